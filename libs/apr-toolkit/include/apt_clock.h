@@ -0,0 +1,57 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef APT_CLOCK_H
+#define APT_CLOCK_H
+
+/**
+ * @file apt_clock.h
+ * @brief Coarse Clock Cached per Loop Iteration
+ *
+ * The clock is read once per iteration of the MPF scheduler and poller task
+ * loops, and the time is then taken from the cache by the paths which run
+ * within the iteration and only need millisecond accuracy, such as the arrival
+ * time of RTP packets. The clocks are read directly where sub-millisecond
+ * accuracy is needed (profiling, the timestamps of log entries).
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/**
+ * Read the clocks and update the cache.
+ * @return the real time just read (usec since epoch)
+ * @remark Called by the loops at the start of each iteration, from any number of threads.
+ */
+APT_DECLARE(apr_time_t) apt_clock_update(void);
+
+/**
+ * Get the real time cached by the last update (usec since epoch).
+ * @remark The clock is read directly, if the cache has never been updated.
+ */
+APT_DECLARE(apr_time_t) apt_clock_now(void);
+
+/**
+ * Get the monotonic time cached by the last update (usec, never going backwards).
+ * @remark The clock is read directly, if the cache has never been updated.
+ */
+APT_DECLARE(apr_time_t) apt_clock_monotonic_now(void);
+
+APT_END_EXTERN_C
+
+#endif /* APT_CLOCK_H */
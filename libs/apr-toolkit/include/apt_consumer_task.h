@@ -27,6 +27,9 @@
 
 APT_BEGIN_EXTERN_C
 
+/** Default capacity of the message queue of consumer task */
+#define CONSUMER_TASK_QUEUE_SIZE 1024
+
 /** Opaque consumer task declaration */
 typedef struct apt_consumer_task_t apt_consumer_task_t;
 
@@ -41,6 +44,20 @@ APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create(
 									apt_task_msg_pool_t *msg_pool,
 									apr_pool_t *pool);
 
+/**
+ * Create consumer task (extended version).
+ * @param obj the external object to associate with the task
+ * @param msg_pool the pool of task messages
+ * @param queue_size the capacity of the message queue (rounded up to a power of two)
+ * @param pool the pool to allocate memory from
+ * @remark signaling a message to the task never blocks, it fails if the queue is full
+ */
+APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create_ex(
+									void *obj,
+									apt_task_msg_pool_t *msg_pool,
+									apr_size_t queue_size,
+									apr_pool_t *pool);
+
 /**
  * Get task base.
  * @param task the consumer task to get base for
@@ -72,6 +89,12 @@ APT_DECLARE(apt_timer_t*) apt_consumer_task_timer_create(
 								void *obj,
 								apr_pool_t *pool);
 
+/**
+ * Get the number of messages pending in the queue of consumer task.
+ * @param task the consumer task to get the queue size of
+ */
+APT_DECLARE(apr_size_t) apt_consumer_task_queue_size_get(const apt_consumer_task_t *task);
+
 APT_END_EXTERN_C
 
 #endif /* APT_CONSUMER_TASK_H */
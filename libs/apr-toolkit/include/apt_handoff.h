@@ -0,0 +1,115 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APT_HANDOFF_H
+#define APT_HANDOFF_H
+
+/**
+ * @file apt_handoff.h
+ * @brief Handoff of Listening Sockets to a Successor Process
+ *
+ * A running process serves a UNIX socket, a successor started with the same
+ * path connects to it and receives the registered listening sockets, which
+ * are then taken by the address they are bound to instead of being bound
+ * anew. The predecessor is notified once the successor has started, stops
+ * accepting and drains, while the successor takes over serving the path.
+ * Not supported on Windows.
+ */
+
+#include <apr_network_io.h>
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max number of sockets handed off */
+#define APT_HANDOFF_MAX_SOCKET_COUNT 64
+
+/** Opaque handoff declaration */
+typedef struct apt_handoff_t apt_handoff_t;
+
+/**
+ * Handler called once the sockets have been taken over by a successor.
+ * @param handoff the handoff
+ * @param obj the object the handoff is served with
+ * @remark Called from the thread serving the handoff.
+ */
+typedef void (*apt_handoff_handler_f)(apt_handoff_t *handoff, void *obj);
+
+/**
+ * Create handoff.
+ * @param path the path of the UNIX socket
+ * @param pool the pool to allocate memory from
+ */
+APT_DECLARE(apt_handoff_t*) apt_handoff_create(const char *path, apr_pool_t *pool);
+
+/**
+ * Destroy handoff, stop serving and close the sockets inherited, but not taken.
+ * @param handoff the handoff to destroy
+ */
+APT_DECLARE(void) apt_handoff_destroy(apt_handoff_t *handoff);
+
+/**
+ * Receive the listening sockets of the predecessor, if any is serving the path.
+ * @param handoff the handoff
+ * @return the number of sockets received
+ * @remark The predecessor keeps accepting till apt_handoff_complete() is called.
+ */
+APT_DECLARE(apr_size_t) apt_handoff_receive(apt_handoff_t *handoff);
+
+/**
+ * Take an inherited listening socket.
+ * @param handoff the handoff
+ * @param sockaddr the address the socket must be bound to
+ * @param pool the pool to allocate the socket from
+ * @return the socket, NULL if none is inherited for the address
+ */
+APT_DECLARE(apr_socket_t*) apt_handoff_socket_take(apt_handoff_t *handoff, const apr_sockaddr_t *sockaddr, apr_pool_t *pool);
+
+/**
+ * Register a listening socket to hand off to the successor.
+ * @param handoff the handoff
+ * @param sock the listening socket
+ */
+APT_DECLARE(apt_bool_t) apt_handoff_socket_add(apt_handoff_t *handoff, apr_socket_t *sock);
+
+/**
+ * Unregister a listening socket, which is about to be closed.
+ * @param handoff the handoff
+ * @param sock the listening socket
+ */
+APT_DECLARE(void) apt_handoff_socket_remove(apt_handoff_t *handoff, apr_socket_t *sock);
+
+/**
+ * Complete the takeover on start, then serve the path for a successor.
+ * @param handoff the handoff
+ * @param handler the handler to call once the sockets are taken over by a successor
+ * @param obj the object to pass to the handler
+ * @remark The predecessor, if any, is released, stops accepting and drains.
+ */
+APT_DECLARE(apt_bool_t) apt_handoff_complete(apt_handoff_t *handoff, apt_handoff_handler_f handler, void *obj);
+
+/**
+ * Set the handoff the listening sockets of the process are taken from and registered to.
+ * @param handoff the handoff, NULL to reset
+ */
+APT_DECLARE(void) apt_handoff_instance_set(apt_handoff_t *handoff);
+
+/** Get the handoff of the process, NULL if none */
+APT_DECLARE(apt_handoff_t*) apt_handoff_instance_get(void);
+
+APT_END_EXTERN_C
+
+#endif /* APT_HANDOFF_H */
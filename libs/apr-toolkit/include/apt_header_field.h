@@ -35,7 +35,12 @@ typedef struct apt_header_field_t apt_header_field_t;
 /** Header section declaration */
 typedef struct apt_header_section_t apt_header_section_t;
 
-/** Header field */
+/** 
+ * Header field
+ * @remark The name and value of a header field are typically stored inline, in the same
+ * allocation as the header field itself. Once the numeric identifier of a header field
+ * is known, the name refers to the interned (static) string of the protocol string table.
+ */
 struct apt_header_field_t {
 	/** Ring entry */
 	APR_RING_ENTRY(apt_header_field_t) link;
@@ -71,6 +76,15 @@ struct apt_header_section_t {
  */
 APT_DECLARE(apt_header_field_t*) apt_header_field_alloc(apr_pool_t *pool);
 
+/**
+ * Allocate a header field along with its name and value in a single block.
+ * @param name_length the length of the name to store inline
+ * @param value_length the length of the value to store inline
+ * @param pool the pool to allocate memory from
+ * @remark The name and value are nul-terminated, the caller fills them in.
+ */
+APT_DECLARE(apt_header_field_t*) apt_header_field_inline_alloc(apr_size_t name_length, apr_size_t value_length, apr_pool_t *pool);
+
 /**
  * Create a header field using given name and value APT strings.
  * @param name the name of the header field
@@ -99,6 +113,7 @@ APT_DECLARE(apt_header_field_t*) apt_header_field_create_from_line(const apt_str
  * Copy specified header field.
  * @param src_header_field the header field to copy
  * @param pool the pool to allocate memory from
+ * @remark The interned name of a known header field is shared rather than copied.
  */
 APT_DECLARE(apt_header_field_t*) apt_header_field_copy(const apt_header_field_t *src_header_field, apr_pool_t *pool);
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef APT_HISTOGRAM_H
+#define APT_HISTOGRAM_H
+
+/**
+ * @file apt_histogram.h
+ * @brief Log-Linear (HDR Style) Histogram of Values
+ */ 
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque histogram declaration */
+typedef struct apt_histogram_t apt_histogram_t;
+
+/**
+ * Create histogram.
+ * @param pool the pool to allocate memory from
+ * @remark Values below 32 are counted exactly, larger ones fall into one of
+ *         16 buckets per power of two, which keeps the relative error within 6.25%.
+ */
+APT_DECLARE(apt_histogram_t*) apt_histogram_create(apr_pool_t *pool);
+
+/**
+ * Record value (any thread, lock-free).
+ * @param histogram the histogram to record value to
+ * @param value the value to record
+ */
+APT_DECLARE(void) apt_histogram_record(apt_histogram_t *histogram, apr_uint32_t value);
+
+/**
+ * Reset recorded values.
+ * @param histogram the histogram to reset
+ */
+APT_DECLARE(void) apt_histogram_reset(apt_histogram_t *histogram);
+
+/**
+ * Get the number of recorded values.
+ * @param histogram the histogram to query
+ */
+APT_DECLARE(apr_size_t) apt_histogram_count_get(const apt_histogram_t *histogram);
+
+/**
+ * Get the min recorded value (0 if none).
+ * @param histogram the histogram to query
+ */
+APT_DECLARE(apr_uint32_t) apt_histogram_min_get(const apt_histogram_t *histogram);
+
+/**
+ * Get the max recorded value (0 if none).
+ * @param histogram the histogram to query
+ */
+APT_DECLARE(apr_uint32_t) apt_histogram_max_get(const apt_histogram_t *histogram);
+
+/**
+ * Get the (approximate) mean of recorded values.
+ * @param histogram the histogram to query
+ */
+APT_DECLARE(double) apt_histogram_mean_get(const apt_histogram_t *histogram);
+
+/**
+ * Get the value at percentile.
+ * @param histogram the histogram to query
+ * @param percentile the percentile [0..100]
+ * @return the highest value equivalent to the bucket the percentile falls into (0 if none)
+ */
+APT_DECLARE(apr_uint32_t) apt_histogram_percentile_get(const apt_histogram_t *histogram, double percentile);
+
+APT_END_EXTERN_C
+
+#endif /* APT_HISTOGRAM_H */
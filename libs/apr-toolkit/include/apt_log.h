@@ -33,7 +33,7 @@ APT_BEGIN_EXTERN_C
 /** Default max number of log files used in rotation */
 #define MAX_LOG_FILE_COUNT 100
 
-/** Opaque log source declaration */
+/** Log source declaration */
 typedef struct apt_log_source_t apt_log_source_t;
 
 /** Declaration of log mark to be used by custom log sources */
@@ -121,6 +121,16 @@ typedef enum {
 	APT_LOG_MASKING_ENCRYPTED  /**< encrypt private data */
 } apt_log_masking_e;
 
+/** Log source */
+struct apt_log_source_t {
+	/** Name of the log source */
+	const char        *name;
+	/** Max priority of log entries passed through */
+	apt_log_priority_e priority;
+	/** Masking mode of private data */
+	apt_log_masking_e  masking;
+};
+
 /** Opaque logger declaration */
 typedef struct apt_logger_t apt_logger_t;
 
@@ -205,6 +215,28 @@ APT_DECLARE(apt_bool_t) apt_log_file_open_ex(const char *dir_path, const char *p
  */
 APT_DECLARE(apt_bool_t) apt_log_file_close(void);
 
+/**
+ * Start asynchronous logging.
+ * @param buffer_size the size of the ring buffer in bytes
+ * @param pool the memory pool to use
+ * @remark log entries are formatted by the calling thread and then
+ *         written to the outputs by a background writer thread;
+ *         entries which don't fit into the ring buffer are dropped
+ *         rather than blocking the calling thread
+ */
+APT_DECLARE(apt_bool_t) apt_log_async_start(apr_size_t buffer_size, apr_pool_t *pool);
+
+/**
+ * Stop asynchronous logging, write out pending entries and switch back
+ * to synchronous logging.
+ */
+APT_DECLARE(apt_bool_t) apt_log_async_stop(void);
+
+/**
+ * Get the number of log entries dropped in asynchronous mode so far.
+ */
+APT_DECLARE(apr_size_t) apt_log_async_dropped_get(void);
+
 /**
  * Open the syslog.
  * @param prefix the prefix used to compose the log file name
@@ -286,6 +318,30 @@ APT_DECLARE(apt_log_masking_e) apt_log_masking_translate(const char *str);
  */
 APT_DECLARE(const char*) apt_log_data_mask(const char *data_in, apr_size_t *length, apr_pool_t *pool);
 
+/**
+ * Set the max priority of log entries out of the sampled scopes.
+ * @param priority the priority to set, e.g. APT_PRIO_NOTICE (APT_PRIO_DEBUG - sampling disabled)
+ * @remark Entries of lower priority (more verbose) are logged only by the threads
+ *         within a scope of a higher priority, e.g. while processing a session
+ *         sampled, provided they pass the filter of the log source as well,
+ *         which is therefore set to the verbose priority.
+ */
+APT_DECLARE(void) apt_log_sampling_set(apt_log_priority_e priority);
+
+/**
+ * Get the max priority of log entries out of the sampled scopes.
+ */
+APT_DECLARE(apt_log_priority_e) apt_log_sampling_get(void);
+
+/**
+ * Enter the scope of the calling thread, e.g. the session processed.
+ * @param priority the max priority of log entries of the scope (APT_PRIO_COUNT - leave the scope)
+ * @return the priority of the scope left
+ * @remark The priority is typically decided once per session and cached on the
+ *         session and its channels, so that entering the scope is a single store.
+ */
+APT_DECLARE(apt_log_priority_e) apt_log_scope_set(apt_log_priority_e priority);
+
 /**
  * Set the extended external log handler.
  * @param handler the handler to pass log events to
@@ -326,6 +382,35 @@ APT_DECLARE(apt_bool_t) apt_obj_log(apt_log_source_t *log_source, const char *fi
  */
 APT_DECLARE(apt_bool_t) apt_va_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr);
 
+/**
+ * Check whether log entries of the specified priority pass the filter of the log source.
+ * @param LOG_SOURCE the log source
+ * @param PRIORITY the priority to check
+ */
+#define APT_LOG_PRIORITY_CHECK(LOG_SOURCE,PRIORITY) ((PRIORITY) <= (LOG_SOURCE)->priority)
+
+/** Expand the arguments (MSVC otherwise passes __VA_ARGS__ on as a single argument) */
+#define APT_LOG_EXPAND(x) x
+
+/** Call apt_log() only if the priority passes the filter, the arguments are not evaluated otherwise */
+#define APT_LOG_FILTER(LOG_SOURCE,LOG_FILE,LOG_LINE,PRIORITY,...) \
+	(APT_LOG_PRIORITY_CHECK(LOG_SOURCE,PRIORITY) ? \
+		(apt_log)(LOG_SOURCE,LOG_FILE,LOG_LINE,PRIORITY,__VA_ARGS__) : TRUE)
+
+/** Call apt_obj_log() only if the priority passes the filter, the arguments are not evaluated otherwise */
+#define APT_OBJ_LOG_FILTER(LOG_SOURCE,LOG_FILE,LOG_LINE,PRIORITY,...) \
+	(APT_LOG_PRIORITY_CHECK(LOG_SOURCE,PRIORITY) ? \
+		(apt_obj_log)(LOG_SOURCE,LOG_FILE,LOG_LINE,PRIORITY,__VA_ARGS__) : TRUE)
+
+/*
+ * Route the calls through the inline priority check, which saves both the
+ * function call and the evaluation of the arguments of filtered out log entries.
+ * The log mark is expanded first, so that it provides the source, file and line.
+ * Note the log source and the priority may be evaluated twice.
+ */
+#define apt_log(...)     APT_LOG_EXPAND(APT_LOG_FILTER(__VA_ARGS__))
+#define apt_obj_log(...) APT_LOG_EXPAND(APT_OBJ_LOG_FILTER(__VA_ARGS__))
+
 APT_END_EXTERN_C
 
 #endif /* APT_LOG_H */
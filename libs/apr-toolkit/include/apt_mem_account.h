@@ -0,0 +1,106 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef APT_MEM_ACCOUNT_H
+#define APT_MEM_ACCOUNT_H
+
+/**
+ * @file apt_mem_account.h
+ * @brief Accounting of Memory by Owner
+ *
+ * APR pools tell nothing of their size, unless APR is built with pool
+ * debugging, so the memory held on behalf of an owner (session, engine)
+ * is charged to its account by the code allocating it, and uncharged once
+ * freed. Accounts form a tree: a charge is applied to the account and all
+ * its ancestors, and is denied, as a whole, if any of their caps is exceeded.
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque memory account declaration */
+typedef struct apt_mem_account_t apt_mem_account_t;
+
+/** Statistics of memory account */
+typedef struct apt_mem_account_stats_t apt_mem_account_stats_t;
+
+/** Statistics of memory account */
+struct apt_mem_account_stats_t {
+	/** Number of bytes currently charged */
+	apr_size_t used;
+	/** Max number of bytes charged at once */
+	apr_size_t peak;
+	/** Max number of bytes allowed (0 - unlimited) */
+	apr_size_t cap;
+	/** Number of charges denied */
+	apr_size_t denied;
+};
+
+/**
+ * Create memory account.
+ * @param name the name of the account to log
+ * @param cap the max number of bytes allowed (0 - unlimited)
+ * @param parent the account charges are also applied to (NULL if none)
+ * @param pool the pool to allocate memory from
+ */
+APT_DECLARE(apt_mem_account_t*) apt_mem_account_create(const char *name, apr_size_t cap, apt_mem_account_t *parent, apr_pool_t *pool);
+
+/**
+ * Destroy memory account, the bytes still charged are uncharged from the ancestors.
+ * @param account the account to destroy
+ */
+APT_DECLARE(void) apt_mem_account_destroy(apt_mem_account_t *account);
+
+/**
+ * Charge bytes to account (any thread).
+ * @param account the account to charge
+ * @param size the number of bytes to charge
+ * @return FALSE if the cap of the account or of any ancestor would be exceeded, nothing is charged then
+ */
+APT_DECLARE(apt_bool_t) apt_mem_account_charge(apt_mem_account_t *account, apr_size_t size);
+
+/**
+ * Uncharge bytes charged before (any thread).
+ * @param account the account to uncharge
+ * @param size the number of bytes to uncharge
+ */
+APT_DECLARE(void) apt_mem_account_uncharge(apt_mem_account_t *account, apr_size_t size);
+
+/**
+ * Set the cap of account, the bytes already charged are kept even if exceeding it.
+ * @param account the account to set the cap of
+ * @param cap the max number of bytes allowed (0 - unlimited)
+ */
+APT_DECLARE(void) apt_mem_account_cap_set(apt_mem_account_t *account, apr_size_t cap);
+
+/**
+ * Get the number of bytes currently charged.
+ * @param account the account to query
+ */
+APT_DECLARE(apr_size_t) apt_mem_account_used_get(apt_mem_account_t *account);
+
+/**
+ * Get statistics of account.
+ * @param account the account to query
+ * @param stats the statistics to fill
+ */
+APT_DECLARE(void) apt_mem_account_stats_get(apt_mem_account_t *account, apt_mem_account_stats_t *stats);
+
+APT_END_EXTERN_C
+
+#endif /* APT_MEM_ACCOUNT_H */
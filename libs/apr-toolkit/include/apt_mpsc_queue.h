@@ -0,0 +1,71 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APT_MPSC_QUEUE_H
+#define APT_MPSC_QUEUE_H
+
+/**
+ * @file apt_mpsc_queue.h
+ * @brief Lock-free Multi-Producer Single-Consumer Queue of Pointers
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque MPSC queue declaration */
+typedef struct apt_mpsc_queue_t apt_mpsc_queue_t;
+
+/**
+ * Create MPSC queue.
+ * @param capacity the max number of objects (rounded up to the power of two)
+ * @param pool the pool to allocate memory from
+ * @return the created queue
+ * @remark The queue is bounded: producers claim a slot by compare-and-swap and publish
+ *         it by a per-slot sequence number, the consumer never blocks producers.
+ */
+APT_DECLARE(apt_mpsc_queue_t*) apt_mpsc_queue_create(apr_size_t capacity, apr_pool_t *pool);
+
+/**
+ * Push object to the queue (any thread).
+ * @param queue the queue to push object to
+ * @param obj the object to push (not NULL)
+ * @return FALSE if the queue is full
+ */
+APT_DECLARE(apt_bool_t) apt_mpsc_queue_push(apt_mpsc_queue_t *queue, void *obj);
+
+/**
+ * Pop the oldest published object from the queue (consumer thread only).
+ * @param queue the queue to pop object from
+ * @return the object, or NULL if the queue is empty
+ */
+APT_DECLARE(void*) apt_mpsc_queue_pop(apt_mpsc_queue_t *queue);
+
+/**
+ * Get the (approximate) number of objects in the queue.
+ * @param queue the queue to query
+ */
+APT_DECLARE(apr_size_t) apt_mpsc_queue_size(const apt_mpsc_queue_t *queue);
+
+/**
+ * Get the max number of objects the queue can hold.
+ * @param queue the queue to query
+ */
+APT_DECLARE(apr_size_t) apt_mpsc_queue_capacity(const apt_mpsc_queue_t *queue);
+
+APT_END_EXTERN_C
+
+#endif /* APT_MPSC_QUEUE_H */
@@ -36,7 +36,7 @@ typedef struct apt_content_part_t apt_content_part_t;
 struct apt_content_part_t {
 	/** Header section */
 	apt_header_section_t header;
-	/** Body */
+	/** Body, a span of the parsed multipart content (not nul-terminated) */
 	apt_str_t            body;
 
 	/** Pointer to parsed content-type header field */
@@ -97,6 +97,9 @@ APT_DECLARE(apt_multipart_content_t*) apt_multipart_content_assign(const apt_str
  * @param content_part the parsed content part
  * @param is_final indicates the final boundary is reached
  * @return TRUE on success
+ * @remark Once the boundary is known, the delimiters are searched for in a single pass over
+ *         the content; the body of a part without Content-Length spans up to the next delimiter.
+ *         The body refers to the assigned content, which must outlive the content part.
  */
 APT_DECLARE(apt_bool_t) apt_multipart_content_get(apt_multipart_content_t *multipart_content, apt_content_part_t *content_part, apt_bool_t *is_final);
 
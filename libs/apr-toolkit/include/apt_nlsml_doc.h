@@ -26,7 +26,7 @@
  */
 
 #include <apr_xml.h>
-#include "apt.h"
+#include "apt_string.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -47,6 +47,17 @@ typedef struct nlsml_input_t nlsml_input_t;
  */
 APT_DECLARE(nlsml_result_t*) nlsml_result_parse(const char *data, apr_size_t length, apr_pool_t *pool);
 
+/**
+ * Scan NLSML result, without building a document
+ * @param data the data to scan
+ * @param length the length of the data
+ * @param pool the memory pool to use
+ * @return the scanned NLSML result.
+ * @remark The instances and inputs refer to the spans of the data, which must outlive the result;
+ *         they have no XML representation, their content is generated of the spans instead.
+ */
+APT_DECLARE(nlsml_result_t*) nlsml_result_scan(const char *data, apr_size_t length, apr_pool_t *pool);
+
 /**
  * Trace parsed NLSML result (for debug purposes only)
  * @param result the parsed result to output
@@ -148,9 +159,17 @@ APT_DECLARE(const char*) nlsml_interpretation_grammar_get(const nlsml_interpreta
 /**
  * Get an XML representation of the instance element
  * @param instance the parsed instance element
+ * @remark NULL if the result is scanned
  */
 APT_DECLARE(const apr_xml_elem*) nlsml_instance_elem_get(const nlsml_instance_t *instance);
 
+/**
+ * Get the inner content of the instance element, as is
+ * @param instance the scanned instance element
+ * @remark The span is empty if the result is parsed
+ */
+APT_DECLARE(const apt_str_t*) nlsml_instance_span_get(const nlsml_instance_t *instance);
+
 /**
  * Suppress SWI elements (normalize instance)
  * @param instance the parsed instance to suppress SWI sub-elements from
@@ -167,9 +186,17 @@ APT_DECLARE(const char*) nlsml_instance_content_generate(const nlsml_instance_t
 /**
  * Get an XML representation of the input element
  * @param input the parsed input element
+ * @remark NULL if the result is scanned
  */
 APT_DECLARE(const apr_xml_elem*) nlsml_input_elem_get(const nlsml_input_t *input);
 
+/**
+ * Get the inner content of the input element, as is
+ * @param input the scanned input element
+ * @remark The span is empty if the result is parsed
+ */
+APT_DECLARE(const apt_str_t*) nlsml_input_span_get(const nlsml_input_t *input);
+
 /**
  * Generate a plain text content of the input element
  * @param input the parsed input to generate content of
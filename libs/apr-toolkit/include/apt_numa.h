@@ -0,0 +1,69 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APT_NUMA_H
+#define APT_NUMA_H
+
+/**
+ * @file apt_numa.h
+ * @brief NUMA Topology and Memory Placement
+ *
+ * The topology is read from sysfs and the memory policy is set by the
+ * system call, so that no extra library is required. On other platforms
+ * one node holding all the CPUs is reported and the policy is not set.
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** No node, memory is allocated by the default policy */
+#define APT_NUMA_NODE_NONE       -1
+/** Memory is interleaved across all the nodes */
+#define APT_NUMA_NODE_INTERLEAVE -2
+
+/** Max number of nodes supported */
+#define APT_NUMA_MAX_NODE_COUNT  64
+
+/** Get the number of nodes (1 if the topology is unknown) */
+APT_DECLARE(apr_size_t) apt_numa_node_count_get(void);
+
+/**
+ * Get the CPUs of a node.
+ * @param node the node to get the CPUs of
+ * @param pool the pool to allocate memory from
+ * @return the list of CPUs and ranges of CPUs (e.g. "0-7,16-23") as accepted
+ *         by apt_task_affinity_set(), NULL if unknown
+ */
+APT_DECLARE(const char*) apt_numa_node_cpu_set_get(apr_size_t node, apr_pool_t *pool);
+
+/**
+ * Get the node of a CPU.
+ * @param cpu the CPU to get the node of
+ * @return the node, APT_NUMA_NODE_NONE if unknown
+ */
+APT_DECLARE(int) apt_numa_cpu_node_get(int cpu);
+
+/**
+ * Set the memory policy of the calling thread.
+ * @param node the node to prefer, APT_NUMA_NODE_INTERLEAVE or APT_NUMA_NODE_NONE to reset
+ * @remark Only memory touched afterwards is placed according to the policy.
+ */
+APT_DECLARE(apt_bool_t) apt_numa_memory_policy_set(int node);
+
+APT_END_EXTERN_C
+
+#endif /* APT_NUMA_H */
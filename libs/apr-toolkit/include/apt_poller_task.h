@@ -34,6 +34,9 @@ typedef struct apt_poller_task_t apt_poller_task_t;
 /** Function prototype to handle signalled descripors */
 typedef apt_bool_t (*apt_poll_signal_f)(void *obj, const apr_pollfd_t *descriptor);
 
+/** Function prototype to handle the end of a poll iteration */
+typedef void (*apt_poll_iteration_f)(void *obj);
+
 
 /**
  * Create poller task.
@@ -95,6 +98,14 @@ APT_DECLARE(apt_task_vtable_t*) apt_poller_task_vtable_get(const apt_poller_task
  */
 APT_DECLARE(void*) apt_poller_task_object_get(const apt_poller_task_t *task);
 
+/**
+ * Set the handler raised once per poll iteration.
+ * @param task the poller task
+ * @param iteration_handler the handler raised after the signalled descriptors, messages
+ *        and timers of the iteration are processed (e.g. to flush the output buffered meanwhile)
+ */
+APT_DECLARE(void) apt_poller_task_iteration_handler_set(apt_poller_task_t *task, apt_poll_iteration_f iteration_handler);
+
 /**
  * Add descriptor to pollset.
  * @param task the task which holds the pollset
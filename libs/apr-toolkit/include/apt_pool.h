@@ -33,6 +33,8 @@ APT_BEGIN_EXTERN_C
 
 /**
  * Create APR pool
+ * @remark The pool is created on the allocator of the calling thread, if one is set,
+ *         otherwise on an allocator of its own.
  */
 APT_DECLARE(apr_pool_t*) apt_pool_create(void);
 
@@ -42,6 +44,92 @@ APT_DECLARE(apr_pool_t*) apt_pool_create(void);
  */
 APT_DECLARE(apr_pool_t*) apt_subpool_create(apr_pool_t *parent);
 
+/**
+ * Get the size of memory allocated from pool and its subpools.
+ * @param pool the pool to get the size of
+ * @return the size, 0 unless APR is built with pool debugging (APR_POOL_DEBUG)
+ */
+APT_DECLARE(apr_size_t) apt_pool_size_get(apr_pool_t *pool);
+
+/**
+ * Create allocator shared by the pools of a thread.
+ * @param max_free the max size of free memory the allocator keeps (0 - unlimited)
+ * @return the allocator, NULL on failure
+ * @remark The allocator is guarded by a mutex of its own, so that the pools created on it
+ *         may be destroyed by any thread. It's never destroyed, since such pools may
+ *         outlive the thread; the free memory beyond the max size is returned to the system.
+ */
+APT_DECLARE(apr_allocator_t*) apt_thread_allocator_create(apr_size_t max_free);
+
+/**
+ * Set allocator the pools created by the calling thread are created on.
+ * @param allocator the allocator to set, NULL to create a pool with its own allocator each
+ */
+APT_DECLARE(void) apt_thread_allocator_set(apr_allocator_t *allocator);
+
+/**
+ * Get allocator of the calling thread (NULL if not set).
+ */
+APT_DECLARE(apr_allocator_t*) apt_thread_allocator_get(void);
+
+
+/** Opaque cache of recycled pools declaration */
+typedef struct apt_pool_cache_t apt_pool_cache_t;
+
+/** Statistics of the cache of pools */
+typedef struct apt_pool_cache_stats_t apt_pool_cache_stats_t;
+
+/** Statistics of the cache of pools */
+struct apt_pool_cache_stats_t {
+	/** Number of pools acquired */
+	apr_size_t acquired;
+	/** Number of pools taken from the cache (hits) */
+	apr_size_t reused;
+	/** Number of pools released */
+	apr_size_t released;
+	/** Number of released pools destroyed instead of being cached (full cache) */
+	apr_size_t discarded;
+	/** Number of pools currently cached */
+	apr_size_t cached;
+};
+
+/**
+ * Create cache of recycled pools.
+ * @param max_count the max number of released pools kept for reuse
+ * @param max_retained_size the max size of free memory a released pool keeps (0 - unlimited)
+ * @param pool the pool to allocate memory from
+ * @remark Pools are acquired and released by any thread. A released pool is cleared
+ *         and the memory beyond the max retained size is returned to the system.
+ */
+APT_DECLARE(apt_pool_cache_t*) apt_pool_cache_create(apr_size_t max_count, apr_size_t max_retained_size, apr_pool_t *pool);
+
+/**
+ * Destroy the cached pools.
+ * @param cache the cache to destroy
+ * @remark No pool acquired from the cache must be released afterwards.
+ */
+APT_DECLARE(void) apt_pool_cache_destroy(apt_pool_cache_t *cache);
+
+/**
+ * Acquire pool, taken from the cache or created, if there is none.
+ * @param cache the cache to acquire pool from
+ */
+APT_DECLARE(apr_pool_t*) apt_pool_cache_acquire(apt_pool_cache_t *cache);
+
+/**
+ * Release pool acquired from the cache.
+ * @param cache the cache to release pool to
+ * @param pool the pool to release, anything allocated from it is gone
+ */
+APT_DECLARE(void) apt_pool_cache_release(apt_pool_cache_t *cache, apr_pool_t *pool);
+
+/**
+ * Get statistics of the cache.
+ * @param cache the cache to get statistics of
+ * @param stats the statistics to fill
+ */
+APT_DECLARE(void) apt_pool_cache_stats_get(apt_pool_cache_t *cache, apt_pool_cache_stats_t *stats);
+
 APT_END_EXTERN_C
 
 #endif /* APT_POOL_H */
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APT_PROBE_H
+#define APT_PROBE_H
+
+/**
+ * @file apt_probe.h
+ * @brief Static Tracepoints (USDT)
+ *
+ * Probes placed on the hot paths (RTP in, jitter buffer out, MRCP parsing,
+ * requests and responses of engine channels, decoding) to be attached to by
+ * eBPF (bpftrace, bcc) or SystemTap in production. A probe unattached costs
+ * a single nop; probes are compiled in if APT_USDT_PROBES is defined, that is,
+ * with --enable-usdt (ENABLE_USDT in CMake) and <sys/sdt.h> is available, and
+ * are compiled out otherwise, along with their arguments.
+ *
+ * The provider is "unimrcp". The arguments are integers, pointers and
+ * NUL-terminated strings, the ids of the session or channel first.
+ */
+
+#include "apt.h"
+
+#ifdef APT_USDT_PROBES
+
+#include <sys/sdt.h>
+
+/** Probe with no arguments */
+#define APT_PROBE0(name) \
+	DTRACE_PROBE(unimrcp,name)
+/** Probe with 1 argument */
+#define APT_PROBE1(name,a1) \
+	DTRACE_PROBE1(unimrcp,name,a1)
+/** Probe with 2 arguments */
+#define APT_PROBE2(name,a1,a2) \
+	DTRACE_PROBE2(unimrcp,name,a1,a2)
+/** Probe with 3 arguments */
+#define APT_PROBE3(name,a1,a2,a3) \
+	DTRACE_PROBE3(unimrcp,name,a1,a2,a3)
+/** Probe with 4 arguments */
+#define APT_PROBE4(name,a1,a2,a3,a4) \
+	DTRACE_PROBE4(unimrcp,name,a1,a2,a3,a4)
+/** Probe with 5 arguments */
+#define APT_PROBE5(name,a1,a2,a3,a4,a5) \
+	DTRACE_PROBE5(unimrcp,name,a1,a2,a3,a4,a5)
+
+#else
+
+#define APT_PROBE0(name) do {} while(0)
+#define APT_PROBE1(name,a1) do {} while(0)
+#define APT_PROBE2(name,a1,a2) do {} while(0)
+#define APT_PROBE3(name,a1,a2,a3) do {} while(0)
+#define APT_PROBE4(name,a1,a2,a3,a4) do {} while(0)
+#define APT_PROBE5(name,a1,a2,a3,a4,a5) do {} while(0)
+
+#endif
+
+#endif /* APT_PROBE_H */
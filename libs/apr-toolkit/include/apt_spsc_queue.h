@@ -0,0 +1,84 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APT_SPSC_QUEUE_H
+#define APT_SPSC_QUEUE_H
+
+/**
+ * @file apt_spsc_queue.h
+ * @brief Lock-free Single-Producer Single-Consumer Queue of Fixed-Size Elements
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque SPSC queue declaration */
+typedef struct apt_spsc_queue_t apt_spsc_queue_t;
+
+/**
+ * Create SPSC queue.
+ * @param capacity the max number of elements (rounded up to the power of two)
+ * @param elem_size the size of each element
+ * @param pool the pool to allocate memory from
+ * @return the created queue
+ * @remark Elements are stored in-place: the producer fills a slot and commits it,
+ *         the consumer processes a slot and releases it. No allocation or locking
+ *         takes place after the queue is created.
+ */
+APT_DECLARE(apt_spsc_queue_t*) apt_spsc_queue_create(apr_size_t capacity, apr_size_t elem_size, apr_pool_t *pool);
+
+/**
+ * Get the next free slot to write to (producer side).
+ * @param queue the queue to write to
+ * @return the slot to fill, or NULL if the queue is full
+ */
+APT_DECLARE(void*) apt_spsc_queue_write_begin(apt_spsc_queue_t *queue);
+
+/**
+ * Commit the slot previously obtained by apt_spsc_queue_write_begin() (producer side).
+ * @param queue the queue to commit slot to
+ */
+APT_DECLARE(void) apt_spsc_queue_write_commit(apt_spsc_queue_t *queue);
+
+/**
+ * Get the oldest committed slot to read from (consumer side).
+ * @param queue the queue to read from
+ * @return the slot to process, or NULL if the queue is empty
+ */
+APT_DECLARE(void*) apt_spsc_queue_read_begin(apt_spsc_queue_t *queue);
+
+/**
+ * Release the slot previously obtained by apt_spsc_queue_read_begin() (consumer side).
+ * @param queue the queue to release slot to
+ */
+APT_DECLARE(void) apt_spsc_queue_read_commit(apt_spsc_queue_t *queue);
+
+/**
+ * Get the number of committed elements in the queue.
+ * @param queue the queue to query
+ */
+APT_DECLARE(apr_size_t) apt_spsc_queue_size(const apt_spsc_queue_t *queue);
+
+/**
+ * Get the max number of elements the queue can hold.
+ * @param queue the queue to query
+ */
+APT_DECLARE(apr_size_t) apt_spsc_queue_capacity(const apt_spsc_queue_t *queue);
+
+APT_END_EXTERN_C
+
+#endif /* APT_SPSC_QUEUE_H */
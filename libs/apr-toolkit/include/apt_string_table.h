@@ -38,6 +38,24 @@ struct apt_str_table_item_t {
 	apr_size_t key;
 };
 
+/** String table index declaration */
+typedef struct apt_str_table_index_t apt_str_table_index_t;
+
+/**
+ * Minimal perfect hash index of a string table.
+ *
+ * The hash of a string selects a bucket. The bucket holds either
+ * the slot itself, encoded as (-slot - 1), or the seed to rehash
+ * the string with in order to get the slot. Every slot maps to the id of exactly one string.
+ * Indexes of the static tables are generated by strtablegen.
+ */
+struct apt_str_table_index_t {
+	/** Slots (negative) or seeds (positive) by bucket, one per item */
+	const apr_int32_t *buckets;
+	/** Ids of the items by slot, one per item */
+	const apr_size_t  *ids;
+};
+
 
 /**
  * Get the string by a given id.
@@ -57,6 +75,25 @@ APT_DECLARE(const apt_str_t*) apt_string_table_str_get(const apt_str_table_item_
  */
 APT_DECLARE(apr_size_t) apt_string_table_id_find(const apt_str_table_item_t table[], apr_size_t size, const apt_str_t *value);
 
+/**
+ * Find the id associated with a given string by the perfect hash index.
+ * @param table the table to search for the id
+ * @param size the size of the table
+ * @param index the index of the table (linear search is used if NULL)
+ * @param value the string to search for
+ * @return the id associated with the string, or invalid id if string cannot be matched
+ */
+APT_DECLARE(apr_size_t) apt_string_table_index_find(const apt_str_table_item_t table[], apr_size_t size, const apt_str_table_index_t *index, const apt_str_t *value);
+
+/**
+ * Generate the perfect hash index of a string table.
+ * @param table the table to generate the index for
+ * @param size the size of the table
+ * @param pool the pool to allocate the index from
+ * @return the index, or NULL if the table contains duplicate strings
+ */
+APT_DECLARE(apt_str_table_index_t*) apt_string_table_index_generate(const apt_str_table_item_t table[], apr_size_t size, apr_pool_t *pool);
+
 
 APT_END_EXTERN_C
 
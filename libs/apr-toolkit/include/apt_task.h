@@ -24,9 +24,14 @@
 
 #include "apt.h"
 #include "apt_task_msg.h"
+#include "apt_histogram.h"
+#include "apt_numa.h"
 
 APT_BEGIN_EXTERN_C
 
+/** Max number of CPUs the task thread can be pinned to */
+#define TASK_MAX_CPU_COUNT 256
+
 /** Opaque task declaration */
 typedef struct apt_task_t apt_task_t;
 /** Opaque task virtual table declaration */
@@ -36,6 +41,15 @@ typedef apt_bool_t (*apt_task_method_f)(apt_task_t *task);
 /** Opaque task event declaration */
 typedef void (*apt_task_event_f)(apt_task_t *task);
 
+/** Enumeration of task histograms */
+typedef enum {
+	TASK_HISTOGRAM_QUEUE_DEPTH,  /**< number of pending messages, sampled as each message is processed */
+	TASK_HISTOGRAM_DWELL_TIME,   /**< time (usec) from signaling a message till its processing starts */
+	TASK_HISTOGRAM_PROCESS_TIME, /**< time (usec) spent processing a message */
+
+	TASK_HISTOGRAM_COUNT         /**< number of histograms */
+} apt_task_histogram_e;
+
 
 /**
  * Create task.
@@ -139,6 +153,21 @@ APT_DECLARE(apt_bool_t) apt_task_terminate_request_process(apt_task_t *task);
  */
 APT_DECLARE(apt_task_t*) apt_task_parent_get(const apt_task_t *task);
 
+/**
+ * Get the first child task.
+ * @param task the task to get child from
+ * @return the first child task, or NULL if none
+ */
+APT_DECLARE(apt_task_t*) apt_task_child_first(const apt_task_t *task);
+
+/**
+ * Get the next child task.
+ * @param task the task to get child from
+ * @param child_task the current child task
+ * @return the next child task, or NULL if the current one is the last
+ */
+APT_DECLARE(apt_task_t*) apt_task_child_next(const apt_task_t *task, const apt_task_t *child_task);
+
 /**
  * Get memory pool associated with task.
  * @param task the task to get pool from
@@ -170,6 +199,103 @@ APT_DECLARE(void) apt_task_name_set(apt_task_t *task, const char *name);
  */
 APT_DECLARE(const char*) apt_task_name_get(const apt_task_t *task);
 
+/**
+ * Set CPU affinity of the task thread.
+ * @param task the task to set affinity for
+ * @param cpu_set the list of CPUs and ranges of CPUs (e.g. "0-3,6"), NULL or empty to reset
+ * @return FALSE if the list is malformed or exceeds TASK_MAX_CPU_COUNT
+ * @remark Should be called before the task is started, the affinity is applied
+ *         by the task thread itself. Supported on Linux and Windows (first 64 CPUs).
+ */
+APT_DECLARE(apt_bool_t) apt_task_affinity_set(apt_task_t *task, const char *cpu_set);
+
+/**
+ * Get CPU of the task affinity.
+ * @param task the task to get CPU of
+ * @param index the index of CPU in the set, wrapped around the number of CPUs
+ * @return the CPU, or -1 if no affinity is set
+ * @remark Used by tasks running several threads, to pin each of them to a single CPU.
+ */
+APT_DECLARE(int) apt_task_affinity_cpu_get(const apt_task_t *task, apr_size_t index);
+
+/**
+ * Set NUMA node of the task thread.
+ * @param task the task to set node for
+ * @param node the node to place memory of the thread on (APT_NUMA_NODE_NONE to reset)
+ * @remark Should be called before the task is started. Unless CPU affinity is set
+ *         explicitly, the thread is also pinned to the CPUs of the node.
+ */
+APT_DECLARE(apt_bool_t) apt_task_numa_node_set(apt_task_t *task, int node);
+
+/**
+ * Get NUMA node of the task thread.
+ * @param task the task to get node of
+ * @return the node, or APT_NUMA_NODE_NONE if not set
+ */
+APT_DECLARE(int) apt_task_numa_node_get(const apt_task_t *task);
+
+/**
+ * Enable allocator of the task thread.
+ * @param task the task to enable allocator for
+ * @param max_free the max size of free memory the allocator keeps (0 - unlimited)
+ * @remark Should be called before the task is started. The pools created by the thread
+ *         by apt_pool_create() share the allocator instead of having one each, which saves
+ *         an allocator and a mutex per pool and bounds the memory kept after load bursts.
+ */
+APT_DECLARE(apt_bool_t) apt_task_allocator_enable(apt_task_t *task, apr_size_t max_free);
+
+/**
+ * Set priority of the task thread.
+ * @param task the task to set priority for
+ * @param priority the real-time priority [1..99], 0 for the default scheduling
+ * @remark Should be called before the task is started. Real-time (SCHED_FIFO) priority
+ *         requires privileges on Linux, on Windows it's mapped to a thread priority level.
+ */
+APT_DECLARE(apt_bool_t) apt_task_priority_set(apt_task_t *task, int priority);
+
+/**
+ * Get priority of the task thread.
+ * @param task the task to get priority of
+ */
+APT_DECLARE(int) apt_task_priority_get(const apt_task_t *task);
+
+/**
+ * Enable statistics of the task.
+ * @param task the task to enable statistics for
+ * @param dump_interval the interval (msec) to log the statistics at, 0 not to log periodically
+ * @remark Should be called before the task is started. The statistics are disabled by default,
+ *         which costs a single check per message. A periodic dump is triggered by a processed message,
+ *         so an idle task doesn't log anything.
+ */
+APT_DECLARE(apt_bool_t) apt_task_stats_enable(apt_task_t *task, apr_size_t dump_interval);
+
+/**
+ * Get task histogram.
+ * @param task the task to get histogram from
+ * @param type the type of histogram to get
+ * @return the histogram, or NULL if the statistics are disabled
+ */
+APT_DECLARE(const apt_histogram_t*) apt_task_histogram_get(const apt_task_t *task, apt_task_histogram_e type);
+
+/**
+ * Get the number of messages pending in the queue of the task.
+ * @param task the task to get queue depth of
+ * @return the number of pending messages, or 0 if the statistics are disabled
+ */
+APT_DECLARE(apr_size_t) apt_task_pending_get(const apt_task_t *task);
+
+/**
+ * Reset statistics of the task.
+ * @param task the task to reset statistics of
+ */
+APT_DECLARE(void) apt_task_stats_reset(apt_task_t *task);
+
+/**
+ * Log statistics of the task.
+ * @param task the task to log statistics of
+ */
+APT_DECLARE(void) apt_task_stats_dump(const apt_task_t *task);
+
 /**
  * Enable/disable auto ready mode.
  * @param task the task to set mode for
@@ -22,6 +22,7 @@
  * @brief Task Message Base Definition
  */ 
 
+#include <apr_time.h>
 #include "apt.h"
 
 APT_BEGIN_EXTERN_C
@@ -57,20 +58,61 @@ struct apt_task_msg_t {
 	int                  type;
 	/** Task msg sub type */
 	int                  sub_type;
+	/** Time the message has been signaled at (set only if the task statistics are enabled) */
+	apr_time_t           signal_time;
 	/** Context specific data */
 	char                 data[1];
 };
 
 
-/** Create pool of task messages with dynamic allocation of messages (no actual pool is created) */
+/** Statistics of task message pool */
+typedef struct apt_task_msg_pool_stats_t apt_task_msg_pool_stats_t;
+
+/** Statistics of task message pool */
+struct apt_task_msg_pool_stats_t {
+	/** Number of messages acquired */
+	apr_size_t acquired;
+	/** Number of messages released */
+	apr_size_t released;
+	/** Number of messages allocated from the heap */
+	apr_size_t allocated;
+	/** Number of messages returned to the heap */
+	apr_size_t freed;
+	/** Max number of messages in use at once */
+	apr_size_t max_used;
+};
+
+
+/**
+ * Create pool of task messages with dynamic allocation of messages.
+ * @remark released messages are kept in a lock-free freelist for reuse,
+ *         messages above the default high-water mark are returned to the heap
+ */
 APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_dynamic(apr_size_t msg_size, apr_pool_t *pool);
 
-/** Create pool of task messages with static allocation of messages */
+/**
+ * Create pool of task messages with static allocation of messages.
+ * @remark msg_pool_size messages are preallocated, the pool is extended
+ *         from the heap, if they all are in use
+ */
 APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_static(apr_size_t msg_size, apr_size_t msg_pool_size, apr_pool_t *pool);
 
+/**
+ * Create pool of task messages (extended version).
+ * @param msg_size the size of message specific data
+ * @param prealloc_count the number of messages to preallocate
+ * @param max_free_count the max number of free heap allocated messages to keep for reuse
+ *        (high-water mark, rounded up to a power of two, 0 to keep none)
+ * @param pool the memory pool to use
+ */
+APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_ex(apr_size_t msg_size, apr_size_t prealloc_count, apr_size_t max_free_count, apr_pool_t *pool);
+
 /** Destroy pool of task messages */
 APT_DECLARE(void) apt_task_msg_pool_destroy(apt_task_msg_pool_t *msg_pool);
 
+/** Get statistics of task message pool */
+APT_DECLARE(void) apt_task_msg_pool_stats_get(const apt_task_msg_pool_t *msg_pool, apt_task_msg_pool_stats_t *stats);
+
 
 /** Acquire task message from task message pool */
 APT_DECLARE(apt_task_msg_t*) apt_task_msg_acquire(apt_task_msg_pool_t *task_msg_pool);
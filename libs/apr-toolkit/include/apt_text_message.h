@@ -60,6 +60,23 @@ APT_DECLARE(void*) apt_message_parser_object_get(apt_message_parser_t *parser);
 /** Set verbose mode for the parser */
 APT_DECLARE(void) apt_message_parser_verbose_set(apt_message_parser_t *parser, apt_bool_t verbose);
 
+/**
+ * Get the remaining part of the message body being parsed, data can directly be received into.
+ * @param parser the parser to get the body buffer of
+ * @param buf the pointer to the remaining part of the body buffer
+ * @param length the length of the remaining part
+ * @return TRUE if the parser awaits body data only
+ */
+APT_DECLARE(apt_bool_t) apt_message_parser_body_buffer_get(apt_message_parser_t *parser, char **buf, apr_size_t *length);
+
+/**
+ * Account the data directly received into the body buffer.
+ * @param parser the parser to fill the body buffer of
+ * @param length the length of the received data
+ * @remark The message gets completed by the next apt_message_parser_run() called for an empty stream.
+ */
+APT_DECLARE(void) apt_message_parser_body_buffer_fill(apt_message_parser_t *parser, apr_size_t length);
+
 
 /** Create message generator */
 APT_DECLARE(apt_message_generator_t*) apt_message_generator_create(void *obj, const apt_message_generator_vtable_t *vtable, apr_pool_t *pool);
@@ -93,8 +110,10 @@ struct apt_message_context_t {
 	void                 *message;
 	/** Header section of the message */
 	apt_header_section_t *header;
-	/** Body or content of the message */
+	/** Body or content of the message (the buffer of at least length+1 bytes may be set by on_header_complete) */
 	apt_str_t            *body;
+	/** Pool to allocate the header and body of the message from (the pool of the parser, if not set) */
+	apr_pool_t           *pool;
 };
 
 /** Vtable of text message parser */
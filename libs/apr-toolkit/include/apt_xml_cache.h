@@ -0,0 +1,74 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef APT_XML_CACHE_H
+#define APT_XML_CACHE_H
+
+/**
+ * @file apt_xml_cache.h
+ * @brief Binary Cache of Parsed XML Documents
+ *
+ * A parsed document is saved to a cache file as a compact image of its
+ * element tree, which is read back at once instead of parsed again, as long
+ * as the size and the modification time of the source file are unchanged.
+ * The image is validated by a checksum, an invalid or stale cache is
+ * ignored and the source file is parsed instead.
+ *
+ * Image layout (host byte order, 32-bit fields)
+ *    header:  "AXC1", version, source size (64), source mtime (64), payload length, checksum
+ *    payload: namespaces, then the element tree in pre-order
+ *    element: name, ns, lang, cdata, following cdata, attributes (name, ns, value), children
+ *    strings: length (or ~0 for NULL), chars, nul
+ */
+
+#include <apr_xml.h>
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/**
+ * Load XML document, from the cache if it is valid, otherwise by parsing the source file and caching it.
+ * @param file_path the path to the source file
+ * @param cache_path the path to the cache file (NULL to parse only)
+ * @param pool the pool to allocate the document from
+ * @return the document, NULL if the source file can be neither read nor parsed
+ */
+APT_DECLARE(apr_xml_doc*) apt_xml_doc_load(const char *file_path, const char *cache_path, apr_pool_t *pool);
+
+/**
+ * Save XML document to cache file, replacing the previous one at once.
+ * @param doc the document to save
+ * @param cache_path the path to the cache file
+ * @param size the size of the source file
+ * @param mtime the modification time of the source file
+ * @param pool the pool to allocate temporary memory from
+ */
+APT_DECLARE(apt_bool_t) apt_xml_cache_save(const apr_xml_doc *doc, const char *cache_path, apr_off_t size, apr_time_t mtime, apr_pool_t *pool);
+
+/**
+ * Load XML document from cache file.
+ * @param cache_path the path to the cache file
+ * @param size the size of the source file
+ * @param mtime the modification time of the source file
+ * @param pool the pool to allocate the document from
+ * @return the document, NULL if there is no valid image of the source file
+ */
+APT_DECLARE(apr_xml_doc*) apt_xml_cache_load(const char *cache_path, apr_off_t size, apr_time_t mtime, apr_pool_t *pool);
+
+APT_END_EXTERN_C
+
+#endif /* APT_XML_CACHE_H */
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "apt_clock.h"
+
+#if defined(__linux__)
+#include <time.h>
+#define APT_CLOCK_MONOTONIC
+#endif
+
+/** Sequence number of the updates, odd while an update is in progress (0 if never updated) */
+static volatile apr_uint32_t clock_seq = 0;
+/** Cached real time */
+static volatile apr_time_t clock_real = 0;
+/** Cached monotonic time */
+static volatile apr_time_t clock_monotonic = 0;
+
+/** Read the monotonic clock, the real time stands for it where there is none */
+static APR_INLINE apr_time_t apt_clock_monotonic_read(apr_time_t real)
+{
+#ifdef APT_CLOCK_MONOTONIC
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC,&ts) == 0) {
+		return (apr_time_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+#endif
+	return real;
+}
+
+/** Read the cache consistently, the times are 64-bit and updated by any thread (seqlock) */
+static apt_bool_t apt_clock_read(apr_time_t *real, apr_time_t *monotonic)
+{
+	apr_uint32_t seq;
+	do {
+		seq = apr_atomic_read32(&clock_seq);
+		if(!seq) {
+			return FALSE;
+		}
+		*real = clock_real;
+		*monotonic = clock_monotonic;
+	}
+	/* compared and set to the same value, as a full barrier ordering the reads above */
+	while((seq & 1) || apr_atomic_cas32(&clock_seq,seq,seq) != seq);
+	return TRUE;
+}
+
+APT_DECLARE(apr_time_t) apt_clock_update(void)
+{
+	apr_time_t real = apr_time_now();
+	apr_time_t monotonic = apt_clock_monotonic_read(real);
+	apr_uint32_t seq = apr_atomic_read32(&clock_seq);
+	if((seq & 1) || apr_atomic_cas32(&clock_seq,seq + 1,seq) != seq) {
+		/* another loop is updating the cache right now, with the time as fresh */
+		return real;
+	}
+	clock_real = real;
+	if(monotonic > clock_monotonic) {
+		/* the loops read the clock in any order, the time published never goes backwards */
+		clock_monotonic = monotonic;
+	}
+	apr_atomic_inc32(&clock_seq);
+	return real;
+}
+
+APT_DECLARE(apr_time_t) apt_clock_now(void)
+{
+	apr_time_t real;
+	apr_time_t monotonic;
+	if(apt_clock_read(&real,&monotonic) == FALSE) {
+		return apr_time_now();
+	}
+	return real;
+}
+
+APT_DECLARE(apr_time_t) apt_clock_monotonic_now(void)
+{
+	apr_time_t real;
+	apr_time_t monotonic;
+	if(apt_clock_read(&real,&monotonic) == FALSE) {
+		real = apr_time_now();
+		return apt_clock_monotonic_read(real);
+	}
+	return monotonic;
+}
@@ -15,17 +15,26 @@
  */
 
 #include <apr_time.h>
-#include <apr_queue.h>
+#include <apr_atomic.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
 #include "apt_consumer_task.h"
+#include "apt_mpsc_queue.h"
 #include "apt_log.h"
 
+/** Max number of messages processed before the timers are checked */
+#define CONSUMER_TASK_BATCH_SIZE 64
+
 struct apt_consumer_task_t {
-	void              *obj;
-	apt_task_t        *base;
-	apr_queue_t       *msg_queue;
-#if APR_HAS_QUEUE_TIMEOUT
-	apt_timer_queue_t *timer_queue;
-#endif
+	void                 *obj;
+	apt_task_t           *base;
+	apt_mpsc_queue_t     *msg_queue;
+	/** Mutex and condition used only while the consumer waits for messages */
+	apr_thread_mutex_t   *wait_mutex;
+	apr_thread_cond_t    *wait_cond;
+	/** Whether the consumer waits (or is about to wait) for messages */
+	volatile apr_uint32_t waiting;
+	apt_timer_queue_t    *timer_queue;
 };
 
 static apt_bool_t apt_consumer_task_msg_signal(apt_task_t *task, apt_task_msg_t *msg);
@@ -35,12 +44,28 @@ APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create(
 									void *obj,
 									apt_task_msg_pool_t *msg_pool,
 									apr_pool_t *pool)
+{
+	return apt_consumer_task_create_ex(obj,msg_pool,CONSUMER_TASK_QUEUE_SIZE,pool);
+}
+
+APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create_ex(
+									void *obj,
+									apt_task_msg_pool_t *msg_pool,
+									apr_size_t queue_size,
+									apr_pool_t *pool)
 {
 	apt_task_vtable_t *vtable;
 	apt_consumer_task_t *consumer_task = apr_palloc(pool,sizeof(apt_consumer_task_t));
 	consumer_task->obj = obj;
-	consumer_task->msg_queue = NULL;
-	if(apr_queue_create(&consumer_task->msg_queue,1024,pool) != APR_SUCCESS) {
+	consumer_task->waiting = 0;
+	consumer_task->msg_queue = apt_mpsc_queue_create(queue_size ? queue_size : CONSUMER_TASK_QUEUE_SIZE,pool);
+	if(!consumer_task->msg_queue) {
+		return NULL;
+	}
+	if(apr_thread_mutex_create(&consumer_task->wait_mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_thread_cond_create(&consumer_task->wait_cond,pool) != APR_SUCCESS) {
 		return NULL;
 	}
 	
@@ -55,10 +80,7 @@ APT_DECLARE(apt_consumer_task_t*) apt_consumer_task_create(
 		vtable->signal_msg = apt_consumer_task_msg_signal;
 	}
 
-#if APR_HAS_QUEUE_TIMEOUT
 	consumer_task->timer_queue = apt_timer_queue_create(pool);
-#endif
-
 	return consumer_task;
 }
 
@@ -83,30 +105,68 @@ APT_DECLARE(apt_timer_t*) apt_consumer_task_timer_create(
 									void *obj, 
 									apr_pool_t *pool)
 {
-#if APR_HAS_QUEUE_TIMEOUT
 	return apt_timer_create(task->timer_queue,proc,obj,pool);
-#else
-	return NULL;
-#endif
+}
+
+APT_DECLARE(apr_size_t) apt_consumer_task_queue_size_get(const apt_consumer_task_t *task)
+{
+	return apt_mpsc_queue_size(task->msg_queue);
 }
 
 static apt_bool_t apt_consumer_task_msg_signal(apt_task_t *task, apt_task_msg_t *msg)
 {
 	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
-	return (apr_queue_push(consumer_task->msg_queue,msg) == APR_SUCCESS) ? TRUE : FALSE;
+	if(apt_mpsc_queue_push(consumer_task->msg_queue,msg) == FALSE) {
+		/* report back-pressure rather than block the producer */
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Message Queue is Full [%s]",apt_task_name_get(task));
+		return FALSE;
+	}
+
+	/* the push is fenced, so either the consumer sees the message on its re-check or it is signaled */
+	if(apr_atomic_add32(&consumer_task->waiting,0)) {
+		apr_thread_mutex_lock(consumer_task->wait_mutex);
+		apr_thread_cond_signal(consumer_task->wait_cond);
+		apr_thread_mutex_unlock(consumer_task->wait_mutex);
+	}
+	return TRUE;
+}
+
+static apt_task_msg_t* apt_consumer_task_msg_wait(apt_consumer_task_t *consumer_task, apr_interval_time_t timeout, apr_status_t *rv)
+{
+	apt_task_msg_t *msg;
+	*rv = APR_SUCCESS;
+	apr_thread_mutex_lock(consumer_task->wait_mutex);
+	apr_atomic_xchg32(&consumer_task->waiting,1);
+	/* re-check the queue once the producers are going to signal */
+	msg = apt_mpsc_queue_pop(consumer_task->msg_queue);
+	if(!msg) {
+		if(timeout >= 0) {
+			*rv = apr_thread_cond_timedwait(consumer_task->wait_cond,consumer_task->wait_mutex,timeout);
+		}
+		else {
+			*rv = apr_thread_cond_wait(consumer_task->wait_cond,consumer_task->wait_mutex);
+		}
+	}
+	apr_atomic_xchg32(&consumer_task->waiting,0);
+	apr_thread_mutex_unlock(consumer_task->wait_mutex);
+
+	if(!msg) {
+		msg = apt_mpsc_queue_pop(consumer_task->msg_queue);
+	}
+	return msg;
 }
 
 static apt_bool_t apt_consumer_task_run(apt_task_t *task)
 {
 	apr_status_t rv;
-	void *msg;
+	apt_task_msg_t *msg;
 	apt_bool_t *running;
 	apt_consumer_task_t *consumer_task;
-#if APR_HAS_QUEUE_TIMEOUT
+	apr_size_t count;
 	apr_interval_time_t timeout;
-	apr_uint32_t queue_timeout;
-	apr_time_t time_now, time_last = 0;
-#endif
+	apr_uint32_t queue_timeout = 0;
+	apr_time_t time_now, time_last;
+	apr_uint32_t elapsed;
 	const char *task_name;
 
 	consumer_task = apt_task_object_get(task);
@@ -120,49 +180,53 @@ static apt_bool_t apt_consumer_task_run(apt_task_t *task)
 		return FALSE;
 	}
 
+	time_last = apr_time_now();
 	while(*running) {
-#if APR_HAS_QUEUE_TIMEOUT
-		if(apt_timer_queue_timeout_get(consumer_task->timer_queue,&queue_timeout) == TRUE) {
-			timeout = (apr_interval_time_t)queue_timeout * 1000;
-			time_last = apr_time_now();
-			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s] timeout [%u]",
-				task_name, queue_timeout);
-			rv = apr_queue_timedpop(consumer_task->msg_queue,timeout,&msg);
-		}
-		else
-		{
-			timeout = -1;
-			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s]",task_name);
-			rv = apr_queue_pop(consumer_task->msg_queue,&msg);
+		/* process pending messages in a batch, no lock is taken as long as there are any */
+		rv = APR_SUCCESS;
+		timeout = -1;
+		for(count = 0; count < CONSUMER_TASK_BATCH_SIZE; count++) {
+			msg = apt_mpsc_queue_pop(consumer_task->msg_queue);
+			if(!msg) {
+				break;
+			}
+			apt_task_msg_process(consumer_task->base,msg);
 		}
-#else
-		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s]",task_name);
-		rv = apr_queue_pop(consumer_task->msg_queue,&msg);
-#endif
-		if(rv == APR_SUCCESS) {
+
+		if(!count) {
+			if(apt_timer_queue_timeout_get(consumer_task->timer_queue,&queue_timeout) == TRUE) {
+				timeout = (apr_interval_time_t)queue_timeout * 1000;
+				apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s] timeout [%u]",
+					task_name, queue_timeout);
+			}
+			else {
+				apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s]",task_name);
+			}
+			msg = apt_consumer_task_msg_wait(consumer_task,timeout,&rv);
 			if(msg) {
-				apt_task_msg_t *task_msg = msg;
-				apt_task_msg_process(consumer_task->base,task_msg);
+				apt_task_msg_process(consumer_task->base,msg);
+			}
+			else if(rv != APR_SUCCESS && rv != APR_TIMEUP) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Wait for Messages [%s] status: %d",task_name,rv);
 			}
-		}
-		else if(rv != APR_TIMEUP) {
-			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Pop Message [%s] status: %d",task_name,rv);
 		}
 
-#if APR_HAS_QUEUE_TIMEOUT
-		if(timeout != -1) {
-			time_now = apr_time_now();
-			if(time_now > time_last) {
-				apt_timer_queue_advance(consumer_task->timer_queue,(apr_uint32_t)((time_now - time_last)/1000));
+		time_now = apr_time_now();
+		if(time_now >= time_last) {
+			elapsed = (apr_uint32_t)((time_now - time_last) / 1000);
+			if(elapsed) {
+				apt_timer_queue_advance(consumer_task->timer_queue,elapsed);
+				/* keep the sub-millisecond remainder */
+				time_last += (apr_time_t)elapsed * 1000;
 			}
-			else {
-				/* If NTP has drifted the clock backwards, advance the queue based on the set timeout but not actual time difference */
-				if(rv == APR_TIMEUP) {
-					apt_timer_queue_advance(consumer_task->timer_queue,queue_timeout);
-				}
+		}
+		else {
+			/* If NTP has drifted the clock backwards, advance the queue based on the set timeout but not actual time difference */
+			if(rv == APR_TIMEUP) {
+				apt_timer_queue_advance(consumer_task->timer_queue,queue_timeout);
 			}
+			time_last = time_now;
 		}
-#endif
 	}
 	return TRUE;
 }
@@ -0,0 +1,533 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* struct ucred of SO_PEERCRED */
+#define _GNU_SOURCE
+#endif
+
+#include <apr_portable.h>
+#include <apr_strings.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include "apt_handoff.h"
+#include "apt_log.h"
+
+#ifndef WIN32
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#endif
+
+/** Magic of the message the sockets are passed with */
+#define HANDOFF_MAGIC       "UHOF"
+/** Byte the successor acknowledges the takeover with */
+#define HANDOFF_ACK         'A'
+/** Interval (msec) the serving thread checks for termination at */
+#define HANDOFF_POLL_TIMEOUT 500
+
+#if !defined(WIN32) && !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0
+#endif
+
+/** Handoff of listening sockets */
+struct apt_handoff_t {
+	/** Path of the UNIX socket */
+	const char            *path;
+	/** Connection to the predecessor (-1 if none) */
+	int                    predecessor_fd;
+	/** Socket the path is served by (-1 if not served) */
+	int                    listen_fd;
+	/** Sockets inherited from the predecessor (-1 once taken) */
+	int                    inherited[APT_HANDOFF_MAX_SOCKET_COUNT];
+	/** Number of inherited sockets */
+	apr_size_t             inherited_count;
+	/** Sockets to hand off to the successor */
+	int                    registered[APT_HANDOFF_MAX_SOCKET_COUNT];
+	/** Number of registered sockets */
+	apr_size_t             registered_count;
+	/** Guard of the registered sockets */
+	apr_thread_mutex_t    *guard;
+	/** Thread the path is served by */
+	apr_thread_t          *thread;
+	/** Serving or not */
+	volatile apt_bool_t    running;
+	/** Handler of the takeover */
+	apt_handoff_handler_f  handler;
+	/** Object to pass to the handler */
+	void                  *obj;
+	/** Memory pool */
+	apr_pool_t            *pool;
+};
+
+/** Handoff of the process */
+static apt_handoff_t *handoff_instance = NULL;
+
+APT_DECLARE(apt_handoff_t*) apt_handoff_create(const char *path, apr_pool_t *pool)
+{
+	apt_handoff_t *handoff;
+	if(!path) {
+		return NULL;
+	}
+	handoff = apr_palloc(pool,sizeof(apt_handoff_t));
+	handoff->path = apr_pstrdup(pool,path);
+	handoff->predecessor_fd = -1;
+	handoff->listen_fd = -1;
+	handoff->inherited_count = 0;
+	handoff->registered_count = 0;
+	handoff->guard = NULL;
+	handoff->thread = NULL;
+	handoff->running = FALSE;
+	handoff->handler = NULL;
+	handoff->obj = NULL;
+	handoff->pool = pool;
+	if(apr_thread_mutex_create(&handoff->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return handoff;
+}
+
+APT_DECLARE(void) apt_handoff_instance_set(apt_handoff_t *handoff)
+{
+	handoff_instance = handoff;
+}
+
+APT_DECLARE(apt_handoff_t*) apt_handoff_instance_get(void)
+{
+	return handoff_instance;
+}
+
+#ifndef WIN32
+
+static apt_bool_t handoff_sockaddr_set(apt_handoff_t *handoff, struct sockaddr_un *addr)
+{
+	if(strlen(handoff->path) >= sizeof(addr->sun_path)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Too Long Handoff Path [%s]",handoff->path);
+		return FALSE;
+	}
+	memset(addr,0,sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path,handoff->path);
+	return TRUE;
+}
+
+/** Wait for the descriptor to be readable, FALSE on timeout */
+static apt_bool_t handoff_readable_wait(int fd)
+{
+	struct pollfd pfd;
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd,1,HANDOFF_POLL_TIMEOUT) > 0 ? TRUE : FALSE;
+}
+
+/** Check the process connected is run by the same user, anyone else must never take over the sockets */
+static apt_bool_t handoff_peer_check(apt_handoff_t *handoff, int fd)
+{
+	uid_t uid;
+#if defined(SO_PEERCRED)
+	struct ucred cred;
+	socklen_t length = sizeof(cred);
+	if(getsockopt(fd,SOL_SOCKET,SO_PEERCRED,&cred,&length) != 0 || length != sizeof(cred)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Handoff Peer Credentials [%s] errno [%d]",handoff->path,errno);
+		return FALSE;
+	}
+	uid = cred.uid;
+#else
+	gid_t gid;
+	if(getpeereid(fd,&uid,&gid) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Handoff Peer Credentials [%s] errno [%d]",handoff->path,errno);
+		return FALSE;
+	}
+#endif
+	if(uid != geteuid()) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Refuse Handoff to Peer of Another User [%s] uid [%ld]",handoff->path,(long)uid);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Pass the registered sockets to the successor and wait for acknowledgement */
+static apt_bool_t handoff_sockets_send(apt_handoff_t *handoff, int fd)
+{
+	char data[sizeof(HANDOFF_MAGIC) - 1 + sizeof(apr_uint32_t)];
+	char control[CMSG_SPACE(sizeof(int) * APT_HANDOFF_MAX_SOCKET_COUNT)];
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	apr_uint32_t count;
+	char ack = 0;
+	ssize_t rc;
+
+	apr_thread_mutex_lock(handoff->guard);
+	count = (apr_uint32_t)handoff->registered_count;
+	memcpy(data,HANDOFF_MAGIC,sizeof(HANDOFF_MAGIC) - 1);
+	memcpy(data + sizeof(HANDOFF_MAGIC) - 1,&count,sizeof(count));
+	iov.iov_base = data;
+	iov.iov_len = sizeof(data);
+	memset(&msg,0,sizeof(msg));
+	memset(control,0,sizeof(control));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if(count) {
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+		memcpy(CMSG_DATA(cmsg),handoff->registered,sizeof(int) * count);
+	}
+	rc = sendmsg(fd,&msg,MSG_NOSIGNAL);
+	apr_thread_mutex_unlock(handoff->guard);
+	if(rc != (ssize_t)sizeof(data)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Hand Off Sockets [%s] errno [%d]",handoff->path,errno);
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Hand Off Sockets [%s] [%u]",handoff->path,count);
+
+	/* the successor acknowledges once started, or closes the connection on failure */
+	while(handoff->running == TRUE) {
+		if(handoff_readable_wait(fd) == FALSE) {
+			continue;
+		}
+		rc = read(fd,&ack,1);
+		if(rc < 0 && errno == EINTR) {
+			continue;
+		}
+		break;
+	}
+	if(ack != HANDOFF_ACK) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Handoff Aborted by Successor [%s]",handoff->path);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void* APR_THREAD_FUNC handoff_thread_run(apr_thread_t *thread, void *data)
+{
+	apt_handoff_t *handoff = data;
+	apt_bool_t status = FALSE;
+	int fd;
+
+	while(handoff->running == TRUE && status == FALSE) {
+		if(handoff_readable_wait(handoff->listen_fd) == FALSE) {
+			continue;
+		}
+		fd = accept(handoff->listen_fd,NULL,NULL);
+		if(fd < 0) {
+			continue;
+		}
+		if(handoff_peer_check(handoff,fd) == FALSE) {
+			close(fd);
+			continue;
+		}
+		status = handoff_sockets_send(handoff,fd);
+		close(fd);
+	}
+
+	if(status == TRUE) {
+		/* the path is owned by the successor from now on, it must not be unlinked */
+		close(handoff->listen_fd);
+		handoff->listen_fd = -1;
+		if(handoff->handler) {
+			handoff->handler(handoff,handoff->obj);
+		}
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+APT_DECLARE(apr_size_t) apt_handoff_receive(apt_handoff_t *handoff)
+{
+	struct sockaddr_un addr;
+	char data[sizeof(HANDOFF_MAGIC) - 1 + sizeof(apr_uint32_t)];
+	char control[CMSG_SPACE(sizeof(int) * APT_HANDOFF_MAX_SOCKET_COUNT)];
+	struct msghdr msg;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	apr_uint32_t count = 0;
+	ssize_t rc;
+	int fd;
+
+	if(!handoff || handoff->predecessor_fd != -1 || handoff_sockaddr_set(handoff,&addr) == FALSE) {
+		return 0;
+	}
+
+	fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if(fd < 0) {
+		return 0;
+	}
+	if(connect(fd,(struct sockaddr*)&addr,sizeof(addr)) != 0) {
+		/* no predecessor is serving the path */
+		close(fd);
+		return 0;
+	}
+
+	iov.iov_base = data;
+	iov.iov_len = sizeof(data);
+	memset(&msg,0,sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+#ifdef MSG_CMSG_CLOEXEC
+	rc = recvmsg(fd,&msg,MSG_WAITALL | MSG_CMSG_CLOEXEC);
+#else
+	rc = recvmsg(fd,&msg,MSG_WAITALL);
+#endif
+	if(rc != (ssize_t)sizeof(data) || memcmp(data,HANDOFF_MAGIC,sizeof(HANDOFF_MAGIC) - 1) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Receive Handoff [%s]",handoff->path);
+		close(fd);
+		return 0;
+	}
+	memcpy(&count,data + sizeof(HANDOFF_MAGIC) - 1,sizeof(count));
+
+	handoff->inherited_count = 0;
+	for(cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg,cmsg)) {
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+			apr_size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			if(n > APT_HANDOFF_MAX_SOCKET_COUNT) {
+				n = APT_HANDOFF_MAX_SOCKET_COUNT;
+			}
+			memcpy(handoff->inherited,CMSG_DATA(cmsg),sizeof(int) * n);
+			handoff->inherited_count = n;
+		}
+	}
+	if(handoff->inherited_count != count) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Received Incomplete Handoff [%s] [%"APR_SIZE_T_FMT" of %u]",
+			handoff->path,handoff->inherited_count,count);
+	}
+
+	handoff->predecessor_fd = fd;
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Receive Handoff [%s] [%"APR_SIZE_T_FMT" sockets]",
+		handoff->path,handoff->inherited_count);
+	return handoff->inherited_count;
+}
+
+APT_DECLARE(apr_socket_t*) apt_handoff_socket_take(apt_handoff_t *handoff, const apr_sockaddr_t *sockaddr, apr_pool_t *pool)
+{
+	apr_size_t i;
+	if(!handoff || !sockaddr) {
+		return NULL;
+	}
+
+	for(i=0; i<handoff->inherited_count; i++) {
+		struct sockaddr_storage local;
+		socklen_t len = sizeof(local);
+		const void *ipaddr = NULL;
+		apr_port_t port = 0;
+		apr_os_sock_info_t info;
+		apr_os_sock_t fd = handoff->inherited[i];
+		apr_socket_t *sock = NULL;
+		if(fd == -1 || getsockname(fd,(struct sockaddr*)&local,&len) != 0) {
+			continue;
+		}
+
+		if(local.ss_family == AF_INET && sockaddr->family == AF_INET) {
+			const struct sockaddr_in *sin = (const struct sockaddr_in*)&local;
+			ipaddr = &sin->sin_addr;
+			port = ntohs(sin->sin_port);
+		}
+#if APR_HAVE_IPV6
+		else if(local.ss_family == AF_INET6 && sockaddr->family == AF_INET6) {
+			const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6*)&local;
+			ipaddr = &sin6->sin6_addr;
+			port = ntohs(sin6->sin6_port);
+		}
+#endif
+		if(!ipaddr || port != sockaddr->port || memcmp(ipaddr,sockaddr->ipaddr_ptr,sockaddr->ipaddr_len) != 0) {
+			continue;
+		}
+
+		info.os_sock = &fd;
+		info.local = (struct sockaddr*)&local;
+		info.remote = NULL;
+		info.family = local.ss_family;
+		info.type = SOCK_STREAM;
+		info.protocol = APR_PROTO_TCP;
+		if(apr_os_sock_make(&sock,&info,pool) != APR_SUCCESS) {
+			continue;
+		}
+		handoff->inherited[i] = -1;
+		return sock;
+	}
+	return NULL;
+}
+
+APT_DECLARE(apt_bool_t) apt_handoff_socket_add(apt_handoff_t *handoff, apr_socket_t *sock)
+{
+	apr_os_sock_t fd;
+	apt_bool_t status = FALSE;
+	if(!handoff || !sock || apr_os_sock_get(&fd,sock) != APR_SUCCESS) {
+		return FALSE;
+	}
+	apr_thread_mutex_lock(handoff->guard);
+	if(handoff->registered_count < APT_HANDOFF_MAX_SOCKET_COUNT) {
+		handoff->registered[handoff->registered_count++] = fd;
+		status = TRUE;
+	}
+	apr_thread_mutex_unlock(handoff->guard);
+	return status;
+}
+
+APT_DECLARE(void) apt_handoff_socket_remove(apt_handoff_t *handoff, apr_socket_t *sock)
+{
+	apr_os_sock_t fd;
+	apr_size_t i;
+	if(!handoff || !sock || apr_os_sock_get(&fd,sock) != APR_SUCCESS) {
+		return;
+	}
+	apr_thread_mutex_lock(handoff->guard);
+	for(i=0; i<handoff->registered_count; i++) {
+		if(handoff->registered[i] == fd) {
+			handoff->registered[i] = handoff->registered[--handoff->registered_count];
+			break;
+		}
+	}
+	apr_thread_mutex_unlock(handoff->guard);
+}
+
+APT_DECLARE(apt_bool_t) apt_handoff_complete(apt_handoff_t *handoff, apt_handoff_handler_f handler, void *obj)
+{
+	struct sockaddr_un addr;
+	apr_size_t i;
+	char ack = HANDOFF_ACK;
+	if(!handoff || handoff->running == TRUE || handoff_sockaddr_set(handoff,&addr) == FALSE) {
+		return FALSE;
+	}
+
+	/* release the predecessor and close the sockets nobody has taken */
+	if(handoff->predecessor_fd != -1) {
+		if(send(handoff->predecessor_fd,&ack,1,MSG_NOSIGNAL) != 1) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Release Predecessor [%s]",handoff->path);
+		}
+		close(handoff->predecessor_fd);
+		handoff->predecessor_fd = -1;
+	}
+	for(i=0; i<handoff->inherited_count; i++) {
+		if(handoff->inherited[i] != -1) {
+			close(handoff->inherited[i]);
+			handoff->inherited[i] = -1;
+		}
+	}
+	handoff->inherited_count = 0;
+
+	/* take over the path, which is left to a stale or the released predecessor otherwise */
+	unlink(handoff->path);
+	handoff->listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+	if(handoff->listen_fd < 0) {
+		return FALSE;
+	}
+	/* accessible to the user only, before any connection is accepted */
+	if(bind(handoff->listen_fd,(struct sockaddr*)&addr,sizeof(addr)) != 0 ||
+		chmod(handoff->path,S_IRUSR | S_IWUSR) != 0 ||
+		listen(handoff->listen_fd,1) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Serve Handoff [%s] errno [%d]",handoff->path,errno);
+		close(handoff->listen_fd);
+		handoff->listen_fd = -1;
+		return FALSE;
+	}
+
+	handoff->handler = handler;
+	handoff->obj = obj;
+	handoff->running = TRUE;
+	if(apr_thread_create(&handoff->thread,NULL,handoff_thread_run,handoff,handoff->pool) != APR_SUCCESS) {
+		handoff->running = FALSE;
+		close(handoff->listen_fd);
+		handoff->listen_fd = -1;
+		unlink(handoff->path);
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Serve Handoff [%s]",handoff->path);
+	return TRUE;
+}
+
+APT_DECLARE(void) apt_handoff_destroy(apt_handoff_t *handoff)
+{
+	apr_status_t rv;
+	apr_size_t i;
+	if(!handoff) {
+		return;
+	}
+
+	if(handoff->thread) {
+		handoff->running = FALSE;
+		apr_thread_join(&rv,handoff->thread);
+		handoff->thread = NULL;
+	}
+	if(handoff->listen_fd != -1) {
+		/* not handed off, the path is still owned */
+		close(handoff->listen_fd);
+		handoff->listen_fd = -1;
+		unlink(handoff->path);
+	}
+	if(handoff->predecessor_fd != -1) {
+		close(handoff->predecessor_fd);
+		handoff->predecessor_fd = -1;
+	}
+	for(i=0; i<handoff->inherited_count; i++) {
+		if(handoff->inherited[i] != -1) {
+			close(handoff->inherited[i]);
+		}
+	}
+	handoff->inherited_count = 0;
+	if(handoff_instance == handoff) {
+		handoff_instance = NULL;
+	}
+}
+
+#else /* WIN32 */
+
+APT_DECLARE(apr_size_t) apt_handoff_receive(apt_handoff_t *handoff)
+{
+	return 0;
+}
+
+APT_DECLARE(apr_socket_t*) apt_handoff_socket_take(apt_handoff_t *handoff, const apr_sockaddr_t *sockaddr, apr_pool_t *pool)
+{
+	return NULL;
+}
+
+APT_DECLARE(apt_bool_t) apt_handoff_socket_add(apt_handoff_t *handoff, apr_socket_t *sock)
+{
+	return FALSE;
+}
+
+APT_DECLARE(void) apt_handoff_socket_remove(apt_handoff_t *handoff, apr_socket_t *sock)
+{
+}
+
+APT_DECLARE(apt_bool_t) apt_handoff_complete(apt_handoff_t *handoff, apt_handoff_handler_f handler, void *obj)
+{
+	apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Handoff Not Supported");
+	return FALSE;
+}
+
+APT_DECLARE(void) apt_handoff_destroy(apt_handoff_t *handoff)
+{
+	if(handoff_instance == handoff) {
+		handoff_instance = NULL;
+	}
+}
+
+#endif /* WIN32 */
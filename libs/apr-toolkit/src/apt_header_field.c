@@ -30,77 +30,102 @@ APT_DECLARE(apt_header_field_t*) apt_header_field_alloc(apr_pool_t *pool)
 	return header_field;
 }
 
+/** Allocate a header field along with its name and value in a single block */
+APT_DECLARE(apt_header_field_t*) apt_header_field_inline_alloc(apr_size_t name_length, apr_size_t value_length, apr_pool_t *pool)
+{
+	char *buf;
+	apt_header_field_t *header_field = apr_palloc(pool,sizeof(apt_header_field_t) + name_length + value_length + 2);
+	buf = (char*)header_field + sizeof(apt_header_field_t);
+	header_field->name.buf = buf;
+	header_field->name.length = name_length;
+	buf[name_length] = '\0';
+
+	buf += name_length + 1;
+	header_field->value.buf = buf;
+	header_field->value.length = value_length;
+	buf[value_length] = '\0';
+
+	header_field->id = UNKNOWN_HEADER_FIELD_ID;
+	APR_RING_ELEM_INIT(header_field,link);
+	return header_field;
+}
+
+/** Create a header field storing a copy of the name and value inline */
+static apt_header_field_t* apt_header_field_inline_create(const char *name, apr_size_t name_length, const char *value, apr_size_t value_length, apr_pool_t *pool)
+{
+	apt_header_field_t *header_field = apt_header_field_inline_alloc(name_length,value_length,pool);
+	if(name_length) {
+		memcpy(header_field->name.buf,name,name_length);
+	}
+	if(value_length) {
+		memcpy(header_field->value.buf,value,value_length);
+	}
+	return header_field;
+}
+
 /** Create a header field using given name and value APT strings */
 APT_DECLARE(apt_header_field_t*) apt_header_field_create(const apt_str_t *name, const apt_str_t *value, apr_pool_t *pool)
 {
-	apt_header_field_t *header_field;
 	if(!name || !value) {
 		return NULL;
 	}
-	header_field = apr_palloc(pool,sizeof(apt_header_field_t));
-	apt_string_copy(&header_field->name,name,pool);
-	apt_string_copy(&header_field->value,value,pool);
-	header_field->id = UNKNOWN_HEADER_FIELD_ID;
-	APR_RING_ELEM_INIT(header_field,link);
-	return header_field;
+	return apt_header_field_inline_create(name->buf,name->length,value->buf,value->length,pool);
 }
 
 /** Create a header field using given name and value C strings */
 APT_DECLARE(apt_header_field_t*) apt_header_field_create_c(const char *name, const char *value, apr_pool_t *pool)
 {
-	apt_header_field_t *header_field;
 	if(!name || !value) {
 		return NULL;
 	}
-	header_field = apr_palloc(pool,sizeof(apt_header_field_t));
-	apt_string_assign(&header_field->name,name,pool);
-	apt_string_assign(&header_field->value,value,pool);
-	header_field->id = UNKNOWN_HEADER_FIELD_ID;
-	APR_RING_ELEM_INIT(header_field,link);
-	return header_field;
+	return apt_header_field_inline_create(name,strlen(name),value,strlen(value),pool);
 }
 
 /* Create a header field from entire text line consisting of a name and value pair */
 APT_DECLARE(apt_header_field_t*) apt_header_field_create_from_line(const apt_str_t *line, char separator, apr_pool_t *pool)
 {
-	apt_str_t item;
+	apt_str_t name;
+	apt_str_t value;
 	apt_text_stream_t stream;
-	apt_header_field_t *header_field;
 	if(!line) {
 		return NULL;
 	}
 	
-	header_field = apr_palloc(pool,sizeof(apt_header_field_t));
 	stream.text = *line;
 	apt_text_stream_reset(&stream);
 
 	/* read name */
-	if(apt_text_field_read(&stream,separator,TRUE,&item) == FALSE) {
+	if(apt_text_field_read(&stream,separator,TRUE,&name) == FALSE) {
 		return NULL;
 	}
-	apt_string_copy(&header_field->name,&item,pool);
 
 	/* read value */
-	if(apt_text_field_read(&stream,0,TRUE,&item) == TRUE) {
-		apt_string_copy(&header_field->value,&item,pool);
-	}
-	else {
-		apt_string_reset(&header_field->value);
+	if(apt_text_field_read(&stream,0,TRUE,&value) == FALSE) {
+		apt_string_reset(&value);
 	}
 
-	header_field->id = UNKNOWN_HEADER_FIELD_ID;
-	APR_RING_ELEM_INIT(header_field,link);
-	return header_field;
+	return apt_header_field_inline_create(name.buf,name.length,value.buf,value.length,pool);
 }
 
 /** Copy specified header field */
 APT_DECLARE(apt_header_field_t*) apt_header_field_copy(const apt_header_field_t *src_header_field, apr_pool_t *pool)
 {
-	apt_header_field_t *header_field = apr_palloc(pool,sizeof(apt_header_field_t));
-	apt_string_copy(&header_field->name,&src_header_field->name,pool);
-	apt_string_copy(&header_field->value,&src_header_field->value,pool);
+	apt_header_field_t *header_field;
+	if(src_header_field->id == UNKNOWN_HEADER_FIELD_ID ||
+		src_header_field->name.buf == (const char*)src_header_field + sizeof(apt_header_field_t)) {
+		return apt_header_field_inline_create(
+					src_header_field->name.buf,src_header_field->name.length,
+					src_header_field->value.buf,src_header_field->value.length,
+					pool);
+	}
+
+	/* the name of a known header field is interned, refer to it instead of copying */
+	header_field = apt_header_field_inline_alloc(0,src_header_field->value.length,pool);
+	header_field->name = src_header_field->name;
+	if(src_header_field->value.length) {
+		memcpy(header_field->value.buf,src_header_field->value.buf,src_header_field->value.length);
+	}
 	header_field->id = src_header_field->id;
-	APR_RING_ELEM_INIT(header_field,link);
 	return header_field;
 }
 
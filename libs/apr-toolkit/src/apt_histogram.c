@@ -0,0 +1,199 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_atomic.h>
+#include "apt_histogram.h"
+
+/** Number of bits of the sub-bucket index */
+#define HISTOGRAM_SUB_BUCKET_BITS   5
+/** Number of values counted exactly */
+#define HISTOGRAM_LINEAR_COUNT      (1 << HISTOGRAM_SUB_BUCKET_BITS)
+/** Number of buckets per power of two above the linear range */
+#define HISTOGRAM_SUB_BUCKET_COUNT  (HISTOGRAM_LINEAR_COUNT >> 1)
+/** Total number of buckets to cover 32-bit values */
+#define HISTOGRAM_BUCKET_COUNT      (HISTOGRAM_LINEAR_COUNT + (32 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_SUB_BUCKET_COUNT)
+
+struct apt_histogram_t {
+	/** Counters of values per bucket */
+	volatile apr_uint32_t buckets[HISTOGRAM_BUCKET_COUNT];
+	/** Min recorded value + 1 (0 if none) */
+	volatile apr_uint32_t min;
+	/** Max recorded value */
+	volatile apr_uint32_t max;
+};
+
+/** Load value with full barrier */
+static APR_INLINE apr_uint32_t apt_histogram_load(const volatile apr_uint32_t *value)
+{
+	return apr_atomic_add32((volatile apr_uint32_t*)value,0);
+}
+
+/** Get the index of the most significant bit set */
+static APR_INLINE apr_uint32_t apt_histogram_msb_get(apr_uint32_t value)
+{
+	apr_uint32_t msb = 0;
+	if(value >= 0x10000) { value >>= 16; msb += 16; }
+	if(value >= 0x100) { value >>= 8; msb += 8; }
+	if(value >= 0x10) { value >>= 4; msb += 4; }
+	if(value >= 0x4) { value >>= 2; msb += 2; }
+	if(value >= 0x2) { msb += 1; }
+	return msb;
+}
+
+static APR_INLINE apr_size_t apt_histogram_index_get(apr_uint32_t value)
+{
+	apr_uint32_t shift;
+	if(value < HISTOGRAM_LINEAR_COUNT) {
+		return value;
+	}
+	/* keep HISTOGRAM_SUB_BUCKET_BITS significant bits, the top one is always set */
+	shift = apt_histogram_msb_get(value) - HISTOGRAM_SUB_BUCKET_BITS + 1;
+	return HISTOGRAM_LINEAR_COUNT + (shift - 1) * HISTOGRAM_SUB_BUCKET_COUNT +
+		((value >> shift) - HISTOGRAM_SUB_BUCKET_COUNT);
+}
+
+/** Get the lowest value of the bucket, the width of the bucket is returned too */
+static APR_INLINE apr_uint32_t apt_histogram_bucket_value_get(apr_size_t index, apr_uint32_t *width)
+{
+	apr_uint32_t shift;
+	if(index < HISTOGRAM_LINEAR_COUNT) {
+		*width = 1;
+		return (apr_uint32_t)index;
+	}
+	index -= HISTOGRAM_LINEAR_COUNT;
+	shift = (apr_uint32_t)(index / HISTOGRAM_SUB_BUCKET_COUNT) + 1;
+	*width = (apr_uint32_t)1 << shift;
+	return (apr_uint32_t)(HISTOGRAM_SUB_BUCKET_COUNT + index % HISTOGRAM_SUB_BUCKET_COUNT) << shift;
+}
+
+APT_DECLARE(apt_histogram_t*) apt_histogram_create(apr_pool_t *pool)
+{
+	apt_histogram_t *histogram = apr_palloc(pool,sizeof(apt_histogram_t));
+	apt_histogram_reset(histogram);
+	return histogram;
+}
+
+APT_DECLARE(void) apt_histogram_record(apt_histogram_t *histogram, apr_uint32_t value)
+{
+	apr_uint32_t current;
+	apr_atomic_inc32(&histogram->buckets[apt_histogram_index_get(value)]);
+
+	/* plain reads are enough to skip the common case, a stale value is fixed up by compare-and-swap */
+	current = histogram->max;
+	while(value > current) {
+		apr_uint32_t prev = apr_atomic_cas32(&histogram->max,value,current);
+		if(prev == current) {
+			break;
+		}
+		current = prev;
+	}
+
+	if(value == 0xFFFFFFFF) {
+		/* cannot be stored as min + 1, the max is set anyway */
+		value--;
+	}
+	current = histogram->min;
+	while(current == 0 || value + 1 < current) {
+		apr_uint32_t prev = apr_atomic_cas32(&histogram->min,value + 1,current);
+		if(prev == current) {
+			break;
+		}
+		current = prev;
+	}
+}
+
+APT_DECLARE(void) apt_histogram_reset(apt_histogram_t *histogram)
+{
+	apr_size_t i;
+	for(i=0; i<HISTOGRAM_BUCKET_COUNT; i++) {
+		apr_atomic_set32(&histogram->buckets[i],0);
+	}
+	apr_atomic_set32(&histogram->min,0);
+	apr_atomic_set32(&histogram->max,0);
+}
+
+APT_DECLARE(apr_size_t) apt_histogram_count_get(const apt_histogram_t *histogram)
+{
+	apr_size_t count = 0;
+	apr_size_t i;
+	for(i=0; i<HISTOGRAM_BUCKET_COUNT; i++) {
+		count += histogram->buckets[i];
+	}
+	return count;
+}
+
+APT_DECLARE(apr_uint32_t) apt_histogram_min_get(const apt_histogram_t *histogram)
+{
+	apr_uint32_t min = apt_histogram_load(&histogram->min);
+	return min ? min - 1 : 0;
+}
+
+APT_DECLARE(apr_uint32_t) apt_histogram_max_get(const apt_histogram_t *histogram)
+{
+	return apt_histogram_load(&histogram->max);
+}
+
+APT_DECLARE(double) apt_histogram_mean_get(const apt_histogram_t *histogram)
+{
+	double sum = 0;
+	apr_size_t count = 0;
+	apr_uint32_t width;
+	apr_uint32_t value;
+	apr_size_t i;
+	for(i=0; i<HISTOGRAM_BUCKET_COUNT; i++) {
+		apr_uint32_t n = histogram->buckets[i];
+		if(n) {
+			/* use the middle of the bucket */
+			value = apt_histogram_bucket_value_get(i,&width);
+			sum += ((double)value + (width - 1) / 2.0) * n;
+			count += n;
+		}
+	}
+	return count ? sum / count : 0;
+}
+
+APT_DECLARE(apr_uint32_t) apt_histogram_percentile_get(const apt_histogram_t *histogram, double percentile)
+{
+	apr_size_t count = apt_histogram_count_get(histogram);
+	apr_size_t target;
+	apr_size_t total = 0;
+	apr_uint32_t width;
+	apr_uint32_t value;
+	apr_uint32_t max;
+	apr_size_t i;
+	if(!count) {
+		return 0;
+	}
+	if(percentile > 100) {
+		percentile = 100;
+	}
+	target = (apr_size_t)(percentile * count / 100 + 0.5);
+	if(target < 1) {
+		target = 1;
+	}
+
+	max = apt_histogram_max_get(histogram);
+	for(i=0; i<HISTOGRAM_BUCKET_COUNT; i++) {
+		total += histogram->buckets[i];
+		if(total >= target) {
+			value = apt_histogram_bucket_value_get(i,&width);
+			value += width - 1;
+			return value < max ? value : max;
+		}
+	}
+	return max;
+}
@@ -28,12 +28,23 @@
 #include <apr_portable.h>
 #include <apr_hash.h>
 #include <apr_xml.h>
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
 #include "apt_pool.h"
 #include "apt_log.h"
 
 #define MAX_LOG_ENTRY_SIZE 4096
 #define MAX_PRIORITY_NAME_LENGTH 9
 
+/* size of a slot of the async ring buffer, a log record occupies one or more consecutive slots */
+#define LOG_RING_SLOT_SIZE 128
+/* min number of slots, enough to hold a log record of max size */
+#define LOG_RING_MIN_SLOT_COUNT 64
+/* max number of log records written out by the writer thread at once */
+#define LOG_RING_BATCH_SIZE 256
+/* time the writer thread sleeps for when the ring buffer is empty (usec) */
+#define LOG_RING_IDLE_TIMEOUT 10000
+
 static const char priority_snames[APT_PRIO_COUNT][MAX_PRIORITY_NAME_LENGTH+1] =
 {
 	"[EMERG]  ",
@@ -50,6 +61,9 @@ typedef struct apt_log_file_data_t apt_log_file_data_t;
 typedef struct apt_log_file_settings_t apt_log_file_settings_t;
 typedef struct apt_log_file_entry_t apt_log_file_entry_t;
 typedef struct apt_syslog_settings_t apt_syslog_settings_t;
+typedef struct apt_log_record_t apt_log_record_t;
+typedef struct apt_log_ring_t apt_log_ring_t;
+typedef struct apt_log_time_cache_t apt_log_time_cache_t;
 
 struct apt_log_file_entry_t {
 	APR_RING_ENTRY(apt_log_file_entry_t) link;
@@ -86,10 +100,31 @@ struct apt_log_file_data_t {
 	apt_log_file_settings_t   settings;
 };
 
-struct apt_log_source_t {
-	const char               *name;
-	apt_log_priority_e        priority;
-	apt_log_masking_e         masking;
+/* header of a log record stored in the ring buffer, followed by the formatted log entry */
+struct apt_log_record_t {
+	apr_uint32_t              size;               /* size of the log entry */
+	apr_uint16_t              data_offset;        /* offset of the message past the optional headers */
+	apr_uint16_t              priority;
+};
+
+/* lock-free ring buffer of log records written by any thread and consumed by the writer thread */
+struct apt_log_ring_t {
+	char                     *data;               /* (mask + 1) slots of LOG_RING_SLOT_SIZE bytes */
+	volatile apr_uint32_t    *sequences;          /* equals the position when free, the position + 1 when published */
+	apr_uint32_t              mask;               /* number of slots - 1 (number of slots is a power of two) */
+	volatile apr_uint32_t     head;               /* free-running write position (claimed by producers) */
+	apr_uint32_t              tail;               /* free-running read position (modified by writer only) */
+	volatile apr_uint32_t     running;
+	apr_thread_t             *thread;
+};
+
+/* date and time headers formatted for the current second */
+struct apt_log_time_cache_t {
+	apr_time_t                sec;                /* time in seconds the headers are formatted for, 0 if not set */
+	char                      date[16];
+	apr_size_t                date_length;
+	char                      time[16];
+	apr_size_t                time_length;
 };
 
 struct apt_logger_t {
@@ -99,11 +134,40 @@ struct apt_logger_t {
 	apt_log_ext_handler_f     ext_handler;
 	apt_log_file_data_t      *file_data;
 	apt_bool_t                syslog;
+	apt_log_ring_t           *ring;
+	volatile apr_uint32_t     dropped;
 };
 
 static apt_logger_t *apt_logger = NULL;
 apt_log_source_t def_log_source;
 
+#if defined(_MSC_VER)
+#define APT_LOG_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define APT_LOG_THREAD_LOCAL __thread
+#endif
+
+/* max priority of log entries out of the sampled scopes */
+static apt_log_priority_e log_sampling_priority = APT_PRIO_DEBUG;
+
+#ifdef APT_LOG_THREAD_LOCAL
+/* each thread refreshes its own copy of the time headers once per second */
+static APT_LOG_THREAD_LOCAL apt_log_time_cache_t log_time_cache;
+/* max priority of log entries of the scope the thread is in (APT_PRIO_COUNT - out of scope) */
+static APT_LOG_THREAD_LOCAL apt_log_priority_e log_scope_priority = APT_PRIO_COUNT;
+#endif
+
+/* check whether log entries of the priority pass the scope of the calling thread */
+static APR_INLINE apt_bool_t apt_log_scope_check(apt_log_priority_e priority)
+{
+#ifdef APT_LOG_THREAD_LOCAL
+	if(log_scope_priority != APT_PRIO_COUNT) {
+		return priority <= log_scope_priority ? TRUE : FALSE;
+	}
+#endif
+	return priority <= log_sampling_priority ? TRUE : FALSE;
+}
+
 static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr);
 
 static apt_bool_t apt_log_file_open_internal(const char *dir_path, const char *prefix, const apt_log_file_settings_t *settings, apr_pool_t *pool);
@@ -113,7 +177,7 @@ static apt_bool_t apt_log_file_link_current(const apt_log_file_data_t *file_data
 static void apt_log_files_purge(const apt_log_file_data_t *file_data);
 static void apt_log_files_populate(apt_log_file_data_t *file_data);
 static void apt_log_file_entries_clear(apt_log_file_data_t *file_data);
-static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *log_entry, apr_size_t size);
+static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *log_entry, apr_size_t size, apt_bool_t flush);
 static apr_xml_doc* apt_log_doc_parse(const char *file_path, apr_pool_t *pool);
 
 static void apt_log_file_settings_init(apt_log_file_settings_t *settings)
@@ -133,6 +197,8 @@ static apt_logger_t* apt_log_instance_alloc(apr_pool_t *pool)
 	logger->ext_handler = NULL;
 	logger->file_data = NULL;
 	logger->syslog = FALSE;
+	logger->ring = NULL;
+	logger->dropped = 0;
 
 	/* Create hash for custom log sources */
 	logger->log_sources = apr_hash_make(pool);
@@ -235,6 +301,7 @@ APT_DECLARE(apt_bool_t) apt_log_instance_load(const char *config_file, apr_pool_
 	const apr_xml_elem *elem;
 	const apr_xml_elem *root;
 	char *text;
+	apr_size_t async_size = 0;
 
 	if(apt_logger) {
 		return FALSE;
@@ -280,10 +347,17 @@ APT_DECLARE(apt_bool_t) apt_log_instance_load(const char *config_file, apr_pool_
 		else if(strcasecmp(elem->name,"sources") == 0) {
 			apt_log_sources_load(elem,pool);
 		}
+		else if(strcasecmp(elem->name,"async") == 0) {
+			async_size = atol(text) * 1024;
+		}
 		else {
 			/* Unknown element */
 		}
 	}
+
+	if(async_size) {
+		apt_log_async_start(async_size,pool);
+	}
 	return TRUE;
 }
 
@@ -293,6 +367,11 @@ APT_DECLARE(apt_bool_t) apt_log_instance_destroy()
 		return FALSE;
 	}
 
+	if(apt_logger->ring) {
+		/* write out pending log entries before closing the outputs */
+		apt_log_async_stop();
+	}
+
 	if(apt_logger->file_data) {
 		apt_log_file_close();
 	}
@@ -458,6 +537,10 @@ APT_DECLARE(apt_bool_t) apt_log_file_close()
 	if(!apt_logger || !apt_logger->file_data) {
 		return FALSE;
 	}
+	if(apt_logger->ring) {
+		/* the writer thread must not outlive the log file */
+		apt_log_async_stop();
+	}
 	file_data = apt_logger->file_data;
 	if(file_data->file) {
 		/* close log file */
@@ -759,6 +842,30 @@ APT_DECLARE(const char*) apt_log_data_mask(const char *data_in, apr_size_t *leng
 	return data_in;
 }
 
+APT_DECLARE(void) apt_log_sampling_set(apt_log_priority_e priority)
+{
+	if(priority >= APT_PRIO_COUNT) {
+		priority = APT_PRIO_DEBUG;
+	}
+	log_sampling_priority = priority;
+}
+
+APT_DECLARE(apt_log_priority_e) apt_log_sampling_get(void)
+{
+	return log_sampling_priority;
+}
+
+APT_DECLARE(apt_log_priority_e) apt_log_scope_set(apt_log_priority_e priority)
+{
+#ifdef APT_LOG_THREAD_LOCAL
+	apt_log_priority_e prev = log_scope_priority;
+	log_scope_priority = priority;
+	return prev;
+#else
+	return APT_PRIO_COUNT;
+#endif
+}
+
 APT_DECLARE(apt_bool_t) apt_log_ext_handler_set(apt_log_ext_handler_f handler)
 {
 	if(!apt_logger) {
@@ -768,14 +875,14 @@ APT_DECLARE(apt_bool_t) apt_log_ext_handler_set(apt_log_ext_handler_f handler)
 	return TRUE;
 }
 
-APT_DECLARE(apt_bool_t) apt_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, ...)
+APT_DECLARE(apt_bool_t) (apt_log)(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, ...)
 {
 	apt_bool_t status = TRUE;
 	if(!apt_logger || !log_source) {
 		return FALSE;
 	}
 	
-	if(priority <= log_source->priority) {
+	if(priority <= log_source->priority && apt_log_scope_check(priority) == TRUE) {
 		va_list arg_ptr;
 		va_start(arg_ptr, format);
 		if(apt_logger->ext_handler) {
@@ -789,14 +896,14 @@ APT_DECLARE(apt_bool_t) apt_log(apt_log_source_t *log_source, const char *file,
 	return status;
 }
 
-APT_DECLARE(apt_bool_t) apt_obj_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, void *obj, const char *format, ...)
+APT_DECLARE(apt_bool_t) (apt_obj_log)(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, void *obj, const char *format, ...)
 {
 	apt_bool_t status = TRUE;
 	if(!apt_logger || !log_source) {
 		return FALSE;
 	}
 
-	if(priority <= log_source->priority) {
+	if(priority <= log_source->priority && apt_log_scope_check(priority) == TRUE) {
 		va_list arg_ptr;
 		va_start(arg_ptr, format);
 		if(apt_logger->ext_handler) {
@@ -817,7 +924,7 @@ APT_DECLARE(apt_bool_t) apt_va_log(apt_log_source_t *log_source, const char *fil
 		return FALSE;
 	}
 
-	if(priority <= log_source->priority) {
+	if(priority <= log_source->priority && apt_log_scope_check(priority) == TRUE) {
 		if(apt_logger->ext_handler) {
 			status = apt_logger->ext_handler(file,line,NULL,priority,format,arg_ptr);
 		}
@@ -837,28 +944,61 @@ static APR_INLINE unsigned long apt_thread_id_get(void)
 #endif
 }
 
-static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr)
+static apr_size_t apt_log_time_header_format(char *buf, int header)
 {
-	char log_entry[MAX_LOG_ENTRY_SIZE];
-	apr_size_t max_size = MAX_LOG_ENTRY_SIZE - 2;
 	apr_size_t offset = 0;
-	apr_size_t data_offset;
-	apr_time_exp_t result;
 	apr_time_t now = apr_time_now();
-	apr_time_exp_lt(&result,now);
+	apr_time_t sec = apr_time_sec(now);
+	apr_uint32_t usec = (apr_uint32_t)apr_time_usec(now);
+	int i;
+#ifdef APT_LOG_THREAD_LOCAL
+	apt_log_time_cache_t *cache = &log_time_cache;
+#else
+	apt_log_time_cache_t local_cache;
+	apt_log_time_cache_t *cache = &local_cache;
+	local_cache.sec = 0;
+#endif
 
-	if(apt_logger->header & APT_LOG_HEADER_DATE) {
-		offset += apr_snprintf(log_entry+offset,max_size-offset,"%4d-%02d-%02d ",
+	if(cache->sec != sec) {
+		/* the second has changed, format the headers anew */
+		apr_time_exp_t result;
+		apr_time_exp_lt(&result,now);
+		cache->date_length = apr_snprintf(cache->date,sizeof(cache->date),"%4d-%02d-%02d ",
 							result.tm_year+1900,
 							result.tm_mon+1,
 							result.tm_mday);
-	}
-	if(apt_logger->header & APT_LOG_HEADER_TIME) {
-		offset += apr_snprintf(log_entry+offset,max_size-offset,"%02d:%02d:%02d:%06d ",
+		cache->time_length = apr_snprintf(cache->time,sizeof(cache->time),"%02d:%02d:%02d:",
 							result.tm_hour,
 							result.tm_min,
-							result.tm_sec,
-							result.tm_usec);
+							result.tm_sec);
+		cache->sec = sec;
+	}
+
+	if(header & APT_LOG_HEADER_DATE) {
+		memcpy(buf+offset,cache->date,cache->date_length);
+		offset += cache->date_length;
+	}
+	if(header & APT_LOG_HEADER_TIME) {
+		memcpy(buf+offset,cache->time,cache->time_length);
+		offset += cache->time_length;
+		/* append microseconds as %06d does */
+		for(i=5; i>=0; i--) {
+			buf[offset+i] = (char)('0' + usec % 10);
+			usec /= 10;
+		}
+		offset += 6;
+		buf[offset++] = ' ';
+	}
+	return offset;
+}
+
+static apr_size_t apt_log_entry_format(char *log_entry, apr_size_t *data_offset, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr)
+{
+	apr_size_t max_size = MAX_LOG_ENTRY_SIZE - 2;
+	apr_size_t offset = 0;
+
+	if(apt_logger->header & (APT_LOG_HEADER_DATE | APT_LOG_HEADER_TIME)) {
+		offset += apt_log_time_header_format(log_entry,apt_logger->header);
 	}
 	if(apt_logger->header & APT_LOG_HEADER_MARK) {
 		offset += apr_snprintf(log_entry+offset,max_size-offset,"%s:%03d ",file,line);
@@ -871,16 +1011,21 @@ static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int
 		offset += MAX_PRIORITY_NAME_LENGTH;
 	}
 
-	data_offset = offset;
+	*data_offset = offset;
 	offset += apr_vsnprintf(log_entry+offset,max_size-offset,format,arg_ptr);
 	log_entry[offset++] = '\n';
 	log_entry[offset] = '\0';
+	return offset;
+}
+
+static void apt_log_entry_output(const char *log_entry, apr_size_t size, apr_size_t data_offset, apt_log_priority_e priority, apt_bool_t flush)
+{
 	if((apt_logger->mode & APT_LOG_OUTPUT_CONSOLE) == APT_LOG_OUTPUT_CONSOLE) {
-		fwrite(log_entry,offset,1,stdout);
+		fwrite(log_entry,size,1,stdout);
 	}
 	
 	if((apt_logger->mode & APT_LOG_OUTPUT_FILE) == APT_LOG_OUTPUT_FILE && apt_logger->file_data) {
-		apt_log_file_dump(apt_logger->file_data,log_entry,offset);
+		apt_log_file_dump(apt_logger->file_data,log_entry,size,flush);
 	}
 
 #ifndef WIN32
@@ -888,6 +1033,250 @@ static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int
 		syslog(priority,"%s",log_entry + data_offset);
 	}
 #endif
+}
+
+/* load value with full barrier (apr_atomic_read32() is not guaranteed to be fenced) */
+static APR_INLINE apr_uint32_t apt_log_ring_load(const volatile apr_uint32_t *value)
+{
+	return apr_atomic_add32((volatile apr_uint32_t*)value,0);
+}
+
+static void apt_log_ring_copy_in(apt_log_ring_t *ring, apr_size_t offset, const void *src, apr_size_t size)
+{
+	apr_size_t ring_size = (ring->mask + 1) * LOG_RING_SLOT_SIZE;
+	apr_size_t chunk;
+	offset %= ring_size;
+	chunk = ring_size - offset;
+	if(chunk >= size) {
+		memcpy(ring->data + offset,src,size);
+		return;
+	}
+	/* wrap around the end of the buffer */
+	memcpy(ring->data + offset,src,chunk);
+	memcpy(ring->data,(const char*)src + chunk,size - chunk);
+}
+
+static void apt_log_ring_copy_out(const apt_log_ring_t *ring, apr_size_t offset, void *dst, apr_size_t size)
+{
+	apr_size_t ring_size = (ring->mask + 1) * LOG_RING_SLOT_SIZE;
+	apr_size_t chunk;
+	offset %= ring_size;
+	chunk = ring_size - offset;
+	if(chunk >= size) {
+		memcpy(dst,ring->data + offset,size);
+		return;
+	}
+	memcpy(dst,ring->data + offset,chunk);
+	memcpy((char*)dst + chunk,ring->data,size - chunk);
+}
+
+static APR_INLINE apr_uint32_t apt_log_ring_slot_count(apr_size_t size)
+{
+	return (apr_uint32_t)((sizeof(apt_log_record_t) + size + LOG_RING_SLOT_SIZE - 1) / LOG_RING_SLOT_SIZE);
+}
+
+static apt_bool_t apt_log_ring_put(apt_log_ring_t *ring, const char *log_entry, apr_size_t size, apr_size_t data_offset, apt_log_priority_e priority)
+{
+	apt_log_record_t record;
+	apr_uint32_t count = apt_log_ring_slot_count(size);
+	apr_uint32_t last;
+	apr_uint32_t sequence;
+	apr_uint32_t claimed;
+	apr_uint32_t head = apt_log_ring_load(&ring->head);
+	for(;;) {
+		/* slots are released in order, the last slot being free implies the preceding ones are free too */
+		last = head + count - 1;
+		sequence = apt_log_ring_load(&ring->sequences[last & ring->mask]);
+		if(sequence == last) {
+			claimed = apr_atomic_cas32(&ring->head,head + count,head);
+			if(claimed == head) {
+				break;
+			}
+			head = claimed;
+		}
+		else if((apr_int32_t)(sequence - last) < 0) {
+			/* the slots still hold records from the previous lap: full */
+			return FALSE;
+		}
+		else {
+			/* another producer claimed the slots, retry with the current position */
+			head = apt_log_ring_load(&ring->head);
+		}
+	}
+
+	record.size = (apr_uint32_t)size;
+	record.data_offset = (apr_uint16_t)data_offset;
+	record.priority = (apr_uint16_t)priority;
+	apt_log_ring_copy_in(ring,(apr_size_t)(head & ring->mask) * LOG_RING_SLOT_SIZE,&record,sizeof(record));
+	apt_log_ring_copy_in(ring,(apr_size_t)(head & ring->mask) * LOG_RING_SLOT_SIZE + sizeof(record),log_entry,size);
+	/* publish the record before advancing the sequence of its first slot */
+	apr_atomic_xchg32(&ring->sequences[head & ring->mask],head + 1);
+	return TRUE;
+}
+
+static apt_bool_t apt_log_ring_get(apt_log_ring_t *ring, char *log_entry, apt_log_record_t *record)
+{
+	apr_uint32_t i;
+	apr_uint32_t count;
+	apr_uint32_t tail = ring->tail;
+	apr_size_t offset = (apr_size_t)(tail & ring->mask) * LOG_RING_SLOT_SIZE;
+	if(apt_log_ring_load(&ring->sequences[tail & ring->mask]) != tail + 1) {
+		/* empty, or the slots are claimed but not published yet */
+		return FALSE;
+	}
+
+	apt_log_ring_copy_out(ring,offset,record,sizeof(*record));
+	apt_log_ring_copy_out(ring,offset + sizeof(*record),log_entry,record->size);
+	log_entry[record->size] = '\0';
+
+	/* release the slots for the next lap in order */
+	count = apt_log_ring_slot_count(record->size);
+	for(i=0; i<count; i++) {
+		apr_atomic_xchg32(&ring->sequences[(tail + i) & ring->mask],tail + i + ring->mask + 1);
+	}
+	ring->tail = tail + count;
+	return TRUE;
+}
+
+static void apt_log_outputs_flush(void)
+{
+	apt_log_file_data_t *file_data = apt_logger->file_data;
+	if((apt_logger->mode & APT_LOG_OUTPUT_CONSOLE) == APT_LOG_OUTPUT_CONSOLE) {
+		fflush(stdout);
+	}
+	if(file_data) {
+		apr_thread_mutex_lock(file_data->mutex);
+		if(file_data->file) {
+			fflush(file_data->file);
+		}
+		apr_thread_mutex_unlock(file_data->mutex);
+	}
+}
+
+static apr_size_t apt_log_entry_printf(char *log_entry, apr_size_t *data_offset, apt_log_priority_e priority, const char *format, ...)
+{
+	apr_size_t size;
+	va_list arg_ptr;
+	va_start(arg_ptr, format);
+	size = apt_log_entry_format(log_entry,data_offset,__FILE__,__LINE__,priority,format,arg_ptr);
+	va_end(arg_ptr);
+	return size;
+}
+
+/* write out a batch of pending records, return the number of records written */
+static apr_size_t apt_log_ring_drain(apt_log_ring_t *ring, apr_uint32_t *reported)
+{
+	char log_entry[MAX_LOG_ENTRY_SIZE];
+	apt_log_record_t record;
+	apr_uint32_t dropped;
+	apr_size_t count = 0;
+	while(count < LOG_RING_BATCH_SIZE && apt_log_ring_get(ring,log_entry,&record) == TRUE) {
+		apt_log_entry_output(log_entry,record.size,record.data_offset,record.priority,FALSE);
+		count++;
+	}
+
+	dropped = apt_log_ring_load(&apt_logger->dropped);
+	if(dropped != *reported) {
+		apr_size_t data_offset;
+		apr_size_t size = apt_log_entry_printf(log_entry,&data_offset,APT_PRIO_WARNING,"Dropped [%u] Log Entries",dropped - *reported);
+		apt_log_entry_output(log_entry,size,data_offset,APT_PRIO_WARNING,FALSE);
+		*reported = dropped;
+	}
+	return count;
+}
+
+static void* APR_THREAD_FUNC apt_log_writer_run(apr_thread_t *thread, void *data)
+{
+	apt_log_ring_t *ring = data;
+	apr_uint32_t reported = apt_log_ring_load(&apt_logger->dropped);
+	while(apt_log_ring_load(&ring->running)) {
+		if(!apt_log_ring_drain(ring,&reported)) {
+			/* flush only once the ring buffer is empty, not per log entry */
+			apt_log_outputs_flush();
+			apr_sleep(LOG_RING_IDLE_TIMEOUT);
+		}
+	}
+
+	/* write out the remaining records */
+	while(apt_log_ring_drain(ring,&reported));
+	apt_log_outputs_flush();
+
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_async_start(apr_size_t buffer_size, apr_pool_t *pool)
+{
+	apt_log_ring_t *ring;
+	apr_uint32_t slot_count = LOG_RING_MIN_SLOT_COUNT;
+	apr_uint32_t i;
+	if(!apt_logger || apt_logger->ring) {
+		return FALSE;
+	}
+	while((apr_size_t)slot_count * LOG_RING_SLOT_SIZE < buffer_size) {
+		slot_count <<= 1;
+	}
+
+	ring = apr_palloc(pool,sizeof(apt_log_ring_t));
+	ring->data = apr_palloc(pool,(apr_size_t)slot_count * LOG_RING_SLOT_SIZE);
+	ring->sequences = apr_palloc(pool,sizeof(apr_uint32_t) * slot_count);
+	for(i=0; i<slot_count; i++) {
+		ring->sequences[i] = i;
+	}
+	ring->mask = slot_count - 1;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->running = 1;
+	if(apr_thread_create(&ring->thread,NULL,apt_log_writer_run,ring,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	apt_logger->ring = ring;
+	return TRUE;
+}
+
+APT_DECLARE(apt_bool_t) apt_log_async_stop(void)
+{
+	apr_status_t rv;
+	apt_log_ring_t *ring;
+	if(!apt_logger || !apt_logger->ring) {
+		return FALSE;
+	}
+	ring = apt_logger->ring;
+	/* switch back to synchronous logging, then let the writer drain the ring buffer */
+	apt_logger->ring = NULL;
+	apr_atomic_set32(&ring->running,0);
+	apr_thread_join(&rv,ring->thread);
+	return TRUE;
+}
+
+APT_DECLARE(apr_size_t) apt_log_async_dropped_get(void)
+{
+	if(!apt_logger) {
+		return 0;
+	}
+	return apt_log_ring_load(&apt_logger->dropped);
+}
+
+static apt_bool_t apt_do_log(apt_log_source_t *log_source, const char *file, int line, apt_log_priority_e priority, const char *format, va_list arg_ptr)
+{
+	char log_entry[MAX_LOG_ENTRY_SIZE];
+	apr_size_t data_offset;
+	apr_size_t size;
+	apt_log_ring_t *ring;
+
+	size = apt_log_entry_format(log_entry,&data_offset,file,line,priority,format,arg_ptr);
+
+	ring = apt_logger->ring;
+	if(ring) {
+		/* never block the calling thread, drop the log entry if the ring buffer is full */
+		if(apt_log_ring_put(ring,log_entry,size,data_offset,priority) == FALSE) {
+			apr_atomic_inc32(&apt_logger->dropped);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	apt_log_entry_output(log_entry,size,data_offset,priority,TRUE);
 	return TRUE;
 }
 
@@ -1102,7 +1491,7 @@ static apt_bool_t apt_log_file_rotate(apt_log_file_data_t *file_data)
 	return apt_log_file_create(file_data);
 }
 
-static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *log_entry, apr_size_t size)
+static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *log_entry, apr_size_t size, apt_bool_t flush)
 {
 	apr_thread_mutex_lock(file_data->mutex);
 
@@ -1118,7 +1507,9 @@ static apt_bool_t apt_log_file_dump(apt_log_file_data_t *file_data, const char *
 	}
 	/* write to log file */
 	fwrite(log_entry,1,size,file_data->file);
-	fflush(file_data->file);
+	if(flush == TRUE) {
+		fflush(file_data->file);
+	}
 
 	apr_thread_mutex_unlock(file_data->mutex);
 	return TRUE;
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_thread_mutex.h>
+#include "apt_mem_account.h"
+#include "apt_log.h"
+
+struct apt_mem_account_t {
+	/** Name of the account */
+	const char         *name;
+	/** Account charges are also applied to (NULL if none) */
+	apt_mem_account_t  *parent;
+	/** Guards the statistics (charged by the server task and the engine threads) */
+	apr_thread_mutex_t *guard;
+	/** Statistics of the account */
+	apt_mem_account_stats_t stats;
+};
+
+APT_DECLARE(apt_mem_account_t*) apt_mem_account_create(const char *name, apr_size_t cap, apt_mem_account_t *parent, apr_pool_t *pool)
+{
+	apt_mem_account_t *account = apr_palloc(pool,sizeof(apt_mem_account_t));
+	account->name = name;
+	account->parent = parent;
+	account->stats.used = 0;
+	account->stats.peak = 0;
+	account->stats.cap = cap;
+	account->stats.denied = 0;
+	if(apr_thread_mutex_create(&account->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return account;
+}
+
+APT_DECLARE(void) apt_mem_account_destroy(apt_mem_account_t *account)
+{
+	apr_size_t used;
+	apr_thread_mutex_lock(account->guard);
+	used = account->stats.used;
+	account->stats.used = 0;
+	apr_thread_mutex_unlock(account->guard);
+	if(used && account->parent) {
+		apt_mem_account_uncharge(account->parent,used);
+	}
+	apr_thread_mutex_destroy(account->guard);
+}
+
+/** Charge the account itself */
+static apt_bool_t apt_mem_account_own_charge(apt_mem_account_t *account, apr_size_t size)
+{
+	apt_bool_t status = TRUE;
+	apr_thread_mutex_lock(account->guard);
+	if(account->stats.cap && account->stats.used + size > account->stats.cap) {
+		account->stats.denied++;
+		status = FALSE;
+	}
+	else {
+		account->stats.used += size;
+		if(account->stats.used > account->stats.peak) {
+			account->stats.peak = account->stats.used;
+		}
+	}
+	apr_thread_mutex_unlock(account->guard);
+	return status;
+}
+
+/** Uncharge the account itself */
+static void apt_mem_account_own_uncharge(apt_mem_account_t *account, apr_size_t size)
+{
+	apr_thread_mutex_lock(account->guard);
+	account->stats.used = account->stats.used > size ? account->stats.used - size : 0;
+	apr_thread_mutex_unlock(account->guard);
+}
+
+APT_DECLARE(apt_bool_t) apt_mem_account_charge(apt_mem_account_t *account, apr_size_t size)
+{
+	apt_mem_account_t *it;
+	apt_mem_account_t *failed = NULL;
+	if(!size) {
+		return TRUE;
+	}
+
+	/* each account is locked on its own, so that no lock is held while an ancestor is charged */
+	for(it = account; it; it = it->parent) {
+		if(apt_mem_account_own_charge(it,size) == FALSE) {
+			failed = it;
+			break;
+		}
+	}
+	if(!failed) {
+		return TRUE;
+	}
+
+	/* roll back the descendants of the account which denied the charge */
+	for(it = account; it != failed; it = it->parent) {
+		apt_mem_account_own_uncharge(it,size);
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Memory Cap Exceeded [%s] cap [%"APR_SIZE_T_FMT"] charge [%"APR_SIZE_T_FMT"] for [%s]",
+		failed->name,
+		failed->stats.cap,
+		size,
+		account->name);
+	return FALSE;
+}
+
+APT_DECLARE(void) apt_mem_account_uncharge(apt_mem_account_t *account, apr_size_t size)
+{
+	apt_mem_account_t *it;
+	if(!size) {
+		return;
+	}
+	for(it = account; it; it = it->parent) {
+		apt_mem_account_own_uncharge(it,size);
+	}
+}
+
+APT_DECLARE(void) apt_mem_account_cap_set(apt_mem_account_t *account, apr_size_t cap)
+{
+	apr_thread_mutex_lock(account->guard);
+	account->stats.cap = cap;
+	apr_thread_mutex_unlock(account->guard);
+}
+
+APT_DECLARE(apr_size_t) apt_mem_account_used_get(apt_mem_account_t *account)
+{
+	apr_size_t used;
+	apr_thread_mutex_lock(account->guard);
+	used = account->stats.used;
+	apr_thread_mutex_unlock(account->guard);
+	return used;
+}
+
+APT_DECLARE(void) apt_mem_account_stats_get(apt_mem_account_t *account, apt_mem_account_stats_t *stats)
+{
+	apr_thread_mutex_lock(account->guard);
+	*stats = account->stats;
+	apr_thread_mutex_unlock(account->guard);
+}
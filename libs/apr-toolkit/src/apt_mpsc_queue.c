@@ -0,0 +1,130 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "apt_mpsc_queue.h"
+
+/** Slot of the queue */
+typedef struct {
+	/** Sequence number: equals the write index when free, the write index + 1 when published */
+	volatile apr_uint32_t  sequence;
+	/** Stored object */
+	void                  *obj;
+} apt_mpsc_slot_t;
+
+struct apt_mpsc_queue_t {
+	/** Array of (mask + 1) slots */
+	apt_mpsc_slot_t       *slots;
+	/** Capacity - 1 (capacity is a power of two) */
+	apr_uint32_t           mask;
+	/** Free-running write index (claimed by producers) */
+	volatile apr_uint32_t  head;
+	/** Free-running read index (modified by consumer only) */
+	volatile apr_uint32_t  tail;
+};
+
+/** Load value with full barrier (apr_atomic_read32() is not guaranteed to be fenced) */
+static APR_INLINE apr_uint32_t apt_mpsc_load(const volatile apr_uint32_t *value)
+{
+	return apr_atomic_add32((volatile apr_uint32_t*)value,0);
+}
+
+APT_DECLARE(apt_mpsc_queue_t*) apt_mpsc_queue_create(apr_size_t capacity, apr_pool_t *pool)
+{
+	apt_mpsc_queue_t *queue;
+	apr_uint32_t size = 1;
+	apr_uint32_t i;
+	if(!capacity) {
+		return NULL;
+	}
+	while(size < capacity) {
+		size <<= 1;
+	}
+
+	queue = apr_palloc(pool,sizeof(apt_mpsc_queue_t));
+	queue->slots = apr_palloc(pool,sizeof(apt_mpsc_slot_t) * size);
+	for(i=0; i<size; i++) {
+		queue->slots[i].sequence = i;
+		queue->slots[i].obj = NULL;
+	}
+	queue->mask = size - 1;
+	queue->head = 0;
+	queue->tail = 0;
+	return queue;
+}
+
+APT_DECLARE(apt_bool_t) apt_mpsc_queue_push(apt_mpsc_queue_t *queue, void *obj)
+{
+	apt_mpsc_slot_t *slot;
+	apr_uint32_t sequence;
+	apr_uint32_t claimed;
+	apr_uint32_t head = apt_mpsc_load(&queue->head);
+	for(;;) {
+		slot = &queue->slots[head & queue->mask];
+		sequence = apt_mpsc_load(&slot->sequence);
+		if(sequence == head) {
+			/* the slot is free, try to claim it */
+			claimed = apr_atomic_cas32(&queue->head,head + 1,head);
+			if(claimed == head) {
+				break;
+			}
+			head = claimed;
+		}
+		else if((apr_int32_t)(sequence - head) < 0) {
+			/* the slot still holds an object from the previous lap: full */
+			return FALSE;
+		}
+		else {
+			/* another producer claimed the slot, retry with the current index */
+			head = apt_mpsc_load(&queue->head);
+		}
+	}
+
+	slot->obj = obj;
+	/* publish the object before advancing the sequence */
+	apr_atomic_xchg32(&slot->sequence,head + 1);
+	return TRUE;
+}
+
+APT_DECLARE(void*) apt_mpsc_queue_pop(apt_mpsc_queue_t *queue)
+{
+	void *obj;
+	apr_uint32_t tail = queue->tail;
+	apt_mpsc_slot_t *slot = &queue->slots[tail & queue->mask];
+	if(apt_mpsc_load(&slot->sequence) != tail + 1) {
+		/* empty, or the slot is claimed but not published yet */
+		return NULL;
+	}
+
+	obj = slot->obj;
+	/* release the slot for the next lap */
+	apr_atomic_xchg32(&slot->sequence,tail + queue->mask + 1);
+	queue->tail = tail + 1;
+	return obj;
+}
+
+APT_DECLARE(apr_size_t) apt_mpsc_queue_size(const apt_mpsc_queue_t *queue)
+{
+	apr_uint32_t tail = apt_mpsc_load(&queue->tail);
+	apr_uint32_t size = apt_mpsc_load(&queue->head) - tail;
+	/* the consumer and producers may have advanced in between the loads */
+	return size > queue->mask + 1 ? queue->mask + 1 : size;
+}
+
+APT_DECLARE(apr_size_t) apt_mpsc_queue_capacity(const apt_mpsc_queue_t *queue)
+{
+	return (apr_size_t)queue->mask + 1;
+}
@@ -35,6 +35,11 @@ struct apt_multipart_content_t {
 
 	apt_str_t         boundary;
 	apt_str_t         hyphens;
+
+	/** Delimiter ("--" boundary) the parser searches for */
+	apt_str_t         delimiter;
+	/** Skip table of the delimiter (Boyer-Moore-Horspool), NULL until the boundary is known */
+	apr_uint16_t     *skip;
 };
 
 /** Create an empty multipart content */
@@ -58,6 +63,8 @@ APT_DECLARE(apt_multipart_content_t*) apt_multipart_content_create(apr_size_t ma
 
 	multipart_content->hyphens.buf = DEFAULT_HYPHENS;
 	multipart_content->hyphens.length = sizeof(DEFAULT_HYPHENS)-1;
+	apt_string_reset(&multipart_content->delimiter);
+	multipart_content->skip = NULL;
 
 	buffer = apr_palloc(pool,max_content_size+1);
 	apt_text_stream_init(&multipart_content->stream,buffer,max_content_size);
@@ -185,6 +192,56 @@ APT_DECLARE(apt_str_t*) apt_multipart_content_finalize(apt_multipart_content_t *
 }
 
 
+/** Set the delimiter to search for and precompute its skip table */
+static apt_bool_t apt_multipart_delimiter_set(apt_multipart_content_t *multipart_content, const apt_str_t *boundary)
+{
+	apr_size_t i;
+	apr_size_t length = boundary->length + 2;
+	char *delimiter;
+	if(!boundary->length || length > 0xFFFF) {
+		return FALSE;
+	}
+
+	delimiter = apr_palloc(multipart_content->pool,length + 1);
+	delimiter[0] = '-';
+	delimiter[1] = '-';
+	memcpy(delimiter + 2,boundary->buf,boundary->length);
+	delimiter[length] = '\0';
+	multipart_content->delimiter.buf = delimiter;
+	multipart_content->delimiter.length = length;
+
+	multipart_content->skip = apr_palloc(multipart_content->pool,256 * sizeof(apr_uint16_t));
+	for(i=0; i<256; i++) {
+		multipart_content->skip[i] = (apr_uint16_t)length;
+	}
+	for(i=0; i<length-1; i++) {
+		multipart_content->skip[(unsigned char)delimiter[i]] = (apr_uint16_t)(length - 1 - i);
+	}
+	return TRUE;
+}
+
+/** Find the next delimiter at the beginning of a line, in a single pass over the text */
+static char* apt_multipart_delimiter_find(const apt_multipart_content_t *multipart_content, char *pos)
+{
+	const apt_text_stream_t *stream = &multipart_content->stream;
+	const char *delimiter = multipart_content->delimiter.buf;
+	apr_size_t length = multipart_content->delimiter.length;
+	const char *last;
+
+	if(length > (apr_size_t)(stream->end - pos)) {
+		return NULL;
+	}
+	for(last = stream->end - length; pos <= last; ) {
+		unsigned char ch = (unsigned char)pos[length-1];
+		if(ch == (unsigned char)delimiter[length-1] && memcmp(pos,delimiter,length-1) == 0 &&
+			(pos == stream->text.buf || *(pos-1) == APT_TOKEN_LF)) {
+			return pos;
+		}
+		pos += multipart_content->skip[ch];
+	}
+	return NULL;
+}
+
 /** Assign body to multipart content to get (parse) each content part from */
 APT_DECLARE(apt_multipart_content_t*) apt_multipart_content_assign(const apt_str_t *body, const apt_str_t *boundary, apr_pool_t *pool)
 {
@@ -203,6 +260,11 @@ APT_DECLARE(apt_multipart_content_t*) apt_multipart_content_assign(const apt_str
 	}
 
 	apt_string_reset(&multipart_content->hyphens);
+	apt_string_reset(&multipart_content->delimiter);
+	multipart_content->skip = NULL;
+	if(boundary) {
+		apt_multipart_delimiter_set(multipart_content,boundary);
+	}
 	apt_text_stream_init(&multipart_content->stream,body->buf,body->length);
 	return multipart_content;
 }
@@ -229,16 +291,30 @@ APT_DECLARE(apt_bool_t) apt_multipart_content_get(apt_multipart_content_t *multi
 	*is_final = FALSE;
 	apt_content_part_reset(content_part);
 
-	/* skip preamble */
-	apt_text_skip_to_char(stream,'-');
-	if(apt_text_is_eos(stream) == TRUE) {
-		return FALSE;
+	if(multipart_content->skip) {
+		/* skip preamble or the rest of the previous part up to the next delimiter */
+		char *delimiter = apt_multipart_delimiter_find(multipart_content,stream->pos);
+		if(!delimiter) {
+			return FALSE;
+		}
+		/* skip initial hyphens */
+		stream->pos = delimiter + 2;
 	}
+	else {
+		/* skip preamble up to the first line starting with hyphens */
+		while(stream->pos + 2 < stream->end) {
+			if((stream->pos == stream->text.buf || *(stream->pos-1) == APT_TOKEN_LF) &&
+				stream->pos[0] == '-' && stream->pos[1] == '-') {
+				break;
+			}
+			stream->pos++;
+		}
+		if(stream->pos + 2 >= stream->end) {
+			return FALSE;
+		}
 
-	/* skip initial hyphens */
-	apt_text_chars_skip(stream,'-');
-	if(apt_text_is_eos(stream) == TRUE) {
-		return FALSE;
+		/* skip initial hyphens */
+		stream->pos += 2;
 	}
 
 	/* read line and the boundary */
@@ -263,6 +339,7 @@ APT_DECLARE(apt_bool_t) apt_multipart_content_get(apt_multipart_content_t *multi
 		/* no boundary was specified from user space, 
 		learn boundary from the content */
 		multipart_content->boundary = boundary;
+		apt_multipart_delimiter_set(multipart_content,&boundary);
 	}
 	else {
 		if(apt_string_compare(&multipart_content->boundary,&boundary) == FALSE) {
@@ -301,10 +378,26 @@ APT_DECLARE(apt_bool_t) apt_multipart_content_get(apt_multipart_content_t *multi
 			return FALSE;
 		}
 
-		/* read content */
-		apt_string_assign_n(&content_part->body,stream->pos,length,multipart_content->pool);
+		/* refer to content */
+		content_part->body.buf = stream->pos;
+		content_part->body.length = length;
 		stream->pos += length;
 	}
+	else if(multipart_content->skip) {
+		/* no content-length, the content spans up to the next delimiter */
+		char *delimiter = apt_multipart_delimiter_find(multipart_content,stream->pos);
+		char *end;
+		if(!delimiter) {
+			return FALSE;
+		}
+		/* the line break preceding the delimiter is a part of it */
+		end = delimiter;
+		if(end > stream->pos && *(end-1) == APT_TOKEN_LF) end--;
+		if(end > stream->pos && *(end-1) == APT_TOKEN_CR) end--;
+		content_part->body.buf = stream->pos;
+		content_part->body.length = end - stream->pos;
+		stream->pos = delimiter;
+	}
 
 	return TRUE;
 }
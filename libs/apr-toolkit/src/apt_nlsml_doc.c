@@ -19,10 +19,15 @@
 #pragma warning(disable: 4127)
 #endif
 #include <apr_ring.h>
+#include <apr_strings.h>
 
 #include "apt_nlsml_doc.h"
+#include "apt_string.h"
 #include "apt_log.h"
 
+/** Max depth of elements scanned */
+#define NLSML_SCAN_MAX_DEPTH 64
+
 /** NLSML result */
 struct nlsml_result_t
 {
@@ -43,15 +48,21 @@ struct nlsml_instance_t
 	/** Ring entry */
 	APR_RING_ENTRY(nlsml_instance_t) link;
 
-	/** Instance element */
+	/** Instance element (NULL if scanned) */
 	apr_xml_elem *elem;
+	/** Inner content of the scanned element, a span of the scanned data */
+	apt_str_t     span;
+	/** Whether SWI elements are suppressed from the content of the scanned element */
+	apt_bool_t    swi_suppress;
 };
 
 /** NLSML input */
 struct nlsml_input_t
 {
-	/** Input element */
+	/** Input element (NULL if scanned) */
 	apr_xml_elem *elem;
+	/** Inner content of the scanned element, a span of the scanned data */
+	apt_str_t   span;
 	/** Input mode attribute [default: "speech"] */
 	const char *mode;
 	/** Confidence attribute [default: 1.0] */
@@ -141,31 +152,40 @@ static float nlsml_confidence_parse(const char *str)
 	return confidence;
 }
 
-/** Parse <instance> element */
-static nlsml_instance_t* nlsml_instance_parse(apr_xml_elem *elem, apr_pool_t *pool)
+/** Create instance */
+static nlsml_instance_t* nlsml_instance_create(apr_xml_elem *elem, apr_pool_t *pool)
 {
 	/* Initialize instance */
 	nlsml_instance_t *instance = apr_palloc(pool, sizeof(*instance));
 	APR_RING_ELEM_INIT(instance,link);
 	instance->elem = elem;
+	apt_string_reset(&instance->span);
+	instance->swi_suppress = FALSE;
 
 	return instance;
 }
 
-/** Parse <input> element */
-static nlsml_input_t* nlsml_input_parse(apr_xml_elem *elem, apr_pool_t *pool)
+/** Parse <instance> element */
+static nlsml_instance_t* nlsml_instance_parse(apr_xml_elem *elem, apr_pool_t *pool)
+{
+	return nlsml_instance_create(elem, pool);
+}
+
+/** Create input of attributes */
+static nlsml_input_t* nlsml_input_create(apr_xml_elem *elem, const apr_xml_attr *attr, const char *name, apr_pool_t *pool)
 {
 	const apr_xml_attr *xml_attr;
 	/* Initialize input */
 	nlsml_input_t *input = apr_palloc(pool, sizeof(*input));
 	input->elem = elem;
+	apt_string_reset(&input->span);
 	input->mode = "speech";
 	input->confidence = 1.0;
 	input->timestamp_start = NULL;
 	input->timestamp_end = NULL;
 
 	/* Find input attributes */
-	for(xml_attr = elem->attr; xml_attr; xml_attr = xml_attr->next) {
+	for(xml_attr = attr; xml_attr; xml_attr = xml_attr->next) {
 		if(strcasecmp(xml_attr->name, "mode") == 0) {
 			input->mode = xml_attr->value;
 		}
@@ -179,20 +199,23 @@ static nlsml_input_t* nlsml_input_parse(apr_xml_elem *elem, apr_pool_t *pool)
 			input->timestamp_end = xml_attr->value;
 		}
 		else {
-			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown attribute '%s' for <%s>", xml_attr->name, elem->name);
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown attribute '%s' for <%s>", xml_attr->name, name);
 		}
 	}
 
 	return input;
 }
 
-/** Parse <interpretation> element */
-static nlsml_interpretation_t* nlsml_interpretation_parse(apr_xml_elem *elem, apr_pool_t *pool)
+/** Parse <input> element */
+static nlsml_input_t* nlsml_input_parse(apr_xml_elem *elem, apr_pool_t *pool)
+{
+	return nlsml_input_create(elem, elem->attr, elem->name, pool);
+}
+
+/** Create interpretation of attributes */
+static nlsml_interpretation_t* nlsml_interpretation_create(const apr_xml_attr *attr, const char *name, apr_pool_t *pool)
 {
-	apr_xml_elem *child_elem;
 	const apr_xml_attr *xml_attr;
-	nlsml_instance_t *instance;
-	nlsml_input_t *input;
 
 	/* Initialize interpretation */
 	nlsml_interpretation_t *interpretation = apr_palloc(pool, sizeof(*interpretation));
@@ -203,7 +226,7 @@ static nlsml_interpretation_t* nlsml_interpretation_parse(apr_xml_elem *elem, ap
 	APR_RING_INIT(&interpretation->instances, nlsml_instance_t, link);
 
 	/* Find optional grammar and confidence attributes */
-	for(xml_attr = elem->attr; xml_attr; xml_attr = xml_attr->next) {
+	for(xml_attr = attr; xml_attr; xml_attr = xml_attr->next) {
 		if(strcasecmp(xml_attr->name, "grammar") == 0) {
 			interpretation->grammar = xml_attr->value;
 		}
@@ -211,9 +234,19 @@ static nlsml_interpretation_t* nlsml_interpretation_parse(apr_xml_elem *elem, ap
 			interpretation->confidence = nlsml_confidence_parse(xml_attr->value);
 		}
 		else {
-			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown attribute '%s' for <%s>", xml_attr->name, elem->name);
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown attribute '%s' for <%s>", xml_attr->name, name);
 		}
 	}
+	return interpretation;
+}
+
+/** Parse <interpretation> element */
+static nlsml_interpretation_t* nlsml_interpretation_parse(apr_xml_elem *elem, apr_pool_t *pool)
+{
+	apr_xml_elem *child_elem;
+	nlsml_instance_t *instance;
+	nlsml_input_t *input;
+	nlsml_interpretation_t *interpretation = nlsml_interpretation_create(elem->attr, elem->name, pool);
 
 	/* Find input and instance elements */
 	for(child_elem = elem->first_child; child_elem; child_elem = child_elem->next) {
@@ -251,13 +284,46 @@ static nlsml_verification_result_t* nlsml_verification_result_parse(const apr_xm
 	return NULL;
 }
 
+/** Create result of attributes */
+static nlsml_result_t* nlsml_result_create(const apr_xml_attr *attr, const char *name, apr_pool_t *pool)
+{
+	const apr_xml_attr *xml_attr;
+	/* Initialize result */
+	nlsml_result_t *result = apr_palloc(pool, sizeof(*result));
+	APR_RING_INIT(&result->interpretations, nlsml_interpretation_t, link);
+	APR_RING_INIT(&result->enrollment_results, nlsml_enrollment_result_t, link);
+	APR_RING_INIT(&result->verification_results, nlsml_verification_result_t, link);
+	result->grammar = NULL;
+
+	/* Find optional grammar attribute */
+	for(xml_attr = attr; xml_attr; xml_attr = xml_attr->next) {
+		if(strcasecmp(xml_attr->name, "grammar") == 0) {
+			result->grammar = xml_attr->value;
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown attribute '%s' for <%s>", xml_attr->name, name);
+		}
+	}
+	return result;
+}
+
+/** Check whether result has no child elements, at least one MUST be specified */
+static void nlsml_result_validate(const nlsml_result_t *result, const char *name)
+{
+	if(APR_RING_EMPTY(&result->interpretations, nlsml_interpretation_t, link) && 
+		APR_RING_EMPTY(&result->enrollment_results, nlsml_enrollment_result_t, link) &&
+			APR_RING_EMPTY(&result->verification_results, nlsml_verification_result_t, link)) {
+		/* at least one of <interpretation>, <enrollment-result>, <verification-result> MUST be specified */
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid NLSML document: at least one child element MUST be specified for <%s>", name);
+	}
+}
+
 /** Parse NLSML result */
 APT_DECLARE(nlsml_result_t*) nlsml_result_parse(const char *data, apr_size_t length, apr_pool_t *pool)
 {
 	nlsml_result_t *result;
 	apr_xml_elem *root;
 	apr_xml_elem *child_elem;
-	const apr_xml_attr *xml_attr;
 	nlsml_interpretation_t *interpretation;
 	nlsml_enrollment_result_t *enrollment_result;
 	nlsml_verification_result_t *verification_result;
@@ -269,22 +335,7 @@ APT_DECLARE(nlsml_result_t*) nlsml_result_parse(const char *data, apr_size_t len
 
 	root = doc->root;
 
-	/* Initialize result */
-	result = apr_palloc(pool, sizeof(*result));
-	APR_RING_INIT(&result->interpretations, nlsml_interpretation_t, link);
-	APR_RING_INIT(&result->enrollment_results, nlsml_enrollment_result_t, link);
-	APR_RING_INIT(&result->verification_results, nlsml_verification_result_t, link);
-	result->grammar = NULL;
-
-	/* Find optional grammar attribute */
-	for(xml_attr = root->attr; xml_attr; xml_attr = xml_attr->next) {
-		if(strcasecmp(xml_attr->name, "grammar") == 0) {
-			result->grammar = xml_attr->value;
-		}
-		else {
-			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown attribute '%s' for <%s>", xml_attr->name, root->name);
-		}
-	}
+	result = nlsml_result_create(root->attr, root->name, pool);
 
 	/* Find interpretation, enrollment-result, or verification-result elements */
 	for(child_elem = root->first_child; child_elem; child_elem = child_elem->next) {
@@ -311,16 +362,574 @@ APT_DECLARE(nlsml_result_t*) nlsml_result_parse(const char *data, apr_size_t len
 		}
 	}
 
-	if(APR_RING_EMPTY(&result->interpretations, nlsml_interpretation_t, link) && 
-		APR_RING_EMPTY(&result->enrollment_results, nlsml_enrollment_result_t, link) &&
-			APR_RING_EMPTY(&result->verification_results, nlsml_verification_result_t, link)) {
-		/* at least one of <interpretation>, <enrollment-result>, <verification-result> MUST be specified */
-		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid NLSML document: at least one child element MUST be specified for <%s>", root->name);
+	nlsml_result_validate(result, root->name);
+	return result;
+}
+
+/** Type of token scanned */
+typedef enum {
+	NLSML_TOKEN_EOF,   /**< end of data */
+	NLSML_TOKEN_TEXT,  /**< character data or CDATA section */
+	NLSML_TOKEN_START, /**< start tag */
+	NLSML_TOKEN_END,   /**< end tag */
+	NLSML_TOKEN_ERROR  /**< malformed data */
+} nlsml_token_e;
+
+/** Scanner of NLSML data, which walks the data in place rather than builds a document */
+typedef struct nlsml_scanner_t nlsml_scanner_t;
+struct nlsml_scanner_t {
+	/** Current position */
+	const char *pos;
+	/** End of data */
+	const char *end;
+	/** Pool to allocate names and attributes from */
+	apr_pool_t *pool;
+};
+
+/** Token scanned */
+typedef struct nlsml_token_t nlsml_token_t;
+struct nlsml_token_t {
+	/** Qualified name of start or end tag, a span of the data */
+	const char   *qname;
+	/** Length of the qualified name */
+	apr_size_t    qname_length;
+	/** Local name of start tag (copied, only if attributes are read) */
+	const char   *name;
+	/** Attributes of start tag (decoded, only if read) */
+	apr_xml_attr *attr;
+	/** Whether the start tag is of an empty element (<name/>) */
+	apt_bool_t    empty;
+	/** Whether the text is a CDATA section, not to be decoded */
+	apt_bool_t    cdata;
+	/** Text, a span of the data */
+	apt_str_t     text;
+};
+
+static APR_INLINE apt_bool_t nlsml_is_space(char ch)
+{
+	return (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') ? TRUE : FALSE;
+}
+
+static APR_INLINE apt_bool_t nlsml_is_name_char(char ch)
+{
+	return (nlsml_is_space(ch) == FALSE && ch != '<' && ch != '>' && ch != '/' && ch != '=' &&
+		ch != '"' && ch != '\'') ? TRUE : FALSE;
+}
+
+static APR_INLINE apt_bool_t nlsml_scan_prefix(const nlsml_scanner_t *scanner, const char *prefix, apr_size_t length)
+{
+	return ((apr_size_t)(scanner->end - scanner->pos) >= length && memcmp(scanner->pos, prefix, length) == 0) ? TRUE : FALSE;
+}
+
+/** Move past the first occurrence of pattern, the data before it is returned */
+static apt_bool_t nlsml_scan_until(nlsml_scanner_t *scanner, const char *pattern, apr_size_t length, apt_str_t *skipped)
+{
+	const char *pos;
+	for(pos = scanner->pos; pos + length <= scanner->end; pos++) {
+		if(*pos == *pattern && memcmp(pos, pattern, length) == 0) {
+			if(skipped) {
+				skipped->buf = (char*)scanner->pos;
+				skipped->length = pos - scanner->pos;
+			}
+			scanner->pos = pos + length;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void nlsml_scan_spaces(nlsml_scanner_t *scanner)
+{
+	while(scanner->pos < scanner->end && nlsml_is_space(*scanner->pos) == TRUE) {
+		scanner->pos++;
+	}
+}
+
+/** Encode code point as UTF-8 */
+static apr_size_t nlsml_utf8_encode(unsigned long cp, char *out)
+{
+	if(cp < 0x80) {
+		out[0] = (char)cp;
+		return 1;
+	}
+	if(cp < 0x800) {
+		out[0] = (char)(0xC0 | (cp >> 6));
+		out[1] = (char)(0x80 | (cp & 0x3F));
+		return 2;
+	}
+	if(cp < 0x10000) {
+		out[0] = (char)(0xE0 | (cp >> 12));
+		out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		out[2] = (char)(0x80 | (cp & 0x3F));
+		return 3;
+	}
+	out[0] = (char)(0xF0 | (cp >> 18));
+	out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+	out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+	out[3] = (char)(0x80 | (cp & 0x3F));
+	return 4;
+}
+
+/** Decode entity references of text, the output is never longer than the input */
+static apr_size_t nlsml_text_decode(const char *buf, apr_size_t length, char *out)
+{
+	const char *end = buf + length;
+	char *pos = out;
+	while(buf < end) {
+		const char *semicolon;
+		apr_size_t name_length;
+		if(*buf != '&') {
+			*pos++ = *buf++;
+			continue;
+		}
+		for(semicolon = buf + 1; semicolon < end && *semicolon != ';' && semicolon - buf < 12; semicolon++);
+		if(semicolon >= end || *semicolon != ';') {
+			*pos++ = *buf++;
+			continue;
+		}
+		name_length = semicolon - buf - 1;
+		if(name_length == 2 && strncmp(buf + 1, "lt", 2) == 0) {
+			*pos++ = '<';
+		}
+		else if(name_length == 2 && strncmp(buf + 1, "gt", 2) == 0) {
+			*pos++ = '>';
+		}
+		else if(name_length == 3 && strncmp(buf + 1, "amp", 3) == 0) {
+			*pos++ = '&';
+		}
+		else if(name_length == 4 && strncmp(buf + 1, "quot", 4) == 0) {
+			*pos++ = '"';
+		}
+		else if(name_length == 4 && strncmp(buf + 1, "apos", 4) == 0) {
+			*pos++ = '\'';
+		}
+		else if(name_length > 1 && buf[1] == '#') {
+			char digits[12];
+			char *digits_end;
+			unsigned long cp;
+			memcpy(digits, buf + 2, name_length - 1);
+			digits[name_length - 1] = '\0';
+			if(digits[0] == 'x' || digits[0] == 'X') {
+				cp = strtoul(digits + 1, &digits_end, 16);
+			}
+			else {
+				cp = strtoul(digits, &digits_end, 10);
+			}
+			if(*digits_end != '\0' || digits_end == digits || cp == 0 || cp > 0x10FFFF) {
+				*pos++ = *buf++;
+				continue;
+			}
+			pos += nlsml_utf8_encode(cp, pos);
+		}
+		else {
+			*pos++ = *buf++;
+			continue;
+		}
+		buf = semicolon + 1;
+	}
+	return pos - out;
+}
+
+/** Get local name of qualified name */
+static const char* nlsml_local_name_get(const char *qname, apr_size_t length, apr_size_t *local_length)
+{
+	const char *colon = memchr(qname, ':', length);
+	if(colon) {
+		*local_length = length - (colon + 1 - qname);
+		return colon + 1;
+	}
+	*local_length = length;
+	return qname;
+}
+
+/** Scan start tag, the position is past '<' */
+static nlsml_token_e nlsml_scan_start_tag(nlsml_scanner_t *scanner, nlsml_token_t *token, apt_bool_t attribs)
+{
+	apr_xml_attr *last_attr = NULL;
+	const char *local;
+	apr_size_t local_length;
+
+	token->qname = scanner->pos;
+	while(scanner->pos < scanner->end && nlsml_is_name_char(*scanner->pos) == TRUE) {
+		scanner->pos++;
+	}
+	token->qname_length = scanner->pos - token->qname;
+	if(!token->qname_length) {
+		return NLSML_TOKEN_ERROR;
+	}
+	if(attribs == TRUE) {
+		local = nlsml_local_name_get(token->qname, token->qname_length, &local_length);
+		token->name = apr_pstrmemdup(scanner->pool, local, local_length);
+	}
+
+	for(;;) {
+		const char *name;
+		apr_size_t name_length;
+		const char *value;
+		apr_size_t value_length;
+		char quote;
+
+		nlsml_scan_spaces(scanner);
+		if(scanner->pos >= scanner->end) {
+			return NLSML_TOKEN_ERROR;
+		}
+		if(*scanner->pos == '>') {
+			scanner->pos++;
+			return NLSML_TOKEN_START;
+		}
+		if(nlsml_scan_prefix(scanner, "/>", 2) == TRUE) {
+			scanner->pos += 2;
+			token->empty = TRUE;
+			return NLSML_TOKEN_START;
+		}
+
+		name = scanner->pos;
+		while(scanner->pos < scanner->end && nlsml_is_name_char(*scanner->pos) == TRUE) {
+			scanner->pos++;
+		}
+		name_length = scanner->pos - name;
+		nlsml_scan_spaces(scanner);
+		if(!name_length || scanner->pos >= scanner->end || *scanner->pos != '=') {
+			return NLSML_TOKEN_ERROR;
+		}
+		scanner->pos++;
+		nlsml_scan_spaces(scanner);
+		if(scanner->pos >= scanner->end || (*scanner->pos != '"' && *scanner->pos != '\'')) {
+			return NLSML_TOKEN_ERROR;
+		}
+		quote = *scanner->pos++;
+		value = scanner->pos;
+		while(scanner->pos < scanner->end && *scanner->pos != quote) {
+			scanner->pos++;
+		}
+		if(scanner->pos >= scanner->end) {
+			return NLSML_TOKEN_ERROR;
+		}
+		value_length = scanner->pos - value;
+		scanner->pos++;
+
+		/* namespace declarations are not attributes, as in the document */
+		if(attribs == FALSE || (name_length >= 5 && strncmp(name, "xmlns", 5) == 0 &&
+			(name_length == 5 || name[5] == ':'))) {
+			continue;
+		}
+		else {
+			apr_xml_attr *attr = apr_palloc(scanner->pool, sizeof(*attr));
+			char *decoded = apr_palloc(scanner->pool, value_length + 1);
+			local = nlsml_local_name_get(name, name_length, &local_length);
+			attr->name = apr_pstrmemdup(scanner->pool, local, local_length);
+			attr->ns = 0;
+			decoded[nlsml_text_decode(value, value_length, decoded)] = '\0';
+			attr->value = decoded;
+			attr->next = NULL;
+			if(last_attr) {
+				last_attr->next = attr;
+			}
+			else {
+				token->attr = attr;
+			}
+			last_attr = attr;
+		}
+	}
+}
+
+/** Scan next token, skipping comments, processing instructions and declarations */
+static nlsml_token_e nlsml_scan_token(nlsml_scanner_t *scanner, nlsml_token_t *token, apt_bool_t attribs)
+{
+	token->qname = NULL;
+	token->qname_length = 0;
+	token->name = NULL;
+	token->attr = NULL;
+	token->empty = FALSE;
+	token->cdata = FALSE;
+	apt_string_reset(&token->text);
+
+	for(;;) {
+		if(scanner->pos >= scanner->end) {
+			return NLSML_TOKEN_EOF;
+		}
+		if(*scanner->pos != '<') {
+			token->text.buf = (char*)scanner->pos;
+			while(scanner->pos < scanner->end && *scanner->pos != '<') {
+				scanner->pos++;
+			}
+			token->text.length = scanner->pos - token->text.buf;
+			return NLSML_TOKEN_TEXT;
+		}
+		if(nlsml_scan_prefix(scanner, "<!--", 4) == TRUE) {
+			scanner->pos += 4;
+			if(nlsml_scan_until(scanner, "-->", 3, NULL) == FALSE) {
+				return NLSML_TOKEN_ERROR;
+			}
+			continue;
+		}
+		if(nlsml_scan_prefix(scanner, "<![CDATA[", 9) == TRUE) {
+			scanner->pos += 9;
+			if(nlsml_scan_until(scanner, "]]>", 3, &token->text) == FALSE) {
+				return NLSML_TOKEN_ERROR;
+			}
+			token->cdata = TRUE;
+			return NLSML_TOKEN_TEXT;
+		}
+		if(nlsml_scan_prefix(scanner, "<?", 2) == TRUE) {
+			scanner->pos += 2;
+			if(nlsml_scan_until(scanner, "?>", 2, NULL) == FALSE) {
+				return NLSML_TOKEN_ERROR;
+			}
+			continue;
+		}
+		if(nlsml_scan_prefix(scanner, "<!", 2) == TRUE) {
+			scanner->pos += 2;
+			if(nlsml_scan_until(scanner, ">", 1, NULL) == FALSE) {
+				return NLSML_TOKEN_ERROR;
+			}
+			continue;
+		}
+		if(nlsml_scan_prefix(scanner, "</", 2) == TRUE) {
+			scanner->pos += 2;
+			token->qname = scanner->pos;
+			while(scanner->pos < scanner->end && nlsml_is_name_char(*scanner->pos) == TRUE) {
+				scanner->pos++;
+			}
+			token->qname_length = scanner->pos - token->qname;
+			nlsml_scan_spaces(scanner);
+			if(!token->qname_length || scanner->pos >= scanner->end || *scanner->pos != '>') {
+				return NLSML_TOKEN_ERROR;
+			}
+			scanner->pos++;
+			return NLSML_TOKEN_END;
+		}
+		scanner->pos++;
+		return nlsml_scan_start_tag(scanner, token, attribs);
+	}
+}
+
+static APR_INLINE apt_bool_t nlsml_end_tag_match(const nlsml_token_t *start, const nlsml_token_t *end)
+{
+	return (start->qname_length == end->qname_length &&
+		memcmp(start->qname, end->qname, start->qname_length) == 0) ? TRUE : FALSE;
+}
+
+/** Scan content of element up to its end tag, the content (if requested) is a span of the data */
+static apt_bool_t nlsml_scan_content(nlsml_scanner_t *scanner, const nlsml_token_t *tag, apt_str_t *span, apr_size_t depth)
+{
+	nlsml_token_t token;
+	const char *begin = scanner->pos;
+	if(tag->empty == TRUE) {
+		if(span) {
+			/* the content of an empty element is empty, rather than missing */
+			span->buf = (char*)begin;
+			span->length = 0;
+		}
+		return TRUE;
+	}
+	if(depth > NLSML_SCAN_MAX_DEPTH) {
+		return FALSE;
+	}
+	for(;;) {
+		const char *pos = scanner->pos;
+		switch(nlsml_scan_token(scanner, &token, FALSE)) {
+			case NLSML_TOKEN_TEXT:
+				break;
+			case NLSML_TOKEN_START:
+				if(nlsml_scan_content(scanner, &token, NULL, depth + 1) == FALSE) {
+					return FALSE;
+				}
+				break;
+			case NLSML_TOKEN_END:
+				if(nlsml_end_tag_match(tag, &token) == FALSE) {
+					return FALSE;
+				}
+				if(span) {
+					span->buf = (char*)begin;
+					span->length = pos - begin;
+				}
+				return TRUE;
+			default:
+				return FALSE;
+		}
+	}
+}
+
+/** Scan <interpretation> element */
+static nlsml_interpretation_t* nlsml_interpretation_scan(nlsml_scanner_t *scanner, const nlsml_token_t *tag)
+{
+	nlsml_token_t token;
+	nlsml_interpretation_t *interpretation = nlsml_interpretation_create(tag->attr, tag->name, scanner->pool);
+	if(tag->empty == TRUE) {
+		return interpretation;
 	}
 
+	/* Find input and instance elements */
+	for(;;) {
+		switch(nlsml_scan_token(scanner, &token, TRUE)) {
+			case NLSML_TOKEN_TEXT:
+				break;
+			case NLSML_TOKEN_START:
+				if(strcasecmp(token.name, "input") == 0) {
+					nlsml_input_t *input = nlsml_input_create(NULL, token.attr, token.name, scanner->pool);
+					if(nlsml_scan_content(scanner, &token, &input->span, 1) == FALSE) {
+						return NULL;
+					}
+					interpretation->input = input;
+				}
+				else if(strcasecmp(token.name, "instance") == 0) {
+					nlsml_instance_t *instance = nlsml_instance_create(NULL, scanner->pool);
+					if(nlsml_scan_content(scanner, &token, &instance->span, 1) == FALSE) {
+						return NULL;
+					}
+					APR_RING_INSERT_TAIL(&interpretation->instances, instance, nlsml_instance_t, link);
+				}
+				else {
+					apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown child element <%s> for <%s>", token.name, tag->name);
+					if(nlsml_scan_content(scanner, &token, NULL, 1) == FALSE) {
+						return NULL;
+					}
+				}
+				break;
+			case NLSML_TOKEN_END:
+				return nlsml_end_tag_match(tag, &token) == TRUE ? interpretation : NULL;
+			default:
+				return NULL;
+		}
+	}
+}
+
+/** Scan NLSML result */
+APT_DECLARE(nlsml_result_t*) nlsml_result_scan(const char *data, apr_size_t length, apr_pool_t *pool)
+{
+	nlsml_scanner_t scanner;
+	nlsml_token_t root;
+	nlsml_token_t token;
+	nlsml_result_t *result;
+	nlsml_token_e type;
+
+	if(!data || !length) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No NLSML data available");
+		return NULL;
+	}
+	scanner.pos = data;
+	scanner.end = data + length;
+	scanner.pool = pool;
+
+	/* skip the prolog up to the root element */
+	while((type = nlsml_scan_token(&scanner, &root, TRUE)) == NLSML_TOKEN_TEXT);
+	if(type != NLSML_TOKEN_START) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No NLSML root element");
+		return NULL;
+	}
+
+	/* NLSML validity check: root element must be <result> */
+	if(strcmp(root.name, "result") != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected NLSML root element <%s>",root.name);
+		return NULL;
+	}
+
+	result = nlsml_result_create(root.attr, root.name, pool);
+	while(root.empty == FALSE) {
+		type = nlsml_scan_token(&scanner, &token, TRUE);
+		if(type == NLSML_TOKEN_TEXT) {
+			continue;
+		}
+		if(type == NLSML_TOKEN_END && nlsml_end_tag_match(&root, &token) == TRUE) {
+			break;
+		}
+		if(type != NLSML_TOKEN_START) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to scan NLSML input");
+			return NULL;
+		}
+
+		/* Find interpretation, enrollment-result, or verification-result elements */
+		if(strcasecmp(token.name, "interpretation") == 0) {
+			nlsml_interpretation_t *interpretation = nlsml_interpretation_scan(&scanner, &token);
+			if(!interpretation) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to scan NLSML input");
+				return NULL;
+			}
+			APR_RING_INSERT_TAIL(&result->interpretations, interpretation, nlsml_interpretation_t, link);
+			continue;
+		}
+		if(strcasecmp(token.name, "enrollment-result") != 0 && strcasecmp(token.name, "verification-result") != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown child element <%s> for <%s>", token.name, root.name);
+		}
+		/* enrollment and verification results are not parsed yet, as in the document */
+		if(nlsml_scan_content(&scanner, &token, NULL, 1) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to scan NLSML input");
+			return NULL;
+		}
+	}
+
+	nlsml_result_validate(result, root.name);
 	return result;
 }
 
+/** Generate a plain text content of scanned element, decoding entity references */
+static const char* nlsml_span_content_generate(const apt_str_t *span, apt_bool_t swi_suppress, apr_pool_t *pool)
+{
+	nlsml_scanner_t scanner;
+	nlsml_token_t token;
+	apt_str_t literal;
+	apt_bool_t blank = TRUE;
+	char *buf;
+	apr_size_t length = 0;
+
+	if(!span->buf) {
+		return NULL;
+	}
+	buf = apr_palloc(pool, span->length + 1);
+	apt_string_reset(&literal);
+	scanner.pos = span->buf;
+	scanner.end = span->buf + span->length;
+	scanner.pool = pool;
+	for(;;) {
+		const char *pos = scanner.pos;
+		nlsml_token_e type = nlsml_scan_token(&scanner, &token, FALSE);
+		if(type == NLSML_TOKEN_TEXT) {
+			apr_size_t i;
+			if(token.cdata == TRUE) {
+				memcpy(buf + length, token.text.buf, token.text.length);
+				length += token.text.length;
+			}
+			else {
+				length += nlsml_text_decode(token.text.buf, token.text.length, buf + length);
+			}
+			for(i=0; blank == TRUE && i<token.text.length; i++) {
+				if(nlsml_is_space(token.text.buf[i]) == FALSE) {
+					blank = FALSE;
+				}
+			}
+		}
+		else if(type == NLSML_TOKEN_START) {
+			apr_size_t local_length;
+			const char *local = nlsml_local_name_get(token.qname, token.qname_length, &local_length);
+			apt_str_t content;
+			apt_string_reset(&content);
+			if(nlsml_scan_content(&scanner, &token, &content, 1) == FALSE) {
+				break;
+			}
+			if(swi_suppress == TRUE && local_length == 11 && strncasecmp(local, "SWI_literal", 11) == 0) {
+				literal = content;
+			}
+			else if(swi_suppress == FALSE || local_length != 11 || strncasecmp(local, "SWI_meaning", 11) != 0) {
+				/* child elements are kept as they are */
+				memcpy(buf + length, pos, scanner.pos - pos);
+				length += scanner.pos - pos;
+				blank = FALSE;
+			}
+		}
+		else {
+			break;
+		}
+	}
+	buf[length] = '\0';
+
+	if(blank == TRUE && literal.buf) {
+		/* the instance holds nothing but SWI elements, the literal is the content */
+		return nlsml_span_content_generate(&literal, FALSE, pool);
+	}
+	return buf;
+}
+
 /** Trace NLSML result (for debug purposes only) */
 APT_DECLARE(void) nlsml_result_trace(const nlsml_result_t *result, apr_pool_t *pool)
 {
@@ -482,8 +1091,11 @@ APT_DECLARE(apt_bool_t) nlsml_instance_swi_suppress(nlsml_instance_t *instance)
 	apr_xml_elem *prev_elem = NULL;
 	apr_xml_elem *swi_literal = NULL;
 	apt_bool_t remove;
-	if(!instance->elem)
-		return FALSE;
+	if(!instance->elem) {
+		/* the content of a scanned instance is normalized as it is generated */
+		instance->swi_suppress = TRUE;
+		return instance->span.buf ? TRUE : FALSE;
+	}
 
 	for(child_elem = instance->elem->first_child; child_elem; child_elem = child_elem->next) {
 		remove = FALSE;
@@ -522,9 +1134,18 @@ APT_DECLARE(const char*) nlsml_instance_content_generate(const nlsml_instance_t
 		apr_size_t size;
 		apr_xml_to_text(pool, instance->elem, APR_XML_X2T_INNER, NULL, NULL, &buf, &size);
 	}
+	else {
+		buf = nlsml_span_content_generate(&instance->span, instance->swi_suppress, pool);
+	}
 	return buf;
 }
 
+/** Get the inner content of the scanned instance element */
+APT_DECLARE(const apt_str_t*) nlsml_instance_span_get(const nlsml_instance_t *instance)
+{
+	return &instance->span;
+}
+
 /** Get input element */
 APT_DECLARE(const apr_xml_elem*) nlsml_input_elem_get(const nlsml_input_t *input)
 {
@@ -539,9 +1160,18 @@ APT_DECLARE(const char*) nlsml_input_content_generate(const nlsml_input_t *input
 		apr_size_t size;
 		apr_xml_to_text(pool, input->elem, APR_XML_X2T_INNER, NULL, NULL, &buf, &size);
 	}
+	else {
+		buf = nlsml_span_content_generate(&input->span, FALSE, pool);
+	}
 	return buf;
 }
 
+/** Get the inner content of the scanned input element */
+APT_DECLARE(const apt_str_t*) nlsml_input_span_get(const nlsml_input_t *input)
+{
+	return &input->span;
+}
+
 /** Get input mode */
 APT_DECLARE(const char*) nlsml_input_mode_get(const nlsml_input_t *input)
 {
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <apr_strings.h>
+#include "apt_numa.h"
+#include "apt_log.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#define APT_NUMA_SYSFS
+#ifdef SYS_set_mempolicy
+#define APT_NUMA_MEMPOLICY
+#endif
+#endif
+
+#define APT_NUMA_NODE_PATH_FMT "/sys/devices/system/node/node%d"
+
+/** Max length of the list of CPUs of a node */
+#define APT_NUMA_CPU_LIST_MAX_LENGTH 1024
+
+/** Memory policy modes (linux/mempolicy.h) */
+#define APT_MPOL_DEFAULT    0
+#define APT_MPOL_PREFERRED  1
+#define APT_MPOL_INTERLEAVE 3
+
+#ifdef APT_NUMA_SYSFS
+/** Read the list of CPUs of a node, trailing white space stripped */
+static apt_bool_t apt_numa_cpu_list_read(apr_size_t node, char *buf, apr_size_t size)
+{
+	char path[128];
+	apr_size_t length;
+	FILE *file;
+	apr_snprintf(path,sizeof(path),APT_NUMA_NODE_PATH_FMT"/cpulist",(int)node);
+	file = fopen(path,"r");
+	if(!file) {
+		return FALSE;
+	}
+	if(!fgets(buf,(int)size,file)) {
+		fclose(file);
+		return FALSE;
+	}
+	fclose(file);
+
+	length = strlen(buf);
+	while(length && (buf[length-1] == '\n' || buf[length-1] == ' ')) {
+		buf[--length] = '\0';
+	}
+	return length ? TRUE : FALSE;
+}
+
+/** Check whether the list of CPUs and ranges of CPUs contains the CPU */
+static apt_bool_t apt_numa_cpu_list_contains(const char *list, int cpu)
+{
+	const char *pos = list;
+	char *end;
+	long first;
+	long last;
+	while(*pos != '\0') {
+		first = strtol(pos,&end,10);
+		if(end == pos) {
+			return FALSE;
+		}
+		last = first;
+		pos = end;
+		if(*pos == '-') {
+			pos++;
+			last = strtol(pos,&end,10);
+			if(end == pos) {
+				return FALSE;
+			}
+			pos = end;
+		}
+		if(cpu >= first && cpu <= last) {
+			return TRUE;
+		}
+		if(*pos == ',') {
+			pos++;
+		}
+		else if(*pos != '\0') {
+			return FALSE;
+		}
+	}
+	return FALSE;
+}
+#endif
+
+APT_DECLARE(apr_size_t) apt_numa_node_count_get(void)
+{
+	apr_size_t count = 0;
+#ifdef APT_NUMA_SYSFS
+	char path[128];
+	/* nodes are numbered consecutively, unless memory is hot-removed, which is not accounted */
+	for(; count < APT_NUMA_MAX_NODE_COUNT; count++) {
+		apr_snprintf(path,sizeof(path),APT_NUMA_NODE_PATH_FMT,(int)count);
+		if(access(path,F_OK) != 0) {
+			break;
+		}
+	}
+#endif
+	return count ? count : 1;
+}
+
+APT_DECLARE(const char*) apt_numa_node_cpu_set_get(apr_size_t node, apr_pool_t *pool)
+{
+#ifdef APT_NUMA_SYSFS
+	char buf[APT_NUMA_CPU_LIST_MAX_LENGTH];
+	if(apt_numa_cpu_list_read(node,buf,sizeof(buf)) == TRUE) {
+		return apr_pstrdup(pool,buf);
+	}
+#endif
+	return NULL;
+}
+
+APT_DECLARE(int) apt_numa_cpu_node_get(int cpu)
+{
+#ifdef APT_NUMA_SYSFS
+	char buf[APT_NUMA_CPU_LIST_MAX_LENGTH];
+	apr_size_t count = apt_numa_node_count_get();
+	apr_size_t node;
+	if(cpu < 0) {
+		return APT_NUMA_NODE_NONE;
+	}
+	for(node = 0; node < count; node++) {
+		if(apt_numa_cpu_list_read(node,buf,sizeof(buf)) == TRUE && apt_numa_cpu_list_contains(buf,cpu) == TRUE) {
+			return (int)node;
+		}
+	}
+#endif
+	return APT_NUMA_NODE_NONE;
+}
+
+APT_DECLARE(apt_bool_t) apt_numa_memory_policy_set(int node)
+{
+#ifdef APT_NUMA_MEMPOLICY
+	unsigned long mask = 0;
+	int mode = APT_MPOL_DEFAULT;
+	apr_size_t count = apt_numa_node_count_get();
+	if(node == APT_NUMA_NODE_INTERLEAVE) {
+		apr_size_t i;
+		if(count < 2) {
+			return TRUE;
+		}
+		for(i=0; i<count && i<sizeof(mask)*8; i++) {
+			mask |= 1UL << i;
+		}
+		mode = APT_MPOL_INTERLEAVE;
+	}
+	else if(node >= 0) {
+		if((apr_size_t)node >= count || (apr_size_t)node >= sizeof(mask)*8) {
+			return FALSE;
+		}
+		mask = 1UL << node;
+		mode = APT_MPOL_PREFERRED;
+	}
+
+	if(syscall(SYS_set_mempolicy,mode,mode == APT_MPOL_DEFAULT ? NULL : &mask,
+			mode == APT_MPOL_DEFAULT ? 0UL : (unsigned long)sizeof(mask)*8 + 1) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set Memory Policy [%d]",node);
+		return FALSE;
+	}
+	return TRUE;
+#else
+	/* a single node is reported, so only a specific other node can not be preferred */
+	return node > 0 ? FALSE : TRUE;
+#endif
+}
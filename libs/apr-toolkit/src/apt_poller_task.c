@@ -17,6 +17,7 @@
 #include "apt_poller_task.h"
 #include "apt_task.h"
 #include "apt_pool.h"
+#include "apt_clock.h"
 #include "apt_cyclic_queue.h"
 #include "apt_log.h"
 
@@ -28,6 +29,7 @@ struct apt_poller_task_t {
 	
 	void               *obj;
 	apt_poll_signal_f   signal_handler;
+	apt_poll_iteration_f iteration_handler;
 
 	apr_thread_mutex_t *guard;
 	apt_cyclic_queue_t *msg_queue;
@@ -65,6 +67,7 @@ APT_DECLARE(apt_poller_task_t*) apt_poller_task_create(
 	task->obj = obj;
 	task->pollset = NULL;
 	task->signal_handler = signal_handler;
+	task->iteration_handler = NULL;
 
 	task->pollset = apt_pollset_create((apr_uint32_t)max_pollset_size,pool);
 	if(!task->pollset) {
@@ -158,6 +161,12 @@ APT_DECLARE(void*) apt_poller_task_object_get(const apt_poller_task_t *task)
 	return task->obj;
 }
 
+/** Set the handler raised once per poll iteration */
+APT_DECLARE(void) apt_poller_task_iteration_handler_set(apt_poller_task_t *task, apt_poll_iteration_f iteration_handler)
+{
+	task->iteration_handler = iteration_handler;
+}
+
 /** Add descriptor to pollset */
 APT_DECLARE(apt_bool_t) apt_poller_task_descriptor_add(const apt_poller_task_t *task, const apr_pollfd_t *descriptor)
 {
@@ -240,7 +249,7 @@ static apt_bool_t apt_poller_task_run(apt_task_t *base)
 	while(*running) {
 		if(apt_timer_queue_timeout_get(task->timer_queue,&queue_timeout) == TRUE) {
 			timeout = (apr_interval_time_t)queue_timeout * 1000;
-			time_last = apr_time_now();
+			time_last = apt_clock_update();
 			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Wait for Messages [%s] timeout [%u]",
 				task_name, queue_timeout);
 		}
@@ -253,6 +262,8 @@ static apt_bool_t apt_poller_task_run(apt_task_t *base)
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Poll [%s] status: %d",task_name,status);
 			continue;
 		}
+		/* the descriptors processed below take the time from the cache */
+		apt_clock_update();
 		for(task->desc_index = 0; task->desc_index < task->desc_count; task->desc_index++) {
 			const apr_pollfd_t *descriptor = &task->desc_arr[task->desc_index];
 			if(apt_pollset_is_wakeup(task->pollset,descriptor)) {
@@ -269,7 +280,8 @@ static apt_bool_t apt_poller_task_run(apt_task_t *base)
 		}
 
 		if(timeout != -1) {
-			time_now = apr_time_now();
+			/* read again, so that the time the descriptors are processed in counts against the timers */
+			time_now = apt_clock_update();
 			if(time_now > time_last) {
 				apt_timer_queue_advance(task->timer_queue,(apr_uint32_t)((time_now - time_last)/1000));
 			}
@@ -280,6 +292,10 @@ static apt_bool_t apt_poller_task_run(apt_task_t *base)
 				}
 			}
 		}
+
+		if(task->iteration_handler) {
+			task->iteration_handler(task->obj);
+		}
 	}
 
 	return TRUE;
@@ -14,11 +14,81 @@
  * limitations under the License.
  */
 
+#if defined(__linux__)
+#define ENABLE_EPOLL_POLLSET
+#ifdef APT_IO_URING_POLLSET
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ENABLE_IO_URING_POLLSET
+#endif
+#endif
+#endif
+
 #include <apr_poll.h>
+#include <apr_atomic.h>
+#ifdef ENABLE_EPOLL_POLLSET
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <apr_portable.h>
+#endif
+#ifdef ENABLE_IO_URING_POLLSET
+#include <poll.h>
+#include <endian.h>
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+#include <apr_time.h>
+#endif
 #include "apt_pollset.h"
 #include "apt_log.h"
 
+#ifdef ENABLE_EPOLL_POLLSET
+/** Descriptor added to the epoll based pollset */
+typedef struct apt_pollset_elem_t apt_pollset_elem_t;
+struct apt_pollset_elem_t {
+	/** Copy of the added descriptor */
+	apr_pollfd_t        pfd;
+	/** OS descriptor */
+	int                 fd;
+	/** Next element in the list of used or free elements */
+	apt_pollset_elem_t *next;
+	/** Previous element in the list of used elements */
+	apt_pollset_elem_t *prev;
+#ifdef ENABLE_IO_URING_POLLSET
+	/** State of the element in the ring */
+	int                 state;
+	/** Poll request is submitted and its completion is outstanding */
+	apt_bool_t          armed;
+#endif
+};
+
+#ifdef ENABLE_IO_URING_POLLSET
+typedef struct apt_pollset_uring_t apt_pollset_uring_t;
+#endif
+#endif
+
 struct apt_pollset_t {
+#ifdef ENABLE_EPOLL_POLLSET
+	/** Epoll descriptor */
+	int                 epoll_fd;
+	/** Eventfd used for wakeup */
+	int                 wakeup_fd;
+	/** Array of (size + 1) events returned by epoll */
+	struct epoll_event *events;
+	/** Array of (size + 1) signalled descriptors */
+	apr_pollfd_t       *results;
+	/** Max number of descriptors (excluding the wakeup one) */
+	apr_uint32_t        size;
+	/** List of added descriptors */
+	apt_pollset_elem_t *used_elems;
+	/** List of elements to reuse */
+	apt_pollset_elem_t *free_elems;
+#ifdef ENABLE_IO_URING_POLLSET
+	/** Ring used instead of epoll, if available */
+	apt_pollset_uring_t *uring;
+#endif
+#else
 	/** APR pollset */
 	apr_pollset_t *base;
 #ifdef WIN32
@@ -27,14 +97,652 @@ struct apt_pollset_t {
 #else
 	/** Pipe descriptors used for wakeup */
 	apr_file_t    *wakeup_pipe[2];
+#endif
 #endif
 	/** Builtin wakeup poll descriptor */
 	apr_pollfd_t   wakeup_pfd;
+	/** Wakeup has been signalled, but not consumed yet (coalesces wakeups) */
+	volatile apr_uint32_t wakeup_pending;
 
 	/** Pool to allocate memory from */
 	apr_pool_t    *pool;
 };
 
+#ifdef ENABLE_EPOLL_POLLSET
+
+#ifdef ENABLE_IO_URING_POLLSET
+/*
+ * io_uring backend: each descriptor has a one-shot poll request outstanding in the ring,
+ * which is re-armed by the poll following its report, so that the descriptors stay
+ * level-triggered as with epoll. Requests of a round (re-arms, adds and removes) are
+ * submitted by the same io_uring_enter() call, which then waits for completions.
+ */
+
+/** Max number of submission entries */
+#define APT_URING_MAX_SQ_ENTRIES 4096
+
+/** User data of the completions to be ignored (removals) */
+#define APT_URING_DATA_IGNORE    0
+/** User data of the poll of the wakeup descriptor */
+#define APT_URING_DATA_WAKEUP    1
+
+/** States of an element */
+enum {
+	APT_URING_ELEM_FREE,
+	APT_URING_ELEM_USED,
+	/** removed, but the completion of its poll request is outstanding */
+	APT_URING_ELEM_REMOVING
+};
+
+/** Submission and completion rings shared with the kernel */
+struct apt_pollset_uring_t {
+	/** Ring descriptor */
+	int                  fd;
+	unsigned            *sq_head;
+	unsigned            *sq_tail;
+	unsigned            *sq_array;
+	unsigned             sq_mask;
+	unsigned             sq_entries;
+	struct io_uring_sqe *sqes;
+	/** Number of entries queued, but not submitted yet */
+	unsigned             to_submit;
+	unsigned            *cq_head;
+	unsigned            *cq_tail;
+	unsigned             cq_mask;
+	struct io_uring_cqe *cqes;
+
+	void                *ring;
+	size_t               ring_size;
+	size_t               sqes_size;
+
+	/** Elements reported by the last poll, to be re-armed by the next one */
+	apt_pollset_elem_t **rearm_elems;
+	apr_uint32_t         rearm_count;
+	/** Poll request of the wakeup descriptor is outstanding */
+	apt_bool_t           wakeup_armed;
+};
+
+static APR_INLINE int apt_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return (int) syscall(__NR_io_uring_setup,entries,params);
+}
+
+static APR_INLINE int apt_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size)
+{
+	return (int) syscall(__NR_io_uring_enter,fd,to_submit,min_complete,flags,arg,arg_size);
+}
+
+static APR_INLINE apr_uint32_t apt_uring_poll_events_get(apr_int16_t reqevents)
+{
+	apr_uint32_t events = 0;
+	if(reqevents & APR_POLLIN) events |= POLLIN;
+	if(reqevents & APR_POLLPRI) events |= POLLPRI;
+	if(reqevents & APR_POLLOUT) events |= POLLOUT;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	events = (events << 16) | (events >> 16);
+#endif
+	return events;
+}
+
+static APR_INLINE apr_int16_t apt_uring_rtnevents_get(int res)
+{
+	apr_int16_t rtnevents = 0;
+	if(res < 0) {
+		return APR_POLLERR;
+	}
+	if(res & POLLIN) rtnevents |= APR_POLLIN;
+	if(res & POLLPRI) rtnevents |= APR_POLLPRI;
+	if(res & POLLOUT) rtnevents |= APR_POLLOUT;
+	if(res & POLLERR) rtnevents |= APR_POLLERR;
+	if(res & POLLHUP) rtnevents |= APR_POLLHUP;
+	if(res & POLLNVAL) rtnevents |= APR_POLLNVAL;
+	return rtnevents;
+}
+
+/** Create ring, NULL if io_uring is unavailable or lacks the required features */
+static apt_pollset_uring_t* apt_pollset_uring_create(apr_uint32_t size, apr_pool_t *pool)
+{
+	struct io_uring_params params;
+	apt_pollset_uring_t *uring;
+	size_t sq_ring_size;
+	size_t cq_ring_size;
+	unsigned entries = size < APT_URING_MAX_SQ_ENTRIES ? size : APT_URING_MAX_SQ_ENTRIES;
+	int fd;
+
+	memset(&params,0,sizeof(params));
+	/* each descriptor has at most one poll request plus a removal outstanding */
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = 2 * (size + 1);
+	fd = apt_uring_setup(entries,&params);
+	if(fd < 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Failed to Setup io_uring errno [%d], use epoll",errno);
+		return NULL;
+	}
+	if(!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Unsupported io_uring features [0x%x], use epoll",params.features);
+		close(fd);
+		return NULL;
+	}
+
+	uring = apr_palloc(pool,sizeof(apt_pollset_uring_t));
+	uring->fd = fd;
+	uring->to_submit = 0;
+	uring->rearm_elems = apr_palloc(pool,sizeof(apt_pollset_elem_t*) * size);
+	uring->rearm_count = 0;
+	uring->wakeup_armed = FALSE;
+
+	/* both rings are mapped at once */
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	uring->ring_size = sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+	uring->ring = mmap(NULL,uring->ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+	if(uring->ring == MAP_FAILED) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Map io_uring errno [%d]",errno);
+		close(fd);
+		return NULL;
+	}
+	uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	uring->sqes = mmap(NULL,uring->sqes_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_SQES);
+	if(uring->sqes == MAP_FAILED) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Map io_uring Entries errno [%d]",errno);
+		munmap(uring->ring,uring->ring_size);
+		close(fd);
+		return NULL;
+	}
+
+	uring->sq_head = (unsigned*)((char*)uring->ring + params.sq_off.head);
+	uring->sq_tail = (unsigned*)((char*)uring->ring + params.sq_off.tail);
+	uring->sq_array = (unsigned*)((char*)uring->ring + params.sq_off.array);
+	uring->sq_mask = *(unsigned*)((char*)uring->ring + params.sq_off.ring_mask);
+	uring->sq_entries = params.sq_entries;
+	uring->cq_head = (unsigned*)((char*)uring->ring + params.cq_off.head);
+	uring->cq_tail = (unsigned*)((char*)uring->ring + params.cq_off.tail);
+	uring->cq_mask = *(unsigned*)((char*)uring->ring + params.cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe*)((char*)uring->ring + params.cq_off.cqes);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create io_uring Pollset [%u] entries",params.sq_entries);
+	return uring;
+}
+
+static void apt_pollset_uring_destroy(apt_pollset_uring_t *uring)
+{
+	/* outstanding requests are cancelled as the ring is closed */
+	munmap(uring->sqes,uring->sqes_size);
+	munmap(uring->ring,uring->ring_size);
+	close(uring->fd);
+}
+
+/** Get next submission entry, the queued ones are submitted at once if the ring is full */
+static struct io_uring_sqe* apt_pollset_uring_sqe_get(apt_pollset_uring_t *uring)
+{
+	struct io_uring_sqe *sqe;
+	unsigned tail = *uring->sq_tail;
+	unsigned index;
+	if(tail - __atomic_load_n(uring->sq_head,__ATOMIC_ACQUIRE) >= uring->sq_entries) {
+		if(apt_uring_enter(uring->fd,uring->to_submit,0,0,NULL,0) < 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Submit io_uring Entries errno [%d]",errno);
+			return NULL;
+		}
+		uring->to_submit = 0;
+		if(tail - __atomic_load_n(uring->sq_head,__ATOMIC_ACQUIRE) >= uring->sq_entries) {
+			return NULL;
+		}
+	}
+	index = tail & uring->sq_mask;
+	sqe = &uring->sqes[index];
+	memset(sqe,0,sizeof(*sqe));
+	uring->sq_array[index] = index;
+	/* the entry is filled in before the kernel is entered, it's only published here */
+	__atomic_store_n(uring->sq_tail,tail + 1,__ATOMIC_RELEASE);
+	uring->to_submit++;
+	return sqe;
+}
+
+/** Queue one-shot poll request */
+static apt_bool_t apt_pollset_uring_poll_add(apt_pollset_uring_t *uring, int fd, apr_int16_t reqevents, apr_uint64_t data)
+{
+	struct io_uring_sqe *sqe = apt_pollset_uring_sqe_get(uring);
+	if(!sqe) {
+		return FALSE;
+	}
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = apt_uring_poll_events_get(reqevents);
+	sqe->user_data = data;
+	return TRUE;
+}
+
+static apt_bool_t apt_pollset_uring_elem_arm(apt_pollset_uring_t *uring, apt_pollset_elem_t *elem)
+{
+	if(apt_pollset_uring_poll_add(uring,elem->fd,elem->pfd.reqevents,(apr_uint64_t)(apr_uintptr_t)elem) == FALSE) {
+		return FALSE;
+	}
+	elem->armed = TRUE;
+	return TRUE;
+}
+
+/** Cancel the outstanding poll request of the element, FALSE if there is none */
+static apt_bool_t apt_pollset_uring_elem_disarm(apt_pollset_uring_t *uring, apt_pollset_elem_t *elem)
+{
+	struct io_uring_sqe *sqe;
+	if(elem->armed == FALSE) {
+		return FALSE;
+	}
+	sqe = apt_pollset_uring_sqe_get(uring);
+	if(sqe) {
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = (apr_uint64_t)(apr_uintptr_t)elem;
+		sqe->user_data = APT_URING_DATA_IGNORE;
+	}
+	/* the element is retired by the completion of its poll request, either cancelled or not */
+	return TRUE;
+}
+
+/** Reap available completions to the results, return the number of them */
+static int apt_pollset_uring_reap(apt_pollset_t *pollset)
+{
+	apt_pollset_uring_t *uring = pollset->uring;
+	unsigned head = *uring->cq_head;
+	unsigned tail = __atomic_load_n(uring->cq_tail,__ATOMIC_ACQUIRE);
+	int count = 0;
+
+	while(head != tail && count < (int)pollset->size + 1) {
+		struct io_uring_cqe *cqe = &uring->cqes[head & uring->cq_mask];
+		head++;
+		if(cqe->user_data == APT_URING_DATA_IGNORE) {
+			continue;
+		}
+		if(cqe->user_data == APT_URING_DATA_WAKEUP) {
+			uring->wakeup_armed = FALSE;
+			pollset->results[count++] = pollset->wakeup_pfd;
+		}
+		else {
+			apt_pollset_elem_t *elem = (apt_pollset_elem_t*)(apr_uintptr_t)cqe->user_data;
+			elem->armed = FALSE;
+			if(elem->state == APT_URING_ELEM_REMOVING) {
+				elem->state = APT_URING_ELEM_FREE;
+				elem->next = pollset->free_elems;
+				pollset->free_elems = elem;
+				continue;
+			}
+			pollset->results[count] = elem->pfd;
+			pollset->results[count].rtnevents = apt_uring_rtnevents_get(cqe->res);
+			count++;
+			uring->rearm_elems[uring->rearm_count++] = elem;
+		}
+	}
+	__atomic_store_n(uring->cq_head,head,__ATOMIC_RELEASE);
+	return count;
+}
+
+static apr_status_t apt_pollset_uring_poll(apt_pollset_t *pollset, apr_interval_time_t timeout, apr_int32_t *num)
+{
+	apt_pollset_uring_t *uring = pollset->uring;
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	apr_time_t deadline = 0;
+	apr_uint32_t i;
+	int count;
+	int rv;
+
+	/* re-arm the reported descriptors still in the set, unread data gets them reported again at once */
+	for(i=0; i<uring->rearm_count; i++) {
+		apt_pollset_elem_t *elem = uring->rearm_elems[i];
+		if(elem->state == APT_URING_ELEM_USED && elem->armed == FALSE) {
+			apt_pollset_uring_elem_arm(uring,elem);
+		}
+	}
+	uring->rearm_count = 0;
+	if(uring->wakeup_armed == FALSE &&
+		apt_pollset_uring_poll_add(uring,pollset->wakeup_fd,APR_POLLIN,APT_URING_DATA_WAKEUP) == TRUE) {
+		uring->wakeup_armed = TRUE;
+	}
+
+	if(timeout >= 0) {
+		deadline = apr_time_now() + timeout;
+	}
+	do {
+		memset(&arg,0,sizeof(arg));
+		if(timeout >= 0) {
+			apr_interval_time_t remaining = deadline - apr_time_now();
+			if(remaining < 0) {
+				remaining = 0;
+			}
+			ts.tv_sec = remaining / APR_USEC_PER_SEC;
+			ts.tv_nsec = (remaining % APR_USEC_PER_SEC) * 1000;
+			arg.ts = (apr_uint64_t)(apr_uintptr_t)&ts;
+		}
+		/* submit the queued requests and wait for a completion by the same call */
+		rv = apt_uring_enter(uring->fd,uring->to_submit,1,IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,&arg,sizeof(arg));
+		if(rv >= 0) {
+			uring->to_submit = 0;
+		}
+		else if(errno == ETIME) {
+			/* entries are consumed even though the wait timed out */
+			uring->to_submit = 0;
+		}
+		else if(errno != EBUSY) {
+			return APR_FROM_OS_ERROR(errno);
+		}
+
+		count = apt_pollset_uring_reap(pollset);
+		if(count) {
+			break;
+		}
+		if(rv < 0 && errno == ETIME) {
+			return APR_TIMEUP;
+		}
+		/* only ignored completions have been reaped, wait again */
+	}
+	while(timeout < 0 || apr_time_now() < deadline);
+
+	if(!count) {
+		return APR_TIMEUP;
+	}
+	*num = count;
+	return APR_SUCCESS;
+}
+#endif
+
+/** Create interruptable pollset on top of epoll */
+APT_DECLARE(apt_pollset_t*) apt_pollset_create(apr_uint32_t size, apr_pool_t *pool)
+{
+	struct epoll_event event;
+	apt_pollset_t *pollset = apr_palloc(pool,sizeof(apt_pollset_t));
+	pollset->pool = pool;
+	pollset->size = size;
+	pollset->used_elems = NULL;
+	pollset->free_elems = NULL;
+	pollset->wakeup_pending = 0;
+	memset(&pollset->wakeup_pfd,0,sizeof(pollset->wakeup_pfd));
+
+	/* +1 is builtin wakeup descriptor */
+	pollset->events = apr_palloc(pool,sizeof(struct epoll_event) * (size + 1));
+	pollset->results = apr_palloc(pool,sizeof(apr_pollfd_t) * (size + 1));
+
+	pollset->wakeup_fd = eventfd(0,EFD_NONBLOCK | EFD_CLOEXEC);
+	if(pollset->wakeup_fd < 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Wakeup Eventfd errno [%d]",errno);
+		return NULL;
+	}
+	/* the wakeup descriptor is reported with no APR descriptor, but the pollset as client data */
+	pollset->wakeup_pfd.desc_type = APR_NO_DESC;
+	pollset->wakeup_pfd.reqevents = APR_POLLIN;
+	pollset->wakeup_pfd.rtnevents = APR_POLLIN;
+	pollset->wakeup_pfd.client_data = pollset;
+
+#ifdef ENABLE_IO_URING_POLLSET
+	/* the wakeup descriptor is polled by the ring as any other one, epoll is the fallback */
+	pollset->uring = apt_pollset_uring_create(size + 1,pool);
+	if(pollset->uring) {
+		pollset->epoll_fd = -1;
+		return pollset;
+	}
+#endif
+
+	pollset->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(pollset->epoll_fd < 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Epoll errno [%d]",errno);
+		close(pollset->wakeup_fd);
+		return NULL;
+	}
+
+	memset(&event,0,sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if(epoll_ctl(pollset->epoll_fd,EPOLL_CTL_ADD,pollset->wakeup_fd,&event) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add Wakeup Eventfd errno [%d]",errno);
+		close(pollset->wakeup_fd);
+		close(pollset->epoll_fd);
+		return NULL;
+	}
+	return pollset;
+}
+
+/** Destroy pollset */
+APT_DECLARE(apt_bool_t) apt_pollset_destroy(apt_pollset_t *pollset)
+{
+	if(pollset->wakeup_fd >= 0) {
+		close(pollset->wakeup_fd);
+		pollset->wakeup_fd = -1;
+	}
+	if(pollset->epoll_fd >= 0) {
+		close(pollset->epoll_fd);
+		pollset->epoll_fd = -1;
+	}
+#ifdef ENABLE_IO_URING_POLLSET
+	if(pollset->uring) {
+		apt_pollset_uring_destroy(pollset->uring);
+		pollset->uring = NULL;
+	}
+#endif
+	return TRUE;
+}
+
+/** Get OS descriptor of the poll descriptor */
+static int apt_pollset_os_fd_get(const apr_pollfd_t *descriptor)
+{
+	if(descriptor->desc_type == APR_POLL_SOCKET) {
+		apr_os_sock_t fd;
+		if(apr_os_sock_get(&fd,descriptor->desc.s) == APR_SUCCESS) {
+			return fd;
+		}
+	}
+	else if(descriptor->desc_type == APR_POLL_FILE) {
+		apr_os_file_t fd;
+		if(apr_os_file_get(&fd,descriptor->desc.f) == APR_SUCCESS) {
+			return fd;
+		}
+	}
+	return -1;
+}
+
+static APR_INLINE apr_uint32_t apt_pollset_reqevents_to_epoll(apr_int16_t reqevents)
+{
+	apr_uint32_t events = 0;
+	if(reqevents & APR_POLLIN) events |= EPOLLIN;
+	if(reqevents & APR_POLLPRI) events |= EPOLLPRI;
+	if(reqevents & APR_POLLOUT) events |= EPOLLOUT;
+	return events;
+}
+
+static APR_INLINE apr_int16_t apt_pollset_rtnevents_from_epoll(apr_uint32_t events)
+{
+	apr_int16_t rtnevents = 0;
+	if(events & EPOLLIN) rtnevents |= APR_POLLIN;
+	if(events & EPOLLPRI) rtnevents |= APR_POLLPRI;
+	if(events & EPOLLOUT) rtnevents |= APR_POLLOUT;
+	if(events & EPOLLERR) rtnevents |= APR_POLLERR;
+	if(events & EPOLLHUP) rtnevents |= APR_POLLHUP;
+	return rtnevents;
+}
+
+/** Link element to the list of used elements */
+static APR_INLINE void apt_pollset_elem_link(apt_pollset_t *pollset, apt_pollset_elem_t *elem)
+{
+	elem->prev = NULL;
+	elem->next = pollset->used_elems;
+	if(pollset->used_elems) {
+		pollset->used_elems->prev = elem;
+	}
+	pollset->used_elems = elem;
+}
+
+/** Add pollset descriptor to a pollset */
+APT_DECLARE(apt_bool_t) apt_pollset_add(apt_pollset_t *pollset, const apr_pollfd_t *descriptor)
+{
+	struct epoll_event event;
+	apt_pollset_elem_t *elem;
+	int fd = apt_pollset_os_fd_get(descriptor);
+	if(fd < 0) {
+		return FALSE;
+	}
+
+	elem = pollset->free_elems;
+	if(elem) {
+		pollset->free_elems = elem->next;
+	}
+	else {
+		elem = apr_palloc(pollset->pool,sizeof(apt_pollset_elem_t));
+	}
+	elem->pfd = *descriptor;
+	elem->fd = fd;
+
+#ifdef ENABLE_IO_URING_POLLSET
+	if(pollset->uring) {
+		elem->state = APT_URING_ELEM_USED;
+		elem->armed = FALSE;
+		if(apt_pollset_uring_elem_arm(pollset->uring,elem) == FALSE) {
+			elem->state = APT_URING_ELEM_FREE;
+			elem->next = pollset->free_elems;
+			pollset->free_elems = elem;
+			return FALSE;
+		}
+		apt_pollset_elem_link(pollset,elem);
+		return TRUE;
+	}
+#endif
+
+	/* level-triggered, signal handlers are allowed to leave data unread till the next poll */
+	memset(&event,0,sizeof(event));
+	event.events = apt_pollset_reqevents_to_epoll(descriptor->reqevents);
+	event.data.ptr = elem;
+	if(epoll_ctl(pollset->epoll_fd,EPOLL_CTL_ADD,fd,&event) != 0) {
+		elem->next = pollset->free_elems;
+		pollset->free_elems = elem;
+		return FALSE;
+	}
+
+	apt_pollset_elem_link(pollset,elem);
+	return TRUE;
+}
+
+/** Remove pollset descriptor from a pollset */
+APT_DECLARE(apt_bool_t) apt_pollset_remove(apt_pollset_t *pollset, const apr_pollfd_t *descriptor)
+{
+	struct epoll_event event;
+	apt_pollset_elem_t *elem;
+	for(elem = pollset->used_elems; elem; elem = elem->next) {
+		if(elem->pfd.desc_type == descriptor->desc_type && elem->pfd.desc.s == descriptor->desc.s) {
+			break;
+		}
+	}
+	if(!elem) {
+		return FALSE;
+	}
+
+	if(elem->prev) {
+		elem->prev->next = elem->next;
+	}
+	else {
+		pollset->used_elems = elem->next;
+	}
+	if(elem->next) {
+		elem->next->prev = elem->prev;
+	}
+
+#ifdef ENABLE_IO_URING_POLLSET
+	if(pollset->uring) {
+		if(apt_pollset_uring_elem_disarm(pollset->uring,elem) == TRUE) {
+			/* retired by the completion of the cancelled poll request */
+			elem->state = APT_URING_ELEM_REMOVING;
+			return TRUE;
+		}
+		elem->state = APT_URING_ELEM_FREE;
+		elem->next = pollset->free_elems;
+		pollset->free_elems = elem;
+		return TRUE;
+	}
+#endif
+
+	memset(&event,0,sizeof(event));
+	epoll_ctl(pollset->epoll_fd,EPOLL_CTL_DEL,elem->fd,&event);
+
+	elem->next = pollset->free_elems;
+	pollset->free_elems = elem;
+	return TRUE;
+}
+
+/** Block for activity on the descriptor(s) in a pollset */
+APT_DECLARE(apr_status_t) apt_pollset_poll(
+								apt_pollset_t *pollset,
+								apr_interval_time_t timeout,
+								apr_int32_t *num,
+								const apr_pollfd_t **descriptors)
+{
+	int i;
+	int count;
+	int msec = -1;
+	if(timeout >= 0) {
+		/* round up not to spin on sub-millisecond timeouts */
+		msec = (int)((timeout + 999) / 1000);
+	}
+
+	*num = 0;
+#ifdef ENABLE_IO_URING_POLLSET
+	if(pollset->uring) {
+		apr_status_t status = apt_pollset_uring_poll(pollset,timeout,num);
+		*descriptors = pollset->results;
+		return status;
+	}
+#endif
+	count = epoll_wait(pollset->epoll_fd,pollset->events,(int)pollset->size + 1,msec);
+	if(count < 0) {
+		return APR_FROM_OS_ERROR(errno);
+	}
+	if(count == 0) {
+		return APR_TIMEUP;
+	}
+
+	/* copy the whole batch at once, descriptors removed while the batch is processed stay valid */
+	for(i=0; i<count; i++) {
+		apt_pollset_elem_t *elem = pollset->events[i].data.ptr;
+		if(elem) {
+			pollset->results[i] = elem->pfd;
+			pollset->results[i].rtnevents = apt_pollset_rtnevents_from_epoll(pollset->events[i].events);
+		}
+		else {
+			pollset->results[i] = pollset->wakeup_pfd;
+		}
+	}
+	*num = count;
+	*descriptors = pollset->results;
+	return APR_SUCCESS;
+}
+
+/** Interrupt the blocked poll call */
+APT_DECLARE(apt_bool_t) apt_pollset_wakeup(apt_pollset_t *pollset)
+{
+	apr_uint64_t value = 1;
+	if(apr_atomic_xchg32(&pollset->wakeup_pending,1) != 0) {
+		/* already signalled, but not consumed yet */
+		return TRUE;
+	}
+	if(write(pollset->wakeup_fd,&value,sizeof(value)) != sizeof(value)) {
+		apr_atomic_set32(&pollset->wakeup_pending,0);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Match against builtin wake up descriptor in a pollset */
+APT_DECLARE(apt_bool_t) apt_pollset_is_wakeup(apt_pollset_t *pollset, const apr_pollfd_t *descriptor)
+{
+	apr_uint64_t value;
+	if(descriptor->desc_type != APR_NO_DESC || descriptor->client_data != pollset) {
+		return FALSE;
+	}
+	/* consume the signal before the pending flag is cleared, so that no wakeup gets lost */
+	if(read(pollset->wakeup_fd,&value,sizeof(value)) < 0 && errno != EAGAIN) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Read Wakeup Eventfd errno [%d]",errno);
+	}
+	apr_atomic_xchg32(&pollset->wakeup_pending,0);
+	return TRUE;
+}
+
+#else
+
 static apt_bool_t apt_wakeup_pipe_create(apt_pollset_t *pollset);
 static apt_bool_t apt_wakeup_pipe_destroy(apt_pollset_t *pollset);
 
@@ -43,6 +751,7 @@ APT_DECLARE(apt_pollset_t*) apt_pollset_create(apr_uint32_t size, apr_pool_t *po
 {
 	apt_pollset_t *pollset = apr_palloc(pool,sizeof(apt_pollset_t));
 	pollset->pool = pool;
+	pollset->wakeup_pending = 0;
 	memset(&pollset->wakeup_pfd,0,sizeof(pollset->wakeup_pfd));
 	
 	/* create pollset with max number of descriptors size+1, 
@@ -107,6 +816,12 @@ APT_DECLARE(apt_bool_t) apt_pollset_wakeup(apt_pollset_t *pollset)
 #ifdef WIN32
 	char tmp = 0;
 	apr_size_t len = sizeof(tmp);
+#endif
+	if(apr_atomic_xchg32(&pollset->wakeup_pending,1) != 0) {
+		/* already signalled, but not consumed yet */
+		return TRUE;
+	}
+#ifdef WIN32
 	if(apr_socket_send(pollset->wakeup_pipe[1],&tmp,&len) != APR_SUCCESS) {
 		status = FALSE;
 	}
@@ -115,6 +830,9 @@ APT_DECLARE(apt_bool_t) apt_pollset_wakeup(apt_pollset_t *pollset)
 		status = FALSE;
 	}
 #endif
+	if(status == FALSE) {
+		apr_atomic_set32(&pollset->wakeup_pending,0);
+	}
 	return status;
 }
 
@@ -133,6 +851,8 @@ APT_DECLARE(apt_bool_t) apt_pollset_is_wakeup(apt_pollset_t *pollset, const apr_
 				break;
 			}
 		}
+		/* the pending flag is cleared after the pipe is read out, so that no wakeup gets lost */
+		apr_atomic_xchg32(&pollset->wakeup_pending,0);
 		status = TRUE;
 	}
 #else
@@ -146,6 +866,8 @@ APT_DECLARE(apt_bool_t) apt_pollset_is_wakeup(apt_pollset_t *pollset, const apr_
 				break;
 			}
 		}
+		/* the pending flag is cleared after the pipe is read out, so that no wakeup gets lost */
+		apr_atomic_xchg32(&pollset->wakeup_pending,0);
 		status = TRUE;
 	}
 #endif
@@ -321,3 +1043,5 @@ static apt_bool_t apt_wakeup_pipe_destroy(apt_pollset_t *pollset)
 }
 
 #endif
+
+#endif /* ENABLE_EPOLL_POLLSET */
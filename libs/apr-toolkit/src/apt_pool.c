@@ -14,18 +14,31 @@
  * limitations under the License.
  */
 
+#include <apr_thread_mutex.h>
 #include "apt_pool.h"
 #include "apt_log.h"
 
 #define OWN_ALLOCATOR_PER_POOL
 
+#if defined(_MSC_VER)
+#define APT_POOL_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define APT_POOL_THREAD_LOCAL __thread
+#endif
+
+#ifdef APT_POOL_THREAD_LOCAL
+/* allocator the pools of the thread are created on (NULL - own allocator per pool) */
+static APT_POOL_THREAD_LOCAL apr_allocator_t *thread_allocator = NULL;
+#endif
+
 static int apt_abort_fn(int retcode)
 {
 	apt_log(APT_LOG_MARK,APT_PRIO_CRITICAL,"APR Abort Called [%d]", retcode);
 	return 0;
 }
 
-APT_DECLARE(apr_pool_t*) apt_pool_create()
+/** Create pool on an allocator of its own */
+static apr_pool_t* apt_pool_own_create(void)
 {
 	apr_pool_t *pool = NULL;
 
@@ -47,9 +60,199 @@ APT_DECLARE(apr_pool_t*) apt_pool_create()
 	return pool;
 }
 
+APT_DECLARE(apr_pool_t*) apt_pool_create()
+{
+#ifdef APT_POOL_THREAD_LOCAL
+	if(thread_allocator) {
+		apr_pool_t *pool = NULL;
+		if(apr_pool_create_ex(&pool,NULL,apt_abort_fn,thread_allocator) != APR_SUCCESS) {
+			return NULL;
+		}
+		return pool;
+	}
+#endif
+	return apt_pool_own_create();
+}
+
 APT_DECLARE(apr_pool_t*) apt_subpool_create(apr_pool_t *parent)
 {
 	apr_pool_t *pool = NULL;
 	apr_pool_create(&pool,parent);
 	return pool;
 }
+
+APT_DECLARE(apr_size_t) apt_pool_size_get(apr_pool_t *pool)
+{
+#if APR_POOL_DEBUG
+	return apr_pool_num_bytes(pool,1);
+#else
+	return 0;
+#endif
+}
+
+APT_DECLARE(apr_allocator_t*) apt_thread_allocator_create(apr_size_t max_free)
+{
+	apr_allocator_t *allocator = NULL;
+	apr_pool_t *owner = NULL;
+	apr_thread_mutex_t *mutex = NULL;
+
+	if(apr_allocator_create(&allocator) != APR_SUCCESS) {
+		return NULL;
+	}
+	/* the allocator owns itself through a pool, which holds its mutex */
+	if(apr_pool_create_ex(&owner,NULL,apt_abort_fn,allocator) != APR_SUCCESS) {
+		apr_allocator_destroy(allocator);
+		return NULL;
+	}
+	apr_allocator_owner_set(allocator,owner);
+	if(apr_thread_mutex_create(&mutex,APR_THREAD_MUTEX_DEFAULT,owner) != APR_SUCCESS) {
+		apr_pool_destroy(owner);
+		return NULL;
+	}
+	apr_allocator_mutex_set(allocator,mutex);
+	if(max_free) {
+		apr_allocator_max_free_set(allocator,max_free);
+	}
+	return allocator;
+}
+
+APT_DECLARE(void) apt_thread_allocator_set(apr_allocator_t *allocator)
+{
+#ifdef APT_POOL_THREAD_LOCAL
+	thread_allocator = allocator;
+#endif
+}
+
+APT_DECLARE(apr_allocator_t*) apt_thread_allocator_get(void)
+{
+#ifdef APT_POOL_THREAD_LOCAL
+	return thread_allocator;
+#else
+	return NULL;
+#endif
+}
+
+/** Cache of recycled pools */
+struct apt_pool_cache_t {
+	/** Released pools available for reuse (LIFO, to keep the recent ones hot) */
+	apr_pool_t        **pools;
+	/** Max number of cached pools */
+	apr_size_t          max_count;
+	/** Max size of free memory a cached pool keeps */
+	apr_size_t          max_retained_size;
+	/** Statistics of the cache */
+	apt_pool_cache_stats_t stats;
+	/** Guard of the cache */
+	apr_thread_mutex_t *guard;
+};
+
+APT_DECLARE(apt_pool_cache_t*) apt_pool_cache_create(apr_size_t max_count, apr_size_t max_retained_size, apr_pool_t *pool)
+{
+	apt_pool_cache_t *cache = apr_palloc(pool,sizeof(apt_pool_cache_t));
+	cache->pools = apr_palloc(pool,sizeof(apr_pool_t*) * (max_count ? max_count : 1));
+	cache->max_count = max_count;
+	cache->max_retained_size = max_retained_size;
+	cache->stats.acquired = 0;
+	cache->stats.reused = 0;
+	cache->stats.released = 0;
+	cache->stats.discarded = 0;
+	cache->stats.cached = 0;
+	cache->guard = NULL;
+	if(apr_thread_mutex_create(&cache->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return cache;
+}
+
+APT_DECLARE(void) apt_pool_cache_destroy(apt_pool_cache_t *cache)
+{
+	apr_thread_mutex_lock(cache->guard);
+	while(cache->stats.cached) {
+		apr_pool_destroy(cache->pools[--cache->stats.cached]);
+	}
+	apr_thread_mutex_unlock(cache->guard);
+	apr_thread_mutex_destroy(cache->guard);
+}
+
+APT_DECLARE(apr_pool_t*) apt_pool_cache_acquire(apt_pool_cache_t *cache)
+{
+	apr_pool_t *pool = NULL;
+	apr_thread_mutex_lock(cache->guard);
+	cache->stats.acquired++;
+	if(cache->stats.cached) {
+		pool = cache->pools[--cache->stats.cached];
+		cache->stats.reused++;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+	if(pool) {
+		return pool;
+	}
+
+	/* the cached pools are reset along with their allocators, hence never on a shared one */
+	pool = apt_pool_own_create();
+#ifdef OWN_ALLOCATOR_PER_POOL
+	if(pool && cache->max_retained_size) {
+		/* the blocks beyond the limit are returned to the system, once the pool is cleared */
+		apr_allocator_max_free_set(apr_pool_allocator_get(pool),cache->max_retained_size);
+	}
+#endif
+	return pool;
+}
+
+/** Clear pool to be reused */
+static void apt_pool_reset(apr_pool_t *pool)
+{
+#ifdef OWN_ALLOCATOR_PER_POOL
+	apr_allocator_t *allocator = apr_pool_allocator_get(pool);
+	apr_thread_mutex_t *mutex = NULL;
+	/* the mutex of the allocator is allocated from the pool, detach it before it is gone */
+	apr_allocator_mutex_set(allocator,NULL);
+	apr_pool_clear(pool);
+	apr_thread_mutex_create(&mutex,APR_THREAD_MUTEX_NESTED,pool);
+	apr_allocator_mutex_set(allocator,mutex);
+	apr_pool_mutex_set(pool,mutex);
+#else
+	apr_pool_clear(pool);
+#endif
+}
+
+APT_DECLARE(void) apt_pool_cache_release(apt_pool_cache_t *cache, apr_pool_t *pool)
+{
+	apt_bool_t cached = FALSE;
+	if(!pool) {
+		return;
+	}
+
+	apr_thread_mutex_lock(cache->guard);
+	cache->stats.released++;
+	if(cache->stats.cached >= cache->max_count) {
+		cache->stats.discarded++;
+		apr_thread_mutex_unlock(cache->guard);
+		apr_pool_destroy(pool);
+		return;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+
+	/* clear outside the guard, the pool is not referenced by anyone else by now */
+	apt_pool_reset(pool);
+	apr_thread_mutex_lock(cache->guard);
+	if(cache->stats.cached < cache->max_count) {
+		cache->pools[cache->stats.cached++] = pool;
+		cached = TRUE;
+	}
+	else {
+		cache->stats.discarded++;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+
+	if(cached == FALSE) {
+		apr_pool_destroy(pool);
+	}
+}
+
+APT_DECLARE(void) apt_pool_cache_stats_get(apt_pool_cache_t *cache, apt_pool_cache_stats_t *stats)
+{
+	apr_thread_mutex_lock(cache->guard);
+	*stats = cache->stats;
+	apr_thread_mutex_unlock(cache->guard);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "apt_spsc_queue.h"
+
+struct apt_spsc_queue_t {
+	/** Contiguous storage of (mask + 1) slots */
+	char                  *data;
+	/** Size of each slot */
+	apr_size_t             elem_size;
+	/** Capacity - 1 (capacity is a power of two) */
+	apr_uint32_t           mask;
+	/** Free-running write index (modified by producer only) */
+	volatile apr_uint32_t  head;
+	/** Free-running read index (modified by consumer only) */
+	volatile apr_uint32_t  tail;
+};
+
+/** Load index with full barrier (apr_atomic_read32() is not guaranteed to be fenced) */
+static APR_INLINE apr_uint32_t apt_spsc_index_load(const volatile apr_uint32_t *index)
+{
+	return apr_atomic_add32((volatile apr_uint32_t*)index,0);
+}
+
+APT_DECLARE(apt_spsc_queue_t*) apt_spsc_queue_create(apr_size_t capacity, apr_size_t elem_size, apr_pool_t *pool)
+{
+	apt_spsc_queue_t *queue;
+	apr_uint32_t size = 1;
+	if(!capacity || !elem_size) {
+		return NULL;
+	}
+	while(size < capacity) {
+		size <<= 1;
+	}
+
+	queue = apr_palloc(pool,sizeof(apt_spsc_queue_t));
+	/* keep slots pointer-aligned */
+	queue->elem_size = (elem_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+	queue->data = apr_palloc(pool,queue->elem_size * size);
+	queue->mask = size - 1;
+	queue->head = 0;
+	queue->tail = 0;
+	return queue;
+}
+
+APT_DECLARE(void*) apt_spsc_queue_write_begin(apt_spsc_queue_t *queue)
+{
+	apr_uint32_t tail = apt_spsc_index_load(&queue->tail);
+	if(queue->head - tail > queue->mask) {
+		/* full */
+		return NULL;
+	}
+	return queue->data + (queue->head & queue->mask) * queue->elem_size;
+}
+
+APT_DECLARE(void) apt_spsc_queue_write_commit(apt_spsc_queue_t *queue)
+{
+	/* publish the slot content before advancing the index */
+	apr_atomic_inc32(&queue->head);
+}
+
+APT_DECLARE(void*) apt_spsc_queue_read_begin(apt_spsc_queue_t *queue)
+{
+	apr_uint32_t head = apt_spsc_index_load(&queue->head);
+	if(head == queue->tail) {
+		/* empty */
+		return NULL;
+	}
+	return queue->data + (queue->tail & queue->mask) * queue->elem_size;
+}
+
+APT_DECLARE(void) apt_spsc_queue_read_commit(apt_spsc_queue_t *queue)
+{
+	apr_atomic_inc32(&queue->tail);
+}
+
+APT_DECLARE(apr_size_t) apt_spsc_queue_size(const apt_spsc_queue_t *queue)
+{
+	return apt_spsc_index_load(&queue->head) - apt_spsc_index_load(&queue->tail);
+}
+
+APT_DECLARE(apr_size_t) apt_spsc_queue_capacity(const apt_spsc_queue_t *queue)
+{
+	return (apr_size_t)queue->mask + 1;
+}
@@ -64,3 +64,194 @@ APT_DECLARE(apr_size_t) apt_string_table_id_find(const apt_str_table_item_t tabl
 	/* no match found, return invalid id */
 	return size;
 }
+
+/** Multiplier of the hash function (golden ratio) */
+#define STRING_TABLE_HASH_PRIME APR_UINT64_C(0x9E3779B97F4A7C15)
+/** Mask to fold the case of 8 characters at once */
+#define STRING_TABLE_HASH_FOLD  APR_UINT64_C(0x2020202020202020)
+
+/** Load up to 8 characters in the same (little-endian) order on any platform */
+static APR_INLINE apr_uint64_t string_table_word_load(const char *buf, apr_size_t length)
+{
+	apr_uint64_t word = 0;
+	while(length) {
+		length--;
+		word = (word << 8) | (apr_byte_t)buf[length];
+	}
+	return word;
+}
+
+/** Calculate the case-insensitive hash of a string, 8 characters at a time */
+static apr_uint64_t string_table_hash(const apt_str_t *value)
+{
+	/* folding by 0x20 is enough, since strings compared equal (no case) always hash the same */
+	const char *buf = value->buf;
+	apr_size_t length = value->length;
+	apr_uint64_t hash = value->length * STRING_TABLE_HASH_PRIME;
+	while(length > 8) {
+		hash = (hash ^ (string_table_word_load(buf,8) | STRING_TABLE_HASH_FOLD)) * STRING_TABLE_HASH_PRIME;
+		hash ^= hash >> 29;
+		buf += 8;
+		length -= 8;
+	}
+	hash = (hash ^ (string_table_word_load(buf,length) | STRING_TABLE_HASH_FOLD)) * STRING_TABLE_HASH_PRIME;
+	return hash ^ (hash >> 32);
+}
+
+/** Map the hash, rehashed by a seed if any, onto [0, size) with no division */
+static APR_INLINE apr_size_t string_table_hash_reduce(apr_uint64_t hash, apr_uint32_t seed, apr_size_t size)
+{
+	if(seed) {
+		hash = (hash ^ seed) * STRING_TABLE_HASH_PRIME;
+		hash ^= hash >> 32;
+	}
+	return (apr_size_t)(((hash & 0xFFFFFFFF) * size) >> 32);
+}
+
+/* Find the id associated with a given string by the perfect hash index */
+APT_DECLARE(apr_size_t) apt_string_table_index_find(const apt_str_table_item_t table[], apr_size_t size, const apt_str_table_index_t *index, const apt_str_t *value)
+{
+	apr_uint64_t hash;
+	apr_int32_t bucket;
+	apr_size_t slot;
+	apr_size_t id;
+	if(!index) {
+		return apt_string_table_id_find(table,size,value);
+	}
+	if(!size) {
+		return size;
+	}
+
+	hash = string_table_hash(value);
+	bucket = index->buckets[string_table_hash_reduce(hash,0,size)];
+	if(bucket < 0) {
+		slot = (apr_size_t)(-bucket - 1);
+	}
+	else {
+		slot = string_table_hash_reduce(hash,(apr_uint32_t)bucket,size);
+	}
+
+	/* the only candidate, the whole strings must still be compared */
+	id = index->ids[slot];
+	if(apt_string_compare(&table[id].value,value) == TRUE) {
+		return id;
+	}
+	return size;
+}
+
+/** Max seed to try for a bucket before giving up */
+#define STRING_TABLE_MAX_SEED 0x100000
+
+/* Generate the perfect hash index of a string table */
+APT_DECLARE(apt_str_table_index_t*) apt_string_table_index_generate(const apt_str_table_item_t table[], apr_size_t size, apr_pool_t *pool)
+{
+	apt_str_table_index_t *index;
+	apr_int32_t *buckets;
+	apr_size_t *ids;
+	apr_uint64_t *hashes;
+	apr_size_t *item_buckets;
+	apr_size_t *bucket_sizes;
+	apt_bool_t *bucket_done;
+	apr_size_t *slots;
+	apr_size_t i,j,k;
+	apr_size_t count;
+	apr_size_t bucket;
+	apr_uint32_t seed;
+
+	if(!size) {
+		return NULL;
+	}
+	for(i=0; i<size; i++) {
+		for(j=i+1; j<size; j++) {
+			if(apt_string_compare(&table[i].value,&table[j].value) == TRUE) {
+				/* duplicates cannot be told apart */
+				return NULL;
+			}
+		}
+	}
+
+	buckets = apr_palloc(pool,sizeof(apr_int32_t) * size);
+	ids = apr_palloc(pool,sizeof(apr_size_t) * size);
+	hashes = apr_palloc(pool,sizeof(apr_uint64_t) * size);
+	item_buckets = apr_palloc(pool,sizeof(apr_size_t) * size);
+	bucket_sizes = apr_pcalloc(pool,sizeof(apr_size_t) * size);
+	bucket_done = apr_pcalloc(pool,sizeof(apt_bool_t) * size);
+	slots = apr_palloc(pool,sizeof(apr_size_t) * size);
+	for(i=0; i<size; i++) {
+		buckets[i] = 0;
+		/* unused slot is marked by the (invalid) size of the table */
+		ids[i] = size;
+		hashes[i] = string_table_hash(&table[i].value);
+		item_buckets[i] = string_table_hash_reduce(hashes[i],0,size);
+		bucket_sizes[item_buckets[i]]++;
+	}
+
+	/* place the largest buckets first, while most of the slots are still free */
+	for(;;) {
+		bucket = size;
+		for(i=0; i<size; i++) {
+			if(bucket_done[i] == FALSE && bucket_sizes[i] > 1 &&
+				(bucket == size || bucket_sizes[i] > bucket_sizes[bucket])) {
+				bucket = i;
+			}
+		}
+		if(bucket == size) {
+			break;
+		}
+
+		for(seed=1; seed<STRING_TABLE_MAX_SEED; seed++) {
+			count = 0;
+			for(i=0; i<size; i++) {
+				if(item_buckets[i] != bucket) {
+					continue;
+				}
+				slots[count] = string_table_hash_reduce(hashes[i],seed,size);
+				if(ids[slots[count]] != size) {
+					break;
+				}
+				for(k=0; k<count; k++) {
+					if(slots[k] == slots[count]) {
+						break;
+					}
+				}
+				if(k < count) {
+					break;
+				}
+				count++;
+			}
+			if(count == bucket_sizes[bucket]) {
+				break;
+			}
+		}
+		if(seed == STRING_TABLE_MAX_SEED) {
+			return NULL;
+		}
+
+		count = 0;
+		for(i=0; i<size; i++) {
+			if(item_buckets[i] == bucket) {
+				ids[slots[count++]] = i;
+			}
+		}
+		buckets[bucket] = (apr_int32_t)seed;
+		bucket_done[bucket] = TRUE;
+	}
+
+	/* the rest of the buckets hold a single item each, which takes any free slot */
+	j = 0;
+	for(i=0; i<size; i++) {
+		if(bucket_sizes[item_buckets[i]] != 1) {
+			continue;
+		}
+		while(ids[j] != size) {
+			j++;
+		}
+		ids[j] = i;
+		buckets[item_buckets[i]] = -(apr_int32_t)j - 1;
+	}
+
+	index = apr_palloc(pool,sizeof(apt_str_table_index_t));
+	index->buckets = buckets;
+	index->ids = ids;
+	return index;
+}
@@ -14,15 +14,26 @@
  * limitations under the License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #ifdef WIN32
 #pragma warning(disable: 4127)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
 #endif
+#include <stdlib.h>
 #include <apr_ring.h> 
 #include <apr_thread_proc.h>
 #include <apr_thread_cond.h>
 #include <apr_portable.h>
+#include <apr_atomic.h>
 #include "apt_task.h"
 #include "apt_log.h"
+#include "apt_pool.h"
 
 /** Internal states of the task */
 typedef enum {
@@ -32,6 +43,18 @@ typedef enum {
 	TASK_STATE_TERMINATE_REQUESTED /**< termination of the task has been requested, but it's still running */
 } apt_task_state_e;
 
+/** Number of words in the CPU mask */
+#define TASK_CPU_MASK_SIZE  (TASK_MAX_CPU_COUNT / 32)
+
+/** Statistics of the task */
+typedef struct {
+	apt_histogram_t       *histograms[TASK_HISTOGRAM_COUNT]; /* histograms by type */
+	volatile apr_uint32_t  pending;       /* number of signaled, but not processed yet messages */
+	apr_time_t             start_time;    /* time the statistics have been enabled at */
+	apr_uint32_t           dump_interval; /* interval (msec) to log the statistics at */
+	volatile apr_uint32_t  dump_last;     /* time (msec since start_time) of the last dump */
+} apt_task_stats_t;
+
 struct apt_task_t {
 	APR_RING_ENTRY(apt_task_t) link;                 /* entry to parent task ring */
 	APR_RING_HEAD(apt_task_head_t, apt_task_t) head; /* head of child tasks ring */
@@ -51,9 +74,16 @@ struct apt_task_t {
 	apr_size_t           pending_on;    /* number of pending bringing-online requests */
 	apt_bool_t           running;       /* task is running (TRUE if even terminate has already been requested) */
 	apt_bool_t           auto_ready;    /* if TRUE, task is implicitly ready to process messages */
+	apt_task_stats_t    *stats;         /* statistics (NULL if disabled) */
+	apr_uint32_t        *cpu_mask;      /* CPUs to pin the thread to (NULL if not set) */
+	apr_size_t           cpu_count;     /* number of CPUs in the mask */
+	int                  priority;      /* real-time priority of the thread (0 if not set) */
+	int                  numa_node;     /* NUMA node memory of the thread is placed on (APT_NUMA_NODE_NONE if not set) */
+	apr_allocator_t     *allocator;     /* allocator of the pools created by the thread (NULL if not set) */
 };
 
 static void* APR_THREAD_FUNC apt_task_run(apr_thread_t *thread_handle, void *data);
+static void apt_task_thread_setup(apt_task_t *task);
 static APR_INLINE void apt_task_vtable_reset(apt_task_vtable_t *vtable);
 
 static apt_bool_t apt_task_core_msg_signal(apt_task_t *task, apt_task_msg_pool_t *msg_pool, apt_core_task_msg_type_e type);
@@ -109,6 +139,12 @@ APT_DECLARE(apt_task_t*) apt_task_create(
 	task->pending_off = 0;
 	task->pending_on = 0;
 	task->auto_ready = TRUE;
+	task->stats = NULL;
+	task->cpu_mask = NULL;
+	task->cpu_count = 0;
+	task->priority = 0;
+	task->numa_node = APT_NUMA_NODE_NONE;
+	task->allocator = NULL;
 	task->name = "Task";
 	return task;
 }
@@ -225,6 +261,23 @@ APT_DECLARE(apt_task_t*) apt_task_parent_get(const apt_task_t *task)
 	return task->parent_task;
 }
 
+APT_DECLARE(apt_task_t*) apt_task_child_first(const apt_task_t *task)
+{
+	if(APR_RING_EMPTY(&task->head, apt_task_t, link)) {
+		return NULL;
+	}
+	return APR_RING_FIRST(&task->head);
+}
+
+APT_DECLARE(apt_task_t*) apt_task_child_next(const apt_task_t *task, const apt_task_t *child_task)
+{
+	apt_task_t *next_task = APR_RING_NEXT(child_task, link);
+	if(next_task == APR_RING_SENTINEL(&task->head, apt_task_t, link)) {
+		return NULL;
+	}
+	return next_task;
+}
+
 APT_DECLARE(apr_pool_t*) apt_task_pool_get(const apt_task_t *task)
 {
 	return task->pool;
@@ -250,6 +303,243 @@ APT_DECLARE(const char*) apt_task_name_get(const apt_task_t *task)
 	return task->name;
 }
 
+/** Parse the list of CPUs and ranges of CPUs (e.g. "0-3,6") */
+static apt_bool_t apt_task_cpu_set_parse(const char *cpu_set, apr_uint32_t *mask)
+{
+	const char *pos = cpu_set;
+	char *end;
+	long first;
+	long last;
+	while(*pos != '\0') {
+		first = strtol(pos,&end,10);
+		if(end == pos || first < 0 || first >= TASK_MAX_CPU_COUNT) {
+			return FALSE;
+		}
+		last = first;
+		pos = end;
+		if(*pos == '-') {
+			pos++;
+			last = strtol(pos,&end,10);
+			if(end == pos || last < first || last >= TASK_MAX_CPU_COUNT) {
+				return FALSE;
+			}
+			pos = end;
+		}
+		for(; first <= last; first++) {
+			mask[first / 32] |= (apr_uint32_t)1 << (first % 32);
+		}
+
+		while(*pos == ' ') pos++;
+		if(*pos == ',') {
+			pos++;
+		}
+		else if(*pos != '\0') {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+APT_DECLARE(apt_bool_t) apt_task_affinity_set(apt_task_t *task, const char *cpu_set)
+{
+	apr_uint32_t mask[TASK_CPU_MASK_SIZE];
+	apr_size_t count = 0;
+	int i;
+	if(!cpu_set || *cpu_set == '\0') {
+		task->cpu_mask = NULL;
+		task->cpu_count = 0;
+		return TRUE;
+	}
+
+	memset(mask,0,sizeof(mask));
+	if(apt_task_cpu_set_parse(cpu_set,mask) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid CPU Set [%s] [%s]",task->name,cpu_set);
+		return FALSE;
+	}
+	for(i=0; i<TASK_MAX_CPU_COUNT; i++) {
+		if(mask[i / 32] & ((apr_uint32_t)1 << (i % 32))) {
+			count++;
+		}
+	}
+	if(!task->cpu_mask) {
+		task->cpu_mask = apr_palloc(task->pool,sizeof(mask));
+	}
+	memcpy(task->cpu_mask,mask,sizeof(mask));
+	task->cpu_count = count;
+	return TRUE;
+}
+
+APT_DECLARE(int) apt_task_affinity_cpu_get(const apt_task_t *task, apr_size_t index)
+{
+	int i;
+	if(!task->cpu_count) {
+		return -1;
+	}
+	index %= task->cpu_count;
+	for(i=0; i<TASK_MAX_CPU_COUNT; i++) {
+		if(task->cpu_mask[i / 32] & ((apr_uint32_t)1 << (i % 32))) {
+			if(!index) {
+				return i;
+			}
+			index--;
+		}
+	}
+	return -1;
+}
+
+APT_DECLARE(apt_bool_t) apt_task_numa_node_set(apt_task_t *task, int node)
+{
+	if(node >= 0 && (apr_size_t)node >= apt_numa_node_count_get()) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid NUMA Node [%s] [%d]",task->name,node);
+		return FALSE;
+	}
+	task->numa_node = node;
+	if(node >= 0 && !task->cpu_count) {
+		/* run on the CPUs of the node, unless pinned explicitly */
+		const char *cpu_set = apt_numa_node_cpu_set_get(node,task->pool);
+		if(cpu_set) {
+			apt_task_affinity_set(task,cpu_set);
+		}
+	}
+	return TRUE;
+}
+
+APT_DECLARE(int) apt_task_numa_node_get(const apt_task_t *task)
+{
+	return task->numa_node;
+}
+
+APT_DECLARE(apt_bool_t) apt_task_allocator_enable(apt_task_t *task, apr_size_t max_free)
+{
+	if(task->allocator) {
+		apr_allocator_max_free_set(task->allocator,max_free);
+		return TRUE;
+	}
+	task->allocator = apt_thread_allocator_create(max_free);
+	if(!task->allocator) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Allocator [%s]",task->name);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+APT_DECLARE(apt_bool_t) apt_task_priority_set(apt_task_t *task, int priority)
+{
+	if(priority < 0 || priority > 99) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Priority [%s] [%d]",task->name,priority);
+		return FALSE;
+	}
+	task->priority = priority;
+	return TRUE;
+}
+
+APT_DECLARE(int) apt_task_priority_get(const apt_task_t *task)
+{
+	return task->priority;
+}
+
+APT_DECLARE(apt_bool_t) apt_task_stats_enable(apt_task_t *task, apr_size_t dump_interval)
+{
+	apt_task_stats_t *stats = task->stats;
+	int i;
+	if(!stats) {
+		stats = apr_palloc(task->pool,sizeof(apt_task_stats_t));
+		for(i=0; i<TASK_HISTOGRAM_COUNT; i++) {
+			stats->histograms[i] = apt_histogram_create(task->pool);
+		}
+		stats->pending = 0;
+		stats->start_time = apr_time_now();
+		stats->dump_last = 0;
+	}
+	stats->dump_interval = (apr_uint32_t)dump_interval;
+	task->stats = stats;
+	return TRUE;
+}
+
+APT_DECLARE(const apt_histogram_t*) apt_task_histogram_get(const apt_task_t *task, apt_task_histogram_e type)
+{
+	if(!task->stats || (unsigned int)type >= TASK_HISTOGRAM_COUNT) {
+		return NULL;
+	}
+	return task->stats->histograms[type];
+}
+
+APT_DECLARE(apr_size_t) apt_task_pending_get(const apt_task_t *task)
+{
+	if(!task->stats) {
+		return 0;
+	}
+	return apr_atomic_read32(&task->stats->pending);
+}
+
+APT_DECLARE(void) apt_task_stats_reset(apt_task_t *task)
+{
+	int i;
+	if(!task->stats) {
+		return;
+	}
+	for(i=0; i<TASK_HISTOGRAM_COUNT; i++) {
+		apt_histogram_reset(task->stats->histograms[i]);
+	}
+}
+
+APT_DECLARE(void) apt_task_stats_dump(const apt_task_t *task)
+{
+	const apt_histogram_t *depth;
+	const apt_histogram_t *dwell;
+	const apt_histogram_t *process;
+	if(!task->stats) {
+		return;
+	}
+	depth = task->stats->histograms[TASK_HISTOGRAM_QUEUE_DEPTH];
+	dwell = task->stats->histograms[TASK_HISTOGRAM_DWELL_TIME];
+	process = task->stats->histograms[TASK_HISTOGRAM_PROCESS_TIME];
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Task Stats [%s] messages [%"APR_SIZE_T_FMT"] "
+		"queue depth p50/p99/max [%u/%u/%u] "
+		"dwell usec p50/p99/p99.9/max [%u/%u/%u/%u] "
+		"process usec p50/p99/p99.9/max [%u/%u/%u/%u]",
+		task->name,
+		apt_histogram_count_get(process),
+		apt_histogram_percentile_get(depth,50),
+		apt_histogram_percentile_get(depth,99),
+		apt_histogram_max_get(depth),
+		apt_histogram_percentile_get(dwell,50),
+		apt_histogram_percentile_get(dwell,99),
+		apt_histogram_percentile_get(dwell,99.9),
+		apt_histogram_max_get(dwell),
+		apt_histogram_percentile_get(process,50),
+		apt_histogram_percentile_get(process,99),
+		apt_histogram_percentile_get(process,99.9),
+		apt_histogram_max_get(process));
+}
+
+/** Record time interval (usec) clamped to the range of histogram */
+static APR_INLINE void apt_task_histogram_time_record(apt_histogram_t *histogram, apr_time_t interval)
+{
+	if(interval < 0) {
+		/* system time set backwards */
+		interval = 0;
+	}
+	else if(interval > 0xFFFFFFFF) {
+		interval = 0xFFFFFFFF;
+	}
+	apt_histogram_record(histogram,(apr_uint32_t)interval);
+}
+
+static void apt_task_stats_periodic_dump(apt_task_t *task, apr_time_t now)
+{
+	apt_task_stats_t *stats = task->stats;
+	apr_uint32_t elapsed = (apr_uint32_t)((now - stats->start_time) / 1000);
+	apr_uint32_t last = apr_atomic_add32(&stats->dump_last,0);
+	if(elapsed - last < stats->dump_interval) {
+		return;
+	}
+	/* a single thread gets to dump, if messages are processed concurrently */
+	if(apr_atomic_cas32(&stats->dump_last,elapsed,last) == last) {
+		apt_task_stats_dump(task);
+	}
+}
+
 APT_DECLARE(apt_task_msg_t*) apt_task_msg_get(apt_task_t *task)
 {
 	if(task->msg_pool) {
@@ -260,13 +550,22 @@ APT_DECLARE(apt_task_msg_t*) apt_task_msg_get(apt_task_t *task)
 
 APT_DECLARE(apt_bool_t) apt_task_msg_signal(apt_task_t *task, apt_task_msg_t *msg)
 {
+	apt_task_stats_t *stats = task->stats;
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Signal Message to [%s] [" APT_PTR_FMT ";%d;%d]",
 		task->name, msg, msg->type, msg->sub_type);
+	if(stats) {
+		/* account the message before it's signaled, it may be processed right away */
+		msg->signal_time = apr_time_now();
+		apr_atomic_inc32(&stats->pending);
+	}
 	if(task->vtable.signal_msg) {
 		if(task->vtable.signal_msg(task,msg) == TRUE) {
 			return TRUE;
 		}
 	}
+	if(stats) {
+		apr_atomic_add32(&stats->pending,(apr_uint32_t)-1);
+	}
 
 	apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Signal Task Message [%s] [0x%x;%d;%d]",
 		task->name, msg, msg->type, msg->sub_type);
@@ -332,8 +631,17 @@ static apt_bool_t apt_core_task_msg_process(apt_task_t *task, apt_task_msg_t *ms
 APT_DECLARE(apt_bool_t) apt_task_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
 	apt_bool_t status = FALSE;
+	apt_task_stats_t *stats = task->stats;
+	apr_time_t start = 0;
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Process Message [%s] [" APT_PTR_FMT ";%d;%d]",
 		task->name, msg, msg->type, msg->sub_type);
+	if(stats && msg->signal_time) {
+		/* the message has been accounted as signaled */
+		start = apr_time_now();
+		apt_histogram_record(stats->histograms[TASK_HISTOGRAM_QUEUE_DEPTH],
+			apr_atomic_add32(&stats->pending,(apr_uint32_t)-1));
+		apt_task_histogram_time_record(stats->histograms[TASK_HISTOGRAM_DWELL_TIME],start - msg->signal_time);
+	}
 	if(msg->type == TASK_MSG_CORE) {
 		status = apt_core_task_msg_process(task,msg);
 	}
@@ -342,7 +650,14 @@ APT_DECLARE(apt_bool_t) apt_task_msg_process(apt_task_t *task, apt_task_msg_t *m
 			status = task->vtable.process_msg(task,msg);
 		}
 	}
-	
+
+	if(start) {
+		apr_time_t now = apr_time_now();
+		apt_task_histogram_time_record(stats->histograms[TASK_HISTOGRAM_PROCESS_TIME],now - start);
+		if(stats->dump_interval) {
+			apt_task_stats_periodic_dump(task,now);
+		}
+	}
 	apt_task_msg_release(msg);
 	return status;
 }
@@ -568,6 +883,7 @@ static void* APR_THREAD_FUNC apt_task_run(apr_thread_t *thread_handle, void *dat
 #if APR_HAS_SETTHREADNAME
 	apr_thread_name_set(task->name);
 #endif
+	apt_task_thread_setup(task);
 	/* raise pre-run event */
 	if(task->vtable.on_pre_run) {
 		task->vtable.on_pre_run(task);
@@ -602,6 +918,72 @@ static void* APR_THREAD_FUNC apt_task_run(apr_thread_t *thread_handle, void *dat
 	return NULL;
 }
 
+/** Apply CPU affinity, priority and allocator to the calling (task) thread */
+static void apt_task_thread_setup(apt_task_t *task)
+{
+	if(task->allocator) {
+		apt_thread_allocator_set(task->allocator);
+	}
+	if(task->numa_node != APT_NUMA_NODE_NONE) {
+		apt_numa_memory_policy_set(task->numa_node);
+	}
+#if defined(__linux__)
+	if(task->cpu_count) {
+		cpu_set_t cpu_set;
+		int i;
+		CPU_ZERO(&cpu_set);
+		for(i=0; i<TASK_MAX_CPU_COUNT && i<CPU_SETSIZE; i++) {
+			if(task->cpu_mask[i / 32] & ((apr_uint32_t)1 << (i % 32))) {
+				CPU_SET(i,&cpu_set);
+			}
+		}
+		if(pthread_setaffinity_np(pthread_self(),sizeof(cpu_set),&cpu_set) != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set CPU Affinity [%s]",task->name);
+		}
+	}
+	if(task->priority > 0) {
+		struct sched_param param;
+		int rv;
+		memset(&param,0,sizeof(param));
+		param.sched_priority = task->priority;
+		rv = pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+		if(rv != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set SCHED_FIFO Priority [%s] [%d] errno [%d]",
+				task->name,task->priority,rv);
+		}
+	}
+#elif defined(WIN32)
+	if(task->cpu_count) {
+		DWORD_PTR mask = 0;
+		int i;
+		for(i=0; i<TASK_MAX_CPU_COUNT && i<(int)(sizeof(DWORD_PTR) * 8); i++) {
+			if(task->cpu_mask[i / 32] & ((apr_uint32_t)1 << (i % 32))) {
+				mask |= (DWORD_PTR)1 << i;
+			}
+		}
+		if(!mask || SetThreadAffinityMask(GetCurrentThread(),mask) == 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set CPU Affinity [%s]",task->name);
+		}
+	}
+	if(task->priority > 0) {
+		int level = THREAD_PRIORITY_ABOVE_NORMAL;
+		if(task->priority >= 90) {
+			level = THREAD_PRIORITY_TIME_CRITICAL;
+		}
+		else if(task->priority >= 50) {
+			level = THREAD_PRIORITY_HIGHEST;
+		}
+		if(SetThreadPriority(GetCurrentThread(),level) == 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set Thread Priority [%s] [%d]",task->name,task->priority);
+		}
+	}
+#else
+	if(task->cpu_count || task->priority > 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"CPU Affinity and Priority Not Supported [%s]",task->name);
+	}
+#endif
+}
+
 static APR_INLINE void apt_task_vtable_reset(apt_task_vtable_t *vtable)
 {
 	vtable->destroy = NULL;
@@ -15,8 +15,12 @@
  */
 
 #include <stdlib.h>
+#include <apr_atomic.h>
 #include "apt_task_msg.h"
 
+/** Default max number of free messages kept by a dynamic pool */
+#define DYNAMIC_POOL_MAX_FREE_COUNT 64
+
 /** Abstract pool of task messages to allocate task messages from */
 struct apt_task_msg_pool_t {
 	void (*destroy)(apt_task_msg_pool_t *pool);
@@ -26,60 +30,303 @@ struct apt_task_msg_pool_t {
 
 	void       *obj;
 	apr_pool_t *pool;
+
+	/** Statistics counters */
+	volatile apr_uint32_t acquired;
+	volatile apr_uint32_t released;
+	volatile apr_uint32_t allocated;
+	volatile apr_uint32_t freed;
+	volatile apr_uint32_t used;
+	volatile apr_uint32_t max_used;
 };
 
 
-/** Dynamic allocation of messages (no actual pool exist)*/
-typedef struct apt_msg_pool_dynamic_t apt_msg_pool_dynamic_t;
+/** Slot of the freelist */
+typedef struct {
+	/** Sequence number: equals the write index when free, the write index + 1 when published */
+	volatile apr_uint32_t  sequence;
+	/** Free message */
+	apt_task_msg_t        *task_msg;
+} apt_msg_freelist_slot_t;
+
+/** Lock-free bounded freelist of messages (any thread may acquire and release) */
+typedef struct {
+	/** Array of (mask + 1) slots */
+	apt_msg_freelist_slot_t *slots;
+	/** Capacity - 1 (capacity is a power of two) */
+	apr_uint32_t             mask;
+	/** Free-running write index */
+	volatile apr_uint32_t    head;
+	/** Free-running read index */
+	volatile apr_uint32_t    tail;
+} apt_msg_freelist_t;
+
+/** Load value with full barrier (apr_atomic_read32() is not guaranteed to be fenced) */
+static APR_INLINE apr_uint32_t apt_msg_load(const volatile apr_uint32_t *value)
+{
+	return apr_atomic_add32((volatile apr_uint32_t*)value,0);
+}
+
+static void apt_msg_freelist_init(apt_msg_freelist_t *freelist, apr_size_t capacity, apr_pool_t *pool)
+{
+	apr_uint32_t size = 1;
+	apr_uint32_t i;
+	freelist->head = 0;
+	freelist->tail = 0;
+	if(!capacity) {
+		/* nothing to keep */
+		freelist->slots = NULL;
+		freelist->mask = 0;
+		return;
+	}
+	while(size < capacity) {
+		size <<= 1;
+	}
+	freelist->slots = apr_palloc(pool,sizeof(apt_msg_freelist_slot_t) * size);
+	for(i=0; i<size; i++) {
+		freelist->slots[i].sequence = i;
+		freelist->slots[i].task_msg = NULL;
+	}
+	freelist->mask = size - 1;
+}
+
+static apt_bool_t apt_msg_freelist_push(apt_msg_freelist_t *freelist, apt_task_msg_t *task_msg)
+{
+	apt_msg_freelist_slot_t *slot;
+	apr_uint32_t sequence;
+	apr_uint32_t claimed;
+	apr_uint32_t head;
+	if(!freelist->slots) {
+		return FALSE;
+	}
+	head = apt_msg_load(&freelist->head);
+	for(;;) {
+		slot = &freelist->slots[head & freelist->mask];
+		sequence = apt_msg_load(&slot->sequence);
+		if(sequence == head) {
+			claimed = apr_atomic_cas32(&freelist->head,head + 1,head);
+			if(claimed == head) {
+				break;
+			}
+			head = claimed;
+		}
+		else if((apr_int32_t)(sequence - head) < 0) {
+			/* full */
+			return FALSE;
+		}
+		else {
+			head = apt_msg_load(&freelist->head);
+		}
+	}
 
-struct apt_msg_pool_dynamic_t {
-	apr_size_t size;
+	slot->task_msg = task_msg;
+	apr_atomic_xchg32(&slot->sequence,head + 1);
+	return TRUE;
+}
+
+static apt_task_msg_t* apt_msg_freelist_pop(apt_msg_freelist_t *freelist)
+{
+	apt_msg_freelist_slot_t *slot;
+	apt_task_msg_t *task_msg;
+	apr_uint32_t sequence;
+	apr_uint32_t claimed;
+	apr_uint32_t tail;
+	if(!freelist->slots) {
+		return NULL;
+	}
+	tail = apt_msg_load(&freelist->tail);
+	for(;;) {
+		slot = &freelist->slots[tail & freelist->mask];
+		sequence = apt_msg_load(&slot->sequence);
+		if(sequence == tail + 1) {
+			/* the slot is published, try to claim it */
+			claimed = apr_atomic_cas32(&freelist->tail,tail + 1,tail);
+			if(claimed == tail) {
+				break;
+			}
+			tail = claimed;
+		}
+		else if((apr_int32_t)(sequence - (tail + 1)) < 0) {
+			/* empty, or the slot is claimed but not published yet */
+			return NULL;
+		}
+		else {
+			/* another consumer claimed the slot, retry with the current index */
+			tail = apt_msg_load(&freelist->tail);
+		}
+	}
+
+	task_msg = slot->task_msg;
+	/* release the slot for the next lap */
+	apr_atomic_xchg32(&slot->sequence,tail + freelist->mask + 1);
+	return task_msg;
+}
+
+
+/** Allocation of messages backed by a freelist */
+typedef struct apt_msg_pool_cached_t apt_msg_pool_cached_t;
+
+struct apt_msg_pool_cached_t {
+	/** Size of a message */
+	apr_size_t          size;
+	/** Free heap allocated messages ready for reuse, the capacity is the high-water mark */
+	apt_msg_freelist_t  freelist;
+	/** Free preallocated messages, there is room for all of them */
+	apt_msg_freelist_t  static_freelist;
+	/** Preallocated messages (static pool), NULL otherwise */
+	char               *block;
+	/** Size of the block of preallocated messages */
+	apr_size_t          block_size;
 };
 
-static apt_task_msg_t* dynamic_pool_acquire_msg(apt_task_msg_pool_t *task_msg_pool)
+static APR_INLINE apt_bool_t cached_pool_msg_is_preallocated(const apt_msg_pool_cached_t *cached_pool, const apt_task_msg_t *task_msg)
+{
+	const char *ptr = (const char*)task_msg;
+	return (cached_pool->block && ptr >= cached_pool->block && ptr < cached_pool->block + cached_pool->block_size) ? TRUE : FALSE;
+}
+
+static apt_task_msg_t* cached_pool_acquire_msg(apt_task_msg_pool_t *task_msg_pool)
 {
-	apt_msg_pool_dynamic_t *dynamic_pool = task_msg_pool->obj;
-	apt_task_msg_t *task_msg = malloc(dynamic_pool->size);
+	apt_msg_pool_cached_t *cached_pool = task_msg_pool->obj;
+	apr_uint32_t used;
+	apr_uint32_t max_used;
+	apt_task_msg_t *task_msg = NULL;
+	if(cached_pool->block) {
+		task_msg = apt_msg_freelist_pop(&cached_pool->static_freelist);
+	}
+	if(!task_msg) {
+		task_msg = apt_msg_freelist_pop(&cached_pool->freelist);
+	}
+	if(!task_msg) {
+		/* no free message left, extend the pool */
+		task_msg = malloc(cached_pool->size);
+		if(!task_msg) {
+			return NULL;
+		}
+		apr_atomic_inc32(&task_msg_pool->allocated);
+	}
 	task_msg->msg_pool = task_msg_pool;
 	task_msg->type = TASK_MSG_USER;
 	task_msg->sub_type = 0;
+	task_msg->signal_time = 0;
+
+	apr_atomic_inc32(&task_msg_pool->acquired);
+	used = apr_atomic_inc32(&task_msg_pool->used) + 1;
+	max_used = apt_msg_load(&task_msg_pool->max_used);
+	while(used > max_used) {
+		apr_uint32_t prev = apr_atomic_cas32(&task_msg_pool->max_used,used,max_used);
+		if(prev == max_used) {
+			break;
+		}
+		max_used = prev;
+	}
 	return task_msg;
 }
 
-static void dynamic_pool_release_msg(apt_task_msg_t *task_msg)
+static void cached_pool_release_msg(apt_task_msg_t *task_msg)
 {
-	if(task_msg) {
+	apt_task_msg_pool_t *task_msg_pool;
+	apt_msg_pool_cached_t *cached_pool;
+	if(!task_msg) {
+		return;
+	}
+	task_msg_pool = task_msg->msg_pool;
+	cached_pool = task_msg_pool->obj;
+	apr_atomic_inc32(&task_msg_pool->released);
+	apr_atomic_dec32(&task_msg_pool->used);
+	if(cached_pool_msg_is_preallocated(cached_pool,task_msg) == TRUE) {
+		apt_msg_freelist_push(&cached_pool->static_freelist,task_msg);
+		return;
+	}
+	if(apt_msg_freelist_push(&cached_pool->freelist,task_msg) == TRUE) {
+		return;
+	}
+
+	/* above the high-water mark */
+	free(task_msg);
+	apr_atomic_inc32(&task_msg_pool->freed);
+}
+
+static void cached_pool_free_msgs(apt_task_msg_pool_t *task_msg_pool)
+{
+	apt_msg_pool_cached_t *cached_pool = task_msg_pool->obj;
+	apt_task_msg_t *task_msg;
+	while((task_msg = apt_msg_freelist_pop(&cached_pool->freelist)) != NULL) {
+		if(cached_pool_msg_is_preallocated(cached_pool,task_msg) == TRUE) {
+			/* allocated from the pool along with the block */
+			continue;
+		}
 		free(task_msg);
+		apr_atomic_inc32(&task_msg_pool->freed);
 	}
 }
 
-static void dynamic_pool_destroy(apt_task_msg_pool_t *task_msg_pool)
+static apr_status_t cached_pool_cleanup(void *obj)
 {
-	/* nothing to do */
+	apt_task_msg_pool_t *task_msg_pool = obj;
+	cached_pool_free_msgs(task_msg_pool);
+	return APR_SUCCESS;
 }
 
-APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_dynamic(apr_size_t msg_size, apr_pool_t *pool)
+static void cached_pool_destroy(apt_task_msg_pool_t *task_msg_pool)
+{
+	apr_pool_cleanup_kill(task_msg_pool->pool,task_msg_pool,cached_pool_cleanup);
+	cached_pool_free_msgs(task_msg_pool);
+}
+
+static apt_task_msg_pool_t* apt_task_msg_pool_create_cached(apr_size_t msg_size, apr_size_t prealloc_count, apr_size_t max_free_count, apr_pool_t *pool)
 {
+	apr_size_t i;
 	apt_task_msg_pool_t *task_msg_pool = apr_palloc(pool,sizeof(apt_task_msg_pool_t));
-	apt_msg_pool_dynamic_t *dynamic_pool = apr_palloc(pool,sizeof(apt_msg_pool_dynamic_t));
-	dynamic_pool->size = msg_size + sizeof(apt_task_msg_t) - 1;
+	apt_msg_pool_cached_t *cached_pool = apr_palloc(pool,sizeof(apt_msg_pool_cached_t));
+	cached_pool->size = APR_ALIGN_DEFAULT(msg_size + sizeof(apt_task_msg_t) - 1);
+	cached_pool->block = NULL;
+	cached_pool->block_size = 0;
+	apt_msg_freelist_init(&cached_pool->static_freelist,0,pool);
+	apt_msg_freelist_init(&cached_pool->freelist,max_free_count,pool);
 
 	task_msg_pool->pool = pool;
-	task_msg_pool->obj = dynamic_pool;
-	task_msg_pool->acquire_msg = dynamic_pool_acquire_msg;
-	task_msg_pool->release_msg = dynamic_pool_release_msg;
-	task_msg_pool->destroy = dynamic_pool_destroy;
+	task_msg_pool->obj = cached_pool;
+	task_msg_pool->acquire_msg = cached_pool_acquire_msg;
+	task_msg_pool->release_msg = cached_pool_release_msg;
+	task_msg_pool->destroy = cached_pool_destroy;
+	task_msg_pool->acquired = 0;
+	task_msg_pool->released = 0;
+	task_msg_pool->allocated = 0;
+	task_msg_pool->freed = 0;
+	task_msg_pool->used = 0;
+	task_msg_pool->max_used = 0;
+
+	if(prealloc_count) {
+		cached_pool->block_size = cached_pool->size * prealloc_count;
+		cached_pool->block = apr_palloc(pool,cached_pool->block_size);
+		apt_msg_freelist_init(&cached_pool->static_freelist,prealloc_count,pool);
+		for(i=0; i<prealloc_count; i++) {
+			apt_msg_freelist_push(&cached_pool->static_freelist,(apt_task_msg_t*)(cached_pool->block + i * cached_pool->size));
+		}
+	}
+
+	apr_pool_cleanup_register(pool,task_msg_pool,cached_pool_cleanup,apr_pool_cleanup_null);
 	return task_msg_pool;
 }
 
+APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_dynamic(apr_size_t msg_size, apr_pool_t *pool)
+{
+	return apt_task_msg_pool_create_cached(msg_size,0,DYNAMIC_POOL_MAX_FREE_COUNT,pool);
+}
 
-/** Static allocation of messages from message pool (not implemented yet) */
 APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_static(apr_size_t msg_size, apr_size_t pool_size, apr_pool_t *pool)
 {
-	return NULL;
+	if(!pool_size) {
+		return NULL;
+	}
+	return apt_task_msg_pool_create_cached(msg_size,pool_size,pool_size,pool);
 }
 
-
+APT_DECLARE(apt_task_msg_pool_t*) apt_task_msg_pool_create_ex(apr_size_t msg_size, apr_size_t prealloc_count, apr_size_t max_free_count, apr_pool_t *pool)
+{
+	return apt_task_msg_pool_create_cached(msg_size,prealloc_count,max_free_count,pool);
+}
 
 APT_DECLARE(void) apt_task_msg_pool_destroy(apt_task_msg_pool_t *msg_pool)
 {
@@ -88,6 +335,15 @@ APT_DECLARE(void) apt_task_msg_pool_destroy(apt_task_msg_pool_t *msg_pool)
 	}
 }
 
+APT_DECLARE(void) apt_task_msg_pool_stats_get(const apt_task_msg_pool_t *msg_pool, apt_task_msg_pool_stats_t *stats)
+{
+	stats->acquired = apt_msg_load(&msg_pool->acquired);
+	stats->released = apt_msg_load(&msg_pool->released);
+	stats->allocated = apt_msg_load(&msg_pool->allocated);
+	stats->freed = apt_msg_load(&msg_pool->freed);
+	stats->max_used = apt_msg_load(&msg_pool->max_used);
+}
+
 APT_DECLARE(apt_task_msg_t*) apt_task_msg_acquire(apt_task_msg_pool_t *task_msg_pool)
 {
 	if(!task_msg_pool->acquire_msg)
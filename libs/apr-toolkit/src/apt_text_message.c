@@ -85,18 +85,12 @@ APT_DECLARE(apt_header_field_t*) apt_header_field_parse(apt_text_stream_t *strea
 		}
 	}
 
-	header_field = apt_header_field_alloc(pool);
-	/* copy parsed name of the header field */
-	header_field->name.length = pair.name.length;
-	header_field->name.buf = apr_palloc(pool, pair.name.length + 1);
+	/* store parsed name and value inline in the header field */
+	header_field = apt_header_field_inline_alloc(pair.name.length, pair.value.length + folding_length, pool);
 	if(pair.name.length) {
 		memcpy(header_field->name.buf, pair.name.buf, pair.name.length);
 	}
-	header_field->name.buf[header_field->name.length] = '\0';
 
-	/* copy parsed value of the header field */
-	header_field->value.length = pair.value.length + folding_length;
-	header_field->value.buf = apr_palloc(pool, header_field->value.length + 1);
 	if(pair.value.length) {
 		memcpy(header_field->value.buf, pair.value.buf, pair.value.length);
 	}
@@ -112,7 +106,6 @@ APT_DECLARE(apt_header_field_t*) apt_header_field_parse(apt_text_stream_t *strea
 			pos += line->length;
 		}
 	}
-	header_field->value.buf[header_field->value.length] = '\0';
 
 	return header_field;
 }
@@ -234,6 +227,7 @@ APT_DECLARE(apt_message_parser_t*) apt_message_parser_create(void *obj, const ap
 	parser->context.message = NULL;
 	parser->context.body = NULL;
 	parser->context.header = NULL;
+	parser->context.pool = NULL;
 	parser->content_length = 0;
 	parser->stage = APT_MESSAGE_STAGE_START_LINE;
 	parser->skip_lf = FALSE;
@@ -281,7 +275,8 @@ APT_DECLARE(apt_message_status_e) apt_message_parser_run(apt_message_parser_t *p
 
 		if(parser->stage == APT_MESSAGE_STAGE_HEADER) {
 			/* read header section */
-			apt_bool_t res = apt_header_section_parse(parser->context.header,stream,parser->pool);
+			apt_bool_t res = apt_header_section_parse(parser->context.header,stream,
+								parser->context.pool ? parser->context.pool : parser->pool);
 			if(parser->verbose == TRUE) {
 				apr_size_t length = stream->pos - pos;
 				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Parsed Message Header [%"APR_SIZE_T_FMT" bytes]\n%.*s",
@@ -304,7 +299,10 @@ APT_DECLARE(apt_message_status_e) apt_message_parser_run(apt_message_parser_t *p
 			if(parser->context.body && parser->context.body->length) {
 				apt_str_t *body = parser->context.body;
 				parser->content_length = body->length;
-				body->buf = apr_palloc(parser->pool,parser->content_length+1);
+				if(!body->buf) {
+					/* unless the header handler has provided a buffer to read the body into */
+					body->buf = apr_palloc(parser->context.pool ? parser->context.pool : parser->pool,parser->content_length+1);
+				}
 				body->buf[parser->content_length] = '\0';
 				body->length = 0;
 				parser->stage = APT_MESSAGE_STAGE_BODY;
@@ -352,6 +350,38 @@ APT_DECLARE(void) apt_message_parser_verbose_set(apt_message_parser_t *parser, a
 	parser->verbose = verbose;
 }
 
+/** Get the remaining part of the message body being parsed */
+APT_DECLARE(apt_bool_t) apt_message_parser_body_buffer_get(apt_message_parser_t *parser, char **buf, apr_size_t *length)
+{
+	apt_str_t *body = parser->context.body;
+	/* the <LF> left from the header section is to be skipped first */
+	if(parser->stage != APT_MESSAGE_STAGE_BODY || parser->skip_lf == TRUE || !body || !body->buf) {
+		return FALSE;
+	}
+	*buf = body->buf + body->length;
+	*length = parser->content_length - body->length;
+	return TRUE;
+}
+
+/** Account the data directly received into the body buffer */
+APT_DECLARE(void) apt_message_parser_body_buffer_fill(apt_message_parser_t *parser, apr_size_t length)
+{
+	apt_str_t *body = parser->context.body;
+	if(parser->stage != APT_MESSAGE_STAGE_BODY || !body || !body->buf) {
+		return;
+	}
+	if(length > parser->content_length - body->length) {
+		length = parser->content_length - body->length;
+	}
+	if(parser->verbose == TRUE) {
+		apr_size_t masked_length = length;
+		const char *masked_data = apt_log_data_mask(body->buf + body->length,&masked_length,parser->pool);
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Parsed Message Body [%"APR_SIZE_T_FMT" bytes]\n%.*s",
+				length, masked_length, masked_data);
+	}
+	body->length += length;
+}
+
 
 /** Create message generator */
 APT_DECLARE(apt_message_generator_t*) apt_message_generator_create(void *obj, const apt_message_generator_vtable_t *vtable, apr_pool_t *pool)
@@ -363,6 +393,7 @@ APT_DECLARE(apt_message_generator_t*) apt_message_generator_create(void *obj, co
 	generator->context.message = NULL;
 	generator->context.header = NULL;
 	generator->context.body = NULL;
+	generator->context.pool = NULL;
 	generator->content_length = 0;
 	generator->stage = APT_MESSAGE_STAGE_START_LINE;
 	generator->verbose = FALSE;
@@ -16,54 +16,167 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <apr_uuid.h>
 #include "apt_text_stream.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define APT_TEXT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+/* AVX2 is not assumed at compile-time, but selected by CPU capabilities */
+#define APT_TEXT_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define APT_TEXT_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define TOKEN_TRUE  "true"
 #define TOKEN_FALSE "false"
 #define TOKEN_TRUE_LENGTH  (sizeof(TOKEN_TRUE)-1)
 #define TOKEN_FALSE_LENGTH (sizeof(TOKEN_FALSE)-1)
 
 
-/** Navigate through the lines of the text stream (message) */
-APT_DECLARE(apt_bool_t) apt_text_line_read(apt_text_stream_t *stream, apt_str_t *line)
+/** Find the end of line (CR or LF) within [pos, end), return end if not found */
+typedef const char* (*apt_text_eol_find_f)(const char *pos, const char *end);
+
+static const char* apt_text_eol_select(const char *pos, const char *end);
+
+/** End of line search, resolved by CPU capabilities on the first use */
+static apt_text_eol_find_f apt_text_eol_find = apt_text_eol_select;
+
+/** Index of the lowest set bit of a non-zero mask */
+static APR_INLINE unsigned int apt_text_mask_scan(apr_uint32_t mask)
 {
-	char *pos = stream->pos;
-	apt_bool_t status = FALSE;
-	line->length = 0;
-	line->buf = pos;
-	/* while not end of stream */
-	while(pos < stream->end) {
-		if(*pos == APT_TOKEN_CR) {
-			/* end of line detected */
-			line->length = pos - line->buf;
-			pos++;
-			if(pos < stream->end && *pos == APT_TOKEN_LF) {
-				pos++;
-			}
-			status = TRUE;
-			break;
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index,mask);
+	return (unsigned int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+	return (unsigned int)__builtin_ctz(mask);
+#else
+	unsigned int index = 0;
+	while(!(mask & 1)) {
+		mask >>= 1;
+		index++;
+	}
+	return index;
+#endif
+}
+
+static const char* apt_text_eol_scalar_find(const char *pos, const char *end)
+{
+	while(pos < end && *pos != APT_TOKEN_CR && *pos != APT_TOKEN_LF) pos++;
+	return pos;
+}
+
+#ifdef APT_TEXT_SSE2
+static const char* apt_text_eol_sse2_find(const char *pos, const char *end)
+{
+	const __m128i cr = _mm_set1_epi8(APT_TOKEN_CR);
+	const __m128i lf = _mm_set1_epi8(APT_TOKEN_LF);
+	while(end - pos >= 16) {
+		__m128i x = _mm_loadu_si128((const __m128i*)pos);
+		apr_uint32_t mask = (apr_uint32_t)_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(x,cr),_mm_cmpeq_epi8(x,lf)));
+		if(mask) {
+			return pos + apt_text_mask_scan(mask);
 		}
-		else if(*pos == APT_TOKEN_LF) {
-			/* end of line detected */
-			line->length = pos - line->buf;
-			pos++;
-			status = TRUE;
-			break;
+		pos += 16;
+	}
+	return apt_text_eol_scalar_find(pos,end);
+}
+#endif
+
+#ifdef APT_TEXT_AVX2
+__attribute__((target("avx2")))
+static const char* apt_text_eol_avx2_find(const char *pos, const char *end)
+{
+	const __m256i cr = _mm256_set1_epi8(APT_TOKEN_CR);
+	const __m256i lf = _mm256_set1_epi8(APT_TOKEN_LF);
+	while(end - pos >= 32) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)pos);
+		apr_uint32_t mask = (apr_uint32_t)_mm256_movemask_epi8(
+			_mm256_or_si256(_mm256_cmpeq_epi8(x,cr),_mm256_cmpeq_epi8(x,lf)));
+		if(mask) {
+			return pos + apt_text_mask_scan(mask);
 		}
-		pos++;
+		pos += 32;
 	}
+	return apt_text_eol_sse2_find(pos,end);
+}
+#endif
 
-	if(status == TRUE) {
-		/* advance stream pos */
-		stream->pos = pos;
+#ifdef APT_TEXT_NEON
+static const char* apt_text_eol_neon_find(const char *pos, const char *end)
+{
+	const uint8x16_t cr = vdupq_n_u8(APT_TOKEN_CR);
+	const uint8x16_t lf = vdupq_n_u8(APT_TOKEN_LF);
+	while(end - pos >= 16) {
+		uint8x16_t x = vld1q_u8((const uint8_t*)pos);
+		uint8x16_t eq = vorrq_u8(vceqq_u8(x,cr),vceqq_u8(x,lf));
+		/* narrow to 4 bits per character */
+		uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq),4)),0);
+		if(mask) {
+			if(mask & 0xFFFFFFFF) {
+				return pos + apt_text_mask_scan((apr_uint32_t)mask) / 4;
+			}
+			return pos + 8 + apt_text_mask_scan((apr_uint32_t)(mask >> 32)) / 4;
+		}
+		pos += 16;
 	}
-	else {
+	return apt_text_eol_scalar_find(pos,end);
+}
+#endif
+
+/** Resolve the end of line search by CPU capabilities, then run it */
+static const char* apt_text_eol_select(const char *pos, const char *end)
+{
+	apt_text_eol_find_f eol_find = apt_text_eol_scalar_find;
+#if defined(APT_TEXT_NEON)
+	eol_find = apt_text_eol_neon_find;
+#elif defined(APT_TEXT_SSE2)
+	eol_find = apt_text_eol_sse2_find;
+#endif
+#ifdef APT_TEXT_AVX2
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		eol_find = apt_text_eol_avx2_find;
+	}
+#endif
+	apt_text_eol_find = eol_find;
+	return eol_find(pos,end);
+}
+
+/** Navigate through the lines of the text stream (message) */
+APT_DECLARE(apt_bool_t) apt_text_line_read(apt_text_stream_t *stream, apt_str_t *line)
+{
+	char *pos = stream->pos;
+	char *eol = (char*)apt_text_eol_find(pos,stream->end);
+	line->buf = pos;
+	line->length = eol - pos;
+	if(eol == stream->end) {
 		/* end of stream is reached, do not advance stream pos, but set is_eos flag */
 		stream->is_eos = TRUE;
-		line->length = pos - line->buf;
+		return FALSE;
+	}
+
+	/* end of line detected, advance stream pos */
+	pos = eol + 1;
+	if(*eol == APT_TOKEN_CR && pos < stream->end && *pos == APT_TOKEN_LF) {
+		pos++;
 	}
-	return status;
+	stream->pos = pos;
+	return TRUE;
 }
 
 /** To be used to navigate through the header fields (name:value pairs) of the text stream (message) 
@@ -81,68 +194,52 @@ APT_DECLARE(apt_bool_t) apt_text_line_read(apt_text_stream_t *stream, apt_str_t
 APT_DECLARE(apt_bool_t) apt_text_header_read(apt_text_stream_t *stream, apt_pair_t *pair)
 {
 	char *pos = stream->pos;
-	apt_bool_t status = FALSE;
+	char *eol = (char*)apt_text_eol_find(pos,stream->end);
+	const char *separator;
 	apt_string_reset(&pair->name);
 	apt_string_reset(&pair->value);
-	/* while not end of stream */
-	while(pos < stream->end) {
-		if(*pos == APT_TOKEN_CR) {
-			/* end of line detected */
-			if(pair->value.buf) {
-				/* set length of the value */
-				pair->value.length = pos - pair->value.buf;
-			}
-			pos++;
-			if(pos < stream->end && *pos == APT_TOKEN_LF) {
-				pos++;
-			}
-			status = TRUE;
-			break;
-		}
-		else if(*pos == APT_TOKEN_LF) {
-			/* end of line detected */
-			if(pair->value.buf) {
-				/* set length of the value */
-				pair->value.length = pos - pair->value.buf;
-			}
-			pos++;
-			status = TRUE;
-			break;
-		}
-		else if(!pair->name.length) {
-			/* skip preceding white spaces (SHOULD NOT be any WSP, though) and read name */
-			if(!pair->name.buf && apt_text_is_wsp(*pos) == FALSE) {
-				pair->name.buf = pos;
-			}
-			if(*pos == ':') {
-				/* set length of the name */
-				pair->name.length = pos - pair->name.buf;
-			}
-		}
-		else if(!pair->value.length) {
+
+	/* skip preceding white spaces (SHOULD NOT be any WSP, though) and read name */
+	while(pos < eol && apt_text_is_wsp(*pos) == TRUE) pos++;
+	if(pos < eol) {
+		pair->name.buf = pos;
+		/* the name is not empty, so the separator is searched after its first character */
+		separator = memchr(pos + 1,':',eol - pos - 1);
+		if(separator) {
+			/* set length of the name */
+			pair->name.length = separator - pair->name.buf;
+
 			/* skip preceding white spaces and read value */
-			if(!pair->value.buf && apt_text_is_wsp(*pos) == FALSE) {
+			pos = (char*)separator + 1;
+			while(pos < eol && apt_text_is_wsp(*pos) == TRUE) pos++;
+			if(pos < eol) {
 				pair->value.buf = pos;
+				if(eol < stream->end) {
+					/* set length of the value */
+					pair->value.length = eol - pos;
+				}
 			}
 		}
-		pos++;
 	}
 
-	if(status == TRUE) {
-		/* advance stream pos regardless it's a valid header or not */
-		stream->pos = pos;
-		
-		/* if length == 0 && buf => header is malformed */
-		if(!pair->name.length && pair->name.buf) {
-			status = FALSE;
-		}
-	}
-	else {
+	if(eol == stream->end) {
 		/* end of stream is reached, do not advance stream pos, but set is_eos flag */
 		stream->is_eos = TRUE;
+		return FALSE;
+	}
+
+	/* end of line detected, advance stream pos regardless it's a valid header or not */
+	pos = eol + 1;
+	if(*eol == APT_TOKEN_CR && pos < stream->end && *pos == APT_TOKEN_LF) {
+		pos++;
 	}
+	stream->pos = pos;
 
-	return status;
+	/* if length == 0 && buf => header is malformed */
+	if(!pair->name.length && pair->name.buf) {
+		return FALSE;
+	}
+	return TRUE;
 }
 
 
@@ -21,12 +21,39 @@
 #include "apt_timer_queue.h"
 #include "apt_log.h"
 
+/*
+ * Timers are kept in a hierarchical timing wheel. The first (root) level has
+ * a slot per millisecond, each slot of an upper level spans the whole lower
+ * level. When the root level wraps around, the next slot of the upper level
+ * is cascaded down. 8 + 4 * 6 bits cover the whole 32-bit range of timeouts,
+ * thus set and kill are O(1) regardless of the number of timers.
+ */
+#define TIMER_WHEEL_ROOT_BITS    8
+#define TIMER_WHEEL_ROOT_SIZE    (1 << TIMER_WHEEL_ROOT_BITS)
+#define TIMER_WHEEL_ROOT_MASK    (TIMER_WHEEL_ROOT_SIZE - 1)
+#define TIMER_WHEEL_LEVEL_BITS   6
+#define TIMER_WHEEL_LEVEL_SIZE   (1 << TIMER_WHEEL_LEVEL_BITS)
+#define TIMER_WHEEL_LEVEL_MASK   (TIMER_WHEEL_LEVEL_SIZE - 1)
+#define TIMER_WHEEL_LEVEL_COUNT  5
+
+/** Offset of the slot index of the specified upper level (1..4) in time */
+#define TIMER_WHEEL_SHIFT(level) (TIMER_WHEEL_ROOT_BITS + ((level) - 1) * TIMER_WHEEL_LEVEL_BITS)
+
+/** Slot of the wheel (ring of timers) */
+APR_RING_HEAD(apt_timer_slot_t, apt_timer_t);
+
 /** Timer queue */
 struct apt_timer_queue_t {
-	/** Ring head */
-	APR_RING_HEAD(apt_timer_head_t, apt_timer_t) head;
-
-	/** Elapsed time */
+	/** Root level slots */
+	struct apt_timer_slot_t root[TIMER_WHEEL_ROOT_SIZE];
+	/** Upper level slots */
+	struct apt_timer_slot_t levels[TIMER_WHEEL_LEVEL_COUNT - 1][TIMER_WHEEL_LEVEL_SIZE];
+	/** Number of timers set per level */
+	apr_size_t    counts[TIMER_WHEEL_LEVEL_COUNT];
+	/** Total number of timers set */
+	apr_size_t    count;
+
+	/** Elapsed time (free-running, wraps around) */
 	apr_uint32_t  elapsed_time;
 	/** Whether elapsed_time is reset or not */
 	apt_bool_t    reset;
@@ -41,6 +68,8 @@ struct apt_timer_t {
 	apt_timer_queue_t   *queue;
 	/** Time next report is scheduled at */
 	apr_uint32_t         scheduled_time;
+	/** Level of the wheel the timer is in, -1 if not set */
+	int                  level;
 
 	/** Timer proc */
 	apt_timer_proc_f     proc;
@@ -48,15 +77,27 @@ struct apt_timer_t {
 	void                *obj;
 };
 
-static apt_bool_t apt_timer_insert(apt_timer_queue_t *timer_queue, apt_timer_t *timer);
+static void apt_timer_insert(apt_timer_queue_t *timer_queue, apt_timer_t *timer);
 static apt_bool_t apt_timer_remove(apt_timer_queue_t *timer_queue, apt_timer_t *timer);
-static void apt_timers_reschedule(apt_timer_queue_t *timer_queue);
+static void apt_timers_cascade(apt_timer_queue_t *timer_queue);
 
 /** Create timer queue */
 APT_DECLARE(apt_timer_queue_t*) apt_timer_queue_create(apr_pool_t *pool)
 {
+	int i, j;
 	apt_timer_queue_t *timer_queue = apr_palloc(pool,sizeof(apt_timer_queue_t));
-	APR_RING_INIT(&timer_queue->head, apt_timer_t, link);
+	for(i=0; i<TIMER_WHEEL_ROOT_SIZE; i++) {
+		APR_RING_INIT(&timer_queue->root[i], apt_timer_t, link);
+	}
+	for(i=0; i<TIMER_WHEEL_LEVEL_COUNT - 1; i++) {
+		for(j=0; j<TIMER_WHEEL_LEVEL_SIZE; j++) {
+			APR_RING_INIT(&timer_queue->levels[i][j], apt_timer_t, link);
+		}
+	}
+	for(i=0; i<TIMER_WHEEL_LEVEL_COUNT; i++) {
+		timer_queue->counts[i] = 0;
+	}
+	timer_queue->count = 0;
 	timer_queue->elapsed_time = 0;
 	timer_queue->reset = FALSE;
 	return timer_queue;
@@ -72,58 +113,70 @@ APT_DECLARE(void) apt_timer_queue_destroy(apt_timer_queue_t *timer_queue)
 APT_DECLARE(void) apt_timer_queue_advance(apt_timer_queue_t *timer_queue, apr_uint32_t elapsed_time)
 {
 	apt_timer_t *timer;
+	struct apt_timer_slot_t *slot;
+	apr_uint32_t skip;
 
-	if(APR_RING_EMPTY(&timer_queue->head, apt_timer_t, link)) {
+	if(!timer_queue->count) {
 		/* just return, nothing to do */
 		return;
 	}
 
 	if(timer_queue->reset == TRUE) {
-		/* elapsed_time has just been reset, do not advance */
+		/* elapsed_time has just been reset, do not advance this time */
+		timer_queue->reset = FALSE;
 		return;
 	}
 
-	/* increment elapsed time */
-	timer_queue->elapsed_time += elapsed_time;
-	if(timer_queue->elapsed_time >= 0xFFFF) {
-#ifdef APT_TIMER_DEBUG
-		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Reschedule Timers [%u]",timer_queue->elapsed_time);
-#endif
-		apt_timers_reschedule(timer_queue);
-	}
-
-	/* process timers */
-	do {
-		/* get first node (timer) */
-		timer = APR_RING_FIRST(&timer_queue->head);
+	while(elapsed_time && timer_queue->count) {
+		if(!timer_queue->counts[0]) {
+			/* nothing to elapse at the root level, skip to the next cascade */
+			skip = TIMER_WHEEL_ROOT_MASK - (timer_queue->elapsed_time & TIMER_WHEEL_ROOT_MASK);
+			if(skip >= elapsed_time) {
+				timer_queue->elapsed_time += elapsed_time;
+				break;
+			}
+			timer_queue->elapsed_time += skip;
+			elapsed_time -= skip;
+		}
 
-		if(timer->scheduled_time > timer_queue->elapsed_time) {
-			/* scheduled time is not elapsed yet */
-			break;
+		timer_queue->elapsed_time++;
+		elapsed_time--;
+		if((timer_queue->elapsed_time & TIMER_WHEEL_ROOT_MASK) == 0) {
+			apt_timers_cascade(timer_queue);
 		}
 
+		/* process timers elapsed at this millisecond */
+		slot = &timer_queue->root[timer_queue->elapsed_time & TIMER_WHEEL_ROOT_MASK];
+		while(!APR_RING_EMPTY(slot, apt_timer_t, link)) {
+			timer = APR_RING_FIRST(slot);
 #ifdef APT_TIMER_DEBUG
-		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Timer Elapsed 0x%x [%u]",timer,timer->scheduled_time);
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Timer Elapsed 0x%x [%u]",timer,timer->scheduled_time);
 #endif
-		/* remove the elapsed timer from the list */
-		APR_RING_REMOVE(timer, link);
-		timer->scheduled_time = 0;
-		/* process the elapsed timer */
-		timer->proc(timer,timer->obj);
+			/* remove the elapsed timer from the wheel */
+			APR_RING_REMOVE(timer, link);
+			timer_queue->counts[0]--;
+			timer_queue->count--;
+			timer->level = -1;
+			/* process the elapsed timer */
+			timer->proc(timer,timer->obj);
+		}
 	}
-	while(!APR_RING_EMPTY(&timer_queue->head, apt_timer_t, link));
 }
 
 /** Is timer queue empty */
 APT_DECLARE(apt_bool_t) apt_timer_queue_is_empty(const apt_timer_queue_t *timer_queue)
 {
-	return APR_RING_EMPTY(&timer_queue->head, apt_timer_t, link) ? TRUE : FALSE;
+	return timer_queue->count ? FALSE : TRUE;
 }
 
 /** Get current timeout */
 APT_DECLARE(apt_bool_t) apt_timer_queue_timeout_get(apt_timer_queue_t *timer_queue, apr_uint32_t *timeout)
 {
-	apt_timer_t *timer;
+	int level;
+	apr_uint32_t i;
+	apr_uint32_t base;
+	apr_uint64_t cur;
+	apr_uint64_t min = 0xFFFFFFFF;
 
 	/* clear reset flag, if set */
 	if(timer_queue->reset == TRUE) {
@@ -131,17 +184,38 @@ APT_DECLARE(apt_bool_t) apt_timer_queue_timeout_get(apt_timer_queue_t *timer_que
 	}
 
 	/* is queue empty */
-	if(APR_RING_EMPTY(&timer_queue->head, apt_timer_t, link)) {
+	if(!timer_queue->count) {
 		return FALSE;
 	}
 
-	/* get first node (timer) */
-	timer = APR_RING_FIRST(&timer_queue->head);
-	if(!timer) {
-		return FALSE;
+	/* the first occupied slot of the root level gives the exact time */
+	if(timer_queue->counts[0]) {
+		for(i=1; i<=TIMER_WHEEL_ROOT_SIZE; i++) {
+			if(!APR_RING_EMPTY(&timer_queue->root[(timer_queue->elapsed_time + i) & TIMER_WHEEL_ROOT_MASK], apt_timer_t, link)) {
+				min = i;
+				break;
+			}
+		}
 	}
 
-	*timeout = timer->scheduled_time - timer_queue->elapsed_time;
+	/* timers of an upper level may elapse earlier, but not before their slot is cascaded */
+	for(level=1; level<TIMER_WHEEL_LEVEL_COUNT; level++) {
+		if(!timer_queue->counts[level]) {
+			continue;
+		}
+		base = timer_queue->elapsed_time >> TIMER_WHEEL_SHIFT(level);
+		for(i=1; i<=TIMER_WHEEL_LEVEL_SIZE; i++) {
+			if(!APR_RING_EMPTY(&timer_queue->levels[level-1][(base + i) & TIMER_WHEEL_LEVEL_MASK], apt_timer_t, link)) {
+				cur = (((apr_uint64_t)base + i) << TIMER_WHEEL_SHIFT(level)) - timer_queue->elapsed_time;
+				if(cur < min) {
+					min = cur;
+				}
+				break;
+			}
+		}
+	}
+
+	*timeout = (apr_uint32_t)min;
 	return TRUE;
 }
 
@@ -152,6 +226,7 @@ APT_DECLARE(apt_timer_t*) apt_timer_create(apt_timer_queue_t *timer_queue, apt_t
 	APR_RING_ELEM_INIT(timer,link);
 	timer->queue = timer_queue;
 	timer->scheduled_time = 0;
+	timer->level = -1;
 	timer->proc = proc;
 	timer->obj = obj;
 	return timer;
@@ -166,7 +241,7 @@ APT_DECLARE(apt_bool_t) apt_timer_set(apt_timer_t *timer, apr_uint32_t timeout)
 		return FALSE;
 	}
 
-	if(timer->scheduled_time) {
+	if(timer->level >= 0) {
 		/* remove timer first */
 		apt_timer_remove(queue,timer);
 	}
@@ -176,19 +251,14 @@ APT_DECLARE(apt_bool_t) apt_timer_set(apt_timer_t *timer, apr_uint32_t timeout)
 #ifdef APT_TIMER_DEBUG
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Set Timer 0x%x [%u]",timer,timer->scheduled_time);
 #endif
-	if(APR_RING_EMPTY(&queue->head, apt_timer_t, link)) {
-		APR_RING_INSERT_TAIL(&queue->head,timer,apt_timer_t,link);
-		return TRUE;
-	}
-
-	/* insert new node (timer) to sorted by scheduled time list */
-	return apt_timer_insert(queue,timer);
+	apt_timer_insert(queue,timer);
+	return TRUE;
 }
 
 /** Kill timer */
 APT_DECLARE(apt_bool_t) apt_timer_kill(apt_timer_t *timer)
 {
-	if(!timer->scheduled_time) {
+	if(timer->level < 0) {
 		return FALSE;
 	}
 
@@ -198,29 +268,38 @@ APT_DECLARE(apt_bool_t) apt_timer_kill(apt_timer_t *timer)
 	return apt_timer_remove(timer->queue,timer);
 }
 
-static apt_bool_t apt_timer_insert(apt_timer_queue_t *timer_queue, apt_timer_t *timer)
+/** Place timer to the slot its scheduled time falls into */
+static void apt_timer_insert(apt_timer_queue_t *timer_queue, apt_timer_t *timer)
 {
-	apt_timer_t *it;
-	for(it = APR_RING_LAST(&timer_queue->head);
-			it != APR_RING_SENTINEL(&timer_queue->head, apt_timer_t, link);
-				it = APR_RING_PREV(it, link)) {
-		
-		if(it->scheduled_time <= timer->scheduled_time) {
-			APR_RING_INSERT_AFTER(it,timer,link);
-			return TRUE;
+	struct apt_timer_slot_t *slot;
+	apr_uint32_t delta = timer->scheduled_time - timer_queue->elapsed_time;
+	int level = 0;
+	if(delta < TIMER_WHEEL_ROOT_SIZE) {
+		slot = &timer_queue->root[timer->scheduled_time & TIMER_WHEEL_ROOT_MASK];
+	}
+	else {
+		for(level=1; level<TIMER_WHEEL_LEVEL_COUNT - 1; level++) {
+			if(delta < (apr_uint32_t)1 << (TIMER_WHEEL_SHIFT(level) + TIMER_WHEEL_LEVEL_BITS)) {
+				break;
+			}
 		}
+		slot = &timer_queue->levels[level-1][(timer->scheduled_time >> TIMER_WHEEL_SHIFT(level)) & TIMER_WHEEL_LEVEL_MASK];
 	}
-	APR_RING_INSERT_HEAD(&timer_queue->head,timer,apt_timer_t,link);
-	return TRUE;
+	APR_RING_INSERT_TAIL(slot,timer,apt_timer_t,link);
+	timer->level = level;
+	timer_queue->counts[level]++;
+	timer_queue->count++;
 }
 
 static apt_bool_t apt_timer_remove(apt_timer_queue_t *timer_queue, apt_timer_t *timer)
 {
-	/* remove node (timer) from the list */
+	/* remove node (timer) from the slot */
 	APR_RING_REMOVE(timer,link);
-	timer->scheduled_time = 0;
+	timer_queue->counts[timer->level]--;
+	timer_queue->count--;
+	timer->level = -1;
 
-	if(APR_RING_EMPTY(&timer_queue->head, apt_timer_t, link)) {
+	if(!timer_queue->count) {
 		/* reset elapsed time if no timers set */
 		timer_queue->elapsed_time = 0;
 		/* set reset flag */
@@ -229,16 +308,27 @@ static apt_bool_t apt_timer_remove(apt_timer_queue_t *timer_queue, apt_timer_t *
 	return TRUE;
 }
 
-static void apt_timers_reschedule(apt_timer_queue_t *timer_queue)
+/** Move timers of the upper levels due within the next round of the lower level down */
+static void apt_timers_cascade(apt_timer_queue_t *timer_queue)
 {
-	apt_timer_t *it;
-	for(it = APR_RING_LAST(&timer_queue->head);
-			it != APR_RING_SENTINEL(&timer_queue->head, apt_timer_t, link);
-				it = APR_RING_PREV(it, link)) {
-		if (it->scheduled_time > timer_queue->elapsed_time)
-			it->scheduled_time -= timer_queue->elapsed_time;
-		else
-			it->scheduled_time = 0;
+	int level;
+	apr_uint32_t index;
+	apt_timer_t *timer;
+	struct apt_timer_slot_t *slot;
+	for(level=1; level<TIMER_WHEEL_LEVEL_COUNT; level++) {
+		index = (timer_queue->elapsed_time >> TIMER_WHEEL_SHIFT(level)) & TIMER_WHEEL_LEVEL_MASK;
+		slot = &timer_queue->levels[level-1][index];
+		while(!APR_RING_EMPTY(slot, apt_timer_t, link)) {
+			timer = APR_RING_FIRST(slot);
+			APR_RING_REMOVE(timer, link);
+			timer_queue->counts[level]--;
+			timer_queue->count--;
+			/* lands on a lower level, since it is due within the span of this slot */
+			apt_timer_insert(timer_queue,timer);
+		}
+		if(index) {
+			/* the upper level does not wrap around yet */
+			break;
+		}
 	}
-	timer_queue->elapsed_time = 0;
 }
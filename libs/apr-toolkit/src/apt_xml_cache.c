@@ -0,0 +1,402 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_file_io.h>
+#include <apr_file_info.h>
+#include <apr_strings.h>
+#include "apt_xml_cache.h"
+#include "apt_log.h"
+
+/** Magic of the image ("AXC1") */
+#define APT_XML_CACHE_MAGIC   0x31435841
+/** Version of the image layout */
+#define APT_XML_CACHE_VERSION 1
+/** Size of the buffer to parse the source file by */
+#define APT_XML_FILE_BUFFER_LENGTH 16000
+/** Max depth of the element tree read back */
+#define APT_XML_CACHE_MAX_DEPTH 256
+/** Length of NULL string */
+#define APT_XML_CACHE_NULL 0xFFFFFFFF
+
+/** Header of the image */
+typedef struct apt_xml_cache_header_t apt_xml_cache_header_t;
+struct apt_xml_cache_header_t {
+	apr_uint32_t magic;
+	apr_uint32_t version;
+	apr_uint64_t size;
+	apr_uint64_t mtime;
+	apr_uint32_t length;
+	apr_uint32_t checksum;
+};
+
+/** Buffer the payload is written to and read from */
+typedef struct apt_xml_cache_buf_t apt_xml_cache_buf_t;
+struct apt_xml_cache_buf_t {
+	char       *data;
+	apr_size_t  size;
+	apr_size_t  pos;
+	apr_pool_t *pool;
+};
+
+/** FNV-1a hash of the payload */
+static apr_uint32_t apt_xml_cache_checksum(const char *data, apr_size_t length)
+{
+	apr_uint32_t hash = 2166136261U;
+	apr_size_t i;
+	for(i=0; i<length; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static void apt_xml_cache_data_write(apt_xml_cache_buf_t *buf, const void *data, apr_size_t length)
+{
+	if(buf->pos + length > buf->size) {
+		apr_size_t size = buf->size * 2;
+		char *new_data;
+		while(buf->pos + length > size) {
+			size *= 2;
+		}
+		new_data = apr_palloc(buf->pool,size);
+		memcpy(new_data,buf->data,buf->pos);
+		buf->data = new_data;
+		buf->size = size;
+	}
+	memcpy(buf->data + buf->pos,data,length);
+	buf->pos += length;
+}
+
+static void apt_xml_cache_u32_write(apt_xml_cache_buf_t *buf, apr_uint32_t value)
+{
+	apt_xml_cache_data_write(buf,&value,sizeof(value));
+}
+
+static void apt_xml_cache_str_write(apt_xml_cache_buf_t *buf, const char *str)
+{
+	apr_uint32_t length;
+	if(!str) {
+		apt_xml_cache_u32_write(buf,APT_XML_CACHE_NULL);
+		return;
+	}
+	length = (apr_uint32_t)strlen(str);
+	apt_xml_cache_u32_write(buf,length);
+	apt_xml_cache_data_write(buf,str,length + 1);
+}
+
+static void apt_xml_cache_text_write(apt_xml_cache_buf_t *buf, const apr_text_header *header)
+{
+	const apr_text *text;
+	apr_uint32_t count = 0;
+	for(text = header->first; text; text = text->next) {
+		count++;
+	}
+	apt_xml_cache_u32_write(buf,count);
+	for(text = header->first; text; text = text->next) {
+		apt_xml_cache_str_write(buf,text->text);
+	}
+}
+
+static void apt_xml_cache_elem_write(apt_xml_cache_buf_t *buf, const apr_xml_elem *elem)
+{
+	const apr_xml_attr *attr;
+	const apr_xml_elem *child;
+	apr_uint32_t count = 0;
+
+	apt_xml_cache_str_write(buf,elem->name);
+	apt_xml_cache_u32_write(buf,(apr_uint32_t)elem->ns);
+	apt_xml_cache_str_write(buf,elem->lang);
+	apt_xml_cache_text_write(buf,&elem->first_cdata);
+	apt_xml_cache_text_write(buf,&elem->following_cdata);
+
+	for(attr = elem->attr; attr; attr = attr->next) {
+		count++;
+	}
+	apt_xml_cache_u32_write(buf,count);
+	for(attr = elem->attr; attr; attr = attr->next) {
+		apt_xml_cache_str_write(buf,attr->name);
+		apt_xml_cache_u32_write(buf,(apr_uint32_t)attr->ns);
+		apt_xml_cache_str_write(buf,attr->value);
+	}
+
+	count = 0;
+	for(child = elem->first_child; child; child = child->next) {
+		count++;
+	}
+	apt_xml_cache_u32_write(buf,count);
+	for(child = elem->first_child; child; child = child->next) {
+		apt_xml_cache_elem_write(buf,child);
+	}
+}
+
+APT_DECLARE(apt_bool_t) apt_xml_cache_save(const apr_xml_doc *doc, const char *cache_path, apr_off_t size, apr_time_t mtime, apr_pool_t *pool)
+{
+	apt_xml_cache_header_t header;
+	apt_xml_cache_buf_t buf;
+	apr_file_t *file;
+	const char *tmp_path;
+	apr_size_t length;
+	apt_bool_t status;
+	int i;
+
+	if(!doc || !doc->root || !cache_path) {
+		return FALSE;
+	}
+
+	buf.size = 4096;
+	buf.data = apr_palloc(pool,buf.size);
+	buf.pos = 0;
+	buf.pool = pool;
+	apt_xml_cache_u32_write(&buf,doc->namespaces ? (apr_uint32_t)doc->namespaces->nelts : 0);
+	for(i=0; doc->namespaces && i<doc->namespaces->nelts; i++) {
+		apt_xml_cache_str_write(&buf,APR_XML_GET_URI_ITEM(doc->namespaces,i));
+	}
+	apt_xml_cache_elem_write(&buf,doc->root);
+
+	header.magic = APT_XML_CACHE_MAGIC;
+	header.version = APT_XML_CACHE_VERSION;
+	header.size = (apr_uint64_t)size;
+	header.mtime = (apr_uint64_t)mtime;
+	header.length = (apr_uint32_t)buf.pos;
+	header.checksum = apt_xml_cache_checksum(buf.data,buf.pos);
+
+	/* the file is named after the pool too, another process may write the same cache meanwhile */
+	tmp_path = apr_psprintf(pool,"%s.%pp.tmp",cache_path,(void*)pool);
+	if(apr_file_open(&file,tmp_path,APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Failed to Open XML Cache File [%s]",tmp_path);
+		return FALSE;
+	}
+	length = sizeof(header);
+	status = apr_file_write_full(file,&header,length,&length) == APR_SUCCESS ? TRUE : FALSE;
+	if(status == TRUE) {
+		length = buf.pos;
+		status = apr_file_write_full(file,buf.data,length,&length) == APR_SUCCESS ? TRUE : FALSE;
+	}
+	if(apr_file_close(file) != APR_SUCCESS) {
+		status = FALSE;
+	}
+	if(status == FALSE || apr_file_rename(tmp_path,cache_path,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Failed to Write XML Cache File [%s]",cache_path);
+		apr_file_remove(tmp_path,pool);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t apt_xml_cache_u32_read(apt_xml_cache_buf_t *buf, apr_uint32_t *value)
+{
+	if(buf->pos + sizeof(*value) > buf->size) {
+		return FALSE;
+	}
+	memcpy(value,buf->data + buf->pos,sizeof(*value));
+	buf->pos += sizeof(*value);
+	return TRUE;
+}
+
+static apt_bool_t apt_xml_cache_str_read(apt_xml_cache_buf_t *buf, const char **str)
+{
+	apr_uint32_t length;
+	if(apt_xml_cache_u32_read(buf,&length) == FALSE) {
+		return FALSE;
+	}
+	if(length == APT_XML_CACHE_NULL) {
+		*str = NULL;
+		return TRUE;
+	}
+	if(length >= buf->size - buf->pos || buf->data[buf->pos + length] != '\0') {
+		return FALSE;
+	}
+	/* the strings point into the image, which is kept along with the document */
+	*str = buf->data + buf->pos;
+	buf->pos += length + 1;
+	return TRUE;
+}
+
+static apt_bool_t apt_xml_cache_text_read(apt_xml_cache_buf_t *buf, apr_text_header *header)
+{
+	apr_uint32_t count;
+	apr_text *text;
+	header->first = header->last = NULL;
+	if(apt_xml_cache_u32_read(buf,&count) == FALSE) {
+		return FALSE;
+	}
+	while(count--) {
+		text = apr_palloc(buf->pool,sizeof(apr_text));
+		text->next = NULL;
+		if(apt_xml_cache_str_read(buf,&text->text) == FALSE) {
+			return FALSE;
+		}
+		if(header->last) {
+			header->last->next = text;
+		}
+		else {
+			header->first = text;
+		}
+		header->last = text;
+	}
+	return TRUE;
+}
+
+static apr_xml_elem* apt_xml_cache_elem_read(apt_xml_cache_buf_t *buf, apr_xml_elem *parent, apr_size_t depth)
+{
+	apr_uint32_t count;
+	apr_uint32_t value;
+	apr_xml_attr *last_attr = NULL;
+	apr_xml_elem *elem;
+
+	if(depth > APT_XML_CACHE_MAX_DEPTH) {
+		return NULL;
+	}
+	elem = apr_pcalloc(buf->pool,sizeof(apr_xml_elem));
+	elem->parent = parent;
+	if(apt_xml_cache_str_read(buf,&elem->name) == FALSE || !elem->name ||
+		apt_xml_cache_u32_read(buf,&value) == FALSE ||
+		apt_xml_cache_str_read(buf,&elem->lang) == FALSE ||
+		apt_xml_cache_text_read(buf,&elem->first_cdata) == FALSE ||
+		apt_xml_cache_text_read(buf,&elem->following_cdata) == FALSE ||
+		apt_xml_cache_u32_read(buf,&count) == FALSE) {
+		return NULL;
+	}
+	elem->ns = (int)value;
+
+	while(count--) {
+		apr_xml_attr *attr = apr_palloc(buf->pool,sizeof(apr_xml_attr));
+		attr->next = NULL;
+		if(apt_xml_cache_str_read(buf,&attr->name) == FALSE || !attr->name ||
+			apt_xml_cache_u32_read(buf,&value) == FALSE ||
+			apt_xml_cache_str_read(buf,&attr->value) == FALSE) {
+			return NULL;
+		}
+		attr->ns = (int)value;
+		if(last_attr) {
+			last_attr->next = attr;
+		}
+		else {
+			elem->attr = attr;
+		}
+		last_attr = attr;
+	}
+
+	if(apt_xml_cache_u32_read(buf,&count) == FALSE) {
+		return NULL;
+	}
+	while(count--) {
+		apr_xml_elem *child = apt_xml_cache_elem_read(buf,elem,depth + 1);
+		if(!child) {
+			return NULL;
+		}
+		if(elem->last_child) {
+			elem->last_child->next = child;
+		}
+		else {
+			elem->first_child = child;
+		}
+		elem->last_child = child;
+	}
+	return elem;
+}
+
+APT_DECLARE(apr_xml_doc*) apt_xml_cache_load(const char *cache_path, apr_off_t size, apr_time_t mtime, apr_pool_t *pool)
+{
+	apt_xml_cache_header_t header;
+	apt_xml_cache_buf_t buf;
+	apr_xml_doc *doc;
+	apr_file_t *file;
+	apr_uint32_t count;
+	apr_size_t length;
+	apt_bool_t status;
+
+	if(!cache_path || apr_file_open(&file,cache_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	length = sizeof(header);
+	status = apr_file_read_full(file,&header,length,&length) == APR_SUCCESS ? TRUE : FALSE;
+	if(status == TRUE) {
+		status = (header.magic == APT_XML_CACHE_MAGIC && header.version == APT_XML_CACHE_VERSION &&
+			header.size == (apr_uint64_t)size && header.mtime == (apr_uint64_t)mtime) ? TRUE : FALSE;
+	}
+	if(status == TRUE) {
+		buf.size = header.length;
+		buf.data = apr_palloc(pool,buf.size + 1);
+		length = buf.size;
+		status = apr_file_read_full(file,buf.data,length,&length) == APR_SUCCESS ? TRUE : FALSE;
+	}
+	apr_file_close(file);
+	if(status == FALSE || apt_xml_cache_checksum(buf.data,buf.size) != header.checksum) {
+		return NULL;
+	}
+
+	buf.pos = 0;
+	buf.pool = pool;
+	doc = apr_palloc(pool,sizeof(apr_xml_doc));
+	if(apt_xml_cache_u32_read(&buf,&count) == FALSE || count > buf.size) {
+		return NULL;
+	}
+	doc->namespaces = apr_array_make(pool,count ? (int)count : 1,sizeof(const char*));
+	while(count--) {
+		const char *uri;
+		if(apt_xml_cache_str_read(&buf,&uri) == FALSE) {
+			return NULL;
+		}
+		APR_ARRAY_PUSH(doc->namespaces,const char*) = uri;
+	}
+	doc->root = apt_xml_cache_elem_read(&buf,NULL,0);
+	if(!doc->root || buf.pos != buf.size) {
+		return NULL;
+	}
+	return doc;
+}
+
+APT_DECLARE(apr_xml_doc*) apt_xml_doc_load(const char *file_path, const char *cache_path, apr_pool_t *pool)
+{
+	apr_xml_parser *parser = NULL;
+	apr_xml_doc *doc = NULL;
+	apr_file_t *fd = NULL;
+	apr_finfo_t finfo;
+	apr_status_t rv;
+
+	rv = apr_file_open(&fd,file_path,APR_READ|APR_BINARY,0,pool);
+	if(rv != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Config File [%s]",file_path);
+		return NULL;
+	}
+
+	if(cache_path && apr_file_info_get(&finfo,APR_FINFO_SIZE | APR_FINFO_MTIME,fd) != APR_SUCCESS) {
+		cache_path = NULL;
+	}
+	if(cache_path) {
+		doc = apt_xml_cache_load(cache_path,finfo.size,finfo.mtime,pool);
+		if(doc) {
+			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Load Config Cache [%s]",cache_path);
+			apr_file_close(fd);
+			return doc;
+		}
+	}
+
+	rv = apr_xml_parse_file(pool,&parser,&doc,fd,APT_XML_FILE_BUFFER_LENGTH);
+	apr_file_close(fd);
+	if(rv != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Config File [%s]",file_path);
+		return NULL;
+	}
+
+	if(cache_path) {
+		apt_xml_cache_save(doc,cache_path,finfo.size,finfo.mtime,pool);
+	}
+	return doc;
+}
@@ -0,0 +1,390 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * g722.c - The ITU G.722 codec.
+ *
+ * Written by Steve Underwood <steveu@coppice.org>
+ *
+ * Copyright (C) 2005 Steve Underwood
+ *
+ *  Despite my general liking of the GPL, I place my own contributions 
+ *  to this code in the public domain for the benefit of all mankind -
+ *  even the slimy ones who might try to proprietize my work and use it
+ *  to my detriment.
+ *
+ * Based on a single channel 64kbps only G.722 codec which is:
+ *
+ *****    Copyright (c) CMU    1993      *****
+ * Computer Science, Speech Group
+ * Chengxiang Lu and Alex Hauptmann
+ */
+
+#include <string.h>
+#include "g722.h"
+
+static const int qmf_coeffs[12] =
+{
+	3, -11, 12, 32, -210, 951, 3876, -805, 362, -156, 53, -11,
+};
+
+static const int q6[32] =
+{
+	0,   35,   72,  110,  150,  190,  233,  276,
+	323,  370,  422,  473,  530,  587,  650,  714,
+	786,  858,  940, 1023, 1121, 1219, 1339, 1458,
+	1612, 1765, 1980, 2195, 2557, 2919,    0,    0
+};
+
+static const int iln[32] =
+{
+	0, 63, 62, 31, 30, 29, 28, 27,
+	26, 25, 24, 23, 22, 21, 20, 19,
+	18, 17, 16, 15, 14, 13, 12, 11,
+	10,  9,  8,  7,  6,  5,  4,  0
+};
+
+static const int ilp[32] =
+{
+	0, 61, 60, 59, 58, 57, 56, 55,
+	54, 53, 52, 51, 50, 49, 48, 47,
+	46, 45, 44, 43, 42, 41, 40, 39,
+	38, 37, 36, 35, 34, 33, 32,  0
+};
+
+static const int wl[8] =
+{
+	-60, -30, 58, 172, 334, 538, 1198, 3042
+};
+
+static const int rl42[16] =
+{
+	0, 7, 6, 5, 4, 3, 2, 1, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+static const int ilb[32] =
+{
+	2048, 2093, 2139, 2186, 2233, 2282, 2332,
+	2383, 2435, 2489, 2543, 2599, 2656, 2714,
+	2774, 2834, 2896, 2960, 3025, 3091, 3158,
+	3228, 3298, 3371, 3444, 3520, 3597, 3676,
+	3756, 3838, 3922, 4008
+};
+
+static const int qm4[16] =
+{
+	0, -20456, -12896, -8968,
+	-6288,  -4240,  -2584, -1200,
+	20456,  12896,   8968,  6288,
+	4240,   2584,   1200,     0
+};
+
+static const int qm6[64] =
+{
+	-136,   -136,   -136,   -136,
+	-24808, -21904, -19008, -16704,
+	-14984, -13512, -12280, -11192,
+	-10232,  -9360,  -8576,  -7856,
+	-7192,  -6576,  -6000,  -5456,
+	-4944,  -4464,  -4008,  -3576,
+	-3168,  -2776,  -2400,  -2032,
+	-1688,  -1360,  -1040,   -728,
+	24808,  21904,  19008,  16704,
+	14984,  13512,  12280,  11192,
+	10232,   9360,   8576,   7856,
+	7192,   6576,   6000,   5456,
+	4944,   4464,   4008,   3576,
+	3168,   2776,   2400,   2032,
+	1688,   1360,   1040,    728,
+	432,    136,   -432,   -136
+};
+
+static const int qm2[4] =
+{
+	-7408, -1616, 7408, 1616
+};
+
+static const int ihn[3] = {0, 1, 0};
+static const int ihp[3] = {0, 3, 2};
+static const int wh[3] = {0, -214, 798};
+static const int rh2[4] = {2, 1, 2, 1};
+
+static APR_INLINE int saturate(int amp)
+{
+	if(amp > 32767) {
+		return 32767;
+	}
+	if(amp < -32768) {
+		return -32768;
+	}
+	return amp;
+}
+
+/* Block 4, adaptive predictor (common to encoder and decoder) */
+static void block4(g722_band_t *band, int d)
+{
+	int wd1;
+	int wd2;
+	int wd3;
+	int i;
+
+	/* Block 4, RECONS */
+	band->d[0] = d;
+	band->r[0] = saturate(band->s + d);
+
+	/* Block 4, PARREC */
+	band->p[0] = saturate(band->sz + d);
+
+	/* Block 4, UPPOL2 */
+	for(i = 0; i < 3; i++) {
+		band->sg[i] = band->p[i] >> 15;
+	}
+	wd1 = saturate(band->a[1] << 2);
+
+	wd2 = (band->sg[0] == band->sg[1]) ? -wd1 : wd1;
+	if(wd2 > 32767) {
+		wd2 = 32767;
+	}
+	wd3 = (wd2 >> 7) + ((band->sg[0] == band->sg[2]) ? 128 : -128);
+	wd3 += (band->a[2] * 32512) >> 15;
+	if(wd3 > 12288) {
+		wd3 = 12288;
+	}
+	else if(wd3 < -12288) {
+		wd3 = -12288;
+	}
+	band->ap[2] = wd3;
+
+	/* Block 4, UPPOL1 */
+	band->sg[0] = band->p[0] >> 15;
+	band->sg[1] = band->p[1] >> 15;
+	wd1 = (band->sg[0] == band->sg[1]) ? 192 : -192;
+	wd2 = (band->a[1] * 32640) >> 15;
+
+	band->ap[1] = saturate(wd1 + wd2);
+	wd3 = saturate(15360 - band->ap[2]);
+	if(band->ap[1] > wd3) {
+		band->ap[1] = wd3;
+	}
+	else if(band->ap[1] < -wd3) {
+		band->ap[1] = -wd3;
+	}
+
+	/* Block 4, UPZERO */
+	wd1 = (d == 0) ? 0 : 128;
+	band->sg[0] = d >> 15;
+	for(i = 1; i < 7; i++) {
+		band->sg[i] = band->d[i] >> 15;
+		wd2 = (band->sg[i] == band->sg[0]) ? wd1 : -wd1;
+		wd3 = (band->b[i] * 32640) >> 15;
+		band->bp[i] = saturate(wd2 + wd3);
+	}
+
+	/* Block 4, DELAYA */
+	for(i = 6; i > 0; i--) {
+		band->d[i] = band->d[i - 1];
+		band->b[i] = band->bp[i];
+	}
+	for(i = 2; i > 0; i--) {
+		band->r[i] = band->r[i - 1];
+		band->p[i] = band->p[i - 1];
+		band->a[i] = band->ap[i];
+	}
+
+	/* Block 4, FILTEP */
+	wd1 = saturate(band->r[1] + band->r[1]);
+	wd1 = (band->a[1] * wd1) >> 15;
+	wd2 = saturate(band->r[2] + band->r[2]);
+	wd2 = (band->a[2] * wd2) >> 15;
+	band->sp = saturate(wd1 + wd2);
+
+	/* Block 4, FILTEZ */
+	band->sz = 0;
+	for(i = 6; i > 0; i--) {
+		wd1 = saturate(band->d[i] + band->d[i]);
+		band->sz += (band->b[i] * wd1) >> 15;
+	}
+	band->sz = saturate(band->sz);
+
+	/* Block 4, PREDIC */
+	band->s = saturate(band->sp + band->sz);
+}
+
+/* Block 3L/3H, LOGSCL/LOGSCH and SCALEL/SCALEH */
+static APR_INLINE void scale_update(g722_band_t *band, int wd, int nb_max, int shift)
+{
+	int wd1;
+	int wd2;
+	int wd3;
+	band->nb = ((band->nb * 127) >> 7) + wd;
+	if(band->nb < 0) {
+		band->nb = 0;
+	}
+	else if(band->nb > nb_max) {
+		band->nb = nb_max;
+	}
+
+	wd1 = (band->nb >> 6) & 31;
+	wd2 = shift - (band->nb >> 11);
+	wd3 = (wd2 < 0) ? (ilb[wd1] << -wd2) : (ilb[wd1] >> wd2);
+	band->det = wd3 << 2;
+}
+
+void g722_init(g722_state_t *s)
+{
+	memset(s,0,sizeof(g722_state_t));
+	s->band[0].det = 32;
+	s->band[1].det = 8;
+}
+
+int g722_encode(g722_state_t *s, apr_byte_t g722_data[], const apr_int16_t amp[], int len)
+{
+	int dlow;
+	int dhigh;
+	int el;
+	int eh;
+	int wd;
+	int wd1;
+	int ilow;
+	int ihigh;
+	int mih;
+	int ril;
+	int xlow;
+	int xhigh;
+	int g722_bytes = 0;
+	int sumeven;
+	int sumodd;
+	int i;
+	int j;
+
+	for(j = 0; j + 1 < len; ) {
+		/* Apply the transmit QMF, shuffle the buffer down */
+		for(i = 0; i < 22; i++) {
+			s->x[i] = s->x[i + 2];
+		}
+		s->x[22] = amp[j++];
+		s->x[23] = amp[j++];
+
+		/* Discard every other QMF output */
+		sumeven = 0;
+		sumodd = 0;
+		for(i = 0; i < 12; i++) {
+			sumodd += s->x[2 * i] * qmf_coeffs[i];
+			sumeven += s->x[2 * i + 1] * qmf_coeffs[11 - i];
+		}
+		xlow = (sumeven + sumodd) >> 14;
+		xhigh = (sumeven - sumodd) >> 14;
+
+		/* Block 1L, SUBTRA */
+		el = saturate(xlow - s->band[0].s);
+
+		/* Block 1L, QUANTL */
+		wd = (el >= 0) ? el : -(el + 1);
+		for(i = 1; i < 30; i++) {
+			wd1 = (q6[i] * s->band[0].det) >> 12;
+			if(wd < wd1) {
+				break;
+			}
+		}
+		ilow = (el < 0) ? iln[i] : ilp[i];
+
+		/* Block 2L, INVQAL */
+		ril = ilow >> 2;
+		dlow = (s->band[0].det * qm4[ril]) >> 15;
+
+		scale_update(&s->band[0],wl[rl42[ril]],18432,8);
+		block4(&s->band[0],dlow);
+
+		/* Block 1H, SUBTRA */
+		eh = saturate(xhigh - s->band[1].s);
+
+		/* Block 1H, QUANTH */
+		wd = (eh >= 0) ? eh : -(eh + 1);
+		wd1 = (564 * s->band[1].det) >> 12;
+		mih = (wd >= wd1) ? 2 : 1;
+		ihigh = (eh < 0) ? ihn[mih] : ihp[mih];
+
+		/* Block 2H, INVQAH */
+		dhigh = (s->band[1].det * qm2[ihigh]) >> 15;
+
+		scale_update(&s->band[1],wh[rh2[ihigh]],22528,10);
+		block4(&s->band[1],dhigh);
+
+		g722_data[g722_bytes++] = (apr_byte_t)((ihigh << 6) | ilow);
+	}
+	return g722_bytes;
+}
+
+int g722_decode(g722_state_t *s, apr_int16_t amp[], const apr_byte_t g722_data[], int len)
+{
+	int dlow;
+	int dhigh;
+	int rlow;
+	int rhigh;
+	int wd1;
+	int wd2;
+	int code;
+	int ihigh;
+	int xout1;
+	int xout2;
+	int outlen = 0;
+	int i;
+	int j;
+
+	for(j = 0; j < len; j++) {
+		code = g722_data[j];
+		wd1 = code & 0x3F;
+		ihigh = (code >> 6) & 0x03;
+		wd2 = qm6[wd1];
+		wd1 >>= 2;
+
+		/* Block 5L, LOW BAND INVQBL */
+		wd2 = (s->band[0].det * wd2) >> 15;
+		/* Block 5L, RECONS */
+		rlow = s->band[0].s + wd2;
+		/* Block 6L, LIMIT */
+		if(rlow > 16383) {
+			rlow = 16383;
+		}
+		else if(rlow < -16384) {
+			rlow = -16384;
+		}
+
+		/* Block 2L, INVQAL */
+		dlow = (s->band[0].det * qm4[wd1]) >> 15;
+
+		scale_update(&s->band[0],wl[rl42[wd1]],18432,8);
+		block4(&s->band[0],dlow);
+
+		/* Block 2H, INVQAH */
+		dhigh = (s->band[1].det * qm2[ihigh]) >> 15;
+		/* Block 5H, RECONS */
+		rhigh = dhigh + s->band[1].s;
+		/* Block 6H, LIMIT */
+		if(rhigh > 16383) {
+			rhigh = 16383;
+		}
+		else if(rhigh < -16384) {
+			rhigh = -16384;
+		}
+
+		scale_update(&s->band[1],wh[rh2[ihigh]],22528,10);
+		block4(&s->band[1],dhigh);
+
+		/* Apply the receive QMF */
+		for(i = 0; i < 22; i++) {
+			s->x[i] = s->x[i + 2];
+		}
+		s->x[22] = rlow + rhigh;
+		s->x[23] = rlow - rhigh;
+
+		xout1 = 0;
+		xout2 = 0;
+		for(i = 0; i < 12; i++) {
+			xout2 += s->x[2 * i] * qmf_coeffs[i];
+			xout1 += s->x[2 * i + 1] * qmf_coeffs[11 - i];
+		}
+		amp[outlen++] = (apr_int16_t)saturate(xout1 >> 11);
+		amp[outlen++] = (apr_int16_t)saturate(xout2 >> 11);
+	}
+	return outlen;
+}
@@ -0,0 +1,84 @@
+/*
+ * SpanDSP - a series of DSP components for telephony
+ *
+ * g722.h - The ITU G.722 codec.
+ *
+ * Written by Steve Underwood <steveu@coppice.org>
+ *
+ * Copyright (C) 2005 Steve Underwood
+ *
+ *  Despite my general liking of the GPL, I place my own contributions 
+ *  to this code in the public domain for the benefit of all mankind -
+ *  even the slimy ones who might try to proprietize my work and use it
+ *  to my detriment.
+ *
+ * Based on a single channel G.722 codec which is:
+ *
+ *****    Copyright (c) CMU    1993      *****
+ * Computer Science, Speech Group
+ * Chengxiang Lu and Alex Hauptmann
+ */
+
+#ifndef MPF_G722_H
+#define MPF_G722_H
+
+/**
+ * @file g722.h
+ * @brief ITU G.722 codec (64 kbit/s mode)
+ */ 
+
+#include "mpf.h"
+
+APT_BEGIN_EXTERN_C
+
+/** State of a sub-band ADPCM coder */
+typedef struct {
+	int s;
+	int sp;
+	int sz;
+	int r[3];
+	int a[3];
+	int ap[3];
+	int p[3];
+	int d[7];
+	int b[7];
+	int bp[7];
+	int sg[7];
+	int nb;
+	int det;
+} g722_band_t;
+
+/** State of G.722 encoder or decoder */
+typedef struct {
+	/** QMF signal history */
+	int         x[24];
+	/** Low and high sub-bands */
+	g722_band_t band[2];
+} g722_state_t;
+
+/** Initialize (reset) the state */
+void g722_init(g722_state_t *s);
+
+/**
+ * Encode 16 kHz linear samples.
+ * @param s the encoder state
+ * @param g722_data the output buffer, one byte per two samples
+ * @param amp the samples
+ * @param len the number of samples (even)
+ * @return the number of bytes produced
+ */
+int g722_encode(g722_state_t *s, apr_byte_t g722_data[], const apr_int16_t amp[], int len);
+
+/**
+ * Decode to 16 kHz linear samples.
+ * @param s the decoder state
+ * @param amp the output buffer, two samples per byte
+ * @param g722_data the encoded data
+ * @param len the number of bytes
+ * @return the number of samples produced
+ */
+int g722_decode(g722_state_t *s, apr_int16_t amp[], const apr_byte_t g722_data[], int len);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_G722_H */
@@ -38,16 +38,48 @@ typedef enum {
 	MPF_DETECTOR_EVENT_NOINPUT     /**< noinput event occurred */
 } mpf_detector_event_e;
 
+/** Modes of activity detector */
+typedef enum {
+	MPF_DETECTOR_MODE_FIXED,       /**< compare the level against the fixed threshold */
+	MPF_DETECTOR_MODE_ADAPTIVE     /**< compare the level against thresholds relative to the tracked noise floor */
+} mpf_detector_mode_e;
+
+/** Features of audio frame calculated by activity detector */
+typedef struct mpf_activity_features_t mpf_activity_features_t;
+struct mpf_activity_features_t {
+	/** Mean absolute amplitude (0 .. 32768), used as activity level */
+	apr_size_t level;
+	/** Mean energy (squared RMS amplitude, 0 .. 2^30) */
+	apr_size_t energy;
+	/** Number of sign changes between adjacent samples */
+	apr_size_t zero_crossings;
+};
+
 
 /** Create activity detector */
 MPF_DECLARE(mpf_activity_detector_t*) mpf_activity_detector_create(apr_pool_t *pool);
 
+/** Initialize activity detector to the defaults, so that it can be reused for another leg */
+MPF_DECLARE(void) mpf_activity_detector_init(mpf_activity_detector_t *detector);
+
 /** Reset activity detector */
 MPF_DECLARE(void) mpf_activity_detector_reset(mpf_activity_detector_t *detector);
 
 /** Set threshold of voice activity (silence) level */
 MPF_DECLARE(void) mpf_activity_detector_level_set(mpf_activity_detector_t *detector, apr_size_t level_threshold);
 
+/** Set mode of activity detection */
+MPF_DECLARE(void) mpf_activity_detector_mode_set(mpf_activity_detector_t *detector, mpf_detector_mode_e mode);
+
+/**
+ * Set thresholds of the adaptive mode relative to the noise floor.
+ * @param detector the detector to set thresholds for
+ * @param onset_ratio the ratio (percent) of the level to the noise floor to start activity
+ * @param offset_ratio the ratio (percent) of the level to the noise floor to keep activity
+ * @remark The offset ratio is lower than the onset one to provide hysteresis
+ */
+MPF_DECLARE(void) mpf_activity_detector_adaptive_ratio_set(mpf_activity_detector_t *detector, apr_size_t onset_ratio, apr_size_t offset_ratio);
+
 /** Set noinput timeout */
 MPF_DECLARE(void) mpf_activity_detector_noinput_timeout_set(mpf_activity_detector_t *detector, apr_size_t noinput_timeout);
 
@@ -60,6 +92,31 @@ MPF_DECLARE(void) mpf_activity_detector_silence_timeout_set(mpf_activity_detecto
 /** Process current frame, return detected event if any */
 MPF_DECLARE(mpf_detector_event_e) mpf_activity_detector_process(mpf_activity_detector_t *detector, const mpf_frame_t *frame);
 
+/** Check whether the last processed frame is considered voice (activity or transition to activity) */
+MPF_DECLARE(apt_bool_t) mpf_activity_detector_activity_check(const mpf_activity_detector_t *detector);
+
+/** Get probability (0 .. 1) of the last processed frame being speech, 0.5 corresponds to the activity threshold */
+MPF_DECLARE(float) mpf_activity_detector_speech_probability_get(const mpf_activity_detector_t *detector);
+
+/** Get the noise floor (mean absolute amplitude) tracked in the adaptive mode */
+MPF_DECLARE(apr_size_t) mpf_activity_detector_noise_floor_get(const mpf_activity_detector_t *detector);
+
+/** Enable calculation of energy and zero-crossings, besides the activity level, in the same pass */
+MPF_DECLARE(void) mpf_activity_detector_features_enable(mpf_activity_detector_t *detector, apt_bool_t enable);
+
+/** Get features of the last processed frame */
+MPF_DECLARE(const mpf_activity_features_t*) mpf_activity_detector_features_get(const mpf_activity_detector_t *detector);
+
+/**
+ * Calculate features of 16-bit linear PCM samples.
+ * @param samples the samples to calculate features of
+ * @param count the number of samples
+ * @param features the calculated features
+ * @param full whether to calculate energy and zero-crossings, or the level only
+ * @remark SIMD implementation is selected by CPU capabilities on the first call
+ */
+MPF_DECLARE(void) mpf_activity_features_calculate(const apr_int16_t *samples, apr_size_t count, mpf_activity_features_t *features, apt_bool_t full);
+
 
 APT_END_EXTERN_C
 
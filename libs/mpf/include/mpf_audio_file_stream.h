@@ -24,6 +24,7 @@
 
 #include "mpf_stream.h"
 #include "mpf_audio_file_descriptor.h"
+#include "apt_task.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -41,6 +42,20 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_file_stream_create(mpf_termination_t *termi
  */
 MPF_DECLARE(apt_bool_t) mpf_file_stream_modify(mpf_audio_stream_t *stream, mpf_audio_file_descriptor_t *descriptor);
 
+/**
+ * Create writer task, which writes the audio of file streams in blocks off the media thread.
+ * @param pool the pool to allocate memory from
+ */
+MPF_DECLARE(apt_task_t*) mpf_file_stream_writer_create(apr_pool_t *pool);
+
+/**
+ * Set writer task of file stream.
+ * @param stream file stream to set writer for
+ * @param writer the writer task (NULL to write on the media thread)
+ * @remark The writer task closes the files of the stream once their pending blocks are written.
+ */
+MPF_DECLARE(void) mpf_file_stream_writer_set(mpf_audio_stream_t *stream, apt_task_t *writer);
+
 APT_END_EXTERN_C
 
 #endif /* MPF_AUDIO_FILE_STREAM_H */
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_AUDIO_QUEUE_H
+#define MPF_AUDIO_QUEUE_H
+
+/**
+ * @file mpf_audio_queue.h
+ * @brief MPF Bounded Queue of Audio Frames between the Scheduler and a Consumer Thread
+ *
+ * A lock-free single-producer single-consumer queue, which the MPF scheduler
+ * thread writes frames to, one entry per frame time, and another thread
+ * (e.g. a decoder) reads them from. The capacity is set in msec of audio.
+ * Entries other than plain audio (control entries) are never dropped and
+ * may exceed the capacity by the reserve the queue is allocated with.
+ *
+ * Overflow policies
+ *    drop-oldest:    the oldest plain audio beyond the capacity is dropped by
+ *                    the consumer, so that it never lags behind the live audio
+ *                    by more than the capacity;
+ *    signal-backlog: audio beyond the capacity is rejected, so that the
+ *                    producer learns of the backlog and holds its state back.
+ */
+
+#include "mpf_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Overflow policy of audio queue */
+typedef enum {
+	MPF_AUDIO_QUEUE_DROP_OLDEST,   /**< drop the oldest audio beyond the capacity */
+	MPF_AUDIO_QUEUE_SIGNAL_BACKLOG /**< reject audio beyond the capacity */
+} mpf_audio_queue_policy_e;
+
+/** Opaque audio queue declaration */
+typedef struct mpf_audio_queue_t mpf_audio_queue_t;
+
+/** Occupancy metrics of audio queue */
+typedef struct mpf_audio_queue_stats_t mpf_audio_queue_stats_t;
+
+/** Occupancy metrics of audio queue, counted since creation or reset */
+struct mpf_audio_queue_stats_t {
+	/** Number of entries written */
+	apr_size_t written;
+	/** Number of audio entries dropped by drop-oldest */
+	apr_size_t dropped;
+	/** Number of entries rejected (the queue is full) */
+	apr_size_t rejected;
+	/** Max number of entries queued at once */
+	apr_size_t high_water;
+};
+
+/**
+ * Function called by the consumer for each audio entry dropped.
+ * @param obj the object set along with the function
+ * @param elem the entry, to release what it holds
+ */
+typedef void (*mpf_audio_queue_drop_f)(void *obj, void *elem);
+
+/**
+ * Create audio queue.
+ * @param capacity the capacity in msec of audio, one entry per CODEC_FRAME_TIME_BASE
+ * @param elem_size the size of each entry
+ * @param policy the overflow policy
+ * @param pool the pool to allocate memory from
+ * @remark Entries are stored in-place, the frame is copied into the entry once.
+ */
+MPF_DECLARE(mpf_audio_queue_t*) mpf_audio_queue_create(
+									apr_size_t capacity,
+									apr_size_t elem_size,
+									mpf_audio_queue_policy_e policy,
+									apr_pool_t *pool);
+
+/** Set function to release dropped entries by */
+MPF_DECLARE(void) mpf_audio_queue_drop_handler_set(mpf_audio_queue_t *queue, mpf_audio_queue_drop_f handler, void *obj);
+
+/**
+ * Get the next free entry to write to (producer side).
+ * @param queue the queue to write to
+ * @param audio whether the entry is plain audio, which the overflow policy applies to
+ * @return the entry to fill, or NULL if it is rejected
+ */
+MPF_DECLARE(void*) mpf_audio_queue_write_begin(mpf_audio_queue_t *queue, apt_bool_t audio);
+
+/** Commit the entry obtained by mpf_audio_queue_write_begin() (producer side) */
+MPF_DECLARE(void) mpf_audio_queue_write_commit(mpf_audio_queue_t *queue);
+
+/**
+ * Get the oldest entry to read from (consumer side), dropping the audio beyond the capacity first.
+ * @param queue the queue to read from
+ * @return the entry to process, or NULL if the queue is empty
+ */
+MPF_DECLARE(void*) mpf_audio_queue_read_begin(mpf_audio_queue_t *queue);
+
+/** Release the entry obtained by mpf_audio_queue_read_begin() (consumer side) */
+MPF_DECLARE(void) mpf_audio_queue_read_commit(mpf_audio_queue_t *queue);
+
+/** Get the number of entries queued (either side) */
+MPF_DECLARE(apr_size_t) mpf_audio_queue_size_get(const mpf_audio_queue_t *queue);
+
+/** Get the audio queued in msec (either side) */
+MPF_DECLARE(apr_size_t) mpf_audio_queue_occupancy_get(const mpf_audio_queue_t *queue);
+
+/** Get the capacity in msec */
+MPF_DECLARE(apr_size_t) mpf_audio_queue_capacity_get(const mpf_audio_queue_t *queue);
+
+/** Get occupancy metrics (either side, the counts of the other side may lag) */
+MPF_DECLARE(void) mpf_audio_queue_stats_get(const mpf_audio_queue_t *queue, mpf_audio_queue_stats_t *stats);
+
+/** Reset occupancy metrics, neither side may be active meanwhile */
+MPF_DECLARE(void) mpf_audio_queue_stats_reset(mpf_audio_queue_t *queue);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_AUDIO_QUEUE_H */
@@ -39,9 +39,15 @@ void mpf_buffer_destroy(mpf_buffer_t *buffer);
 /** Restart buffer */
 apt_bool_t mpf_buffer_restart(mpf_buffer_t *buffer);
 
-/** Write audio chunk to buffer */
+/** Write audio chunk to buffer (the chunk is copied) */
 apt_bool_t mpf_buffer_audio_write(mpf_buffer_t *buffer, void *data, apr_size_t size);
 
+/**
+ * Write reference to audio chunk to buffer (the chunk is not copied).
+ * @remark The chunk must be kept intact till it is read or the buffer is restarted.
+ */
+apt_bool_t mpf_buffer_audio_ref_write(mpf_buffer_t *buffer, const void *data, apr_size_t size);
+
 /** Write event to buffer */
 apt_bool_t mpf_buffer_event_write(mpf_buffer_t *buffer, mpf_frame_type_e event_type);
 
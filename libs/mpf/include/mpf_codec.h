@@ -39,6 +39,10 @@ struct mpf_codec_t {
 	const mpf_codec_attribs_t    *attribs;
 	/** Optional static codec descriptor (pt < 96) */
 	const mpf_codec_descriptor_t *static_descriptor;
+	/** Optional per instance state of stateful codecs (allocated on open) */
+	void                         *obj;
+	/** Pool to allocate per instance state from */
+	apr_pool_t                   *pool;
 };
 
 /** Table of codec virtual methods */
@@ -77,6 +81,8 @@ static APR_INLINE mpf_codec_t* mpf_codec_create(
 	codec->vtable = vtable;
 	codec->attribs = attribs;
 	codec->static_descriptor = descriptor;
+	codec->obj = NULL;
+	codec->pool = pool;
 	return codec;
 }
 
@@ -91,6 +97,8 @@ static APR_INLINE mpf_codec_t* mpf_codec_clone(mpf_codec_t *src_codec, apr_pool_
 	codec->vtable = src_codec->vtable;
 	codec->attribs = src_codec->attribs;
 	codec->static_descriptor = src_codec->static_descriptor;
+	codec->obj = NULL;
+	codec->pool = pool;
 	return codec;
 }
 
@@ -200,6 +200,13 @@ static APR_INLINE mpf_codec_descriptor_t* mpf_codec_list_descriptor_get(const mp
 /** Create linear PCM descriptor */
 MPF_DECLARE(mpf_codec_descriptor_t*) mpf_codec_lpcm_descriptor_create(apr_uint16_t sampling_rate, apr_byte_t channel_count, apr_pool_t *pool);
 
+/**
+ * Get the sampling rate of linear audio the codec is decoded to (encoded from).
+ * Normally it is the RTP clock rate, except for G722 which is sampled at 16kHz
+ * while advertised and timestamped at 8kHz (RFC3551).
+ */
+MPF_DECLARE(apr_uint16_t) mpf_codec_linear_sampling_rate_get(const mpf_codec_descriptor_t *descriptor);
+
 /** Create codec descriptor by capabilities */
 MPF_DECLARE(mpf_codec_descriptor_t*) mpf_codec_descriptor_create_by_capabilities(const mpf_codec_capabilities_t *capabilities, const mpf_codec_descriptor_t *peer, apr_pool_t *pool);
 
@@ -209,6 +216,9 @@ MPF_DECLARE(apt_bool_t) mpf_codec_descriptors_match(const mpf_codec_descriptor_t
 /** Match specified codec descriptor and the default lpcm one */
 MPF_DECLARE(apt_bool_t) mpf_codec_lpcm_descriptor_match(const mpf_codec_descriptor_t *descriptor);
 
+/** Get table of linear samples by G.711 code (256 entries), NULL if the codec is not PCMU or PCMA */
+MPF_DECLARE(const apr_int16_t*) mpf_codec_g711_decode_table_get(const apt_str_t *codec_name);
+
 /** Match codec descriptor by attribs specified */
 MPF_DECLARE(apt_bool_t) mpf_codec_descriptor_match_by_attribs(mpf_codec_descriptor_t *descriptor, const mpf_codec_descriptor_t *static_descriptor, const mpf_codec_attribs_t *attribs);
 
@@ -41,9 +41,52 @@ MPF_DECLARE(void) mpf_context_factory_destroy(mpf_context_factory_t *factory);
 
 /**
  * Process factory of media contexts.
+ * @return TRUE if media has been transferred by any of the contexts
+ * @remark Only the contexts with applied (non-empty) topology are processed.
  */
 MPF_DECLARE(apt_bool_t) mpf_context_factory_process(mpf_context_factory_t *factory);
 
+/**
+ * Set data layout of the media processing objects of the contexts.
+ * @param factory the factory to set data layout for
+ * @param enable whether to allocate the objects of all the contexts (bridges, codec streams
+ *               and frame buffers) from one arena in the order the topologies are applied
+ *               and processed in, rather than from the pools of the contexts (default)
+ * @remark Must be called from the thread processing the factory, or before it is processed.
+ */
+MPF_DECLARE(void) mpf_context_factory_arena_enable(mpf_context_factory_t *factory, apt_bool_t enable);
+
+/**
+ * Enable timing of the media processing objects of the contexts.
+ * @param factory the factory to enable timing for
+ * @param enable whether to time each object of the topologies applied from now on,
+ *               keeping the time of the last tick and the max over a rolling window
+ * @remark Must be called from the thread processing the factory, or before it is processed.
+ *         Once disabled, the objects are processed as they are, without any timing.
+ */
+MPF_DECLARE(void) mpf_context_factory_profile_enable(mpf_context_factory_t *factory, apt_bool_t enable);
+
+/**
+ * Log the objects taking the longest to process by the last tick, e.g. on a tick overrun.
+ * @param factory the factory to log the objects of
+ * @param count the max number of objects to log
+ * @remark Must be called from the thread processing the factory.
+ */
+MPF_DECLARE(void) mpf_context_factory_profile_trace(const mpf_context_factory_t *factory, apr_size_t count);
+
+/**
+ * Get the number of contexts created by the factory and not yet destroyed.
+ * @param factory the factory to get the number of contexts for
+ * @remark May be called from any thread
+ */
+MPF_DECLARE(apr_size_t) mpf_context_factory_count_get(const mpf_context_factory_t *factory);
+
+/**
+ * Get the factory context belongs to.
+ * @param context the context to get factory for
+ */
+MPF_DECLARE(mpf_context_factory_t*) mpf_context_factory_get(const mpf_context_t *context);
+
 /**
  * Create MPF context.
  * @param factory the factory context belongs to
@@ -122,6 +165,7 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_destroy(mpf_context_t *context);
 /**
  * Process context.
  * @param context the context to process
+ * @return TRUE if media has been transferred by any of the objects of the context
  */
 MPF_DECLARE(apt_bool_t) mpf_context_process(mpf_context_t *context);
 
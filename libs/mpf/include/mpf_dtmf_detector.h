@@ -29,6 +29,7 @@
 #include "apt.h"
 #include "mpf_frame.h"
 #include "mpf_stream.h"
+#include "mpf_activity_detector.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -101,6 +102,17 @@ MPF_DECLARE(apr_size_t) mpf_dtmf_detector_digits_lost(const struct mpf_dtmf_dete
  */
 MPF_DECLARE(void) mpf_dtmf_detector_reset(struct mpf_dtmf_detector_t *detector);
 
+/**
+ * Skip in-band detection while an activity detector reports silence.
+ * @param detector           The detector.
+ * @param activity_detector  The activity detector, which must process each
+ *                           frame before the DTMF detector does, or NULL
+ *                           to detect in all the frames.
+ */
+MPF_DECLARE(void) mpf_dtmf_detector_activity_detector_set(
+								struct mpf_dtmf_detector_t *detector,
+								const struct mpf_activity_detector_t *activity_detector);
+
 /**
  * Detect DTMF digits in the frame.
  * @param detector  The detector.
@@ -23,7 +23,9 @@
  *
  * Generator used to send DTMF tones. Capable to send digits
  * either in-band as audible tones or out-of-band according
- * to RFC4733.
+ * to RFC4733. In-band tones at 8, 16, 32 and 48 kHz are mixed
+ * from sine tables computed once per process and rate, when the
+ * first generator of the rate is created.
  */
 
 #include "apr_pools.h"
@@ -24,9 +24,43 @@
 
 #include "apt_task.h"
 #include "mpf_message.h"
+#include "mpf_scheduler.h"
+#include "mpf_rtp_stat.h"
 
 APT_BEGIN_EXTERN_C
 
+/** RTP receiver statistics totaled over the streams of an engine */
+typedef struct mpf_engine_rtp_stat_t mpf_engine_rtp_stat_t;
+
+/** RTP receiver statistics totaled over the streams of an engine */
+struct mpf_engine_rtp_stat_t {
+	/** Number of receivers closed */
+	apr_uint32_t streams;
+	/** Number of valid RTP packets received */
+	apr_uint32_t received_packets;
+	/** Number of invalid RTP packets received */
+	apr_uint32_t invalid_packets;
+	/** Number of packets discarded in jitter buffer */
+	apr_uint32_t discarded_packets;
+	/** Number of ignored packets */
+	apr_uint32_t ignored_packets;
+	/** Number of packets lost in network */
+	apr_uint32_t lost_packets;
+	/** Number of frames concealed in jitter buffer */
+	apr_uint32_t concealed_frames;
+	/** Number of times jitter buffer ran dry */
+	apr_uint32_t underruns;
+	/** Number of restarts */
+	apr_uint32_t restarts;
+	/** Max interarrival jitter of a receiver (RTP timestamp units) */
+	apr_uint32_t max_jitter;
+};
+
+/** Default number of scheduler threads */
+#define MPF_ENGINE_DEFAULT_THREAD_COUNT 1
+/** Max number of scheduler threads */
+#define MPF_ENGINE_MAX_THREAD_COUNT     64
+
 /** MPF task message definition */
 typedef apt_task_msg_t mpf_task_msg_t;
 
@@ -71,6 +105,30 @@ MPF_DECLARE(mpf_context_t*) mpf_engine_context_create(
  */
 MPF_DECLARE(apt_bool_t) mpf_engine_context_destroy(mpf_context_t *context);
 
+/**
+ * Get NUMA node of the shard the context is assigned to.
+ * @param engine the engine the context is created by
+ * @param context the context to get node of
+ * @return the node of the CPU the shard thread is pinned to, APT_NUMA_NODE_NONE if unpinned or unknown
+ * @remark Available once the engine task is started.
+ */
+MPF_DECLARE(int) mpf_engine_context_numa_node_get(const mpf_engine_t *engine, const mpf_context_t *context);
+
+/**
+ * Get CPU of the shard the context is assigned to.
+ * @param engine the engine the context is created by
+ * @param context the context to get CPU of
+ * @return the CPU the shard thread is pinned to, -1 if unpinned or unknown
+ * @remark Available once the engine task is started.
+ */
+MPF_DECLARE(int) mpf_engine_context_cpu_get(const mpf_engine_t *engine, const mpf_context_t *context);
+
+/**
+ * Get the number of contexts of the engine (any thread).
+ * @param engine the engine to get the number of contexts of
+ */
+MPF_DECLARE(apr_size_t) mpf_engine_context_count_get(const mpf_engine_t *engine);
+
 /**
  * Get external object associated with MPF context.
  * @param context the context to get object from
@@ -144,6 +202,21 @@ MPF_DECLARE(apt_bool_t) mpf_engine_topology_message_add(
  */
 MPF_DECLARE(apt_bool_t) mpf_engine_message_send(mpf_engine_t *engine, mpf_task_msg_t **task_msg);
 
+/**
+ * Set the number of scheduler threads.
+ * @param engine the engine to set the number of threads for
+ * @param count the number of threads to shard media contexts across
+ * @remark Must be called before the engine task is started. Each context
+ * is assigned to the least loaded thread upon creation and stays there.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_thread_count_set(mpf_engine_t *engine, apr_size_t count);
+
+/**
+ * Get the number of scheduler threads.
+ * @param engine the engine to get the number of threads for
+ */
+MPF_DECLARE(apr_size_t) mpf_engine_thread_count_get(const mpf_engine_t *engine);
+
 /**
  * Set scheduler rate.
  * @param engine the engine to set rate for
@@ -152,7 +225,76 @@ MPF_DECLARE(apt_bool_t) mpf_engine_message_send(mpf_engine_t *engine, mpf_task_m
 MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_rate_set(mpf_engine_t *engine, unsigned long rate);
 
 /**
- * Get the identifier of the engine .
+ * Set real-time (SCHED_FIFO) priority of the scheduler threads.
+ * @param engine the engine to set priority for
+ * @param priority the priority in range [1,99], 0 to keep the default policy
+ * @remark Must be called before the engine task is started.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_priority_set(mpf_engine_t *engine, int priority);
+
+/**
+ * Pin the scheduler threads to consecutive CPUs.
+ * @param engine the engine to set affinity for
+ * @param cpu the CPU to pin the first thread to, -1 to leave threads unpinned
+ * @remark Must be called before the engine task is started.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_cpu_affinity_set(mpf_engine_t *engine, int cpu);
+
+/**
+ * Set data layout of the media processing objects.
+ * @param engine the engine to set data layout for
+ * @param enable whether to allocate the objects of all the contexts of a scheduler thread
+ *               from one arena in processing order, rather than from the pools of the contexts
+ * @remark Must be called before the engine task is started.
+ */
+MPF_DECLARE(void) mpf_engine_topology_arena_set(mpf_engine_t *engine, apt_bool_t enable);
+
+/**
+ * Set offline (faster than real-time) mode, e.g. for batch processing of recorded audio.
+ * @param engine the engine to set mode for
+ * @param offline whether the scheduler threads run ticks back-to-back as long as media
+ *                is transferred by the contexts, rather than by the wall clock
+ * @remark Must be called before the engine task is started. Timers (e.g. noinput timeouts)
+ *         are driven by ticks, they expire in media time then.
+ */
+MPF_DECLARE(apt_bool_t) mpf_engine_offline_set(mpf_engine_t *engine, apt_bool_t offline);
+
+/**
+ * Set time budget of a tick, enabling profiling of the scheduler threads.
+ * @param engine the engine to set budget for
+ * @param budget the time a tick is to be processed within, 0 to disable profiling (default)
+ * @remark Must be called before the engine task is started. Once profiling is enabled, each stage
+ *         of a tick and each media processing object is timed, and a tick overrunning the budget
+ *         is logged (at most once a second per thread) along with the objects taking the longest.
+ *         Profiling disabled costs nothing but a test per tick.
+ */
+MPF_DECLARE(void) mpf_engine_tick_budget_set(mpf_engine_t *engine, apr_interval_time_t budget);
+
+/**
+ * Get tick statistics summed up over the scheduler threads.
+ * @param engine the engine to get statistics of
+ * @param stat the statistics to fill
+ */
+MPF_DECLARE(void) mpf_engine_scheduler_stat_get(const mpf_engine_t *engine, mpf_scheduler_stat_t *stat);
+
+/**
+ * Add the statistics of a closed RTP receiver to the totals of the engine (any thread).
+ * @param engine the engine the receiver belonged to
+ * @param rx_stat the statistics of the receiver
+ * @param jitter the last interarrival jitter of the receiver (RTP timestamp units)
+ */
+MPF_DECLARE(void) mpf_engine_rtp_stat_add(mpf_engine_t *engine, const rtp_rx_stat_t *rx_stat, apr_uint32_t jitter);
+
+/**
+ * Get RTP receiver statistics totaled over the closed streams of the engine.
+ * @param engine the engine to get statistics of
+ * @param stat the statistics to fill
+ * @remark The counters are 32 bits wide and wrap around.
+ */
+MPF_DECLARE(void) mpf_engine_rtp_stat_get(const mpf_engine_t *engine, mpf_engine_rtp_stat_t *stat);
+
+/**
+ * Get engine id.
  * @param engine the engine to get name of
  */
 MPF_DECLARE(const char*) mpf_engine_id_get(const mpf_engine_t *engine);
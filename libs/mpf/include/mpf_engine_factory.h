@@ -38,6 +38,14 @@ MPF_DECLARE(apt_bool_t) mpf_engine_factory_is_empty(const mpf_engine_factory_t *
 /** Select next available media engine. */
 MPF_DECLARE(mpf_engine_t*) mpf_engine_factory_engine_select(mpf_engine_factory_t *mpf_factory);
 
+/**
+ * Select the least loaded media engine (any thread).
+ * @param mpf_factory the factory to select engine from
+ * @remark The engine with the fewest contexts is selected, then the one with the lowest
+ *         tick lateness, and the engines loaded equally are taken in turn.
+ */
+MPF_DECLARE(mpf_engine_t*) mpf_engine_factory_engine_load_select(mpf_engine_factory_t *mpf_factory);
+
 /** Associate media engines with RTP termination factory. */
 MPF_DECLARE(apt_bool_t) mpf_engine_factory_rtp_factory_assign(mpf_engine_factory_t *mpf_factory, mpf_termination_factory_t *rtp_factory);
 
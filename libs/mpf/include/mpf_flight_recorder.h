@@ -0,0 +1,126 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_FLIGHT_RECORDER_H
+#define MPF_FLIGHT_RECORDER_H
+
+/**
+ * @file mpf_flight_recorder.h
+ * @brief MPF Flight Recorder of Media Streams
+ *
+ * A fixed-size ring of binary records per stream: RTP packets arrived along
+ * with the decisions of the jitter buffer, frames delivered, frames written
+ * to the sink and how long the write took, and detector events. The ring is
+ * written by the scheduler thread only, by a store and an atomic increment
+ * per record, and is always on. It is dumped to the log on an anomaly (a
+ * spike of discarded packets, no-input while RTP arrives) or on demand, from
+ * any thread: records overwritten while being copied are left out.
+ */
+
+#include "mpf_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Type of flight record */
+typedef enum {
+	MPF_FLIGHT_RTP_IN,     /**< RTP packet arrived: seq, ts, payload size, jitter buffer result (jb_result_t) */
+	MPF_FLIGHT_FRAME_OUT,  /**< frame read from the jitter buffer: frame type, marker */
+	MPF_FLIGHT_SINK_WRITE, /**< frame written to the sink: frame type, duration of the write in usec */
+	MPF_FLIGHT_DETECTOR,   /**< event of a detector (e.g. mpf_detector_event_e) */
+	MPF_FLIGHT_MARK        /**< mark set by the user of the stream, e.g. a request started */
+} mpf_flight_record_type_e;
+
+/** Flight record declaration */
+typedef struct mpf_flight_record_t mpf_flight_record_t;
+
+/** Flight record (16 bytes) */
+struct mpf_flight_record_t {
+	/** Time in usec since the recorder is created (wraps in 71 min) */
+	apr_uint32_t time;
+	/** Type of the record (mpf_flight_record_type_e) */
+	apr_byte_t   type;
+	/** Result, marker or event, depending on the type */
+	apr_byte_t   result;
+	/** RTP sequence number */
+	apr_uint16_t seq;
+	/** RTP timestamp */
+	apr_uint32_t ts;
+	/** Size, frame type or duration, depending on the type */
+	apr_uint32_t value;
+};
+
+/**
+ * Create flight recorder.
+ * @param capacity the number of records kept (rounded up to a power of 2)
+ * @param pool the pool to allocate memory from
+ */
+MPF_DECLARE(mpf_flight_recorder_t*) mpf_flight_recorder_create(apr_size_t capacity, apr_pool_t *pool);
+
+/**
+ * Add record (scheduler thread).
+ * @param recorder the recorder to add record to
+ * @param type the type of the record
+ * @param result the result, marker or event
+ * @param seq the RTP sequence number (0 if none)
+ * @param ts the RTP timestamp (0 if none)
+ * @param value the size, frame type or duration
+ */
+MPF_DECLARE(void) mpf_flight_recorder_put(
+						mpf_flight_recorder_t *recorder,
+						mpf_flight_record_type_e type,
+						apr_byte_t result,
+						apr_uint16_t seq,
+						apr_uint32_t ts,
+						apr_uint32_t value);
+
+/**
+ * Add record of RTP packet arrived (scheduler thread).
+ * @return TRUE if discarded packets spike, once per window of the ring
+ */
+MPF_DECLARE(apt_bool_t) mpf_flight_recorder_rtp_put(
+						mpf_flight_recorder_t *recorder,
+						apr_uint16_t seq,
+						apr_uint32_t ts,
+						apr_size_t size,
+						int jb_result);
+
+/**
+ * Check whether RTP packets arrived recently.
+ * @param recorder the recorder to check
+ * @param interval the interval to check within
+ */
+MPF_DECLARE(apt_bool_t) mpf_flight_recorder_rtp_check(const mpf_flight_recorder_t *recorder, apr_interval_time_t interval);
+
+/**
+ * Copy the records kept, oldest first (any thread).
+ * @param recorder the recorder to copy records of
+ * @param records the array to copy records to
+ * @param max_count the max number of records to copy (the latest ones are copied)
+ * @return the number of records copied
+ */
+MPF_DECLARE(apr_size_t) mpf_flight_recorder_snapshot(const mpf_flight_recorder_t *recorder, mpf_flight_record_t *records, apr_size_t max_count);
+
+/**
+ * Dump the records kept to the log (any thread).
+ * @param recorder the recorder to dump
+ * @param name the name of the stream, e.g. its address or the channel it is attached to
+ * @param reason the reason of the dump
+ */
+MPF_DECLARE(void) mpf_flight_recorder_dump(const mpf_flight_recorder_t *recorder, const char *name, const char *reason);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_FLIGHT_RECORDER_H */
@@ -32,7 +32,8 @@ typedef enum {
 	MEDIA_FRAME_TYPE_NONE  = 0x0, /**< none */
 	MEDIA_FRAME_TYPE_AUDIO = 0x1, /**< audio frame */
 	MEDIA_FRAME_TYPE_VIDEO = 0x2, /**< video frame */
-	MEDIA_FRAME_TYPE_EVENT = 0x4  /**< named event frame (RFC4733/RFC2833) */
+	MEDIA_FRAME_TYPE_EVENT = 0x4, /**< named event frame (RFC4733/RFC2833) */
+	MEDIA_FRAME_TYPE_SILENCE = 0x8 /**< silence signaled by comfort noise (RFC3389), a frame time of absent audio */
 } mpf_frame_type_e;
 
 /** Media frame marker */
@@ -40,7 +41,8 @@ typedef enum {
 	MPF_MARKER_NONE,           /**< none */
 	MPF_MARKER_START_OF_EVENT, /**< start of event */
 	MPF_MARKER_END_OF_EVENT,   /**< end of event */
-	MPF_MARKER_NEW_SEGMENT     /**< start of new segment (long-lasting events) */
+	MPF_MARKER_NEW_SEGMENT,    /**< start of new segment (long-lasting events) */
+	MPF_MARKER_GAP             /**< audio frame preceded by missing (lost or late) ones */
 } mpf_frame_marker_e;
 
 /** Media frame declaration */
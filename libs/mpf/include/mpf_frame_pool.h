@@ -0,0 +1,69 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_FRAME_POOL_H
+#define MPF_FRAME_POOL_H
+
+/**
+ * @file mpf_frame_pool.h
+ * @brief MPF Pool of Reference-Counted Frame Buffers
+ *
+ * Buffers are acquired by the scheduler thread the pool belongs to, and
+ * may be retained by the sinks a frame is written to, so that audio kept
+ * beyond the current tick is shared instead of copied per sink. The last
+ * release, from any thread, returns the buffer to the pool.
+ */
+
+#include "mpf_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default max number of buffers of a pool */
+#define MPF_FRAME_POOL_DEFAULT_SIZE 4096
+/** Size of a buffer, enough for 10 msec of 48 kHz stereo linear audio */
+#define MPF_FRAME_POOL_BUFFER_SIZE  1920
+
+/**
+ * Create pool of frame buffers.
+ * @param buffer_size the size of a buffer
+ * @param capacity the max number of buffers, allocated on demand
+ * @param pool the pool to allocate memory from
+ */
+MPF_DECLARE(mpf_frame_pool_t*) mpf_frame_pool_create(apr_size_t buffer_size, apr_size_t capacity, apr_pool_t *pool);
+
+/** Get the size of a buffer of the pool */
+MPF_DECLARE(apr_size_t) mpf_frame_pool_buffer_size_get(const mpf_frame_pool_t *pool);
+
+/**
+ * Acquire buffer referenced once.
+ * @param pool the pool to acquire buffer from
+ * @return the buffer, NULL if all the buffers are in use
+ * @remark Must be called by the scheduler thread the pool belongs to only.
+ */
+MPF_DECLARE(mpf_frame_ref_t*) mpf_frame_pool_acquire(mpf_frame_pool_t *pool);
+
+/** Get the data of a buffer */
+MPF_DECLARE(void*) mpf_frame_ref_data_get(mpf_frame_ref_t *ref);
+
+/** Take another reference of a buffer (any thread) */
+MPF_DECLARE(void) mpf_frame_ref_retain(mpf_frame_ref_t *ref);
+
+/** Drop a reference of a buffer, the last one returns the buffer to the pool (any thread) */
+MPF_DECLARE(void) mpf_frame_ref_release(mpf_frame_ref_t *ref);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_FRAME_POOL_H */
@@ -52,15 +52,52 @@ apt_bool_t mpf_jitter_buffer_restart(mpf_jitter_buffer_t *jb);
 /** Write audio data to jitter buffer */
 jb_result_t mpf_jitter_buffer_write(mpf_jitter_buffer_t *jb, void *buffer, apr_size_t size, apr_uint32_t ts, apr_byte_t marker);
 
+/**
+ * Allocate packet buffer to receive audio to, the first allocation determines the size.
+ * @return the buffer, or NULL if the requested size exceeds the one of the packets
+ */
+void* mpf_jitter_buffer_packet_alloc(mpf_jitter_buffer_t *jb, apr_size_t size);
+
+/** Free packet buffer, which stays in use as long as the audio written from it is buffered */
+void mpf_jitter_buffer_packet_free(mpf_jitter_buffer_t *jb, void *packet);
+
+/**
+ * Write audio data received to packet buffer to jitter buffer.
+ * @remark Frames of fixed size are referenced in the packet rather than copied.
+ * @param packet the packet buffer allocated by mpf_jitter_buffer_packet_alloc()
+ * @param buffer the audio data within the packet buffer
+ */
+jb_result_t mpf_jitter_buffer_packet_write(mpf_jitter_buffer_t *jb, void *packet, void *buffer, apr_size_t size, apr_uint32_t ts, apr_byte_t marker);
+
 /** Write named event to jitter buffer */
 jb_result_t mpf_jitter_buffer_event_write(mpf_jitter_buffer_t *jb, const mpf_named_event_frame_t *named_event, apr_uint32_t ts, apr_byte_t marker);
 
+/**
+ * Write comfort noise to jitter buffer.
+ * @remark The frames missing from the timestamp on till the next audio are read as silence frames,
+ *         rather than as lost ones, so that no audio is concealed or made up for them.
+ */
+jb_result_t mpf_jitter_buffer_silence_write(mpf_jitter_buffer_t *jb, apr_uint32_t ts);
+
 /** Read media frame from jitter buffer */
 apt_bool_t mpf_jitter_buffer_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame);
 
+/**
+ * Read media frame from jitter buffer by reference.
+ * @remark Received audio is referenced in place, valid till the next write to jitter buffer,
+ *         concealed audio is generated to the buffer of the frame.
+ */
+apt_bool_t mpf_jitter_buffer_ref_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame);
+
 /** Get current playout delay */
 apr_uint32_t mpf_jitter_buffer_playout_delay_get(const mpf_jitter_buffer_t *jb);
 
+/** Get the number of frames concealed so far */
+apr_uint32_t mpf_jitter_buffer_concealed_frames_get(const mpf_jitter_buffer_t *jb);
+
+/** Get the number of times the buffer ran dry while playing out */
+apr_uint32_t mpf_jitter_buffer_underruns_get(const mpf_jitter_buffer_t *jb);
+
 APT_END_EXTERN_C
 
 #endif /* MPF_JITTER_BUFFER_H */
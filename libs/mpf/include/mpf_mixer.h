@@ -43,6 +43,18 @@ MPF_DECLARE(mpf_object_t*) mpf_mixer_create(
 								const char *name,
 								apr_pool_t *pool);
 
+/**
+ * Mix linear samples of several inputs in one pass, the sum is saturated once.
+ * @param mix the buffer to store the mixed samples in (may be one of the inputs)
+ * @param inputs the array of input samples
+ * @param input_count the number of inputs (the mix is silence if none)
+ * @param samples the number of samples per input
+ */
+MPF_DECLARE(void) mpf_mixer_samples_mix(
+								apr_int16_t *mix,
+								const apr_int16_t * const *inputs,
+								apr_size_t input_count,
+								apr_size_t samples);
 
 APT_END_EXTERN_C
 
@@ -43,6 +43,13 @@ MPF_DECLARE(mpf_object_t*) mpf_multiplier_create(
 								const char *name,
 								apr_pool_t *pool);
 
+/**
+ * Set pool of frame buffers to share frames across sinks by.
+ * @param object the multiplier to set pool to
+ * @param frame_pool the pool of the scheduler thread the multiplier is processed by, NULL to copy frames
+ */
+MPF_DECLARE(void) mpf_multiplier_frame_pool_set(mpf_object_t *object, mpf_frame_pool_t *frame_pool);
+
 
 APT_END_EXTERN_C
 
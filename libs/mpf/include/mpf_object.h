@@ -35,7 +35,7 @@ struct mpf_object_t {
 	const char *name;
 	/** Virtual destroy */
 	apt_bool_t (*destroy)(mpf_object_t *object);
-	/** Virtual process */
+	/** Virtual process, returns TRUE if media has been transferred */
 	apt_bool_t (*process)(mpf_object_t *object);
 	/** Virtual trace of media path */
 	void (*trace)(mpf_object_t *object);
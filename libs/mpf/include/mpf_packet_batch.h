@@ -0,0 +1,74 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_PACKET_BATCH_H
+#define MPF_PACKET_BATCH_H
+
+/**
+ * @file mpf_packet_batch.h
+ * @brief MPF Batch of Outbound Packets (Flushed Once per Tick)
+ */ 
+
+#include <apr_network_io.h>
+#include "mpf_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default max number of packets staged before the batch is flushed implicitly */
+#define MPF_PACKET_BATCH_DEFAULT_SIZE 256
+/** Max size of a packet in the batch */
+#define MPF_PACKET_BATCH_MAX_PACKET_SIZE 1500
+
+/**
+ * Create batch of outbound packets.
+ * @param size the max number of packets to stage
+ * @param pool the pool to allocate memory from
+ * @remark The batch is not thread-safe and must be used by a single scheduler thread.
+ */
+MPF_DECLARE(mpf_packet_batch_t*) mpf_packet_batch_create(apr_size_t size, apr_pool_t *pool);
+
+/**
+ * Get buffer of the next packet to stage.
+ * @param batch the batch to stage packet in
+ * @param socket the socket to send packet through
+ * @param sockaddr the destination address, must stay valid till the batch is flushed
+ * @return the buffer of MPF_PACKET_BATCH_MAX_PACKET_SIZE bytes to write packet into
+ * @remark The batch is flushed implicitly if full. The packet is not staged till committed.
+ */
+MPF_DECLARE(void*) mpf_packet_batch_packet_get(
+								mpf_packet_batch_t *batch,
+								apr_socket_t *socket,
+								apr_sockaddr_t *sockaddr);
+
+/**
+ * Commit the packet obtained by mpf_packet_batch_packet_get().
+ * @param batch the batch to commit packet to
+ * @param size the size of the packet
+ */
+MPF_DECLARE(void) mpf_packet_batch_packet_commit(mpf_packet_batch_t *batch, apr_size_t size);
+
+/**
+ * Send staged packets.
+ * @param batch the batch to flush
+ * @return the number of packets failed to be sent
+ * @remark Consecutive packets sent through the same socket are sent by a single
+ * sendmmsg() call where available.
+ */
+MPF_DECLARE(apr_size_t) mpf_packet_batch_flush(mpf_packet_batch_t *batch);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_PACKET_BATCH_H */
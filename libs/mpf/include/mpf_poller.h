@@ -0,0 +1,82 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_POLLER_H
+#define MPF_POLLER_H
+
+/**
+ * @file mpf_poller.h
+ * @brief MPF Socket Poller (Readiness Notification for Media Sockets)
+ */ 
+
+#include <apr_network_io.h>
+#include "mpf_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default max number of sockets a poller can hold */
+#define MPF_POLLER_DEFAULT_SIZE 1024
+
+/** Opaque poller entry declaration */
+typedef struct mpf_poller_entry_t mpf_poller_entry_t;
+
+/** Prototype of handler invoked when a socket is readable */
+typedef void (*mpf_poller_handler_f)(void *obj);
+
+/**
+ * Create poller.
+ * @param size the max number of sockets the poller can hold
+ * @param pool the pool to allocate memory from
+ * @remark The poller is not thread-safe and must be used by a single scheduler thread.
+ */
+MPF_DECLARE(mpf_poller_t*) mpf_poller_create(apr_uint32_t size, apr_pool_t *pool);
+
+/** Destroy poller */
+MPF_DECLARE(void) mpf_poller_destroy(mpf_poller_t *poller);
+
+/**
+ * Add socket to poller.
+ * @param poller the poller to add socket to
+ * @param socket the socket to watch for readability
+ * @param handler the handler to invoke when the socket is readable
+ * @param obj the object to pass to the handler
+ * @param pool the pool to allocate entry from
+ * @return the entry to remove socket by, or NULL if the socket cannot be watched
+ */
+MPF_DECLARE(mpf_poller_entry_t*) mpf_poller_add(
+								mpf_poller_t *poller,
+								apr_socket_t *socket,
+								mpf_poller_handler_f handler,
+								void *obj,
+								apr_pool_t *pool);
+
+/**
+ * Remove socket from poller.
+ * @param poller the poller to remove socket from
+ * @param entry the entry returned by mpf_poller_add()
+ */
+MPF_DECLARE(apt_bool_t) mpf_poller_remove(mpf_poller_t *poller, mpf_poller_entry_t *entry);
+
+/**
+ * Dispatch readable sockets without blocking.
+ * @param poller the poller to process
+ * @remark Sockets with no pending data cost nothing.
+ */
+MPF_DECLARE(apt_bool_t) mpf_poller_process(mpf_poller_t *poller);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_POLLER_H */
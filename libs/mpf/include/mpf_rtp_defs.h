@@ -51,6 +51,8 @@ typedef struct rtp_rx_periodic_history_t rtp_rx_periodic_history_t;
 typedef struct rtp_receiver_t rtp_receiver_t;
 /** RTP transmitter declaration */
 typedef struct rtp_transmitter_t rtp_transmitter_t;
+/** Opaque impairment of RTP transmitter declaration */
+typedef struct rtp_tx_impairment_t rtp_tx_impairment_t;
 
 /** History of RTP receiver */
 struct rtp_rx_history_t {
@@ -109,6 +111,8 @@ struct rtp_receiver_t {
 	rtcp_rr_stat_t            rr_stat;
 	/** RTP receiver statistics */
 	rtp_rx_stat_t             stat;
+	/** RTCP XR VoIP metrics (calculated on close) */
+	rtcp_xr_voip_stat_t       xr_stat;
 	/** RTP history */
 	rtp_rx_history_t          history;
 	/** RTP periodic history */
@@ -144,6 +148,9 @@ struct rtp_transmitter_t {
 
 	/** RTCP statistics used in SR */
 	rtcp_sr_stat_t  sr_stat;
+
+	/** Loss and jitter injected into packets sent (NULL if none) */
+	rtp_tx_impairment_t *impairment;
 };
 
 
@@ -176,6 +183,7 @@ static APR_INLINE void rtp_transmitter_init(rtp_transmitter_t *transmitter)
 	transmitter->packet_size = 0;
 
 	mpf_rtcp_sr_stat_reset(&transmitter->sr_stat);
+	transmitter->impairment = NULL;
 }
 
 APT_END_EXTERN_C
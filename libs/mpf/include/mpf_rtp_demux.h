@@ -0,0 +1,101 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_RTP_DEMUX_H
+#define MPF_RTP_DEMUX_H
+
+/**
+ * @file mpf_rtp_demux.h
+ * @brief MPF RTP Demultiplexer (Single Shared RTP/RTCP Port)
+ */ 
+
+#include <apr_network_io.h>
+#include "mpf_rtp_descriptor.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max number of sockets sharing the port */
+#define MPF_RTP_DEMUX_MAX_SOCKET_COUNT 16
+
+/** Opaque demultiplexer entry (stream registration) declaration */
+typedef struct mpf_rtp_demux_entry_t mpf_rtp_demux_entry_t;
+
+/**
+ * Create demultiplexer and start its receiver thread.
+ * @param ip the local IP address to bind to
+ * @param port the shared RTP port (RTCP uses port + 1)
+ * @param socket_count the number of SO_REUSEPORT sockets to bind to the port
+ * @param pool the pool to allocate memory from
+ * @remark The receiver thread is stopped when the pool is cleared.
+ */
+MPF_DECLARE(mpf_rtp_demux_t*) mpf_rtp_demux_create(const char *ip, apr_port_t port, apr_size_t socket_count, apr_pool_t *pool);
+
+/** Get the shared RTP port */
+MPF_DECLARE(apr_port_t) mpf_rtp_demux_port_get(const mpf_rtp_demux_t *demux);
+
+/**
+ * Get the sockets to transmit through.
+ * @param demux the demultiplexer to get sockets of
+ * @param rtp_socket the RTP socket (output)
+ * @param rtcp_socket the RTCP socket, NULL if not bound (output)
+ * @param rtp_l_sockaddr the local RTP address (output)
+ * @param rtcp_l_sockaddr the local RTCP address (output)
+ */
+MPF_DECLARE(void) mpf_rtp_demux_sockets_get(
+							const mpf_rtp_demux_t *demux,
+							apr_socket_t **rtp_socket,
+							apr_socket_t **rtcp_socket,
+							apr_sockaddr_t **rtp_l_sockaddr,
+							apr_sockaddr_t **rtcp_l_sockaddr);
+
+/**
+ * Register a stream to receive packets from the remote addresses.
+ * @param demux the demultiplexer to register stream in
+ * @param rtp_r_sockaddr the remote RTP address
+ * @param rtcp_r_sockaddr the remote RTCP address (may be NULL)
+ * @param pool the pool to allocate entry from
+ * @remark Packets from an unknown address are matched by the SSRC learnt from known ones.
+ */
+MPF_DECLARE(mpf_rtp_demux_entry_t*) mpf_rtp_demux_add(
+							mpf_rtp_demux_t *demux,
+							const apr_sockaddr_t *rtp_r_sockaddr,
+							const apr_sockaddr_t *rtcp_r_sockaddr,
+							apr_pool_t *pool);
+
+/**
+ * Unregister a stream. No packet is queued to the entry afterwards.
+ * @param demux the demultiplexer to unregister stream from
+ * @param entry the entry returned by mpf_rtp_demux_add()
+ */
+MPF_DECLARE(void) mpf_rtp_demux_remove(mpf_rtp_demux_t *demux, mpf_rtp_demux_entry_t *entry);
+
+/**
+ * Read the next packet queued to the entry.
+ * @param entry the entry to read packet from
+ * @param buffer the buffer to copy packet to
+ * @param size the size of the buffer (input), the size of the packet (output)
+ * @param rtcp whether the packet has been received on the RTCP port (output)
+ * @remark Must be called by a single thread (the scheduler thread of the stream).
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_demux_packet_read(
+							mpf_rtp_demux_entry_t *entry,
+							void *buffer,
+							apr_size_t *size,
+							apt_bool_t *rtcp);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_RTP_DEMUX_H */
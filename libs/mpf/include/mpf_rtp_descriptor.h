@@ -40,6 +40,12 @@ typedef struct mpf_rtp_config_t mpf_rtp_config_t;
 typedef struct mpf_rtp_settings_t mpf_rtp_settings_t;
 /** Jitter buffer configuration declaration */
 typedef struct mpf_jb_config_t mpf_jb_config_t;
+/** RTP impairment configuration declaration */
+typedef struct mpf_rtp_impairment_t mpf_rtp_impairment_t;
+/** Opaque RTP demultiplexer (shared port) declaration */
+typedef struct mpf_rtp_demux_t mpf_rtp_demux_t;
+/** Opaque pool of RTP/RTCP port pairs declaration */
+typedef struct mpf_rtp_port_pool_t mpf_rtp_port_pool_t;
 
 /** MPF media state */
 typedef enum {
@@ -101,6 +107,13 @@ struct mpf_jb_config_t {
 	apr_byte_t adaptive;
 	/** Enable/disable time skew detection */
 	apr_byte_t time_skew_detection;
+	/** Max duration of packet loss concealment in msec (0 - disabled) */
+	apr_uint32_t concealment;
+	/**
+	 * Low-latency mode (for recognition): frames are played out at arrival, held for
+	 * the min playout delay only to be reordered, gaps are marked by MPF_MARKER_GAP
+	 */
+	apr_byte_t low_latency;
 };
 
 /** RTCP BYE transmission policy */
@@ -120,8 +133,24 @@ struct mpf_rtp_config_t {
 	apr_port_t        rtp_port_min;
 	/** Max RTP port */
 	apr_port_t        rtp_port_max;
-	/** Current RTP port */
+	/** Current RTP port (probed if there is no port pool) */
 	apr_port_t        rtp_port_cur;
+	/** Whether to allocate RTP ports at random within the range */
+	apt_bool_t        rtp_port_random;
+	/** Pool of the port pairs of the range (created by the RTP factory) */
+	mpf_rtp_port_pool_t *port_pool;
+	/** Number of sockets sharing rtp_port_min by all streams (0 - a port pair per stream) */
+	apr_size_t        shared_socket_count;
+	/** Demultiplexer of the shared port (created by the RTP factory) */
+	mpf_rtp_demux_t  *demux;
+};
+
+/** Impairment injected into RTP sent, e.g. for load testing over a clean network */
+struct mpf_rtp_impairment_t {
+	/** Probability of a packet to be dropped (per 10000) */
+	apr_uint16_t loss_rate;
+	/** Max time in msec a packet is held back by, which also reorders packets (0 - none) */
+	apr_uint16_t jitter;
 };
 
 /** RTP settings */
@@ -142,6 +171,10 @@ struct mpf_rtp_settings_t {
 	apr_uint16_t      rtcp_rx_resolution;
 	/** Jitter buffer config */
 	mpf_jb_config_t   jb_config;
+	/** Impairment of RTP sent */
+	mpf_rtp_impairment_t tx_impairment;
+	/** Number of records kept by the flight recorder of each stream (0 if disabled) */
+	apr_size_t        flight_recorder_size;
 };
 
 /** Initialize RTP media descriptor */
@@ -182,6 +215,8 @@ static APR_INLINE void mpf_jb_config_init(mpf_jb_config_t *jb_config)
 	jb_config->min_playout_delay = 0;
 	jb_config->max_playout_delay = 0;
 	jb_config->time_skew_detection = 1;
+	jb_config->concealment = 0;
+	jb_config->low_latency = 0;
 }
 
 /** Allocate RTP config */
@@ -193,6 +228,10 @@ static APR_INLINE mpf_rtp_config_t* mpf_rtp_config_alloc(apr_pool_t *pool)
 	rtp_config->rtp_port_cur = 0;
 	rtp_config->rtp_port_min = 0;
 	rtp_config->rtp_port_max = 0;
+	rtp_config->rtp_port_random = FALSE;
+	rtp_config->port_pool = NULL;
+	rtp_config->shared_socket_count = 0;
+	rtp_config->demux = NULL;
 	return rtp_config;
 }
 
@@ -208,6 +247,9 @@ static APR_INLINE mpf_rtp_settings_t* mpf_rtp_settings_alloc(apr_pool_t *pool)
 	rtp_settings->rtcp_tx_interval = 0;
 	rtp_settings->rtcp_rx_resolution = 0;
 	mpf_jb_config_init(&rtp_settings->jb_config);
+	rtp_settings->tx_impairment.loss_rate = 0;
+	rtp_settings->tx_impairment.jitter = 0;
+	rtp_settings->flight_recorder_size = 256;
 	return rtp_settings;
 }
 
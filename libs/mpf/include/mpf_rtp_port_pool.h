@@ -0,0 +1,65 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MPF_RTP_PORT_POOL_H
+#define MPF_RTP_PORT_POOL_H
+
+/**
+ * @file mpf_rtp_port_pool.h
+ * @brief MPF Pool of RTP/RTCP Port Pairs
+ *
+ * The port range of an RTP factory is split into even RTP/RTCP pairs, the
+ * ownership of which is tracked by a bitmap, while the free pairs are kept
+ * in a FIFO ring, so that a pair is taken and returned in constant time and
+ * a released pair is reused last. Optionally, the free pair taken is picked
+ * at random. The pool is used by the thread of a single media engine.
+ */
+
+#include "mpf_rtp_descriptor.h"
+
+APT_BEGIN_EXTERN_C
+
+/**
+ * Create pool of port pairs.
+ * @param port_min the min RTP port (rounded up to even)
+ * @param port_max the max RTP port (exclusive)
+ * @param random whether to pick free pairs at random
+ * @param pool the pool to allocate memory from
+ * @return the pool, NULL if the range holds no pair
+ */
+MPF_DECLARE(mpf_rtp_port_pool_t*) mpf_rtp_port_pool_create(apr_port_t port_min, apr_port_t port_max, apt_bool_t random, apr_pool_t *pool);
+
+/**
+ * Take a free port pair.
+ * @param port_pool the pool to take pair from
+ * @return the RTP port of the pair (RTCP uses port + 1), 0 if all the pairs are taken
+ */
+MPF_DECLARE(apr_port_t) mpf_rtp_port_pool_alloc(mpf_rtp_port_pool_t *port_pool);
+
+/**
+ * Return a port pair taken by mpf_rtp_port_pool_alloc().
+ * @param port_pool the pool to return pair to
+ * @param port the RTP port of the pair
+ * @return FALSE if the port is out of the range or the pair is not taken
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_port_pool_release(mpf_rtp_port_pool_t *port_pool, apr_port_t port);
+
+/** Get the number of free port pairs */
+MPF_DECLARE(apr_size_t) mpf_rtp_port_pool_free_count_get(const mpf_rtp_port_pool_t *port_pool);
+
+APT_END_EXTERN_C
+
+#endif /* MPF_RTP_PORT_POOL_H */
@@ -33,7 +33,34 @@ typedef struct rtp_rx_stat_t rtp_rx_stat_t;
 typedef struct rtcp_sr_stat_t rtcp_sr_stat_t;
 /** RTCP statistics used in Receiver Report (RR) */
 typedef struct rtcp_rr_stat_t rtcp_rr_stat_t;
+/** Burst/gap loss counters of RTP receiver */
+typedef struct rtp_burst_stat_t rtp_burst_stat_t;
+/** RTCP XR VoIP metrics (RFC 3611) */
+typedef struct rtcp_xr_voip_stat_t rtcp_xr_voip_stat_t;
 
+/** Min number of received packets between losses the losses are considered isolated at (gap) */
+#define RTP_BURST_GMIN 16
+
+/**
+ * Burst/gap loss counters of RTP receiver, updated per packet by the
+ * Markov model of RFC 3611 (Appendix A.2), where state 1 is the gap
+ * (received), state 2 the burst (received) and state 3 the burst (lost).
+ */
+struct rtp_burst_stat_t {
+	/** number of packets received since the last loss */
+	apr_uint32_t pkt;
+	/** number of losses in the current burst */
+	apr_uint32_t lost;
+	/** number of loss runs (consecutive lost or discarded packets) */
+	apr_uint32_t loss_runs;
+	/** transition counts */
+	apr_uint32_t c11;
+	apr_uint32_t c13;
+	apr_uint32_t c14;
+	apr_uint32_t c22;
+	apr_uint32_t c23;
+	apr_uint32_t c33;
+};
 
 /** RTP receiver statistics */
 struct rtp_rx_stat_t {
@@ -49,9 +76,16 @@ struct rtp_rx_stat_t {
 
 	/** number of lost in network packets */
 	apr_uint32_t lost_packets;
+	/** number of frames concealed in jitter buffer */
+	apr_uint32_t concealed_frames;
+	/** number of times jitter buffer ran dry */
+	apr_uint32_t underruns;
 
 	/** number of restarts */
 	apr_byte_t   restarts;
+
+	/** burst/gap loss counters */
+	rtp_burst_stat_t burst;
 };
 
 /** RTCP statistics used in Sender Report (SR)  */
@@ -88,7 +122,57 @@ struct rtcp_rr_stat_t {
 	apr_uint32_t dlsr;
 };
 
+/** RTCP XR VoIP metrics (RFC 3611 4.7) */
+struct rtcp_xr_voip_stat_t {
+	/** fraction of packets lost in network (of 256) */
+	apr_byte_t   loss_rate;
+	/** fraction of packets discarded in jitter buffer (of 256) */
+	apr_byte_t   discard_rate;
+	/** fraction of packets lost or discarded within bursts (of 256) */
+	apr_byte_t   burst_density;
+	/** fraction of packets lost or discarded within gaps (of 256) */
+	apr_byte_t   gap_density;
+	/** mean duration of bursts in msec */
+	apr_uint16_t burst_duration;
+	/** mean duration of gaps in msec */
+	apr_uint16_t gap_duration;
+	/** nominal (current) jitter buffer delay in msec */
+	apr_uint16_t jb_nominal;
+	/** max jitter buffer delay in msec */
+	apr_uint16_t jb_maximum;
+	/** conversational R factor [0, 100] */
+	apr_byte_t   r_factor;
+	/** listening quality MOS (x10) [10, 50] */
+	apr_byte_t   mos_lq;
+	/** conversational quality MOS (x10) [10, 50] */
+	apr_byte_t   mos_cq;
+};
 
+/**
+ * Update burst/gap loss counters by a received packet.
+ * @param burst_stat the counters to update
+ * @param lost the number of packets lost in network right before the packet
+ * @param discarded whether the packet is discarded (in jitter buffer)
+ */
+MPF_DECLARE(void) mpf_rtp_burst_stat_update(rtp_burst_stat_t *burst_stat, apr_uint32_t lost, apt_bool_t discarded);
+
+/**
+ * Calculate RTCP XR VoIP metrics of RTP receiver statistics.
+ * @param rx_stat the statistics of the receiver (the number of lost packets must be up to date)
+ * @param packet_time the packetization time in msec
+ * @param jb_nominal the nominal jitter buffer delay in msec
+ * @param jb_maximum the max jitter buffer delay in msec
+ * @param voip_stat the metrics to calculate
+ * @remark The R factor is estimated by the E-model (ITU-T G.107) with the impairments
+ *         of G.711 with no packet loss concealment (ITU-T G.113), and the delay of
+ *         the jitter buffer and packetization only, as the network delay is not known.
+ */
+MPF_DECLARE(void) mpf_rtcp_xr_voip_stat_calculate(
+						const rtp_rx_stat_t *rx_stat,
+						apr_uint16_t packet_time,
+						apr_uint16_t jb_nominal,
+						apr_uint16_t jb_maximum,
+						rtcp_xr_voip_stat_t *voip_stat);
 
 /** Reset RTCP SR statistics */
 static APR_INLINE void mpf_rtcp_sr_stat_reset(rtcp_sr_stat_t *sr_stat)
@@ -24,6 +24,7 @@
 
 #include "mpf_stream.h"
 #include "mpf_rtp_descriptor.h"
+#include "mpf_rtp_stat.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -55,6 +56,15 @@ MPF_DECLARE(apt_bool_t) mpf_rtp_stream_remove(mpf_audio_stream_t *stream);
  */
 MPF_DECLARE(apt_bool_t) mpf_rtp_stream_modify(mpf_audio_stream_t *stream, mpf_rtp_stream_descriptor_t *descriptor);
 
+/**
+ * Get the statistics of RTP receiver, final once the receiver is closed.
+ * @param stream RTP stream to get statistics of
+ * @param rx_stat the receiver statistics to fill
+ * @param voip_stat the RTCP XR VoIP metrics to fill (calculated on close)
+ * @return FALSE if no packet is received
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_stream_rx_stat_get(const mpf_audio_stream_t *stream, rtp_rx_stat_t *rx_stat, rtcp_xr_voip_stat_t *voip_stat);
+
 APT_END_EXTERN_C
 
 #endif /* MPF_RTP_STREAM_H */
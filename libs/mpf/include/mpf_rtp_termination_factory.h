@@ -24,6 +24,7 @@
 
 #include "mpf_termination_factory.h"
 #include "mpf_rtp_descriptor.h"
+#include "mpf_rtp_stat.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -34,6 +35,17 @@ MPF_DECLARE(mpf_termination_factory_t*) mpf_rtp_termination_factory_create(
 										mpf_rtp_config_t *rtp_config,
 										apr_pool_t *pool);
 
+/**
+ * Get the statistics of the RTP receiver of termination, final once the termination is subtracted.
+ * @param termination the termination to get statistics of
+ * @param rx_stat the receiver statistics to fill
+ * @param voip_stat the RTCP XR VoIP metrics to fill
+ * @return FALSE if the termination is not an RTP one, or no packet is received
+ */
+MPF_DECLARE(apt_bool_t) mpf_rtp_termination_rx_stat_get(
+										const mpf_termination_t *termination,
+										rtp_rx_stat_t *rx_stat,
+										rtcp_xr_voip_stat_t *voip_stat);
 
 APT_END_EXTERN_C
 
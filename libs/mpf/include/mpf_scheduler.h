@@ -26,6 +26,23 @@
 
 APT_BEGIN_EXTERN_C
 
+/** Tick statistics of scheduler */
+typedef struct mpf_scheduler_stat_t mpf_scheduler_stat_t;
+
+/** Tick statistics of scheduler */
+struct mpf_scheduler_stat_t {
+	/** Number of ticks elapsed */
+	apr_uint64_t tick_count;
+	/** Number of ticks started 1 ms or more past their deadline */
+	apr_uint64_t late_count;
+	/** Number of times the scheduler fell behind and resynchronized */
+	apr_uint64_t resync_count;
+	/** Sum of lateness of all the ticks (usec) */
+	apr_uint64_t total_lateness;
+	/** Max lateness of a tick (usec) */
+	apr_uint32_t max_lateness;
+};
+
 /** Prototype of scheduler callback */
 typedef void (*mpf_scheduler_proc_f)(mpf_scheduler_t *scheduler, void *obj);
 
@@ -54,6 +71,58 @@ MPF_DECLARE(apt_bool_t) mpf_scheduler_rate_set(
 								mpf_scheduler_t *scheduler,
 								unsigned long rate);
 
+/**
+ * Set real-time (SCHED_FIFO) priority of the scheduler thread.
+ * @param scheduler the scheduler to set priority for
+ * @param priority the priority in range [1,99], 0 to keep the default policy
+ * @remark Must be set before the scheduler is started. Currently applied on Linux only.
+ */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_priority_set(
+								mpf_scheduler_t *scheduler,
+								int priority);
+
+/**
+ * Pin the scheduler thread to the CPU.
+ * @param scheduler the scheduler to set affinity for
+ * @param cpu the CPU number, -1 to leave the thread unpinned
+ * @remark Must be set before the scheduler is started. Currently applied on Linux only.
+ */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_cpu_affinity_set(
+								mpf_scheduler_t *scheduler,
+								int cpu);
+
+/**
+ * Set offline (faster than real-time) mode.
+ * @param scheduler the scheduler to set mode for
+ * @param offline whether to run ticks back-to-back as long as media is transferred,
+ *                the ticks follow the wall clock while there is no media
+ * @remark The timer clock advances by ticks, it is thus faster than real-time too.
+ *         Not supported by the multimedia timers (Windows).
+ */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_offline_set(
+								mpf_scheduler_t *scheduler,
+								apt_bool_t offline);
+
+/**
+ * Report whether media has been transferred during the current tick.
+ * @param scheduler the scheduler running the tick
+ * @param busy whether media has been transferred
+ * @remark Called from the media processing callback, used in offline mode only.
+ */
+MPF_DECLARE(void) mpf_scheduler_tick_busy_set(
+								mpf_scheduler_t *scheduler,
+								apt_bool_t busy);
+
+/**
+ * Get tick statistics.
+ * @param scheduler the scheduler to get statistics of
+ * @param stat the statistics to fill
+ * @remark Lateness is measured by the Linux (absolute deadline) backend only.
+ */
+MPF_DECLARE(void) mpf_scheduler_stat_get(
+								const mpf_scheduler_t *scheduler,
+								mpf_scheduler_stat_t *stat);
+
 /** Start scheduler */
 MPF_DECLARE(apt_bool_t) mpf_scheduler_start(mpf_scheduler_t *scheduler);
 
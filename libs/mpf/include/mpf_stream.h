@@ -55,6 +55,8 @@ struct mpf_audio_stream_t {
 	mpf_codec_descriptor_t          *tx_descriptor;
 	/** Tx event descriptor */
 	mpf_codec_descriptor_t          *tx_event_descriptor;
+	/** Flight recorder of the stream (NULL if none) */
+	mpf_flight_recorder_t           *recorder;
 };
 
 /** Video stream */
@@ -86,6 +88,21 @@ struct mpf_audio_stream_vtable_t {
 
 	/** Virtual trace method */
 	void (*trace)(mpf_audio_stream_t *stream, mpf_stream_direction_e direction, apt_text_stream_t *output);
+
+	/**
+	 * Virtual read frame by reference method (optional).
+	 * Audio may be handed over by pointing the buffer of the frame to the storage of the source,
+	 * which stays intact till the next read, otherwise it is read to the buffer of the frame.
+	 * The buffer must not be modified, nor referenced beyond the current tick.
+	 */
+	apt_bool_t (*read_frame_ref)(mpf_audio_stream_t *stream, mpf_frame_t *frame);
+
+	/**
+	 * Virtual write frame with reference-counted buffer method (optional).
+	 * The buffer of the frame is the data of the reference, which may be retained by
+	 * mpf_frame_ref_retain() to keep audio beyond the call instead of copying it.
+	 */
+	apt_bool_t (*write_frame_ref)(mpf_audio_stream_t *stream, const mpf_frame_t *frame, mpf_frame_ref_t *ref);
 };
 
 /** Create audio stream */
@@ -137,6 +154,20 @@ static APR_INLINE apt_bool_t mpf_audio_stream_frame_read(mpf_audio_stream_t *str
 	return TRUE;
 }
 
+/**
+ * Read frame by reference, if supported by the source, otherwise by copy.
+ * @param stream the source to read frame from
+ * @param frame the frame to read, the buffer of which is reset to the buffer of the caller in advance
+ */
+static APR_INLINE apt_bool_t mpf_audio_stream_frame_ref_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	if(stream->vtable->read_frame_ref)
+		return stream->vtable->read_frame_ref(stream,frame);
+	if(stream->vtable->read_frame)
+		return stream->vtable->read_frame(stream,frame);
+	return TRUE;
+}
+
 /** Open audio stream transmitter */
 static APR_INLINE apt_bool_t mpf_audio_stream_tx_open(mpf_audio_stream_t *stream, mpf_codec_t *codec)
 {
@@ -161,6 +192,16 @@ static APR_INLINE apt_bool_t mpf_audio_stream_frame_write(mpf_audio_stream_t *st
 	return TRUE;
 }
 
+/** Write frame with reference-counted buffer, if supported by the sink, otherwise as usual */
+static APR_INLINE apt_bool_t mpf_audio_stream_frame_ref_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame, mpf_frame_ref_t *ref)
+{
+	if(stream->vtable->write_frame_ref)
+		return stream->vtable->write_frame_ref(stream,frame,ref);
+	if(stream->vtable->write_frame)
+		return stream->vtable->write_frame(stream,frame);
+	return TRUE;
+}
+
 /** Trace media path */
 MPF_DECLARE(void) mpf_audio_stream_trace(mpf_audio_stream_t *stream, mpf_stream_direction_e direction, apt_text_stream_t *output);
 
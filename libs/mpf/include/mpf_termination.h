@@ -63,6 +63,12 @@ struct mpf_termination_t {
 	const mpf_codec_manager_t      *codec_manager;
 	/** Timer queue */
 	apt_timer_queue_t              *timer_queue;
+	/** Socket poller (NULL if sockets are to be polled on every tick) */
+	mpf_poller_t                   *poller;
+	/** Batch of outbound packets (NULL if packets are to be sent immediately) */
+	mpf_packet_batch_t             *tx_batch;
+	/** Pool of frame buffers shared across sinks (NULL if frames are not shared) */
+	mpf_frame_pool_t               *frame_pool;
 	/** Termination factory entire termination created by */
 	mpf_termination_factory_t      *termination_factory;
 	/** Table of virtual methods */
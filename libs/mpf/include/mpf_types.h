@@ -35,6 +35,21 @@ typedef struct mpf_engine_factory_t mpf_engine_factory_t;
 /** Opaque MPF scheduler declaration */
 typedef struct mpf_scheduler_t mpf_scheduler_t;
 
+/** Opaque MPF poller declaration */
+typedef struct mpf_poller_t mpf_poller_t;
+
+/** Opaque MPF batch of outbound packets declaration */
+typedef struct mpf_packet_batch_t mpf_packet_batch_t;
+
+/** Opaque MPF pool of frame buffers declaration */
+typedef struct mpf_frame_pool_t mpf_frame_pool_t;
+
+/** Opaque MPF reference-counted frame buffer declaration */
+typedef struct mpf_frame_ref_t mpf_frame_ref_t;
+
+/** Opaque MPF flight recorder of a stream declaration */
+typedef struct mpf_flight_recorder_t mpf_flight_recorder_t;
+
 /** Opaque codec manager declaration */
 typedef struct mpf_codec_manager_t mpf_codec_manager_t;
 
@@ -17,6 +17,40 @@
 #include "mpf_activity_detector.h"
 #include "apt_log.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MPF_ACTIVITY_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+/* AVX2 is not assumed at compile-time, but selected by CPU capabilities */
+#define MPF_ACTIVITY_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MPF_ACTIVITY_NEON
+#include <arm_neon.h>
+#endif
+
+/** Max number of vectors accumulated in 16/32-bit lanes before being added to the totals */
+#define MPF_ACTIVITY_BLOCK_SIZE 4096
+
+/** Default ratio (percent) of the level to the noise floor to start activity in the adaptive mode */
+#define MPF_DETECTOR_ONSET_RATIO  300
+/** Default ratio (percent) of the level to the noise floor to keep activity in the adaptive mode */
+#define MPF_DETECTOR_OFFSET_RATIO 200
+/** Lowest threshold in the adaptive mode, so that digital silence does not make any noise speech */
+#define MPF_DETECTOR_MIN_LEVEL    40
+/** Period (msec) the noise floor is initially averaged over, before any activity is detected */
+#define MPF_DETECTOR_CALIBRATION_TIME 200
+/** Fractional bits of the noise floor */
+#define MPF_DETECTOR_FLOOR_SHIFT  4
+/** Update rates (log2 of frames) of the noise floor */
+#define MPF_DETECTOR_FLOOR_FALL_RATE     2  /* fast, track quieter noise */
+#define MPF_DETECTOR_FLOOR_RISE_RATE     5  /* slow, track louder noise */
+#define MPF_DETECTOR_FLOOR_VOICE_RATE    11 /* very slow, recover from a step of noise taken for speech */
+
 /** Detector states */
 typedef enum {
 	DETECTOR_STATE_INACTIVITY,           /**< inactivity detected */
@@ -30,6 +64,19 @@ struct mpf_activity_detector_t {
 	/* voice activity (silence) level threshold */
 	apr_size_t           level_threshold;
 
+	/* mode of activity detection */
+	mpf_detector_mode_e  mode;
+	/* ratio (percent) of the level to the noise floor to start activity */
+	apr_size_t           onset_ratio;
+	/* ratio (percent) of the level to the noise floor to keep activity */
+	apr_size_t           offset_ratio;
+	/* tracked noise floor (fixed-point, MPF_DETECTOR_FLOOR_SHIFT fractional bits) */
+	apr_size_t           noise_floor;
+	/* period (msec) the noise floor has been tracked for */
+	apr_size_t           floor_duration;
+	/* speech probability of the last processed frame */
+	float                speech_probability;
+
 	/* period of activity required to complete transition to active state */
 	apr_size_t           speech_timeout;
 	/* period of inactivity required to complete transition to inactive state */
@@ -41,26 +88,64 @@ struct mpf_activity_detector_t {
 	mpf_detector_state_e state;
 	/* duration spent in current state  */
 	apr_size_t           duration;
+
+	/* whether to calculate energy and zero-crossings */
+	apt_bool_t           features_enabled;
+	/* features of the last processed frame */
+	mpf_activity_features_t features;
 };
 
+/** Sums accumulated over samples */
+typedef struct {
+	apr_uint64_t abs_sum;
+	apr_uint64_t energy_sum;
+	apr_size_t   zero_crossings;
+} mpf_activity_sums_t;
+
+/** Prototype of features kernel, sample 0 is left to the caller */
+typedef void (*mpf_activity_kernel_f)(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full);
+
+static void mpf_activity_kernel_select(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full);
+
+/** Kernel in use, resolved on the first call (the race is benign) */
+static mpf_activity_kernel_f mpf_activity_kernel = mpf_activity_kernel_select;
+
 /** Create activity detector */
 MPF_DECLARE(mpf_activity_detector_t*) mpf_activity_detector_create(apr_pool_t *pool)
 {
 	mpf_activity_detector_t *detector = apr_palloc(pool,sizeof(mpf_activity_detector_t));
+	mpf_activity_detector_init(detector);
+	return detector;
+}
+
+/** Initialize activity detector to the defaults */
+MPF_DECLARE(void) mpf_activity_detector_init(mpf_activity_detector_t *detector)
+{
 	detector->level_threshold = 200; /* 0 .. 65536 */
+	detector->mode = MPF_DETECTOR_MODE_FIXED;
+	detector->onset_ratio = MPF_DETECTOR_ONSET_RATIO;
+	detector->offset_ratio = MPF_DETECTOR_OFFSET_RATIO;
+	detector->noise_floor = 0;
+	detector->floor_duration = 0;
+	detector->speech_probability = 0;
 	detector->speech_timeout = 300; /* 0.3 s */
 	detector->silence_timeout = 300; /* 0.3 s */
 	detector->noinput_timeout = 5000; /* 5 s */
 	detector->duration = 0;
 	detector->state = DETECTOR_STATE_INACTIVITY;
-	return detector;
+	detector->features_enabled = FALSE;
+	detector->features.level = 0;
+	detector->features.energy = 0;
+	detector->features.zero_crossings = 0;
 }
 
 /** Reset activity detector */
 MPF_DECLARE(void) mpf_activity_detector_reset(mpf_activity_detector_t *detector)
 {
+	/* the noise floor is a property of the leg, keep tracking it across requests */
 	detector->duration = 0;
 	detector->state = DETECTOR_STATE_INACTIVITY;
+	detector->speech_probability = 0;
 }
 
 /** Set threshold of voice activity (silence) level */
@@ -69,6 +154,30 @@ MPF_DECLARE(void) mpf_activity_detector_level_set(mpf_activity_detector_t *detec
 	detector->level_threshold = level_threshold;
 }
 
+/** Set mode of activity detection */
+MPF_DECLARE(void) mpf_activity_detector_mode_set(mpf_activity_detector_t *detector, mpf_detector_mode_e mode)
+{
+	if(mode == MPF_DETECTOR_MODE_ADAPTIVE && detector->mode != MPF_DETECTOR_MODE_ADAPTIVE) {
+		/* calibrate the noise floor again */
+		detector->noise_floor = 0;
+		detector->floor_duration = 0;
+	}
+	detector->mode = mode;
+}
+
+/** Set thresholds of the adaptive mode relative to the noise floor */
+MPF_DECLARE(void) mpf_activity_detector_adaptive_ratio_set(mpf_activity_detector_t *detector, apr_size_t onset_ratio, apr_size_t offset_ratio)
+{
+	if(onset_ratio <= 100) {
+		onset_ratio = MPF_DETECTOR_ONSET_RATIO;
+	}
+	if(offset_ratio <= 100 || offset_ratio > onset_ratio) {
+		offset_ratio = onset_ratio;
+	}
+	detector->onset_ratio = onset_ratio;
+	detector->offset_ratio = offset_ratio;
+}
+
 /** Set noinput timeout */
 MPF_DECLARE(void) mpf_activity_detector_noinput_timeout_set(mpf_activity_detector_t *detector, apr_size_t noinput_timeout)
 {
@@ -94,23 +203,263 @@ static APR_INLINE void mpf_activity_detector_state_change(mpf_activity_detector_
 	detector->state = state;
 }
 
-static apr_size_t mpf_activity_detector_level_calculate(const mpf_frame_t *frame)
+/** Accumulate samples [from, count) one by one */
+static void mpf_activity_scalar_accumulate(const apr_int16_t *samples, apr_size_t from, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full)
 {
-	apr_size_t sum = 0;
-	apr_size_t count = frame->codec_frame.size/2;
-	const apr_int16_t *cur = frame->codec_frame.buffer;
-	const apr_int16_t *end = cur + count;
+	apr_size_t i;
+	for(i=from; i<count; i++) {
+		apr_int32_t value = samples[i];
+		apr_int32_t sign = value >> 31;
+		sums->abs_sum += (apr_uint32_t)((value ^ sign) - sign);
+		if(full == TRUE) {
+			sums->energy_sum += (apr_uint32_t)(value * value);
+			if(i && (value ^ samples[i-1]) < 0) {
+				sums->zero_crossings++;
+			}
+		}
+	}
+}
+
+static void mpf_activity_scalar_kernel(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full)
+{
+	mpf_activity_scalar_accumulate(samples,1,count,sums,full);
+}
 
-	for(; cur < end; cur++) {
-		if(*cur < 0) {
-			sum -= *cur;
+#ifdef MPF_ACTIVITY_SSE2
+static void mpf_activity_sse2_kernel(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full)
+{
+	apr_uint32_t abs_lanes[4];
+	apr_uint64_t energy_lanes[2];
+	apr_uint16_t zc_lanes[8];
+	const __m128i zero = _mm_setzero_si128();
+	apr_size_t i = 1;
+	apr_size_t j;
+	while(i + 8 <= count) {
+		__m128i abs_acc = zero;
+		__m128i energy_acc = zero;
+		__m128i zc_acc = zero;
+		apr_size_t block = 0;
+		for(; i + 8 <= count && block < MPF_ACTIVITY_BLOCK_SIZE; i += 8, block++) {
+			__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+			__m128i sign = _mm_srai_epi16(x,15);
+			/* absolute value, -32768 turns into 32768 treated as unsigned */
+			__m128i a = _mm_sub_epi16(_mm_xor_si128(x,sign),sign);
+			abs_acc = _mm_add_epi32(abs_acc,_mm_unpacklo_epi16(a,zero));
+			abs_acc = _mm_add_epi32(abs_acc,_mm_unpackhi_epi16(a,zero));
+			if(full == TRUE) {
+				__m128i prev = _mm_loadu_si128((const __m128i*)(samples + i - 1));
+				/* pairwise sums of squares fit 32 bits unsigned */
+				__m128i sq = _mm_madd_epi16(x,x);
+				energy_acc = _mm_add_epi64(energy_acc,_mm_unpacklo_epi32(sq,zero));
+				energy_acc = _mm_add_epi64(energy_acc,_mm_unpackhi_epi32(sq,zero));
+				/* -1 in lanes where the sign differs from the previous sample */
+				zc_acc = _mm_sub_epi16(zc_acc,_mm_srai_epi16(_mm_xor_si128(x,prev),15));
+			}
 		}
-		else {
-			sum += *cur;
+		_mm_storeu_si128((__m128i*)abs_lanes,abs_acc);
+		_mm_storeu_si128((__m128i*)energy_lanes,energy_acc);
+		_mm_storeu_si128((__m128i*)zc_lanes,zc_acc);
+		for(j=0; j<4; j++) {
+			sums->abs_sum += abs_lanes[j];
+		}
+		sums->energy_sum += energy_lanes[0] + energy_lanes[1];
+		for(j=0; j<8; j++) {
+			sums->zero_crossings += zc_lanes[j];
+		}
+	}
+	mpf_activity_scalar_accumulate(samples,i,count,sums,full);
+}
+#endif
+
+#ifdef MPF_ACTIVITY_AVX2
+__attribute__((target("avx2")))
+static void mpf_activity_avx2_kernel(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full)
+{
+	apr_uint32_t abs_lanes[8];
+	apr_uint64_t energy_lanes[4];
+	apr_uint16_t zc_lanes[16];
+	const __m256i zero = _mm256_setzero_si256();
+	apr_size_t i = 1;
+	apr_size_t j;
+	while(i + 16 <= count) {
+		__m256i abs_acc = zero;
+		__m256i energy_acc = zero;
+		__m256i zc_acc = zero;
+		apr_size_t block = 0;
+		for(; i + 16 <= count && block < MPF_ACTIVITY_BLOCK_SIZE; i += 16, block++) {
+			__m256i x = _mm256_loadu_si256((const __m256i*)(samples + i));
+			/* absolute value, -32768 turns into 32768 treated as unsigned */
+			__m256i a = _mm256_abs_epi16(x);
+			abs_acc = _mm256_add_epi32(abs_acc,_mm256_unpacklo_epi16(a,zero));
+			abs_acc = _mm256_add_epi32(abs_acc,_mm256_unpackhi_epi16(a,zero));
+			if(full == TRUE) {
+				__m256i prev = _mm256_loadu_si256((const __m256i*)(samples + i - 1));
+				/* pairwise sums of squares fit 32 bits unsigned */
+				__m256i sq = _mm256_madd_epi16(x,x);
+				energy_acc = _mm256_add_epi64(energy_acc,_mm256_unpacklo_epi32(sq,zero));
+				energy_acc = _mm256_add_epi64(energy_acc,_mm256_unpackhi_epi32(sq,zero));
+				/* -1 in lanes where the sign differs from the previous sample */
+				zc_acc = _mm256_sub_epi16(zc_acc,_mm256_srai_epi16(_mm256_xor_si256(x,prev),15));
+			}
+		}
+		_mm256_storeu_si256((__m256i*)abs_lanes,abs_acc);
+		_mm256_storeu_si256((__m256i*)energy_lanes,energy_acc);
+		_mm256_storeu_si256((__m256i*)zc_lanes,zc_acc);
+		for(j=0; j<8; j++) {
+			sums->abs_sum += abs_lanes[j];
+		}
+		for(j=0; j<4; j++) {
+			sums->energy_sum += energy_lanes[j];
+		}
+		for(j=0; j<16; j++) {
+			sums->zero_crossings += zc_lanes[j];
+		}
+	}
+	mpf_activity_scalar_accumulate(samples,i,count,sums,full);
+}
+#endif
+
+#ifdef MPF_ACTIVITY_NEON
+static void mpf_activity_neon_kernel(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full)
+{
+	apr_size_t i = 1;
+	while(i + 8 <= count) {
+		uint32x4_t abs_acc = vdupq_n_u32(0);
+		uint64x2_t energy_acc = vdupq_n_u64(0);
+		int16x8_t zc_acc = vdupq_n_s16(0);
+		apr_size_t block = 0;
+		for(; i + 8 <= count && block < MPF_ACTIVITY_BLOCK_SIZE; i += 8, block++) {
+			int16x8_t x = vld1q_s16(samples + i);
+			/* absolute value, -32768 turns into 32768 treated as unsigned */
+			abs_acc = vpadalq_u16(abs_acc,vreinterpretq_u16_s16(vabsq_s16(x)));
+			if(full == TRUE) {
+				int16x8_t prev = vld1q_s16(samples + i - 1);
+				int32x4_t sq_low = vmull_s16(vget_low_s16(x),vget_low_s16(x));
+				int32x4_t sq_high = vmull_s16(vget_high_s16(x),vget_high_s16(x));
+				energy_acc = vpadalq_u32(energy_acc,vreinterpretq_u32_s32(sq_low));
+				energy_acc = vpadalq_u32(energy_acc,vreinterpretq_u32_s32(sq_high));
+				/* -1 in lanes where the sign differs from the previous sample */
+				zc_acc = vsubq_s16(zc_acc,vshrq_n_s16(veorq_s16(x,prev),15));
+			}
+		}
+		sums->abs_sum += vgetq_lane_u64(vpaddlq_u32(abs_acc),0) + vgetq_lane_u64(vpaddlq_u32(abs_acc),1);
+		sums->energy_sum += vgetq_lane_u64(energy_acc,0) + vgetq_lane_u64(energy_acc,1);
+		{
+			uint64x2_t zc = vpaddlq_u32(vpaddlq_u16(vreinterpretq_u16_s16(zc_acc)));
+			sums->zero_crossings += (apr_size_t)(vgetq_lane_u64(zc,0) + vgetq_lane_u64(zc,1));
 		}
 	}
+	mpf_activity_scalar_accumulate(samples,i,count,sums,full);
+}
+#endif
+
+/** Resolve the kernel by CPU capabilities, then run it */
+static void mpf_activity_kernel_select(const apr_int16_t *samples, apr_size_t count, mpf_activity_sums_t *sums, apt_bool_t full)
+{
+	mpf_activity_kernel_f kernel = mpf_activity_scalar_kernel;
+#if defined(MPF_ACTIVITY_NEON)
+	kernel = mpf_activity_neon_kernel;
+#elif defined(MPF_ACTIVITY_SSE2)
+	kernel = mpf_activity_sse2_kernel;
+#endif
+#ifdef MPF_ACTIVITY_AVX2
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		kernel = mpf_activity_avx2_kernel;
+	}
+#endif
+	mpf_activity_kernel = kernel;
+	kernel(samples,count,sums,full);
+}
+
+/** Calculate features of 16-bit linear PCM samples */
+MPF_DECLARE(void) mpf_activity_features_calculate(const apr_int16_t *samples, apr_size_t count, mpf_activity_features_t *features, apt_bool_t full)
+{
+	mpf_activity_sums_t sums;
+	features->level = 0;
+	features->energy = 0;
+	features->zero_crossings = 0;
+	if(!count) {
+		return;
+	}
+
+	sums.abs_sum = 0;
+	sums.energy_sum = 0;
+	sums.zero_crossings = 0;
+	mpf_activity_scalar_accumulate(samples,0,1,&sums,full);
+	mpf_activity_kernel(samples,count,&sums,full);
+
+	features->level = (apr_size_t)(sums.abs_sum / count);
+	if(full == TRUE) {
+		features->energy = (apr_size_t)(sums.energy_sum / count);
+		features->zero_crossings = sums.zero_crossings;
+	}
+}
+
+/** Get the threshold of the current state in the adaptive mode */
+static apr_size_t mpf_activity_detector_adaptive_threshold_get(const mpf_activity_detector_t *detector)
+{
+	apr_size_t ratio = detector->onset_ratio;
+	apr_size_t threshold;
+	if(detector->state == DETECTOR_STATE_ACTIVITY || detector->state == DETECTOR_STATE_INACTIVITY_TRANSITION) {
+		/* hysteresis, keep activity at the lower threshold */
+		ratio = detector->offset_ratio;
+	}
+	threshold = (detector->noise_floor * ratio / 100) >> MPF_DETECTOR_FLOOR_SHIFT;
+	return threshold > MPF_DETECTOR_MIN_LEVEL ? threshold : MPF_DETECTOR_MIN_LEVEL;
+}
+
+/** Track the noise floor by the level of audio frame */
+static void mpf_activity_detector_noise_floor_update(mpf_activity_detector_t *detector, apr_size_t level, apt_bool_t voice)
+{
+	apr_size_t value = level << MPF_DETECTOR_FLOOR_SHIFT;
+	if(detector->floor_duration < MPF_DETECTOR_CALIBRATION_TIME) {
+		/* average of the first frames */
+		apr_size_t count = detector->floor_duration / CODEC_FRAME_TIME_BASE;
+		detector->noise_floor = (detector->noise_floor * count + value) / (count + 1);
+		detector->floor_duration += CODEC_FRAME_TIME_BASE;
+		return;
+	}
 
-	return sum / count;
+	if(value < detector->noise_floor) {
+		detector->noise_floor -= (detector->noise_floor - value) >> MPF_DETECTOR_FLOOR_FALL_RATE;
+	}
+	else {
+		int rate = voice == TRUE ? MPF_DETECTOR_FLOOR_VOICE_RATE : MPF_DETECTOR_FLOOR_RISE_RATE;
+		/* round up, so that the floor keeps moving by small differences */
+		detector->noise_floor += (value - detector->noise_floor + (1 << rate) - 1) >> rate;
+	}
+}
+
+/** Classify the level of audio frame as voice or silence */
+static apt_bool_t mpf_activity_detector_level_classify(mpf_activity_detector_t *detector, apr_size_t level)
+{
+	apr_size_t floor = 0;
+	apr_size_t threshold = detector->level_threshold;
+	apt_bool_t voice;
+	if(detector->mode == MPF_DETECTOR_MODE_ADAPTIVE) {
+		if(detector->floor_duration < MPF_DETECTOR_CALIBRATION_TIME) {
+			/* the noise floor is not known yet */
+			detector->speech_probability = 0;
+			return FALSE;
+		}
+		floor = detector->noise_floor >> MPF_DETECTOR_FLOOR_SHIFT;
+		threshold = mpf_activity_detector_adaptive_threshold_get(detector);
+	}
+
+	voice = level >= threshold ? TRUE : FALSE;
+
+	/* the threshold maps to 0.5, the floor to 0 */
+	if(level <= floor || threshold <= floor) {
+		detector->speech_probability = level > floor ? 1.0f : 0;
+	}
+	else {
+		detector->speech_probability = (float)(level - floor) / (2 * (threshold - floor));
+		if(detector->speech_probability > 1.0f) {
+			detector->speech_probability = 1.0f;
+		}
+	}
+	return voice;
 }
 
 /** Process current frame */
@@ -118,16 +467,32 @@ MPF_DECLARE(mpf_detector_event_e) mpf_activity_detector_process(mpf_activity_det
 {
 	mpf_detector_event_e det_event = MPF_DETECTOR_EVENT_NONE;
 	apr_size_t level = 0;
+	apt_bool_t voice;
 	if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
 		/* first, calculate current activity level of processed frame */
-		level = mpf_activity_detector_level_calculate(frame);
+		mpf_activity_features_calculate(
+			frame->codec_frame.buffer,
+			frame->codec_frame.size / sizeof(apr_int16_t),
+			&detector->features,
+			detector->features_enabled);
+		level = detector->features.level;
 #if 0
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Activity Detector [%"APR_SIZE_T_FMT"]",level);
 #endif
 	}
+	else {
+		detector->features.level = 0;
+		detector->features.energy = 0;
+		detector->features.zero_crossings = 0;
+	}
+
+	voice = mpf_activity_detector_level_classify(detector,level);
+	if(detector->mode == MPF_DETECTOR_MODE_ADAPTIVE && (frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
+		mpf_activity_detector_noise_floor_update(detector,level,voice);
+	}
 
 	if(detector->state == DETECTOR_STATE_INACTIVITY) {
-		if(level >= detector->level_threshold) {
+		if(voice == TRUE) {
 			/* start to detect activity */
 			mpf_activity_detector_state_change(detector,DETECTOR_STATE_ACTIVITY_TRANSITION);
 		}
@@ -140,7 +505,7 @@ MPF_DECLARE(mpf_detector_event_e) mpf_activity_detector_process(mpf_activity_det
 		}
 	}
 	else if(detector->state == DETECTOR_STATE_ACTIVITY_TRANSITION) {
-		if(level >= detector->level_threshold) {
+		if(voice == TRUE) {
 			detector->duration += CODEC_FRAME_TIME_BASE;
 			if(detector->duration >= detector->speech_timeout) {
 				/* finally detected activity */
@@ -154,7 +519,7 @@ MPF_DECLARE(mpf_detector_event_e) mpf_activity_detector_process(mpf_activity_det
 		}
 	}
 	else if(detector->state == DETECTOR_STATE_ACTIVITY) {
-		if(level >= detector->level_threshold) {
+		if(voice == TRUE) {
 			detector->duration += CODEC_FRAME_TIME_BASE;
 		}
 		else {
@@ -163,7 +528,7 @@ MPF_DECLARE(mpf_detector_event_e) mpf_activity_detector_process(mpf_activity_det
 		}
 	}
 	else if(detector->state == DETECTOR_STATE_INACTIVITY_TRANSITION) {
-		if(level >= detector->level_threshold) {
+		if(voice == TRUE) {
 			/* fallback to activity */
 			mpf_activity_detector_state_change(detector,DETECTOR_STATE_ACTIVITY);
 		}
@@ -179,3 +544,36 @@ MPF_DECLARE(mpf_detector_event_e) mpf_activity_detector_process(mpf_activity_det
 
 	return det_event;
 }
+
+/** Get probability of the last processed frame being speech */
+MPF_DECLARE(float) mpf_activity_detector_speech_probability_get(const mpf_activity_detector_t *detector)
+{
+	return detector->speech_probability;
+}
+
+/** Get the noise floor tracked in the adaptive mode */
+MPF_DECLARE(apr_size_t) mpf_activity_detector_noise_floor_get(const mpf_activity_detector_t *detector)
+{
+	return detector->noise_floor >> MPF_DETECTOR_FLOOR_SHIFT;
+}
+
+/** Enable calculation of energy and zero-crossings */
+MPF_DECLARE(void) mpf_activity_detector_features_enable(mpf_activity_detector_t *detector, apt_bool_t enable)
+{
+	detector->features_enabled = enable;
+}
+
+/** Get features of the last processed frame */
+MPF_DECLARE(const mpf_activity_features_t*) mpf_activity_detector_features_get(const mpf_activity_detector_t *detector)
+{
+	return &detector->features;
+}
+
+/** Check whether the last processed frame is considered voice */
+MPF_DECLARE(apt_bool_t) mpf_activity_detector_activity_check(const mpf_activity_detector_t *detector)
+{
+	if(detector->state == DETECTOR_STATE_ACTIVITY_TRANSITION || detector->state == DETECTOR_STATE_ACTIVITY) {
+		return TRUE;
+	}
+	return FALSE;
+}
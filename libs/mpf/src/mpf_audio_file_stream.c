@@ -1,25 +1,36 @@
-/*
- * Copyright 2008-2015 Arsen Chaloyan
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- *     http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
+#include <apr_mmap.h>
+#include <apr_portable.h>
+#if defined(WIN32)
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
 #include "mpf_audio_file_stream.h"
 #include "mpf_termination.h"
 #include "mpf_frame.h"
 #include "mpf_codec_manager.h"
+#include "apt_consumer_task.h"
 #include "apt_log.h"
 
+#define MPF_FILE_WRITER_TASK_NAME "MPF File Writer"
+
+/** Size of a block of audio written to file at once (1 sec of 8 kHz L16) */
+#define MPF_FILE_WRITER_BLOCK_SIZE 16000
+
+typedef enum {
+	MPF_FILE_WRITER_MSG_WRITE,
+	MPF_FILE_WRITER_MSG_CLOSE
+} mpf_file_writer_msg_type_e;
+
+/** Writer task message, carrying a block of audio */
+typedef struct mpf_file_writer_msg_t mpf_file_writer_msg_t;
+struct mpf_file_writer_msg_t {
+	mpf_file_writer_msg_type_e type;
+	FILE                      *handle;
+	apr_size_t                 size;
+	char                       data[MPF_FILE_WRITER_BLOCK_SIZE];
+};
+
 /** Audio file stream */
 typedef struct mpf_audio_file_stream_t mpf_audio_file_stream_t;
 struct mpf_audio_file_stream_t {
@@ -28,6 +39,18 @@ struct mpf_audio_file_stream_t {
 	FILE               *read_handle;
 	FILE               *write_handle;
 
+	/** Mapping of the file read (NULL if read by stdio) */
+	apr_mmap_t         *read_map;
+	/** Position of the next frame in the mapping */
+	const char         *read_pos;
+	/** Size of audio left in the mapping */
+	apr_size_t          read_left;
+
+	/** Writer task blocks are written by (NULL if written on the media thread) */
+	apt_task_t         *writer;
+	/** Message of the block being filled */
+	apt_task_msg_t     *write_msg;
+
 	apt_bool_t          eof;
 	apr_size_t          max_write_size;
 	apr_size_t          cur_write_size;
@@ -35,18 +58,155 @@ struct mpf_audio_file_stream_t {
 
 static APR_INLINE void mpf_audio_file_event_raise(mpf_audio_stream_t *stream, int event_id, void *descriptor);
 
+/** Unmap the file read */
+static void mpf_audio_file_reader_unmap(mpf_audio_file_stream_t *file_stream)
+{
+	if(file_stream->read_map) {
+		apr_mmap_delete(file_stream->read_map);
+		file_stream->read_map = NULL;
+	}
+	file_stream->read_pos = NULL;
+	file_stream->read_left = 0;
+}
+
+/** Map the file read from its current position, so that frames are not read by syscalls on the media thread */
+static apt_bool_t mpf_audio_file_reader_map(mpf_audio_file_stream_t *file_stream, FILE *handle, apr_pool_t *pool)
+{
+	apr_file_t *file = NULL;
+	apr_os_file_t os_file;
+	apr_finfo_t finfo;
+	long offset = ftell(handle);
+	if(offset < 0) {
+		return FALSE;
+	}
+#if defined(WIN32)
+	os_file = (HANDLE)_get_osfhandle(_fileno(handle));
+#else
+	os_file = fileno(handle);
+#endif
+	if(apr_os_file_put(&file,&os_file,APR_FOPEN_READ,pool) != APR_SUCCESS ||
+		apr_file_info_get(&finfo,APR_FINFO_SIZE,file) != APR_SUCCESS ||
+		finfo.size <= (apr_off_t)offset) {
+		return FALSE;
+	}
+	/* the offset of a mapping must be page aligned, hence the whole file is mapped */
+	if(apr_mmap_create(&file_stream->read_map,file,0,(apr_size_t)finfo.size,APR_MMAP_READ,pool) != APR_SUCCESS) {
+		file_stream->read_map = NULL;
+		return FALSE;
+	}
+#if defined(POSIX_MADV_WILLNEED)
+	/* start reading ahead at once, so that the media thread does not fault on cold pages */
+	posix_madvise(file_stream->read_map->mm,file_stream->read_map->size,POSIX_MADV_SEQUENTIAL | POSIX_MADV_WILLNEED);
+#endif
+	file_stream->read_pos = (const char*)file_stream->read_map->mm + offset;
+	file_stream->read_left = (apr_size_t)finfo.size - offset;
+	return TRUE;
+}
+
+/** Write a block to file and close the file if requested (writer or media thread) */
+static void mpf_file_writer_block_write(const mpf_file_writer_msg_t *writer_msg)
+{
+	if(writer_msg->size) {
+		fwrite(writer_msg->data,1,writer_msg->size,writer_msg->handle);
+	}
+	if(writer_msg->type == MPF_FILE_WRITER_MSG_CLOSE) {
+		fclose(writer_msg->handle);
+	}
+}
+
+static apt_bool_t mpf_file_writer_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	mpf_file_writer_block_write((const mpf_file_writer_msg_t*)msg->data);
+	return TRUE;
+}
+
+/** Pass the block being filled to the writer task, or write it on failure */
+static void mpf_audio_file_block_flush(mpf_audio_file_stream_t *file_stream, mpf_file_writer_msg_type_e type)
+{
+	apt_task_msg_t *msg = file_stream->write_msg;
+	mpf_file_writer_msg_t *writer_msg;
+	if(!msg) {
+		msg = apt_task_msg_get(file_stream->writer);
+		if(!msg) {
+			if(type == MPF_FILE_WRITER_MSG_CLOSE) {
+				fclose(file_stream->write_handle);
+			}
+			return;
+		}
+		writer_msg = (mpf_file_writer_msg_t*)msg->data;
+		writer_msg->handle = file_stream->write_handle;
+		writer_msg->size = 0;
+	}
+	file_stream->write_msg = NULL;
+	msg->type = TASK_MSG_USER;
+	writer_msg = (mpf_file_writer_msg_t*)msg->data;
+	writer_msg->type = type;
+	if(apt_task_msg_signal(file_stream->writer,msg) == FALSE) {
+		/* the writer is gone (terminated before the stream is destroyed) */
+		mpf_file_writer_block_write(writer_msg);
+		apt_task_msg_release(msg);
+	}
+}
+
+/** Write audio to file, by blocks passed to the writer task if any */
+static apr_size_t mpf_audio_file_data_write(mpf_audio_file_stream_t *file_stream, const char *data, apr_size_t size)
+{
+	apr_size_t written = 0;
+	mpf_file_writer_msg_t *writer_msg;
+	if(!file_stream->writer) {
+		return fwrite(data,1,size,file_stream->write_handle);
+	}
+
+	while(written < size) {
+		apr_size_t chunk;
+		if(!file_stream->write_msg) {
+			file_stream->write_msg = apt_task_msg_get(file_stream->writer);
+			if(!file_stream->write_msg) {
+				return written + fwrite(data + written,1,size - written,file_stream->write_handle);
+			}
+			writer_msg = (mpf_file_writer_msg_t*)file_stream->write_msg->data;
+			writer_msg->handle = file_stream->write_handle;
+			writer_msg->size = 0;
+		}
+		writer_msg = (mpf_file_writer_msg_t*)file_stream->write_msg->data;
+		chunk = MPF_FILE_WRITER_BLOCK_SIZE - writer_msg->size;
+		if(chunk > size - written) {
+			chunk = size - written;
+		}
+		memcpy(writer_msg->data + writer_msg->size,data + written,chunk);
+		writer_msg->size += chunk;
+		written += chunk;
+		if(writer_msg->size == MPF_FILE_WRITER_BLOCK_SIZE) {
+			mpf_audio_file_block_flush(file_stream,MPF_FILE_WRITER_MSG_WRITE);
+		}
+	}
+	return written;
+}
+
+/** Close the file written, once the pending blocks are written */
+static void mpf_audio_file_writer_release(mpf_audio_file_stream_t *file_stream)
+{
+	if(!file_stream->write_handle) {
+		return;
+	}
+	if(file_stream->writer) {
+		mpf_audio_file_block_flush(file_stream,MPF_FILE_WRITER_MSG_CLOSE);
+	}
+	else {
+		fclose(file_stream->write_handle);
+	}
+	file_stream->write_handle = NULL;
+}
 
 static apt_bool_t mpf_audio_file_destroy(mpf_audio_stream_t *stream)
 {
 	mpf_audio_file_stream_t *file_stream = stream->obj;
+	mpf_audio_file_reader_unmap(file_stream);
 	if(file_stream->read_handle) {
 		fclose(file_stream->read_handle);
 		file_stream->read_handle = NULL;
 	}
-	if(file_stream->write_handle) {
-		fclose(file_stream->write_handle);
-		file_stream->write_handle = NULL;
-	}
+	mpf_audio_file_writer_release(file_stream);
 	return TRUE;
 }
 
@@ -63,7 +223,19 @@ static apt_bool_t mpf_audio_file_reader_close(mpf_audio_stream_t *stream)
 static apt_bool_t mpf_audio_file_frame_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
 {
 	mpf_audio_file_stream_t *file_stream = stream->obj;
-	if(file_stream->read_handle && file_stream->eof == FALSE) {
+	if(file_stream->read_map && file_stream->eof == FALSE) {
+		if(file_stream->read_left >= frame->codec_frame.size) {
+			memcpy(frame->codec_frame.buffer,file_stream->read_pos,frame->codec_frame.size);
+			file_stream->read_pos += frame->codec_frame.size;
+			file_stream->read_left -= frame->codec_frame.size;
+			frame->type = MEDIA_FRAME_TYPE_AUDIO;
+		}
+		else {
+			file_stream->eof = TRUE;
+			mpf_audio_file_event_raise(stream,0,NULL);
+		}
+	}
+	else if(file_stream->read_handle && file_stream->eof == FALSE) {
 		if(fread(frame->codec_frame.buffer,1,frame->codec_frame.size,file_stream->read_handle) == frame->codec_frame.size) {
 			frame->type = MEDIA_FRAME_TYPE_AUDIO;
 		}
@@ -91,11 +263,10 @@ static apt_bool_t mpf_audio_file_frame_write(mpf_audio_stream_t *stream, const m
 	mpf_audio_file_stream_t *file_stream = stream->obj;
 	if(file_stream->write_handle && 
 		(!file_stream->max_write_size || file_stream->cur_write_size < file_stream->max_write_size)) {
-		file_stream->cur_write_size += fwrite(
+		file_stream->cur_write_size += mpf_audio_file_data_write(
+										file_stream,
 										frame->codec_frame.buffer,
-										1,
-										frame->codec_frame.size,
-										file_stream->write_handle);
+										frame->codec_frame.size);
 		if(file_stream->cur_write_size >= file_stream->max_write_size) {
 			mpf_audio_file_event_raise(stream,0,NULL);
 		}
@@ -127,6 +298,11 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_file_stream_create(mpf_termination_t *termi
 	file_stream->audio_stream = audio_stream;
 	file_stream->write_handle = NULL;
 	file_stream->read_handle = NULL;
+	file_stream->read_map = NULL;
+	file_stream->read_pos = NULL;
+	file_stream->read_left = 0;
+	file_stream->writer = NULL;
+	file_stream->write_msg = NULL;
 	file_stream->eof = FALSE;
 	file_stream->max_write_size = 0;
 	file_stream->cur_write_size = 0;
@@ -138,19 +314,22 @@ MPF_DECLARE(apt_bool_t) mpf_file_stream_modify(mpf_audio_stream_t *stream, mpf_a
 {
 	mpf_audio_file_stream_t *file_stream = stream->obj;
 	if(descriptor->mask & FILE_READER) {
+		mpf_audio_file_reader_unmap(file_stream);
 		if(file_stream->read_handle) {
 			fclose(file_stream->read_handle);
 		}
 		file_stream->read_handle = descriptor->read_handle;
+		if(file_stream->read_handle) {
+			/* read by stdio, if the file can not be mapped (e.g. a pipe) */
+			mpf_audio_file_reader_map(file_stream,file_stream->read_handle,stream->termination->pool);
+		}
 		file_stream->eof = FALSE;
 		stream->direction |= FILE_READER;
 
 		stream->rx_descriptor = descriptor->codec_descriptor;
 	}
 	if(descriptor->mask & FILE_WRITER) {
-		if(file_stream->write_handle) {
-			fclose(file_stream->write_handle);
-		}
+		mpf_audio_file_writer_release(file_stream);
 		file_stream->write_handle = descriptor->write_handle;
 		file_stream->max_write_size = descriptor->max_write_size;
 		file_stream->cur_write_size = 0;
@@ -161,6 +340,33 @@ MPF_DECLARE(apt_bool_t) mpf_file_stream_modify(mpf_audio_stream_t *stream, mpf_a
 	return TRUE;
 }
 
+MPF_DECLARE(void) mpf_file_stream_writer_set(mpf_audio_stream_t *stream, apt_task_t *writer)
+{
+	mpf_audio_file_stream_t *file_stream = stream->obj;
+	file_stream->writer = writer;
+}
+
+MPF_DECLARE(apt_task_t*) mpf_file_stream_writer_create(apr_pool_t *pool)
+{
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	apt_consumer_task_t *consumer_task;
+
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mpf_file_writer_msg_t),pool);
+	consumer_task = apt_consumer_task_create(NULL,msg_pool,pool);
+	if(!consumer_task) {
+		return NULL;
+	}
+	task = apt_consumer_task_base_get(consumer_task);
+	apt_task_name_set(task,MPF_FILE_WRITER_TASK_NAME);
+	vtable = apt_task_vtable_get(task);
+	if(vtable) {
+		vtable->process_msg = mpf_file_writer_msg_process;
+	}
+	return task;
+}
+
 static APR_INLINE void mpf_audio_file_event_raise(mpf_audio_stream_t *stream, int event_id, void *descriptor)
 {
 	if(stream->termination->event_handler) {
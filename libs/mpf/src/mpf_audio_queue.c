@@ -0,0 +1,177 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "mpf_audio_queue.h"
+#include "mpf_codec_descriptor.h"
+#include "apt_spsc_queue.h"
+
+/** Number of entries kept in reserve for control entries */
+#define MPF_AUDIO_QUEUE_RESERVE 16
+
+/** Header of an entry, the data follows */
+typedef struct mpf_audio_queue_entry_t mpf_audio_queue_entry_t;
+struct mpf_audio_queue_entry_t {
+	/** Whether the entry is plain audio */
+	apt_bool_t audio;
+};
+
+/** Size of the header of an entry, the data is aligned as a pool allocation */
+#define MPF_AUDIO_QUEUE_HEADER_SIZE APR_ALIGN_DEFAULT(sizeof(mpf_audio_queue_entry_t))
+
+/** Audio queue */
+struct mpf_audio_queue_t {
+	/** Entries */
+	apt_spsc_queue_t        *entries;
+	/** Capacity in entries */
+	apr_size_t               capacity;
+	/** Overflow policy */
+	mpf_audio_queue_policy_e policy;
+	/** Function to release dropped entries by */
+	mpf_audio_queue_drop_f   drop_handler;
+	/** Object to pass to the function */
+	void                    *drop_obj;
+	/** Number of entries queued, once the entry being written is committed (producer only) */
+	apr_size_t               write_size;
+
+	/** Number of entries written (producer only) */
+	volatile apr_uint32_t    written;
+	/** Number of entries rejected (producer only) */
+	volatile apr_uint32_t    rejected;
+	/** Max number of entries queued (producer only) */
+	volatile apr_uint32_t    high_water;
+	/** Number of entries dropped (consumer only) */
+	volatile apr_uint32_t    dropped;
+};
+
+MPF_DECLARE(mpf_audio_queue_t*) mpf_audio_queue_create(
+									apr_size_t capacity,
+									apr_size_t elem_size,
+									mpf_audio_queue_policy_e policy,
+									apr_pool_t *pool)
+{
+	mpf_audio_queue_t *queue;
+	apr_size_t slots;
+	apr_size_t frames = capacity / CODEC_FRAME_TIME_BASE;
+	if(!frames || !elem_size) {
+		return NULL;
+	}
+
+	/* audio keeps being written past the capacity till the consumer drops the oldest */
+	slots = frames + MPF_AUDIO_QUEUE_RESERVE;
+	if(policy == MPF_AUDIO_QUEUE_DROP_OLDEST) {
+		slots += frames;
+	}
+	queue = apr_palloc(pool,sizeof(mpf_audio_queue_t));
+	queue->entries = apt_spsc_queue_create(slots,MPF_AUDIO_QUEUE_HEADER_SIZE + elem_size,pool);
+	if(!queue->entries) {
+		return NULL;
+	}
+	queue->capacity = frames;
+	queue->policy = policy;
+	queue->drop_handler = NULL;
+	queue->drop_obj = NULL;
+	queue->write_size = 0;
+	mpf_audio_queue_stats_reset(queue);
+	return queue;
+}
+
+MPF_DECLARE(void) mpf_audio_queue_drop_handler_set(mpf_audio_queue_t *queue, mpf_audio_queue_drop_f handler, void *obj)
+{
+	queue->drop_handler = handler;
+	queue->drop_obj = obj;
+}
+
+MPF_DECLARE(void*) mpf_audio_queue_write_begin(mpf_audio_queue_t *queue, apt_bool_t audio)
+{
+	mpf_audio_queue_entry_t *entry;
+	apr_size_t size = apt_spsc_queue_size(queue->entries);
+	if(audio == TRUE && queue->policy == MPF_AUDIO_QUEUE_SIGNAL_BACKLOG && size >= queue->capacity) {
+		apr_atomic_inc32(&queue->rejected);
+		return NULL;
+	}
+	entry = apt_spsc_queue_write_begin(queue->entries);
+	if(!entry) {
+		apr_atomic_inc32(&queue->rejected);
+		return NULL;
+	}
+	entry->audio = audio;
+	queue->write_size = size + 1;
+	return (char*)entry + MPF_AUDIO_QUEUE_HEADER_SIZE;
+}
+
+MPF_DECLARE(void) mpf_audio_queue_write_commit(mpf_audio_queue_t *queue)
+{
+	apt_spsc_queue_write_commit(queue->entries);
+	apr_atomic_inc32(&queue->written);
+	if(queue->write_size > apr_atomic_read32(&queue->high_water)) {
+		apr_atomic_set32(&queue->high_water,(apr_uint32_t)queue->write_size);
+	}
+}
+
+MPF_DECLARE(void*) mpf_audio_queue_read_begin(mpf_audio_queue_t *queue)
+{
+	mpf_audio_queue_entry_t *entry;
+	while((entry = apt_spsc_queue_read_begin(queue->entries)) != NULL) {
+		if(queue->policy != MPF_AUDIO_QUEUE_DROP_OLDEST || entry->audio == FALSE ||
+			apt_spsc_queue_size(queue->entries) <= queue->capacity) {
+			return (char*)entry + MPF_AUDIO_QUEUE_HEADER_SIZE;
+		}
+		/* the consumer lags behind by more than the capacity, catch up with the live audio */
+		if(queue->drop_handler) {
+			queue->drop_handler(queue->drop_obj,(char*)entry + MPF_AUDIO_QUEUE_HEADER_SIZE);
+		}
+		apt_spsc_queue_read_commit(queue->entries);
+		apr_atomic_inc32(&queue->dropped);
+	}
+	return NULL;
+}
+
+MPF_DECLARE(void) mpf_audio_queue_read_commit(mpf_audio_queue_t *queue)
+{
+	apt_spsc_queue_read_commit(queue->entries);
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_queue_size_get(const mpf_audio_queue_t *queue)
+{
+	return apt_spsc_queue_size(queue->entries);
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_queue_occupancy_get(const mpf_audio_queue_t *queue)
+{
+	return apt_spsc_queue_size(queue->entries) * CODEC_FRAME_TIME_BASE;
+}
+
+MPF_DECLARE(apr_size_t) mpf_audio_queue_capacity_get(const mpf_audio_queue_t *queue)
+{
+	return queue->capacity * CODEC_FRAME_TIME_BASE;
+}
+
+MPF_DECLARE(void) mpf_audio_queue_stats_get(const mpf_audio_queue_t *queue, mpf_audio_queue_stats_t *stats)
+{
+	stats->written = apr_atomic_read32((volatile apr_uint32_t*)&queue->written);
+	stats->dropped = apr_atomic_read32((volatile apr_uint32_t*)&queue->dropped);
+	stats->rejected = apr_atomic_read32((volatile apr_uint32_t*)&queue->rejected);
+	stats->high_water = apr_atomic_read32((volatile apr_uint32_t*)&queue->high_water);
+}
+
+MPF_DECLARE(void) mpf_audio_queue_stats_reset(mpf_audio_queue_t *queue)
+{
+	apr_atomic_set32(&queue->written,0);
+	apr_atomic_set32(&queue->dropped,0);
+	apr_atomic_set32(&queue->rejected,0);
+	apr_atomic_set32(&queue->high_water,0);
+}
@@ -19,6 +19,7 @@
 #include "mpf_decoder.h"
 #include "mpf_resampler.h"
 #include "mpf_codec_manager.h"
+#include "mpf_flight_recorder.h"
 #include "apt_log.h"
 
 typedef struct mpf_bridge_t mpf_bridge_t;
@@ -35,14 +36,39 @@ struct mpf_bridge_t {
 	mpf_codec_t        *codec;
 	/** Media frame used to read data from source and write it to sink */
 	mpf_frame_t         frame;
+	/** Buffer of the frame, unless referenced from the source */
+	void               *buffer;
+	/** Flight recorder of the source, sink writes are recorded to (NULL if none) */
+	mpf_flight_recorder_t *recorder;
+	/** Sink the recorder is lent to, for the duration of the bridge (NULL if none) */
+	mpf_audio_stream_t *recorder_sink;
 };
 
+static APR_INLINE void mpf_bridge_frame_write(mpf_bridge_t *bridge)
+{
+	apr_time_t start;
+	if(!bridge->recorder) {
+		bridge->sink->vtable->write_frame(bridge->sink,&bridge->frame);
+		return;
+	}
+
+	start = apr_time_now();
+	bridge->sink->vtable->write_frame(bridge->sink,&bridge->frame);
+	mpf_flight_recorder_put(
+		bridge->recorder,
+		MPF_FLIGHT_SINK_WRITE,
+		(apr_byte_t)bridge->frame.type,
+		0,0,
+		(apr_uint32_t)(apr_time_now() - start));
+}
+
 static apt_bool_t mpf_bridge_process(mpf_object_t *object)
 {
 	mpf_bridge_t *bridge = (mpf_bridge_t*) object;
 	bridge->frame.type = MEDIA_FRAME_TYPE_NONE;
 	bridge->frame.marker = MPF_MARKER_NONE;
-	bridge->source->vtable->read_frame(bridge->source,&bridge->frame);
+	bridge->frame.codec_frame.buffer = bridge->buffer;
+	mpf_audio_stream_frame_ref_read(bridge->source,&bridge->frame);
 	
 	if((bridge->frame.type & MEDIA_FRAME_TYPE_AUDIO) == 0) {
 		memset(	bridge->frame.codec_frame.buffer,
@@ -50,8 +76,8 @@ static apt_bool_t mpf_bridge_process(mpf_object_t *object)
 				bridge->frame.codec_frame.size);
 	}
 
-	bridge->sink->vtable->write_frame(bridge->sink,&bridge->frame);
-	return TRUE;
+	mpf_bridge_frame_write(bridge);
+	return (bridge->frame.type & MEDIA_FRAME_TYPE_AUDIO) ? TRUE : FALSE;
 }
 
 static apt_bool_t mpf_null_bridge_process(mpf_object_t *object)
@@ -59,15 +85,17 @@ static apt_bool_t mpf_null_bridge_process(mpf_object_t *object)
 	mpf_bridge_t *bridge = (mpf_bridge_t*) object;
 	bridge->frame.type = MEDIA_FRAME_TYPE_NONE;
 	bridge->frame.marker = MPF_MARKER_NONE;
-	bridge->source->vtable->read_frame(bridge->source,&bridge->frame);
+	/* the sink consumes audio straight from the storage of the source (e.g. the jitter buffer) */
+	bridge->frame.codec_frame.buffer = bridge->buffer;
+	mpf_audio_stream_frame_ref_read(bridge->source,&bridge->frame);
 
 	if((bridge->frame.type & MEDIA_FRAME_TYPE_AUDIO) == 0) {
 		/* generate silence frame */
 		mpf_codec_initialize(bridge->codec,&bridge->frame.codec_frame);
 	}
 
-	bridge->sink->vtable->write_frame(bridge->sink,&bridge->frame);
-	return TRUE;
+	mpf_bridge_frame_write(bridge);
+	return (bridge->frame.type & MEDIA_FRAME_TYPE_AUDIO) ? TRUE : FALSE;
 }
 
 static void mpf_bridge_trace(mpf_object_t *object)
@@ -98,6 +126,10 @@ static apt_bool_t mpf_bridge_destroy(mpf_object_t *object)
 	apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Destroy Audio Bridge %s",object->name);
 	mpf_audio_stream_rx_close(bridge->source);
 	mpf_audio_stream_tx_close(bridge->sink);
+	if(bridge->recorder_sink) {
+		bridge->recorder_sink->recorder = NULL;
+		bridge->recorder_sink = NULL;
+	}
 	return TRUE;
 }
 
@@ -112,6 +144,9 @@ static mpf_bridge_t* mpf_bridge_base_create(mpf_audio_stream_t *source, mpf_audi
 	bridge->source = source;
 	bridge->sink = sink;
 	bridge->codec = NULL;
+	bridge->buffer = NULL;
+	bridge->recorder = NULL;
+	bridge->recorder_sink = NULL;
 	mpf_object_init(&bridge->base,name);
 	bridge->base.destroy = mpf_bridge_destroy;
 	bridge->base.process = mpf_bridge_process;
@@ -133,7 +168,8 @@ static mpf_object_t* mpf_linear_bridge_create(mpf_audio_stream_t *source, mpf_au
 	descriptor = source->rx_descriptor;
 	frame_size = mpf_codec_linear_frame_size_calculate(descriptor->sampling_rate,descriptor->channel_count);
 	bridge->frame.codec_frame.size = frame_size;
-	bridge->frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	bridge->buffer = apr_palloc(pool,frame_size);
+	bridge->frame.codec_frame.buffer = bridge->buffer;
 	
 	if(mpf_audio_stream_rx_open(source,NULL) == FALSE) {
 		return NULL;
@@ -165,7 +201,8 @@ static mpf_object_t* mpf_null_bridge_create(mpf_audio_stream_t *source, mpf_audi
 	frame_size = mpf_codec_frame_size_calculate(source->rx_descriptor,codec->attribs);
 	bridge->codec = codec;
 	bridge->frame.codec_frame.size = frame_size;
-	bridge->frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	bridge->buffer = apr_palloc(pool,frame_size);
+	bridge->frame.codec_frame.buffer = bridge->buffer;
 
 	if(mpf_audio_stream_rx_open(source,codec) == FALSE) {
 		return NULL;
@@ -177,6 +214,22 @@ static mpf_object_t* mpf_null_bridge_create(mpf_audio_stream_t *source, mpf_audi
 	return &bridge->base;
 }
 
+static mpf_object_t* mpf_bridge_recorder_attach(mpf_object_t *object, mpf_flight_recorder_t *recorder, mpf_audio_stream_t *sink)
+{
+	mpf_bridge_t *bridge = (mpf_bridge_t*) object;
+	if(!bridge || !recorder) {
+		return object;
+	}
+
+	bridge->recorder = recorder;
+	if(!sink->recorder) {
+		/* lend the recorder of the source to the sink, so that its events land in the same ring */
+		sink->recorder = recorder;
+		bridge->recorder_sink = sink;
+	}
+	return object;
+}
+
 MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 						mpf_audio_stream_t *source, 
 						mpf_audio_stream_t *sink, 
@@ -184,6 +237,8 @@ MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 						const char *name,
 						apr_pool_t *pool)
 {
+	mpf_flight_recorder_t *recorder;
+	mpf_audio_stream_t *origin_sink;
 	if(!source || !sink) {
 		return NULL;
 	}
@@ -193,8 +248,12 @@ MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 		return NULL;
 	}
 
+	recorder = source->recorder;
+	origin_sink = sink;
 	if(mpf_codec_descriptors_match(source->rx_descriptor,sink->tx_descriptor) == TRUE) {
-		return mpf_null_bridge_create(source,sink,codec_manager,name,pool);
+		return mpf_bridge_recorder_attach(
+					mpf_null_bridge_create(source,sink,codec_manager,name,pool),
+					recorder,origin_sink);
 	}
 
 	if(mpf_codec_lpcm_descriptor_match(source->rx_descriptor) == FALSE) {
@@ -224,5 +283,7 @@ MPF_DECLARE(mpf_object_t*) mpf_bridge_create(
 		source = resampler;
 	}
 
-	return mpf_linear_bridge_create(source,sink,codec_manager,name,pool);
+	return mpf_bridge_recorder_attach(
+				mpf_linear_bridge_create(source,sink,codec_manager,name,pool),
+				recorder,origin_sink);
 }
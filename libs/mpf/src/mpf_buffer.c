@@ -25,10 +25,16 @@ typedef struct mpf_chunk_t mpf_chunk_t;
 struct mpf_chunk_t {
 	APR_RING_ENTRY(mpf_chunk_t) link;
 	mpf_frame_t                 frame;
+	/** Storage owned by the chunk, kept for reuse when the chunk is recycled */
+	void                       *data;
+	/** Capacity of the storage */
+	apr_size_t                  capacity;
 };
 
 struct mpf_buffer_t {
 	APR_RING_HEAD(mpf_chunk_head_t, mpf_chunk_t) head;
+	/** Chunks read or restarted, recycled by subsequent writes */
+	APR_RING_HEAD(mpf_chunk_free_head_t, mpf_chunk_t) free_head;
 	mpf_chunk_t                                 *cur_chunk;
 	apr_size_t                                   remaining_chunk_size;
 	apr_thread_mutex_t                          *guard;
@@ -44,6 +50,7 @@ mpf_buffer_t* mpf_buffer_create(apr_pool_t *pool)
 	buffer->remaining_chunk_size = 0;
 	buffer->size = 0;
 	APR_RING_INIT(&buffer->head, mpf_chunk_t, link);
+	APR_RING_INIT(&buffer->free_head, mpf_chunk_t, link);
 	apr_thread_mutex_create(&buffer->guard,APR_THREAD_MUTEX_UNNESTED,pool);
 	return buffer;
 }
@@ -56,17 +63,47 @@ void mpf_buffer_destroy(mpf_buffer_t *buffer)
 	}
 }
 
+/** Recycle chunk */
+static APR_INLINE void mpf_buffer_chunk_recycle(mpf_buffer_t *buffer, mpf_chunk_t *chunk)
+{
+	APR_RING_INSERT_TAIL(&buffer->free_head,chunk,mpf_chunk_t,link);
+}
+
 apt_bool_t mpf_buffer_restart(mpf_buffer_t *buffer)
 {
 	apr_thread_mutex_lock(buffer->guard);
-	buffer->cur_chunk = NULL;
+	if(buffer->cur_chunk) {
+		mpf_buffer_chunk_recycle(buffer,buffer->cur_chunk);
+		buffer->cur_chunk = NULL;
+	}
 	buffer->remaining_chunk_size = 0;
 	buffer->size = 0;
-	APR_RING_INIT(&buffer->head, mpf_chunk_t, link);
+	APR_RING_CONCAT(&buffer->free_head,&buffer->head,mpf_chunk_t,link);
 	apr_thread_mutex_unlock(buffer->guard);
 	return TRUE;
 }
 
+/** Get recycled chunk having storage of at least the size, or allocate new one */
+static mpf_chunk_t* mpf_buffer_chunk_get(mpf_buffer_t *buffer, apr_size_t size)
+{
+	mpf_chunk_t *chunk;
+	for(chunk = APR_RING_FIRST(&buffer->free_head);
+			chunk != APR_RING_SENTINEL(&buffer->free_head,mpf_chunk_t,link);
+				chunk = APR_RING_NEXT(chunk,link)) {
+		if(chunk->capacity >= size) {
+			APR_RING_REMOVE(chunk,link);
+			APR_RING_ELEM_INIT(chunk,link);
+			return chunk;
+		}
+	}
+
+	chunk = apr_palloc(buffer->pool,sizeof(mpf_chunk_t));
+	APR_RING_ELEM_INIT(chunk,link);
+	chunk->data = size ? apr_palloc(buffer->pool,size) : NULL;
+	chunk->capacity = size;
+	return chunk;
+}
+
 static APR_INLINE apt_bool_t mpf_buffer_chunk_write(mpf_buffer_t *buffer, mpf_chunk_t *chunk)
 {
 	APR_RING_INSERT_TAIL(&buffer->head,chunk,mpf_chunk_t,link);
@@ -89,9 +126,8 @@ apt_bool_t mpf_buffer_audio_write(mpf_buffer_t *buffer, void *data, apr_size_t s
 	apt_bool_t status;
 	apr_thread_mutex_lock(buffer->guard);
 
-	chunk = apr_palloc(buffer->pool,sizeof(mpf_chunk_t));
-	APR_RING_ELEM_INIT(chunk,link);
-	chunk->frame.codec_frame.buffer = apr_palloc(buffer->pool,size);
+	chunk = mpf_buffer_chunk_get(buffer,size);
+	chunk->frame.codec_frame.buffer = chunk->data;
 	memcpy(chunk->frame.codec_frame.buffer,data,size);
 	chunk->frame.codec_frame.size = size;
 	chunk->frame.type = MEDIA_FRAME_TYPE_AUDIO;
@@ -102,14 +138,32 @@ apt_bool_t mpf_buffer_audio_write(mpf_buffer_t *buffer, void *data, apr_size_t s
 	return status;
 }
 
+apt_bool_t mpf_buffer_audio_ref_write(mpf_buffer_t *buffer, const void *data, apr_size_t size)
+{
+	mpf_chunk_t *chunk;
+	apt_bool_t status;
+	apr_thread_mutex_lock(buffer->guard);
+
+	/* any chunk will do, its storage is kept intact */
+	chunk = mpf_buffer_chunk_get(buffer,0);
+	/* chunks are only read from */
+	chunk->frame.codec_frame.buffer = (void*)data;
+	chunk->frame.codec_frame.size = size;
+	chunk->frame.type = MEDIA_FRAME_TYPE_AUDIO;
+	status = mpf_buffer_chunk_write(buffer,chunk);
+	
+	buffer->size += size;
+	apr_thread_mutex_unlock(buffer->guard);
+	return status;
+}
+
 apt_bool_t mpf_buffer_event_write(mpf_buffer_t *buffer, mpf_frame_type_e event_type)
 {
 	mpf_chunk_t *chunk;
 	apt_bool_t status;
 	apr_thread_mutex_lock(buffer->guard);
 
-	chunk = apr_palloc(buffer->pool,sizeof(mpf_chunk_t));
-	APR_RING_ELEM_INIT(chunk,link);
+	chunk = mpf_buffer_chunk_get(buffer,0);
 	chunk->frame.codec_frame.buffer = NULL;
 	chunk->frame.codec_frame.size = 0;
 	chunk->frame.type = event_type;
@@ -157,6 +211,7 @@ apt_bool_t mpf_buffer_frame_read(mpf_buffer_t *buffer, mpf_frame_t *media_frame)
 			remaining_frame_size -= buffer->remaining_chunk_size;
 			buffer->size -= buffer->remaining_chunk_size;
 			buffer->remaining_chunk_size = 0;
+			mpf_buffer_chunk_recycle(buffer,buffer->cur_chunk);
 			buffer->cur_chunk = NULL;
 		}
 	}
@@ -65,6 +65,43 @@ MPF_DECLARE(mpf_codec_descriptor_t*) mpf_codec_lpcm_descriptor_create(apr_uint16
 	return descriptor;
 }
 
+/** Get the sampling rate supported by capabilities closest to the specified one (8000 if none) */
+static apr_uint16_t mpf_sample_rate_closest_get(const mpf_codec_capabilities_t *capabilities, apr_uint16_t sampling_rate)
+{
+	static const apr_uint16_t rates[] = {8000, 16000, 32000, 48000};
+	int i;
+	int mask = MPF_SAMPLE_RATE_NONE;
+	apr_uint16_t closest = 8000;
+	apr_size_t distance = 0;
+	apt_bool_t found = FALSE;
+	for(i=0; i<capabilities->attrib_arr->nelts; i++) {
+		mask |= APR_ARRAY_IDX(capabilities->attrib_arr,i,mpf_codec_attribs_t).sample_rates;
+	}
+	for(i=0; i<(int)(sizeof(rates)/sizeof(rates[0])); i++) {
+		apr_size_t cur;
+		if(mpf_sampling_rate_check(rates[i],mask) == FALSE) {
+			continue;
+		}
+		cur = rates[i] > sampling_rate ? rates[i] - sampling_rate : sampling_rate - rates[i];
+		/* on equal distance, the higher rate wins as it is checked later */
+		if(found == FALSE || cur <= distance) {
+			closest = rates[i];
+			distance = cur;
+			found = TRUE;
+		}
+	}
+	return closest;
+}
+
+MPF_DECLARE(apr_uint16_t) mpf_codec_linear_sampling_rate_get(const mpf_codec_descriptor_t *descriptor)
+{
+	if(descriptor->sampling_rate == 8000 && descriptor->name.buf &&
+		strcasecmp(descriptor->name.buf,"G722") == 0) {
+		return 16000;
+	}
+	return descriptor->sampling_rate;
+}
+
 /** Create codec descriptor by capabilities */
 MPF_DECLARE(mpf_codec_descriptor_t*) mpf_codec_descriptor_create_by_capabilities(const mpf_codec_capabilities_t *capabilities, const mpf_codec_descriptor_t *peer, apr_pool_t *pool)
 {
@@ -75,7 +112,12 @@ MPF_DECLARE(mpf_codec_descriptor_t*) mpf_codec_descriptor_create_by_capabilities
 	}
 	
 	if(!attribs) {
-		return mpf_codec_lpcm_descriptor_create(8000,1,pool);
+		/* the rate is converted by the resampler, take the supported one closest to the peer's */
+		apr_uint16_t sampling_rate = 8000;
+		if(capabilities && peer) {
+			sampling_rate = mpf_sample_rate_closest_get(capabilities,mpf_codec_linear_sampling_rate_get(peer));
+		}
+		return mpf_codec_lpcm_descriptor_create(sampling_rate,1,pool);
 	}
 
 	descriptor = mpf_codec_descriptor_create(pool);
@@ -24,6 +24,37 @@
 #define G711a_CODEC_NAME        "PCMA"
 #define G711a_CODEC_NAME_LENGTH (sizeof(G711a_CODEC_NAME)-1)
 
+/* Encoding depends on the upper 14 bits of a sample only ((linear >> 2) for both laws),
+   so both directions are table driven: 256 entries to decode, 16K entries to encode */
+#define G711_ENCODE_TABLE_SIZE  (1 << 14)
+#define G711_ENCODE_INDEX(linear) (((apr_uint16_t)(linear)) >> 2)
+
+static apr_int16_t ulaw_decode_table[256];
+static apr_int16_t alaw_decode_table[256];
+static apr_byte_t  ulaw_encode_table[G711_ENCODE_TABLE_SIZE];
+static apr_byte_t  alaw_encode_table[G711_ENCODE_TABLE_SIZE];
+static apt_bool_t  g711_tables_initialized = FALSE;
+
+/** Fill the lookup tables (invoked on codec creation, at startup) */
+static void g711_tables_init(void)
+{
+	apr_size_t i;
+	if(g711_tables_initialized == TRUE) {
+		return;
+	}
+	for(i=0; i<256; i++) {
+		ulaw_decode_table[i] = ulaw_to_linear((apr_byte_t)i);
+		alaw_decode_table[i] = alaw_to_linear((apr_byte_t)i);
+	}
+	for(i=0; i<G711_ENCODE_TABLE_SIZE; i++) {
+		/* any sample of the group, the lower 2 bits are not significant */
+		apr_int16_t linear = (apr_int16_t)(apr_uint16_t)(i << 2);
+		ulaw_encode_table[i] = linear_to_ulaw(linear);
+		alaw_encode_table[i] = linear_to_alaw(linear);
+	}
+	g711_tables_initialized = TRUE;
+}
+
 static apt_bool_t g711_open(mpf_codec_t *codec)
 {
 	return TRUE;
@@ -46,7 +77,7 @@ static apt_bool_t g711u_encode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 	frame_out->size = frame_in->size / sizeof(apr_int16_t);
 
 	for(i=0; i<frame_out->size; i++) {
-		encode_buf[i] = linear_to_ulaw(decode_buf[i]);
+		encode_buf[i] = ulaw_encode_table[G711_ENCODE_INDEX(decode_buf[i])];
 	}
 
 	return TRUE;
@@ -64,7 +95,7 @@ static apt_bool_t g711u_decode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 	frame_out->size = frame_in->size * sizeof(apr_int16_t);
 
 	for(i=0; i<frame_in->size; i++) {
-		decode_buf[i] = ulaw_to_linear(encode_buf[i]);
+		decode_buf[i] = ulaw_decode_table[encode_buf[i]];
 	}
 
 	return TRUE;
@@ -72,11 +103,7 @@ static apt_bool_t g711u_decode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 
 static apt_bool_t g711u_init(mpf_codec_t *codec, mpf_codec_frame_t *frame_out)
 {
-	apr_size_t i;
-	unsigned char *encode_buf = frame_out->buffer;
-	for(i=0; i<frame_out->size; i++) {
-		encode_buf[i] = linear_to_ulaw(0);
-	}
+	memset(frame_out->buffer,ulaw_encode_table[0],frame_out->size);
 
 	return TRUE;
 }
@@ -93,7 +120,7 @@ static apt_bool_t g711a_encode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 	frame_out->size = frame_in->size / sizeof(apr_int16_t);
 
 	for(i=0; i<frame_out->size; i++) {
-		encode_buf[i] = linear_to_alaw(decode_buf[i]);
+		encode_buf[i] = alaw_encode_table[G711_ENCODE_INDEX(decode_buf[i])];
 	}
 
 	return TRUE;
@@ -111,7 +138,7 @@ static apt_bool_t g711a_decode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 	frame_out->size = frame_in->size * sizeof(apr_int16_t);
 
 	for(i=0; i<frame_in->size; i++) {
-		decode_buf[i] = alaw_to_linear(encode_buf[i]);
+		decode_buf[i] = alaw_decode_table[encode_buf[i]];
 	}
 
 	return TRUE;
@@ -119,11 +146,7 @@ static apt_bool_t g711a_decode(mpf_codec_t *codec, const mpf_codec_frame_t *fram
 
 static apt_bool_t g711a_init(mpf_codec_t *codec, mpf_codec_frame_t *frame_out)
 {
-	apr_size_t i;
-	unsigned char *encode_buf = frame_out->buffer;
-	for(i=0; i<frame_out->size; i++) {
-		encode_buf[i] = linear_to_alaw(0);
-	}
+	memset(frame_out->buffer,alaw_encode_table[0],frame_out->size);
 
 	return TRUE;
 }
@@ -180,10 +203,27 @@ static const mpf_codec_attribs_t g711a_attribs = {
 
 mpf_codec_t* mpf_codec_g711u_create(apr_pool_t *pool)
 {
+	g711_tables_init();
 	return mpf_codec_create(&g711u_vtable,&g711u_attribs,&g711u_descriptor,pool);
 }
 
 mpf_codec_t* mpf_codec_g711a_create(apr_pool_t *pool)
 {
+	g711_tables_init();
 	return mpf_codec_create(&g711a_vtable,&g711a_attribs,&g711a_descriptor,pool);
 }
+
+MPF_DECLARE(const apr_int16_t*) mpf_codec_g711_decode_table_get(const apt_str_t *codec_name)
+{
+	if(!codec_name || !codec_name->buf) {
+		return NULL;
+	}
+	g711_tables_init();
+	if(apt_string_compare(codec_name,&g711u_attribs.name) == TRUE) {
+		return ulaw_decode_table;
+	}
+	if(apt_string_compare(codec_name,&g711a_attribs.name) == TRUE) {
+		return alaw_decode_table;
+	}
+	return NULL;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mpf_codec.h"
+#include "mpf_rtp_pt.h"
+#include "g722/g722.h"
+
+#define G722_CODEC_NAME        "G722"
+#define G722_CODEC_NAME_LENGTH (sizeof(G722_CODEC_NAME)-1)
+
+/** Per instance state of G722 codec (reset on open) */
+typedef struct {
+	g722_state_t encoder;
+	g722_state_t decoder;
+} mpf_g722_codec_t;
+
+static apt_bool_t g722_codec_open(mpf_codec_t *codec)
+{
+	mpf_g722_codec_t *g722 = codec->obj;
+	if(!g722) {
+		g722 = apr_palloc(codec->pool,sizeof(mpf_g722_codec_t));
+		codec->obj = g722;
+	}
+	g722_init(&g722->encoder);
+	g722_init(&g722->decoder);
+	return TRUE;
+}
+
+static apt_bool_t g722_codec_close(mpf_codec_t *codec)
+{
+	return TRUE;
+}
+
+static apt_bool_t g722_codec_encode(mpf_codec_t *codec, const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out)
+{
+	mpf_g722_codec_t *g722 = codec->obj;
+	if(!g722) {
+		return FALSE;
+	}
+
+	frame_out->size = g722_encode(
+						&g722->encoder,
+						frame_out->buffer,
+						frame_in->buffer,
+						(int)(frame_in->size / sizeof(apr_int16_t)));
+	return TRUE;
+}
+
+static apt_bool_t g722_codec_decode(mpf_codec_t *codec, const mpf_codec_frame_t *frame_in, mpf_codec_frame_t *frame_out)
+{
+	mpf_g722_codec_t *g722 = codec->obj;
+	if(!g722) {
+		return FALSE;
+	}
+
+	frame_out->size = sizeof(apr_int16_t) * g722_decode(
+						&g722->decoder,
+						frame_out->buffer,
+						frame_in->buffer,
+						(int)frame_in->size);
+	return TRUE;
+}
+
+static apt_bool_t g722_codec_init(mpf_codec_t *codec, mpf_codec_frame_t *frame_out)
+{
+	/* the smallest positive step in both sub-bands decodes to (near) silence */
+	memset(frame_out->buffer,0xFF,frame_out->size);
+	return TRUE;
+}
+
+static const mpf_codec_vtable_t g722_vtable = {
+	g722_codec_open,
+	g722_codec_close,
+	g722_codec_encode,
+	g722_codec_decode,
+	NULL,
+	g722_codec_init
+};
+
+static const mpf_codec_descriptor_t g722_descriptor = {
+	RTP_PT_G722,
+	{G722_CODEC_NAME, G722_CODEC_NAME_LENGTH},
+	8000, /* RTP clock rate, the audio is sampled at 16kHz (RFC3551) */
+	1,
+	{NULL, 0},
+	TRUE
+};
+
+static const mpf_codec_attribs_t g722_attribs = {
+	{G722_CODEC_NAME, G722_CODEC_NAME_LENGTH},  /* codec name */
+	8,                                          /* bits per sample (per RTP clock tick) */
+	MPF_SAMPLE_RATE_8000                        /* supported sampling rates */
+};
+
+mpf_codec_t* mpf_codec_g722_create(apr_pool_t *pool)
+{
+	return mpf_codec_create(&g722_vtable,&g722_attribs,&g722_descriptor,pool);
+}
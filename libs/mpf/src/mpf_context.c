@@ -18,6 +18,9 @@
 #pragma warning(disable: 4127)
 #endif
 #include <apr_ring.h> 
+#include <apr_atomic.h>
+#include <apr_allocator.h>
+#include <apr_strings.h>
 #include "mpf_context.h"
 #include "mpf_termination.h"
 #include "mpf_stream.h"
@@ -26,6 +29,13 @@
 #include "mpf_mixer.h"
 #include "apt_log.h"
 
+/** Max number of topologies allocated from an arena, before the next arena is started */
+#define MPF_TOPOLOGY_ARENA_CAPACITY 1024
+/** Number of ticks the rolling maxima of processing times are kept over (1 sec) */
+#define MPF_PROFILE_WINDOW_TICKS 100
+/** Max number of offenders traced */
+#define MPF_PROFILE_MAX_OFFENDERS 8
+
 /** Item of the association matrix */
 typedef struct {
 	unsigned char on;
@@ -38,6 +48,31 @@ typedef struct {
 	unsigned char      rx_count;
 } header_item_t;
 
+/** Arena the topologies of the contexts of a factory are allocated from in processing order */
+typedef struct mpf_topology_arena_t mpf_topology_arena_t;
+struct mpf_topology_arena_t {
+	/** Pool of the arena itself, with an allocator of its own */
+	apr_pool_t *pool;
+	/** Pool to allocate media processing objects from, cleared once none is in use */
+	apr_pool_t *object_pool;
+	/** Number of contexts whose topology is allocated from the arena */
+	apr_size_t  live;
+	/** Number of topologies allocated since the last clear */
+	apr_size_t  allocated;
+};
+
+/** Processing times of a media processing object */
+typedef struct {
+	/** Names of the terminations the object transfers media between */
+	const char          *label;
+	/** Time the object is processed for by the last tick */
+	apr_interval_time_t  last;
+	/** Max time of the current window */
+	apr_interval_time_t  max;
+	/** Max time of the previous window */
+	apr_interval_time_t  prev_max;
+} mpf_object_profile_t;
+
 /** Media processing context */
 struct mpf_context_t {
 	/** Ring entry */
@@ -63,12 +98,32 @@ struct mpf_context_t {
 	/** Array of media processing objects constructed while 
 	applying topology based on association matrix */
 	apr_array_header_t           *mpf_objects;
+	/** Index in the array of active contexts of the factory, -1 if not active */
+	apr_size_t                    active_index;
+	/** Pool the objects of the topology are allocated from (the pool of the context or an arena) */
+	apr_pool_t                   *object_pool;
+	/** Arena the objects of the topology are allocated from, if any */
+	mpf_topology_arena_t         *arena;
+	/** Array of processing times (mpf_object_profile_t) in the order of the objects, NULL if not profiled */
+	apr_array_header_t           *profiles;
 };
 
 /** Factory of media contexts */
 struct mpf_context_factory_t {
 	/** Ring head */
 	APR_RING_HEAD(mpf_context_head_t, mpf_context_t) head;
+	/** Dense array of contexts with non-empty topology, processed each tick */
+	apr_array_header_t                             *active_contexts;
+	/** Whether to allocate topologies from arenas rather than from the pools of the contexts */
+	apt_bool_t                                      arena_enabled;
+	/** Current arena to allocate topologies from */
+	mpf_topology_arena_t                           *arena;
+	/** Number of contexts created and not yet destroyed */
+	volatile apr_uint32_t                           context_count;
+	/** Whether to time the processing of the objects of the topologies applied */
+	apt_bool_t                                      profile_enabled;
+	/** Number of ticks processed in the current window of rolling maxima */
+	apr_size_t                                      profile_ticks;
 };
 
 
@@ -76,12 +131,22 @@ static APR_INLINE apt_bool_t stream_direction_compatibility_check(mpf_terminatio
 static mpf_object_t* mpf_context_bridge_create(mpf_context_t *context, apr_size_t i);
 static mpf_object_t* mpf_context_multiplier_create(mpf_context_t *context, apr_size_t i);
 static mpf_object_t* mpf_context_mixer_create(mpf_context_t *context, apr_size_t j);
+static void mpf_context_activate(mpf_context_t *context);
+static void mpf_context_deactivate(mpf_context_t *context);
+static apr_pool_t* mpf_context_object_pool_acquire(mpf_context_t *context);
+static void mpf_context_object_pool_release(mpf_context_t *context);
 
 
 MPF_DECLARE(mpf_context_factory_t*) mpf_context_factory_create(apr_pool_t *pool)
 {
 	mpf_context_factory_t *factory = apr_palloc(pool, sizeof(mpf_context_factory_t));
 	APR_RING_INIT(&factory->head, mpf_context_t, link);
+	factory->active_contexts = apr_array_make(pool,16,sizeof(mpf_context_t*));
+	factory->arena_enabled = FALSE;
+	factory->arena = NULL;
+	factory->context_count = 0;
+	factory->profile_enabled = FALSE;
+	factory->profile_ticks = 0;
 	return factory;
 }
 
@@ -93,19 +158,150 @@ MPF_DECLARE(void) mpf_context_factory_destroy(mpf_context_factory_t *factory)
 		mpf_context_destroy(context);
 		APR_RING_REMOVE(context, link);
 	}
+	apr_array_clear(factory->active_contexts);
+	if(factory->arena && !factory->arena->live) {
+		apr_pool_destroy(factory->arena->pool);
+		factory->arena = NULL;
+	}
+}
+
+MPF_DECLARE(void) mpf_context_factory_arena_enable(mpf_context_factory_t *factory, apt_bool_t enable)
+{
+	factory->arena_enabled = enable;
+	if(!enable && factory->arena) {
+		/* an arena in use is destroyed once the last topology allocated from it is destroyed */
+		if(!factory->arena->live) {
+			apr_pool_destroy(factory->arena->pool);
+		}
+		factory->arena = NULL;
+	}
+}
+
+MPF_DECLARE(void) mpf_context_factory_profile_enable(mpf_context_factory_t *factory, apt_bool_t enable)
+{
+	factory->profile_enabled = enable;
+	factory->profile_ticks = 0;
+}
+
+/** Process context timing each object, the end of one object being the start of the next one */
+static apt_bool_t mpf_context_profile_process(mpf_context_t *context, apt_bool_t window_end)
+{
+	int i;
+	mpf_object_t *object;
+	mpf_object_profile_t *profile;
+	apr_time_t start;
+	apr_time_t end;
+	apt_bool_t transferred = FALSE;
+	if(!context->profiles) {
+		/* the topology is applied before profiling is enabled */
+		return mpf_context_process(context);
+	}
+
+	start = apr_time_now();
+	for(i=0; i<context->mpf_objects->nelts; i++) {
+		object = APR_ARRAY_IDX(context->mpf_objects,i,mpf_object_t*);
+		profile = &APR_ARRAY_IDX(context->profiles,i,mpf_object_profile_t);
+		if(window_end == TRUE) {
+			profile->prev_max = profile->max;
+			profile->max = 0;
+		}
+		if(object && object->process) {
+			if(object->process(object) == TRUE) {
+				transferred = TRUE;
+			}
+		}
+		end = apr_time_now();
+		profile->last = end - start;
+		if(profile->last > profile->max) {
+			profile->max = profile->last;
+		}
+		start = end;
+	}
+	return transferred;
 }
 
 MPF_DECLARE(apt_bool_t) mpf_context_factory_process(mpf_context_factory_t *factory)
 {
-	mpf_context_t *context;
-	for(context = APR_RING_FIRST(&factory->head);
-			context != APR_RING_SENTINEL(&factory->head, mpf_context_t, link);
-				context = APR_RING_NEXT(context, link)) {
-		
-		mpf_context_process(context);
+	int i;
+	apt_bool_t transferred = FALSE;
+	apt_bool_t window_end;
+	mpf_context_t **contexts = (mpf_context_t**)factory->active_contexts->elts;
+	if(factory->profile_enabled == TRUE) {
+		window_end = (++factory->profile_ticks >= MPF_PROFILE_WINDOW_TICKS) ? TRUE : FALSE;
+		if(window_end == TRUE) {
+			factory->profile_ticks = 0;
+		}
+		for(i=0; i<factory->active_contexts->nelts; i++) {
+			if(mpf_context_profile_process(contexts[i],window_end) == TRUE) {
+				transferred = TRUE;
+			}
+		}
+		return transferred;
 	}
 
-	return TRUE;
+	/* only contexts with applied topology are processed */
+	for(i=0; i<factory->active_contexts->nelts; i++) {
+		if(mpf_context_process(contexts[i]) == TRUE) {
+			transferred = TRUE;
+		}
+	}
+
+	return transferred;
+}
+
+MPF_DECLARE(void) mpf_context_factory_profile_trace(const mpf_context_factory_t *factory, apr_size_t count)
+{
+	int i, j;
+	apr_size_t k, n = 0;
+	mpf_context_t *offender_contexts[MPF_PROFILE_MAX_OFFENDERS];
+	const mpf_object_profile_t *offenders[MPF_PROFILE_MAX_OFFENDERS];
+	mpf_context_t **contexts = (mpf_context_t**)factory->active_contexts->elts;
+	if(!count) {
+		return;
+	}
+	if(count > MPF_PROFILE_MAX_OFFENDERS) {
+		count = MPF_PROFILE_MAX_OFFENDERS;
+	}
+
+	/* keep the objects taking the longest by the last tick, in descending order */
+	for(i=0; i<factory->active_contexts->nelts; i++) {
+		const apr_array_header_t *profiles = contexts[i]->profiles;
+		if(!profiles) {
+			continue;
+		}
+		for(j=0; j<profiles->nelts; j++) {
+			const mpf_object_profile_t *profile = &APR_ARRAY_IDX(profiles,j,mpf_object_profile_t);
+			if(n == count && profile->last <= offenders[n-1]->last) {
+				continue;
+			}
+			k = n < count ? n++ : n - 1;
+			for(; k > 0 && offenders[k-1]->last < profile->last; k--) {
+				offenders[k] = offenders[k-1];
+				offender_contexts[k] = offender_contexts[k-1];
+			}
+			offenders[k] = profile;
+			offender_contexts[k] = contexts[i];
+		}
+	}
+
+	for(k=0; k<n; k++) {
+		apr_interval_time_t max = offenders[k]->max > offenders[k]->prev_max ? offenders[k]->max : offenders[k]->prev_max;
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Tick Offender [%s] [%s] took [%"APR_TIME_T_FMT" usec] max [%"APR_TIME_T_FMT" usec]",
+			offender_contexts[k]->name,
+			offenders[k]->label,
+			offenders[k]->last,
+			max);
+	}
+}
+
+MPF_DECLARE(apr_size_t) mpf_context_factory_count_get(const mpf_context_factory_t *factory)
+{
+	return apr_atomic_read32((volatile apr_uint32_t*)&factory->context_count);
+}
+
+MPF_DECLARE(mpf_context_factory_t*) mpf_context_factory_get(const mpf_context_t *context)
+{
+	return context->factory;
 }
 
  
@@ -131,6 +327,10 @@ MPF_DECLARE(mpf_context_t*) mpf_context_create(
 	context->capacity = max_termination_count;
 	context->count = 0;
 	context->mpf_objects = apr_array_make(pool,1,sizeof(mpf_object_t*));
+	context->active_index = (apr_size_t)-1;
+	context->object_pool = pool;
+	context->arena = NULL;
+	context->profiles = NULL;
 	context->header = apr_palloc(pool,context->capacity * sizeof(header_item_t));
 	context->matrix = apr_palloc(pool,context->capacity * sizeof(matrix_item_t*));
 	for(i=0; i<context->capacity; i++) {
@@ -145,6 +345,7 @@ MPF_DECLARE(mpf_context_t*) mpf_context_create(
 		}
 	}
 
+	apr_atomic_inc32(&factory->context_count);
 	return context;
 }
 
@@ -159,6 +360,7 @@ MPF_DECLARE(apt_bool_t) mpf_context_destroy(mpf_context_t *context)
 			mpf_termination_subtract(termination);
 		}
 	}
+	apr_atomic_dec32(&context->factory->context_count);
 	return TRUE;
 }
 
@@ -235,6 +437,12 @@ MPF_DECLARE(apt_bool_t) mpf_context_termination_subtract(mpf_context_t *context,
 	if(!context->count) {
 		apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Remove Media Context %s",context->name);
 		APR_RING_REMOVE(context,link);
+		mpf_context_deactivate(context);
+		if(context->arena) {
+			/* the objects are not processed anymore, nor referenced once the arena is released */
+			apr_array_clear(context->mpf_objects);
+			mpf_context_object_pool_release(context);
+		}
 	}
 	return TRUE;
 }
@@ -365,13 +573,46 @@ MPF_DECLARE(apt_bool_t) mpf_context_associations_reset(mpf_context_t *context)
 	return TRUE;
 }
 
-static apt_bool_t mpf_context_object_add(mpf_context_t *context, mpf_object_t *object)
+/**
+ * Make label of the object transferring media from (tx) or to (rx) termination i,
+ * e.g. "rtp-tm->Vosk-Recog-1"
+ */
+static const char* mpf_context_object_label_make(mpf_context_t *context, apr_size_t i, apt_bool_t tx)
+{
+	apr_size_t j;
+	const char *peers = NULL;
+	const char *name = context->header[i].termination->name;
+	for(j=0; j<context->capacity; j++) {
+		mpf_termination_t *peer = context->header[j].termination;
+		if(!peer || !(tx == TRUE ? context->matrix[i][j].on : context->matrix[j][i].on)) {
+			continue;
+		}
+		peers = peers ?
+			apr_pstrcat(context->object_pool,peers,",",peer->name,NULL) :
+			peer->name;
+	}
+	if(!peers) {
+		peers = "";
+	}
+	return tx == TRUE ?
+		apr_pstrcat(context->object_pool,name,"->",peers,NULL) :
+		apr_pstrcat(context->object_pool,peers,"->",name,NULL);
+}
+
+static apt_bool_t mpf_context_object_add(mpf_context_t *context, mpf_object_t *object, apr_size_t i, apt_bool_t tx)
 {
 	if(!object) {
 		return FALSE;
 	}
 	
 	APR_ARRAY_PUSH(context->mpf_objects, mpf_object_t*) = object;
+	if(context->profiles) {
+		mpf_object_profile_t *profile = apr_array_push(context->profiles);
+		profile->label = mpf_context_object_label_make(context,i,tx);
+		profile->last = 0;
+		profile->max = 0;
+		profile->prev_max = 0;
+	}
 #if 1
 	mpf_object_trace(object);
 #endif
@@ -386,6 +627,10 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_apply(mpf_context_t *context)
 	
 	/* first destroy existing topology / if any */
 	mpf_context_topology_destroy(context);
+	context->object_pool = mpf_context_object_pool_acquire(context);
+	if(context->factory->profile_enabled == TRUE) {
+		context->profiles = apr_array_make(context->object_pool,2,sizeof(mpf_object_profile_t));
+	}
 
 	for(i=0,k=0; i<context->capacity && k<context->count; i++) {
 		header_item = &context->header[i];
@@ -403,14 +648,20 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_apply(mpf_context_t *context)
 				object = mpf_context_multiplier_create(context,i);
 			}
 
-			mpf_context_object_add(context,object);
+			mpf_context_object_add(context,object,i,TRUE);
 		}
 		if(header_item->rx_count > 1) {
 			object = mpf_context_mixer_create(context,i);
-			mpf_context_object_add(context,object);
+			mpf_context_object_add(context,object,i,FALSE);
 		}
 	}
 
+	if(context->mpf_objects->nelts) {
+		mpf_context_activate(context);
+	}
+	else {
+		mpf_context_object_pool_release(context);
+	}
 	return TRUE;
 }
 
@@ -425,6 +676,10 @@ MPF_DECLARE(apt_bool_t) mpf_context_topology_destroy(mpf_context_t *context)
 		}
 		apr_array_clear(context->mpf_objects);
 	}
+	/* the processing times are allocated along with the objects */
+	context->profiles = NULL;
+	mpf_context_deactivate(context);
+	mpf_context_object_pool_release(context);
 	return TRUE;
 }
 
@@ -432,15 +687,117 @@ MPF_DECLARE(apt_bool_t) mpf_context_process(mpf_context_t *context)
 {
 	int i;
 	mpf_object_t *object;
+	apt_bool_t transferred = FALSE;
 	for(i=0; i<context->mpf_objects->nelts; i++) {
 		object = APR_ARRAY_IDX(context->mpf_objects,i,mpf_object_t*);
 		if(object && object->process) {
-			object->process(object);
+			if(object->process(object) == TRUE) {
+				transferred = TRUE;
+			}
 		}
 	}
-	return TRUE;
+	return transferred;
 }
 
+/** Add context to the array of active contexts of the factory */
+static void mpf_context_activate(mpf_context_t *context)
+{
+	apr_array_header_t *active_contexts = context->factory->active_contexts;
+	if(context->active_index != (apr_size_t)-1) {
+		return;
+	}
+	context->active_index = active_contexts->nelts;
+	APR_ARRAY_PUSH(active_contexts, mpf_context_t*) = context;
+}
+
+/** Remove context from the array of active contexts, the last one takes its place */
+static void mpf_context_deactivate(mpf_context_t *context)
+{
+	apr_array_header_t *active_contexts = context->factory->active_contexts;
+	mpf_context_t *last;
+	if(context->active_index == (apr_size_t)-1) {
+		return;
+	}
+	last = APR_ARRAY_IDX(active_contexts, active_contexts->nelts - 1, mpf_context_t*);
+	APR_ARRAY_IDX(active_contexts, context->active_index, mpf_context_t*) = last;
+	last->active_index = context->active_index;
+	active_contexts->nelts--;
+	context->active_index = (apr_size_t)-1;
+}
+/** Create arena with an allocator of its own, used by the thread processing the factory only */
+static mpf_topology_arena_t* mpf_topology_arena_create(void)
+{
+	mpf_topology_arena_t *arena;
+	apr_allocator_t *allocator = NULL;
+	apr_pool_t *pool = NULL;
+	if(apr_allocator_create(&allocator) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_pool_create_ex(&pool,NULL,NULL,allocator) != APR_SUCCESS) {
+		apr_allocator_destroy(allocator);
+		return NULL;
+	}
+	apr_allocator_owner_set(allocator,pool);
+
+	arena = apr_palloc(pool,sizeof(mpf_topology_arena_t));
+	arena->pool = pool;
+	arena->object_pool = NULL;
+	arena->live = 0;
+	arena->allocated = 0;
+	if(apr_pool_create(&arena->object_pool,pool) != APR_SUCCESS) {
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+	return arena;
+}
+
+/** Get pool to allocate the objects of the topology from */
+static apr_pool_t* mpf_context_object_pool_acquire(mpf_context_t *context)
+{
+	mpf_context_factory_t *factory = context->factory;
+	mpf_topology_arena_t *arena = factory->arena;
+	if(!factory->arena_enabled) {
+		return context->pool;
+	}
+
+	if(arena && arena->live && arena->allocated >= MPF_TOPOLOGY_ARENA_CAPACITY) {
+		/* start the next arena, the full one is destroyed once drained */
+		arena = NULL;
+	}
+	if(!arena) {
+		arena = mpf_topology_arena_create();
+		if(!arena) {
+			return context->pool;
+		}
+		factory->arena = arena;
+	}
+
+	if(!arena->live && arena->allocated) {
+		/* reuse the memory of the drained arena from the start */
+		apr_pool_clear(arena->object_pool);
+		arena->allocated = 0;
+	}
+	arena->live++;
+	arena->allocated++;
+	context->arena = arena;
+	return arena->object_pool;
+}
+
+/** Release the pool the objects of the topology have been allocated from */
+static void mpf_context_object_pool_release(mpf_context_t *context)
+{
+	mpf_topology_arena_t *arena = context->arena;
+	context->object_pool = context->pool;
+	if(!arena) {
+		return;
+	}
+
+	context->arena = NULL;
+	arena->live--;
+	if(!arena->live && arena != context->factory->arena) {
+		apr_pool_destroy(arena->pool);
+	}
+}
 
 static mpf_object_t* mpf_context_bridge_create(mpf_context_t *context, apr_size_t i)
 {
@@ -470,7 +827,7 @@ static mpf_object_t* mpf_context_bridge_create(mpf_context_t *context, apr_size_
 				header_item2->termination->audio_stream,
 				header_item1->termination->codec_manager,
 				context->name,
-				context->pool);
+				context->object_pool);
 		}
 	}
 	return NULL;
@@ -479,11 +836,12 @@ static mpf_object_t* mpf_context_bridge_create(mpf_context_t *context, apr_size_
 static mpf_object_t* mpf_context_multiplier_create(mpf_context_t *context, apr_size_t i)
 {
 	mpf_audio_stream_t **sink_arr;
+	mpf_object_t *multiplier;
 	header_item_t *header_item1 = &context->header[i];
 	header_item_t *header_item2;
 	matrix_item_t *item;
 	apr_size_t j,k;
-	sink_arr = apr_palloc(context->pool,header_item1->tx_count * sizeof(mpf_audio_stream_t*));
+	sink_arr = apr_palloc(context->object_pool,header_item1->tx_count * sizeof(mpf_audio_stream_t*));
 	for(j=0,k=0; j<context->capacity && k<header_item1->tx_count; j++) {
 		header_item2 = &context->header[j];
 		if(!header_item2->termination) {
@@ -496,13 +854,17 @@ static mpf_object_t* mpf_context_multiplier_create(mpf_context_t *context, apr_s
 		sink_arr[k] = header_item2->termination->audio_stream;
 		k++;
 	}
-	return mpf_multiplier_create(
+	multiplier = mpf_multiplier_create(
 				header_item1->termination->audio_stream,
 				sink_arr,
 				header_item1->tx_count,
 				header_item1->termination->codec_manager,
 				context->name,
-				context->pool);
+				context->object_pool);
+	if(multiplier) {
+		mpf_multiplier_frame_pool_set(multiplier,header_item1->termination->frame_pool);
+	}
+	return multiplier;
 }
 
 static mpf_object_t* mpf_context_mixer_create(mpf_context_t *context, apr_size_t j)
@@ -512,7 +874,7 @@ static mpf_object_t* mpf_context_mixer_create(mpf_context_t *context, apr_size_t
 	header_item_t *header_item2;
 	matrix_item_t *item;
 	apr_size_t i,k;
-	source_arr = apr_palloc(context->pool,header_item1->rx_count * sizeof(mpf_audio_stream_t*));
+	source_arr = apr_palloc(context->object_pool,header_item1->rx_count * sizeof(mpf_audio_stream_t*));
 	for(i=0,k=0; i<context->capacity && k<header_item1->rx_count; i++) {
 		header_item2 = &context->header[i];
 		if(!header_item2->termination) {
@@ -531,7 +893,7 @@ static mpf_object_t* mpf_context_mixer_create(mpf_context_t *context, apr_size_t
 				header_item1->termination->audio_stream,
 				header_item1->termination->codec_manager,
 				context->name,
-				context->pool);
+				context->object_pool);
 }
 
 static APR_INLINE apt_bool_t stream_direction_compatibility_check(mpf_termination_t *termination1, mpf_termination_t *termination2)
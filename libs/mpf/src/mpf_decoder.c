@@ -24,6 +24,8 @@ struct mpf_decoder_t {
 	mpf_audio_stream_t *source;
 	mpf_codec_t        *codec;
 	mpf_frame_t         frame_in;
+	/** Buffer of the input frame, unless referenced from the source */
+	apr_byte_t         *buffer;
 };
 
 
@@ -52,7 +54,9 @@ static apt_bool_t mpf_decoder_process(mpf_audio_stream_t *stream, mpf_frame_t *f
 	mpf_decoder_t *decoder = stream->obj;
 	decoder->frame_in.type = MEDIA_FRAME_TYPE_NONE;
 	decoder->frame_in.marker = MPF_MARKER_NONE;
-	if(mpf_audio_stream_frame_read(decoder->source,&decoder->frame_in) != TRUE) {
+	decoder->frame_in.codec_frame.buffer = decoder->buffer;
+	/* encoded audio is decoded straight from the storage of the source */
+	if(mpf_audio_stream_frame_ref_read(decoder->source,&decoder->frame_in) != TRUE) {
 		return FALSE;
 	}
 
@@ -112,7 +116,7 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_decoder_create(mpf_audio_stream_t *source,
 		return NULL;
 	}
 	decoder->base->rx_descriptor = mpf_codec_lpcm_descriptor_create(
-		source->rx_descriptor->sampling_rate,
+		mpf_codec_linear_sampling_rate_get(source->rx_descriptor),
 		source->rx_descriptor->channel_count,
 		pool);
 	decoder->base->rx_event_descriptor = source->rx_event_descriptor;
@@ -122,6 +126,7 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_decoder_create(mpf_audio_stream_t *source,
 
 	frame_size = mpf_codec_frame_size_calculate(source->rx_descriptor,codec->attribs);
 	decoder->frame_in.codec_frame.size = frame_size;
-	decoder->frame_in.codec_frame.buffer = apr_palloc(pool,frame_size);
+	decoder->buffer = apr_palloc(pool,frame_size);
+	decoder->frame_in.codec_frame.buffer = decoder->buffer;
 	return decoder->base;
 }
@@ -24,6 +24,23 @@
 #	define M_PI 3.141592653589793238462643
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MPF_DTMF_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+/* AVX2 is not assumed at compile-time, but selected by CPU capabilities */
+#define MPF_DTMF_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+/* double precision lanes are available on AArch64 only */
+#define MPF_DTMF_NEON
+#include <arm_neon.h>
+#endif
+
 /** Max detected DTMF digits buffer length */
 #define MPF_DTMFDET_BUFFER_LEN  32
 
@@ -44,16 +61,27 @@
  *
  * Then energy of frequency f in the signal is:
  * X(f)X'(f) = s(t-2)^2 + s(t-1)^2 - coef*s(t-2)*s(t-1)
+ *
+ * The states of all the frequencies are laid out as arrays, so that
+ * the filters are run as one group of SIMD lanes over a block of samples.
  */
 typedef struct goertzel_state_t {
 	/** coef = cos(2*pi*f_tone/f_sampling) */
-	double coef;
-	/** s(t-2) or resulting energy @see goertzel_state_t */
-	double s1;
+	double coef[DTMF_FREQUENCIES];
+	/** s(t-2) @see goertzel_state_t */
+	double s1[DTMF_FREQUENCIES];
 	/** s(t-1) @see goertzel_state_t */
-	double s2;
+	double s2[DTMF_FREQUENCIES];
 } goertzel_state_t;
 
+/** Prototype of Goertzel's kernel running the filters over a block of samples */
+typedef void (*goertzel_kernel_f)(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count);
+
+static void goertzel_kernel_select(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count);
+
+/** Kernel resolved on the first call */
+static goertzel_kernel_f goertzel_kernel = goertzel_kernel_select;
+
 /** DTMF frequencies */
 static const double dtmf_freqs[DTMF_FREQUENCIES] = {
 	 697,  770,  852,  941,  /* Row frequencies */
@@ -79,7 +107,7 @@ struct mpf_dtmf_detector_t {
 	/** Number of lost digits due to full buffer */
 	apr_size_t                     lost_digits;
 	/** Frequency analyzators */
-	struct goertzel_state_t        energies[DTMF_FREQUENCIES];
+	struct goertzel_state_t        energies;
 	/** Total energy of signal */
 	double                         totenergy;
 	/** Number of samples in a window */
@@ -88,8 +116,127 @@ struct mpf_dtmf_detector_t {
 	apr_size_t                     nsamples;
 	/** Previously detected and last reported digits */
 	char                           last1, last2, curr;
+	/** Activity detector to skip in-band detection during silence (optional) */
+	const mpf_activity_detector_t *activity_detector;
 };
 
+static void goertzel_scalar_kernel(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count)
+{
+	apr_size_t i, n;
+	double s;
+	for (n = 0; n < count; n++) {
+		for (i = 0; i < DTMF_FREQUENCIES; i++) {
+			s = state->s1[i];
+			state->s1[i] = state->s2[i];
+			state->s2[i] = samples[n] + state->coef[i] * state->s1[i] - s;
+		}
+	}
+}
+
+#ifdef MPF_DTMF_SSE2
+static void goertzel_sse2_kernel(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count)
+{
+	__m128d coef[DTMF_FREQUENCIES/2], s1[DTMF_FREQUENCIES/2], s2[DTMF_FREQUENCIES/2];
+	__m128d x, s;
+	apr_size_t i, n;
+	for (i = 0; i < DTMF_FREQUENCIES/2; i++) {
+		coef[i] = _mm_loadu_pd(state->coef + 2*i);
+		s1[i] = _mm_loadu_pd(state->s1 + 2*i);
+		s2[i] = _mm_loadu_pd(state->s2 + 2*i);
+	}
+	for (n = 0; n < count; n++) {
+		x = _mm_set1_pd(samples[n]);
+		for (i = 0; i < DTMF_FREQUENCIES/2; i++) {
+			s = s1[i];
+			s1[i] = s2[i];
+			s2[i] = _mm_sub_pd(_mm_add_pd(x, _mm_mul_pd(coef[i], s1[i])), s);
+		}
+	}
+	for (i = 0; i < DTMF_FREQUENCIES/2; i++) {
+		_mm_storeu_pd(state->s1 + 2*i, s1[i]);
+		_mm_storeu_pd(state->s2 + 2*i, s2[i]);
+	}
+}
+#endif
+
+#ifdef MPF_DTMF_AVX2
+__attribute__((target("avx2")))
+static void goertzel_avx2_kernel(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count)
+{
+	__m256d coef[DTMF_FREQUENCIES/4], s1[DTMF_FREQUENCIES/4], s2[DTMF_FREQUENCIES/4];
+	__m256d x, s;
+	apr_size_t i, n;
+	for (i = 0; i < DTMF_FREQUENCIES/4; i++) {
+		coef[i] = _mm256_loadu_pd(state->coef + 4*i);
+		s1[i] = _mm256_loadu_pd(state->s1 + 4*i);
+		s2[i] = _mm256_loadu_pd(state->s2 + 4*i);
+	}
+	for (n = 0; n < count; n++) {
+		x = _mm256_set1_pd(samples[n]);
+		for (i = 0; i < DTMF_FREQUENCIES/4; i++) {
+			s = s1[i];
+			s1[i] = s2[i];
+			s2[i] = _mm256_sub_pd(_mm256_add_pd(x, _mm256_mul_pd(coef[i], s1[i])), s);
+		}
+	}
+	for (i = 0; i < DTMF_FREQUENCIES/4; i++) {
+		_mm256_storeu_pd(state->s1 + 4*i, s1[i]);
+		_mm256_storeu_pd(state->s2 + 4*i, s2[i]);
+	}
+}
+#endif
+
+#ifdef MPF_DTMF_NEON
+static void goertzel_neon_kernel(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count)
+{
+	float64x2_t coef[DTMF_FREQUENCIES/2], s1[DTMF_FREQUENCIES/2], s2[DTMF_FREQUENCIES/2];
+	float64x2_t x, s;
+	apr_size_t i, n;
+	for (i = 0; i < DTMF_FREQUENCIES/2; i++) {
+		coef[i] = vld1q_f64(state->coef + 2*i);
+		s1[i] = vld1q_f64(state->s1 + 2*i);
+		s2[i] = vld1q_f64(state->s2 + 2*i);
+	}
+	for (n = 0; n < count; n++) {
+		x = vdupq_n_f64(samples[n]);
+		for (i = 0; i < DTMF_FREQUENCIES/2; i++) {
+			s = s1[i];
+			s1[i] = s2[i];
+			s2[i] = vsubq_f64(vaddq_f64(x, vmulq_f64(coef[i], s1[i])), s);
+		}
+	}
+	for (i = 0; i < DTMF_FREQUENCIES/2; i++) {
+		vst1q_f64(state->s1 + 2*i, s1[i]);
+		vst1q_f64(state->s2 + 2*i, s2[i]);
+	}
+}
+#endif
+
+/** Resolve the kernel by CPU capabilities, then run it */
+static void goertzel_kernel_select(goertzel_state_t *state, const apr_int16_t *samples, apr_size_t count)
+{
+	goertzel_kernel_f kernel = goertzel_scalar_kernel;
+#if defined(MPF_DTMF_NEON)
+	kernel = goertzel_neon_kernel;
+#elif defined(MPF_DTMF_SSE2)
+	kernel = goertzel_sse2_kernel;
+#endif
+#ifdef MPF_DTMF_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		kernel = goertzel_avx2_kernel;
+	}
+#endif
+	goertzel_kernel = kernel;
+	kernel(state, samples, count);
+}
+
+static APR_INLINE void goertzel_state_reset(goertzel_state_t *state)
+{
+	memset(state->s1, 0, sizeof(state->s1));
+	memset(state->s2, 0, sizeof(state->s2));
+}
+
 
 MPF_DECLARE(struct mpf_dtmf_detector_t *) mpf_dtmf_detector_create_ex(
 								const struct mpf_audio_stream_t *stream,
@@ -116,15 +263,15 @@ MPF_DECLARE(struct mpf_dtmf_detector_t *) mpf_dtmf_detector_create_ex(
 	det->buf[0] = 0;
 	det->digits = 0;
 	det->lost_digits = 0;
+	det->activity_detector = NULL;
 
 	if (det->band & MPF_DTMF_DETECTOR_INBAND) {
 		apr_size_t i;
 		for (i = 0; i < DTMF_FREQUENCIES; i++) {
-			det->energies[i].coef = 2 * cos(2 * M_PI * dtmf_freqs[i] /
+			det->energies.coef[i] = 2 * cos(2 * M_PI * dtmf_freqs[i] /
 				stream->tx_descriptor->sampling_rate);
-			det->energies[i].s1 = 0;
-			det->energies[i].s2 = 0;
 		}
+		goertzel_state_reset(&det->energies);
 		det->nsamples = 0;
 		det->wsamples = GOERTZEL_SAMPLES_8K * (stream->tx_descriptor->sampling_rate / 8000);
 		det->last1 = det->last2 = det->curr = 0;
@@ -161,9 +308,17 @@ MPF_DECLARE(void) mpf_dtmf_detector_reset(struct mpf_dtmf_detector_t *detector)
 	detector->curr = detector->last1 = detector->last2 = 0;
 	detector->nsamples = 0;
 	detector->totenergy = 0;
+	goertzel_state_reset(&detector->energies);
 	apr_thread_mutex_unlock(detector->mutex);
 }
 
+MPF_DECLARE(void) mpf_dtmf_detector_activity_detector_set(
+								struct mpf_dtmf_detector_t *detector,
+								const struct mpf_activity_detector_t *activity_detector)
+{
+	detector->activity_detector = activity_detector;
+}
+
 static APR_INLINE void mpf_dtmf_detector_add_digit(
 								struct mpf_dtmf_detector_t *detector,
 								char digit)
@@ -178,19 +333,18 @@ static APR_INLINE void mpf_dtmf_detector_add_digit(
 	apr_thread_mutex_unlock(detector->mutex);
 }
 
-static APR_INLINE void goertzel_sample(
+static APR_INLINE void goertzel_block(
 								struct mpf_dtmf_detector_t *detector,
-								apr_int16_t sample)
+								const apr_int16_t *samples,
+								apr_size_t count)
 {
-	apr_size_t i;
-	double s;
-	for (i = 0; i < DTMF_FREQUENCIES; i++) {
-		s = detector->energies[i].s1;
-		detector->energies[i].s1 = detector->energies[i].s2;
-		detector->energies[i].s2 = sample +
-			detector->energies[i].coef * detector->energies[i].s1 - s;
+	apr_size_t n;
+	apr_int64_t totenergy = 0;
+	goertzel_kernel(&detector->energies, samples, count);
+	for (n = 0; n < count; n++) {
+		totenergy += samples[n] * samples[n];
 	}
-	detector->totenergy += sample * sample;
+	detector->totenergy += (double)totenergy;
 }
 
 static void goertzel_energies_digit(struct mpf_dtmf_detector_t *detector)
@@ -201,9 +355,9 @@ static void goertzel_energies_digit(struct mpf_dtmf_detector_t *detector)
 
 	/* Calculate energies and maxims */
 	for (i = 0; i < DTMF_FREQUENCIES; i++) {
-		double eng = detector->energies[i].s1 * detector->energies[i].s1 +
-			detector->energies[i].s2 * detector->energies[i].s2 -
-			detector->energies[i].coef * detector->energies[i].s1 * detector->energies[i].s2;
+		double eng = detector->energies.s1[i] * detector->energies.s1[i] +
+			detector->energies.s2[i] * detector->energies.s2[i] -
+			detector->energies.coef[i] * detector->energies.s1[i] * detector->energies.s2[i];
 		if (i < DTMF_FREQUENCIES/2) {
 			if (eng > reng) {
 				rmax = i;
@@ -253,10 +407,7 @@ static void goertzel_energies_digit(struct mpf_dtmf_detector_t *detector)
 	detector->last2 = digit;
 
 	/* Reset Goertzel's detectors */
-	for (i = 0; i < DTMF_FREQUENCIES; i++) {
-		detector->energies[i].s1 = 0;
-		detector->energies[i].s2 = 0;
-	}
+	goertzel_state_reset(&detector->energies);
 	detector->totenergy = 0;
 }
 
@@ -280,12 +431,32 @@ MPF_DECLARE(void) mpf_dtmf_detector_get_frame(
 	}
 
 	if ((detector->band & MPF_DTMF_DETECTOR_INBAND) && (frame->type & MEDIA_FRAME_TYPE_AUDIO)) {
-		apr_int16_t *samples = frame->codec_frame.buffer;
-		apr_size_t i;
+		const apr_int16_t *samples = frame->codec_frame.buffer;
+		apr_size_t count = frame->codec_frame.size / 2;
+		apr_size_t block;
+
+		if (detector->activity_detector &&
+			!mpf_activity_detector_activity_check(detector->activity_detector))
+		{
+			/* No tone in silence, drop the pending window and digit */
+			if (detector->nsamples || detector->curr || detector->last1 || detector->last2) {
+				goertzel_state_reset(&detector->energies);
+				detector->totenergy = 0;
+				detector->nsamples = 0;
+				detector->curr = detector->last1 = detector->last2 = 0;
+			}
+			return;
+		}
 
-		for (i = 0; i < frame->codec_frame.size / 2; i++) {
-			goertzel_sample(detector, samples[i]);
-			if (++detector->nsamples >= detector->wsamples) {
+		while (count) {
+			block = detector->wsamples - detector->nsamples;
+			if (block > count)
+				block = count;
+			goertzel_block(detector, samples, block);
+			samples += block;
+			count -= block;
+			detector->nsamples += block;
+			if (detector->nsamples >= detector->wsamples) {
 				goertzel_energies_digit(detector);
 				detector->nsamples = 0;
 			}
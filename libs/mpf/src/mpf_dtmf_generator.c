@@ -15,7 +15,9 @@
  */
 
 #include "mpf_dtmf_generator.h"
+#include <stdlib.h>
 #include "apr.h"
+#include "apr_atomic.h"
 #include "apr_thread_mutex.h"
 #include "apt_log.h"
 #include "mpf_named_event.h"
@@ -37,6 +39,12 @@
 /** Amplitude of single sine wave from tone generator */
 #define DTMF_SINE_AMPLITUDE 12288
 
+/** Number of distinct DTMF frequencies (4 rows, 4 columns) */
+#define DTMF_TONE_COUNT     8
+
+/** Number of sampling rates tone tables are kept for */
+#define DTMF_TONE_RATE_COUNT 4
+
 /** State of the DTMF generator */
 typedef enum mpf_dtmf_generator_state_e {
 	/** Ready to generate next digit in queue */
@@ -85,6 +93,33 @@ static const double dtmf_freq[DTMF_EVENT_ID_MAX+1][2] = {
 	{941, 1633}   /* D */
 };
 
+/** Mapping tone table index to frequency */
+static const apr_uint32_t dtmf_tone_freq[DTMF_TONE_COUNT] = {
+	697, 770, 852, 941, 1209, 1336, 1477, 1633
+};
+
+/** Sampling rates tone tables are kept for, other rates use the IIR oscillators */
+static const apr_uint32_t dtmf_tone_rates[DTMF_TONE_RATE_COUNT] = {
+	8000, 16000, 32000, 48000
+};
+
+/**
+ * Precomputed sine waves of the DTMF frequencies at a sampling rate.
+ *
+ * Each wave spans one exact period of its frequency, sampling_rate / gcd(f, sampling_rate)
+ * samples (one second at most, as the frequencies are integers), so it wraps seamlessly.
+ * The tables are shared by all the generators of the process and never freed.
+ */
+typedef struct dtmf_tone_table_t {
+	/** Samples of each wave */
+	apr_int16_t *samples[DTMF_TONE_COUNT];
+	/** Number of samples of each wave */
+	apr_size_t   length[DTMF_TONE_COUNT];
+} dtmf_tone_table_t;
+
+/** Tone tables by sampling rate (@see dtmf_tone_rates), built once and published atomically */
+static struct dtmf_tone_table_t * volatile dtmf_tone_tables[DTMF_TONE_RATE_COUNT];
+
 /** Media Processing Framework's Dual Tone Multiple Frequncy generator */
 struct mpf_dtmf_generator_t {
 	/** Generator state */
@@ -113,6 +148,20 @@ struct mpf_dtmf_generator_t {
 	struct sine_state_t              sine1;
 	/** Higher frequency generator */
 	struct sine_state_t              sine2;
+	/** Tone tables of the audio sampling rate (NULL if the IIR oscillators are used) */
+	const struct dtmf_tone_table_t  *tones;
+	/** Lower frequency wave of the current digit */
+	const apr_int16_t               *wave1;
+	/** Higher frequency wave of the current digit */
+	const apr_int16_t               *wave2;
+	/** Length of the lower frequency wave */
+	apr_size_t                       wave1_length;
+	/** Length of the higher frequency wave */
+	apr_size_t                       wave2_length;
+	/** Position in the lower frequency wave */
+	apr_size_t                       wave1_pos;
+	/** Position in the higher frequency wave */
+	apr_size_t                       wave2_pos;
 	/** Sampling rate of audio in Hz; used in tone generator */
 	apr_uint32_t                     sample_rate_audio;
 	/** Sampling rate of telephone-events in Hz; used for timing */
@@ -124,6 +173,83 @@ struct mpf_dtmf_generator_t {
 };
 
 
+/** Greatest common divisor */
+static apr_uint32_t dtmf_gcd(apr_uint32_t a, apr_uint32_t b)
+{
+	while (b) {
+		apr_uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/** Build tone tables of the sampling rate */
+static struct dtmf_tone_table_t *dtmf_tone_table_build(apr_uint32_t sample_rate)
+{
+	struct dtmf_tone_table_t *table;
+	apr_size_t i, k;
+
+	table = calloc(1, sizeof(struct dtmf_tone_table_t));
+	if (!table) return NULL;
+	for (i = 0; i < DTMF_TONE_COUNT; i++) {
+		double omega = 2 * M_PI * dtmf_tone_freq[i] / sample_rate;
+		table->length[i] = sample_rate / dtmf_gcd(dtmf_tone_freq[i], sample_rate);
+		table->samples[i] = malloc(table->length[i] * sizeof(apr_int16_t));
+		if (!table->samples[i]) {
+			while (i--) free(table->samples[i]);
+			free(table);
+			return NULL;
+		}
+		for (k = 0; k < table->length[i]; k++)
+			table->samples[i][k] = (apr_int16_t) floor(DTMF_SINE_AMPLITUDE * sin(omega * k) + 0.5);
+	}
+	return table;
+}
+
+/** Destroy tone tables which lost the race to be published */
+static void dtmf_tone_table_destroy(struct dtmf_tone_table_t *table)
+{
+	apr_size_t i;
+	for (i = 0; i < DTMF_TONE_COUNT; i++)
+		free(table->samples[i]);
+	free(table);
+}
+
+/** Get tone tables of the sampling rate, build them on the first use */
+static const struct dtmf_tone_table_t *dtmf_tone_table_get(apr_uint32_t sample_rate)
+{
+	struct dtmf_tone_table_t *table;
+	apr_size_t i;
+
+	for (i = 0; i < DTMF_TONE_RATE_COUNT; i++) {
+		if (dtmf_tone_rates[i] == sample_rate) break;
+	}
+	if (i == DTMF_TONE_RATE_COUNT) return NULL;
+
+	table = apr_atomic_casptr((volatile void**)&dtmf_tone_tables[i], NULL, NULL);
+	if (table) return table;
+	table = dtmf_tone_table_build(sample_rate);
+	if (!table) return NULL;
+	/* generators may be created concurrently, the first table published wins */
+	if (apr_atomic_casptr((volatile void**)&dtmf_tone_tables[i], table, NULL) != NULL) {
+		dtmf_tone_table_destroy(table);
+		table = apr_atomic_casptr((volatile void**)&dtmf_tone_tables[i], NULL, NULL);
+	}
+	return table;
+}
+
+/** Get index of the frequency in the tone tables */
+static apr_size_t dtmf_tone_index_get(double freq)
+{
+	apr_size_t i;
+	for (i = 0; i < DTMF_TONE_COUNT - 1; i++) {
+		if (dtmf_tone_freq[i] == (apr_uint32_t) freq) break;
+	}
+	return i;
+}
+
+
 MPF_DECLARE(struct mpf_dtmf_generator_t *) mpf_dtmf_generator_create_ex(
 								const struct mpf_audio_stream_t *stream,
 								enum mpf_dtmf_generator_band_e band,
@@ -154,6 +280,10 @@ MPF_DECLARE(struct mpf_dtmf_generator_t *) mpf_dtmf_generator_create_ex(
 	gen->tone_duration = gen->sample_rate_events / 1000 * tone_ms;
 	gen->silence_duration = gen->sample_rate_events / 1000 * silence_ms;
 	gen->events_ptime = CODEC_FRAME_TIME_BASE;  /* Should be got from event_descriptor */
+	/* Waves are computed once per sampling rate, tones are then mixed from the tables */
+	gen->tones = NULL;
+	if (gen->band & MPF_DTMF_GENERATOR_INBAND)
+		gen->tones = dtmf_tone_table_get(gen->sample_rate_audio);
 	return gen;
 }
 
@@ -217,7 +347,20 @@ MPF_DECLARE(apt_bool_t) mpf_dtmf_generator_put_frame(
 			generator->since_last_event = generator->events_ptime;
 			generator->new_segment = FALSE;
 			/* Initialize tone generator */
-			if (generator->band & MPF_DTMF_GENERATOR_INBAND) {
+			if ((generator->band & MPF_DTMF_GENERATOR_INBAND) && generator->tones) {
+				apr_size_t index;
+
+				index = dtmf_tone_index_get(dtmf_freq[generator->event_id][0]);
+				generator->wave1 = generator->tones->samples[index];
+				generator->wave1_length = generator->tones->length[index];
+				generator->wave1_pos = 0;
+
+				index = dtmf_tone_index_get(dtmf_freq[generator->event_id][1]);
+				generator->wave2 = generator->tones->samples[index];
+				generator->wave2_length = generator->tones->length[index];
+				generator->wave2_pos = 0;
+			}
+			else if (generator->band & MPF_DTMF_GENERATOR_INBAND) {
 				double omega;
 
 				omega = 2 * M_PI * dtmf_freq[generator->event_id][0] / generator->sample_rate_audio;
@@ -244,15 +387,43 @@ MPF_DECLARE(apt_bool_t) mpf_dtmf_generator_put_frame(
 			double s;
 
 			frame->type |= MEDIA_FRAME_TYPE_AUDIO;
-			/* Tone generator */
-			for (i = 0; i < frame->codec_frame.size / 2; i++) {
-				s = generator->sine1.s1;
-				generator->sine1.s1 = generator->sine1.s2;
-				generator->sine1.s2 = generator->sine1.coef * generator->sine1.s1 - s;
-				samples[i] = (apr_int16_t) (s + generator->sine2.s1);
-				s = generator->sine2.s1;
-				generator->sine2.s1 = generator->sine2.s2;
-				generator->sine2.s2 = generator->sine2.coef * generator->sine2.s1 - s;
+			if (generator->tones) {
+				apr_size_t count = frame->codec_frame.size / 2;
+				apr_size_t n;
+
+				/* Mix runs of both waves up to the wrap of either, the sum never saturates */
+				for (i = 0; i < count; i += n) {
+					const apr_int16_t *wave1 = generator->wave1 + generator->wave1_pos;
+					const apr_int16_t *wave2 = generator->wave2 + generator->wave2_pos;
+					apr_int16_t *out = samples + i;
+					apr_size_t k;
+
+					n = count - i;
+					if (n > generator->wave1_length - generator->wave1_pos)
+						n = generator->wave1_length - generator->wave1_pos;
+					if (n > generator->wave2_length - generator->wave2_pos)
+						n = generator->wave2_length - generator->wave2_pos;
+					for (k = 0; k < n; k++)
+						out[k] = (apr_int16_t) (wave1[k] + wave2[k]);
+					generator->wave1_pos += n;
+					if (generator->wave1_pos == generator->wave1_length)
+						generator->wave1_pos = 0;
+					generator->wave2_pos += n;
+					if (generator->wave2_pos == generator->wave2_length)
+						generator->wave2_pos = 0;
+				}
+			}
+			else {
+				/* Tone generator */
+				for (i = 0; i < frame->codec_frame.size / 2; i++) {
+					s = generator->sine1.s1;
+					generator->sine1.s1 = generator->sine1.s2;
+					generator->sine1.s2 = generator->sine1.coef * generator->sine1.s1 - s;
+					samples[i] = (apr_int16_t) (s + generator->sine2.s1);
+					s = generator->sine2.s1;
+					generator->sine2.s1 = generator->sine2.s2;
+					generator->sine2.s2 = generator->sine2.coef * generator->sine2.s1 - s;
+				}
 			}
 		}
 		if (generator->band & MPF_DTMF_GENERATOR_OUTBAND) {
@@ -108,7 +108,7 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_encoder_create(mpf_audio_stream_t *sink, mp
 		return NULL;
 	}
 	encoder->base->tx_descriptor = mpf_codec_lpcm_descriptor_create(
-		sink->tx_descriptor->sampling_rate,
+		mpf_codec_linear_sampling_rate_get(sink->tx_descriptor),
 		sink->tx_descriptor->channel_count,
 		pool);
 	encoder->base->tx_event_descriptor = sink->tx_event_descriptor;
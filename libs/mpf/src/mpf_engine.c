@@ -14,31 +14,89 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mpf_engine.h"
 #include "mpf_context.h"
 #include "mpf_termination.h"
 #include "mpf_stream.h"
 #include "mpf_scheduler.h"
+#include "mpf_poller.h"
+#include "mpf_frame_pool.h"
+#include "mpf_packet_batch.h"
 #include "mpf_codec_descriptor.h"
 #include "mpf_codec_manager.h"
 #include "apt_obj_list.h"
-#include "apt_cyclic_queue.h"
+#include "apt_mpsc_queue.h"
 #include "apt_log.h"
 
 #define MPF_TIMER_RESOLUTION 100 /* 100 ms */
 
+/** Max number of pending requests per shard */
+#define MPF_REQUEST_QUEUE_SIZE  4096
+/** Max number of requests processed per tick, the rest is left for the next ticks */
+#define MPF_REQUEST_BATCH_SIZE  64
+/** Min interval between the logs of tick overruns of a shard */
+#define MPF_OVERRUN_LOG_INTERVAL apr_time_from_sec(1)
+/** Number of the objects taking the longest logged on a tick overrun */
+#define MPF_OVERRUN_OFFENDER_COUNT 3
+
+/** Counters of the RTP totals of the engine */
+typedef enum {
+	MPF_ENGINE_RTP_STREAMS,
+	MPF_ENGINE_RTP_RECEIVED,
+	MPF_ENGINE_RTP_INVALID,
+	MPF_ENGINE_RTP_DISCARDED,
+	MPF_ENGINE_RTP_IGNORED,
+	MPF_ENGINE_RTP_LOST,
+	MPF_ENGINE_RTP_CONCEALED,
+	MPF_ENGINE_RTP_UNDERRUNS,
+	MPF_ENGINE_RTP_RESTARTS,
+	MPF_ENGINE_RTP_MAX_JITTER,
+
+	MPF_ENGINE_RTP_STAT_COUNT
+} mpf_engine_rtp_stat_e;
+
+typedef struct mpf_engine_shard_t mpf_engine_shard_t;
+
+/** Shard of the media engine, processed by a dedicated scheduler thread */
+struct mpf_engine_shard_t {
+	mpf_engine_t              *engine;
+	apt_mpsc_queue_t          *request_queue;
+	mpf_context_factory_t     *context_factory;
+	mpf_scheduler_t           *scheduler;
+	apt_timer_queue_t         *timer_queue;
+	mpf_poller_t              *poller;
+	mpf_packet_batch_t        *tx_batch;
+	mpf_frame_pool_t          *frame_pool;
+	/* NUMA node of the CPU the scheduler thread is pinned to */
+	int                        numa_node;
+	/* CPU the scheduler thread is pinned to (-1 if unpinned) */
+	int                        cpu;
+	/* time the last tick overrun is logged at */
+	apr_time_t                 overrun_logged;
+	/* number of tick overruns not logged since then */
+	apr_size_t                 overrun_count;
+};
+
 struct mpf_engine_t {
 	apr_pool_t                *pool;
 	apt_task_t                *task;
 	apt_task_msg_type_e        task_msg_type;
-	apr_thread_mutex_t        *request_queue_guard;
-	apt_cyclic_queue_t        *request_queue;
-	mpf_context_factory_t     *context_factory;
-	mpf_scheduler_t           *scheduler;
-	apt_timer_queue_t         *timer_queue;
+	mpf_engine_shard_t        *shards;
+	apr_size_t                 shard_count;
+	unsigned long              rate;
+	int                        priority;
+	int                        cpu;
+	apt_bool_t                 topology_arena;
+	apt_bool_t                 offline;
+	/* time a tick is to be processed within, 0 if ticks are not timed */
+	apr_interval_time_t        tick_budget;
 	const mpf_codec_manager_t *codec_manager;
+	/* totals of closed RTP receivers, updated by the shards */
+	volatile apr_uint32_t      rtp_stat[MPF_ENGINE_RTP_STAT_COUNT];
 };
 
+static apt_bool_t mpf_engine_shards_create(mpf_engine_t *engine, apr_size_t count);
 static void mpf_engine_main(mpf_scheduler_t *scheduler, void *obj);
 static void mpf_engine_timer_proc(mpf_scheduler_t *scheduler, void *obj);
 static apt_bool_t mpf_engine_destroy(apt_task_t *task);
@@ -50,6 +108,7 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 mpf_codec_t* mpf_codec_l16_create(apr_pool_t *pool);
 mpf_codec_t* mpf_codec_g711u_create(apr_pool_t *pool);
 mpf_codec_t* mpf_codec_g711a_create(apr_pool_t *pool);
+mpf_codec_t* mpf_codec_g722_create(apr_pool_t *pool);
 
 APT_LOG_SOURCE_IMPLEMENT(MPF,mpf_log_source,"MPF")
 
@@ -59,9 +118,16 @@ MPF_DECLARE(mpf_engine_t*) mpf_engine_create(const char *id, apr_pool_t *pool)
 	apt_task_msg_pool_t *msg_pool;
 	mpf_engine_t *engine = apr_palloc(pool,sizeof(mpf_engine_t));
 	engine->pool = pool;
-	engine->request_queue = NULL;
-	engine->context_factory = NULL;
+	engine->shards = NULL;
+	engine->shard_count = 0;
+	engine->rate = 1;
+	engine->priority = 0;
+	engine->cpu = -1;
+	engine->topology_arena = FALSE;
+	engine->offline = FALSE;
+	engine->tick_budget = 0;
 	engine->codec_manager = NULL;
+	memset((void*)engine->rtp_stat,0,sizeof(engine->rtp_stat));
 
 	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mpf_message_container_t),pool);
 
@@ -84,16 +150,111 @@ MPF_DECLARE(mpf_engine_t*) mpf_engine_create(const char *id, apr_pool_t *pool)
 
 	engine->task_msg_type = TASK_MSG_USER;
 
-	engine->context_factory = mpf_context_factory_create(engine->pool);
-	engine->request_queue = apt_cyclic_queue_create(CYCLIC_QUEUE_DEFAULT_SIZE);
-	apr_thread_mutex_create(&engine->request_queue_guard,APR_THREAD_MUTEX_UNNESTED,engine->pool);
+	if(mpf_engine_shards_create(engine,MPF_ENGINE_DEFAULT_THREAD_COUNT) == FALSE) {
+		return NULL;
+	}
+	return engine;
+}
+
+static apt_bool_t mpf_engine_shards_create(mpf_engine_t *engine, apr_size_t count)
+{
+	apr_size_t i;
+	mpf_engine_shard_t *shard;
+	mpf_engine_shard_t *shards = apr_palloc(engine->pool,sizeof(mpf_engine_shard_t) * count);
+	for(i=0; i<count; i++) {
+		shard = &shards[i];
+		if(i < engine->shard_count) {
+			/* keep already created shards */
+			*shard = engine->shards[i];
+			continue;
+		}
+
+		shard->engine = engine;
+		shard->numa_node = APT_NUMA_NODE_NONE;
+		shard->cpu = -1;
+		shard->overrun_logged = 0;
+		shard->overrun_count = 0;
+		shard->context_factory = mpf_context_factory_create(engine->pool);
+		mpf_context_factory_arena_enable(shard->context_factory,engine->topology_arena);
+		mpf_context_factory_profile_enable(shard->context_factory,engine->tick_budget ? TRUE : FALSE);
+		shard->request_queue = apt_mpsc_queue_create(MPF_REQUEST_QUEUE_SIZE,engine->pool);
+		if(!shard->request_queue) {
+			return FALSE;
+		}
 
-	engine->scheduler = mpf_scheduler_create(engine->pool);
-	mpf_scheduler_media_clock_set(engine->scheduler,CODEC_FRAME_TIME_BASE,mpf_engine_main,engine);
+		shard->scheduler = mpf_scheduler_create(engine->pool);
+		mpf_scheduler_media_clock_set(shard->scheduler,CODEC_FRAME_TIME_BASE,mpf_engine_main,shard);
+		mpf_scheduler_rate_set(shard->scheduler,engine->rate);
+		mpf_scheduler_priority_set(shard->scheduler,engine->priority);
+		mpf_scheduler_cpu_affinity_set(shard->scheduler,engine->cpu >= 0 ? engine->cpu + (int)i : -1);
+		mpf_scheduler_offline_set(shard->scheduler,engine->offline);
 
-	engine->timer_queue = apt_timer_queue_create(engine->pool);
-	mpf_scheduler_timer_clock_set(engine->scheduler,MPF_TIMER_RESOLUTION,mpf_engine_timer_proc,engine);
-	return engine;
+		shard->timer_queue = apt_timer_queue_create(engine->pool);
+		mpf_scheduler_timer_clock_set(shard->scheduler,MPF_TIMER_RESOLUTION,mpf_engine_timer_proc,shard);
+
+		/* streams fall back to polling their sockets on every tick if there is no poller */
+		shard->poller = mpf_poller_create(MPF_POLLER_DEFAULT_SIZE,engine->pool);
+		shard->tx_batch = mpf_packet_batch_create(MPF_PACKET_BATCH_DEFAULT_SIZE,engine->pool);
+		shard->frame_pool = mpf_frame_pool_create(MPF_FRAME_POOL_BUFFER_SIZE,MPF_FRAME_POOL_DEFAULT_SIZE,engine->pool);
+	}
+	engine->shards = shards;
+	engine->shard_count = count;
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_thread_count_set(mpf_engine_t *engine, apr_size_t count)
+{
+	if(count == 0 || count > MPF_ENGINE_MAX_THREAD_COUNT) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Invalid Thread Count [%"APR_SIZE_T_FMT"] [%s]",
+			count,mpf_engine_id_get(engine));
+		return FALSE;
+	}
+	if(count <= engine->shard_count) {
+		/* shards are never removed, the extra ones simply stay idle */
+		return TRUE;
+	}
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Set Thread Count [%"APR_SIZE_T_FMT"] [%s]",
+		count,mpf_engine_id_get(engine));
+	return mpf_engine_shards_create(engine,count);
+}
+
+MPF_DECLARE(apr_size_t) mpf_engine_thread_count_get(const mpf_engine_t *engine)
+{
+	return engine->shard_count;
+}
+
+/** Find shard the context has been assigned to */
+static mpf_engine_shard_t* mpf_engine_shard_find(const mpf_engine_t *engine, const mpf_context_t *context)
+{
+	apr_size_t i;
+	mpf_context_factory_t *factory;
+	if(!context) {
+		return &engine->shards[0];
+	}
+
+	factory = mpf_context_factory_get(context);
+	for(i=0; i<engine->shard_count; i++) {
+		if(engine->shards[i].context_factory == factory) {
+			return &engine->shards[i];
+		}
+	}
+	return NULL;
+}
+
+/** Get shard a task message is to be processed by */
+static mpf_engine_shard_t* mpf_engine_msg_shard_get(const mpf_engine_t *engine, const apt_task_msg_t *msg)
+{
+	const mpf_message_container_t *container;
+	if(msg->type != TASK_MSG_USER) {
+		return &engine->shards[0];
+	}
+	/* all the messages in a container refer to the same context */
+	container = (const mpf_message_container_t*) msg->data;
+	if(!container->count) {
+		return &engine->shards[0];
+	}
+	return mpf_engine_shard_find(engine,container->messages[0].context);
 }
 
 MPF_DECLARE(mpf_context_t*) mpf_engine_context_create(
@@ -103,7 +264,49 @@ MPF_DECLARE(mpf_context_t*) mpf_engine_context_create(
 								apr_size_t max_termination_count,
 								apr_pool_t *pool)
 {
-	return mpf_context_create(engine->context_factory,name,obj,max_termination_count,pool);
+	apr_size_t i;
+	apr_size_t count;
+	mpf_engine_shard_t *shard = &engine->shards[0];
+	apr_size_t min_count = mpf_context_factory_count_get(shard->context_factory);
+	/* assign the context to the least loaded shard for the whole lifetime */
+	for(i=1; i<engine->shard_count && min_count; i++) {
+		count = mpf_context_factory_count_get(engine->shards[i].context_factory);
+		if(count < min_count) {
+			min_count = count;
+			shard = &engine->shards[i];
+		}
+	}
+	return mpf_context_create(shard->context_factory,name,obj,max_termination_count,pool);
+}
+
+MPF_DECLARE(int) mpf_engine_context_numa_node_get(const mpf_engine_t *engine, const mpf_context_t *context)
+{
+	const mpf_engine_shard_t *shard;
+	if(!context) {
+		return APT_NUMA_NODE_NONE;
+	}
+	shard = mpf_engine_shard_find(engine,context);
+	return shard ? shard->numa_node : APT_NUMA_NODE_NONE;
+}
+
+MPF_DECLARE(int) mpf_engine_context_cpu_get(const mpf_engine_t *engine, const mpf_context_t *context)
+{
+	const mpf_engine_shard_t *shard;
+	if(!context) {
+		return -1;
+	}
+	shard = mpf_engine_shard_find(engine,context);
+	return shard ? shard->cpu : -1;
+}
+
+MPF_DECLARE(apr_size_t) mpf_engine_context_count_get(const mpf_engine_t *engine)
+{
+	apr_size_t i;
+	apr_size_t count = 0;
+	for(i=0; i<engine->shard_count; i++) {
+		count += mpf_context_factory_count_get(engine->shards[i].context_factory);
+	}
+	return count;
 }
 
 MPF_DECLARE(apt_bool_t) mpf_engine_context_destroy(mpf_context_t *context)
@@ -224,30 +427,57 @@ MPF_DECLARE(apt_bool_t) mpf_engine_message_send(mpf_engine_t *engine, mpf_task_m
 
 static apt_bool_t mpf_engine_destroy(apt_task_t *task)
 {
+	apr_size_t i;
+	mpf_engine_shard_t *shard;
 	mpf_engine_t *engine = apt_task_object_get(task);
 
-	apt_timer_queue_destroy(engine->timer_queue);
-	mpf_scheduler_destroy(engine->scheduler);
-	mpf_context_factory_destroy(engine->context_factory);
-	apt_cyclic_queue_destroy(engine->request_queue);
-	apr_thread_mutex_destroy(engine->request_queue_guard);
+	for(i=0; i<engine->shard_count; i++) {
+		shard = &engine->shards[i];
+		apt_timer_queue_destroy(shard->timer_queue);
+		if(shard->poller) {
+			mpf_poller_destroy(shard->poller);
+		}
+		mpf_scheduler_destroy(shard->scheduler);
+		mpf_context_factory_destroy(shard->context_factory);
+	}
 	return TRUE;
 }
 
 static apt_bool_t mpf_engine_start(apt_task_t *task)
 {
+	apr_size_t i;
 	mpf_engine_t *engine = apt_task_object_get(task);
+	int priority = apt_task_priority_get(task);
 
-	mpf_scheduler_start(engine->scheduler);
+	for(i=0; i<engine->shard_count; i++) {
+		/* the task has no thread of its own, pin each scheduler thread to the next CPU of the task set */
+		int cpu = apt_task_affinity_cpu_get(task,i);
+		if(cpu >= 0) {
+			mpf_scheduler_cpu_affinity_set(engine->shards[i].scheduler,cpu);
+		}
+		else if(engine->cpu >= 0) {
+			cpu = engine->cpu + (int)i;
+		}
+		/* consumers of the media of a context may be placed on the CPU or node of its shard */
+		engine->shards[i].cpu = cpu;
+		engine->shards[i].numa_node = apt_numa_cpu_node_get(cpu);
+		if(priority > 0) {
+			mpf_scheduler_priority_set(engine->shards[i].scheduler,priority);
+		}
+		mpf_scheduler_start(engine->shards[i].scheduler);
+	}
 	apt_task_start_request_process(task);
 	return TRUE;
 }
 
 static apt_bool_t mpf_engine_terminate(apt_task_t *task)
 {
+	apr_size_t i;
 	mpf_engine_t *engine = apt_task_object_get(task);
 
-	mpf_scheduler_stop(engine->scheduler);
+	for(i=0; i<engine->shard_count; i++) {
+		mpf_scheduler_stop(engine->shards[i].scheduler);
+	}
 	apt_task_terminate_request_process(task);
 	return TRUE;
 }
@@ -285,12 +515,16 @@ static apt_bool_t mpf_engine_event_raise(mpf_termination_t *termination, int eve
 static apt_bool_t mpf_engine_msg_signal(apt_task_t *task, apt_task_msg_t *msg)
 {
 	mpf_engine_t *engine = apt_task_object_get(task);
+	mpf_engine_shard_t *shard = mpf_engine_msg_shard_get(engine,msg);
+	if(!shard) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_ERROR,"No Shard Found for MPF Request [%s]",apt_task_name_get(task));
+		return FALSE;
+	}
 	
-	apr_thread_mutex_lock(engine->request_queue_guard);
-	if(apt_cyclic_queue_push(engine->request_queue,msg) == FALSE) {
+	if(apt_mpsc_queue_push(shard->request_queue,msg) == FALSE) {
 		apt_log(MPF_LOG_MARK,APT_PRIO_ERROR,"MPF Request Queue is Full [%s]",apt_task_name_get(task));
+		return FALSE;
 	}
-	apr_thread_mutex_unlock(engine->request_queue_guard);
 	return TRUE;
 }
 
@@ -298,6 +532,7 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
 	apr_size_t i;
 	mpf_engine_t *engine = apt_task_object_get(task);
+	mpf_engine_shard_t *shard = mpf_engine_msg_shard_get(engine,msg);
 	apt_task_msg_t *response_msg;
 	mpf_message_container_t *response;
 	mpf_message_t *mpf_response;
@@ -306,6 +541,9 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	const mpf_message_t *mpf_request;
 	const mpf_message_container_t *request = (const mpf_message_container_t*) msg->data;
 
+	if(!shard) {
+		return FALSE;
+	}
 	response_msg = apt_task_msg_get(engine->task);
 	if(!response_msg) {
 		return FALSE;
@@ -332,7 +570,10 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 				termination->media_engine = engine;
 				termination->event_handler = mpf_engine_event_raise;
 				termination->codec_manager = engine->codec_manager;
-				termination->timer_queue = engine->timer_queue;
+				termination->timer_queue = shard->timer_queue;
+				termination->poller = shard->poller;
+				termination->tx_batch = shard->tx_batch;
+				termination->frame_pool = shard->frame_pool;
 
 				mpf_termination_add(termination,mpf_request->descriptor);
 				if(mpf_context_termination_add(context,termination) == FALSE) {
@@ -391,30 +632,108 @@ static apt_bool_t mpf_engine_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	return apt_task_msg_parent_signal(engine->task,response_msg);
 }
 
-static void mpf_engine_main(mpf_scheduler_t *scheduler, void *obj)
+/** Process request queue, a bounded batch per tick not to starve media processing */
+static APR_INLINE apr_size_t mpf_engine_requests_process(mpf_engine_shard_t *shard)
 {
-	mpf_engine_t *engine = obj;
 	apt_task_msg_t *msg;
+	apr_size_t count = 0;
+	while(count < MPF_REQUEST_BATCH_SIZE) {
+		msg = apt_mpsc_queue_pop(shard->request_queue);
+		if(!msg) {
+			break;
+		}
+		apt_task_msg_process(shard->engine->task,msg);
+		count++;
+	}
+	return count;
+}
+
+/** Process tick timing each stage, and log the objects taking the longest, once the tick overruns the budget */
+static void mpf_engine_main_profile(mpf_scheduler_t *scheduler, mpf_engine_shard_t *shard)
+{
+	apr_size_t count;
+	apt_bool_t transferred;
+	apr_time_t start = apr_time_now();
+	apr_time_t requests_end;
+	apr_time_t poll_end;
+	apr_time_t process_end;
+	apr_time_t end;
+
+	count = mpf_engine_requests_process(shard);
+	requests_end = apr_time_now();
+
+	if(shard->poller) {
+		mpf_poller_process(shard->poller);
+	}
+	poll_end = apr_time_now();
 
-	/* process request queue */
-	apr_thread_mutex_lock(engine->request_queue_guard);
-	msg = apt_cyclic_queue_pop(engine->request_queue);
-	while(msg) {
-		apr_thread_mutex_unlock(engine->request_queue_guard);
-		apt_task_msg_process(engine->task,msg);
-		apr_thread_mutex_lock(engine->request_queue_guard);
-		msg = apt_cyclic_queue_pop(engine->request_queue);
+	transferred = mpf_context_factory_process(shard->context_factory);
+	if(transferred == TRUE || count) {
+		mpf_scheduler_tick_busy_set(scheduler,TRUE);
 	}
-	apr_thread_mutex_unlock(engine->request_queue_guard);
+	process_end = apr_time_now();
 
-	/* process factory of media contexts */
-	mpf_context_factory_process(engine->context_factory);
+	if(shard->tx_batch) {
+		mpf_packet_batch_flush(shard->tx_batch);
+	}
+	end = apr_time_now();
+
+	if(end - start <= shard->engine->tick_budget) {
+		return;
+	}
+	shard->overrun_count++;
+	if(end - shard->overrun_logged < MPF_OVERRUN_LOG_INTERVAL) {
+		return;
+	}
+	apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Tick Overrun [%s] took [%"APR_TIME_T_FMT" usec] budget [%"APR_TIME_T_FMT" usec] "
+		"requests [%"APR_SIZE_T_FMT"] [%"APR_TIME_T_FMT" usec] poll [%"APR_TIME_T_FMT" usec] "
+		"contexts [%"APR_TIME_T_FMT" usec] send [%"APR_TIME_T_FMT" usec] overruns [%"APR_SIZE_T_FMT"]",
+		mpf_engine_id_get(shard->engine),
+		end - start,
+		shard->engine->tick_budget,
+		count,
+		requests_end - start,
+		poll_end - requests_end,
+		process_end - poll_end,
+		end - process_end,
+		shard->overrun_count);
+	mpf_context_factory_profile_trace(shard->context_factory,MPF_OVERRUN_OFFENDER_COUNT);
+	shard->overrun_logged = end;
+	shard->overrun_count = 0;
+}
+
+static void mpf_engine_main(mpf_scheduler_t *scheduler, void *obj)
+{
+	mpf_engine_shard_t *shard = obj;
+	apr_size_t count;
+	if(shard->engine->tick_budget) {
+		mpf_engine_main_profile(scheduler,shard);
+		return;
+	}
+
+	/* process request queue, a bounded batch per tick not to starve media processing */
+	count = mpf_engine_requests_process(shard);
+
+	/* receive from readable sockets */
+	if(shard->poller) {
+		mpf_poller_process(shard->poller);
+	}
+
+	/* process factory of media contexts, the next tick follows at once in offline mode while media is transferred */
+	if(mpf_context_factory_process(shard->context_factory) == TRUE || count) {
+		mpf_scheduler_tick_busy_set(scheduler,TRUE);
+	}
+
+	/* send packets produced during the tick */
+	if(shard->tx_batch) {
+		mpf_packet_batch_flush(shard->tx_batch);
+	}
 }
 
 static void mpf_engine_timer_proc(mpf_scheduler_t *scheduler, void *obj)
 {
-	mpf_engine_t *engine = obj;
-	apt_timer_queue_advance(engine->timer_queue,MPF_TIMER_RESOLUTION);
+	mpf_engine_shard_t *shard = obj;
+	apt_timer_queue_advance(shard->timer_queue,MPF_TIMER_RESOLUTION);
 }
 
 MPF_DECLARE(mpf_codec_manager_t*) mpf_engine_codec_manager_create(apr_pool_t *pool)
@@ -429,6 +748,9 @@ MPF_DECLARE(mpf_codec_manager_t*) mpf_engine_codec_manager_create(apr_pool_t *po
 		codec = mpf_codec_g711a_create(pool);
 		mpf_codec_manager_codec_register(codec_manager,codec);
 
+		codec = mpf_codec_g722_create(pool);
+		mpf_codec_manager_codec_register(codec_manager,codec);
+
 		codec = mpf_codec_l16_create(pool);
 		mpf_codec_manager_codec_register(codec_manager,codec);
 	}
@@ -443,7 +765,132 @@ MPF_DECLARE(apt_bool_t) mpf_engine_codec_manager_register(mpf_engine_t *engine,
 
 MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_rate_set(mpf_engine_t *engine, unsigned long rate)
 {
-	return mpf_scheduler_rate_set(engine->scheduler,rate);
+	apr_size_t i;
+	apt_bool_t status = TRUE;
+	for(i=0; i<engine->shard_count; i++) {
+		if(mpf_scheduler_rate_set(engine->shards[i].scheduler,rate) == FALSE) {
+			status = FALSE;
+		}
+	}
+	if(status == TRUE) {
+		engine->rate = rate;
+	}
+	return status;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_priority_set(mpf_engine_t *engine, int priority)
+{
+	apr_size_t i;
+	for(i=0; i<engine->shard_count; i++) {
+		if(mpf_scheduler_priority_set(engine->shards[i].scheduler,priority) == FALSE) {
+			return FALSE;
+		}
+	}
+	engine->priority = priority;
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_scheduler_cpu_affinity_set(mpf_engine_t *engine, int cpu)
+{
+	apr_size_t i;
+	for(i=0; i<engine->shard_count; i++) {
+		if(mpf_scheduler_cpu_affinity_set(engine->shards[i].scheduler,cpu >= 0 ? cpu + (int)i : -1) == FALSE) {
+			return FALSE;
+		}
+	}
+	engine->cpu = cpu;
+	return TRUE;
+}
+
+MPF_DECLARE(void) mpf_engine_topology_arena_set(mpf_engine_t *engine, apt_bool_t enable)
+{
+	apr_size_t i;
+	for(i=0; i<engine->shard_count; i++) {
+		mpf_context_factory_arena_enable(engine->shards[i].context_factory,enable);
+	}
+	engine->topology_arena = enable;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_engine_offline_set(mpf_engine_t *engine, apt_bool_t offline)
+{
+	apr_size_t i;
+	for(i=0; i<engine->shard_count; i++) {
+		if(mpf_scheduler_offline_set(engine->shards[i].scheduler,offline) == FALSE) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Offline Mode Not Supported [%s]",mpf_engine_id_get(engine));
+			return FALSE;
+		}
+	}
+	if(offline == TRUE) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Enable Offline Mode [%s]",mpf_engine_id_get(engine));
+	}
+	engine->offline = offline;
+	return TRUE;
+}
+
+MPF_DECLARE(void) mpf_engine_tick_budget_set(mpf_engine_t *engine, apr_interval_time_t budget)
+{
+	apr_size_t i;
+	for(i=0; i<engine->shard_count; i++) {
+		mpf_context_factory_profile_enable(engine->shards[i].context_factory,budget ? TRUE : FALSE);
+	}
+	if(budget) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Enable Tick Profiling [%s] budget [%"APR_TIME_T_FMT" usec]",mpf_engine_id_get(engine),budget);
+	}
+	engine->tick_budget = budget;
+}
+
+MPF_DECLARE(void) mpf_engine_scheduler_stat_get(const mpf_engine_t *engine, mpf_scheduler_stat_t *stat)
+{
+	apr_size_t i;
+	mpf_scheduler_stat_t shard_stat;
+	memset(stat,0,sizeof(mpf_scheduler_stat_t));
+	for(i=0; i<engine->shard_count; i++) {
+		mpf_scheduler_stat_get(engine->shards[i].scheduler,&shard_stat);
+		stat->tick_count += shard_stat.tick_count;
+		stat->late_count += shard_stat.late_count;
+		stat->resync_count += shard_stat.resync_count;
+		stat->total_lateness += shard_stat.total_lateness;
+		if(shard_stat.max_lateness > stat->max_lateness) {
+			stat->max_lateness = shard_stat.max_lateness;
+		}
+	}
+}
+
+MPF_DECLARE(void) mpf_engine_rtp_stat_add(mpf_engine_t *engine, const rtp_rx_stat_t *rx_stat, apr_uint32_t jitter)
+{
+	apr_uint32_t max_jitter;
+	apr_atomic_inc32(&engine->rtp_stat[MPF_ENGINE_RTP_STREAMS]);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_RECEIVED],rx_stat->received_packets);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_INVALID],rx_stat->invalid_packets);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_DISCARDED],rx_stat->discarded_packets);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_IGNORED],rx_stat->ignored_packets);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_LOST],rx_stat->lost_packets);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_CONCEALED],rx_stat->concealed_frames);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_UNDERRUNS],rx_stat->underruns);
+	apr_atomic_add32(&engine->rtp_stat[MPF_ENGINE_RTP_RESTARTS],rx_stat->restarts);
+
+	do {
+		max_jitter = apr_atomic_read32(&engine->rtp_stat[MPF_ENGINE_RTP_MAX_JITTER]);
+		if(jitter <= max_jitter) {
+			break;
+		}
+	}
+	while(apr_atomic_cas32(&engine->rtp_stat[MPF_ENGINE_RTP_MAX_JITTER],jitter,max_jitter) != max_jitter);
+}
+
+MPF_DECLARE(void) mpf_engine_rtp_stat_get(const mpf_engine_t *engine, mpf_engine_rtp_stat_t *stat)
+{
+	volatile apr_uint32_t *rtp_stat = (volatile apr_uint32_t*)engine->rtp_stat;
+	stat->streams = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_STREAMS]);
+	stat->received_packets = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_RECEIVED]);
+	stat->invalid_packets = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_INVALID]);
+	stat->discarded_packets = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_DISCARDED]);
+	stat->ignored_packets = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_IGNORED]);
+	stat->lost_packets = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_LOST]);
+	stat->concealed_frames = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_CONCEALED]);
+	stat->underruns = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_UNDERRUNS]);
+	stat->restarts = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_RESTARTS]);
+	stat->max_jitter = apr_atomic_read32(&rtp_stat[MPF_ENGINE_RTP_MAX_JITTER]);
 }
 
 MPF_DECLARE(const char*) mpf_engine_id_get(const mpf_engine_t *engine)
@@ -15,7 +15,9 @@
  */
 
 #include <apr_tables.h>
+#include <apr_atomic.h>
 #include "mpf_engine_factory.h"
+#include "mpf_engine.h"
 #include "mpf_termination_factory.h"
 
 /** Factory of media engines */
@@ -24,6 +26,8 @@ struct mpf_engine_factory_t {
 	apr_array_header_t   *engines_arr;
 	/** Index of the current engine */
 	int                   index;
+	/** Number of load-aware selections, to start the next one from */
+	volatile apr_uint32_t load_index;
 };
 
 /** Create factory of media engines. */
@@ -32,6 +36,7 @@ MPF_DECLARE(mpf_engine_factory_t*) mpf_engine_factory_create(apr_pool_t *pool)
 	mpf_engine_factory_t *mpf_factory = apr_palloc(pool,sizeof(mpf_engine_factory_t));
 	mpf_factory->engines_arr = apr_array_make(pool,1,sizeof(mpf_engine_t*));
 	mpf_factory->index = 0;
+	mpf_factory->load_index = 0;
 	return mpf_factory;
 }
 
@@ -63,6 +68,48 @@ MPF_DECLARE(mpf_engine_t*) mpf_engine_factory_engine_select(mpf_engine_factory_t
 	return media_engine;
 }
 
+/** Get the average lateness of the ticks of media engine (usec) */
+static double mpf_engine_lateness_get(const mpf_engine_t *media_engine)
+{
+	mpf_scheduler_stat_t stat;
+	mpf_engine_scheduler_stat_get(media_engine,&stat);
+	return stat.tick_count ? (double)stat.total_lateness / stat.tick_count : 0;
+}
+
+/** Select the least loaded media engine. */
+MPF_DECLARE(mpf_engine_t*) mpf_engine_factory_engine_load_select(mpf_engine_factory_t *mpf_factory)
+{
+	int i;
+	int count = mpf_factory->engines_arr->nelts;
+	int start;
+	mpf_engine_t *media_engine;
+	mpf_engine_t *selected = NULL;
+	apr_size_t context_count;
+	apr_size_t min_context_count = 0;
+	double lateness;
+	double min_lateness = 0;
+	if(!count) {
+		return NULL;
+	}
+
+	/* start from the engine next to the previous selection, so that ties are spread in turn */
+	start = (int)(apr_atomic_inc32(&mpf_factory->load_index) % count);
+	for(i=0; i<count; i++) {
+		media_engine = APR_ARRAY_IDX(mpf_factory->engines_arr, (start + i) % count, mpf_engine_t*);
+		context_count = mpf_engine_context_count_get(media_engine);
+		if(selected && context_count > min_context_count) {
+			continue;
+		}
+		lateness = mpf_engine_lateness_get(media_engine);
+		if(!selected || context_count < min_context_count || lateness < min_lateness) {
+			selected = media_engine;
+			min_context_count = context_count;
+			min_lateness = lateness;
+		}
+	}
+	return selected;
+}
+
 /** Associate media engines with RTP termination factory. */
 MPF_DECLARE(apt_bool_t) mpf_engine_factory_rtp_factory_assign(mpf_engine_factory_t *mpf_factory, mpf_termination_factory_t *rtp_factory)
 {
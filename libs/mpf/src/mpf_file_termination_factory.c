@@ -17,6 +17,18 @@
 #include "mpf_termination.h"
 #include "mpf_file_termination_factory.h"
 #include "mpf_audio_file_stream.h"
+#include "mpf_engine.h"
+
+/** File termination factory */
+typedef struct file_termination_factory_t file_termination_factory_t;
+struct file_termination_factory_t {
+	/** Base termination factory */
+	mpf_termination_factory_t base;
+	/** Writer task of the file streams, a child of the media engine task (NULL if not assigned) */
+	apt_task_t               *writer;
+	/** Pool to allocate memory from */
+	apr_pool_t               *pool;
+};
 
 static apt_bool_t mpf_file_termination_destroy(mpf_termination_t *termination)
 {
@@ -28,10 +40,12 @@ static apt_bool_t mpf_file_termination_add(mpf_termination_t *termination, void
 	apt_bool_t status = TRUE;
 	mpf_audio_stream_t *audio_stream = termination->audio_stream;
 	if(!audio_stream) {
+		file_termination_factory_t *file_termination_factory = (file_termination_factory_t*)termination->termination_factory;
 		audio_stream = mpf_file_stream_create(termination,termination->pool);
 		if(!audio_stream) {
 			return FALSE;
 		}
+		mpf_file_stream_writer_set(audio_stream,file_termination_factory->writer);
 		termination->audio_stream = audio_stream;
 	}
 
@@ -75,10 +89,30 @@ static mpf_termination_t* mpf_file_termination_create(
 	return mpf_termination_base_create(termination_factory,obj,&file_vtable,NULL,NULL,pool);
 }
 
+static apt_bool_t mpf_file_factory_engine_assign(mpf_termination_factory_t *termination_factory, mpf_engine_t *media_engine)
+{
+	file_termination_factory_t *file_termination_factory = (file_termination_factory_t*)termination_factory;
+	if(!media_engine) {
+		return FALSE;
+	}
+	if(file_termination_factory->writer) {
+		/* one writer serves the streams of all the engines */
+		return TRUE;
+	}
+	/* started and terminated along with the engine, which therefore must not be started yet */
+	file_termination_factory->writer = mpf_file_stream_writer_create(file_termination_factory->pool);
+	if(!file_termination_factory->writer) {
+		return FALSE;
+	}
+	return apt_task_add(mpf_task_get(media_engine),file_termination_factory->writer);
+}
+
 MPF_DECLARE(mpf_termination_factory_t*) mpf_file_termination_factory_create(apr_pool_t *pool)
 {
-	mpf_termination_factory_t *file_termination_factory = apr_palloc(pool,sizeof(mpf_termination_factory_t));
-	file_termination_factory->create_termination = mpf_file_termination_create;
-	file_termination_factory->assign_engine = NULL;
-	return file_termination_factory;
+	file_termination_factory_t *file_termination_factory = apr_palloc(pool,sizeof(file_termination_factory_t));
+	file_termination_factory->base.create_termination = mpf_file_termination_create;
+	file_termination_factory->base.assign_engine = mpf_file_factory_engine_assign;
+	file_termination_factory->writer = NULL;
+	file_termination_factory->pool = pool;
+	return &file_termination_factory->base;
 }
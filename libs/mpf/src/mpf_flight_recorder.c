@@ -0,0 +1,250 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_atomic.h>
+#include "mpf_flight_recorder.h"
+#include "mpf_jitter_buffer.h"
+#include "apt_log.h"
+
+/** Window discarded packets are counted within */
+#define MPF_FLIGHT_SPIKE_WINDOW   APR_USEC_PER_SEC
+/** Number of discarded packets within the window making a spike */
+#define MPF_FLIGHT_SPIKE_DISCARDS 10
+
+/** Flight recorder */
+struct mpf_flight_recorder_t {
+	/** Ring of records */
+	mpf_flight_record_t   *records;
+	/** Capacity of the ring, a power of 2 */
+	apr_uint32_t           capacity;
+	/** Number of records ever added, the next one is at head & (capacity - 1) */
+	volatile apr_uint32_t  head;
+	/** Time the recorder is created at */
+	apr_time_t             created;
+
+	/** Time the last RTP packet arrived at */
+	volatile apr_uint32_t  rtp_time;
+	/** Start of the window discarded packets are counted within */
+	apr_time_t             spike_window;
+	/** Number of discarded packets within the window */
+	apr_uint32_t           spike_discards;
+	/** Head at the last spike reported */
+	apr_uint32_t           spike_head;
+	/** Whether a spike is reported yet */
+	apt_bool_t             spike_reported;
+};
+
+/** Create flight recorder */
+MPF_DECLARE(mpf_flight_recorder_t*) mpf_flight_recorder_create(apr_size_t capacity, apr_pool_t *pool)
+{
+	mpf_flight_recorder_t *recorder;
+	apr_uint32_t size = 16;
+	while(size < capacity && size < 0x10000) {
+		size <<= 1;
+	}
+
+	recorder = apr_palloc(pool,sizeof(mpf_flight_recorder_t));
+	recorder->records = apr_pcalloc(pool,sizeof(mpf_flight_record_t) * size);
+	recorder->capacity = size;
+	recorder->head = 0;
+	recorder->created = apr_time_now();
+	recorder->rtp_time = 0;
+	recorder->spike_window = 0;
+	recorder->spike_discards = 0;
+	recorder->spike_head = 0;
+	recorder->spike_reported = FALSE;
+	return recorder;
+}
+
+static APR_INLINE apr_uint32_t mpf_flight_recorder_time_get(const mpf_flight_recorder_t *recorder, apr_time_t now)
+{
+	return (apr_uint32_t)(now - recorder->created);
+}
+
+static void mpf_flight_recorder_record_put(
+						mpf_flight_recorder_t *recorder,
+						apr_uint32_t time,
+						mpf_flight_record_type_e type,
+						apr_byte_t result,
+						apr_uint16_t seq,
+						apr_uint32_t ts,
+						apr_uint32_t value)
+{
+	/* single writer: the record is complete before the head moves past it */
+	mpf_flight_record_t *record = &recorder->records[recorder->head & (recorder->capacity - 1)];
+	record->time = time;
+	record->type = (apr_byte_t)type;
+	record->result = result;
+	record->seq = seq;
+	record->ts = ts;
+	record->value = value;
+	apr_atomic_inc32(&recorder->head);
+}
+
+/** Add record */
+MPF_DECLARE(void) mpf_flight_recorder_put(
+						mpf_flight_recorder_t *recorder,
+						mpf_flight_record_type_e type,
+						apr_byte_t result,
+						apr_uint16_t seq,
+						apr_uint32_t ts,
+						apr_uint32_t value)
+{
+	mpf_flight_recorder_record_put(
+		recorder,
+		mpf_flight_recorder_time_get(recorder,apr_time_now()),
+		type,result,seq,ts,value);
+}
+
+/** Add record of RTP packet arrived */
+MPF_DECLARE(apt_bool_t) mpf_flight_recorder_rtp_put(
+						mpf_flight_recorder_t *recorder,
+						apr_uint16_t seq,
+						apr_uint32_t ts,
+						apr_size_t size,
+						int jb_result)
+{
+	apr_time_t now = apr_time_now();
+	apr_uint32_t time = mpf_flight_recorder_time_get(recorder,now);
+	mpf_flight_recorder_record_put(recorder,time,MPF_FLIGHT_RTP_IN,(apr_byte_t)jb_result,seq,ts,(apr_uint32_t)size);
+	apr_atomic_set32(&recorder->rtp_time,time);
+
+	if(jb_result == JB_OK) {
+		return FALSE;
+	}
+
+	if(now - recorder->spike_window >= MPF_FLIGHT_SPIKE_WINDOW) {
+		recorder->spike_window = now;
+		recorder->spike_discards = 0;
+	}
+	if(++recorder->spike_discards < MPF_FLIGHT_SPIKE_DISCARDS) {
+		return FALSE;
+	}
+
+	/* report once per ring of records, so that the dumps don't overlap */
+	if(recorder->spike_reported == TRUE && recorder->head - recorder->spike_head < recorder->capacity) {
+		return FALSE;
+	}
+	recorder->spike_reported = TRUE;
+	recorder->spike_head = recorder->head;
+	recorder->spike_discards = 0;
+	return TRUE;
+}
+
+/** Check whether RTP packets arrived recently */
+MPF_DECLARE(apt_bool_t) mpf_flight_recorder_rtp_check(const mpf_flight_recorder_t *recorder, apr_interval_time_t interval)
+{
+	apr_uint32_t rtp_time = apr_atomic_read32((volatile apr_uint32_t*)&recorder->rtp_time);
+	apr_uint32_t time;
+	if(!rtp_time) {
+		return FALSE;
+	}
+
+	time = mpf_flight_recorder_time_get(recorder,apr_time_now());
+	return (time - rtp_time <= (apr_uint32_t)interval) ? TRUE : FALSE;
+}
+
+/** Copy the records kept */
+MPF_DECLARE(apr_size_t) mpf_flight_recorder_snapshot(const mpf_flight_recorder_t *recorder, mpf_flight_record_t *records, apr_size_t max_count)
+{
+	volatile apr_uint32_t *head = (volatile apr_uint32_t*)&recorder->head;
+	apr_uint32_t end = apr_atomic_read32(head);
+	apr_uint32_t count = end < recorder->capacity ? end : recorder->capacity;
+	apr_uint32_t begin;
+	apr_uint32_t overwritten;
+	apr_uint32_t i;
+
+	if(count > max_count) {
+		count = (apr_uint32_t)max_count;
+	}
+	begin = end - count;
+	for(i = 0; i < count; i++) {
+		records[i] = recorder->records[(begin + i) & (recorder->capacity - 1)];
+	}
+
+	/* the writer went on meanwhile: drop the records it may have overwritten while copied */
+	overwritten = apr_atomic_read32(head) - end;
+	if(overwritten >= count) {
+		return 0;
+	}
+	if(overwritten) {
+		/* the oldest records are overwritten first, and one more may be in progress */
+		overwritten++;
+		if(overwritten >= count) {
+			return 0;
+		}
+		memmove(records,records + overwritten,sizeof(mpf_flight_record_t) * (count - overwritten));
+		count -= overwritten;
+	}
+	return count;
+}
+
+static const char* mpf_flight_jb_result_str(apr_byte_t result)
+{
+	switch(result) {
+		case JB_OK:                   return "ok";
+		case JB_DISCARD_NOT_ALLIGNED: return "not-aligned";
+		case JB_DISCARD_TOO_LATE:     return "too-late";
+		case JB_DISCARD_TOO_EARLY:    return "too-early";
+	}
+	return "unknown";
+}
+
+/** Dump the records kept to the log */
+MPF_DECLARE(void) mpf_flight_recorder_dump(const mpf_flight_recorder_t *recorder, const char *name, const char *reason)
+{
+	mpf_flight_record_t *records;
+	apr_size_t count;
+	apr_size_t i;
+
+	records = malloc(sizeof(mpf_flight_record_t) * recorder->capacity);
+	if(!records) {
+		return;
+	}
+
+	count = mpf_flight_recorder_snapshot(recorder,records,recorder->capacity);
+	apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Flight Recorder Dump [%s] reason [%s] records [%"APR_SIZE_T_FMT"]",
+		name,reason,count);
+	for(i = 0; i < count; i++) {
+		const mpf_flight_record_t *record = &records[i];
+		switch(record->type) {
+			case MPF_FLIGHT_RTP_IN:
+				apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Flight [%s] %10u rtp-in seq [%hu] ts [%u] size [%u] jb [%s]",
+					name,record->time,record->seq,record->ts,record->value,
+					mpf_flight_jb_result_str(record->result));
+				break;
+			case MPF_FLIGHT_FRAME_OUT:
+				apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Flight [%s] %10u frame-out type [0x%x] marker [%d]",
+					name,record->time,record->value,record->result);
+				break;
+			case MPF_FLIGHT_SINK_WRITE:
+				apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Flight [%s] %10u sink-write type [0x%x] duration [%u usec]",
+					name,record->time,record->result,record->value);
+				break;
+			case MPF_FLIGHT_DETECTOR:
+				apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Flight [%s] %10u detector event [%d] value [%u]",
+					name,record->time,record->result,record->value);
+				break;
+			case MPF_FLIGHT_MARK:
+				apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Flight [%s] %10u mark [%d] value [%u]",
+					name,record->time,record->result,record->value);
+				break;
+		}
+	}
+	free(records);
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include "mpf_frame_pool.h"
+#include "apt_mpsc_queue.h"
+
+/** Header of a buffer, the data follows */
+struct mpf_frame_ref_t {
+	/** Pool to return the buffer to */
+	mpf_frame_pool_t    *pool;
+	/** Number of references */
+	volatile apr_uint32_t refs;
+};
+
+/** Size of the header of a buffer, the data is aligned as a pool allocation */
+#define MPF_FRAME_REF_HEADER_SIZE APR_ALIGN_DEFAULT(sizeof(mpf_frame_ref_t))
+
+/** Pool of frame buffers */
+struct mpf_frame_pool_t {
+	/** Size of a buffer */
+	apr_size_t        buffer_size;
+	/** Max number of buffers */
+	apr_size_t        capacity;
+	/** Number of allocated buffers (scheduler thread only) */
+	apr_size_t        allocated;
+	/** Free buffers, released by any thread and acquired by the scheduler thread */
+	apt_mpsc_queue_t *free_queue;
+	/** Pool buffers are allocated from (scheduler thread only) */
+	apr_pool_t       *pool;
+};
+
+MPF_DECLARE(mpf_frame_pool_t*) mpf_frame_pool_create(apr_size_t buffer_size, apr_size_t capacity, apr_pool_t *pool)
+{
+	mpf_frame_pool_t *frame_pool;
+	if(!buffer_size || !capacity) {
+		return NULL;
+	}
+
+	frame_pool = apr_palloc(pool,sizeof(mpf_frame_pool_t));
+	frame_pool->buffer_size = buffer_size;
+	frame_pool->capacity = capacity;
+	frame_pool->allocated = 0;
+	/* there is room for all the buffers, so that release never fails */
+	frame_pool->free_queue = apt_mpsc_queue_create(capacity,pool);
+	if(!frame_pool->free_queue) {
+		return NULL;
+	}
+	/* allocated from the scheduler thread, while the parent pool may be used by others */
+	if(apr_pool_create(&frame_pool->pool,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return frame_pool;
+}
+
+MPF_DECLARE(apr_size_t) mpf_frame_pool_buffer_size_get(const mpf_frame_pool_t *pool)
+{
+	return pool->buffer_size;
+}
+
+MPF_DECLARE(mpf_frame_ref_t*) mpf_frame_pool_acquire(mpf_frame_pool_t *pool)
+{
+	mpf_frame_ref_t *ref = apt_mpsc_queue_pop(pool->free_queue);
+	if(!ref) {
+		if(pool->allocated >= pool->capacity) {
+			return NULL;
+		}
+		ref = apr_palloc(pool->pool,MPF_FRAME_REF_HEADER_SIZE + pool->buffer_size);
+		ref->pool = pool;
+		pool->allocated++;
+	}
+	ref->refs = 1;
+	return ref;
+}
+
+MPF_DECLARE(void*) mpf_frame_ref_data_get(mpf_frame_ref_t *ref)
+{
+	return (char*)ref + MPF_FRAME_REF_HEADER_SIZE;
+}
+
+MPF_DECLARE(void) mpf_frame_ref_retain(mpf_frame_ref_t *ref)
+{
+	apr_atomic_inc32(&ref->refs);
+}
+
+MPF_DECLARE(void) mpf_frame_ref_release(mpf_frame_ref_t *ref)
+{
+	if(apr_atomic_dec32(&ref->refs) == 0) {
+		apt_mpsc_queue_push(ref->pool->free_queue,ref);
+	}
+}
@@ -16,6 +16,8 @@
 
 #include "mpf_jitter_buffer.h"
 #include "mpf_trace.h"
+#include "apt_probe.h"
+#include "g711/g711.h"
 
 #if ENABLE_JB_TRACE == 1
 #define JB_TRACE printf
@@ -28,20 +30,70 @@
 #define JB_TRACE mpf_null_trace
 #endif
 
+/** Alignment of the slots (typical cache line size) */
+#define JB_SLOT_ALIGNMENT 64
+
+/* received packet, the slots it's written to by reference share it, the buffer follows the header */
+typedef struct mpf_jb_packet_t mpf_jb_packet_t;
+struct mpf_jb_packet_t {
+	/* number of references (the receiver and the slots) */
+	apr_size_t       refs;
+	/* next packet in the list of free packets */
+	mpf_jb_packet_t *next;
+};
+
+#define JB_PACKET_BUFFER(packet) ((apr_byte_t*)(packet) + sizeof(mpf_jb_packet_t))
+#define JB_PACKET_GET(buffer)    ((mpf_jb_packet_t*)((apr_byte_t*)(buffer) - sizeof(mpf_jb_packet_t)))
+
+/* slot of the ring, the payload follows the header inline unless it's referenced in a packet */
+typedef struct mpf_jb_slot_t mpf_jb_slot_t;
+struct mpf_jb_slot_t {
+	/* frame type (mpf_frame_type_e) */
+	int                     type;
+	/* frame marker (mpf_frame_marker_e) */
+	int                     marker;
+	/* size of the payload */
+	apr_size_t              size;
+	/* payload, either inline or in the packet */
+	const apr_byte_t       *payload;
+	/* packet referenced by the slot, if any */
+	mpf_jb_packet_t        *packet;
+	/* named-event frame */
+	mpf_named_event_frame_t event_frame;
+};
+
+#define JB_SLOT_PAYLOAD(slot) ((apr_byte_t*)(slot) + sizeof(mpf_jb_slot_t))
+
+/* packet loss concealment (by encoding of the payload) */
+typedef enum {
+	JB_PLC_NONE,
+	JB_PLC_L16,
+	JB_PLC_PCMU,
+	JB_PLC_PCMA
+} jb_plc_e;
+
 struct mpf_jitter_buffer_t {
 	/* jitter buffer config */
 	mpf_jb_config_t *config;
 	/* codec to be used to dissect payload */
 	mpf_codec_t     *codec;
 
-	/* cyclic raw data */
-	apr_byte_t      *raw_data;
-	/* frames (out of raw data) */
-	mpf_frame_t     *frames;
+	/* cyclic array of slots */
+	apr_byte_t      *slots;
+	/* distance between the slots in bytes */
+	apr_size_t       slot_stride;
+	/* mask of the slot index (the number of slots is a power of two) */
+	apr_size_t       slot_mask;
+	/* index of the slot at read_ts */
+	apr_size_t       read_index;
 	/* number of frames */
 	apr_size_t       frame_count;
 	/* frame timestamp units (samples) */
 	apr_uint32_t     frame_ts;
+	/* reciprocal of frame_ts (2^32 / frame_ts rounded up) */
+	apr_uint64_t     frame_ts_recip;
+	/* length of the buffer in timestamp units (frame_count * frame_ts) */
+	apr_uint32_t     length_ts;
 	/* frame size in bytes */
 	apr_size_t       frame_size;
 
@@ -73,13 +125,61 @@ struct mpf_jitter_buffer_t {
 	mpf_named_event_frame_t        event_write_base;
 	/* the last received update for the event */
 	const mpf_named_event_frame_t *event_write_update;
+
+	/* packet loss concealment method */
+	jb_plc_e         plc;
+	/* the last frame read (the one to repeat) */
+	apr_byte_t      *plc_history;
+	/* max number of frames to conceal in a row */
+	apr_uint32_t     plc_max_frames;
+	/* number of frames concealed in a row */
+	apr_uint32_t     plc_frame_count;
+	/* total number of concealed frames */
+	apr_uint32_t     concealed_frames;
+
+	/* whether the buffer ran dry since the last frame read */
+	apt_bool_t       underflow;
+	/* number of times the buffer ran dry while playing out */
+	apr_uint32_t     underruns;
+	/* whether frames are missing since the last audio frame read (low-latency mode) */
+	apt_bool_t       gap;
+	/* whether the sender is in discontinuous transmission, signaled by comfort noise, since the last audio frame read */
+	apt_bool_t       dtx;
+
+	/* pool to allocate packets from */
+	apr_pool_t      *pool;
+	/* size of the packet buffers */
+	apr_size_t       packet_size;
+	/* list of packets to reuse */
+	mpf_jb_packet_t *free_packets;
+	/* packet the frame read by reference was in, held till the next read */
+	mpf_jb_packet_t *read_packet;
 };
 
+static jb_plc_e mpf_jitter_buffer_plc_get(const mpf_codec_t *codec)
+{
+	const char *name = codec->attribs ? codec->attribs->name.buf : NULL;
+	if(!name) {
+		return JB_PLC_NONE;
+	}
+	if(strcasecmp(name,"L16") == 0) {
+		return JB_PLC_L16;
+	}
+	if(strcasecmp(name,"PCMU") == 0) {
+		return JB_PLC_PCMU;
+	}
+	if(strcasecmp(name,"PCMA") == 0) {
+		return JB_PLC_PCMA;
+	}
+	return JB_PLC_NONE;
+}
+
 
 mpf_jitter_buffer_t* mpf_jitter_buffer_create(mpf_jb_config_t *jb_config, mpf_codec_descriptor_t *descriptor, mpf_codec_t *codec, apr_pool_t *pool)
 {
 	apr_size_t i;
-	mpf_frame_t *frame;
+	apr_size_t slot_count;
+	mpf_jb_slot_t *slot;
 	mpf_jitter_buffer_t *jb = apr_palloc(pool,sizeof(mpf_jitter_buffer_t));
 	if(!jb_config) {
 		/* create default jb config */
@@ -87,6 +187,11 @@ mpf_jitter_buffer_t* mpf_jitter_buffer_create(mpf_jb_config_t *jb_config, mpf_co
 		mpf_jb_config_init(jb_config);
 	}
 	/* validate jb config */
+	if(jb_config->low_latency) {
+		/* frames are held for reordering only, late ones resync the buffer instead of increasing the delay */
+		jb_config->initial_playout_delay = jb_config->min_playout_delay;
+		jb_config->adaptive = 0;
+	}
 	if(jb_config->min_playout_delay > jb_config->initial_playout_delay) {
 		jb_config->min_playout_delay = jb_config->initial_playout_delay;
 	}
@@ -104,13 +209,26 @@ mpf_jitter_buffer_t* mpf_jitter_buffer_create(mpf_jb_config_t *jb_config, mpf_co
 	jb->frame_ts = (apr_uint32_t)mpf_codec_frame_samples_calculate(descriptor);
 	jb->frame_size = mpf_codec_frame_size_calculate(descriptor,codec->attribs);
 	jb->frame_count = jb->config->max_playout_delay / CODEC_FRAME_TIME_BASE;
-	jb->raw_data = apr_palloc(pool,jb->frame_size*jb->frame_count);
-	jb->frames = apr_palloc(pool,sizeof(mpf_frame_t)*jb->frame_count);
-	for(i=0; i<jb->frame_count; i++) {
-		frame = &jb->frames[i];
-		frame->type = MEDIA_FRAME_TYPE_NONE;
-		frame->marker = MPF_MARKER_NONE;
-		frame->codec_frame.buffer = jb->raw_data + i*jb->frame_size;
+	jb->frame_ts_recip = (apr_uint64_t)(0xFFFFFFFF / jb->frame_ts) + 1;
+	jb->length_ts = (apr_uint32_t)jb->frame_count * jb->frame_ts;
+
+	/* round the number of slots up to a power of two to index them by mask */
+	slot_count = 1;
+	while(slot_count < jb->frame_count) {
+		slot_count <<= 1;
+	}
+	jb->slot_mask = slot_count - 1;
+	jb->read_index = 0;
+	jb->slot_stride = sizeof(mpf_jb_slot_t) + jb->frame_size;
+	jb->slot_stride = (jb->slot_stride + JB_SLOT_ALIGNMENT - 1) & ~((apr_size_t)JB_SLOT_ALIGNMENT - 1);
+	jb->slots = apr_palloc(pool,jb->slot_stride*slot_count);
+	for(i=0; i<slot_count; i++) {
+		slot = (mpf_jb_slot_t*)(jb->slots + i*jb->slot_stride);
+		slot->type = MEDIA_FRAME_TYPE_NONE;
+		slot->marker = MPF_MARKER_NONE;
+		slot->size = 0;
+		slot->payload = JB_SLOT_PAYLOAD(slot);
+		slot->packet = NULL;
 	}
 
 	if(jb->config->initial_playout_delay % CODEC_FRAME_TIME_BASE != 0) {
@@ -132,6 +250,29 @@ mpf_jitter_buffer_t* mpf_jitter_buffer_create(mpf_jb_config_t *jb_config, mpf_co
 	memset(&jb->event_write_base,0,sizeof(mpf_named_event_frame_t));
 	jb->event_write_update = NULL;
 
+	jb->plc = JB_PLC_NONE;
+	jb->plc_history = NULL;
+	jb->plc_max_frames = jb->config->concealment / CODEC_FRAME_TIME_BASE;
+	if(jb->plc_max_frames) {
+		jb->plc = mpf_jitter_buffer_plc_get(codec);
+		if(jb->plc != JB_PLC_NONE) {
+			jb->plc_history = apr_palloc(pool,jb->frame_size);
+		}
+	}
+	/* nothing to repeat yet */
+	jb->plc_frame_count = jb->plc_max_frames;
+	jb->concealed_frames = 0;
+	/* running dry before the first frame is not an underrun */
+	jb->underflow = TRUE;
+	jb->underruns = 0;
+	jb->gap = FALSE;
+	jb->dtx = FALSE;
+
+	jb->pool = pool;
+	jb->packet_size = 0;
+	jb->free_packets = NULL;
+	jb->read_packet = NULL;
+
 	return jb;
 }
 
@@ -149,6 +290,10 @@ apt_bool_t mpf_jitter_buffer_restart(mpf_jitter_buffer_t *jb)
 	memset(&jb->event_write_base,0,sizeof(mpf_named_event_frame_t));
 	jb->event_write_update = NULL;
 
+	jb->underflow = TRUE;
+	jb->gap = FALSE;
+	jb->dtx = FALSE;
+
 	if(jb->config->adaptive && jb->playout_delay_ts == jb->max_playout_delay_ts) {
 		jb->playout_delay_ts = jb->frame_ts * jb->config->initial_playout_delay / CODEC_FRAME_TIME_BASE;
 	}
@@ -157,10 +302,63 @@ apt_bool_t mpf_jitter_buffer_restart(mpf_jitter_buffer_t *jb)
 	return TRUE;
 }
 
-static APR_INLINE mpf_frame_t* mpf_jitter_buffer_frame_get(mpf_jitter_buffer_t *jb, apr_size_t ts)
+void* mpf_jitter_buffer_packet_alloc(mpf_jitter_buffer_t *jb, apr_size_t size)
+{
+	mpf_jb_packet_t *packet;
+	if(!jb->packet_size) {
+		/* the first allocation determines the size of all the packets */
+		jb->packet_size = size;
+	}
+	else if(size > jb->packet_size) {
+		return NULL;
+	}
+
+	packet = jb->free_packets;
+	if(packet) {
+		jb->free_packets = packet->next;
+	}
+	else {
+		packet = apr_palloc(jb->pool,sizeof(mpf_jb_packet_t) + jb->packet_size);
+	}
+	packet->refs = 1;
+	packet->next = NULL;
+	return JB_PACKET_BUFFER(packet);
+}
+
+static APR_INLINE void mpf_jitter_buffer_packet_unref(mpf_jitter_buffer_t *jb, mpf_jb_packet_t *packet)
+{
+	if(--packet->refs == 0) {
+		packet->next = jb->free_packets;
+		jb->free_packets = packet;
+	}
+}
+
+void mpf_jitter_buffer_packet_free(mpf_jitter_buffer_t *jb, void *buffer)
+{
+	mpf_jitter_buffer_packet_unref(jb,JB_PACKET_GET(buffer));
+}
+
+/* drop the packet referenced by the slot, the payload goes inline again */
+static APR_INLINE void mpf_jitter_buffer_slot_release(mpf_jitter_buffer_t *jb, mpf_jb_slot_t *slot)
+{
+	if(slot->packet) {
+		mpf_jitter_buffer_packet_unref(jb,slot->packet);
+		slot->packet = NULL;
+		slot->payload = JB_SLOT_PAYLOAD(slot);
+	}
+}
+
+static APR_INLINE mpf_jb_slot_t* mpf_jitter_buffer_slot_at(mpf_jitter_buffer_t *jb, apr_size_t index)
+{
+	return (mpf_jb_slot_t*)(jb->slots + (index & jb->slot_mask) * jb->slot_stride);
+}
+
+/* get the index of the slot at ts, which must be within [read_ts, read_ts + length_ts) */
+static APR_INLINE apr_size_t mpf_jitter_buffer_index_get(mpf_jitter_buffer_t *jb, apr_uint32_t ts)
 {
-	apr_size_t index = (ts / jb->frame_ts) % jb->frame_count;
-	return &jb->frames[index];
+	/* the offset is less than length_ts, so multiplication by the reciprocal is exact */
+	apr_uint32_t offset = (apr_uint32_t)(((apr_uint64_t)(ts - jb->read_ts) * jb->frame_ts_recip) >> 32);
+	return (jb->read_index + offset) & jb->slot_mask;
 }
 
 static APR_INLINE void mpf_jitter_buffer_stat_update(mpf_jitter_buffer_t *jb)
@@ -222,11 +420,12 @@ static APR_INLINE jb_result_t mpf_jitter_buffer_write_prepare(mpf_jitter_buffer_
 	return JB_OK;
 }
 
-jb_result_t mpf_jitter_buffer_write(mpf_jitter_buffer_t *jb, void *buffer, apr_size_t size, apr_uint32_t ts, apr_byte_t marker)
+static jb_result_t mpf_jitter_buffer_audio_write(mpf_jitter_buffer_t *jb, mpf_jb_packet_t *packet, void *buffer, apr_size_t size, apr_uint32_t ts, apr_byte_t marker)
 {
-	mpf_frame_t *media_frame;
+	mpf_jb_slot_t *slot;
+	mpf_codec_frame_t codec_frame;
 	apr_uint32_t write_ts;
-	apr_size_t available_frame_count;
+	apr_size_t index;
 	jb_result_t result;
 
 	if(marker) {
@@ -261,88 +460,113 @@ jb_result_t mpf_jitter_buffer_write(mpf_jitter_buffer_t *jb, void *buffer, apr_s
 			return JB_DISCARD_TOO_LATE;
 		}
 
-		/* calculate a minimal adjustment needed in order to place the packet into the buffer */
-		delta_ts = jb->read_ts - write_ts;
+		if(jb->config->low_latency) {
+			/* the buffer has run dry meanwhile => play the packet out at arrival, rather than delay what follows */
+			JB_TRACE("JB write ts=%u too late => resync\n",write_ts);
+			jb->write_sync = 1;
+			mpf_jitter_buffer_write_prepare(jb,ts,&write_ts);
+		}
+		else {
+			/* calculate a minimal adjustment needed in order to place the packet into the buffer */
+			delta_ts = jb->read_ts - write_ts;
 
-		if(jb->config->time_skew_detection) {
-			JB_TRACE("JB stat length [%d : %d] playout delay=%u delta=%u\n",
-				jb->min_length_ts,jb->max_length_ts,jb->playout_delay_ts,delta_ts);
+			if(jb->config->time_skew_detection) {
+				JB_TRACE("JB stat length [%d : %d] playout delay=%u delta=%u\n",
+					jb->min_length_ts,jb->max_length_ts,jb->playout_delay_ts,delta_ts);
 			
-			if((apr_uint32_t)(jb->max_length_ts - jb->min_length_ts) > jb->playout_delay_ts + delta_ts) {
-				/* update the adjustment based on the collected statistics */
-				delta_ts = (apr_uint32_t)(jb->max_length_ts - jb->min_length_ts) - jb->playout_delay_ts;
-				mpf_jitter_buffer_frame_allign(jb,&delta_ts);
-			}
-
-			/* determine if there might be a time skew or not */
-			if(jb->max_length_ts > 0 && (apr_uint32_t)jb->max_length_ts < jb->playout_delay_ts) {
-				/* calculate the time skew */
-				apr_uint32_t skew_ts = jb->playout_delay_ts - jb->max_length_ts;
-				mpf_jitter_buffer_frame_allign(jb,&skew_ts);
-				JB_TRACE("JB time skew detected offset=%u\n",skew_ts);
-
-				/* adjust the offset and write pos */
-				jb->write_ts_offset -= skew_ts;
-				write_ts = ts - jb->write_ts_offset + jb->playout_delay_ts;
-
-				/* adjust the statistics */
-				jb->min_length_ts += skew_ts;
-				jb->max_length_ts += skew_ts;
-
-				if(skew_ts < delta_ts) {
-					delta_ts -= skew_ts;
+				if((apr_uint32_t)(jb->max_length_ts - jb->min_length_ts) > jb->playout_delay_ts + delta_ts) {
+					/* update the adjustment based on the collected statistics */
+					delta_ts = (apr_uint32_t)(jb->max_length_ts - jb->min_length_ts) - jb->playout_delay_ts;
+					mpf_jitter_buffer_frame_allign(jb,&delta_ts);
 				}
-				else {
-					delta_ts = 0;
+
+				/* determine if there might be a time skew or not */
+				if(jb->max_length_ts > 0 && (apr_uint32_t)jb->max_length_ts < jb->playout_delay_ts) {
+					/* calculate the time skew */
+					apr_uint32_t skew_ts = jb->playout_delay_ts - jb->max_length_ts;
+					mpf_jitter_buffer_frame_allign(jb,&skew_ts);
+					JB_TRACE("JB time skew detected offset=%u\n",skew_ts);
+
+					/* adjust the offset and write pos */
+					jb->write_ts_offset -= skew_ts;
+					write_ts = ts - jb->write_ts_offset + jb->playout_delay_ts;
+
+					/* adjust the statistics */
+					jb->min_length_ts += skew_ts;
+					jb->max_length_ts += skew_ts;
+
+					if(skew_ts < delta_ts) {
+						delta_ts -= skew_ts;
+					}
+					else {
+						delta_ts = 0;
+					}
 				}
 			}
-		}
 
-		if(delta_ts) {
-			if(jb->config->adaptive == 0) {
-				/* jitter buffer is not adaptive => discard the packet */
-				JB_TRACE("JB write ts=%u too late => discard\n",write_ts);
-				return JB_DISCARD_TOO_LATE;
-			}
+			if(delta_ts) {
+				if(jb->config->adaptive == 0) {
+					/* jitter buffer is not adaptive => discard the packet */
+					JB_TRACE("JB write ts=%u too late => discard\n",write_ts);
+					return JB_DISCARD_TOO_LATE;
+				}
 
-			if(jb->playout_delay_ts + delta_ts > jb->max_playout_delay_ts) {
-				/* max playout delay will be reached => discard the packet */
-				JB_TRACE("JB write ts=%u max playout delay reached => discard\n",write_ts);
-				return JB_DISCARD_TOO_LATE;
-			}
+				if(jb->playout_delay_ts + delta_ts > jb->max_playout_delay_ts) {
+					/* max playout delay will be reached => discard the packet */
+					JB_TRACE("JB write ts=%u max playout delay reached => discard\n",write_ts);
+					return JB_DISCARD_TOO_LATE;
+				}
 
-			/* adjust the playout delay */
-			jb->playout_delay_ts += delta_ts;
-			write_ts += delta_ts;
-			JB_TRACE("JB adjust playout delay=%u delta=%u\n",jb->playout_delay_ts,delta_ts);
+				/* adjust the playout delay */
+				jb->playout_delay_ts += delta_ts;
+				write_ts += delta_ts;
+				JB_TRACE("JB adjust playout delay=%u delta=%u\n",jb->playout_delay_ts,delta_ts);
 
-			if(jb->config->time_skew_detection) {
-				/* adjust the statistics */
-				jb->min_length_ts += delta_ts;
-				jb->max_length_ts += delta_ts;
+				if(jb->config->time_skew_detection) {
+					/* adjust the statistics */
+					jb->min_length_ts += delta_ts;
+					jb->max_length_ts += delta_ts;
+				}
 			}
 		}
 	}
 
-	/* get number of frames available to write */
-	available_frame_count = jb->frame_count - (write_ts - jb->read_ts)/jb->frame_ts;
-	if(available_frame_count <= 0) {
+	if(write_ts - jb->read_ts >= jb->length_ts) {
 		/* too early */
 		JB_TRACE("JB write ts=%u too early => discard\n",write_ts);
 		return JB_DISCARD_TOO_EARLY;
 	}
 
 	JB_TRACE("JB write ts=%u size=%"APR_SIZE_T_FMT"\n",write_ts,size);
-	while(available_frame_count && size) {
-		media_frame = mpf_jitter_buffer_frame_get(jb,write_ts);
-		media_frame->codec_frame.size = jb->frame_size;
-		if(mpf_codec_dissect(jb->codec,&buffer,&size,&media_frame->codec_frame) == FALSE) {
-			break;
+	index = mpf_jitter_buffer_index_get(jb,write_ts);
+	while(size && write_ts - jb->read_ts < jb->length_ts) {
+		slot = mpf_jitter_buffer_slot_at(jb,index);
+		if(packet) {
+			/* fixed size frames are referenced in the packet, instead of copied */
+			if(size < jb->frame_size || !jb->frame_size) {
+				break;
+			}
+			/* a duplicate frame replaces the one written earlier */
+			mpf_jitter_buffer_slot_release(jb,slot);
+			slot->payload = buffer;
+			slot->packet = packet;
+			packet->refs++;
+			slot->size = jb->frame_size;
+			buffer = (apr_byte_t*)buffer + jb->frame_size;
+			size -= jb->frame_size;
 		}
-
-		media_frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+		else {
+			codec_frame.buffer = JB_SLOT_PAYLOAD(slot);
+			codec_frame.size = jb->frame_size;
+			if(mpf_codec_dissect(jb->codec,&buffer,&size,&codec_frame) == FALSE) {
+				break;
+			}
+			mpf_jitter_buffer_slot_release(jb,slot);
+			slot->size = codec_frame.size;
+		}
+		slot->type |= MEDIA_FRAME_TYPE_AUDIO;
 		write_ts += jb->frame_ts;
-		available_frame_count--;
+		index++;
 	}
 
 	if(size) {
@@ -356,9 +580,23 @@ jb_result_t mpf_jitter_buffer_write(mpf_jitter_buffer_t *jb, void *buffer, apr_s
 	return result;
 }
 
+jb_result_t mpf_jitter_buffer_write(mpf_jitter_buffer_t *jb, void *buffer, apr_size_t size, apr_uint32_t ts, apr_byte_t marker)
+{
+	return mpf_jitter_buffer_audio_write(jb,NULL,buffer,size,ts,marker);
+}
+
+jb_result_t mpf_jitter_buffer_packet_write(mpf_jitter_buffer_t *jb, void *packet, void *buffer, apr_size_t size, apr_uint32_t ts, apr_byte_t marker)
+{
+	if(jb->codec->vtable->dissect) {
+		/* frames of variable size are copied by the custom dissector */
+		return mpf_jitter_buffer_audio_write(jb,NULL,buffer,size,ts,marker);
+	}
+	return mpf_jitter_buffer_audio_write(jb,JB_PACKET_GET(packet),buffer,size,ts,marker);
+}
+
 jb_result_t mpf_jitter_buffer_event_write(mpf_jitter_buffer_t *jb, const mpf_named_event_frame_t *named_event, apr_uint32_t ts, apr_byte_t marker)
 {
-	mpf_frame_t *media_frame;
+	mpf_jb_slot_t *slot;
 	apr_uint32_t write_ts;
 	jb_result_t result = mpf_jitter_buffer_write_prepare(jb,ts,&write_ts);
 	if(result != JB_OK) {
@@ -439,25 +677,25 @@ jb_result_t mpf_jitter_buffer_event_write(mpf_jitter_buffer_t *jb, const mpf_nam
 		}
 		JB_TRACE("JB adjust playout delay=%u delta=%u\n",jb->playout_delay_ts,delta_ts);
 	}
-	else if( (write_ts - jb->read_ts)/jb->frame_ts >= jb->frame_count) {
+	else if(write_ts - jb->read_ts >= jb->length_ts) {
 		/* too early */
 		JB_TRACE("JB write ts=%u event=%d duration=%d too early => discard\n",
 			write_ts,named_event->event_id,named_event->duration);
 		return JB_DISCARD_TOO_EARLY;
 	}
 
-	media_frame = mpf_jitter_buffer_frame_get(jb,write_ts);
-	media_frame->event_frame = *named_event;
-	media_frame->type |= MEDIA_FRAME_TYPE_EVENT;
+	slot = mpf_jitter_buffer_slot_at(jb,mpf_jitter_buffer_index_get(jb,write_ts));
+	slot->event_frame = *named_event;
+	slot->type |= MEDIA_FRAME_TYPE_EVENT;
 	if(marker) {
-		media_frame->marker = MPF_MARKER_START_OF_EVENT;
+		slot->marker = MPF_MARKER_START_OF_EVENT;
 	}
 	else if(named_event->edge == 1) {
-		media_frame->marker = MPF_MARKER_END_OF_EVENT;
+		slot->marker = MPF_MARKER_END_OF_EVENT;
 	}
 	JB_TRACE("JB write ts=%u event=%d duration=%d marker=%d\n",
-		write_ts,named_event->event_id,named_event->duration,media_frame->marker);
-	jb->event_write_update = &media_frame->event_frame;
+		write_ts,named_event->event_id,named_event->duration,slot->marker);
+	jb->event_write_update = &slot->event_frame;
 
 	write_ts += jb->frame_ts;
 	if(write_ts > jb->write_ts) {
@@ -467,32 +705,205 @@ jb_result_t mpf_jitter_buffer_event_write(mpf_jitter_buffer_t *jb, const mpf_nam
 	return result;
 }
 
-apt_bool_t mpf_jitter_buffer_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame)
+jb_result_t mpf_jitter_buffer_silence_write(mpf_jitter_buffer_t *jb, apr_uint32_t ts)
+{
+	mpf_jb_slot_t *slot;
+	apr_uint32_t write_ts;
+	jb_result_t result = mpf_jitter_buffer_write_prepare(jb,ts,&write_ts);
+	if(result != JB_OK) {
+		return result;
+	}
+
+	if(write_ts < jb->read_ts) {
+		/* the silence is played out already, it is taken from now on */
+		JB_TRACE("JB write ts=%u silence late\n",write_ts);
+		jb->dtx = TRUE;
+		return JB_OK;
+	}
+	if(write_ts - jb->read_ts >= jb->length_ts) {
+		/* too early */
+		JB_TRACE("JB write ts=%u silence too early => discard\n",write_ts);
+		return JB_DISCARD_TOO_EARLY;
+	}
+
+	/* the write pos is not advanced, the frames till the next audio are missing as such */
+	slot = mpf_jitter_buffer_slot_at(jb,mpf_jitter_buffer_index_get(jb,write_ts));
+	slot->type |= MEDIA_FRAME_TYPE_SILENCE;
+	JB_TRACE("JB write ts=%u silence\n",write_ts);
+	return JB_OK;
+}
+
+static APR_INLINE void mpf_jitter_buffer_plc_history_update(mpf_jitter_buffer_t *jb, const mpf_jb_slot_t *slot)
+{
+	if(jb->plc_history && slot->size == jb->frame_size) {
+		memcpy(jb->plc_history,slot->payload,slot->size);
+		jb->plc_frame_count = 0;
+	}
+}
+
+/* repeat the last frame attenuating it linearly down to silence over plc_max_frames */
+static void mpf_jitter_buffer_conceal(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame)
+{
+	apr_size_t i;
+	apr_size_t count;
+	apr_int32_t gain_start;
+	apr_int32_t gain_end;
+	apr_int32_t value;
+	const apr_byte_t *src = jb->plc_history;
+	apr_byte_t *dest = media_frame->codec_frame.buffer;
+
+	/* gain in Q15 at the start and at the end of the frame */
+	gain_start = (apr_int32_t)(32768 * (jb->plc_max_frames - jb->plc_frame_count) / jb->plc_max_frames);
+	gain_end = (apr_int32_t)(32768 * (jb->plc_max_frames - jb->plc_frame_count - 1) / jb->plc_max_frames);
+
+	count = jb->plc == JB_PLC_L16 ? jb->frame_size / BYTES_PER_SAMPLE : jb->frame_size;
+	for(i=0; i<count; i++) {
+		apr_int32_t gain = gain_start + (gain_end - gain_start) * (apr_int32_t)i / (apr_int32_t)count;
+		switch(jb->plc) {
+			case JB_PLC_L16:
+				/* network byte order */
+				value = (apr_int16_t)((src[2*i] << 8) | src[2*i+1]);
+				value = (value * gain) >> 15;
+				dest[2*i] = (apr_byte_t)((value >> 8) & 0xFF);
+				dest[2*i+1] = (apr_byte_t)(value & 0xFF);
+				break;
+			case JB_PLC_PCMU:
+				value = (ulaw_to_linear(src[i]) * gain) >> 15;
+				dest[i] = linear_to_ulaw(value);
+				break;
+			case JB_PLC_PCMA:
+				value = (alaw_to_linear(src[i]) * gain) >> 15;
+				dest[i] = linear_to_alaw(value);
+				break;
+			default:
+				break;
+		}
+	}
+
+	media_frame->type = MEDIA_FRAME_TYPE_AUDIO;
+	media_frame->marker = MPF_MARKER_NONE;
+	media_frame->codec_frame.size = jb->frame_size;
+	jb->plc_frame_count++;
+	jb->concealed_frames++;
+}
+
+/** Hand audio of a slot over to a media frame, by copy or by reference */
+static APR_INLINE void mpf_jitter_buffer_audio_get(mpf_jitter_buffer_t *jb, mpf_jb_slot_t *slot, mpf_frame_t *media_frame, apt_bool_t by_ref)
+{
+	media_frame->codec_frame.size = slot->size;
+	if(by_ref == TRUE) {
+		media_frame->codec_frame.buffer = (void*)slot->payload;
+		if(slot->packet) {
+			/* the packet outlives the slot till the next read */
+			jb->read_packet = slot->packet;
+			slot->packet->refs++;
+		}
+	}
+	else {
+		memcpy(media_frame->codec_frame.buffer,slot->payload,slot->size);
+	}
+}
+
+/** Mark the first audio frame read after missing ones (low-latency mode) */
+static APR_INLINE void mpf_jitter_buffer_gap_mark(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame)
+{
+	if(media_frame->marker == MPF_MARKER_NONE) {
+		media_frame->marker = MPF_MARKER_GAP;
+	}
+	jb->gap = FALSE;
+}
+
+static apt_bool_t mpf_jitter_buffer_frame_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame, apt_bool_t by_ref)
 {
-	mpf_frame_t *src_media_frame = mpf_jitter_buffer_frame_get(jb,jb->read_ts);
-	if(jb->write_ts > jb->read_ts) {
-		/* normal read */
+	mpf_jb_slot_t *slot = mpf_jitter_buffer_slot_at(jb,jb->read_index);
+	apt_bool_t silence = (slot->type & MEDIA_FRAME_TYPE_SILENCE) ? TRUE : FALSE;
+	slot->type &= ~MEDIA_FRAME_TYPE_SILENCE;
+	if(jb->read_packet) {
+		/* the frame read by reference last time is done with */
+		mpf_jitter_buffer_packet_unref(jb,jb->read_packet);
+		jb->read_packet = NULL;
+	}
+	if(slot->type == MEDIA_FRAME_TYPE_AUDIO && jb->write_ts > jb->read_ts) {
+		/* normal read of audio, the most common case */
 		JB_TRACE("JB read ts=%u\n",	jb->read_ts);
-		media_frame->type = src_media_frame->type;
-		media_frame->marker = src_media_frame->marker;
+		media_frame->type = MEDIA_FRAME_TYPE_AUDIO;
+		media_frame->marker = slot->marker;
+		mpf_jitter_buffer_audio_get(jb,slot,media_frame,by_ref);
+		if(jb->plc_history) {
+			mpf_jitter_buffer_plc_history_update(jb,slot);
+		}
+		if(jb->gap == TRUE) {
+			mpf_jitter_buffer_gap_mark(jb,media_frame);
+		}
+		jb->underflow = FALSE;
+		jb->dtx = FALSE;
+	}
+	else if(jb->write_ts > jb->read_ts) {
+		/* normal read of event and/or gap */
+		JB_TRACE("JB read ts=%u\n",	jb->read_ts);
+		media_frame->type = slot->type;
+		media_frame->marker = slot->marker;
 		if(media_frame->type & MEDIA_FRAME_TYPE_AUDIO) {
-			media_frame->codec_frame.size = src_media_frame->codec_frame.size;
-			memcpy(media_frame->codec_frame.buffer,src_media_frame->codec_frame.buffer,media_frame->codec_frame.size);
+			mpf_jitter_buffer_audio_get(jb,slot,media_frame,by_ref);
+			mpf_jitter_buffer_plc_history_update(jb,slot);
+			if(jb->gap == TRUE) {
+				mpf_jitter_buffer_gap_mark(jb,media_frame);
+			}
+			jb->dtx = FALSE;
 		}
 		if(media_frame->type & MEDIA_FRAME_TYPE_EVENT) {
-			media_frame->event_frame = src_media_frame->event_frame;
+			media_frame->event_frame = slot->event_frame;
+		}
+		if(media_frame->type != MEDIA_FRAME_TYPE_NONE) {
+			jb->underflow = FALSE;
+		}
+		else if(jb->underflow == FALSE && jb->dtx == FALSE && jb->config->low_latency) {
+			/* lost or not yet arrived frame, which is not part of the initial hold */
+			jb->gap = TRUE;
 		}
 	}
 	else {
 		/* underflow */
 		JB_TRACE("JB read ts=%u underflow\n", jb->read_ts);
+		if(jb->underflow == FALSE) {
+			jb->underflow = TRUE;
+			/* the buffer is expected to run dry once the sender stops transmitting */
+			if(jb->dtx == FALSE && silence == FALSE) {
+				jb->underruns++;
+				if(jb->config->low_latency) {
+					jb->gap = TRUE;
+				}
+			}
+		}
 		media_frame->type = MEDIA_FRAME_TYPE_NONE;
 		media_frame->marker = MPF_MARKER_NONE;
 	}
-	src_media_frame->type = MEDIA_FRAME_TYPE_NONE;
-	src_media_frame->marker = MPF_MARKER_NONE;
+	if(silence == TRUE) {
+		/* the silence starts with the frame comfort noise is written to */
+		jb->dtx = TRUE;
+	}
+	if(media_frame->type == MEDIA_FRAME_TYPE_NONE && jb->dtx == TRUE) {
+		/* absent rather than lost audio, nothing to conceal */
+		JB_TRACE("JB read ts=%u silence\n", jb->read_ts);
+		media_frame->type = MEDIA_FRAME_TYPE_SILENCE;
+	}
+	else if(media_frame->type == MEDIA_FRAME_TYPE_NONE && jb->plc_frame_count < jb->plc_max_frames) {
+		/* missing frame (lost or late) right after audio */
+		JB_TRACE("JB read ts=%u conceal\n", jb->read_ts);
+		mpf_jitter_buffer_conceal(jb,media_frame);
+	}
+	slot->type = MEDIA_FRAME_TYPE_NONE;
+	slot->marker = MPF_MARKER_NONE;
+	mpf_jitter_buffer_slot_release(jb,slot);
+	APT_PROBE5(jb_read,
+		jb,
+		jb->read_ts,
+		media_frame->type,
+		media_frame->codec_frame.size,
+		jb->write_ts > jb->read_ts ? jb->write_ts - jb->read_ts : 0);
 	/* advance read pos */
 	jb->read_ts += jb->frame_ts;
+	jb->read_index = (jb->read_index + 1) & jb->slot_mask;
 	
 	if(jb->config->time_skew_detection) {
 		/* update statistics after every read */
@@ -501,6 +912,16 @@ apt_bool_t mpf_jitter_buffer_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_fr
 	return TRUE;
 }
 
+apt_bool_t mpf_jitter_buffer_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame)
+{
+	return mpf_jitter_buffer_frame_read(jb,media_frame,FALSE);
+}
+
+apt_bool_t mpf_jitter_buffer_ref_read(mpf_jitter_buffer_t *jb, mpf_frame_t *media_frame)
+{
+	return mpf_jitter_buffer_frame_read(jb,media_frame,TRUE);
+}
+
 apr_uint32_t mpf_jitter_buffer_playout_delay_get(const mpf_jitter_buffer_t *jb)
 {
 	if(jb->config->adaptive == 0) {
@@ -509,3 +930,13 @@ apr_uint32_t mpf_jitter_buffer_playout_delay_get(const mpf_jitter_buffer_t *jb)
 
 	return jb->playout_delay_ts * CODEC_FRAME_TIME_BASE / jb->frame_ts;
 }
+
+apr_uint32_t mpf_jitter_buffer_concealed_frames_get(const mpf_jitter_buffer_t *jb)
+{
+	return jb->concealed_frames;
+}
+
+apr_uint32_t mpf_jitter_buffer_underruns_get(const mpf_jitter_buffer_t *jb)
+{
+	return jb->underruns;
+}
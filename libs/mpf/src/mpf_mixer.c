@@ -21,6 +21,22 @@
 #include "mpf_codec_manager.h"
 #include "apt_log.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MPF_MIXER_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+/* AVX2 is not assumed at compile-time, but selected by CPU capabilities */
+#define MPF_MIXER_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MPF_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
 typedef struct mpf_mixer_t mpf_mixer_t;
 
 /** MPF mixer derived from MPF object */
@@ -34,54 +50,202 @@ struct mpf_mixer_t {
 	/** Audio sink */
 	mpf_audio_stream_t  *sink;
 
-	/** Frame to read from audio source */
-	mpf_frame_t          frame;
+	/** Array of frames (one per source) to read from audio sources */
+	mpf_frame_t         *frame_arr;
+	/** Array of samples of the sources to mix */
+	const apr_int16_t  **input_arr;
 	/** Mixed frame to write to audio sink */
 	mpf_frame_t          mix_frame;
 };
 
-static apt_bool_t mpf_frames_mix(mpf_frame_t *mix_frame, const mpf_frame_t *frame)
+/** Prototype of mixing kernel */
+typedef void (*mpf_mix_kernel_f)(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples);
+
+static void mpf_mix_kernel_select(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples);
+
+/** Kernel resolved on the first call */
+static mpf_mix_kernel_f mpf_mix_kernel = mpf_mix_kernel_select;
+
+/** Mix samples [from, samples) one by one, the sum saturated once */
+static void mpf_mix_scalar_accumulate(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t from, apr_size_t samples)
 {
 	apr_size_t i;
-	apr_int16_t *mix_buf = mix_frame->codec_frame.buffer;
-	const apr_int16_t *buf = frame->codec_frame.buffer;
-	apr_size_t samples = frame->codec_frame.size / sizeof(apr_int16_t);
+	apr_size_t j;
+	apr_int32_t sum;
+	for(i=from; i<samples; i++) {
+		sum = 0;
+		for(j=0; j<input_count; j++) {
+			sum += inputs[j][i];
+		}
+		if(sum > 32767) {
+			sum = 32767;
+		}
+		else if(sum < -32768) {
+			sum = -32768;
+		}
+		mix[i] = (apr_int16_t)sum;
+	}
+}
 
-	if(mix_frame->codec_frame.size != frame->codec_frame.size) {
-		return FALSE;
+static void mpf_mix_scalar_kernel(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples)
+{
+	mpf_mix_scalar_accumulate(mix,inputs,input_count,0,samples);
+}
+
+#ifdef MPF_MIXER_SSE2
+static void mpf_mix_sse2_kernel(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples)
+{
+	apr_size_t i = 0;
+	apr_size_t j;
+	if(input_count == 2) {
+		/* the saturated sum of two inputs is exact */
+		for(; i + 8 <= samples; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(inputs[0] + i));
+			__m128i b = _mm_loadu_si128((const __m128i*)(inputs[1] + i));
+			_mm_storeu_si128((__m128i*)(mix + i),_mm_adds_epi16(a,b));
+		}
+	}
+	else {
+		/* sum in 32-bit lanes, saturate once by packing */
+		for(; i + 8 <= samples; i += 8) {
+			__m128i low = _mm_setzero_si128();
+			__m128i high = _mm_setzero_si128();
+			for(j=0; j<input_count; j++) {
+				__m128i x = _mm_loadu_si128((const __m128i*)(inputs[j] + i));
+				low = _mm_add_epi32(low,_mm_srai_epi32(_mm_unpacklo_epi16(x,x),16));
+				high = _mm_add_epi32(high,_mm_srai_epi32(_mm_unpackhi_epi16(x,x),16));
+			}
+			_mm_storeu_si128((__m128i*)(mix + i),_mm_packs_epi32(low,high));
+		}
+	}
+	mpf_mix_scalar_accumulate(mix,inputs,input_count,i,samples);
+}
+#endif
+
+#ifdef MPF_MIXER_AVX2
+__attribute__((target("avx2")))
+static void mpf_mix_avx2_kernel(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples)
+{
+	apr_size_t i = 0;
+	apr_size_t j;
+	if(input_count == 2) {
+		for(; i + 16 <= samples; i += 16) {
+			__m256i a = _mm256_loadu_si256((const __m256i*)(inputs[0] + i));
+			__m256i b = _mm256_loadu_si256((const __m256i*)(inputs[1] + i));
+			_mm256_storeu_si256((__m256i*)(mix + i),_mm256_adds_epi16(a,b));
+		}
+	}
+	else {
+		/* unpacking and packing are both per 128-bit lane, so the order is kept */
+		for(; i + 16 <= samples; i += 16) {
+			__m256i low = _mm256_setzero_si256();
+			__m256i high = _mm256_setzero_si256();
+			for(j=0; j<input_count; j++) {
+				__m256i x = _mm256_loadu_si256((const __m256i*)(inputs[j] + i));
+				low = _mm256_add_epi32(low,_mm256_srai_epi32(_mm256_unpacklo_epi16(x,x),16));
+				high = _mm256_add_epi32(high,_mm256_srai_epi32(_mm256_unpackhi_epi16(x,x),16));
+			}
+			_mm256_storeu_si256((__m256i*)(mix + i),_mm256_packs_epi32(low,high));
+		}
 	}
+	mpf_mix_scalar_accumulate(mix,inputs,input_count,i,samples);
+}
+#endif
 
-	if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
-		for(i=0; i<samples; i++) {
-			/* overflow MUST be considered */
-			mix_buf[i] = mix_buf[i] + buf[i];
+#ifdef MPF_MIXER_NEON
+static void mpf_mix_neon_kernel(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples)
+{
+	apr_size_t i = 0;
+	apr_size_t j;
+	if(input_count == 2) {
+		for(; i + 8 <= samples; i += 8) {
+			vst1q_s16(mix + i,vqaddq_s16(vld1q_s16(inputs[0] + i),vld1q_s16(inputs[1] + i)));
 		}
-		mix_frame->type |= MEDIA_FRAME_TYPE_AUDIO;
 	}
+	else {
+		for(; i + 8 <= samples; i += 8) {
+			int32x4_t low = vdupq_n_s32(0);
+			int32x4_t high = vdupq_n_s32(0);
+			for(j=0; j<input_count; j++) {
+				int16x8_t x = vld1q_s16(inputs[j] + i);
+				low = vaddw_s16(low,vget_low_s16(x));
+				high = vaddw_s16(high,vget_high_s16(x));
+			}
+			vst1q_s16(mix + i,vcombine_s16(vqmovn_s32(low),vqmovn_s32(high)));
+		}
+	}
+	mpf_mix_scalar_accumulate(mix,inputs,input_count,i,samples);
+}
+#endif
 
-	return TRUE;
+/** Resolve the kernel by CPU capabilities, then run it */
+static void mpf_mix_kernel_select(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples)
+{
+	mpf_mix_kernel_f kernel = mpf_mix_scalar_kernel;
+#if defined(MPF_MIXER_NEON)
+	kernel = mpf_mix_neon_kernel;
+#elif defined(MPF_MIXER_SSE2)
+	kernel = mpf_mix_sse2_kernel;
+#endif
+#ifdef MPF_MIXER_AVX2
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		kernel = mpf_mix_avx2_kernel;
+	}
+#endif
+	mpf_mix_kernel = kernel;
+	kernel(mix,inputs,input_count,samples);
+}
+
+MPF_DECLARE(void) mpf_mixer_samples_mix(apr_int16_t *mix, const apr_int16_t * const *inputs, apr_size_t input_count, apr_size_t samples)
+{
+	if(!input_count) {
+		memset(mix,0,samples * sizeof(apr_int16_t));
+		return;
+	}
+	if(input_count == 1) {
+		if(mix != inputs[0]) {
+			memcpy(mix,inputs[0],samples * sizeof(apr_int16_t));
+		}
+		return;
+	}
+	mpf_mix_kernel(mix,inputs,input_count,samples);
 }
 
 static apt_bool_t mpf_mixer_process(mpf_object_t *object)
 {
 	apr_size_t i;
+	apr_size_t input_count = 0;
 	mpf_audio_stream_t *source;
+	mpf_frame_t *frame;
 	mpf_mixer_t *mixer = (mpf_mixer_t*) object;
 
 	mixer->mix_frame.type = MEDIA_FRAME_TYPE_NONE;
 	mixer->mix_frame.marker = MPF_MARKER_NONE;
-	memset(mixer->mix_frame.codec_frame.buffer,0,mixer->mix_frame.codec_frame.size);
+	/* read all the sources first, then mix them in one pass */
 	for(i=0; i<mixer->source_count; i++) {
 		source = mixer->source_arr[i];
 		if(source) {
-			mixer->frame.type = MEDIA_FRAME_TYPE_NONE;
-			mixer->frame.marker = MPF_MARKER_NONE;
-			source->vtable->read_frame(source,&mixer->frame);
-			mpf_frames_mix(&mixer->mix_frame,&mixer->frame);
+			frame = &mixer->frame_arr[i];
+			frame->type = MEDIA_FRAME_TYPE_NONE;
+			frame->marker = MPF_MARKER_NONE;
+			source->vtable->read_frame(source,frame);
+			if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO &&
+				frame->codec_frame.size == mixer->mix_frame.codec_frame.size) {
+				mixer->input_arr[input_count++] = frame->codec_frame.buffer;
+			}
 		}
 	}
+	if(input_count) {
+		mixer->mix_frame.type |= MEDIA_FRAME_TYPE_AUDIO;
+	}
+	mpf_mixer_samples_mix(
+		mixer->mix_frame.codec_frame.buffer,
+		mixer->input_arr,
+		input_count,
+		mixer->mix_frame.codec_frame.size / sizeof(apr_int16_t));
 	mixer->sink->vtable->write_frame(mixer->sink,&mixer->mix_frame);
-	return TRUE;
+	return input_count ? TRUE : FALSE;
 }
 
 static apt_bool_t mpf_mixer_destroy(mpf_object_t *object)
@@ -154,6 +318,8 @@ MPF_DECLARE(mpf_object_t*) mpf_mixer_create(
 	mixer->source_arr = NULL;
 	mixer->source_count = 0;
 	mixer->sink = NULL;
+	mixer->frame_arr = NULL;
+	mixer->input_arr = NULL;
 	mpf_object_init(&mixer->base,name);
 	mixer->base.process = mpf_mixer_process;
 	mixer->base.destroy = mpf_mixer_destroy;
@@ -200,8 +366,12 @@ MPF_DECLARE(mpf_object_t*) mpf_mixer_create(
 
 	descriptor = sink->tx_descriptor;
 	frame_size = mpf_codec_linear_frame_size_calculate(descriptor->sampling_rate,descriptor->channel_count);
-	mixer->frame.codec_frame.size = frame_size;
-	mixer->frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	mixer->frame_arr = apr_palloc(pool,source_count * sizeof(mpf_frame_t));
+	for(i=0; i<source_count; i++) {
+		mixer->frame_arr[i].codec_frame.size = frame_size;
+		mixer->frame_arr[i].codec_frame.buffer = apr_palloc(pool,frame_size);
+	}
+	mixer->input_arr = apr_palloc(pool,source_count * sizeof(const apr_int16_t*));
 	mixer->mix_frame.codec_frame.size = frame_size;
 	mixer->mix_frame.codec_frame.buffer = apr_palloc(pool,frame_size);
 	return &mixer->base;
@@ -19,6 +19,7 @@
 #include "mpf_decoder.h"
 #include "mpf_resampler.h"
 #include "mpf_codec_manager.h"
+#include "mpf_frame_pool.h"
 #include "apt_log.h"
 
 typedef struct mpf_multiplier_t mpf_multiplier_t;
@@ -36,16 +37,29 @@ struct mpf_multiplier_t {
 
 	/** Media frame used to read data from source and write it to sinks */
 	mpf_frame_t          frame;
+	/** Buffer of the frame, unless shared by reference */
+	void                *buffer;
+	/** Pool of buffers to share frames across sinks by (NULL if frames are copied by sinks) */
+	mpf_frame_pool_t    *frame_pool;
 };
 
 static apt_bool_t mpf_multiplier_process(mpf_object_t *object)
 {
 	apr_size_t i;
 	mpf_audio_stream_t *sink;
+	mpf_frame_ref_t *ref = NULL;
 	mpf_multiplier_t *multiplier = (mpf_multiplier_t*) object;
 
 	multiplier->frame.type = MEDIA_FRAME_TYPE_NONE;
 	multiplier->frame.marker = MPF_MARKER_NONE;
+	multiplier->frame.codec_frame.buffer = multiplier->buffer;
+	if(multiplier->frame_pool) {
+		/* read to a shared buffer, which sinks keeping audio retain instead of copying it (the copy is used, if the pool is exhausted) */
+		ref = mpf_frame_pool_acquire(multiplier->frame_pool);
+		if(ref) {
+			multiplier->frame.codec_frame.buffer = mpf_frame_ref_data_get(ref);
+		}
+	}
 	multiplier->source->vtable->read_frame(multiplier->source,&multiplier->frame);
 	
 	if((multiplier->frame.type & MEDIA_FRAME_TYPE_AUDIO) == 0) {
@@ -57,10 +71,18 @@ static apt_bool_t mpf_multiplier_process(mpf_object_t *object)
 	for(i=0; i<multiplier->sink_count; i++)	{
 		sink = multiplier->sink_arr[i];
 		if(sink) {
-			sink->vtable->write_frame(sink,&multiplier->frame);
+			if(ref) {
+				mpf_audio_stream_frame_ref_write(sink,&multiplier->frame,ref);
+			}
+			else {
+				sink->vtable->write_frame(sink,&multiplier->frame);
+			}
 		}
 	}
-	return TRUE;
+	if(ref) {
+		mpf_frame_ref_release(ref);
+	}
+	return (multiplier->frame.type & MEDIA_FRAME_TYPE_AUDIO) ? TRUE : FALSE;
 }
 
 static apt_bool_t mpf_multiplier_destroy(mpf_object_t *object)
@@ -133,6 +155,8 @@ MPF_DECLARE(mpf_object_t*) mpf_multiplier_create(
 	multiplier->source = NULL;
 	multiplier->sink_arr = NULL;
 	multiplier->sink_count = 0;
+	multiplier->buffer = NULL;
+	multiplier->frame_pool = NULL;
 	mpf_object_init(&multiplier->base,name);
 	multiplier->base.process = mpf_multiplier_process;
 	multiplier->base.destroy = mpf_multiplier_destroy;
@@ -180,6 +204,18 @@ MPF_DECLARE(mpf_object_t*) mpf_multiplier_create(
 	descriptor = source->rx_descriptor;
 	frame_size = mpf_codec_linear_frame_size_calculate(descriptor->sampling_rate,descriptor->channel_count);
 	multiplier->frame.codec_frame.size = frame_size;
-	multiplier->frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	multiplier->buffer = apr_palloc(pool,frame_size);
+	multiplier->frame.codec_frame.buffer = multiplier->buffer;
 	return &multiplier->base;
 }
+
+MPF_DECLARE(void) mpf_multiplier_frame_pool_set(mpf_object_t *object, mpf_frame_pool_t *frame_pool)
+{
+	mpf_multiplier_t *multiplier = (mpf_multiplier_t*) object;
+	if(frame_pool && multiplier->frame.codec_frame.size > mpf_frame_pool_buffer_size_get(frame_pool)) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Frames Not Shared by Multiplier %s [%"APR_SIZE_T_FMT" bytes]",
+			object->name,multiplier->frame.codec_frame.size);
+		frame_pool = NULL;
+	}
+	multiplier->frame_pool = frame_pool;
+}
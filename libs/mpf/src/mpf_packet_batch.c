@@ -0,0 +1,174 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <apr_portable.h>
+#include "mpf_packet_batch.h"
+#include "apt_log.h"
+
+#if defined(__linux__)
+#include <sys/socket.h>
+/** Send packets through the same socket by sendmmsg() */
+#define ENABLE_SENDMMSG
+#endif
+
+/** Staged packet */
+typedef struct mpf_packet_t mpf_packet_t;
+struct mpf_packet_t {
+	apr_socket_t   *socket;
+	apr_sockaddr_t *sockaddr;
+	apr_size_t      size;
+	char           *data;
+};
+
+/** Batch of outbound packets */
+struct mpf_packet_batch_t {
+	/** Array of packets */
+	mpf_packet_t *packets;
+	/** Max number of packets */
+	apr_size_t    size;
+	/** Number of committed packets */
+	apr_size_t    count;
+#ifdef ENABLE_SENDMMSG
+	/** Message headers used by sendmmsg() */
+	struct mmsghdr *msgs;
+	/** IO vectors used by sendmmsg() */
+	struct iovec   *iovecs;
+#endif
+};
+
+MPF_DECLARE(mpf_packet_batch_t*) mpf_packet_batch_create(apr_size_t size, apr_pool_t *pool)
+{
+	apr_size_t i;
+	char *data;
+	mpf_packet_batch_t *batch;
+	if(!size) {
+		return NULL;
+	}
+
+	batch = apr_palloc(pool,sizeof(mpf_packet_batch_t));
+	batch->packets = apr_palloc(pool,sizeof(mpf_packet_t) * size);
+	batch->size = size;
+	batch->count = 0;
+	data = apr_palloc(pool,MPF_PACKET_BATCH_MAX_PACKET_SIZE * size);
+	for(i=0; i<size; i++) {
+		batch->packets[i].data = data + i * MPF_PACKET_BATCH_MAX_PACKET_SIZE;
+	}
+#ifdef ENABLE_SENDMMSG
+	batch->msgs = apr_pcalloc(pool,sizeof(struct mmsghdr) * size);
+	batch->iovecs = apr_pcalloc(pool,sizeof(struct iovec) * size);
+#endif
+	return batch;
+}
+
+MPF_DECLARE(void*) mpf_packet_batch_packet_get(
+								mpf_packet_batch_t *batch,
+								apr_socket_t *socket,
+								apr_sockaddr_t *sockaddr)
+{
+	mpf_packet_t *packet;
+	if(batch->count == batch->size) {
+		mpf_packet_batch_flush(batch);
+	}
+
+	packet = &batch->packets[batch->count];
+	packet->socket = socket;
+	packet->sockaddr = sockaddr;
+	packet->size = 0;
+	return packet->data;
+}
+
+MPF_DECLARE(void) mpf_packet_batch_packet_commit(mpf_packet_batch_t *batch, apr_size_t size)
+{
+	batch->packets[batch->count].size = size;
+	batch->count++;
+}
+
+#ifdef ENABLE_SENDMMSG
+/** Send packets [first, first + count) sharing the same socket */
+static apr_size_t mpf_packet_batch_group_send(mpf_packet_batch_t *batch, apr_os_sock_t fd, apr_size_t first, apr_size_t count)
+{
+	apr_size_t i;
+	apr_size_t sent = 0;
+	int rv;
+	for(i=0; i<count; i++) {
+		const mpf_packet_t *packet = &batch->packets[first + i];
+		struct mmsghdr *msg = &batch->msgs[i];
+		batch->iovecs[i].iov_base = packet->data;
+		batch->iovecs[i].iov_len = packet->size;
+		msg->msg_hdr.msg_iov = &batch->iovecs[i];
+		msg->msg_hdr.msg_iovlen = 1;
+		msg->msg_hdr.msg_name = &packet->sockaddr->sa;
+		msg->msg_hdr.msg_namelen = packet->sockaddr->salen;
+		msg->msg_hdr.msg_control = NULL;
+		msg->msg_hdr.msg_controllen = 0;
+		msg->msg_hdr.msg_flags = 0;
+		msg->msg_len = 0;
+	}
+
+	while(sent < count) {
+		rv = sendmmsg(fd,batch->msgs + sent,(unsigned int)(count - sent),MSG_DONTWAIT);
+		if(rv <= 0) {
+			break;
+		}
+		sent += rv;
+	}
+	return count - sent;
+}
+#endif
+
+MPF_DECLARE(apr_size_t) mpf_packet_batch_flush(mpf_packet_batch_t *batch)
+{
+	apr_size_t i;
+	apr_size_t j;
+	apr_size_t size;
+	apr_size_t failed = 0;
+	mpf_packet_t *packet;
+	for(i=0; i<batch->count; i = j) {
+		packet = &batch->packets[i];
+		/* find the run of packets sent through the same socket */
+		j = i + 1;
+		while(j < batch->count && batch->packets[j].socket == packet->socket) {
+			j++;
+		}
+
+#ifdef ENABLE_SENDMMSG
+		{
+			apr_os_sock_t fd;
+			if(apr_os_sock_get(&fd,packet->socket) == APR_SUCCESS) {
+				failed += mpf_packet_batch_group_send(batch,fd,i,j-i);
+				continue;
+			}
+		}
+#endif
+		for(; packet != batch->packets + j; packet++) {
+			size = packet->size;
+			if(apr_socket_sendto(packet->socket,packet->sockaddr,0,packet->data,&size) != APR_SUCCESS) {
+				failed++;
+			}
+		}
+	}
+
+	if(failed) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Failed to Send [%"APR_SIZE_T_FMT"] of [%"APR_SIZE_T_FMT"] Packets",
+			failed,batch->count);
+	}
+	batch->count = 0;
+	return failed;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_poll.h>
+#include "mpf_poller.h"
+#include "apt_log.h"
+
+/** Poller entry */
+struct mpf_poller_entry_t {
+	/** Pollset descriptor */
+	apr_pollfd_t         descriptor;
+	/** Readability handler */
+	mpf_poller_handler_f handler;
+	/** Object to pass to the handler */
+	void                *obj;
+};
+
+/** Poller */
+struct mpf_poller_t {
+	/** APR pollset (epoll on Linux) */
+	apr_pollset_t *pollset;
+	/** Max number of sockets */
+	apr_uint32_t   size;
+	/** Current number of sockets */
+	apr_uint32_t   count;
+};
+
+MPF_DECLARE(mpf_poller_t*) mpf_poller_create(apr_uint32_t size, apr_pool_t *pool)
+{
+	mpf_poller_t *poller = apr_palloc(pool,sizeof(mpf_poller_t));
+	poller->size = size;
+	poller->count = 0;
+	poller->pollset = NULL;
+	if(apr_pollset_create(&poller->pollset,size,pool,0) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pollset");
+		return NULL;
+	}
+	return poller;
+}
+
+MPF_DECLARE(void) mpf_poller_destroy(mpf_poller_t *poller)
+{
+	if(poller->pollset) {
+		apr_pollset_destroy(poller->pollset);
+		poller->pollset = NULL;
+	}
+}
+
+MPF_DECLARE(mpf_poller_entry_t*) mpf_poller_add(
+								mpf_poller_t *poller,
+								apr_socket_t *socket,
+								mpf_poller_handler_f handler,
+								void *obj,
+								apr_pool_t *pool)
+{
+	mpf_poller_entry_t *entry;
+	if(poller->count >= poller->size) {
+		return NULL;
+	}
+
+	entry = apr_palloc(pool,sizeof(mpf_poller_entry_t));
+	entry->handler = handler;
+	entry->obj = obj;
+	entry->descriptor.p = pool;
+	entry->descriptor.desc_type = APR_POLL_SOCKET;
+	entry->descriptor.reqevents = APR_POLLIN;
+	entry->descriptor.rtnevents = 0;
+	entry->descriptor.desc.s = socket;
+	entry->descriptor.client_data = entry;
+	if(apr_pollset_add(poller->pollset,&entry->descriptor) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Add Socket to Pollset");
+		return NULL;
+	}
+	poller->count++;
+	return entry;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_poller_remove(mpf_poller_t *poller, mpf_poller_entry_t *entry)
+{
+	if(apr_pollset_remove(poller->pollset,&entry->descriptor) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Remove Socket from Pollset");
+		return FALSE;
+	}
+	poller->count--;
+	return TRUE;
+}
+
+MPF_DECLARE(apt_bool_t) mpf_poller_process(mpf_poller_t *poller)
+{
+	apr_int32_t i;
+	apr_int32_t num = 0;
+	const apr_pollfd_t *descriptors;
+	const mpf_poller_entry_t *entry;
+	if(!poller->count) {
+		return TRUE;
+	}
+
+	if(apr_pollset_poll(poller->pollset,0,&num,&descriptors) != APR_SUCCESS) {
+		/* APR_TIMEUP, nothing to read */
+		return TRUE;
+	}
+
+	for(i=0; i<num; i++) {
+		entry = descriptors[i].client_data;
+		if(entry && entry->handler) {
+			entry->handler(entry->obj);
+		}
+	}
+	return TRUE;
+}
@@ -14,13 +14,295 @@
  * limitations under the License.
  */
 
+#include <math.h>
 #include "mpf_resampler.h"
 #include "apt_log.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MPF_RESAMPLER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MPF_RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Max interpolation/decimation factor (covers ratios of 8, 16, 32 and 48 kHz) */
+#define MPF_RESAMPLER_MAX_FACTOR   6
+/** Number of filter taps per zero-crossing of the lowest band edge (by the slower rate) */
+#define MPF_RESAMPLER_TAPS         16
+/** Fractional bits of filter coefficients */
+#define MPF_RESAMPLER_COEF_SHIFT   14
+/** Cutoff relative to the Nyquist frequency of the slower rate */
+#define MPF_RESAMPLER_CUTOFF       0.9
+
+typedef struct mpf_resampler_t mpf_resampler_t;
+
+/** Polyphase resampler by the rational factor of up/down */
+struct mpf_resampler_t {
+	/** Resampler base */
+	mpf_audio_stream_t *base;
+	/** Source stream to read from */
+	mpf_audio_stream_t *source;
+	/** Frame read from the source */
+	mpf_frame_t         frame_in;
+
+	/** Interpolation factor (the number of phases) */
+	apr_size_t          up;
+	/** Decimation factor */
+	apr_size_t          down;
+	/** Number of taps per phase (a multiple of 8) */
+	apr_size_t          taps;
+	/** Coefficients of phases ([up][taps]), reversed for the dot product with the history */
+	apr_int16_t        *coefs;
+
+	/** Samples of the previous frame needed by the filter, followed by the current frame */
+	apr_int16_t        *history;
+	/** Number of samples of the source frame */
+	apr_size_t          samples_in;
+	/** Number of samples of the resampled frame */
+	apr_size_t          samples_out;
+};
+
+static apr_size_t mpf_resampler_gcd(apr_size_t a, apr_size_t b)
+{
+	while(b) {
+		apr_size_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/** Design the lowpass filter (Blackman windowed sinc) and split it into phases */
+static void mpf_resampler_coefs_calculate(mpf_resampler_t *resampler)
+{
+	apr_size_t phase;
+	apr_size_t k;
+	apr_size_t length = resampler->taps * resampler->up;
+	double center = (double)(length - 1) / 2;
+	double factor = (double)(resampler->up > resampler->down ? resampler->up : resampler->down);
+	double cutoff = MPF_RESAMPLER_CUTOFF / (2 * factor);
+	for(phase=0; phase<resampler->up; phase++) {
+		apr_int16_t *coefs = resampler->coefs + phase * resampler->taps;
+		for(k=0; k<resampler->taps; k++) {
+			/* tap k of the phase is applied to the sample k steps back in the history */
+			apr_size_t i = phase + k * resampler->up;
+			double x = (double)i - center;
+			double w = 0.42 - 0.5 * cos(2 * M_PI * i / (length - 1)) + 0.08 * cos(4 * M_PI * i / (length - 1));
+			double h = 2 * cutoff;
+			if(x != 0) {
+				h = sin(2 * M_PI * cutoff * x) / (M_PI * x);
+			}
+			/* compensate for zero-stuffing on interpolation */
+			h *= w * resampler->up;
+			coefs[resampler->taps - 1 - k] = (apr_int16_t)floor(h * (1 << MPF_RESAMPLER_COEF_SHIFT) + 0.5);
+		}
+	}
+}
+
+/** Dot product of coefficients and samples, the count is a multiple of 8 */
+static APR_INLINE apr_int32_t mpf_resampler_dot_product(const apr_int16_t *coefs, const apr_int16_t *samples, apr_size_t count)
+{
+	apr_int32_t sum = 0;
+	apr_size_t i;
+#if defined(MPF_RESAMPLER_SSE2)
+	apr_int32_t lanes[4];
+	__m128i acc = _mm_setzero_si128();
+	for(i=0; i<count; i+=8) {
+		__m128i c = _mm_loadu_si128((const __m128i*)(coefs + i));
+		__m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+		acc = _mm_add_epi32(acc,_mm_madd_epi16(c,x));
+	}
+	_mm_storeu_si128((__m128i*)lanes,acc);
+	sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(MPF_RESAMPLER_NEON)
+	int32x4_t acc = vdupq_n_s32(0);
+	for(i=0; i<count; i+=8) {
+		int16x8_t c = vld1q_s16(coefs + i);
+		int16x8_t x = vld1q_s16(samples + i);
+		acc = vmlal_s16(acc,vget_low_s16(c),vget_low_s16(x));
+		acc = vmlal_s16(acc,vget_high_s16(c),vget_high_s16(x));
+	}
+	sum = vgetq_lane_s32(acc,0) + vgetq_lane_s32(acc,1) + vgetq_lane_s32(acc,2) + vgetq_lane_s32(acc,3);
+#else
+	for(i=0; i<count; i++) {
+		sum += (apr_int32_t)coefs[i] * samples[i];
+	}
+#endif
+	return sum;
+}
+
+/** Resample the frame in the history */
+static void mpf_resampler_frame_process(mpf_resampler_t *resampler, apr_int16_t *out)
+{
+	apr_size_t n;
+	const apr_size_t keep = resampler->taps - 1;
+	for(n=0; n<resampler->samples_out; n++) {
+		/* position in the interpolated domain, the frame holds a whole number of periods */
+		apr_size_t t = n * resampler->down;
+		apr_size_t index = t / resampler->up;
+		apr_size_t phase = t % resampler->up;
+		apr_int32_t sum = mpf_resampler_dot_product(
+			resampler->coefs + phase * resampler->taps,
+			resampler->history + index,
+			resampler->taps);
+		sum = (sum + (1 << (MPF_RESAMPLER_COEF_SHIFT - 1))) >> MPF_RESAMPLER_COEF_SHIFT;
+		if(sum > 32767) {
+			sum = 32767;
+		}
+		else if(sum < -32768) {
+			sum = -32768;
+		}
+		out[n] = (apr_int16_t)sum;
+	}
+
+	/* keep the tail for the next frame */
+	memmove(resampler->history,resampler->history + resampler->samples_in,keep * sizeof(apr_int16_t));
+}
+
+static apt_bool_t mpf_resampler_destroy(mpf_audio_stream_t *stream)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	return mpf_audio_stream_destroy(resampler->source);
+}
+
+static apt_bool_t mpf_resampler_open(mpf_audio_stream_t *stream, mpf_codec_t *codec)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	memset(resampler->history,0,(resampler->taps - 1 + resampler->samples_in) * sizeof(apr_int16_t));
+	return mpf_audio_stream_rx_open(resampler->source,NULL);
+}
+
+static apt_bool_t mpf_resampler_close(mpf_audio_stream_t *stream)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	return mpf_audio_stream_rx_close(resampler->source);
+}
+
+static apt_bool_t mpf_resampler_process(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	mpf_resampler_t *resampler = stream->obj;
+	apr_int16_t *in = resampler->history + resampler->taps - 1;
+	resampler->frame_in.type = MEDIA_FRAME_TYPE_NONE;
+	resampler->frame_in.marker = MPF_MARKER_NONE;
+	if(mpf_audio_stream_frame_read(resampler->source,&resampler->frame_in) != TRUE) {
+		return FALSE;
+	}
+
+	frame->type = resampler->frame_in.type;
+	frame->marker = resampler->frame_in.marker;
+	if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
+		frame->event_frame = resampler->frame_in.event_frame;
+	}
+	if((frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
+		memcpy(in,resampler->frame_in.codec_frame.buffer,resampler->samples_in * sizeof(apr_int16_t));
+	}
+	else {
+		/* keep the filter state continuous over missing audio */
+		memset(in,0,resampler->samples_in * sizeof(apr_int16_t));
+	}
+	mpf_resampler_frame_process(resampler,frame->codec_frame.buffer);
+	frame->codec_frame.size = resampler->samples_out * sizeof(apr_int16_t);
+	return TRUE;
+}
+
+static void mpf_resampler_trace(mpf_audio_stream_t *stream, mpf_stream_direction_e direction, apt_text_stream_t *output)
+{
+	apr_size_t offset;
+	mpf_codec_descriptor_t *descriptor;
+	mpf_resampler_t *resampler = stream->obj;
+
+	mpf_audio_stream_trace(resampler->source,direction,output);
+
+	descriptor = resampler->base->rx_descriptor;
+	if(descriptor) {
+		offset = output->pos - output->text.buf;
+		output->pos += apr_snprintf(output->pos, output->text.length - offset,
+			"->Resampler->[%s/%d/%d]",
+			descriptor->name.buf,
+			descriptor->sampling_rate,
+			descriptor->channel_count);
+	}
+}
+
+static const mpf_audio_stream_vtable_t vtable = {
+	mpf_resampler_destroy,
+	mpf_resampler_open,
+	mpf_resampler_close,
+	mpf_resampler_process,
+	NULL,
+	NULL,
+	NULL,
+	mpf_resampler_trace
+};
+
 MPF_DECLARE(mpf_audio_stream_t*) mpf_resampler_create(mpf_audio_stream_t *source, mpf_audio_stream_t *sink, apr_pool_t *pool)
 {
-	apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,
-		"Currently resampling is not supported. "
-		"Try to configure and use the same sampling rate on both ends");
-	return NULL;
+	apr_size_t gcd;
+	apr_size_t factor;
+	mpf_resampler_t *resampler;
+	mpf_stream_capabilities_t *capabilities;
+	const mpf_codec_descriptor_t *descriptor_in;
+	const mpf_codec_descriptor_t *descriptor_out;
+	if(!source || !sink || !source->rx_descriptor || !sink->tx_descriptor) {
+		return NULL;
+	}
+	descriptor_in = source->rx_descriptor;
+	descriptor_out = sink->tx_descriptor;
+
+	if(mpf_codec_lpcm_descriptor_match(descriptor_in) == FALSE) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler: unsupported codec [%s]",descriptor_in->name.buf);
+		return NULL;
+	}
+	if(descriptor_in->channel_count != 1 || descriptor_out->channel_count != 1) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler: only mono is supported");
+		return NULL;
+	}
+
+	gcd = mpf_resampler_gcd(descriptor_in->sampling_rate,descriptor_out->sampling_rate);
+	if(!gcd || descriptor_in->sampling_rate / gcd > MPF_RESAMPLER_MAX_FACTOR || descriptor_out->sampling_rate / gcd > MPF_RESAMPLER_MAX_FACTOR) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler: unsupported ratio [%d->%d]",
+			descriptor_in->sampling_rate,
+			descriptor_out->sampling_rate);
+		return NULL;
+	}
+
+	resampler = apr_palloc(pool,sizeof(mpf_resampler_t));
+	capabilities = mpf_stream_capabilities_create(STREAM_DIRECTION_RECEIVE,pool);
+	resampler->base = mpf_audio_stream_create(resampler,&vtable,capabilities,pool);
+	if(!resampler->base) {
+		return NULL;
+	}
+	resampler->base->rx_descriptor = mpf_codec_lpcm_descriptor_create(
+		descriptor_out->sampling_rate,
+		descriptor_out->channel_count,
+		pool);
+	resampler->base->rx_event_descriptor = source->rx_event_descriptor;
+	resampler->source = source;
+
+	resampler->up = descriptor_out->sampling_rate / gcd;
+	resampler->down = descriptor_in->sampling_rate / gcd;
+	/* the filter length grows with the larger factor to keep the transition band */
+	factor = resampler->up > resampler->down ? resampler->up : resampler->down;
+	resampler->taps = (MPF_RESAMPLER_TAPS * factor / resampler->up + 7) & ~(apr_size_t)7;
+	resampler->coefs = apr_palloc(pool,resampler->up * resampler->taps * sizeof(apr_int16_t));
+	mpf_resampler_coefs_calculate(resampler);
+
+	resampler->samples_in = mpf_codec_linear_frame_size_calculate(descriptor_in->sampling_rate,1) / sizeof(apr_int16_t);
+	resampler->samples_out = mpf_codec_linear_frame_size_calculate(descriptor_out->sampling_rate,1) / sizeof(apr_int16_t);
+	resampler->history = apr_pcalloc(pool,(resampler->taps - 1 + resampler->samples_in) * sizeof(apr_int16_t));
+
+	resampler->frame_in.codec_frame.size = resampler->samples_in * sizeof(apr_int16_t);
+	resampler->frame_in.codec_frame.buffer = apr_palloc(pool,resampler->frame_in.codec_frame.size);
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_DEBUG,"Create Resampler [%d->%d] phases [%"APR_SIZE_T_FMT"] taps [%"APR_SIZE_T_FMT"]",
+		descriptor_in->sampling_rate,
+		descriptor_out->sampling_rate,
+		resampler->up,
+		resampler->taps);
+	return resampler->base;
 }
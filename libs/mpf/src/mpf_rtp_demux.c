@@ -0,0 +1,518 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_poll.h>
+#include <apr_hash.h>
+#include <apr_portable.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include "mpf_rtp_demux.h"
+#include "apt_spsc_queue.h"
+#include "apt_log.h"
+
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
+
+#if defined(__linux__)
+#include <netinet/in.h>
+/** Receive packets in batches by recvmmsg() */
+#define ENABLE_DEMUX_RECVMMSG
+#endif
+
+/** Max size of a demultiplexed packet */
+#define DEMUX_MAX_PACKET_SIZE  1500
+/** Number of packets queued per stream */
+#define DEMUX_QUEUE_SIZE       16
+/** Poll timeout of the receiver thread (the max delay to stop the thread) */
+#define DEMUX_POLL_TIMEOUT     100000 /* usec */
+/** Max number of packets read from a socket per poll */
+#define DEMUX_MAX_READ_COUNT   64
+/** Size of a key made of remote IPv4 address and port */
+#define DEMUX_KEY_SIZE         6
+/** Max number of packets received by a single syscall */
+#define DEMUX_BATCH_SIZE       32
+
+/** Packet queued to a stream */
+typedef struct demux_packet_t demux_packet_t;
+struct demux_packet_t {
+	apr_size_t size;
+	apt_bool_t rtcp;
+	char       data[DEMUX_MAX_PACKET_SIZE];
+};
+
+/** Socket bound to the shared port */
+typedef struct demux_socket_t demux_socket_t;
+struct demux_socket_t {
+	apr_socket_t *socket;
+	apt_bool_t    rtcp;
+};
+
+/** Stream registration */
+struct mpf_rtp_demux_entry_t {
+	/** Packets from the receiver thread to the scheduler thread */
+	apt_spsc_queue_t *queue;
+	/** Remote RTP address key */
+	char              rtp_key[DEMUX_KEY_SIZE];
+	/** Remote RTCP address key */
+	char              rtcp_key[DEMUX_KEY_SIZE];
+	/** Whether RTCP key is set */
+	apt_bool_t        rtcp_key_set;
+	/** SSRC learnt from the remote RTP address */
+	apr_uint32_t      ssrc;
+	/** Whether SSRC is learnt */
+	apt_bool_t        ssrc_set;
+	/** Number of packets dropped due to the full queue */
+	apr_size_t        dropped_packets;
+};
+
+/** Demultiplexer of the shared port */
+struct mpf_rtp_demux_t {
+	/** Shared RTP port */
+	apr_port_t          port;
+	/** Sockets bound to RTP and RTCP ports */
+	demux_socket_t      sockets[2 * MPF_RTP_DEMUX_MAX_SOCKET_COUNT];
+	/** Number of sockets */
+	apr_size_t          socket_count;
+	/** Local RTP address */
+	apr_sockaddr_t     *rtp_l_sockaddr;
+	/** Local RTCP address */
+	apr_sockaddr_t     *rtcp_l_sockaddr;
+
+	/** Pollset of the sockets */
+	apr_pollset_t      *pollset;
+	/** Receiver thread */
+	apr_thread_t       *thread;
+	/** Whether receiver thread is running */
+	volatile apt_bool_t running;
+
+	/** Guard of the tables (the receiver thread vs the scheduler threads) */
+	apr_thread_mutex_t *guard;
+	/** Table of entries by remote address key */
+	apr_hash_t         *addr_table;
+	/** Table of entries by SSRC */
+	apr_hash_t         *ssrc_table;
+	/** Number of packets matching no entry */
+	apr_size_t          unmatched_packets;
+#ifdef ENABLE_DEMUX_RECVMMSG
+	/** Buffers of a batch (used by the receiver thread only) */
+	char              (*batch_buffers)[DEMUX_MAX_PACKET_SIZE];
+#endif
+	/** Pool to allocate memory from */
+	apr_pool_t         *pool;
+};
+
+static APR_INLINE void demux_key_make(char *key, const struct sockaddr_in *sin)
+{
+	memcpy(key,&sin->sin_addr,4);
+	memcpy(key+4,&sin->sin_port,2);
+}
+
+static apr_socket_t* demux_socket_create(const char *ip, apr_port_t port, apt_bool_t reuse_port, apr_pool_t *pool, apr_sockaddr_t **l_sockaddr)
+{
+	apr_socket_t *socket;
+	apr_sockaddr_t *sockaddr = NULL;
+	if(apr_sockaddr_info_get(&sockaddr,ip,APR_INET,port,0,pool) != APR_SUCCESS || !sockaddr) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Sockaddr %s:%hu",ip,port);
+		return NULL;
+	}
+	if(apr_socket_create(&socket,APR_INET,SOCK_DGRAM,0,pool) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Socket");
+		return NULL;
+	}
+
+	apr_socket_opt_set(socket,APR_SO_NONBLOCK,1);
+	apr_socket_timeout_set(socket,0);
+#ifdef SO_REUSEPORT
+	if(reuse_port == TRUE) {
+		apr_os_sock_t fd;
+		int on = 1;
+		if(apr_os_sock_get(&fd,socket) != APR_SUCCESS ||
+			setsockopt(fd,SOL_SOCKET,SO_REUSEPORT,(void*)&on,sizeof(on)) != 0) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Set SO_REUSEPORT %s:%hu",ip,port);
+		}
+	}
+#endif
+	if(apr_socket_bind(socket,sockaddr) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Bind Socket to %s:%hu",ip,port);
+		apr_socket_close(socket);
+		return NULL;
+	}
+	if(l_sockaddr) {
+		*l_sockaddr = sockaddr;
+	}
+	return socket;
+}
+
+/** Queue the packet to the stream it is destined to (called by the receiver thread with the guard locked) */
+static void demux_packet_dispatch(mpf_rtp_demux_t *demux, const struct sockaddr_in *from, const char *data, apr_size_t size, apt_bool_t rtcp)
+{
+	char key[DEMUX_KEY_SIZE];
+	apr_uint32_t ssrc = 0;
+	apt_bool_t ssrc_valid = FALSE;
+	mpf_rtp_demux_entry_t *entry;
+	demux_packet_t *packet;
+
+	/* SSRC of the sender is at offset 8 in RTP header and at offset 4 in RTCP SR/RR */
+	if(rtcp == FALSE && size >= 12) {
+		memcpy(&ssrc,data+8,4);
+		ssrc_valid = TRUE;
+	}
+	else if(rtcp == TRUE && size >= 8) {
+		memcpy(&ssrc,data+4,4);
+		ssrc_valid = TRUE;
+	}
+
+	demux_key_make(key,from);
+	entry = apr_hash_get(demux->addr_table,key,DEMUX_KEY_SIZE);
+	if(entry) {
+		if(rtcp == FALSE && ssrc_valid == TRUE && (entry->ssrc_set == FALSE || entry->ssrc != ssrc)) {
+			/* learn SSRC to follow the stream if the remote address changes (NAT rebinding) */
+			if(entry->ssrc_set == TRUE && apr_hash_get(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc)) == entry) {
+				apr_hash_set(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc),NULL);
+			}
+			entry->ssrc = ssrc;
+			entry->ssrc_set = TRUE;
+			apr_hash_set(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc),entry);
+		}
+	}
+	else if(ssrc_valid == TRUE) {
+		entry = apr_hash_get(demux->ssrc_table,&ssrc,sizeof(ssrc));
+	}
+
+	if(entry) {
+		packet = apt_spsc_queue_write_begin(entry->queue);
+		if(packet) {
+			memcpy(packet->data,data,size);
+			packet->size = size;
+			packet->rtcp = rtcp;
+			apt_spsc_queue_write_commit(entry->queue);
+		}
+		else {
+			entry->dropped_packets++;
+		}
+	}
+	else {
+		demux->unmatched_packets++;
+	}
+}
+
+#ifdef ENABLE_DEMUX_RECVMMSG
+/** Drain the socket by recvmmsg(), the packets of a batch are dispatched under a single lock */
+static void demux_socket_batch_read(mpf_rtp_demux_t *demux, const demux_socket_t *demux_socket, apr_os_sock_t fd)
+{
+	struct sockaddr_in names[DEMUX_BATCH_SIZE];
+	struct iovec iovecs[DEMUX_BATCH_SIZE];
+	struct mmsghdr msgs[DEMUX_BATCH_SIZE];
+	apr_size_t count = 0;
+	int num;
+	int i;
+
+	memset(msgs,0,sizeof(msgs));
+	for(i=0; i<DEMUX_BATCH_SIZE; i++) {
+		iovecs[i].iov_base = demux->batch_buffers[i];
+		iovecs[i].iov_len = DEMUX_MAX_PACKET_SIZE;
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &names[i];
+	}
+
+	while(count < DEMUX_MAX_READ_COUNT) {
+		for(i=0; i<DEMUX_BATCH_SIZE; i++) {
+			msgs[i].msg_hdr.msg_namelen = sizeof(names[i]);
+		}
+		num = recvmmsg(fd,msgs,DEMUX_BATCH_SIZE,MSG_DONTWAIT,NULL);
+		if(num <= 0) {
+			break;
+		}
+
+		apr_thread_mutex_lock(demux->guard);
+		for(i=0; i<num; i++) {
+			demux_packet_dispatch(demux,&names[i],demux->batch_buffers[i],msgs[i].msg_len,demux_socket->rtcp);
+		}
+		apr_thread_mutex_unlock(demux->guard);
+
+		if(num < DEMUX_BATCH_SIZE) {
+			/* drained */
+			break;
+		}
+		count += num;
+	}
+}
+#endif
+
+/** Read the packets available on the socket, up to DEMUX_MAX_READ_COUNT */
+static void demux_socket_read(mpf_rtp_demux_t *demux, const demux_socket_t *demux_socket)
+{
+	apr_size_t count;
+	apr_size_t size;
+	apr_sockaddr_t from;
+	char buffer[DEMUX_MAX_PACKET_SIZE];
+#ifdef ENABLE_DEMUX_RECVMMSG
+	apr_os_sock_t fd;
+	if(apr_os_sock_get(&fd,demux_socket->socket) == APR_SUCCESS) {
+		demux_socket_batch_read(demux,demux_socket,fd);
+		return;
+	}
+#endif
+
+	for(count=0; count<DEMUX_MAX_READ_COUNT; count++) {
+		memset(&from,0,sizeof(from));
+		size = sizeof(buffer);
+		if(apr_socket_recvfrom(&from,demux_socket->socket,0,buffer,&size) != APR_SUCCESS) {
+			break;
+		}
+		apr_thread_mutex_lock(demux->guard);
+		demux_packet_dispatch(demux,&from.sa.sin,buffer,size,demux_socket->rtcp);
+		apr_thread_mutex_unlock(demux->guard);
+	}
+}
+
+static void* APR_THREAD_FUNC demux_thread_proc(apr_thread_t *thread, void *data)
+{
+	mpf_rtp_demux_t *demux = data;
+	const apr_pollfd_t *descriptors;
+	apr_int32_t num;
+	apr_int32_t i;
+
+#if APR_HAS_SETTHREADNAME
+	apr_thread_name_set("MPF RTP Demux");
+#endif
+	while(demux->running == TRUE) {
+		num = 0;
+		if(apr_pollset_poll(demux->pollset,DEMUX_POLL_TIMEOUT,&num,&descriptors) != APR_SUCCESS) {
+			continue;
+		}
+
+		for(i=0; i<num; i++) {
+			demux_socket_read(demux,descriptors[i].client_data);
+		}
+	}
+
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static apr_status_t mpf_rtp_demux_cleanup(void *data)
+{
+	apr_size_t i;
+	apr_status_t status;
+	mpf_rtp_demux_t *demux = data;
+	if(demux->thread) {
+		demux->running = FALSE;
+		apr_thread_join(&status,demux->thread);
+		demux->thread = NULL;
+	}
+	for(i=0; i<demux->socket_count; i++) {
+		apr_socket_close(demux->sockets[i].socket);
+	}
+	demux->socket_count = 0;
+	apr_pollset_destroy(demux->pollset);
+	apr_thread_mutex_destroy(demux->guard);
+	return APR_SUCCESS;
+}
+
+MPF_DECLARE(mpf_rtp_demux_t*) mpf_rtp_demux_create(const char *ip, apr_port_t port, apr_size_t socket_count, apr_pool_t *pool)
+{
+	apr_size_t i;
+	apt_bool_t reuse_port;
+	demux_socket_t *demux_socket;
+	mpf_rtp_demux_t *demux;
+	if(!socket_count) {
+		return NULL;
+	}
+#ifndef SO_REUSEPORT
+	/* the port cannot be bound more than once */
+	socket_count = 1;
+#endif
+	if(socket_count > MPF_RTP_DEMUX_MAX_SOCKET_COUNT) {
+		socket_count = MPF_RTP_DEMUX_MAX_SOCKET_COUNT;
+	}
+	reuse_port = socket_count > 1 ? TRUE : FALSE;
+
+	demux = apr_palloc(pool,sizeof(mpf_rtp_demux_t));
+	demux->port = port;
+	demux->socket_count = 0;
+	demux->rtp_l_sockaddr = NULL;
+	demux->rtcp_l_sockaddr = NULL;
+	demux->thread = NULL;
+	demux->running = FALSE;
+	demux->addr_table = apr_hash_make(pool);
+	demux->ssrc_table = apr_hash_make(pool);
+	demux->unmatched_packets = 0;
+#ifdef ENABLE_DEMUX_RECVMMSG
+	demux->batch_buffers = apr_palloc(pool,DEMUX_BATCH_SIZE * DEMUX_MAX_PACKET_SIZE);
+#endif
+	demux->pool = pool;
+	if(apr_thread_mutex_create(&demux->guard,APR_THREAD_MUTEX_UNNESTED,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_pollset_create(&demux->pollset,(apr_uint32_t)(2 * socket_count),pool,0) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pollset");
+		apr_thread_mutex_destroy(demux->guard);
+		return NULL;
+	}
+
+	for(i=0; i<2 * socket_count; i++) {
+		apt_bool_t rtcp = (i % 2) ? TRUE : FALSE;
+		apr_socket_t *socket = demux_socket_create(
+									ip,
+									rtcp == TRUE ? port + 1 : port,
+									reuse_port,
+									pool,
+									rtcp == TRUE ? &demux->rtcp_l_sockaddr : &demux->rtp_l_sockaddr);
+		if(!socket) {
+			if(rtcp == TRUE) {
+				/* proceed without RTCP socket */
+				continue;
+			}
+			break;
+		}
+
+		demux_socket = &demux->sockets[demux->socket_count++];
+		demux_socket->socket = socket;
+		demux_socket->rtcp = rtcp;
+		{
+			apr_pollfd_t descriptor;
+			descriptor.p = pool;
+			descriptor.desc_type = APR_POLL_SOCKET;
+			descriptor.reqevents = APR_POLLIN;
+			descriptor.rtnevents = 0;
+			descriptor.desc.s = socket;
+			descriptor.client_data = demux_socket;
+			apr_pollset_add(demux->pollset,&descriptor);
+		}
+	}
+	apr_pool_cleanup_register(pool,demux,mpf_rtp_demux_cleanup,apr_pool_cleanup_null);
+
+	if(!demux->rtp_l_sockaddr) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Bind Shared RTP Port %s:%hu",ip,port);
+		return NULL;
+	}
+
+	demux->running = TRUE;
+	if(apr_thread_create(&demux->thread,NULL,demux_thread_proc,demux,pool) != APR_SUCCESS) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create RTP Demux Thread");
+		demux->running = FALSE;
+		demux->thread = NULL;
+		return NULL;
+	}
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Create RTP Demux %s:%hu [%"APR_SIZE_T_FMT" sockets]",
+		ip,port,demux->socket_count);
+	return demux;
+}
+
+MPF_DECLARE(apr_port_t) mpf_rtp_demux_port_get(const mpf_rtp_demux_t *demux)
+{
+	return demux->port;
+}
+
+MPF_DECLARE(void) mpf_rtp_demux_sockets_get(
+							const mpf_rtp_demux_t *demux,
+							apr_socket_t **rtp_socket,
+							apr_socket_t **rtcp_socket,
+							apr_sockaddr_t **rtp_l_sockaddr,
+							apr_sockaddr_t **rtcp_l_sockaddr)
+{
+	apr_size_t i;
+	*rtp_socket = NULL;
+	*rtcp_socket = NULL;
+	for(i=0; i<demux->socket_count; i++) {
+		const demux_socket_t *demux_socket = &demux->sockets[i];
+		if(demux_socket->rtcp == FALSE && !*rtp_socket) {
+			*rtp_socket = demux_socket->socket;
+		}
+		else if(demux_socket->rtcp == TRUE && !*rtcp_socket) {
+			*rtcp_socket = demux_socket->socket;
+		}
+	}
+	*rtp_l_sockaddr = demux->rtp_l_sockaddr;
+	*rtcp_l_sockaddr = demux->rtcp_l_sockaddr;
+}
+
+MPF_DECLARE(mpf_rtp_demux_entry_t*) mpf_rtp_demux_add(
+							mpf_rtp_demux_t *demux,
+							const apr_sockaddr_t *rtp_r_sockaddr,
+							const apr_sockaddr_t *rtcp_r_sockaddr,
+							apr_pool_t *pool)
+{
+	mpf_rtp_demux_entry_t *entry;
+	if(!rtp_r_sockaddr) {
+		return NULL;
+	}
+
+	entry = apr_palloc(pool,sizeof(mpf_rtp_demux_entry_t));
+	entry->queue = apt_spsc_queue_create(DEMUX_QUEUE_SIZE,sizeof(demux_packet_t),pool);
+	if(!entry->queue) {
+		return NULL;
+	}
+	demux_key_make(entry->rtp_key,&rtp_r_sockaddr->sa.sin);
+	entry->rtcp_key_set = FALSE;
+	if(rtcp_r_sockaddr) {
+		demux_key_make(entry->rtcp_key,&rtcp_r_sockaddr->sa.sin);
+		entry->rtcp_key_set = TRUE;
+	}
+	entry->ssrc = 0;
+	entry->ssrc_set = FALSE;
+	entry->dropped_packets = 0;
+
+	apr_thread_mutex_lock(demux->guard);
+	apr_hash_set(demux->addr_table,entry->rtp_key,DEMUX_KEY_SIZE,entry);
+	if(entry->rtcp_key_set == TRUE) {
+		apr_hash_set(demux->addr_table,entry->rtcp_key,DEMUX_KEY_SIZE,entry);
+	}
+	apr_thread_mutex_unlock(demux->guard);
+	return entry;
+}
+
+MPF_DECLARE(void) mpf_rtp_demux_remove(mpf_rtp_demux_t *demux, mpf_rtp_demux_entry_t *entry)
+{
+	apr_thread_mutex_lock(demux->guard);
+	if(apr_hash_get(demux->addr_table,entry->rtp_key,DEMUX_KEY_SIZE) == entry) {
+		apr_hash_set(demux->addr_table,entry->rtp_key,DEMUX_KEY_SIZE,NULL);
+	}
+	if(entry->rtcp_key_set == TRUE && apr_hash_get(demux->addr_table,entry->rtcp_key,DEMUX_KEY_SIZE) == entry) {
+		apr_hash_set(demux->addr_table,entry->rtcp_key,DEMUX_KEY_SIZE,NULL);
+	}
+	if(entry->ssrc_set == TRUE && apr_hash_get(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc)) == entry) {
+		apr_hash_set(demux->ssrc_table,&entry->ssrc,sizeof(entry->ssrc),NULL);
+	}
+	apr_thread_mutex_unlock(demux->guard);
+
+	if(entry->dropped_packets) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"RTP Demux Dropped [%"APR_SIZE_T_FMT"] Packets",entry->dropped_packets);
+	}
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_demux_packet_read(
+							mpf_rtp_demux_entry_t *entry,
+							void *buffer,
+							apr_size_t *size,
+							apt_bool_t *rtcp)
+{
+	demux_packet_t *packet = apt_spsc_queue_read_begin(entry->queue);
+	if(!packet) {
+		return FALSE;
+	}
+	if(packet->size < *size) {
+		*size = packet->size;
+	}
+	memcpy(buffer,packet->data,*size);
+	*rtcp = packet->rtcp;
+	apt_spsc_queue_read_commit(entry->queue);
+	return TRUE;
+}
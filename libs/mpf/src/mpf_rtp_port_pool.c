@@ -0,0 +1,118 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_time.h>
+#include "mpf_rtp_port_pool.h"
+
+/** Pool of RTP/RTCP port pairs */
+struct mpf_rtp_port_pool_t {
+	/** RTP port of the first pair */
+	apr_port_t    port_min;
+	/** Number of pairs in the range */
+	apr_size_t    pair_count;
+	/** Bitmap of the pairs taken */
+	apr_uint32_t *owned;
+	/** Ring of the free pairs (indexes), taken from the head and returned to the tail */
+	apr_uint16_t *ring;
+	/** Head of the ring */
+	apr_size_t    head;
+	/** Number of free pairs */
+	apr_size_t    free_count;
+	/** Whether to pick free pairs at random */
+	apt_bool_t    random;
+	/** State of the random generator (xorshift) */
+	apr_uint32_t  seed;
+};
+
+#define PAIR_BIT_TEST(bitmap,i)  ((bitmap)[(i) >> 5] & (1u << ((i) & 31)))
+#define PAIR_BIT_SET(bitmap,i)   ((bitmap)[(i) >> 5] |= (1u << ((i) & 31)))
+#define PAIR_BIT_CLEAR(bitmap,i) ((bitmap)[(i) >> 5] &= ~(1u << ((i) & 31)))
+
+MPF_DECLARE(mpf_rtp_port_pool_t*) mpf_rtp_port_pool_create(apr_port_t port_min, apr_port_t port_max, apt_bool_t random, apr_pool_t *pool)
+{
+	mpf_rtp_port_pool_t *port_pool;
+	apr_size_t i;
+	apr_uint32_t min = port_min + (port_min & 1);
+	if(port_max <= min + 1) {
+		return NULL;
+	}
+
+	port_pool = apr_palloc(pool,sizeof(mpf_rtp_port_pool_t));
+	port_pool->port_min = (apr_port_t)min;
+	port_pool->pair_count = (port_max - min) / 2;
+	port_pool->owned = apr_pcalloc(pool,sizeof(apr_uint32_t) * ((port_pool->pair_count + 31) / 32));
+	port_pool->ring = apr_palloc(pool,sizeof(apr_uint16_t) * port_pool->pair_count);
+	for(i=0; i<port_pool->pair_count; i++) {
+		port_pool->ring[i] = (apr_uint16_t)i;
+	}
+	port_pool->head = 0;
+	port_pool->free_count = port_pool->pair_count;
+	port_pool->random = random;
+	port_pool->seed = (apr_uint32_t)apr_time_now() | 1;
+	return port_pool;
+}
+
+MPF_DECLARE(apr_port_t) mpf_rtp_port_pool_alloc(mpf_rtp_port_pool_t *port_pool)
+{
+	apr_uint16_t index;
+	if(!port_pool->free_count) {
+		return 0;
+	}
+
+	if(port_pool->random == TRUE && port_pool->free_count > 1) {
+		/* swap a random free pair with the head */
+		apr_size_t slot;
+		apr_uint32_t x = port_pool->seed;
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		port_pool->seed = x;
+		slot = (port_pool->head + x % port_pool->free_count) % port_pool->pair_count;
+		index = port_pool->ring[slot];
+		port_pool->ring[slot] = port_pool->ring[port_pool->head];
+	}
+	else {
+		index = port_pool->ring[port_pool->head];
+	}
+	port_pool->head = (port_pool->head + 1) % port_pool->pair_count;
+	port_pool->free_count--;
+
+	PAIR_BIT_SET(port_pool->owned,index);
+	return (apr_port_t)(port_pool->port_min + index * 2);
+}
+
+MPF_DECLARE(apt_bool_t) mpf_rtp_port_pool_release(mpf_rtp_port_pool_t *port_pool, apr_port_t port)
+{
+	apr_size_t index;
+	if(port < port_pool->port_min || (port - port_pool->port_min) & 1) {
+		return FALSE;
+	}
+	index = (port - port_pool->port_min) / 2;
+	if(index >= port_pool->pair_count || !PAIR_BIT_TEST(port_pool->owned,index)) {
+		return FALSE;
+	}
+
+	PAIR_BIT_CLEAR(port_pool->owned,index);
+	port_pool->ring[(port_pool->head + port_pool->free_count) % port_pool->pair_count] = (apr_uint16_t)index;
+	port_pool->free_count++;
+	return TRUE;
+}
+
+MPF_DECLARE(apr_size_t) mpf_rtp_port_pool_free_count_get(const mpf_rtp_port_pool_t *port_pool)
+{
+	return port_pool->free_count;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "mpf_rtp_stat.h"
+
+/** Equipment impairment factor of G.711 (ITU-T G.113) */
+#define EMODEL_IE  0.0
+/** Packet-loss robustness factor of G.711 with no packet loss concealment (ITU-T G.113) */
+#define EMODEL_BPL 4.3
+/** Basic signal-to-noise ratio less the default impairments (ITU-T G.107) */
+#define EMODEL_R0  93.2
+
+/** Process a lost or discarded packet (RFC 3611 Appendix A.2) */
+static APR_INLINE void rtp_burst_loss_process(rtp_burst_stat_t *burst_stat)
+{
+	if(burst_stat->pkt || !burst_stat->loss_runs) {
+		burst_stat->loss_runs++;
+	}
+	if(burst_stat->pkt >= RTP_BURST_GMIN) {
+		if(burst_stat->lost == 1) {
+			burst_stat->c14++;
+		}
+		else {
+			burst_stat->c13++;
+		}
+		burst_stat->lost = 1;
+		burst_stat->c11 += burst_stat->pkt;
+	}
+	else {
+		burst_stat->lost++;
+		if(burst_stat->pkt == 0) {
+			burst_stat->c33++;
+		}
+		else {
+			burst_stat->c23++;
+			burst_stat->c22 += burst_stat->pkt - 1;
+		}
+	}
+	burst_stat->pkt = 0;
+}
+
+MPF_DECLARE(void) mpf_rtp_burst_stat_update(rtp_burst_stat_t *burst_stat, apr_uint32_t lost, apt_bool_t discarded)
+{
+	if(lost) {
+		rtp_burst_loss_process(burst_stat);
+		/* the rest of the run stays in the lost state */
+		burst_stat->lost += lost - 1;
+		burst_stat->c33 += lost - 1;
+	}
+	if(discarded == TRUE) {
+		rtp_burst_loss_process(burst_stat);
+	}
+	else {
+		burst_stat->pkt++;
+	}
+}
+
+/** Convert a fraction to the 8-bit fixed point of RFC 3611 */
+static APR_INLINE apr_byte_t rtcp_xr_fraction_get(double fraction)
+{
+	double value = fraction * 256;
+	if(value >= 255) {
+		return 255;
+	}
+	if(value <= 0) {
+		return 0;
+	}
+	return (apr_byte_t)value;
+}
+
+/** Convert a duration to the 16-bit msec of RFC 3611 */
+static APR_INLINE apr_uint16_t rtcp_xr_duration_get(double duration)
+{
+	if(duration >= 65535) {
+		return 65535;
+	}
+	if(duration <= 0) {
+		return 0;
+	}
+	return (apr_uint16_t)duration;
+}
+
+/** Convert R factor to MOS (x10) (ITU-T G.107 Annex B) */
+static APR_INLINE apr_byte_t emodel_mos_get(double r)
+{
+	double mos;
+	if(r <= 0) {
+		mos = 1;
+	}
+	else if(r >= 100) {
+		mos = 4.5;
+	}
+	else {
+		mos = 1 + 0.035 * r + r * (r - 60) * (100 - r) * 7e-6;
+	}
+	return (apr_byte_t)(mos * 10 + 0.5);
+}
+
+MPF_DECLARE(void) mpf_rtcp_xr_voip_stat_calculate(
+						const rtp_rx_stat_t *rx_stat,
+						apr_uint16_t packet_time,
+						apr_uint16_t jb_nominal,
+						apr_uint16_t jb_maximum,
+						rtcp_xr_voip_stat_t *voip_stat)
+{
+	const rtp_burst_stat_t *burst_stat = &rx_stat->burst;
+	double expected = (double)rx_stat->received_packets + rx_stat->lost_packets;
+	double c11, c13, c14, c22, c23, c31, c32, c33, ctotal;
+	double ppl = 0;
+	double burst_r = 1;
+	double delay;
+	double ie_eff;
+	double id;
+	double r_lq;
+	double r_cq;
+
+	if(expected > 0) {
+		voip_stat->loss_rate = rtcp_xr_fraction_get(rx_stat->lost_packets / expected);
+		voip_stat->discard_rate = rtcp_xr_fraction_get(rx_stat->discarded_packets / expected);
+		ppl = 100.0 * (rx_stat->lost_packets + rx_stat->discarded_packets) / expected;
+		if(ppl > 100) {
+			ppl = 100;
+		}
+	}
+	else {
+		voip_stat->loss_rate = 0;
+		voip_stat->discard_rate = 0;
+	}
+
+	/* packets received since the last loss complete the last gap */
+	c11 = burst_stat->c11 + (burst_stat->pkt >= RTP_BURST_GMIN ? burst_stat->pkt : 0);
+	c13 = burst_stat->c13;
+	c14 = burst_stat->c14;
+	c22 = burst_stat->c22;
+	c23 = burst_stat->c23;
+	c33 = burst_stat->c33;
+	if(c13 == 0 && (c23 + c33) > 0) {
+		/* the burst began with the stream */
+		c13 = 1;
+	}
+	c31 = c13;
+	c32 = c23;
+	ctotal = c11 + c14 + c13 + c22 + c23 + c31 + c32 + c33;
+
+	voip_stat->gap_density = (c11 + c14) > 0 ? rtcp_xr_fraction_get(c14 / (c11 + c14)) : 0;
+	if(c13 > 0) {
+		double p32 = c32 / (c31 + c32 + c33);
+		double p23 = (c22 + c23) < 1 ? 1 : 1 - c22 / (c22 + c23);
+		double gap_duration = (c11 + c14 + c13) * packet_time / c13;
+		voip_stat->burst_density = (p23 + p32) > 0 ? rtcp_xr_fraction_get(p23 / (p23 + p32)) : 0;
+		voip_stat->gap_duration = rtcp_xr_duration_get(gap_duration);
+		voip_stat->burst_duration = rtcp_xr_duration_get(ctotal * packet_time / c13 - gap_duration);
+	}
+	else {
+		/* no bursts */
+		voip_stat->burst_density = 0;
+		voip_stat->burst_duration = 0;
+		voip_stat->gap_duration = rtcp_xr_duration_get(ctotal * packet_time);
+	}
+	voip_stat->jb_nominal = jb_nominal;
+	voip_stat->jb_maximum = jb_maximum;
+
+	/* burst ratio: the mean loss run over the one expected of random loss */
+	if(burst_stat->loss_runs && ppl > 0 && ppl < 100) {
+		burst_r = (rx_stat->lost_packets + rx_stat->discarded_packets) / (double)burst_stat->loss_runs * (1 - ppl / 100);
+		if(burst_r < 1) {
+			burst_r = 1;
+		}
+	}
+	ie_eff = EMODEL_IE + (95 - EMODEL_IE) * ppl / (ppl / burst_r + EMODEL_BPL);
+
+	/* one-way delay of the receiver */
+	delay = (double)jb_nominal + packet_time;
+	id = 0.024 * delay;
+	if(delay > 177.3) {
+		id += 0.11 * (delay - 177.3);
+	}
+
+	r_lq = EMODEL_R0 - ie_eff;
+	r_cq = r_lq - id;
+	voip_stat->r_factor = (apr_byte_t)(r_cq <= 0 ? 0 : r_cq >= 100 ? 100 : r_cq + 0.5);
+	voip_stat->mos_lq = emodel_mos_get(r_lq);
+	voip_stat->mos_cq = emodel_mos_get(r_cq);
+}
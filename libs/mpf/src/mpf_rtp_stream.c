@@ -14,17 +14,31 @@
  * limitations under the License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <apr_network_io.h>
+#include <apr_portable.h>
+#include <apr_strings.h>
 #include "apt_net.h"
 #include "apt_timer_queue.h"
 #include "mpf_rtp_stream.h"
 #include "mpf_termination.h"
+#include "mpf_engine.h"
+#include "mpf_poller.h"
+#include "mpf_packet_batch.h"
+#include "mpf_rtp_demux.h"
+#include "mpf_rtp_port_pool.h"
 #include "mpf_codec_manager.h"
 #include "mpf_rtp_header.h"
 #include "mpf_rtcp_packet.h"
 #include "mpf_rtp_defs.h"
 #include "mpf_rtp_pt.h"
+#include "mpf_flight_recorder.h"
 #include "mpf_trace.h"
+#include "apt_probe.h"
+#include "apt_clock.h"
 #include "apt_log.h"
 
 /** Max size of RTP packet */
@@ -32,7 +46,21 @@
 /** Max size of RTCP packet */
 #define MAX_RTCP_PACKET_SIZE 1500
 
+#if defined(__linux__)
+#include <sys/socket.h>
+/** Receive RTP packets in batches by recvmmsg() */
+#define ENABLE_RTP_RECVMMSG
+#endif
+
+/** Max number of RTP packets received by a single syscall */
+#define RTP_RX_BATCH_SIZE       16
+/** Max number of batches received per stream per tick */
+#define RTP_RX_MAX_BATCH_COUNT  4
+
 /* Reason strings used in RTCP BYE messages (informative only) */
+/* Max number of packets held back by the jitter injected */
+#define RTP_TX_IMPAIRMENT_SLOTS 16
+
 #define RTCP_BYE_SESSION_ENDED "Session ended"
 #define RTCP_BYE_TALKSPURT_ENDED "Talskpurt ended"
 
@@ -47,6 +75,31 @@
 #define RTP_TRACE mpf_null_trace
 #endif
 
+/** Packet held back by the jitter injected */
+typedef struct rtp_tx_delayed_packet_t rtp_tx_delayed_packet_t;
+struct rtp_tx_delayed_packet_t {
+	/** Frame tick the packet is due at */
+	apr_uint32_t due;
+	/** Size of the packet (0 - free slot) */
+	apr_size_t   size;
+	/** Packet data */
+	char        *data;
+};
+
+/** Loss and jitter injected into packets sent */
+struct rtp_tx_impairment_t {
+	/** Configuration */
+	const mpf_rtp_impairment_t *config;
+	/** Max number of frames a packet is held back by */
+	apr_uint32_t                max_delay;
+	/** State of the pseudo-random sequence */
+	apr_uint32_t                seed;
+	/** Frame tick, incremented per frame transmitted */
+	apr_uint32_t                tick;
+	/** Packets held back */
+	rtp_tx_delayed_packet_t     slots[RTP_TX_IMPAIRMENT_SLOTS];
+};
+
 /** RTP stream */
 typedef struct mpf_rtp_stream_t mpf_rtp_stream_t;
 struct mpf_rtp_stream_t {
@@ -71,6 +124,11 @@ struct mpf_rtp_stream_t {
 
 	apt_timer_t                *rtcp_tx_timer;
 	apt_timer_t                *rtcp_rx_timer;
+
+	mpf_poller_entry_t         *rtp_poller_entry;
+	mpf_rtp_demux_entry_t      *demux_entry;
+	/** RTP port of the pair taken from the port pool (0 - none) */
+	apr_port_t                  pool_port;
 	
 	apr_pool_t                 *pool;
 };
@@ -79,6 +137,7 @@ static apt_bool_t mpf_rtp_stream_destroy(mpf_audio_stream_t *stream);
 static apt_bool_t mpf_rtp_rx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t *codec);
 static apt_bool_t mpf_rtp_rx_stream_close(mpf_audio_stream_t *stream);
 static apt_bool_t mpf_rtp_stream_receive(mpf_audio_stream_t *stream, mpf_frame_t *frame);
+static apt_bool_t mpf_rtp_stream_ref_receive(mpf_audio_stream_t *stream, mpf_frame_t *frame);
 static apt_bool_t mpf_rtp_tx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t *codec);
 static apt_bool_t mpf_rtp_tx_stream_close(mpf_audio_stream_t *stream);
 static apt_bool_t mpf_rtp_stream_transmit(mpf_audio_stream_t *stream, const mpf_frame_t *frame);
@@ -91,17 +150,25 @@ static const mpf_audio_stream_vtable_t vtable = {
 	mpf_rtp_tx_stream_open,
 	mpf_rtp_tx_stream_close,
 	mpf_rtp_stream_transmit,
-	NULL /* mpf_rtp_stream_trace */
+	NULL, /* mpf_rtp_stream_trace */
+	mpf_rtp_stream_ref_receive
 };
 
 static apt_bool_t mpf_rtp_socket_pair_create(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media, apt_bool_t bind);
 static apt_bool_t mpf_rtp_socket_pair_bind(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media);
+static apt_bool_t mpf_rtp_socket_pair_alloc(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media);
 static void mpf_rtp_socket_pair_close(mpf_rtp_stream_t *stream);
 
+static void rtp_rx_poller_handler(void *obj);
+static void rtp_rx_poller_remove(mpf_rtp_stream_t *rtp_stream);
+static void rtp_rx_demux_add(mpf_rtp_stream_t *rtp_stream);
+static void rtp_rx_demux_remove(mpf_rtp_stream_t *rtp_stream);
+
 static apt_bool_t mpf_rtcp_report_send(mpf_rtp_stream_t *stream);
 static apt_bool_t mpf_rtcp_bye_send(mpf_rtp_stream_t *stream, apt_str_t *reason);
 static void mpf_rtcp_tx_timer_proc(apt_timer_t *timer, void *obj);
 static void mpf_rtcp_rx_timer_proc(apt_timer_t *timer, void *obj);
+static apt_bool_t mpf_rtcp_compound_packet_receive(mpf_rtp_stream_t *rtp_stream, char *buffer, apr_size_t length);
 
 
 MPF_DECLARE(mpf_audio_stream_t*) mpf_rtp_stream_create(mpf_termination_t *termination, mpf_rtp_config_t *config, mpf_rtp_settings_t *settings, apr_pool_t *pool)
@@ -130,6 +197,9 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_rtp_stream_create(mpf_termination_t *termin
 	rtp_stream->rtcp_r_sockaddr = NULL;
 	rtp_stream->rtcp_tx_timer = NULL;
 	rtp_stream->rtcp_rx_timer = NULL;
+	rtp_stream->rtp_poller_entry = NULL;
+	rtp_stream->demux_entry = NULL;
+	rtp_stream->pool_port = 0;
 	rtp_stream->state = MPF_MEDIA_DISABLED;
 	rtp_receiver_init(&rtp_stream->receiver);
 	rtp_transmitter_init(&rtp_stream->transmitter);
@@ -150,6 +220,10 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_rtp_stream_create(mpf_termination_t *termin
 		}
 	}
 
+	if(settings->flight_recorder_size) {
+		audio_stream->recorder = mpf_flight_recorder_create(settings->flight_recorder_size,pool);
+	}
+
 	return audio_stream;
 }
 
@@ -169,7 +243,18 @@ static apt_bool_t mpf_rtp_stream_local_media_create(mpf_rtp_stream_t *rtp_stream
 		local_media->ip = rtp_stream->config->ip;
 		local_media->ext_ip = rtp_stream->config->ext_ip;
 	}
-	if(local_media->port == 0) {
+	if(rtp_stream->config->demux) {
+		/* all the streams share the same port */
+		if(mpf_rtp_socket_pair_create(rtp_stream,local_media,TRUE) == FALSE) {
+			status = FALSE;
+		}
+	}
+	else if(local_media->port == 0 && rtp_stream->config->port_pool) {
+		if(mpf_rtp_socket_pair_alloc(rtp_stream,local_media) == FALSE) {
+			status = FALSE;
+		}
+	}
+	else if(local_media->port == 0) {
 		if(mpf_rtp_socket_pair_create(rtp_stream,local_media,FALSE) == TRUE) {
 			/* RTP port management */
 			mpf_rtp_config_t *rtp_config = rtp_stream->config;
@@ -305,6 +390,12 @@ static apt_bool_t mpf_rtp_stream_remote_media_update(mpf_rtp_stream_t *rtp_strea
 				media->port+1,
 				0,
 				rtp_stream->pool);
+
+			if(rtp_stream->demux_entry) {
+				/* re-register to receive from the new remote address */
+				rtp_rx_demux_remove(rtp_stream);
+				rtp_rx_demux_add(rtp_stream);
+			}
 		}
 	}
 
@@ -436,6 +527,17 @@ MPF_DECLARE(apt_bool_t) mpf_rtp_stream_remove(mpf_audio_stream_t *stream)
 	return TRUE;
 }
 
+MPF_DECLARE(apt_bool_t) mpf_rtp_stream_rx_stat_get(const mpf_audio_stream_t *stream, rtp_rx_stat_t *rx_stat, rtcp_xr_voip_stat_t *voip_stat)
+{
+	const mpf_rtp_stream_t *rtp_stream = stream->obj;
+	if(!rtp_stream->receiver.stat.received_packets) {
+		return FALSE;
+	}
+	*rx_stat = rtp_stream->receiver.stat;
+	*voip_stat = rtp_stream->receiver.xr_stat;
+	return TRUE;
+}
+
 MPF_DECLARE(apt_bool_t) mpf_rtp_stream_modify(mpf_audio_stream_t *stream, mpf_rtp_stream_descriptor_t *descriptor)
 {
 	apt_bool_t status = TRUE;
@@ -506,8 +608,22 @@ static apt_bool_t mpf_rtp_rx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t
 						codec,
 						rtp_stream->pool);
 
+	if(rtp_stream->config->demux) {
+		/* packets are received by the demultiplexer of the shared port */
+		rtp_rx_demux_add(rtp_stream);
+	}
+	else if(stream->termination && stream->termination->poller) {
+		/* read the socket only when it becomes readable instead of on every tick */
+		rtp_stream->rtp_poller_entry = mpf_poller_add(
+						stream->termination->poller,
+						rtp_stream->rtp_socket,
+						rtp_rx_poller_handler,
+						rtp_stream,
+						rtp_stream->pool);
+	}
+
 	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,
-			"Open RTP Receiver %s:%hu <- %s:%hu playout [%u ms] bounds [%u - %u ms] adaptive [%d] skew detection [%d]",
+			"Open RTP Receiver %s:%hu <- %s:%hu playout [%u ms] bounds [%u - %u ms] adaptive [%d] skew detection [%d] low latency [%d]",
 			rtp_stream->rtp_l_sockaddr->hostname,
 			rtp_stream->rtp_l_sockaddr->port,
 			rtp_stream->rtp_r_sockaddr->hostname,
@@ -516,15 +632,36 @@ static apt_bool_t mpf_rtp_rx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t
 			jb_config->min_playout_delay,
 			jb_config->max_playout_delay,
 			jb_config->adaptive,
-			jb_config->time_skew_detection);
+			jb_config->time_skew_detection,
+			jb_config->low_latency);
 	return TRUE;
 }
 
+/** Calculate RTCP XR VoIP metrics of the receiver */
+static void rtp_rx_xr_stat_calculate(mpf_rtp_stream_t *rtp_stream)
+{
+	rtp_receiver_t *receiver = &rtp_stream->receiver;
+	mpf_jb_config_t *jb_config = &rtp_stream->settings->jb_config;
+	apr_uint16_t packet_time = 20;
+	apr_uint16_t jb_nominal = (apr_uint16_t)mpf_jitter_buffer_playout_delay_get(receiver->jb);
+	apr_uint16_t jb_maximum = jb_nominal;
+	if(rtp_stream->remote_media && rtp_stream->remote_media->ptime) {
+		packet_time = rtp_stream->remote_media->ptime;
+	}
+	if(jb_config->adaptive && jb_config->max_playout_delay > jb_maximum) {
+		jb_maximum = (apr_uint16_t)jb_config->max_playout_delay;
+	}
+	mpf_rtcp_xr_voip_stat_calculate(&receiver->stat,packet_time,jb_nominal,jb_maximum,&receiver->xr_stat);
+}
+
 static apt_bool_t mpf_rtp_rx_stream_close(mpf_audio_stream_t *stream)
 {
 	mpf_rtp_stream_t *rtp_stream = stream->obj;
 	rtp_receiver_t *receiver = &rtp_stream->receiver;
 
+	rtp_rx_poller_remove(rtp_stream);
+	rtp_rx_demux_remove(rtp_stream);
+
 	if(!rtp_stream->rtp_l_sockaddr || !rtp_stream->rtp_r_sockaddr) {
 		return FALSE;
 	}
@@ -538,7 +675,11 @@ static apt_bool_t mpf_rtp_rx_stream_close(mpf_audio_stream_t *stream)
 		}
 	}
 
-	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Close RTP Receiver %s:%hu <- %s:%hu [r:%u l:%u j:%u p:%u d:%u i:%u]",
+	receiver->stat.concealed_frames = mpf_jitter_buffer_concealed_frames_get(receiver->jb);
+	receiver->stat.underruns = mpf_jitter_buffer_underruns_get(receiver->jb);
+	rtp_rx_xr_stat_calculate(rtp_stream);
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Close RTP Receiver %s:%hu <- %s:%hu [r:%u l:%u j:%u p:%u d:%u i:%u c:%u]",
 			rtp_stream->rtp_l_sockaddr->hostname,
 			rtp_stream->rtp_l_sockaddr->port,
 			rtp_stream->rtp_r_sockaddr->hostname,
@@ -548,7 +689,29 @@ static apt_bool_t mpf_rtp_rx_stream_close(mpf_audio_stream_t *stream)
 			receiver->rr_stat.jitter,
 			mpf_jitter_buffer_playout_delay_get(receiver->jb),
 			receiver->stat.discarded_packets,
-			receiver->stat.ignored_packets);
+			receiver->stat.ignored_packets,
+			receiver->stat.concealed_frames);
+	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"RTP Receiver VoIP Metrics %s:%hu <- %s:%hu [loss:%u discard:%u burst:%u/%ums gap:%u/%ums jb:%u/%ums R:%u MOS-LQ:%u.%u MOS-CQ:%u.%u]",
+			rtp_stream->rtp_l_sockaddr->hostname,
+			rtp_stream->rtp_l_sockaddr->port,
+			rtp_stream->rtp_r_sockaddr->hostname,
+			rtp_stream->rtp_r_sockaddr->port,
+			receiver->xr_stat.loss_rate,
+			receiver->xr_stat.discard_rate,
+			receiver->xr_stat.burst_density,
+			receiver->xr_stat.burst_duration,
+			receiver->xr_stat.gap_density,
+			receiver->xr_stat.gap_duration,
+			receiver->xr_stat.jb_nominal,
+			receiver->xr_stat.jb_maximum,
+			receiver->xr_stat.r_factor,
+			receiver->xr_stat.mos_lq / 10,
+			receiver->xr_stat.mos_lq % 10,
+			receiver->xr_stat.mos_cq / 10,
+			receiver->xr_stat.mos_cq % 10);
+	if(stream->termination && stream->termination->media_engine) {
+		mpf_engine_rtp_stat_add(stream->termination->media_engine,&receiver->stat,receiver->rr_stat.jitter);
+	}
 	mpf_jitter_buffer_destroy(receiver->jb);
 	return TRUE;
 }
@@ -703,15 +866,16 @@ typedef enum {
 	RTP_SEQ_DRIFT
 } rtp_seq_result_e;
 
-static APR_INLINE rtp_seq_result_e rtp_rx_seq_update(rtp_receiver_t *receiver, apr_uint16_t seq_num)
+static APR_INLINE rtp_seq_result_e rtp_rx_seq_update(rtp_receiver_t *receiver, apr_uint16_t seq_num, apr_uint32_t *lost)
 {
 	rtp_seq_result_e result = RTP_SEQ_UPDATE;
 	apr_uint16_t seq_delta = seq_num - receiver->history.seq_num_max;
+	*lost = 0;
 	if(seq_delta < MAX_DROPOUT) {
-		if(seq_num < receiver->history.seq_num_max) {
-			/* sequence number wrapped */
-			receiver->history.seq_cycles += RTP_SEQ_MOD;
-		}
+		/* in order, or after a gap (late packets of the gap are not subtracted, they count as received) */
+		*lost = seq_delta - (seq_delta != 0);
+		/* add a cycle if the sequence number wrapped */
+		receiver->history.seq_cycles += (seq_num < receiver->history.seq_num_max) ? RTP_SEQ_MOD : 0;
 		receiver->history.seq_num_max = seq_num;
 	}
 	else if(seq_delta <= RTP_SEQ_MOD - MAX_MISORDER) {
@@ -788,12 +952,63 @@ static APR_INLINE void rtp_rx_failure_threshold_check(rtp_receiver_t *receiver)
 	}
 }
 
-static apt_bool_t rtp_rx_packet_receive(mpf_rtp_stream_t *rtp_stream, void *buffer, apr_size_t size)
+/** Update SSRC off the fast path: the first packet, a packet of another SSRC or the one on probation */
+static apt_bool_t rtp_rx_ssrc_slow_update(rtp_receiver_t *receiver, rtp_header_t *header, apr_time_t *time)
+{
+	rtp_ssrc_result_e ssrc_result;
+	if(!receiver->stat.received_packets) {
+		/* initialization */
+		rtp_rx_stat_init(receiver,header,time);
+	}
+
+	ssrc_result = rtp_rx_ssrc_update(receiver,header->ssrc);
+	if(ssrc_result == RTP_SSRC_PROBATION) {
+		receiver->stat.invalid_packets++;
+		return FALSE;
+	}
+	else if(ssrc_result == RTP_SSRC_RESTART) {
+		rtp_rx_restart(receiver);
+		rtp_rx_stat_init(receiver,header,time);
+	}
+	return TRUE;
+}
+
+/**
+ * Receive RTP packet.
+ * @param packet the packet buffer of the jitter buffer the packet is received to
+ * @param buffer the packet
+ * @param size the size of the packet
+ * @param time the arrival time, which is read once per receive batch
+ */
+static void rtp_rx_packet_trace(mpf_rtp_stream_t *rtp_stream, const rtp_header_t *header, apr_size_t size, jb_result_t result)
+{
+	mpf_flight_recorder_t *recorder = rtp_stream->base->recorder;
+	char name[64];
+	APT_PROBE5(rtp_rx,
+		rtp_stream->local_media ? rtp_stream->local_media->port : 0,
+		header->ssrc,
+		header->sequence,
+		size,
+		result);
+	if(!recorder) {
+		return;
+	}
+
+	if(mpf_flight_recorder_rtp_put(recorder,(apr_uint16_t)header->sequence,header->timestamp,size,result) == TRUE) {
+		apr_snprintf(name,sizeof(name),"%s:%hu",
+			rtp_stream->local_media ? rtp_stream->local_media->ip.buf : "",
+			rtp_stream->local_media ? rtp_stream->local_media->port : 0);
+		mpf_flight_recorder_dump(recorder,name,"Discard Spike");
+	}
+}
+
+static apt_bool_t rtp_rx_packet_receive(mpf_rtp_stream_t *rtp_stream, void *packet, void *buffer, apr_size_t size, apr_time_t time)
 {
 	rtp_receiver_t *receiver = &rtp_stream->receiver;
 	mpf_codec_descriptor_t *descriptor = rtp_stream->base->rx_descriptor;
-	apr_time_t time;
-	rtp_ssrc_result_e ssrc_result;
+	apr_uint32_t lost;
+	apt_bool_t discarded = FALSE;
+	jb_result_t result;
 	rtp_header_t *header = rtp_rx_header_skip(&buffer,&size);
 	if(!header) {
 		/* invalid RTP packet */
@@ -805,28 +1020,20 @@ static apt_bool_t rtp_rx_packet_receive(mpf_rtp_stream_t *rtp_stream, void *buff
 	header->timestamp = ntohl(header->timestamp);
 	header->ssrc = ntohl(header->ssrc);
 
-	time = apr_time_now();
-
+#if ENABLE_RTP_PACKET_TRACE
 	RTP_TRACE("RTP time=%6u ssrc=%8x pt=%3u %cts=%9u seq=%5u size=%"APR_SIZE_T_FMT"\n",
 					(apr_uint32_t)apr_time_usec(time),
 					header->ssrc, header->type, (header->marker == 1) ? '*' : ' ',
 					header->timestamp, header->sequence, size);
-	if(!receiver->stat.received_packets) {
-		/* initialization */
-		rtp_rx_stat_init(receiver,header,&time);
-	}
-
-	ssrc_result = rtp_rx_ssrc_update(receiver,header->ssrc);
-	if(ssrc_result == RTP_SSRC_PROBATION) {
-		receiver->stat.invalid_packets++;
-		return FALSE;
-	}
-	else if(ssrc_result == RTP_SSRC_RESTART) {
-		rtp_rx_restart(receiver);
-		rtp_rx_stat_init(receiver,header,&time);
+#endif
+	/* a single branch for the known SSRC with no probation, the most common case */
+	if(((receiver->rr_stat.ssrc ^ header->ssrc) | receiver->history.ssrc_probation | (receiver->stat.received_packets == 0)) != 0) {
+		if(rtp_rx_ssrc_slow_update(receiver,header,&time) == FALSE) {
+			return FALSE;
+		}
 	}
 
-	rtp_rx_seq_update(receiver,(apr_uint16_t)header->sequence);
+	rtp_rx_seq_update(receiver,(apr_uint16_t)header->sequence,&lost);
 	
 	if(header->type == descriptor->payload_type) {
 		/* codec */
@@ -836,54 +1043,236 @@ static apt_bool_t rtp_rx_packet_receive(mpf_rtp_stream_t *rtp_stream, void *buff
 			return FALSE;
 		}
 	
-		if(mpf_jitter_buffer_write(receiver->jb,buffer,size,header->timestamp,marker) != JB_OK) {
+		result = mpf_jitter_buffer_packet_write(receiver->jb,packet,buffer,size,header->timestamp,marker);
+		if(result != JB_OK) {
 			receiver->stat.discarded_packets++;
+			discarded = TRUE;
 			rtp_rx_failure_threshold_check(receiver);
 		}
+		rtp_rx_packet_trace(rtp_stream,header,size,result);
 	}
 	else if(rtp_stream->base->rx_event_descriptor && 
 		header->type == rtp_stream->base->rx_event_descriptor->payload_type) {
 		/* named event */
 		mpf_named_event_frame_t *named_event = (mpf_named_event_frame_t *)buffer;
 		named_event->duration = ntohs((apr_uint16_t)named_event->duration);
-		if(mpf_jitter_buffer_event_write(receiver->jb,named_event,header->timestamp,(apr_byte_t)header->marker) != JB_OK) {
+		result = mpf_jitter_buffer_event_write(receiver->jb,named_event,header->timestamp,(apr_byte_t)header->marker);
+		if(result != JB_OK) {
 			receiver->stat.discarded_packets++;
+			discarded = TRUE;
 		}
+		rtp_rx_packet_trace(rtp_stream,header,size,result);
 	}
-	else if(header->type == RTP_PT_CN) {
-		/* CN packet */
-		receiver->stat.ignored_packets++;
+	else if(header->type == RTP_PT_CN && descriptor->sampling_rate == 8000) {
+		/* CN packet, the audio is absent till the next talkspurt (the static payload type is clocked at 8 kHz) */
+		result = mpf_jitter_buffer_silence_write(receiver->jb,header->timestamp);
+		rtp_rx_packet_trace(rtp_stream,header,size,result);
 	}
 	else {
 		/* invalid payload type */
 		receiver->stat.ignored_packets++;
 	}
-	
+
+	mpf_rtp_burst_stat_update(&receiver->stat.burst,lost,discarded);
+	return TRUE;
+}
+
+#ifdef ENABLE_RTP_RECVMMSG
+/** Drain the socket by recvmmsg(), up to RTP_RX_BATCH_SIZE packets per syscall */
+static apt_bool_t rtp_rx_batch_process(mpf_rtp_stream_t *rtp_stream, apr_os_sock_t fd)
+{
+	mpf_jitter_buffer_t *jb = rtp_stream->receiver.jb;
+	void *packets[RTP_RX_BATCH_SIZE];
+	struct iovec iovecs[RTP_RX_BATCH_SIZE];
+	struct mmsghdr msgs[RTP_RX_BATCH_SIZE];
+	apr_size_t batch_count = RTP_RX_MAX_BATCH_COUNT;
+	apr_time_t time;
+	int count = 0;
+	int i;
+
+	memset(msgs,0,sizeof(msgs));
+	for(i=0; i<RTP_RX_BATCH_SIZE; i++) {
+		/* packets are received to the buffers of the jitter buffer, which keeps the audio in place */
+		packets[i] = mpf_jitter_buffer_packet_alloc(jb,MAX_RTP_PACKET_SIZE);
+		iovecs[i].iov_base = packets[i];
+		iovecs[i].iov_len = MAX_RTP_PACKET_SIZE;
+		msgs[i].msg_hdr.msg_iov = &iovecs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while(batch_count) {
+		count = recvmmsg(fd,msgs,RTP_RX_BATCH_SIZE,MSG_DONTWAIT,NULL);
+		if(count <= 0) {
+			break;
+		}
+
+		/* the packets of a batch share the arrival time */
+		time = apt_clock_now();
+		for(i=0; i<count; i++) {
+			rtp_rx_packet_receive(rtp_stream,packets[i],packets[i],msgs[i].msg_len,time);
+			/* the packet stays in use, if its audio has been buffered, replace it */
+			mpf_jitter_buffer_packet_free(jb,packets[i]);
+			packets[i] = mpf_jitter_buffer_packet_alloc(jb,MAX_RTP_PACKET_SIZE);
+			iovecs[i].iov_base = packets[i];
+		}
+
+		if(count < RTP_RX_BATCH_SIZE) {
+			/* drained */
+			break;
+		}
+		batch_count--;
+	}
+
+	for(i=0; i<RTP_RX_BATCH_SIZE; i++) {
+		mpf_jitter_buffer_packet_free(jb,packets[i]);
+	}
 	return TRUE;
 }
+#endif
 
 static apt_bool_t rtp_rx_process(mpf_rtp_stream_t *rtp_stream)
 {
-	char buffer[MAX_RTP_PACKET_SIZE];
-	apr_size_t size = sizeof(buffer);
+	mpf_jitter_buffer_t *jb = rtp_stream->receiver.jb;
+	void *packet;
+	apr_size_t size = MAX_RTP_PACKET_SIZE;
 	apr_size_t max_count = 5;
-	while(max_count && apr_socket_recv(rtp_stream->rtp_socket,buffer,&size) == APR_SUCCESS) {
-		rtp_rx_packet_receive(rtp_stream,buffer,size);
-
-		size = sizeof(buffer);
+	apr_time_t time;
+#ifdef ENABLE_RTP_RECVMMSG
+	apr_os_sock_t fd;
+#endif
+	/* packets are received to the buffers of the jitter buffer, which keeps the audio in place */
+	if(rtp_stream->demux_entry) {
+		/* the queued packets are a batch sharing the arrival time */
+		time = apt_clock_now();
+		apt_bool_t rtcp;
+		packet = mpf_jitter_buffer_packet_alloc(jb,MAX_RTP_PACKET_SIZE);
+		while(mpf_rtp_demux_packet_read(rtp_stream->demux_entry,packet,&size,&rtcp) == TRUE) {
+			if(rtcp == TRUE) {
+				mpf_rtcp_compound_packet_receive(rtp_stream,packet,size);
+			}
+			else {
+				rtp_rx_packet_receive(rtp_stream,packet,packet,size,time);
+				mpf_jitter_buffer_packet_free(jb,packet);
+				packet = mpf_jitter_buffer_packet_alloc(jb,MAX_RTP_PACKET_SIZE);
+			}
+			size = MAX_RTP_PACKET_SIZE;
+		}
+		mpf_jitter_buffer_packet_free(jb,packet);
+		return TRUE;
+	}
+#ifdef ENABLE_RTP_RECVMMSG
+	if(apr_os_sock_get(&fd,rtp_stream->rtp_socket) == APR_SUCCESS) {
+		return rtp_rx_batch_process(rtp_stream,fd);
+	}
+#endif
+	/* the packets pending on the socket are a batch sharing the arrival time */
+	time = apt_clock_now();
+	packet = mpf_jitter_buffer_packet_alloc(jb,MAX_RTP_PACKET_SIZE);
+	while(max_count && apr_socket_recv(rtp_stream->rtp_socket,packet,&size) == APR_SUCCESS) {
+		rtp_rx_packet_receive(rtp_stream,packet,packet,size,time);
+		mpf_jitter_buffer_packet_free(jb,packet);
+		packet = mpf_jitter_buffer_packet_alloc(jb,MAX_RTP_PACKET_SIZE);
+
+		size = MAX_RTP_PACKET_SIZE;
 		max_count--;
 	}
+	mpf_jitter_buffer_packet_free(jb,packet);
 	return TRUE;
 }
 
+static void rtp_rx_demux_add(mpf_rtp_stream_t *rtp_stream)
+{
+	rtp_stream->demux_entry = mpf_rtp_demux_add(
+							rtp_stream->config->demux,
+							rtp_stream->rtp_r_sockaddr,
+							rtp_stream->rtcp_r_sockaddr,
+							rtp_stream->pool);
+}
+
+static void rtp_rx_demux_remove(mpf_rtp_stream_t *rtp_stream)
+{
+	if(rtp_stream->demux_entry) {
+		mpf_rtp_demux_remove(rtp_stream->config->demux,rtp_stream->demux_entry);
+		rtp_stream->demux_entry = NULL;
+	}
+}
+
+static void rtp_rx_poller_handler(void *obj)
+{
+	mpf_rtp_stream_t *rtp_stream = obj;
+	rtp_rx_process(rtp_stream);
+}
+
+static void rtp_rx_poller_remove(mpf_rtp_stream_t *rtp_stream)
+{
+	mpf_termination_t *termination = rtp_stream->base->termination;
+	if(rtp_stream->rtp_poller_entry) {
+		mpf_poller_remove(termination->poller,rtp_stream->rtp_poller_entry);
+		rtp_stream->rtp_poller_entry = NULL;
+	}
+}
+
 static apt_bool_t mpf_rtp_stream_receive(mpf_audio_stream_t *stream, mpf_frame_t *frame)
 {
 	mpf_rtp_stream_t *rtp_stream = stream->obj;
-	rtp_rx_process(rtp_stream);
+	if(!rtp_stream->rtp_poller_entry) {
+		/* not watched by the poller, poll the socket (or the demux queue) on every tick */
+		rtp_rx_process(rtp_stream);
+	}
 
-	return mpf_jitter_buffer_read(rtp_stream->receiver.jb,frame);
+	if(mpf_jitter_buffer_read(rtp_stream->receiver.jb,frame) == FALSE) {
+		return FALSE;
+	}
+	if(stream->recorder) {
+		mpf_flight_recorder_put(stream->recorder,MPF_FLIGHT_FRAME_OUT,(apr_byte_t)frame->marker,0,0,frame->type);
+	}
+	return TRUE;
 }
 
+static apt_bool_t mpf_rtp_stream_ref_receive(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	mpf_rtp_stream_t *rtp_stream = stream->obj;
+	if(!rtp_stream->rtp_poller_entry) {
+		rtp_rx_process(rtp_stream);
+	}
+
+	/* the jitter buffer is written to by rtp_rx_process() only, the slot read stays intact till the next tick */
+	if(mpf_jitter_buffer_ref_read(rtp_stream->receiver.jb,frame) == FALSE) {
+		return FALSE;
+	}
+	if(stream->recorder) {
+		mpf_flight_recorder_put(stream->recorder,MPF_FLIGHT_FRAME_OUT,(apr_byte_t)frame->marker,0,0,frame->type);
+	}
+	return TRUE;
+}
+
+
+static rtp_tx_impairment_t* rtp_tx_impairment_create(const mpf_rtp_impairment_t *config, apr_uint32_t seed, apr_size_t packet_size, apr_pool_t *pool)
+{
+	apr_size_t i;
+	rtp_tx_impairment_t *impairment = apr_palloc(pool,sizeof(rtp_tx_impairment_t));
+	impairment->config = config;
+	impairment->max_delay = config->jitter / CODEC_FRAME_TIME_BASE;
+	/* xorshift must not be seeded with zero */
+	impairment->seed = seed ? seed : 0x9e3779b9;
+	impairment->tick = 0;
+	for(i=0; i<RTP_TX_IMPAIRMENT_SLOTS; i++) {
+		impairment->slots[i].due = 0;
+		impairment->slots[i].size = 0;
+		impairment->slots[i].data = impairment->max_delay ? apr_palloc(pool,packet_size) : NULL;
+	}
+	return impairment;
+}
+
+static APR_INLINE apr_uint32_t rtp_tx_impairment_rand(rtp_tx_impairment_t *impairment)
+{
+	apr_uint32_t x = impairment->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	impairment->seed = x;
+	return x;
+}
 
 static apt_bool_t mpf_rtp_tx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t *codec)
 {
@@ -917,6 +1306,19 @@ static apt_bool_t mpf_rtp_tx_stream_open(mpf_audio_stream_t *stream, mpf_codec_t
 							rtp_stream->pool,
 							sizeof(rtp_header_t) + transmitter->packet_frames * frame_size);
 	
+	transmitter->impairment = NULL;
+	if(rtp_stream->settings &&
+		(rtp_stream->settings->tx_impairment.loss_rate || rtp_stream->settings->tx_impairment.jitter)) {
+		transmitter->impairment = rtp_tx_impairment_create(
+							&rtp_stream->settings->tx_impairment,
+							transmitter->sr_stat.ssrc,
+							sizeof(rtp_header_t) + transmitter->packet_frames * frame_size,
+							rtp_stream->pool);
+		apt_log(MPF_LOG_MARK,APT_PRIO_NOTICE,"Impair RTP Transmitter loss [%.2f%%] jitter [%hu ms]",
+				rtp_stream->settings->tx_impairment.loss_rate / 100.0,
+				rtp_stream->settings->tx_impairment.jitter);
+	}
+
 	transmitter->inactivity = 1;
 	apt_log(MPF_LOG_MARK,APT_PRIO_INFO,"Open RTP Transmitter %s:%hu -> %s:%hu",
 			rtp_stream->rtp_l_sockaddr->hostname,
@@ -960,6 +1362,76 @@ static APR_INLINE void rtp_header_prepare(
 	header->ssrc = htonl(transmitter->sr_stat.ssrc);
 }
 
+static apt_bool_t mpf_rtp_packet_send(mpf_rtp_stream_t *rtp_stream, rtp_transmitter_t *transmitter, const char *data, apr_size_t size)
+{
+	mpf_packet_batch_t *tx_batch = rtp_stream->base->termination->tx_batch;
+	if(tx_batch && size <= MPF_PACKET_BATCH_MAX_PACKET_SIZE) {
+		/* stage the packet to be sent at the end of the tick */
+		void *packet = mpf_packet_batch_packet_get(tx_batch,rtp_stream->rtp_socket,rtp_stream->rtp_r_sockaddr);
+		memcpy(packet,data,size);
+		mpf_packet_batch_packet_commit(tx_batch,size);
+	}
+	else if(apr_socket_sendto(
+				rtp_stream->rtp_socket,
+				rtp_stream->rtp_r_sockaddr,
+				0,
+				data,
+				&size) != APR_SUCCESS) {
+		return FALSE;
+	}
+	transmitter->sr_stat.sent_packets++;
+	transmitter->sr_stat.sent_octets += (apr_uint32_t)size - sizeof(rtp_header_t);
+	return TRUE;
+}
+
+/** Send the packets held back which are due by the current frame tick */
+static void mpf_rtp_delayed_packets_send(mpf_rtp_stream_t *rtp_stream, rtp_transmitter_t *transmitter)
+{
+	rtp_tx_impairment_t *impairment = transmitter->impairment;
+	apr_size_t i;
+	impairment->tick++;
+	if(!impairment->max_delay) {
+		return;
+	}
+	for(i=0; i<RTP_TX_IMPAIRMENT_SLOTS; i++) {
+		rtp_tx_delayed_packet_t *slot = &impairment->slots[i];
+		if(slot->size && (apr_int32_t)(impairment->tick - slot->due) >= 0) {
+			mpf_rtp_packet_send(rtp_stream,transmitter,slot->data,slot->size);
+			slot->size = 0;
+		}
+	}
+}
+
+/** Drop or hold back the packet as configured, otherwise send it */
+static apt_bool_t mpf_rtp_impaired_packet_send(mpf_rtp_stream_t *rtp_stream, rtp_transmitter_t *transmitter, const char *data, apr_size_t size)
+{
+	rtp_tx_impairment_t *impairment = transmitter->impairment;
+	apr_uint32_t delay;
+	apr_size_t i;
+	if(impairment->config->loss_rate && rtp_tx_impairment_rand(impairment) % 10000 < impairment->config->loss_rate) {
+		/* lost on the way, as far as the sender (and its SR) is concerned the packet is sent */
+		transmitter->sr_stat.sent_packets++;
+		transmitter->sr_stat.sent_octets += (apr_uint32_t)size - sizeof(rtp_header_t);
+		return TRUE;
+	}
+	if(impairment->max_delay) {
+		delay = rtp_tx_impairment_rand(impairment) % (impairment->max_delay + 1);
+		if(delay) {
+			for(i=0; i<RTP_TX_IMPAIRMENT_SLOTS; i++) {
+				rtp_tx_delayed_packet_t *slot = &impairment->slots[i];
+				if(!slot->size) {
+					memcpy(slot->data,data,size);
+					slot->size = size;
+					slot->due = impairment->tick + delay;
+					return TRUE;
+				}
+			}
+			/* no free slot, send the packet right away */
+		}
+	}
+	return mpf_rtp_packet_send(rtp_stream,transmitter,data,size);
+}
+
 static APR_INLINE apt_bool_t mpf_rtp_data_send(mpf_rtp_stream_t *rtp_stream, rtp_transmitter_t *transmitter, const mpf_frame_t *frame)
 {
 	apt_bool_t status = TRUE;
@@ -978,17 +1450,11 @@ static APR_INLINE apt_bool_t mpf_rtp_data_send(mpf_rtp_stream_t *rtp_stream, rtp
 			(header->marker == 1) ? '*' : ' ',
 			header->timestamp, transmitter->last_seq_num);
 		header->timestamp = htonl(header->timestamp);
-		if(apr_socket_sendto(
-					rtp_stream->rtp_socket,
-					rtp_stream->rtp_r_sockaddr,
-					0,
-					transmitter->packet_data,
-					&transmitter->packet_size) == APR_SUCCESS) {
-			transmitter->sr_stat.sent_packets++;
-			transmitter->sr_stat.sent_octets += (apr_uint32_t)transmitter->packet_size - sizeof(rtp_header_t);
+		if(transmitter->impairment) {
+			status = mpf_rtp_impaired_packet_send(rtp_stream,transmitter,transmitter->packet_data,transmitter->packet_size);
 		}
 		else {
-			status = FALSE;
+			status = mpf_rtp_packet_send(rtp_stream,transmitter,transmitter->packet_data,transmitter->packet_size);
 		}
 		transmitter->current_frames = 0;
 	}
@@ -999,8 +1465,17 @@ static APR_INLINE apt_bool_t mpf_rtp_event_send(mpf_rtp_stream_t *rtp_stream, rt
 {
 	char packet_data[20];
 	apr_size_t packet_size = sizeof(rtp_header_t) + sizeof(mpf_named_event_frame_t);
-	rtp_header_t *header = (rtp_header_t*) packet_data;
-	mpf_named_event_frame_t *named_event = (mpf_named_event_frame_t*)(header+1);
+	mpf_packet_batch_t *tx_batch = rtp_stream->base->termination->tx_batch;
+	rtp_header_t *header;
+	mpf_named_event_frame_t *named_event;
+	if(tx_batch) {
+		/* compose the packet right in the batch */
+		header = mpf_packet_batch_packet_get(tx_batch,rtp_stream->rtp_socket,rtp_stream->rtp_r_sockaddr);
+	}
+	else {
+		header = (rtp_header_t*) packet_data;
+	}
+	named_event = (mpf_named_event_frame_t*)(header+1);
 	rtp_header_prepare(
 		transmitter,
 		header,
@@ -1021,7 +1496,10 @@ static APR_INLINE apt_bool_t mpf_rtp_event_send(mpf_rtp_stream_t *rtp_stream, rt
 		(named_event->edge == 1) ? '*' : ' ');
 	header->timestamp = htonl(header->timestamp);
 	named_event->duration = htons((apr_uint16_t)named_event->duration);
-	if(apr_socket_sendto(
+	if(tx_batch) {
+		mpf_packet_batch_packet_commit(tx_batch,packet_size);
+	}
+	else if(apr_socket_sendto(
 				rtp_stream->rtp_socket,
 				rtp_stream->rtp_r_sockaddr,
 				0,
@@ -1041,8 +1519,11 @@ static apt_bool_t mpf_rtp_stream_transmit(mpf_audio_stream_t *stream, const mpf_
 	rtp_transmitter_t *transmitter = &rtp_stream->transmitter;
 
 	transmitter->timestamp += transmitter->samples_per_frame;
+	if(transmitter->impairment) {
+		mpf_rtp_delayed_packets_send(rtp_stream,transmitter);
+	}
 
-	if(frame->type == MEDIA_FRAME_TYPE_NONE) {
+	if((frame->type & ~MEDIA_FRAME_TYPE_SILENCE) == MEDIA_FRAME_TYPE_NONE) {
 		if(!transmitter->inactivity) {
 			if(transmitter->current_frames == 0) {
 				/* set inactivity (ptime alligned) */
@@ -1140,6 +1621,18 @@ static apt_bool_t mpf_socket_bind(apr_socket_t *socket, const char *ip, apr_port
 /* Create RTP/RTCP sockets */
 static apt_bool_t mpf_rtp_socket_pair_create(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media, apt_bool_t bind)
 {
+	if(stream->config->demux) {
+		/* use the sockets of the shared port, never closed by the stream */
+		mpf_rtp_demux_sockets_get(
+					stream->config->demux,
+					&stream->rtp_socket,
+					&stream->rtcp_socket,
+					&stream->rtp_l_sockaddr,
+					&stream->rtcp_l_sockaddr);
+		local_media->port = mpf_rtp_demux_port_get(stream->config->demux);
+		return stream->rtp_socket ? TRUE : FALSE;
+	}
+
 	/* Create and optionally bind RTP socket. Return FALSE in case of an error. */
 	if(mpf_socket_create(stream->pool,&stream->rtp_socket) == FALSE) {
 		return FALSE;
@@ -1175,9 +1668,48 @@ static apt_bool_t mpf_rtp_socket_pair_bind(mpf_rtp_stream_t *stream, mpf_rtp_med
 	return TRUE;
 }
 
+/* Create RTP/RTCP sockets and bind them to a port pair taken from the port pool */
+static apt_bool_t mpf_rtp_socket_pair_alloc(mpf_rtp_stream_t *stream, mpf_rtp_media_descriptor_t *local_media)
+{
+	mpf_rtp_config_t *rtp_config = stream->config;
+	apr_size_t attempts = mpf_rtp_port_pool_free_count_get(rtp_config->port_pool);
+	apr_port_t port;
+	if(mpf_rtp_socket_pair_create(stream,local_media,FALSE) == FALSE) {
+		return FALSE;
+	}
+
+	while(attempts-- && (port = mpf_rtp_port_pool_alloc(rtp_config->port_pool)) != 0) {
+		local_media->port = port;
+		if(mpf_rtp_socket_pair_bind(stream,local_media) == TRUE) {
+			stream->pool_port = port;
+			return TRUE;
+		}
+		/* the pair is bound by another process, return it to be retried last */
+		mpf_rtp_port_pool_release(rtp_config->port_pool,port);
+	}
+
+	apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Find Free RTP Port %s:[%hu,%hu]",
+							rtp_config->ip.buf,
+							rtp_config->rtp_port_min,
+							rtp_config->rtp_port_max);
+	mpf_rtp_socket_pair_close(stream);
+	return FALSE;
+}
+
 /* Close RTP/RTCP sockets */
 static void mpf_rtp_socket_pair_close(mpf_rtp_stream_t *stream)
 {
+	rtp_rx_poller_remove(stream);
+	rtp_rx_demux_remove(stream);
+	if(stream->config->demux) {
+		stream->rtp_socket = NULL;
+		stream->rtcp_socket = NULL;
+		return;
+	}
+	if(stream->pool_port) {
+		mpf_rtp_port_pool_release(stream->config->port_pool,stream->pool_port);
+		stream->pool_port = 0;
+	}
 	if(stream->rtp_socket) {
 		apr_socket_close(stream->rtp_socket);
 		stream->rtp_socket = NULL;
@@ -1487,7 +2019,9 @@ static void mpf_rtcp_tx_timer_proc(apt_timer_t *timer, void *obj)
 static void mpf_rtcp_rx_timer_proc(apt_timer_t *timer, void *obj)
 {
 	mpf_rtp_stream_t *rtp_stream = obj;
-	if(rtp_stream->rtcp_socket && rtp_stream->rtcp_l_sockaddr && rtp_stream->rtcp_r_sockaddr) {
+	/* RTCP packets of the shared port are delivered along with RTP ones */
+	if(!rtp_stream->config->demux &&
+		rtp_stream->rtcp_socket && rtp_stream->rtcp_l_sockaddr && rtp_stream->rtcp_r_sockaddr) {
 		char buffer[MAX_RTCP_PACKET_SIZE];
 		apr_size_t length = sizeof(buffer);
 		
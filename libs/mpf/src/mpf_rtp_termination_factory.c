@@ -18,6 +18,8 @@
 #include "mpf_termination.h"
 #include "mpf_rtp_termination_factory.h"
 #include "mpf_rtp_stream.h"
+#include "mpf_rtp_demux.h"
+#include "mpf_rtp_port_pool.h"
 #include "apt_log.h"
 
 typedef struct media_engine_slot_t media_engine_slot_t;
@@ -117,6 +119,26 @@ static mpf_termination_t* mpf_rtp_termination_create(mpf_termination_factory_t *
 	return termination;
 }
 
+/** Create pool of the port pairs of the range, to allocate ports in constant time by */
+static void mpf_rtp_config_port_pool_create(mpf_rtp_config_t *rtp_config, apr_pool_t *pool)
+{
+	if(rtp_config->demux) {
+		/* all the streams share rtp_port_min */
+		rtp_config->port_pool = NULL;
+		return;
+	}
+	rtp_config->port_pool = mpf_rtp_port_pool_create(
+								rtp_config->rtp_port_min,
+								rtp_config->rtp_port_max,
+								rtp_config->rtp_port_random,
+								pool);
+	if(!rtp_config->port_pool) {
+		apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create RTP Port Pool [%hu,%hu]",
+								rtp_config->rtp_port_min,
+								rtp_config->rtp_port_max);
+	}
+}
+
 static apt_bool_t mpf_rtp_factory_engine_assign(mpf_termination_factory_t *termination_factory, mpf_engine_t *media_engine)
 {
 	int i;
@@ -175,10 +197,27 @@ static apt_bool_t mpf_rtp_factory_engine_assign(mpf_termination_factory_t *termi
 		rtp_config = slot->rtp_config;
 		rtp_config->rtp_port_min = rtp_config_prev->rtp_port_max;
 		rtp_config->rtp_port_cur = rtp_config->rtp_port_min;
+
+		/* each media engine owns the pairs of its own range */
+		for(i=0; i<rtp_termination_factory->media_engine_slots->nelts; i++) {
+			slot = &APR_ARRAY_IDX(rtp_termination_factory->media_engine_slots,i,media_engine_slot_t);
+			mpf_rtp_config_port_pool_create(slot->rtp_config,rtp_termination_factory->pool);
+		}
 	}
 	return TRUE;
 }
 
+MPF_DECLARE(apt_bool_t) mpf_rtp_termination_rx_stat_get(
+										const mpf_termination_t *termination,
+										rtp_rx_stat_t *rx_stat,
+										rtcp_xr_voip_stat_t *voip_stat)
+{
+	if(termination->vtable != &rtp_vtable || !termination->audio_stream) {
+		return FALSE;
+	}
+	return mpf_rtp_stream_rx_stat_get(termination->audio_stream,rx_stat,voip_stat);
+}
+
 MPF_DECLARE(mpf_termination_factory_t*) mpf_rtp_termination_factory_create(
 											mpf_rtp_config_t *rtp_config,
 											apr_pool_t *pool)
@@ -188,6 +227,18 @@ MPF_DECLARE(mpf_termination_factory_t*) mpf_rtp_termination_factory_create(
 		return NULL;
 	}
 	rtp_config->rtp_port_cur = rtp_config->rtp_port_min;
+	if(rtp_config->shared_socket_count && !rtp_config->demux) {
+		/* all the streams share rtp_port_min and are told apart by remote address/SSRC */
+		rtp_config->demux = mpf_rtp_demux_create(
+								rtp_config->ip.buf,
+								rtp_config->rtp_port_min,
+								rtp_config->shared_socket_count,
+								pool);
+		if(!rtp_config->demux) {
+			apt_log(MPF_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Shared RTP Port, Fall Back to Port Range");
+		}
+	}
+	mpf_rtp_config_port_pool_create(rtp_config,pool);
 	rtp_termination_factory = apr_palloc(pool,sizeof(rtp_termination_factory_t));
 	rtp_termination_factory->base.create_termination = mpf_rtp_termination_create;
 	rtp_termination_factory->base.assign_engine = mpf_rtp_factory_engine_assign;
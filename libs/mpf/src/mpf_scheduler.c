@@ -14,10 +14,17 @@
  * limitations under the License.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "mpf_scheduler.h"
+#include "apt_clock.h"
 
 #ifdef WIN32
 #define ENABLE_MULTIMEDIA_TIMERS
+#elif defined(__linux__)
+#define ENABLE_MONOTONIC_TIMERS
 #endif
 
 #ifdef ENABLE_MULTIMEDIA_TIMERS
@@ -34,6 +41,19 @@
 #include <apr_thread_proc.h>
 #endif
 
+#ifdef ENABLE_MONOTONIC_TIMERS
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include "apt_log.h"
+
+/** Number of ticks the scheduler may fall behind before it resynchronizes */
+#define MPF_SCHEDULER_MAX_LAG_TICKS 5
+/** Lateness (usec) a tick is counted as late from */
+#define MPF_SCHEDULER_LATE_THRESHOLD 1000
+#endif
+
 
 struct mpf_scheduler_t {
 	apr_pool_t          *pool;
@@ -54,10 +74,35 @@ struct mpf_scheduler_t {
 	apr_thread_t        *thread;
 	apt_bool_t           running;
 #endif
+
+	int                  priority;   /* real-time (SCHED_FIFO) priority, 0 if not used */
+	int                  cpu;        /* CPU to pin the thread to, -1 if not pinned */
+	apt_bool_t           offline;    /* run ticks back-to-back while media is transferred */
+	apt_bool_t           busy;       /* media has been transferred during the current tick */
+	mpf_scheduler_stat_t stat;
 };
 
 static APR_INLINE void mpf_scheduler_init(mpf_scheduler_t *scheduler);
 
+/** Run the callbacks due at the current tick */
+static APR_INLINE void mpf_scheduler_tick(mpf_scheduler_t *scheduler)
+{
+	scheduler->stat.tick_count++;
+	/* the clock is read once per tick, the media processed within the tick takes the time from the cache */
+	apt_clock_update();
+	if(scheduler->media_proc) {
+		scheduler->media_proc(scheduler,scheduler->media_obj);
+	}
+
+	if(scheduler->timer_proc) {
+		scheduler->timer_elapsed_time += scheduler->resolution;
+		if(scheduler->timer_elapsed_time >= scheduler->timer_resolution) {
+			scheduler->timer_elapsed_time = 0;
+			scheduler->timer_proc(scheduler,scheduler->timer_obj);
+		}
+	}
+}
+
 /** Create scheduler */
 MPF_DECLARE(mpf_scheduler_t*) mpf_scheduler_create(apr_pool_t *pool)
 {
@@ -74,6 +119,12 @@ MPF_DECLARE(mpf_scheduler_t*) mpf_scheduler_create(apr_pool_t *pool)
 	scheduler->timer_elapsed_time = 0;
 	scheduler->timer_obj = NULL;
 	scheduler->timer_proc = NULL;
+
+	scheduler->priority = 0;
+	scheduler->cpu = -1;
+	scheduler->offline = FALSE;
+	scheduler->busy = FALSE;
+	memset(&scheduler->stat,0,sizeof(scheduler->stat));
 	return scheduler;
 }
 
@@ -127,6 +178,55 @@ MPF_DECLARE(apt_bool_t) mpf_scheduler_rate_set(
 	return TRUE;
 }
 
+/** Set real-time priority of the scheduler thread */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_priority_set(
+								mpf_scheduler_t *scheduler,
+								int priority)
+{
+	if(priority < 0 || priority > 99) {
+		return FALSE;
+	}
+	scheduler->priority = priority;
+	return TRUE;
+}
+
+/** Pin the scheduler thread to the CPU */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_cpu_affinity_set(
+								mpf_scheduler_t *scheduler,
+								int cpu)
+{
+	if(cpu < -1) {
+		return FALSE;
+	}
+	scheduler->cpu = cpu;
+	return TRUE;
+}
+
+/** Report whether media has been transferred during the current tick */
+MPF_DECLARE(void) mpf_scheduler_tick_busy_set(
+								mpf_scheduler_t *scheduler,
+								apt_bool_t busy)
+{
+	scheduler->busy = busy;
+}
+
+/** Take the busy state of the last tick and reset it */
+static APR_INLINE apt_bool_t mpf_scheduler_busy_take(mpf_scheduler_t *scheduler)
+{
+	apt_bool_t busy = scheduler->busy;
+	scheduler->busy = FALSE;
+	return scheduler->offline == TRUE && busy == TRUE;
+}
+
+/** Get tick statistics */
+MPF_DECLARE(void) mpf_scheduler_stat_get(
+								const mpf_scheduler_t *scheduler,
+								mpf_scheduler_stat_t *stat)
+{
+	/* counters are updated by the scheduler thread only, a slightly stale snapshot is fine */
+	*stat = scheduler->stat;
+}
+
 static APR_INLINE void mpf_scheduler_resolution_set(mpf_scheduler_t *scheduler)
 {
 	if(scheduler->media_resolution) {
@@ -146,20 +246,19 @@ static APR_INLINE void mpf_scheduler_init(mpf_scheduler_t *scheduler)
 	scheduler->timer_id = 0;
 }
 
+/** Set offline mode, not supported by multimedia timers */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_offline_set(
+								mpf_scheduler_t *scheduler,
+								apt_bool_t offline)
+{
+	scheduler->offline = FALSE;
+	return offline == TRUE ? FALSE : TRUE;
+}
+
 static void CALLBACK mm_timer_proc(UINT uID, UINT uMsg, DWORD_PTR dwUser, DWORD_PTR dw1, DWORD_PTR dw2)
 {
 	mpf_scheduler_t *scheduler = (mpf_scheduler_t*) dwUser;
-	if(scheduler->media_proc) {
-		scheduler->media_proc(scheduler,scheduler->media_obj);
-	}
-
-	if(scheduler->timer_proc) {
-		scheduler->timer_elapsed_time += scheduler->resolution;
-		if(scheduler->timer_elapsed_time >= scheduler->timer_resolution) {
-			scheduler->timer_elapsed_time = 0;
-			scheduler->timer_proc(scheduler,scheduler->timer_obj);
-		}
-	}
+	mpf_scheduler_tick(scheduler);
 }
 
 /** Start scheduler */
@@ -194,6 +293,113 @@ static APR_INLINE void mpf_scheduler_init(mpf_scheduler_t *scheduler)
 	scheduler->running = FALSE;
 }
 
+/** Set offline mode */
+MPF_DECLARE(apt_bool_t) mpf_scheduler_offline_set(
+								mpf_scheduler_t *scheduler,
+								apt_bool_t offline)
+{
+	scheduler->offline = offline;
+	return TRUE;
+}
+
+#ifdef ENABLE_MONOTONIC_TIMERS
+
+/** Apply real-time priority and CPU affinity to the calling thread */
+static void mpf_scheduler_thread_setup(mpf_scheduler_t *scheduler)
+{
+	if(scheduler->priority > 0) {
+		struct sched_param param;
+		int rv;
+		memset(&param,0,sizeof(param));
+		param.sched_priority = scheduler->priority;
+		rv = pthread_setschedparam(pthread_self(),SCHED_FIFO,&param);
+		if(rv != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set SCHED_FIFO Priority [%d] errno [%d]",
+				scheduler->priority,rv);
+		}
+	}
+
+	if(scheduler->cpu >= 0) {
+		cpu_set_t cpu_set;
+		CPU_ZERO(&cpu_set);
+		CPU_SET(scheduler->cpu,&cpu_set);
+		if(pthread_setaffinity_np(pthread_self(),sizeof(cpu_set),&cpu_set) != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Pin Scheduler Thread to CPU [%d]",scheduler->cpu);
+		}
+	}
+}
+
+static APR_INLINE void timespec_add_nsec(struct timespec *ts, long nsec)
+{
+	ts->tv_nsec += nsec;
+	while(ts->tv_nsec >= 1000000000L) {
+		ts->tv_nsec -= 1000000000L;
+		ts->tv_sec++;
+	}
+}
+
+static APR_INLINE apr_int64_t timespec_diff_usec(const struct timespec *ts1, const struct timespec *ts2)
+{
+	return (apr_int64_t)(ts1->tv_sec - ts2->tv_sec) * 1000000 + (ts1->tv_nsec - ts2->tv_nsec) / 1000;
+}
+
+/** Sleep until absolute CLOCK_MONOTONIC deadlines, so that ticks never accumulate drift */
+static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
+{
+	mpf_scheduler_t *scheduler = data;
+	long period = (long)scheduler->resolution * 1000000L; /* nsec */
+	struct timespec deadline;
+	struct timespec time_now;
+	apr_int64_t lateness;
+	int rv;
+
+#if APR_HAS_SETTHREADNAME
+	apr_thread_name_set("MPF Scheduler");
+#endif
+	mpf_scheduler_thread_setup(scheduler);
+
+	clock_gettime(CLOCK_MONOTONIC,&deadline);
+	while(scheduler->running == TRUE) {
+		mpf_scheduler_tick(scheduler);
+
+		if(mpf_scheduler_busy_take(scheduler) == TRUE) {
+			/* offline: the next tick follows at once, the clock restarts once media is exhausted */
+			clock_gettime(CLOCK_MONOTONIC,&deadline);
+			continue;
+		}
+
+		timespec_add_nsec(&deadline,period);
+		do {
+			rv = clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&deadline,NULL);
+		}
+		while(rv == EINTR);
+
+		clock_gettime(CLOCK_MONOTONIC,&time_now);
+		lateness = timespec_diff_usec(&time_now,&deadline);
+		if(lateness < 0) {
+			continue;
+		}
+
+		if(lateness >= MPF_SCHEDULER_LATE_THRESHOLD) {
+			scheduler->stat.late_count++;
+		}
+		if((apr_uint32_t)lateness > scheduler->stat.max_lateness) {
+			scheduler->stat.max_lateness = (apr_uint32_t)lateness;
+		}
+		scheduler->stat.total_lateness += lateness;
+		if(lateness >= (apr_int64_t)MPF_SCHEDULER_MAX_LAG_TICKS * period / 1000) {
+			/* fell too far behind (e.g. the process was stopped), do not burst to catch up */
+			scheduler->stat.resync_count++;
+			deadline = time_now;
+		}
+	}
+
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+#else
+
 static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
 {
 	mpf_scheduler_t *scheduler = data;
@@ -208,16 +414,13 @@ static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
 	while(scheduler->running == TRUE) {
 		time_last = time_now;
 
-		if(scheduler->media_proc) {
-			scheduler->media_proc(scheduler,scheduler->media_obj);
-		}
+		mpf_scheduler_tick(scheduler);
 
-		if(scheduler->timer_proc) {
-			scheduler->timer_elapsed_time += scheduler->resolution;
-			if(scheduler->timer_elapsed_time >= scheduler->timer_resolution) {
-				scheduler->timer_elapsed_time = 0;
-				scheduler->timer_proc(scheduler,scheduler->timer_obj);
-			}
+		if(mpf_scheduler_busy_take(scheduler) == TRUE) {
+			/* offline: the next tick follows at once */
+			time_now = apr_time_now();
+			time_drift = 0;
+			continue;
 		}
 
 		if(timeout > time_drift) {
@@ -235,6 +438,8 @@ static void* APR_THREAD_FUNC timer_thread_proc(apr_thread_t *thread, void *data)
 	return NULL;
 }
 
+#endif /* ENABLE_MONOTONIC_TIMERS */
+
 MPF_DECLARE(apt_bool_t) mpf_scheduler_start(mpf_scheduler_t *scheduler)
 {
 	mpf_scheduler_resolution_set(scheduler);
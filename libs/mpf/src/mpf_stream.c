@@ -75,6 +75,7 @@ MPF_DECLARE(mpf_audio_stream_t*) mpf_audio_stream_create(void *obj, const mpf_au
 	stream->rx_event_descriptor = NULL;
 	stream->tx_descriptor = NULL;
 	stream->tx_event_descriptor = NULL;
+	stream->recorder = NULL;
 	return stream;
 }
 
@@ -37,6 +37,27 @@ typedef void (*mrcp_client_handler_f)(apt_bool_t status);
  */
 MRCP_DECLARE(mrcp_client_t*) mrcp_client_create(apt_dir_layout_t *dir_layout);
 
+/**
+ * Set the number of session processing shards.
+ * @param client the MRCP client to set shards for
+ * @param count the number of shards, each shard but the first one is processed by a thread of its own
+ * @remark Sessions are assigned to shards round-robin as they are created and stay on
+ *         the same shard, which processes the application requests, the signaling and
+ *         the connection events and the media responses of the session in order.
+ *         Must be set before the client is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_client_session_shards_set(mrcp_client_t *client, apr_size_t count);
+
+/**
+ * Set the number of application callback threads.
+ * @param client the MRCP client to set callback threads for
+ * @param count the number of threads, 0 to raise the callbacks by the session shards
+ * @remark The callbacks of a session are always raised by the same thread in order,
+ *         but concurrently with the processing of the session by its shard.
+ *         Must be set before the client is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_client_callback_threads_set(mrcp_client_t *client, apr_size_t count);
+
 /**
  * Set asynchronous start mode.
  * @param client the MRCP client to set mode for
@@ -37,6 +37,9 @@ typedef struct rtp_termination_slot_t rtp_termination_slot_t;
 /** MRCP client session declaration */
 typedef struct mrcp_client_session_t mrcp_client_session_t;
 
+/** Session processing shard declaration */
+typedef struct mrcp_client_shard_t mrcp_client_shard_t;
+
 /** Client session states */
 typedef enum {
 	SESSION_STATE_NONE,
@@ -94,6 +97,11 @@ struct mrcp_client_session_t {
 
 	/** Optional session attributes */
 	mrcp_session_attribs_t     *attribs;
+
+	/** Shard the session is processed by */
+	mrcp_client_shard_t        *shard;
+	/** Task the application callbacks are raised by (NULL, if raised by the shard) */
+	apt_task_t                 *callback_task;
 };
 
 /** MRCP channel */
@@ -16,6 +16,7 @@
 
 #include <apr_thread_cond.h>
 #include <apr_hash.h>
+#include <apr_atomic.h>
 #include "mrcp_client.h"
 #include "mrcp_sig_agent.h"
 #include "mrcp_client_session.h"
@@ -27,6 +28,23 @@
 #include "apt_log.h"
 
 #define CLIENT_TASK_NAME "MRCP Client"
+#define SHARD_TASK_NAME "MRCP Client Shard"
+#define CALLBACK_TASK_NAME "MRCP Client Callback"
+
+/** Max number of session processing shards */
+#define MRCP_CLIENT_MAX_SHARD_COUNT    64
+/** Max number of application callback threads */
+#define MRCP_CLIENT_MAX_CALLBACK_COUNT 64
+
+/** Session processing shard */
+struct mrcp_client_shard_t {
+	/** Message processing task (the main task of the client for the first shard) */
+	apt_consumer_task_t *task;
+	/** Table of sessions/handles processed by the shard (accessed in the shard task context only) */
+	apr_hash_t          *session_table;
+	/** Index of the shard */
+	apr_size_t           index;
+};
 
 /** MRCP client */
 struct mrcp_client_t {
@@ -55,8 +73,18 @@ struct mrcp_client_t {
 	/** Table of applications (mrcp_application_t*) */
 	apr_hash_t              *app_table;
 
-	/** Table of sessions/handles */
-	apr_hash_t              *session_table;
+	/** Array of session processing shards */
+	mrcp_client_shard_t     *shards;
+	/** Number of shards */
+	apr_size_t               shard_count;
+	/** Array of application callback tasks (apt_consumer_task_t*) */
+	apt_consumer_task_t    **callbacks;
+	/** Number of application callback tasks, the callbacks are raised by the shards if none */
+	apr_size_t               callback_count;
+	/** Number of sessions created, to distribute them across the shards and the callback tasks */
+	volatile apr_uint32_t    session_seq;
+	/** Shard task message pool (used to pass MPF messages on to shards) */
+	apt_task_msg_pool_t     *shard_msg_pool;
 
 	/** Connection task message pool */
 	apt_task_msg_pool_t     *cnt_msg_pool;
@@ -79,7 +107,8 @@ typedef enum {
 	MRCP_CLIENT_SIGNALING_TASK_MSG = TASK_MSG_USER,
 	MRCP_CLIENT_CONNECTION_TASK_MSG,
 	MRCP_CLIENT_MEDIA_TASK_MSG,
-	MRCP_CLIENT_APPLICATION_TASK_MSG
+	MRCP_CLIENT_APPLICATION_TASK_MSG,
+	MRCP_CLIENT_CALLBACK_TASK_MSG
 } mrcp_client_task_msg_type_e;
 
 /* Signaling agent interface */
@@ -151,6 +180,8 @@ static const mrcp_connection_event_vtable_t connection_method_vtable = {
 static void mrcp_client_on_start_complete(apt_task_t *task);
 static void mrcp_client_on_terminate_complete(apt_task_t *task);
 static apt_bool_t mrcp_client_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+static apt_bool_t mrcp_client_session_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+static apt_bool_t mrcp_client_callback_msg_process(apt_task_t *task, apt_task_msg_t *msg);
 
 
 /** Create MRCP client instance */
@@ -180,7 +211,12 @@ MRCP_DECLARE(mrcp_client_t*) mrcp_client_create(apt_dir_layout_t *dir_layout)
 	client->rtp_settings_table = NULL;
 	client->profile_table = NULL;
 	client->app_table = NULL;
-	client->session_table = NULL;
+	client->shards = NULL;
+	client->shard_count = 0;
+	client->callbacks = NULL;
+	client->callback_count = 0;
+	client->session_seq = 0;
+	client->shard_msg_pool = NULL;
 	client->cnt_msg_pool = NULL;
 
 	msg_pool = apt_task_msg_pool_create_dynamic(0,pool);
@@ -206,8 +242,14 @@ MRCP_DECLARE(mrcp_client_t*) mrcp_client_create(apt_dir_layout_t *dir_layout)
 	client->rtp_settings_table = apr_hash_make(client->pool);
 	client->profile_table = apr_hash_make(client->pool);
 	client->app_table = apr_hash_make(client->pool);
-	
-	client->session_table = apr_hash_make(client->pool);
+
+	/* sessions are processed by the main task, unless more shards are set */
+	client->shard_msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mpf_message_container_t),pool);
+	client->shards = apr_palloc(client->pool,sizeof(mrcp_client_shard_t));
+	client->shards[0].task = client->task;
+	client->shards[0].session_table = apr_hash_make(client->pool);
+	client->shards[0].index = 0;
+	client->shard_count = 1;
 
 	client->on_start_complete = NULL;
 	client->sync_start_object = NULL;
@@ -215,6 +257,92 @@ MRCP_DECLARE(mrcp_client_t*) mrcp_client_create(apt_dir_layout_t *dir_layout)
 	return client;
 }
 
+/** Set the number of session processing shards */
+MRCP_DECLARE(apt_bool_t) mrcp_client_session_shards_set(mrcp_client_t *client, apr_size_t count)
+{
+	mrcp_client_shard_t *shards;
+	mrcp_client_shard_t *shard;
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	apr_size_t i;
+	if(!client || !client->task || client->shard_count != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set Session Shards");
+		return FALSE;
+	}
+	if(count <= 1) {
+		return TRUE;
+	}
+	if(count > MRCP_CLIENT_MAX_SHARD_COUNT) {
+		count = MRCP_CLIENT_MAX_SHARD_COUNT;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Session Shards [%"APR_SIZE_T_FMT"]",count);
+	shards = apr_palloc(client->pool,sizeof(mrcp_client_shard_t) * count);
+	shards[0] = client->shards[0];
+	for(i=1; i<count; i++) {
+		shard = &shards[i];
+		shard->index = i;
+		shard->session_table = apr_hash_make(client->pool);
+		msg_pool = apt_task_msg_pool_create_dynamic(0,client->pool);
+		shard->task = apt_consumer_task_create(client,msg_pool,client->pool);
+		if(!shard->task) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Shard Task [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		task = apt_consumer_task_base_get(shard->task);
+		apt_task_name_set(task,apr_psprintf(client->pool,SHARD_TASK_NAME"-%"APR_SIZE_T_FMT,i));
+		vtable = apt_task_vtable_get(task);
+		if(vtable) {
+			vtable->process_msg = mrcp_client_session_msg_process;
+		}
+		/* shards are started and terminated along with the main task */
+		apt_task_add(apt_consumer_task_base_get(client->task),task);
+	}
+	client->shards = shards;
+	client->shard_count = count;
+	return TRUE;
+}
+
+/** Set the number of application callback threads */
+MRCP_DECLARE(apt_bool_t) mrcp_client_callback_threads_set(mrcp_client_t *client, apr_size_t count)
+{
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	apr_size_t i;
+	if(!client || !client->task || client->callback_count) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set Callback Threads");
+		return FALSE;
+	}
+	if(!count) {
+		return TRUE;
+	}
+	if(count > MRCP_CLIENT_MAX_CALLBACK_COUNT) {
+		count = MRCP_CLIENT_MAX_CALLBACK_COUNT;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Callback Threads [%"APR_SIZE_T_FMT"]",count);
+	client->callbacks = apr_palloc(client->pool,sizeof(apt_consumer_task_t*) * count);
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mrcp_app_message_t*),client->pool);
+	for(i=0; i<count; i++) {
+		client->callbacks[i] = apt_consumer_task_create(client,msg_pool,client->pool);
+		if(!client->callbacks[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Callback Task [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		task = apt_consumer_task_base_get(client->callbacks[i]);
+		apt_task_name_set(task,apr_psprintf(client->pool,CALLBACK_TASK_NAME"-%"APR_SIZE_T_FMT,i));
+		vtable = apt_task_vtable_get(task);
+		if(vtable) {
+			vtable->process_msg = mrcp_client_callback_msg_process;
+		}
+		apt_task_add(apt_consumer_task_base_get(client->task),task);
+		client->callback_count++;
+	}
+	return TRUE;
+}
+
 /** Set asynchronous start mode */
 MRCP_DECLARE(void) mrcp_client_async_start_set(mrcp_client_t *client, mrcp_client_handler_f handler)
 {
@@ -276,7 +404,6 @@ MRCP_DECLARE(apt_bool_t) mrcp_client_shutdown(mrcp_client_t *client)
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Shutdown Client Task");
 		return FALSE;
 	}
-	client->session_table = NULL;
 
 	if(client->sync_start_object) {
 		apr_thread_cond_destroy(client->sync_start_object);
@@ -664,12 +791,21 @@ MRCP_DECLARE(apt_dir_layout_t*) mrcp_client_dir_layout_get(const mrcp_client_t *
 
 mrcp_client_session_t* mrcp_client_session_create_ex(mrcp_client_t *client, apt_bool_t take_ownership, apr_pool_t *pool)
 {
+	apr_uint32_t seq;
 	mrcp_client_session_t *session = (mrcp_client_session_t*) mrcp_session_create_ex(pool,take_ownership,sizeof(mrcp_client_session_t)-sizeof(mrcp_session_t));
 
 	session->base.name = apr_psprintf(pool,"0x%pp",session);
 	session->base.response_vtable = &session_response_vtable;
 	session->base.event_vtable = &session_event_vtable;
 
+	/* the session stays on the same shard and the same callback task for its lifetime */
+	seq = apr_atomic_inc32(&client->session_seq);
+	session->shard = &client->shards[seq % client->shard_count];
+	session->callback_task = NULL;
+	if(client->callback_count) {
+		session->callback_task = apt_consumer_task_base_get(client->callbacks[seq % client->callback_count]);
+	}
+
 	session->application = NULL;
 	session->app_obj = NULL;
 	session->profile = NULL;
@@ -697,7 +833,7 @@ void mrcp_client_session_add(mrcp_client_t *client, mrcp_client_session_t *sessi
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,session->base.log_obj,"Add MRCP Handle " APT_NAMESID_FMT,
 			session->base.name,
 			MRCP_SESSION_SID(&session->base));
-		apr_hash_set(client->session_table,session,sizeof(void*),session);
+		apr_hash_set(session->shard->session_table,session,sizeof(void*),session);
 	}
 }
 
@@ -707,10 +843,26 @@ void mrcp_client_session_remove(mrcp_client_t *client, mrcp_client_session_t *se
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,session->base.log_obj,"Remove MRCP Handle " APT_NAMESID_FMT,
 			session->base.name,
 			MRCP_SESSION_SID(&session->base));
-		apr_hash_set(client->session_table,session,sizeof(void*),NULL);
+		apr_hash_set(session->shard->session_table,session,sizeof(void*),NULL);
 	}
 }
 
+/** Raise application message, either by the shard of the session or by its callback task */
+apt_bool_t mrcp_client_app_message_raise(mrcp_client_session_t *session, mrcp_app_message_t *app_message)
+{
+	apt_task_msg_t *task_msg;
+	if(!session->callback_task) {
+		return session->application->handler(app_message);
+	}
+	task_msg = apt_task_msg_acquire(session->application->msg_pool);
+	if(!task_msg) {
+		return FALSE;
+	}
+	task_msg->type = MRCP_CLIENT_CALLBACK_TASK_MSG;
+	*((mrcp_app_message_t**)task_msg->data) = app_message;
+	return apt_task_msg_signal(session->callback_task,task_msg);
+}
+
 static void mrcp_client_on_start_complete(apt_task_t *task)
 {
 	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
@@ -742,6 +894,27 @@ static apt_bool_t mrcp_client_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	if(!client) {
 		return FALSE;
 	}
+	if(msg->type == MRCP_CLIENT_MEDIA_TASK_MSG && client->shard_count > 1) {
+		/* MPF messages are sent to the main task, pass them on to the shard of the session */
+		mpf_message_container_t *mpf_message_container = (mpf_message_container_t*) msg->data;
+		mrcp_client_session_t *session = NULL;
+		if(mpf_message_container->count && mpf_message_container->messages[0].context) {
+			session = mpf_engine_context_object_get(mpf_message_container->messages[0].context);
+		}
+		if(session && session->shard && session->shard->index) {
+			apt_task_msg_t *task_msg = apt_task_msg_acquire(client->shard_msg_pool);
+			task_msg->type = msg->type;
+			task_msg->sub_type = msg->sub_type;
+			memcpy(task_msg->data,mpf_message_container,sizeof(mpf_message_container_t));
+			return apt_task_msg_signal(apt_consumer_task_base_get(session->shard->task),task_msg);
+		}
+	}
+	return mrcp_client_session_msg_process(task,msg);
+}
+
+/** Process session related message (in the context of the shard of the session) */
+static apt_bool_t mrcp_client_session_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
 	switch(msg->type) {
 		case MRCP_CLIENT_SIGNALING_TASK_MSG:
 		{
@@ -812,11 +985,28 @@ static apt_bool_t mrcp_client_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 	return TRUE;
 }
 
+/** Raise application message (in the context of a callback task) */
+static apt_bool_t mrcp_client_callback_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	mrcp_app_message_t **app_message = (mrcp_app_message_t**) msg->data;
+	if(msg->type != MRCP_CLIENT_CALLBACK_TASK_MSG || !*app_message) {
+		return FALSE;
+	}
+	(*app_message)->application->handler(*app_message);
+	return TRUE;
+}
+
+/** Get the task of the shard the session is processed by */
+static APR_INLINE apt_task_t* mrcp_client_session_task_get(mrcp_client_session_t *session)
+{
+	return apt_consumer_task_base_get(session->shard->task);
+}
+
 apt_bool_t mrcp_app_signaling_task_msg_signal(mrcp_sig_command_e command_id, mrcp_session_t *session, mrcp_channel_t *channel)
 {
 	mrcp_client_session_t *client_session = (mrcp_client_session_t*)session;
 	mrcp_application_t *application = client_session->application;
-	apt_task_t *task = apt_consumer_task_base_get(application->client->task);
+	apt_task_t *task = mrcp_client_session_task_get(client_session);
 	apt_task_msg_t *task_msg = apt_task_msg_acquire(application->msg_pool);
 	if(task_msg) {
 		mrcp_app_message_t **slot = ((mrcp_app_message_t**)task_msg->data);
@@ -839,7 +1029,7 @@ apt_bool_t mrcp_app_control_task_msg_signal(mrcp_session_t *session, mrcp_channe
 {
 	mrcp_client_session_t *client_session = (mrcp_client_session_t*)session;
 	mrcp_application_t *application = client_session->application;
-	apt_task_t *task = apt_consumer_task_base_get(application->client->task);
+	apt_task_t *task = mrcp_client_session_task_get(client_session);
 	apt_task_msg_t *task_msg = apt_task_msg_acquire(application->msg_pool);
 	if(task_msg) {
 		mrcp_app_message_t **slot = ((mrcp_app_message_t**)task_msg->data);
@@ -868,7 +1058,7 @@ static apt_bool_t mrcp_client_signaling_task_msg_signal(sig_agent_task_msg_type_
 		data->session = (mrcp_client_session_t*)session;
 		data->descriptor = descriptor;
 		data->message = message;
-		return apt_task_msg_parent_signal(session->signaling_agent->task,task_msg);
+		return apt_task_msg_signal(mrcp_client_session_task_get((mrcp_client_session_t*)session),task_msg);
 	}
 	return FALSE;
 }
@@ -884,17 +1074,21 @@ static apt_bool_t mrcp_client_connection_task_msg_signal(
 	apt_task_t *task;
 	apt_task_msg_t *task_msg;
 	connection_agent_task_msg_data_t *data;
+	mrcp_channel_t *mrcp_channel = channel ? channel->obj : NULL;
 	mrcp_client_t *client = mrcp_client_connection_agent_object_get(agent);
 	if(!client || !client->cnt_msg_pool) {
 		return FALSE;
 	}
 	task = apt_consumer_task_base_get(client->task);
+	if(mrcp_channel && mrcp_channel->session) {
+		task = mrcp_client_session_task_get((mrcp_client_session_t*)mrcp_channel->session);
+	}
 	task_msg = apt_task_msg_acquire(client->cnt_msg_pool);
 	if(task_msg) {
 		task_msg->type = MRCP_CLIENT_CONNECTION_TASK_MSG;
 		task_msg->sub_type = type;
 		data = (connection_agent_task_msg_data_t*) task_msg->data;
-		data->channel = channel ? channel->obj : NULL;
+		data->channel = mrcp_channel;
 		data->descriptor = descriptor;
 		data->message = message;
 		data->status = status;
@@ -41,6 +41,7 @@
 
 void mrcp_client_session_add(mrcp_client_t *client, mrcp_client_session_t *session);
 void mrcp_client_session_remove(mrcp_client_t *client, mrcp_client_session_t *session);
+apt_bool_t mrcp_client_app_message_raise(mrcp_client_session_t *session, mrcp_app_message_t *app_message);
 
 static apt_bool_t mrcp_client_session_offer_send(mrcp_client_session_t *session);
 
@@ -276,7 +277,7 @@ apt_bool_t mrcp_client_session_discover_response_process(mrcp_client_session_t *
 		response->descriptor = session->answer;
 		session->answer = NULL;
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Raise App Resource Discovery Response %s", session->base.name);
-		session->application->handler(response);
+		mrcp_client_app_message_raise(session,response);
 
 		session->active_request = apt_list_pop_front(session->request_queue);
 		if(session->active_request) {
@@ -455,7 +456,7 @@ static apt_bool_t mrcp_app_sig_response_raise(mrcp_client_session_t *session, ap
 		response->sig_message.command_id,
 		session->status == MRCP_SIG_STATUS_CODE_SUCCESS ? "SUCCESS" : "FAILURE",
 		session->status);
-	session->application->handler(response);
+	mrcp_client_app_message_raise(session,response);
 
 	if(process_pending_requests) {
 		session->active_request = apt_list_pop_front(session->request_queue);
@@ -479,7 +480,7 @@ static apt_bool_t mrcp_app_sig_event_raise(mrcp_client_session_t *session, mrcp_
 	apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,session->base.log_obj,"Raise App Event " APT_NAMESID_FMT " [%d]", 
 		MRCP_SESSION_NAMESID(session),
 		app_event->sig_message.event_id);
-	return session->application->handler(app_event);
+	return mrcp_client_app_message_raise(session,app_event);
 }
 
 static apt_bool_t mrcp_app_control_message_raise(mrcp_client_session_t *session, mrcp_channel_t *channel, mrcp_message_t *mrcp_message)
@@ -497,7 +498,7 @@ static apt_bool_t mrcp_app_control_message_raise(mrcp_client_session_t *session,
 		response->control_message = mrcp_message;
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,session->base.log_obj,"Raise App MRCP Response " APT_NAMESID_FMT, 
 			MRCP_SESSION_NAMESID(session));
-		session->application->handler(response);
+		mrcp_client_app_message_raise(session,response);
 
 		session->active_request = apt_list_pop_front(session->request_queue);
 		if(session->active_request) {
@@ -513,7 +514,7 @@ static apt_bool_t mrcp_app_control_message_raise(mrcp_client_session_t *session,
 		app_message->channel = channel;
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,session->base.log_obj,"Raise App MRCP Event " APT_NAMESID_FMT, 
 			MRCP_SESSION_NAMESID(session));
-		session->application->handler(app_message);
+		mrcp_client_app_message_raise(session,app_message);
 	}
 	return TRUE;
 }
@@ -541,7 +542,7 @@ static apt_bool_t mrcp_app_failure_message_raise(mrcp_client_session_t *session)
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,session->base.log_obj,"Raise App MRCP Response " APT_NAMESID_FMT, 
 			MRCP_SESSION_NAMESID(session));
 	}
-	session->application->handler(response);
+	mrcp_client_app_message_raise(session,response);
 	return TRUE;
 }
 
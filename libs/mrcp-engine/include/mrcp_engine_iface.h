@@ -23,6 +23,8 @@
  */ 
 
 #include "mrcp_engine_types.h"
+#include "mrcp_message.h"
+#include "apt_probe.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -71,12 +73,26 @@ static APR_INLINE apt_bool_t mrcp_engine_channel_virtual_close(mrcp_engine_chann
 /** Process request */
 static APR_INLINE apt_bool_t mrcp_engine_channel_request_process(mrcp_engine_channel_t *channel, mrcp_message_t *message)
 {
+	APT_PROBE4(engine_request,
+		channel->id.buf,
+		message->start_line.method_id,
+		message->start_line.request_id,
+		message->body.length);
 	return channel->method_vtable->process_request(channel,message);
 }
 
 /** Allocate engine config */
 mrcp_engine_config_t* mrcp_engine_config_alloc(apr_pool_t *pool);
 
+/** Parse engine params of the config once and index them by name (to be called before the engine is open) */
+apt_bool_t mrcp_engine_config_params_index(mrcp_engine_config_t *config, apr_pool_t *pool);
+
+/** Parse engine param value */
+void mrcp_engine_param_parse(mrcp_engine_param_t *param, const char *value);
+
+/** Lowercase param name to look it up in the index by, FALSE if it is too long */
+apt_bool_t mrcp_engine_param_key_get(const char *name, char *key, apr_size_t size);
+
 /** Allocate engine profile settings */
 mrcp_engine_settings_t* mrcp_engine_settings_alloc(apr_pool_t *pool);
 
@@ -23,7 +23,10 @@
  */ 
 
 #include "mrcp_engine_types.h"
+#include "mrcp_message.h"
 #include "mpf_stream.h"
+#include "apt_task.h"
+#include "apt_probe.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -53,6 +56,54 @@ const mrcp_engine_config_t* mrcp_engine_config_get(const mrcp_engine_t *engine);
 /** Get engine param by name */
 const char* mrcp_engine_param_get(const mrcp_engine_t *engine, const char *name);
 
+/**
+ * Look engine param up once, to read its pre-parsed values directly afterwards (e.g. per request).
+ * @param engine the engine to get the param of
+ * @param name the name of the param
+ * @return the param, NULL if it is not set or the engine is not open yet
+ * @remark The param is immutable and lives as long as the engine.
+ */
+const mrcp_engine_param_t* mrcp_engine_param_lookup(const mrcp_engine_t *engine, const char *name);
+
+/**
+ * Get integer engine param.
+ * @return FALSE if the param is not set or is not a decimal number, the value is then left intact
+ */
+apt_bool_t mrcp_engine_param_int_get(const mrcp_engine_t *engine, const char *name, long *value);
+
+/**
+ * Get real engine param.
+ * @return FALSE if the param is not set or is not a number, the value is then left intact
+ */
+apt_bool_t mrcp_engine_param_float_get(const mrcp_engine_t *engine, const char *name, float *value);
+
+/**
+ * Get duration engine param in msec, given in msec or with a unit ("500ms", "2s", "1m").
+ * @return FALSE if the param is not set or is not a duration, the value is then left intact
+ */
+apt_bool_t mrcp_engine_param_duration_get(const mrcp_engine_t *engine, const char *name, apr_size_t *value);
+
+/**
+ * Get boolean engine param.
+ * @param engine the engine to get the param of
+ * @param name the name of the param
+ * @param value the value to set, left intact unless the param is "true" or "false"
+ * @return FALSE if the param is not set or is not boolean
+ */
+apt_bool_t mrcp_engine_param_bool_get(const mrcp_engine_t *engine, const char *name, apt_bool_t *value);
+
+/**
+ * Get non-negative integer engine param.
+ * @param engine the engine to get the param of
+ * @param name the name of the param
+ * @param value the value to set, left intact unless the param is a non-negative decimal number
+ * @return FALSE if the param is not set or is not a non-negative decimal number
+ */
+apt_bool_t mrcp_engine_param_size_get(const mrcp_engine_t *engine, const char *name, apr_size_t *value);
+
+/** Apply CPU affinity and priority of engine config to the task (to be called before the task is started) */
+apt_bool_t mrcp_engine_task_config_apply(const mrcp_engine_t *engine, apt_task_t *task);
+
 
 /** Create engine channel */
 mrcp_engine_channel_t* mrcp_engine_channel_create(
@@ -106,6 +157,13 @@ static APR_INLINE apt_bool_t mrcp_engine_channel_close_respond(mrcp_engine_chann
 /** Send response/event message */
 static APR_INLINE apt_bool_t mrcp_engine_channel_message_send(mrcp_engine_channel_t *channel, mrcp_message_t *message)
 {
+	/* message type tells a response from an event */
+	APT_PROBE5(engine_message,
+		channel->id.buf,
+		message->start_line.message_type,
+		message->start_line.method_id,
+		message->start_line.request_id,
+		message->body.length);
 	return channel->event_vtable->on_message(channel,message);
 }
 
@@ -121,6 +179,21 @@ static APR_INLINE mrcp_version_e mrcp_engine_channel_version_get(const mrcp_engi
 	return channel->mrcp_version;
 }
 
+/**
+ * Charge memory held on behalf of channel to the accounts of its session and engine (any thread).
+ * @param channel the channel to charge memory to
+ * @param size the number of bytes allocated
+ * @return FALSE if the cap of the session, the server or the engine would be exceeded,
+ *         the allocation is then to be undone and the request failed
+ */
+apt_bool_t mrcp_engine_channel_mem_charge(mrcp_engine_channel_t *channel, apr_size_t size);
+
+/**
+ * Uncharge memory charged on behalf of channel before (any thread).
+ * @remark The bytes left charged are uncharged once the channel is destroyed.
+ */
+void mrcp_engine_channel_mem_uncharge(mrcp_engine_channel_t *channel, apr_size_t size);
+
 /** Get codec descriptor of the audio source stream */
 const mpf_codec_descriptor_t* mrcp_engine_source_stream_codec_get(const mrcp_engine_channel_t *channel);
 
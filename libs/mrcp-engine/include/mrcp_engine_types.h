@@ -24,9 +24,13 @@
 
 #include <apr_tables.h>
 #include <apr_hash.h>
+#include <apr_time.h>
 #include "mrcp_state_machine.h"
 #include "mpf_types.h"
 #include "apt_string.h"
+#include "apt_histogram.h"
+#include "apt_log.h"
+#include "apt_mem_account.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -34,6 +38,8 @@ APT_BEGIN_EXTERN_C
 typedef struct mrcp_engine_t mrcp_engine_t;
 /** MRCP engine config declaration */
 typedef struct mrcp_engine_config_t mrcp_engine_config_t;
+/** Forward declaration of MRCP engine param */
+typedef struct mrcp_engine_param_t mrcp_engine_param_t;
 /** MRCP engine profile settings declaration */
 typedef struct mrcp_engine_settings_t mrcp_engine_settings_t;
 /** MRCP engine vtable declaration */
@@ -93,6 +99,16 @@ struct mrcp_engine_channel_t {
 	apr_pool_t                                *pool;
 	/** Name/value attributes */
 	apr_table_t                               *attribs;
+	/** NUMA node media of the channel is processed on (APT_NUMA_NODE_NONE if unknown), set before open */
+	int                                        numa_node;
+	/** CPU media of the channel is processed on (-1 if unpinned or unknown), set before open */
+	int                                        cpu;
+	/** Max priority of log entries of the channel, that of its session, set before open */
+	apt_log_priority_e                         log_priority;
+	/** Memory account of the session of the channel, set before open (NULL if not accounted) */
+	apt_mem_account_t                         *mem_account;
+	/** Number of bytes charged on behalf of the channel and not uncharged yet */
+	volatile apr_uint32_t                      mem_charged;
 };
 
 /** Table of MRCP engine virtual methods */
@@ -136,9 +152,21 @@ struct mrcp_engine_t {
 	/** Config of engine */
 	mrcp_engine_config_t              *config;
 	/** Number of simultaneous channels currently in use */
-	apr_size_t                         cur_channel_count;
+	volatile apr_uint32_t              cur_channel_count;
+	/** Number of jobs queued to the threads of the engine, but not taken yet */
+	volatile apr_uint32_t              backlog;
+	/** Real-time factor (permille) of the media processed by the engine (NULL if not measured) */
+	apt_histogram_t                   *rtf_histogram;
+	/** Number of channels currently processed by cheaper settings, as the engine falls behind real time */
+	volatile apr_uint32_t              degraded_channel_count;
+	/** Number of times channels are switched to cheaper settings */
+	volatile apr_uint32_t              degradation_count;
+	/** Memory held on behalf of the channels of the engine (created on open) */
+	apt_mem_account_t                 *mem_account;
 	/** Is engine successfully opened */
 	apt_bool_t                         is_open;
+	/** Time the engine is requested to open at */
+	apr_time_t                         open_time;
 	/** Pool to allocate memory from */
 	apr_pool_t                        *pool;
 
@@ -150,8 +178,38 @@ struct mrcp_engine_t {
 struct mrcp_engine_config_t {
 	/** Max number of simultaneous channels */
 	apr_size_t   max_channel_count;
+	/** Max size of memory held on behalf of the channels (0 - unlimited) */
+	apr_size_t   max_memory_size;
 	/** Table of name/value string params */
 	apr_table_t *params;
+	/** Params (mrcp_engine_param_t*) parsed once and indexed by lowercase name (NULL if not indexed) */
+	apr_hash_t  *param_index;
+	/** CPUs to pin the engine threads to (NULL if not set) */
+	const char  *cpu_set;
+	/** Real-time priority of the engine threads (0 if not set) */
+	int          priority;
+};
+
+/** MRCP engine param, parsed once the config is loaded */
+struct mrcp_engine_param_t {
+	/** String value */
+	const char  *value;
+	/** Integer value, if the value is a decimal number */
+	apr_int64_t  number;
+	/** Whether the value is a decimal number */
+	apt_bool_t   is_number;
+	/** Real value, if the value is a decimal (fractional) number */
+	double       real;
+	/** Whether the value is a decimal (fractional) number */
+	apt_bool_t   is_real;
+	/** Duration in msec, if the value is msec or a number with a unit ("ms", "s", "m") */
+	apr_int64_t  duration;
+	/** Whether the value is a duration */
+	apt_bool_t   is_duration;
+	/** Whether the value is boolean ("true" or "false") */
+	apt_bool_t   is_bool;
+	/** Boolean value, if the value is boolean */
+	apt_bool_t   bool_value;
 };
 
 /** MRCP engine profile settings */
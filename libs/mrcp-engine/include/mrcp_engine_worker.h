@@ -0,0 +1,112 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_ENGINE_WORKER_H
+#define MRCP_ENGINE_WORKER_H
+
+/**
+ * @file mrcp_engine_worker.h
+ * @brief Worker Threads of Engines
+ *
+ * Jobs of an engine are processed by a fixed number of threads shared by
+ * all its channels. Jobs are posted to strands, typically one per channel:
+ * the jobs of a strand are processed in order, by one thread at a time, so
+ * that the state of the channel needs no locking, while the jobs of other
+ * strands are processed in parallel. A strand queues up to the number of
+ * jobs it is created for, posting allocates no memory. Timers post their
+ * job to the strand on expiry.
+ */
+
+#include "mrcp_engine_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque engine worker declaration */
+typedef struct mrcp_engine_worker_t mrcp_engine_worker_t;
+/** Opaque strand declaration */
+typedef struct mrcp_engine_strand_t mrcp_engine_strand_t;
+/** Opaque timer declaration */
+typedef struct mrcp_engine_timer_t mrcp_engine_timer_t;
+
+/**
+ * Function called to process job of a strand (worker thread).
+ * @param obj the object the strand is created for
+ * @param type the type of the job
+ * @param data the data of the job
+ */
+typedef void (*mrcp_engine_job_f)(void *obj, int type, void *data);
+
+/**
+ * Create engine worker.
+ * @param thread_count the number of threads to process jobs by
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_engine_worker_t*) mrcp_engine_worker_create(apr_size_t thread_count, apr_pool_t *pool);
+
+/** Destroy engine worker, queued jobs are abandoned, all the strands must be destroyed beforehand */
+MRCP_DECLARE(void) mrcp_engine_worker_destroy(mrcp_engine_worker_t *worker);
+
+/**
+ * Create strand.
+ * @param worker the worker to process the jobs of the strand by
+ * @param capacity the max number of jobs queued
+ * @param handler the function to process jobs by
+ * @param obj the object to pass to the function
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_engine_strand_t*) mrcp_engine_strand_create(
+										mrcp_engine_worker_t *worker,
+										apr_size_t capacity,
+										mrcp_engine_job_f handler,
+										void *obj,
+										apr_pool_t *pool);
+
+/**
+ * Destroy strand, queued jobs are abandoned and its timers are killed.
+ * @remark The job in progress, if any, is waited for, hence the strand must not be destroyed by its own job.
+ */
+MRCP_DECLARE(void) mrcp_engine_strand_destroy(mrcp_engine_strand_t *strand);
+
+/**
+ * Post job to strand (any thread).
+ * @param strand the strand to process the job by
+ * @param type the type of the job
+ * @param data the data of the job
+ * @return FALSE if the strand is full
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_engine_strand_post(mrcp_engine_strand_t *strand, int type, void *data);
+
+/**
+ * Create timer.
+ * @param strand the strand to post the job to on expiry
+ * @param type the type of the job
+ * @param data the data of the job
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_engine_timer_t*) mrcp_engine_timer_create(mrcp_engine_strand_t *strand, int type, void *data, apr_pool_t *pool);
+
+/**
+ * Set timer, replacing the timeout set before, if not expired yet.
+ * @remark A timer set or killed by a job of its strand is not processed afterwards by the timeout set before.
+ */
+MRCP_DECLARE(void) mrcp_engine_timer_set(mrcp_engine_timer_t *timer, apr_interval_time_t timeout);
+
+/** Kill timer, if set */
+MRCP_DECLARE(void) mrcp_engine_timer_kill(mrcp_engine_timer_t *timer);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_ENGINE_WORKER_H */
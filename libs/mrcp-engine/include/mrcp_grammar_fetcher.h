@@ -0,0 +1,104 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_GRAMMAR_FETCHER_H
+#define MRCP_GRAMMAR_FETCHER_H
+
+/**
+ * @file mrcp_grammar_fetcher.h
+ * @brief Fetcher of Grammars Referenced by URI for Recognizer Engines
+ *
+ * Grammars referenced by http:// URIs are fetched by the threads of the
+ * fetcher, so that neither the engine task nor the media are blocked on
+ * the network. Fetched documents are kept in memory and, optionally, in
+ * files of a cache directory, which survive restarts. A cached document
+ * is taken as is till it expires by Cache-Control max-age (or the default
+ * max age), and is revalidated by its ETag afterwards.
+ *
+ * Cache file layout
+ *    "URI <uri>\n" "ETag <etag>\n" "Expires <usec since epoch>\n" "\n" document
+ */
+
+#include "mrcp_engine_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque grammar fetcher declaration */
+typedef struct mrcp_grammar_fetcher_t mrcp_grammar_fetcher_t;
+/** Opaque grammar fetch declaration */
+typedef struct mrcp_grammar_fetch_t mrcp_grammar_fetch_t;
+
+/**
+ * Function called on completion of a fetch (fetcher thread).
+ * @param obj the object the fetch is started on behalf of
+ * @param uri the URI of the grammar
+ * @param body the document, valid during the call only (NULL on failure)
+ */
+typedef void (*mrcp_grammar_fetch_f)(void *obj, const char *uri, const apt_str_t *body);
+
+/**
+ * Create grammar fetcher.
+ * @param thread_count the number of threads to fetch grammars by
+ * @param cache_dir the directory to keep fetched documents in (NULL to keep them in memory only)
+ * @param max_size the max total size of documents kept in memory in bytes
+ * @param max_age the time documents are taken as is, unless the server sets Cache-Control max-age
+ * @param timeout the timeout of the network operations of a fetch
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_grammar_fetcher_t*) mrcp_grammar_fetcher_create(
+										apr_size_t thread_count,
+										const char *cache_dir,
+										apr_size_t max_size,
+										apr_interval_time_t max_age,
+										apr_interval_time_t timeout,
+										apr_pool_t *pool);
+
+/** Destroy grammar fetcher, pending fetches are abandoned, all the fetches must be released beforehand */
+MRCP_DECLARE(void) mrcp_grammar_fetcher_destroy(mrcp_grammar_fetcher_t *fetcher);
+
+/** Check whether the URI is to be fetched by the fetcher */
+MRCP_DECLARE(apt_bool_t) mrcp_grammar_uri_check(const char *uri);
+
+/**
+ * Get grammar kept in memory and not expired yet, without blocking on the network.
+ * @param fetcher the fetcher to look up grammar in
+ * @param uri the URI of the grammar
+ * @param body the document to copy to the pool
+ * @param pool the pool to allocate memory from
+ * @return TRUE if the document is taken from the memory, FALSE if it is to be fetched
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_grammar_fetcher_get(mrcp_grammar_fetcher_t *fetcher, const char *uri, apt_str_t *body, apr_pool_t *pool);
+
+/**
+ * Start to fetch grammar.
+ * @param fetcher the fetcher to fetch grammar by
+ * @param uri the URI of the grammar
+ * @param handler the function to call on completion
+ * @param obj the object to pass to the function
+ * @return the fetch to release by mrcp_grammar_fetch_release(), NULL on failure
+ */
+MRCP_DECLARE(mrcp_grammar_fetch_t*) mrcp_grammar_fetch_start(mrcp_grammar_fetcher_t *fetcher, const char *uri, mrcp_grammar_fetch_f handler, void *obj);
+
+/**
+ * Release fetch, cancel it, if not completed yet.
+ * @remark The function is not called back afterwards, it waits for the call in progress, if any.
+ *         Hence the fetch must not be released by the function it completes by.
+ */
+MRCP_DECLARE(void) mrcp_grammar_fetch_release(mrcp_grammar_fetcher_t *fetcher, mrcp_grammar_fetch_t *fetch);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_GRAMMAR_FETCHER_H */
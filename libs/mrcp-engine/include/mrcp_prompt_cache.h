@@ -0,0 +1,93 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MRCP_PROMPT_CACHE_H
+#define MRCP_PROMPT_CACHE_H
+
+/**
+ * @file mrcp_prompt_cache.h
+ * @brief Cache of Prompts for Synthesizer Engines
+ *
+ * Prompts are buffers of audio (decoded L16 or pre-encoded, e.g. G.711),
+ * which are shared read-only by all the channels playing them, so that a
+ * frequently played prompt is neither read nor synthesized nor encoded
+ * again. Prompts are keyed by the codec and the hash of the content, which
+ * the audio is produced of, and the least recently used ones are evicted,
+ * as soon as the cache exceeds its size. A prompt stays valid while it is
+ * referenced, even if evicted meanwhile.
+ */
+
+#include "mrcp_engine_types.h"
+#include "mpf_codec_descriptor.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque prompt cache declaration */
+typedef struct mrcp_prompt_cache_t mrcp_prompt_cache_t;
+/** Opaque prompt declaration */
+typedef struct mrcp_prompt_t mrcp_prompt_t;
+
+/**
+ * Create prompt cache.
+ * @param max_size the max total size of cached prompts in bytes (0 disables caching)
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_prompt_cache_t*) mrcp_prompt_cache_create(apr_size_t max_size, apr_pool_t *pool);
+
+/** Destroy prompt cache, all the prompts must be released beforehand */
+MRCP_DECLARE(void) mrcp_prompt_cache_destroy(mrcp_prompt_cache_t *cache);
+
+/**
+ * Create key of a prompt.
+ * @param descriptor the codec descriptor of the audio
+ * @param content the content the audio is produced of (e.g. text and voice, or source file)
+ * @param length the length of the content
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(const char*) mrcp_prompt_key_create(const mpf_codec_descriptor_t *descriptor, const void *content, apr_size_t length, apr_pool_t *pool);
+
+/**
+ * Find and reference prompt.
+ * @param cache the cache to find prompt in
+ * @param key the key of the prompt
+ * @return the prompt to release by mrcp_prompt_release(), NULL if not cached
+ */
+MRCP_DECLARE(mrcp_prompt_t*) mrcp_prompt_cache_get(mrcp_prompt_cache_t *cache, const char *key);
+
+/**
+ * Add and reference prompt, the audio is copied once.
+ * @param cache the cache to add prompt to
+ * @param key the key of the prompt
+ * @param data the audio of the prompt
+ * @param size the size of the audio
+ * @return the prompt to release by mrcp_prompt_release() (the cached one, if added concurrently)
+ * @remark Prompts larger than the cache are referenced but not cached.
+ */
+MRCP_DECLARE(mrcp_prompt_t*) mrcp_prompt_cache_put(mrcp_prompt_cache_t *cache, const char *key, const void *data, apr_size_t size);
+
+/** Release referenced prompt, the prompt must not be referenced afterwards */
+MRCP_DECLARE(void) mrcp_prompt_release(mrcp_prompt_cache_t *cache, mrcp_prompt_t *prompt);
+
+/** Get the audio of referenced prompt */
+MRCP_DECLARE(const void*) mrcp_prompt_data_get(const mrcp_prompt_t *prompt);
+
+/** Get the size of the audio of referenced prompt */
+MRCP_DECLARE(apr_size_t) mrcp_prompt_size_get(const mrcp_prompt_t *prompt);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_PROMPT_CACHE_H */
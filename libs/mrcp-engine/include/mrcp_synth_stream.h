@@ -0,0 +1,140 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MRCP_SYNTH_STREAM_H
+#define MRCP_SYNTH_STREAM_H
+
+/**
+ * @file mrcp_synth_stream.h
+ * @brief Pre-buffered Audio Stream between a TTS Worker and the Media Engine
+ *
+ * A lock-free single-producer single-consumer ring of audio frames, which
+ * a TTS worker thread writes synthesized audio to in chunks of any size,
+ * and which the read callback of the audio stream of a synthesizer channel
+ * takes one frame from per frame time. Neither side blocks the other: the
+ * worker learns of a full ring by a short write and may wait for room in
+ * frame ticks, the media engine learns of an empty ring by an underrun.
+ *
+ * Playback starts once the lead time of audio is buffered, or the worker
+ * has completed earlier (a prompt shorter than the lead time). Completion
+ * is reported to the consumer only after the ring is drained, so that
+ * SPEAK-COMPLETE is never raised ahead of the audio, even if the worker
+ * completed long before. Abort (STOP, barge-in) completes the stream at
+ * the next frame time, dropping what is buffered.
+ */
+
+#include "mrcp_engine_types.h"
+#include "mpf_codec_descriptor.h"
+#include "mpf_frame.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque synth stream declaration */
+typedef struct mrcp_synth_stream_t mrcp_synth_stream_t;
+
+/** Status of a frame read from synth stream */
+typedef enum {
+	MRCP_SYNTH_STREAM_AUDIO,     /**< the frame is filled with audio */
+	MRCP_SYNTH_STREAM_BUFFERING, /**< the lead time is not buffered yet, the frame is untouched */
+	MRCP_SYNTH_STREAM_UNDERRUN,  /**< the worker lags behind the playback, the frame is untouched */
+	MRCP_SYNTH_STREAM_COMPLETE   /**< the audio is played out or aborted, SPEAK-COMPLETE is due */
+} mrcp_synth_stream_status_e;
+
+/** Delivery metrics of synth stream */
+typedef struct mrcp_synth_stream_stats_t mrcp_synth_stream_stats_t;
+
+/** Delivery metrics of synth stream, counted since creation or reset */
+struct mrcp_synth_stream_stats_t {
+	/** Number of frames written by the worker */
+	apr_size_t written;
+	/** Number of frames played */
+	apr_size_t played;
+	/** Number of underruns (runs of consecutive frame times with no audio) */
+	apr_size_t underruns;
+	/** Number of frame times with no audio during underruns */
+	apr_size_t underrun_frames;
+};
+
+/**
+ * Create synth stream.
+ * @param descriptor the codec descriptor of the audio (linear)
+ * @param capacity the capacity in msec of audio
+ * @param lead_time the audio in msec to buffer before the playback starts
+ * @param pool the pool to allocate memory from
+ * @remark Lead time beyond the capacity is cut to the capacity, the capacity is rounded up
+ *         to the power of two frames.
+ */
+MRCP_DECLARE(mrcp_synth_stream_t*) mrcp_synth_stream_create(
+										const mpf_codec_descriptor_t *descriptor,
+										apr_size_t capacity,
+										apr_size_t lead_time,
+										apr_pool_t *pool);
+
+/** Reset synth stream for the next SPEAK request, neither side may be active meanwhile */
+MRCP_DECLARE(void) mrcp_synth_stream_reset(mrcp_synth_stream_t *stream);
+
+/**
+ * Write audio to synth stream (producer side), never blocks.
+ * @param stream the stream to write to
+ * @param data the audio to write
+ * @param size the size of the audio
+ * @return the number of bytes accepted, less than the size if the ring is full
+ * @remark A chunk of less than a frame is staged till the rest of the frame is written.
+ */
+MRCP_DECLARE(apr_size_t) mrcp_synth_stream_write(mrcp_synth_stream_t *stream, const void *data, apr_size_t size);
+
+/**
+ * Wait for room in synth stream (producer side), sleeping in frame ticks.
+ * @param stream the stream to wait for
+ * @param timeout the max time to wait in msec
+ * @return TRUE if there is room for a frame, FALSE on timeout or abort
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_stream_write_wait(mrcp_synth_stream_t *stream, apr_size_t timeout);
+
+/**
+ * Complete synth stream (producer side), the staged chunk is padded with silence.
+ * @param stream the stream to complete
+ * @return FALSE if the ring is full, to be called again once there is room
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_stream_complete(mrcp_synth_stream_t *stream);
+
+/** Abort synth stream (either side), the producer should stop synthesis */
+MRCP_DECLARE(void) mrcp_synth_stream_abort(mrcp_synth_stream_t *stream);
+
+/** Check whether synth stream is aborted (either side) */
+MRCP_DECLARE(apt_bool_t) mrcp_synth_stream_is_aborted(const mrcp_synth_stream_t *stream);
+
+/**
+ * Read the next frame from synth stream (consumer side), called once per frame time.
+ * @param stream the stream to read from
+ * @param frame the frame to fill
+ * @return the status of the frame
+ */
+MRCP_DECLARE(mrcp_synth_stream_status_e) mrcp_synth_stream_read(mrcp_synth_stream_t *stream, mpf_frame_t *frame);
+
+/** Get the audio buffered in msec (either side) */
+MRCP_DECLARE(apr_size_t) mrcp_synth_stream_buffered_get(const mrcp_synth_stream_t *stream);
+
+/** Get delivery metrics (either side, the counts of the other side may lag) */
+MRCP_DECLARE(void) mrcp_synth_stream_stats_get(const mrcp_synth_stream_t *stream, mrcp_synth_stream_stats_t *stats);
+
+/** Reset delivery metrics, neither side may be active meanwhile */
+MRCP_DECLARE(void) mrcp_synth_stream_stats_reset(mrcp_synth_stream_t *stream);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_SYNTH_STREAM_H */
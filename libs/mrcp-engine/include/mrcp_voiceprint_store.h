@@ -0,0 +1,103 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_VOICEPRINT_STORE_H
+#define MRCP_VOICEPRINT_STORE_H
+
+/**
+ * @file mrcp_voiceprint_store.h
+ * @brief Store of Voiceprints for Verifier Engines
+ *
+ * Voiceprints are speaker embeddings of a fixed size, stored normalized
+ * in an append-only file of fixed size records, so that the cosine score
+ * is a dot product. The records enrolled before open are mapped and scored
+ * in place, the ones enrolled afterwards are appended to the file and kept
+ * in memory. Records are indexed by the id of the speaker.
+ *
+ * File layout (host byte order)
+ *    header: "VPIX", version (uint32), vector size (uint32), reserved (uint32)
+ *    record: id (64 bytes, nul-terminated), vector (float[vector size])
+ */
+
+#include "mrcp_engine_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max size of a voiceprint vector */
+#define MRCP_VOICEPRINT_MAX_SIZE 1024
+/** Size of the id of a speaker, including the terminating nul */
+#define MRCP_VOICEPRINT_ID_SIZE  64
+
+/** Opaque voiceprint store declaration */
+typedef struct mrcp_voiceprint_store_t mrcp_voiceprint_store_t;
+
+/** Match of a speaker */
+typedef struct mrcp_voiceprint_match_t mrcp_voiceprint_match_t;
+struct mrcp_voiceprint_match_t {
+	/** The id of the speaker, valid till the store is closed */
+	const char *id;
+	/** The best cosine score [-1, 1] among the voiceprints of the speaker */
+	float       score;
+};
+
+/**
+ * Open store, the file is created on the first enrollment, if there is none.
+ * @param path the path to the file of the store
+ * @param pool the pool to allocate memory from
+ * @return the store, NULL if the file is invalid
+ */
+MRCP_DECLARE(mrcp_voiceprint_store_t*) mrcp_voiceprint_store_open(const char *path, apr_pool_t *pool);
+
+/** Close store */
+MRCP_DECLARE(void) mrcp_voiceprint_store_close(mrcp_voiceprint_store_t *store);
+
+/** Get the number of enrolled voiceprints */
+MRCP_DECLARE(apr_size_t) mrcp_voiceprint_store_count_get(mrcp_voiceprint_store_t *store);
+
+/**
+ * Enroll voiceprint (appended to the file at once).
+ * @param store the store to add voiceprint to
+ * @param id the id of the speaker (several voiceprints may be enrolled per speaker)
+ * @param vector the voiceprint vector
+ * @param size the size of the vector, which must be the same for all the voiceprints
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_voiceprint_store_enroll(mrcp_voiceprint_store_t *store, const char *id, const float *vector, apr_size_t size);
+
+/**
+ * Find the speakers best matching a vector.
+ * @param store the store to search in
+ * @param vector the vector to score
+ * @param size the size of the vector
+ * @param matches the array to store the matches in, distinct speakers by descending score
+ * @param max_count the max number of matches
+ * @return the number of matches
+ */
+MRCP_DECLARE(apr_size_t) mrcp_voiceprint_store_identify(mrcp_voiceprint_store_t *store, const float *vector, apr_size_t size, mrcp_voiceprint_match_t *matches, apr_size_t max_count);
+
+/**
+ * Score a vector against the voiceprints of a claimed speaker.
+ * @param store the store to search in
+ * @param id the id of the claimed speaker
+ * @param vector the vector to score
+ * @param size the size of the vector
+ * @param score the best cosine score [-1, 1] among the voiceprints of the speaker
+ * @return FALSE if the speaker is not enrolled
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_voiceprint_store_verify(mrcp_voiceprint_store_t *store, const char *id, const float *vector, apr_size_t size, float *score);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_VOICEPRINT_STORE_H */
@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+#include <apr_atomic.h>
+#include <apr_lib.h>
+#include <apr_strings.h>
 #include "mrcp_engine_iface.h"
 #include "apt_log.h"
 
@@ -28,6 +32,15 @@ apt_bool_t mrcp_engine_virtual_open(mrcp_engine_t *engine)
 {
 	if(engine->is_open == FALSE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Open Engine [%s]",engine->id);
+		/* the params of an engine loaded otherwise than by the plugin loader are indexed now, before any lookup */
+		if(engine->config && engine->config->params && !engine->config->param_index) {
+			mrcp_engine_config_params_index(engine->config,engine->pool);
+		}
+		if(!engine->mem_account) {
+			engine->mem_account = apt_mem_account_create(engine->id,
+				engine->config ? engine->config->max_memory_size : 0,NULL,engine->pool);
+		}
+		engine->open_time = apr_time_now();
 		return engine->method_vtable->open(engine);
 	}
 	return FALSE;
@@ -36,9 +49,11 @@ apt_bool_t mrcp_engine_virtual_open(mrcp_engine_t *engine)
 /** Response to open engine request */
 void mrcp_engine_on_open(mrcp_engine_t *engine, apt_bool_t status)
 {
-	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Engine Opened [%s] status [%s]",
+	/* engines open independently, each one takes channels as soon as it is ready */
+	apt_log(APT_LOG_MARK,status == TRUE ? APT_PRIO_NOTICE : APT_PRIO_WARNING,"Engine %s [%s] in [%"APR_TIME_T_FMT" ms]",
+		status == TRUE ? "Ready" : "Failed to Open",
 		engine->id,
-		status == TRUE ? "success" : "failure");
+		apr_time_as_msec(apr_time_now() - engine->open_time));
 	engine->is_open = status;
 }
 
@@ -64,31 +79,49 @@ void mrcp_engine_on_close(mrcp_engine_t *engine)
 mrcp_engine_channel_t* mrcp_engine_channel_virtual_create(mrcp_engine_t *engine, apr_table_t *attribs, mrcp_version_e mrcp_version, apr_pool_t *pool)
 {
 	mrcp_engine_channel_t *channel;
+	apr_uint32_t count;
 	if(engine->is_open != TRUE) {
 		return NULL;
 	}
-	if(engine->config->max_channel_count && engine->cur_channel_count >= engine->config->max_channel_count) {
+	/* channels may be created by several session shards at once, reserve the slot first */
+	count = apr_atomic_inc32(&engine->cur_channel_count);
+	if(engine->config->max_channel_count && count >= engine->config->max_channel_count) {
+		apr_atomic_dec32(&engine->cur_channel_count);
 		apt_log(APT_LOG_MARK, APT_PRIO_NOTICE, "Maximum channel count %"APR_SIZE_T_FMT" exceeded for engine [%s]",
 			engine->config->max_channel_count, engine->id);
 		return NULL;
 	}
 	channel = engine->method_vtable->create_channel(engine,pool);
-	if(channel) {
-		channel->mrcp_version = mrcp_version;
-		channel->attribs = attribs;
-		engine->cur_channel_count++;
+	if(!channel) {
+		apr_atomic_dec32(&engine->cur_channel_count);
+		return NULL;
 	}
+	channel->mrcp_version = mrcp_version;
+	channel->attribs = attribs;
 	return channel;
 }
 
 /** Destroy engine channel */
 apt_bool_t mrcp_engine_channel_virtual_destroy(mrcp_engine_channel_t *channel)
 {
+	apt_bool_t status;
+	apr_uint32_t mem_charged;
 	mrcp_engine_t *engine = channel->engine;
-	if(engine->cur_channel_count) {
-		engine->cur_channel_count--;
+	if(apr_atomic_read32(&engine->cur_channel_count)) {
+		apr_atomic_dec32(&engine->cur_channel_count);
+	}
+	status = channel->method_vtable->destroy(channel);
+	/* the memory the plugin has not uncharged by now is gone along with the channel */
+	mem_charged = apr_atomic_xchg32(&channel->mem_charged,0);
+	if(mem_charged) {
+		if(channel->mem_account) {
+			apt_mem_account_uncharge(channel->mem_account,mem_charged);
+		}
+		if(engine->mem_account) {
+			apt_mem_account_uncharge(engine->mem_account,mem_charged);
+		}
 	}
-	return channel->method_vtable->destroy(channel);
+	return status;
 }
 
 /** Allocate engine config */
@@ -96,7 +129,11 @@ mrcp_engine_config_t* mrcp_engine_config_alloc(apr_pool_t *pool)
 {
 	mrcp_engine_config_t *config = apr_palloc(pool,sizeof(mrcp_engine_config_t));
 	config->max_channel_count = 0;
+	config->max_memory_size = 0;
 	config->params = NULL;
+	config->param_index = NULL;
+	config->cpu_set = NULL;
+	config->priority = 0;
 	return config;
 }
 
@@ -110,3 +147,104 @@ mrcp_engine_settings_t* mrcp_engine_settings_alloc(apr_pool_t *pool)
 	settings->engine = NULL;
 	return settings;
 }
+
+/** Parse engine param value */
+void mrcp_engine_param_parse(mrcp_engine_param_t *param, const char *value)
+{
+	char *end = NULL;
+	param->value = value;
+	param->number = 0;
+	param->is_number = FALSE;
+	param->real = 0;
+	param->is_real = FALSE;
+	param->duration = 0;
+	param->is_duration = FALSE;
+	param->is_bool = FALSE;
+	param->bool_value = FALSE;
+	if(!value || *value == '\0') {
+		return;
+	}
+	param->number = apr_strtoi64(value,&end,10);
+	if(end != value && *end == '\0') {
+		param->is_number = TRUE;
+		/* a plain number of a duration is msec */
+		param->duration = param->number;
+		param->is_duration = param->number >= 0 ? TRUE : FALSE;
+	}
+	else {
+		if(end != value && param->number >= 0) {
+			if(strcasecmp(end,"ms") == 0) {
+				param->duration = param->number;
+				param->is_duration = TRUE;
+			}
+			else if(strcasecmp(end,"s") == 0) {
+				param->duration = param->number * 1000;
+				param->is_duration = TRUE;
+			}
+			else if(strcasecmp(end,"m") == 0) {
+				param->duration = param->number * 60000;
+				param->is_duration = TRUE;
+			}
+		}
+		param->number = 0;
+	}
+	param->real = strtod(value,&end);
+	if(end != value && *end == '\0') {
+		param->is_real = TRUE;
+	}
+	else {
+		param->real = 0;
+	}
+	if(strcasecmp(value,"true") == 0) {
+		param->is_bool = TRUE;
+		param->bool_value = TRUE;
+	}
+	else if(strcasecmp(value,"false") == 0) {
+		param->is_bool = TRUE;
+	}
+}
+
+/** Lowercase param name to look it up in the index by, FALSE if it is too long */
+apt_bool_t mrcp_engine_param_key_get(const char *name, char *key, apr_size_t size)
+{
+	apr_size_t i;
+	for(i=0; name[i] != '\0'; i++) {
+		if(i + 1 >= size) {
+			return FALSE;
+		}
+		key[i] = (char)apr_tolower(name[i]);
+	}
+	key[i] = '\0';
+	return TRUE;
+}
+
+/** Parse engine params of the config once and index them by name */
+apt_bool_t mrcp_engine_config_params_index(mrcp_engine_config_t *config, apr_pool_t *pool)
+{
+	const apr_array_header_t *header;
+	const apr_table_entry_t *entry;
+	int i;
+	if(!config->params) {
+		return FALSE;
+	}
+	config->param_index = apr_hash_make(pool);
+	header = apr_table_elts(config->params);
+	entry = (const apr_table_entry_t*)header->elts;
+	for(i=0; i<header->nelts; i++) {
+		mrcp_engine_param_t *param;
+		char *key;
+		if(!entry[i].key) {
+			continue;
+		}
+		key = apr_pstrdup(pool,entry[i].key);
+		mrcp_engine_param_key_get(entry[i].key,key,strlen(key) + 1);
+		/* the table keeps the first entry of duplicate names, so does the index */
+		if(apr_hash_get(config->param_index,key,APR_HASH_KEY_STRING)) {
+			continue;
+		}
+		param = apr_palloc(pool,sizeof(mrcp_engine_param_t));
+		mrcp_engine_param_parse(param,entry[i].val);
+		apr_hash_set(config->param_index,key,APR_HASH_KEY_STRING,param);
+	}
+	return TRUE;
+}
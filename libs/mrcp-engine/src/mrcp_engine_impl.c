@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mrcp_engine_impl.h"
+#include "mrcp_engine_iface.h"
 #include "mpf_termination_factory.h"
+#include "mpf_termination.h"
+#include "apt_numa.h"
 
 /** Create engine */
 mrcp_engine_t* mrcp_engine_create(
@@ -35,7 +39,13 @@ mrcp_engine_t* mrcp_engine_create(
 	engine->codec_manager = NULL;
 	engine->dir_layout = NULL;
 	engine->cur_channel_count = 0;
+	engine->backlog = 0;
+	engine->rtf_histogram = NULL;
+	engine->degraded_channel_count = 0;
+	engine->degradation_count = 0;
+	engine->mem_account = NULL;
 	engine->is_open = FALSE;
+	engine->open_time = 0;
 	engine->pool = pool;
 	engine->create_state_machine = NULL;
 	return engine;
@@ -47,13 +57,123 @@ const mrcp_engine_config_t* mrcp_engine_config_get(const mrcp_engine_t *engine)
 	return engine->config;
 }
 
+/** Max length of param name looked up in the index */
+#define MRCP_ENGINE_PARAM_MAX_NAME_LENGTH 64
+
+/** Find engine param by name, parsed once in the index or on the fly otherwise */
+static const mrcp_engine_param_t* mrcp_engine_param_find(const mrcp_engine_t *engine, const char *name, mrcp_engine_param_t *tmp)
+{
+	const char *value;
+	if(!engine->config || !engine->config->params) {
+		return NULL;
+	}
+	if(engine->config->param_index) {
+		char key[MRCP_ENGINE_PARAM_MAX_NAME_LENGTH];
+		if(mrcp_engine_param_key_get(name,key,sizeof(key)) == TRUE) {
+			return apr_hash_get(engine->config->param_index,key,APR_HASH_KEY_STRING);
+		}
+	}
+	value = apr_table_get(engine->config->params,name);
+	if(!value) {
+		return NULL;
+	}
+	mrcp_engine_param_parse(tmp,value);
+	return tmp;
+}
+
 /** Get engine param by name */
 const char* mrcp_engine_param_get(const mrcp_engine_t *engine, const char *name)
 {
-	if(!engine->config || !engine->config->params) {
+	mrcp_engine_param_t tmp;
+	const mrcp_engine_param_t *param = mrcp_engine_param_find(engine,name,&tmp);
+	return param ? param->value : NULL;
+}
+
+/** Look engine param up once, to read it directly afterwards */
+const mrcp_engine_param_t* mrcp_engine_param_lookup(const mrcp_engine_t *engine, const char *name)
+{
+	char key[MRCP_ENGINE_PARAM_MAX_NAME_LENGTH];
+	if(!engine->config || !engine->config->param_index ||
+		mrcp_engine_param_key_get(name,key,sizeof(key)) == FALSE) {
 		return NULL;
 	}
-	return apr_table_get(engine->config->params,name);
+	return apr_hash_get(engine->config->param_index,key,APR_HASH_KEY_STRING);
+}
+
+/** Get integer engine param */
+apt_bool_t mrcp_engine_param_int_get(const mrcp_engine_t *engine, const char *name, long *value)
+{
+	mrcp_engine_param_t tmp;
+	const mrcp_engine_param_t *param = mrcp_engine_param_find(engine,name,&tmp);
+	if(!param || param->is_number == FALSE) {
+		return FALSE;
+	}
+	*value = (long)param->number;
+	return TRUE;
+}
+
+/** Get real engine param */
+apt_bool_t mrcp_engine_param_float_get(const mrcp_engine_t *engine, const char *name, float *value)
+{
+	mrcp_engine_param_t tmp;
+	const mrcp_engine_param_t *param = mrcp_engine_param_find(engine,name,&tmp);
+	if(!param || param->is_real == FALSE) {
+		return FALSE;
+	}
+	*value = (float)param->real;
+	return TRUE;
+}
+
+/** Get duration engine param in msec */
+apt_bool_t mrcp_engine_param_duration_get(const mrcp_engine_t *engine, const char *name, apr_size_t *value)
+{
+	mrcp_engine_param_t tmp;
+	const mrcp_engine_param_t *param = mrcp_engine_param_find(engine,name,&tmp);
+	if(!param || param->is_duration == FALSE) {
+		return FALSE;
+	}
+	*value = (apr_size_t)param->duration;
+	return TRUE;
+}
+
+/** Get boolean engine param */
+apt_bool_t mrcp_engine_param_bool_get(const mrcp_engine_t *engine, const char *name, apt_bool_t *value)
+{
+	mrcp_engine_param_t tmp;
+	const mrcp_engine_param_t *param = mrcp_engine_param_find(engine,name,&tmp);
+	if(!param || param->is_bool == FALSE) {
+		return FALSE;
+	}
+	*value = param->bool_value;
+	return TRUE;
+}
+
+/** Get non-negative integer engine param */
+apt_bool_t mrcp_engine_param_size_get(const mrcp_engine_t *engine, const char *name, apr_size_t *value)
+{
+	mrcp_engine_param_t tmp;
+	const mrcp_engine_param_t *param = mrcp_engine_param_find(engine,name,&tmp);
+	if(!param || param->is_number == FALSE || param->number < 0) {
+		return FALSE;
+	}
+	*value = (apr_size_t)param->number;
+	return TRUE;
+}
+
+/** Apply CPU affinity and priority of engine config to the task */
+apt_bool_t mrcp_engine_task_config_apply(const mrcp_engine_t *engine, apt_task_t *task)
+{
+	apt_bool_t status = TRUE;
+	if(!engine->config || !task) {
+		return FALSE;
+	}
+	if(engine->config->cpu_set && apt_task_affinity_set(task,engine->config->cpu_set) == FALSE) {
+		status = FALSE;
+	}
+	if(engine->config->priority && apt_task_priority_set(task,engine->config->priority) == FALSE) {
+		status = FALSE;
+	}
+	return status;
 }
 
 /** Create engine channel */
@@ -71,7 +191,16 @@ mrcp_engine_channel_t* mrcp_engine_channel_create(
 	channel->event_obj = NULL;
 	channel->termination = termination;
 	channel->engine = engine;
+	if(termination && engine->id) {
+		/* the media path and tick offenders are traced by the engine id */
+		termination->name = engine->id;
+	}
 	channel->is_open = FALSE;
+	channel->numa_node = APT_NUMA_NODE_NONE;
+	channel->cpu = -1;
+	channel->log_priority = APT_PRIO_COUNT;
+	channel->mem_account = NULL;
+	channel->mem_charged = 0;
 	channel->pool = pool;
 	channel->attribs = NULL;
 	apt_string_reset(&channel->id);
@@ -243,3 +372,48 @@ const mpf_codec_descriptor_t* mrcp_engine_sink_stream_codec_get(const mrcp_engin
 	}
 	return NULL;
 }
+
+/** Charge memory held on behalf of channel to the accounts of its session and engine */
+apt_bool_t mrcp_engine_channel_mem_charge(mrcp_engine_channel_t *channel, apr_size_t size)
+{
+	if(!size) {
+		return TRUE;
+	}
+	if(channel->mem_account && apt_mem_account_charge(channel->mem_account,size) == FALSE) {
+		return FALSE;
+	}
+	if(channel->engine->mem_account && apt_mem_account_charge(channel->engine->mem_account,size) == FALSE) {
+		if(channel->mem_account) {
+			apt_mem_account_uncharge(channel->mem_account,size);
+		}
+		return FALSE;
+	}
+	apr_atomic_add32(&channel->mem_charged,(apr_uint32_t)size);
+	return TRUE;
+}
+
+/** Uncharge memory charged on behalf of channel before */
+void mrcp_engine_channel_mem_uncharge(mrcp_engine_channel_t *channel, apr_size_t size)
+{
+	apr_uint32_t charged;
+	apr_uint32_t prev;
+	/* never uncharge more than charged, the rest is uncharged on destroy */
+	do {
+		charged = apr_atomic_read32(&channel->mem_charged);
+		if(size > charged) {
+			size = charged;
+		}
+		if(!size) {
+			return;
+		}
+		prev = apr_atomic_cas32(&channel->mem_charged,charged - (apr_uint32_t)size,charged);
+	}
+	while(prev != charged);
+
+	if(channel->mem_account) {
+		apt_mem_account_uncharge(channel->mem_account,size);
+	}
+	if(channel->engine->mem_account) {
+		apt_mem_account_uncharge(channel->engine->mem_account,size);
+	}
+}
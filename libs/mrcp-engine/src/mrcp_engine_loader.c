@@ -171,5 +171,9 @@ MRCP_DECLARE(mrcp_engine_t*) mrcp_engine_loader_plugin_load(mrcp_engine_loader_t
 	
 	engine->id = id;
 	engine->config = config;
+	/* the params are parsed once, the engine looks them up by name on open */
+	if(config && config->params) {
+		mrcp_engine_config_params_index(config,loader->pool);
+	}
 	return engine;
 }
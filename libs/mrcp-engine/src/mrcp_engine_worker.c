@@ -0,0 +1,384 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef WIN32
+#pragma warning(disable: 4127)
+#endif
+#include <apr_ring.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include "mrcp_engine_worker.h"
+#include "apt_log.h"
+
+/** Max number of jobs of a strand processed in a row, before the thread turns to other strands */
+#define MRCP_ENGINE_STRAND_BATCH 8
+
+/** Job queued to a strand */
+typedef struct mrcp_engine_job_t mrcp_engine_job_t;
+struct mrcp_engine_job_t {
+	/** Type of the job */
+	int   type;
+	/** Data of the job */
+	void *data;
+};
+
+/** State of a timer */
+typedef enum {
+	MRCP_ENGINE_TIMER_IDLE,  /**< not set */
+	MRCP_ENGINE_TIMER_ARMED, /**< in the list of timers of the worker */
+	MRCP_ENGINE_TIMER_FIRED  /**< expired, in the list of fired timers of the strand */
+} mrcp_engine_timer_state_e;
+
+/** Timer */
+struct mrcp_engine_timer_t {
+	/** Ring entry of the list of timers of the worker or of fired timers of the strand */
+	APR_RING_ENTRY(mrcp_engine_timer_t) link;
+	/** Strand to post the job to */
+	mrcp_engine_strand_t               *strand;
+	/** Type of the job */
+	int                                 type;
+	/** Data of the job */
+	void                               *data;
+	/** Time the timer expires at */
+	apr_time_t                          expires;
+	/** State of the timer */
+	mrcp_engine_timer_state_e           state;
+};
+
+/** Strand */
+struct mrcp_engine_strand_t {
+	/** Ring entry of the queue of strands ready to run */
+	APR_RING_ENTRY(mrcp_engine_strand_t) link;
+	/** Worker the strand belongs to */
+	mrcp_engine_worker_t                *worker;
+	/** Function to process jobs by */
+	mrcp_engine_job_f                    handler;
+	/** Object to pass to the function */
+	void                                *obj;
+	/** Ring buffer of queued jobs */
+	mrcp_engine_job_t                   *jobs;
+	/** Size of the ring buffer */
+	apr_size_t                           capacity;
+	/** Index of the first queued job */
+	apr_size_t                           head;
+	/** Number of queued jobs */
+	apr_size_t                           count;
+	/** Fired timers, the jobs of which are processed after the queued ones */
+	APR_RING_HEAD(mrcp_engine_fired_head_t, mrcp_engine_timer_t) fired;
+	/** Whether the strand is in the queue of strands ready to run */
+	apt_bool_t                           ready;
+	/** Whether a job of the strand is being processed */
+	apt_bool_t                           running;
+};
+
+/** Engine worker */
+struct mrcp_engine_worker_t {
+	/** Threads processing jobs */
+	apr_thread_t                                       **threads;
+	/** Number of threads */
+	apr_size_t                                           thread_count;
+	/** Whether the threads are to run */
+	apt_bool_t                                           running;
+	/** Queue of strands ready to run */
+	APR_RING_HEAD(mrcp_engine_strand_head_t, mrcp_engine_strand_t) ready;
+	/** Set timers, sorted by time of expiry */
+	APR_RING_HEAD(mrcp_engine_timer_head_t, mrcp_engine_timer_t)   timers;
+	/** Guard of the queues, the strands and the timers */
+	apr_thread_mutex_t                                  *guard;
+	/** Signaled on a strand ready, a timer set ahead of others or the worker destroyed */
+	apr_thread_cond_t                                   *wakeup;
+	/** Signaled on a strand done running */
+	apr_thread_cond_t                                   *idle;
+};
+
+static void* APR_THREAD_FUNC mrcp_engine_worker_thread_proc(apr_thread_t *thread, void *data);
+
+MRCP_DECLARE(mrcp_engine_worker_t*) mrcp_engine_worker_create(apr_size_t thread_count, apr_pool_t *pool)
+{
+	apr_size_t i;
+	mrcp_engine_worker_t *worker = apr_palloc(pool,sizeof(mrcp_engine_worker_t));
+	worker->threads = apr_pcalloc(pool,sizeof(apr_thread_t*) * (thread_count ? thread_count : 1));
+	worker->thread_count = 0;
+	worker->running = TRUE;
+	APR_RING_INIT(&worker->ready, mrcp_engine_strand_t, link);
+	APR_RING_INIT(&worker->timers, mrcp_engine_timer_t, link);
+	worker->guard = NULL;
+	worker->wakeup = NULL;
+	worker->idle = NULL;
+
+	if(apr_thread_mutex_create(&worker->guard,APR_THREAD_MUTEX_UNNESTED,pool) != APR_SUCCESS ||
+		apr_thread_cond_create(&worker->wakeup,pool) != APR_SUCCESS ||
+		apr_thread_cond_create(&worker->idle,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	for(i=0; i<thread_count; i++) {
+		if(apr_thread_create(&worker->threads[i],NULL,mrcp_engine_worker_thread_proc,worker,pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Engine Worker Thread");
+			break;
+		}
+		worker->thread_count++;
+	}
+	if(!worker->thread_count) {
+		mrcp_engine_worker_destroy(worker);
+		return NULL;
+	}
+	return worker;
+}
+
+MRCP_DECLARE(void) mrcp_engine_worker_destroy(mrcp_engine_worker_t *worker)
+{
+	apr_size_t i;
+	apr_status_t rv;
+	if(worker->guard) {
+		apr_thread_mutex_lock(worker->guard);
+		worker->running = FALSE;
+		apr_thread_cond_broadcast(worker->wakeup);
+		apr_thread_mutex_unlock(worker->guard);
+	}
+	for(i=0; i<worker->thread_count; i++) {
+		apr_thread_join(&rv,worker->threads[i]);
+	}
+	worker->thread_count = 0;
+
+	if(worker->idle) {
+		apr_thread_cond_destroy(worker->idle);
+		worker->idle = NULL;
+	}
+	if(worker->wakeup) {
+		apr_thread_cond_destroy(worker->wakeup);
+		worker->wakeup = NULL;
+	}
+	if(worker->guard) {
+		apr_thread_mutex_destroy(worker->guard);
+		worker->guard = NULL;
+	}
+}
+
+/** Queue strand to run, unless queued or running already (guarded) */
+static void mrcp_engine_strand_schedule(mrcp_engine_strand_t *strand)
+{
+	if(strand->ready == TRUE || strand->running == TRUE) {
+		/* the running thread queues the strand again, once done */
+		return;
+	}
+	strand->ready = TRUE;
+	APR_RING_INSERT_TAIL(&strand->worker->ready,strand,mrcp_engine_strand_t,link);
+	apr_thread_cond_signal(strand->worker->wakeup);
+}
+
+MRCP_DECLARE(mrcp_engine_strand_t*) mrcp_engine_strand_create(
+										mrcp_engine_worker_t *worker,
+										apr_size_t capacity,
+										mrcp_engine_job_f handler,
+										void *obj,
+										apr_pool_t *pool)
+{
+	mrcp_engine_strand_t *strand = apr_palloc(pool,sizeof(mrcp_engine_strand_t));
+	APR_RING_ELEM_INIT(strand,link);
+	strand->worker = worker;
+	strand->handler = handler;
+	strand->obj = obj;
+	strand->capacity = capacity ? capacity : 1;
+	strand->jobs = apr_palloc(pool,sizeof(mrcp_engine_job_t) * strand->capacity);
+	strand->head = 0;
+	strand->count = 0;
+	APR_RING_INIT(&strand->fired, mrcp_engine_timer_t, link);
+	strand->ready = FALSE;
+	strand->running = FALSE;
+	return strand;
+}
+
+MRCP_DECLARE(void) mrcp_engine_strand_destroy(mrcp_engine_strand_t *strand)
+{
+	mrcp_engine_worker_t *worker = strand->worker;
+	mrcp_engine_timer_t *timer;
+	mrcp_engine_timer_t *next;
+
+	apr_thread_mutex_lock(worker->guard);
+	while(strand->running == TRUE) {
+		apr_thread_cond_wait(worker->idle,worker->guard);
+	}
+	if(strand->ready == TRUE) {
+		APR_RING_REMOVE(strand,link);
+		strand->ready = FALSE;
+	}
+	strand->count = 0;
+	for(timer = APR_RING_FIRST(&worker->timers); timer != APR_RING_SENTINEL(&worker->timers,mrcp_engine_timer_t,link); timer = next) {
+		next = APR_RING_NEXT(timer,link);
+		if(timer->strand == strand) {
+			APR_RING_REMOVE(timer,link);
+			timer->state = MRCP_ENGINE_TIMER_IDLE;
+		}
+	}
+	while(!APR_RING_EMPTY(&strand->fired,mrcp_engine_timer_t,link)) {
+		timer = APR_RING_FIRST(&strand->fired);
+		APR_RING_REMOVE(timer,link);
+		timer->state = MRCP_ENGINE_TIMER_IDLE;
+	}
+	apr_thread_mutex_unlock(worker->guard);
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_engine_strand_post(mrcp_engine_strand_t *strand, int type, void *data)
+{
+	mrcp_engine_worker_t *worker = strand->worker;
+	mrcp_engine_job_t *job;
+
+	apr_thread_mutex_lock(worker->guard);
+	if(strand->count == strand->capacity) {
+		apr_thread_mutex_unlock(worker->guard);
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Engine Strand Overflow [%"APR_SIZE_T_FMT"]",strand->capacity);
+		return FALSE;
+	}
+	job = &strand->jobs[(strand->head + strand->count) % strand->capacity];
+	job->type = type;
+	job->data = data;
+	strand->count++;
+	mrcp_engine_strand_schedule(strand);
+	apr_thread_mutex_unlock(worker->guard);
+	return TRUE;
+}
+
+/** Take the next job of strand, queued jobs first (guarded) */
+static apt_bool_t mrcp_engine_strand_job_take(mrcp_engine_strand_t *strand, mrcp_engine_job_t *job)
+{
+	if(strand->count) {
+		*job = strand->jobs[strand->head];
+		strand->head = (strand->head + 1) % strand->capacity;
+		strand->count--;
+		return TRUE;
+	}
+	if(!APR_RING_EMPTY(&strand->fired,mrcp_engine_timer_t,link)) {
+		mrcp_engine_timer_t *timer = APR_RING_FIRST(&strand->fired);
+		APR_RING_REMOVE(timer,link);
+		timer->state = MRCP_ENGINE_TIMER_IDLE;
+		job->type = timer->type;
+		job->data = timer->data;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+MRCP_DECLARE(mrcp_engine_timer_t*) mrcp_engine_timer_create(mrcp_engine_strand_t *strand, int type, void *data, apr_pool_t *pool)
+{
+	mrcp_engine_timer_t *timer = apr_palloc(pool,sizeof(mrcp_engine_timer_t));
+	APR_RING_ELEM_INIT(timer,link);
+	timer->strand = strand;
+	timer->type = type;
+	timer->data = data;
+	timer->expires = 0;
+	timer->state = MRCP_ENGINE_TIMER_IDLE;
+	return timer;
+}
+
+/** Remove timer from the list it is in (guarded) */
+static void mrcp_engine_timer_remove(mrcp_engine_timer_t *timer)
+{
+	if(timer->state != MRCP_ENGINE_TIMER_IDLE) {
+		APR_RING_REMOVE(timer,link);
+		timer->state = MRCP_ENGINE_TIMER_IDLE;
+	}
+}
+
+MRCP_DECLARE(void) mrcp_engine_timer_set(mrcp_engine_timer_t *timer, apr_interval_time_t timeout)
+{
+	mrcp_engine_worker_t *worker = timer->strand->worker;
+	mrcp_engine_timer_t *prev;
+
+	apr_thread_mutex_lock(worker->guard);
+	mrcp_engine_timer_remove(timer);
+	timer->expires = apr_time_now() + timeout;
+	/* timers are mostly set for similar timeouts, hence looked through from the latest */
+	for(prev = APR_RING_LAST(&worker->timers); prev != APR_RING_SENTINEL(&worker->timers,mrcp_engine_timer_t,link); prev = APR_RING_PREV(prev,link)) {
+		if(prev->expires <= timer->expires) {
+			break;
+		}
+	}
+	APR_RING_INSERT_AFTER(prev,timer,link);
+	timer->state = MRCP_ENGINE_TIMER_ARMED;
+	if(APR_RING_FIRST(&worker->timers) == timer) {
+		/* the threads wait for the expiry of the timer set before */
+		apr_thread_cond_signal(worker->wakeup);
+	}
+	apr_thread_mutex_unlock(worker->guard);
+}
+
+MRCP_DECLARE(void) mrcp_engine_timer_kill(mrcp_engine_timer_t *timer)
+{
+	mrcp_engine_worker_t *worker = timer->strand->worker;
+	apr_thread_mutex_lock(worker->guard);
+	mrcp_engine_timer_remove(timer);
+	apr_thread_mutex_unlock(worker->guard);
+}
+
+/** Move expired timers to their strands, return the time till the next expiry, -1 if none (guarded) */
+static apr_interval_time_t mrcp_engine_timers_expire(mrcp_engine_worker_t *worker)
+{
+	apr_time_t now = apr_time_now();
+	mrcp_engine_timer_t *timer;
+	while(!APR_RING_EMPTY(&worker->timers,mrcp_engine_timer_t,link)) {
+		timer = APR_RING_FIRST(&worker->timers);
+		if(timer->expires > now) {
+			return timer->expires - now;
+		}
+		APR_RING_REMOVE(timer,link);
+		timer->state = MRCP_ENGINE_TIMER_FIRED;
+		APR_RING_INSERT_TAIL(&timer->strand->fired,timer,mrcp_engine_timer_t,link);
+		mrcp_engine_strand_schedule(timer->strand);
+	}
+	return -1;
+}
+
+static void* APR_THREAD_FUNC mrcp_engine_worker_thread_proc(apr_thread_t *thread, void *data)
+{
+	mrcp_engine_worker_t *worker = data;
+	mrcp_engine_strand_t *strand;
+	mrcp_engine_job_t job;
+	apr_interval_time_t timeout;
+	apr_size_t i;
+
+	apr_thread_mutex_lock(worker->guard);
+	while(worker->running == TRUE) {
+		timeout = mrcp_engine_timers_expire(worker);
+		if(APR_RING_EMPTY(&worker->ready,mrcp_engine_strand_t,link)) {
+			if(timeout < 0) {
+				apr_thread_cond_wait(worker->wakeup,worker->guard);
+			}
+			else {
+				apr_thread_cond_timedwait(worker->wakeup,worker->guard,timeout);
+			}
+			continue;
+		}
+
+		strand = APR_RING_FIRST(&worker->ready);
+		APR_RING_REMOVE(strand,link);
+		strand->ready = FALSE;
+		strand->running = TRUE;
+		/* a busy strand takes turns with the others */
+		for(i=0; i<MRCP_ENGINE_STRAND_BATCH && mrcp_engine_strand_job_take(strand,&job) == TRUE; i++) {
+			apr_thread_mutex_unlock(worker->guard);
+			strand->handler(strand->obj,job.type,job.data);
+			apr_thread_mutex_lock(worker->guard);
+		}
+		strand->running = FALSE;
+		if(strand->count || !APR_RING_EMPTY(&strand->fired,mrcp_engine_timer_t,link)) {
+			mrcp_engine_strand_schedule(strand);
+		}
+		apr_thread_cond_broadcast(worker->idle);
+	}
+	apr_thread_mutex_unlock(worker->guard);
+	return NULL;
+}
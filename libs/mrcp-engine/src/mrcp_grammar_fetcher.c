@@ -0,0 +1,823 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef WIN32
+#pragma warning(disable: 4127)
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <apr_ring.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_file_io.h>
+#include <apr_file_info.h>
+#include <apr_network_io.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include "mrcp_grammar_fetcher.h"
+#include "apt_log.h"
+
+/** Max size of a grammar document */
+#define MRCP_GRAMMAR_MAX_SIZE      (1024 * 1024)
+/** Max size of the status line and the headers of a response */
+#define MRCP_GRAMMAR_MAX_HEADERS   (16 * 1024)
+/** Max number of redirects followed */
+#define MRCP_GRAMMAR_MAX_REDIRECTS 3
+
+/** Grammar document kept in memory */
+typedef struct mrcp_grammar_doc_t mrcp_grammar_doc_t;
+struct mrcp_grammar_doc_t {
+	/** Ring entry of the LRU list (most recently used first) */
+	APR_RING_ENTRY(mrcp_grammar_doc_t) link;
+	/** URI of the grammar */
+	const char                        *uri;
+	/** Entity tag of the document (NULL if none) */
+	const char                        *etag;
+	/** Time the document expires at */
+	apr_time_t                         expires;
+	/** The document */
+	apt_str_t                          body;
+	/** Pool the document is allocated from */
+	apr_pool_t                        *pool;
+};
+
+/** Grammar fetch */
+struct mrcp_grammar_fetch_t {
+	/** Ring entry of the queue of pending fetches */
+	APR_RING_ENTRY(mrcp_grammar_fetch_t) link;
+	/** URI of the grammar */
+	const char                          *uri;
+	/** Function to call on completion */
+	mrcp_grammar_fetch_f                 handler;
+	/** Object to pass to the function */
+	void                                *obj;
+	/** Number of references (the caller and the fetcher) */
+	apr_size_t                           ref_count;
+	/** Whether the fetch is in the queue */
+	apt_bool_t                           queued;
+	/** Whether the fetch is released before completion */
+	apt_bool_t                           cancelled;
+	/** Whether the function is being called */
+	apt_bool_t                           delivering;
+	/** Pool the fetch and its temporary data are allocated from */
+	apr_pool_t                          *pool;
+};
+
+/** Grammar fetcher */
+struct mrcp_grammar_fetcher_t {
+	/** Threads fetching grammars */
+	apr_thread_t                                   **threads;
+	/** Number of threads */
+	apr_size_t                                       thread_count;
+	/** Whether the threads are to run */
+	apt_bool_t                                       running;
+	/** Queue of pending fetches */
+	APR_RING_HEAD(mrcp_grammar_fetch_head_t, mrcp_grammar_fetch_t) queue;
+	/** LRU list of documents (most recently used first) */
+	APR_RING_HEAD(mrcp_grammar_doc_head_t, mrcp_grammar_doc_t)     docs;
+	/** Table of documents (mrcp_grammar_doc_t*) by URI */
+	apr_hash_t                                      *table;
+	/** Total size of documents */
+	apr_size_t                                       size;
+	/** Max total size of documents */
+	apr_size_t                                       max_size;
+	/** Directory to keep documents in (NULL if none) */
+	const char                                      *cache_dir;
+	/** Default max age of documents */
+	apr_interval_time_t                              max_age;
+	/** Timeout of network operations */
+	apr_interval_time_t                              timeout;
+	/** Guard of the queue, the documents and the state of fetches */
+	apr_thread_mutex_t                              *guard;
+	/** Signaled on a fetch queued or the fetcher destroyed */
+	apr_thread_cond_t                               *wakeup;
+	/** Signaled on a call of the function of a fetch completed */
+	apr_thread_cond_t                               *delivered;
+	/** Pool to allocate memory from */
+	apr_pool_t                                      *pool;
+};
+
+/** Response to a GET request */
+typedef struct mrcp_grammar_response_t mrcp_grammar_response_t;
+struct mrcp_grammar_response_t {
+	/** Status code */
+	int         status;
+	/** ETag header (NULL if none) */
+	const char *etag;
+	/** Location header (NULL if none) */
+	const char *location;
+	/** Time the document expires at by Cache-Control (0 if not set) */
+	apr_time_t  expires;
+	/** Whether the document must not be stored (Cache-Control no-store) */
+	apt_bool_t  no_store;
+	/** The document */
+	apt_str_t   body;
+};
+
+static void* APR_THREAD_FUNC mrcp_grammar_fetcher_thread_proc(apr_thread_t *thread, void *data);
+
+MRCP_DECLARE(mrcp_grammar_fetcher_t*) mrcp_grammar_fetcher_create(
+										apr_size_t thread_count,
+										const char *cache_dir,
+										apr_size_t max_size,
+										apr_interval_time_t max_age,
+										apr_interval_time_t timeout,
+										apr_pool_t *pool)
+{
+	apr_size_t i;
+	mrcp_grammar_fetcher_t *fetcher = apr_palloc(pool,sizeof(mrcp_grammar_fetcher_t));
+	fetcher->threads = apr_pcalloc(pool,sizeof(apr_thread_t*) * (thread_count ? thread_count : 1));
+	fetcher->thread_count = 0;
+	fetcher->running = TRUE;
+	APR_RING_INIT(&fetcher->queue, mrcp_grammar_fetch_t, link);
+	APR_RING_INIT(&fetcher->docs, mrcp_grammar_doc_t, link);
+	fetcher->table = apr_hash_make(pool);
+	fetcher->size = 0;
+	fetcher->max_size = max_size;
+	fetcher->cache_dir = NULL;
+	fetcher->max_age = max_age;
+	fetcher->timeout = timeout;
+	fetcher->guard = NULL;
+	fetcher->wakeup = NULL;
+	fetcher->delivered = NULL;
+	fetcher->pool = pool;
+
+	if(cache_dir) {
+		if(apr_dir_make_recursive(cache_dir,APR_OS_DEFAULT,pool) == APR_SUCCESS) {
+			fetcher->cache_dir = apr_pstrdup(pool,cache_dir);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Grammar Cache Dir [%s]",cache_dir);
+		}
+	}
+	if(apr_thread_mutex_create(&fetcher->guard,APR_THREAD_MUTEX_UNNESTED,pool) != APR_SUCCESS ||
+		apr_thread_cond_create(&fetcher->wakeup,pool) != APR_SUCCESS ||
+		apr_thread_cond_create(&fetcher->delivered,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	for(i=0; i<thread_count; i++) {
+		if(apr_thread_create(&fetcher->threads[i],NULL,mrcp_grammar_fetcher_thread_proc,fetcher,pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Grammar Fetcher Thread");
+			break;
+		}
+		fetcher->thread_count++;
+	}
+	if(!fetcher->thread_count) {
+		mrcp_grammar_fetcher_destroy(fetcher);
+		return NULL;
+	}
+	return fetcher;
+}
+
+/** Drop reference to fetch, the fetch is destroyed, if not referenced (guarded) */
+static void mrcp_grammar_fetch_unref(mrcp_grammar_fetch_t *fetch)
+{
+	if(--fetch->ref_count == 0) {
+		apr_pool_destroy(fetch->pool);
+	}
+}
+
+/** Remove document from memory (guarded) */
+static void mrcp_grammar_doc_evict(mrcp_grammar_fetcher_t *fetcher, mrcp_grammar_doc_t *doc)
+{
+	APR_RING_REMOVE(doc,link);
+	apr_hash_set(fetcher->table,doc->uri,APR_HASH_KEY_STRING,NULL);
+	fetcher->size -= doc->body.length;
+	apr_pool_destroy(doc->pool);
+}
+
+MRCP_DECLARE(void) mrcp_grammar_fetcher_destroy(mrcp_grammar_fetcher_t *fetcher)
+{
+	apr_size_t i;
+	apr_status_t rv;
+	if(fetcher->guard) {
+		apr_thread_mutex_lock(fetcher->guard);
+		fetcher->running = FALSE;
+		apr_thread_cond_broadcast(fetcher->wakeup);
+		apr_thread_mutex_unlock(fetcher->guard);
+	}
+	for(i=0; i<fetcher->thread_count; i++) {
+		apr_thread_join(&rv,fetcher->threads[i]);
+	}
+	fetcher->thread_count = 0;
+
+	while(!APR_RING_EMPTY(&fetcher->queue,mrcp_grammar_fetch_t,link)) {
+		mrcp_grammar_fetch_t *fetch = APR_RING_FIRST(&fetcher->queue);
+		APR_RING_REMOVE(fetch,link);
+		fetch->queued = FALSE;
+		mrcp_grammar_fetch_unref(fetch);
+	}
+	while(!APR_RING_EMPTY(&fetcher->docs,mrcp_grammar_doc_t,link)) {
+		mrcp_grammar_doc_evict(fetcher,APR_RING_LAST(&fetcher->docs));
+	}
+	if(fetcher->delivered) {
+		apr_thread_cond_destroy(fetcher->delivered);
+		fetcher->delivered = NULL;
+	}
+	if(fetcher->wakeup) {
+		apr_thread_cond_destroy(fetcher->wakeup);
+		fetcher->wakeup = NULL;
+	}
+	if(fetcher->guard) {
+		apr_thread_mutex_destroy(fetcher->guard);
+		fetcher->guard = NULL;
+	}
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_grammar_uri_check(const char *uri)
+{
+	return (uri && strncasecmp(uri,"http://",7) == 0) ? TRUE : FALSE;
+}
+
+/** Keep document in memory, replacing the previous one of the URI, if any (guarded) */
+static void mrcp_grammar_doc_put(mrcp_grammar_fetcher_t *fetcher, const char *uri, const char *etag, apr_time_t expires, const apt_str_t *body)
+{
+	mrcp_grammar_doc_t *doc;
+	apr_pool_t *pool;
+	doc = apr_hash_get(fetcher->table,uri,APR_HASH_KEY_STRING);
+	if(doc) {
+		mrcp_grammar_doc_evict(fetcher,doc);
+	}
+	if(body->length > fetcher->max_size) {
+		return;
+	}
+	/* documents are replaced and evicted in any order, hence a pool per document */
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return;
+	}
+	doc = apr_palloc(pool,sizeof(mrcp_grammar_doc_t));
+	APR_RING_ELEM_INIT(doc,link);
+	doc->uri = apr_pstrdup(pool,uri);
+	doc->etag = etag ? apr_pstrdup(pool,etag) : NULL;
+	doc->expires = expires;
+	apt_string_copy(&doc->body,body,pool);
+	doc->pool = pool;
+
+	/* evict the least recently used documents to fit */
+	while(fetcher->size + body->length > fetcher->max_size) {
+		mrcp_grammar_doc_evict(fetcher,APR_RING_LAST(&fetcher->docs));
+	}
+	APR_RING_INSERT_HEAD(&fetcher->docs,doc,mrcp_grammar_doc_t,link);
+	apr_hash_set(fetcher->table,doc->uri,APR_HASH_KEY_STRING,doc);
+	fetcher->size += body->length;
+}
+
+/** Find document in memory and move it to the head of the LRU list (guarded) */
+static mrcp_grammar_doc_t* mrcp_grammar_doc_find(mrcp_grammar_fetcher_t *fetcher, const char *uri)
+{
+	mrcp_grammar_doc_t *doc = apr_hash_get(fetcher->table,uri,APR_HASH_KEY_STRING);
+	if(doc) {
+		APR_RING_REMOVE(doc,link);
+		APR_RING_INSERT_HEAD(&fetcher->docs,doc,mrcp_grammar_doc_t,link);
+	}
+	return doc;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_grammar_fetcher_get(mrcp_grammar_fetcher_t *fetcher, const char *uri, apt_str_t *body, apr_pool_t *pool)
+{
+	mrcp_grammar_doc_t *doc;
+	apt_bool_t status = FALSE;
+	apr_time_t now = apr_time_now();
+	apr_thread_mutex_lock(fetcher->guard);
+	doc = mrcp_grammar_doc_find(fetcher,uri);
+	if(doc && doc->expires > now) {
+		apt_string_copy(body,&doc->body,pool);
+		status = TRUE;
+	}
+	apr_thread_mutex_unlock(fetcher->guard);
+	return status;
+}
+
+MRCP_DECLARE(mrcp_grammar_fetch_t*) mrcp_grammar_fetch_start(mrcp_grammar_fetcher_t *fetcher, const char *uri, mrcp_grammar_fetch_f handler, void *obj)
+{
+	mrcp_grammar_fetch_t *fetch;
+	apr_pool_t *pool;
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	fetch = apr_palloc(pool,sizeof(mrcp_grammar_fetch_t));
+	APR_RING_ELEM_INIT(fetch,link);
+	fetch->uri = apr_pstrdup(pool,uri);
+	fetch->handler = handler;
+	fetch->obj = obj;
+	fetch->ref_count = 2;
+	fetch->queued = TRUE;
+	fetch->cancelled = FALSE;
+	fetch->delivering = FALSE;
+	fetch->pool = pool;
+
+	apr_thread_mutex_lock(fetcher->guard);
+	APR_RING_INSERT_TAIL(&fetcher->queue,fetch,mrcp_grammar_fetch_t,link);
+	apr_thread_cond_signal(fetcher->wakeup);
+	apr_thread_mutex_unlock(fetcher->guard);
+	return fetch;
+}
+
+MRCP_DECLARE(void) mrcp_grammar_fetch_release(mrcp_grammar_fetcher_t *fetcher, mrcp_grammar_fetch_t *fetch)
+{
+	apr_thread_mutex_lock(fetcher->guard);
+	fetch->cancelled = TRUE;
+	if(fetch->queued == TRUE) {
+		APR_RING_REMOVE(fetch,link);
+		fetch->queued = FALSE;
+		mrcp_grammar_fetch_unref(fetch);
+	}
+	while(fetch->delivering == TRUE) {
+		apr_thread_cond_wait(fetcher->delivered,fetcher->guard);
+	}
+	mrcp_grammar_fetch_unref(fetch);
+	apr_thread_mutex_unlock(fetcher->guard);
+}
+
+/** Get path to the cache file of the URI */
+static const char* mrcp_grammar_file_path_get(mrcp_grammar_fetcher_t *fetcher, const char *uri, apr_pool_t *pool)
+{
+	char *path = NULL;
+	apr_ssize_t length = APR_HASH_KEY_STRING;
+	const char *file_name = apr_psprintf(pool,"%08x.grammar",apr_hashfunc_default(uri,&length));
+	if(apr_filepath_merge(&path,fetcher->cache_dir,file_name,APR_FILEPATH_NATIVE,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return path;
+}
+
+/** Get the value of a line of the cache file starting with the name */
+static char* mrcp_grammar_file_line_get(char **pos, const char *name)
+{
+	char *line = *pos;
+	char *line_end = strchr(line,'\n');
+	apr_size_t length = strlen(name);
+	if(!line_end || strncmp(line,name,length) != 0 || line[length] != ' ') {
+		return NULL;
+	}
+	*line_end = '\0';
+	*pos = line_end + 1;
+	return line + length + 1;
+}
+
+/** Read document of the URI from the cache file */
+static apt_bool_t mrcp_grammar_file_read(mrcp_grammar_fetcher_t *fetcher, const char *uri, const char **etag, apr_time_t *expires, apt_str_t *body, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	apr_size_t size;
+	char *buf;
+	char *pos;
+	const char *value;
+	const char *path = mrcp_grammar_file_path_get(fetcher,uri,pool);
+	if(!path || apr_file_open(&file,path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) != APR_SUCCESS ||
+		finfo.size <= 0 || finfo.size > MRCP_GRAMMAR_MAX_SIZE + MRCP_GRAMMAR_MAX_HEADERS) {
+		apr_file_close(file);
+		return FALSE;
+	}
+	size = (apr_size_t)finfo.size;
+	buf = apr_palloc(pool,size + 1);
+	if(apr_file_read_full(file,buf,size,&size) != APR_SUCCESS) {
+		apr_file_close(file);
+		return FALSE;
+	}
+	apr_file_close(file);
+	buf[size] = '\0';
+
+	/* the file of another URI of the same hash is not taken */
+	pos = buf;
+	value = mrcp_grammar_file_line_get(&pos,"URI");
+	if(!value || strcmp(value,uri) != 0) {
+		return FALSE;
+	}
+	value = mrcp_grammar_file_line_get(&pos,"ETag");
+	if(!value) {
+		return FALSE;
+	}
+	*etag = *value != '\0' ? value : NULL;
+	value = mrcp_grammar_file_line_get(&pos,"Expires");
+	if(!value || *pos != '\n') {
+		return FALSE;
+	}
+	*expires = (apr_time_t)apr_atoi64(value);
+	pos++;
+	body->buf = pos;
+	body->length = size - (pos - buf);
+	return TRUE;
+}
+
+/** Write document of the URI to the cache file, replacing the previous one at once */
+static void mrcp_grammar_file_write(mrcp_grammar_fetcher_t *fetcher, const char *uri, const char *etag, apr_time_t expires, const apt_str_t *body, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	const char *header;
+	const char *tmp_path;
+	apr_size_t size;
+	apt_bool_t status;
+	const char *path = mrcp_grammar_file_path_get(fetcher,uri,pool);
+	if(!path) {
+		return;
+	}
+	/* the file is named after the fetch too, another thread may write the same URI meanwhile */
+	tmp_path = apr_psprintf(pool,"%s.%pp.tmp",path,(void*)pool);
+	if(apr_file_open(&file,tmp_path,APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Grammar Cache File [%s]",tmp_path);
+		return;
+	}
+	header = apr_psprintf(pool,"URI %s\nETag %s\nExpires %" APR_TIME_T_FMT "\n\n",uri,etag ? etag : "",expires);
+	size = strlen(header);
+	status = apr_file_write_full(file,header,size,&size) == APR_SUCCESS ? TRUE : FALSE;
+	if(status == TRUE && body->length) {
+		size = body->length;
+		status = apr_file_write_full(file,body->buf,size,&size) == APR_SUCCESS ? TRUE : FALSE;
+	}
+	if(apr_file_close(file) != APR_SUCCESS) {
+		status = FALSE;
+	}
+	if(status == FALSE || apr_file_rename(tmp_path,path,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Write Grammar Cache File [%s]",path);
+		apr_file_remove(tmp_path,pool);
+	}
+}
+
+/** Remove the cache file of the URI */
+static void mrcp_grammar_file_remove(mrcp_grammar_fetcher_t *fetcher, const char *uri, apr_pool_t *pool)
+{
+	const char *path = mrcp_grammar_file_path_get(fetcher,uri,pool);
+	if(path) {
+		apr_file_remove(path,pool);
+	}
+}
+
+/** Parse Cache-Control header */
+static void mrcp_grammar_cache_control_parse(mrcp_grammar_response_t *response, const char *value)
+{
+	apr_time_t now = apr_time_now();
+	const char *pos = value;
+	while(*pos != '\0') {
+		while(*pos == ' ' || *pos == '\t' || *pos == ',') {
+			pos++;
+		}
+		if(strncasecmp(pos,"no-store",8) == 0) {
+			response->no_store = TRUE;
+		}
+		else if(strncasecmp(pos,"no-cache",8) == 0) {
+			/* kept, but revalidated on every use */
+			response->expires = now;
+		}
+		else if(strncasecmp(pos,"max-age=",8) == 0) {
+			long max_age = atol(pos + 8);
+			response->expires = max_age > 0 ? now + apr_time_from_sec(max_age) : now;
+		}
+		while(*pos != '\0' && *pos != ',') {
+			pos++;
+		}
+	}
+}
+
+/** Parse status line and headers of response, the headers end with an empty line */
+static apt_bool_t mrcp_grammar_response_parse(mrcp_grammar_response_t *response, char *buf, apr_size_t size)
+{
+	char *line = buf;
+	char *line_end;
+	char *value;
+	apr_size_t header_size;
+	apr_int64_t content_length = -1;
+	char *end = NULL;
+	apr_size_t i;
+
+	for(i=0; i+3 < size; i++) {
+		if(buf[i] == '\r' && buf[i+1] == '\n' && buf[i+2] == '\r' && buf[i+3] == '\n') {
+			end = buf + i + 2;
+			break;
+		}
+	}
+	if(!end) {
+		return FALSE;
+	}
+	*end = '\0';
+	header_size = end + 2 - buf;
+
+	/* HTTP/1.x NNN reason */
+	if(strncmp(line,"HTTP/1.",7) != 0 || strlen(line) < 12) {
+		return FALSE;
+	}
+	response->status = atoi(line + 9);
+	for(line = strstr(line,"\r\n") + 2; *line != '\0'; line = line_end + 2) {
+		line_end = strstr(line,"\r\n");
+		if(!line_end) {
+			break;
+		}
+		*line_end = '\0';
+		value = strchr(line,':');
+		if(!value) {
+			continue;
+		}
+		*value++ = '\0';
+		while(*value == ' ' || *value == '\t') {
+			value++;
+		}
+		if(strcasecmp(line,"ETag") == 0) {
+			response->etag = value;
+		}
+		else if(strcasecmp(line,"Location") == 0) {
+			response->location = value;
+		}
+		else if(strcasecmp(line,"Cache-Control") == 0) {
+			mrcp_grammar_cache_control_parse(response,value);
+		}
+		else if(strcasecmp(line,"Content-Length") == 0) {
+			content_length = apr_atoi64(value);
+		}
+		else if(strcasecmp(line,"Transfer-Encoding") == 0 && strcasecmp(value,"identity") != 0) {
+			/* not expected in response to HTTP/1.0 request */
+			return FALSE;
+		}
+	}
+
+	response->body.buf = buf + header_size;
+	response->body.length = size - header_size;
+	if(content_length >= 0) {
+		if((apr_size_t)content_length > response->body.length) {
+			/* truncated */
+			return FALSE;
+		}
+		response->body.length = (apr_size_t)content_length;
+	}
+	response->body.buf[response->body.length] = '\0';
+	return TRUE;
+}
+
+/** Split http:// URI into host, port and path */
+static apt_bool_t mrcp_grammar_uri_parse(const char *uri, char **host, apr_port_t *port, const char **path, apr_pool_t *pool)
+{
+	const char *pos = uri + 7;
+	const char *host_end;
+	const char *authority_end = pos + strcspn(pos,"/?#");
+	*port = 80;
+	if(*pos == '[') {
+		/* IPv6 literal */
+		host_end = memchr(pos,']',authority_end - pos);
+		if(!host_end) {
+			return FALSE;
+		}
+		*host = apr_pstrmemdup(pool,pos + 1,host_end - pos - 1);
+		host_end++;
+	}
+	else {
+		host_end = memchr(pos,':',authority_end - pos);
+		if(!host_end) {
+			host_end = authority_end;
+		}
+		*host = apr_pstrmemdup(pool,pos,host_end - pos);
+	}
+	if(host_end < authority_end && *host_end == ':') {
+		int value = atoi(host_end + 1);
+		if(value <= 0 || value > 65535) {
+			return FALSE;
+		}
+		*port = (apr_port_t)value;
+	}
+	if(**host == '\0') {
+		return FALSE;
+	}
+	/* the fragment is not sent */
+	*path = *authority_end == '/' ? apr_pstrndup(pool,authority_end,strcspn(authority_end,"#")) :
+		apr_pstrcat(pool,"/",apr_pstrndup(pool,authority_end,strcspn(authority_end,"#")),NULL);
+	return TRUE;
+}
+
+/** Send GET request and receive the response */
+static apt_bool_t mrcp_grammar_http_get(mrcp_grammar_fetcher_t *fetcher, const char *uri, const char *etag, mrcp_grammar_response_t *response, apr_pool_t *pool)
+{
+	apr_sockaddr_t *sockaddr;
+	apr_socket_t *sock;
+	char *host;
+	apr_port_t port;
+	const char *path;
+	const char *request;
+	apr_size_t length;
+	apr_size_t offset;
+	apr_size_t size;
+	apr_size_t capacity;
+	char *buf;
+	apr_status_t rv;
+
+	if(mrcp_grammar_uri_parse(uri,&host,&port,&path,pool) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Grammar URI [%s]",uri);
+		return FALSE;
+	}
+	if(apr_sockaddr_info_get(&sockaddr,host,APR_UNSPEC,port,0,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Resolve Grammar Host [%s]",host);
+		return FALSE;
+	}
+	if(apr_socket_create(&sock,sockaddr->family,SOCK_STREAM,APR_PROTO_TCP,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	apr_socket_timeout_set(sock,fetcher->timeout);
+	if(apr_socket_connect(sock,sockaddr) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Connect to Grammar Host [%s:%hu]",host,port);
+		apr_socket_close(sock);
+		return FALSE;
+	}
+
+	/* HTTP/1.0 is enough to revalidate and keeps the body of the response unchunked */
+	request = apr_psprintf(pool,
+		"GET %s HTTP/1.0\r\n"
+		"Host: %s:%hu\r\n"
+		"Accept: application/srgs+xml, application/srgs, text/plain, */*\r\n"
+		"User-Agent: UniMRCP\r\n"
+		"%s%s%s"
+		"\r\n",
+		path,host,port,
+		etag ? "If-None-Match: " : "",
+		etag ? etag : "",
+		etag ? "\r\n" : "");
+	length = strlen(request);
+	for(offset = 0; offset < length; offset += size) {
+		size = length - offset;
+		if(apr_socket_send(sock,request + offset,&size) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Send Grammar Request [%s]",uri);
+			apr_socket_close(sock);
+			return FALSE;
+		}
+	}
+
+	/* the response ends with the connection closed, the buffer is doubled as it fills up */
+	capacity = 4096;
+	buf = apr_palloc(pool,capacity);
+	rv = APR_SUCCESS;
+	for(offset = 0; rv == APR_SUCCESS; offset += size) {
+		if(offset + 1 == capacity) {
+			char *new_buf;
+			if(capacity >= MRCP_GRAMMAR_MAX_SIZE + MRCP_GRAMMAR_MAX_HEADERS) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Grammar Too Large [%s]",uri);
+				break;
+			}
+			new_buf = apr_palloc(pool,capacity * 2);
+			memcpy(new_buf,buf,offset);
+			buf = new_buf;
+			capacity *= 2;
+		}
+		size = capacity - 1 - offset;
+		rv = apr_socket_recv(sock,buf + offset,&size);
+	}
+	apr_socket_close(sock);
+	if(!APR_STATUS_IS_EOF(rv)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Receive Grammar [%s]",uri);
+		return FALSE;
+	}
+	buf[offset] = '\0';
+	if(mrcp_grammar_response_parse(response,buf,offset) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Grammar Response [%s]",uri);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Load grammar from memory, the cache file or the network, in that order */
+static apt_bool_t mrcp_grammar_load(mrcp_grammar_fetcher_t *fetcher, const char *uri, apt_str_t *body, apr_pool_t *pool)
+{
+	mrcp_grammar_response_t response;
+	mrcp_grammar_doc_t *doc;
+	apt_str_t stale_body;
+	const char *etag = NULL;
+	const char *location = uri;
+	apr_time_t expires = 0;
+	apr_time_t now = apr_time_now();
+	apt_bool_t stale = FALSE;
+	apr_size_t redirects;
+
+	apr_thread_mutex_lock(fetcher->guard);
+	doc = mrcp_grammar_doc_find(fetcher,uri);
+	if(doc) {
+		/* fetched by another thread meanwhile, or expired */
+		apt_string_copy(&stale_body,&doc->body,pool);
+		etag = doc->etag ? apr_pstrdup(pool,doc->etag) : NULL;
+		expires = doc->expires;
+		stale = TRUE;
+	}
+	apr_thread_mutex_unlock(fetcher->guard);
+
+	if(stale == FALSE && fetcher->cache_dir) {
+		stale = mrcp_grammar_file_read(fetcher,uri,&etag,&expires,&stale_body,pool);
+	}
+	if(stale == TRUE && expires > now) {
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Take Cached Grammar [%s]",uri);
+		if(!doc) {
+			apr_thread_mutex_lock(fetcher->guard);
+			mrcp_grammar_doc_put(fetcher,uri,etag,expires,&stale_body);
+			apr_thread_mutex_unlock(fetcher->guard);
+		}
+		*body = stale_body;
+		return TRUE;
+	}
+
+	for(redirects = 0; ; redirects++) {
+		memset(&response,0,sizeof(response));
+		if(mrcp_grammar_http_get(fetcher,location,location == uri ? etag : NULL,&response,pool) == FALSE) {
+			break;
+		}
+		if((response.status == 301 || response.status == 302 || response.status == 303 || response.status == 307 || response.status == 308) &&
+			response.location && redirects < MRCP_GRAMMAR_MAX_REDIRECTS) {
+			if(mrcp_grammar_uri_check(response.location) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unsupported Grammar Redirect [%s] -> [%s]",uri,response.location);
+				break;
+			}
+			location = response.location;
+			continue;
+		}
+		if(response.status == 304 && stale == TRUE) {
+			response.body = stale_body;
+			response.etag = etag;
+		}
+		else if(response.status != 200) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Fetch Grammar [%s] status [%d]",uri,response.status);
+			break;
+		}
+
+		if(!response.expires) {
+			response.expires = now + fetcher->max_age;
+		}
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"%s Grammar [%s] [%"APR_SIZE_T_FMT" bytes]",
+			response.status == 304 ? "Revalidate" : "Fetch",uri,response.body.length);
+		apr_thread_mutex_lock(fetcher->guard);
+		if(response.no_store == TRUE) {
+			doc = apr_hash_get(fetcher->table,uri,APR_HASH_KEY_STRING);
+			if(doc) {
+				mrcp_grammar_doc_evict(fetcher,doc);
+			}
+		}
+		else {
+			mrcp_grammar_doc_put(fetcher,uri,response.etag,response.expires,&response.body);
+		}
+		apr_thread_mutex_unlock(fetcher->guard);
+		if(fetcher->cache_dir) {
+			if(response.no_store == TRUE) {
+				mrcp_grammar_file_remove(fetcher,uri,pool);
+			}
+			else {
+				mrcp_grammar_file_write(fetcher,uri,response.etag,response.expires,&response.body,pool);
+			}
+		}
+		*body = response.body;
+		return TRUE;
+	}
+
+	if(stale == TRUE) {
+		/* better stale than none, while the server is not reachable */
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Take Stale Grammar [%s]",uri);
+		*body = stale_body;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void* APR_THREAD_FUNC mrcp_grammar_fetcher_thread_proc(apr_thread_t *thread, void *data)
+{
+	mrcp_grammar_fetcher_t *fetcher = data;
+	mrcp_grammar_fetch_t *fetch;
+	apt_str_t body;
+	apt_bool_t status;
+
+	apr_thread_mutex_lock(fetcher->guard);
+	while(fetcher->running == TRUE) {
+		if(APR_RING_EMPTY(&fetcher->queue,mrcp_grammar_fetch_t,link)) {
+			apr_thread_cond_wait(fetcher->wakeup,fetcher->guard);
+			continue;
+		}
+		fetch = APR_RING_FIRST(&fetcher->queue);
+		APR_RING_REMOVE(fetch,link);
+		fetch->queued = FALSE;
+		apr_thread_mutex_unlock(fetcher->guard);
+
+		/* the pool of the fetch is not used by the caller, while referenced by the fetcher */
+		status = mrcp_grammar_load(fetcher,fetch->uri,&body,fetch->pool);
+
+		apr_thread_mutex_lock(fetcher->guard);
+		if(fetch->cancelled == FALSE) {
+			fetch->delivering = TRUE;
+			apr_thread_mutex_unlock(fetcher->guard);
+			fetch->handler(fetch->obj,fetch->uri,status == TRUE ? &body : NULL);
+			apr_thread_mutex_lock(fetcher->guard);
+			fetch->delivering = FALSE;
+			apr_thread_cond_broadcast(fetcher->delivered);
+		}
+		mrcp_grammar_fetch_unref(fetch);
+	}
+	apr_thread_mutex_unlock(fetcher->guard);
+	return NULL;
+}
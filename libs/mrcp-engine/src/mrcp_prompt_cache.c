@@ -0,0 +1,214 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifdef WIN32
+#pragma warning(disable: 4127)
+#endif
+#include <string.h>
+#include <apr_ring.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+#include "mrcp_prompt_cache.h"
+#include "apt_log.h"
+
+/** Prompt */
+struct mrcp_prompt_t {
+	/** Ring entry of the LRU list (most recently used first) */
+	APR_RING_ENTRY(mrcp_prompt_t) link;
+	/** Key of the prompt */
+	const char                   *key;
+	/** Audio of the prompt */
+	void                         *data;
+	/** Size of the audio */
+	apr_size_t                    size;
+	/** Number of references */
+	apr_size_t                    ref_count;
+	/** Whether the prompt is in the cache (not evicted yet) */
+	apt_bool_t                    cached;
+	/** Pool the prompt is allocated from */
+	apr_pool_t                   *pool;
+};
+
+/** Prompt cache */
+struct mrcp_prompt_cache_t {
+	/** LRU list of cached prompts (most recently used first) */
+	APR_RING_HEAD(mrcp_prompt_head_t, mrcp_prompt_t) head;
+	/** Table of cached prompts (mrcp_prompt_t*) by key */
+	apr_hash_t                                      *table;
+	/** Total size of cached prompts */
+	apr_size_t                                       size;
+	/** Max total size of cached prompts */
+	apr_size_t                                       max_size;
+	/** Guard of the cache and the references of prompts */
+	apr_thread_mutex_t                              *guard;
+	/** Pool to allocate memory from */
+	apr_pool_t                                      *pool;
+};
+
+MRCP_DECLARE(mrcp_prompt_cache_t*) mrcp_prompt_cache_create(apr_size_t max_size, apr_pool_t *pool)
+{
+	mrcp_prompt_cache_t *cache = apr_palloc(pool,sizeof(mrcp_prompt_cache_t));
+	APR_RING_INIT(&cache->head, mrcp_prompt_t, link);
+	cache->table = apr_hash_make(pool);
+	cache->size = 0;
+	cache->max_size = max_size;
+	cache->guard = NULL;
+	cache->pool = pool;
+	if(apr_thread_mutex_create(&cache->guard,APR_THREAD_MUTEX_UNNESTED,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return cache;
+}
+
+/** Create prompt, the audio is copied to the pool of the prompt */
+static mrcp_prompt_t* mrcp_prompt_create(const char *key, const void *data, apr_size_t size)
+{
+	mrcp_prompt_t *prompt;
+	apr_pool_t *pool;
+	/* prompts outlive each other in any order, hence a pool per prompt */
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	prompt = apr_palloc(pool,sizeof(mrcp_prompt_t));
+	APR_RING_ELEM_INIT(prompt,link);
+	prompt->key = apr_pstrdup(pool,key);
+	prompt->data = apr_palloc(pool,size ? size : 1);
+	memcpy(prompt->data,data,size);
+	prompt->size = size;
+	prompt->ref_count = 0;
+	prompt->cached = FALSE;
+	prompt->pool = pool;
+	return prompt;
+}
+
+/** Remove prompt from the cache, the prompt is destroyed, if not referenced (guarded) */
+static void mrcp_prompt_evict(mrcp_prompt_cache_t *cache, mrcp_prompt_t *prompt)
+{
+	APR_RING_REMOVE(prompt,link);
+	apr_hash_set(cache->table,prompt->key,APR_HASH_KEY_STRING,NULL);
+	cache->size -= prompt->size;
+	prompt->cached = FALSE;
+	if(!prompt->ref_count) {
+		apr_pool_destroy(prompt->pool);
+	}
+}
+
+MRCP_DECLARE(void) mrcp_prompt_cache_destroy(mrcp_prompt_cache_t *cache)
+{
+	while(!APR_RING_EMPTY(&cache->head,mrcp_prompt_t,link)) {
+		mrcp_prompt_evict(cache,APR_RING_LAST(&cache->head));
+	}
+	if(cache->guard) {
+		apr_thread_mutex_destroy(cache->guard);
+		cache->guard = NULL;
+	}
+}
+
+MRCP_DECLARE(const char*) mrcp_prompt_key_create(const mpf_codec_descriptor_t *descriptor, const void *content, apr_size_t length, apr_pool_t *pool)
+{
+	/* 64-bit FNV-1a */
+	apr_uint64_t hash = APR_UINT64_C(14695981039346656037);
+	const unsigned char *pos = content;
+	const unsigned char *end = pos + length;
+	for(; pos < end; pos++) {
+		hash ^= *pos;
+		hash *= APR_UINT64_C(1099511628211);
+	}
+	return apr_psprintf(pool,"%s/%d/%d/%08x%08x",
+		descriptor->name.buf ? descriptor->name.buf : "",
+		descriptor->sampling_rate,
+		descriptor->channel_count,
+		(apr_uint32_t)(hash >> 32),
+		(apr_uint32_t)(hash & 0xffffffff));
+}
+
+MRCP_DECLARE(mrcp_prompt_t*) mrcp_prompt_cache_get(mrcp_prompt_cache_t *cache, const char *key)
+{
+	mrcp_prompt_t *prompt;
+	apr_thread_mutex_lock(cache->guard);
+	prompt = apr_hash_get(cache->table,key,APR_HASH_KEY_STRING);
+	if(prompt) {
+		/* move to the head of the LRU list */
+		APR_RING_REMOVE(prompt,link);
+		APR_RING_INSERT_HEAD(&cache->head,prompt,mrcp_prompt_t,link);
+		prompt->ref_count++;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+	return prompt;
+}
+
+MRCP_DECLARE(mrcp_prompt_t*) mrcp_prompt_cache_put(mrcp_prompt_cache_t *cache, const char *key, const void *data, apr_size_t size)
+{
+	mrcp_prompt_t *prompt;
+	mrcp_prompt_t *cached_prompt;
+	/* copy outside of the guard */
+	prompt = mrcp_prompt_create(key,data,size);
+	if(!prompt) {
+		return NULL;
+	}
+	prompt->ref_count = 1;
+
+	apr_thread_mutex_lock(cache->guard);
+	cached_prompt = apr_hash_get(cache->table,key,APR_HASH_KEY_STRING);
+	if(cached_prompt) {
+		/* added concurrently, use the cached one */
+		APR_RING_REMOVE(cached_prompt,link);
+		APR_RING_INSERT_HEAD(&cache->head,cached_prompt,mrcp_prompt_t,link);
+		cached_prompt->ref_count++;
+		apr_thread_mutex_unlock(cache->guard);
+		apr_pool_destroy(prompt->pool);
+		return cached_prompt;
+	}
+
+	if(size <= cache->max_size) {
+		/* evict the least recently used prompts to fit */
+		while(cache->size + size > cache->max_size) {
+			mrcp_prompt_evict(cache,APR_RING_LAST(&cache->head));
+		}
+		APR_RING_INSERT_HEAD(&cache->head,prompt,mrcp_prompt_t,link);
+		apr_hash_set(cache->table,prompt->key,APR_HASH_KEY_STRING,prompt);
+		cache->size += size;
+		prompt->cached = TRUE;
+	}
+	apr_thread_mutex_unlock(cache->guard);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"%s Prompt [%s] [%"APR_SIZE_T_FMT" bytes]",
+		prompt->cached == TRUE ? "Cache" : "Do Not Cache",key,size);
+	return prompt;
+}
+
+MRCP_DECLARE(void) mrcp_prompt_release(mrcp_prompt_cache_t *cache, mrcp_prompt_t *prompt)
+{
+	apt_bool_t destroy;
+	apr_thread_mutex_lock(cache->guard);
+	destroy = (--prompt->ref_count == 0 && prompt->cached == FALSE) ? TRUE : FALSE;
+	apr_thread_mutex_unlock(cache->guard);
+	if(destroy == TRUE) {
+		apr_pool_destroy(prompt->pool);
+	}
+}
+
+MRCP_DECLARE(const void*) mrcp_prompt_data_get(const mrcp_prompt_t *prompt)
+{
+	return prompt->data;
+}
+
+MRCP_DECLARE(apr_size_t) mrcp_prompt_size_get(const mrcp_prompt_t *prompt)
+{
+	return prompt->size;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include <apr_atomic.h>
+#include <apr_time.h>
+#include "mrcp_synth_stream.h"
+#include "apt_spsc_queue.h"
+
+/** Synth stream */
+struct mrcp_synth_stream_t {
+	/** Ring of frames */
+	apt_spsc_queue_t     *frames;
+	/** Size of a frame in bytes */
+	apr_size_t            frame_size;
+	/** Number of frames to buffer before the playback starts */
+	apr_size_t            lead_frames;
+
+	/** Chunk of less than a frame (producer only) */
+	char                 *staging;
+	/** Size of the staged chunk (producer only) */
+	apr_size_t            staged;
+	/** Whether the playback has started (consumer only) */
+	apt_bool_t            playing;
+	/** Whether an underrun is in progress (consumer only) */
+	apt_bool_t            underrun;
+
+	/** Whether the producer has completed */
+	volatile apr_uint32_t completed;
+	/** Whether the stream is aborted */
+	volatile apr_uint32_t aborted;
+
+	/** Number of frames written (producer only) */
+	volatile apr_uint32_t written;
+	/** Number of frames played (consumer only) */
+	volatile apr_uint32_t played;
+	/** Number of underruns (consumer only) */
+	volatile apr_uint32_t underruns;
+	/** Number of frame times with no audio during underruns (consumer only) */
+	volatile apr_uint32_t underrun_frames;
+};
+
+MRCP_DECLARE(mrcp_synth_stream_t*) mrcp_synth_stream_create(
+										const mpf_codec_descriptor_t *descriptor,
+										apr_size_t capacity,
+										apr_size_t lead_time,
+										apr_pool_t *pool)
+{
+	mrcp_synth_stream_t *stream;
+	apr_size_t frames = capacity / CODEC_FRAME_TIME_BASE;
+	if(!descriptor || !frames) {
+		return NULL;
+	}
+
+	stream = apr_palloc(pool,sizeof(mrcp_synth_stream_t));
+	stream->frame_size = mpf_codec_linear_frame_size_calculate(descriptor->sampling_rate,descriptor->channel_count);
+	if(!stream->frame_size) {
+		return NULL;
+	}
+	stream->frames = apt_spsc_queue_create(frames,stream->frame_size,pool);
+	if(!stream->frames) {
+		return NULL;
+	}
+	stream->lead_frames = lead_time / CODEC_FRAME_TIME_BASE;
+	if(stream->lead_frames > frames) {
+		stream->lead_frames = frames;
+	}
+	stream->staging = apr_palloc(pool,stream->frame_size);
+	mrcp_synth_stream_reset(stream);
+	mrcp_synth_stream_stats_reset(stream);
+	return stream;
+}
+
+MRCP_DECLARE(void) mrcp_synth_stream_reset(mrcp_synth_stream_t *stream)
+{
+	while(apt_spsc_queue_read_begin(stream->frames)) {
+		apt_spsc_queue_read_commit(stream->frames);
+	}
+	stream->staged = 0;
+	stream->playing = FALSE;
+	stream->underrun = FALSE;
+	apr_atomic_set32(&stream->completed,0);
+	apr_atomic_set32(&stream->aborted,0);
+}
+
+/** Move the staged frame to the ring (producer side) */
+static apt_bool_t mrcp_synth_stream_staged_flush(mrcp_synth_stream_t *stream)
+{
+	void *slot = apt_spsc_queue_write_begin(stream->frames);
+	if(!slot) {
+		return FALSE;
+	}
+	memcpy(slot,stream->staging,stream->frame_size);
+	apt_spsc_queue_write_commit(stream->frames);
+	apr_atomic_inc32(&stream->written);
+	stream->staged = 0;
+	return TRUE;
+}
+
+MRCP_DECLARE(apr_size_t) mrcp_synth_stream_write(mrcp_synth_stream_t *stream, const void *data, apr_size_t size)
+{
+	const char *pos = data;
+	apr_size_t accepted = 0;
+	apr_size_t count;
+	void *slot;
+
+	if(apr_atomic_read32(&stream->aborted) || apr_atomic_read32(&stream->completed)) {
+		return 0;
+	}
+	/* the frame staged by the previous write goes first */
+	if(stream->staged == stream->frame_size && mrcp_synth_stream_staged_flush(stream) == FALSE) {
+		return 0;
+	}
+
+	while(accepted < size) {
+		if(stream->staged || size - accepted < stream->frame_size) {
+			/* complete the staged frame, or stage the trailing chunk */
+			count = stream->frame_size - stream->staged;
+			if(count > size - accepted) {
+				count = size - accepted;
+			}
+			memcpy(stream->staging + stream->staged,pos + accepted,count);
+			stream->staged += count;
+			accepted += count;
+			if(stream->staged == stream->frame_size && mrcp_synth_stream_staged_flush(stream) == FALSE) {
+				/* the frame stays staged till there is room */
+				break;
+			}
+			continue;
+		}
+
+		/* whole frames are copied into the ring at once */
+		slot = apt_spsc_queue_write_begin(stream->frames);
+		if(!slot) {
+			break;
+		}
+		memcpy(slot,pos + accepted,stream->frame_size);
+		apt_spsc_queue_write_commit(stream->frames);
+		apr_atomic_inc32(&stream->written);
+		accepted += stream->frame_size;
+	}
+	return accepted;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_synth_stream_write_wait(mrcp_synth_stream_t *stream, apr_size_t timeout)
+{
+	apr_size_t waited = 0;
+	while(!apr_atomic_read32(&stream->aborted)) {
+		if(apt_spsc_queue_size(stream->frames) < apt_spsc_queue_capacity(stream->frames)) {
+			return TRUE;
+		}
+		if(waited >= timeout) {
+			break;
+		}
+		apr_sleep(CODEC_FRAME_TIME_BASE * 1000);
+		waited += CODEC_FRAME_TIME_BASE;
+	}
+	return FALSE;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_synth_stream_complete(mrcp_synth_stream_t *stream)
+{
+	if(stream->staged) {
+		/* the last frame is padded with silence */
+		memset(stream->staging + stream->staged,0,stream->frame_size - stream->staged);
+		stream->staged = stream->frame_size;
+		if(mrcp_synth_stream_staged_flush(stream) == FALSE) {
+			return FALSE;
+		}
+	}
+	/* the frames written are visible to the consumer before the completion */
+	apr_atomic_set32(&stream->completed,1);
+	return TRUE;
+}
+
+MRCP_DECLARE(void) mrcp_synth_stream_abort(mrcp_synth_stream_t *stream)
+{
+	apr_atomic_set32(&stream->aborted,1);
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_synth_stream_is_aborted(const mrcp_synth_stream_t *stream)
+{
+	return apr_atomic_read32((volatile apr_uint32_t*)&stream->aborted) ? TRUE : FALSE;
+}
+
+MRCP_DECLARE(mrcp_synth_stream_status_e) mrcp_synth_stream_read(mrcp_synth_stream_t *stream, mpf_frame_t *frame)
+{
+	apr_uint32_t completed;
+	void *slot;
+
+	if(apr_atomic_read32(&stream->aborted)) {
+		/* drop what is buffered, the producer writes no more */
+		while(apt_spsc_queue_read_begin(stream->frames)) {
+			apt_spsc_queue_read_commit(stream->frames);
+		}
+		return MRCP_SYNTH_STREAM_COMPLETE;
+	}
+
+	/* the completion is read ahead of the ring, so that no frame committed before it is missed */
+	completed = apr_atomic_read32(&stream->completed);
+	if(stream->playing == FALSE) {
+		if(!completed && apt_spsc_queue_size(stream->frames) < stream->lead_frames) {
+			return MRCP_SYNTH_STREAM_BUFFERING;
+		}
+		stream->playing = TRUE;
+	}
+
+	slot = apt_spsc_queue_read_begin(stream->frames);
+	if(slot) {
+		apr_size_t size = frame->codec_frame.size;
+		if(size > stream->frame_size) {
+			size = stream->frame_size;
+		}
+		memcpy(frame->codec_frame.buffer,slot,size);
+		frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+		apt_spsc_queue_read_commit(stream->frames);
+		apr_atomic_inc32(&stream->played);
+		stream->underrun = FALSE;
+		return MRCP_SYNTH_STREAM_AUDIO;
+	}
+
+	if(completed) {
+		return MRCP_SYNTH_STREAM_COMPLETE;
+	}
+
+	/* the playback resumes as soon as the next frame is written */
+	if(stream->underrun == FALSE) {
+		stream->underrun = TRUE;
+		apr_atomic_inc32(&stream->underruns);
+	}
+	apr_atomic_inc32(&stream->underrun_frames);
+	return MRCP_SYNTH_STREAM_UNDERRUN;
+}
+
+MRCP_DECLARE(apr_size_t) mrcp_synth_stream_buffered_get(const mrcp_synth_stream_t *stream)
+{
+	return apt_spsc_queue_size(stream->frames) * CODEC_FRAME_TIME_BASE;
+}
+
+MRCP_DECLARE(void) mrcp_synth_stream_stats_get(const mrcp_synth_stream_t *stream, mrcp_synth_stream_stats_t *stats)
+{
+	stats->written = apr_atomic_read32((volatile apr_uint32_t*)&stream->written);
+	stats->played = apr_atomic_read32((volatile apr_uint32_t*)&stream->played);
+	stats->underruns = apr_atomic_read32((volatile apr_uint32_t*)&stream->underruns);
+	stats->underrun_frames = apr_atomic_read32((volatile apr_uint32_t*)&stream->underrun_frames);
+}
+
+MRCP_DECLARE(void) mrcp_synth_stream_stats_reset(mrcp_synth_stream_t *stream)
+{
+	apr_atomic_set32(&stream->written,0);
+	apr_atomic_set32(&stream->played,0);
+	apr_atomic_set32(&stream->underruns,0);
+	apr_atomic_set32(&stream->underrun_frames,0);
+}
@@ -0,0 +1,499 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <math.h>
+#include <apr_strings.h>
+#include <apr_tables.h>
+#include <apr_hash.h>
+#include <apr_file_io.h>
+#include <apr_file_info.h>
+#include <apr_mmap.h>
+#include <apr_thread_rwlock.h>
+#include "mrcp_voiceprint_store.h"
+#include "apt_log.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MRCP_VOICEPRINT_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MRCP_VOICEPRINT_NEON
+#include <arm_neon.h>
+#endif
+
+#define MRCP_VOICEPRINT_MAGIC   "VPIX"
+#define MRCP_VOICEPRINT_VERSION 1
+
+/** Number of records per block of the records enrolled since open */
+#define MRCP_VOICEPRINT_BLOCK_SIZE 64
+
+/** Header of the file of the store */
+typedef struct mrcp_voiceprint_header_t mrcp_voiceprint_header_t;
+struct mrcp_voiceprint_header_t {
+	char         magic[4];
+	apr_uint32_t version;
+	apr_uint32_t size;
+	apr_uint32_t reserved;
+};
+
+/** Enrolled speaker */
+typedef struct mrcp_voiceprint_speaker_t mrcp_voiceprint_speaker_t;
+struct mrcp_voiceprint_speaker_t {
+	/** The id of the speaker */
+	const char         *id;
+	/** Array of the numbers (apr_size_t) of the records of the speaker */
+	apr_array_header_t *records;
+};
+
+/** Voiceprint store */
+struct mrcp_voiceprint_store_t {
+	/** Path to the file */
+	const char          *path;
+	/** Records enrolled before open, mapped from the file (NULL if none) */
+	const char          *records;
+	/** Number of mapped records */
+	apr_size_t           mapped_count;
+	/** Array of blocks (char*) of the records enrolled since open */
+	apr_array_header_t  *blocks;
+	/** Number of records enrolled since open */
+	apr_size_t           enrolled_count;
+	/** Table of speakers (mrcp_voiceprint_speaker_t*) by id */
+	apr_hash_t          *speakers;
+	/** Size of vectors (0 till the first voiceprint is enrolled) */
+	apr_size_t           size;
+	/** Size of a record */
+	apr_size_t           record_size;
+	/** File records are appended to (opened on the first enrollment) */
+	apr_file_t          *file;
+	/** Guards the enrolled records against concurrent enrollment */
+	apr_thread_rwlock_t *lock;
+	/** Pool of the store, only allocated from with the write lock held */
+	apr_pool_t          *pool;
+};
+
+/** Compute dot product of two vectors */
+static float mrcp_voiceprint_dot(const float *a, const float *b, apr_size_t size)
+{
+	apr_size_t i = 0;
+	float sum = 0;
+#if defined(MRCP_VOICEPRINT_SSE2)
+	{
+		float lanes[4];
+		__m128 acc = _mm_setzero_ps();
+		for(; i + 4 <= size; i += 4) {
+			acc = _mm_add_ps(acc,_mm_mul_ps(_mm_loadu_ps(a + i),_mm_loadu_ps(b + i)));
+		}
+		_mm_storeu_ps(lanes,acc);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#elif defined(MRCP_VOICEPRINT_NEON)
+	{
+		float lanes[4];
+		float32x4_t acc = vdupq_n_f32(0);
+		for(; i + 4 <= size; i += 4) {
+			acc = vmlaq_f32(acc,vld1q_f32(a + i),vld1q_f32(b + i));
+		}
+		vst1q_f32(lanes,acc);
+		sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#endif
+	for(; i < size; i++) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+/** Score contiguous records, four at a time, loading each lane of the vector once per four records */
+static void mrcp_voiceprint_batch_score(const char *records, apr_size_t count, apr_size_t record_size, const float *vector, apr_size_t size, float *scores)
+{
+	apr_size_t r = 0;
+#if defined(MRCP_VOICEPRINT_SSE2) || defined(MRCP_VOICEPRINT_NEON)
+	for(; r + 4 <= count; r += 4) {
+		const float *a0 = (const float*)(records + r * record_size + MRCP_VOICEPRINT_ID_SIZE);
+		const float *a1 = (const float*)((const char*)a0 + record_size);
+		const float *a2 = (const float*)((const char*)a1 + record_size);
+		const float *a3 = (const float*)((const char*)a2 + record_size);
+		apr_size_t i = 0;
+#if defined(MRCP_VOICEPRINT_SSE2)
+		__m128 v;
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		__m128 acc2 = _mm_setzero_ps();
+		__m128 acc3 = _mm_setzero_ps();
+		for(; i + 4 <= size; i += 4) {
+			v = _mm_loadu_ps(vector + i);
+			acc0 = _mm_add_ps(acc0,_mm_mul_ps(v,_mm_loadu_ps(a0 + i)));
+			acc1 = _mm_add_ps(acc1,_mm_mul_ps(v,_mm_loadu_ps(a1 + i)));
+			acc2 = _mm_add_ps(acc2,_mm_mul_ps(v,_mm_loadu_ps(a2 + i)));
+			acc3 = _mm_add_ps(acc3,_mm_mul_ps(v,_mm_loadu_ps(a3 + i)));
+		}
+		/* sum the lanes of the four accumulators at once */
+		_MM_TRANSPOSE4_PS(acc0,acc1,acc2,acc3);
+		_mm_storeu_ps(scores + r,_mm_add_ps(_mm_add_ps(acc0,acc1),_mm_add_ps(acc2,acc3)));
+#else
+		float32x4_t v;
+		float32x4_t acc0 = vdupq_n_f32(0);
+		float32x4_t acc1 = vdupq_n_f32(0);
+		float32x4_t acc2 = vdupq_n_f32(0);
+		float32x4_t acc3 = vdupq_n_f32(0);
+		float32x2_t sum01;
+		float32x2_t sum23;
+		for(; i + 4 <= size; i += 4) {
+			v = vld1q_f32(vector + i);
+			acc0 = vmlaq_f32(acc0,v,vld1q_f32(a0 + i));
+			acc1 = vmlaq_f32(acc1,v,vld1q_f32(a1 + i));
+			acc2 = vmlaq_f32(acc2,v,vld1q_f32(a2 + i));
+			acc3 = vmlaq_f32(acc3,v,vld1q_f32(a3 + i));
+		}
+		sum01 = vpadd_f32(vpadd_f32(vget_low_f32(acc0),vget_high_f32(acc0)),vpadd_f32(vget_low_f32(acc1),vget_high_f32(acc1)));
+		sum23 = vpadd_f32(vpadd_f32(vget_low_f32(acc2),vget_high_f32(acc2)),vpadd_f32(vget_low_f32(acc3),vget_high_f32(acc3)));
+		vst1q_f32(scores + r,vcombine_f32(sum01,sum23));
+#endif
+		for(; i < size; i++) {
+			scores[r]   += vector[i] * a0[i];
+			scores[r+1] += vector[i] * a1[i];
+			scores[r+2] += vector[i] * a2[i];
+			scores[r+3] += vector[i] * a3[i];
+		}
+	}
+#endif
+	for(; r < count; r++) {
+		scores[r] = mrcp_voiceprint_dot((const float*)(records + r * record_size + MRCP_VOICEPRINT_ID_SIZE),vector,size);
+	}
+}
+
+/** Scale vector to the unit length, so that the cosine score is a dot product */
+static apt_bool_t mrcp_voiceprint_normalize(const float *vector, float *normalized, apr_size_t size)
+{
+	apr_size_t i;
+	float norm = (float)sqrt(mrcp_voiceprint_dot(vector,vector,size));
+	if(norm <= 0) {
+		return FALSE;
+	}
+	for(i=0; i<size; i++) {
+		normalized[i] = vector[i] / norm;
+	}
+	return TRUE;
+}
+
+/** Get a record by number */
+static APR_INLINE const char* mrcp_voiceprint_record_get(const mrcp_voiceprint_store_t *store, apr_size_t number)
+{
+	if(number < store->mapped_count) {
+		return store->records + number * store->record_size;
+	}
+	number -= store->mapped_count;
+	return APR_ARRAY_IDX(store->blocks,number / MRCP_VOICEPRINT_BLOCK_SIZE,const char*) +
+		(number % MRCP_VOICEPRINT_BLOCK_SIZE) * store->record_size;
+}
+
+/** Add a record to the index of speakers (called with the write lock held or before the store is shared) */
+static void mrcp_voiceprint_speaker_add(mrcp_voiceprint_store_t *store, const char *id, apr_size_t number)
+{
+	mrcp_voiceprint_speaker_t *speaker = apr_hash_get(store->speakers,id,APR_HASH_KEY_STRING);
+	if(!speaker) {
+		speaker = apr_palloc(store->pool,sizeof(mrcp_voiceprint_speaker_t));
+		speaker->id = id;
+		speaker->records = apr_array_make(store->pool,1,sizeof(apr_size_t));
+		apr_hash_set(store->speakers,speaker->id,APR_HASH_KEY_STRING,speaker);
+	}
+	APR_ARRAY_PUSH(speaker->records,apr_size_t) = number;
+}
+
+/** Check the vector to score and normalize it */
+static apt_bool_t mrcp_voiceprint_vector_prepare(const mrcp_voiceprint_store_t *store, const float *vector, apr_size_t size, float *normalized)
+{
+	if(size != store->size) {
+		if(store->size) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Voiceprint Size Mismatch [%"APR_SIZE_T_FMT"] store [%"APR_SIZE_T_FMT"]",
+				size,store->size);
+		}
+		return FALSE;
+	}
+	return mrcp_voiceprint_normalize(vector,normalized,size);
+}
+
+MRCP_DECLARE(mrcp_voiceprint_store_t*) mrcp_voiceprint_store_open(const char *path, apr_pool_t *pool)
+{
+	mrcp_voiceprint_store_t *store;
+	mrcp_voiceprint_header_t header;
+	apr_finfo_t finfo;
+	apr_file_t *file;
+	apr_mmap_t *mm;
+	apr_pool_t *subpool;
+	apr_size_t length;
+	apr_size_t i;
+	const char *record;
+
+	if(apr_pool_create(&subpool,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	store = apr_palloc(subpool,sizeof(mrcp_voiceprint_store_t));
+	store->path = apr_pstrdup(subpool,path);
+	store->records = NULL;
+	store->mapped_count = 0;
+	store->blocks = apr_array_make(subpool,4,sizeof(char*));
+	store->enrolled_count = 0;
+	store->speakers = apr_hash_make(subpool);
+	store->size = 0;
+	store->record_size = 0;
+	store->file = NULL;
+	store->pool = subpool;
+	if(apr_thread_rwlock_create(&store->lock,subpool) != APR_SUCCESS) {
+		apr_pool_destroy(subpool);
+		return NULL;
+	}
+
+	if(apr_stat(&finfo,path,APR_FINFO_SIZE,subpool) != APR_SUCCESS || finfo.size == 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"No Voiceprints Enrolled [%s]",path);
+		return store;
+	}
+	if(apr_file_open(&file,path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,subpool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Voiceprint Store [%s]",path);
+		apr_pool_destroy(subpool);
+		return NULL;
+	}
+	length = sizeof(header);
+	if(apr_file_read_full(file,&header,length,&length) != APR_SUCCESS ||
+		memcmp(header.magic,MRCP_VOICEPRINT_MAGIC,sizeof(header.magic)) != 0 ||
+		header.version != MRCP_VOICEPRINT_VERSION ||
+		!header.size || header.size > MRCP_VOICEPRINT_MAX_SIZE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Voiceprint Store [%s]",path);
+		apr_file_close(file);
+		apr_pool_destroy(subpool);
+		return NULL;
+	}
+	store->size = header.size;
+	store->record_size = MRCP_VOICEPRINT_ID_SIZE + header.size * sizeof(float);
+	/* a record cut by an interrupted enrollment is ignored */
+	store->mapped_count = ((apr_size_t)finfo.size - sizeof(header)) / store->record_size;
+	if(store->mapped_count) {
+		if(apr_mmap_create(&mm,file,0,sizeof(header) + store->mapped_count * store->record_size,APR_MMAP_READ,subpool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Map Voiceprint Store [%s]",path);
+			apr_file_close(file);
+			apr_pool_destroy(subpool);
+			return NULL;
+		}
+		store->records = (const char*)mm->mm + sizeof(header);
+	}
+	/* the mapping outlives the file */
+	apr_file_close(file);
+
+	for(i=0, record=store->records; i<store->mapped_count; i++, record+=store->record_size) {
+		if(*record == '\0' || record[MRCP_VOICEPRINT_ID_SIZE-1] != '\0') {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Voiceprint Record [%s] [%"APR_SIZE_T_FMT"]",path,i);
+			apr_pool_destroy(subpool);
+			return NULL;
+		}
+		mrcp_voiceprint_speaker_add(store,record,i);
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Open Voiceprint Store [%s] [%"APR_SIZE_T_FMT" voiceprints] [%u speakers]",
+		path,store->mapped_count,apr_hash_count(store->speakers));
+	return store;
+}
+
+MRCP_DECLARE(void) mrcp_voiceprint_store_close(mrcp_voiceprint_store_t *store)
+{
+	if(store->file) {
+		apr_file_close(store->file);
+		store->file = NULL;
+	}
+	apr_thread_rwlock_destroy(store->lock);
+	/* unmap the records */
+	apr_pool_destroy(store->pool);
+}
+
+MRCP_DECLARE(apr_size_t) mrcp_voiceprint_store_count_get(mrcp_voiceprint_store_t *store)
+{
+	apr_size_t count;
+	apr_thread_rwlock_rdlock(store->lock);
+	count = store->mapped_count + store->enrolled_count;
+	apr_thread_rwlock_unlock(store->lock);
+	return count;
+}
+
+/** Open the file to append records to, writing the header to a new one (called with the write lock held) */
+static apt_bool_t mrcp_voiceprint_file_open(mrcp_voiceprint_store_t *store)
+{
+	apr_finfo_t finfo;
+	apr_int32_t flags = APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_APPEND | APR_FOPEN_BINARY;
+	if(apr_file_open(&store->file,store->path,flags,APR_OS_DEFAULT,store->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Voiceprint Store [%s]",store->path);
+		store->file = NULL;
+		return FALSE;
+	}
+	if(apr_file_info_get(&finfo,APR_FINFO_SIZE,store->file) == APR_SUCCESS && finfo.size == 0) {
+		mrcp_voiceprint_header_t header;
+		memcpy(header.magic,MRCP_VOICEPRINT_MAGIC,sizeof(header.magic));
+		header.version = MRCP_VOICEPRINT_VERSION;
+		header.size = (apr_uint32_t)store->size;
+		header.reserved = 0;
+		if(apr_file_write_full(store->file,&header,sizeof(header),NULL) != APR_SUCCESS) {
+			apr_file_close(store->file);
+			store->file = NULL;
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_voiceprint_store_enroll(mrcp_voiceprint_store_t *store, const char *id, const float *vector, apr_size_t size)
+{
+	char *record;
+	apr_size_t slot;
+	apt_bool_t status = FALSE;
+	if(!id || *id == '\0' || strlen(id) >= MRCP_VOICEPRINT_ID_SIZE || !size || size > MRCP_VOICEPRINT_MAX_SIZE) {
+		return FALSE;
+	}
+
+	apr_thread_rwlock_wrlock(store->lock);
+	if(!store->size) {
+		/* the first voiceprint sets the size of vectors */
+		store->size = size;
+		store->record_size = MRCP_VOICEPRINT_ID_SIZE + size * sizeof(float);
+	}
+	if(size != store->size) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Voiceprint Size Mismatch [%"APR_SIZE_T_FMT"] store [%"APR_SIZE_T_FMT"]",
+			size,store->size);
+	}
+	else if(store->file || mrcp_voiceprint_file_open(store) == TRUE) {
+		slot = store->enrolled_count % MRCP_VOICEPRINT_BLOCK_SIZE;
+		if(slot == 0) {
+			/* records of a block are contiguous, so that they are scored in batches */
+			APR_ARRAY_PUSH(store->blocks,char*) = apr_palloc(store->pool,MRCP_VOICEPRINT_BLOCK_SIZE * store->record_size);
+		}
+		record = APR_ARRAY_IDX(store->blocks,store->blocks->nelts - 1,char*) + slot * store->record_size;
+		memset(record,0,MRCP_VOICEPRINT_ID_SIZE);
+		apr_cpystrn(record,id,MRCP_VOICEPRINT_ID_SIZE);
+		if(mrcp_voiceprint_normalize(vector,(float*)(record + MRCP_VOICEPRINT_ID_SIZE),size) == TRUE &&
+			apr_file_write_full(store->file,record,store->record_size,NULL) == APR_SUCCESS &&
+			apr_file_flush(store->file) == APR_SUCCESS) {
+			mrcp_voiceprint_speaker_add(store,record,store->mapped_count + store->enrolled_count);
+			store->enrolled_count++;
+			status = TRUE;
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Enroll Voiceprint [%s]",id);
+		}
+	}
+	apr_thread_rwlock_unlock(store->lock);
+	return status;
+}
+
+/** Add a scored speaker to the matches, kept distinct and sorted by descending score */
+static void mrcp_voiceprint_match_add(mrcp_voiceprint_match_t *matches, apr_size_t *count, apr_size_t max_count, const char *id, float score)
+{
+	apr_size_t i;
+	apr_size_t n = *count;
+	if(n == max_count && score <= matches[n-1].score) {
+		return;
+	}
+	for(i=0; i<n; i++) {
+		if(strcmp(matches[i].id,id) == 0) {
+			if(score <= matches[i].score) {
+				return;
+			}
+			/* rescored speaker, take it out and insert again */
+			memmove(matches + i,matches + i + 1,(n - i - 1) * sizeof(mrcp_voiceprint_match_t));
+			n--;
+			break;
+		}
+	}
+	if(n == max_count) {
+		n--;
+	}
+	for(i=n; i>0 && matches[i-1].score < score; i--) {
+		matches[i] = matches[i-1];
+	}
+	matches[i].id = id;
+	matches[i].score = score;
+	*count = n + 1;
+}
+
+/** Score contiguous records in batches and add them to the matches */
+static void mrcp_voiceprint_records_match(const mrcp_voiceprint_store_t *store, const char *records, apr_size_t count, const float *vector,
+	mrcp_voiceprint_match_t *matches, apr_size_t *match_count, apr_size_t max_count)
+{
+	float scores[MRCP_VOICEPRINT_BLOCK_SIZE];
+	apr_size_t batch;
+	apr_size_t i;
+	while(count) {
+		batch = count < MRCP_VOICEPRINT_BLOCK_SIZE ? count : MRCP_VOICEPRINT_BLOCK_SIZE;
+		mrcp_voiceprint_batch_score(records,batch,store->record_size,vector,store->size,scores);
+		for(i=0; i<batch; i++) {
+			mrcp_voiceprint_match_add(matches,match_count,max_count,records + i * store->record_size,scores[i]);
+		}
+		records += batch * store->record_size;
+		count -= batch;
+	}
+}
+
+MRCP_DECLARE(apr_size_t) mrcp_voiceprint_store_identify(mrcp_voiceprint_store_t *store, const float *vector, apr_size_t size, mrcp_voiceprint_match_t *matches, apr_size_t max_count)
+{
+	float normalized[MRCP_VOICEPRINT_MAX_SIZE];
+	apr_size_t count = 0;
+	apr_size_t remaining;
+	int i;
+
+	if(!max_count || !size || size > MRCP_VOICEPRINT_MAX_SIZE) {
+		return 0;
+	}
+
+	apr_thread_rwlock_rdlock(store->lock);
+	if(mrcp_voiceprint_vector_prepare(store,vector,size,normalized) == TRUE) {
+		mrcp_voiceprint_records_match(store,store->records,store->mapped_count,normalized,matches,&count,max_count);
+		remaining = store->enrolled_count;
+		for(i=0; i<store->blocks->nelts; i++) {
+			apr_size_t block_count = remaining < MRCP_VOICEPRINT_BLOCK_SIZE ? remaining : MRCP_VOICEPRINT_BLOCK_SIZE;
+			mrcp_voiceprint_records_match(store,APR_ARRAY_IDX(store->blocks,i,const char*),block_count,normalized,matches,&count,max_count);
+			remaining -= block_count;
+		}
+	}
+	apr_thread_rwlock_unlock(store->lock);
+	return count;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_voiceprint_store_verify(mrcp_voiceprint_store_t *store, const char *id, const float *vector, apr_size_t size, float *score)
+{
+	float normalized[MRCP_VOICEPRINT_MAX_SIZE];
+	mrcp_voiceprint_speaker_t *speaker = NULL;
+	const char *record;
+	float record_score;
+	int i;
+
+	*score = 0;
+	if(!id || !size || size > MRCP_VOICEPRINT_MAX_SIZE) {
+		return FALSE;
+	}
+
+	apr_thread_rwlock_rdlock(store->lock);
+	if(mrcp_voiceprint_vector_prepare(store,vector,size,normalized) == TRUE) {
+		speaker = apr_hash_get(store->speakers,id,APR_HASH_KEY_STRING);
+	}
+	if(speaker) {
+		for(i=0; i<speaker->records->nelts; i++) {
+			record = mrcp_voiceprint_record_get(store,APR_ARRAY_IDX(speaker->records,i,apr_size_t));
+			record_score = mrcp_voiceprint_dot((const float*)(record + MRCP_VOICEPRINT_ID_SIZE),normalized,size);
+			if(i == 0 || record_score > *score) {
+				*score = record_score;
+			}
+		}
+	}
+	apr_thread_rwlock_unlock(store->lock);
+	return speaker ? TRUE : FALSE;
+}
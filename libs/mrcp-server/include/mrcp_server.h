@@ -26,6 +26,10 @@
 #include "mrcp_engine_iface.h"
 #include "mpf_rtp_descriptor.h"
 #include "apt_task.h"
+#include "apt_pool.h"
+#include "apt_histogram.h"
+#include "apt_handoff.h"
+#include "apt_mem_account.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -54,6 +58,36 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_offline(mrcp_server_t *server);
  */
 MRCP_DECLARE(apt_bool_t) mrcp_server_online(mrcp_server_t *server);
 
+/**
+ * Drain server, new sessions are rejected with 503 while the ones in progress continue.
+ * @param server the MRCP server to drain
+ * @param retry_after the time (sec) rejected clients are asked to retry in (0 - not specified)
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_drain(mrcp_server_t *server, apr_size_t retry_after);
+
+/**
+ * Get whether the server is draining.
+ * @param server the MRCP server to check
+ * @param retry_after the time (sec) rejected clients are asked to retry in (optional)
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_draining_get(const mrcp_server_t *server, apr_size_t *retry_after);
+
+/**
+ * Get whether the server is draining and no session is in progress anymore.
+ * @param server the MRCP server to check
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_is_drained(const mrcp_server_t *server);
+
+/**
+ * Set handoff of the listening sockets to a successor process.
+ * @param server the MRCP server to set handoff for
+ * @param handoff the handoff the sockets of the predecessor, if any, have been received by
+ * @remark The predecessor is released once the server is started, and the path is served
+ *         for a successor then. Once the successor has started, the server stops listening
+ *         and drains. Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_handoff_set(mrcp_server_t *server, apt_handoff_t *handoff);
+
 /**
  * Shutdown message processing loop.
  * @param server the MRCP server to shutdown
@@ -66,6 +100,153 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_shutdown(mrcp_server_t *server);
  */
 MRCP_DECLARE(apt_bool_t) mrcp_server_destroy(mrcp_server_t *server);
 
+/**
+ * Set the number of session processing shards.
+ * @param server the MRCP server to set shards for
+ * @param count the number of shards (1 - all the sessions are processed by the main task)
+ * @remark Sessions are distributed across the shards by session id, each shard running
+ *         a task of its own. Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_shards_set(mrcp_server_t *server, apr_size_t count);
+
+/**
+ * Register admission control.
+ * @param server the MRCP server to set admission control for
+ * @param settings the thresholds new sessions are rejected at
+ * @remark Rejected sessions are answered with 503 (Service Unavailable).
+ *         Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_admission_register(mrcp_server_t *server, const mrcp_admission_settings_t *settings);
+
+/**
+ * Get admission control.
+ * @param server the MRCP server to get admission control from
+ * @return the admission control, or NULL if not set
+ */
+MRCP_DECLARE(mrcp_server_admission_t*) mrcp_server_admission_get(const mrcp_server_t *server);
+
+/**
+ * Register cluster-aware load redirection.
+ * @param server the MRCP server to gossip the load of
+ * @param settings the cluster settings
+ * @remark New offers are redirected to the least loaded peer of the cluster once
+ *         the server is overloaded. Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_cluster_register(mrcp_server_t *server, const mrcp_cluster_settings_t *settings);
+
+/**
+ * Get cluster.
+ * @param server the MRCP server to get the cluster from
+ * @return the cluster, or NULL if not set
+ */
+MRCP_DECLARE(mrcp_server_cluster_t*) mrcp_server_cluster_get(const mrcp_server_t *server);
+
+/**
+ * Set exporting of metrics to a file.
+ * @param server the MRCP server to export metrics of
+ * @param file_path the path of the file to write metrics to
+ * @param interval the interval (msec) to write metrics at, 0 for the default
+ * @remark The statistics of the tasks of the server are enabled on start to be exported too.
+ *         Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_metrics_export_set(mrcp_server_t *server, const char *file_path, apr_size_t interval);
+
+/**
+ * Set caching of session pools, so that the pools of terminated sessions are
+ * cleared and reused by new sessions rather than destroyed.
+ * @param server the MRCP server to cache session pools of
+ * @param max_count the max number of idle pools to keep
+ * @param max_retained_size the max size of free memory a pool retains once cleared, 0 for unlimited
+ * @remark Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_pool_cache_set(mrcp_server_t *server, apr_size_t max_count, apr_size_t max_retained_size);
+
+/**
+ * Set sampling of verbose logging by session.
+ * @param server the MRCP server to sample sessions of
+ * @param priority the max priority of log entries of the sessions not sampled, e.g. APT_PRIO_NOTICE
+ * @param rate the fraction of sessions sampled, per 10000
+ * @param attrib the name of the session attribute sessions are also sampled by, e.g. "sip.request.user-name" (NULL if none)
+ * @param value the value of the attribute sessions are sampled at
+ * @remark The sessions sampled log at the priority of the log sources, which is therefore set to the verbose one.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_log_sampling_set(mrcp_server_t *server, apt_log_priority_e priority, apr_size_t rate, const char *attrib, const char *value);
+
+/**
+ * Decide the max priority of log entries of a new session.
+ * @param server the MRCP server the session belongs to
+ * @param session_id the identifier of the session
+ * @param attribs the generic attributes of the session (NULL if none)
+ * @return APT_PRIO_DEBUG if the session is sampled, APT_PRIO_COUNT (the sampling priority applies) otherwise
+ */
+MRCP_DECLARE(apt_log_priority_e) mrcp_server_log_sampling_decide(const mrcp_server_t *server, const apt_str_t *session_id, const apr_table_t *attribs);
+
+/**
+ * Set accounting of memory held by sessions, so that requests driving a session or
+ * the server over its cap fail instead of the node being driven into swap.
+ * @param server the MRCP server to account memory of
+ * @param max_size the max size of memory held by all the sessions (0 - unlimited)
+ * @param max_session_size the max size of memory held by a session (0 - unlimited)
+ * @remark Request bodies and the memory charged by engines on behalf of channels
+ *         are accounted. Must be called before the server is started.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_mem_accounting_set(mrcp_server_t *server, apr_size_t max_size, apr_size_t max_session_size);
+
+/**
+ * Get the statistics of memory held by sessions.
+ * @param server the MRCP server to get the statistics of
+ * @param stats the statistics to fill
+ * @return FALSE if memory is not accounted
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_mem_stats_get(const mrcp_server_t *server, apt_mem_account_stats_t *stats);
+
+/**
+ * Get the histogram of the peak sizes (bytes) of memory held by sessions, recorded at removal of sessions.
+ * @param server the MRCP server to get the histogram of
+ * @return the histogram, NULL if memory is not accounted
+ */
+MRCP_DECLARE(const apt_histogram_t*) mrcp_server_session_mem_peak_histogram_get(const mrcp_server_t *server);
+
+/**
+ * Get the statistics of the cache of session pools.
+ * @param server the MRCP server to get the statistics of
+ * @param stats the statistics to fill
+ * @return FALSE if session pools are not cached
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_pool_stats_get(const mrcp_server_t *server, apt_pool_cache_stats_t *stats);
+
+/**
+ * Get the histogram of the sizes (bytes) of session pools at removal of sessions.
+ * @param server the MRCP server to get the histogram of
+ * @param version the MRCP version of the sessions
+ * @remark Pool sizes are only measured if APR is built with pool debugging.
+ */
+MRCP_DECLARE(const apt_histogram_t*) mrcp_server_session_pool_size_histogram_get(const mrcp_server_t *server, mrcp_version_e version);
+
+/**
+ * Get the number of sessions in progress.
+ * @param server the MRCP server to get the number of sessions of
+ */
+MRCP_DECLARE(apr_size_t) mrcp_server_session_count_get(const mrcp_server_t *server);
+
+/**
+ * Get the main task of the server, the parent of the tasks of the components.
+ * @param server the MRCP server to get task of
+ */
+MRCP_DECLARE(apt_task_t*) mrcp_server_task_get(const mrcp_server_t *server);
+
+/**
+ * Get the first of the registered MRCP engines (mrcp_engine_t*).
+ * @param server the MRCP server to get engines of
+ */
+MRCP_DECLARE(apr_hash_index_t*) mrcp_server_engine_first(const mrcp_server_t *server);
+
+/**
+ * Get the first of the registered media engines (mpf_engine_t*).
+ * @param server the MRCP server to get media engines of
+ */
+MRCP_DECLARE(apr_hash_index_t*) mrcp_server_media_engine_first(const mrcp_server_t *server);
+
 
 /**
  * Register MRCP resource factory.
@@ -159,6 +340,26 @@ MRCP_DECLARE(mrcp_server_profile_t*) mrcp_server_profile_create(
 										mpf_rtp_settings_t *rtp_settings,
 										apr_pool_t *pool);
 
+/**
+ * Add media engine to the pool of the profile.
+ * @param profile the profile to add media engine to
+ * @param media_engine the media engine to add
+ * @param pool the pool to allocate memory from
+ * @remark The RTP port range of the profile is split among the engines of the pool.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_profile_media_engine_add(
+										mrcp_server_profile_t *profile,
+										mpf_engine_t *media_engine,
+										apr_pool_t *pool);
+
+/**
+ * Enable barge-in link of the sessions of the profile by default.
+ * @param profile the profile to set the default for
+ * @param enable whether START-OF-INPUT of the recognizer cuts the synthesizer of the session,
+ *        a session may override the default by the "barge-in-link" session attribute
+ */
+MRCP_DECLARE(void) mrcp_server_profile_barge_in_link_set(mrcp_server_profile_t *profile, apt_bool_t enable);
+
 /**
  * Register MRCP profile.
  * @param server the MRCP server to set profile for
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_SERVER_ADMISSION_H
+#define MRCP_SERVER_ADMISSION_H
+
+/**
+ * @file mrcp_server_admission.h
+ * @brief MRCP Server Admission Control
+ *
+ * New sessions are rejected upfront, as long as the live load of the media
+ * or an MRCP engine is above the configured thresholds, rather than being
+ * accepted to degrade the sessions already running.
+ */ 
+
+#include "mrcp_server_types.h"
+#include "mrcp_engine_types.h"
+#include "mpf_engine.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default interval (msec) MPF tick statistics are sampled at */
+#define MRCP_ADMISSION_DEFAULT_SAMPLING_INTERVAL 1000
+/** Default time (sec) rejected clients are asked to retry in */
+#define MRCP_ADMISSION_DEFAULT_RETRY_AFTER       5
+
+/** Admission control settings */
+struct mrcp_admission_settings_t {
+	/** Percentage of max-channel-count of an engine, new sessions are rejected at (0 - disabled) */
+	apr_size_t channel_usage;
+	/** Percentage of late MPF ticks within the sampling interval, new sessions are rejected at (0 - disabled) */
+	apr_size_t late_tick_rate;
+	/** Number of jobs queued to the threads of an engine, new sessions are rejected at (0 - disabled) */
+	apr_size_t engine_backlog;
+	/** Interval (msec) MPF tick statistics are sampled at */
+	apr_size_t sampling_interval;
+	/** Time (sec) rejected clients are asked to retry in (0 - not specified) */
+	apr_size_t retry_after;
+};
+
+/** Allocate admission control settings */
+MRCP_DECLARE(mrcp_admission_settings_t*) mrcp_admission_settings_alloc(apr_pool_t *pool);
+
+/**
+ * Create admission control.
+ * @param settings the thresholds to apply
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_server_admission_t*) mrcp_server_admission_create(const mrcp_admission_settings_t *settings, apr_pool_t *pool);
+
+/** Destroy admission control */
+MRCP_DECLARE(void) mrcp_server_admission_destroy(mrcp_server_admission_t *admission);
+
+/**
+ * Check whether the media engine can take a new session.
+ * @param admission the admission control
+ * @param media_engine the media engine the session is to be processed by
+ * @remark May be called by several session shards at once.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_admission_media_check(mrcp_server_admission_t *admission, const mpf_engine_t *media_engine);
+
+/**
+ * Check whether the MRCP engine can take a new channel.
+ * @param admission the admission control
+ * @param engine the engine the channel is to be created by
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_admission_engine_check(const mrcp_server_admission_t *admission, const mrcp_engine_t *engine);
+
+/** Get the time (sec) rejected clients are asked to retry in */
+MRCP_DECLARE(apr_size_t) mrcp_server_admission_retry_after_get(const mrcp_server_admission_t *admission);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_SERVER_ADMISSION_H */
@@ -0,0 +1,122 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MRCP_SERVER_CLUSTER_H
+#define MRCP_SERVER_CLUSTER_H
+
+/**
+ * @file mrcp_server_cluster.h
+ * @brief MRCP Server Cluster-aware Load Redirection
+ *
+ * Nodes of a cluster gossip their load over UDP: the channel usage, the
+ * backlog and real-time factor of MRCP engines, and whether they admit
+ * new sessions. Members are learned from each other, so that every node
+ * only needs to be seeded with a few peers. An overloaded node redirects
+ * new SIP offers to the least loaded peer which admits them and rejects
+ * the offers it can neither take nor redirect, rather than accepting a
+ * session it can't process in real time.
+ */ 
+
+#include <apr_tables.h>
+#include "mrcp_server_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default interval (msec) the load is gossiped at */
+#define MRCP_CLUSTER_DEFAULT_INTERVAL       1000
+/** Default percentage of channel usage, new offers are redirected at */
+#define MRCP_CLUSTER_DEFAULT_REDIRECT_USAGE 80
+/** Default real-time factor (percent), new offers are no longer admitted at */
+#define MRCP_CLUSTER_DEFAULT_MAX_RTF        90
+/** Default margin (percent) of channel usage, a peer must be less loaded by to be redirected to */
+#define MRCP_CLUSTER_DEFAULT_MARGIN         10
+
+/** Cluster settings */
+struct mrcp_cluster_settings_t {
+	/** Identifier of the node, unique within the cluster */
+	const char         *node_id;
+	/** SIP URI offers redirected to the node are to be sent to */
+	const char         *sip_uri;
+	/** IP address to gossip on */
+	const char         *ip;
+	/** Port to gossip on */
+	apr_port_t          port;
+	/** Seed peers gossiped to at start (const char* "ip:port") */
+	apr_array_header_t *peers;
+	/** Interval (msec) the load is gossiped at */
+	apr_size_t          interval;
+	/** Percentage of channel usage, new offers are redirected at */
+	apr_size_t          redirect_usage;
+	/** Real-time factor (percent), new offers are no longer admitted at */
+	apr_size_t          max_rtf;
+	/** Margin (percent) of channel usage, a peer must be less loaded by to be redirected to */
+	apr_size_t          margin;
+	/** Time (sec) rejected clients are asked to retry in (0 - not specified) */
+	apr_size_t          retry_after;
+	/** Secret shared by the nodes the gossip is authenticated by (NULL - only known peers are heard) */
+	const char         *secret;
+};
+
+/** Decision on a new offer */
+typedef enum {
+	MRCP_CLUSTER_OFFER_ACCEPT,   /**< take the offer */
+	MRCP_CLUSTER_OFFER_REDIRECT, /**< redirect the offer to a peer */
+	MRCP_CLUSTER_OFFER_REJECT    /**< reject the offer, no peer can take it either */
+} mrcp_cluster_offer_e;
+
+/** Allocate cluster settings */
+MRCP_DECLARE(mrcp_cluster_settings_t*) mrcp_cluster_settings_alloc(apr_pool_t *pool);
+
+/**
+ * Create cluster.
+ * @param settings the settings to apply
+ * @param server the MRCP server to gossip the load of
+ * @param pool the pool to allocate memory from
+ */
+MRCP_DECLARE(mrcp_server_cluster_t*) mrcp_server_cluster_create(
+										const mrcp_cluster_settings_t *settings,
+										mrcp_server_t *server,
+										apr_pool_t *pool);
+
+/** Destroy cluster */
+MRCP_DECLARE(void) mrcp_server_cluster_destroy(mrcp_server_cluster_t *cluster);
+
+/** Get the interval (msec) the load is gossiped at */
+MRCP_DECLARE(apr_size_t) mrcp_server_cluster_interval_get(const mrcp_server_cluster_t *cluster);
+
+/**
+ * Measure the local load, take in the gossip received and gossip the load to the peers.
+ * @param cluster the cluster
+ * @remark Called by the server task every interval.
+ */
+MRCP_DECLARE(void) mrcp_server_cluster_exchange(mrcp_server_cluster_t *cluster);
+
+/**
+ * Decide on a new offer.
+ * @param cluster the cluster
+ * @param redirect_uri the buffer to copy the SIP URI of the peer to redirect to
+ * @param size the size of the buffer
+ * @remark May be called by signaling agents at any time.
+ */
+MRCP_DECLARE(mrcp_cluster_offer_e) mrcp_server_cluster_offer_check(mrcp_server_cluster_t *cluster, char *redirect_uri, apr_size_t size);
+
+/** Get the time (sec) rejected clients are asked to retry in */
+MRCP_DECLARE(apr_size_t) mrcp_server_cluster_retry_after_get(const mrcp_server_cluster_t *cluster);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_SERVER_CLUSTER_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_SERVER_METRICS_H
+#define MRCP_SERVER_METRICS_H
+
+/**
+ * @file mrcp_server_metrics.h
+ * @brief MRCP Server Metrics
+ *
+ * The metrics are written in the Prometheus text exposition format, so that
+ * the file exported periodically can be picked up by the textfile collector
+ * of the node exporter, or served as is by any HTTP server.
+ */ 
+
+#include <apr_file_io.h>
+#include "mrcp_server_types.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default interval (msec) metrics are exported at */
+#define MRCP_METRICS_DEFAULT_EXPORT_INTERVAL 15000
+
+/**
+ * Write metrics of the server.
+ * @param server the server to write metrics of
+ * @param file the file to write to
+ * @param pool the pool to allocate temporary memory from
+ * @remark Covers sessions, session pools, memory held by sessions, channels, backlog and memory per engine, decoding
+ *         real-time factor of engines measuring it, tick, RTP and jitter buffer
+ *         statistics per media engine, and queue statistics of the tasks of the server.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_metrics_write(const mrcp_server_t *server, apr_file_t *file, apr_pool_t *pool);
+
+/**
+ * Export metrics of the server to a file.
+ * @param server the server to write metrics of
+ * @param file_path the path of the file to write
+ * @param pool the pool to allocate temporary memory from
+ * @remark The file is written aside and renamed, so readers never see it partially written.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_metrics_export(const mrcp_server_t *server, const char *file_path, apr_pool_t *pool);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_SERVER_METRICS_H */
@@ -27,16 +27,24 @@
 #include "mpf_engine.h"
 #include "apt_task.h"
 #include "apt_obj_list.h"
+#include "apt_mem_account.h"
 
 
 APT_BEGIN_EXTERN_C
 
+/** Length of session identifiers generated by the server */
+#define MRCP_SESSION_ID_HEX_STRING_LENGTH 16
+
 /** Opaque MRCP channel declaration */
 typedef struct mrcp_channel_t mrcp_channel_t;
 /** MRCP server session declaration */
 typedef struct mrcp_server_session_t mrcp_server_session_t;
 /** MRCP signaling message declaration */
 typedef struct mrcp_signaling_message_t mrcp_signaling_message_t;
+/** Opaque session processing shard declaration */
+typedef struct mrcp_server_shard_t mrcp_server_shard_t;
+/** Opaque barge-in link declaration */
+typedef struct mrcp_barge_in_link_t mrcp_barge_in_link_t;
 
 /** Enumeration of signaling task messages */
 typedef enum {
@@ -79,6 +87,8 @@ struct mrcp_server_session_t {
 	mrcp_server_t              *server;
 	/** MRCP profile */
 	mrcp_server_profile_t      *profile;
+	/** Shard the session is processed by (assigned on the first signaling message) */
+	mrcp_server_shard_t        *shard;
 
 	/** Media context */
 	mpf_context_t              *context;
@@ -110,6 +120,12 @@ struct mrcp_server_session_t {
 	mrcp_server_session_state_e state;
 	/** Number of in-progress sub requests */
 	apr_size_t                  subrequest_count;
+
+	/** Link cutting the synthesizer on START-OF-INPUT of the recognizer (NULL if not enabled) */
+	mrcp_barge_in_link_t       *barge_in_link;
+
+	/** Memory held by the session (NULL if not accounted) */
+	apt_mem_account_t          *mem_account;
 };
 
 /** MRCP server profile */
@@ -122,8 +138,10 @@ struct mrcp_server_profile_t {
 	apr_hash_t                *engine_table;
 	/** MRCP resource factory */
 	mrcp_resource_factory_t   *resource_factory;
-	/** Media processing engine */
+	/** Media processing engine (the first one of the pool) */
 	mpf_engine_t              *media_engine;
+	/** Pool of media processing engines, each session is assigned to the least loaded one */
+	mpf_engine_factory_t      *mpf_factory;
 	/** RTP termination factory */
 	mpf_termination_factory_t *rtp_termination_factory;
 	/** RTP settings */
@@ -132,10 +150,12 @@ struct mrcp_server_profile_t {
 	mrcp_sig_agent_t          *signaling_agent;
 	/** Connection agent */
 	mrcp_connection_agent_t   *connection_agent;
+	/** Whether START-OF-INPUT of the recognizer cuts the synthesizer of the session by default */
+	apt_bool_t                 barge_in_link;
 };
 
-/** Create server session */
-mrcp_server_session_t* mrcp_server_session_create(void);
+/** Create server session, taking the pool of the session from the cache, if any */
+mrcp_server_session_t* mrcp_server_session_create(apt_pool_cache_t *pool_cache);
 
 /** Process signaling message */
 apt_bool_t mrcp_server_signaling_message_process(mrcp_signaling_message_t *signaling_message);
@@ -157,6 +177,8 @@ apt_bool_t mrcp_server_on_engine_channel_open(mrcp_channel_t *channel, apt_bool_
 apt_bool_t mrcp_server_on_engine_channel_close(mrcp_channel_t *channel);
 /** Process message receive event */
 apt_bool_t mrcp_server_on_engine_channel_message(mrcp_channel_t *channel, mrcp_message_t *message);
+/** Cut the synthesizer linked to the channel on START-OF-INPUT (called in the context the engine sends the message from) */
+void mrcp_server_barge_in_signal(mrcp_channel_t *channel, const mrcp_message_t *message);
 
 /** Get session by channel */
 mrcp_session_t* mrcp_server_channel_session_get(mrcp_channel_t *channel);
@@ -34,6 +34,18 @@ typedef struct mrcp_server_t mrcp_server_t;
 /** Opaque MRCP server profile declaration */
 typedef struct mrcp_server_profile_t mrcp_server_profile_t;
 
+/** Opaque admission control declaration */
+typedef struct mrcp_server_admission_t mrcp_server_admission_t;
+
+/** Admission control settings declaration */
+typedef struct mrcp_admission_settings_t mrcp_admission_settings_t;
+
+/** Opaque cluster declaration */
+typedef struct mrcp_server_cluster_t mrcp_server_cluster_t;
+
+/** Cluster settings declaration */
+typedef struct mrcp_cluster_settings_t mrcp_cluster_settings_t;
+
 
 APT_END_EXTERN_C
 
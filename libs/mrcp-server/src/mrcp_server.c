@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mrcp_server.h"
 #include "mrcp_server_session.h"
+#include "mrcp_server_admission.h"
+#include "mrcp_server_cluster.h"
+#include "mrcp_server_metrics.h"
 #include "mrcp_message.h"
 #include "mrcp_resource_factory.h"
 #include "mrcp_resource.h"
@@ -24,12 +28,39 @@
 #include "mrcp_sig_agent.h"
 #include "mrcp_server_connection.h"
 #include "mpf_termination_factory.h"
+#include "mpf_engine_factory.h"
 #include "apt_pool.h"
+#include "apt_histogram.h"
+#include "apt_text_stream.h"
 #include "apt_consumer_task.h"
+#include "apt_mpsc_queue.h"
 #include "apt_obj_list.h"
 #include "apt_log.h"
 
 #define SERVER_TASK_NAME "MRCP Server"
+#define SHARD_TASK_NAME  "MRCP Shard"
+
+/** Max number of session processing shards */
+#define MRCP_SERVER_MAX_SHARD_COUNT 64
+/** Max number of engine channel and connection events queued per shard, beyond that they are signaled one by one */
+#define MRCP_SERVER_EVENT_QUEUE_SIZE 4096
+
+/** Session processing shard */
+struct mrcp_server_shard_t {
+	/** Message processing task (the main task of the server for the first shard) */
+	apt_consumer_task_t     *task;
+	/** Table of sessions processed by the shard (accessed in the shard task context only) */
+	apr_hash_t              *session_table;
+	/** MRCP server */
+	mrcp_server_t           *server;
+	/** Index of the shard */
+	apr_size_t               index;
+	/** Engine channel and received MRCP message events (apt_task_msg_t*) queued by plugin and
+	connection agent threads, processed in a batch per wakeup */
+	apt_mpsc_queue_t        *events;
+	/** Whether the shard is signaled to process the queued events */
+	volatile apr_uint32_t    events_pending;
+};
 
 /** MRCP server */
 struct mrcp_server_t {
@@ -58,20 +89,65 @@ struct mrcp_server_t {
 	/** Table of profiles (mrcp_server_profile_t*) */
 	apr_hash_t              *profile_table;
 
-	/** Table of sessions */
-	apr_hash_t              *session_table;
+	/** Array of session processing shards */
+	mrcp_server_shard_t     *shards;
+	/** Number of shards */
+	apr_size_t               shard_count;
+	/** Number of sessions across all the shards */
+	volatile apr_uint32_t    session_count;
+	/** Draining (new sessions are rejected) or not */
+	volatile apr_uint32_t    draining;
+	/** Time (sec) clients rejected while draining are asked to retry in */
+	apr_size_t               drain_retry_after;
+	/** Handoff of listening sockets to a successor (NULL if not used) */
+	apt_handoff_t           *handoff;
+	/** Cache of session pools (NULL if not used) */
+	apt_pool_cache_t        *session_pool_cache;
+	/** Sizes of session pools at removal per MRCP version */
+	apt_histogram_t         *session_pool_sizes[MRCP_VERSION_2 + 1];
+	/** Admission control (NULL if not set) */
+	mrcp_server_admission_t *admission;
+	/** Cluster the load is gossiped within (NULL if not set) */
+	mrcp_server_cluster_t   *cluster;
+	/** Timer the load is gossiped by */
+	apt_timer_t             *cluster_timer;
+
+	/** Fraction of sessions logging verbosely, per 10000 (0 - by the attribute only) */
+	apr_uint32_t             log_sample_rate;
+	/** Session attribute sessions logging verbosely are matched by (NULL if none) */
+	const char              *log_sample_attrib;
+	/** Value of the attribute sessions logging verbosely are matched at */
+	const char              *log_sample_value;
+	/** Whether sessions are sampled */
+	apt_bool_t               log_sampling;
+
+	/** Memory held by all the sessions (NULL if not accounted) */
+	apt_mem_account_t       *mem_account;
+	/** Max size of memory held by a session (0 - unlimited) */
+	apr_size_t               session_mem_cap;
+	/** Peak sizes of memory held by sessions at removal */
+	apt_histogram_t         *session_mem_peaks;
+
+	/** Path of the file metrics are exported to (NULL if not exported) */
+	const char              *metrics_path;
+	/** Interval (msec) metrics are exported at */
+	apr_size_t               metrics_interval;
+	/** Timer metrics are exported by */
+	apt_timer_t             *metrics_timer;
 
 	/** Connection task message pool */
 	apt_task_msg_pool_t     *connection_msg_pool;
 	/** Engine task message pool */
 	apt_task_msg_pool_t     *engine_msg_pool;
+	/** Shard task message pool (also used to pass MPF messages on to shards) */
+	apt_task_msg_pool_t     *shard_msg_pool;
 
 	/** Dir layout structure */
 	apt_dir_layout_t        *dir_layout;
 	/** Time server started at */
 	apr_time_t               start_time;
-	/** Shutting down or not */
-	apt_bool_t               shutdown_requested;
+	/** Shutting down or not (also read by shards) */
+	volatile apt_bool_t      shutdown_requested;
 	/** Memory pool */
 	apr_pool_t              *pool;
 };
@@ -81,9 +157,17 @@ typedef enum {
 	MRCP_SERVER_SIGNALING_TASK_MSG = TASK_MSG_USER,
 	MRCP_SERVER_CONNECTION_TASK_MSG,
 	MRCP_SERVER_ENGINE_TASK_MSG,
-	MRCP_SERVER_MEDIA_TASK_MSG
+	MRCP_SERVER_MEDIA_TASK_MSG,
+	MRCP_SERVER_SHARD_TASK_MSG
 } mrcp_server_task_msg_type_e;
 
+/* Shard interface */
+typedef enum {
+	SHARD_TASK_MSG_RELEASE_SESSIONS, /**< release sessions of the shard on shutdown (to shard) */
+	SHARD_TASK_MSG_IDLE,             /**< the last session has been removed (to main task) */
+	SHARD_TASK_MSG_EVENTS            /**< engine channel or connection events are queued (to shard) */
+} shard_task_msg_type_e;
+
 
 static apt_bool_t mrcp_server_offer_signal(mrcp_session_t *session, mrcp_session_descriptor_t *descriptor);
 static apt_bool_t mrcp_server_terminate_signal(mrcp_session_t *session);
@@ -173,9 +257,19 @@ static void mrcp_server_on_terminate_complete(apt_task_t *task);
 static void mrcp_server_on_offline_complete(apt_task_t *task);
 static void mrcp_server_on_online_complete(apt_task_t *task);
 
+static apt_bool_t mrcp_server_shard_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+static apt_bool_t mrcp_server_session_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+static void mrcp_server_shard_events_process(mrcp_server_shard_t *shard, apt_task_t *task);
+static apt_bool_t mrcp_server_shard_event_signal(mrcp_server_t *server, mrcp_server_shard_t *shard, apt_task_msg_t *task_msg);
+
 static mrcp_session_t* mrcp_server_sig_agent_session_create(mrcp_sig_agent_t *signaling_agent);
+static mrcp_sig_offer_e mrcp_server_sig_agent_offer_check(mrcp_sig_agent_t *signaling_agent, char *redirect_uri, apr_size_t size, apr_size_t *retry_after);
 static apt_bool_t mrcp_server_do_terminate(mrcp_server_t *server);
+static void mrcp_server_task_stats_enable(apt_task_t *task);
+static void mrcp_server_metrics_timer_proc(apt_timer_t *timer, void *obj);
+static void mrcp_server_cluster_timer_proc(apt_timer_t *timer, void *obj);
 static void mrcp_server_sessions_release(mrcp_server_t *server);
+static void mrcp_server_shard_sessions_release(mrcp_server_shard_t *shard);
 
 
 /** Create MRCP server instance */
@@ -205,9 +299,32 @@ MRCP_DECLARE(mrcp_server_t*) mrcp_server_create(apt_dir_layout_t *dir_layout)
 	server->cnt_agent_table = NULL;
 	server->rtp_settings_table = NULL;
 	server->profile_table = NULL;
-	server->session_table = NULL;
+	server->shards = NULL;
+	server->shard_count = 0;
+	server->session_count = 0;
+	server->draining = 0;
+	server->drain_retry_after = 0;
+	server->handoff = NULL;
+	server->session_pool_cache = NULL;
+	server->session_pool_sizes[MRCP_VERSION_UNKNOWN] = NULL;
+	server->session_pool_sizes[MRCP_VERSION_1] = apt_histogram_create(pool);
+	server->session_pool_sizes[MRCP_VERSION_2] = apt_histogram_create(pool);
+	server->admission = NULL;
+	server->cluster = NULL;
+	server->cluster_timer = NULL;
+	server->log_sample_rate = 0;
+	server->log_sample_attrib = NULL;
+	server->log_sample_value = NULL;
+	server->log_sampling = FALSE;
+	server->mem_account = NULL;
+	server->session_mem_cap = 0;
+	server->session_mem_peaks = NULL;
+	server->metrics_path = NULL;
+	server->metrics_interval = 0;
+	server->metrics_timer = NULL;
 	server->connection_msg_pool = NULL;
 	server->engine_msg_pool = NULL;
+	server->shard_msg_pool = NULL;
 	server->shutdown_requested = FALSE;
 
 	msg_pool = apt_task_msg_pool_create_dynamic(0,pool);
@@ -240,11 +357,252 @@ MRCP_DECLARE(mrcp_server_t*) mrcp_server_create(apt_dir_layout_t *dir_layout)
 	server->cnt_agent_table = apr_hash_make(server->pool);
 
 	server->profile_table = apr_hash_make(server->pool);
-	
-	server->session_table = apr_hash_make(server->pool);
+
+	/* sessions are processed by the main task, unless more shards are set */
+	server->shard_msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mpf_message_container_t),pool);
+	server->shards = apr_palloc(server->pool,sizeof(mrcp_server_shard_t));
+	server->shards[0].task = server->task;
+	server->shards[0].session_table = apr_hash_make(server->pool);
+	server->shards[0].server = server;
+	server->shards[0].index = 0;
+	server->shards[0].events = apt_mpsc_queue_create(MRCP_SERVER_EVENT_QUEUE_SIZE,server->pool);
+	server->shards[0].events_pending = 0;
+	server->shard_count = 1;
 	return server;
 }
 
+/** Set the number of session processing shards */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_shards_set(mrcp_server_t *server, apr_size_t count)
+{
+	mrcp_server_shard_t *shards;
+	mrcp_server_shard_t *shard;
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	apr_size_t i;
+	if(!server || !server->task || server->shard_count != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Set Session Shards");
+		return FALSE;
+	}
+	if(count <= 1) {
+		return TRUE;
+	}
+	if(count > MRCP_SERVER_MAX_SHARD_COUNT) {
+		count = MRCP_SERVER_MAX_SHARD_COUNT;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Session Shards [%"APR_SIZE_T_FMT"]",count);
+	shards = apr_palloc(server->pool,sizeof(mrcp_server_shard_t) * count);
+	shards[0] = server->shards[0];
+	for(i=1; i<count; i++) {
+		shard = &shards[i];
+		shard->server = server;
+		shard->index = i;
+		shard->session_table = apr_hash_make(server->pool);
+		shard->events = apt_mpsc_queue_create(MRCP_SERVER_EVENT_QUEUE_SIZE,server->pool);
+		shard->events_pending = 0;
+		msg_pool = apt_task_msg_pool_create_dynamic(0,server->pool);
+		shard->task = apt_consumer_task_create(shard,msg_pool,server->pool);
+		if(!shard->task) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Shard Task [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		task = apt_consumer_task_base_get(shard->task);
+		apt_task_name_set(task,apr_psprintf(server->pool,SHARD_TASK_NAME"-%"APR_SIZE_T_FMT,i));
+		vtable = apt_task_vtable_get(task);
+		if(vtable) {
+			vtable->process_msg = mrcp_server_shard_msg_process;
+		}
+		/* shards are started, taken offline and terminated along with the main task */
+		apt_task_add(apt_consumer_task_base_get(server->task),task);
+	}
+	server->shards = shards;
+	server->shard_count = count;
+	return TRUE;
+}
+
+/** Register admission control */
+MRCP_DECLARE(apt_bool_t) mrcp_server_admission_register(mrcp_server_t *server, const mrcp_admission_settings_t *settings)
+{
+	if(!server || !settings || server->admission) {
+		return FALSE;
+	}
+	server->admission = mrcp_server_admission_create(settings,server->pool);
+	return server->admission ? TRUE : FALSE;
+}
+
+/** Get admission control */
+MRCP_DECLARE(mrcp_server_admission_t*) mrcp_server_admission_get(const mrcp_server_t *server)
+{
+	return server->admission;
+}
+
+/** Register cluster */
+MRCP_DECLARE(apt_bool_t) mrcp_server_cluster_register(mrcp_server_t *server, const mrcp_cluster_settings_t *settings)
+{
+	if(!server || !server->task || !settings || server->cluster) {
+		return FALSE;
+	}
+	server->cluster = mrcp_server_cluster_create(settings,server,server->pool);
+	if(!server->cluster) {
+		return FALSE;
+	}
+	server->cluster_timer = apt_consumer_task_timer_create(server->task,mrcp_server_cluster_timer_proc,server,server->pool);
+	return TRUE;
+}
+
+/** Get cluster */
+MRCP_DECLARE(mrcp_server_cluster_t*) mrcp_server_cluster_get(const mrcp_server_t *server)
+{
+	return server->cluster;
+}
+
+/** Set exporting of metrics to a file */
+MRCP_DECLARE(apt_bool_t) mrcp_server_metrics_export_set(mrcp_server_t *server, const char *file_path, apr_size_t interval)
+{
+	if(!server || !server->task || !file_path) {
+		return FALSE;
+	}
+	server->metrics_path = apr_pstrdup(server->pool,file_path);
+	server->metrics_interval = interval ? interval : MRCP_METRICS_DEFAULT_EXPORT_INTERVAL;
+	server->metrics_timer = apt_consumer_task_timer_create(server->task,mrcp_server_metrics_timer_proc,server,server->pool);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Export Metrics [%s] every %"APR_SIZE_T_FMT" msec",
+		server->metrics_path,server->metrics_interval);
+	return TRUE;
+}
+
+/** Set sampling of verbose logging by session */
+MRCP_DECLARE(apt_bool_t) mrcp_server_log_sampling_set(mrcp_server_t *server, apt_log_priority_e priority, apr_size_t rate, const char *attrib, const char *value)
+{
+	if(!server) {
+		return FALSE;
+	}
+	server->log_sample_rate = rate > 10000 ? 10000 : (apr_uint32_t)rate;
+	server->log_sample_attrib = attrib ? apr_pstrdup(server->pool,attrib) : NULL;
+	server->log_sample_value = value ? apr_pstrdup(server->pool,value) : "";
+	server->log_sampling = TRUE;
+	apt_log_sampling_set(priority);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Sample Verbose Logging rate [%u/10000] attrib [%s=%s] others up to [%d]",
+		server->log_sample_rate,
+		server->log_sample_attrib ? server->log_sample_attrib : "",
+		server->log_sample_attrib ? server->log_sample_value : "",
+		priority);
+	return TRUE;
+}
+
+/** Decide the max priority of log entries of a new session */
+MRCP_DECLARE(apt_log_priority_e) mrcp_server_log_sampling_decide(const mrcp_server_t *server, const apt_str_t *session_id, const apr_table_t *attribs)
+{
+	if(server->log_sampling == FALSE) {
+		return APT_PRIO_COUNT;
+	}
+	if(server->log_sample_attrib && attribs) {
+		const char *value = apr_table_get(attribs,server->log_sample_attrib);
+		if(value && strcmp(value,server->log_sample_value) == 0) {
+			return APT_PRIO_DEBUG;
+		}
+	}
+	if(server->log_sample_rate && session_id->buf) {
+		/* the id is random, its hash picks the same sessions at the same rate wherever decided */
+		apr_ssize_t length = session_id->length;
+		if(apr_hashfunc_default(session_id->buf,&length) % 10000 < server->log_sample_rate) {
+			return APT_PRIO_DEBUG;
+		}
+	}
+	return APT_PRIO_COUNT;
+}
+
+/** Set caching of session pools */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_pool_cache_set(mrcp_server_t *server, apr_size_t max_count, apr_size_t max_retained_size)
+{
+	if(!server || !server->task || server->session_pool_cache) {
+		return FALSE;
+	}
+	server->session_pool_cache = apt_pool_cache_create(max_count,max_retained_size,server->pool);
+	if(!server->session_pool_cache) {
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Cache Session Pools [%"APR_SIZE_T_FMT"] max retained size [%"APR_SIZE_T_FMT"]",
+		max_count,max_retained_size);
+	return TRUE;
+}
+
+/** Set accounting of memory held by sessions */
+MRCP_DECLARE(apt_bool_t) mrcp_server_mem_accounting_set(mrcp_server_t *server, apr_size_t max_size, apr_size_t max_session_size)
+{
+	if(!server || !server->task || server->mem_account) {
+		return FALSE;
+	}
+	server->mem_account = apt_mem_account_create("server",max_size,NULL,server->pool);
+	if(!server->mem_account) {
+		return FALSE;
+	}
+	server->session_mem_cap = max_session_size;
+	server->session_mem_peaks = apt_histogram_create(server->pool);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Account Session Memory max size [%"APR_SIZE_T_FMT"] per session [%"APR_SIZE_T_FMT"]",
+		max_size,max_session_size);
+	return TRUE;
+}
+
+/** Get the statistics of memory held by sessions */
+MRCP_DECLARE(apt_bool_t) mrcp_server_mem_stats_get(const mrcp_server_t *server, apt_mem_account_stats_t *stats)
+{
+	if(!server->mem_account) {
+		return FALSE;
+	}
+	apt_mem_account_stats_get(server->mem_account,stats);
+	return TRUE;
+}
+
+/** Get the histogram of the peak sizes of memory held by sessions */
+MRCP_DECLARE(const apt_histogram_t*) mrcp_server_session_mem_peak_histogram_get(const mrcp_server_t *server)
+{
+	return server->session_mem_peaks;
+}
+
+/** Get the statistics of the cache of session pools */
+MRCP_DECLARE(apt_bool_t) mrcp_server_session_pool_stats_get(const mrcp_server_t *server, apt_pool_cache_stats_t *stats)
+{
+	if(!server->session_pool_cache) {
+		return FALSE;
+	}
+	apt_pool_cache_stats_get(server->session_pool_cache,stats);
+	return TRUE;
+}
+
+/** Get the histogram of the sizes of session pools per MRCP version */
+MRCP_DECLARE(const apt_histogram_t*) mrcp_server_session_pool_size_histogram_get(const mrcp_server_t *server, mrcp_version_e version)
+{
+	if(version != MRCP_VERSION_1 && version != MRCP_VERSION_2) {
+		return NULL;
+	}
+	return server->session_pool_sizes[version];
+}
+
+/** Get the number of sessions in progress */
+MRCP_DECLARE(apr_size_t) mrcp_server_session_count_get(const mrcp_server_t *server)
+{
+	return apr_atomic_read32((volatile apr_uint32_t*)&server->session_count);
+}
+
+/** Get the main task of the server */
+MRCP_DECLARE(apt_task_t*) mrcp_server_task_get(const mrcp_server_t *server)
+{
+	return apt_consumer_task_base_get(server->task);
+}
+
+/** Get the first of the registered MRCP engines */
+MRCP_DECLARE(apr_hash_index_t*) mrcp_server_engine_first(const mrcp_server_t *server)
+{
+	return mrcp_engine_factory_engine_first(server->engine_factory);
+}
+
+/** Get the first of the registered media engines */
+MRCP_DECLARE(apr_hash_index_t*) mrcp_server_media_engine_first(const mrcp_server_t *server)
+{
+	return apr_hash_first(NULL,server->media_engine_table);
+}
+
 /** Start message processing loop */
 MRCP_DECLARE(apt_bool_t) mrcp_server_start(mrcp_server_t *server)
 {
@@ -255,6 +613,10 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_start(mrcp_server_t *server)
 	}
 	server->start_time = apr_time_now();
 	task = apt_consumer_task_base_get(server->task);
+	if(server->metrics_path) {
+		/* queue statistics are published along with the rest of metrics */
+		mrcp_server_task_stats_enable(task);
+	}
 	if(apt_task_start(task) == FALSE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Server Task");
 		return FALSE;
@@ -288,6 +650,85 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_online(mrcp_server_t *server)
 	return apt_task_online(task);
 }
 
+/** Drain server */
+MRCP_DECLARE(apt_bool_t) mrcp_server_drain(mrcp_server_t *server, apr_size_t retry_after)
+{
+	if(!server || !server->task) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Server Instance");
+		return FALSE;
+	}
+	server->drain_retry_after = retry_after;
+	if(apr_atomic_xchg32(&server->draining,1) == 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Drain Server: remaining sessions [%d]",
+			apr_atomic_read32(&server->session_count));
+	}
+	return TRUE;
+}
+
+/** Get whether the server is draining */
+MRCP_DECLARE(apt_bool_t) mrcp_server_draining_get(const mrcp_server_t *server, apr_size_t *retry_after)
+{
+	if(!apr_atomic_read32((volatile apr_uint32_t*)&server->draining)) {
+		return FALSE;
+	}
+	if(retry_after) {
+		*retry_after = server->drain_retry_after;
+	}
+	return TRUE;
+}
+
+/** Get whether the server is drained */
+MRCP_DECLARE(apt_bool_t) mrcp_server_is_drained(const mrcp_server_t *server)
+{
+	if(mrcp_server_draining_get(server,NULL) == FALSE) {
+		return FALSE;
+	}
+	return apr_atomic_read32((volatile apr_uint32_t*)&server->session_count) ? FALSE : TRUE;
+}
+
+/** Set handoff of the listening sockets */
+MRCP_DECLARE(apt_bool_t) mrcp_server_handoff_set(mrcp_server_t *server, apt_handoff_t *handoff)
+{
+	if(!server || !server->task || server->handoff) {
+		return FALSE;
+	}
+	server->handoff = handoff;
+	return TRUE;
+}
+
+/** Stop accepting new connections by the signaling and connection agents */
+static void mrcp_server_listeners_stop(mrcp_server_t *server)
+{
+	mrcp_sig_agent_t *sig_agent;
+	mrcp_connection_agent_t *connection_agent;
+	apr_hash_index_t *it;
+	void *val;
+
+	for(it = apr_hash_first(NULL,server->sig_agent_table); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		sig_agent = val;
+		if(sig_agent && sig_agent->listen_stop) {
+			sig_agent->listen_stop(sig_agent);
+		}
+	}
+	for(it = apr_hash_first(NULL,server->cnt_agent_table); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		connection_agent = val;
+		if(connection_agent) {
+			mrcp_server_connection_agent_listen_stop(connection_agent);
+		}
+	}
+}
+
+/** Handle the takeover of the listening sockets by a successor (handoff thread) */
+static void mrcp_server_on_handoff(apt_handoff_t *handoff, void *obj)
+{
+	mrcp_server_t *server = obj;
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Listening Sockets Taken Over by Successor");
+	mrcp_server_listeners_stop(server);
+	mrcp_server_drain(server,server->drain_retry_after);
+}
+
 /** Shutdown message processing loop */
 MRCP_DECLARE(apt_bool_t) mrcp_server_shutdown(mrcp_server_t *server)
 {
@@ -297,12 +738,16 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_shutdown(mrcp_server_t *server)
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Server Instance");
 		return FALSE;
 	}
+	if(server->handoff) {
+		/* stop serving the successor, before the agents are terminated */
+		apt_handoff_destroy(server->handoff);
+		server->handoff = NULL;
+	}
 	task = apt_consumer_task_base_get(server->task);
 	if(apt_task_terminate(task,TRUE) == FALSE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Shutdown Server Task");
 		return FALSE;
 	}
-	server->session_table = NULL;
 	uptime = apr_time_now() - server->start_time;
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Server Uptime [%"APR_TIME_T_FMT" sec]", apr_time_sec(uptime));
 	return TRUE;
@@ -323,6 +768,20 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_destroy(mrcp_server_t *server)
 	task = apt_consumer_task_base_get(server->task);
 	apt_task_destroy(task);
 
+	if(server->admission) {
+		mrcp_server_admission_destroy(server->admission);
+		server->admission = NULL;
+	}
+	if(server->cluster) {
+		mrcp_server_cluster_destroy(server->cluster);
+		server->cluster = NULL;
+	}
+
+	if(server->session_pool_cache) {
+		apt_pool_cache_destroy(server->session_pool_cache);
+		server->session_pool_cache = NULL;
+	}
+
 	apr_pool_destroy(server->pool);
 	return TRUE;
 }
@@ -338,6 +797,22 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_resource_factory_register(mrcp_server_t *se
 	return TRUE;
 }
 
+/** Let the signaling agents know the engines or profiles have changed */
+static void mrcp_server_capabilities_invalidate(mrcp_server_t *server)
+{
+	mrcp_sig_agent_t *sig_agent;
+	apr_hash_index_t *it;
+	void *val;
+
+	for(it = apr_hash_first(NULL,server->sig_agent_table); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		sig_agent = val;
+		if(sig_agent && sig_agent->capabilities_invalidate) {
+			sig_agent->capabilities_invalidate(sig_agent);
+		}
+	}
+}
+
 /** Register MRCP engine */
 MRCP_DECLARE(apt_bool_t) mrcp_server_engine_register(mrcp_server_t *server, mrcp_engine_t *engine)
 {
@@ -353,7 +828,11 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_engine_register(mrcp_server_t *server, mrcp
 	engine->event_vtable = &engine_vtable;
 	engine->event_obj = server;
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Register MRCP Engine [%s]",engine->id);
-	return mrcp_engine_factory_engine_register(server->engine_factory,engine);
+	if(mrcp_engine_factory_engine_register(server->engine_factory,engine) == FALSE) {
+		return FALSE;
+	}
+	mrcp_server_capabilities_invalidate(server);
+	return TRUE;
 }
 
 /** Get MRCP engine by name */
@@ -452,6 +931,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_signaling_agent_register(mrcp_server_t *ser
 	signaling_agent->parent = server;
 	signaling_agent->resource_factory = server->resource_factory;
 	signaling_agent->create_server_session = mrcp_server_sig_agent_session_create;
+	signaling_agent->offer_check = mrcp_server_sig_agent_offer_check;
 	signaling_agent->msg_pool = apt_task_msg_pool_create_dynamic(sizeof(mrcp_signaling_message_t*),server->pool);
 	apr_hash_set(server->sig_agent_table,signaling_agent->id,APR_HASH_KEY_STRING,signaling_agent);
 	if(server->task) {
@@ -514,16 +994,46 @@ MRCP_DECLARE(mrcp_server_profile_t*) mrcp_server_profile_create(
 	profile->mrcp_version = mrcp_version;
 	profile->resource_factory = resource_factory;
 	profile->engine_table = NULL;
-	profile->media_engine = media_engine;
+	profile->media_engine = NULL;
+	profile->mpf_factory = NULL;
 	profile->rtp_termination_factory = rtp_factory;
 	profile->rtp_settings = rtp_settings;
 	profile->signaling_agent = signaling_agent;
 	profile->connection_agent = connection_agent;
+	profile->barge_in_link = FALSE;
 
-	mpf_termination_factory_engine_assign(rtp_factory,media_engine);
+	mrcp_server_profile_media_engine_add(profile,media_engine,pool);
 	return profile;
 }
 
+/** Enable barge-in link of the sessions of the profile by default */
+MRCP_DECLARE(void) mrcp_server_profile_barge_in_link_set(mrcp_server_profile_t *profile, apt_bool_t enable)
+{
+	if(profile) {
+		profile->barge_in_link = enable;
+	}
+}
+
+/** Add media engine to the pool of the profile */
+MRCP_DECLARE(apt_bool_t) mrcp_server_profile_media_engine_add(
+										mrcp_server_profile_t *profile,
+										mpf_engine_t *media_engine,
+										apr_pool_t *pool)
+{
+	if(!profile || !media_engine) {
+		return FALSE;
+	}
+	if(!profile->mpf_factory) {
+		profile->mpf_factory = mpf_engine_factory_create(pool);
+		profile->media_engine = media_engine;
+	}
+	mpf_engine_factory_engine_add(profile->mpf_factory,media_engine);
+
+	/* the terminations of each engine take ports from its own part of the range */
+	mpf_termination_factory_engine_assign(profile->rtp_termination_factory,media_engine);
+	return TRUE;
+}
+
 static apt_bool_t mrcp_server_engine_table_make(mrcp_server_t *server, mrcp_server_profile_t *profile, apr_hash_t *resource_engine_map)
 {
 	int i;
@@ -611,6 +1121,7 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_profile_register(
 
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Register Profile [%s]",profile->id);
 	apr_hash_set(server->profile_table,profile->id,APR_HASH_KEY_STRING,profile);
+	mrcp_server_capabilities_invalidate(server);
 	return TRUE;
 }
 
@@ -645,38 +1156,113 @@ MRCP_DECLARE(apr_pool_t*) mrcp_server_memory_pool_get(const mrcp_server_t *serve
 	return server->pool;
 }
 
+/** Get the shard to process the session by, which is selected by session id */
+static mrcp_server_shard_t* mrcp_server_shard_select(mrcp_server_t *server, mrcp_server_session_t *session)
+{
+	apr_ssize_t length;
+	if(server->shard_count == 1) {
+		return &server->shards[0];
+	}
+	if(!session->base.id.length) {
+		/* the id is generated by the server, unless the signaling agent already set it */
+		apt_unique_id_generate(&session->base.id,MRCP_SESSION_ID_HEX_STRING_LENGTH,session->base.pool);
+	}
+	length = session->base.id.length;
+	return &server->shards[apr_hashfunc_default(session->base.id.buf,&length) % server->shard_count];
+}
+
+/** Get the task of the shard the session is processed by */
+static APR_INLINE apt_task_t* mrcp_server_session_task_get(mrcp_server_t *server, mrcp_session_t *session)
+{
+	mrcp_server_shard_t *shard = session ? ((mrcp_server_session_t*)session)->shard : NULL;
+	if(!shard) {
+		shard = &server->shards[0];
+	}
+	return apt_consumer_task_base_get(shard->task);
+}
+
+static apt_bool_t mrcp_server_shard_task_msg_signal(shard_task_msg_type_e type, mrcp_server_t *server, mrcp_server_shard_t *shard)
+{
+	apt_task_msg_t *task_msg = apt_task_msg_acquire(server->shard_msg_pool);
+	task_msg->type = MRCP_SERVER_SHARD_TASK_MSG;
+	task_msg->sub_type = type;
+	return apt_task_msg_signal(apt_consumer_task_base_get(shard->task),task_msg);
+}
+
 void mrcp_server_session_add(mrcp_server_t *server, mrcp_server_session_t *session)
 {
 	if(!session->base.id.buf) 
 		return;
 
-	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Add Session " APT_SID_FMT,MRCP_SESSION_SID(&session->base));
-	apr_hash_set(server->session_table,session->base.id.buf,session->base.id.length,session);
+	if(!session->shard) {
+		session->shard = &server->shards[0];
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Add Session " APT_SID_FMT" [%"APR_SIZE_T_FMT"]",
+		MRCP_SESSION_SID(&session->base),
+		session->shard->index);
+	if(!apr_hash_get(session->shard->session_table,session->base.id.buf,session->base.id.length)) {
+		apr_atomic_inc32(&server->session_count);
+	}
+	apr_hash_set(session->shard->session_table,session->base.id.buf,session->base.id.length,session);
+}
+
+/** Release the memory account of session, recording its peak */
+static void mrcp_server_session_mem_release(mrcp_server_t *server, mrcp_server_session_t *session)
+{
+	apt_mem_account_stats_t stats;
+	if(!session->mem_account) {
+		return;
+	}
+	apt_mem_account_stats_get(session->mem_account,&stats);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Session Memory " APT_SID_FMT" peak [%"APR_SIZE_T_FMT"] left [%"APR_SIZE_T_FMT"] denied [%"APR_SIZE_T_FMT"]",
+		MRCP_SESSION_SID(&session->base),
+		stats.peak,
+		stats.used,
+		stats.denied);
+	if(server->session_mem_peaks) {
+		apt_histogram_record(server->session_mem_peaks,stats.peak > 0xFFFFFFFF ? 0xFFFFFFFF : (apr_uint32_t)stats.peak);
+	}
+	apt_mem_account_destroy(session->mem_account);
+	session->mem_account = NULL;
 }
 
 void mrcp_server_session_remove(mrcp_server_t *server, mrcp_server_session_t *session)
 {
-	if(!session->base.id.buf) 
+	mrcp_server_session_mem_release(server,session);
+	if(!session->base.id.buf || !session->shard) 
 		return;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Remove Session " APT_SID_FMT,MRCP_SESSION_SID(&session->base));
-	apr_hash_set(server->session_table,session->base.id.buf,session->base.id.length,NULL);
+	if(apr_hash_get(session->shard->session_table,session->base.id.buf,session->base.id.length)) {
+		apr_hash_set(session->shard->session_table,session->base.id.buf,session->base.id.length,NULL);
+		if(!apr_atomic_dec32(&server->session_count) && apr_atomic_read32(&server->draining)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Server Drained");
+		}
+	}
+	if(session->profile) {
+		apr_size_t size = apt_pool_size_get(session->base.pool);
+		apt_histogram_t *histogram = server->session_pool_sizes[session->profile->mrcp_version];
+		if(size && histogram) {
+			apt_histogram_record(histogram,size > 0xFFFFFFFF ? 0xFFFFFFFF : (apr_uint32_t)size);
+		}
+	}
 }
 
 void mrcp_server_session_idle_test(mrcp_server_t *server)
 {
 	if(server->shutdown_requested == TRUE) {
-		unsigned int count = apr_hash_count(server->session_table);
+		apr_uint32_t count = apr_atomic_read32(&server->session_count);
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Shutdown Pending: remaining sessions [%d]", count);
 		if(!count) {
-			mrcp_server_do_terminate(server);
+			/* the engines are closed by the main task */
+			mrcp_server_shard_task_msg_signal(SHARD_TASK_MSG_IDLE,server,&server->shards[0]);
 		}
 	}
 }
 
-static APR_INLINE mrcp_server_session_t* mrcp_server_session_find(mrcp_server_t *server, const apt_str_t *session_id)
+static APR_INLINE mrcp_server_session_t* mrcp_server_session_find(mrcp_server_shard_t *shard, const apt_str_t *session_id)
 {
-	return apr_hash_get(server->session_table,session_id->buf,session_id->length);
+	return apr_hash_get(shard->session_table,session_id->buf,session_id->length);
 }
 
 static apt_bool_t mrcp_server_start_request_process(apt_task_t *task)
@@ -684,6 +1270,13 @@ static apt_bool_t mrcp_server_start_request_process(apt_task_t *task)
 	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
 	mrcp_server_t *server = apt_consumer_task_object_get(consumer_task);
 
+	if(server->metrics_timer) {
+		apt_timer_set(server->metrics_timer,(apr_uint32_t)server->metrics_interval);
+	}
+	if(server->cluster_timer) {
+		apt_timer_set(server->cluster_timer,(apr_uint32_t)mrcp_server_cluster_interval_get(server->cluster));
+	}
+
 	mrcp_engine_t *engine;
 	apr_hash_index_t *it;
 	void *val;
@@ -701,6 +1294,36 @@ static apt_bool_t mrcp_server_start_request_process(apt_task_t *task)
 	return apt_task_start_request_process(task);
 }
 
+/** Enable statistics of the task and its children, unless already enabled */
+static void mrcp_server_task_stats_enable(apt_task_t *task)
+{
+	apt_task_t *child_task;
+	if(!apt_task_histogram_get(task,TASK_HISTOGRAM_QUEUE_DEPTH)) {
+		apt_task_stats_enable(task,0);
+	}
+	for(child_task = apt_task_child_first(task); child_task; child_task = apt_task_child_next(task,child_task)) {
+		mrcp_server_task_stats_enable(child_task);
+	}
+}
+
+static void mrcp_server_metrics_timer_proc(apt_timer_t *timer, void *obj)
+{
+	mrcp_server_t *server = obj;
+	apr_pool_t *pool;
+	if(apr_pool_create(&pool,server->pool) == APR_SUCCESS) {
+		mrcp_server_metrics_export(server,server->metrics_path,pool);
+		apr_pool_destroy(pool);
+	}
+	apt_timer_set(timer,(apr_uint32_t)server->metrics_interval);
+}
+
+static void mrcp_server_cluster_timer_proc(apt_timer_t *timer, void *obj)
+{
+	mrcp_server_t *server = obj;
+	mrcp_server_cluster_exchange(server->cluster);
+	apt_timer_set(timer,(apr_uint32_t)mrcp_server_cluster_interval_get(server->cluster));
+}
+
 static apt_bool_t mrcp_server_do_terminate(mrcp_server_t *server)
 {
 	apt_task_t *task = apt_consumer_task_base_get(server->task);
@@ -723,11 +1346,21 @@ static apt_bool_t mrcp_server_do_terminate(mrcp_server_t *server)
 }
 
 static void mrcp_server_sessions_release(mrcp_server_t *server)
+{
+	apr_size_t i;
+	/* sessions of other shards are released in the context of their tasks */
+	for(i=1; i<server->shard_count; i++) {
+		mrcp_server_shard_task_msg_signal(SHARD_TASK_MSG_RELEASE_SESSIONS,server,&server->shards[i]);
+	}
+	mrcp_server_shard_sessions_release(&server->shards[0]);
+}
+
+static void mrcp_server_shard_sessions_release(mrcp_server_shard_t *shard)
 {
 	mrcp_server_session_t *session;
 	apr_hash_index_t *it;
 	void *val;
-	it = apr_hash_first(NULL,server->session_table);
+	it = apr_hash_first(NULL,shard->session_table);
 	for(; it; it = apr_hash_next(it)) {
 		apr_hash_this(it,NULL,NULL,&val);
 		session = val;
@@ -745,13 +1378,46 @@ static apt_bool_t mrcp_server_terminate_request_process(apt_task_t *task)
 	mrcp_server_t *server = apt_consumer_task_object_get(consumer_task);
 
 	server->shutdown_requested = TRUE;
+	if(server->metrics_timer) {
+		apt_timer_kill(server->metrics_timer);
+	}
+	if(server->cluster_timer) {
+		apt_timer_kill(server->cluster_timer);
+	}
 
 	return apt_task_offline(task);
 }
 
 static void mrcp_server_on_start_complete(apt_task_t *task)
 {
-	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,SERVER_TASK_NAME" Started");
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	mrcp_server_t *server = apt_consumer_task_object_get(consumer_task);
+	const mrcp_engine_t *engine;
+	apr_hash_index_t *it;
+	void *val;
+	apr_size_t ready_count = 0;
+	apr_size_t count = 0;
+
+	/* all the engines have responded to open by now */
+	it = mrcp_engine_factory_engine_first(server->engine_factory);
+	for(; it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(engine) {
+			count++;
+			if(engine->is_open == TRUE) {
+				ready_count++;
+			}
+		}
+	}
+	apt_log(APT_LOG_MARK,ready_count == count ? APT_PRIO_NOTICE : APT_PRIO_WARNING,
+		SERVER_TASK_NAME" Started [%"APR_SIZE_T_FMT" of %"APR_SIZE_T_FMT" engines ready]",
+		ready_count,count);
+
+	if(server->handoff) {
+		/* release the predecessor, if any, and serve the successor */
+		apt_handoff_complete(server->handoff,mrcp_server_on_handoff,server);
+	}
 }
 
 static void mrcp_server_on_terminate_complete(apt_task_t *task)
@@ -767,7 +1433,7 @@ static void mrcp_server_on_offline_complete(apt_task_t *task)
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,SERVER_TASK_NAME" Taken Offline");
 	
 	if(server->shutdown_requested == TRUE) {
-		unsigned int count = apr_hash_count(server->session_table);
+		apr_uint32_t count = apr_atomic_read32(&server->session_count);
 		if(count) {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Shutdown Pending: release open sessions [%d]", count);
 			mrcp_server_sessions_release(server);
@@ -784,6 +1450,95 @@ static void mrcp_server_on_online_complete(apt_task_t *task)
 }
 
 static apt_bool_t mrcp_server_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	mrcp_server_t *server = apt_consumer_task_object_get(consumer_task);
+	/* the events queued ahead of the message are processed ahead of it */
+	mrcp_server_shard_events_process(&server->shards[0],task);
+	switch(msg->type) {
+		case MRCP_SERVER_ENGINE_TASK_MSG:
+		{
+			engine_task_msg_data_t *data = (engine_task_msg_data_t*)msg->data;
+			switch(msg->sub_type) {
+				case ENGINE_TASK_MSG_OPEN_ENGINE:
+					mrcp_engine_on_open(data->engine,data->status);
+					mrcp_server_capabilities_invalidate(server);
+					apt_task_start_request_remove(task);
+					return TRUE;
+				case ENGINE_TASK_MSG_CLOSE_ENGINE:
+					mrcp_engine_on_close(data->engine);
+					mrcp_server_capabilities_invalidate(server);
+					apt_task_terminate_request_remove(task);
+					return TRUE;
+				default:
+					break;
+			}
+			break;
+		}
+		case MRCP_SERVER_MEDIA_TASK_MSG:
+		{
+			/* MPF messages are sent to the main task, pass them on to the shard of the session */
+			mpf_message_container_t *mpf_message_container = (mpf_message_container_t*) msg->data;
+			mrcp_server_session_t *session = NULL;
+			if(mpf_message_container->count && mpf_message_container->messages[0].context) {
+				session = mpf_engine_context_object_get(mpf_message_container->messages[0].context);
+			}
+			if(session && session->shard && session->shard->index) {
+				apt_task_msg_t *task_msg = apt_task_msg_acquire(server->shard_msg_pool);
+				task_msg->type = msg->type;
+				task_msg->sub_type = msg->sub_type;
+				memcpy(task_msg->data,mpf_message_container,sizeof(mpf_message_container_t));
+				return apt_task_msg_signal(apt_consumer_task_base_get(session->shard->task),task_msg);
+			}
+			break;
+		}
+		case MRCP_SERVER_SHARD_TASK_MSG:
+		{
+			if(msg->sub_type == SHARD_TASK_MSG_IDLE) {
+				if(server->shutdown_requested == TRUE && !apr_atomic_read32(&server->session_count)) {
+					mrcp_server_do_terminate(server);
+				}
+			}
+			return TRUE;
+		}
+		default:
+			break;
+	}
+	return mrcp_server_session_msg_process(task,msg);
+}
+
+static apt_bool_t mrcp_server_shard_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	mrcp_server_shard_t *shard = apt_consumer_task_object_get(consumer_task);
+	/* the events queued ahead of the message are processed ahead of it */
+	mrcp_server_shard_events_process(shard,task);
+	if(msg->type == MRCP_SERVER_SHARD_TASK_MSG) {
+		if(msg->sub_type == SHARD_TASK_MSG_RELEASE_SESSIONS) {
+			mrcp_server_shard_sessions_release(shard);
+		}
+		return TRUE;
+	}
+	return mrcp_server_session_msg_process(task,msg);
+}
+
+/** Process all the queued events of the shard (in the context of the shard) */
+static void mrcp_server_shard_events_process(mrcp_server_shard_t *shard, apt_task_t *task)
+{
+	apt_task_msg_t *task_msg;
+	if(!shard->events) {
+		return;
+	}
+	/* cleared first, so that an event queued meanwhile signals the shard again */
+	apr_atomic_xchg32(&shard->events_pending,0);
+	while((task_msg = apt_mpsc_queue_pop(shard->events)) != NULL) {
+		mrcp_server_session_msg_process(task,task_msg);
+		apt_task_msg_release(task_msg);
+	}
+}
+
+/** Process messages of sessions (in the context of the shard the sessions are processed by) */
+static apt_bool_t mrcp_server_session_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
 	switch(msg->type) {
 		case MRCP_SERVER_SIGNALING_TASK_MSG:
@@ -830,14 +1585,6 @@ static apt_bool_t mrcp_server_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 		{
 			engine_task_msg_data_t *data = (engine_task_msg_data_t*)msg->data;
 			switch(msg->sub_type) {
-				case ENGINE_TASK_MSG_OPEN_ENGINE:
-					mrcp_engine_on_open(data->engine,data->status);
-					apt_task_start_request_remove(task);
-					break;
-				case ENGINE_TASK_MSG_CLOSE_ENGINE:
-					mrcp_engine_on_close(data->engine);
-					apt_task_terminate_request_remove(task);
-					break;
 				case ENGINE_TASK_MSG_OPEN_CHANNEL:
 					mrcp_server_on_engine_channel_open(data->channel,data->status);
 					break;
@@ -864,12 +1611,15 @@ static apt_bool_t mrcp_server_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 			break;
 		}
 	}
+	/* leave the log scope of the session entered by the handler, if any */
+	apt_log_scope_set(APT_PRIO_COUNT);
 	return TRUE;
 }
 
 static apt_bool_t mrcp_server_signaling_task_msg_signal(mrcp_signaling_message_type_e type, mrcp_session_t *session, mrcp_session_descriptor_t *descriptor, mrcp_message_t *message)
 {
 	mrcp_signaling_message_t *signaling_message;
+	mrcp_server_session_t *server_session;
 	apt_task_msg_t *task_msg = apt_task_msg_acquire(session->signaling_agent->msg_pool);
 	mrcp_signaling_message_t **slot = ((mrcp_signaling_message_t**)task_msg->data);
 	task_msg->type = MRCP_SERVER_SIGNALING_TASK_MSG;
@@ -882,8 +1632,13 @@ static apt_bool_t mrcp_server_signaling_task_msg_signal(mrcp_signaling_message_t
 	signaling_message->channel = NULL;
 	signaling_message->message = message;
 	*slot = signaling_message;
-	
-	return apt_task_msg_parent_signal(session->signaling_agent->task,task_msg);
+
+	server_session = (mrcp_server_session_t*)session;
+	if(!server_session->shard) {
+		/* the session is bound to its shard for life from the first signaling message on */
+		server_session->shard = mrcp_server_shard_select(server_session->server,server_session);
+	}
+	return apt_task_msg_signal(apt_consumer_task_base_get(server_session->shard->task),task_msg);
 }
 
 static apt_bool_t mrcp_server_connection_task_msg_signal(
@@ -895,18 +1650,24 @@ static apt_bool_t mrcp_server_connection_task_msg_signal(
 							apt_bool_t                       status)
 {
 	mrcp_server_t *server = mrcp_server_connection_agent_object_get(agent);
-	apt_task_t *task = apt_consumer_task_base_get(server->task);
+	mrcp_channel_t *server_channel = channel ? channel->obj : NULL;
+	mrcp_session_t *session = server_channel ? mrcp_server_channel_session_get(server_channel) : NULL;
 	connection_agent_task_msg_data_t *data;
 	apt_task_msg_t *task_msg = apt_task_msg_acquire(server->connection_msg_pool);
 	task_msg->type = MRCP_SERVER_CONNECTION_TASK_MSG;
 	task_msg->sub_type = type;
 	data = (connection_agent_task_msg_data_t*) task_msg->data;
-	data->channel = channel ? channel->obj : NULL;
+	data->channel = server_channel;
 	data->descriptor = descriptor;
 	data->message = message;
 	data->status = status;
 
-	return apt_task_msg_signal(task,task_msg);
+	if(type == CONNECTION_AGENT_TASK_MSG_RECEIVE_MESSAGE || type == CONNECTION_AGENT_TASK_MSG_DISCONNECT) {
+		/* the messages parsed out of a receive are dispatched to the shard in a batch,
+		the disconnect is queued along in order not to overtake them */
+		return mrcp_server_shard_event_signal(server,session ? ((mrcp_server_session_t*)session)->shard : NULL,task_msg);
+	}
+	return apt_task_msg_signal(mrcp_server_session_task_get(server,session),task_msg);
 }
 
 static apt_bool_t mrcp_server_engine_task_msg_signal(
@@ -938,7 +1699,7 @@ static apt_bool_t mrcp_server_channel_task_msg_signal(
 	mrcp_channel_t *channel = engine_channel->event_obj;
 	mrcp_session_t *session = mrcp_server_channel_session_get(channel);
 	mrcp_server_t *server = session->signaling_agent->parent;
-	apt_task_t *task = apt_consumer_task_base_get(server->task);
+	mrcp_server_shard_t *shard = ((mrcp_server_session_t*)session)->shard;
 	engine_task_msg_data_t *data;
 	apt_task_msg_t *task_msg = apt_task_msg_acquire(server->engine_msg_pool);
 	task_msg->type = MRCP_SERVER_ENGINE_TASK_MSG;
@@ -949,7 +1710,24 @@ static apt_bool_t mrcp_server_channel_task_msg_signal(
 	data->status = status;
 	data->mrcp_message = message;
 
-	return apt_task_msg_signal(task,task_msg);
+	return mrcp_server_shard_event_signal(server,shard,task_msg);
+}
+
+/** Queue event to the shard, the shard is signaled once per batch of events */
+static apt_bool_t mrcp_server_shard_event_signal(mrcp_server_t *server, mrcp_server_shard_t *shard, apt_task_msg_t *task_msg)
+{
+	if(!shard) {
+		shard = &server->shards[0];
+	}
+	if(!shard->events || apt_mpsc_queue_push(shard->events,task_msg) == FALSE) {
+		/* the queue is full, still processed after the queued events */
+		return apt_task_msg_signal(apt_consumer_task_base_get(shard->task),task_msg);
+	}
+	/* the events queued meanwhile are processed along, the shard is signaled once per batch */
+	if(apr_atomic_cas32(&shard->events_pending,1,0) != 0) {
+		return TRUE;
+	}
+	return mrcp_server_shard_task_msg_signal(SHARD_TASK_MSG_EVENTS,server,shard);
 }
 
 static mrcp_server_profile_t* mrcp_server_profile_get_by_agent(mrcp_server_t *server, mrcp_server_session_t *session, const mrcp_sig_agent_t *signaling_agent)
@@ -968,10 +1746,30 @@ static mrcp_server_profile_t* mrcp_server_profile_get_by_agent(mrcp_server_t *se
 	return NULL;
 }
 
+static mrcp_sig_offer_e mrcp_server_sig_agent_offer_check(mrcp_sig_agent_t *signaling_agent, char *redirect_uri, apr_size_t size, apr_size_t *retry_after)
+{
+	mrcp_server_t *server = signaling_agent->parent;
+	if(!server->cluster) {
+		return MRCP_SIG_OFFER_ACCEPT;
+	}
+	switch(mrcp_server_cluster_offer_check(server->cluster,redirect_uri,size)) {
+		case MRCP_CLUSTER_OFFER_REDIRECT:
+			return MRCP_SIG_OFFER_REDIRECT;
+		case MRCP_CLUSTER_OFFER_REJECT:
+			if(retry_after) {
+				*retry_after = mrcp_server_cluster_retry_after_get(server->cluster);
+			}
+			return MRCP_SIG_OFFER_REJECT;
+		default:
+			break;
+	}
+	return MRCP_SIG_OFFER_ACCEPT;
+}
+
 static mrcp_session_t* mrcp_server_sig_agent_session_create(mrcp_sig_agent_t *signaling_agent)
 {
 	mrcp_server_t *server = signaling_agent->parent;
-	mrcp_server_session_t *session = mrcp_server_session_create();
+	mrcp_server_session_t *session = mrcp_server_session_create(server->session_pool_cache);
 	session->server = server;
 	session->profile = mrcp_server_profile_get_by_agent(server,session,signaling_agent);
 	if(!session->profile) {
@@ -985,6 +1783,9 @@ static mrcp_session_t* mrcp_server_sig_agent_session_create(mrcp_sig_agent_t *si
 			session->base.name,
 			MRCP_SESSION_SID(&session->base), 
 			session->profile->id);
+	if(server->mem_account) {
+		session->mem_account = apt_mem_account_create(session->base.name,server->session_mem_cap,server->mem_account,session->base.pool);
+	}
 	session->base.signaling_agent = signaling_agent;
 	session->base.request_vtable = &session_request_vtable;
 	return &session->base;
@@ -1101,6 +1902,8 @@ static apt_bool_t mrcp_server_channel_close_signal(mrcp_engine_channel_t *channe
 
 static apt_bool_t mrcp_server_channel_message_signal(mrcp_engine_channel_t *channel, mrcp_message_t *message)
 {
+	/* the synthesizer is cut right away, ahead of the message reaching the session */
+	mrcp_server_barge_in_signal(channel->event_obj,message);
 	return mrcp_server_channel_task_msg_signal(
 								ENGINE_TASK_MSG_MESSAGE,
 								channel,
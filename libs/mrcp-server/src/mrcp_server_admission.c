@@ -0,0 +1,164 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include <apr_hash.h>
+#include <apr_thread_mutex.h>
+#include "mrcp_server_admission.h"
+#include "apt_log.h"
+
+/** Sample of tick statistics of a media engine */
+typedef struct mrcp_admission_sample_t mrcp_admission_sample_t;
+
+struct mrcp_admission_sample_t {
+	/** Time the sample is taken at */
+	apr_time_t           time;
+	/** Tick statistics at the time of the sample */
+	mpf_scheduler_stat_t stat;
+	/** Whether the media engine was overloaded within the last interval */
+	apt_bool_t           overloaded;
+};
+
+/** Admission control */
+struct mrcp_server_admission_t {
+	/** Thresholds */
+	mrcp_admission_settings_t settings;
+	/** Samples of media engines (mpf_engine_t* -> mrcp_admission_sample_t*) */
+	apr_hash_t               *samples;
+	/** Guard of the samples, accessed by session shards */
+	apr_thread_mutex_t       *guard;
+	/** Pool to allocate memory from */
+	apr_pool_t               *pool;
+};
+
+/** Allocate admission control settings */
+MRCP_DECLARE(mrcp_admission_settings_t*) mrcp_admission_settings_alloc(apr_pool_t *pool)
+{
+	mrcp_admission_settings_t *settings = apr_palloc(pool,sizeof(mrcp_admission_settings_t));
+	settings->channel_usage = 0;
+	settings->late_tick_rate = 0;
+	settings->engine_backlog = 0;
+	settings->sampling_interval = MRCP_ADMISSION_DEFAULT_SAMPLING_INTERVAL;
+	settings->retry_after = MRCP_ADMISSION_DEFAULT_RETRY_AFTER;
+	return settings;
+}
+
+/** Create admission control */
+MRCP_DECLARE(mrcp_server_admission_t*) mrcp_server_admission_create(const mrcp_admission_settings_t *settings, apr_pool_t *pool)
+{
+	mrcp_server_admission_t *admission = apr_palloc(pool,sizeof(mrcp_server_admission_t));
+	admission->settings = *settings;
+	if(!admission->settings.sampling_interval) {
+		admission->settings.sampling_interval = MRCP_ADMISSION_DEFAULT_SAMPLING_INTERVAL;
+	}
+	admission->samples = apr_hash_make(pool);
+	admission->guard = NULL;
+	if(apr_thread_mutex_create(&admission->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Admission Control Mutex");
+		return NULL;
+	}
+	admission->pool = pool;
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Admission Control [channel usage: %"APR_SIZE_T_FMT"%%] "
+		"[late ticks: %"APR_SIZE_T_FMT"%%] [engine backlog: %"APR_SIZE_T_FMT"]",
+		admission->settings.channel_usage,
+		admission->settings.late_tick_rate,
+		admission->settings.engine_backlog);
+	return admission;
+}
+
+/** Destroy admission control */
+MRCP_DECLARE(void) mrcp_server_admission_destroy(mrcp_server_admission_t *admission)
+{
+	if(admission->guard) {
+		apr_thread_mutex_destroy(admission->guard);
+		admission->guard = NULL;
+	}
+}
+
+/** Check whether the media engine can take a new session */
+MRCP_DECLARE(apt_bool_t) mrcp_server_admission_media_check(mrcp_server_admission_t *admission, const mpf_engine_t *media_engine)
+{
+	mrcp_admission_sample_t *sample;
+	apt_bool_t overloaded;
+	apr_time_t now;
+
+	if(!admission->settings.late_tick_rate || !media_engine) {
+		return TRUE;
+	}
+
+	now = apr_time_now();
+	apr_thread_mutex_lock(admission->guard);
+	sample = apr_hash_get(admission->samples,&media_engine,sizeof(media_engine));
+	if(!sample) {
+		sample = apr_palloc(admission->pool,sizeof(mrcp_admission_sample_t));
+		sample->time = now;
+		mpf_engine_scheduler_stat_get(media_engine,&sample->stat);
+		sample->overloaded = FALSE;
+		apr_hash_set(admission->samples,apr_pmemdup(admission->pool,&media_engine,sizeof(media_engine)),sizeof(media_engine),sample);
+	}
+	else if(now - sample->time >= apr_time_from_msec(admission->settings.sampling_interval)) {
+		/* the rate is computed over the last interval, not since the start of the engine */
+		mpf_scheduler_stat_t stat;
+		apr_uint64_t ticks;
+		apr_uint64_t late_ticks;
+		mpf_engine_scheduler_stat_get(media_engine,&stat);
+		ticks = stat.tick_count - sample->stat.tick_count;
+		late_ticks = stat.late_count - sample->stat.late_count;
+		sample->overloaded = ticks && late_ticks * 100 >= ticks * admission->settings.late_tick_rate;
+		if(sample->overloaded == TRUE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Media Engine Overloaded [%s] [late ticks: %"APR_UINT64_T_FMT"/%"APR_UINT64_T_FMT"]",
+				mpf_engine_id_get(media_engine),late_ticks,ticks);
+		}
+		sample->time = now;
+		sample->stat = stat;
+	}
+	overloaded = sample->overloaded;
+	apr_thread_mutex_unlock(admission->guard);
+	return overloaded == TRUE ? FALSE : TRUE;
+}
+
+/** Check whether the MRCP engine can take a new channel */
+MRCP_DECLARE(apt_bool_t) mrcp_server_admission_engine_check(const mrcp_server_admission_t *admission, const mrcp_engine_t *engine)
+{
+	if(!engine) {
+		return TRUE;
+	}
+
+	if(admission->settings.channel_usage && engine->config && engine->config->max_channel_count) {
+		apr_uint32_t count = apr_atomic_read32((volatile apr_uint32_t*)&engine->cur_channel_count);
+		if(count * 100 >= engine->config->max_channel_count * admission->settings.channel_usage) {
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Engine Overloaded [%s] [channels: %d/%"APR_SIZE_T_FMT"]",
+				engine->id,count,engine->config->max_channel_count);
+			return FALSE;
+		}
+	}
+
+	if(admission->settings.engine_backlog) {
+		apr_uint32_t backlog = apr_atomic_read32((volatile apr_uint32_t*)&engine->backlog);
+		if(backlog >= admission->settings.engine_backlog) {
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Engine Overloaded [%s] [backlog: %d]",
+				engine->id,backlog);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/** Get the time (sec) rejected clients are asked to retry in */
+MRCP_DECLARE(apr_size_t) mrcp_server_admission_retry_after_get(const mrcp_server_admission_t *admission)
+{
+	return admission->settings.retry_after;
+}
@@ -0,0 +1,807 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_atomic.h>
+#include <apr_hash.h>
+#include <apr_network_io.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+#include <apr_sha1.h>
+#include "mrcp_server_cluster.h"
+#include "mrcp_server.h"
+#include "mrcp_engine_types.h"
+#include "apt_histogram.h"
+#include "apt_log.h"
+
+/** Max number of peers a node keeps track of */
+#define MRCP_CLUSTER_MAX_PEERS       64
+/** Max size of a gossip datagram */
+#define MRCP_CLUSTER_MAX_MESSAGE     2048
+/** Number of intervals a peer is considered alive for since last heard */
+#define MRCP_CLUSTER_ALIVE_INTERVALS 3
+/** Number of intervals a learned peer is forgotten in since last heard */
+#define MRCP_CLUSTER_FORGET_INTERVALS 30
+
+/** Start line of a gossip datagram */
+#define MRCP_CLUSTER_SIGNATURE       "UNIMRCP-CLUSTER/1.0"
+/** Last line of a gossip datagram, the HMAC-SHA1 (hex) of the preceding lines keyed by the secret */
+#define MRCP_CLUSTER_AUTH_HEADER     "auth: "
+/** Block size of SHA-1, which HMAC pads the key to */
+#define MRCP_CLUSTER_HMAC_BLOCK_SIZE 64
+
+/** Load of a node */
+typedef struct mrcp_cluster_load_t mrcp_cluster_load_t;
+
+struct mrcp_cluster_load_t {
+	/** Number of channels in use across all the engines */
+	apr_size_t channels;
+	/** Max number of channels across the limited engines (0 - unlimited) */
+	apr_size_t capacity;
+	/** Max percentage of channel usage of an engine */
+	apr_size_t usage;
+	/** Number of jobs queued to the threads of all the engines */
+	apr_size_t backlog;
+	/** Max real-time factor (percent) of an engine within the last intervals */
+	apr_size_t rtf;
+	/** Whether the node admits new offers */
+	apt_bool_t admitting;
+};
+
+/** Peer node */
+typedef struct mrcp_cluster_peer_t mrcp_cluster_peer_t;
+
+struct mrcp_cluster_peer_t {
+	/** Address to gossip to */
+	apr_sockaddr_t     *sockaddr;
+	/** Address as "ip:port", the peer is looked up by */
+	char                address[64];
+	/** Identifier of the node */
+	char                node_id[64];
+	/** SIP URI offers are redirected to */
+	char                sip_uri[256];
+	/** Last load gossiped, adjusted by the offers redirected to the peer since */
+	mrcp_cluster_load_t load;
+	/** Time last heard of (0 - never) */
+	apr_time_t          last_heard;
+	/** Time added at, a learned peer never heard of is forgotten since */
+	apr_time_t          added;
+	/** Whether the peer is a seed, which is never forgotten */
+	apt_bool_t          seed;
+	/** Whether the peer turned out to be the node itself */
+	apt_bool_t          self;
+	/** Pool of the slot, cleared whenever the slot is reused */
+	apr_pool_t         *pool;
+};
+
+/** Real-time factor sample of an engine */
+typedef struct mrcp_cluster_rtf_sample_t mrcp_cluster_rtf_sample_t;
+
+struct mrcp_cluster_rtf_sample_t {
+	/** Number of measurements at the time of the sample */
+	apr_size_t count;
+	/** Sum of measurements (permille) at the time of the sample */
+	double     sum;
+	/** Real-time factor (percent) within the last interval a measurement completed in */
+	apr_size_t rtf;
+};
+
+/** Cluster */
+struct mrcp_server_cluster_t {
+	/** Settings */
+	mrcp_cluster_settings_t settings;
+	/** MRCP server to gossip the load of */
+	mrcp_server_t          *server;
+	/** Socket to gossip on */
+	apr_socket_t           *sock;
+	/** Local load */
+	mrcp_cluster_load_t     local;
+	/** Peers (NULL - slot of a forgotten peer) */
+	mrcp_cluster_peer_t    *peers[MRCP_CLUSTER_MAX_PEERS];
+	/** Peers of the slots in use or forgotten, reused along with the slots */
+	mrcp_cluster_peer_t    *slots[MRCP_CLUSTER_MAX_PEERS];
+	/** Number of peer slots in use */
+	apr_size_t              peer_count;
+	/** Sequence number of the last gossip sent */
+	apr_size_t              seq;
+	/** Samples of engines (mrcp_engine_t* -> mrcp_cluster_rtf_sample_t*) */
+	apr_hash_t             *rtf_samples;
+	/** Guard of the local load and peers, accessed by signaling agents */
+	apr_thread_mutex_t     *guard;
+	/** Pool to allocate memory from */
+	apr_pool_t             *pool;
+};
+
+static mrcp_cluster_peer_t* mrcp_cluster_peer_add(mrcp_server_cluster_t *cluster, const char *host, apr_port_t port, const char *address, apt_bool_t seed, apr_time_t now);
+
+/** Allocate cluster settings */
+MRCP_DECLARE(mrcp_cluster_settings_t*) mrcp_cluster_settings_alloc(apr_pool_t *pool)
+{
+	mrcp_cluster_settings_t *settings = apr_palloc(pool,sizeof(mrcp_cluster_settings_t));
+	settings->node_id = NULL;
+	settings->sip_uri = NULL;
+	settings->ip = NULL;
+	settings->port = 0;
+	settings->peers = apr_array_make(pool,1,sizeof(const char*));
+	settings->interval = MRCP_CLUSTER_DEFAULT_INTERVAL;
+	settings->redirect_usage = MRCP_CLUSTER_DEFAULT_REDIRECT_USAGE;
+	settings->max_rtf = MRCP_CLUSTER_DEFAULT_MAX_RTF;
+	settings->margin = MRCP_CLUSTER_DEFAULT_MARGIN;
+	settings->retry_after = 0;
+	settings->secret = NULL;
+	return settings;
+}
+
+/** Resolve "ip:port" of a seed peer */
+static apt_bool_t mrcp_cluster_seed_add(mrcp_server_cluster_t *cluster, const char *str)
+{
+	char *host = NULL;
+	char *scope_id = NULL;
+	char *ip = NULL;
+	apr_port_t port = 0;
+	apr_sockaddr_t *sockaddr = NULL;
+	const char *address;
+
+	if(apr_parse_addr_port(&host,&scope_id,&port,str,cluster->pool) != APR_SUCCESS || !host || !port) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Cluster Peer [%s]",str);
+		return FALSE;
+	}
+	if(apr_sockaddr_info_get(&sockaddr,host,APR_INET,port,0,cluster->pool) != APR_SUCCESS || !sockaddr) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Resolve Cluster Peer [%s]",str);
+		return FALSE;
+	}
+	apr_sockaddr_ip_get(&ip,sockaddr);
+	address = apr_psprintf(cluster->pool,"%s:%hu",ip,port);
+	return mrcp_cluster_peer_add(cluster,ip,port,address,TRUE,apr_time_now()) ? TRUE : FALSE;
+}
+
+/** Create cluster */
+MRCP_DECLARE(mrcp_server_cluster_t*) mrcp_server_cluster_create(
+										const mrcp_cluster_settings_t *settings,
+										mrcp_server_t *server,
+										apr_pool_t *pool)
+{
+	mrcp_server_cluster_t *cluster;
+	apr_sockaddr_t *sockaddr = NULL;
+	int i;
+
+	if(!settings->node_id || !settings->sip_uri || !settings->ip || !settings->port) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Cluster Requires Node Id, SIP URI, IP and Port");
+		return NULL;
+	}
+
+	cluster = apr_palloc(pool,sizeof(mrcp_server_cluster_t));
+	cluster->settings = *settings;
+	if(!cluster->settings.interval) {
+		cluster->settings.interval = MRCP_CLUSTER_DEFAULT_INTERVAL;
+	}
+	cluster->server = server;
+	cluster->sock = NULL;
+	cluster->local.channels = 0;
+	cluster->local.capacity = 0;
+	cluster->local.usage = 0;
+	cluster->local.backlog = 0;
+	cluster->local.rtf = 0;
+	cluster->local.admitting = TRUE;
+	cluster->peer_count = 0;
+	memset(cluster->peers,0,sizeof(cluster->peers));
+	memset(cluster->slots,0,sizeof(cluster->slots));
+	cluster->seq = 0;
+	cluster->rtf_samples = apr_hash_make(pool);
+	cluster->guard = NULL;
+	cluster->pool = pool;
+
+	if(apr_sockaddr_info_get(&sockaddr,settings->ip,APR_INET,settings->port,0,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Cluster Address %s:%hu",settings->ip,settings->port);
+		return NULL;
+	}
+	if(apr_socket_create(&cluster->sock,sockaddr->family,SOCK_DGRAM,APR_PROTO_UDP,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Cluster Socket");
+		return NULL;
+	}
+	apr_socket_opt_set(cluster->sock,APR_SO_REUSEADDR,1);
+	if(apr_socket_bind(cluster->sock,sockaddr) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Bind Cluster Socket to %s:%hu",settings->ip,settings->port);
+		apr_socket_close(cluster->sock);
+		return NULL;
+	}
+	/* the gossip received is taken in by the server task every interval, never waited for */
+	apr_socket_opt_set(cluster->sock,APR_SO_NONBLOCK,1);
+	apr_socket_timeout_set(cluster->sock,0);
+
+	if(apr_thread_mutex_create(&cluster->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Cluster Mutex");
+		apr_socket_close(cluster->sock);
+		return NULL;
+	}
+
+	for(i = 0; i < settings->peers->nelts; i++) {
+		mrcp_cluster_seed_add(cluster,APR_ARRAY_IDX(settings->peers,i,const char*));
+	}
+	if(!settings->secret || !*settings->secret) {
+		cluster->settings.secret = NULL;
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Cluster Gossip is not Authenticated, only Known Peers are Heard");
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Create Cluster Node [%s] %s:%hu [%s] [peers: %"APR_SIZE_T_FMT"] "
+		"[redirect usage: %"APR_SIZE_T_FMT"%%] [max rtf: %"APR_SIZE_T_FMT"%%]",
+		settings->node_id,
+		settings->ip,
+		settings->port,
+		settings->sip_uri,
+		cluster->peer_count,
+		cluster->settings.redirect_usage,
+		cluster->settings.max_rtf);
+	return cluster;
+}
+
+/** Destroy cluster */
+MRCP_DECLARE(void) mrcp_server_cluster_destroy(mrcp_server_cluster_t *cluster)
+{
+	if(cluster->sock) {
+		apr_socket_close(cluster->sock);
+		cluster->sock = NULL;
+	}
+	if(cluster->guard) {
+		apr_thread_mutex_destroy(cluster->guard);
+		cluster->guard = NULL;
+	}
+}
+
+/** Get the interval (msec) the load is gossiped at */
+MRCP_DECLARE(apr_size_t) mrcp_server_cluster_interval_get(const mrcp_server_cluster_t *cluster)
+{
+	return cluster->settings.interval;
+}
+
+/** Get the time (sec) rejected clients are asked to retry in */
+MRCP_DECLARE(apr_size_t) mrcp_server_cluster_retry_after_get(const mrcp_server_cluster_t *cluster)
+{
+	return cluster->settings.retry_after;
+}
+
+/** Find peer by "ip:port" */
+static mrcp_cluster_peer_t* mrcp_cluster_peer_find(mrcp_server_cluster_t *cluster, const char *address)
+{
+	apr_size_t i;
+	for(i = 0; i < cluster->peer_count; i++) {
+		if(cluster->peers[i] && strcmp(cluster->peers[i]->address,address) == 0) {
+			return cluster->peers[i];
+		}
+	}
+	return NULL;
+}
+
+/** Add peer, reusing the slot of a forgotten one */
+static mrcp_cluster_peer_t* mrcp_cluster_peer_add(mrcp_server_cluster_t *cluster, const char *host, apr_port_t port, const char *address, apt_bool_t seed, apr_time_t now)
+{
+	mrcp_cluster_peer_t *peer;
+	apr_sockaddr_t *sockaddr = NULL;
+	apr_size_t slot;
+	for(slot = 0; slot < cluster->peer_count; slot++) {
+		if(!cluster->peers[slot]) {
+			break;
+		}
+	}
+	if(slot == cluster->peer_count) {
+		if(cluster->peer_count == MRCP_CLUSTER_MAX_PEERS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Cluster Peers Exceed Max [%d], Ignore [%s]",MRCP_CLUSTER_MAX_PEERS,address);
+			return NULL;
+		}
+		cluster->peer_count++;
+	}
+
+	/* the peer of a slot is allocated once, the memory of a forgotten one goes with its pool */
+	peer = cluster->slots[slot];
+	if(peer) {
+		apr_pool_clear(peer->pool);
+	}
+	else {
+		apr_pool_t *pool;
+		if(apr_pool_create(&pool,cluster->pool) != APR_SUCCESS) {
+			return NULL;
+		}
+		peer = apr_palloc(pool,sizeof(mrcp_cluster_peer_t));
+		peer->pool = pool;
+		cluster->slots[slot] = peer;
+	}
+	if(apr_sockaddr_info_get(&sockaddr,host,APR_INET,port,0,peer->pool) != APR_SUCCESS || !sockaddr) {
+		return NULL;
+	}
+	peer->sockaddr = sockaddr;
+	apr_cpystrn(peer->address,address,sizeof(peer->address));
+	*peer->node_id = '\0';
+	*peer->sip_uri = '\0';
+	peer->load.channels = 0;
+	peer->load.capacity = 0;
+	peer->load.usage = 0;
+	peer->load.backlog = 0;
+	peer->load.rtf = 0;
+	peer->load.admitting = FALSE;
+	peer->last_heard = 0;
+	peer->added = now;
+	peer->seed = seed;
+	peer->self = FALSE;
+	cluster->peers[slot] = peer;
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Add Cluster Peer [%s]%s",address,seed ? " (seed)" : "");
+	return peer;
+}
+
+/** Learn peer by "ip:port" gossiped by another one */
+static void mrcp_cluster_peer_learn(mrcp_server_cluster_t *cluster, const char *address, apr_time_t now, apr_pool_t *pool)
+{
+	char *host = NULL;
+	char *scope_id = NULL;
+	apr_port_t port = 0;
+
+	if(mrcp_cluster_peer_find(cluster,address)) {
+		return;
+	}
+	if(apr_parse_addr_port(&host,&scope_id,&port,address,pool) != APR_SUCCESS || !host || !port) {
+		return;
+	}
+	if(port == cluster->settings.port && strcmp(host,cluster->settings.ip) == 0) {
+		return;
+	}
+	mrcp_cluster_peer_add(cluster,host,port,address,FALSE,now);
+}
+
+/** Check whether peer was heard of lately */
+static APR_INLINE apt_bool_t mrcp_cluster_peer_is_alive(const mrcp_server_cluster_t *cluster, const mrcp_cluster_peer_t *peer, apr_time_t now)
+{
+	if(!peer->last_heard || peer->self) {
+		return FALSE;
+	}
+	return (now - peer->last_heard) <= apr_time_from_msec(MRCP_CLUSTER_ALIVE_INTERVALS * cluster->settings.interval) ? TRUE : FALSE;
+}
+
+/** Measure the local load of the engines */
+static void mrcp_cluster_local_measure(mrcp_server_cluster_t *cluster, mrcp_cluster_load_t *load)
+{
+	mrcp_cluster_rtf_sample_t *sample;
+	mrcp_engine_t *engine;
+	apr_hash_index_t *it;
+	void *val;
+	apr_size_t channels;
+	apr_size_t count;
+	double sum;
+
+	load->channels = 0;
+	load->capacity = 0;
+	load->usage = 0;
+	load->backlog = 0;
+	load->rtf = 0;
+	for(it = mrcp_server_engine_first(cluster->server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(!engine) {
+			continue;
+		}
+		channels = apr_atomic_read32(&engine->cur_channel_count);
+		load->channels += channels;
+		load->backlog += apr_atomic_read32(&engine->backlog);
+		if(engine->config && engine->config->max_channel_count) {
+			apr_size_t usage = channels * 100 / engine->config->max_channel_count;
+			load->capacity += engine->config->max_channel_count;
+			if(usage > load->usage) {
+				load->usage = usage;
+			}
+		}
+
+		if(!engine->rtf_histogram) {
+			continue;
+		}
+		sample = apr_hash_get(cluster->rtf_samples,&engine,sizeof(engine));
+		if(!sample) {
+			sample = apr_palloc(cluster->pool,sizeof(mrcp_cluster_rtf_sample_t));
+			sample->count = 0;
+			sample->sum = 0;
+			sample->rtf = 0;
+			apr_hash_set(cluster->rtf_samples,apr_pmemdup(cluster->pool,&engine,sizeof(engine)),sizeof(engine),sample);
+		}
+		/* the recent factor is the mean of the measurements completed since the last sample */
+		count = apt_histogram_count_get(engine->rtf_histogram);
+		sum = apt_histogram_mean_get(engine->rtf_histogram) * count;
+		if(count > sample->count) {
+			sample->rtf = (apr_size_t)((sum - sample->sum) / (count - sample->count) / 10);
+		}
+		else if(count < sample->count || !channels) {
+			/* reset of the histogram, or an idle engine */
+			sample->rtf = 0;
+		}
+		sample->count = count;
+		sample->sum = sum;
+		if(sample->rtf > load->rtf) {
+			load->rtf = sample->rtf;
+		}
+	}
+
+	load->admitting = TRUE;
+	if(mrcp_server_draining_get(cluster->server,NULL) == TRUE) {
+		load->admitting = FALSE;
+	}
+	else if(load->capacity && load->usage >= 100) {
+		load->admitting = FALSE;
+	}
+	else if(cluster->settings.max_rtf && load->rtf >= cluster->settings.max_rtf) {
+		load->admitting = FALSE;
+	}
+}
+
+/** Compute HMAC-SHA1 of data keyed by the secret, as hex */
+static void mrcp_cluster_hmac_compute(const char *secret, const char *data, apr_size_t length, char hex[2 * APR_SHA1_DIGESTSIZE + 1])
+{
+	static const char digits[] = "0123456789abcdef";
+	unsigned char key[MRCP_CLUSTER_HMAC_BLOCK_SIZE];
+	unsigned char pad[MRCP_CLUSTER_HMAC_BLOCK_SIZE];
+	unsigned char digest[APR_SHA1_DIGESTSIZE];
+	apr_sha1_ctx_t context;
+	apr_size_t key_length = strlen(secret);
+	apr_size_t i;
+
+	memset(key,0,sizeof(key));
+	if(key_length > sizeof(key)) {
+		/* longer keys are hashed first */
+		apr_sha1_init(&context);
+		apr_sha1_update(&context,secret,(unsigned int)key_length);
+		apr_sha1_final(key,&context);
+	}
+	else {
+		memcpy(key,secret,key_length);
+	}
+
+	for(i = 0; i < sizeof(pad); i++) {
+		pad[i] = key[i] ^ 0x36;
+	}
+	apr_sha1_init(&context);
+	apr_sha1_update_binary(&context,pad,sizeof(pad));
+	apr_sha1_update_binary(&context,(const unsigned char*)data,(unsigned int)length);
+	apr_sha1_final(digest,&context);
+
+	for(i = 0; i < sizeof(pad); i++) {
+		pad[i] = key[i] ^ 0x5c;
+	}
+	apr_sha1_init(&context);
+	apr_sha1_update_binary(&context,pad,sizeof(pad));
+	apr_sha1_update_binary(&context,digest,sizeof(digest));
+	apr_sha1_final(digest,&context);
+
+	for(i = 0; i < sizeof(digest); i++) {
+		hex[2 * i] = digits[digest[i] >> 4];
+		hex[2 * i + 1] = digits[digest[i] & 0x0f];
+	}
+	hex[2 * APR_SHA1_DIGESTSIZE] = '\0';
+}
+
+/** Check the HMAC of a gossip datagram, which is its last line, and cut it off */
+static apt_bool_t mrcp_cluster_gossip_verify(mrcp_server_cluster_t *cluster, char *text, apr_size_t size)
+{
+	char hex[2 * APR_SHA1_DIGESTSIZE + 1];
+	apr_size_t header_length = sizeof(MRCP_CLUSTER_AUTH_HEADER) - 1;
+	apr_size_t offset;
+	unsigned char diff = 0;
+	apr_size_t i;
+
+	if(!cluster->settings.secret) {
+		return TRUE;
+	}
+	/* "auth: <hex>" terminated by CRLF, preceded by the lines it is computed over */
+	if(size < header_length + sizeof(hex) + 1) {
+		return FALSE;
+	}
+	offset = size - (header_length + sizeof(hex) + 1);
+	if(offset < 2 || memcmp(text + offset - 2,"\r\n",2) != 0 ||
+		memcmp(text + offset,MRCP_CLUSTER_AUTH_HEADER,header_length) != 0 ||
+		memcmp(text + size - 2,"\r\n",2) != 0) {
+		return FALSE;
+	}
+	mrcp_cluster_hmac_compute(cluster->settings.secret,text,offset,hex);
+	/* compared in constant time, so that the expected value is not learned by timing */
+	for(i = 0; i < sizeof(hex) - 1; i++) {
+		diff |= (unsigned char)(hex[i] ^ text[offset + header_length + i]);
+	}
+	if(diff) {
+		return FALSE;
+	}
+	text[offset] = '\0';
+	return TRUE;
+}
+
+/** Take in a gossip datagram */
+static void mrcp_cluster_gossip_process(mrcp_server_cluster_t *cluster, const char *from, char *text, apr_time_t now, apr_pool_t *pool)
+{
+	mrcp_cluster_peer_t *peer;
+	mrcp_cluster_load_t load;
+	const char *node_id = NULL;
+	const char *sip_uri = NULL;
+	const char *peers = NULL;
+	char *line;
+	char *value;
+	char *last;
+
+	line = apr_strtok(text,"\r\n",&last);
+	if(!line || strcmp(line,MRCP_CLUSTER_SIGNATURE) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Ignore Non-Cluster Datagram from [%s]",from);
+		return;
+	}
+	load.channels = 0;
+	load.capacity = 0;
+	load.usage = 0;
+	load.backlog = 0;
+	load.rtf = 0;
+	load.admitting = FALSE;
+	while((line = apr_strtok(NULL,"\r\n",&last)) != NULL) {
+		value = strchr(line,':');
+		if(!value) {
+			continue;
+		}
+		*value++ = '\0';
+		while(*value == ' ') {
+			value++;
+		}
+
+		if(strcmp(line,"node") == 0) {
+			node_id = value;
+		}
+		else if(strcmp(line,"sip") == 0) {
+			sip_uri = value;
+		}
+		else if(strcmp(line,"channels") == 0) {
+			load.channels = atol(value);
+		}
+		else if(strcmp(line,"capacity") == 0) {
+			load.capacity = atol(value);
+		}
+		else if(strcmp(line,"usage") == 0) {
+			load.usage = atol(value);
+		}
+		else if(strcmp(line,"backlog") == 0) {
+			load.backlog = atol(value);
+		}
+		else if(strcmp(line,"rtf") == 0) {
+			load.rtf = atol(value);
+		}
+		else if(strcmp(line,"admit") == 0) {
+			load.admitting = atol(value) ? TRUE : FALSE;
+		}
+		else if(strcmp(line,"peers") == 0) {
+			peers = value;
+		}
+	}
+	if(!node_id) {
+		return;
+	}
+
+	apr_thread_mutex_lock(cluster->guard);
+	peer = mrcp_cluster_peer_find(cluster,from);
+	if(!peer && cluster->settings.secret) {
+		/* the gossip is authenticated, a node with the secret is a member wherever it gossips from */
+		char *host = NULL;
+		char *scope_id = NULL;
+		apr_port_t port = 0;
+		if(apr_parse_addr_port(&host,&scope_id,&port,from,pool) == APR_SUCCESS && host && port) {
+			peer = mrcp_cluster_peer_add(cluster,host,port,from,FALSE,now);
+		}
+	}
+	else if(!peer) {
+		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Ignore Gossip of Unknown Cluster Peer [%s]",from);
+		apr_thread_mutex_unlock(cluster->guard);
+		return;
+	}
+	if(peer) {
+		if(strcmp(node_id,cluster->settings.node_id) == 0) {
+			/* a seed listed along with the rest of the cluster may be the node itself */
+			peer->self = TRUE;
+		}
+		else {
+			apr_cpystrn(peer->node_id,node_id,sizeof(peer->node_id));
+			apr_cpystrn(peer->sip_uri,sip_uri ? sip_uri : "",sizeof(peer->sip_uri));
+			peer->load = load;
+			peer->last_heard = now;
+		}
+	}
+	if(peers && peer && !peer->self) {
+		char *members = apr_pstrdup(pool,peers);
+		char *address;
+		char *member_last;
+		for(address = apr_strtok(members," ,",&member_last); address; address = apr_strtok(NULL," ,",&member_last)) {
+			mrcp_cluster_peer_learn(cluster,address,now,pool);
+		}
+	}
+	apr_thread_mutex_unlock(cluster->guard);
+}
+
+/** Take in the gossip received since the last interval */
+static void mrcp_cluster_gossip_receive(mrcp_server_cluster_t *cluster, apr_time_t now, apr_pool_t *pool)
+{
+	char buffer[MRCP_CLUSTER_MAX_MESSAGE];
+	apr_sockaddr_t *from = NULL;
+	apr_size_t size;
+	char *ip;
+
+	if(apr_sockaddr_info_get(&from,NULL,APR_INET,0,0,pool) != APR_SUCCESS) {
+		return;
+	}
+	for(;;) {
+		size = sizeof(buffer) - 1;
+		if(apr_socket_recvfrom(from,cluster->sock,0,buffer,&size) != APR_SUCCESS || !size) {
+			break;
+		}
+		buffer[size] = '\0';
+		ip = NULL;
+		apr_sockaddr_ip_get(&ip,from);
+		if(ip && mrcp_cluster_gossip_verify(cluster,buffer,size) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Ignore Unauthenticated Gossip from [%s:%hu]",ip,from->port);
+			continue;
+		}
+		if(ip) {
+			mrcp_cluster_gossip_process(cluster,apr_psprintf(pool,"%s:%hu",ip,from->port),buffer,now,pool);
+		}
+	}
+}
+
+/** Compose the gossip of the local load */
+static apr_size_t mrcp_cluster_gossip_compose(mrcp_server_cluster_t *cluster, char *buffer, apr_size_t max_size, apr_time_t now)
+{
+	const mrcp_cluster_load_t *load = &cluster->local;
+	mrcp_cluster_peer_t *peer;
+	apr_size_t size;
+	apr_size_t i;
+
+	size = apr_snprintf(buffer,max_size,
+		MRCP_CLUSTER_SIGNATURE"\r\n"
+		"node: %s\r\n"
+		"sip: %s\r\n"
+		"seq: %"APR_SIZE_T_FMT"\r\n"
+		"channels: %"APR_SIZE_T_FMT"\r\n"
+		"capacity: %"APR_SIZE_T_FMT"\r\n"
+		"usage: %"APR_SIZE_T_FMT"\r\n"
+		"backlog: %"APR_SIZE_T_FMT"\r\n"
+		"rtf: %"APR_SIZE_T_FMT"\r\n"
+		"admit: %d\r\n"
+		"peers:",
+		cluster->settings.node_id,
+		cluster->settings.sip_uri,
+		++cluster->seq,
+		load->channels,
+		load->capacity,
+		load->usage,
+		load->backlog,
+		load->rtf,
+		load->admitting == TRUE ? 1 : 0);
+	/* members alive are passed on, so that every node learns of the whole cluster */
+	for(i = 0; i < cluster->peer_count && size < max_size; i++) {
+		peer = cluster->peers[i];
+		if(peer && mrcp_cluster_peer_is_alive(cluster,peer,now) == TRUE) {
+			size += apr_snprintf(buffer + size,max_size - size," %s",peer->address);
+		}
+	}
+	if(size < max_size) {
+		size += apr_snprintf(buffer + size,max_size - size,"\r\n");
+	}
+	if(cluster->settings.secret && size + sizeof(MRCP_CLUSTER_AUTH_HEADER) + 2 * APR_SHA1_DIGESTSIZE + 2 < max_size) {
+		char hex[2 * APR_SHA1_DIGESTSIZE + 1];
+		mrcp_cluster_hmac_compute(cluster->settings.secret,buffer,size,hex);
+		size += apr_snprintf(buffer + size,max_size - size,MRCP_CLUSTER_AUTH_HEADER"%s\r\n",hex);
+	}
+	return size;
+}
+
+/** Measure the local load, take in the gossip received and gossip the load to the peers */
+MRCP_DECLARE(void) mrcp_server_cluster_exchange(mrcp_server_cluster_t *cluster)
+{
+	char buffer[MRCP_CLUSTER_MAX_MESSAGE];
+	mrcp_cluster_load_t load;
+	mrcp_cluster_peer_t *peer;
+	apr_time_t now = apr_time_now();
+	apr_time_t forget_time = apr_time_from_msec(MRCP_CLUSTER_FORGET_INTERVALS * cluster->settings.interval);
+	apr_pool_t *pool;
+	apr_size_t size;
+	apr_size_t length;
+	apr_size_t i;
+
+	if(apr_pool_create(&pool,cluster->pool) != APR_SUCCESS) {
+		return;
+	}
+
+	mrcp_cluster_local_measure(cluster,&load);
+	apr_thread_mutex_lock(cluster->guard);
+	if(cluster->local.admitting != load.admitting) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Cluster Node [%s] %s Offers [usage: %"APR_SIZE_T_FMT"%%] [rtf: %"APR_SIZE_T_FMT"%%]",
+			cluster->settings.node_id,
+			load.admitting == TRUE ? "Admits" : "No Longer Admits",
+			load.usage,
+			load.rtf);
+	}
+	cluster->local = load;
+	apr_thread_mutex_unlock(cluster->guard);
+
+	mrcp_cluster_gossip_receive(cluster,now,pool);
+
+	apr_thread_mutex_lock(cluster->guard);
+	size = mrcp_cluster_gossip_compose(cluster,buffer,sizeof(buffer),now);
+	for(i = 0; i < cluster->peer_count; i++) {
+		peer = cluster->peers[i];
+		if(!peer || peer->self) {
+			continue;
+		}
+		/* a learned peer never heard of is forgotten in as long since it was added */
+		if(peer->seed == FALSE && now - (peer->last_heard ? peer->last_heard : peer->added) > forget_time) {
+			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Forget Cluster Peer [%s] [%s]",peer->node_id,peer->address);
+			cluster->peers[i] = NULL;
+			continue;
+		}
+		length = size;
+		if(apr_socket_sendto(cluster->sock,peer->sockaddr,0,buffer,&length) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Failed to Gossip to Cluster Peer [%s]",peer->address);
+		}
+	}
+	apr_thread_mutex_unlock(cluster->guard);
+
+	apr_pool_destroy(pool);
+}
+
+/** Decide on a new offer */
+MRCP_DECLARE(mrcp_cluster_offer_e) mrcp_server_cluster_offer_check(mrcp_server_cluster_t *cluster, char *redirect_uri, apr_size_t size)
+{
+	mrcp_cluster_offer_e offer;
+	mrcp_cluster_peer_t *peer;
+	mrcp_cluster_peer_t *target = NULL;
+	apr_time_t now = apr_time_now();
+	apr_size_t i;
+
+	apr_thread_mutex_lock(cluster->guard);
+	if(cluster->local.admitting == TRUE && cluster->local.usage < cluster->settings.redirect_usage) {
+		apr_thread_mutex_unlock(cluster->guard);
+		return MRCP_CLUSTER_OFFER_ACCEPT;
+	}
+
+	for(i = 0; i < cluster->peer_count; i++) {
+		peer = cluster->peers[i];
+		if(!peer || !*peer->sip_uri || peer->load.admitting == FALSE ||
+			mrcp_cluster_peer_is_alive(cluster,peer,now) == FALSE) {
+			continue;
+		}
+		/* while the node still admits offers, only a peer less loaded by the margin is worth a redirect */
+		if(cluster->local.admitting == TRUE && peer->load.usage + cluster->settings.margin > cluster->local.usage) {
+			continue;
+		}
+		if(!target || peer->load.usage < target->load.usage ||
+			(peer->load.usage == target->load.usage && peer->load.rtf < target->load.rtf)) {
+			target = peer;
+		}
+	}
+
+	if(target) {
+		apr_cpystrn(redirect_uri,target->sip_uri,size);
+		/* the offers redirected count against the peer till it gossips next */
+		target->load.channels++;
+		if(target->load.capacity) {
+			apr_size_t usage = target->load.channels * 100 / target->load.capacity;
+			if(usage > target->load.usage) {
+				target->load.usage = usage;
+			}
+		}
+		offer = MRCP_CLUSTER_OFFER_REDIRECT;
+	}
+	else {
+		offer = cluster->local.admitting == TRUE ? MRCP_CLUSTER_OFFER_ACCEPT : MRCP_CLUSTER_OFFER_REJECT;
+	}
+	apr_thread_mutex_unlock(cluster->guard);
+	return offer;
+}
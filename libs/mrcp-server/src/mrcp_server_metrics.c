@@ -0,0 +1,417 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include <apr_strings.h>
+#include "mrcp_server_metrics.h"
+#include "mrcp_server.h"
+#include "mrcp_engine_types.h"
+#include "mpf_engine.h"
+#include "apt_task.h"
+#include "apt_histogram.h"
+#include "apt_log.h"
+
+#define METRICS_PREFIX "unimrcp_"
+
+/** Quantiles of the summaries */
+static const double metrics_quantiles[] = {0.5, 0.9, 0.99};
+
+/** Escape label value (backslash, double quote and line feed) */
+static const char* metrics_label_escape(const char *value, apr_pool_t *pool)
+{
+	const char *src;
+	char *escaped;
+	char *dest;
+	if(!value) {
+		return "";
+	}
+	if(!strpbrk(value,"\\\"\n")) {
+		return value;
+	}
+	escaped = dest = apr_palloc(pool,strlen(value) * 2 + 1);
+	for(src = value; *src; src++) {
+		if(*src == '\n') {
+			*dest++ = '\\';
+			*dest++ = 'n';
+			continue;
+		}
+		if(*src == '\\' || *src == '"') {
+			*dest++ = '\\';
+		}
+		*dest++ = *src;
+	}
+	*dest = '\0';
+	return escaped;
+}
+
+/** Write HELP and TYPE lines of a metric */
+static void metrics_header_write(apr_file_t *file, const char *name, const char *type, const char *help)
+{
+	apr_file_printf(file,"# HELP "METRICS_PREFIX"%s %s\n# TYPE "METRICS_PREFIX"%s %s\n",name,help,name,type);
+}
+
+/** Write sample of a metric with a single label */
+static void metrics_sample_write(apr_file_t *file, const char *name, const char *label, const char *value, apr_uint64_t sample)
+{
+	apr_file_printf(file,METRICS_PREFIX"%s{%s=\"%s\"} %"APR_UINT64_T_FMT"\n",name,label,value,sample);
+}
+
+/** Write histogram as a summary with a single label, scaling the recorded values */
+static void metrics_summary_write(apr_file_t *file, const char *name, const char *label, const char *value, const apt_histogram_t *histogram, double scale)
+{
+	apr_size_t i;
+	apr_size_t count = apt_histogram_count_get(histogram);
+	for(i=0; i<sizeof(metrics_quantiles)/sizeof(metrics_quantiles[0]); i++) {
+		double sample = apt_histogram_percentile_get(histogram,metrics_quantiles[i] * 100) * scale;
+		apr_file_printf(file,METRICS_PREFIX"%s{%s=\"%s\",quantile=\"%g\"} %g\n",
+			name,label,value,metrics_quantiles[i],sample);
+	}
+	apr_file_printf(file,METRICS_PREFIX"%s_sum{%s=\"%s\"} %g\n",name,label,value,apt_histogram_mean_get(histogram) * count * scale);
+	apr_file_printf(file,METRICS_PREFIX"%s_count{%s=\"%s\"} %"APR_SIZE_T_FMT"\n",name,label,value,count);
+}
+
+/** Write metrics of MRCP engines */
+static void metrics_engines_write(const mrcp_server_t *server, apr_file_t *file, apr_pool_t *pool)
+{
+	apr_hash_index_t *it;
+	void *val;
+	const mrcp_engine_t *engine;
+	const char *id;
+
+	metrics_header_write(file,"engine_ready","gauge","Whether engine is open and takes channels");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		id = metrics_label_escape(engine->id,pool);
+		metrics_sample_write(file,"engine_ready","engine",id,engine->is_open == TRUE ? 1 : 0);
+	}
+
+	metrics_header_write(file,"engine_channels","gauge","Number of channels in use per engine");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		id = metrics_label_escape(engine->id,pool);
+		metrics_sample_write(file,"engine_channels","engine",id,
+			apr_atomic_read32((volatile apr_uint32_t*)&engine->cur_channel_count));
+	}
+
+	metrics_header_write(file,"engine_max_channels","gauge","Max number of channels per engine (0 - unlimited)");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		id = metrics_label_escape(engine->id,pool);
+		metrics_sample_write(file,"engine_max_channels","engine",id,
+			engine->config ? engine->config->max_channel_count : 0);
+	}
+
+	metrics_header_write(file,"engine_backlog","gauge","Number of jobs queued to the threads of engine");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		id = metrics_label_escape(engine->id,pool);
+		metrics_sample_write(file,"engine_backlog","engine",id,
+			apr_atomic_read32((volatile apr_uint32_t*)&engine->backlog));
+	}
+
+	metrics_header_write(file,"engine_degraded_channels","gauge","Number of channels processed by cheaper settings per engine");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		id = metrics_label_escape(engine->id,pool);
+		metrics_sample_write(file,"engine_degraded_channels","engine",id,
+			apr_atomic_read32((volatile apr_uint32_t*)&engine->degraded_channel_count));
+	}
+
+	metrics_header_write(file,"engine_degradations_total","counter","Number of times channels are switched to cheaper settings");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		id = metrics_label_escape(engine->id,pool);
+		metrics_sample_write(file,"engine_degradations_total","engine",id,
+			apr_atomic_read32((volatile apr_uint32_t*)&engine->degradation_count));
+	}
+
+	metrics_header_write(file,"engine_memory_bytes","gauge","Size of memory held on behalf of the channels of engine");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(engine->mem_account) {
+			id = metrics_label_escape(engine->id,pool);
+			metrics_sample_write(file,"engine_memory_bytes","engine",id,apt_mem_account_used_get(engine->mem_account));
+		}
+	}
+
+	metrics_header_write(file,"engine_memory_peak_bytes","gauge","Max size of memory held on behalf of the channels of engine at once");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apt_mem_account_stats_t stats;
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(engine->mem_account) {
+			id = metrics_label_escape(engine->id,pool);
+			apt_mem_account_stats_get(engine->mem_account,&stats);
+			metrics_sample_write(file,"engine_memory_peak_bytes","engine",id,stats.peak);
+		}
+	}
+
+	metrics_header_write(file,"engine_memory_max_bytes","gauge","Max size of memory held on behalf of the channels of engine (0 - unlimited)");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(engine->mem_account) {
+			id = metrics_label_escape(engine->id,pool);
+			metrics_sample_write(file,"engine_memory_max_bytes","engine",id,
+				engine->config ? engine->config->max_memory_size : 0);
+		}
+	}
+
+	metrics_header_write(file,"engine_memory_denied_total","counter","Number of allocations denied by the memory cap of engine");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apt_mem_account_stats_t stats;
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(engine->mem_account) {
+			id = metrics_label_escape(engine->id,pool);
+			apt_mem_account_stats_get(engine->mem_account,&stats);
+			metrics_sample_write(file,"engine_memory_denied_total","engine",id,stats.denied);
+		}
+	}
+
+	metrics_header_write(file,"engine_real_time_factor","summary","Real-time factor of the media processed by engine");
+	for(it = mrcp_server_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		engine = val;
+		if(engine->rtf_histogram) {
+			id = metrics_label_escape(engine->id,pool);
+			metrics_summary_write(file,"engine_real_time_factor","engine",id,engine->rtf_histogram,0.001);
+		}
+	}
+}
+
+/** Write metrics of media engines */
+static void metrics_media_engines_write(const mrcp_server_t *server, apr_file_t *file, apr_pool_t *pool)
+{
+	/* counters totaled over the closed RTP receivers of the engine */
+	static const struct {
+		const char *name;
+		const char *help;
+		apr_size_t  offset;
+	} rtp_counters[] = {
+		{"rtp_streams_total",          "Number of RTP receivers closed",           APR_OFFSETOF(mpf_engine_rtp_stat_t,streams)},
+		{"rtp_received_packets_total", "Number of valid RTP packets received",     APR_OFFSETOF(mpf_engine_rtp_stat_t,received_packets)},
+		{"rtp_invalid_packets_total",  "Number of invalid RTP packets received",   APR_OFFSETOF(mpf_engine_rtp_stat_t,invalid_packets)},
+		{"rtp_ignored_packets_total",  "Number of RTP packets ignored",            APR_OFFSETOF(mpf_engine_rtp_stat_t,ignored_packets)},
+		{"rtp_lost_packets_total",     "Number of RTP packets lost in network",    APR_OFFSETOF(mpf_engine_rtp_stat_t,lost_packets)},
+		{"rtp_restarts_total",         "Number of RTP receiver restarts",          APR_OFFSETOF(mpf_engine_rtp_stat_t,restarts)},
+		{"jb_discarded_packets_total", "Number of packets discarded in jitter buffer", APR_OFFSETOF(mpf_engine_rtp_stat_t,discarded_packets)},
+		{"jb_concealed_frames_total",  "Number of frames concealed in jitter buffer",  APR_OFFSETOF(mpf_engine_rtp_stat_t,concealed_frames)},
+		{"jb_underruns_total",         "Number of times jitter buffer ran dry",        APR_OFFSETOF(mpf_engine_rtp_stat_t,underruns)},
+		{"rtp_max_jitter",             "Max interarrival jitter of an RTP receiver (timestamp units)", APR_OFFSETOF(mpf_engine_rtp_stat_t,max_jitter)}
+	};
+	apr_hash_index_t *it;
+	void *val;
+	const mpf_engine_t *media_engine;
+	mpf_scheduler_stat_t stat;
+	mpf_engine_rtp_stat_t rtp_stat;
+	apr_size_t i;
+
+	metrics_header_write(file,"media_ticks_total","counter","Number of ticks elapsed per media engine");
+	for(it = mrcp_server_media_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		media_engine = val;
+		mpf_engine_scheduler_stat_get(media_engine,&stat);
+		metrics_sample_write(file,"media_ticks_total","media_engine",
+			metrics_label_escape(mpf_engine_id_get(media_engine),pool),stat.tick_count);
+	}
+
+	metrics_header_write(file,"media_late_ticks_total","counter","Number of ticks started 1 ms or more past their deadline");
+	for(it = mrcp_server_media_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		media_engine = val;
+		mpf_engine_scheduler_stat_get(media_engine,&stat);
+		metrics_sample_write(file,"media_late_ticks_total","media_engine",
+			metrics_label_escape(mpf_engine_id_get(media_engine),pool),stat.late_count);
+	}
+
+	metrics_header_write(file,"media_resyncs_total","counter","Number of times the scheduler fell behind and resynchronized");
+	for(it = mrcp_server_media_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		media_engine = val;
+		mpf_engine_scheduler_stat_get(media_engine,&stat);
+		metrics_sample_write(file,"media_resyncs_total","media_engine",
+			metrics_label_escape(mpf_engine_id_get(media_engine),pool),stat.resync_count);
+	}
+
+	metrics_header_write(file,"media_tick_lateness_seconds_total","counter","Sum of lateness of all the ticks");
+	for(it = mrcp_server_media_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		media_engine = val;
+		mpf_engine_scheduler_stat_get(media_engine,&stat);
+		apr_file_printf(file,METRICS_PREFIX"media_tick_lateness_seconds_total{media_engine=\"%s\"} %g\n",
+			metrics_label_escape(mpf_engine_id_get(media_engine),pool),stat.total_lateness / 1000000.0);
+	}
+
+	metrics_header_write(file,"media_tick_lateness_max_seconds","gauge","Max lateness of a tick");
+	for(it = mrcp_server_media_engine_first(server); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		media_engine = val;
+		mpf_engine_scheduler_stat_get(media_engine,&stat);
+		apr_file_printf(file,METRICS_PREFIX"media_tick_lateness_max_seconds{media_engine=\"%s\"} %g\n",
+			metrics_label_escape(mpf_engine_id_get(media_engine),pool),stat.max_lateness / 1000000.0);
+	}
+
+	for(i=0; i<sizeof(rtp_counters)/sizeof(rtp_counters[0]); i++) {
+		apt_bool_t gauge = (rtp_counters[i].offset == APR_OFFSETOF(mpf_engine_rtp_stat_t,max_jitter));
+		metrics_header_write(file,rtp_counters[i].name,gauge ? "gauge" : "counter",rtp_counters[i].help);
+		for(it = mrcp_server_media_engine_first(server); it; it = apr_hash_next(it)) {
+			apr_hash_this(it,NULL,NULL,&val);
+			media_engine = val;
+			mpf_engine_rtp_stat_get(media_engine,&rtp_stat);
+			metrics_sample_write(file,rtp_counters[i].name,"media_engine",
+				metrics_label_escape(mpf_engine_id_get(media_engine),pool),
+				*(apr_uint32_t*)((char*)&rtp_stat + rtp_counters[i].offset));
+		}
+	}
+}
+
+/** Write queue metrics of the task and its children */
+static void metrics_task_write(const apt_task_t *task, apt_task_histogram_e type, apr_file_t *file, apr_pool_t *pool)
+{
+	const apt_task_t *child_task;
+	const apt_histogram_t *histogram = apt_task_histogram_get(task,type);
+	if(histogram) {
+		const char *name = metrics_label_escape(apt_task_name_get(task),pool);
+		switch(type) {
+			case TASK_HISTOGRAM_QUEUE_DEPTH:
+				metrics_sample_write(file,"task_queue_depth","task",name,apt_task_pending_get(task));
+				break;
+			case TASK_HISTOGRAM_DWELL_TIME:
+				metrics_summary_write(file,"task_dwell_seconds","task",name,histogram,0.000001);
+				break;
+			case TASK_HISTOGRAM_PROCESS_TIME:
+				metrics_summary_write(file,"task_process_seconds","task",name,histogram,0.000001);
+				break;
+			default:
+				break;
+		}
+	}
+
+	for(child_task = apt_task_child_first(task); child_task; child_task = apt_task_child_next(task,child_task)) {
+		metrics_task_write(child_task,type,file,pool);
+	}
+}
+
+/** Write metrics of session pools */
+static void metrics_session_pools_write(const mrcp_server_t *server, apr_file_t *file)
+{
+	apt_pool_cache_stats_t stats;
+	const apt_histogram_t *v1 = mrcp_server_session_pool_size_histogram_get(server,MRCP_VERSION_1);
+	const apt_histogram_t *v2 = mrcp_server_session_pool_size_histogram_get(server,MRCP_VERSION_2);
+
+	if(mrcp_server_session_pool_stats_get(server,&stats) == TRUE) {
+		metrics_header_write(file,"session_pools_total","counter","Number of session pools by operation on the cache");
+		metrics_sample_write(file,"session_pools_total","op","acquired",stats.acquired);
+		metrics_sample_write(file,"session_pools_total","op","reused",stats.reused);
+		metrics_sample_write(file,"session_pools_total","op","released",stats.released);
+		metrics_sample_write(file,"session_pools_total","op","discarded",stats.discarded);
+		metrics_header_write(file,"session_pools_cached","gauge","Number of idle session pools in the cache");
+		apr_file_printf(file,METRICS_PREFIX"session_pools_cached %"APR_SIZE_T_FMT"\n",stats.cached);
+	}
+
+	if((v1 && apt_histogram_count_get(v1)) || (v2 && apt_histogram_count_get(v2))) {
+		metrics_header_write(file,"session_pool_bytes","summary","Size of the pool of session at removal");
+		if(v1 && apt_histogram_count_get(v1)) {
+			metrics_summary_write(file,"session_pool_bytes","version","MRCPv1",v1,1);
+		}
+		if(v2 && apt_histogram_count_get(v2)) {
+			metrics_summary_write(file,"session_pool_bytes","version","MRCPv2",v2,1);
+		}
+	}
+}
+
+/** Write metrics of memory held by sessions */
+static void metrics_session_memory_write(const mrcp_server_t *server, apr_file_t *file)
+{
+	apt_mem_account_stats_t stats;
+	const apt_histogram_t *peaks;
+	if(mrcp_server_mem_stats_get(server,&stats) == FALSE) {
+		return;
+	}
+
+	metrics_header_write(file,"session_memory_bytes","gauge","Size of memory held by all the sessions");
+	apr_file_printf(file,METRICS_PREFIX"session_memory_bytes %"APR_SIZE_T_FMT"\n",stats.used);
+	metrics_header_write(file,"session_memory_peak_bytes","gauge","Max size of memory held by all the sessions at once");
+	apr_file_printf(file,METRICS_PREFIX"session_memory_peak_bytes %"APR_SIZE_T_FMT"\n",stats.peak);
+	metrics_header_write(file,"session_memory_max_bytes","gauge","Max size of memory held by all the sessions (0 - unlimited)");
+	apr_file_printf(file,METRICS_PREFIX"session_memory_max_bytes %"APR_SIZE_T_FMT"\n",stats.cap);
+	metrics_header_write(file,"session_memory_denied_total","counter","Number of allocations denied by the memory cap of the server");
+	apr_file_printf(file,METRICS_PREFIX"session_memory_denied_total %"APR_SIZE_T_FMT"\n",stats.denied);
+
+	peaks = mrcp_server_session_mem_peak_histogram_get(server);
+	if(peaks && apt_histogram_count_get(peaks)) {
+		metrics_header_write(file,"session_memory_peak_per_session_bytes","summary","Max size of memory held by session at once, at removal");
+		metrics_summary_write(file,"session_memory_peak_per_session_bytes","account","session",peaks,1);
+	}
+}
+
+/** Write metrics of the server */
+MRCP_DECLARE(apt_bool_t) mrcp_server_metrics_write(const mrcp_server_t *server, apr_file_t *file, apr_pool_t *pool)
+{
+	const apt_task_t *task;
+	if(!server || !file) {
+		return FALSE;
+	}
+
+	metrics_header_write(file,"sessions","gauge","Number of sessions in progress");
+	apr_file_printf(file,METRICS_PREFIX"sessions %"APR_SIZE_T_FMT"\n",mrcp_server_session_count_get(server));
+
+	metrics_session_pools_write(server,file);
+	metrics_session_memory_write(server,file);
+	metrics_engines_write(server,file,pool);
+	metrics_media_engines_write(server,file,pool);
+
+	task = mrcp_server_task_get(server);
+	if(task) {
+		metrics_header_write(file,"task_queue_depth","gauge","Number of messages pending in the queue of task");
+		metrics_task_write(task,TASK_HISTOGRAM_QUEUE_DEPTH,file,pool);
+		metrics_header_write(file,"task_dwell_seconds","summary","Time from signaling a message to task till its processing starts");
+		metrics_task_write(task,TASK_HISTOGRAM_DWELL_TIME,file,pool);
+		metrics_header_write(file,"task_process_seconds","summary","Time spent by task processing a message");
+		metrics_task_write(task,TASK_HISTOGRAM_PROCESS_TIME,file,pool);
+	}
+	return TRUE;
+}
+
+/** Export metrics of the server to a file */
+MRCP_DECLARE(apt_bool_t) mrcp_server_metrics_export(const mrcp_server_t *server, const char *file_path, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	apt_bool_t status;
+	const char *tmp_path = apr_pstrcat(pool,file_path,".tmp",NULL);
+	if(apr_file_open(&file,tmp_path,APR_WRITE|APR_CREATE|APR_TRUNCATE|APR_BUFFERED|APR_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Metrics File [%s]",tmp_path);
+		return FALSE;
+	}
+	status = mrcp_server_metrics_write(server,file,pool);
+	if(apr_file_close(file) != APR_SUCCESS) {
+		status = FALSE;
+	}
+	if(status == FALSE || apr_file_rename(tmp_path,file_path,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Export Metrics [%s]",file_path);
+		apr_file_remove(tmp_path,pool);
+		return FALSE;
+	}
+	return TRUE;
+}
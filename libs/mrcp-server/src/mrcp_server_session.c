@@ -14,8 +14,10 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mrcp_server.h"
 #include "mrcp_server_session.h"
+#include "mrcp_server_admission.h"
 #include "mrcp_resource.h"
 #include "mrcp_resource_factory.h"
 #include "mrcp_engine_iface.h"
@@ -24,18 +26,24 @@
 #include "mrcp_session_descriptor.h"
 #include "mrcp_control_descriptor.h"
 #include "mrcp_state_machine.h"
+#include "mpf_engine_factory.h"
 #include "mrcp_message.h"
+#include "mrcp_message_trace.h"
+#include "mrcp_generic_header.h"
+#include "mrcp_synth_header.h"
+#include "mrcp_synth_resource.h"
+#include "mrcp_recog_resource.h"
 #include "mpf_termination_factory.h"
+#include "mpf_rtp_termination_factory.h"
 #include "mpf_stream.h"
 #include "apt_consumer_task.h"
 #include "apt_log.h"
+#include "apt_probe.h"
 
 /** Macro to log session name and identifier */
 #define MRCP_SESSION_NAMESID(session) \
 	session->base.name, MRCP_SESSION_SID(&session->base)
 
-#define MRCP_SESSION_ID_HEX_STRING_LENGTH 16
-
 struct mrcp_channel_t {
 	/** Memory pool */
 	apr_pool_t             *pool;
@@ -75,6 +83,29 @@ struct mrcp_termination_slot_t {
 	apt_bool_t          waiting;
 };
 
+/**
+ * Barge-in link of a session.
+ * The audio stream of the synthesizer is read through the link, which mutes it
+ * from the tick START-OF-INPUT is sent by the recognizer on, till the SPEAK request
+ * is killed by BARGE-IN-OCCURRED issued by the server on behalf of the client.
+ */
+struct mrcp_barge_in_link_t {
+	/** Table of virtual methods of the stream read through the link (must be the first) */
+	mpf_audio_stream_vtable_t        vtable;
+	/** Table of virtual methods of the stream of the synthesizer */
+	const mpf_audio_stream_vtable_t *stream_vtable;
+	/** Synthesizer channel */
+	mrcp_channel_t                  *channel;
+	/** In-progress SPEAK request (server only) */
+	mrcp_message_t                  *speaker;
+	/** In-progress BARGE-IN-OCCURRED request issued by the server (server only) */
+	mrcp_message_t                  *request;
+	/** Whether the in-progress SPEAK request is to be killed on barge-in */
+	volatile apr_uint32_t            armed;
+	/** Whether the audio is cut */
+	volatile apr_uint32_t            cut;
+};
+
 extern const mrcp_engine_channel_event_vtable_t engine_channel_vtable;
 
 void mrcp_server_session_add(mrcp_server_t *server, mrcp_server_session_t *session);
@@ -99,10 +130,11 @@ static apt_bool_t state_machine_on_deactivate(mrcp_state_machine_t *state_machin
 
 static apt_bool_t mrcp_session_offers_compare(const mrcp_session_descriptor_t *offer1, const mrcp_session_descriptor_t *offer2);
 
-mrcp_server_session_t* mrcp_server_session_create()
+mrcp_server_session_t* mrcp_server_session_create(apt_pool_cache_t *pool_cache)
 {
-	mrcp_server_session_t *session = (mrcp_server_session_t*) mrcp_session_create(sizeof(mrcp_server_session_t)-sizeof(mrcp_session_t));
+	mrcp_server_session_t *session = (mrcp_server_session_t*) mrcp_session_cached_create(pool_cache,sizeof(mrcp_server_session_t)-sizeof(mrcp_session_t));
 	session->context = NULL;
+	session->shard = NULL;
 	session->terminations = apr_array_make(session->base.pool,2,sizeof(mrcp_termination_slot_t));
 	session->channels = apr_array_make(session->base.pool,2,sizeof(mrcp_channel_t*));
 	session->active_request = NULL;
@@ -114,6 +146,8 @@ mrcp_server_session_t* mrcp_server_session_create()
 	session->mpf_task_msg = NULL;
 	session->subrequest_count = 0;
 	session->state = SESSION_STATE_NONE;
+	session->barge_in_link = NULL;
+	session->mem_account = NULL;
 	session->base.name = apr_psprintf(session->base.pool,"0x%pp",session);
 	return session;
 }
@@ -127,6 +161,7 @@ static mrcp_engine_channel_t* mrcp_server_engine_channel_create(mrcp_server_sess
 {
 	mrcp_engine_t *engine = NULL;
 	apr_table_t *attribs = NULL;
+	mrcp_server_admission_t *admission;
 
 	/* get engine settings per profile */
 	mrcp_engine_settings_t *settings = apr_hash_get(
@@ -197,6 +232,18 @@ static mrcp_engine_channel_t* mrcp_server_engine_channel_create(mrcp_server_sess
 		return NULL;
 	}
 
+	/* check if engine can take one more channel */
+	admission = mrcp_server_admission_get(session->server);
+	if(admission && mrcp_server_admission_engine_check(admission,engine) == FALSE) {
+		apt_log(APT_LOG_MARK, APT_PRIO_WARNING, "MRCP Engine [%s] Overloaded for Resource [%s] " APT_NAMESID_FMT,
+			engine->id,
+			resource_name->buf,
+			MRCP_SESSION_NAMESID(session));
+		session->answer->status = MRCP_SESSION_STATUS_OVERLOADED;
+		session->answer->retry_after = mrcp_server_admission_retry_after_get(admission);
+		return NULL;
+	}
+
 	apt_log(APT_LOG_MARK, APT_PRIO_INFO, "Found MRCP Engine [%s] for Resource [%s] " APT_NAMESID_FMT,
 			engine->id,
 			resource_name->buf,
@@ -213,6 +260,73 @@ static mrcp_engine_channel_t* mrcp_server_engine_channel_create(mrcp_server_sess
 	return mrcp_engine_channel_virtual_create(engine,attribs,mrcp_session_version_get(session),session->base.pool);
 }
 
+/** Read frame of the synthesizer through the barge-in link */
+static apt_bool_t mrcp_barge_in_link_frame_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	mrcp_barge_in_link_t *link = (mrcp_barge_in_link_t*)stream->vtable;
+	/* the engine is still read while muted, to be driven by ticks as usual */
+	apt_bool_t status = link->stream_vtable->read_frame(stream,frame);
+	if(apr_atomic_read32(&link->cut)) {
+		frame->type &= ~MEDIA_FRAME_TYPE_AUDIO;
+	}
+	return status;
+}
+
+/** Read frame of the synthesizer by reference through the barge-in link */
+static apt_bool_t mrcp_barge_in_link_frame_ref_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	mrcp_barge_in_link_t *link = (mrcp_barge_in_link_t*)stream->vtable;
+	apt_bool_t status = link->stream_vtable->read_frame_ref(stream,frame);
+	if(apr_atomic_read32(&link->cut)) {
+		frame->type &= ~MEDIA_FRAME_TYPE_AUDIO;
+	}
+	return status;
+}
+
+/** Check whether barge-in link is enabled for the session, the session attribute overrides the profile */
+static apt_bool_t mrcp_server_barge_in_link_enabled(mrcp_server_session_t *session, mrcp_session_attribs_t *session_attribs)
+{
+	apt_bool_t enabled = session->profile->barge_in_link;
+	if(session_attribs && session_attribs->generic_attribs) {
+		const char *value = apr_table_get(session_attribs->generic_attribs,"barge-in-link");
+		if(value) {
+			apt_str_t str;
+			apt_string_set(&str,value);
+			apt_boolean_value_parse(&str,&enabled);
+		}
+	}
+	return enabled;
+}
+
+/** Create barge-in link, the audio stream of the synthesizer channel is read through from now on */
+static mrcp_barge_in_link_t* mrcp_server_barge_in_link_create(mrcp_channel_t *channel)
+{
+	mrcp_barge_in_link_t *link;
+	mpf_audio_stream_t *audio_stream = NULL;
+	if(channel->engine_channel->termination) {
+		audio_stream = mpf_termination_audio_stream_get(channel->engine_channel->termination);
+	}
+	if(!audio_stream || !audio_stream->vtable->read_frame) {
+		return NULL;
+	}
+
+	link = apr_palloc(channel->pool,sizeof(mrcp_barge_in_link_t));
+	link->vtable = *audio_stream->vtable;
+	link->vtable.read_frame = mrcp_barge_in_link_frame_read;
+	if(link->vtable.read_frame_ref) {
+		link->vtable.read_frame_ref = mrcp_barge_in_link_frame_ref_read;
+	}
+	link->stream_vtable = audio_stream->vtable;
+	link->channel = channel;
+	link->speaker = NULL;
+	link->request = NULL;
+	apr_atomic_set32(&link->armed,0);
+	apr_atomic_set32(&link->cut,0);
+	/* the termination is not added to the context yet */
+	audio_stream->vtable = &link->vtable;
+	return link;
+}
+
 static mrcp_channel_t* mrcp_server_channel_create(mrcp_server_session_t *session, const apt_str_t *resource_name, apr_size_t id, apr_array_header_t *cmid_arr, mrcp_session_attribs_t *session_attribs)
 {
 	mrcp_channel_t *channel;
@@ -245,15 +359,31 @@ static mrcp_channel_t* mrcp_server_channel_create(mrcp_server_session_t *session
 			engine_channel = mrcp_server_engine_channel_create(session,channel,resource_name,session_attribs);
 			if(engine_channel) {
 				engine_channel->id = session->base.id;
+				/* the engine may place the processing of the channel on the CPU or node its media is processed on */
+				engine_channel->numa_node = mpf_engine_context_numa_node_get(session->base.media_engine,session->context);
+				engine_channel->cpu = mpf_engine_context_cpu_get(session->base.media_engine,session->context);
+				engine_channel->log_priority = session->base.log_priority;
+				engine_channel->mem_account = session->mem_account;
 				engine_channel->event_obj = channel;
 				engine_channel->event_vtable = &engine_channel_vtable;
 				channel->engine_channel = engine_channel;
+				if(resource->id == MRCP_SYNTHESIZER_RESOURCE && !session->barge_in_link &&
+					mrcp_server_barge_in_link_enabled(session,session_attribs) == TRUE) {
+					session->barge_in_link = mrcp_server_barge_in_link_create(channel);
+					if(session->barge_in_link) {
+						apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Enable Barge-in Link " APT_NAMESIDRES_FMT,
+							MRCP_SESSION_NAMESID(session),
+							resource_name->buf);
+					}
+				}
 			}
 			else {
 				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Engine Channel " APT_NAMESID_FMT" [%s]",
 					MRCP_SESSION_NAMESID(session),
 					resource_name->buf);
-				session->answer->status = MRCP_SESSION_STATUS_UNACCEPTABLE_RESOURCE;
+				if(session->answer->status == MRCP_SESSION_STATUS_OK) {
+					session->answer->status = MRCP_SESSION_STATUS_UNACCEPTABLE_RESOURCE;
+				}
 			}
 		}
 		else {
@@ -319,9 +449,16 @@ mrcp_session_t* mrcp_server_channel_session_get(mrcp_channel_t *channel)
 	return channel->session;
 }
 
+/** Enter the log scope of the session, the entries are logged at its priority till the next session is entered */
+static APR_INLINE void mrcp_server_session_log_scope_enter(mrcp_session_t *session)
+{
+	apt_log_scope_set(session->log_priority);
+}
+
 apt_bool_t mrcp_server_signaling_message_process(mrcp_signaling_message_t *signaling_message)
 {
 	mrcp_server_session_t *session = signaling_message->session;
+	mrcp_server_session_log_scope_enter(&session->base);
 	if(session->active_request) {
 		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Push Request to Queue " APT_NAMESID_FMT, 
 			MRCP_SESSION_NAMESID(session));
@@ -337,6 +474,7 @@ apt_bool_t mrcp_server_signaling_message_process(mrcp_signaling_message_t *signa
 apt_bool_t mrcp_server_on_channel_modify(mrcp_channel_t *channel, mrcp_control_descriptor_t *answer, apt_bool_t status)
 {
 	mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
+	mrcp_server_session_log_scope_enter(channel->session);
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Control Channel Modified " APT_NAMESIDRES_FMT,
 			MRCP_SESSION_NAMESID(session),
 			channel->resource->name.buf);
@@ -356,6 +494,7 @@ apt_bool_t mrcp_server_on_channel_modify(mrcp_channel_t *channel, mrcp_control_d
 apt_bool_t mrcp_server_on_channel_remove(mrcp_channel_t *channel, apt_bool_t status)
 {
 	mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
+	mrcp_server_session_log_scope_enter(channel->session);
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Control Channel Removed " APT_NAMESIDRES_FMT,
 			MRCP_SESSION_NAMESID(session),
 			channel->resource->name.buf);
@@ -385,6 +524,7 @@ apt_bool_t mrcp_server_on_disconnect(mrcp_channel_t *channel)
 	mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
 	if(!session)
 		return FALSE;
+	mrcp_server_session_log_scope_enter(&session->base);
 
 	if(session->state != SESSION_STATE_DEACTIVATING && session->state != SESSION_STATE_TERMINATING) {
 		mrcp_session_terminate_event(&session->base);
@@ -395,6 +535,7 @@ apt_bool_t mrcp_server_on_disconnect(mrcp_channel_t *channel)
 apt_bool_t mrcp_server_on_engine_channel_open(mrcp_channel_t *channel, apt_bool_t status)
 {
 	mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
+	mrcp_server_session_log_scope_enter(channel->session);
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Engine Channel Opened " APT_NAMESIDRES_FMT" [%s]",
 			MRCP_SESSION_NAMESID(session),
 			channel->resource->name.buf,
@@ -409,6 +550,7 @@ apt_bool_t mrcp_server_on_engine_channel_open(mrcp_channel_t *channel, apt_bool_
 apt_bool_t mrcp_server_on_engine_channel_close(mrcp_channel_t *channel)
 {
 	mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
+	mrcp_server_session_log_scope_enter(channel->session);
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Engine Channel Closed " APT_NAMESIDRES_FMT,
 			MRCP_SESSION_NAMESID(session),
 			channel->resource->name.buf);
@@ -416,26 +558,97 @@ apt_bool_t mrcp_server_on_engine_channel_close(mrcp_channel_t *channel)
 	return TRUE;
 }
 
+/** Check whether the message is START-OF-INPUT of the recognizer */
+static APR_INLINE apt_bool_t mrcp_server_start_of_input_check(const mrcp_channel_t *channel, const mrcp_message_t *message)
+{
+	return (channel->resource && channel->resource->id == MRCP_RECOGNIZER_RESOURCE &&
+		message->start_line.message_type == MRCP_MESSAGE_TYPE_EVENT &&
+		message->start_line.method_id == RECOGNIZER_START_OF_INPUT) ? TRUE : FALSE;
+}
+
+void mrcp_server_barge_in_signal(mrcp_channel_t *channel, const mrcp_message_t *message)
+{
+	mrcp_barge_in_link_t *link;
+	if(!channel || mrcp_server_start_of_input_check(channel,message) == FALSE) {
+		return;
+	}
+	link = ((mrcp_server_session_t*)channel->session)->barge_in_link;
+	/* the audio is muted from the next tick on, only once per SPEAK request */
+	if(link && apr_atomic_cas32(&link->armed,0,1) == 1) {
+		apr_atomic_set32(&link->cut,1);
+	}
+}
+
+/** Issue BARGE-IN-OCCURRED on behalf of the client to kill the SPEAK request cut on START-OF-INPUT */
+static apt_bool_t mrcp_server_barge_in_process(mrcp_server_session_t *session)
+{
+	mrcp_signaling_message_t *signaling_message;
+	mrcp_message_t *request;
+	mrcp_barge_in_link_t *link = session->barge_in_link;
+	if(!link || link->request || !link->speaker || !apr_atomic_read32(&link->cut)) {
+		return FALSE;
+	}
+
+	request = mrcp_request_create(
+					link->channel->resource,
+					mrcp_session_version_get(session),
+					SYNTHESIZER_BARGE_IN_OCCURRED,
+					session->base.pool);
+	if(!request) {
+		return FALSE;
+	}
+	request->channel_id = link->speaker->channel_id;
+	request->start_line.request_id = link->speaker->start_line.request_id;
+	link->request = request;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Barge-in on START-OF-INPUT " APT_NAMESIDRES_FMT " [%" MRCP_REQUEST_ID_FMT "]",
+		MRCP_SESSION_NAMESID(session),
+		link->channel->resource->name.buf,
+		request->start_line.request_id);
+	/* processed in turn with the requests of the client */
+	signaling_message = apr_palloc(session->base.pool,sizeof(mrcp_signaling_message_t));
+	signaling_message->type = SIGNALING_MESSAGE_CONTROL;
+	signaling_message->session = session;
+	signaling_message->descriptor = NULL;
+	signaling_message->channel = link->channel;
+	signaling_message->message = request;
+	return mrcp_server_signaling_message_process(signaling_message);
+}
+
 apt_bool_t mrcp_server_on_engine_channel_message(mrcp_channel_t *channel, mrcp_message_t *message)
 {
+	mrcp_server_session_log_scope_enter(channel->session);
 	if(!channel->state_machine) {
 		return FALSE;
 	}
+	if(mrcp_server_start_of_input_check(channel,message) == TRUE) {
+		mrcp_server_barge_in_process((mrcp_server_session_t*)channel->session);
+	}
 	/* update state machine */
 	return mrcp_state_machine_update(channel->state_machine,message);
 }
 
 static apt_bool_t mrcp_server_session_offer_process(mrcp_server_session_t *session, mrcp_session_descriptor_t *descriptor)
 {
+	apt_bool_t initial = FALSE;
 	if(!session->context) {
+		initial = TRUE;
 		/* initial offer received, generate session id and add to session's table */
 		if(!session->base.id.length) {
 			apt_unique_id_generate(&session->base.id,MRCP_SESSION_ID_HEX_STRING_LENGTH,session->base.pool);
 		}
+		/* whether the session logs verbosely is decided once, its channels take it over */
+		session->base.log_priority = mrcp_server_log_sampling_decide(
+										session->server,
+										&session->base.id,
+										descriptor->attribs.generic_attribs);
+		mrcp_server_session_log_scope_enter(&session->base);
 		mrcp_server_session_add(session->server,session);
 
+		/* assign the session to the least loaded media engine of the profile for its whole lifetime */
+		session->base.media_engine = mpf_engine_factory_engine_load_select(session->profile->mpf_factory);
 		session->context = mpf_engine_context_create(
-			session->profile->media_engine,
+			session->base.media_engine,
 			session->base.name,
 			session,5,session->base.pool);
 	}
@@ -459,11 +672,33 @@ static apt_bool_t mrcp_server_session_offer_process(mrcp_server_session_t *sessi
 
 	session->answer = mrcp_session_answer_create(descriptor,session->base.pool);
 
+	if(initial == TRUE) {
+		/* reject new session upfront, if the server is draining or the media engine is already behind */
+		mrcp_server_admission_t *admission = mrcp_server_admission_get(session->server);
+		apr_size_t retry_after = 0;
+		if(mrcp_server_draining_get(session->server,&retry_after) == TRUE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Reject Offer, Server Draining " APT_NAMESID_FMT,
+				MRCP_SESSION_NAMESID(session));
+			session->answer->status = MRCP_SESSION_STATUS_OVERLOADED;
+			session->answer->retry_after = retry_after;
+			mrcp_server_session_answer_send(session);
+			return TRUE;
+		}
+		if(admission && mrcp_server_admission_media_check(admission,session->base.media_engine) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Reject Offer, Media Engine Overloaded " APT_NAMESID_FMT,
+				MRCP_SESSION_NAMESID(session));
+			session->answer->status = MRCP_SESSION_STATUS_OVERLOADED;
+			session->answer->retry_after = mrcp_server_admission_retry_after_get(admission);
+			mrcp_server_session_answer_send(session);
+			return TRUE;
+		}
+	}
+
 	mrcp_server_session_state_set(session,SESSION_STATE_GENERATING_ANSWER);
 
 	/* first, reset/destroy existing associations and topology */
 	if(mpf_engine_topology_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_RESET_ASSOCIATIONS,session->context,
 				&session->mpf_task_msg) == TRUE){
 		mrcp_server_session_subrequest_add(session);
@@ -484,12 +719,12 @@ static apt_bool_t mrcp_server_session_offer_process(mrcp_server_session_t *sessi
 
 	/* apply topology based on assigned associations */
 	if(mpf_engine_topology_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_APPLY_TOPOLOGY,session->context,
 				&session->mpf_task_msg) == TRUE) {
 		mrcp_server_session_subrequest_add(session);
 	}
-	mpf_engine_message_send(session->profile->media_engine,&session->mpf_task_msg);
+	mpf_engine_message_send(session->base.media_engine,&session->mpf_task_msg);
 
 	if(!session->subrequest_count) {
 		/* send answer to client */
@@ -510,7 +745,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 	if(session->context) {
 		/* first, destroy existing topology */
 		if(mpf_engine_topology_message_add(
-					session->profile->media_engine,
+					session->base.media_engine,
 					MPF_RESET_ASSOCIATIONS,session->context,
 					&session->mpf_task_msg) == TRUE){
 			mrcp_server_session_subrequest_add(session);
@@ -541,7 +776,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 					MRCP_SESSION_NAMESID(session),
 					mpf_termination_name_get(termination));
 				if(mpf_engine_termination_message_add(
-							session->profile->media_engine,
+							session->base.media_engine,
 							MPF_SUBTRACT_TERMINATION,session->context,termination,NULL,
 							&session->mpf_task_msg) == TRUE) {
 					channel->waiting_for_termination = TRUE;
@@ -565,7 +800,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 			MRCP_SESSION_NAMESID(session),
 			mpf_termination_name_get(slot->termination));
 		if(mpf_engine_termination_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_SUBTRACT_TERMINATION,session->context,slot->termination,NULL,
 				&session->mpf_task_msg) == TRUE) {
 			slot->waiting = TRUE;
@@ -574,7 +809,7 @@ static apt_bool_t mrcp_server_session_terminate_process(mrcp_server_session_t *s
 	}
 
 	if(session->context) {
-		mpf_engine_message_send(session->profile->media_engine,&session->mpf_task_msg);
+		mpf_engine_message_send(session->base.media_engine,&session->mpf_task_msg);
 	}
 
 	if(!session->subrequest_count) {
@@ -624,6 +859,26 @@ static apt_bool_t mrcp_server_on_message_receive(mrcp_server_session_t *session,
 		return FALSE;
 	}
 
+	APT_PROBE4(mrcp_server_receive,
+		message->channel_id.session_id.buf,
+		message->channel_id.resource_name.buf,
+		message->start_line.method_id,
+		message->start_line.request_id);
+	/* MRCPv1 requests are traced from here */
+	mrcp_message_trace_start(message);
+	if(session->mem_account && message->start_line.message_type == MRCP_MESSAGE_TYPE_REQUEST && message->body.length) {
+		/* the body is kept in the pool of the connection or session, hence held for the rest of the session */
+		if(apt_mem_account_charge(session->mem_account,message->body.length) == FALSE) {
+			mrcp_message_t *response = mrcp_response_create(message,message->pool);
+			response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Reject Request over Memory Cap " APT_NAMESIDRES_FMT" [%"APR_SIZE_T_FMT"]",
+				MRCP_SESSION_NAMESID(session),
+				message->channel_id.resource_name.buf,
+				message->body.length);
+			/* the response is sent and the next request is dispatched as if it came from the engine */
+			return state_machine_on_message_dispatch(channel->state_machine,response);
+		}
+	}
 	/* update state machine */
 	return mrcp_state_machine_update(channel->state_machine,message);
 }
@@ -725,7 +980,7 @@ static apt_bool_t mrcp_server_resource_offer_process(mrcp_server_session_t *sess
 			mpf_termination_t *termination = channel->engine_channel->termination;
 			/* send add termination request (add to media context) */
 			if(mpf_engine_termination_message_add(
-					session->profile->media_engine,
+					session->base.media_engine,
 					MPF_ADD_TERMINATION,session->context,termination,NULL,
 					&session->mpf_task_msg) == TRUE) {
 				channel->waiting_for_termination = TRUE;
@@ -817,7 +1072,7 @@ static apt_bool_t mrcp_server_control_media_offer_process(mrcp_server_session_t
 			mpf_termination_t *termination = channel->engine_channel->termination;
 			/* send add termination request (add to media context) */
 			if(mpf_engine_termination_message_add(
-					session->profile->media_engine,
+					session->base.media_engine,
 					MPF_ADD_TERMINATION,session->context,termination,NULL,
 					&session->mpf_task_msg) == TRUE) {
 				channel->waiting_for_termination = TRUE;
@@ -912,7 +1167,7 @@ static apt_bool_t mrcp_server_associations_set(mrcp_server_session_t *session, m
 		if(!channel || !channel->engine_channel) continue;
 
 		if(mpf_engine_assoc_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_ADD_ASSOCIATION,session->context,slot->termination,channel->engine_channel->termination,
 				&session->mpf_task_msg) == TRUE) {
 			mrcp_server_session_subrequest_add(session);
@@ -953,7 +1208,7 @@ static apt_bool_t mrcp_server_av_media_offer_process(mrcp_server_session_t *sess
 				mpf_termination_name_get(slot->termination),
 				i);
 		if(mpf_engine_termination_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_MODIFY_TERMINATION,session->context,slot->termination,rtp_descriptor,
 				&session->mpf_task_msg) == TRUE) {
 			slot->waiting = TRUE;
@@ -987,7 +1242,7 @@ static apt_bool_t mrcp_server_av_media_offer_process(mrcp_server_session_t *sess
 
 		/* send add termination request (add to media context) */
 		if(mpf_engine_termination_message_add(
-				session->profile->media_engine,
+				session->base.media_engine,
 				MPF_ADD_TERMINATION,session->context,termination,rtp_descriptor,
 				&session->mpf_task_msg) == TRUE) {
 			slot->waiting = TRUE;
@@ -1128,6 +1383,34 @@ static apt_bool_t mrcp_server_on_termination_modify(mrcp_server_session_t *sessi
 	return TRUE;
 }
 
+/** Log the receive quality of the RTP termination of session, which is final once subtracted */
+static void mrcp_server_rtp_quality_log(mrcp_server_session_t *session, mpf_termination_t *termination)
+{
+	rtp_rx_stat_t rx_stat;
+	rtcp_xr_voip_stat_t voip_stat;
+	if(mpf_rtp_termination_rx_stat_get(termination,&rx_stat,&voip_stat) == FALSE) {
+		return;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"RTP Receive Quality " APT_NAMESID_FMT " [r:%u l:%u d:%u loss:%u discard:%u burst:%u/%ums gap:%u/%ums jb:%u/%ums R:%u MOS-LQ:%u.%u MOS-CQ:%u.%u]",
+		MRCP_SESSION_NAMESID(session),
+		rx_stat.received_packets,
+		rx_stat.lost_packets,
+		rx_stat.discarded_packets,
+		voip_stat.loss_rate,
+		voip_stat.discard_rate,
+		voip_stat.burst_density,
+		voip_stat.burst_duration,
+		voip_stat.gap_density,
+		voip_stat.gap_duration,
+		voip_stat.jb_nominal,
+		voip_stat.jb_maximum,
+		voip_stat.r_factor,
+		voip_stat.mos_lq / 10,
+		voip_stat.mos_lq % 10,
+		voip_stat.mos_cq / 10,
+		voip_stat.mos_cq % 10);
+}
+
 static apt_bool_t mrcp_server_on_termination_subtract(mrcp_server_session_t *session, const mpf_message_t *mpf_message)
 {
 	mrcp_termination_slot_t *termination_slot;
@@ -1141,6 +1424,7 @@ static apt_bool_t mrcp_server_on_termination_subtract(mrcp_server_session_t *ses
 			return FALSE;
 		}
 		termination_slot->waiting = FALSE;
+		mrcp_server_rtp_quality_log(session,mpf_message->termination);
 		mrcp_server_session_subrequest_remove(session);
 	}
 	else {
@@ -1171,6 +1455,7 @@ apt_bool_t mrcp_server_mpf_message_process(mpf_message_container_t *mpf_message_
 			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Received MPF Message: NULL session");
 			continue;
 		}
+		mrcp_server_session_log_scope_enter(&session->base);
 		if(mpf_message->message_type == MPF_MESSAGE_TYPE_RESPONSE) {
 			switch(mpf_message->command_id) {
 				case MPF_ADD_TERMINATION:
@@ -1200,27 +1485,120 @@ apt_bool_t mrcp_server_mpf_message_process(mpf_message_container_t *mpf_message_
 	return TRUE;
 }
 
+/** Send response or event message to client */
+static void mrcp_server_channel_message_send(mrcp_channel_t *channel, mrcp_message_t *message)
+{
+	if(channel->control_channel) {
+		/* MRCPv2 */
+		mrcp_server_control_message_send(channel->control_channel,message);
+	}
+	else {
+		/* MRCPv1 */
+		mrcp_session_control_response(channel->session,message);
+	}
+	mrcp_message_trace_sent(message);
+}
+
+/** Follow the SPEAK requests of the synthesizer linked for barge-in */
+static void mrcp_server_barge_in_track(mrcp_barge_in_link_t *link, mrcp_message_t *message)
+{
+	switch(message->start_line.message_type) {
+		case MRCP_MESSAGE_TYPE_REQUEST:
+			if(message->start_line.method_id == SYNTHESIZER_SPEAK) {
+				/* the request dispatched to the engine is the one to be spoken now */
+				apt_bool_t kill_on_barge_in = TRUE;
+				mrcp_synth_header_t *synth_header = mrcp_resource_header_get(message);
+				if(synth_header && mrcp_resource_header_property_check(message,SYNTHESIZER_HEADER_KILL_ON_BARGE_IN) == TRUE) {
+					kill_on_barge_in = synth_header->kill_on_barge_in;
+				}
+				link->speaker = message;
+				apr_atomic_set32(&link->cut,0);
+				apr_atomic_set32(&link->armed,kill_on_barge_in == TRUE ? 1 : 0);
+			}
+			else if(message->start_line.method_id == SYNTHESIZER_STOP ||
+				message->start_line.method_id == SYNTHESIZER_BARGE_IN_OCCURRED) {
+				apr_atomic_set32(&link->armed,0);
+			}
+			break;
+		case MRCP_MESSAGE_TYPE_RESPONSE:
+			if((message->start_line.method_id == SYNTHESIZER_SPEAK &&
+				message->start_line.status_code != MRCP_STATUS_CODE_SUCCESS &&
+				message->start_line.status_code != MRCP_STATUS_CODE_SUCCESS_WITH_IGNORE) ||
+				message->start_line.method_id == SYNTHESIZER_STOP) {
+				apr_atomic_set32(&link->armed,0);
+				apr_atomic_set32(&link->cut,0);
+			}
+			break;
+		case MRCP_MESSAGE_TYPE_EVENT:
+			if(message->start_line.method_id == SYNTHESIZER_SPEAK_COMPLETE) {
+				apr_atomic_set32(&link->armed,0);
+				apr_atomic_set32(&link->cut,0);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+/** Complete the SPEAK requests killed by BARGE-IN-OCCURRED issued by the server, the response goes nowhere */
+static void mrcp_server_barge_in_complete(mrcp_barge_in_link_t *link, mrcp_message_t *response)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(response);
+	if(link->speaker && generic_header &&
+		mrcp_generic_header_property_check(response,GENERIC_HEADER_ACTIVE_REQUEST_ID_LIST) == TRUE) {
+		apr_size_t i;
+		for(i=0; i<generic_header->active_request_id_list.count; i++) {
+			mrcp_synth_header_t *synth_header;
+			mrcp_message_t *event = mrcp_event_create(link->speaker,SYNTHESIZER_SPEAK_COMPLETE,response->pool);
+			if(!event) continue;
+
+			event->start_line.request_id = generic_header->active_request_id_list.ids[i];
+			event->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+			synth_header = mrcp_resource_header_prepare(event);
+			if(synth_header) {
+				synth_header->completion_cause = SYNTHESIZER_COMPLETION_CAUSE_BARGE_IN;
+				mrcp_resource_header_property_add(event,SYNTHESIZER_HEADER_COMPLETION_CAUSE);
+			}
+			mrcp_server_channel_message_send(link->channel,event);
+		}
+	}
+	link->request = NULL;
+	link->speaker = NULL;
+	apr_atomic_set32(&link->armed,0);
+	apr_atomic_set32(&link->cut,0);
+}
+
 static apt_bool_t state_machine_on_message_dispatch(mrcp_state_machine_t *state_machine, mrcp_message_t *message)
 {
 	mrcp_channel_t *channel = state_machine->obj;
+	mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
+	mrcp_barge_in_link_t *link = session->barge_in_link;
+
+	if(link && link->channel == channel) {
+		if(link->request && message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE &&
+			message->start_line.method_id == SYNTHESIZER_BARGE_IN_OCCURRED &&
+			message->start_line.request_id == link->request->start_line.request_id) {
+			/* the client learns of the barge-in by SPEAK-COMPLETE instead */
+			mrcp_server_barge_in_complete(link,message);
+			session->active_request = apt_list_pop_front(session->request_queue);
+			if(session->active_request) {
+				mrcp_server_signaling_message_dispatch(session,session->active_request);
+			}
+			return TRUE;
+		}
+		mrcp_server_barge_in_track(link,message);
+	}
 
 	if(message->start_line.message_type == MRCP_MESSAGE_TYPE_REQUEST) {
 		/* send request message to engine for actual processing */
 		if(channel->engine_channel) {
+			mrcp_message_trace_stamp(message,MRCP_TRACE_POINT_DISPATCHED);
 			mrcp_engine_channel_request_process(channel->engine_channel,message);
 		}
 	}
 	else if(message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE) {
-		mrcp_server_session_t *session = (mrcp_server_session_t*)channel->session;
 		/* send response message to client */
-		if(channel->control_channel) {
-			/* MRCPv2 */
-			mrcp_server_control_message_send(channel->control_channel,message);
-		}
-		else {
-			/* MRCPv1 */
-			mrcp_session_control_response(channel->session,message);
-		}
+		mrcp_server_channel_message_send(channel,message);
 
 		session->active_request = apt_list_pop_front(session->request_queue);
 		if(session->active_request) {
@@ -1229,14 +1607,7 @@ static apt_bool_t state_machine_on_message_dispatch(mrcp_state_machine_t *state_
 	}
 	else { 
 		/* send event message to client */
-		if(channel->control_channel) {
-			/* MRCPv2 */
-			mrcp_server_control_message_send(channel->control_channel,message);
-		}
-		else {
-			/* MRCPv1 */
-			mrcp_session_control_response(channel->session,message);
-		}
+		mrcp_server_channel_message_send(channel,message);
 	}
 	return TRUE;
 }
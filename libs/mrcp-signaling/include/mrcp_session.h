@@ -25,6 +25,8 @@
 #include "mrcp_sig_types.h"
 #include "mpf_types.h"
 #include "apt_string.h"
+#include "apt_pool.h"
+#include "apt_log.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -51,12 +53,16 @@ struct mrcp_session_t {
 	apr_pool_t       *pool;
 	/** Whether the memory pool is self-owned or not */
 	apt_bool_t        self_owned;
+	/** Cache the self-owned pool is released to instead of being destroyed, if any */
+	apt_pool_cache_t *pool_cache;
 	/** External object associated with session */
 	void             *obj;
 	/** External logger object associated with session */
 	void             *log_obj;
 	/** Informative name of the session used for debugging */
 	const char       *name;
+	/** Max priority of log entries of the session (APT_PRIO_COUNT - the sampling priority applies) */
+	apt_log_priority_e log_priority;
 
 	/** Signaling (session managment) agent */
 	mrcp_sig_agent_t          *signaling_agent;
@@ -117,6 +123,9 @@ MRCP_DECLARE(mrcp_session_t*) mrcp_session_create(apr_size_t padding);
 /** Allocate session object from the provided memory pool. Take over the ownership of the pool, if take_ownership is TRUE */
 MRCP_DECLARE(mrcp_session_t*) mrcp_session_create_ex(apr_pool_t *pool, apt_bool_t take_ownership, apr_size_t padding);
 
+/** Acquire memory pool from the cache and allocate session object from the pool, which is released to the cache on destroy. */
+MRCP_DECLARE(mrcp_session_t*) mrcp_session_cached_create(apt_pool_cache_t *pool_cache, apr_size_t padding);
+
 /** Destroy session and assosiated memory pool. */
 MRCP_DECLARE(void) mrcp_session_destroy(mrcp_session_t *session);
 
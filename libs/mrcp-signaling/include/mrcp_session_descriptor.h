@@ -35,6 +35,7 @@ typedef enum {
 	MRCP_SESSION_STATUS_NO_SUCH_RESOURCE,     /**< no such resource found */
 	MRCP_SESSION_STATUS_UNACCEPTABLE_RESOURCE,/**< resource exists, but no implementation (plugin) found */
 	MRCP_SESSION_STATUS_UNAVAILABLE_RESOURCE, /**< resource exists, but is temporary unavailable */
+	MRCP_SESSION_STATUS_OVERLOADED,           /**< server is overloaded, the session is to be retried later or elsewhere */
 	MRCP_SESSION_STATUS_ERROR                 /**< internal error occurred */
 } mrcp_session_status_e;
 
@@ -62,6 +63,8 @@ struct mrcp_session_descriptor_t {
 	mrcp_session_status_e status;
 	/** Response code (SIP for MRCPv2 and RTSP for MRCPv1) */
 	int                   response_code;
+	/** Time (sec) the client is asked to retry in, if the session is rejected (0 - not specified) */
+	apr_size_t            retry_after;
 
 	/** MRCP control media array (mrcp_control_descriptor_t) */
 	apr_array_header_t   *control_media_arr;
@@ -48,6 +48,13 @@ struct mrcp_sig_settings_t {
 	char        *feature_tags;
 };
 
+/** Decision of a server on a new offer */
+typedef enum {
+	MRCP_SIG_OFFER_ACCEPT,   /**< take the offer */
+	MRCP_SIG_OFFER_REDIRECT, /**< redirect the offer to another server */
+	MRCP_SIG_OFFER_REJECT    /**< reject the offer */
+} mrcp_sig_offer_e;
+
 /** MRCP signaling agent  */
 struct mrcp_sig_agent_t {
 	/** Agent identifier */
@@ -69,6 +76,14 @@ struct mrcp_sig_agent_t {
 	mrcp_session_t* (*create_server_session)(mrcp_sig_agent_t *signaling_agent);
 	/** Virtual create_client_session */
 	apt_bool_t (*create_client_session)(mrcp_session_t *session, const mrcp_sig_settings_t *settings, const mrcp_session_attribs_t *attribs);
+	/** Virtual listen_stop (optional), stop accepting new connections of a server agent */
+	apt_bool_t (*listen_stop)(mrcp_sig_agent_t *signaling_agent);
+	/** Virtual offer_check (optional), decide on a new offer received by a server agent,
+	    copying the URI to redirect to and the time (sec) to retry in (0 - not specified) */
+	mrcp_sig_offer_e (*offer_check)(mrcp_sig_agent_t *signaling_agent, char *redirect_uri, apr_size_t size, apr_size_t *retry_after);
+	/** Virtual capabilities_invalidate (optional), drop what a server agent caches of the engines and profiles,
+	    as they have changed; may be called from any thread */
+	void (*capabilities_invalidate)(mrcp_sig_agent_t *signaling_agent);
 };
 
 /** Create signaling agent. */
@@ -39,6 +39,9 @@ MRCP_DECLARE(mrcp_sig_agent_t*) mrcp_signaling_agent_create(const char *id, void
 	sig_agent->msg_pool = NULL;
 	sig_agent->create_server_session = NULL;
 	sig_agent->create_client_session = NULL;
+	sig_agent->listen_stop = NULL;
+	sig_agent->offer_check = NULL;
+	sig_agent->capabilities_invalidate = NULL;
 	return sig_agent;
 }
 
@@ -104,15 +107,34 @@ MRCP_DECLARE(mrcp_session_t*) mrcp_session_create(apr_size_t padding)
 	return mrcp_session_create_ex(pool,TRUE,padding);
 }
 
+MRCP_DECLARE(mrcp_session_t*) mrcp_session_cached_create(apt_pool_cache_t *pool_cache, apr_size_t padding)
+{
+	mrcp_session_t *session;
+	apr_pool_t *pool;
+	if(!pool_cache) {
+		return mrcp_session_create(padding);
+	}
+
+	pool = apt_pool_cache_acquire(pool_cache);
+	if(!pool) {
+		return NULL;
+	}
+	session = mrcp_session_create_ex(pool,TRUE,padding);
+	session->pool_cache = pool_cache;
+	return session;
+}
+
 MRCP_DECLARE(mrcp_session_t*) mrcp_session_create_ex(apr_pool_t *pool, apt_bool_t take_ownership, apr_size_t padding)
 {
 	mrcp_session_t *session;
 	session = apr_palloc(pool,sizeof(mrcp_session_t)+padding);
 	session->self_owned = take_ownership;
+	session->pool_cache = NULL;
 	session->pool = pool;
 	session->obj = NULL;
 	session->log_obj = NULL;
 	session->name = NULL;
+	session->log_priority = APT_PRIO_COUNT;
 	session->signaling_agent = NULL;
 	session->connection_agent = NULL;
 	session->media_engine = NULL;
@@ -128,6 +150,11 @@ MRCP_DECLARE(mrcp_session_t*) mrcp_session_create_ex(apr_pool_t *pool, apt_bool_
 MRCP_DECLARE(void) mrcp_session_destroy(mrcp_session_t *session)
 {
 	if(session->pool && session->self_owned == TRUE) {
-		apr_pool_destroy(session->pool);
+		if(session->pool_cache) {
+			apt_pool_cache_release(session->pool_cache,session->pool);
+		}
+		else {
+			apr_pool_destroy(session->pool);
+		}
 	}
 }
@@ -24,6 +24,7 @@
 
 #include "apt_text_message.h"
 #include "mrcp_types.h"
+#include "mrcp_body_store.h"
 
 APT_BEGIN_EXTERN_C
 
@@ -43,9 +44,39 @@ MRCP_DECLARE(void) mrcp_parser_resource_set(mrcp_parser_t *parser, const apt_str
 /** Set verbose mode for the parser */
 MRCP_DECLARE(void) mrcp_parser_verbose_set(mrcp_parser_t *parser, apt_bool_t verbose);
 
+/**
+ * Set lazy mode for the parser.
+ * @param parser the parser to set the mode for
+ * @param lazy whether to parse the header field values on the first access only
+ */
+MRCP_DECLARE(void) mrcp_parser_lazy_mode_set(mrcp_parser_t *parser, apt_bool_t lazy);
+
+/**
+ * Set arena mode for the parser.
+ * @param parser the parser to set the mode for
+ * @param arena whether to parse each message into its own arena (see mrcp_message_arena.h)
+ * @remark The messages parsed in the arena mode must be released by mrcp_message_arena_release().
+ */
+MRCP_DECLARE(void) mrcp_parser_arena_mode_set(mrcp_parser_t *parser, apt_bool_t arena);
+
+/**
+ * Set store to intern bodies of parsed messages in.
+ * @param parser the parser to set the store for
+ * @param body_store the store to intern bodies in (NULL - keep a copy of the body per message)
+ * @remark Bodies are then read into a buffer of the parser, and copied to the store only
+ *         if no byte-identical body is interned yet (see mrcp_body_store.h).
+ */
+MRCP_DECLARE(void) mrcp_parser_body_store_set(mrcp_parser_t *parser, mrcp_body_store_t *body_store);
+
 /** Parse MRCP stream */
 MRCP_DECLARE(apt_message_status_e) mrcp_parser_run(mrcp_parser_t *parser, apt_text_stream_t *stream, mrcp_message_t **message);
 
+/** Get the remaining part of the message body being parsed, data can directly be received into */
+MRCP_DECLARE(apt_bool_t) mrcp_parser_body_buffer_get(mrcp_parser_t *parser, char **buf, apr_size_t *length);
+
+/** Account the data directly received into the body buffer */
+MRCP_DECLARE(void) mrcp_parser_body_buffer_fill(mrcp_parser_t *parser, apr_size_t length);
+
 
 
 /** Create MRCP stream generator */
@@ -57,6 +88,9 @@ MRCP_DECLARE(void) mrcp_generator_verbose_set(mrcp_generator_t *generator, apt_b
 /** Generate MRCP stream */
 MRCP_DECLARE(apt_message_status_e) mrcp_generator_run(mrcp_generator_t *generator, mrcp_message_t *message, apt_text_stream_t *stream);
 
+/** Generate MRCP start-line and header section only, the body is to be sent as is */
+MRCP_DECLARE(apt_bool_t) mrcp_generator_header_run(mrcp_generator_t *generator, mrcp_message_t *message, apt_text_stream_t *stream);
+
 
 /** Generate MRCP message (excluding message body) */
 MRCP_DECLARE(apt_bool_t) mrcp_message_generate(const mrcp_resource_factory_t *resource_factory, mrcp_message_t *message, apt_text_stream_t *stream);
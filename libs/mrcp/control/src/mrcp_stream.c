@@ -16,9 +16,12 @@
 
 #include "mrcp_stream.h"
 #include "mrcp_message.h"
+#include "mrcp_message_arena.h"
+#include "mrcp_body_store.h"
 #include "mrcp_resource_factory.h"
 #include "mrcp_resource.h"
 #include "apt_log.h"
+#include "apt_probe.h"
 
 
 /** MRCP parser */
@@ -26,6 +29,18 @@ struct mrcp_parser_t {
 	apt_message_parser_t          *base;
 	const mrcp_resource_factory_t *resource_factory;
 	mrcp_resource_t               *resource;
+	apt_bool_t                     lazy;
+	apt_bool_t                     arena;
+	/** Message being parsed in its own arena, until handed out */
+	mrcp_message_t                *message;
+	/** Store to intern bodies in (NULL if bodies are kept per message) */
+	mrcp_body_store_t             *body_store;
+	/** Buffer bodies to intern are read into, reused for each message */
+	char                          *body_buf;
+	/** Size of the buffer */
+	apr_size_t                     body_buf_size;
+	/** Pool to allocate the buffer from */
+	apr_pool_t                    *pool;
 };
 
 /** MRCP generator */
@@ -38,11 +53,13 @@ struct mrcp_generator_t {
 static apt_bool_t mrcp_parser_on_start(apt_message_parser_t *parser, apt_message_context_t *context, apt_text_stream_t *stream, apr_pool_t *pool);
 /** Header section handler */
 static apt_bool_t mrcp_parser_on_header_complete(apt_message_parser_t *parser, apt_message_context_t *context);
+/** Body handler */
+static apt_bool_t mrcp_parser_on_body_complete(apt_message_parser_t *parser, apt_message_context_t *context);
 
 static const apt_message_parser_vtable_t parser_vtable = {
 	mrcp_parser_on_start,
 	mrcp_parser_on_header_complete,
-	NULL
+	mrcp_parser_on_body_complete
 };
 
 /** Start message generation  */
@@ -57,6 +74,17 @@ static const apt_message_generator_vtable_t generator_vtable = {
 };
 
 
+/** Release the incomplete message left in its arena */
+static apr_status_t mrcp_parser_cleanup(void *obj)
+{
+	mrcp_parser_t *parser = obj;
+	if(parser->message) {
+		mrcp_message_arena_release(parser->message);
+		parser->message = NULL;
+	}
+	return APR_SUCCESS;
+}
+
 /** Create MRCP stream parser */
 MRCP_DECLARE(mrcp_parser_t*) mrcp_parser_create(const mrcp_resource_factory_t *resource_factory, apr_pool_t *pool)
 {
@@ -64,6 +92,14 @@ MRCP_DECLARE(mrcp_parser_t*) mrcp_parser_create(const mrcp_resource_factory_t *r
 	parser->base = apt_message_parser_create(parser,&parser_vtable,pool);
 	parser->resource_factory = resource_factory;
 	parser->resource = NULL;
+	parser->lazy = FALSE;
+	parser->arena = FALSE;
+	parser->message = NULL;
+	parser->body_store = NULL;
+	parser->body_buf = NULL;
+	parser->body_buf_size = 0;
+	parser->pool = pool;
+	apr_pool_cleanup_register(pool,parser,mrcp_parser_cleanup,apr_pool_cleanup_null);
 	return parser;
 }
 
@@ -81,15 +117,57 @@ MRCP_DECLARE(void) mrcp_parser_verbose_set(mrcp_parser_t *parser, apt_bool_t ver
 	apt_message_parser_verbose_set(parser->base,verbose);
 }
 
+/** Set lazy mode for the parser */
+MRCP_DECLARE(void) mrcp_parser_lazy_mode_set(mrcp_parser_t *parser, apt_bool_t lazy)
+{
+	parser->lazy = lazy;
+}
+
+/** Set arena mode for the parser */
+MRCP_DECLARE(void) mrcp_parser_arena_mode_set(mrcp_parser_t *parser, apt_bool_t arena)
+{
+	parser->arena = arena;
+}
+
+/** Set store to intern bodies of parsed messages in */
+MRCP_DECLARE(void) mrcp_parser_body_store_set(mrcp_parser_t *parser, mrcp_body_store_t *body_store)
+{
+	parser->body_store = body_store;
+}
+
 /** Parse MRCP stream */
 MRCP_DECLARE(apt_message_status_e) mrcp_parser_run(mrcp_parser_t *parser, apt_text_stream_t *stream, mrcp_message_t **message)
 {
-	return apt_message_parser_run(parser->base,stream,(void**)message);
+	apt_message_status_e status = apt_message_parser_run(parser->base,stream,(void**)message);
+	if(status == APT_MESSAGE_STATUS_COMPLETE) {
+		/* the arena (if any) is owned by the caller from now on */
+		parser->message = NULL;
+		APT_PROBE5(mrcp_parse,
+			(*message)->channel_id.session_id.buf,
+			(*message)->channel_id.resource_name.buf,
+			(*message)->start_line.method_id,
+			(*message)->start_line.request_id,
+			(*message)->start_line.length);
+	}
+	return status;
+}
+
+/** Get the remaining part of the message body being parsed */
+MRCP_DECLARE(apt_bool_t) mrcp_parser_body_buffer_get(mrcp_parser_t *parser, char **buf, apr_size_t *length)
+{
+	return apt_message_parser_body_buffer_get(parser->base,buf,length);
+}
+
+/** Account the data directly received into the body buffer */
+MRCP_DECLARE(void) mrcp_parser_body_buffer_fill(mrcp_parser_t *parser, apr_size_t length)
+{
+	apt_message_parser_body_buffer_fill(parser->base,length);
 }
 
 /** Create message and read start line */
 static apt_bool_t mrcp_parser_on_start(apt_message_parser_t *parser, apt_message_context_t *context, apt_text_stream_t *stream, apr_pool_t *pool)
 {
+	mrcp_parser_t *mrcp_parser = apt_message_parser_object_get(parser);
 	mrcp_message_t *mrcp_message;
 	apt_str_t start_line;
 	/* read start line */
@@ -97,15 +175,30 @@ static apt_bool_t mrcp_parser_on_start(apt_message_parser_t *parser, apt_message
 		return FALSE;
 	}
 
+	if(mrcp_parser->message) {
+		/* the previous message has never been completed */
+		mrcp_message_arena_release(mrcp_parser->message);
+		mrcp_parser->message = NULL;
+	}
+
 	/* create new MRCP message */
-	mrcp_message = mrcp_message_create(pool);
+	if(mrcp_parser->arena == TRUE) {
+		mrcp_message = mrcp_message_arena_create();
+		if(!mrcp_message) {
+			return FALSE;
+		}
+		mrcp_parser->message = mrcp_message;
+		pool = mrcp_message->pool;
+	}
+	else {
+		mrcp_message = mrcp_message_create(pool);
+	}
 	/* parse start-line */
 	if(mrcp_start_line_parse(&mrcp_message->start_line,&start_line,mrcp_message->pool) == FALSE) {
 		return FALSE;
 	}
 
 	if(mrcp_message->start_line.version == MRCP_VERSION_1) {
-		mrcp_parser_t *mrcp_parser = apt_message_parser_object_get(parser);
 		if(!mrcp_parser->resource) {
 			return FALSE;
 		}
@@ -122,6 +215,7 @@ static apt_bool_t mrcp_parser_on_start(apt_message_parser_t *parser, apt_message
 	context->message = mrcp_message;
 	context->header = &mrcp_message->header.header_section;
 	context->body = &mrcp_message->body;
+	context->pool = mrcp_message->pool;
 	return TRUE;
 }
 
@@ -129,13 +223,12 @@ static apt_bool_t mrcp_parser_on_start(apt_message_parser_t *parser, apt_message
 static apt_bool_t mrcp_parser_on_header_complete(apt_message_parser_t *parser, apt_message_context_t *context)
 {
 	mrcp_message_t *mrcp_message = context->message;
+	mrcp_parser_t *mrcp_parser = apt_message_parser_object_get(parser);
 	if(mrcp_message->start_line.version == MRCP_VERSION_2) {
 		mrcp_resource_t *resource;
-		mrcp_parser_t *mrcp_parser;
 		if(mrcp_channel_id_parse(&mrcp_message->channel_id,&mrcp_message->header,mrcp_message->pool) == FALSE) {
 			return FALSE;
 		}
-		mrcp_parser = apt_message_parser_object_get(parser);
 		/* find resource */
 		resource = mrcp_resource_find(mrcp_parser->resource_factory,&mrcp_message->channel_id.resource_name);
 		if(!resource) {
@@ -147,19 +240,49 @@ static apt_bool_t mrcp_parser_on_header_complete(apt_message_parser_t *parser, a
 		}
 	}
 
-	if(mrcp_header_fields_parse(&mrcp_message->header,mrcp_message->pool) == FALSE) {
+	if(mrcp_parser->lazy == TRUE) {
+		if(mrcp_header_fields_lazy_parse(&mrcp_message->header,mrcp_message->pool) == FALSE) {
+			return FALSE;
+		}
+	}
+	else if(mrcp_header_fields_parse(&mrcp_message->header,mrcp_message->pool) == FALSE) {
 		return FALSE;
 	}
 
 	if(context->body && mrcp_generic_header_property_check(mrcp_message,GENERIC_HEADER_CONTENT_LENGTH) == TRUE) {
-		mrcp_generic_header_t *generic_header = mrcp_generic_header_get(mrcp_message);
+		/* the content length has just been parsed by the check, the rest is left pending (lazy mode) */
+		mrcp_generic_header_t *generic_header = mrcp_message->header.generic_header_accessor.data;
 		if(generic_header && generic_header->content_length) {
 			context->body->length = generic_header->content_length;
+			if(mrcp_parser->body_store && mrcp_body_store_check(mrcp_parser->body_store,context->body->length) == TRUE) {
+				/* the body is read into the buffer of the parser, and only copied if it is not interned yet */
+				if(mrcp_parser->body_buf_size < context->body->length + 1) {
+					mrcp_parser->body_buf_size = context->body->length + 1;
+					mrcp_parser->body_buf = apr_palloc(mrcp_parser->pool,mrcp_parser->body_buf_size);
+				}
+				context->body->buf = mrcp_parser->body_buf;
+			}
 		}
 	}
 	return TRUE;
 }
 
+/** Body handler */
+static apt_bool_t mrcp_parser_on_body_complete(apt_message_parser_t *parser, apt_message_context_t *context)
+{
+	mrcp_message_t *mrcp_message = context->message;
+	mrcp_parser_t *mrcp_parser = apt_message_parser_object_get(parser);
+	if(!mrcp_parser->body_buf || mrcp_message->body.buf != mrcp_parser->body_buf) {
+		return TRUE;
+	}
+
+	if(mrcp_body_store_intern(mrcp_parser->body_store,mrcp_message,&mrcp_message->body) == FALSE) {
+		/* the buffer of the parser is reused by the next message */
+		mrcp_message->body.buf = apr_pstrmemdup(mrcp_message->pool,mrcp_parser->body_buf,mrcp_message->body.length);
+	}
+	return TRUE;
+}
+
 
 /** Create MRCP stream generator */
 MRCP_DECLARE(mrcp_generator_t*) mrcp_generator_create(const mrcp_resource_factory_t *resource_factory, apr_pool_t *pool)
@@ -182,6 +305,12 @@ MRCP_DECLARE(apt_message_status_e) mrcp_generator_run(mrcp_generator_t *generato
 	return apt_message_generator_run(generator->base,message,stream);
 }
 
+/** Generate MRCP start-line and header section only */
+MRCP_DECLARE(apt_bool_t) mrcp_generator_header_run(mrcp_generator_t *generator, mrcp_message_t *message, apt_text_stream_t *stream)
+{
+	return mrcp_message_generate(generator->resource_factory,message,stream);
+}
+
 /** Initialize by generating message start line and return header section and body */
 apt_bool_t mrcp_generator_on_start(apt_message_generator_t *generator, apt_message_context_t *context, apt_text_stream_t *stream)
 {
@@ -70,6 +70,8 @@ typedef apr_size_t mrcp_resource_id;
 
 /** Opaque MRCP message declaration */
 typedef struct mrcp_message_t mrcp_message_t;
+/** Opaque MRCP message trace declaration */
+typedef struct mrcp_message_trace_t mrcp_message_trace_t;
 /** Opaque MRCP resource declaration */
 typedef struct mrcp_resource_t mrcp_resource_t;
 /** Opaque MRCP resource factory declaration */
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_BODY_STORE_H
+#define MRCP_BODY_STORE_H
+
+/**
+ * @file mrcp_body_store.h
+ * @brief Store of Interned Message Bodies
+ *
+ * Byte-identical bodies of received messages, such as the same grammar sent
+ * by thousands of sessions, are kept once and shared read-only by the messages
+ * referencing them. Each interned body is assigned an id, which downstream
+ * caches may key on instead of hashing the body again.
+ */
+
+#include "mrcp_message.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default min size of the body of a message to intern (smaller ones are cheaper to copy) */
+#define MRCP_BODY_STORE_DEFAULT_MIN_SIZE 256
+/** Default max size of the body of a message to intern (larger ones are mostly audio) */
+#define MRCP_BODY_STORE_DEFAULT_MAX_SIZE (256 * 1024)
+
+/** Opaque store of interned bodies */
+typedef struct mrcp_body_store_t mrcp_body_store_t;
+
+/** Statistics of the store */
+typedef struct mrcp_body_store_stats_t mrcp_body_store_stats_t;
+
+/** Statistics of the store */
+struct mrcp_body_store_stats_t {
+	/** Number of distinct bodies currently held */
+	apr_size_t count;
+	/** Total size of the bodies currently held */
+	apr_size_t size;
+	/** Number of bodies found already interned */
+	apr_size_t hits;
+	/** Number of bodies interned anew */
+	apr_size_t misses;
+};
+
+/**
+ * Create store of interned bodies.
+ * @param min_size the min size of the body to intern
+ * @param max_size the max size of the body to intern
+ * @param pool the pool to allocate memory from
+ * @remark The store may be shared by any number of parsers running in different threads,
+ *         and must outlive the messages referencing the bodies of it.
+ */
+MRCP_DECLARE(mrcp_body_store_t*) mrcp_body_store_create(apr_size_t min_size, apr_size_t max_size, apr_pool_t *pool);
+
+/**
+ * Check whether the body of the length is to be interned.
+ * @param store the store to check
+ * @param length the length of the body
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_body_store_check(const mrcp_body_store_t *store, apr_size_t length);
+
+/**
+ * Intern body and make it the body of the message.
+ * @param store the store to intern the body in
+ * @param message the message to set the body of
+ * @param body the body to intern (may be a temporary buffer, it is copied if not interned yet)
+ * @remark The body is referenced till message->pool is cleared or destroyed,
+ *         and must not be modified, since it is shared by other messages.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_body_store_intern(mrcp_body_store_t *store, mrcp_message_t *message, const apt_str_t *body);
+
+/**
+ * Get statistics of the store.
+ * @param store the store to get statistics of
+ * @param stats the statistics to fill
+ */
+MRCP_DECLARE(void) mrcp_body_store_stats_get(mrcp_body_store_t *store, mrcp_body_store_stats_t *stats);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_BODY_STORE_H */
@@ -47,6 +47,13 @@ struct mrcp_message_header_t {
 
 	/** Header section (collection of header fields)*/
 	apt_header_section_t   header_section;
+
+	/** Flags of the header fields (by id) whose values are not parsed yet, set in the lazy mode only */
+	apr_byte_t            *pending_fields;
+	/** Number of the header fields whose values are not parsed yet */
+	apr_size_t             pending_count;
+	/** Pool to parse the pending values from */
+	apr_pool_t            *pending_pool;
 };
 
 /** MRCP channel-identifier */
@@ -64,6 +71,9 @@ static APR_INLINE void mrcp_message_header_init(mrcp_message_header_t *header)
 	mrcp_header_accessor_init(&header->generic_header_accessor);
 	mrcp_header_accessor_init(&header->resource_header_accessor);
 	apt_header_section_init(&header->header_section);
+	header->pending_fields = NULL;
+	header->pending_count = 0;
+	header->pending_pool = NULL;
 }
 
 /** Allocate MRCP message-header data */
@@ -102,6 +112,21 @@ MRCP_DECLARE(apt_bool_t) mrcp_header_fields_inherit(mrcp_message_header_t *heade
 /** Parse MRCP header fields */
 MRCP_DECLARE(apt_bool_t) mrcp_header_fields_parse(mrcp_message_header_t *header, apr_pool_t *pool);
 
+/**
+ * Parse MRCP header fields in the lazy mode.
+ * @param header the header to parse
+ * @param pool the pool to allocate memory from
+ * @remark Only the ids of the header fields are resolved, while the values are
+ *         parsed on the first property check or header access.
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_header_fields_lazy_parse(mrcp_message_header_t *header, apr_pool_t *pool);
+
+/** Parse the pending value of MRCP header field (lazy mode) by id */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_resolve(mrcp_message_header_t *header, apr_size_t id);
+
+/** Parse the pending values of MRCP header fields (lazy mode) having ids in the range [begin, end) */
+MRCP_DECLARE(void) mrcp_header_fields_resolve(mrcp_message_header_t *header, apr_size_t begin, apr_size_t end);
+
 
 /** Initialize MRCP channel-identifier */
 MRCP_DECLARE(void) mrcp_channel_id_init(mrcp_channel_id *channel_id);
@@ -51,8 +51,54 @@ struct mrcp_header_vtable_t {
 	const apt_str_table_item_t *field_table;
 	/** Number of fields  */
 	apr_size_t                  field_count;
+	/** Perfect hash index of fields (optional) */
+	const apt_str_table_index_t *field_index;
 };
 
+/** MRCP header field descriptor declaration */
+typedef struct mrcp_header_field_desc_t mrcp_header_field_desc_t;
+
+/**
+ * Descriptor of the typed member of header data a header field is stored in.
+ * @remark Resources define a static table of descriptors indexed by header field id,
+ * so that a header field is parsed, generated and duplicated without switching on its id.
+ */
+struct mrcp_header_field_desc_t {
+	/** Parse header field value into the member, NULL if the field is handled by the resource itself */
+	void (*parse)(void *member, const apt_str_t *value, apr_pool_t *pool);
+	/** Generate header field value of the member, NULL if the field is handled by the resource itself */
+	void (*generate)(const void *member, apt_str_t *value, apr_pool_t *pool);
+	/** Offset of the member in header data */
+	apr_size_t offset;
+	/** Size of the member copied on duplication, 0 for a string, which refers to the duplicated value */
+	apr_size_t size;
+};
+
+/** Size of the member of a struct */
+#define MRCP_HEADER_MEMBER_SIZE(type,member) sizeof(((type*)0)->member)
+
+/** Descriptor of an apr_size_t member */
+#define MRCP_HEADER_FIELD_SIZE(type,member) \
+	{mrcp_header_size_member_parse, mrcp_header_size_member_generate, APR_OFFSETOF(type,member), sizeof(apr_size_t)}
+/** Descriptor of an apt_bool_t member */
+#define MRCP_HEADER_FIELD_BOOLEAN(type,member) \
+	{mrcp_header_boolean_member_parse, mrcp_header_boolean_member_generate, APR_OFFSETOF(type,member), sizeof(apt_bool_t)}
+/** Descriptor of a float member */
+#define MRCP_HEADER_FIELD_FLOAT(type,member) \
+	{mrcp_header_float_member_parse, mrcp_header_float_member_generate, APR_OFFSETOF(type,member), sizeof(float)}
+/** Descriptor of a char member */
+#define MRCP_HEADER_FIELD_CHAR(type,member) \
+	{mrcp_header_char_member_parse, mrcp_header_char_member_generate, APR_OFFSETOF(type,member), sizeof(char)}
+/** Descriptor of an apt_str_t member */
+#define MRCP_HEADER_FIELD_STRING(type,member) \
+	{mrcp_header_string_member_parse, mrcp_header_string_member_generate, APR_OFFSETOF(type,member), 0}
+/** Descriptor of a member of a resource specific type */
+#define MRCP_HEADER_FIELD_TYPED(type,member,parse,generate) \
+	{parse, generate, APR_OFFSETOF(type,member), MRCP_HEADER_MEMBER_SIZE(type,member)}
+/** Descriptor of a member parsed and generated by the resource itself, but duplicated as is */
+#define MRCP_HEADER_FIELD_CUSTOM(type,member) \
+	{NULL, NULL, APR_OFFSETOF(type,member), MRCP_HEADER_MEMBER_SIZE(type,member)}
+
 /** MRCP header accessor */
 struct mrcp_header_accessor_t {
 	/** Actual header data allocated by accessor */
@@ -73,6 +119,7 @@ static APR_INLINE void mrcp_header_vtable_init(mrcp_header_vtable_t *vtable)
 	vtable->duplicate_field = NULL;
 	vtable->field_table = NULL;
 	vtable->field_count = 0;
+	vtable->field_index = NULL;
 }
 
 /** Validate header vtable */
@@ -117,6 +164,12 @@ static APR_INLINE void mrcp_header_destroy(mrcp_header_accessor_t *accessor)
 /** Parse header field value */
 MRCP_DECLARE(apt_bool_t) mrcp_header_field_value_parse(mrcp_header_accessor_t *accessor, apt_header_field_t *header_field, apr_pool_t *pool);
 
+/** Find the id of header field by its name, leaving the value unparsed */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_id_find(const mrcp_header_accessor_t *accessor, apt_header_field_t *header_field);
+
+/** Parse header field value by the id found before */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_value_resolve(mrcp_header_accessor_t *accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool);
+
 /** Generate header field value */
 MRCP_DECLARE(apt_header_field_t*) mrcp_header_field_value_generate(const mrcp_header_accessor_t *accessor, apr_size_t id, apt_bool_t empty_value, apr_pool_t *pool);
 
@@ -124,6 +177,46 @@ MRCP_DECLARE(apt_header_field_t*) mrcp_header_field_value_generate(const mrcp_he
 MRCP_DECLARE(apt_bool_t) mrcp_header_field_value_duplicate(mrcp_header_accessor_t *accessor, const mrcp_header_accessor_t *src_accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool);
 
 
+/**
+ * Parse header field value by the descriptor table of the resource.
+ * @param table the descriptors indexed by header field id
+ * @param count the number of descriptors
+ * @param data the header data to parse into
+ * @param id the id of the header field
+ * @param value the value to parse
+ * @param pool the pool to allocate memory from
+ * @return FALSE if the header field has no descriptor or is handled by the resource itself
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_desc_parse(const mrcp_header_field_desc_t *table, apr_size_t count, void *data, apr_size_t id, const apt_str_t *value, apr_pool_t *pool);
+
+/** Generate header field value by the descriptor table of the resource */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_desc_generate(const mrcp_header_field_desc_t *table, apr_size_t count, const void *data, apr_size_t id, apt_str_t *value, apr_pool_t *pool);
+
+/** Duplicate header field value by the descriptor table of the resource */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_desc_duplicate(const mrcp_header_field_desc_t *table, apr_size_t count, void *data, const void *src_data, apr_size_t id, const apt_str_t *value);
+
+/** Parse apr_size_t member */
+MRCP_DECLARE(void) mrcp_header_size_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool);
+/** Generate apr_size_t member */
+MRCP_DECLARE(void) mrcp_header_size_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool);
+/** Parse apt_bool_t member */
+MRCP_DECLARE(void) mrcp_header_boolean_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool);
+/** Generate apt_bool_t member */
+MRCP_DECLARE(void) mrcp_header_boolean_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool);
+/** Parse float member */
+MRCP_DECLARE(void) mrcp_header_float_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool);
+/** Generate float member */
+MRCP_DECLARE(void) mrcp_header_float_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool);
+/** Parse char member */
+MRCP_DECLARE(void) mrcp_header_char_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool);
+/** Generate char member */
+MRCP_DECLARE(void) mrcp_header_char_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool);
+/** Parse apt_str_t member, referring to the value */
+MRCP_DECLARE(void) mrcp_header_string_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool);
+/** Generate apt_str_t member, referring to the member */
+MRCP_DECLARE(void) mrcp_header_string_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool);
+
+
 APT_END_EXTERN_C
 
 #endif /* MRCP_HEADER_ACCESSOR_H */
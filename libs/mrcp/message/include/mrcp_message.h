@@ -43,11 +43,15 @@ struct mrcp_message_t {
 	mrcp_message_header_t  header;
 	/** Body of MRCP message */
 	apt_str_t              body;
+	/** Id of the interned body, the same for byte-identical bodies (0 if not interned, see mrcp_body_store.h) */
+	apr_uint32_t           body_id;
 
 	/** Associated MRCP resource */
 	const mrcp_resource_t *resource;
 	/** Memory pool to allocate memory from */
 	apr_pool_t            *pool;
+	/** Trace of the request, shared with its response and events (NULL if not traced) */
+	mrcp_message_trace_t  *trace;
 };
 
 /**
@@ -113,6 +117,10 @@ MRCP_DECLARE(void) mrcp_message_destroy(mrcp_message_t *message);
  */
 static APR_INLINE mrcp_generic_header_t* mrcp_generic_header_get(const mrcp_message_t *message)
 {
+	if(message->header.pending_count) {
+		/* lazy mode: the pending values are parsed on the first access */
+		mrcp_header_fields_resolve((mrcp_message_header_t*)&message->header,0,GENERIC_HEADER_COUNT);
+	}
 	return (mrcp_generic_header_t*) message->header.generic_header_accessor.data;
 }
 
@@ -122,6 +130,9 @@ static APR_INLINE mrcp_generic_header_t* mrcp_generic_header_get(const mrcp_mess
  */
 static APR_INLINE mrcp_generic_header_t* mrcp_generic_header_prepare(mrcp_message_t *message)
 {
+	if(message->header.pending_count) {
+		mrcp_header_fields_resolve(&message->header,0,GENERIC_HEADER_COUNT);
+	}
 	return (mrcp_generic_header_t*) mrcp_header_allocate(&message->header.generic_header_accessor,message->pool);
 }
 
@@ -161,6 +172,10 @@ static APR_INLINE apt_bool_t mrcp_generic_header_property_remove(mrcp_message_t
  */
 static APR_INLINE apt_bool_t mrcp_generic_header_property_check(const mrcp_message_t *message, apr_size_t id)
 {
+	if(message->header.pending_count) {
+		/* lazy mode: the pending value is parsed on the first check */
+		mrcp_header_field_resolve((mrcp_message_header_t*)&message->header,id);
+	}
 	return apt_header_section_field_check(&message->header.header_section,id);
 }
 
@@ -171,6 +186,10 @@ static APR_INLINE apt_bool_t mrcp_generic_header_property_check(const mrcp_messa
  */
 static APR_INLINE void* mrcp_resource_header_get(const mrcp_message_t *message)
 {
+	if(message->header.pending_count) {
+		/* lazy mode: the pending values are parsed on the first access */
+		mrcp_header_fields_resolve((mrcp_message_header_t*)&message->header,GENERIC_HEADER_COUNT,message->header.header_section.arr_size);
+	}
 	return message->header.resource_header_accessor.data;
 }
 
@@ -180,6 +199,9 @@ static APR_INLINE void* mrcp_resource_header_get(const mrcp_message_t *message)
  */
 static APR_INLINE void* mrcp_resource_header_prepare(mrcp_message_t *mrcp_message)
 {
+	if(mrcp_message->header.pending_count) {
+		mrcp_header_fields_resolve(&mrcp_message->header,GENERIC_HEADER_COUNT,mrcp_message->header.header_section.arr_size);
+	}
 	return mrcp_header_allocate(&mrcp_message->header.resource_header_accessor,mrcp_message->pool);
 }
 
@@ -219,6 +241,10 @@ static APR_INLINE apt_bool_t mrcp_resource_header_property_remove(mrcp_message_t
  */
 static APR_INLINE apt_bool_t mrcp_resource_header_property_check(const mrcp_message_t *message, apr_size_t id)
 {
+	if(message->header.pending_count) {
+		/* lazy mode: the pending value is parsed on the first check */
+		mrcp_header_field_resolve((mrcp_message_header_t*)&message->header,id + GENERIC_HEADER_COUNT);
+	}
 	return apt_header_section_field_check(&message->header.header_section,id + GENERIC_HEADER_COUNT);
 }
 
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_MESSAGE_ARENA_H
+#define MRCP_MESSAGE_ARENA_H
+
+/**
+ * @file mrcp_message_arena.h
+ * @brief Recyclable Per-Message Memory Arenas
+ */
+
+#include "mrcp_message.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max number of released arenas kept for reuse per thread */
+#define MRCP_MESSAGE_ARENA_CACHE_SIZE    32
+/** Default max size of the body of a message whose arena is reused */
+#define MRCP_MESSAGE_ARENA_MAX_BODY_SIZE (16 * 1024)
+
+/** Statistics of the arena cache of a thread */
+typedef struct mrcp_message_arena_stats_t mrcp_message_arena_stats_t;
+
+/** Statistics of the arena cache of a thread */
+struct mrcp_message_arena_stats_t {
+	/** Number of arenas acquired */
+	apr_size_t acquired;
+	/** Number of arenas taken from the cache (hits) */
+	apr_size_t reused;
+	/** Number of arenas released */
+	apr_size_t released;
+	/** Number of released arenas destroyed instead of being cached (large body or full cache) */
+	apr_size_t discarded;
+	/** Number of arenas currently cached */
+	apr_size_t cached;
+};
+
+/**
+ * Create an MRCP message in its own arena.
+ * @remark The arena is taken from the cache of the calling thread, if available.
+ *         The message must be released by mrcp_message_arena_release() once it is
+ *         no longer referenced, and anything allocated from message->pool goes with it.
+ */
+MRCP_DECLARE(mrcp_message_t*) mrcp_message_arena_create(void);
+
+/**
+ * Release an MRCP message created by mrcp_message_arena_create().
+ * @param message the message to release
+ * @remark The arena is reset and cached by the calling thread, unless the body of
+ *         the message exceeds the max body size, in which case it is destroyed.
+ */
+MRCP_DECLARE(void) mrcp_message_arena_release(mrcp_message_t *message);
+
+/**
+ * Set the max size of the body of a message whose arena is reused.
+ * @param size the max body size (0 - never reuse arenas)
+ * @remark Arenas of larger messages hold the blocks taken for the body, so they are destroyed.
+ */
+MRCP_DECLARE(void) mrcp_message_arena_max_body_set(apr_size_t size);
+
+/**
+ * Get statistics of the arena cache of the calling thread.
+ * @param stats the statistics to fill
+ */
+MRCP_DECLARE(void) mrcp_message_arena_stats_get(mrcp_message_arena_stats_t *stats);
+
+/**
+ * Destroy the arenas cached by the calling thread.
+ * @remark To be called by a task before its thread exits.
+ */
+MRCP_DECLARE(void) mrcp_message_arena_cache_clear(void);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_MESSAGE_ARENA_H */
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MRCP_MESSAGE_TRACE_H
+#define MRCP_MESSAGE_TRACE_H
+
+/**
+ * @file mrcp_message_trace.h
+ * @brief Per-Request Latency Tracing
+ *
+ * A trace is attached to a request when it is received and is shared with
+ * the response and the events created for the request. Each point of the
+ * path of the request is stamped once by a monotonic clock, and one record
+ * is emitted as soon as the message completing the request is sent.
+ */
+
+#include "mrcp_message.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Points of the path of a request */
+typedef enum {
+	MRCP_TRACE_POINT_RECEIVED,       /**< request is received by the connection agent */
+	MRCP_TRACE_POINT_DISPATCHED,     /**< request is dispatched to the engine channel */
+	MRCP_TRACE_POINT_PROCESSED,      /**< request is processed by the engine */
+	MRCP_TRACE_POINT_FIRST_AUDIO,    /**< first audio frame is taken for the request */
+	MRCP_TRACE_POINT_INPUT_STARTED,  /**< start of input is detected */
+	MRCP_TRACE_POINT_RESPONSE_SENT,  /**< response is sent to the client */
+	MRCP_TRACE_POINT_COMPLETE_SENT,  /**< message completing the request is sent to the client */
+
+	MRCP_TRACE_POINT_COUNT           /**< number of trace points */
+} mrcp_trace_point_e;
+
+/** Trace of a request */
+struct mrcp_message_trace_t {
+	/** Method name of the request */
+	apt_str_t    method_name;
+	/** Timestamps (usec, monotonic) of the trace points, 0 if not reached */
+	apr_int64_t  stamps[MRCP_TRACE_POINT_COUNT];
+	/** Whether the record is already emitted */
+	apt_bool_t   emitted;
+};
+
+/**
+ * Handler of trace records.
+ * @param message the message completing the request
+ * @param trace the trace of the request
+ */
+typedef void (*mrcp_message_trace_handler_f)(const mrcp_message_t *message, const mrcp_message_trace_t *trace);
+
+/**
+ * Enable or disable tracing of requests.
+ * @param enable whether to trace requests received from now on
+ */
+MRCP_DECLARE(void) mrcp_message_trace_enable(apt_bool_t enable);
+
+/**
+ * Set the handler of trace records.
+ * @param handler the handler to export records with (NULL - log records)
+ */
+MRCP_DECLARE(void) mrcp_message_trace_handler_set(mrcp_message_trace_handler_f handler);
+
+/**
+ * Start the trace of a received request.
+ * @param request the request to trace
+ * @remark Nothing is done if tracing is disabled or the request is already traced.
+ */
+MRCP_DECLARE(void) mrcp_message_trace_start(mrcp_message_t *request);
+
+/**
+ * Stamp a trace point of the request the message belongs to.
+ * @param message the request or a response or an event of the request
+ * @param point the point to stamp
+ * @remark Only the first stamp of a point is kept.
+ */
+MRCP_DECLARE(void) mrcp_message_trace_stamp(const mrcp_message_t *message, mrcp_trace_point_e point);
+
+/**
+ * Stamp the message as sent and emit the record, if it completes the request.
+ * @param message the response or the event sent to the client
+ */
+MRCP_DECLARE(void) mrcp_message_trace_sent(const mrcp_message_t *message);
+
+/**
+ * Get the name of a trace point.
+ * @param point the point to get the name of
+ */
+MRCP_DECLARE(const char*) mrcp_message_trace_point_name_get(mrcp_trace_point_e point);
+
+APT_END_EXTERN_C
+
+#endif /* MRCP_MESSAGE_TRACE_H */
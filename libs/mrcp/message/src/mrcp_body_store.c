@@ -0,0 +1,162 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_hash.h>
+#include <apr_atomic.h>
+#include <apr_thread_mutex.h>
+#include "mrcp_body_store.h"
+
+/** Interned body */
+typedef struct mrcp_body_entry_t mrcp_body_entry_t;
+
+struct mrcp_body_entry_t {
+	/** The store the body is held by */
+	mrcp_body_store_t *store;
+	/** Id of the body, unique across the stores of the process (but on wrap-around) */
+	apr_uint32_t       id;
+	/** Number of messages referencing the body (guarded) */
+	apr_size_t         ref_count;
+	/** Length of the body, which follows the entry in the same block */
+	apr_size_t         length;
+};
+
+/** Store of interned bodies */
+struct mrcp_body_store_t {
+	/** Table of entries by body */
+	apr_hash_t         *table;
+	/** Min size of the body to intern */
+	apr_size_t          min_size;
+	/** Max size of the body to intern */
+	apr_size_t          max_size;
+	/** Statistics */
+	mrcp_body_store_stats_t stats;
+	/** Guards the table, bodies are interned and released by any thread */
+	apr_thread_mutex_t *mutex;
+};
+
+/** Id of the body interned last by any store, so that the stores of different agents never assign the same id */
+static volatile apr_uint32_t body_last_id = 0;
+
+/** Get the body of the entry */
+#define MRCP_BODY_ENTRY_BUF(entry) ((char*)(entry) + sizeof(mrcp_body_entry_t))
+
+/** Release the body referenced by a message, once its pool is cleared */
+static apr_status_t mrcp_body_entry_cleanup(void *obj)
+{
+	mrcp_body_entry_t *entry = obj;
+	mrcp_body_store_t *store = entry->store;
+	apr_thread_mutex_lock(store->mutex);
+	if(--entry->ref_count == 0) {
+		apr_hash_set(store->table,MRCP_BODY_ENTRY_BUF(entry),entry->length,NULL);
+		store->stats.count--;
+		store->stats.size -= entry->length;
+		free(entry);
+	}
+	apr_thread_mutex_unlock(store->mutex);
+	return APR_SUCCESS;
+}
+
+/** Free the bodies left, the messages referencing them must be gone by now */
+static apr_status_t mrcp_body_store_cleanup(void *obj)
+{
+	mrcp_body_store_t *store = obj;
+	apr_hash_index_t *it;
+	void *val;
+	for(it = apr_hash_first(NULL,store->table); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		free(val);
+	}
+	apr_hash_clear(store->table);
+	apr_thread_mutex_destroy(store->mutex);
+	return APR_SUCCESS;
+}
+
+MRCP_DECLARE(mrcp_body_store_t*) mrcp_body_store_create(apr_size_t min_size, apr_size_t max_size, apr_pool_t *pool)
+{
+	mrcp_body_store_t *store = apr_palloc(pool,sizeof(mrcp_body_store_t));
+	store->table = apr_hash_make(pool);
+	store->min_size = min_size ? min_size : 1;
+	store->max_size = max_size;
+	store->stats.count = 0;
+	store->stats.size = 0;
+	store->stats.hits = 0;
+	store->stats.misses = 0;
+	if(apr_thread_mutex_create(&store->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	apr_pool_cleanup_register(pool,store,mrcp_body_store_cleanup,apr_pool_cleanup_null);
+	return store;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_body_store_check(const mrcp_body_store_t *store, apr_size_t length)
+{
+	return (length >= store->min_size && length <= store->max_size) ? TRUE : FALSE;
+}
+
+MRCP_DECLARE(apt_bool_t) mrcp_body_store_intern(mrcp_body_store_t *store, mrcp_message_t *message, const apt_str_t *body)
+{
+	mrcp_body_entry_t *entry;
+	char *buf;
+	if(!body->buf || !body->length) {
+		return FALSE;
+	}
+
+	apr_thread_mutex_lock(store->mutex);
+	entry = apr_hash_get(store->table,body->buf,body->length);
+	if(entry) {
+		store->stats.hits++;
+	}
+	else {
+		/* the body follows the entry, so that an interned body takes a single block */
+		entry = malloc(sizeof(mrcp_body_entry_t) + body->length + 1);
+		if(!entry) {
+			apr_thread_mutex_unlock(store->mutex);
+			return FALSE;
+		}
+		buf = MRCP_BODY_ENTRY_BUF(entry);
+		memcpy(buf,body->buf,body->length);
+		buf[body->length] = '\0';
+		entry->store = store;
+		entry->length = body->length;
+		entry->ref_count = 0;
+		entry->id = apr_atomic_inc32(&body_last_id) + 1;
+		if(entry->id == 0) {
+			/* 0 stands for a body not interned */
+			entry->id = apr_atomic_inc32(&body_last_id) + 1;
+		}
+		apr_hash_set(store->table,buf,entry->length,entry);
+		store->stats.count++;
+		store->stats.size += entry->length;
+		store->stats.misses++;
+	}
+	entry->ref_count++;
+	apr_thread_mutex_unlock(store->mutex);
+
+	message->body.buf = MRCP_BODY_ENTRY_BUF(entry);
+	message->body.length = entry->length;
+	message->body_id = entry->id;
+	apr_pool_cleanup_register(message->pool,entry,mrcp_body_entry_cleanup,apr_pool_cleanup_null);
+	return TRUE;
+}
+
+MRCP_DECLARE(void) mrcp_body_store_stats_get(mrcp_body_store_t *store, mrcp_body_store_stats_t *stats)
+{
+	apr_thread_mutex_lock(store->mutex);
+	*stats = store->stats;
+	apr_thread_mutex_unlock(store->mutex);
+}
@@ -37,6 +37,11 @@ static const apt_str_table_item_t generic_header_string_table[] = {
 	{{"Set-Cookie2",               11},10}
 };
 
+/** Perfect hash index of mrcp generic-header fields (generated by strtablegen) */
+static const apr_int32_t generic_header_string_buckets[] = {1,0,-3,-1,0,3,0,-4,0,0,1,12,3,0,-7,-13};
+static const apr_size_t generic_header_string_ids[] = {2,12,6,7,13,3,9,4,0,11,5,10,15,14,1,8};
+static const apt_str_table_index_t generic_header_string_index = {generic_header_string_buckets,generic_header_string_ids};
+
 /** Parse mrcp request-id list */
 static apt_bool_t mrcp_request_id_list_parse(mrcp_request_id_list_t *request_id_list, const apt_str_t *value)
 {
@@ -315,7 +320,8 @@ static const mrcp_header_vtable_t vtable = {
 	mrcp_generic_header_generate,
 	mrcp_generic_header_duplicate,
 	generic_header_string_table,
-	GENERIC_HEADER_COUNT
+	GENERIC_HEADER_COUNT,
+	&generic_header_string_index
 };
 
 
@@ -40,6 +40,10 @@ MRCP_DECLARE(apt_bool_t) mrcp_message_header_data_alloc(
 	header->resource_header_accessor.data = NULL;
 	header->resource_header_accessor.vtable = resource_header_vtable;
 
+	header->pending_fields = NULL;
+	header->pending_count = 0;
+	header->pending_pool = NULL;
+
 	apt_header_section_array_alloc(
 		&header->header_section,
 		header->generic_header_accessor.vtable->field_count +
@@ -58,6 +62,9 @@ MRCP_DECLARE(mrcp_message_header_t*) mrcp_message_header_create(
 {
 	mrcp_message_header_t *header = apr_palloc(pool,sizeof(mrcp_message_header_t));
 	apt_header_section_init(&header->header_section);
+	header->pending_fields = NULL;
+	header->pending_count = 0;
+	header->pending_pool = NULL;
 	mrcp_message_header_data_alloc(header,generic_header_vtable,resource_header_vtable,pool);
 	return header;
 }
@@ -104,6 +111,86 @@ MRCP_DECLARE(apt_bool_t) mrcp_header_fields_parse(mrcp_message_header_t *header,
 	return TRUE;
 }
 
+/** Resolve the ids of MRCP header fields, leaving the values to be parsed on the first access */
+MRCP_DECLARE(apt_bool_t) mrcp_header_fields_lazy_parse(mrcp_message_header_t *header, apr_pool_t *pool)
+{
+	apt_header_field_t *header_field;
+	header->pending_fields = apr_pcalloc(pool,header->header_section.arr_size);
+	header->pending_count = 0;
+	header->pending_pool = pool;
+	for(header_field = APR_RING_FIRST(&header->header_section.ring);
+			header_field != APR_RING_SENTINEL(&header->header_section.ring, apt_header_field_t, link);
+				header_field = APR_RING_NEXT(header_field, link)) {
+
+		if(mrcp_header_field_id_find(&header->resource_header_accessor,header_field) == TRUE) {
+			header_field->id += GENERIC_HEADER_COUNT;
+		}
+		else if(mrcp_header_field_id_find(&header->generic_header_accessor,header_field) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown MRCP header field: %s",header_field->name.buf);
+			continue;
+		}
+
+		if(apt_header_section_field_set(&header->header_section,header_field) == TRUE) {
+			header->pending_fields[header_field->id] = TRUE;
+			header->pending_count++;
+		}
+	}
+
+	return TRUE;
+}
+
+/** Parse the pending value of MRCP header field (lazy mode) by id */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_resolve(mrcp_message_header_t *header, apr_size_t id)
+{
+	apt_header_field_t *header_field;
+	apt_bool_t status;
+	if(!header->pending_count || id >= header->header_section.arr_size || !header->pending_fields[id]) {
+		/* nothing pending */
+		return TRUE;
+	}
+
+	header->pending_fields[id] = FALSE;
+	header->pending_count--;
+	header_field = header->header_section.arr[id];
+	if(!header_field) {
+		/* removed before being parsed */
+		return FALSE;
+	}
+	if(id < GENERIC_HEADER_COUNT) {
+		status = mrcp_header_field_value_resolve(
+			&header->generic_header_accessor,
+			id,
+			&header_field->value,
+			header->pending_pool);
+	}
+	else {
+		status = mrcp_header_field_value_resolve(
+			&header->resource_header_accessor,
+			id - GENERIC_HEADER_COUNT,
+			&header_field->value,
+			header->pending_pool);
+	}
+
+	if(status == FALSE) {
+		/* as in the regular mode, the field stays in the section, but it cannot be checked */
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse MRCP header field: %s",header_field->name.buf);
+		header->header_section.arr[id] = NULL;
+	}
+	return status;
+}
+
+/** Parse the pending values of MRCP header fields (lazy mode) having ids in the range [begin, end) */
+MRCP_DECLARE(void) mrcp_header_fields_resolve(mrcp_message_header_t *header, apr_size_t begin, apr_size_t end)
+{
+	apr_size_t id;
+	if(end > header->header_section.arr_size) {
+		end = header->header_section.arr_size;
+	}
+	for(id = begin; id < end && header->pending_count; id++) {
+		mrcp_header_field_resolve(header,id);
+	}
+}
+
 static apt_bool_t mrcp_header_accessor_value_duplicate(mrcp_message_header_t *header, apt_header_field_t *header_field,
 											  const mrcp_message_header_t *src_header, const apt_header_field_t *src_header_field, 
 											  apr_pool_t *pool)
@@ -133,6 +220,9 @@ MRCP_DECLARE(apt_bool_t) mrcp_header_fields_set(mrcp_message_header_t *header, c
 {
 	apt_header_field_t *header_field;
 	const apt_header_field_t *src_header_field;
+	/* the values are duplicated from the parsed data, which must be complete in both headers */
+	mrcp_header_fields_resolve(header,0,header->header_section.arr_size);
+	mrcp_header_fields_resolve((mrcp_message_header_t*)src_header,0,src_header->header_section.arr_size);
 	for(src_header_field = APR_RING_FIRST(&src_header->header_section.ring);
 			src_header_field != APR_RING_SENTINEL(&src_header->header_section.ring, apt_header_field_t, link);
 				src_header_field = APR_RING_NEXT(src_header_field, link)) {
@@ -160,6 +250,9 @@ MRCP_DECLARE(apt_bool_t) mrcp_header_fields_get(mrcp_message_header_t *header, c
 	apt_header_field_t *header_field;
 	const apt_header_field_t *src_header_field;
 	const apt_header_field_t *mask_header_field;
+	/* the values are duplicated from the parsed data, which must be complete in both headers */
+	mrcp_header_fields_resolve(header,0,header->header_section.arr_size);
+	mrcp_header_fields_resolve((mrcp_message_header_t*)src_header,0,src_header->header_section.arr_size);
 	for(mask_header_field = APR_RING_FIRST(&mask_header->header_section.ring);
 			mask_header_field != APR_RING_SENTINEL(&mask_header->header_section.ring, apt_header_field_t, link);
 				mask_header_field = APR_RING_NEXT(mask_header_field, link)) {
@@ -192,6 +285,9 @@ MRCP_DECLARE(apt_bool_t) mrcp_header_fields_inherit(mrcp_message_header_t *heade
 {
 	apt_header_field_t *header_field;
 	const apt_header_field_t *src_header_field;
+	/* the values are duplicated from the parsed data, which must be complete in both headers */
+	mrcp_header_fields_resolve(header,0,header->header_section.arr_size);
+	mrcp_header_fields_resolve((mrcp_message_header_t*)src_header,0,src_header->header_section.arr_size);
 	for(src_header_field = APR_RING_FIRST(&src_header->header_section.ring);
 			src_header_field != APR_RING_SENTINEL(&src_header->header_section.ring, apt_header_field_t, link);
 				src_header_field = APR_RING_NEXT(src_header_field, link)) {
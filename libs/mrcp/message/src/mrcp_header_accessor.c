@@ -19,20 +19,45 @@
 
 /** Parse header field value */
 MRCP_DECLARE(apt_bool_t) mrcp_header_field_value_parse(mrcp_header_accessor_t *accessor, apt_header_field_t *header_field, apr_pool_t *pool)
+{
+	if(mrcp_header_field_id_find(accessor,header_field) == FALSE) {
+		return FALSE;
+	}
+
+	return mrcp_header_field_value_resolve(accessor,header_field->id,&header_field->value,pool);
+}
+
+/** Find the id of header field by its name, leaving the value unparsed */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_id_find(const mrcp_header_accessor_t *accessor, apt_header_field_t *header_field)
 {
 	apr_size_t id;
+	const apt_str_t *name;
 	if(!accessor->vtable) {
 		return FALSE;
 	}
 
-	id = apt_string_table_id_find(accessor->vtable->field_table,accessor->vtable->field_count,&header_field->name);
+	id = apt_string_table_index_find(accessor->vtable->field_table,accessor->vtable->field_count,accessor->vtable->field_index,&header_field->name);
 	if(id >= accessor->vtable->field_count) {
 		return FALSE;
 	}
+	/* refer to the interned name instead of the parsed one */
+	name = apt_string_table_str_get(accessor->vtable->field_table,accessor->vtable->field_count,id);
+	if(name) {
+		header_field->name = *name;
+	}
 	header_field->id = id;
+	return TRUE;
+}
+
+/** Parse header field value by the id found before */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_value_resolve(mrcp_header_accessor_t *accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
+{
+	if(!accessor->vtable) {
+		return FALSE;
+	}
 
-	if(header_field->value.length) {
-		if(accessor->vtable->parse_field(accessor,header_field->id,&header_field->value,pool) == FALSE) {
+	if(value->length) {
+		if(accessor->vtable->parse_field(accessor,id,value,pool) == FALSE) {
 			return FALSE;
 		}
 	}
@@ -80,3 +105,98 @@ MRCP_DECLARE(apt_bool_t) mrcp_header_field_value_duplicate(mrcp_header_accessor_
 
 	return TRUE;
 }
+
+
+/** Parse header field value by the descriptor table of the resource */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_desc_parse(const mrcp_header_field_desc_t *table, apr_size_t count, void *data, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
+{
+	const mrcp_header_field_desc_t *desc;
+	if(id >= count || !table[id].parse) {
+		return FALSE;
+	}
+	desc = &table[id];
+	desc->parse((char*)data + desc->offset,value,pool);
+	return TRUE;
+}
+
+/** Generate header field value by the descriptor table of the resource */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_desc_generate(const mrcp_header_field_desc_t *table, apr_size_t count, const void *data, apr_size_t id, apt_str_t *value, apr_pool_t *pool)
+{
+	const mrcp_header_field_desc_t *desc;
+	if(id >= count || !table[id].generate) {
+		return FALSE;
+	}
+	desc = &table[id];
+	desc->generate((const char*)data + desc->offset,value,pool);
+	return TRUE;
+}
+
+/** Duplicate header field value by the descriptor table of the resource */
+MRCP_DECLARE(apt_bool_t) mrcp_header_field_desc_duplicate(const mrcp_header_field_desc_t *table, apr_size_t count, void *data, const void *src_data, apr_size_t id, const apt_str_t *value)
+{
+	const mrcp_header_field_desc_t *desc;
+	if(id >= count) {
+		return FALSE;
+	}
+	desc = &table[id];
+	if(!desc->size) {
+		/* the value has already been duplicated */
+		*(apt_str_t*)((char*)data + desc->offset) = *value;
+	}
+	else {
+		memcpy((char*)data + desc->offset,(const char*)src_data + desc->offset,desc->size);
+	}
+	return TRUE;
+}
+
+MRCP_DECLARE(void) mrcp_header_size_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	*(apr_size_t*)member = apt_size_value_parse(value);
+}
+
+MRCP_DECLARE(void) mrcp_header_size_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	apt_size_value_generate(*(const apr_size_t*)member,value,pool);
+}
+
+MRCP_DECLARE(void) mrcp_header_boolean_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	apt_boolean_value_parse(value,(apt_bool_t*)member);
+}
+
+MRCP_DECLARE(void) mrcp_header_boolean_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	apt_boolean_value_generate(*(const apt_bool_t*)member,value,pool);
+}
+
+MRCP_DECLARE(void) mrcp_header_float_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	*(float*)member = apt_float_value_parse(value);
+}
+
+MRCP_DECLARE(void) mrcp_header_float_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	apt_float_value_generate(*(const float*)member,value,pool);
+}
+
+MRCP_DECLARE(void) mrcp_header_char_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	*(char*)member = *value->buf;
+}
+
+MRCP_DECLARE(void) mrcp_header_char_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	value->length = 1;
+	value->buf = apr_palloc(pool,value->length);
+	*value->buf = *(const char*)member;
+}
+
+MRCP_DECLARE(void) mrcp_header_string_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	*(apt_str_t*)member = *value;
+}
+
+MRCP_DECLARE(void) mrcp_header_string_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	*value = *(const apt_str_t*)member;
+}
@@ -74,18 +74,20 @@ MRCP_DECLARE(apt_bool_t) mrcp_message_resource_set(mrcp_message_t *message, cons
 	
 	/* associate method_name and method_id */
 	if(message->start_line.message_type == MRCP_MESSAGE_TYPE_REQUEST) {
-		message->start_line.method_id = apt_string_table_id_find(
+		message->start_line.method_id = apt_string_table_index_find(
 			resource->get_method_str_table(message->start_line.version),
 			resource->method_count,
+			resource->get_method_str_index ? resource->get_method_str_index(message->start_line.version) : NULL,
 			&message->start_line.method_name);
 		if(message->start_line.method_id >= resource->method_count) {
 			return FALSE;
 		}
 	}
 	else if(message->start_line.message_type == MRCP_MESSAGE_TYPE_EVENT) {
-		message->start_line.method_id = apt_string_table_id_find(
+		message->start_line.method_id = apt_string_table_index_find(
 			resource->get_event_str_table(message->start_line.version),
 			resource->event_count,
+			resource->get_event_str_index ? resource->get_event_str_index(message->start_line.version) : NULL,
 			&message->start_line.method_name);
 		if(message->start_line.method_id >= resource->event_count) {
 			return FALSE;
@@ -103,8 +105,10 @@ MRCP_DECLARE(mrcp_message_t*) mrcp_message_create(apr_pool_t *pool)
 	mrcp_channel_id_init(&message->channel_id);
 	mrcp_message_header_init(&message->header);
 	apt_string_reset(&message->body);
+	message->body_id = 0;
 	message->resource = NULL;
 	message->pool = pool;
+	message->trace = NULL;
 	return message;
 }
 
@@ -133,6 +137,7 @@ MRCP_DECLARE(mrcp_message_t*) mrcp_response_create(const mrcp_message_t *request
 		response_message->start_line.method_id = request_message->start_line.method_id;
 		response_message->start_line.method_name = request_message->start_line.method_name;
 		mrcp_message_resource_set_by_id(response_message,request_message->resource);
+		response_message->trace = request_message->trace;
 	}
 	return response_message;
 }
@@ -148,6 +153,7 @@ MRCP_DECLARE(mrcp_message_t*) mrcp_event_create(const mrcp_message_t *request_me
 		event_message->start_line.request_id = request_message->start_line.request_id;
 		event_message->start_line.version = request_message->start_line.version;
 		mrcp_message_resource_set_by_id(event_message,request_message->resource);
+		event_message->trace = request_message->trace;
 	}
 	return event_message;
 }
@@ -156,6 +162,7 @@ MRCP_DECLARE(mrcp_message_t*) mrcp_event_create(const mrcp_message_t *request_me
 MRCP_DECLARE(void) mrcp_message_destroy(mrcp_message_t *message)
 {
 	apt_string_reset(&message->body);
+	message->body_id = 0;
 	mrcp_message_header_destroy(&message->header);
 }
 
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_allocator.h>
+#include "mrcp_message_arena.h"
+
+/** Max memory an arena keeps in its allocator after reset */
+#define MRCP_MESSAGE_ARENA_MAX_FREE (32 * 1024)
+
+#if defined(_MSC_VER)
+#define MRCP_ARENA_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+#define MRCP_ARENA_THREAD_LOCAL __thread
+#endif
+
+/** Arena cache of a thread */
+typedef struct mrcp_message_arena_cache_t mrcp_message_arena_cache_t;
+
+struct mrcp_message_arena_cache_t {
+	/** Reset arenas available for reuse (LIFO, to keep the recent ones hot) */
+	apr_pool_t                *arenas[MRCP_MESSAGE_ARENA_CACHE_SIZE];
+	/** Number of cached arenas */
+	apr_size_t                 count;
+	/** Statistics of the cache */
+	mrcp_message_arena_stats_t stats;
+};
+
+#ifdef MRCP_ARENA_THREAD_LOCAL
+/* an arena may be released by another thread, it then goes to the cache of that thread */
+static MRCP_ARENA_THREAD_LOCAL mrcp_message_arena_cache_t arena_cache;
+#endif
+
+static apr_size_t arena_max_body_size = MRCP_MESSAGE_ARENA_MAX_BODY_SIZE;
+
+/** Create an arena with its own allocator, the arena is used by one thread at a time */
+static apr_pool_t* mrcp_message_arena_alloc(void)
+{
+	apr_pool_t *pool = NULL;
+	apr_allocator_t *allocator = NULL;
+	if(apr_allocator_create(&allocator) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_pool_create_ex(&pool,NULL,NULL,allocator) != APR_SUCCESS) {
+		apr_allocator_destroy(allocator);
+		return NULL;
+	}
+	apr_allocator_owner_set(allocator,pool);
+	apr_allocator_max_free_set(allocator,MRCP_MESSAGE_ARENA_MAX_FREE);
+	return pool;
+}
+
+/** Create an MRCP message in its own arena */
+MRCP_DECLARE(mrcp_message_t*) mrcp_message_arena_create(void)
+{
+	apr_pool_t *pool = NULL;
+#ifdef MRCP_ARENA_THREAD_LOCAL
+	mrcp_message_arena_cache_t *cache = &arena_cache;
+	cache->stats.acquired++;
+	if(cache->count) {
+		pool = cache->arenas[--cache->count];
+		cache->stats.reused++;
+	}
+#endif
+	if(!pool) {
+		pool = mrcp_message_arena_alloc();
+		if(!pool) {
+			return NULL;
+		}
+	}
+	return mrcp_message_create(pool);
+}
+
+/** Release an MRCP message created by mrcp_message_arena_create() */
+MRCP_DECLARE(void) mrcp_message_arena_release(mrcp_message_t *message)
+{
+	apr_pool_t *pool;
+	apr_size_t body_size;
+#ifdef MRCP_ARENA_THREAD_LOCAL
+	mrcp_message_arena_cache_t *cache = &arena_cache;
+#endif
+	if(!message) {
+		return;
+	}
+
+	pool = message->pool;
+	body_size = message->body.length;
+	mrcp_message_destroy(message);
+
+#ifdef MRCP_ARENA_THREAD_LOCAL
+	cache->stats.released++;
+	if(body_size <= arena_max_body_size && arena_max_body_size && cache->count < MRCP_MESSAGE_ARENA_CACHE_SIZE) {
+		/* the message itself is allocated from the arena, it is gone after the reset */
+		apr_pool_clear(pool);
+		cache->arenas[cache->count++] = pool;
+		return;
+	}
+	cache->stats.discarded++;
+#endif
+	apr_pool_destroy(pool);
+}
+
+/** Set the max size of the body of a message whose arena is reused */
+MRCP_DECLARE(void) mrcp_message_arena_max_body_set(apr_size_t size)
+{
+	arena_max_body_size = size;
+}
+
+/** Get statistics of the arena cache of the calling thread */
+MRCP_DECLARE(void) mrcp_message_arena_stats_get(mrcp_message_arena_stats_t *stats)
+{
+#ifdef MRCP_ARENA_THREAD_LOCAL
+	*stats = arena_cache.stats;
+	stats->cached = arena_cache.count;
+#else
+	stats->acquired = 0;
+	stats->reused = 0;
+	stats->released = 0;
+	stats->discarded = 0;
+	stats->cached = 0;
+#endif
+}
+
+/** Destroy the arenas cached by the calling thread */
+MRCP_DECLARE(void) mrcp_message_arena_cache_clear(void)
+{
+#ifdef MRCP_ARENA_THREAD_LOCAL
+	mrcp_message_arena_cache_t *cache = &arena_cache;
+	while(cache->count) {
+		apr_pool_destroy(cache->arenas[--cache->count]);
+	}
+#endif
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_strings.h>
+#include "mrcp_message_trace.h"
+#include "apt_log.h"
+
+#if defined(__linux__)
+#define MRCP_TRACE_MONOTONIC_CLOCK
+#include <time.h>
+#endif
+
+/** Max length of a logged record */
+#define MRCP_TRACE_RECORD_MAX_LENGTH 512
+
+static apt_bool_t trace_enabled = FALSE;
+static mrcp_message_trace_handler_f trace_handler = NULL;
+
+static const char *trace_point_names[MRCP_TRACE_POINT_COUNT] = {
+	"received",
+	"dispatched",
+	"processed",
+	"first-audio",
+	"input-started",
+	"response-sent",
+	"complete-sent"
+};
+
+/** Get the time (usec) of a clock never going backwards */
+static APR_INLINE apr_int64_t mrcp_message_trace_now(void)
+{
+#ifdef MRCP_TRACE_MONOTONIC_CLOCK
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC,&ts) == 0) {
+		return (apr_int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+	}
+#endif
+	return apr_time_now();
+}
+
+/** Enable or disable tracing of requests */
+MRCP_DECLARE(void) mrcp_message_trace_enable(apt_bool_t enable)
+{
+	trace_enabled = enable;
+}
+
+/** Set the handler of trace records */
+MRCP_DECLARE(void) mrcp_message_trace_handler_set(mrcp_message_trace_handler_f handler)
+{
+	trace_handler = handler;
+}
+
+/** Start the trace of a received request */
+MRCP_DECLARE(void) mrcp_message_trace_start(mrcp_message_t *request)
+{
+	mrcp_message_trace_t *trace;
+	if(trace_enabled == FALSE || request->trace ||
+		request->start_line.message_type != MRCP_MESSAGE_TYPE_REQUEST) {
+		return;
+	}
+
+	trace = apr_pcalloc(request->pool,sizeof(mrcp_message_trace_t));
+	trace->method_name = request->start_line.method_name;
+	trace->emitted = FALSE;
+	trace->stamps[MRCP_TRACE_POINT_RECEIVED] = mrcp_message_trace_now();
+	request->trace = trace;
+}
+
+/** Stamp a trace point of the request the message belongs to */
+MRCP_DECLARE(void) mrcp_message_trace_stamp(const mrcp_message_t *message, mrcp_trace_point_e point)
+{
+	/* each point is reached in one thread only, so the first stamp needs no lock */
+	mrcp_message_trace_t *trace = message->trace;
+	if(trace && point < MRCP_TRACE_POINT_COUNT && !trace->stamps[point]) {
+		trace->stamps[point] = mrcp_message_trace_now();
+	}
+}
+
+/** Log the record of a completed request */
+static void mrcp_message_trace_log(const mrcp_message_t *message, const mrcp_message_trace_t *trace)
+{
+	char record[MRCP_TRACE_RECORD_MAX_LENGTH];
+	apr_size_t length = 0;
+	apr_int64_t origin = trace->stamps[MRCP_TRACE_POINT_RECEIVED];
+	int i;
+
+	record[0] = '\0';
+	for(i = MRCP_TRACE_POINT_RECEIVED + 1; i < MRCP_TRACE_POINT_COUNT; i++) {
+		if(trace->stamps[i]) {
+			length += apr_snprintf(record + length,sizeof(record) - length," %s=%"APR_INT64_T_FMT,
+								trace_point_names[i],
+								trace->stamps[i] - origin);
+		}
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Trace " APT_SIDRES_FMT " request-id=%"MRCP_REQUEST_ID_FMT" method=%s status=%d%s",
+		MRCP_MESSAGE_SIDRES(message),
+		message->start_line.request_id,
+		trace->method_name.buf ? trace->method_name.buf : "",
+		message->start_line.status_code,
+		record);
+}
+
+/** Stamp the message as sent and emit the record, if it completes the request */
+MRCP_DECLARE(void) mrcp_message_trace_sent(const mrcp_message_t *message)
+{
+	mrcp_message_trace_t *trace = message->trace;
+	if(!trace || trace->emitted == TRUE) {
+		return;
+	}
+
+	if(message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE) {
+		mrcp_message_trace_stamp(message,MRCP_TRACE_POINT_RESPONSE_SENT);
+	}
+	if(message->start_line.request_state != MRCP_REQUEST_STATE_COMPLETE) {
+		return;
+	}
+
+	mrcp_message_trace_stamp(message,MRCP_TRACE_POINT_COMPLETE_SENT);
+	trace->emitted = TRUE;
+	if(trace_handler) {
+		trace_handler(message,trace);
+	}
+	else {
+		mrcp_message_trace_log(message,trace);
+	}
+}
+
+/** Get the name of a trace point */
+MRCP_DECLARE(const char*) mrcp_message_trace_point_name_get(mrcp_trace_point_e point)
+{
+	if(point >= MRCP_TRACE_POINT_COUNT) {
+		return NULL;
+	}
+	return trace_point_names[point];
+}
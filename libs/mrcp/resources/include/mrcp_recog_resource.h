@@ -50,6 +50,8 @@ typedef enum {
 	RECOGNIZER_START_OF_INPUT,
 	RECOGNIZER_RECOGNITION_COMPLETE,
 	RECOGNIZER_INTERPRETATION_COMPLETE,
+	/** Vendor-specific event carrying an interim hypothesis of the in-progress recognition */
+	RECOGNIZER_INTERMEDIATE_RESULT,
 
 	RECOGNIZER_EVENT_COUNT
 } mrcp_recognizer_event_id;
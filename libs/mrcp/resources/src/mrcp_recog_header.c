@@ -65,6 +65,11 @@ static const apt_str_table_item_t v1_recog_header_string_table[] = {
 	{{"Abort-Phrase-Enrollment",          23},0}
 };
 
+/** Perfect hash index of MRCPv1 recognizer header fields (generated by strtablegen) */
+static const apr_int32_t v1_recog_header_string_buckets[] = {1,1,0,0,2,-4,-22,-21,2,-37,0,0,-9,-12,1,1,0,0,0,1,0,-32,0,-34,-28,0,0,1,-8,-5,-38,1,-19,0,0,0,1,0,1,-24,5,0,-39,0,-10};
+static const apr_size_t v1_recog_header_string_ids[] = {44,13,24,0,2,11,41,3,4,5,8,7,28,34,12,17,20,37,14,6,15,16,43,18,21,23,27,25,19,42,10,30,33,31,26,9,32,35,40,36,22,39,1,38,29};
+static const apt_str_table_index_t v1_recog_header_string_index = {v1_recog_header_string_buckets,v1_recog_header_string_ids};
+
 /** String table of MRCPv2 recognizer header fields (mrcp_recog_header_id) */
 static const apt_str_table_item_t v2_recog_header_string_table[] = {
 	{{"Confidence-Threshold",             20},16},
@@ -114,6 +119,11 @@ static const apt_str_table_item_t v2_recog_header_string_table[] = {
 	{{"Abort-Phrase-Enrollment",          23},0}
 };
 
+/** Perfect hash index of MRCPv2 recognizer header fields (generated by strtablegen) */
+static const apr_int32_t v2_recog_header_string_buckets[] = {1,1,0,0,-39,-4,-21,1,-24,-36,0,0,-8,-20,1,1,0,0,0,1,0,-32,0,-34,-28,0,0,1,-6,-5,-37,7,3,0,0,0,1,0,1,-23,5,0,-38,0,-19};
+static const apr_size_t v2_recog_header_string_ids[] = {44,13,24,0,2,3,15,4,6,14,8,9,28,34,12,17,20,37,5,7,16,11,18,22,21,23,27,25,19,42,10,30,33,31,26,32,35,40,43,36,41,39,1,38,29};
+static const apt_str_table_index_t v2_recog_header_string_index = {v2_recog_header_string_buckets,v2_recog_header_string_ids};
+
 /** String table of MRCPv1 recognizer completion-cause fields (mrcp_recog_completion_cause_e) */
 static const apt_str_table_item_t v1_completion_cause_string_table[] = {
 	{{"success",                     7},1},
@@ -217,141 +227,63 @@ static void* mrcp_recog_header_allocate(mrcp_header_accessor_t *accessor, apr_po
 	return accessor->data;
 }
 
+/** Descriptors of recognizer header fields in the order of mrcp_recognizer_header_id (MRCPv2 syntax) */
+static const mrcp_header_field_desc_t recog_header_fields[RECOGNIZER_HEADER_COUNT] = {
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recog_header_t,confidence_threshold),
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recog_header_t,sensitivity_level),
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recog_header_t,speed_vs_accuracy),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,n_best_list_length),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,no_input_timeout),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,recognition_timeout),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,waveform_uri),
+	MRCP_HEADER_FIELD_CUSTOM(mrcp_recog_header_t,completion_cause),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,recognizer_context_block),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,start_input_timers),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,speech_complete_timeout),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,speech_incomplete_timeout),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,dtmf_interdigit_timeout),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,dtmf_term_timeout),
+	MRCP_HEADER_FIELD_CHAR(mrcp_recog_header_t,dtmf_term_char),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,failed_uri),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,failed_uri_cause),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,save_waveform),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,new_audio_channel),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,speech_language),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,input_type),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,input_waveform_uri),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,completion_reason),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,media_type),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,ver_buffer_utterance),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,recognition_mode),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,cancel_if_queue),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,hotword_max_duration),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,hotword_min_duration),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,interpret_text),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,dtmf_buffer_time),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,clear_dtmf_buffer),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,early_no_match),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recog_header_t,num_min_consistent_pronunciations),
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recog_header_t,consistency_threshold),
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recog_header_t,clash_threshold),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,personal_grammar_uri),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,enroll_utterance),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,phrase_id),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,phrase_nl),
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recog_header_t,weight),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,save_best_waveform),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,new_phrase_id),
+	MRCP_HEADER_FIELD_STRING(mrcp_recog_header_t,confusable_phrases_uri),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recog_header_t,abort_phrase_enrollment)
+};
+
 /** Parse MRCP recognizer header */
 static apt_bool_t mrcp_recog_header_parse(mrcp_recog_header_t *recog_header, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	apt_bool_t status = TRUE;
-	switch(id) {
-		case RECOGNIZER_HEADER_N_BEST_LIST_LENGTH:
-			recog_header->n_best_list_length = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_NO_INPUT_TIMEOUT:
-			recog_header->no_input_timeout = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_RECOGNITION_TIMEOUT:
-			recog_header->recognition_timeout = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_WAVEFORM_URI:
-			recog_header->waveform_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_COMPLETION_CAUSE:
-			recog_header->completion_cause = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_RECOGNIZER_CONTEXT_BLOCK:
-			recog_header->recognizer_context_block = *value;
-			break;
-		case RECOGNIZER_HEADER_START_INPUT_TIMERS:
-			apt_boolean_value_parse(value,&recog_header->start_input_timers);
-			break;
-		case RECOGNIZER_HEADER_SPEECH_COMPLETE_TIMEOUT:
-			recog_header->speech_complete_timeout = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_SPEECH_INCOMPLETE_TIMEOUT:
-			recog_header->speech_incomplete_timeout = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_DTMF_INTERDIGIT_TIMEOUT:
-			recog_header->dtmf_interdigit_timeout = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_DTMF_TERM_TIMEOUT:
-			recog_header->dtmf_term_timeout = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_DTMF_TERM_CHAR:
-			recog_header->dtmf_term_char = *value->buf;
-			break;
-		case RECOGNIZER_HEADER_FAILED_URI:
-			recog_header->failed_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_FAILED_URI_CAUSE:
-			recog_header->failed_uri_cause = *value;
-			break;
-		case RECOGNIZER_HEADER_SAVE_WAVEFORM:
-			apt_boolean_value_parse(value,&recog_header->save_waveform);
-			break;
-		case RECOGNIZER_HEADER_NEW_AUDIO_CHANNEL:
-			apt_boolean_value_parse(value,&recog_header->new_audio_channel);
-			break;
-		case RECOGNIZER_HEADER_SPEECH_LANGUAGE:
-			recog_header->speech_language = *value;
-			break;
-		case RECOGNIZER_HEADER_INPUT_TYPE:
-			recog_header->input_type = *value;
-			break;
-		case RECOGNIZER_HEADER_MEDIA_TYPE:
-			recog_header->media_type = *value;
-			break;
-		case RECOGNIZER_HEADER_INPUT_WAVEFORM_URI:
-			recog_header->input_waveform_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_COMPLETION_REASON:
-			recog_header->completion_reason = *value;
-			break;
-		case RECOGNIZER_HEADER_VER_BUFFER_UTTERANCE:
-			apt_boolean_value_parse(value,&recog_header->ver_buffer_utterance);
-			break;
-		case RECOGNIZER_HEADER_RECOGNITION_MODE:
-			recog_header->recognition_mode = *value;
-			break;
-		case RECOGNIZER_HEADER_CANCEL_IF_QUEUE:
-			apt_boolean_value_parse(value,&recog_header->cancel_if_queue);
-			break;
-		case RECOGNIZER_HEADER_HOTWORD_MAX_DURATION:
-			recog_header->hotword_max_duration = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_HOTWORD_MIN_DURATION:
-			recog_header->hotword_min_duration = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_INTERPRET_TEXT:
-			recog_header->interpret_text = *value;
-			break;
-		case RECOGNIZER_HEADER_DTMF_BUFFER_TIME:
-			recog_header->dtmf_buffer_time = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_CLEAR_DTMF_BUFFER:
-			apt_boolean_value_parse(value,&recog_header->clear_dtmf_buffer);
-			break;
-		case RECOGNIZER_HEADER_EARLY_NO_MATCH:
-			apt_boolean_value_parse(value,&recog_header->early_no_match);
-			break;
-		case RECOGNIZER_HEADER_NUM_MIN_CONSISTENT_PRONUNCIATIONS:
-			recog_header->num_min_consistent_pronunciations = apt_size_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_CONSISTENCY_THRESHOLD:
-			recog_header->consistency_threshold = apt_float_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_CLASH_THRESHOLD:
-			recog_header->clash_threshold = apt_float_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_PERSONAL_GRAMMAR_URI:
-			recog_header->personal_grammar_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_ENROLL_UTTERANCE:
-			apt_boolean_value_parse(value,&recog_header->enroll_utterance);
-			break;
-		case RECOGNIZER_HEADER_PHRASE_ID:
-			recog_header->phrase_id = *value;
-			break;
-		case RECOGNIZER_HEADER_PHRASE_NL:
-			recog_header->phrase_nl = *value;
-			break;
-		case RECOGNIZER_HEADER_WEIGHT:
-			recog_header->weight = apt_float_value_parse(value);
-			break;
-		case RECOGNIZER_HEADER_SAVE_BEST_WAVEFORM:
-			apt_boolean_value_parse(value,&recog_header->save_best_waveform);
-			break;
-		case RECOGNIZER_HEADER_NEW_PHRASE_ID:
-			recog_header->new_phrase_id = *value;
-			break;
-		case RECOGNIZER_HEADER_CONFUSABLE_PHRASES_URI:
-			recog_header->confusable_phrases_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_ABORT_PHRASE_ENROLLMENT:
-			apt_boolean_value_parse(value,&recog_header->abort_phrase_enrollment);
-			break;
-		default:
-			status = FALSE;
+	if(id == RECOGNIZER_HEADER_COMPLETION_CAUSE) {
+		recog_header->completion_cause = apt_size_value_parse(value);
+		return TRUE;
 	}
-	return status;
+	return mrcp_header_field_desc_parse(recog_header_fields,RECOGNIZER_HEADER_COUNT,recog_header,id,value,pool);
 }
 
 static APR_INLINE float apt_size_value_parse_as_float(const apt_str_t *value)
@@ -388,154 +320,13 @@ static apt_bool_t mrcp_v1_recog_header_parse(mrcp_header_accessor_t *accessor, a
 /** Parse MRCPv2 recognizer header */
 static apt_bool_t mrcp_v2_recog_header_parse(mrcp_header_accessor_t *accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	mrcp_recog_header_t *recog_header = accessor->data;
-	if(id == RECOGNIZER_HEADER_CONFIDENCE_THRESHOLD) {
-		recog_header->confidence_threshold = apt_float_value_parse(value);
-		return TRUE;
-	}
-	else if(id == RECOGNIZER_HEADER_SENSITIVITY_LEVEL) {
-		recog_header->sensitivity_level = apt_float_value_parse(value);
-		return TRUE;
-	}
-	else if(id == RECOGNIZER_HEADER_SPEED_VS_ACCURACY) {
-		recog_header->speed_vs_accuracy = apt_float_value_parse(value);
-		return TRUE;
-	}
-	return mrcp_recog_header_parse(recog_header,id,value,pool);
+	return mrcp_recog_header_parse(accessor->data,id,value,pool);
 }
 
 /** Generate MRCP recognizer header */
 static apt_bool_t mrcp_recog_header_generate(const mrcp_recog_header_t *recog_header, apr_size_t id, apt_str_t *value, apr_pool_t *pool)
 {
-	switch(id) {
-		case RECOGNIZER_HEADER_N_BEST_LIST_LENGTH:
-			apt_size_value_generate(recog_header->n_best_list_length,value,pool);
-			break;
-		case RECOGNIZER_HEADER_NO_INPUT_TIMEOUT:
-			apt_size_value_generate(recog_header->no_input_timeout,value,pool);
-			break;
-		case RECOGNIZER_HEADER_RECOGNITION_TIMEOUT:
-			apt_size_value_generate(recog_header->recognition_timeout,value,pool);
-			break;
-		case RECOGNIZER_HEADER_WAVEFORM_URI:
-			*value = recog_header->waveform_uri;
-			break;
-		case RECOGNIZER_HEADER_RECOGNIZER_CONTEXT_BLOCK:
-			*value = recog_header->recognizer_context_block;
-			break;
-		case RECOGNIZER_HEADER_START_INPUT_TIMERS:
-			apt_boolean_value_generate(recog_header->start_input_timers,value,pool);
-			break;
-		case RECOGNIZER_HEADER_SPEECH_COMPLETE_TIMEOUT:
-			apt_size_value_generate(recog_header->speech_complete_timeout,value,pool);
-			break;
-		case RECOGNIZER_HEADER_SPEECH_INCOMPLETE_TIMEOUT:
-			apt_size_value_generate(recog_header->speech_incomplete_timeout,value,pool);
-			break;
-		case RECOGNIZER_HEADER_DTMF_INTERDIGIT_TIMEOUT:
-			apt_size_value_generate(recog_header->dtmf_interdigit_timeout,value,pool);
-			break;
-		case RECOGNIZER_HEADER_DTMF_TERM_TIMEOUT:
-			apt_size_value_generate(recog_header->dtmf_term_timeout,value,pool);
-			break;
-		case RECOGNIZER_HEADER_DTMF_TERM_CHAR:
-			value->length = 1;
-			value->buf = apr_palloc(pool,value->length);
-			*value->buf	= recog_header->dtmf_term_char;
-			break;
-		case RECOGNIZER_HEADER_FAILED_URI:
-			*value = recog_header->failed_uri;
-			break;
-		case RECOGNIZER_HEADER_FAILED_URI_CAUSE:
-			*value = recog_header->failed_uri_cause;
-			break;
-		case RECOGNIZER_HEADER_SAVE_WAVEFORM:
-			apt_boolean_value_generate(recog_header->save_waveform,value,pool);
-			break;
-		case RECOGNIZER_HEADER_NEW_AUDIO_CHANNEL:
-			apt_boolean_value_generate(recog_header->new_audio_channel,value,pool);
-			break;
-		case RECOGNIZER_HEADER_SPEECH_LANGUAGE:
-			*value = recog_header->speech_language;
-			break;
-		case RECOGNIZER_HEADER_INPUT_TYPE:
-			*value = recog_header->input_type;
-			break;
-		case RECOGNIZER_HEADER_INPUT_WAVEFORM_URI:
-			*value = recog_header->input_waveform_uri;
-			break;
-		case RECOGNIZER_HEADER_COMPLETION_REASON:
-			*value = recog_header->completion_reason;
-			break;
-		case RECOGNIZER_HEADER_MEDIA_TYPE:
-			*value = recog_header->media_type;
-			break;
-		case RECOGNIZER_HEADER_VER_BUFFER_UTTERANCE:
-			apt_boolean_value_generate(recog_header->ver_buffer_utterance,value,pool);
-			break;
-		case RECOGNIZER_HEADER_RECOGNITION_MODE:
-			*value = recog_header->recognition_mode;
-			break;
-		case RECOGNIZER_HEADER_CANCEL_IF_QUEUE:
-			apt_boolean_value_generate(recog_header->cancel_if_queue,value,pool);
-			break;
-		case RECOGNIZER_HEADER_HOTWORD_MAX_DURATION:
-			apt_size_value_generate(recog_header->hotword_max_duration,value,pool);
-			break;
-		case RECOGNIZER_HEADER_HOTWORD_MIN_DURATION:
-			apt_size_value_generate(recog_header->hotword_min_duration,value,pool);
-			break;
-		case RECOGNIZER_HEADER_INTERPRET_TEXT:
-			*value = recog_header->interpret_text;
-			break;
-		case RECOGNIZER_HEADER_DTMF_BUFFER_TIME:
-			apt_size_value_generate(recog_header->dtmf_buffer_time,value,pool);
-			break;
-		case RECOGNIZER_HEADER_CLEAR_DTMF_BUFFER:
-			apt_boolean_value_generate(recog_header->clear_dtmf_buffer,value,pool);
-			break;
-		case RECOGNIZER_HEADER_EARLY_NO_MATCH:
-			apt_boolean_value_generate(recog_header->early_no_match,value,pool);
-			break;
-		case RECOGNIZER_HEADER_NUM_MIN_CONSISTENT_PRONUNCIATIONS:
-			apt_size_value_generate(recog_header->num_min_consistent_pronunciations,value,pool);
-			break;
-		case RECOGNIZER_HEADER_CONSISTENCY_THRESHOLD:
-			apt_float_value_generate(recog_header->consistency_threshold,value,pool);
-			break;
-		case RECOGNIZER_HEADER_CLASH_THRESHOLD:
-			apt_float_value_generate(recog_header->clash_threshold,value,pool);
-			break;
-		case RECOGNIZER_HEADER_PERSONAL_GRAMMAR_URI:
-			*value = recog_header->personal_grammar_uri;
-			break;
-		case RECOGNIZER_HEADER_ENROLL_UTTERANCE:
-			apt_boolean_value_generate(recog_header->enroll_utterance,value,pool);
-			break;
-		case RECOGNIZER_HEADER_PHRASE_ID:
-			*value = recog_header->phrase_id;
-			break;
-		case RECOGNIZER_HEADER_PHRASE_NL:
-			*value = recog_header->phrase_nl;
-			break;
-		case RECOGNIZER_HEADER_WEIGHT:
-			apt_float_value_generate(recog_header->weight,value,pool);
-			break;
-		case RECOGNIZER_HEADER_SAVE_BEST_WAVEFORM:
-			apt_boolean_value_generate(recog_header->save_best_waveform,value,pool);
-			break;
-		case RECOGNIZER_HEADER_NEW_PHRASE_ID:
-			*value = recog_header->new_phrase_id;
-			break;
-		case RECOGNIZER_HEADER_CONFUSABLE_PHRASES_URI:
-			*value = recog_header->confusable_phrases_uri;
-			break;
-		case RECOGNIZER_HEADER_ABORT_PHRASE_ENROLLMENT:
-			apt_boolean_value_generate(recog_header->abort_phrase_enrollment,value,pool);
-			break;
-		default:
-			break;
-	}
+	mrcp_header_field_desc_generate(recog_header_fields,RECOGNIZER_HEADER_COUNT,recog_header,id,value,pool);
 	return TRUE;
 }
 
@@ -567,16 +358,7 @@ static apt_bool_t mrcp_v1_recog_header_generate(const mrcp_header_accessor_t *ac
 static apt_bool_t mrcp_v2_recog_header_generate(const mrcp_header_accessor_t *accessor, apr_size_t id, apt_str_t *value, apr_pool_t *pool)
 {
 	mrcp_recog_header_t *recog_header = accessor->data;
-	if(id == RECOGNIZER_HEADER_CONFIDENCE_THRESHOLD) {
-		return apt_float_value_generate(recog_header->confidence_threshold,value,pool);
-	}
-	else if(id == RECOGNIZER_HEADER_SENSITIVITY_LEVEL) {
-		return apt_float_value_generate(recog_header->sensitivity_level,value,pool);
-	}
-	else if(id == RECOGNIZER_HEADER_SPEED_VS_ACCURACY) {
-		return apt_float_value_generate(recog_header->speed_vs_accuracy,value,pool);
-	}
-	else if(id == RECOGNIZER_HEADER_COMPLETION_CAUSE) {
+	if(id == RECOGNIZER_HEADER_COMPLETION_CAUSE) {
 		return apt_completion_cause_generate(
 			v2_completion_cause_string_table,
 			RECOGNIZER_COMPLETION_CAUSE_COUNT,
@@ -590,154 +372,10 @@ static apt_bool_t mrcp_v2_recog_header_generate(const mrcp_header_accessor_t *ac
 /** Duplicate MRCP recognizer header */
 static apt_bool_t mrcp_recog_header_duplicate(mrcp_header_accessor_t *accessor, const mrcp_header_accessor_t *src, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	mrcp_recog_header_t *recog_header = accessor->data;
-	const mrcp_recog_header_t *src_recog_header = src->data;
-	apt_bool_t status = TRUE;
-
-	if(!recog_header || !src_recog_header) {
+	if(!accessor->data || !src->data) {
 		return FALSE;
 	}
-	
-	switch(id) {
-		case RECOGNIZER_HEADER_CONFIDENCE_THRESHOLD:
-			recog_header->confidence_threshold = src_recog_header->confidence_threshold;
-			break;
-		case RECOGNIZER_HEADER_SENSITIVITY_LEVEL:
-			recog_header->sensitivity_level = src_recog_header->sensitivity_level;
-			break;
-		case RECOGNIZER_HEADER_SPEED_VS_ACCURACY:
-			recog_header->speed_vs_accuracy = src_recog_header->speed_vs_accuracy;
-			break;
-		case RECOGNIZER_HEADER_N_BEST_LIST_LENGTH:
-			recog_header->n_best_list_length = src_recog_header->n_best_list_length;
-			break;
-		case RECOGNIZER_HEADER_NO_INPUT_TIMEOUT:
-			recog_header->no_input_timeout = src_recog_header->no_input_timeout;
-			break;
-		case RECOGNIZER_HEADER_RECOGNITION_TIMEOUT:
-			recog_header->recognition_timeout = src_recog_header->recognition_timeout;
-			break;
-		case RECOGNIZER_HEADER_WAVEFORM_URI:
-			recog_header->waveform_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_COMPLETION_CAUSE:
-			recog_header->completion_cause = src_recog_header->completion_cause;
-			break;
-		case RECOGNIZER_HEADER_RECOGNIZER_CONTEXT_BLOCK:
-			recog_header->recognizer_context_block = *value;
-			break;
-		case RECOGNIZER_HEADER_START_INPUT_TIMERS:
-			recog_header->start_input_timers = src_recog_header->start_input_timers;
-			break;
-		case RECOGNIZER_HEADER_SPEECH_COMPLETE_TIMEOUT:
-			recog_header->speech_complete_timeout = src_recog_header->speech_complete_timeout;
-			break;
-		case RECOGNIZER_HEADER_SPEECH_INCOMPLETE_TIMEOUT:
-			recog_header->speech_incomplete_timeout = src_recog_header->speech_incomplete_timeout;
-			break;
-		case RECOGNIZER_HEADER_DTMF_INTERDIGIT_TIMEOUT:
-			recog_header->dtmf_interdigit_timeout = src_recog_header->dtmf_interdigit_timeout;
-			break;
-		case RECOGNIZER_HEADER_DTMF_TERM_TIMEOUT:
-			recog_header->dtmf_term_timeout = src_recog_header->dtmf_term_timeout;
-			break;
-		case RECOGNIZER_HEADER_DTMF_TERM_CHAR:
-			recog_header->dtmf_term_char = src_recog_header->dtmf_term_char;
-			break;
-		case RECOGNIZER_HEADER_FAILED_URI:
-			recog_header->failed_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_FAILED_URI_CAUSE:
-			recog_header->failed_uri_cause = *value;
-			break;
-		case RECOGNIZER_HEADER_SAVE_WAVEFORM:
-			recog_header->save_waveform = src_recog_header->save_waveform;
-			break;
-		case RECOGNIZER_HEADER_NEW_AUDIO_CHANNEL:
-			recog_header->new_audio_channel = src_recog_header->new_audio_channel;
-			break;
-		case RECOGNIZER_HEADER_SPEECH_LANGUAGE:
-			recog_header->speech_language = *value;
-			break;
-		case RECOGNIZER_HEADER_INPUT_TYPE:
-			recog_header->input_type = *value;
-			break;
-		case RECOGNIZER_HEADER_INPUT_WAVEFORM_URI:
-			recog_header->input_waveform_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_COMPLETION_REASON:
-			recog_header->completion_reason = *value;
-			break;
-		case RECOGNIZER_HEADER_MEDIA_TYPE:
-			recog_header->media_type = *value;
-			break;
-		case RECOGNIZER_HEADER_VER_BUFFER_UTTERANCE:
-			recog_header->ver_buffer_utterance = src_recog_header->ver_buffer_utterance;
-			break;
-		case RECOGNIZER_HEADER_RECOGNITION_MODE:
-			recog_header->recognition_mode = *value;
-			break;
-		case RECOGNIZER_HEADER_CANCEL_IF_QUEUE:
-			recog_header->cancel_if_queue = src_recog_header->cancel_if_queue;
-			break;
-		case RECOGNIZER_HEADER_HOTWORD_MAX_DURATION:
-			recog_header->hotword_max_duration = src_recog_header->hotword_max_duration;
-			break;
-		case RECOGNIZER_HEADER_HOTWORD_MIN_DURATION:
-			recog_header->hotword_min_duration = src_recog_header->hotword_min_duration;
-			break;
-		case RECOGNIZER_HEADER_INTERPRET_TEXT:
-			recog_header->interpret_text = *value;
-			break;
-		case RECOGNIZER_HEADER_DTMF_BUFFER_TIME:
-			recog_header->dtmf_buffer_time = src_recog_header->dtmf_buffer_time;
-			break;
-		case RECOGNIZER_HEADER_CLEAR_DTMF_BUFFER:
-			recog_header->clear_dtmf_buffer = src_recog_header->clear_dtmf_buffer;
-			break;
-		case RECOGNIZER_HEADER_EARLY_NO_MATCH:
-			recog_header->early_no_match = src_recog_header->early_no_match;
-			break;
-		case RECOGNIZER_HEADER_NUM_MIN_CONSISTENT_PRONUNCIATIONS:
-			recog_header->num_min_consistent_pronunciations = src_recog_header->num_min_consistent_pronunciations;
-			break;
-		case RECOGNIZER_HEADER_CONSISTENCY_THRESHOLD:
-			recog_header->consistency_threshold = src_recog_header->consistency_threshold;
-			break;
-		case RECOGNIZER_HEADER_CLASH_THRESHOLD:
-			recog_header->clash_threshold = src_recog_header->clash_threshold;
-			break;
-		case RECOGNIZER_HEADER_PERSONAL_GRAMMAR_URI:
-			recog_header->personal_grammar_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_ENROLL_UTTERANCE:
-			recog_header->enroll_utterance = src_recog_header->enroll_utterance;
-			break;
-		case RECOGNIZER_HEADER_PHRASE_ID:
-			recog_header->phrase_id = *value;
-			break;
-		case RECOGNIZER_HEADER_PHRASE_NL:
-			recog_header->phrase_nl = *value;
-			break;
-		case RECOGNIZER_HEADER_WEIGHT:
-			recog_header->weight = src_recog_header->weight;
-			break;
-		case RECOGNIZER_HEADER_SAVE_BEST_WAVEFORM:
-			recog_header->save_best_waveform = src_recog_header->save_best_waveform;
-			break;
-		case RECOGNIZER_HEADER_NEW_PHRASE_ID:
-			recog_header->new_phrase_id = *value;
-			break;
-		case RECOGNIZER_HEADER_CONFUSABLE_PHRASES_URI:
-			recog_header->confusable_phrases_uri = *value;
-			break;
-		case RECOGNIZER_HEADER_ABORT_PHRASE_ENROLLMENT:
-			recog_header->abort_phrase_enrollment = src_recog_header->abort_phrase_enrollment;
-			break;
-		default:
-			status = FALSE;
-	}
-	return status;
+	return mrcp_header_field_desc_duplicate(recog_header_fields,RECOGNIZER_HEADER_COUNT,accessor->data,src->data,id,value);
 }
 
 static const mrcp_header_vtable_t v1_vtable = {
@@ -747,7 +385,8 @@ static const mrcp_header_vtable_t v1_vtable = {
 	mrcp_v1_recog_header_generate,
 	mrcp_recog_header_duplicate,
 	v1_recog_header_string_table,
-	RECOGNIZER_HEADER_COUNT
+	RECOGNIZER_HEADER_COUNT,
+	&v1_recog_header_string_index
 };
 
 static const mrcp_header_vtable_t v2_vtable = {
@@ -757,7 +396,8 @@ static const mrcp_header_vtable_t v2_vtable = {
 	mrcp_v2_recog_header_generate,
 	mrcp_recog_header_duplicate,
 	v2_recog_header_string_table,
-	RECOGNIZER_HEADER_COUNT
+	RECOGNIZER_HEADER_COUNT,
+	&v2_recog_header_string_index
 };
 
 const mrcp_header_vtable_t* mrcp_recog_header_vtable_get(mrcp_version_e version)
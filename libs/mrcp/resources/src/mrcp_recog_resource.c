@@ -35,6 +35,11 @@ static const apt_str_table_item_t v1_recog_method_string_table[] = {
 	{{"DELETE-PHRASE",            13},2}
 };
 
+/** Perfect hash index of MRCP recognizer methods (generated by strtablegen) */
+static const apr_int32_t v1_recog_method_string_buckets[] = {0,1,-10,-2,-8,1,0,-12,0,1,-7,-11,-1};
+static const apr_size_t v1_recog_method_string_ids[] = {1,2,10,0,12,3,4,5,8,6,7,9,11};
+static const apt_str_table_index_t v1_recog_method_string_index = {v1_recog_method_string_buckets,v1_recog_method_string_ids};
+
 /** String table of MRCPv2 recognizer methods (mrcp_recognizer_method_id) */
 static const apt_str_table_item_t v2_recog_method_string_table[] = {
 	{{"SET-PARAMS",               10},10},
@@ -52,20 +57,37 @@ static const apt_str_table_item_t v2_recog_method_string_table[] = {
 	{{"DELETE-PHRASE",            13},2}
 };
 
+/** Perfect hash index of MRCPv2 recognizer methods (generated by strtablegen) */
+static const apr_int32_t v2_recog_method_string_buckets[] = {0,1,0,-2,-10,1,0,-12,0,1,-7,-11,-1};
+static const apr_size_t v2_recog_method_string_ids[] = {1,2,10,0,12,3,4,6,8,5,7,9,11};
+static const apt_str_table_index_t v2_recog_method_string_index = {v2_recog_method_string_buckets,v2_recog_method_string_ids};
+
 /** String table of MRCP recognizer events (mrcp_recognizer_event_id) */
 static const apt_str_table_item_t v1_recog_event_string_table[] = {
 	{{"START-OF-SPEECH",          15},0},
 	{{"RECOGNITION-COMPLETE",     20},0},
-	{{"INTERPRETATION-COMPLETE",  23},0}
+	{{"INTERPRETATION-COMPLETE",  23},0},
+	{{"INTERMEDIATE-RESULT",      19},0}
 };
 
+/** Perfect hash index of MRCP recognizer events (generated by strtablegen) */
+static const apr_int32_t v1_recog_event_string_buckets[] = {-2,1,0,-4};
+static const apr_size_t v1_recog_event_string_ids[] = {2,0,1,3};
+static const apt_str_table_index_t v1_recog_event_string_index = {v1_recog_event_string_buckets,v1_recog_event_string_ids};
+
 /** String table of MRCPv2 recognizer events (mrcp_recognizer_event_id) */
 static const apt_str_table_item_t v2_recog_event_string_table[] = {
 	{{"START-OF-INPUT",           14},0},
 	{{"RECOGNITION-COMPLETE",     20},0},
-	{{"INTERPRETATION-COMPLETE",  23},0}
+	{{"INTERPRETATION-COMPLETE",  23},0},
+	{{"INTERMEDIATE-RESULT",      19},0}
 };
 
+/** Perfect hash index of MRCPv2 recognizer events (generated by strtablegen) */
+static const apr_int32_t v2_recog_event_string_buckets[] = {0,1,0,32};
+static const apr_size_t v2_recog_event_string_ids[] = {2,0,1,3};
+static const apt_str_table_index_t v2_recog_event_string_index = {v2_recog_event_string_buckets,v2_recog_event_string_ids};
+
 
 static APR_INLINE const apt_str_table_item_t* recog_method_string_table_get(mrcp_version_e version)
 {
@@ -75,6 +97,14 @@ static APR_INLINE const apt_str_table_item_t* recog_method_string_table_get(mrcp
 	return v2_recog_method_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* recog_method_string_index_get(mrcp_version_e version)
+{
+	if(version == MRCP_VERSION_1) {
+		return &v1_recog_method_string_index;
+	}
+	return &v2_recog_method_string_index;
+}
+
 static APR_INLINE const apt_str_table_item_t* recog_event_string_table_get(mrcp_version_e version)
 {
 	if(version == MRCP_VERSION_1) {
@@ -83,6 +113,14 @@ static APR_INLINE const apt_str_table_item_t* recog_event_string_table_get(mrcp_
 	return v2_recog_event_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* recog_event_string_index_get(mrcp_version_e version)
+{
+	if(version == MRCP_VERSION_1) {
+		return &v1_recog_event_string_index;
+	}
+	return &v2_recog_event_string_index;
+}
+
 /** Create MRCP recognizer resource */
 MRCP_DECLARE(mrcp_resource_t*) mrcp_recog_resource_create(apr_pool_t *pool)
 {
@@ -91,7 +129,9 @@ MRCP_DECLARE(mrcp_resource_t*) mrcp_recog_resource_create(apr_pool_t *pool)
 	resource->method_count = RECOGNIZER_METHOD_COUNT;
 	resource->event_count = RECOGNIZER_EVENT_COUNT;
 	resource->get_method_str_table = recog_method_string_table_get;
+	resource->get_method_str_index = recog_method_string_index_get;
 	resource->get_event_str_table = recog_event_string_table_get;
+	resource->get_event_str_index = recog_event_string_index_get;
 	resource->get_resource_header_vtable = mrcp_recog_header_vtable_get;
 	return resource;
 }
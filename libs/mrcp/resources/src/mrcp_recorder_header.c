@@ -35,6 +35,11 @@ static const apt_str_table_item_t recorder_header_string_table[] = {
 	{{"New-Audio-Channel",    17},2}
 };
 
+/** Perfect hash index of recorder header fields (generated by strtablegen) */
+static const apr_int32_t recorder_header_string_buckets[] = {-6,0,1,0,4,0,0,1,9,-7,-12,0,-9,-14,0};
+static const apr_size_t recorder_header_string_ids[] = {3,2,4,8,6,0,7,10,9,5,12,13,1,14,11};
+static const apt_str_table_index_t recorder_header_string_index = {recorder_header_string_buckets,recorder_header_string_ids};
+
 /** String table of recorder completion-cause fields (mrcp_recorder_completion_cause_e) */
 static const apt_str_table_item_t completion_cause_string_table[] = {
 	{{"success-silence",  15},8},
@@ -74,187 +79,60 @@ static void* mrcp_recorder_header_allocate(mrcp_header_accessor_t *accessor, apr
 	return accessor->data;
 }
 
+/** Descriptors of recorder header fields in the order of mrcp_recorder_header_id */
+static const mrcp_header_field_desc_t recorder_header_fields[RECORDER_HEADER_COUNT] = {
+	MRCP_HEADER_FIELD_FLOAT(mrcp_recorder_header_t,sensitivity_level),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recorder_header_t,no_input_timeout),
+	MRCP_HEADER_FIELD_CUSTOM(mrcp_recorder_header_t,completion_cause),
+	MRCP_HEADER_FIELD_STRING(mrcp_recorder_header_t,completion_reason),
+	MRCP_HEADER_FIELD_STRING(mrcp_recorder_header_t,failed_uri),
+	MRCP_HEADER_FIELD_STRING(mrcp_recorder_header_t,failed_uri_cause),
+	MRCP_HEADER_FIELD_STRING(mrcp_recorder_header_t,record_uri),
+	MRCP_HEADER_FIELD_STRING(mrcp_recorder_header_t,media_type),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recorder_header_t,max_time),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recorder_header_t,trim_length),
+	MRCP_HEADER_FIELD_SIZE(mrcp_recorder_header_t,final_silence),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recorder_header_t,capture_on_speech),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recorder_header_t,ver_buffer_utterance),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recorder_header_t,start_input_timers),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_recorder_header_t,new_audio_channel)
+};
+
 /** Parse MRCP recorder header */
 static apt_bool_t mrcp_recorder_header_parse(mrcp_header_accessor_t *accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	apt_bool_t status = TRUE;
 	mrcp_recorder_header_t *recorder_header = accessor->data;
-	switch(id) {
-		case RECORDER_HEADER_SENSITIVITY_LEVEL:
-			recorder_header->sensitivity_level = apt_float_value_parse(value);
-			break;
-		case RECORDER_HEADER_NO_INPUT_TIMEOUT:
-			recorder_header->no_input_timeout = apt_size_value_parse(value);
-			break;
-		case RECORDER_HEADER_COMPLETION_CAUSE:
-			recorder_header->completion_cause = apt_size_value_parse(value);
-			break;
-		case RECORDER_HEADER_COMPLETION_REASON:
-			recorder_header->completion_reason = *value;
-			break;
-		case RECORDER_HEADER_FAILED_URI:
-			recorder_header->failed_uri = *value;
-			break;
-		case RECORDER_HEADER_FAILED_URI_CAUSE:
-			recorder_header->failed_uri_cause = *value;
-			break;
-		case RECORDER_HEADER_RECORD_URI:
-			recorder_header->record_uri = *value;
-			break;
-		case RECORDER_HEADER_MEDIA_TYPE:
-			recorder_header->media_type = *value;
-			break;
-		case RECORDER_HEADER_MAX_TIME:
-			recorder_header->max_time = apt_size_value_parse(value);
-			break;
-		case RECORDER_HEADER_TRIM_LENGTH:
-			recorder_header->trim_length = apt_size_value_parse(value);
-			break;
-		case RECORDER_HEADER_FINAL_SILENCE:
-			recorder_header->final_silence = apt_size_value_parse(value);
-			break;
-		case RECORDER_HEADER_CAPTURE_ON_SPEECH:
-			apt_boolean_value_parse(value,&recorder_header->capture_on_speech);
-			break;
-		case RECORDER_HEADER_VER_BUFFER_UTTERANCE:
-			apt_boolean_value_parse(value,&recorder_header->ver_buffer_utterance);
-			break;
-		case RECORDER_HEADER_START_INPUT_TIMERS:
-			apt_boolean_value_parse(value,&recorder_header->start_input_timers);
-			break;
-		case RECORDER_HEADER_NEW_AUDIO_CHANNEL:
-			apt_boolean_value_parse(value,&recorder_header->new_audio_channel);
-			break;
-		default:
-			status = FALSE;
+	if(id == RECORDER_HEADER_COMPLETION_CAUSE) {
+		recorder_header->completion_cause = apt_size_value_parse(value);
+		return TRUE;
 	}
-	return status;
+	return mrcp_header_field_desc_parse(recorder_header_fields,RECORDER_HEADER_COUNT,recorder_header,id,value,pool);
 }
 
 /** Generate MRCP recorder header */
 static apt_bool_t mrcp_recorder_header_generate(const mrcp_header_accessor_t *accessor, apr_size_t id, apt_str_t *value, apr_pool_t *pool)
 {
 	mrcp_recorder_header_t *recorder_header = accessor->data;
-	switch(id) {
-		case RECORDER_HEADER_SENSITIVITY_LEVEL:
-			apt_float_value_generate(recorder_header->sensitivity_level,value,pool);
-			break;
-		case RECORDER_HEADER_NO_INPUT_TIMEOUT:
-			apt_size_value_generate(recorder_header->no_input_timeout,value,pool);
-			break;
-		case RECORDER_HEADER_COMPLETION_CAUSE:
-		{
-			apt_completion_cause_generate(
-				completion_cause_string_table,
-				RECORDER_COMPLETION_CAUSE_COUNT,
-				recorder_header->completion_cause,
-				value,
-				pool);
-			break;
-		}
-		case RECORDER_HEADER_COMPLETION_REASON:
-			*value = recorder_header->completion_reason;
-			break;
-		case RECORDER_HEADER_FAILED_URI:
-			*value = recorder_header->failed_uri;
-			break;
-		case RECORDER_HEADER_FAILED_URI_CAUSE:
-			*value = recorder_header->failed_uri_cause;
-			break;
-		case RECORDER_HEADER_RECORD_URI:
-			*value = recorder_header->record_uri;
-			break;
-		case RECORDER_HEADER_MEDIA_TYPE:
-			*value = recorder_header->media_type;
-			break;
-		case RECORDER_HEADER_MAX_TIME:
-			apt_size_value_generate(recorder_header->max_time,value,pool);
-			break;
-		case RECORDER_HEADER_TRIM_LENGTH:
-			apt_size_value_generate(recorder_header->trim_length,value,pool);
-			break;
-		case RECORDER_HEADER_FINAL_SILENCE:
-			apt_size_value_generate(recorder_header->final_silence,value,pool);
-			break;
-		case RECORDER_HEADER_CAPTURE_ON_SPEECH:
-			apt_boolean_value_generate(recorder_header->capture_on_speech,value,pool);
-			break;
-		case RECORDER_HEADER_VER_BUFFER_UTTERANCE:
-			apt_boolean_value_generate(recorder_header->ver_buffer_utterance,value,pool);
-			break;
-		case RECORDER_HEADER_START_INPUT_TIMERS:
-			apt_boolean_value_generate(recorder_header->start_input_timers,value,pool);
-			break;
-		case RECORDER_HEADER_NEW_AUDIO_CHANNEL:
-			apt_boolean_value_generate(recorder_header->new_audio_channel,value,pool);
-			break;
-		default:
-			break;
+	if(id == RECORDER_HEADER_COMPLETION_CAUSE) {
+		apt_completion_cause_generate(
+			completion_cause_string_table,
+			RECORDER_COMPLETION_CAUSE_COUNT,
+			recorder_header->completion_cause,
+			value,
+			pool);
+		return TRUE;
 	}
+	mrcp_header_field_desc_generate(recorder_header_fields,RECORDER_HEADER_COUNT,recorder_header,id,value,pool);
 	return TRUE;
 }
 
 /** Duplicate MRCP recorder header */
 static apt_bool_t mrcp_recorder_header_duplicate(mrcp_header_accessor_t *accessor, const mrcp_header_accessor_t *src, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	mrcp_recorder_header_t *recorder_header = accessor->data;
-	const mrcp_recorder_header_t *src_recorder_header = src->data;
-	apt_bool_t status = TRUE;
-
-	if(!recorder_header || !src_recorder_header) {
+	if(!accessor->data || !src->data) {
 		return FALSE;
 	}
-	
-	switch(id) {
-		case RECORDER_HEADER_SENSITIVITY_LEVEL:
-			recorder_header->sensitivity_level = src_recorder_header->sensitivity_level;
-			break;
-		case RECORDER_HEADER_NO_INPUT_TIMEOUT:
-			recorder_header->no_input_timeout = src_recorder_header->no_input_timeout;
-			break;
-		case RECORDER_HEADER_COMPLETION_CAUSE:
-			recorder_header->completion_cause = src_recorder_header->completion_cause;
-			break;
-		case RECORDER_HEADER_COMPLETION_REASON:
-			recorder_header->completion_reason = *value;
-			break;
-		case RECORDER_HEADER_FAILED_URI:
-			recorder_header->failed_uri = *value;
-			break;
-		case RECORDER_HEADER_FAILED_URI_CAUSE:
-			recorder_header->failed_uri_cause = *value;
-			break;
-		case RECORDER_HEADER_RECORD_URI:
-			recorder_header->record_uri = *value;
-			break;
-		case RECORDER_HEADER_MEDIA_TYPE:
-			recorder_header->media_type = *value;
-			break;
-		case RECORDER_HEADER_MAX_TIME:
-			recorder_header->max_time = src_recorder_header->max_time;
-			break;
-		case RECORDER_HEADER_TRIM_LENGTH:
-			recorder_header->trim_length = src_recorder_header->trim_length;
-			break;
-		case RECORDER_HEADER_FINAL_SILENCE:
-			recorder_header->final_silence = src_recorder_header->final_silence;
-			break;
-		case RECORDER_HEADER_CAPTURE_ON_SPEECH:
-			recorder_header->capture_on_speech = src_recorder_header->capture_on_speech;
-			break;
-		case RECORDER_HEADER_VER_BUFFER_UTTERANCE:
-			recorder_header->ver_buffer_utterance = src_recorder_header->ver_buffer_utterance;
-			break;
-		case RECORDER_HEADER_START_INPUT_TIMERS:
-			recorder_header->start_input_timers = src_recorder_header->start_input_timers;
-			break;
-		case RECORDER_HEADER_NEW_AUDIO_CHANNEL:
-			recorder_header->new_audio_channel = src_recorder_header->new_audio_channel;
-			break;
-		default:
-			status = FALSE;
-	}
-	return status;
+	return mrcp_header_field_desc_duplicate(recorder_header_fields,RECORDER_HEADER_COUNT,accessor->data,src->data,id,value);
 }
 
 static const mrcp_header_vtable_t vtable = {
@@ -264,7 +142,8 @@ static const mrcp_header_vtable_t vtable = {
 	mrcp_recorder_header_generate,
 	mrcp_recorder_header_duplicate,
 	recorder_header_string_table,
-	RECORDER_HEADER_COUNT
+	RECORDER_HEADER_COUNT,
+	&recorder_header_string_index
 };
 
 const mrcp_header_vtable_t* mrcp_recorder_header_vtable_get(mrcp_version_e version)
@@ -27,22 +27,42 @@ static const apt_str_table_item_t recorder_method_string_table[] = {
 	{{"START-INPUT-TIMERS", 18},2}
 };
 
+/** Perfect hash index of MRCP recorder methods (generated by strtablegen) */
+static const apr_int32_t recorder_method_string_buckets[] = {0,-2,-1,-3,1};
+static const apr_size_t recorder_method_string_ids[] = {0,2,4,3,1};
+static const apt_str_table_index_t recorder_method_string_index = {recorder_method_string_buckets,recorder_method_string_ids};
+
 /** String table of MRCP recorder events (mrcp_recorder_event_id) */
 static const apt_str_table_item_t recorder_event_string_table[] = {
 	{{"START-OF-INPUT",     14},0},
 	{{"RECORD-COMPLETE",    15},0}
 };
 
+/** Perfect hash index of MRCP recorder events (generated by strtablegen) */
+static const apr_int32_t recorder_event_string_buckets[] = {-2,-1};
+static const apr_size_t recorder_event_string_ids[] = {0,1};
+static const apt_str_table_index_t recorder_event_string_index = {recorder_event_string_buckets,recorder_event_string_ids};
+
 static APR_INLINE const apt_str_table_item_t* recorder_method_string_table_get(mrcp_version_e version)
 {
 	return recorder_method_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* recorder_method_string_index_get(mrcp_version_e version)
+{
+	return &recorder_method_string_index;
+}
+
 static APR_INLINE const apt_str_table_item_t* recorder_event_string_table_get(mrcp_version_e version)
 {
 	return recorder_event_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* recorder_event_string_index_get(mrcp_version_e version)
+{
+	return &recorder_event_string_index;
+}
+
 /** Create MRCP recorder resource */
 MRCP_DECLARE(mrcp_resource_t*) mrcp_recorder_resource_create(apr_pool_t *pool)
 {
@@ -51,7 +71,9 @@ MRCP_DECLARE(mrcp_resource_t*) mrcp_recorder_resource_create(apr_pool_t *pool)
 	resource->method_count = RECORDER_METHOD_COUNT;
 	resource->event_count = RECORDER_EVENT_COUNT;
 	resource->get_method_str_table = recorder_method_string_table_get;
+	resource->get_method_str_index = recorder_method_string_index_get;
 	resource->get_event_str_table = recorder_event_string_table_get;
+	resource->get_event_str_index = recorder_event_string_index_get;
 	resource->get_resource_header_vtable = mrcp_recorder_header_vtable_get;
 	return resource;
 }
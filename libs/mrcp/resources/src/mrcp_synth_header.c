@@ -41,6 +41,11 @@ static const apt_str_table_item_t synth_header_string_table[] = {
 	{{"Lexicon-Search-Order",20},2}
 };
 
+/** Perfect hash index of MRCP synthesizer header fields (generated by strtablegen) */
+static const apr_int32_t synth_header_string_buckets[] = {2,0,-17,1,-7,0,1,-16,1,0,0,1,0,0,-15,1,0,-5,0,-19,-18};
+static const apr_size_t synth_header_string_ids[] = {14,5,15,11,1,2,4,8,16,9,10,13,7,3,6,12,17,19,20,18,0};
+static const apt_str_table_index_t synth_header_string_index = {synth_header_string_buckets,synth_header_string_ids};
+
 /** String table of MRCP speech-unit fields (mrcp_speech_unit_t) */
 static const apt_str_table_item_t speech_unit_string_table[] = {
 	{{"Second",   6},2},
@@ -300,244 +305,119 @@ static void* mrcp_synth_header_allocate(mrcp_header_accessor_t *accessor, apr_po
 	return accessor->data;
 }
 
+/** Parse speech-length member */
+static void mrcp_speech_length_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	mrcp_speech_length_value_parse(member,value,pool);
+}
+
+/** Generate speech-length member */
+static void mrcp_speech_length_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	mrcp_speech_length_generate((mrcp_speech_length_value_t*)member,value,pool);
+}
+
+/** Parse voice-gender member */
+static void mrcp_voice_gender_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	*(mrcp_voice_gender_e*)member = apt_string_table_value_parse(voice_gender_string_table,VOICE_GENDER_COUNT,value);
+}
+
+/** Generate voice-gender member */
+static void mrcp_voice_gender_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	apt_string_table_value_pgenerate(
+		voice_gender_string_table,
+		VOICE_GENDER_COUNT,
+		*(const mrcp_voice_gender_e*)member,
+		value,
+		pool);
+}
+
+/** Parse prosody-volume member */
+static void mrcp_prosody_volume_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	mrcp_prosody_param_volume_parse(member,value,pool);
+}
+
+/** Generate prosody-volume member */
+static void mrcp_prosody_volume_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	mrcp_prosody_volume_generate((mrcp_prosody_volume_t*)member,value,pool);
+}
+
+/** Parse prosody-rate member */
+static void mrcp_prosody_rate_member_parse(void *member, const apt_str_t *value, apr_pool_t *pool)
+{
+	mrcp_prosody_param_rate_parse(member,value,pool);
+}
+
+/** Generate prosody-rate member */
+static void mrcp_prosody_rate_member_generate(const void *member, apt_str_t *value, apr_pool_t *pool)
+{
+	mrcp_prosody_rate_generate((mrcp_prosody_rate_t*)member,value,pool);
+}
+
+/** Descriptors of synthesizer header fields in the order of mrcp_synthesizer_header_id */
+static const mrcp_header_field_desc_t synth_header_fields[SYNTHESIZER_HEADER_COUNT] = {
+	MRCP_HEADER_FIELD_TYPED(mrcp_synth_header_t,jump_size,mrcp_speech_length_member_parse,mrcp_speech_length_member_generate),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_synth_header_t,kill_on_barge_in),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,speaker_profile),
+	MRCP_HEADER_FIELD_CUSTOM(mrcp_synth_header_t,completion_cause),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,completion_reason),
+	MRCP_HEADER_FIELD_TYPED(mrcp_synth_header_t,voice_param.gender,mrcp_voice_gender_member_parse,mrcp_voice_gender_member_generate),
+	MRCP_HEADER_FIELD_SIZE(mrcp_synth_header_t,voice_param.age),
+	MRCP_HEADER_FIELD_SIZE(mrcp_synth_header_t,voice_param.variant),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,voice_param.name),
+	MRCP_HEADER_FIELD_TYPED(mrcp_synth_header_t,prosody_param.volume,mrcp_prosody_volume_member_parse,mrcp_prosody_volume_member_generate),
+	MRCP_HEADER_FIELD_TYPED(mrcp_synth_header_t,prosody_param.rate,mrcp_prosody_rate_member_parse,mrcp_prosody_rate_member_generate),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,speech_marker),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,speech_language),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,fetch_hint),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,audio_fetch_hint),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,failed_uri),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,failed_uri_cause),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_synth_header_t,speak_restart),
+	MRCP_HEADER_FIELD_TYPED(mrcp_synth_header_t,speak_length,mrcp_speech_length_member_parse,mrcp_speech_length_member_generate),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_synth_header_t,load_lexicon),
+	MRCP_HEADER_FIELD_STRING(mrcp_synth_header_t,lexicon_search_order)
+};
+
 /** Parse MRCP synthesizer header */
 static apt_bool_t mrcp_synth_header_parse(mrcp_header_accessor_t *accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	apt_bool_t status = TRUE;
 	mrcp_synth_header_t *synth_header = accessor->data;
-	switch(id) {
-		case SYNTHESIZER_HEADER_JUMP_SIZE:
-			mrcp_speech_length_value_parse(&synth_header->jump_size,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_KILL_ON_BARGE_IN:
-			apt_boolean_value_parse(value,&synth_header->kill_on_barge_in);
-			break;
-		case SYNTHESIZER_HEADER_SPEAKER_PROFILE:
-			synth_header->speaker_profile = *value;
-			break;
-		case SYNTHESIZER_HEADER_COMPLETION_CAUSE:
-			synth_header->completion_cause = apt_size_value_parse(value);
-			break;
-		case SYNTHESIZER_HEADER_COMPLETION_REASON:
-			synth_header->completion_reason = *value;
-			break;
-		case SYNTHESIZER_HEADER_VOICE_GENDER:
-			synth_header->voice_param.gender = apt_string_table_value_parse(voice_gender_string_table,VOICE_GENDER_COUNT,value);
-			break;
-		case SYNTHESIZER_HEADER_VOICE_AGE:
-			synth_header->voice_param.age = apt_size_value_parse(value);
-			break;
-		case SYNTHESIZER_HEADER_VOICE_VARIANT:
-			synth_header->voice_param.variant = apt_size_value_parse(value);
-			break;
-		case SYNTHESIZER_HEADER_VOICE_NAME:
-			synth_header->voice_param.name = *value;
-			break;
-		case SYNTHESIZER_HEADER_PROSODY_VOLUME:
-			mrcp_prosody_param_volume_parse(&synth_header->prosody_param.volume,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_PROSODY_RATE:
-			mrcp_prosody_param_rate_parse(&synth_header->prosody_param.rate,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_SPEECH_MARKER:
-			synth_header->speech_marker = *value;
-			break;
-		case SYNTHESIZER_HEADER_SPEECH_LANGUAGE:
-			synth_header->speech_language = *value;
-			break;
-		case SYNTHESIZER_HEADER_FETCH_HINT:
-			synth_header->fetch_hint = *value;
-			break;
-		case SYNTHESIZER_HEADER_AUDIO_FETCH_HINT:
-			synth_header->audio_fetch_hint = *value;
-			break;
-		case SYNTHESIZER_HEADER_FAILED_URI:
-			synth_header->failed_uri = *value;
-			break;
-		case SYNTHESIZER_HEADER_FAILED_URI_CAUSE:
-			synth_header->failed_uri_cause = *value;
-			break;
-		case SYNTHESIZER_HEADER_SPEAK_RESTART:
-			apt_boolean_value_parse(value,&synth_header->speak_restart);
-			break;
-		case SYNTHESIZER_HEADER_SPEAK_LENGTH:
-			mrcp_speech_length_value_parse(&synth_header->speak_length,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_LOAD_LEXICON:
-			apt_boolean_value_parse(value,&synth_header->load_lexicon);
-			break;
-		case SYNTHESIZER_HEADER_LEXICON_SEARCH_ORDER:
-			synth_header->lexicon_search_order = *value;
-			break;
-		default:
-			status = FALSE;
+	if(id == SYNTHESIZER_HEADER_COMPLETION_CAUSE) {
+		synth_header->completion_cause = apt_size_value_parse(value);
+		return TRUE;
 	}
-	return status;
+	return mrcp_header_field_desc_parse(synth_header_fields,SYNTHESIZER_HEADER_COUNT,synth_header,id,value,pool);
 }
 
 /** Generate MRCP synthesizer header */
 static apt_bool_t mrcp_synth_header_generate(const mrcp_header_accessor_t *accessor, apr_size_t id, apt_str_t *value, apr_pool_t *pool)
 {
 	mrcp_synth_header_t *synth_header = accessor->data;
-	switch(id) {
-		case SYNTHESIZER_HEADER_JUMP_SIZE:
-			mrcp_speech_length_generate(&synth_header->jump_size,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_KILL_ON_BARGE_IN:
-			apt_boolean_value_generate(synth_header->kill_on_barge_in,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_SPEAKER_PROFILE:
-			*value = synth_header->speaker_profile;
-			break;
-		case SYNTHESIZER_HEADER_COMPLETION_CAUSE:
-			apt_completion_cause_generate(
-				completion_cause_string_table,
-				SYNTHESIZER_COMPLETION_CAUSE_COUNT,
-				synth_header->completion_cause,
-				value,
-				pool);
-			break;
-		case SYNTHESIZER_HEADER_COMPLETION_REASON:
-			*value = synth_header->completion_reason;
-			break;
-		case SYNTHESIZER_HEADER_VOICE_GENDER:
-			apt_string_table_value_pgenerate(
-				voice_gender_string_table,
-				VOICE_GENDER_COUNT,
-				synth_header->voice_param.gender,
-				value,
-				pool);
-			break;
-		case SYNTHESIZER_HEADER_VOICE_AGE:
-			apt_size_value_generate(synth_header->voice_param.age,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_VOICE_VARIANT:
-			apt_size_value_generate(synth_header->voice_param.variant,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_VOICE_NAME:
-			*value = synth_header->voice_param.name;
-			break;
-		case SYNTHESIZER_HEADER_PROSODY_VOLUME:
-			mrcp_prosody_volume_generate(&synth_header->prosody_param.volume,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_PROSODY_RATE:
-			mrcp_prosody_rate_generate(&synth_header->prosody_param.rate,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_SPEECH_MARKER:
-			*value = synth_header->speech_marker;
-			break;
-		case SYNTHESIZER_HEADER_SPEECH_LANGUAGE:
-			*value = synth_header->speech_language;
-			break;
-		case SYNTHESIZER_HEADER_FETCH_HINT:
-			*value = synth_header->fetch_hint;
-			break;
-		case SYNTHESIZER_HEADER_AUDIO_FETCH_HINT:
-			*value = synth_header->audio_fetch_hint;
-			break;
-		case SYNTHESIZER_HEADER_FAILED_URI:
-			*value = synth_header->failed_uri;
-			break;
-		case SYNTHESIZER_HEADER_FAILED_URI_CAUSE:
-			*value = synth_header->failed_uri_cause;
-			break;
-		case SYNTHESIZER_HEADER_SPEAK_RESTART:
-			apt_boolean_value_generate(synth_header->speak_restart,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_SPEAK_LENGTH:
-			mrcp_speech_length_generate(&synth_header->speak_length,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_LOAD_LEXICON:
-			apt_boolean_value_generate(synth_header->load_lexicon,value,pool);
-			break;
-		case SYNTHESIZER_HEADER_LEXICON_SEARCH_ORDER:
-			*value = synth_header->lexicon_search_order;
-			break;
-		default:
-			break;
+	if(id == SYNTHESIZER_HEADER_COMPLETION_CAUSE) {
+		apt_completion_cause_generate(
+			completion_cause_string_table,
+			SYNTHESIZER_COMPLETION_CAUSE_COUNT,
+			synth_header->completion_cause,
+			value,
+			pool);
+		return TRUE;
 	}
+	mrcp_header_field_desc_generate(synth_header_fields,SYNTHESIZER_HEADER_COUNT,synth_header,id,value,pool);
 	return TRUE;
 }
 
 /** Duplicate MRCP synthesizer header */
 static apt_bool_t mrcp_synth_header_duplicate(mrcp_header_accessor_t *accessor, const mrcp_header_accessor_t *src, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	mrcp_synth_header_t *synth_header = accessor->data;
-	const mrcp_synth_header_t *src_synth_header = src->data;
-	apt_bool_t status = TRUE;
-
-	if(!synth_header || !src_synth_header) {
+	if(!accessor->data || !src->data) {
 		return FALSE;
 	}
-
-	switch(id) {
-		case SYNTHESIZER_HEADER_JUMP_SIZE:
-			synth_header->jump_size = src_synth_header->jump_size;
-			break;
-		case SYNTHESIZER_HEADER_KILL_ON_BARGE_IN:
-			synth_header->kill_on_barge_in = src_synth_header->kill_on_barge_in;
-			break;
-		case SYNTHESIZER_HEADER_SPEAKER_PROFILE:
-			synth_header->speaker_profile = *value;
-			break;
-		case SYNTHESIZER_HEADER_COMPLETION_CAUSE:
-			synth_header->completion_cause = src_synth_header->completion_cause;
-			break;
-		case SYNTHESIZER_HEADER_COMPLETION_REASON:
-			synth_header->completion_reason = *value;
-			break;
-		case SYNTHESIZER_HEADER_VOICE_GENDER:
-			synth_header->voice_param.gender = src_synth_header->voice_param.gender;
-			break;
-		case SYNTHESIZER_HEADER_VOICE_AGE:
-			synth_header->voice_param.age = src_synth_header->voice_param.age;
-			break;
-		case SYNTHESIZER_HEADER_VOICE_VARIANT:
-			synth_header->voice_param.variant = src_synth_header->voice_param.variant;
-			break;
-		case SYNTHESIZER_HEADER_VOICE_NAME:
-			synth_header->voice_param.name = *value;
-			break;
-		case SYNTHESIZER_HEADER_PROSODY_VOLUME:
-			synth_header->prosody_param.volume = src_synth_header->prosody_param.volume;
-			break;
-		case SYNTHESIZER_HEADER_PROSODY_RATE:
-			synth_header->prosody_param.rate = src_synth_header->prosody_param.rate;
-			break;
-		case SYNTHESIZER_HEADER_SPEECH_MARKER:
-			synth_header->speech_marker = *value;
-			break;
-		case SYNTHESIZER_HEADER_SPEECH_LANGUAGE:
-			synth_header->speech_language = *value;
-			break;
-		case SYNTHESIZER_HEADER_FETCH_HINT:
-			synth_header->fetch_hint = *value;
-			break;
-		case SYNTHESIZER_HEADER_AUDIO_FETCH_HINT:
-			synth_header->audio_fetch_hint = *value;
-			break;
-		case SYNTHESIZER_HEADER_FAILED_URI:
-			synth_header->failed_uri = *value;
-			break;
-		case SYNTHESIZER_HEADER_FAILED_URI_CAUSE:
-			synth_header->failed_uri_cause = *value;
-			break;
-		case SYNTHESIZER_HEADER_SPEAK_RESTART:
-			synth_header->speak_restart = src_synth_header->speak_restart;
-			break;
-		case SYNTHESIZER_HEADER_SPEAK_LENGTH:
-			synth_header->speak_length = src_synth_header->speak_length;
-			break;
-		case SYNTHESIZER_HEADER_LOAD_LEXICON:
-			synth_header->load_lexicon = src_synth_header->load_lexicon;
-			break;
-		case SYNTHESIZER_HEADER_LEXICON_SEARCH_ORDER:
-			synth_header->lexicon_search_order = *value;
-			break;
-		default:
-			status = FALSE;
-	}
-	return status;
+	return mrcp_header_field_desc_duplicate(synth_header_fields,SYNTHESIZER_HEADER_COUNT,accessor->data,src->data,id,value);
 }
 
 static const mrcp_header_vtable_t vtable = {
@@ -547,7 +427,8 @@ static const mrcp_header_vtable_t vtable = {
 	mrcp_synth_header_generate,
 	mrcp_synth_header_duplicate,
 	synth_header_string_table,
-	SYNTHESIZER_HEADER_COUNT
+	SYNTHESIZER_HEADER_COUNT,
+	&synth_header_string_index
 };
 
 const mrcp_header_vtable_t* mrcp_synth_header_vtable_get(mrcp_version_e version)
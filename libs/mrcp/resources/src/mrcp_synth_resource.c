@@ -31,22 +31,42 @@ static const apt_str_table_item_t synth_method_string_table[] = {
 	{{"DEFINE-LEXICON",   14},0}
 };
 
+/** Perfect hash index of MRCP synthesizer methods (generated by strtablegen) */
+static const apr_int32_t synth_method_string_buckets[] = {0,0,-4,1,-9,0,0,1,7};
+static const apr_size_t synth_method_string_ids[] = {8,5,0,4,2,1,3,7,6};
+static const apt_str_table_index_t synth_method_string_index = {synth_method_string_buckets,synth_method_string_ids};
+
 /** String table of MRCP synthesizer events (mrcp_synthesizer_event_id) */
 static const apt_str_table_item_t synth_event_string_table[] = {
 	{{"SPEECH-MARKER", 13},3},
 	{{"SPEAK-COMPLETE",14},3}
 };
 
+/** Perfect hash index of MRCP synthesizer events (generated by strtablegen) */
+static const apr_int32_t synth_event_string_buckets[] = {1,0};
+static const apr_size_t synth_event_string_ids[] = {0,1};
+static const apt_str_table_index_t synth_event_string_index = {synth_event_string_buckets,synth_event_string_ids};
+
 static APR_INLINE const apt_str_table_item_t* synth_method_string_table_get(mrcp_version_e version)
 {
 	return synth_method_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* synth_method_string_index_get(mrcp_version_e version)
+{
+	return &synth_method_string_index;
+}
+
 static APR_INLINE const apt_str_table_item_t* synth_event_string_table_get(mrcp_version_e version)
 {
 	return synth_event_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* synth_event_string_index_get(mrcp_version_e version)
+{
+	return &synth_event_string_index;
+}
+
 /** Create MRCP synthesizer resource */
 MRCP_DECLARE(mrcp_resource_t*) mrcp_synth_resource_create(apr_pool_t *pool)
 {
@@ -55,7 +75,9 @@ MRCP_DECLARE(mrcp_resource_t*) mrcp_synth_resource_create(apr_pool_t *pool)
 	resource->method_count = SYNTHESIZER_METHOD_COUNT;
 	resource->event_count = SYNTHESIZER_EVENT_COUNT;
 	resource->get_method_str_table = synth_method_string_table_get;
+	resource->get_method_str_index = synth_method_string_index_get;
 	resource->get_event_str_table = synth_event_string_table_get;
+	resource->get_event_str_index = synth_event_string_index_get;
 	resource->get_resource_header_vtable = mrcp_synth_header_vtable_get;
 	return resource;
 }
@@ -41,6 +41,11 @@ static const apt_str_table_item_t verifier_header_string_table[] = {
 	{{"Start-Input-Timers",          18},1}
 };
 
+/** Perfect hash index of MRCP verifier header fields (generated by strtablegen) */
+static const apr_int32_t verifier_header_string_buckets[] = {-13,0,0,3,2,-15,1,0,0,1,0,0,-16,0,0,-17,3,11,28,0,0};
+static const apr_size_t verifier_header_string_ids[] = {5,13,1,4,7,3,12,9,17,11,0,14,6,15,8,10,20,19,18,16,2};
+static const apt_str_table_index_t verifier_header_string_index = {verifier_header_string_buckets,verifier_header_string_ids};
+
 /** String table of MRCP verifier completion-cause fields (mrcp_verifier_completion_cause_e) */
 static const apt_str_table_item_t completion_cause_string_table[] = {
 	{{"success",                 7},2},
@@ -93,239 +98,66 @@ static void* mrcp_verifier_header_allocate(mrcp_header_accessor_t *accessor, apr
 	return accessor->data;
 }
 
+/** Descriptors of verifier header fields in the order of mrcp_verifier_header_id */
+static const mrcp_header_field_desc_t verifier_header_fields[VERIFIER_HEADER_COUNT] = {
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,repository_uri),
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,voiceprint_identifier),
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,verification_mode),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,adapt_model),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,abort_model),
+	MRCP_HEADER_FIELD_FLOAT(mrcp_verifier_header_t,min_verification_score),
+	MRCP_HEADER_FIELD_SIZE(mrcp_verifier_header_t,num_min_verification_phrases),
+	MRCP_HEADER_FIELD_SIZE(mrcp_verifier_header_t,num_max_verification_phrases),
+	MRCP_HEADER_FIELD_SIZE(mrcp_verifier_header_t,no_input_timeout),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,save_waveform),
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,media_type),
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,waveform_uri),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,voiceprint_exists),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,ver_buffer_utterance),
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,input_waveform_uri),
+	MRCP_HEADER_FIELD_CUSTOM(mrcp_verifier_header_t,completion_cause),
+	MRCP_HEADER_FIELD_STRING(mrcp_verifier_header_t,completion_reason),
+	MRCP_HEADER_FIELD_SIZE(mrcp_verifier_header_t,speech_complete_timeout),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,new_audio_channel),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,abort_verification),
+	MRCP_HEADER_FIELD_BOOLEAN(mrcp_verifier_header_t,start_input_timers)
+};
+
 /** Parse MRCP verifier header */
 static apt_bool_t mrcp_verifier_header_parse(mrcp_header_accessor_t *accessor, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
 	mrcp_verifier_header_t *verifier_header = accessor->data;
-	apt_bool_t status = TRUE;
-	switch(id) {
-		case VERIFIER_HEADER_REPOSITORY_URI:
-			verifier_header->repository_uri = *value;
-			break;
-		case VERIFIER_HEADER_VOICEPRINT_IDENTIFIER:
-			verifier_header->voiceprint_identifier = *value;
-			break;
-		case VERIFIER_HEADER_VERIFICATION_MODE:
-			verifier_header->verification_mode = *value;
-			break;
-		case VERIFIER_HEADER_ADAPT_MODEL:
-			apt_boolean_value_parse(value,&verifier_header->adapt_model);
-			break;
-		case VERIFIER_HEADER_ABORT_MODEL:
-			apt_boolean_value_parse(value,&verifier_header->abort_model);
-			break;
-		case VERIFIER_HEADER_MIN_VERIFICATION_SCORE:
-			verifier_header->min_verification_score = apt_float_value_parse(value);
-			break;
-		case VERIFIER_HEADER_NUM_MIN_VERIFICATION_PHRASES:
-			verifier_header->num_min_verification_phrases = apt_size_value_parse(value);
-			break;
-		case VERIFIER_HEADER_NUM_MAX_VERIFICATION_PHRASES:
-			verifier_header->num_max_verification_phrases = apt_size_value_parse(value);
-			break;
-		case VERIFIER_HEADER_NO_INPUT_TIMEOUT:
-			verifier_header->no_input_timeout = apt_size_value_parse(value);
-			break;
-		case VERIFIER_HEADER_SAVE_WAVEFORM:
-			apt_boolean_value_parse(value,&verifier_header->save_waveform);
-			break;
-		case VERIFIER_HEADER_MEDIA_TYPE:
-			verifier_header->media_type = *value;
-			break;
-		case VERIFIER_HEADER_WAVEFORM_URI:
-			verifier_header->waveform_uri = *value;
-			break;
-		case VERIFIER_HEADER_VOICEPRINT_EXISTS:
-			apt_boolean_value_parse(value,&verifier_header->voiceprint_exists);
-			break;
-		case VERIFIER_HEADER_VER_BUFFER_UTTERANCE:
-			apt_boolean_value_parse(value,&verifier_header->ver_buffer_utterance);
-			break;
-		case VERIFIER_HEADER_INPUT_WAVEFORM_URI:
-			verifier_header->input_waveform_uri = *value;
-			break;
-		case VERIFIER_HEADER_COMPLETION_CAUSE:
-			verifier_header->completion_cause = apt_size_value_parse(value);
-			break;
-		case VERIFIER_HEADER_COMPLETION_REASON:
-			verifier_header->completion_reason = *value;
-			break;
-		case VERIFIER_HEADER_SPEECH_COMPLETE_TIMEOUT:
-			verifier_header->speech_complete_timeout = apt_size_value_parse(value);
-			break;
-		case VERIFIER_HEADER_NEW_AUDIO_CHANNEL:
-			apt_boolean_value_parse(value,&verifier_header->new_audio_channel);
-			break;
-		case VERIFIER_HEADER_ABORT_VERIFICATION:
-			apt_boolean_value_parse(value,&verifier_header->abort_verification);
-			break;
-		case VERIFIER_HEADER_START_INPUT_TIMERS:
-			apt_boolean_value_parse(value,&verifier_header->start_input_timers);
-			break;
-		default:
-			status = FALSE;
+	if(id == VERIFIER_HEADER_COMPLETION_CAUSE) {
+		verifier_header->completion_cause = apt_size_value_parse(value);
+		return TRUE;
 	}
-	return status;
+	return mrcp_header_field_desc_parse(verifier_header_fields,VERIFIER_HEADER_COUNT,verifier_header,id,value,pool);
 }
 
 /** Generate MRCP verifier header */
 static apt_bool_t mrcp_verifier_header_generate(const mrcp_header_accessor_t *accessor, apr_size_t id, apt_str_t *value, apr_pool_t *pool)
 {
 	mrcp_verifier_header_t *verifier_header = accessor->data;
-	switch(id) {
-		case VERIFIER_HEADER_REPOSITORY_URI:
-			*value = verifier_header->repository_uri;
-			break;
-		case VERIFIER_HEADER_VOICEPRINT_IDENTIFIER:
-			*value = verifier_header->voiceprint_identifier;
-			break;
-		case VERIFIER_HEADER_VERIFICATION_MODE:
-			*value = verifier_header->verification_mode;
-			break;
-		case VERIFIER_HEADER_ADAPT_MODEL:
-			apt_boolean_value_generate(verifier_header->adapt_model,value,pool);
-			break;
-		case VERIFIER_HEADER_ABORT_MODEL:
-			apt_boolean_value_generate(verifier_header->abort_model,value,pool);
-			break;
-		case VERIFIER_HEADER_MIN_VERIFICATION_SCORE:
-			apt_float_value_generate(verifier_header->min_verification_score,value,pool);
-			break;
-		case VERIFIER_HEADER_NUM_MIN_VERIFICATION_PHRASES:
-			apt_size_value_generate(verifier_header->num_min_verification_phrases,value,pool);
-			break;
-		case VERIFIER_HEADER_NUM_MAX_VERIFICATION_PHRASES:
-			apt_size_value_generate(verifier_header->num_max_verification_phrases,value,pool);
-			break;
-		case VERIFIER_HEADER_NO_INPUT_TIMEOUT:
-			apt_size_value_generate(verifier_header->no_input_timeout,value,pool);
-			break;
-		case VERIFIER_HEADER_SAVE_WAVEFORM:
-			apt_boolean_value_generate(verifier_header->save_waveform,value,pool);
-			break;
-		case VERIFIER_HEADER_MEDIA_TYPE:
-			*value = verifier_header->media_type;
-			break;
-		case VERIFIER_HEADER_WAVEFORM_URI:
-			*value = verifier_header->waveform_uri;
-			break;
-		case VERIFIER_HEADER_VOICEPRINT_EXISTS:
-			apt_boolean_value_generate(verifier_header->voiceprint_exists,value,pool);
-			break;
-		case VERIFIER_HEADER_VER_BUFFER_UTTERANCE:
-			apt_boolean_value_generate(verifier_header->ver_buffer_utterance,value,pool);
-			break;
-		case VERIFIER_HEADER_INPUT_WAVEFORM_URI:
-			*value = verifier_header->input_waveform_uri;
-			break;
-		case VERIFIER_HEADER_COMPLETION_CAUSE:
-			apt_completion_cause_generate(
-				completion_cause_string_table,
-				VERIFIER_COMPLETION_CAUSE_COUNT,
-				verifier_header->completion_cause,
-				value,
-				pool);
-			break;
-		case VERIFIER_HEADER_COMPLETION_REASON:
-			*value = verifier_header->completion_reason;
-			break;
-		case VERIFIER_HEADER_SPEECH_COMPLETE_TIMEOUT:
-			apt_size_value_generate(verifier_header->speech_complete_timeout,value,pool);
-			break;
-		case VERIFIER_HEADER_NEW_AUDIO_CHANNEL:
-			apt_boolean_value_generate(verifier_header->new_audio_channel,value,pool);
-			break;
-		case VERIFIER_HEADER_ABORT_VERIFICATION:
-			apt_boolean_value_generate(verifier_header->abort_verification,value,pool);
-			break;
-		case VERIFIER_HEADER_START_INPUT_TIMERS:
-			apt_boolean_value_generate(verifier_header->start_input_timers,value,pool);
-			break;
-		default:
-			break;
+	if(id == VERIFIER_HEADER_COMPLETION_CAUSE) {
+		apt_completion_cause_generate(
+			completion_cause_string_table,
+			VERIFIER_COMPLETION_CAUSE_COUNT,
+			verifier_header->completion_cause,
+			value,
+			pool);
+		return TRUE;
 	}
+	mrcp_header_field_desc_generate(verifier_header_fields,VERIFIER_HEADER_COUNT,verifier_header,id,value,pool);
 	return TRUE;
 }
 
 /** Duplicate MRCP verifier header */
 static apt_bool_t mrcp_verifier_header_duplicate(mrcp_header_accessor_t *accessor, const mrcp_header_accessor_t *src, apr_size_t id, const apt_str_t *value, apr_pool_t *pool)
 {
-	mrcp_verifier_header_t *verifier_header = accessor->data;
-	const mrcp_verifier_header_t *src_verifier_header = src->data;
-	apt_bool_t status = TRUE;
-
-	if(!verifier_header || !src_verifier_header) {
+	if(!accessor->data || !src->data) {
 		return FALSE;
 	}
-	
-	switch(id) {
-		case VERIFIER_HEADER_REPOSITORY_URI:
-			verifier_header->repository_uri = *value;
-			break;
-		case VERIFIER_HEADER_VOICEPRINT_IDENTIFIER:
-			verifier_header->voiceprint_identifier = *value;
-			break;
-		case VERIFIER_HEADER_VERIFICATION_MODE:
-			verifier_header->verification_mode = *value;
-			break;
-		case VERIFIER_HEADER_ADAPT_MODEL:
-			verifier_header->adapt_model = src_verifier_header->adapt_model;
-			break;
-		case VERIFIER_HEADER_ABORT_MODEL:
-			verifier_header->abort_model = src_verifier_header->abort_model;
-			break;
-		case VERIFIER_HEADER_MIN_VERIFICATION_SCORE:
-			verifier_header->min_verification_score = src_verifier_header->min_verification_score;
-			break;
-		case VERIFIER_HEADER_NUM_MIN_VERIFICATION_PHRASES:
-			verifier_header->num_min_verification_phrases = src_verifier_header->num_min_verification_phrases;
-			break;
-		case VERIFIER_HEADER_NUM_MAX_VERIFICATION_PHRASES:
-			verifier_header->num_max_verification_phrases = src_verifier_header->num_max_verification_phrases;
-			break;
-		case VERIFIER_HEADER_NO_INPUT_TIMEOUT:
-			verifier_header->no_input_timeout = src_verifier_header->no_input_timeout;
-			break;
-		case VERIFIER_HEADER_SAVE_WAVEFORM:
-			verifier_header->save_waveform = src_verifier_header->save_waveform;
-			break;
-		case VERIFIER_HEADER_MEDIA_TYPE:
-			verifier_header->media_type = *value;
-			break;
-		case VERIFIER_HEADER_WAVEFORM_URI:
-			verifier_header->waveform_uri = *value;
-			break;
-		case VERIFIER_HEADER_VOICEPRINT_EXISTS:
-			verifier_header->voiceprint_exists = src_verifier_header->voiceprint_exists;
-			break;
-		case VERIFIER_HEADER_VER_BUFFER_UTTERANCE:
-			verifier_header->ver_buffer_utterance = src_verifier_header->ver_buffer_utterance;
-			break;
-		case VERIFIER_HEADER_INPUT_WAVEFORM_URI:
-			verifier_header->input_waveform_uri = *value;
-			break;
-		case VERIFIER_HEADER_COMPLETION_CAUSE:
-			verifier_header->completion_cause = src_verifier_header->completion_cause;
-			break;
-		case VERIFIER_HEADER_COMPLETION_REASON:
-			verifier_header->completion_reason = *value;
-			break;
-		case VERIFIER_HEADER_SPEECH_COMPLETE_TIMEOUT:
-			verifier_header->speech_complete_timeout = src_verifier_header->speech_complete_timeout;
-			break;
-		case VERIFIER_HEADER_NEW_AUDIO_CHANNEL:
-			verifier_header->new_audio_channel = src_verifier_header->new_audio_channel;
-			break;
-		case VERIFIER_HEADER_ABORT_VERIFICATION:
-			verifier_header->abort_verification = src_verifier_header->abort_verification;
-			break;
-		case VERIFIER_HEADER_START_INPUT_TIMERS:
-			verifier_header->start_input_timers = src_verifier_header->start_input_timers;
-			break;
-		default:
-			status = FALSE;
-	}
-	return status;
+	return mrcp_header_field_desc_duplicate(verifier_header_fields,VERIFIER_HEADER_COUNT,accessor->data,src->data,id,value);
 }
 
 static const mrcp_header_vtable_t header_vtable = {
@@ -335,7 +167,8 @@ static const mrcp_header_vtable_t header_vtable = {
 	mrcp_verifier_header_generate,
 	mrcp_verifier_header_duplicate,
 	verifier_header_string_table,
-	VERIFIER_HEADER_COUNT
+	VERIFIER_HEADER_COUNT,
+	&verifier_header_string_index
 };
 
 const mrcp_header_vtable_t* mrcp_verifier_header_vtable_get(mrcp_version_e version)
@@ -35,22 +35,42 @@ static const apt_str_table_item_t verifier_method_string_table[] = {
 	{{"GET-INTERMEDIATE-RESULT",23},4},
 };
 
+/** Perfect hash index of MRCP verifier methods (generated by strtablegen) */
+static const apr_int32_t verifier_method_string_buckets[] = {-4,0,0,0,0,-1,0,-13,-10,1,-11,3,7};
+static const apr_size_t verifier_method_string_ids[] = {0,4,10,2,8,12,3,11,1,5,6,9,7};
+static const apt_str_table_index_t verifier_method_string_index = {verifier_method_string_buckets,verifier_method_string_ids};
+
 /** String table of MRCP verifier events (mrcp_verifier_event_id) */
 static const apt_str_table_item_t verifier_event_string_table[] = {
 	{{"START-OF-INPUT",       14},0},
 	{{"VERIFICATION-COMPLETE",21},0},
 };
 
+/** Perfect hash index of MRCP verifier events (generated by strtablegen) */
+static const apr_int32_t verifier_event_string_buckets[] = {0,8};
+static const apr_size_t verifier_event_string_ids[] = {1,0};
+static const apt_str_table_index_t verifier_event_string_index = {verifier_event_string_buckets,verifier_event_string_ids};
+
 static APR_INLINE const apt_str_table_item_t* verifier_method_string_table_get(mrcp_version_e version)
 {
 	return verifier_method_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* verifier_method_string_index_get(mrcp_version_e version)
+{
+	return &verifier_method_string_index;
+}
+
 static APR_INLINE const apt_str_table_item_t* verifier_event_string_table_get(mrcp_version_e version)
 {
 	return verifier_event_string_table;
 }
 
+static APR_INLINE const apt_str_table_index_t* verifier_event_string_index_get(mrcp_version_e version)
+{
+	return &verifier_event_string_index;
+}
+
 
 /** Create MRCP verifier resource */
 MRCP_DECLARE(mrcp_resource_t*) mrcp_verifier_resource_create(apr_pool_t *pool)
@@ -60,7 +80,9 @@ MRCP_DECLARE(mrcp_resource_t*) mrcp_verifier_resource_create(apr_pool_t *pool)
 	resource->method_count = VERIFIER_METHOD_COUNT;
 	resource->event_count = VERIFIER_EVENT_COUNT;
 	resource->get_method_str_table = verifier_method_string_table_get;
+	resource->get_method_str_index = verifier_method_string_index_get;
 	resource->get_event_str_table = verifier_event_string_table_get;
+	resource->get_event_str_index = verifier_event_string_index_get;
 	resource->get_resource_header_vtable = mrcp_verifier_header_vtable_get;
 	return resource;
 }
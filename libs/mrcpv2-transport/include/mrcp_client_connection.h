@@ -40,6 +40,22 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_client_connection_agent_create(
 											apt_bool_t offer_new_connection,
 											apr_pool_t *pool);
 
+/**
+ * Create connection agent with the specified number of threads.
+ * @param id the identifier of the agent
+ * @param max_connection_count the number of max MRCPv2 connections per thread
+ * @param offer_new_connection the connection establishment policy in o/a
+ * @param thread_count the number of poller threads, channels are dispatched round-robin
+ * @param pool the pool to allocate memory from
+ * @remark Each channel and its connection stay on the thread the channel is dispatched to.
+ */
+MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_client_connection_agent_create_ex(
+											const char *id,
+											apr_size_t max_connection_count,
+											apt_bool_t offer_new_connection,
+											apr_size_t thread_count,
+											apr_pool_t *pool);
+
 /**
  * Destroy connection agent.
  * @param agent the agent to destroy
@@ -114,12 +130,54 @@ MRCP_DECLARE(void) mrcp_client_connection_timeout_set(
 								mrcp_connection_agent_t *agent,
 								apr_size_t timeout);
 
+/**
+ * Set pool of warm MRCPv2 connections.
+ * @param agent the agent to set the pool for
+ * @param idle_count the number of idle connections to keep established per server (0 disables the pool)
+ * @param max_idle_time the time in seconds an idle connection is recycled after (0 never recycles)
+ * @param check_interval the interval in seconds the idle connections are checked and replenished at
+ * @remark Servers are learned from the connections established for control channels
+ * and may also be added in advance by mrcp_client_connection_pool_target_add().
+ * Control channels are added onto an idle connection, if there is any to the server,
+ * instead of establishing a new one. The max idle time should be below the inactivity
+ * timeout of the server.
+ */
+MRCP_DECLARE(void) mrcp_client_connection_pool_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t idle_count,
+								apr_size_t max_idle_time,
+								apr_size_t check_interval);
+
+/**
+ * Add server to establish warm MRCPv2 connections to on start.
+ * @param agent the agent to add server to
+ * @param ip the IP address of the server
+ * @param port the MRCPv2 port of the server
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_client_connection_pool_target_add(
+								mrcp_connection_agent_t *agent,
+								const char *ip,
+								apr_port_t port);
+
 /**
  * Get task.
  * @param agent the agent to get task from
  */
 MRCP_DECLARE(apt_task_t*) mrcp_client_connection_agent_task_get(const mrcp_connection_agent_t *agent);
 
+/**
+ * Get the number of poller threads.
+ * @param agent the agent to get the number of threads of
+ */
+MRCP_DECLARE(apr_size_t) mrcp_client_connection_agent_thread_count_get(const mrcp_connection_agent_t *agent);
+
+/**
+ * Get task of the specified poller thread.
+ * @param agent the agent to get task from
+ * @param index the index of the thread, 0 is the main task
+ */
+MRCP_DECLARE(apt_task_t*) mrcp_client_connection_agent_thread_task_get(const mrcp_connection_agent_t *agent, apr_size_t index);
+
 /**
  * Get external object.
  * @param agent the agent to get object from
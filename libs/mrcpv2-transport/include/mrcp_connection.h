@@ -35,6 +35,13 @@ APT_BEGIN_EXTERN_C
 
 /** Size of the buffer used for MRCP rx/tx stream */
 #define MRCP_STREAM_BUFFER_SIZE 1024
+/** Max size the rx buffer may grow up to in order to fit an incomplete start-line or header field */
+#define MRCP_STREAM_BUFFER_MAX_SIZE (64 * 1024)
+/** Max number of messages coalesced into a single vectored write */
+#define MRCP_CONNECTION_MAX_COALESCED_MESSAGES 16
+
+/** MRCP message handler raised for each parsed message */
+typedef apt_bool_t (*mrcp_connection_message_handler_f)(mrcp_connection_t *connection, mrcp_message_t *message, apt_message_status_e status);
 
 /** MRCPv2 connection */
 struct mrcp_connection_t {
@@ -64,11 +71,15 @@ struct mrcp_connection_t {
 	apr_size_t        access_count;
 	/** Usage count */
 	apr_size_t        use_count;
-	/** Opaque agent */
+	/** Opaque agent (the agent thread the connection is affine to) */
 	void             *agent;
 
 	/** Table of control channels */
 	apr_hash_t       *channel_table;
+	/** Next connection to the same remote IP (server agent index) */
+	mrcp_connection_t *peer_next;
+	/** Previous connection to the same remote IP (server agent index) */
+	mrcp_connection_t *peer_prev;
 
 	/** Rx buffer */
 	char             *rx_buffer;
@@ -85,11 +96,19 @@ struct mrcp_connection_t {
 	apr_size_t        tx_buffer_size;
 	/** MRCP generator */
 	mrcp_generator_t *generator;
+	/** Messages (mrcp_message_t*) queued to be sent at once (server agent) */
+	apr_array_header_t *tx_queue;
+	/** Next connection having messages queued (server agent) */
+	mrcp_connection_t *tx_next;
+	/** Time the first of the queued messages has been queued at (server agent) */
+	apr_time_t        tx_time;
 
 	/** Inactivity timer  */
 	apt_timer_t      *inactivity_timer;
 	/** Termination timer  */
 	apt_timer_t      *termination_timer;
+	/** Time the connection has been idle since (client pool of warm connections) */
+	apr_time_t        idle_time;
 };
 
 /** Create MRCP connection. */
@@ -110,6 +129,39 @@ apt_bool_t mrcp_connection_channel_remove(mrcp_connection_t *connection, mrcp_co
 /** Raise disconnect event for each channel from the specified connection. */
 apt_bool_t mrcp_connection_disconnect_raise(mrcp_connection_t *connection, const mrcp_connection_event_vtable_t *vtable);
 
+/**
+ * Receive available data and parse it, raising the handler for each message.
+ * @param connection the connection to receive data from
+ * @param handler the handler to raise
+ * @return APR_SUCCESS on success, APR_EOF if the peer has disconnected or the data cannot be received
+ * @remark The rest of a message body is received in place, if nothing else is buffered,
+ * and the rx buffer grows up to MRCP_STREAM_BUFFER_MAX_SIZE, if filled up by an incomplete line.
+ */
+apr_status_t mrcp_connection_receive(mrcp_connection_t *connection, mrcp_connection_message_handler_f handler);
+
+/**
+ * Send MRCP message.
+ * @param connection the connection to send message through
+ * @param message the message to send
+ * @param log_obj the external logger object
+ * @remark The start-line and header section are generated into the tx buffer and sent
+ * along with the body by a single vectored write. The message is generated chunk by chunk
+ * through the tx buffer instead, if its header section does not fit the buffer.
+ */
+apt_bool_t mrcp_connection_message_send(mrcp_connection_t *connection, mrcp_message_t *message, void *log_obj);
+
+/**
+ * Send MRCP messages in order.
+ * @param connection the connection to send messages through
+ * @param messages the messages to send
+ * @param count the number of messages
+ * @param log_obj the external logger object
+ * @remark The start-lines and header sections are generated one after another into the tx
+ * buffer and sent along with the bodies by a single vectored write, as long as they fit the
+ * buffer and up to MRCP_CONNECTION_MAX_COALESCED_MESSAGES messages per write.
+ */
+apt_bool_t mrcp_connection_messages_send(mrcp_connection_t *connection, mrcp_message_t **messages, apr_size_t count, void *log_obj);
+
 APT_END_EXTERN_C
 
 #endif /* MRCP_CONNECTION_H */
@@ -44,6 +44,27 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 										apt_bool_t force_new_connection,
 										apr_pool_t *pool);
 
+/**
+ * Create connection agent running the specified number of poller threads.
+ * @param id the identifier of the engine
+ * @param listen_ip the IP address to listen on
+ * @param listen_port the port to listen on
+ * @param max_connection_count the number of max MRCPv2 connections per thread
+ * @param force_new_connection the policy used in o/a for connection establishment
+ * @param thread_count the number of poller threads
+ * @param pool the pool to allocate memory from
+ * @remark Each thread listens on its own SO_REUSEPORT socket and processes the connections it accepts.
+ * If SO_REUSEPORT is not supported, a single thread is used.
+ */
+MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create_ex(
+										const char *id,
+										const char *listen_ip, 
+										apr_port_t listen_port, 
+										apr_size_t max_connection_count,
+										apt_bool_t force_new_connection,
+										apr_size_t thread_count,
+										apr_pool_t *pool);
+
 /**
  * Destroy connection agent.
  * @param agent the agent to destroy
@@ -62,6 +83,12 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_start(mrcp_connection_agen
  */
 MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_terminate(mrcp_connection_agent_t *agent);
 
+/**
+ * Stop accepting new connections, the established ones are kept.
+ * @param agent the agent to stop listening of
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_listen_stop(mrcp_connection_agent_t *agent);
+
 /**
  * Set connection event handler.
  * @param agent the agent to set event hadler for
@@ -127,12 +154,57 @@ MRCP_DECLARE(void) mrcp_server_connection_term_timeout_set(
 								mrcp_connection_agent_t *agent,
 								apr_size_t timeout);
 
+/**
+ * Enable or disable lazy parsing of header fields of received messages.
+ * @param agent the agent to set the parameter for
+ * @param lazy whether to parse field values on first access only
+ */
+MRCP_DECLARE(void) mrcp_server_connection_lazy_parse_set(
+								mrcp_connection_agent_t *agent,
+								apt_bool_t lazy);
+
+/**
+ * Enable interning of bodies of received messages, so that byte-identical bodies are kept once.
+ * @param agent the agent to set the parameter for
+ * @param min_size the min size of the body to intern
+ * @param max_size the max size of the body to intern
+ * @remark The messages then reference the interned bodies read-only, see mrcp_body_store.h
+ */
+MRCP_DECLARE(apt_bool_t) mrcp_server_connection_body_interning_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t min_size,
+								apr_size_t max_size);
+
+/**
+ * Set cork window, the time messages queued to a connection are held back for to be sent at once.
+ * @param agent the agent to set the parameter for
+ * @param window the cork window in usec (0 - messages are sent at the end of each poll iteration)
+ * @remark Held back messages are sent by timer of msec resolution, and are sent right away
+ * once MRCP_CONNECTION_MAX_COALESCED_MESSAGES messages are queued.
+ */
+MRCP_DECLARE(void) mrcp_server_connection_cork_window_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t window);
+
 /**
  * Get task.
  * @param agent the agent to get task from
  */
 MRCP_DECLARE(apt_task_t*) mrcp_server_connection_agent_task_get(const mrcp_connection_agent_t *agent);
 
+/**
+ * Get number of poller threads.
+ * @param agent the agent to get the number of threads of
+ */
+MRCP_DECLARE(apr_size_t) mrcp_server_connection_agent_thread_count_get(const mrcp_connection_agent_t *agent);
+
+/**
+ * Get task of the specified poller thread.
+ * @param agent the agent to get task from
+ * @param index the index of the thread, the task of the first one is the main task
+ */
+MRCP_DECLARE(apt_task_t*) mrcp_server_connection_agent_thread_task_get(const mrcp_connection_agent_t *agent, apr_size_t index);
+
 /**
  * Get external object.
  * @param agent the agent to get object from
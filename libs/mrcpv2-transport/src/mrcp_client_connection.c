@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <apr_atomic.h>
 #include "mrcp_connection.h"
 #include "mrcp_client_connection.h"
 #include "mrcp_control_descriptor.h"
@@ -23,13 +24,52 @@
 #include "apt_poller_task.h"
 #include "apt_log.h"
 
+/** Timeout to establish a warm MRCPv2 connection within (usec) */
+#define MRCP_CLIENT_POOL_CONNECT_TIMEOUT 2000000
+/** Max number of poller threads of an agent */
+#define MRCP_CLIENT_AGENT_MAX_THREAD_COUNT 64
 
-struct mrcp_connection_agent_t {
+/** Server to keep warm MRCPv2 connections to */
+typedef struct mrcp_connection_target_t mrcp_connection_target_t;
+struct mrcp_connection_target_t {
+	const char     *ip;
+	apr_port_t      port;
+	apr_sockaddr_t *sockaddr;
+};
+
+typedef struct mrcp_connection_worker_t mrcp_connection_worker_t;
+
+/** Poller thread of the agent, channels and their connections are affine to the worker */
+struct mrcp_connection_worker_t {
 	/** List (ring) of MRCP connections */
 	APR_RING_HEAD(mrcp_connection_head_t, mrcp_connection_t) connection_list;
 
-	apr_pool_t                           *pool;
+	mrcp_connection_agent_t              *agent;
 	apt_poller_task_t                    *task;
+
+	/** Array of targets (mrcp_connection_target_t) */
+	apr_array_header_t                   *pool_targets;
+	/** Timer to check and replenish the idle connections */
+	apt_timer_t                          *pool_timer;
+};
+
+/** Control channel along with the worker it is processed by */
+typedef struct mrcp_client_control_channel_t mrcp_client_control_channel_t;
+struct mrcp_client_control_channel_t {
+	/** Base control channel */
+	mrcp_control_channel_t                base;
+	/** Worker the channel is processed by */
+	mrcp_connection_worker_t             *worker;
+};
+
+struct mrcp_connection_agent_t {
+	apr_pool_t                           *pool;
+	/** Workers, the first one is the main task the others are added to */
+	mrcp_connection_worker_t            **workers;
+	/** Number of workers */
+	apr_size_t                            worker_count;
+	/** Number of channels created, the next channel is assigned to the next worker */
+	volatile apr_uint32_t                 channel_count;
 	const mrcp_resource_factory_t        *resource_factory;
 
 	apr_uint32_t                          request_timeout;
@@ -38,6 +78,13 @@ struct mrcp_connection_agent_t {
 	apr_size_t                            tx_buffer_size;
 	apr_size_t                            rx_buffer_size;
 
+	/** Number of idle connections to keep established per target */
+	apr_size_t                            pool_idle_count;
+	/** Time an idle connection is recycled after (usec) */
+	apr_interval_time_t                   pool_max_idle_time;
+	/** Interval the idle connections are checked at (msec) */
+	apr_uint32_t                          pool_check_interval;
+
 	void                                 *obj;
 	const mrcp_connection_event_vtable_t *vtable;
 };
@@ -52,7 +99,7 @@ typedef enum {
 typedef struct connection_task_msg_t connection_task_msg_t;
 struct connection_task_msg_t {
 	connection_task_msg_type_e type;
-	mrcp_connection_agent_t   *agent;
+	mrcp_connection_worker_t  *worker;
 	mrcp_control_channel_t    *channel;
 	mrcp_control_descriptor_t *descriptor;
 	mrcp_message_t            *message;
@@ -62,6 +109,48 @@ struct connection_task_msg_t {
 static apt_bool_t mrcp_client_agent_msg_process(apt_task_t *task, apt_task_msg_t *task_msg);
 static apt_bool_t mrcp_client_poller_signal_process(void *obj, const apr_pollfd_t *descriptor);
 static void mrcp_client_timer_proc(apt_timer_t *timer, void *obj);
+static void mrcp_client_pool_timer_proc(apt_timer_t *timer, void *obj);
+static void mrcp_client_agent_on_pre_run(apt_task_t *task);
+static void mrcp_client_agent_on_post_run(apt_task_t *task);
+
+/** Create worker of the agent */
+static mrcp_connection_worker_t* mrcp_client_agent_worker_create(
+										mrcp_connection_agent_t *agent,
+										const char *id,
+										apr_size_t max_connection_count,
+										apt_task_msg_pool_t *msg_pool)
+{
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	mrcp_connection_worker_t *worker = apr_palloc(agent->pool,sizeof(mrcp_connection_worker_t));
+	worker->agent = agent;
+	worker->pool_targets = apr_array_make(agent->pool,1,sizeof(mrcp_connection_target_t));
+	worker->pool_timer = NULL;
+	worker->task = apt_poller_task_create(
+					max_connection_count,
+					mrcp_client_poller_signal_process,
+					worker,
+					msg_pool,
+					agent->pool);
+	if(!worker->task) {
+		return NULL;
+	}
+
+	task = apt_poller_task_base_get(worker->task);
+	if(task) {
+		apt_task_name_set(task,id);
+	}
+
+	vtable = apt_poller_task_vtable_get(worker->task);
+	if(vtable) {
+		vtable->process_msg = mrcp_client_agent_msg_process;
+		vtable->on_pre_run = mrcp_client_agent_on_pre_run;
+		vtable->on_post_run = mrcp_client_agent_on_post_run;
+	}
+
+	APR_RING_INIT(&worker->connection_list, mrcp_connection_t, link);
+	return worker;
+}
 
 /** Create connection agent. */
 MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_client_connection_agent_create(
@@ -70,44 +159,72 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_client_connection_agent_create(
 											apt_bool_t offer_new_connection,
 											apr_pool_t *pool)
 {
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
+	return mrcp_client_connection_agent_create_ex(
+				id,
+				max_connection_count,
+				offer_new_connection,
+				1,
+				pool);
+}
+
+/** Create connection agent with the specified number of threads */
+MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_client_connection_agent_create_ex(
+											const char *id,
+											apr_size_t max_connection_count,
+											apt_bool_t offer_new_connection,
+											apr_size_t thread_count,
+											apr_pool_t *pool)
+{
+	apr_size_t i;
 	apt_task_msg_pool_t *msg_pool;
 	mrcp_connection_agent_t *agent;
 
-	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create MRCPv2 Agent [%s] [%"APR_SIZE_T_FMT"]",
-				id,max_connection_count);
+	if(!thread_count) {
+		thread_count = 1;
+	}
+	else if(thread_count > MRCP_CLIENT_AGENT_MAX_THREAD_COUNT) {
+		thread_count = MRCP_CLIENT_AGENT_MAX_THREAD_COUNT;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create MRCPv2 Agent [%s] [%"APR_SIZE_T_FMT"] threads [%"APR_SIZE_T_FMT"]",
+				id,max_connection_count,thread_count);
 	agent = apr_palloc(pool,sizeof(mrcp_connection_agent_t));
 	agent->pool = pool;
+	agent->channel_count = 0;
+	agent->resource_factory = NULL;
 	agent->request_timeout = 0;
 	agent->offer_new_connection = offer_new_connection;
 	agent->max_shared_use_count = 100;
 	agent->rx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
 	agent->tx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
+	agent->pool_idle_count = 0;
+	agent->pool_max_idle_time = 0;
+	agent->pool_check_interval = 0;
+	agent->obj = NULL;
+	agent->vtable = NULL;
 
 	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_task_msg_t),pool);
 
-	agent->task = apt_poller_task_create(
-					max_connection_count,
-					mrcp_client_poller_signal_process,
+	agent->workers = apr_palloc(pool,sizeof(mrcp_connection_worker_t*) * thread_count);
+	agent->worker_count = 0;
+	for(i=0; i<thread_count; i++) {
+		mrcp_connection_worker_t *worker = mrcp_client_agent_worker_create(
 					agent,
-					msg_pool,
-					pool);
-	if(!agent->task) {
-		return NULL;
-	}
-
-	task = apt_poller_task_base_get(agent->task);
-	if(task) {
-		apt_task_name_set(task,id);
-	}
-
-	vtable = apt_poller_task_vtable_get(agent->task);
-	if(vtable) {
-		vtable->process_msg = mrcp_client_agent_msg_process;
+					i == 0 ? id : apr_psprintf(pool,"%s-%"APR_SIZE_T_FMT,id,i),
+					max_connection_count,
+					msg_pool);
+		if(!worker) {
+			if(i == 0) {
+				return NULL;
+			}
+			break;
+		}
+		if(i > 0) {
+			/* the other workers are started and terminated along with the main one */
+			apt_task_add(apt_poller_task_base_get(agent->workers[0]->task),apt_poller_task_base_get(worker->task));
+		}
+		agent->workers[agent->worker_count++] = worker;
 	}
-
-	APR_RING_INIT(&agent->connection_list, mrcp_connection_t, link);
 	return agent;
 }
 
@@ -116,19 +233,20 @@ MRCP_DECLARE(apt_bool_t) mrcp_client_connection_agent_destroy(mrcp_connection_ag
 {
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Destroy MRCPv2 Agent [%s]",
 		mrcp_client_connection_agent_id_get(agent));
-	return apt_poller_task_destroy(agent->task);
+	/* the other workers are destroyed along with the main one */
+	return apt_poller_task_destroy(agent->workers[0]->task);
 }
 
 /** Start connection agent. */
 MRCP_DECLARE(apt_bool_t) mrcp_client_connection_agent_start(mrcp_connection_agent_t *agent)
 {
-	return apt_poller_task_start(agent->task);
+	return apt_poller_task_start(agent->workers[0]->task);
 }
 
 /** Terminate connection agent. */
 MRCP_DECLARE(apt_bool_t) mrcp_client_connection_agent_terminate(mrcp_connection_agent_t *agent)
 {
-	return apt_poller_task_terminate(agent->task);
+	return apt_poller_task_terminate(agent->workers[0]->task);
 }
 
 /** Set connection event handler. */
@@ -187,10 +305,98 @@ MRCP_DECLARE(void) mrcp_client_connection_timeout_set(
 	agent->request_timeout = (apr_uint32_t)timeout;
 }
 
+/** Set pool of warm MRCPv2 connections */
+MRCP_DECLARE(void) mrcp_client_connection_pool_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t idle_count,
+								apr_size_t max_idle_time,
+								apr_size_t check_interval)
+{
+	apr_size_t i;
+	mrcp_connection_worker_t *worker;
+	if(!check_interval) {
+		check_interval = 1;
+	}
+	agent->pool_idle_count = idle_count;
+	agent->pool_max_idle_time = apr_time_from_sec(max_idle_time);
+	agent->pool_check_interval = (apr_uint32_t)check_interval * 1000;
+	for(i = 0; i < agent->worker_count && idle_count; i++) {
+		/* each worker keeps its own idle connections */
+		worker = agent->workers[i];
+		if(!worker->pool_timer) {
+			worker->pool_timer = apt_poller_task_timer_create(
+									worker->task,
+									mrcp_client_pool_timer_proc,
+									worker,
+									agent->pool);
+		}
+	}
+}
+
+static mrcp_connection_target_t* mrcp_client_agent_target_add(mrcp_connection_worker_t *worker, const char *ip, apr_port_t port)
+{
+	int i;
+	apr_sockaddr_t *sockaddr;
+	mrcp_connection_target_t *target;
+	mrcp_connection_agent_t *agent = worker->agent;
+	for(i = 0; i < worker->pool_targets->nelts; i++) {
+		target = &APR_ARRAY_IDX(worker->pool_targets,i,mrcp_connection_target_t);
+		if(target->port == port && strcmp(target->ip,ip) == 0) {
+			return target;
+		}
+	}
+
+	if(apr_sockaddr_info_get(&sockaddr,ip,APR_INET,port,0,agent->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Sockaddr for Warm TCP/MRCPv2 Connections %s:%hu",ip,port);
+		return NULL;
+	}
+
+	target = apr_array_push(worker->pool_targets);
+	target->ip = apr_pstrdup(agent->pool,ip);
+	target->port = port;
+	target->sockaddr = sockaddr;
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Keep Warm TCP/MRCPv2 Connections to %s:%hu [%"APR_SIZE_T_FMT"]",
+		ip,port,agent->pool_idle_count);
+	return target;
+}
+
+/** Add server to establish warm MRCPv2 connections to on start */
+MRCP_DECLARE(apt_bool_t) mrcp_client_connection_pool_target_add(
+								mrcp_connection_agent_t *agent,
+								const char *ip,
+								apr_port_t port)
+{
+	apr_size_t i;
+	if(!ip || !port) {
+		return FALSE;
+	}
+	for(i = 0; i < agent->worker_count; i++) {
+		if(!mrcp_client_agent_target_add(agent->workers[i],ip,port)) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
 /** Get task */
 MRCP_DECLARE(apt_task_t*) mrcp_client_connection_agent_task_get(const mrcp_connection_agent_t *agent)
 {
-	return apt_poller_task_base_get(agent->task);
+	return apt_poller_task_base_get(agent->workers[0]->task);
+}
+
+/** Get number of threads */
+MRCP_DECLARE(apr_size_t) mrcp_client_connection_agent_thread_count_get(const mrcp_connection_agent_t *agent)
+{
+	return agent->worker_count;
+}
+
+/** Get task of the specified thread */
+MRCP_DECLARE(apt_task_t*) mrcp_client_connection_agent_thread_task_get(const mrcp_connection_agent_t *agent, apr_size_t index)
+{
+	if(index >= agent->worker_count) {
+		return NULL;
+	}
+	return apt_poller_task_base_get(agent->workers[index]->task);
 }
 
 /** Get external object */
@@ -202,7 +408,7 @@ MRCP_DECLARE(void*) mrcp_client_connection_agent_object_get(const mrcp_connectio
 /** Get string identifier */
 MRCP_DECLARE(const char*) mrcp_client_connection_agent_id_get(const mrcp_connection_agent_t *agent)
 {
-	apt_task_t *task = apt_poller_task_base_get(agent->task);
+	apt_task_t *task = apt_poller_task_base_get(agent->workers[0]->task);
 	return apt_task_name_get(task);
 }
 
@@ -210,7 +416,11 @@ MRCP_DECLARE(const char*) mrcp_client_connection_agent_id_get(const mrcp_connect
 /** Create control channel */
 MRCP_DECLARE(mrcp_control_channel_t*) mrcp_client_control_channel_create(mrcp_connection_agent_t *agent, void *obj, apr_pool_t *pool)
 {
-	mrcp_control_channel_t *channel = apr_palloc(pool,sizeof(mrcp_control_channel_t));
+	mrcp_client_control_channel_t *client_channel = apr_palloc(pool,sizeof(mrcp_client_control_channel_t));
+	mrcp_control_channel_t *channel = &client_channel->base;
+	/* the channels are spread across the workers in turn */
+	apr_uint32_t index = apr_atomic_inc32(&agent->channel_count);
+	client_channel->worker = agent->workers[index % agent->worker_count];
 	channel->agent = agent;
 	channel->connection = NULL;
 	channel->active_request = NULL;
@@ -221,7 +431,7 @@ MRCP_DECLARE(mrcp_control_channel_t*) mrcp_client_control_channel_create(mrcp_co
 	channel->pool = pool;
 
 	channel->request_timer = apt_poller_task_timer_create(
-								agent->task,
+								client_channel->worker->task,
 								mrcp_client_timer_proc,
 								channel,
 								pool);
@@ -246,20 +456,26 @@ MRCP_DECLARE(apt_bool_t) mrcp_client_control_channel_destroy(mrcp_control_channe
 	return TRUE;
 }
 
-/** Signal task message */
+/** Get worker the control channel is processed by */
+static APR_INLINE mrcp_connection_worker_t* mrcp_client_channel_worker_get(const mrcp_control_channel_t *channel)
+{
+	return ((const mrcp_client_control_channel_t*)channel)->worker;
+}
+
+/** Signal task message to the worker of the channel */
 static apt_bool_t mrcp_client_control_message_signal(
 								connection_task_msg_type_e type,
-								mrcp_connection_agent_t *agent,
 								mrcp_control_channel_t *channel,
 								mrcp_control_descriptor_t *descriptor,
 								mrcp_message_t *message)
 {
-	apt_task_t *task = apt_poller_task_base_get(agent->task);
+	mrcp_connection_worker_t *worker = mrcp_client_channel_worker_get(channel);
+	apt_task_t *task = apt_poller_task_base_get(worker->task);
 	apt_task_msg_t *task_msg = apt_task_msg_get(task);
 	if(task_msg) {
 		connection_task_msg_t *msg = (connection_task_msg_t*)task_msg->data;
 		msg->type = type;
-		msg->agent = agent;
+		msg->worker = worker;
 		msg->channel = channel;
 		msg->descriptor = descriptor;
 		msg->message = message;
@@ -271,34 +487,35 @@ static apt_bool_t mrcp_client_control_message_signal(
 /** Add MRCPv2 control channel */
 MRCP_DECLARE(apt_bool_t) mrcp_client_control_channel_add(mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
 {
-	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_ADD_CHANNEL,channel->agent,channel,descriptor,NULL);
+	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_ADD_CHANNEL,channel,descriptor,NULL);
 }
 
 /** Modify MRCPv2 control channel */
 MRCP_DECLARE(apt_bool_t) mrcp_client_control_channel_modify(mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
 {
-	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_MODIFY_CHANNEL,channel->agent,channel,descriptor,NULL);
+	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_MODIFY_CHANNEL,channel,descriptor,NULL);
 }
 
 /** Remove MRCPv2 control channel */
 MRCP_DECLARE(apt_bool_t) mrcp_client_control_channel_remove(mrcp_control_channel_t *channel)
 {
-	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_REMOVE_CHANNEL,channel->agent,channel,NULL,NULL);
+	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_REMOVE_CHANNEL,channel,NULL,NULL);
 }
 
 /** Send MRCPv2 message */
 MRCP_DECLARE(apt_bool_t) mrcp_client_control_message_send(mrcp_control_channel_t *channel, mrcp_message_t *message)
 {
-	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_SEND_MESSAGE,channel->agent,channel,NULL,message);
+	return mrcp_client_control_message_signal(CONNECTION_TASK_MSG_SEND_MESSAGE,channel,NULL,message);
 }
 
-static mrcp_connection_t* mrcp_client_agent_connection_create(mrcp_connection_agent_t *agent, mrcp_control_descriptor_t *descriptor)
+static mrcp_connection_t* mrcp_client_agent_connection_create(mrcp_connection_worker_t *worker, const char *ip, apr_port_t port, apr_interval_time_t connect_timeout)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	char *local_ip = NULL;
 	char *remote_ip = NULL;
 	mrcp_connection_t *connection = mrcp_connection_create();
 
-	apr_sockaddr_info_get(&connection->r_sockaddr,descriptor->ip.buf,APR_INET,descriptor->port,0,connection->pool);
+	apr_sockaddr_info_get(&connection->r_sockaddr,ip,APR_INET,port,0,connection->pool);
 	if(!connection->r_sockaddr) {
 		mrcp_connection_destroy(connection);
 		return NULL;
@@ -310,14 +527,22 @@ static mrcp_connection_t* mrcp_client_agent_connection_create(mrcp_connection_ag
 	}
 
 	apr_socket_opt_set(connection->sock, APR_SO_NONBLOCK, 0);
-	apr_socket_timeout_set(connection->sock, -1);
+	apr_socket_timeout_set(connection->sock, connect_timeout);
 	apr_socket_opt_set(connection->sock, APR_SO_REUSEADDR, 1);
+	if(agent->pool_idle_count) {
+		/* detect dead peers of idle connections */
+		apr_socket_opt_set(connection->sock, APR_SO_KEEPALIVE, 1);
+	}
 
 	if(apr_socket_connect(connection->sock, connection->r_sockaddr) != APR_SUCCESS) {
 		apr_socket_close(connection->sock);
 		mrcp_connection_destroy(connection);
 		return NULL;
 	}
+	if(connect_timeout != -1) {
+		apr_socket_opt_set(connection->sock, APR_SO_NONBLOCK, 0);
+		apr_socket_timeout_set(connection->sock, -1);
+	}
 
 	if(apr_socket_addr_get(&connection->l_sockaddr,APR_LOCAL,connection->sock) != APR_SUCCESS) {
 		apr_socket_close(connection->sock);
@@ -336,7 +561,7 @@ static mrcp_connection_t* mrcp_client_agent_connection_create(mrcp_connection_ag
 	connection->sock_pfd.reqevents = APR_POLLIN;
 	connection->sock_pfd.desc.s = connection->sock;
 	connection->sock_pfd.client_data = connection;
-	if(apt_poller_task_descriptor_add(agent->task, &connection->sock_pfd) != TRUE) {
+	if(apt_poller_task_descriptor_add(worker->task, &connection->sock_pfd) != TRUE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add to Pollset %s",connection->id);
 		apr_socket_close(connection->sock);
 		mrcp_connection_destroy(connection);
@@ -344,8 +569,9 @@ static mrcp_connection_t* mrcp_client_agent_connection_create(mrcp_connection_ag
 	}
 	
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Established TCP/MRCPv2 Connection %s",connection->id);
-	connection->agent = agent;
-	APR_RING_INSERT_TAIL(&agent->connection_list,connection,mrcp_connection_t,link);
+	connection->agent = worker;
+	connection->idle_time = apr_time_now();
+	APR_RING_INSERT_TAIL(&worker->connection_list,connection,mrcp_connection_t,link);
 	
 	connection->parser = mrcp_parser_create(agent->resource_factory,connection->pool);
 	connection->generator = mrcp_generator_create(agent->resource_factory,connection->pool);
@@ -366,13 +592,14 @@ static mrcp_connection_t* mrcp_client_agent_connection_create(mrcp_connection_ag
 	return connection;
 }
 
-static mrcp_connection_t* mrcp_client_agent_connection_find(mrcp_connection_agent_t *agent, mrcp_control_descriptor_t *descriptor)
+static mrcp_connection_t* mrcp_client_agent_connection_find(mrcp_connection_worker_t *worker, mrcp_control_descriptor_t *descriptor)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	apr_sockaddr_t *sockaddr;
 	mrcp_connection_t *connection;
 
-	for(connection = APR_RING_FIRST(&agent->connection_list);
-			connection != APR_RING_SENTINEL(&agent->connection_list, mrcp_connection_t, link);
+	for(connection = APR_RING_FIRST(&worker->connection_list);
+			connection != APR_RING_SENTINEL(&worker->connection_list, mrcp_connection_t, link);
 				connection = APR_RING_NEXT(connection, link)) {
 		/* do not observe connections with closed socket */
 		if(!connection->sock)
@@ -398,28 +625,99 @@ static mrcp_connection_t* mrcp_client_agent_connection_find(mrcp_connection_agen
 	return NULL;
 }
 
-static apt_bool_t mrcp_client_agent_connection_remove(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+static apt_bool_t mrcp_client_agent_connection_remove(mrcp_connection_worker_t *worker, mrcp_connection_t *connection)
 {
 	/* remove from the list */
 	APR_RING_REMOVE(connection,link);
 
 	if(connection->sock) {
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Close TCP/MRCPv2 Connection %s",connection->id);
-		apt_poller_task_descriptor_remove(agent->task,&connection->sock_pfd);
+		apt_poller_task_descriptor_remove(worker->task,&connection->sock_pfd);
 		apr_socket_close(connection->sock);
 		connection->sock = NULL;
 	}
 	return TRUE;
 }
 
-static apt_bool_t mrcp_client_agent_channel_add(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
+static mrcp_connection_t* mrcp_client_agent_connection_take(mrcp_connection_worker_t *worker, mrcp_control_descriptor_t *descriptor, apr_pool_t *pool)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
+	apr_sockaddr_t *sockaddr;
+	mrcp_connection_t *connection;
+
+	if(!agent->pool_idle_count) {
+		return NULL;
+	}
+	if(apr_sockaddr_info_get(&sockaddr,descriptor->ip.buf,APR_INET,descriptor->port,0,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+
+	for(connection = APR_RING_FIRST(&worker->connection_list);
+			connection != APR_RING_SENTINEL(&worker->connection_list, mrcp_connection_t, link);
+				connection = APR_RING_NEXT(connection, link)) {
+		if(connection->sock && !connection->access_count &&
+			apr_sockaddr_equal(sockaddr,connection->r_sockaddr) != 0 &&
+			descriptor->port == connection->r_sockaddr->port) {
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Take Idle TCP/MRCPv2 Connection %s",connection->id);
+			return connection;
+		}
+	}
+	return NULL;
+}
+
+static apr_size_t mrcp_client_agent_idle_count_get(mrcp_connection_worker_t *worker, const apr_sockaddr_t *sockaddr, apr_port_t port)
+{
+	apr_size_t count = 0;
+	mrcp_connection_t *connection;
+	for(connection = APR_RING_FIRST(&worker->connection_list);
+			connection != APR_RING_SENTINEL(&worker->connection_list, mrcp_connection_t, link);
+				connection = APR_RING_NEXT(connection, link)) {
+		if(connection->sock && !connection->access_count &&
+			apr_sockaddr_equal(sockaddr,connection->r_sockaddr) != 0 &&
+			port == connection->r_sockaddr->port) {
+			count++;
+		}
+	}
+	return count;
+}
+
+static apt_bool_t mrcp_client_agent_connection_release(mrcp_connection_worker_t *worker, mrcp_connection_t *connection)
+{
+	mrcp_connection_agent_t *agent = worker->agent;
+	/* keep the connection idle in the pool, unless it is no longer usable or the pool is full */
+	if(!agent->pool_idle_count || !connection->sock) {
+		return FALSE;
+	}
+	if(agent->max_shared_use_count && connection->use_count >= agent->max_shared_use_count) {
+		return FALSE;
+	}
+	/* the count includes the connection being released */
+	if(mrcp_client_agent_idle_count_get(worker,connection->r_sockaddr,connection->r_sockaddr->port) > agent->pool_idle_count) {
+		return FALSE;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Keep Idle TCP/MRCPv2 Connection %s",connection->id);
+	connection->idle_time = apr_time_now();
+	return TRUE;
+}
+
+static void mrcp_client_agent_pool_replenish(mrcp_connection_worker_t *worker)
+{
+	if(worker->pool_timer) {
+		/* replenish right after the current message is processed */
+		apt_timer_set(worker->pool_timer,1);
+	}
+}
+
+static apt_bool_t mrcp_client_agent_channel_add(mrcp_connection_worker_t *worker, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
+{
+	mrcp_connection_agent_t *agent = worker->agent;
 	if(agent->offer_new_connection == TRUE) {
 		descriptor->connection_type = MRCP_CONNECTION_TYPE_NEW;
 	}
 	else {
 		descriptor->connection_type = MRCP_CONNECTION_TYPE_EXISTING;
-		if(APR_RING_EMPTY(&agent->connection_list, mrcp_connection_t, link)) {
+		if(APR_RING_EMPTY(&worker->connection_list, mrcp_connection_t, link)) {
 			/* offer new connection if there is no established connection yet */
 			descriptor->connection_type = MRCP_CONNECTION_TYPE_NEW;
 		}
@@ -428,8 +726,9 @@ static apt_bool_t mrcp_client_agent_channel_add(mrcp_connection_agent_t *agent,
 	return mrcp_control_channel_add_respond(agent->vtable,channel,descriptor,TRUE);
 }
 
-static apt_bool_t mrcp_client_agent_channel_modify(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
+static apt_bool_t mrcp_client_agent_channel_modify(mrcp_connection_worker_t *worker, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	apt_bool_t status = TRUE;
 	if(descriptor->port) {
 		if(!channel->connection) {
@@ -438,20 +737,32 @@ static apt_bool_t mrcp_client_agent_channel_modify(mrcp_connection_agent_t *agen
 			/* no connection yet */
 			if(descriptor->connection_type == MRCP_CONNECTION_TYPE_EXISTING) {
 				/* try to find existing connection */
-				connection = mrcp_client_agent_connection_find(agent,descriptor);
+				connection = mrcp_client_agent_connection_find(worker,descriptor);
 				if(!connection) {
 					apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,channel->log_obj,"Found No Existing TCP/MRCPv2 Connection");
 				}
 			}
+			if(!connection) {
+				/* take an idle connection from the pool */
+				connection = mrcp_client_agent_connection_take(worker,descriptor,channel->pool);
+			}
 			if(!connection) {
 				/* create new connection */
-				connection = mrcp_client_agent_connection_create(agent,descriptor);
+				connection = mrcp_client_agent_connection_create(worker,descriptor->ip.buf,descriptor->port,-1);
 				if(!connection) {
 					apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,channel->log_obj,"Failed to Establish TCP/MRCPv2 Connection");
 				}
+				else if(agent->pool_idle_count) {
+					/* learn the server to keep warm connections to */
+					mrcp_client_agent_target_add(worker,descriptor->ip.buf,descriptor->port);
+				}
 			}
 
 			if(connection) {
+				if(!connection->access_count) {
+					/* an idle connection is taken out of the pool */
+					mrcp_client_agent_pool_replenish(worker);
+				}
 				mrcp_connection_channel_add(connection,channel);
 				apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,channel->log_obj,"Add Control Channel <%s> %s [%d]",
 						channel->identifier.buf,
@@ -472,16 +783,17 @@ static apt_bool_t mrcp_client_agent_channel_modify(mrcp_connection_agent_t *agen
 	return mrcp_control_channel_modify_respond(agent->vtable,channel,descriptor,status);
 }
 
-static apt_bool_t mrcp_client_agent_channel_remove(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel)
+static apt_bool_t mrcp_client_agent_channel_remove(mrcp_connection_worker_t *worker, mrcp_control_channel_t *channel)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	if(channel->connection) {
 		mrcp_connection_t *connection = channel->connection;
 		mrcp_connection_channel_remove(connection,channel);
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,channel->log_obj,"Remove Control Channel <%s> [%d]",
 				channel->identifier.buf,
 				apr_hash_count(connection->channel_table));
-		if(!connection->access_count) {
-			mrcp_client_agent_connection_remove(agent,connection);
+		if(!connection->access_count && mrcp_client_agent_connection_release(worker,connection) == FALSE) {
+			mrcp_client_agent_connection_remove(worker,connection);
 			/* set connection to be destroyed on channel destroy */
 			channel->connection = connection;
 			channel->removed = TRUE;
@@ -530,10 +842,8 @@ static apt_bool_t mrcp_client_agent_disconnect_raise(mrcp_connection_agent_t *ag
 
 static apt_bool_t mrcp_client_agent_messsage_send(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel, mrcp_message_t *message)
 {
-	apt_bool_t status = FALSE;
+	apt_bool_t status;
 	mrcp_connection_t *connection = channel->connection;
-	apt_text_stream_t stream;
-	apt_message_status_e result;
 
 	if(!connection || !connection->sock) {
 		apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,channel->log_obj,"Null MRCPv2 Connection " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(message));
@@ -541,34 +851,7 @@ static apt_bool_t mrcp_client_agent_messsage_send(mrcp_connection_agent_t *agent
 		return FALSE;
 	}
 
-	do {
-		apt_text_stream_init(&stream,connection->tx_buffer,connection->tx_buffer_size);
-		result = mrcp_generator_run(connection->generator,message,&stream);
-		if(result != APT_MESSAGE_STATUS_INVALID) {
-			stream.text.length = stream.pos - stream.text.buf;
-			*stream.pos = '\0';
-
-			apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,channel->log_obj,"Send MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
-				connection->id,
-				stream.text.length,
-				connection->verbose == TRUE ? stream.text.length : 0,
-				stream.text.buf);
-
-			if(apr_socket_send(connection->sock,stream.text.buf,&stream.text.length) == APR_SUCCESS) {
-				status = TRUE;
-			}
-			else {
-				apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,channel->log_obj,"Failed to Send MRCPv2 Data %s",
-					connection->id);
-			}
-		}
-		else {
-			apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,channel->log_obj,"Failed to Generate MRCPv2 Data %s",
-				connection->id);
-		}
-	}
-	while(result == APT_MESSAGE_STATUS_INCOMPLETE);
-
+	status = mrcp_connection_message_send(connection,message,channel->log_obj);
 	if(status == TRUE) {
 		channel->active_request = message;
 		if(channel->request_timer && agent->request_timeout) {
@@ -590,7 +873,8 @@ static apt_bool_t mrcp_client_message_handler(mrcp_connection_t *connection, mrc
 		apt_id_resource_generate(&message->channel_id.session_id,&message->channel_id.resource_name,'@',&identifier,message->pool);
 		channel = mrcp_connection_channel_find(connection,&identifier);
 		if(channel) {
-			mrcp_connection_agent_t *agent = connection->agent;
+			mrcp_connection_worker_t *worker = connection->agent;
+			mrcp_connection_agent_t *agent = worker->agent;
 			if(message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE) {
 				if(!channel->active_request || 
 					channel->active_request->start_line.request_id != message->start_line.request_id) {
@@ -620,80 +904,53 @@ static apt_bool_t mrcp_client_message_handler(mrcp_connection_t *connection, mrc
 /* Receive MRCP message through TCP/MRCPv2 connection */
 static apt_bool_t mrcp_client_poller_signal_process(void *obj, const apr_pollfd_t *descriptor)
 {
-	mrcp_connection_agent_t *agent = obj;
+	mrcp_connection_worker_t *worker = obj;
 	mrcp_connection_t *connection = descriptor->client_data;
 	apr_status_t status;
-	apr_size_t offset;
-	apr_size_t length;
-	apt_text_stream_t *stream;
-	mrcp_message_t *message;
-	apt_message_status_e msg_status;
 
 	if(!connection || !connection->sock) {
 		return FALSE;
 	}
-	stream = &connection->rx_stream;
-
-	/* calculate offset remaining from the previous receive / if any */
-	offset = stream->pos - stream->text.buf;
-	/* calculate available length */
-	length = connection->rx_buffer_size - offset;
 
-	status = apr_socket_recv(connection->sock,stream->pos,&length);
-	if(status == APR_EOF || length == 0) {
+	status = mrcp_connection_receive(connection,mrcp_client_message_handler);
+	if(status == APR_EOF) {
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"TCP/MRCPv2 Peer Disconnected %s",connection->id);
-		apt_poller_task_descriptor_remove(agent->task,&connection->sock_pfd);
+		apt_poller_task_descriptor_remove(worker->task,&connection->sock_pfd);
 		apr_socket_close(connection->sock);
 		connection->sock = NULL;
 
-		mrcp_client_agent_disconnect_raise(agent,connection);
-		return TRUE;
-	}
-	
-	/* calculate actual length of the stream */
-	stream->text.length = offset + length;
-	stream->pos[length] = '\0';
-	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Receive MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
-			connection->id,
-			length,
-			connection->verbose == TRUE ? length : 0,
-			stream->pos);
-
-	/* reset pos */
-	apt_text_stream_reset(stream);
-
-	do {
-		msg_status = mrcp_parser_run(connection->parser,stream,&message);
-		if(mrcp_client_message_handler(connection,message,msg_status) == FALSE) {
-			return FALSE;
+		if(!connection->access_count) {
+			/* idle connection of the pool, there is no channel to destroy it with */
+			APR_RING_REMOVE(connection,link);
+			mrcp_connection_destroy(connection);
+			return TRUE;
 		}
-	}
-	while(apt_text_is_eos(stream) == FALSE);
 
-	/* scroll remaining stream */
-	apt_text_stream_scroll(stream);
-	return TRUE;
+		mrcp_client_agent_disconnect_raise(worker->agent,connection);
+		return TRUE;
+	}
+	return status == APR_SUCCESS ? TRUE : FALSE;
 }
 
 /* Process task message */
 static apt_bool_t mrcp_client_agent_msg_process(apt_task_t *task, apt_task_msg_t *task_msg)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	mrcp_connection_agent_t *agent = apt_poller_task_object_get(poller_task);
+	mrcp_connection_worker_t *worker = apt_poller_task_object_get(poller_task);
 	connection_task_msg_t *msg = (connection_task_msg_t*) task_msg->data;
 
 	switch(msg->type) {
 		case CONNECTION_TASK_MSG_ADD_CHANNEL:
-			mrcp_client_agent_channel_add(agent,msg->channel,msg->descriptor);
+			mrcp_client_agent_channel_add(worker,msg->channel,msg->descriptor);
 			break;
 		case CONNECTION_TASK_MSG_MODIFY_CHANNEL:
-			mrcp_client_agent_channel_modify(agent,msg->channel,msg->descriptor);
+			mrcp_client_agent_channel_modify(worker,msg->channel,msg->descriptor);
 			break;
 		case CONNECTION_TASK_MSG_REMOVE_CHANNEL:
-			mrcp_client_agent_channel_remove(agent,msg->channel);
+			mrcp_client_agent_channel_remove(worker,msg->channel);
 			break;
 		case CONNECTION_TASK_MSG_SEND_MESSAGE:
-			mrcp_client_agent_messsage_send(agent,msg->channel,msg->message);
+			mrcp_client_agent_messsage_send(worker->agent,msg->channel,msg->message);
 			break;
 	}
 
@@ -715,3 +972,80 @@ static void mrcp_client_timer_proc(apt_timer_t *timer, void *obj)
 		}
 	}
 }
+
+/* Timer callback */
+static void mrcp_client_pool_timer_proc(apt_timer_t *timer, void *obj)
+{
+	mrcp_connection_worker_t *worker = obj;
+	mrcp_connection_agent_t *agent;
+	mrcp_connection_t *connection;
+	mrcp_connection_t *next;
+	mrcp_connection_target_t *target;
+	apr_time_t now = apr_time_now();
+	apr_size_t count;
+	int i;
+
+	if(!worker || worker->pool_timer != timer) {
+		return;
+	}
+	agent = worker->agent;
+
+	/* recycle the connections idle for too long, before the server times them out */
+	for(connection = APR_RING_FIRST(&worker->connection_list);
+			connection != APR_RING_SENTINEL(&worker->connection_list, mrcp_connection_t, link);
+				connection = next) {
+		next = APR_RING_NEXT(connection, link);
+		if(connection->sock && !connection->access_count &&
+			agent->pool_max_idle_time && now - connection->idle_time >= agent->pool_max_idle_time) {
+			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Recycle Idle TCP/MRCPv2 Connection %s",connection->id);
+			mrcp_client_agent_connection_remove(worker,connection);
+			mrcp_connection_destroy(connection);
+		}
+	}
+
+	/* re-establish the idle connections up to the count */
+	for(i = 0; i < worker->pool_targets->nelts; i++) {
+		target = &APR_ARRAY_IDX(worker->pool_targets,i,mrcp_connection_target_t);
+		count = mrcp_client_agent_idle_count_get(worker,target->sockaddr,target->port);
+		for(; count < agent->pool_idle_count; count++) {
+			connection = mrcp_client_agent_connection_create(worker,target->ip,target->port,MRCP_CLIENT_POOL_CONNECT_TIMEOUT);
+			if(!connection) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Establish Warm TCP/MRCPv2 Connection to %s:%hu",
+					target->ip,target->port);
+				break;
+			}
+		}
+	}
+
+	apt_timer_set(timer,agent->pool_check_interval);
+}
+
+static void mrcp_client_agent_on_pre_run(apt_task_t *task)
+{
+	apt_poller_task_t *poller_task = apt_task_object_get(task);
+	mrcp_connection_worker_t *worker = apt_poller_task_object_get(poller_task);
+	/* establish the warm connections to the targets known in advance */
+	mrcp_client_agent_pool_replenish(worker);
+}
+
+static void mrcp_client_agent_on_post_run(apt_task_t *task)
+{
+	apt_poller_task_t *poller_task = apt_task_object_get(task);
+	mrcp_connection_worker_t *worker = apt_poller_task_object_get(poller_task);
+	mrcp_connection_t *connection;
+	mrcp_connection_t *next;
+
+	if(worker->pool_timer) {
+		apt_timer_kill(worker->pool_timer);
+	}
+	/* close the idle connections, the ones in use are destroyed with their channels */
+	for(connection = APR_RING_FIRST(&worker->connection_list);
+			connection != APR_RING_SENTINEL(&worker->connection_list, mrcp_connection_t, link);
+				connection = next) {
+		next = APR_RING_NEXT(connection, link);
+		if(!connection->access_count) {
+			mrcp_client_agent_connection_remove(worker,connection);
+			mrcp_connection_destroy(connection);
+		}
+	}
+}
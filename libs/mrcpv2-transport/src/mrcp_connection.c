@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#define APR_WANT_IOVEC
+#include <apr_want.h>
 #include "mrcp_connection.h"
+#include "mrcp_message.h"
 #include "apt_pool.h"
+#include "apt_log.h"
 
 mrcp_connection_t* mrcp_connection_create(void)
 {
@@ -37,14 +41,20 @@ mrcp_connection_t* mrcp_connection_create(void)
 	connection->use_count = 0;
 	APR_RING_ELEM_INIT(connection,link);
 	connection->channel_table = apr_hash_make(pool);
+	connection->peer_next = NULL;
+	connection->peer_prev = NULL;
 	connection->parser = NULL;
 	connection->generator = NULL;
+	connection->tx_queue = NULL;
+	connection->tx_next = NULL;
+	connection->tx_time = 0;
 	connection->rx_buffer = NULL;
 	connection->rx_buffer_size = 0;
 	connection->tx_buffer = NULL;
 	connection->tx_buffer_size = 0;
 	connection->inactivity_timer = NULL;
 	connection->termination_timer = NULL;
+	connection->idle_time = 0;
 
 	return connection;
 }
@@ -104,3 +114,256 @@ apt_bool_t mrcp_connection_disconnect_raise(mrcp_connection_t *connection, const
 	}
 	return TRUE;
 }
+
+/** Grow the rx buffer filled up by an incomplete line */
+static apt_bool_t mrcp_connection_rx_buffer_grow(mrcp_connection_t *connection)
+{
+	char *buffer;
+	apt_text_stream_t *stream = &connection->rx_stream;
+	apr_size_t offset = stream->pos - stream->text.buf;
+	apr_size_t size = connection->rx_buffer_size * 2;
+	if(connection->rx_buffer_size >= MRCP_STREAM_BUFFER_MAX_SIZE) {
+		return FALSE;
+	}
+	if(size > MRCP_STREAM_BUFFER_MAX_SIZE) {
+		size = MRCP_STREAM_BUFFER_MAX_SIZE;
+	}
+
+	/* the previous buffer stays in the pool of the connection, the growth is bounded though */
+	buffer = apr_palloc(connection->pool,size+1);
+	memcpy(buffer,connection->rx_buffer,offset);
+	connection->rx_buffer = buffer;
+	connection->rx_buffer_size = size;
+	stream->text.buf = buffer;
+	stream->text.length = offset;
+	stream->pos = buffer + offset;
+	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Grow Rx Buffer %s [%"APR_SIZE_T_FMT" bytes]",connection->id,size);
+	return TRUE;
+}
+
+apr_status_t mrcp_connection_receive(mrcp_connection_t *connection, mrcp_connection_message_handler_f handler)
+{
+	apr_size_t offset;
+	apr_size_t length;
+	char *buf;
+	apt_bool_t in_place = FALSE;
+	apt_text_stream_t *stream = &connection->rx_stream;
+	mrcp_message_t *message;
+	apt_message_status_e msg_status;
+
+	/* calculate offset remaining from the previous receive / if any */
+	offset = stream->pos - stream->text.buf;
+	if(!offset && mrcp_parser_body_buffer_get(connection->parser,&buf,&length) == TRUE && length) {
+		/* nothing is buffered, receive the rest of the body right into the message */
+		in_place = TRUE;
+	}
+	else {
+		if(offset >= connection->rx_buffer_size && mrcp_connection_rx_buffer_grow(connection) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Too Long MRCPv2 Message Line %s [%"APR_SIZE_T_FMT" bytes]",
+				connection->id,offset);
+			return APR_EOF;
+		}
+		buf = stream->pos;
+		/* calculate available length */
+		length = connection->rx_buffer_size - offset;
+	}
+
+	if(apr_socket_recv(connection->sock,buf,&length) == APR_EOF || length == 0) {
+		return APR_EOF;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Receive MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
+			connection->id,
+			length,
+			connection->verbose == TRUE ? length : 0,
+			buf);
+
+	if(in_place == TRUE) {
+		mrcp_parser_body_buffer_fill(connection->parser,length);
+		/* let the parser complete the message out of an empty stream */
+		stream->text.length = 0;
+	}
+	else {
+		/* calculate actual length of the stream */
+		stream->text.length = offset + length;
+		stream->pos[length] = '\0';
+	}
+
+	/* reset pos */
+	apt_text_stream_reset(stream);
+
+	do {
+		msg_status = mrcp_parser_run(connection->parser,stream,&message);
+		if(handler(connection,message,msg_status) == FALSE) {
+			return APR_EGENERAL;
+		}
+	}
+	while(apt_text_is_eos(stream) == FALSE);
+
+	/* scroll remaining stream */
+	apt_text_stream_scroll(stream);
+	return APR_SUCCESS;
+}
+
+/** Send message generated chunk by chunk through the tx buffer */
+static apt_bool_t mrcp_connection_message_stream_send(mrcp_connection_t *connection, mrcp_message_t *message, void *log_obj)
+{
+	apt_bool_t status = FALSE;
+	apt_text_stream_t stream;
+	apt_message_status_e result;
+
+	do {
+		apt_text_stream_init(&stream,connection->tx_buffer,connection->tx_buffer_size);
+		result = mrcp_generator_run(connection->generator,message,&stream);
+		if(result != APT_MESSAGE_STATUS_INVALID) {
+			stream.text.length = stream.pos - stream.text.buf;
+			*stream.pos = '\0';
+
+			apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,log_obj,"Send MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
+				connection->id,
+				stream.text.length,
+				connection->verbose == TRUE ? stream.text.length : 0,
+				stream.text.buf);
+
+			if(apr_socket_send(connection->sock,stream.text.buf,&stream.text.length) == APR_SUCCESS) {
+				status = TRUE;
+			}
+			else {
+				apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,log_obj,"Failed to Send MRCPv2 Data %s",
+					connection->id);
+			}
+		}
+		else {
+			apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,log_obj,"Failed to Generate MRCPv2 Data %s",
+				connection->id);
+		}
+	}
+	while(result == APT_MESSAGE_STATUS_INCOMPLETE);
+
+	return status;
+}
+
+/** Send the rest of partially sent data */
+static apr_status_t mrcp_connection_data_send(apr_socket_t *sock, const char *buf, apr_size_t length)
+{
+	apr_size_t sent;
+	apr_status_t status;
+	while(length) {
+		sent = length;
+		status = apr_socket_send(sock,buf,&sent);
+		if(status != APR_SUCCESS) {
+			return status;
+		}
+		buf += sent;
+		length -= sent;
+	}
+	return APR_SUCCESS;
+}
+
+/** Send the vector, continuing piece by piece on partial write */
+static apr_status_t mrcp_connection_vec_send(apr_socket_t *sock, struct iovec *vec, apr_size_t count, apr_size_t total_length)
+{
+	apr_size_t i;
+	apr_size_t sent = total_length;
+	apr_status_t status = apr_socket_sendv(sock,vec,(apr_int32_t)count,&sent);
+	if(status != APR_SUCCESS || sent >= total_length) {
+		return status;
+	}
+
+	/* partial write, send the rest piece by piece */
+	for(i = 0; i < count && status == APR_SUCCESS; i++) {
+		if(sent >= vec[i].iov_len) {
+			sent -= vec[i].iov_len;
+			continue;
+		}
+		status = mrcp_connection_data_send(sock,(const char*)vec[i].iov_base + sent,vec[i].iov_len - sent);
+		sent = 0;
+	}
+	return status;
+}
+
+apt_bool_t mrcp_connection_message_send(mrcp_connection_t *connection, mrcp_message_t *message, void *log_obj)
+{
+	return mrcp_connection_messages_send(connection,&message,1,log_obj);
+}
+
+apt_bool_t mrcp_connection_messages_send(mrcp_connection_t *connection, mrcp_message_t **messages, apr_size_t count, void *log_obj)
+{
+	struct iovec vec[MRCP_CONNECTION_MAX_COALESCED_MESSAGES * 2];
+	apr_size_t vec_count = 0;
+	apr_size_t message_count = 0;
+	apr_size_t total_length = 0;
+	apt_text_stream_t stream;
+	char *pos = connection->tx_buffer;
+	apr_size_t header_length;
+	apr_size_t log_length;
+	const char *log_body;
+	mrcp_message_t *message;
+	apt_bool_t status = TRUE;
+	apr_size_t i = 0;
+
+	while(i < count) {
+		message = messages[i];
+		if(message_count < MRCP_CONNECTION_MAX_COALESCED_MESSAGES) {
+			/* each message is generated right after the previous one */
+			apt_text_stream_init(&stream,pos,connection->tx_buffer_size - (pos - connection->tx_buffer));
+			if(mrcp_generator_header_run(connection->generator,message,&stream) == TRUE) {
+				header_length = stream.pos - stream.text.buf;
+
+				log_body = message->body.buf;
+				log_length = message->body.length;
+				if(connection->verbose == FALSE && log_length) {
+					/* mask the body, as the generator does in non-verbose mode */
+					log_body = apt_log_data_mask(log_body,&log_length,connection->pool);
+				}
+				apt_obj_log(APT_LOG_MARK,APT_PRIO_INFO,log_obj,"Send MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s%.*s",
+					connection->id,
+					header_length + message->body.length,
+					header_length,
+					stream.text.buf,
+					log_length,
+					log_length ? log_body : "");
+
+				/* the body is sent right out of the message, not copied into the tx buffer */
+				vec[vec_count].iov_base = stream.text.buf;
+				vec[vec_count].iov_len = header_length;
+				vec_count++;
+				if(message->body.length) {
+					vec[vec_count].iov_base = message->body.buf;
+					vec[vec_count].iov_len = message->body.length;
+					vec_count++;
+				}
+				total_length += header_length + message->body.length;
+				pos = stream.pos;
+				message_count++;
+				i++;
+				continue;
+			}
+		}
+
+		if(message_count) {
+			/* the tx buffer is used up, send the messages generated so far and start over */
+			if(mrcp_connection_vec_send(connection->sock,vec,vec_count,total_length) != APR_SUCCESS) {
+				apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,log_obj,"Failed to Send MRCPv2 Data %s",connection->id);
+				return FALSE;
+			}
+			vec_count = 0;
+			message_count = 0;
+			total_length = 0;
+			pos = connection->tx_buffer;
+			continue;
+		}
+
+		/* the header section does not fit the tx buffer or the message is invalid */
+		if(mrcp_connection_message_stream_send(connection,message,log_obj) == FALSE) {
+			status = FALSE;
+		}
+		i++;
+	}
+
+	if(message_count && mrcp_connection_vec_send(connection->sock,vec,vec_count,total_length) != APR_SUCCESS) {
+		apt_obj_log(APT_LOG_MARK,APT_PRIO_WARNING,log_obj,"Failed to Send MRCPv2 Data %s",connection->id);
+		return FALSE;
+	}
+	return status;
+}
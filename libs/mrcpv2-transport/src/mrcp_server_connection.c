@@ -14,26 +14,61 @@
  * limitations under the License.
  */
 
+#include <apr_portable.h>
+#include <apr_thread_mutex.h>
 #include "mrcp_connection.h"
 #include "mrcp_server_connection.h"
 #include "mrcp_control_descriptor.h"
 #include "mrcp_resource_factory.h"
 #include "mrcp_message.h"
+#include "mrcp_message_trace.h"
+#include "mrcp_body_store.h"
 #include "apt_text_stream.h"
 #include "apt_poller_task.h"
+#include "apt_handoff.h"
 #include "apt_pool.h"
 #include "apt_log.h"
 
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
+
+/** Max number of poller threads of an agent */
+#define MRCP_SERVER_AGENT_MAX_THREAD_COUNT 64
+/** Size of the buffer a channel identifier (session-id@resource-name) of a message is composed in */
+#define MRCP_CHANNEL_IDENTIFIER_BUFFER_SIZE 256
+
+typedef struct mrcp_connection_worker_t mrcp_connection_worker_t;
+
+/** Poller thread of the agent, connections are affine to the worker accepted them */
+struct mrcp_connection_worker_t {
+	mrcp_connection_agent_t              *agent;
+	apt_poller_task_t                    *task;
+
+	/* Listening socket (SO_REUSEPORT, if there are multiple workers) */
+	apr_socket_t                         *listen_sock;
+	apr_pollfd_t                          listen_sock_pfd;
+
+	/** Connections having messages queued, flushed at the end of each poll iteration */
+	mrcp_connection_t                    *tx_pending;
+	/** Timer to flush the connections held back by the cork window */
+	apt_timer_t                          *cork_timer;
+};
 
 struct mrcp_connection_agent_t {
 	apr_pool_t                           *pool;
-	apt_poller_task_t                    *task;
+	/** Workers, the first one is the main task the others are added to */
+	mrcp_connection_worker_t            **workers;
+	/** Number of workers */
+	apr_size_t                            worker_count;
 	const mrcp_resource_factory_t        *resource_factory;
 
-	/** List (ring) of MRCP connections */
-	APR_RING_HEAD(mrcp_connection_head_t, mrcp_connection_t) connection_list;
+	/** Guard of the pending channels and the connections shared across the workers */
+	apr_thread_mutex_t                   *guard;
 	/** Table of pending control channels */
 	apr_hash_t                           *pending_channel_table;
+	/** Table of connections by remote IP, each the first of the connections to the IP */
+	apr_hash_t                           *connection_table;
 
 	apt_bool_t                            force_new_connection;
 	apr_size_t                            max_shared_use_count;
@@ -41,11 +76,15 @@ struct mrcp_connection_agent_t {
 	apr_size_t                            rx_buffer_size;
 	apr_uint32_t                          inactivity_timeout;
 	apr_uint32_t                          termination_timeout;
-
-	/* Listening socket */
+	/** Parse header field values on first access */
+	apt_bool_t                            lazy_parse;
+	/** Store byte-identical bodies of received messages are interned in (NULL if none) */
+	mrcp_body_store_t                    *body_store;
+	/** Time (usec) queued messages are held back for to be sent at once */
+	apr_interval_time_t                   cork_window;
+
+	/* Listening address */
 	apr_sockaddr_t                       *sockaddr;
-	apr_socket_t                         *listen_sock;
-	apr_pollfd_t                          listen_sock_pfd;
 
 	void                                 *obj;
 	const mrcp_connection_event_vtable_t *vtable;
@@ -55,13 +94,14 @@ typedef enum {
 	CONNECTION_TASK_MSG_ADD_CHANNEL,
 	CONNECTION_TASK_MSG_MODIFY_CHANNEL,
 	CONNECTION_TASK_MSG_REMOVE_CHANNEL,
-	CONNECTION_TASK_MSG_SEND_MESSAGE
+	CONNECTION_TASK_MSG_SEND_MESSAGE,
+	CONNECTION_TASK_MSG_LISTEN_STOP
 } connection_task_msg_type_e;
 
 typedef struct connection_task_msg_t connection_task_msg_t;
 struct connection_task_msg_t {
 	connection_task_msg_type_e type;
-	mrcp_connection_agent_t   *agent;
+	mrcp_connection_worker_t  *worker;
 	mrcp_control_channel_t    *channel;
 	mrcp_control_descriptor_t *descriptor;
 	mrcp_message_t            *message;
@@ -70,12 +110,15 @@ struct connection_task_msg_t {
 static apt_bool_t mrcp_server_agent_on_destroy(apt_task_t *task);
 static apt_bool_t mrcp_server_agent_msg_process(apt_task_t *task, apt_task_msg_t *task_msg);
 static apt_bool_t mrcp_server_poller_signal_process(void *obj, const apr_pollfd_t *descriptor);
+static void mrcp_server_poller_iteration_process(void *obj);
+static void mrcp_server_agent_connection_flush(mrcp_connection_t *connection);
 
-static apt_bool_t mrcp_server_agent_listening_socket_create(mrcp_connection_agent_t *agent);
-static void mrcp_server_agent_listening_socket_destroy(mrcp_connection_agent_t *agent);
+static apt_bool_t mrcp_server_agent_listening_socket_create(mrcp_connection_worker_t *worker);
+static void mrcp_server_agent_listening_socket_destroy(mrcp_connection_worker_t *worker);
 
 static void mrcp_server_inactivity_timer_proc(apt_timer_t *timer, void *obj);
 static void mrcp_server_termination_timer_proc(apt_timer_t *timer, void *obj);
+static void mrcp_server_cork_timer_proc(apt_timer_t *timer, void *obj);
 
 /** Create connection agent */
 MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
@@ -85,65 +128,151 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 										apr_size_t max_connection_count,
 										apt_bool_t force_new_connection,
 										apr_pool_t *pool)
+{
+	return mrcp_server_connection_agent_create_ex(
+				id,
+				listen_ip,
+				listen_port,
+				max_connection_count,
+				force_new_connection,
+				1,
+				pool);
+}
+
+static mrcp_connection_worker_t* mrcp_server_agent_worker_create(
+										mrcp_connection_agent_t *agent,
+										const char *id,
+										apr_size_t max_connection_count,
+										apt_task_msg_pool_t *msg_pool)
 {
 	apt_task_t *task;
 	apt_task_vtable_t *vtable;
+	mrcp_connection_worker_t *worker = apr_palloc(agent->pool,sizeof(mrcp_connection_worker_t));
+	worker->agent = agent;
+	worker->listen_sock = NULL;
+	worker->tx_pending = NULL;
+	worker->task = apt_poller_task_create(
+					max_connection_count + 1,
+					mrcp_server_poller_signal_process,
+					worker,
+					msg_pool,
+					agent->pool);
+	if(!worker->task) {
+		return NULL;
+	}
+	apt_poller_task_iteration_handler_set(worker->task,mrcp_server_poller_iteration_process);
+	worker->cork_timer = apt_poller_task_timer_create(
+					worker->task,
+					mrcp_server_cork_timer_proc,
+					worker,
+					agent->pool);
+
+	task = apt_poller_task_base_get(worker->task);
+	if(task) {
+		apt_task_name_set(task,id);
+	}
+
+	vtable = apt_poller_task_vtable_get(worker->task);
+	if(vtable) {
+		vtable->destroy = mrcp_server_agent_on_destroy;
+		vtable->process_msg = mrcp_server_agent_msg_process;
+	}
+
+	return worker;
+}
+
+/** Create connection agent with the specified number of threads */
+MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create_ex(
+										const char *id,
+										const char *listen_ip,
+										apr_port_t listen_port,
+										apr_size_t max_connection_count,
+										apt_bool_t force_new_connection,
+										apr_size_t thread_count,
+										apr_pool_t *pool)
+{
+	apr_size_t i;
 	apt_task_msg_pool_t *msg_pool;
 	mrcp_connection_agent_t *agent;
 
 	if(!listen_ip) {
 		return NULL;
 	}
-	
-	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create MRCPv2 Agent [%s] %s:%hu [%"APR_SIZE_T_FMT"]",
-		id,listen_ip,listen_port,max_connection_count);
+
+	if(!thread_count) {
+		thread_count = 1;
+	}
+	else if(thread_count > MRCP_SERVER_AGENT_MAX_THREAD_COUNT) {
+		thread_count = MRCP_SERVER_AGENT_MAX_THREAD_COUNT;
+	}
+#ifndef SO_REUSEPORT
+	if(thread_count > 1) {
+		/* the port cannot be bound more than once */
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"SO_REUSEPORT Not Supported, Use Single Thread [%s]",id);
+		thread_count = 1;
+	}
+#endif
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create MRCPv2 Agent [%s] %s:%hu [%"APR_SIZE_T_FMT"] threads [%"APR_SIZE_T_FMT"]",
+		id,listen_ip,listen_port,max_connection_count,thread_count);
 	agent = apr_palloc(pool,sizeof(mrcp_connection_agent_t));
 	agent->pool = pool;
 	agent->sockaddr = NULL;
-	agent->listen_sock = NULL;
 	agent->force_new_connection = force_new_connection;
 	agent->max_shared_use_count = 100;
 	agent->rx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
 	agent->tx_buffer_size = MRCP_STREAM_BUFFER_SIZE;
 	agent->inactivity_timeout = 600000; /* 10 min */
 	agent->termination_timeout = 3000; /* 3 sec */
+	agent->lazy_parse = FALSE;
+	agent->body_store = NULL;
+	agent->cork_window = 0;
+	agent->resource_factory = NULL;
+	agent->obj = NULL;
+	agent->vtable = NULL;
 
 	apr_sockaddr_info_get(&agent->sockaddr,listen_ip,APR_INET,listen_port,0,pool);
 	if(!agent->sockaddr) {
 		return NULL;
 	}
 
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_task_msg_t),pool);
-	
-	agent->task = apt_poller_task_create(
-					max_connection_count + 1,
-					mrcp_server_poller_signal_process,
-					agent,
-					msg_pool,
-					pool);
-	if(!agent->task) {
+	if(apr_thread_mutex_create(&agent->guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
 		return NULL;
 	}
+	agent->pending_channel_table = apr_hash_make(pool);
+	agent->connection_table = apr_hash_make(pool);
 
-	task = apt_poller_task_base_get(agent->task);
-	if(task) {
-		apt_task_name_set(task,id);
-	}
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(connection_task_msg_t),pool);
 
-	vtable = apt_poller_task_vtable_get(agent->task);
-	if(vtable) {
-		vtable->destroy = mrcp_server_agent_on_destroy;
-		vtable->process_msg = mrcp_server_agent_msg_process;
+	agent->workers = apr_palloc(pool,sizeof(mrcp_connection_worker_t*) * thread_count);
+	agent->worker_count = 0;
+	for(i=0; i<thread_count; i++) {
+		mrcp_connection_worker_t *worker = mrcp_server_agent_worker_create(
+					agent,
+					i == 0 ? id : apr_psprintf(pool,"%s-%"APR_SIZE_T_FMT,id,i),
+					max_connection_count,
+					msg_pool);
+		if(!worker) {
+			if(i == 0) {
+				return NULL;
+			}
+			break;
+		}
+		if(i > 0) {
+			/* the other workers are started and terminated along with the main one */
+			apt_task_add(apt_poller_task_base_get(agent->workers[0]->task),apt_poller_task_base_get(worker->task));
+		}
+		agent->workers[agent->worker_count++] = worker;
 	}
 
-	APR_RING_INIT(&agent->connection_list, mrcp_connection_t, link);
-	agent->pending_channel_table = apr_hash_make(pool);
-
-	if(mrcp_server_agent_listening_socket_create(agent) != TRUE) {
-		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Listening Socket [%s] %s:%hu", 
-				id,
-				listen_ip,
-				listen_port);
+	for(i=0; i<agent->worker_count; i++) {
+		mrcp_connection_worker_t *worker = agent->workers[i];
+		if(mrcp_server_agent_listening_socket_create(worker) != TRUE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Listening Socket [%s] %s:%hu", 
+					apt_task_name_get(apt_poller_task_base_get(worker->task)),
+					listen_ip,
+					listen_port);
+		}
 	}
 	return agent;
 }
@@ -151,9 +280,9 @@ MRCP_DECLARE(mrcp_connection_agent_t*) mrcp_server_connection_agent_create(
 static apt_bool_t mrcp_server_agent_on_destroy(apt_task_t *task)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	mrcp_connection_agent_t *agent = apt_poller_task_object_get(poller_task);
+	mrcp_connection_worker_t *worker = apt_poller_task_object_get(poller_task);
 
-	mrcp_server_agent_listening_socket_destroy(agent);
+	mrcp_server_agent_listening_socket_destroy(worker);
 	apt_poller_task_cleanup(poller_task);
 	return TRUE;
 }
@@ -163,19 +292,20 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_destroy(mrcp_connection_ag
 {
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Destroy MRCPv2 Agent [%s]",
 		mrcp_server_connection_agent_id_get(agent));
-	return apt_poller_task_destroy(agent->task);
+	/* the other workers are destroyed along with the main one */
+	return apt_poller_task_destroy(agent->workers[0]->task);
 }
 
 /** Start connection agent. */
 MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_start(mrcp_connection_agent_t *agent)
 {
-	return apt_poller_task_start(agent->task);
+	return apt_poller_task_start(agent->workers[0]->task);
 }
 
 /** Terminate connection agent. */
 MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_terminate(mrcp_connection_agent_t *agent)
 {
-	return apt_poller_task_terminate(agent->task);
+	return apt_poller_task_terminate(agent->workers[0]->task);
 }
 
 /** Set connection event handler. */
@@ -242,11 +372,52 @@ MRCP_DECLARE(void) mrcp_server_connection_term_timeout_set(
 	agent->termination_timeout = (apr_uint32_t)timeout * 1000;
 }
 
+/** Set lazy parsing of header fields */
+MRCP_DECLARE(void) mrcp_server_connection_lazy_parse_set(
+								mrcp_connection_agent_t *agent,
+								apt_bool_t lazy)
+{
+	agent->lazy_parse = lazy;
+}
+
+/** Enable interning of bodies of received messages */
+MRCP_DECLARE(apt_bool_t) mrcp_server_connection_body_interning_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t min_size,
+								apr_size_t max_size)
+{
+	/* shared by the connections of all the workers, the store outlives them */
+	agent->body_store = mrcp_body_store_create(min_size,max_size,agent->pool);
+	return agent->body_store ? TRUE : FALSE;
+}
+
+MRCP_DECLARE(void) mrcp_server_connection_cork_window_set(
+								mrcp_connection_agent_t *agent,
+								apr_size_t window)
+{
+	agent->cork_window = (apr_interval_time_t)window;
+}
+
 
 /** Get task */
 MRCP_DECLARE(apt_task_t*) mrcp_server_connection_agent_task_get(const mrcp_connection_agent_t *agent)
 {
-	return apt_poller_task_base_get(agent->task);
+	return apt_poller_task_base_get(agent->workers[0]->task);
+}
+
+/** Get number of threads */
+MRCP_DECLARE(apr_size_t) mrcp_server_connection_agent_thread_count_get(const mrcp_connection_agent_t *agent)
+{
+	return agent->worker_count;
+}
+
+/** Get task of the specified thread */
+MRCP_DECLARE(apt_task_t*) mrcp_server_connection_agent_thread_task_get(const mrcp_connection_agent_t *agent, apr_size_t index)
+{
+	if(index >= agent->worker_count) {
+		return NULL;
+	}
+	return apt_poller_task_base_get(agent->workers[index]->task);
 }
 
 /** Get external object */
@@ -258,7 +429,7 @@ MRCP_DECLARE(void*) mrcp_server_connection_agent_object_get(const mrcp_connectio
 /** Get string identifier */
 MRCP_DECLARE(const char*) mrcp_server_connection_agent_id_get(const mrcp_connection_agent_t *agent)
 {
-	apt_task_t *task = apt_poller_task_base_get(agent->task);
+	apt_task_t *task = apt_poller_task_base_get(agent->workers[0]->task);
 	return apt_task_name_get(task);
 }
 
@@ -290,20 +461,35 @@ MRCP_DECLARE(apt_bool_t) mrcp_server_control_channel_destroy(mrcp_control_channe
 	return TRUE;
 }
 
+/** Get worker to process requests of the control channel */
+static mrcp_connection_worker_t* mrcp_server_channel_worker_get(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel)
+{
+	mrcp_connection_worker_t *worker = agent->workers[0];
+	if(agent->worker_count > 1) {
+		/* once assigned, the channel belongs to the worker of the connection */
+		apr_thread_mutex_lock(agent->guard);
+		if(channel->connection) {
+			worker = channel->connection->agent;
+		}
+		apr_thread_mutex_unlock(agent->guard);
+	}
+	return worker;
+}
+
 /** Signal task message */
 static apt_bool_t mrcp_server_control_message_signal(
 								connection_task_msg_type_e type,
-								mrcp_connection_agent_t *agent,
+								mrcp_connection_worker_t *worker,
 								mrcp_control_channel_t *channel,
 								mrcp_control_descriptor_t *descriptor,
 								mrcp_message_t *message)
 {
-	apt_task_t *task = apt_poller_task_base_get(agent->task);
+	apt_task_t *task = apt_poller_task_base_get(worker->task);
 	apt_task_msg_t *task_msg = apt_task_msg_get(task);
 	if(task_msg) {
 		connection_task_msg_t *msg = (connection_task_msg_t*)task_msg->data;
 		msg->type = type;
-		msg->agent = agent;
+		msg->worker = worker;
 		msg->channel = channel;
 		msg->descriptor = descriptor;
 		msg->message = message;
@@ -312,72 +498,118 @@ static apt_bool_t mrcp_server_control_message_signal(
 	return TRUE;
 }
 
+/** Stop accepting new connections */
+MRCP_DECLARE(apt_bool_t) mrcp_server_connection_agent_listen_stop(mrcp_connection_agent_t *agent)
+{
+	apr_size_t i;
+	for(i=0; i<agent->worker_count; i++) {
+		mrcp_server_control_message_signal(CONNECTION_TASK_MSG_LISTEN_STOP,agent->workers[i],NULL,NULL,NULL);
+	}
+	return TRUE;
+}
+
 /** Add MRCPv2 control channel */
 MRCP_DECLARE(apt_bool_t) mrcp_server_control_channel_add(mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
 {
-	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_ADD_CHANNEL,channel->agent,channel,descriptor,NULL);
+	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_ADD_CHANNEL,channel->agent->workers[0],channel,descriptor,NULL);
 }
 
 /** Modify MRCPv2 control channel */
 MRCP_DECLARE(apt_bool_t) mrcp_server_control_channel_modify(mrcp_control_channel_t *channel, mrcp_control_descriptor_t *descriptor)
 {
-	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_MODIFY_CHANNEL,channel->agent,channel,descriptor,NULL);
+	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_MODIFY_CHANNEL,channel->agent->workers[0],channel,descriptor,NULL);
 }
 
 /** Remove MRCPv2 control channel */
 MRCP_DECLARE(apt_bool_t) mrcp_server_control_channel_remove(mrcp_control_channel_t *channel)
 {
-	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_REMOVE_CHANNEL,channel->agent,channel,NULL,NULL);
+	mrcp_connection_worker_t *worker = mrcp_server_channel_worker_get(channel->agent,channel);
+	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_REMOVE_CHANNEL,worker,channel,NULL,NULL);
 }
 
 /** Send MRCPv2 message */
 MRCP_DECLARE(apt_bool_t) mrcp_server_control_message_send(mrcp_control_channel_t *channel, mrcp_message_t *message)
 {
-	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_SEND_MESSAGE,channel->agent,channel,NULL,message);
+	mrcp_connection_worker_t *worker = mrcp_server_channel_worker_get(channel->agent,channel);
+	return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_SEND_MESSAGE,worker,channel,NULL,message);
 }
 
-/** Create listening socket and add it to pollset */
-static apt_bool_t mrcp_server_agent_listening_socket_create(mrcp_connection_agent_t *agent)
+/** Create, bind and listen socket */
+static apt_bool_t mrcp_server_agent_listening_socket_open(mrcp_connection_worker_t *worker)
 {
 	apr_status_t status;
-	if(!agent->sockaddr) {
-		return FALSE;
-	}
+	mrcp_connection_agent_t *agent = worker->agent;
 
 	/* create listening socket */
-	status = apr_socket_create(&agent->listen_sock, agent->sockaddr->family, SOCK_STREAM, APR_PROTO_TCP, agent->pool);
+	status = apr_socket_create(&worker->listen_sock, agent->sockaddr->family, SOCK_STREAM, APR_PROTO_TCP, agent->pool);
 	if(status != APR_SUCCESS) {
 		return FALSE;
 	}
 
-	apr_socket_opt_set(agent->listen_sock, APR_SO_NONBLOCK, 0);
-	apr_socket_timeout_set(agent->listen_sock, -1);
-	apr_socket_opt_set(agent->listen_sock, APR_SO_REUSEADDR, 1);
+	apr_socket_opt_set(worker->listen_sock, APR_SO_NONBLOCK, 0);
+	apr_socket_timeout_set(worker->listen_sock, -1);
+	apr_socket_opt_set(worker->listen_sock, APR_SO_REUSEADDR, 1);
+#ifdef SO_REUSEPORT
+	if(agent->worker_count > 1) {
+		/* every worker listens on the same port, the kernel balances incoming connections */
+		apr_os_sock_t fd;
+		int on = 1;
+		if(apr_os_sock_get(&fd,worker->listen_sock) != APR_SUCCESS ||
+			setsockopt(fd,SOL_SOCKET,SO_REUSEPORT,(void*)&on,sizeof(on)) != 0) {
+			apr_socket_close(worker->listen_sock);
+			worker->listen_sock = NULL;
+			return FALSE;
+		}
+	}
+#endif
 
-	status = apr_socket_bind(agent->listen_sock, agent->sockaddr);
+	status = apr_socket_bind(worker->listen_sock, agent->sockaddr);
 	if(status != APR_SUCCESS) {
-		apr_socket_close(agent->listen_sock);
-		agent->listen_sock = NULL;
+		apr_socket_close(worker->listen_sock);
+		worker->listen_sock = NULL;
 		return FALSE;
 	}
-	status = apr_socket_listen(agent->listen_sock, SOMAXCONN);
+	status = apr_socket_listen(worker->listen_sock, SOMAXCONN);
 	if(status != APR_SUCCESS) {
-		apr_socket_close(agent->listen_sock);
-		agent->listen_sock = NULL;
+		apr_socket_close(worker->listen_sock);
+		worker->listen_sock = NULL;
 		return FALSE;
 	}
+	return TRUE;
+}
+
+/** Create listening socket and add it to pollset */
+static apt_bool_t mrcp_server_agent_listening_socket_create(mrcp_connection_worker_t *worker)
+{
+	mrcp_connection_agent_t *agent = worker->agent;
+	apt_handoff_t *handoff = apt_handoff_instance_get();
+	if(!agent->sockaddr) {
+		return FALSE;
+	}
+
+	/* take over the socket handed off by the predecessor, if any */
+	worker->listen_sock = apt_handoff_socket_take(handoff,agent->sockaddr,agent->pool);
+	if(worker->listen_sock) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Take Over Listening Socket [%s]",
+			apt_task_name_get(apt_poller_task_base_get(worker->task)));
+	}
+	else if(mrcp_server_agent_listening_socket_open(worker) == FALSE) {
+		return FALSE;
+	}
+	apt_handoff_socket_add(handoff,worker->listen_sock);
 
 	/* add listening socket to pollset */
-	memset(&agent->listen_sock_pfd,0,sizeof(apr_pollfd_t));
-	agent->listen_sock_pfd.desc_type = APR_POLL_SOCKET;
-	agent->listen_sock_pfd.reqevents = APR_POLLIN;
-	agent->listen_sock_pfd.desc.s = agent->listen_sock;
-	agent->listen_sock_pfd.client_data = agent->listen_sock;
-	if(apt_poller_task_descriptor_add(agent->task, &agent->listen_sock_pfd) != TRUE) {
+	memset(&worker->listen_sock_pfd,0,sizeof(apr_pollfd_t));
+	worker->listen_sock_pfd.desc_type = APR_POLL_SOCKET;
+	worker->listen_sock_pfd.reqevents = APR_POLLIN;
+	worker->listen_sock_pfd.desc.s = worker->listen_sock;
+	worker->listen_sock_pfd.client_data = worker->listen_sock;
+	if(apt_poller_task_descriptor_add(worker->task, &worker->listen_sock_pfd) != TRUE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add Listening Socket to Pollset [%s]",
-			apt_task_name_get(apt_poller_task_base_get(agent->task)));
-		apr_socket_close(agent->listen_sock);
-		agent->listen_sock = NULL;
+			apt_task_name_get(apt_poller_task_base_get(worker->task)));
+		apt_handoff_socket_remove(handoff,worker->listen_sock);
+		apr_socket_close(worker->listen_sock);
+		worker->listen_sock = NULL;
 		return FALSE;
 	}
 
@@ -385,26 +617,42 @@ static apt_bool_t mrcp_server_agent_listening_socket_create(mrcp_connection_agen
 }
 
 /** Remove from pollset and destroy listening socket */
-static void mrcp_server_agent_listening_socket_destroy(mrcp_connection_agent_t *agent)
+static void mrcp_server_agent_listening_socket_destroy(mrcp_connection_worker_t *worker)
 {
-	if(agent->listen_sock) {
-		apt_poller_task_descriptor_remove(agent->task,&agent->listen_sock_pfd);
-		apr_socket_close(agent->listen_sock);
-		agent->listen_sock = NULL;
+	if(worker->listen_sock) {
+		apt_poller_task_descriptor_remove(worker->task,&worker->listen_sock_pfd);
+		apt_handoff_socket_remove(apt_handoff_instance_get(),worker->listen_sock);
+		apr_socket_close(worker->listen_sock);
+		worker->listen_sock = NULL;
 	}
 }
 
 /** Associate control channel with MRCPv2 connection */
 static mrcp_control_channel_t* mrcp_connection_channel_associate(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, const mrcp_message_t *message)
 {
+	char buf[MRCP_CHANNEL_IDENTIFIER_BUFFER_SIZE];
 	apt_str_t identifier;
 	mrcp_control_channel_t *channel;
+	const mrcp_channel_id *channel_id;
 	if(!connection || !message) {
 		return NULL;
 	}
-	apt_id_resource_generate(&message->channel_id.session_id,&message->channel_id.resource_name,'@',&identifier,connection->pool);
+	channel_id = &message->channel_id;
+	identifier.length = channel_id->session_id.length + channel_id->resource_name.length + 1;
+	if(identifier.length < sizeof(buf)) {
+		/* compose the key on the stack, no allocation per message */
+		memcpy(buf,channel_id->session_id.buf,channel_id->session_id.length);
+		buf[channel_id->session_id.length] = '@';
+		memcpy(buf + channel_id->session_id.length + 1,channel_id->resource_name.buf,channel_id->resource_name.length);
+		buf[identifier.length] = '\0';
+		identifier.buf = buf;
+	}
+	else {
+		apt_id_resource_generate(&channel_id->session_id,&channel_id->resource_name,'@',&identifier,connection->pool);
+	}
 	channel = mrcp_connection_channel_find(connection,&identifier);
 	if(!channel) {
+		apr_thread_mutex_lock(agent->guard);
 		channel = apr_hash_get(agent->pending_channel_table,identifier.buf,identifier.length);
 		if(channel) {
 			apr_hash_set(agent->pending_channel_table,identifier.buf,identifier.length,NULL);
@@ -415,54 +663,96 @@ static mrcp_control_channel_t* mrcp_connection_channel_associate(mrcp_connection
 				apr_hash_count(agent->pending_channel_table),
 				apr_hash_count(connection->channel_table));
 		}
+		apr_thread_mutex_unlock(agent->guard);
 	}
 	return channel;
 }
 
+/** Find connection across the workers, the guard is expected to be locked */
 static mrcp_connection_t* mrcp_connection_find(mrcp_connection_agent_t *agent, const apt_str_t *remote_ip)
 {
-	mrcp_connection_t *connection;
 	if(!agent || !remote_ip) {
 		return NULL;
 	}
+	return apr_hash_get(agent->connection_table,remote_ip->buf,remote_ip->length);
+}
 
-	for(connection = APR_RING_FIRST(&agent->connection_list);
-			connection != APR_RING_SENTINEL(&agent->connection_list, mrcp_connection_t, link);
-				connection = APR_RING_NEXT(connection, link)) {
-		if(apt_string_compare(&connection->remote_ip,remote_ip) == TRUE) {
-			return connection;
-		}
+/** Index connection by remote IP, the guard is expected to be locked */
+static void mrcp_connection_index_add(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+{
+	mrcp_connection_t *first = apr_hash_get(agent->connection_table,connection->remote_ip.buf,connection->remote_ip.length);
+	if(!first) {
+		connection->peer_prev = NULL;
+		connection->peer_next = NULL;
+		apr_hash_set(agent->connection_table,connection->remote_ip.buf,connection->remote_ip.length,connection);
+		return;
 	}
 
-	return NULL;
+	/* the first connection stays the one found, and its IP stays the key */
+	connection->peer_prev = first;
+	connection->peer_next = first->peer_next;
+	if(first->peer_next) {
+		first->peer_next->peer_prev = connection;
+	}
+	first->peer_next = connection;
+}
+
+/** Remove connection from the index, the guard is expected to be locked */
+static void mrcp_connection_index_remove(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+{
+	mrcp_connection_t *next = connection->peer_next;
+	if(connection->peer_prev) {
+		connection->peer_prev->peer_next = next;
+		if(next) {
+			next->peer_prev = connection->peer_prev;
+		}
+	}
+	else if(apr_hash_get(agent->connection_table,connection->remote_ip.buf,connection->remote_ip.length) == connection) {
+		/* the key refers to the IP of the connection, re-add it by the next one */
+		apr_hash_set(agent->connection_table,connection->remote_ip.buf,connection->remote_ip.length,NULL);
+		if(next) {
+			next->peer_prev = NULL;
+			apr_hash_set(agent->connection_table,next->remote_ip.buf,next->remote_ip.length,next);
+		}
+	}
+	connection->peer_prev = NULL;
+	connection->peer_next = NULL;
 }
 
-static apt_bool_t mrcp_connection_add(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+static apt_bool_t mrcp_connection_add(mrcp_connection_worker_t *worker, mrcp_connection_t *connection)
 {
-	APR_RING_INSERT_TAIL(&agent->connection_list,connection,mrcp_connection_t,link);
+	mrcp_connection_agent_t *agent = worker->agent;
+	apr_thread_mutex_lock(agent->guard);
+	mrcp_connection_index_add(agent,connection);
+	apr_thread_mutex_unlock(agent->guard);
 	if(connection->inactivity_timer) {
 		apt_timer_set(connection->inactivity_timer,agent->inactivity_timeout);
 	}
 	return TRUE;
 }
 
-static apt_bool_t mrcp_connection_remove(mrcp_connection_agent_t *agent, mrcp_connection_t *connection)
+static apt_bool_t mrcp_connection_remove(mrcp_connection_worker_t *worker, mrcp_connection_t *connection)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	if(connection->inactivity_timer) {
 		apt_timer_kill(connection->inactivity_timer);
 	}
-	APR_RING_REMOVE(connection,link);
+	apr_thread_mutex_lock(agent->guard);
+	mrcp_connection_index_remove(agent,connection);
+	apr_thread_mutex_unlock(agent->guard);
 	return TRUE;
 }
 
-static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *agent)
+static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_worker_t *worker)
 {
 	char *local_ip = NULL;
 	char *remote_ip = NULL;
+	apr_size_t pending_count;
+	mrcp_connection_agent_t *agent = worker->agent;
 	
 	mrcp_connection_t *connection = mrcp_connection_create();
 
-	if(apr_socket_accept(&connection->sock,agent->listen_sock,connection->pool) != APR_SUCCESS) {
+	if(apr_socket_accept(&connection->sock,worker->listen_sock,connection->pool) != APR_SUCCESS) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Accept Connection");
 		mrcp_connection_destroy(connection);
 		return FALSE;
@@ -479,11 +769,16 @@ static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *a
 	apr_sockaddr_ip_get(&local_ip,connection->l_sockaddr);
 	apr_sockaddr_ip_get(&remote_ip,connection->r_sockaddr);
 	apt_string_set(&connection->remote_ip,remote_ip);
+	/* small events are not to be delayed by Nagle, they are coalesced by the agent instead */
+	apr_socket_opt_set(connection->sock,APR_TCP_NODELAY,1);
 	connection->id = apr_psprintf(connection->pool,"%s:%hu <-> %s:%hu",
 		local_ip,connection->l_sockaddr->port,
 		remote_ip,connection->r_sockaddr->port);
 
-	if(apr_hash_count(agent->pending_channel_table) == 0) {
+	apr_thread_mutex_lock(agent->guard);
+	pending_count = apr_hash_count(agent->pending_channel_table);
+	apr_thread_mutex_unlock(agent->guard);
+	if(pending_count == 0) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Reject Unexpected TCP/MRCPv2 Connection %s",connection->id);
 		apr_socket_close(connection->sock);
 		mrcp_connection_destroy(connection);
@@ -495,21 +790,27 @@ static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *a
 	connection->sock_pfd.reqevents = APR_POLLIN;
 	connection->sock_pfd.desc.s = connection->sock;
 	connection->sock_pfd.client_data = connection;
-	if(apt_poller_task_descriptor_add(agent->task, &connection->sock_pfd) != TRUE) {
+	if(apt_poller_task_descriptor_add(worker->task, &connection->sock_pfd) != TRUE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add to Pollset %s",connection->id);
 		apr_socket_close(connection->sock);
 		mrcp_connection_destroy(connection);
 		return FALSE;
 	}
 
-	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Accepted TCP/MRCPv2 Connection %s",connection->id);
-	connection->agent = agent;
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Accepted TCP/MRCPv2 Connection %s [%s]",
+		connection->id,
+		apt_task_name_get(apt_poller_task_base_get(worker->task)));
+	/* the connection is processed by the worker accepted it */
+	connection->agent = worker;
 
 	connection->parser = mrcp_parser_create(agent->resource_factory,connection->pool);
+	mrcp_parser_lazy_mode_set(connection->parser,agent->lazy_parse);
+	mrcp_parser_body_store_set(connection->parser,agent->body_store);
 	connection->generator = mrcp_generator_create(agent->resource_factory,connection->pool);
 
 	connection->tx_buffer_size = agent->tx_buffer_size;
 	connection->tx_buffer = apr_palloc(connection->pool,connection->tx_buffer_size+1);
+	connection->tx_queue = apr_array_make(connection->pool,MRCP_CONNECTION_MAX_COALESCED_MESSAGES,sizeof(mrcp_message_t*));
 
 	connection->rx_buffer_size = agent->rx_buffer_size;
 	connection->rx_buffer = apr_palloc(connection->pool,connection->rx_buffer_size+1);
@@ -523,24 +824,27 @@ static apt_bool_t mrcp_server_agent_connection_accept(mrcp_connection_agent_t *a
 
 	if(agent->inactivity_timeout) {
 		connection->inactivity_timer = apt_poller_task_timer_create(
-										agent->task,
+										worker->task,
 										mrcp_server_inactivity_timer_proc,
 										connection,
 										connection->pool);
 	}
 
-	mrcp_connection_add(agent,connection);
+	mrcp_connection_add(worker,connection);
 	return TRUE;
 }
 
-static apt_bool_t mrcp_server_agent_connection_close(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, apt_bool_t timedout)
+static apt_bool_t mrcp_server_agent_connection_close(mrcp_connection_worker_t *worker, mrcp_connection_t *connection, apt_bool_t timedout)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
+	/* the responses queued ahead of the close are still sent */
+	mrcp_server_agent_connection_flush(connection);
 	if(connection->sock) {
-		apt_poller_task_descriptor_remove(agent->task,&connection->sock_pfd);
+		apt_poller_task_descriptor_remove(worker->task,&connection->sock_pfd);
 		apr_socket_close(connection->sock);
 		connection->sock = NULL;
 	}
-	mrcp_connection_remove(agent,connection);
+	mrcp_connection_remove(worker,connection);
 	if(connection->access_count) {
 		if(timedout == TRUE) {
 			mrcp_connection_disconnect_raise(connection,agent->vtable);
@@ -548,7 +852,7 @@ static apt_bool_t mrcp_server_agent_connection_close(mrcp_connection_agent_t *ag
 		else {
 			if(agent->termination_timeout) {
 				connection->termination_timer = apt_poller_task_timer_create(
-												agent->task,
+												worker->task,
 												mrcp_server_termination_timer_proc,
 												connection,
 												connection->pool);
@@ -585,19 +889,22 @@ static void mrcp_server_termination_timer_proc(apt_timer_t *timer, void *obj)
 	if(!connection) return;
 
 	if(connection->termination_timer == timer) {
-		mrcp_connection_agent_t *agent = connection->agent;
+		mrcp_connection_worker_t *worker = connection->agent;
+		mrcp_connection_agent_t *agent = worker->agent;
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Termination Timeout Elapsed %s",connection->id);
 		mrcp_connection_disconnect_raise(connection,agent->vtable);
 	}
 }
 
-static apt_bool_t mrcp_server_agent_channel_add(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *offer)
+static apt_bool_t mrcp_server_agent_channel_add(mrcp_connection_worker_t *worker, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *offer)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	mrcp_control_descriptor_t *answer = mrcp_control_answer_create(offer,channel->pool);
 	apt_id_resource_generate(&offer->session_id,&offer->resource_name,'@',&channel->identifier,channel->pool);
 	if(offer->port) {
 		answer->port = agent->sockaddr->port;
 	}
+	apr_thread_mutex_lock(agent->guard);
 	if(offer->connection_type == MRCP_CONNECTION_TYPE_EXISTING) {
 		if(agent->force_new_connection == TRUE) {
 			/* force client to establish new connection */
@@ -627,12 +934,14 @@ static apt_bool_t mrcp_server_agent_channel_add(mrcp_connection_agent_t *agent,
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Add Pending Control Channel <%s> [%d]",
 			channel->identifier.buf,
 			apr_hash_count(agent->pending_channel_table));
+	apr_thread_mutex_unlock(agent->guard);
 	/* send response */
 	return mrcp_control_channel_add_respond(agent->vtable,channel,answer,TRUE);
 }
 
-static apt_bool_t mrcp_server_agent_channel_modify(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *offer)
+static apt_bool_t mrcp_server_agent_channel_modify(mrcp_connection_worker_t *worker, mrcp_control_channel_t *channel, mrcp_control_descriptor_t *offer)
 {
+	mrcp_connection_agent_t *agent = worker->agent;
 	mrcp_control_descriptor_t *answer = mrcp_control_answer_create(offer,channel->pool);
 	if(offer->port) {
 		answer->port = agent->sockaddr->port;
@@ -642,10 +951,20 @@ static apt_bool_t mrcp_server_agent_channel_modify(mrcp_connection_agent_t *agen
 	return mrcp_control_channel_modify_respond(agent->vtable,channel,answer,TRUE);
 }
 
-static apt_bool_t mrcp_server_agent_channel_remove(mrcp_connection_agent_t *agent, mrcp_control_channel_t *channel)
+static apt_bool_t mrcp_server_agent_channel_remove(mrcp_connection_worker_t *worker, mrcp_control_channel_t *channel)
 {
-	mrcp_connection_t *connection = channel->connection;
+	mrcp_connection_agent_t *agent = worker->agent;
+	mrcp_connection_t *connection;
+	apr_thread_mutex_lock(agent->guard);
+	connection = channel->connection;
+	if(connection && connection->agent != worker) {
+		/* the channel has meanwhile been assigned to a connection of another worker */
+		apr_thread_mutex_unlock(agent->guard);
+		return mrcp_server_control_message_signal(CONNECTION_TASK_MSG_REMOVE_CHANNEL,connection->agent,channel,NULL,NULL);
+	}
 	if(connection) {
+		/* the responses of the channel are sent before the session they are allocated from goes away */
+		mrcp_server_agent_connection_flush(connection);
 		mrcp_connection_channel_remove(connection,channel);
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Remove Control Channel <%s> [%d]",
 				channel->identifier.buf,
@@ -669,55 +988,66 @@ static apt_bool_t mrcp_server_agent_channel_remove(mrcp_connection_agent_t *agen
 				channel->identifier.buf,
 				apr_hash_count(agent->pending_channel_table));
 	}
+	apr_thread_mutex_unlock(agent->guard);
 	/* send response */
 	return mrcp_control_channel_remove_respond(agent->vtable,channel,TRUE);
 }
 
-static apt_bool_t mrcp_server_agent_messsage_send(mrcp_connection_agent_t *agent, mrcp_connection_t *connection, mrcp_message_t *message)
+/** Send the messages queued to the connection by a single write and unlink it from the pending ones */
+static void mrcp_server_agent_connection_flush(mrcp_connection_t *connection)
 {
-	apt_bool_t status = FALSE;
-	apt_text_stream_t stream;
-	apt_message_status_e result;
-	if(!connection || !connection->sock) {
-		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Null MRCPv2 Connection " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(message));
-		return FALSE;
+	mrcp_connection_worker_t *worker = connection->agent;
+	mrcp_connection_t **it;
+	if(!connection->tx_queue || !connection->tx_queue->nelts) {
+		return;
 	}
 
-	do {
-		apt_text_stream_init(&stream,connection->tx_buffer,connection->tx_buffer_size);
-		result = mrcp_generator_run(connection->generator,message,&stream);
-		if(result != APT_MESSAGE_STATUS_INVALID) {
-			stream.text.length = stream.pos - stream.text.buf;
-			*stream.pos = '\0';
+	for(it = &worker->tx_pending; *it; it = &(*it)->tx_next) {
+		if(*it == connection) {
+			*it = connection->tx_next;
+			break;
+		}
+	}
+	connection->tx_next = NULL;
 
-			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Send MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
-					connection->id,
-					stream.text.length,
-					connection->verbose == TRUE ? stream.text.length : 0,
-					stream.text.buf);
+	if(connection->sock) {
+		mrcp_connection_messages_send(
+			connection,
+			(mrcp_message_t**)connection->tx_queue->elts,
+			connection->tx_queue->nelts,
+			NULL);
+	}
+	apr_array_clear(connection->tx_queue);
+}
 
-			if(apr_socket_send(connection->sock,stream.text.buf,&stream.text.length) == APR_SUCCESS) {
-				status = TRUE;
-			}
-			else {
-				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Send MRCPv2 Data");
-			}
-		}
-		else {
-			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Generate MRCPv2 Data");
-		}
+/** Queue the message to be sent along with the others of the poll iteration */
+static apt_bool_t mrcp_server_agent_messsage_send(mrcp_connection_worker_t *worker, mrcp_connection_t *connection, mrcp_message_t *message)
+{
+	if(!connection || !connection->sock) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Null MRCPv2 Connection " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(message));
+		return FALSE;
 	}
-	while(result == APT_MESSAGE_STATUS_INCOMPLETE);
 
-	return status;
+	if(!connection->tx_queue->nelts) {
+		/* the connection is worked by the worker it is affine to */
+		worker = connection->agent;
+		connection->tx_next = worker->tx_pending;
+		worker->tx_pending = connection;
+		connection->tx_time = worker->agent->cork_window ? apr_time_now() : 0;
+	}
+	APR_ARRAY_PUSH(connection->tx_queue,mrcp_message_t*) = message;
+	return TRUE;
 }
 
 static apt_bool_t mrcp_server_message_handler(mrcp_connection_t *connection, mrcp_message_t *message, apt_message_status_e status)
 {
-	mrcp_connection_agent_t *agent = connection->agent;
+	mrcp_connection_worker_t *worker = connection->agent;
+	mrcp_connection_agent_t *agent = worker->agent;
 	if(status == APT_MESSAGE_STATUS_COMPLETE) {
 		/* message is completely parsed */
-		mrcp_control_channel_t *channel = mrcp_connection_channel_associate(agent,connection,message);
+		mrcp_control_channel_t *channel;
+		mrcp_message_trace_start(message);
+		channel = mrcp_connection_channel_associate(agent,connection,message);
 		if(channel) {
 			/* (re)set inactivity timer on every message received */
 			if(connection->inactivity_timer) {
@@ -739,7 +1069,7 @@ static apt_bool_t mrcp_server_message_handler(mrcp_connection_t *connection, mrc
 			mrcp_message_t *response;
 			response = mrcp_response_create(message,message->pool);
 			response->start_line.status_code = MRCP_STATUS_CODE_UNRECOGNIZED_MESSAGE;
-			if(mrcp_server_agent_messsage_send(agent,connection,response) == FALSE) {
+			if(mrcp_server_agent_messsage_send(worker,connection,response) == FALSE) {
 				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Send MRCPv2 Response");
 			}
 		}
@@ -750,79 +1080,92 @@ static apt_bool_t mrcp_server_message_handler(mrcp_connection_t *connection, mrc
 /* Receive MRCP message through TCP/MRCPv2 connection */
 static apt_bool_t mrcp_server_poller_signal_process(void *obj, const apr_pollfd_t *descriptor)
 {
-	mrcp_connection_agent_t *agent = obj;
+	mrcp_connection_worker_t *worker = obj;
 	mrcp_connection_t *connection = descriptor->client_data;
 	apr_status_t status;
-	apr_size_t offset;
-	apr_size_t length;
-	apt_text_stream_t *stream;
-	mrcp_message_t *message;
-	apt_message_status_e msg_status;
 
-	if(descriptor->desc.s == agent->listen_sock) {
-		return mrcp_server_agent_connection_accept(agent);
+	if(descriptor->desc.s == worker->listen_sock) {
+		return mrcp_server_agent_connection_accept(worker);
 	}
 
 	if(!connection || !connection->sock) {
 		return FALSE;
 	}
-	stream = &connection->rx_stream;
 
-	/* calculate offset remaining from the previous receive / if any */
-	offset = stream->pos - stream->text.buf;
-	/* calculate available length */
-	length = connection->rx_buffer_size - offset;
-
-	status = apr_socket_recv(connection->sock,stream->pos,&length);
-	if(status == APR_EOF || length == 0) {
+	status = mrcp_connection_receive(connection,mrcp_server_message_handler);
+	if(status == APR_EOF) {
 		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"TCP/MRCPv2 Peer Disconnected %s",connection->id);
-		return mrcp_server_agent_connection_close(agent,connection,FALSE);
+		return mrcp_server_agent_connection_close(worker,connection,FALSE);
 	}
+	return status == APR_SUCCESS ? TRUE : FALSE;
+}
 
-	/* calculate actual length of the stream */
-	stream->text.length = offset + length;
-	stream->pos[length] = '\0';
-
-	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Receive MRCPv2 Data %s [%"APR_SIZE_T_FMT" bytes]\n%.*s",
-			connection->id,
-			length,
-			connection->verbose == TRUE ? length : 0,
-			stream->pos);
-
-	/* reset pos */
-	apt_text_stream_reset(stream);
+/* Send the messages queued during the poll iteration, a single write per connection */
+static void mrcp_server_poller_iteration_process(void *obj)
+{
+	mrcp_connection_worker_t *worker = obj;
+	apr_interval_time_t cork_window = worker->agent->cork_window;
+	apr_interval_time_t elapsed;
+	apr_interval_time_t remaining = 0;
+	mrcp_connection_t **it;
+	apr_time_t now;
+
+	if(!cork_window) {
+		while(worker->tx_pending) {
+			mrcp_server_agent_connection_flush(worker->tx_pending);
+		}
+		return;
+	}
 
-	do {
-		msg_status = mrcp_parser_run(connection->parser,stream,&message);
-		if(mrcp_server_message_handler(connection,message,msg_status) == FALSE) {
-			return FALSE;
+	/* hold the connections back till their cork window elapses or their queue fills up */
+	now = apr_time_now();
+	it = &worker->tx_pending;
+	while(*it) {
+		elapsed = now - (*it)->tx_time;
+		if(elapsed >= cork_window || (*it)->tx_queue->nelts >= MRCP_CONNECTION_MAX_COALESCED_MESSAGES) {
+			/* unlinked, the next connection takes its place */
+			mrcp_server_agent_connection_flush(*it);
+			continue;
 		}
+		if(!remaining || cork_window - elapsed < remaining) {
+			remaining = cork_window - elapsed;
+		}
+		it = &(*it)->tx_next;
 	}
-	while(apt_text_is_eos(stream) == FALSE);
 
-	/* scroll remaining stream */
-	apt_text_stream_scroll(stream);
-	return TRUE;
+	if(worker->tx_pending && worker->cork_timer) {
+		apt_timer_set(worker->cork_timer,(apr_uint32_t)((remaining + 999) / 1000));
+	}
+}
+
+/* Timer callback */
+static void mrcp_server_cork_timer_proc(apt_timer_t *timer, void *obj)
+{
+	/* nothing to do, the connections are flushed at the end of the poll iteration the timer elapses in */
 }
 
 /* Process task message */
 static apt_bool_t mrcp_server_agent_msg_process(apt_task_t *task, apt_task_msg_t *task_msg)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	mrcp_connection_agent_t *agent = apt_poller_task_object_get(poller_task);
+	mrcp_connection_worker_t *worker = apt_poller_task_object_get(poller_task);
 	connection_task_msg_t *msg = (connection_task_msg_t*) task_msg->data;
 	switch(msg->type) {
 		case CONNECTION_TASK_MSG_ADD_CHANNEL:
-			mrcp_server_agent_channel_add(agent,msg->channel,msg->descriptor);
+			mrcp_server_agent_channel_add(worker,msg->channel,msg->descriptor);
 			break;
 		case CONNECTION_TASK_MSG_MODIFY_CHANNEL:
-			mrcp_server_agent_channel_modify(agent,msg->channel,msg->descriptor);
+			mrcp_server_agent_channel_modify(worker,msg->channel,msg->descriptor);
 			break;
 		case CONNECTION_TASK_MSG_REMOVE_CHANNEL:
-			mrcp_server_agent_channel_remove(agent,msg->channel);
+			mrcp_server_agent_channel_remove(worker,msg->channel);
 			break;
 		case CONNECTION_TASK_MSG_SEND_MESSAGE:
-			mrcp_server_agent_messsage_send(agent,msg->channel->connection,msg->message);
+			mrcp_server_agent_messsage_send(worker,msg->channel->connection,msg->message);
+			break;
+		case CONNECTION_TASK_MSG_LISTEN_STOP:
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Stop Listening [%s]",apt_task_name_get(task));
+			mrcp_server_agent_listening_socket_destroy(worker);
 			break;
 	}
 
@@ -66,6 +66,14 @@ RTSP_DECLARE(rtsp_server_t*) rtsp_server_create(
 									const rtsp_server_vtable_t *handler,
 									apr_pool_t *pool);
 
+/**
+ * Set the number of pollers (threads) connections are distributed across.
+ * @param server the server to set pollers of
+ * @param count the number of pollers, the first one is the main task of the server
+ * @remark Must be called once, before the server is started.
+ */
+RTSP_DECLARE(apt_bool_t) rtsp_server_pollers_set(rtsp_server_t *server, apr_size_t count);
+
 /**
  * Destroy RTSP server.
  * @param server the server to destroy
@@ -84,6 +92,12 @@ RTSP_DECLARE(apt_bool_t) rtsp_server_start(rtsp_server_t *server);
  */
 RTSP_DECLARE(apt_bool_t) rtsp_server_terminate(rtsp_server_t *server);
 
+/**
+ * Stop accepting new connections, the established ones are kept.
+ * @param server the server to stop listening of
+ */
+RTSP_DECLARE(apt_bool_t) rtsp_server_listen_stop(rtsp_server_t *server);
+
 /**
  * Get task.
  * @param server the server to get task from
@@ -360,14 +360,25 @@ static apt_bool_t rtsp_header_field_value_generate(const rtsp_header_t *header,
 	return TRUE;
 }
 
-/** Add RTSP header field */
-RTSP_DECLARE(apt_bool_t) rtsp_header_field_add(rtsp_header_t *header, apt_header_field_t *header_field, apr_pool_t *pool)
+/** Find the id of RTSP header field, referring to the interned name if found */
+static void rtsp_header_field_id_find(apt_header_field_t *header_field)
 {
-	/* parse header field (name-value) */
+	const apt_str_t *name;
 	header_field->id = apt_string_table_id_find(
 								rtsp_header_string_table,
 								RTSP_HEADER_FIELD_COUNT,
 								&header_field->name);
+	name = apt_string_table_str_get(rtsp_header_string_table,RTSP_HEADER_FIELD_COUNT,header_field->id);
+	if(name) {
+		header_field->name = *name;
+	}
+}
+
+/** Add RTSP header field */
+RTSP_DECLARE(apt_bool_t) rtsp_header_field_add(rtsp_header_t *header, apt_header_field_t *header_field, apr_pool_t *pool)
+{
+	/* parse header field (name-value) */
+	rtsp_header_field_id_find(header_field);
 	if(apt_string_is_empty(&header_field->value) == FALSE) {
 		rtsp_header_field_value_parse(header,header_field->id,&header_field->value,pool);
 	}
@@ -383,10 +394,7 @@ RTSP_DECLARE(apt_bool_t) rtsp_header_fields_parse(rtsp_header_t *header, apr_poo
 			header_field != APR_RING_SENTINEL(&header->header_section.ring, apt_header_field_t, link);
 				header_field = APR_RING_NEXT(header_field, link)) {
 
-		header_field->id = apt_string_table_id_find(
-								rtsp_header_string_table,
-								RTSP_HEADER_FIELD_COUNT,
-								&header_field->name);
+		rtsp_header_field_id_find(header_field);
 		if(apt_string_is_empty(&header_field->value) == FALSE) {
 			rtsp_header_field_value_parse(header,header_field->id,&header_field->value,pool);
 		}
@@ -19,9 +19,11 @@
 #endif
 #include <apr_ring.h>
 #include <apr_hash.h>
+#include <apr_atomic.h>
 #include "rtsp_server.h"
 #include "rtsp_stream.h"
 #include "apt_poller_task.h"
+#include "apt_handoff.h"
 #include "apt_text_stream.h"
 #include "apt_pool.h"
 #include "apt_obj_list.h"
@@ -29,16 +31,39 @@
 
 #define RTSP_SESSION_ID_HEX_STRING_LENGTH 16
 #define RTSP_STREAM_BUFFER_SIZE 1024
+#define RTSP_SERVER_MAX_POLLER_COUNT 64
 
 typedef struct rtsp_server_connection_t rtsp_server_connection_t;
+typedef struct rtsp_server_poller_t rtsp_server_poller_t;
+
+/** RTSP poller (thread connections are processed in) */
+struct rtsp_server_poller_t {
+	/** Poller task */
+	apt_poller_task_t          *task;
+	/** RTSP server, poller belongs to */
+	rtsp_server_t              *server;
+
+	/** List (ring) of RTSP connections */
+	APR_RING_HEAD(rtsp_server_connection_head_t, rtsp_server_connection_t) connection_list;
+};
 
 /** RTSP server */
 struct rtsp_server_t {
 	apr_pool_t                 *pool;
+	/** Main poller task (listening socket is polled by) */
 	apt_poller_task_t          *task;
 
-	/** List (ring) of RTSP connections */
-	APR_RING_HEAD(rtsp_server_connection_head_t, rtsp_server_connection_t) connection_list;
+	/** Pollers connections are distributed across (the first one is the main) */
+	rtsp_server_poller_t      **pollers;
+	/** Number of pollers */
+	apr_size_t                  poller_count;
+	/** Poller to assign the next connection to */
+	apr_size_t                  next_poller;
+
+	/** Max number of connections across all the pollers */
+	apr_size_t                  max_connection_count;
+	/** Number of connections across all the pollers */
+	volatile apr_uint32_t       connection_count;
 
 	apr_uint32_t                inactivity_timeout;
 	apt_bool_t                  online;
@@ -70,6 +95,8 @@ struct rtsp_server_connection_t {
 
 	/** RTSP server, connection belongs to */
 	rtsp_server_t     *server;
+	/** RTSP poller, connection is processed by */
+	rtsp_server_poller_t *poller;
 
 	/** Session table (rtsp_server_session_t*) */
 	apr_hash_t        *session_table;
@@ -113,7 +140,9 @@ struct rtsp_server_session_t {
 typedef enum {
 	TASK_MSG_SEND_MESSAGE,
 	TASK_MSG_TERMINATE_SESSION,
-	TASK_MSG_RELEASE_SESSION
+	TASK_MSG_RELEASE_SESSION,
+	TASK_MSG_ADD_CONNECTION,
+	TASK_MSG_LISTEN_STOP
 } task_msg_data_type_e;
 
 typedef struct task_msg_data_t task_msg_data_t;
@@ -123,6 +152,7 @@ struct task_msg_data_t {
 	rtsp_server_t         *server;
 	rtsp_server_session_t *session;
 	rtsp_message_t        *message;
+	rtsp_server_connection_t *connection;
 };
 
 static apt_bool_t rtsp_server_on_destroy(apt_task_t *task);
@@ -137,6 +167,7 @@ static apt_bool_t rtsp_server_listening_socket_create(rtsp_server_t *server);
 static void rtsp_server_listening_socket_destroy(rtsp_server_t *server);
 
 static void rtsp_server_inactivity_timer_proc(apt_timer_t *timer, void *obj);
+static apt_bool_t rtsp_server_connection_add(rtsp_server_poller_t *poller, rtsp_server_connection_t *rtsp_connection);
 
 /** Get string identifier */
 static const char* rtsp_server_id_get(const rtsp_server_t *server)
@@ -178,6 +209,14 @@ RTSP_DECLARE(rtsp_server_t*) rtsp_server_create(
 
 	server->inactivity_timeout = (apr_uint32_t)connection_timeout * 1000;
 	server->online = TRUE;
+	server->max_connection_count = max_connection_count;
+	server->connection_count = 0;
+	server->next_poller = 0;
+	server->poller_count = 1;
+	server->pollers = apr_palloc(pool,sizeof(rtsp_server_poller_t*));
+	server->pollers[0] = apr_palloc(pool,sizeof(rtsp_server_poller_t));
+	server->pollers[0]->server = server;
+	APR_RING_INIT(&server->pollers[0]->connection_list, rtsp_server_connection_t, link);
 
 	server->listen_sock = NULL;
 	server->sockaddr = NULL;
@@ -191,12 +230,13 @@ RTSP_DECLARE(rtsp_server_t*) rtsp_server_create(
 	server->task = apt_poller_task_create(
 						max_connection_count + 1,
 						rtsp_server_poller_signal_process,
-						server,
+						server->pollers[0],
 						msg_pool,
 						pool);
 	if(!server->task) {
 		return NULL;
 	}
+	server->pollers[0]->task = server->task;
 
 	task = apt_poller_task_base_get(server->task);
 	if(task) {
@@ -211,8 +251,6 @@ RTSP_DECLARE(rtsp_server_t*) rtsp_server_create(
 		vtable->process_msg = rtsp_server_task_msg_process;
 	}
 
-	APR_RING_INIT(&server->connection_list, rtsp_server_connection_t, link);
-
 	if(rtsp_server_listening_socket_create(server) != TRUE) {
 		apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Listening Socket [%s] %s:%hu", 
 				id,
@@ -225,7 +263,8 @@ RTSP_DECLARE(rtsp_server_t*) rtsp_server_create(
 static apt_bool_t rtsp_server_on_destroy(apt_task_t *task)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	rtsp_server_t *server = apt_poller_task_object_get(poller_task);
+	rtsp_server_poller_t *poller = apt_poller_task_object_get(poller_task);
+	rtsp_server_t *server = poller->server;
 
 	rtsp_server_listening_socket_destroy(server);
 	apt_poller_task_cleanup(poller_task);
@@ -240,6 +279,62 @@ RTSP_DECLARE(apt_bool_t) rtsp_server_destroy(rtsp_server_t *server)
 	return apt_poller_task_destroy(server->task);
 }
 
+/** Set the number of pollers (threads) connections are distributed across */
+RTSP_DECLARE(apt_bool_t) rtsp_server_pollers_set(rtsp_server_t *server, apr_size_t count)
+{
+	rtsp_server_poller_t **pollers;
+	rtsp_server_poller_t *poller;
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	apr_size_t i;
+	if(!server || !server->task || server->poller_count != 1) {
+		apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Failed to Set RTSP Pollers");
+		return FALSE;
+	}
+	if(count <= 1) {
+		return TRUE;
+	}
+	if(count > RTSP_SERVER_MAX_POLLER_COUNT) {
+		count = RTSP_SERVER_MAX_POLLER_COUNT;
+	}
+
+	apt_log(RTSP_LOG_MARK,APT_PRIO_INFO,"Set RTSP Pollers [%s] [%"APR_SIZE_T_FMT"]",
+			rtsp_server_id_get(server),
+			count);
+	pollers = apr_palloc(server->pool,sizeof(rtsp_server_poller_t*) * count);
+	pollers[0] = server->pollers[0];
+	for(i=1; i<count; i++) {
+		poller = apr_palloc(server->pool,sizeof(rtsp_server_poller_t));
+		pollers[i] = poller;
+		poller->server = server;
+		APR_RING_INIT(&poller->connection_list, rtsp_server_connection_t, link);
+		msg_pool = apt_task_msg_pool_create_dynamic(sizeof(task_msg_data_t),server->pool);
+		/* each poller is capable of holding all the connections, the count is limited by the server */
+		poller->task = apt_poller_task_create(
+							server->max_connection_count,
+							rtsp_server_poller_signal_process,
+							poller,
+							msg_pool,
+							server->pool);
+		if(!poller->task) {
+			apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Failed to Create RTSP Poller [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		task = apt_poller_task_base_get(poller->task);
+		apt_task_name_set(task,apr_psprintf(server->pool,"%s-%"APR_SIZE_T_FMT,rtsp_server_id_get(server),i));
+		vtable = apt_poller_task_vtable_get(poller->task);
+		if(vtable) {
+			vtable->process_msg = rtsp_server_task_msg_process;
+		}
+		/* pollers are started, taken offline and terminated along with the main task */
+		apt_task_add(apt_poller_task_base_get(server->task),task);
+	}
+	server->pollers = pollers;
+	server->poller_count = count;
+	return TRUE;
+}
+
 /** Start connection agent */
 RTSP_DECLARE(apt_bool_t) rtsp_server_start(rtsp_server_t *server)
 {
@@ -304,7 +399,8 @@ static apt_bool_t rtsp_server_control_message_signal(
 								rtsp_server_session_t *session,
 								rtsp_message_t *message)
 {
-	apt_task_t *task = apt_poller_task_base_get(server->task);
+	/* the session is processed by the poller of its connection */
+	apt_task_t *task = apt_poller_task_base_get(session->connection->poller->task);
 	apt_task_msg_t *task_msg = apt_task_msg_get(task);
 	if(task_msg) {
 		task_msg_data_t *data = (task_msg_data_t*)task_msg->data;
@@ -312,6 +408,7 @@ static apt_bool_t rtsp_server_control_message_signal(
 		data->server = server;
 		data->session = session;
 		data->message = message;
+		data->connection = session->connection;
 		apt_task_msg_signal(task,task_msg);
 	}
 	return TRUE;
@@ -335,6 +432,23 @@ RTSP_DECLARE(apt_bool_t) rtsp_server_session_release(rtsp_server_t *server, rtsp
 	return rtsp_server_control_message_signal(TASK_MSG_RELEASE_SESSION,server,session,NULL);
 }
 
+/** Stop accepting new connections */
+RTSP_DECLARE(apt_bool_t) rtsp_server_listen_stop(rtsp_server_t *server)
+{
+	apt_task_t *task = apt_poller_task_base_get(server->task);
+	apt_task_msg_t *task_msg = apt_task_msg_get(task);
+	if(task_msg) {
+		task_msg_data_t *data = (task_msg_data_t*)task_msg->data;
+		data->type = TASK_MSG_LISTEN_STOP;
+		data->server = server;
+		data->session = NULL;
+		data->message = NULL;
+		data->connection = NULL;
+		apt_task_msg_signal(task,task_msg);
+	}
+	return TRUE;
+}
+
 /* Create RTSP session */
 static rtsp_server_session_t* rtsp_server_session_create(rtsp_server_t *server)
 {
@@ -371,8 +485,10 @@ static void rtsp_server_session_destroy(rtsp_server_session_t *session)
 /** Destroy RTSP connection */
 static void rtsp_server_connection_destroy(rtsp_server_connection_t *rtsp_connection)
 {
+	rtsp_server_t *server = rtsp_connection->server;
 	apt_log(RTSP_LOG_MARK,APT_PRIO_NOTICE,"Destroy RTSP Connection %s",rtsp_connection->id);
 	apr_pool_destroy(rtsp_connection->pool);
+	apr_atomic_dec32(&server->connection_count);
 }
 
 /* Finally terminate RTSP session */
@@ -707,14 +823,10 @@ static apt_bool_t rtsp_server_message_handler(rtsp_server_connection_t *rtsp_con
 	return TRUE;
 }
 
-/** Create listening socket and add it to pollset */
-static apt_bool_t rtsp_server_listening_socket_create(rtsp_server_t *server)
+/** Create, bind and listen socket */
+static apt_bool_t rtsp_server_listening_socket_open(rtsp_server_t *server)
 {
 	apr_status_t status;
-	
-	if(!server->sockaddr) {
-		return FALSE;
-	}
 
 	/* create listening socket */
 	status = apr_socket_create(&server->listen_sock, server->sockaddr->family, SOCK_STREAM, APR_PROTO_TCP, server->pool);
@@ -738,6 +850,26 @@ static apt_bool_t rtsp_server_listening_socket_create(rtsp_server_t *server)
 		server->listen_sock = NULL;
 		return FALSE;
 	}
+	return TRUE;
+}
+
+/** Create listening socket and add it to pollset */
+static apt_bool_t rtsp_server_listening_socket_create(rtsp_server_t *server)
+{
+	apt_handoff_t *handoff = apt_handoff_instance_get();
+	if(!server->sockaddr) {
+		return FALSE;
+	}
+
+	/* take over the socket handed off by the predecessor, if any */
+	server->listen_sock = apt_handoff_socket_take(handoff,server->sockaddr,server->pool);
+	if(server->listen_sock) {
+		apt_log(RTSP_LOG_MARK,APT_PRIO_NOTICE,"Take Over RTSP Listening Socket");
+	}
+	else if(rtsp_server_listening_socket_open(server) == FALSE) {
+		return FALSE;
+	}
+	apt_handoff_socket_add(handoff,server->listen_sock);
 
 	/* add listening socket to pollset */
 	memset(&server->listen_sock_pfd,0,sizeof(apr_pollfd_t));
@@ -747,6 +879,7 @@ static apt_bool_t rtsp_server_listening_socket_create(rtsp_server_t *server)
 	server->listen_sock_pfd.client_data = server->listen_sock;
 	if(apt_poller_task_descriptor_add(server->task, &server->listen_sock_pfd) != TRUE) {
 		apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Failed to Add RTSP Listening Socket to Pollset");
+		apt_handoff_socket_remove(handoff,server->listen_sock);
 		apr_socket_close(server->listen_sock);
 		server->listen_sock = NULL;
 		return FALSE;
@@ -760,6 +893,7 @@ static void rtsp_server_listening_socket_destroy(rtsp_server_t *server)
 {
 	if(server->listen_sock) {
 		apt_poller_task_descriptor_remove(server->task,&server->listen_sock_pfd);
+		apt_handoff_socket_remove(apt_handoff_instance_get(),server->listen_sock);
 		apr_socket_close(server->listen_sock);
 		server->listen_sock = NULL;
 	}
@@ -804,13 +938,12 @@ static apt_bool_t rtsp_server_connection_accept(rtsp_server_t *server)
 		local_ip,l_sockaddr->port,
 		remote_ip,r_sockaddr->port);
 
-	memset(&rtsp_connection->sock_pfd,0,sizeof(apr_pollfd_t));
-	rtsp_connection->sock_pfd.desc_type = APR_POLL_SOCKET;
-	rtsp_connection->sock_pfd.reqevents = APR_POLLIN;
-	rtsp_connection->sock_pfd.desc.s = rtsp_connection->sock;
-	rtsp_connection->sock_pfd.client_data = rtsp_connection;
-	if(apt_poller_task_descriptor_add(server->task,&rtsp_connection->sock_pfd) != TRUE) {
-		apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Failed to Add to Pollset %s",rtsp_connection->id);
+	/* connections of all the pollers are limited by the server */
+	if(apr_atomic_inc32(&server->connection_count) >= server->max_connection_count) {
+		apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Reject RTSP Connection %s: Max Count Reached [%"APR_SIZE_T_FMT"]",
+			rtsp_connection->id,
+			server->max_connection_count);
+		apr_atomic_dec32(&server->connection_count);
 		apr_socket_close(rtsp_connection->sock);
 		apr_pool_destroy(pool);
 		return FALSE;
@@ -823,17 +956,60 @@ static apt_bool_t rtsp_server_connection_accept(rtsp_server_t *server)
 	rtsp_connection->parser = rtsp_parser_create(rtsp_connection->pool);
 	rtsp_connection->generator = rtsp_generator_create(rtsp_connection->pool);
 	rtsp_connection->server = server;
-
 	rtsp_connection->inactivity_timer = NULL;
+
+	/* distribute connections across the pollers in round-robin order */
+	rtsp_connection->poller = server->pollers[server->next_poller];
+	server->next_poller = (server->next_poller + 1) % server->poller_count;
+	if(rtsp_connection->poller->task != server->task) {
+		/* hand the connection over to be added to the pollset in the thread of the poller */
+		apt_task_t *task = apt_poller_task_base_get(rtsp_connection->poller->task);
+		apt_task_msg_t *task_msg = apt_task_msg_get(task);
+		task_msg_data_t *data;
+		if(!task_msg) {
+			apr_socket_close(rtsp_connection->sock);
+			rtsp_connection->sock = NULL;
+			rtsp_server_connection_destroy(rtsp_connection);
+			return FALSE;
+		}
+		data = (task_msg_data_t*)task_msg->data;
+		data->type = TASK_MSG_ADD_CONNECTION;
+		data->server = server;
+		data->session = NULL;
+		data->message = NULL;
+		data->connection = rtsp_connection;
+		return apt_task_msg_signal(task,task_msg);
+	}
+	return rtsp_server_connection_add(rtsp_connection->poller,rtsp_connection);
+}
+
+/* Add RTSP connection to the pollset of the poller (processed in the thread of the poller) */
+static apt_bool_t rtsp_server_connection_add(rtsp_server_poller_t *poller, rtsp_server_connection_t *rtsp_connection)
+{
+	rtsp_server_t *server = poller->server;
+
+	memset(&rtsp_connection->sock_pfd,0,sizeof(apr_pollfd_t));
+	rtsp_connection->sock_pfd.desc_type = APR_POLL_SOCKET;
+	rtsp_connection->sock_pfd.reqevents = APR_POLLIN;
+	rtsp_connection->sock_pfd.desc.s = rtsp_connection->sock;
+	rtsp_connection->sock_pfd.client_data = rtsp_connection;
+	if(apt_poller_task_descriptor_add(poller->task,&rtsp_connection->sock_pfd) != TRUE) {
+		apt_log(RTSP_LOG_MARK,APT_PRIO_WARNING,"Failed to Add to Pollset %s",rtsp_connection->id);
+		apr_socket_close(rtsp_connection->sock);
+		rtsp_connection->sock = NULL;
+		rtsp_server_connection_destroy(rtsp_connection);
+		return FALSE;
+	}
+
 	if(server->inactivity_timeout) {
 		rtsp_connection->inactivity_timer = apt_poller_task_timer_create(
-												server->task,
+												poller->task,
 												rtsp_server_inactivity_timer_proc,
 												rtsp_connection,
 												rtsp_connection->pool);
 	}
 
-	APR_RING_INSERT_TAIL(&server->connection_list,rtsp_connection,rtsp_server_connection_t,link);
+	APR_RING_INSERT_TAIL(&poller->connection_list,rtsp_connection,rtsp_server_connection_t,link);
 	if(rtsp_connection->inactivity_timer) {
 		apt_timer_set(rtsp_connection->inactivity_timer,server->inactivity_timeout);
 	}
@@ -848,7 +1024,7 @@ static apt_bool_t rtsp_server_connection_close(rtsp_server_t *server, rtsp_serve
 		return FALSE;
 	}
 	apt_log(RTSP_LOG_MARK,APT_PRIO_INFO,"Close RTSP Connection %s",rtsp_connection->id);
-	apt_poller_task_descriptor_remove(server->task,&rtsp_connection->sock_pfd);
+	apt_poller_task_descriptor_remove(rtsp_connection->poller->task,&rtsp_connection->sock_pfd);
 	apr_socket_close(rtsp_connection->sock);
 	rtsp_connection->sock = NULL;
 
@@ -895,7 +1071,8 @@ static void rtsp_server_inactivity_timer_proc(apt_timer_t *timer, void *obj)
 /* Receive RTSP message through RTSP connection */
 static apt_bool_t rtsp_server_poller_signal_process(void *obj, const apr_pollfd_t *descriptor)
 {
-	rtsp_server_t *server = obj;
+	rtsp_server_poller_t *poller = obj;
+	rtsp_server_t *server = poller->server;
 	rtsp_server_connection_t *rtsp_connection = descriptor->client_data;
 	apr_status_t status;
 	apr_size_t offset;
@@ -949,24 +1126,25 @@ static apt_bool_t rtsp_server_poller_signal_process(void *obj, const apr_pollfd_
 static void rtsp_server_on_offline(apt_task_t *task)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	rtsp_server_t *server = apt_poller_task_object_get(poller_task);
+	rtsp_server_poller_t *poller = apt_poller_task_object_get(poller_task);
 
-	server->online = FALSE;
+	poller->server->online = FALSE;
 }
 
 static void rtsp_server_on_online(apt_task_t *task)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	rtsp_server_t *server = apt_poller_task_object_get(poller_task);
+	rtsp_server_poller_t *poller = apt_poller_task_object_get(poller_task);
 
-	server->online = TRUE;
+	poller->server->online = TRUE;
 }
 
 /* Process task message */
 static apt_bool_t rtsp_server_task_msg_process(apt_task_t *task, apt_task_msg_t *task_msg)
 {
 	apt_poller_task_t *poller_task = apt_task_object_get(task);
-	rtsp_server_t *server = apt_poller_task_object_get(poller_task);
+	rtsp_server_poller_t *poller = apt_poller_task_object_get(poller_task);
+	rtsp_server_t *server = poller->server;
 
 	task_msg_data_t *data = (task_msg_data_t*) task_msg->data;
 	switch(data->type) {
@@ -979,6 +1157,13 @@ static apt_bool_t rtsp_server_task_msg_process(apt_task_t *task, apt_task_msg_t
 		case TASK_MSG_RELEASE_SESSION:
 			rtsp_server_session_do_release(server,data->session);
 			break;
+		case TASK_MSG_ADD_CONNECTION:
+			rtsp_server_connection_add(poller,data->connection);
+			break;
+		case TASK_MSG_LISTEN_STOP:
+			apt_log(RTSP_LOG_MARK,APT_PRIO_NOTICE,"Stop Listening [%s]",apt_task_name_get(task));
+			rtsp_server_listening_socket_destroy(server);
+			break;
 	}
 
 	return TRUE;
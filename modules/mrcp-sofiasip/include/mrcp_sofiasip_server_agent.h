@@ -76,6 +76,8 @@ struct mrcp_sofia_server_config_t {
 	apt_bool_t tport_log;
 	/** Dump SIP messages to the specified file */
 	char      *tport_dump_file;
+	/** Number of Sofia-SIP event loops (threads) sharing the local port */
+	apr_size_t thread_count;
 };
 
 /**
@@ -28,6 +28,9 @@ typedef struct mrcp_sofia_session_t mrcp_sofia_session_t;
 #undef strcasecmp
 #undef strncasecmp
 #include <apr_general.h>
+#include <apr_atomic.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
 
 #include "mrcp_sofiasip_server_agent.h"
 #include "mrcp_sofiasip_logger.h"
@@ -38,14 +41,36 @@ typedef struct mrcp_sofia_session_t mrcp_sofia_session_t;
 #include "apt_text_stream.h"
 #include "apt_log.h"
 
+/** Max size of the SDP answered to resource discovery (OPTIONS) */
+#define MRCP_SOFIA_DISCOVERY_SDP_SIZE 2048
+
+typedef struct mrcp_sofia_discovery_t mrcp_sofia_discovery_t;
+
+/* the resource discovery answer of a task, only accessed by the SIP thread of the task */
+struct mrcp_sofia_discovery_t {
+	/* the version of the capabilities the SDP is generated for, 0 if never generated */
+	apr_uint32_t                version;
+	apr_size_t                  length;
+	char                        sdp_str[MRCP_SOFIA_DISCOVERY_SDP_SIZE];
+};
+
 struct mrcp_sofia_agent_t {
 	mrcp_sig_agent_t           *sig_agent;
 	mrcp_sofia_server_config_t *config;
 	char                       *sip_contact_str;
 	char                       *sip_bind_str;
 
+	/* the primary task, the parent of the others */
 	mrcp_sofia_task_t          *task;
+	/* all the tasks, each running its own event loop and nua instance */
+	mrcp_sofia_task_t         **tasks;
+	apr_size_t                  task_count;
 	apt_bool_t                  online;
+
+	/* the version of the engines and profiles, bumped by the server as they change */
+	volatile apr_uint32_t       capabilities_version;
+	/* the cached resource discovery answers, one per task */
+	mrcp_sofia_discovery_t     *discoveries;
 };
 
 struct mrcp_sofia_session_t {
@@ -54,6 +79,13 @@ struct mrcp_sofia_session_t {
 	nua_handle_t               *nh;
 
 	mrcp_session_attribs_t      attribs;
+
+	/* the last remote SDP offered, its hash and length */
+	const char                 *remote_sdp_str;
+	unsigned int                remote_sdp_hash;
+	apr_ssize_t                 remote_sdp_len;
+	/* the local SDP answered to the last remote SDP, NULL while the answer is pending or if it failed */
+	const char                 *local_sdp_str;
 };
 
 /* Task Interface */
@@ -79,6 +111,7 @@ static const mrcp_session_event_vtable_t session_event_vtable = {
 
 static apt_bool_t mrcp_sofia_config_validate(mrcp_sofia_agent_t *sofia_agent, mrcp_sofia_server_config_t *config, apr_pool_t *pool);
 static nua_t* mrcp_sofia_nua_create(void *obj, su_root_t *root);
+static void mrcp_sofia_capabilities_invalidate(mrcp_sig_agent_t *signaling_agent);
 
 static void mrcp_sofia_event_callback(
 					nua_event_t           nua_event,
@@ -97,6 +130,7 @@ MRCP_DECLARE(mrcp_sig_agent_t*) mrcp_sofiasip_server_agent_create(const char *id
 	apt_task_t *base;
 	apt_task_vtable_t *vtable;
 	mrcp_sofia_agent_t *sofia_agent;
+	apr_size_t i;
 	
 	sofia_agent = apr_palloc(pool,sizeof(mrcp_sofia_agent_t));
 	sofia_agent->sig_agent = mrcp_signaling_agent_create(id,sofia_agent,pool);
@@ -106,13 +140,22 @@ MRCP_DECLARE(mrcp_sig_agent_t*) mrcp_sofiasip_server_agent_create(const char *id
 		return NULL;
 	}
 
-	apt_log(SIP_LOG_MARK,APT_PRIO_NOTICE,"Create SofiaSIP Agent [%s] ["SOFIA_SIP_VERSION"] %s",
-				id,sofia_agent->sip_bind_str);
-	sofia_agent->task = mrcp_sofia_task_create(mrcp_sofia_nua_create,sofia_agent,NULL,pool);
-	if(!sofia_agent->task) {
-		return NULL;
+	apt_log(SIP_LOG_MARK,APT_PRIO_NOTICE,"Create SofiaSIP Agent [%s] ["SOFIA_SIP_VERSION"] %s threads [%"APR_SIZE_T_FMT"]",
+				id,sofia_agent->sip_bind_str,config->thread_count);
+	sofia_agent->task_count = config->thread_count;
+	sofia_agent->tasks = apr_palloc(pool,sizeof(mrcp_sofia_task_t*) * sofia_agent->task_count);
+	for(i=0; i<sofia_agent->task_count; i++) {
+		sofia_agent->tasks[i] = mrcp_sofia_task_create(mrcp_sofia_nua_create,sofia_agent,NULL,pool);
+		if(!sofia_agent->tasks[i]) {
+			return NULL;
+		}
 	}
+	sofia_agent->task = sofia_agent->tasks[0];
 	sofia_agent->online = TRUE;
+	/* the answers are generated on the first OPTIONS a task receives */
+	sofia_agent->capabilities_version = 1;
+	sofia_agent->discoveries = apr_pcalloc(pool,sizeof(mrcp_sofia_discovery_t) * sofia_agent->task_count);
+	sofia_agent->sig_agent->capabilities_invalidate = mrcp_sofia_capabilities_invalidate;
 	base = mrcp_sofia_task_base_get(sofia_agent->task);
 	apt_task_name_set(base,id);
 	vtable = apt_task_vtable_get(base);
@@ -120,6 +163,12 @@ MRCP_DECLARE(mrcp_sig_agent_t*) mrcp_sofiasip_server_agent_create(const char *id
 		vtable->on_offline_complete = mrcp_sofia_task_on_offline;
 		vtable->on_online_complete = mrcp_sofia_task_on_online;
 	}
+	for(i=1; i<sofia_agent->task_count; i++) {
+		/* the other tasks are started, terminated and taken offline along with the primary one */
+		apt_task_t *child = mrcp_sofia_task_base_get(sofia_agent->tasks[i]);
+		apt_task_name_set(child,apr_psprintf(pool,"%s-%"APR_SIZE_T_FMT,id,i));
+		apt_task_add(base,child);
+	}
 	sofia_agent->sig_agent->task = base;
 	return sofia_agent->sig_agent;
 }
@@ -149,6 +198,7 @@ MRCP_DECLARE(mrcp_sofia_server_config_t*) mrcp_sofiasip_server_config_alloc(apr_
 
 	config->tport_log = FALSE;
 	config->tport_dump_file = NULL;
+	config->thread_count = 1;
 
 	return config;
 }
@@ -156,6 +206,9 @@ MRCP_DECLARE(mrcp_sofia_server_config_t*) mrcp_sofiasip_server_config_alloc(apr_
 static apt_bool_t mrcp_sofia_config_validate(mrcp_sofia_agent_t *sofia_agent, mrcp_sofia_server_config_t *config, apr_pool_t *pool)
 {
 	sofia_agent->config = config;
+	if(!config->thread_count) {
+		config->thread_count = 1;
+	}
 	sofia_agent->sip_contact_str = NULL; /* Let Sofia-SIP implicitly set Contact header by default */
 	if(config->ext_ip) {
 		/* Use external IP address in Contact header, if behind NAT */
@@ -217,9 +270,63 @@ static nua_t* mrcp_sofia_nua_create(void *obj, su_root_t *root)
 		TAG_IF(sofia_config->tport_dump_file,TPTAG_DUMP(sofia_config->tport_dump_file)), /* Dump SIP messages to the file */
 		TAG_END());                /* Last tag should always finish the sequence */
 
+	if(!nua && sofia_agent->task_count > 1) {
+		/* the port is shared by the tasks, which is only possible if the transports reuse it */
+		apt_log(SIP_LOG_MARK,APT_PRIO_WARNING,"Failed to Bind %s [%s], Several Threads require SO_REUSEPORT",
+			sofia_agent->sip_bind_str,
+			sofia_agent->sig_agent->id);
+	}
 	return nua;
 }
 
+/** Get the task running a nua instance */
+static apr_size_t mrcp_sofia_task_index_find(mrcp_sofia_agent_t *sofia_agent, nua_t *nua)
+{
+	apr_size_t i;
+	for(i=0; i<sofia_agent->task_count; i++) {
+		if(mrcp_sofia_task_nua_get(sofia_agent->tasks[i]) == nua) {
+			return i;
+		}
+	}
+	return 0;
+}
+
+static mrcp_sofia_task_t* mrcp_sofia_task_find(mrcp_sofia_agent_t *sofia_agent, nua_t *nua)
+{
+	return sofia_agent->tasks[mrcp_sofia_task_index_find(sofia_agent,nua)];
+}
+
+static void mrcp_sofia_capabilities_invalidate(mrcp_sig_agent_t *signaling_agent)
+{
+	mrcp_sofia_agent_t *sofia_agent = signaling_agent->obj;
+	/* each task regenerates its answer on the next OPTIONS it receives */
+	apr_atomic_inc32(&sofia_agent->capabilities_version);
+}
+
+/** Get the resource discovery SDP of the task, generated once per version of the capabilities */
+static const char* mrcp_sofia_discovery_sdp_get(mrcp_sofia_agent_t *sofia_agent, nua_t *nua)
+{
+	mrcp_sofia_discovery_t *discovery = &sofia_agent->discoveries[mrcp_sofia_task_index_find(sofia_agent,nua)];
+	apr_uint32_t version = apr_atomic_read32(&sofia_agent->capabilities_version);
+	if(discovery->version != version) {
+		const char *ip = sofia_agent->config->ext_ip ?
+			sofia_agent->config->ext_ip : sofia_agent->config->local_ip;
+		discovery->length = sdp_resource_discovery_string_generate(
+								ip,
+								sofia_agent->config->origin,
+								discovery->sdp_str,
+								sizeof(discovery->sdp_str));
+		discovery->version = version;
+		if(discovery->length > 0) {
+			apt_log(SIP_LOG_MARK,APT_PRIO_INFO,"Generate Resource Discovery SDP [%s] version %u\n[%s]\n",
+				sofia_agent->sig_agent->id,
+				version,
+				discovery->sdp_str);
+		}
+	}
+	return discovery->length > 0 ? discovery->sdp_str : NULL;
+}
+
 static mrcp_sofia_session_t* mrcp_sofia_session_create(mrcp_sofia_agent_t *sofia_agent, nua_handle_t *nh)
 {
 	mrcp_sofia_session_t *sofia_session;
@@ -239,6 +346,11 @@ static mrcp_sofia_session_t* mrcp_sofia_session_create(mrcp_sofia_agent_t *sofia
 	sofia_session->nh = nh;
 
 	mrcp_session_attribs_init(&sofia_session->attribs);
+
+	sofia_session->remote_sdp_str = NULL;
+	sofia_session->remote_sdp_hash = 0;
+	sofia_session->remote_sdp_len = 0;
+	sofia_session->local_sdp_str = NULL;
 	return sofia_session;
 }
 
@@ -253,12 +365,29 @@ static int sip_status_get(mrcp_session_status_e status)
 			return 406;
 		case MRCP_SESSION_STATUS_UNAVAILABLE_RESOURCE:
 			return 480;
+		case MRCP_SESSION_STATUS_OVERLOADED:
+			return 503;
 		case MRCP_SESSION_STATUS_ERROR:
 			return 500;
 	}
 	return 200;
 }
 
+static void mrcp_sofia_answer_send(mrcp_sofia_agent_t *sofia_agent, mrcp_sofia_session_t *sofia_session, const char *local_sdp_str)
+{
+	nua_respond(sofia_session->nh, SIP_200_OK,
+				TAG_IF(sofia_agent->sip_contact_str,SIPTAG_CONTACT_STR(sofia_agent->sip_contact_str)),
+				TAG_IF(sofia_agent->config->disable_soa && local_sdp_str,SIPTAG_CONTENT_TYPE_STR("application/sdp")),
+				TAG_IF(sofia_agent->config->disable_soa && local_sdp_str,SIPTAG_PAYLOAD_STR(local_sdp_str)),
+				TAG_IF(!sofia_agent->config->disable_soa && local_sdp_str,SOATAG_USER_SDP_STR(local_sdp_str)),
+				SOATAG_AUDIO_AUX("telephone-event"),
+				NUTAG_AUTOANSWER(0),
+				TAG_IF(sofia_agent->config->disable_soa,NUTAG_MEDIA_ENABLE(0)),
+				NUTAG_SESSION_TIMER(sofia_agent->config->session_expires),
+				NUTAG_MIN_SE(sofia_agent->config->min_session_expires),
+				TAG_END());
+}
+
 static apt_bool_t mrcp_sofia_on_session_answer(mrcp_session_t *session, mrcp_session_descriptor_t *descriptor)
 {
 	mrcp_sofia_session_t *sofia_session = session->obj;
@@ -272,8 +401,13 @@ static apt_bool_t mrcp_sofia_on_session_answer(mrcp_session_t *session, mrcp_ses
 
 	if(descriptor->status != MRCP_SESSION_STATUS_OK) {
 		int status = sip_status_get(descriptor->status);
+		const char *retry_after_str = NULL;
+		if(descriptor->retry_after) {
+			retry_after_str = apr_psprintf(session->pool,"%"APR_SIZE_T_FMT,descriptor->retry_after);
+		}
 		nua_respond(sofia_session->nh, status, sip_status_phrase(status),
 					TAG_IF(sofia_agent->sip_contact_str,SIPTAG_CONTACT_STR(sofia_agent->sip_contact_str)),
+					TAG_IF(retry_after_str,SIPTAG_RETRY_AFTER_STR(retry_after_str)),
 					TAG_END());
 		return TRUE;
 	}
@@ -288,20 +422,13 @@ static apt_bool_t mrcp_sofia_on_session_answer(mrcp_session_t *session, mrcp_ses
 			session->name,
 			MRCP_SESSION_SID(session), 
 			local_sdp_str);
-	}
 
-	nua_respond(sofia_session->nh, SIP_200_OK,
-				TAG_IF(sofia_agent->sip_contact_str,SIPTAG_CONTACT_STR(sofia_agent->sip_contact_str)),
-				TAG_IF(sofia_agent->config->disable_soa && local_sdp_str,SIPTAG_CONTENT_TYPE_STR("application/sdp")),
-				TAG_IF(sofia_agent->config->disable_soa && local_sdp_str,SIPTAG_PAYLOAD_STR(local_sdp_str)),
-				TAG_IF(!sofia_agent->config->disable_soa && local_sdp_str,SOATAG_USER_SDP_STR(local_sdp_str)),
-				SOATAG_AUDIO_AUX("telephone-event"),
-				NUTAG_AUTOANSWER(0),
-				TAG_IF(sofia_agent->config->disable_soa,NUTAG_MEDIA_ENABLE(0)),
-				NUTAG_SESSION_TIMER(sofia_agent->config->session_expires),
-				NUTAG_MIN_SE(sofia_agent->config->min_session_expires),
-				TAG_END());
+		/* keep the answer to reuse on an identical offer (session refresh), which can only
+		arrive after this response is passed to the stack */
+		sofia_session->local_sdp_str = apr_pstrdup(session->pool,local_sdp_str);
+	}
 
+	mrcp_sofia_answer_send(sofia_agent,sofia_session,local_sdp_str);
 	return TRUE;
 }
 
@@ -355,6 +482,33 @@ static void mrcp_sofia_on_call_receive(
 		return;
 	}
 
+	if(!sofia_session && sofia_agent->sig_agent->offer_check) {
+		char redirect_uri[256];
+		apr_size_t retry_after = 0;
+		switch(sofia_agent->sig_agent->offer_check(sofia_agent->sig_agent,redirect_uri,sizeof(redirect_uri),&retry_after)) {
+			case MRCP_SIG_OFFER_REDIRECT:
+				apt_log(SIP_LOG_MARK,APT_PRIO_NOTICE,"Redirect SIP Session to [%s]",redirect_uri);
+				nua_respond(nh, SIP_302_MOVED_TEMPORARILY,
+							SIPTAG_CONTACT_STR(redirect_uri),
+							TAG_END());
+				return;
+			case MRCP_SIG_OFFER_REJECT:
+			{
+				char retry_after_str[16];
+				apt_log(SIP_LOG_MARK,APT_PRIO_WARNING,"Cannot Establish SIP Session: Overloaded");
+				if(retry_after) {
+					apr_snprintf(retry_after_str,sizeof(retry_after_str),"%"APR_SIZE_T_FMT,retry_after);
+				}
+				nua_respond(nh, SIP_503_SERVICE_UNAVAILABLE,
+							TAG_IF(retry_after,SIPTAG_RETRY_AFTER_STR(retry_after_str)),
+							TAG_END());
+				return;
+			}
+			default:
+				break;
+		}
+	}
+
 	if(!sofia_session) {
 		sofia_session = mrcp_sofia_session_create(sofia_agent,nh);
 		if(!sofia_session) {
@@ -363,12 +517,33 @@ static void mrcp_sofia_on_call_receive(
 		}
 	}
 
-	descriptor = mrcp_session_descriptor_create(sofia_session->session->pool);
-
 	tl_gets(tags,
 			SOATAG_REMOTE_SDP_STR_REF(remote_sdp_str),
 			TAG_END());
 
+	if(remote_sdp_str) {
+		apr_ssize_t remote_sdp_len = APR_HASH_KEY_STRING;
+		unsigned int remote_sdp_hash = apr_hashfunc_default(remote_sdp_str,&remote_sdp_len);
+		if(sofia_session->local_sdp_str &&
+			remote_sdp_hash == sofia_session->remote_sdp_hash &&
+			remote_sdp_len == sofia_session->remote_sdp_len &&
+			memcmp(remote_sdp_str,sofia_session->remote_sdp_str,remote_sdp_len) == 0) {
+			/* the offer is identical to the previous one (session refresh) => reuse the answer */
+			apt_log(SIP_LOG_MARK,APT_PRIO_INFO,"Reuse Answer to Identical Offer " APT_NAMESID_FMT,
+				sofia_session->session->name,
+				MRCP_SESSION_SID(sofia_session->session));
+			mrcp_sofia_answer_send(sofia_agent,sofia_session,sofia_session->local_sdp_str);
+			return;
+		}
+
+		sofia_session->remote_sdp_str = apr_pstrmemdup(sofia_session->session->pool,remote_sdp_str,remote_sdp_len);
+		sofia_session->remote_sdp_hash = remote_sdp_hash;
+		sofia_session->remote_sdp_len = remote_sdp_len;
+	}
+	/* the answer is pending */
+	sofia_session->local_sdp_str = NULL;
+
+	descriptor = mrcp_session_descriptor_create(sofia_session->session->pool);
 	if(remote_sdp_str) {
 		sdp_parser_t *parser = NULL;
 		sdp_session_t *sdp = NULL;
@@ -545,17 +720,13 @@ static void mrcp_sofia_on_state_change(
 
 static void mrcp_sofia_on_resource_discover(
 							mrcp_sofia_agent_t   *sofia_agent,
+							nua_t                *nua,
 							nua_handle_t         *nh,
 							mrcp_sofia_session_t *sofia_session,
 							sip_t const          *sip,
 							tagi_t                tags[])
 {
-	char sdp_str[2048];
-	const char *local_sdp_str = NULL;
-
-	const char *ip = sofia_agent->config->ext_ip ? 
-		sofia_agent->config->ext_ip : sofia_agent->config->local_ip;
-	nua_t *nua = mrcp_sofia_task_nua_get(sofia_agent->task);
+	const char *local_sdp_str;
 
 	if(sofia_agent->online == FALSE) {
 		apt_log(SIP_LOG_MARK, APT_PRIO_WARNING, "Cannot do Resource Discovery in Offline Mode");
@@ -563,11 +734,8 @@ static void mrcp_sofia_on_resource_discover(
 		return;
 	}
 
-	if(sdp_resource_discovery_string_generate(ip,sofia_agent->config->origin,sdp_str,sizeof(sdp_str)) > 0) {
-		local_sdp_str = sdp_str;
-		apt_log(SIP_LOG_MARK,APT_PRIO_INFO,"Resource Discovery SDP\n[%s]\n", 
-				local_sdp_str);
-	}
+	/* answered right on the SIP thread, health checks cost neither the server task nor a new SDP */
+	local_sdp_str = mrcp_sofia_discovery_sdp_get(sofia_agent,nua);
 
 	nua_respond(nh, SIP_200_OK, 
 				NUTAG_WITH_CURRENT(nua),
@@ -608,13 +776,13 @@ static void mrcp_sofia_event_callback(
 			mrcp_sofia_on_state_change(sofia_agent,nh,sofia_session,sip,tags);
 			break;
 		case nua_i_options:
-			mrcp_sofia_on_resource_discover(sofia_agent,nh,sofia_session,sip,tags);
+			mrcp_sofia_on_resource_discover(sofia_agent,nua,nh,sofia_session,sip,tags);
 			break;
 		case nua_r_shutdown:
 			/* if status < 200, shutdown still in progress */
 			if(status >= 200) {
-				/* break main loop of sofia thread */
-				mrcp_sofia_task_break(sofia_agent->task);
+				/* break main loop of the sofia thread running this nua */
+				mrcp_sofia_task_break(mrcp_sofia_task_find(sofia_agent,nua));
 			}
 			break;
 		default:
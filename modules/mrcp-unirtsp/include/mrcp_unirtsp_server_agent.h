@@ -47,6 +47,8 @@ struct rtsp_server_config_t {
 
 	/** Number of max RTSP connections */
 	apr_size_t   max_connection_count;
+	/** Number of threads RTSP connections are distributed across */
+	apr_size_t   thread_count;
 
 	/** Inactivity timeout for an RTSP connection [sec] */
 	apr_size_t   inactivity_timeout;
@@ -62,6 +62,7 @@ static const mrcp_session_event_vtable_t session_event_vtable = {
 	mrcp_unirtsp_on_session_terminate_event
 };
 
+static apt_bool_t mrcp_unirtsp_listen_stop(mrcp_sig_agent_t *sig_agent);
 static apt_bool_t mrcp_unirtsp_session_create(rtsp_server_t *server, rtsp_server_session_t *session);
 static apt_bool_t mrcp_unirtsp_session_terminate(rtsp_server_t *server, rtsp_server_session_t *session);
 static apt_bool_t mrcp_unirtsp_message_handle(rtsp_server_t *server, rtsp_server_session_t *session, rtsp_message_t *message);
@@ -101,8 +102,13 @@ MRCP_DECLARE(mrcp_sig_agent_t*) mrcp_unirtsp_server_agent_create(const char *id,
 		return NULL;
 	}
 
+	if(rtsp_server_pollers_set(agent->rtsp_server,config->thread_count) == FALSE) {
+		return NULL;
+	}
+
 	task = rtsp_server_task_get(agent->rtsp_server);
 	agent->sig_agent->task = task;
+	agent->sig_agent->listen_stop = mrcp_unirtsp_listen_stop;
 
 	return agent->sig_agent;
 }
@@ -117,6 +123,7 @@ MRCP_DECLARE(rtsp_server_config_t*) mrcp_unirtsp_server_config_alloc(apr_pool_t
 	config->resource_location = NULL;
 	config->resource_map = apr_table_make(pool,2);
 	config->max_connection_count = 100;
+	config->thread_count = 1;
 	config->inactivity_timeout = 600; /* sec */
 	config->force_destination = FALSE;
 	return config;
@@ -132,6 +139,12 @@ static apt_bool_t rtsp_config_validate(mrcp_unirtsp_agent_t *agent, rtsp_server_
 	return TRUE;
 }
 
+static apt_bool_t mrcp_unirtsp_listen_stop(mrcp_sig_agent_t *sig_agent)
+{
+	mrcp_unirtsp_agent_t *agent = sig_agent->obj;
+	return rtsp_server_listen_stop(agent->rtsp_server);
+}
+
 static APR_INLINE mrcp_unirtsp_agent_t* server_agent_get(apt_task_t *task)
 {
 	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
@@ -0,0 +1,713 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Recognition accuracy and speed benchmark.
+ *
+ * The utterances listed in a manifest are recognized over a number of
+ * parallel channels, each utterance in a session of its own. The word error
+ * rate, the real-time factor and the time from the end of input to the final
+ * result are reported per utterance and summarized as JSON lines. Given the
+ * pid of the server, the resident memory of the server is sampled as well,
+ * to estimate the memory taken per channel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <apr_getopt.h>
+#include <apr_file_info.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_strings.h>
+#include "asr_engine.h"
+#include "apt_histogram.h"
+
+#define DEFAULT_GRAMMAR_FILE "grammar.xml"
+#define DEFAULT_PROFILE "uni2"
+#define DEFAULT_SAMPLE_RATE 8000
+
+/** Interval (msec) the memory of the server is sampled at */
+#define MEMORY_SAMPLE_INTERVAL 100
+
+typedef struct {
+	const char        *root_dir_path;
+	apt_log_priority_e log_priority;
+	apt_log_output_e   log_output;
+	const char        *manifest_file;
+	const char        *output_file;
+	const char        *grammar_file;
+	const char        *profile;
+	apr_size_t         channel_count;
+	apr_size_t         sample_rate;
+	long               server_pid;
+	apr_pool_t        *pool;
+} bench_options_t;
+
+/** Utterance of the manifest and the outcome of its recognition */
+typedef struct {
+	const char        *audio_file;
+	const char        *reference;
+
+	apt_bool_t         recognized;
+	const char        *hypothesis;
+	apr_size_t         channel_id;
+	apr_uint32_t       duration;
+	apr_uint32_t       process_time;
+	apr_uint32_t       time_to_final;
+	apr_size_t         reference_words;
+	apr_size_t         errors;
+} bench_utterance_t;
+
+typedef struct bench_t bench_t;
+
+typedef struct {
+	bench_t           *bench;
+	apr_size_t         id;
+	apr_thread_t      *thread;
+	/** Pool the results of the channel are allocated from */
+	apr_pool_t        *pool;
+} bench_channel_t;
+
+struct bench_t {
+	bench_options_t   *options;
+	asr_engine_t      *engine;
+	apr_array_header_t *utterances;
+
+	apr_thread_mutex_t *mutex;
+	apr_size_t         next_utterance;
+	apr_size_t         active_channels;
+
+	apr_pool_t        *pool;
+};
+
+/** Split text into lower-case words, punctuation other than apostrophes is dropped */
+static apr_array_header_t* words_split(const char *text, apr_pool_t *pool)
+{
+	apr_array_header_t *words = apr_array_make(pool,16,sizeof(char*));
+	char *buf;
+	char *word;
+	char *last;
+	char *p;
+
+	if(!text) {
+		return words;
+	}
+
+	buf = apr_pstrdup(pool,text);
+	for(p = buf; *p != '\0'; p++) {
+		if(isalnum((unsigned char)*p) || *p == '\'' || (unsigned char)*p >= 0x80) {
+			*p = (char) tolower((unsigned char)*p);
+		}
+		else {
+			*p = ' ';
+		}
+	}
+
+	for(word = apr_strtok(buf," ",&last); word; word = apr_strtok(NULL," ",&last)) {
+		APR_ARRAY_PUSH(words,char*) = word;
+	}
+	return words;
+}
+
+/** Count the word substitutions, deletions and insertions turning the reference into the hypothesis */
+static apr_size_t word_errors_count(const apr_array_header_t *reference, const apr_array_header_t *hypothesis, apr_pool_t *pool)
+{
+	apr_size_t *prev = apr_palloc(pool,sizeof(apr_size_t) * (hypothesis->nelts + 1));
+	apr_size_t *cur = apr_palloc(pool,sizeof(apr_size_t) * (hypothesis->nelts + 1));
+	apr_size_t *tmp;
+	int i, j;
+
+	for(j = 0; j <= hypothesis->nelts; j++) {
+		prev[j] = j;
+	}
+
+	for(i = 1; i <= reference->nelts; i++) {
+		const char *ref_word = APR_ARRAY_IDX(reference,i-1,const char*);
+		cur[0] = i;
+		for(j = 1; j <= hypothesis->nelts; j++) {
+			const char *hyp_word = APR_ARRAY_IDX(hypothesis,j-1,const char*);
+			apr_size_t cost = prev[j-1] + (strcmp(ref_word,hyp_word) == 0 ? 0 : 1);
+			if(prev[j] + 1 < cost)
+				cost = prev[j] + 1;
+			if(cur[j-1] + 1 < cost)
+				cost = cur[j-1] + 1;
+			cur[j] = cost;
+		}
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+	}
+	return prev[hypothesis->nelts];
+}
+
+/** Get the duration (msec) of an audio file, either WAV or headerless 16-bit PCM */
+static apr_uint32_t audio_duration_get(const char *file_path, apr_size_t sample_rate)
+{
+	unsigned char buf[16];
+	apr_uint32_t byte_rate = (apr_uint32_t) sample_rate * 2;
+	apr_uint32_t data_size = 0;
+	long file_size;
+	FILE *file = fopen(file_path,"rb");
+	if(!file) {
+		return 0;
+	}
+
+	if(fread(buf,1,12,file) == 12 && memcmp(buf,"RIFF",4) == 0 && memcmp(buf+8,"WAVE",4) == 0) {
+		/* walk the chunks till the data one */
+		while(fread(buf,1,8,file) == 8) {
+			apr_uint32_t size = buf[4] | (buf[5] << 8) | (buf[6] << 16) | ((apr_uint32_t)buf[7] << 24);
+			if(memcmp(buf,"data",4) == 0) {
+				data_size = size;
+				break;
+			}
+			if(memcmp(buf,"fmt ",4) == 0 && size >= 16) {
+				if(fread(buf,1,16,file) != 16)
+					break;
+				byte_rate = buf[8] | (buf[9] << 8) | (buf[10] << 16) | ((apr_uint32_t)buf[11] << 24);
+				size -= 16;
+			}
+			if(fseek(file,(size + 1) & ~1U,SEEK_CUR) != 0)
+				break;
+		}
+	}
+	else if(fseek(file,0,SEEK_END) == 0 && (file_size = ftell(file)) > 0) {
+		data_size = (apr_uint32_t) file_size;
+	}
+	fclose(file);
+
+	if(!byte_rate) {
+		return 0;
+	}
+	return (apr_uint32_t) ((apr_uint64_t)data_size * 1000 / byte_rate);
+}
+
+/** Get the resident memory (KB) of a process, 0 if not available */
+static apr_size_t process_memory_get(long pid)
+{
+	char path[64];
+	char line[256];
+	apr_size_t rss = 0;
+	FILE *file;
+
+	apr_snprintf(path,sizeof(path),"/proc/%ld/status",pid);
+	file = fopen(path,"r");
+	if(!file) {
+		return 0;
+	}
+	while(fgets(line,sizeof(line),file)) {
+		if(strncmp(line,"VmRSS:",6) == 0) {
+			rss = (apr_size_t) atol(line + 6);
+			break;
+		}
+	}
+	fclose(file);
+	return rss;
+}
+
+/** Load the manifest, a line per utterance: audio file, a tab, and reference transcript */
+static apt_bool_t manifest_load(bench_t *bench, const char *file_path)
+{
+	char line[4096];
+	FILE *file = fopen(file_path,"r");
+	if(!file) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Manifest [%s]",file_path);
+		return FALSE;
+	}
+
+	while(fgets(line,sizeof(line),file)) {
+		bench_utterance_t *utterance;
+		char *reference;
+		apr_size_t len = strlen(line);
+		while(len && (line[len-1] == '\n' || line[len-1] == '\r')) {
+			line[--len] = '\0';
+		}
+		if(!len || *line == '#') {
+			continue;
+		}
+
+		reference = strchr(line,'\t');
+		if(reference) {
+			*reference++ = '\0';
+		}
+
+		utterance = apr_array_push(bench->utterances);
+		memset(utterance,0,sizeof(bench_utterance_t));
+		utterance->audio_file = apr_pstrdup(bench->pool,line);
+		utterance->reference = apr_pstrdup(bench->pool,reference ? reference : "");
+	}
+	fclose(file);
+
+	if(!bench->utterances->nelts) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Utterances in Manifest [%s]",file_path);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Recognize an utterance in a session of its own */
+static void utterance_recognize(bench_channel_t *channel, bench_utterance_t *utterance, apr_pool_t *pool)
+{
+	bench_t *bench = channel->bench;
+	const apt_dir_layout_t *dir_layout = mrcp_application_dir_layout_get(bench->engine->mrcp_app);
+	const char *file_path = apt_datadir_filepath_get(dir_layout,utterance->audio_file,pool);
+	asr_session_t *session;
+	apr_time_t start_time;
+	apr_time_t complete_time;
+	const char *result;
+
+	utterance->channel_id = channel->id;
+	utterance->duration = file_path ? audio_duration_get(file_path,bench->options->sample_rate) : 0;
+	utterance->hypothesis = "";
+	utterance->reference_words = words_split(utterance->reference,pool)->nelts;
+	utterance->errors = utterance->reference_words;
+
+	session = asr_session_create(bench->engine,bench->options->profile);
+	if(!session) {
+		return;
+	}
+
+	start_time = apr_time_now();
+	result = asr_session_file_recognize(session,bench->options->grammar_file,utterance->audio_file,NULL,FALSE);
+	complete_time = apr_time_now();
+
+	if(session->recog_complete) {
+		utterance->recognized = TRUE;
+		utterance->process_time = (apr_uint32_t) apr_time_as_msec(complete_time - start_time);
+		/* the result may be complete before the input is over */
+		if(session->input_over_time && complete_time > session->input_over_time) {
+			utterance->time_to_final = (apr_uint32_t) apr_time_as_msec(complete_time - session->input_over_time);
+		}
+		if(result) {
+			utterance->hypothesis = apr_pstrdup(channel->pool,result);
+		}
+		utterance->errors = word_errors_count(
+								words_split(utterance->reference,pool),
+								words_split(utterance->hypothesis,pool),
+								pool);
+	}
+	asr_session_destroy(session);
+}
+
+/** Thread function to run a channel in */
+static void* APR_THREAD_FUNC bench_channel_run(apr_thread_t *thread, void *data)
+{
+	bench_channel_t *channel = data;
+	bench_t *bench = channel->bench;
+	bench_utterance_t *utterance;
+	apr_pool_t *pool;
+
+	apr_pool_create(&pool,NULL);
+	do {
+		utterance = NULL;
+		apr_thread_mutex_lock(bench->mutex);
+		if(bench->next_utterance < (apr_size_t)bench->utterances->nelts) {
+			utterance = &APR_ARRAY_IDX(bench->utterances,bench->next_utterance,bench_utterance_t);
+			bench->next_utterance++;
+		}
+		apr_thread_mutex_unlock(bench->mutex);
+
+		if(utterance) {
+			utterance_recognize(channel,utterance,pool);
+			apr_pool_clear(pool);
+		}
+	}
+	while(utterance);
+	apr_pool_destroy(pool);
+
+	apr_thread_mutex_lock(bench->mutex);
+	bench->active_channels--;
+	apr_thread_mutex_unlock(bench->mutex);
+	return NULL;
+}
+
+/** Write a string as a JSON literal */
+static void json_string_write(FILE *out, const char *str)
+{
+	fputc('"',out);
+	for(; str && *str != '\0'; str++) {
+		unsigned char ch = (unsigned char) *str;
+		if(ch == '"' || ch == '\\') {
+			fputc('\\',out);
+			fputc(ch,out);
+		}
+		else if(ch < 0x20) {
+			fprintf(out,"\\u%04x",ch);
+		}
+		else {
+			fputc(ch,out);
+		}
+	}
+	fputc('"',out);
+}
+
+static double ratio_get(apr_size_t numerator, apr_size_t denominator)
+{
+	return denominator ? (double) numerator / denominator : 0.0;
+}
+
+static void utterance_write(FILE *out, const bench_utterance_t *utterance)
+{
+	fprintf(out,"{\"type\":\"utterance\",\"audio\":");
+	json_string_write(out,utterance->audio_file);
+	fprintf(out,",\"channel\":%" APR_SIZE_T_FMT ",\"recognized\":%s,\"duration_ms\":%u,\"process_ms\":%u"
+		",\"rtf\":%.3f,\"time_to_final_ms\":%u,\"reference_words\":%" APR_SIZE_T_FMT ",\"errors\":%" APR_SIZE_T_FMT
+		",\"wer\":%.4f,\"reference\":",
+		utterance->channel_id,
+		utterance->recognized == TRUE ? "true" : "false",
+		utterance->duration,
+		utterance->process_time,
+		ratio_get(utterance->process_time,utterance->duration),
+		utterance->time_to_final,
+		utterance->reference_words,
+		utterance->errors,
+		ratio_get(utterance->errors,utterance->reference_words));
+	json_string_write(out,utterance->reference);
+	fprintf(out,",\"hypothesis\":");
+	json_string_write(out,utterance->hypothesis);
+	fprintf(out,"}\n");
+}
+
+static apt_bool_t bench_run(bench_t *bench, FILE *out)
+{
+	bench_options_t *options = bench->options;
+	bench_channel_t *channels;
+	apt_histogram_t *histogram;
+	apr_size_t baseline_memory = 0;
+	apr_size_t peak_memory = 0;
+	apr_size_t memory;
+	apr_size_t recognized = 0;
+	apr_size_t reference_words = 0;
+	apr_size_t errors = 0;
+	apr_uint64_t duration = 0;
+	apr_uint64_t process_time = 0;
+	apr_size_t active_channels;
+	apr_time_t start_time;
+	apr_time_t wall_time;
+	apr_size_t i;
+	int j;
+
+	if(apr_thread_mutex_create(&bench->mutex,APR_THREAD_MUTEX_DEFAULT,bench->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+
+	if(options->server_pid) {
+		baseline_memory = peak_memory = process_memory_get(options->server_pid);
+		if(!baseline_memory) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Memory of Server [%ld]",options->server_pid);
+		}
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Start Benchmark [%d utterances] [%" APR_SIZE_T_FMT " channels]",
+		bench->utterances->nelts,options->channel_count);
+
+	start_time = apr_time_now();
+	channels = apr_pcalloc(bench->pool,sizeof(bench_channel_t) * options->channel_count);
+	for(i = 0; i < options->channel_count; i++) {
+		channels[i].bench = bench;
+		channels[i].id = i;
+		apr_pool_create(&channels[i].pool,bench->pool);
+		apr_thread_mutex_lock(bench->mutex);
+		bench->active_channels++;
+		apr_thread_mutex_unlock(bench->mutex);
+		if(apr_thread_create(&channels[i].thread,NULL,bench_channel_run,&channels[i],bench->pool) != APR_SUCCESS) {
+			apr_thread_mutex_lock(bench->mutex);
+			bench->active_channels--;
+			apr_thread_mutex_unlock(bench->mutex);
+			channels[i].thread = NULL;
+		}
+	}
+
+	/* sample the memory of the server till all the channels are done */
+	do {
+		apr_sleep(MEMORY_SAMPLE_INTERVAL * 1000);
+		if(baseline_memory) {
+			memory = process_memory_get(options->server_pid);
+			if(memory > peak_memory)
+				peak_memory = memory;
+		}
+		apr_thread_mutex_lock(bench->mutex);
+		active_channels = bench->active_channels;
+		apr_thread_mutex_unlock(bench->mutex);
+	}
+	while(active_channels);
+
+	for(i = 0; i < options->channel_count; i++) {
+		if(channels[i].thread) {
+			apr_status_t rv;
+			apr_thread_join(&rv,channels[i].thread);
+		}
+	}
+	wall_time = apr_time_now() - start_time;
+
+	histogram = apt_histogram_create(bench->pool);
+	for(j = 0; j < bench->utterances->nelts; j++) {
+		const bench_utterance_t *utterance = &APR_ARRAY_IDX(bench->utterances,j,bench_utterance_t);
+		utterance_write(out,utterance);
+
+		reference_words += utterance->reference_words;
+		errors += utterance->errors;
+		if(utterance->recognized == TRUE) {
+			recognized++;
+			duration += utterance->duration;
+			process_time += utterance->process_time;
+			apt_histogram_record(histogram,utterance->time_to_final);
+		}
+	}
+
+	fprintf(out,"{\"type\":\"summary\",\"channels\":%" APR_SIZE_T_FMT ",\"utterances\":%d,\"recognized\":%" APR_SIZE_T_FMT
+		",\"reference_words\":%" APR_SIZE_T_FMT ",\"errors\":%" APR_SIZE_T_FMT ",\"wer\":%.4f"
+		",\"audio_sec\":%.3f,\"wall_sec\":%.3f,\"rtf\":%.3f,\"throughput\":%.3f"
+		",\"time_to_final_ms\":{\"p50\":%u,\"p99\":%u,\"mean\":%.1f,\"max\":%u}",
+		options->channel_count,
+		bench->utterances->nelts,
+		recognized,
+		reference_words,
+		errors,
+		ratio_get(errors,reference_words),
+		(double) duration / 1000,
+		(double) wall_time / APR_USEC_PER_SEC,
+		duration ? (double) process_time / duration : 0.0,
+		wall_time ? (double) duration * 1000 / wall_time : 0.0,
+		apt_histogram_percentile_get(histogram,50),
+		apt_histogram_percentile_get(histogram,99),
+		apt_histogram_mean_get(histogram),
+		apt_histogram_max_get(histogram));
+	if(baseline_memory) {
+		fprintf(out,",\"memory_kb\":{\"baseline\":%" APR_SIZE_T_FMT ",\"peak\":%" APR_SIZE_T_FMT ",\"per_channel\":%.1f}",
+			baseline_memory,
+			peak_memory,
+			(double) (peak_memory - baseline_memory) / options->channel_count);
+	}
+	fprintf(out,"}\n");
+	fflush(out);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Benchmark Complete [%" APR_SIZE_T_FMT "/%d recognized] WER [%.4f]",
+		recognized,bench->utterances->nelts,ratio_get(errors,reference_words));
+	return TRUE;
+}
+
+static void usage(void)
+{
+	printf(
+		"\n"
+		"Usage:\n"
+		"\n"
+		"  asrbench [options]\n"
+		"\n"
+		"  Available options:\n"
+		"\n"
+		"   -m [--manifest] path     : Set the manifest of utterances (required).\n"
+		"                              (a line per utterance: audio file relative to data dir,\n"
+		"                              a tab, and reference transcript)\n"
+		"\n"
+		"   -c [--channels] count    : Set the number of parallel channels (default 1).\n"
+		"\n"
+		"   -g [--grammar] uri_list  : Set the grammar(s) to recognize against (default " DEFAULT_GRAMMAR_FILE ").\n"
+		"\n"
+		"   -p [--profile] name      : Set the client profile (default " DEFAULT_PROFILE ").\n"
+		"\n"
+		"   -s [--sample-rate] rate  : Set the sample rate of headerless PCM files (default 8000).\n"
+		"\n"
+		"   -P [--server-pid] pid    : Set the pid of the server to sample the memory of (Linux).\n"
+		"\n"
+		"   -O [--output] path       : Set the file to write the JSON lines to (default stdout).\n"
+		"\n"
+		"   -r [--root-dir] path     : Set the project root directory path.\n"
+		"\n"
+		"   -l [--log-prio] priority : Set the log priority.\n"
+		"                              (0-emergency, ..., 7-debug)\n"
+		"\n"
+		"   -o [--log-output] mode   : Set the log output mode.\n"
+		"                              (0-none, 1-console only, 2-file only, 3-both)\n"
+		"\n"
+		"   -h [--help]              : Show the help.\n"
+		"\n");
+}
+
+static void options_destroy(bench_options_t *options)
+{
+	if(options->pool) {
+		apr_pool_destroy(options->pool);
+	}
+}
+
+static bench_options_t* options_load(int argc, const char * const *argv)
+{
+	apr_status_t rv;
+	apr_getopt_t *opt = NULL;
+	int optch;
+	const char *optarg;
+	apr_pool_t *pool;
+	bench_options_t *options;
+
+	const apr_getopt_option_t opt_option[] = {
+		/* long-option, short-option, has-arg flag, description */
+		{ "manifest",    'm', TRUE,  "manifest of utterances" },  /* -m arg or --manifest arg */
+		{ "channels",    'c', TRUE,  "number of channels" },      /* -c arg or --channels arg */
+		{ "grammar",     'g', TRUE,  "grammar uri list" },        /* -g arg or --grammar arg */
+		{ "profile",     'p', TRUE,  "client profile" },          /* -p arg or --profile arg */
+		{ "sample-rate", 's', TRUE,  "sample rate of PCM" },      /* -s arg or --sample-rate arg */
+		{ "server-pid",  'P', TRUE,  "pid of server" },           /* -P arg or --server-pid arg */
+		{ "output",      'O', TRUE,  "output file" },             /* -O arg or --output arg */
+		{ "root-dir",    'r', TRUE,  "path to root dir" },        /* -r arg or --root-dir arg */
+		{ "log-prio",    'l', TRUE,  "log priority" },            /* -l arg or --log-prio arg */
+		{ "log-output",  'o', TRUE,  "log output mode" },         /* -o arg or --log-output arg */
+		{ "help",        'h', FALSE, "show help" },               /* -h or --help */
+		{ NULL, 0, 0, NULL },                                     /* end */
+	};
+
+	/* create APR pool to allocate options from */
+	apr_pool_create(&pool,NULL);
+	if(!pool) {
+		return NULL;
+	}
+	options = apr_palloc(pool,sizeof(bench_options_t));
+	options->pool = pool;
+	/* set the default options */
+	options->root_dir_path = NULL;
+	options->log_priority = APT_PRIO_WARNING;
+	options->log_output = APT_LOG_OUTPUT_FILE;
+	options->manifest_file = NULL;
+	options->output_file = NULL;
+	options->grammar_file = DEFAULT_GRAMMAR_FILE;
+	options->profile = DEFAULT_PROFILE;
+	options->channel_count = 1;
+	options->sample_rate = DEFAULT_SAMPLE_RATE;
+	options->server_pid = 0;
+
+	rv = apr_getopt_init(&opt, pool , argc, argv);
+	if(rv != APR_SUCCESS) {
+		options_destroy(options);
+		return NULL;
+	}
+
+	while((rv = apr_getopt_long(opt, opt_option, &optch, &optarg)) == APR_SUCCESS) {
+		switch(optch) {
+			case 'm':
+				options->manifest_file = optarg;
+				break;
+			case 'c':
+				if(optarg && atol(optarg) > 0) {
+					options->channel_count = atol(optarg);
+				}
+				break;
+			case 'g':
+				options->grammar_file = optarg;
+				break;
+			case 'p':
+				options->profile = optarg;
+				break;
+			case 's':
+				if(optarg && atol(optarg) > 0) {
+					options->sample_rate = atol(optarg);
+				}
+				break;
+			case 'P':
+				if(optarg) {
+					options->server_pid = atol(optarg);
+				}
+				break;
+			case 'O':
+				options->output_file = optarg;
+				break;
+			case 'r':
+				options->root_dir_path = optarg;
+				break;
+			case 'l':
+				if(optarg) {
+					options->log_priority = atoi(optarg);
+				}
+				break;
+			case 'o':
+				if(optarg) {
+					options->log_output = atoi(optarg);
+				}
+				break;
+			case 'h':
+				usage();
+				options_destroy(options);
+				return NULL;
+		}
+	}
+
+	if(rv != APR_EOF || !options->manifest_file) {
+		usage();
+		options_destroy(options);
+		return NULL;
+	}
+
+	return options;
+}
+
+int main(int argc, const char * const *argv)
+{
+	bench_options_t *options;
+	bench_t bench;
+	FILE *out = stdout;
+	int status = 1;
+
+	/* APR global initialization */
+	if(apr_initialize() != APR_SUCCESS) {
+		apr_terminate();
+		return 1;
+	}
+
+	/* load options */
+	options = options_load(argc,argv);
+	if(!options) {
+		apr_terminate();
+		return 1;
+	}
+
+	if(options->output_file) {
+		out = fopen(options->output_file,"w");
+		if(!out) {
+			printf("Failed to Open Output [%s]\n",options->output_file);
+			options_destroy(options);
+			apr_terminate();
+			return 1;
+		}
+	}
+
+	memset(&bench,0,sizeof(bench));
+	bench.options = options;
+	bench.pool = options->pool;
+	bench.utterances = apr_array_make(options->pool,64,sizeof(bench_utterance_t));
+
+	/* create asr engine */
+	bench.engine = asr_engine_create(
+				options->root_dir_path,
+				options->log_priority,
+				options->log_output);
+	if(bench.engine) {
+		if(manifest_load(&bench,options->manifest_file) == TRUE && bench_run(&bench,out) == TRUE) {
+			status = 0;
+		}
+		asr_engine_destroy(bench.engine);
+	}
+
+	if(out != stdout) {
+		fclose(out);
+	}
+
+	/* destroy options */
+	options_destroy(options);
+
+	/* APR global termination */
+	apr_terminate();
+	return status;
+}
@@ -34,6 +34,9 @@
 #include "mrcp_recog_resource.h"
 /* MPF includes */
 #include <mpf_frame_buffer.h>
+/* APT includes */
+#include "apt_spsc_queue.h"
+#include "apt_mpsc_queue.h"
 
 #include "asr_engine_common.h"
 
@@ -63,17 +66,71 @@ typedef struct asr_session_t asr_session_t;
 typedef enum {
 	INPUT_MODE_NONE,
 	INPUT_MODE_FILE,
-	INPUT_MODE_STREAM
+	INPUT_MODE_STREAM,
+	INPUT_MODE_PUSH
 } input_mode_e;
 
 #define MAX_URIS 10
 
+/** Max number of audio buffers pushed ahead of the media thread */
+#define ASR_STREAM_RING_SIZE 64
+
+/**
+ * Function called once a pushed audio buffer is fully consumed and may be reused.
+ * @param obj the object passed along with the buffer
+ * @param data the buffer
+ * @param size the size of the buffer
+ * @remark Called by the media thread (or by asr_session_destroy() for the buffers left), must not block.
+ */
+typedef void (*asr_stream_done_f)(void *obj, const char *data, apr_size_t size);
+
+/**
+ * Function called for each MRCP event of a push-based recognition.
+ * @param session the session the event belongs to
+ * @param event the event (START-OF-INPUT, INTERMEDIATE-RESULT, RECOGNITION-COMPLETE)
+ * @param obj the object set along with the function
+ * @remark Called by the client stack thread, must not block.
+ */
+typedef void (*asr_session_event_f)(asr_session_t *session, mrcp_message_t *event, void *obj);
+
+/**
+ * Function called for each completion of an asynchronous session.
+ * @param session the session the completion belongs to
+ * @param app_message the signaling response, the MRCP response or the MRCP event
+ * @param obj the object set along with the function
+ * @remark Called by the client stack thread, must not block.
+ */
+typedef void (*asr_session_complete_f)(asr_session_t *session, const mrcp_app_message_t *app_message, void *obj);
+
+/** Audio buffer pushed to the stream, referenced in-place till it is consumed */
+typedef struct asr_stream_chunk_t asr_stream_chunk_t;
+struct asr_stream_chunk_t {
+	/** Caller-owned data, NULL for the end of input */
+	const char        *data;
+	/** Size of the data */
+	apr_size_t         size;
+	/** Size of the data consumed (media thread only) */
+	apr_size_t         offset;
+	/** Function to release the buffer by */
+	asr_stream_done_f  done;
+	/** Object to pass to the function */
+	void              *obj;
+};
+
 /** ASR engine on top of UniMRCP client stack */
 struct asr_engine_t {
 	/** MRCP client stack */
 	mrcp_client_t      *mrcp_client;
 	/** MRCP client stack */
 	mrcp_application_t *mrcp_app;
+	/** Completions of asynchronous sessions (const mrcp_app_message_t*), if polled */
+	apt_mpsc_queue_t   *completions;
+	/** Mutex of the completion wait object */
+	apr_thread_mutex_t *completion_mutex;
+	/** Completion wait object */
+	apr_thread_cond_t  *completion_cond;
+	/** Whether the completions are waited for (protected by the mutex) */
+	apt_bool_t          completion_waiting;
 	/** Memory pool */
 	apr_pool_t         *pool;
 };
@@ -97,6 +154,14 @@ struct asr_session_t {
 	mpf_frame_buffer_t       *media_buffer;
 	/** Streaming is in-progress */
 	apt_bool_t                streaming;
+	/** Time the input file is over at, 0 while streaming */
+	apr_time_t                input_over_time;
+	/** Ring of pushed audio buffers (asr_stream_chunk_t) */
+	apt_spsc_queue_t         *stream_ring;
+	/** Function to raise push-based recognition events by */
+	asr_session_event_f       event_handler;
+	/** Object to pass to the function */
+	void                     *event_obj;
 
 	/** Conditional wait object */
 	apr_thread_cond_t        *wait_object;
@@ -105,6 +170,13 @@ struct asr_session_t {
 
 	/** Message sent from client stack */
 	const mrcp_app_message_t *app_message;
+
+	/** Whether requests complete asynchronously instead of being waited for */
+	apt_bool_t                async;
+	/** Function to raise completions by, NULL to queue them to the engine */
+	asr_session_complete_f    complete_handler;
+	/** Object to pass to the function */
+	void                     *complete_obj;
 };
 
 
@@ -171,6 +243,46 @@ ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_write(
 									char *data,
 									int size);
 
+/**
+ * Start push-based recognition based on specified grammar.
+ * @param session the session to run recognition in the scope of
+ * @param grammar_file the name of the grammar file to use (path is relative to data dir)
+ * @param handler the function to raise the events of the recognition by
+ * @param obj the object to pass to the function
+ * @return TRUE once RECOGNIZE is in progress
+ *
+ * @remark Audio buffers should be pushed through asr_session_stream_push() calls and the input
+ *         closed by asr_session_stream_end(); the result is raised as RECOGNITION-COMPLETE.
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_start(
+									asr_session_t *session,
+									const char *grammar_file,
+									asr_session_event_f handler,
+									void *obj);
+
+/**
+ * Push audio buffer to recognize, without copying it.
+ * @param session the session to push audio for
+ * @param data the caller-owned buffer, which must stay valid till done is called
+ * @param size the size of the buffer
+ * @param done the function to call once the buffer is consumed (may be NULL)
+ * @param obj the object to pass to the function
+ * @return FALSE if ASR_STREAM_RING_SIZE buffers are already pending
+ * @remark A single thread may push to a session at a time.
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_push(
+									asr_session_t *session,
+									const char *data,
+									apr_size_t size,
+									asr_stream_done_f done,
+									void *obj);
+
+/**
+ * Close audio input pushed to recognize, once the pending buffers are consumed.
+ * @param session the session to close input of
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_end(asr_session_t *session);
+
 /**
  * Send SET-PARAM request.
  * @param session the session to send SET-PARAM in the scope of
@@ -195,9 +307,78 @@ ASR_CLIENT_DECLARE(ParameterSet*) asr_session_get_all_params(asr_session_t *sess
 /**
  * Destroy ASR session.
  * @param session the session to destroy
+ * @remark An asynchronous session must be terminated by asr_session_terminate_async() first.
  */
 ASR_CLIENT_DECLARE(apt_bool_t) asr_session_destroy(asr_session_t *session);
 
+/**
+ * Create queue of completions of asynchronous sessions, which are created with no handler.
+ * @param engine the engine to create queue for
+ * @param capacity the max number of completions queued (rounded up to the power of two)
+ * @remark Completions beyond the capacity are dropped, it should exceed the requests outstanding.
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_engine_completion_queue_create(asr_engine_t *engine, apr_size_t capacity);
+
+/**
+ * Poll completions of asynchronous sessions.
+ * @param engine the engine to poll completions of
+ * @param completions the array to store completions to
+ * @param max_count the size of the array
+ * @param timeout the time to wait for the first completion (usec), 0 not to wait
+ * @return the number of completions stored
+ * @remark A single thread may poll at a time. The session of a completion is
+ *         mrcp_application_session_object_get(completion->session).
+ */
+ASR_CLIENT_DECLARE(apr_size_t) asr_engine_completions_poll(
+									asr_engine_t *engine,
+									const mrcp_app_message_t *completions[],
+									apr_size_t max_count,
+									apr_interval_time_t timeout);
+
+/**
+ * Create asynchronous ASR session, the requests of which return once they are sent.
+ * @param engine the engine session belongs to
+ * @param profile the name of UniMRCP profile to use
+ * @param handler the function to raise completions by, NULL to queue them to the engine
+ * @param obj the object to pass to the function
+ * @remark The response to the channel add request completes the creation.
+ */
+ASR_CLIENT_DECLARE(asr_session_t*) asr_session_create_async(
+									asr_engine_t *engine,
+									const char *profile,
+									asr_session_complete_f handler,
+									void *obj);
+
+/**
+ * Send DEFINE-GRAMMAR request of asynchronous session.
+ * @param session the session to send DEFINE-GRAMMAR in the scope of
+ * @param grammar_uri the grammar URI to use
+ * @param grammar_id the identifier of the grammar to use in Content-Id
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_define_grammar_async(
+									asr_session_t *session,
+									const char *grammar_uri,
+									int grammar_id);
+
+/**
+ * Send RECOGNIZE request of asynchronous session, the input file is streamed once it is in progress.
+ * @param session the session to send RECOGNIZE in the scope of
+ * @param input_file the name of the audio input file to use (path is relative to data dir)
+ * @param uri_count the number of grammar URIs to use
+ * @param weights the array of grammar weights to use
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_file_recognize_async(
+									asr_session_t *session,
+									const char *input_file,
+									int uri_count,
+									float weights[]);
+
+/**
+ * Terminate asynchronous session, once the response completes, the session may be destroyed.
+ * @param session the session to terminate
+ */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_terminate_async(asr_session_t *session);
+
 /**
  * Set log priority.
  * @param priority the priority to set
@@ -70,6 +70,7 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 };
 
 static apt_bool_t app_message_handler(const mrcp_app_message_t *app_message);
+static mrcp_message_t* mrcp_event_get(const mrcp_app_message_t *app_message);
 
 
 /** Create ASR engine */
@@ -114,6 +115,10 @@ ASR_CLIENT_DECLARE(asr_engine_t*) asr_engine_create(
 	engine->pool = pool;
 	engine->mrcp_client = NULL;
 	engine->mrcp_app = NULL;
+	engine->completions = NULL;
+	engine->completion_mutex = NULL;
+	engine->completion_cond = NULL;
+	engine->completion_waiting = FALSE;
 
 	/* create UniMRCP client stack */
 	mrcp_client = unimrcp_client_create(dir_layout);
@@ -162,6 +167,14 @@ ASR_CLIENT_DECLARE(apt_bool_t) asr_engine_destroy(asr_engine_t *engine)
 		engine->mrcp_client = NULL;
 		engine->mrcp_app = NULL;
 	}
+	if(engine->completion_cond) {
+		apr_thread_cond_destroy(engine->completion_cond);
+		engine->completion_cond = NULL;
+	}
+	if(engine->completion_mutex) {
+		apr_thread_mutex_destroy(engine->completion_mutex);
+		engine->completion_mutex = NULL;
+	}
 
 	/* destroy singleton logger */
 	apt_log_instance_destroy();
@@ -201,6 +214,17 @@ static apt_bool_t asr_session_destroy_ex(asr_session_t *asr_session, apt_bool_t
 		mpf_frame_buffer_destroy(asr_session->media_buffer);
 		asr_session->media_buffer = NULL;
 	}
+	if(asr_session->stream_ring) {
+		/* release the buffers pushed, but not consumed */
+		asr_stream_chunk_t *chunk;
+		while((chunk = apt_spsc_queue_read_begin(asr_session->stream_ring)) != NULL) {
+			if(chunk->data && chunk->done) {
+				chunk->done(chunk->obj,chunk->data,chunk->size);
+			}
+			apt_spsc_queue_read_commit(asr_session->stream_ring);
+		}
+		asr_session->stream_ring = NULL;
+	}
 
 	return mrcp_application_session_destroy(asr_session->mrcp_session);
 }
@@ -254,6 +278,44 @@ static apt_bool_t asr_input_file_open(asr_session_t *asr_session, const char *in
 	return TRUE;
 }
 
+/** Fill audio frame from the buffers pushed, in-place */
+static void asr_stream_frame_fill(asr_session_t *asr_session, mpf_frame_t *frame)
+{
+	asr_stream_chunk_t *chunk;
+	char *buffer = frame->codec_frame.buffer;
+	apr_size_t size = frame->codec_frame.size;
+	apr_size_t filled = 0;
+	apr_size_t length;
+	while(filled < size && (chunk = apt_spsc_queue_read_begin(asr_session->stream_ring)) != NULL) {
+		if(!chunk->data) {
+			/* input is over */
+			apt_spsc_queue_read_commit(asr_session->stream_ring);
+			asr_session->streaming = FALSE;
+			asr_session->input_over_time = apr_time_now();
+			break;
+		}
+		length = chunk->size - chunk->offset;
+		if(length > size - filled) {
+			length = size - filled;
+		}
+		memcpy(buffer + filled,chunk->data + chunk->offset,length);
+		filled += length;
+		chunk->offset += length;
+		if(chunk->offset == chunk->size) {
+			if(chunk->done) {
+				chunk->done(chunk->obj,chunk->data,chunk->size);
+			}
+			apt_spsc_queue_read_commit(asr_session->stream_ring);
+		}
+	}
+	if(filled) {
+		if(filled < size) {
+			memset(buffer + filled,0,size - filled);
+		}
+		frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+	}
+}
+
 /** MPF callback to read audio frame */
 static apt_bool_t asr_stream_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
 {
@@ -268,6 +330,7 @@ static apt_bool_t asr_stream_read(mpf_audio_stream_t *stream, mpf_frame_t *frame
 				else {
 					/* file is over */
 					asr_session->streaming = FALSE;
+					asr_session->input_over_time = apr_time_now();
 				}
 			}
 		}
@@ -276,6 +339,11 @@ static apt_bool_t asr_stream_read(mpf_audio_stream_t *stream, mpf_frame_t *frame
 				mpf_frame_buffer_read(asr_session->media_buffer,frame);
 			}
 		}
+		if(asr_session->input_mode == INPUT_MODE_PUSH) {
+			if(asr_session->stream_ring) {
+				asr_stream_frame_fill(asr_session,frame);
+			}
+		}
 	}
 	return TRUE;
 }
@@ -463,7 +531,8 @@ ASR_CLIENT_DECLARE(const char*) nlsml_result_get(mrcp_message_t *message)
 {
 	nlsml_interpretation_t *interpretation;
 	nlsml_instance_t *instance;
-	nlsml_result_t *result = nlsml_result_parse(message->body.buf, message->body.length, message->pool);
+	/* the result is scanned in place of the body, which lives as long as the message */
+	nlsml_result_t *result = nlsml_result_scan(message->body.buf, message->body.length, message->pool);
 	if(!result) {
 		return NULL;
 	}
@@ -485,6 +554,37 @@ ASR_CLIENT_DECLARE(const char*) nlsml_result_get(mrcp_message_t *message)
 }
 
 
+/** Raise completion of asynchronous session */
+static void asr_session_complete(asr_session_t *asr_session, const mrcp_app_message_t *app_message)
+{
+	asr_engine_t *engine = asr_session->engine;
+	mrcp_message_t *mrcp_message = app_message->control_message;
+
+	if(app_message->message_type == MRCP_APP_MESSAGE_TYPE_CONTROL && mrcp_message &&
+		mrcp_message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE &&
+		mrcp_message->start_line.method_id == RECOGNIZER_RECOGNIZE &&
+		mrcp_message->start_line.request_state == MRCP_REQUEST_STATE_INPROGRESS &&
+		asr_session->input_mode == INPUT_MODE_FILE && asr_session->audio_in) {
+		/* start streaming the input file, as RECOGNIZE is in progress */
+		asr_session->input_over_time = 0;
+		asr_session->streaming = TRUE;
+	}
+
+	if(asr_session->complete_handler) {
+		asr_session->complete_handler(asr_session,app_message,asr_session->complete_obj);
+		return;
+	}
+	if(!engine->completions || apt_mpsc_queue_push(engine->completions,(void*)app_message) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Queue Completion: queue is full");
+		return;
+	}
+	apr_thread_mutex_lock(engine->completion_mutex);
+	if(engine->completion_waiting == TRUE) {
+		apr_thread_cond_signal(engine->completion_cond);
+	}
+	apr_thread_mutex_unlock(engine->completion_mutex);
+}
+
 /** Application message handler */
 static apt_bool_t app_message_handler(const mrcp_app_message_t *app_message)
 {
@@ -493,6 +593,21 @@ static apt_bool_t app_message_handler(const mrcp_app_message_t *app_message)
 		app_message->message_type == MRCP_APP_MESSAGE_TYPE_CONTROL) {
 
 		asr_session_t *asr_session = mrcp_application_session_object_get(app_message->session);
+		if(asr_session && asr_session->event_handler) {
+			/* events of push-based recognition are raised instead of waited for */
+			mrcp_message_t *mrcp_message = mrcp_event_get(app_message);
+			if(mrcp_message) {
+				if(mrcp_message->start_line.method_id == RECOGNIZER_RECOGNITION_COMPLETE) {
+					asr_session->recog_complete = mrcp_message;
+				}
+				asr_session->event_handler(asr_session,mrcp_message,asr_session->event_obj);
+				return TRUE;
+			}
+		}
+		if(asr_session && asr_session->async == TRUE) {
+			asr_session_complete(asr_session,app_message);
+			return TRUE;
+		}
 		if(asr_session) {
 			apr_thread_mutex_lock(asr_session->mutex);
 			asr_session->app_message = app_message;
@@ -546,13 +661,12 @@ static mrcp_message_t* mrcp_event_get(const mrcp_app_message_t *app_message)
 	return mrcp_message;
 }
 
-/** Create ASR session */
-ASR_CLIENT_DECLARE(asr_session_t*) asr_session_create(asr_engine_t *engine, const char *profile)
+/** Allocate ASR session, the channel of which is to be added */
+static asr_session_t* asr_session_alloc(asr_engine_t *engine, const char *profile)
 {
 	mpf_termination_t *termination;
 	mrcp_channel_t *channel;
 	mrcp_session_t *session;
-	const mrcp_app_message_t *app_message;
 	apr_pool_t *pool;
 	asr_session_t *asr_session;
 	mpf_stream_capabilities_t *capabilities;
@@ -599,11 +713,18 @@ ASR_CLIENT_DECLARE(asr_session_t*) asr_session_create(asr_engine_t *engine, cons
 	asr_session->recog_complete = NULL;
 	asr_session->input_mode = INPUT_MODE_NONE;
 	asr_session->streaming = FALSE;
+	asr_session->input_over_time = 0;
 	asr_session->audio_in = NULL;
 	asr_session->media_buffer = NULL;
+	asr_session->stream_ring = NULL;
+	asr_session->event_handler = NULL;
+	asr_session->event_obj = NULL;
 	asr_session->mutex = NULL;
 	asr_session->wait_object = NULL;
 	asr_session->app_message = NULL;
+	asr_session->async = FALSE;
+	asr_session->complete_handler = NULL;
+	asr_session->complete_obj = NULL;
 
 	/* Create cond wait object and mutex */
 	apr_thread_mutex_create(&asr_session->mutex,APR_THREAD_MUTEX_DEFAULT,pool);
@@ -611,6 +732,19 @@ ASR_CLIENT_DECLARE(asr_session_t*) asr_session_create(asr_engine_t *engine, cons
 
 	/* Create media buffer */
 	asr_session->media_buffer = mpf_frame_buffer_create(160,20,pool);
+	/* Create ring of pushed audio buffers */
+	asr_session->stream_ring = apt_spsc_queue_create(ASR_STREAM_RING_SIZE,sizeof(asr_stream_chunk_t),pool);
+	return asr_session;
+}
+
+/** Create ASR session */
+ASR_CLIENT_DECLARE(asr_session_t*) asr_session_create(asr_engine_t *engine, const char *profile)
+{
+	const mrcp_app_message_t *app_message;
+	asr_session_t *asr_session = asr_session_alloc(engine,profile);
+	if(!asr_session) {
+		return NULL;
+	}
 
 	/* Send add channel request and wait for the response */
 	apr_thread_mutex_lock(asr_session->mutex);
@@ -1020,8 +1154,9 @@ ASR_CLIENT_DECLARE(apt_bool_t) asr_session_file_recognize_send(
 	mrcp_channel_t *client_channel = (mrcp_channel_t*) asr_session->mrcp_channel;
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Begin asr_session_file_recognize_send. session: %s. input_file: %s,grammar_file: %s",client_channel->session->id.buf, input_file,grammar_file == NULL ? "(null)" : grammar_file);
 
-	/* Reset prev recog result (if any) */
+	/* Reset prev recog result (if any), events are waited for */
 	asr_session->recog_complete = NULL;
+	asr_session->event_handler = NULL;
 
 	mrcp_message = recognize_message_create(asr_session,uri_count,weights);
 	if(!mrcp_message) {
@@ -1052,6 +1187,7 @@ ASR_CLIENT_DECLARE(apt_bool_t) asr_session_file_recognize_send(
 	if(asr_input_file_open(asr_session,input_file) == FALSE) {
 		return FALSE;
 	}
+	asr_session->input_over_time = 0;
 	asr_session->streaming = TRUE;
 
 	return TRUE;
@@ -1086,17 +1222,14 @@ ASR_CLIENT_DECLARE(mrcp_recognizer_event_id) asr_session_file_recognize_receive(
 	return mrcp_message->start_line.method_id;
 }
 
-// udpate note - is this ever used? Should it be removed?
-/** Initiate recognition based on specified grammar and input stream */
-ASR_CLIENT_DECLARE(const char*) asr_session_stream_recognize(
-									asr_session_t *asr_session,
-									const char *grammar_file)
+/** Send DEFINE-GRAMMAR and RECOGNIZE requests for streamed input and wait for the responses */
+static apt_bool_t asr_stream_recognize_send(asr_session_t *asr_session, const char *grammar_file)
 {
 	const mrcp_app_message_t *app_message = NULL;
 	mrcp_message_t *mrcp_message = define_grammar_message_create(asr_session,grammar_file,1);
 	if(!mrcp_message) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create DEFINE-GRAMMAR Request");
-		return NULL;
+		return FALSE;
 	}
 
 	/* Send DEFINE-GRAMMAR request and wait for the response */
@@ -1109,7 +1242,7 @@ ASR_CLIENT_DECLARE(const char*) asr_session_stream_recognize(
 	apr_thread_mutex_unlock(asr_session->mutex);
 
 	if(mrcp_response_check(app_message,MRCP_REQUEST_STATE_COMPLETE) == FALSE) {
-		return NULL;
+		return FALSE;
 	}
 
 	/* Reset prev recog result (if any) */
@@ -1119,7 +1252,7 @@ ASR_CLIENT_DECLARE(const char*) asr_session_stream_recognize(
 	mrcp_message = recognize_message_create(asr_session,1,NULL);
 	if(!mrcp_message) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create RECOGNIZE Request");
-		return NULL;
+		return FALSE;
 	}
 
 	/* Send RECOGNIZE request and wait for the response */
@@ -1131,7 +1264,20 @@ ASR_CLIENT_DECLARE(const char*) asr_session_stream_recognize(
 	}
 	apr_thread_mutex_unlock(asr_session->mutex);
 
-	if(mrcp_response_check(app_message,MRCP_REQUEST_STATE_INPROGRESS) == FALSE) {
+	return mrcp_response_check(app_message,MRCP_REQUEST_STATE_INPROGRESS);
+}
+
+// udpate note - is this ever used? Should it be removed?
+/** Initiate recognition based on specified grammar and input stream */
+ASR_CLIENT_DECLARE(const char*) asr_session_stream_recognize(
+									asr_session_t *asr_session,
+									const char *grammar_file)
+{
+	const mrcp_app_message_t *app_message = NULL;
+	mrcp_message_t *mrcp_message;
+
+	asr_session->event_handler = NULL;
+	if(asr_stream_recognize_send(asr_session,grammar_file) == FALSE) {
 		return NULL;
 	}
 
@@ -1185,10 +1331,222 @@ ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_write(
 	return TRUE;
 }
 
+/** Start push-based recognition based on specified grammar */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_start(
+									asr_session_t *asr_session,
+									const char *grammar_file,
+									asr_session_event_f handler,
+									void *obj)
+{
+	if(!asr_session->stream_ring || asr_session->streaming == TRUE) {
+		return FALSE;
+	}
+
+	/* Events are raised through the handler from now on */
+	asr_session->event_obj = obj;
+	asr_session->event_handler = handler;
+	if(asr_stream_recognize_send(asr_session,grammar_file) == FALSE) {
+		asr_session->event_handler = NULL;
+		return FALSE;
+	}
+
+	/* Set input mode and start streaming */
+	asr_session->input_over_time = 0;
+	asr_session->input_mode = INPUT_MODE_PUSH;
+	asr_session->streaming = TRUE;
+	return TRUE;
+}
+
+/** Push audio buffer to recognize */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_push(
+									asr_session_t *asr_session,
+									const char *data,
+									apr_size_t size,
+									asr_stream_done_f done,
+									void *obj)
+{
+	asr_stream_chunk_t *chunk;
+	if(!asr_session->stream_ring || !data || !size) {
+		return FALSE;
+	}
+	chunk = apt_spsc_queue_write_begin(asr_session->stream_ring);
+	if(!chunk) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Push Audio [%"APR_SIZE_T_FMT"]: ring is full",size);
+		return FALSE;
+	}
+	chunk->data = data;
+	chunk->size = size;
+	chunk->offset = 0;
+	chunk->done = done;
+	chunk->obj = obj;
+	apt_spsc_queue_write_commit(asr_session->stream_ring);
+	return TRUE;
+}
+
+/** Close audio input pushed to recognize */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_stream_end(asr_session_t *asr_session)
+{
+	asr_stream_chunk_t *chunk;
+	if(!asr_session->stream_ring) {
+		return FALSE;
+	}
+	chunk = apt_spsc_queue_write_begin(asr_session->stream_ring);
+	if(!chunk) {
+		return FALSE;
+	}
+	chunk->data = NULL;
+	chunk->size = 0;
+	chunk->offset = 0;
+	chunk->done = NULL;
+	chunk->obj = NULL;
+	apt_spsc_queue_write_commit(asr_session->stream_ring);
+	return TRUE;
+}
+
 /** Destroy ASR session */
 ASR_CLIENT_DECLARE(apt_bool_t) asr_session_destroy(asr_session_t *asr_session)
 {
-	return asr_session_destroy_ex(asr_session,TRUE);
+	/* asynchronous sessions are terminated in advance */
+	return asr_session_destroy_ex(asr_session,asr_session->async == TRUE ? FALSE : TRUE);
+}
+
+/** Create queue of completions of asynchronous sessions */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_engine_completion_queue_create(asr_engine_t *engine, apr_size_t capacity)
+{
+	if(engine->completions || !capacity) {
+		return FALSE;
+	}
+	if(apr_thread_mutex_create(&engine->completion_mutex,APR_THREAD_MUTEX_DEFAULT,engine->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	if(apr_thread_cond_create(&engine->completion_cond,engine->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	engine->completions = apt_mpsc_queue_create(capacity,engine->pool);
+	return engine->completions ? TRUE : FALSE;
+}
+
+/** Poll completions of asynchronous sessions */
+ASR_CLIENT_DECLARE(apr_size_t) asr_engine_completions_poll(
+									asr_engine_t *engine,
+									const mrcp_app_message_t *completions[],
+									apr_size_t max_count,
+									apr_interval_time_t timeout)
+{
+	apr_size_t count = 0;
+	if(!engine->completions || !max_count) {
+		return 0;
+	}
+	while(count < max_count && (completions[count] = apt_mpsc_queue_pop(engine->completions)) != NULL) {
+		count++;
+	}
+	if(count || timeout <= 0) {
+		return count;
+	}
+
+	/* check again once the producers are to signal, then wait */
+	apr_thread_mutex_lock(engine->completion_mutex);
+	engine->completion_waiting = TRUE;
+	completions[0] = apt_mpsc_queue_pop(engine->completions);
+	if(!completions[0]) {
+		apr_thread_cond_timedwait(engine->completion_cond,engine->completion_mutex,timeout);
+		completions[0] = apt_mpsc_queue_pop(engine->completions);
+	}
+	engine->completion_waiting = FALSE;
+	apr_thread_mutex_unlock(engine->completion_mutex);
+	if(!completions[0]) {
+		return 0;
+	}
+	count = 1;
+	while(count < max_count && (completions[count] = apt_mpsc_queue_pop(engine->completions)) != NULL) {
+		count++;
+	}
+	return count;
+}
+
+/** Create asynchronous ASR session */
+ASR_CLIENT_DECLARE(asr_session_t*) asr_session_create_async(
+									asr_engine_t *engine,
+									const char *profile,
+									asr_session_complete_f handler,
+									void *obj)
+{
+	asr_session_t *asr_session;
+	if(!handler && !engine->completions) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Async Session: no completion queue");
+		return NULL;
+	}
+	asr_session = asr_session_alloc(engine,profile);
+	if(!asr_session) {
+		return NULL;
+	}
+	asr_session->async = TRUE;
+	asr_session->complete_handler = handler;
+	asr_session->complete_obj = obj;
+
+	/* Send add channel request, the response completes the creation */
+	if(mrcp_application_channel_add(asr_session->mrcp_session,asr_session->mrcp_channel) != TRUE) {
+		asr_session_destroy_ex(asr_session,FALSE);
+		return NULL;
+	}
+	return asr_session;
+}
+
+/** Send DEFINE-GRAMMAR request of asynchronous session */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_define_grammar_async(
+									asr_session_t *asr_session,
+									const char *grammar_uri,
+									int grammar_id)
+{
+	mrcp_message_t *mrcp_message;
+	if(asr_session->async != TRUE) {
+		return FALSE;
+	}
+	mrcp_message = define_grammar_message_create(asr_session,grammar_uri,grammar_id);
+	if(!mrcp_message) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create DEFINE-GRAMMAR Request");
+		return FALSE;
+	}
+	return mrcp_application_message_send(asr_session->mrcp_session,asr_session->mrcp_channel,mrcp_message);
+}
+
+/** Send RECOGNIZE request of asynchronous session */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_file_recognize_async(
+									asr_session_t *asr_session,
+									const char *input_file,
+									int uri_count,
+									float weights[])
+{
+	mrcp_message_t *mrcp_message;
+	if(asr_session->async != TRUE || asr_session->streaming == TRUE) {
+		return FALSE;
+	}
+
+	/* Reset prev recog result (if any) */
+	asr_session->recog_complete = NULL;
+	asr_session->event_handler = NULL;
+
+	mrcp_message = recognize_message_create(asr_session,uri_count,weights);
+	if(!mrcp_message) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create RECOGNIZE Request");
+		return FALSE;
+	}
+
+	/* Open input file in advance, it is streamed once the request is in progress */
+	asr_session->input_mode = INPUT_MODE_FILE;
+	if(asr_input_file_open(asr_session,input_file) == FALSE) {
+		return FALSE;
+	}
+	return mrcp_application_message_send(asr_session->mrcp_session,asr_session->mrcp_channel,mrcp_message);
+}
+
+/** Terminate asynchronous session */
+ASR_CLIENT_DECLARE(apt_bool_t) asr_session_terminate_async(asr_session_t *asr_session)
+{
+	if(asr_session->async != TRUE) {
+		return FALSE;
+	}
+	return mrcp_application_session_terminate(asr_session->mrcp_session);
 }
 
 /** Set log priority */
@@ -501,16 +501,80 @@ static apt_bool_t unimrcp_client_rtsp_uac_load(unimrcp_client_loader_t *loader,
 }
 
 /** Load MRCPv2 connection agent */
+/** Load pool of warm MRCPv2 connections */
+static apt_bool_t unimrcp_client_connection_pool_load(unimrcp_client_loader_t *loader, mrcp_connection_agent_t *agent, const apr_xml_elem *root)
+{
+	const apr_xml_elem *elem;
+	const apr_xml_attr *attr;
+	apr_size_t idle_count = 0;
+	apr_size_t max_idle_time = 300;
+	apr_size_t check_interval = 5;
+
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(strcasecmp(attr->name,"idle-count") == 0) {
+			if(is_attr_valid(attr) == TRUE) {
+				idle_count = atol(attr->value);
+			}
+		}
+		else if(strcasecmp(attr->name,"max-idle-time") == 0) {
+			if(is_attr_valid(attr) == TRUE) {
+				max_idle_time = atol(attr->value);
+			}
+		}
+		else if(strcasecmp(attr->name,"check-interval") == 0) {
+			if(is_attr_valid(attr) == TRUE) {
+				check_interval = atol(attr->value);
+			}
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+
+	mrcp_client_connection_pool_set(agent,idle_count,max_idle_time,check_interval);
+	if(!idle_count) {
+		return TRUE;
+	}
+
+	for(elem = root->first_child; elem; elem = elem->next) {
+		if(strcasecmp(elem->name,"server") == 0) {
+			const char *ip = NULL;
+			apr_port_t port = 0;
+			for(attr = elem->attr; attr; attr = attr->next) {
+				if(strcasecmp(attr->name,"ip") == 0) {
+					if(is_attr_valid(attr) == TRUE) {
+						ip = attr->value;
+					}
+				}
+				else if(strcasecmp(attr->name,"port") == 0) {
+					if(is_attr_valid(attr) == TRUE) {
+						port = (apr_port_t)atol(attr->value);
+					}
+				}
+			}
+			if(mrcp_client_connection_pool_target_add(agent,ip,port) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Server of Connection Pool");
+			}
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
+		}
+	}
+	return TRUE;
+}
+
 static apt_bool_t unimrcp_client_mrcpv2_uac_load(unimrcp_client_loader_t *loader, const apr_xml_elem *root, const char *id)
 {
 	const apr_xml_elem *elem;
 	mrcp_connection_agent_t *agent;
 	apr_size_t max_connection_count = 100;
 	apr_size_t max_shared_use_count = 100;
+	apr_size_t thread_count = 1;
 	apt_bool_t offer_new_connection = FALSE;
 	const char *rx_buffer_size = NULL;
 	const char *tx_buffer_size = NULL;
 	const char *request_timeout = NULL;
+	const apr_xml_elem *connection_pool = NULL;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading MRCPv2 Agent <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -545,12 +609,20 @@ static apt_bool_t unimrcp_client_mrcpv2_uac_load(unimrcp_client_loader_t *loader
 				request_timeout = cdata_text_get(elem);
 			}
 		}
+		else if(strcasecmp(elem->name,"thread-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				thread_count = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"connection-pool") == 0) {
+			connection_pool = elem;
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
 	}
 
-	agent = mrcp_client_connection_agent_create(id,max_connection_count,offer_new_connection,loader->pool);
+	agent = mrcp_client_connection_agent_create_ex(id,max_connection_count,offer_new_connection,thread_count,loader->pool);
 	if(agent) {
 		if(rx_buffer_size) {
 			mrcp_client_connection_rx_size_set(agent,atol(rx_buffer_size));
@@ -562,6 +634,9 @@ static apt_bool_t unimrcp_client_mrcpv2_uac_load(unimrcp_client_loader_t *loader
 			mrcp_client_connection_timeout_set(agent,atol(request_timeout));
 		}
 		mrcp_client_connection_max_shared_use_set(agent,max_shared_use_count);
+		if(connection_pool) {
+			unimrcp_client_connection_pool_load(loader,agent,connection_pool);
+		}
 	}
 	return mrcp_client_connection_agent_register(loader->client,agent);
 }
@@ -572,6 +647,12 @@ static apt_bool_t unimrcp_client_media_engine_load(unimrcp_client_loader_t *load
 	const apr_xml_elem *elem;
 	mpf_engine_t *media_engine;
 	unsigned long realtime_rate = 1;
+	apr_size_t thread_count = MPF_ENGINE_DEFAULT_THREAD_COUNT;
+	int priority = 0;
+	int cpu = -1;
+	apt_bool_t topology_arena = FALSE;
+	apt_bool_t offline = FALSE;
+	apr_interval_time_t tick_budget = 0;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Media Engine <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -581,6 +662,36 @@ static apt_bool_t unimrcp_client_media_engine_load(unimrcp_client_loader_t *load
 				realtime_rate = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"thread-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				thread_count = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"realtime-priority") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				priority = atoi(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"cpu-affinity") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				cpu = atoi(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"topology-arena") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				topology_arena = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"offline") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				offline = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"tick-budget") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				tick_budget = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -588,7 +699,13 @@ static apt_bool_t unimrcp_client_media_engine_load(unimrcp_client_loader_t *load
 
 	media_engine = mpf_engine_create(id,loader->pool);
 	if(media_engine) {
+		mpf_engine_thread_count_set(media_engine,thread_count);
 		mpf_engine_scheduler_rate_set(media_engine,realtime_rate);
+		mpf_engine_scheduler_priority_set(media_engine,priority);
+		mpf_engine_scheduler_cpu_affinity_set(media_engine,cpu);
+		mpf_engine_topology_arena_set(media_engine,topology_arena);
+		mpf_engine_offline_set(media_engine,offline);
+		mpf_engine_tick_budget_set(media_engine,tick_budget);
 	}
 	return mrcp_client_media_engine_register(loader->client,media_engine);
 }
@@ -625,6 +742,16 @@ static apt_bool_t unimrcp_client_rtp_factory_load(unimrcp_client_loader_t *loade
 				rtp_config->rtp_port_max = (apr_port_t)atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"rtp-port-random") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				rtp_config->rtp_port_random = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"rtp-shared-sockets") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				rtp_config->shared_socket_count = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -780,6 +907,16 @@ static apt_bool_t unimrcp_client_jb_settings_load(unimrcp_client_loader_t *loade
 				jb->time_skew_detection = (apr_byte_t) atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"concealment") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				jb->concealment = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"low-latency") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				jb->low_latency = (apr_byte_t) atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -859,6 +996,29 @@ static apt_bool_t unimrcp_client_rtp_settings_load(unimrcp_client_loader_t *load
 		else if(strcasecmp(elem->name,"rtcp") == 0) {
 			unimrcp_client_rtcp_settings_load(loader,rtp_settings,elem);
 		}
+		else if(strcasecmp(elem->name,"flight-recorder") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				rtp_settings->flight_recorder_size = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"tx-impairment") == 0) {
+			const apr_xml_attr *attr;
+			for(attr = elem->attr; attr; attr = attr->next) {
+				if(strcasecmp(attr->name,"loss") == 0) {
+					/* percent, kept per 10000 */
+					double loss = atof(attr->value);
+					if(loss < 0) loss = 0;
+					if(loss > 100) loss = 100;
+					rtp_settings->tx_impairment.loss_rate = (apr_uint16_t)(loss * 100 + 0.5);
+				}
+				else if(strcasecmp(attr->name,"jitter") == 0) {
+					rtp_settings->tx_impairment.jitter = (apr_uint16_t)atol(attr->value);
+				}
+				else {
+					apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+				}
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -1082,6 +1242,20 @@ static apt_bool_t unimrcp_client_properties_load(unimrcp_client_loader_t *loader
 			loader->server_ip = unimrcp_client_ip_address_get(loader,elem,DEFAULT_IP_ADDRESS);
 			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property server-ip:%s",loader->server_ip);
 		}
+		else if(strcasecmp(elem->name,"session-shards") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				apr_size_t count = atol(cdata_text_get(elem));
+				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property session-shards:%"APR_SIZE_T_FMT,count);
+				mrcp_client_session_shards_set(loader->client,count);
+			}
+		}
+		else if(strcasecmp(elem->name,"callback-threads") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				apr_size_t count = atol(cdata_text_get(elem));
+				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property callback-threads:%"APR_SIZE_T_FMT,count);
+				mrcp_client_callback_threads_set(loader->client,count);
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <apr_strings.h>
 #include <apr_xml.h>
 #include <apr_version.h>
 #include "uni_version.h"
@@ -29,10 +30,17 @@
 #include "mrcp_unirtsp_server_agent.h"
 #include "mrcp_unirtsp_logger.h"
 #include "mrcp_server_connection.h"
+#include "mrcp_server_admission.h"
+#include "mrcp_server_cluster.h"
+#include "mrcp_message_trace.h"
+#include "mrcp_body_store.h"
 #include "apt_net.h"
+#include "apt_handoff.h"
+#include "apt_xml_cache.h"
 #include "apt_log.h"
 
 #define CONF_FILE_NAME            "unimrcpserver.xml"
+#define CONF_CACHE_FILE_NAME      "unimrcpserver.xml.cache"
 #ifdef WIN32
 #define DEFAULT_PLUGIN_EXT        "dll"
 #else
@@ -49,8 +57,6 @@
 #define DEFAULT_SOFIASIP_UA_NAME  "UniMRCP SofiaSIP"
 #define DEFAULT_SDP_ORIGIN        "UniMRCPServer"
 
-#define XML_FILE_BUFFER_LENGTH    16000
-
 /** UniMRCP server loader */
 typedef struct unimrcp_server_loader_t unimrcp_server_loader_t;
 
@@ -183,6 +189,31 @@ static apt_bool_t header_attribs_get(const apr_xml_elem *elem, const apr_xml_att
 	return TRUE;
 }
 
+/** Load optional "cpu-set", "priority" and "allocator-max-free" attributes of the element into the task */
+static apt_bool_t task_attribs_load(const apr_xml_elem *elem, apt_task_t *task)
+{
+	const apr_xml_attr *attr;
+	if(!task) {
+		return FALSE;
+	}
+
+	for(attr = elem->attr; attr; attr = attr->next) {
+		if(strcasecmp(attr->name,"cpu-set") == 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Set CPU Set <%s> [%s]",elem->name,attr->value);
+			apt_task_affinity_set(task,attr->value);
+		}
+		else if(strcasecmp(attr->name,"priority") == 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Set Priority <%s> [%s]",elem->name,attr->value);
+			apt_task_priority_set(task,atoi(attr->value));
+		}
+		else if(strcasecmp(attr->name,"allocator-max-free") == 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Set Allocator Max Free <%s> [%s]",elem->name,attr->value);
+			apt_task_allocator_enable(task,(apr_size_t)apr_atoi64(attr->value));
+		}
+	}
+	return TRUE;
+}
+
 /** Get generic "name" and "value" attributes */
 static apt_bool_t name_value_attribs_get(const apr_xml_elem *elem, const apr_xml_attr **name, const apr_xml_attr **value)
 {
@@ -374,6 +405,11 @@ static apt_bool_t unimrcp_server_sip_uas_load(unimrcp_server_loader_t *loader, c
 				config->min_session_expires = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"sip-threads") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				config->thread_count = atol(cdata_text_get(elem));
+			}
+		}
 		else if(strcasecmp(elem->name,"sip-message-output") == 0) {
 			if(is_cdata_valid(elem) == TRUE) {
 				config->tport_log = cdata_bool_get(elem);
@@ -428,6 +464,9 @@ static apt_bool_t unimrcp_server_sip_uas_load(unimrcp_server_loader_t *loader, c
 	}
 
 	agent = mrcp_sofiasip_server_agent_create(id,config,loader->pool);
+	if(agent) {
+		task_attribs_load(root,agent->task);
+	}
 	return mrcp_server_signaling_agent_register(loader->server,agent);
 }
 
@@ -462,6 +501,11 @@ static apt_bool_t unimrcp_server_rtsp_uas_load(unimrcp_server_loader_t *loader,
 				config->max_connection_count = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"thread-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				config->thread_count = atol(cdata_text_get(elem));
+			}
+		}
 		else if(strcasecmp(elem->name,"force-destination") == 0) {
 			if(is_cdata_valid(elem) == TRUE) {
 				config->force_destination = cdata_bool_get(elem);
@@ -495,6 +539,9 @@ static apt_bool_t unimrcp_server_rtsp_uas_load(unimrcp_server_loader_t *loader,
 	}
 
 	agent = mrcp_unirtsp_server_agent_create(id,config,loader->pool);
+	if(agent) {
+		task_attribs_load(root,agent->task);
+	}
 	return mrcp_server_signaling_agent_register(loader->server,agent);
 }
 
@@ -508,10 +555,15 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 	apr_size_t max_connection_count = 100;
 	apr_size_t max_shared_use_count = 100;
 	apt_bool_t force_new_connection = FALSE;
+	apt_bool_t lazy_header_parsing = FALSE;
+	apt_bool_t body_interning = FALSE;
+	apr_size_t cork_window = 0; /* usec */
 	apr_size_t inactivity_timeout = 600; /* sec */
 	apr_size_t termination_timeout = 3; /* sec */
 	apr_size_t rx_buffer_size = 0;
 	apr_size_t tx_buffer_size = 0;
+	apr_size_t thread_count = 1;
+	apr_size_t i;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading MRCPv2 Agent <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -559,6 +611,26 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 				tx_buffer_size = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"thread-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				thread_count = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"lazy-header-parsing") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				lazy_header_parsing = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"body-interning") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				body_interning = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"cork-window") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				cork_window = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -569,7 +641,7 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 		mrcp_ip = apr_pstrdup(loader->pool,loader->ip);
 	}
 
-	agent = mrcp_server_connection_agent_create(id,mrcp_ip,mrcp_port,max_connection_count,force_new_connection,loader->pool);
+	agent = mrcp_server_connection_agent_create_ex(id,mrcp_ip,mrcp_port,max_connection_count,force_new_connection,thread_count,loader->pool);
 	if(agent) {
 		if(rx_buffer_size) {
 			mrcp_server_connection_rx_size_set(agent,rx_buffer_size);
@@ -580,6 +652,15 @@ static apt_bool_t unimrcp_server_mrcpv2_uas_load(unimrcp_server_loader_t *loader
 		mrcp_server_connection_max_shared_use_set(agent,max_shared_use_count);
 		mrcp_server_connection_timeout_set(agent,inactivity_timeout);
 		mrcp_server_connection_term_timeout_set(agent,termination_timeout);
+		mrcp_server_connection_lazy_parse_set(agent,lazy_header_parsing);
+		if(body_interning == TRUE &&
+			mrcp_server_connection_body_interning_set(agent,MRCP_BODY_STORE_DEFAULT_MIN_SIZE,MRCP_BODY_STORE_DEFAULT_MAX_SIZE) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Body Store [%s]",id);
+		}
+		mrcp_server_connection_cork_window_set(agent,cork_window);
+		for(i=0; i<mrcp_server_connection_agent_thread_count_get(agent); i++) {
+			task_attribs_load(root,mrcp_server_connection_agent_thread_task_get(agent,i));
+		}
 	}
 	return mrcp_server_connection_agent_register(loader->server,agent);
 }
@@ -590,6 +671,12 @@ static apt_bool_t unimrcp_server_media_engine_load(unimrcp_server_loader_t *load
 	const apr_xml_elem *elem;
 	mpf_engine_t *media_engine;
 	unsigned long realtime_rate = 1;
+	apr_size_t thread_count = MPF_ENGINE_DEFAULT_THREAD_COUNT;
+	int priority = 0;
+	int cpu = -1;
+	apt_bool_t topology_arena = FALSE;
+	apt_bool_t offline = FALSE;
+	apr_interval_time_t tick_budget = 0;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Media Engine <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -599,6 +686,36 @@ static apt_bool_t unimrcp_server_media_engine_load(unimrcp_server_loader_t *load
 				realtime_rate = atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"thread-count") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				thread_count = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"realtime-priority") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				priority = atoi(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"cpu-affinity") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				cpu = atoi(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"topology-arena") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				topology_arena = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"offline") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				offline = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"tick-budget") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				tick_budget = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -606,7 +723,15 @@ static apt_bool_t unimrcp_server_media_engine_load(unimrcp_server_loader_t *load
 
 	media_engine = mpf_engine_create(id,loader->pool);
 	if(media_engine) {
+		mpf_engine_thread_count_set(media_engine,thread_count);
 		mpf_engine_scheduler_rate_set(media_engine,realtime_rate);
+		mpf_engine_scheduler_priority_set(media_engine,priority);
+		mpf_engine_scheduler_cpu_affinity_set(media_engine,cpu);
+		mpf_engine_topology_arena_set(media_engine,topology_arena);
+		mpf_engine_offline_set(media_engine,offline);
+		mpf_engine_tick_budget_set(media_engine,tick_budget);
+		/* the attributes take precedence over the elements above */
+		task_attribs_load(root,mpf_task_get(media_engine));
 	}
 	return mrcp_server_media_engine_register(loader->server,media_engine);
 }
@@ -643,6 +768,16 @@ static apt_bool_t unimrcp_server_rtp_factory_load(unimrcp_server_loader_t *loade
 				rtp_config->rtp_port_max = (apr_port_t)atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"rtp-port-random") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				rtp_config->rtp_port_random = cdata_bool_get(elem);
+			}
+		}
+		else if(strcasecmp(elem->name,"rtp-shared-sockets") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				rtp_config->shared_socket_count = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -675,6 +810,8 @@ static apt_bool_t unimrcp_server_plugin_load(unimrcp_server_loader_t *loader, co
 	const char *plugin_id = NULL;
 	const char *plugin_name = NULL;
 	const char *plugin_ext = NULL;
+	const char *cpu_set = NULL;
+	int priority = 0;
 	apt_bool_t plugin_enabled = TRUE;
 	const apr_xml_attr *attr;
 	for(attr = root->attr; attr; attr = attr->next) {
@@ -690,6 +827,12 @@ static apt_bool_t unimrcp_server_plugin_load(unimrcp_server_loader_t *loader, co
 		else if(strcasecmp(attr->name,"enable") == 0) {
 			plugin_enabled = is_attr_enabled(attr);
 		}
+		else if(strcasecmp(attr->name,"cpu-set") == 0) {
+			cpu_set = apr_pstrdup(loader->pool,attr->value);
+		}
+		else if(strcasecmp(attr->name,"priority") == 0) {
+			priority = atoi(attr->value);
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
 		}
@@ -717,6 +860,8 @@ static apt_bool_t unimrcp_server_plugin_load(unimrcp_server_loader_t *loader, co
 	}
 
 	config = mrcp_engine_config_alloc(loader->pool);
+	config->cpu_set = cpu_set;
+	config->priority = priority;
 
 	/* load optional named and generic name/value params */
 	if(root->first_child){
@@ -731,6 +876,11 @@ static apt_bool_t unimrcp_server_plugin_load(unimrcp_server_loader_t *loader, co
 					config->max_channel_count = atol(cdata_text_get(elem));
 				}
 			}
+			else if(strcasecmp(elem->name,"max-memory-size") == 0) {
+				if(is_cdata_valid(elem) == TRUE) {
+					config->max_memory_size = (apr_size_t)apr_atoi64(cdata_text_get(elem));
+				}
+			}
 			else if(strcasecmp(elem->name,"param") == 0) {
 				if(name_value_attribs_get(elem,&attr_name,&attr_value) == TRUE) {
 					apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Param %s:%s",attr_name->value,attr_value->value);
@@ -795,6 +945,16 @@ static apt_bool_t unimrcp_server_jb_settings_load(unimrcp_server_loader_t *loade
 				jb->time_skew_detection = (apr_byte_t) atol(cdata_text_get(elem));
 			}
 		}
+		else if(strcasecmp(elem->name,"concealment") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				jb->concealment = atol(cdata_text_get(elem));
+			}
+		}
+		else if(strcasecmp(elem->name,"low-latency") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				jb->low_latency = (apr_byte_t) atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -881,6 +1041,11 @@ static apt_bool_t unimrcp_server_rtp_settings_load(unimrcp_server_loader_t *load
 		else if(strcasecmp(elem->name,"rtcp") == 0) {
 			unimrcp_server_rtcp_settings_load(loader,rtp_settings,elem);
 		}
+		else if(strcasecmp(elem->name,"flight-recorder") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				rtp_settings->flight_recorder_size = atol(cdata_text_get(elem));
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -969,13 +1134,16 @@ static apr_hash_t* resource_engine_map_load(const apr_xml_elem *root, apr_pool_t
 static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root, const char *id)
 {
 	const apr_xml_elem *elem;
+	int i;
 	mrcp_server_profile_t *profile;
 	mrcp_sig_agent_t *sip_agent = NULL;
 	mrcp_connection_agent_t *mrcpv2_agent = NULL;
 	mpf_engine_t *media_engine = NULL;
+	apr_array_header_t *media_engines = apr_array_make(loader->pool,1,sizeof(mpf_engine_t*));
 	mpf_termination_factory_t *rtp_factory = NULL;
 	mpf_rtp_settings_t *rtp_settings = NULL;
 	apr_hash_t *resource_engine_map = NULL;
+	apt_bool_t barge_in_link = FALSE;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading MRCPv2 Profile <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -992,7 +1160,14 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 			mrcpv2_agent = mrcp_server_connection_agent_get(loader->server,cdata_text_get(elem));
 		}
 		else if(strcasecmp(elem->name,"media-engine") == 0) {
+			/* each media engine listed is added to the pool of the profile */
 			media_engine = mrcp_server_media_engine_get(loader->server,cdata_text_get(elem));
+			if(media_engine) {
+				APR_ARRAY_PUSH(media_engines,mpf_engine_t*) = media_engine;
+			}
+			else {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Such Media Engine <%s>",cdata_text_get(elem));
+			}
 		}
 		else if(strcasecmp(elem->name,"rtp-factory") == 0) {
 			rtp_factory = mrcp_server_rtp_factory_get(loader->server,cdata_text_get(elem));
@@ -1003,6 +1178,9 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 		else if(strcasecmp(elem->name,"resource-engine-map") == 0) {
 			resource_engine_map = resource_engine_map_load(elem,loader->pool);
 		}
+		else if(strcasecmp(elem->name,"barge-in-link") == 0) {
+			barge_in_link = cdata_bool_get(elem);
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -1015,10 +1193,14 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 				NULL,
 				sip_agent,
 				mrcpv2_agent,
-				media_engine,
+				media_engines->nelts ? APR_ARRAY_IDX(media_engines,0,mpf_engine_t*) : NULL,
 				rtp_factory,
 				rtp_settings,
 				loader->pool);
+	for(i=1; i<media_engines->nelts; i++) {
+		mrcp_server_profile_media_engine_add(profile,APR_ARRAY_IDX(media_engines,i,mpf_engine_t*),loader->pool);
+	}
+	mrcp_server_profile_barge_in_link_set(profile,barge_in_link);
 	return mrcp_server_profile_register(loader->server,profile,resource_engine_map);
 }
 
@@ -1026,12 +1208,15 @@ static apt_bool_t unimrcp_server_mrcpv2_profile_load(unimrcp_server_loader_t *lo
 static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root, const char *id)
 {
 	const apr_xml_elem *elem;
+	int i;
 	mrcp_server_profile_t *profile;
 	mrcp_sig_agent_t *rtsp_agent = NULL;
 	mpf_engine_t *media_engine = NULL;
+	apr_array_header_t *media_engines = apr_array_make(loader->pool,1,sizeof(mpf_engine_t*));
 	mpf_termination_factory_t *rtp_factory = NULL;
 	mpf_rtp_settings_t *rtp_settings = NULL;
 	apr_hash_t *resource_engine_map = NULL;
+	apt_bool_t barge_in_link = FALSE;
 
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading MRCPv1 Profile <%s>",id);
 	for(elem = root->first_child; elem; elem = elem->next) {
@@ -1045,7 +1230,14 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 			rtsp_agent = mrcp_server_signaling_agent_get(loader->server,cdata_text_get(elem));
 		}
 		else if(strcasecmp(elem->name,"media-engine") == 0) {
+			/* each media engine listed is added to the pool of the profile */
 			media_engine = mrcp_server_media_engine_get(loader->server,cdata_text_get(elem));
+			if(media_engine) {
+				APR_ARRAY_PUSH(media_engines,mpf_engine_t*) = media_engine;
+			}
+			else {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Such Media Engine <%s>",cdata_text_get(elem));
+			}
 		}
 		else if(strcasecmp(elem->name,"rtp-factory") == 0) {
 			rtp_factory = mrcp_server_rtp_factory_get(loader->server,cdata_text_get(elem));
@@ -1056,6 +1248,9 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 		else if(strcasecmp(elem->name,"resource-engine-map") == 0) {
 			resource_engine_map = resource_engine_map_load(elem,loader->pool);
 		}
+		else if(strcasecmp(elem->name,"barge-in-link") == 0) {
+			barge_in_link = cdata_bool_get(elem);
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -1068,14 +1263,271 @@ static apt_bool_t unimrcp_server_mrcpv1_profile_load(unimrcp_server_loader_t *lo
 				NULL,
 				rtsp_agent,
 				NULL,
-				media_engine,
+				media_engines->nelts ? APR_ARRAY_IDX(media_engines,0,mpf_engine_t*) : NULL,
 				rtp_factory,
 				rtp_settings,
 				loader->pool);
+	for(i=1; i<media_engines->nelts; i++) {
+		mrcp_server_profile_media_engine_add(profile,APR_ARRAY_IDX(media_engines,i,mpf_engine_t*),loader->pool);
+	}
+	mrcp_server_profile_barge_in_link_set(profile,barge_in_link);
 	return mrcp_server_profile_register(loader->server,profile,resource_engine_map);
 }
 
 
+/** Load admission control */
+static apt_bool_t unimrcp_server_admission_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	mrcp_admission_settings_t *settings = mrcp_admission_settings_alloc(loader->pool);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Admission Control");
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"channel-usage") == 0) {
+			settings->channel_usage = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"late-tick-rate") == 0) {
+			settings->late_tick_rate = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"engine-backlog") == 0) {
+			settings->engine_backlog = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"sampling-interval") == 0) {
+			settings->sampling_interval = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"retry-after") == 0) {
+			settings->retry_after = atol(attr->value);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+	return mrcp_server_admission_register(loader->server,settings);
+}
+
+/** Load cluster */
+static apt_bool_t unimrcp_server_cluster_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	const apr_xml_elem *elem;
+	mrcp_cluster_settings_t *settings = mrcp_cluster_settings_alloc(loader->pool);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Loading Cluster");
+	settings->ip = loader->ip;
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"node-id") == 0) {
+			settings->node_id = apr_pstrdup(loader->pool,attr->value);
+		}
+		else if(strcasecmp(attr->name,"sip-uri") == 0) {
+			settings->sip_uri = apr_pstrdup(loader->pool,attr->value);
+		}
+		else if(strcasecmp(attr->name,"ip") == 0) {
+			settings->ip = apr_pstrdup(loader->pool,attr->value);
+		}
+		else if(strcasecmp(attr->name,"port") == 0) {
+			settings->port = (apr_port_t)atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"interval") == 0) {
+			settings->interval = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"redirect-usage") == 0) {
+			settings->redirect_usage = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"max-rtf") == 0) {
+			settings->max_rtf = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"margin") == 0) {
+			settings->margin = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"retry-after") == 0) {
+			settings->retry_after = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"secret") == 0) {
+			settings->secret = apr_pstrdup(loader->pool,attr->value);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+	for(elem = root->first_child; elem; elem = elem->next) {
+		if(strcasecmp(elem->name,"peer") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				APR_ARRAY_PUSH(settings->peers,const char*) = cdata_copy(elem,loader->pool);
+			}
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
+		}
+	}
+	return mrcp_server_cluster_register(loader->server,settings);
+}
+
+/** Load metrics export */
+static apt_bool_t unimrcp_server_metrics_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	const char *path = "unimrcpserver.prom";
+	const char *root_path;
+	apr_size_t interval = 0;
+
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"file") == 0) {
+			path = attr->value;
+		}
+		else if(strcasecmp(attr->name,"interval") == 0) {
+			interval = atol(attr->value);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+
+	if(loader->dir_layout && apr_filepath_root(&root_path,&path,0,loader->pool) == APR_ERELATIVE) {
+		path = apt_dir_layout_path_compose(loader->dir_layout,APT_LAYOUT_VAR_DIR,path,loader->pool);
+	}
+	return mrcp_server_metrics_export_set(loader->server,path,interval);
+}
+
+/** Load cache of session pools */
+static apt_bool_t unimrcp_server_session_pool_cache_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	apr_size_t max_count = 100;
+	apr_size_t max_retained_size = 65536;
+
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"max-count") == 0) {
+			max_count = atol(attr->value);
+		}
+		else if(strcasecmp(attr->name,"max-retained-size") == 0) {
+			max_retained_size = atol(attr->value);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+
+	if(!max_count) {
+		return TRUE;
+	}
+	return mrcp_server_session_pool_cache_set(loader->server,max_count,max_retained_size);
+}
+
+/** Load handoff of listening sockets */
+static apt_bool_t unimrcp_server_handoff_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	const char *path = "unimrcpserver.sock";
+	const char *root_path;
+	apt_handoff_t *handoff;
+
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"path") == 0) {
+			path = attr->value;
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+
+	if(loader->dir_layout && apr_filepath_root(&root_path,&path,0,loader->pool) == APR_ERELATIVE) {
+		path = apt_dir_layout_path_compose(loader->dir_layout,APT_LAYOUT_VAR_DIR,path,loader->pool);
+	}
+	handoff = apt_handoff_create(path,loader->pool);
+	if(!handoff) {
+		return FALSE;
+	}
+	/* the listening sockets of the predecessor are taken over by the agents loaded next */
+	apt_handoff_receive(handoff);
+	apt_handoff_instance_set(handoff);
+	return mrcp_server_handoff_set(loader->server,handoff);
+}
+
+/** Load accounting of memory held by sessions */
+static apt_bool_t unimrcp_server_mem_accounting_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	apr_size_t max_size = 0;
+	apr_size_t max_session_size = 0;
+
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"max-size") == 0) {
+			max_size = (apr_size_t)apr_atoi64(attr->value);
+		}
+		else if(strcasecmp(attr->name,"max-session-size") == 0) {
+			max_session_size = (apr_size_t)apr_atoi64(attr->value);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+
+	return mrcp_server_mem_accounting_set(loader->server,max_size,max_session_size);
+}
+
+/** Load sampling of verbose logging by session */
+static apt_bool_t unimrcp_server_log_sampling_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
+{
+	const apr_xml_attr *attr;
+	apt_log_priority_e priority = APT_PRIO_NOTICE;
+	double rate = 0;
+	const char *attrib = NULL;
+	const char *value = NULL;
+
+	for(attr = root->attr; attr; attr = attr->next) {
+		if(is_attr_valid(attr) == FALSE) {
+			continue;
+		}
+		if(strcasecmp(attr->name,"priority") == 0) {
+			priority = apt_log_priority_translate(attr->value);
+		}
+		else if(strcasecmp(attr->name,"rate") == 0) {
+			rate = atof(attr->value);
+		}
+		else if(strcasecmp(attr->name,"attrib") == 0) {
+			attrib = attr->value;
+		}
+		else if(strcasecmp(attr->name,"value") == 0) {
+			value = attr->value;
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Attribute <%s>",attr->name);
+		}
+	}
+
+	if(rate < 0) {
+		rate = 0;
+	}
+	else if(rate > 100) {
+		rate = 100;
+	}
+	if(attrib && !value) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Missing Value of Log Sampling Attribute <%s>",attrib);
+		attrib = NULL;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property log-sampling priority:%d rate:%.2f%%",priority,rate);
+	/* percent to the fraction per 10000 */
+	return mrcp_server_log_sampling_set(loader->server,priority,(apr_size_t)(rate * 100 + 0.5),attrib,value);
+}
+
 /** Load properties */
 static apt_bool_t unimrcp_server_properties_load(unimrcp_server_loader_t *loader, const apr_xml_elem *root)
 {
@@ -1092,6 +1544,41 @@ static apt_bool_t unimrcp_server_properties_load(unimrcp_server_loader_t *loader
 			loader->ext_ip = unimrcp_server_ip_address_get(loader,elem);
 			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property ext-ip:%s",loader->ext_ip);
 		}
+		else if(strcasecmp(elem->name,"session-shards") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				apr_size_t count = atol(cdata_text_get(elem));
+				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property session-shards:%"APR_SIZE_T_FMT,count);
+				mrcp_server_session_shards_set(loader->server,count);
+			}
+		}
+		else if(strcasecmp(elem->name,"admission-control") == 0) {
+			unimrcp_server_admission_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"cluster") == 0) {
+			unimrcp_server_cluster_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"metrics") == 0) {
+			unimrcp_server_metrics_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"session-pool-cache") == 0) {
+			unimrcp_server_session_pool_cache_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"handoff") == 0) {
+			unimrcp_server_handoff_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"memory-accounting") == 0) {
+			unimrcp_server_mem_accounting_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"log-sampling") == 0) {
+			unimrcp_server_log_sampling_load(loader,elem);
+		}
+		else if(strcasecmp(elem->name,"request-tracing") == 0) {
+			if(is_cdata_valid(elem) == TRUE) {
+				apt_bool_t enable = cdata_bool_get(elem);
+				apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Set Property request-tracing:%s",enable == TRUE ? "true" : "false");
+				mrcp_message_trace_enable(enable);
+			}
+		}
 		else {
 			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Element <%s>",elem->name);
 		}
@@ -1265,29 +1752,13 @@ static apt_bool_t unimrcp_server_misc_load(unimrcp_server_loader_t *loader, cons
 	return TRUE;
 }
 
-/** Parse XML document */
-static apr_xml_doc* unimrcp_server_doc_parse(const char *file_path, apr_pool_t *pool)
+/** Parse XML document, or read it back from the cache of the previous start */
+static apr_xml_doc* unimrcp_server_doc_parse(const char *file_path, apt_dir_layout_t *dir_layout, apr_pool_t *pool)
 {
-	apr_xml_parser *parser = NULL;
-	apr_xml_doc *xml_doc = NULL;
-	apr_file_t *fd = NULL;
-	apr_status_t rv;
-
+	/* the cache is kept in the var dir, it is refreshed once the config file is modified */
+	const char *cache_path = apt_vardir_filepath_get(dir_layout,CONF_CACHE_FILE_NAME,pool);
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Open Config File [%s]",file_path);
-	rv = apr_file_open(&fd,file_path,APR_READ|APR_BINARY,0,pool);
-	if(rv != APR_SUCCESS) {
-		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Config File [%s]",file_path);
-		return NULL;
-	}
-
-	rv = apr_xml_parse_file(pool,&parser,&xml_doc,fd,XML_FILE_BUFFER_LENGTH);
-	if(rv != APR_SUCCESS) {
-		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Config File [%s]",file_path);
-		xml_doc = NULL;
-	}
-
-	apr_file_close(fd);
-	return xml_doc;
+	return apt_xml_doc_load(file_path,cache_path,pool);
 }
 
 static apt_bool_t unimrcp_server_load(mrcp_server_t *mrcp_server, apt_dir_layout_t *dir_layout, apr_pool_t *pool)
@@ -1307,7 +1778,7 @@ static apt_bool_t unimrcp_server_load(mrcp_server_t *mrcp_server, apt_dir_layout
 	}
 
 	/* Parse XML document */
-	doc = unimrcp_server_doc_parse(file_path,pool);
+	doc = unimrcp_server_doc_parse(file_path,dir_layout,pool);
 	if(!doc) {
 		return FALSE;
 	}
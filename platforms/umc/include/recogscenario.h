@@ -79,6 +79,8 @@ inline apr_size_t RecogScenario::GetContentLength() const
 
 inline const char* RecogScenario::GetAudioSource() const
 {
+	if(m_pAudioCorpus)
+		return GetAudioCorpusFile();
 	return m_AudioSource;
 }
 
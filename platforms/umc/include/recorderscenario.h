@@ -55,6 +55,8 @@ protected:
 /* ============================ INLINE METHODS ============================= */
 inline const char* RecorderScenario::GetAudioSource() const
 {
+	if(m_pAudioCorpus)
+		return GetAudioCorpusFile();
 	return m_AudioSource;
 }
 
@@ -26,10 +26,11 @@
 #include <apr_hash.h>
 #include "apt_consumer_task.h"
 #include "umcsession.h"
+#include "umcloadgenerator.h"
 
 class UmcScenario;
 
-class UmcFramework : public UmcSessionMethodProvider
+class UmcFramework : public UmcSessionMethodProvider, public UmcLoadMethodProvider
 {
 public:
 /* ============================ CREATORS =================================== */
@@ -47,6 +48,10 @@ public:
 	void ShowScenarios();
 	void ShowSessions();
 
+	void StartLoad(apr_size_t cps, apr_size_t concurrency, apr_size_t count, const char* pMix, const char* pProfileName);
+	void StopLoad();
+	void ShowLoad();
+
 protected:
 	bool CreateMrcpClient();
 	void DestroyMrcpClient();
@@ -66,6 +71,13 @@ protected:
 	void ProcessShowScenarios();
 	void ProcessShowSessions();
 	void ProcessSessionExit(UmcSession* pUmcSession);
+	bool ProcessStartLoadRequest(apr_size_t cps, apr_size_t concurrency, apr_size_t count, const char* pMix, const char* pProfileName);
+	void ProcessStopLoadRequest();
+	void ProcessShowLoad();
+	void ProcessLoadTick();
+
+	UmcSession* RunScenarioSession(UmcScenario* pScenario, const char* pProfileName);
+	UmcSession* LaunchSession(UmcScenario* pScenario, const char* pProfileName);
 
 	bool AddSession(UmcSession* pSession);
 	bool RemoveSession(UmcSession* pSession);
@@ -77,6 +89,7 @@ protected:
 	friend apt_bool_t UmcProcessMsg(apt_task_t* pTask, apt_task_msg_t* pMsg);
 	friend void UmcOnStartComplete(apt_task_t* pTask);
 	friend void UmcOnTerminateComplete(apt_task_t* pTask);
+	friend void UmcLoadTimerProc(apt_timer_t* pTimer, void* pObj);
 	friend apt_bool_t AppMessageHandler(const mrcp_app_message_t* pAppMessage);
 
 private:
@@ -90,6 +103,9 @@ private:
 
 	apr_hash_t*          m_pScenarioTable;
 	apr_hash_t*          m_pSessionTable;
+
+	UmcLoadGenerator*    m_pLoadGenerator;
+	apt_timer_t*         m_pLoadTimer;
 };
 
 #endif /* UMC_FRAMEWORK_H */
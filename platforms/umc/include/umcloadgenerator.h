@@ -0,0 +1,126 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UMC_LOAD_GENERATOR_H
+#define UMC_LOAD_GENERATOR_H
+
+/**
+ * @file umcloadgenerator.h
+ * @brief UMC Load Generator
+ *
+ * Sessions of a weighted mix of scenarios are launched at a target rate (CPS),
+ * up to a max number of concurrent sessions. The latencies of the sessions
+ * are summarized in histograms: setup (till the channel is added), and
+ * START-OF-INPUT and COMPLETE events (since the channel is added).
+ */
+
+#include <apr_tables.h>
+#include "apt_histogram.h"
+
+class UmcScenario;
+class UmcSession;
+
+/** Interval (msec) sessions are launched at */
+#define UMC_LOAD_TICK_INTERVAL 10
+
+class UmcLoadMethodProvider
+{
+public:
+/* ============================ CREATORS =================================== */
+	virtual ~UmcLoadMethodProvider() {}
+
+/* ============================ MANIPULATORS =============================== */
+	virtual UmcSession* LaunchSession(UmcScenario* pScenario, const char* pProfileName) = 0;
+};
+
+class UmcLoadGenerator
+{
+public:
+/* ============================ CREATORS =================================== */
+	UmcLoadGenerator(UmcLoadMethodProvider* pMethodProvider);
+	~UmcLoadGenerator();
+
+/* ============================ MANIPULATORS =============================== */
+	bool Create(apr_size_t cps, apr_size_t concurrency, apr_size_t count, const char* pProfileName);
+	bool AddScenario(UmcScenario* pScenario, apr_size_t weight);
+	void Destroy();
+
+	bool Start();
+	void Stop();
+
+	void OnTick();
+	void OnSessionExit(const UmcSession* pSession);
+
+	void ShowSummary() const;
+
+/* ============================ INQUIRIES ================================== */
+	bool IsRunning() const;
+	bool IsComplete() const;
+
+protected:
+/* ============================ MANIPULATORS =============================== */
+	UmcScenario* PickScenario();
+
+	void ShowHistogram(const char* pName, const apt_histogram_t* pHistogram) const;
+
+private:
+/* ============================ DATA ======================================= */
+	struct MixEntry
+	{
+		UmcScenario* m_pScenario;
+		apr_size_t   m_Weight;
+		apr_int64_t  m_Current;
+	};
+
+	UmcLoadMethodProvider* m_pMethodProvider;
+	apr_pool_t*            m_pPool;
+
+	apr_size_t             m_Cps;
+	apr_size_t             m_Concurrency;
+	apr_size_t             m_Count;
+	const char*            m_pProfileName;
+	apr_array_header_t*    m_pMix;
+	apr_size_t             m_TotalWeight;
+
+	bool                   m_Running;
+	apr_time_t             m_StartTime;
+	apr_time_t             m_StopTime;
+
+	apr_size_t             m_Scheduled;
+	apr_size_t             m_Launched;
+	apr_size_t             m_Throttled;
+	apr_size_t             m_Active;
+	apr_size_t             m_Completed;
+	apr_size_t             m_Failed;
+
+	apt_histogram_t*       m_pSetupHistogram;
+	apt_histogram_t*       m_pInputHistogram;
+	apt_histogram_t*       m_pCompleteHistogram;
+	apt_histogram_t*       m_pSessionHistogram;
+};
+
+/* ============================ INLINE METHODS ============================= */
+inline bool UmcLoadGenerator::IsRunning() const
+{
+	return m_Running;
+}
+
+inline bool UmcLoadGenerator::IsComplete() const
+{
+	return !m_Running && m_StartTime && !m_Active;
+}
+
+#endif /* UMC_LOAD_GENERATOR_H */
@@ -23,6 +23,7 @@
  */ 
 
 #include <apr_xml.h>
+#include <apr_tables.h>
 #include "mrcp_application.h"
 
 class UmcSession;
@@ -50,6 +51,7 @@ public:
 	apt_dir_layout_t* GetDirLayout() const;
 	const char* GetName() const;
 	const char* GetMrcpProfile() const;
+	const char* GetAudioCorpusFile() const;
 
 /* ============================ INQUIRIES ================================== */
 	bool IsDiscoveryEnabled() const;
@@ -62,6 +64,7 @@ protected:
 	bool LoadTermination(const apr_xml_elem* pElem, apr_pool_t* pool);
 	bool LoadCapabilities(const apr_xml_elem* pElem, apr_pool_t* pool);
 	bool LoadRtpTermination(const apr_xml_elem* pElem, apr_pool_t* pool);
+	bool LoadAudioCorpus(const char* pPattern, apr_pool_t* pool);
 
 	const char* LoadFileContent(const char* pFileName, apr_size_t& size, apr_pool_t* pool) const;
 	static int ParseRates(const char* pStr, apr_pool_t* pool);
@@ -77,6 +80,10 @@ protected:
 	bool                              m_ResourceDiscovery;
 	mpf_codec_capabilities_t*         m_pCapabilities;
 	mpf_rtp_termination_descriptor_t* m_pRtpDescriptor;
+
+	/** Files of the data dir matching the audio source pattern, streamed in turn */
+	apr_array_header_t*               m_pAudioCorpus;
+	mutable int                       m_AudioCorpusIndex;
 };
 
 
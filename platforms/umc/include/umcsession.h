@@ -69,12 +69,25 @@ public:
 	void SetMrcpProfile(const char* pMrcpProfile);
 	void SetMrcpApplication(mrcp_application_t* pMrcpApplication);
 	void SetMethodProvider(UmcSessionMethodProvider* pMethodProvider);
+	void SetLoadGenerated(bool loadGenerated);
 
 	const UmcScenario* GetScenario() const;
 	apr_pool_t* GetSessionPool() const;
 
 	const char* GetId() const;
 
+	/** Get the time the session is run at */
+	apr_time_t GetStartTime() const;
+	/** Get the time the channel is added at (0 if not yet) */
+	apr_time_t GetSetupTime() const;
+	/** Get the time START-OF-INPUT is received at (0 if not yet) */
+	apr_time_t GetInputTime() const;
+	/** Get the time the request is complete at (0 if not yet) */
+	apr_time_t GetCompleteTime() const;
+
+/* ============================ INQUIRIES ================================== */
+	bool IsLoadGenerated() const;
+
 protected:
 /* ============================ MANIPULATORS =============================== */
 	virtual bool Start() = 0;
@@ -127,6 +140,12 @@ private:
 	mrcp_message_t*             m_pMrcpMessage; /* last message sent */
 	bool                        m_Running;
 	bool                        m_Terminating;
+	bool                        m_LoadGenerated;
+
+	apr_time_t                  m_StartTime;
+	apr_time_t                  m_SetupTime;
+	apr_time_t                  m_InputTime;
+	apr_time_t                  m_CompleteTime;
 };
 
 /* ============================ INLINE METHODS ============================= */
@@ -166,4 +185,34 @@ inline mrcp_message_t* UmcSession::GetMrcpMessage() const
 	return m_pMrcpMessage;
 }
 
+inline void UmcSession::SetLoadGenerated(bool loadGenerated)
+{
+	m_LoadGenerated = loadGenerated;
+}
+
+inline bool UmcSession::IsLoadGenerated() const
+{
+	return m_LoadGenerated;
+}
+
+inline apr_time_t UmcSession::GetStartTime() const
+{
+	return m_StartTime;
+}
+
+inline apr_time_t UmcSession::GetSetupTime() const
+{
+	return m_SetupTime;
+}
+
+inline apr_time_t UmcSession::GetInputTime() const
+{
+	return m_InputTime;
+}
+
+inline apr_time_t UmcSession::GetCompleteTime() const
+{
+	return m_CompleteTime;
+}
+
 #endif /* UMC_SESSION_H */
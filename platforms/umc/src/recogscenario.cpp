@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <apr_fnmatch.h>
 #include "recogscenario.h"
 #include "recogsession.h"
 #include "mrcp_message.h"
@@ -80,6 +81,8 @@ bool RecogScenario::LoadRecognize(const apr_xml_elem* pElem, apr_pool_t* pool)
 		else if(strcasecmp(pAttr->name,"audio-source") == 0)
 		{
 			m_AudioSource = pAttr->value;
+			if(apr_fnmatch_test(m_AudioSource))
+				LoadAudioCorpus(m_AudioSource,pool);
 		}
 	}
 
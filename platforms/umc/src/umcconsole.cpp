@@ -177,6 +177,34 @@ bool UmcConsole::ProcessCmdLine(char* pCmdLine)
 				m_pFramework->ShowSessions();
 			else if(strcasecmp(pWhat,"scenarios") == 0)
 				m_pFramework->ShowScenarios();
+			else if(strcasecmp(pWhat,"load") == 0)
+				m_pFramework->ShowLoad();
+		}
+	}
+	else if(strcasecmp(name,"load") == 0)
+	{
+		char* pCps = apr_strtok(NULL, " ", &last);
+		if(pCps) 
+		{
+			if(strcasecmp(pCps,"stop") == 0)
+			{
+				m_pFramework->StopLoad();
+			}
+			else
+			{
+				char* pConcurrency = apr_strtok(NULL, " ", &last);
+				char* pCount = apr_strtok(NULL, " ", &last);
+				char* pMix = apr_strtok(NULL, " ", &last);
+				if(pConcurrency && pCount && pMix)
+				{
+					const char* pProfileName = apr_strtok(NULL, " ", &last);
+					m_pFramework->StartLoad(atol(pCps),atol(pConcurrency),atol(pCount),pMix,pProfileName);
+				}
+				else
+				{
+					printf("usage: load [cps] [concurrency] [count] [mix] [profile] (input help for usage)\n");
+				}
+			}
 		}
 	}
 	else if(strcasecmp(name,"loglevel") == 0) 
@@ -206,10 +234,20 @@ bool UmcConsole::ProcessCmdLine(char* pCmdLine)
 			   "       id is a session identifier: 1, 2, ... (use 'show sessions')\n"
 			   "\n       example: \n"
 			   "           kill 1\n"
-		       "\n- show [what] (show either available scenarios or in-progress sessions)\n"
+		       "\n- load [cps] [concurrency] [count] [mix] [profile] (generate load)\n"
+			   "       cps is the number of sessions launched per second\n"
+			   "       concurrency is the max number of sessions in progress (0 - unlimited)\n"
+			   "       count is the number of sessions to launch (0 - till stopped)\n"
+			   "       mix is a comma-separated list of scenario[:weight]\n"
+			   "\n       examples: \n"
+			   "           load 10 100 1000 recog\n"
+			   "           load 20 200 0 recog:6,synth:3,rec:1 uni1\n"
+			   "           load stop\n"
+		       "\n- show [what] (show either available scenarios, in-progress sessions or load summary)\n"
 			   "\n       examples: \n"
 			   "           show scenarios\n"
 			   "           show sessions\n"
+			   "           show load\n"
 		       "\n- loglevel [level] (set loglevel, one of 0,1...7)\n"
 		       "\n- quit, exit\n");
 	}
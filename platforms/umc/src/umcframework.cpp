@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include <apr_fnmatch.h>
 #include "umcframework.h"
 #include "synthscenario.h"
@@ -30,6 +31,10 @@ typedef struct
 	char                      m_SessionId[10];
 	char                      m_ScenarioName[128];
 	char                      m_ProfileName[128];
+	char                      m_LoadMix[256];
+	apr_size_t                m_Cps;
+	apr_size_t                m_Concurrency;
+	apr_size_t                m_Count;
 	const mrcp_app_message_t* m_pAppMessage;
 	UmcSession*               m_pSession;
 } UmcTaskMsg;
@@ -42,12 +47,16 @@ enum UmcTaskMsgType
 	UMC_TASK_KILL_SESSION_MSG,
 	UMC_TASK_SHOW_SCENARIOS_MSG,
 	UMC_TASK_SHOW_SESSIONS_MSG,
-	UMC_TASK_EXIT_SESSION_MSG
+	UMC_TASK_EXIT_SESSION_MSG,
+	UMC_TASK_START_LOAD_MSG,
+	UMC_TASK_STOP_LOAD_MSG,
+	UMC_TASK_SHOW_LOAD_MSG
 };
 
 apt_bool_t UmcProcessMsg(apt_task_t* pTask, apt_task_msg_t* pMsg);
 void UmcOnStartComplete(apt_task_t* pTask);
 void UmcOnTerminateComplete(apt_task_t* pTask);
+void UmcLoadTimerProc(apt_timer_t* pTimer, void* pObj);
 apt_bool_t AppMessageHandler(const mrcp_app_message_t* pAppMessage);
 
 
@@ -58,7 +67,9 @@ UmcFramework::UmcFramework() :
 	m_pMrcpClient(NULL),
 	m_pMrcpApplication(NULL),
 	m_pScenarioTable(NULL),
-	m_pSessionTable(NULL)
+	m_pSessionTable(NULL),
+	m_pLoadGenerator(NULL),
+	m_pLoadTimer(NULL)
 {
 }
 
@@ -147,6 +158,8 @@ bool UmcFramework::CreateTask()
 		pVtable->on_terminate_complete = UmcOnTerminateComplete;
 	}
 
+	m_pLoadTimer = apt_consumer_task_timer_create(m_pTask,UmcLoadTimerProc,this,m_pPool);
+
 	apt_task_start(pTask);
 	return true;
 }
@@ -342,17 +355,12 @@ bool UmcFramework::RemoveSession(UmcSession* pSession)
 	return true;
 }
 
-bool UmcFramework::ProcessRunRequest(const char* pScenarioName, const char* pProfileName)
+UmcSession* UmcFramework::RunScenarioSession(UmcScenario* pScenario, const char* pProfileName)
 {
-	UmcScenario* pScenario = (UmcScenario*) apr_hash_get(m_pScenarioTable,pScenarioName,APR_HASH_KEY_STRING);
-	if(!pScenario)
-		return false;
-
 	UmcSession* pSession = pScenario->CreateSession();
 	if(!pSession)
-		return false;
+		return NULL;
 
-	printf("[%s]\n",pSession->GetId());
 	if(pProfileName && *pProfileName != '\0')
 		pSession->SetMrcpProfile(pProfileName);
 	pSession->SetMrcpApplication(m_pMrcpApplication);
@@ -360,13 +368,127 @@ bool UmcFramework::ProcessRunRequest(const char* pScenarioName, const char* pPro
 	if(!pSession->Run())
 	{
 		delete pSession;
-		return false;
+		return NULL;
 	}
 
 	AddSession(pSession);
+	return pSession;
+}
+
+bool UmcFramework::ProcessRunRequest(const char* pScenarioName, const char* pProfileName)
+{
+	UmcScenario* pScenario = (UmcScenario*) apr_hash_get(m_pScenarioTable,pScenarioName,APR_HASH_KEY_STRING);
+	if(!pScenario)
+		return false;
+
+	UmcSession* pSession = RunScenarioSession(pScenario,pProfileName);
+	if(!pSession)
+		return false;
+
+	printf("[%s]\n",pSession->GetId());
 	return true;
 }
 
+UmcSession* UmcFramework::LaunchSession(UmcScenario* pScenario, const char* pProfileName)
+{
+	UmcSession* pSession = RunScenarioSession(pScenario,pProfileName);
+	if(pSession)
+		pSession->SetLoadGenerated(true);
+	return pSession;
+}
+
+bool UmcFramework::ProcessStartLoadRequest(apr_size_t cps, apr_size_t concurrency, apr_size_t count, const char* pMix, const char* pProfileName)
+{
+	if(m_pLoadGenerator)
+	{
+		if(!m_pLoadGenerator->IsComplete())
+		{
+			printf("Load Is Already in Progress (use 'load stop')\n");
+			return false;
+		}
+		delete m_pLoadGenerator;
+		m_pLoadGenerator = NULL;
+	}
+
+	UmcLoadGenerator* pLoadGenerator = new UmcLoadGenerator(this);
+	if(!pLoadGenerator->Create(cps,concurrency,count,pProfileName))
+	{
+		printf("Invalid Load Settings\n");
+		delete pLoadGenerator;
+		return false;
+	}
+
+	/* the mix is a comma-separated list of scenario[:weight] */
+	char* pState;
+	char* pMixStr = apr_pstrdup(m_pPool,pMix);
+	char* pItem = apr_strtok(pMixStr,",",&pState);
+	for(; pItem; pItem = apr_strtok(NULL,",",&pState))
+	{
+		apr_size_t weight = 1;
+		char* pWeight = strchr(pItem,':');
+		if(pWeight)
+		{
+			*pWeight++ = '\0';
+			weight = atol(pWeight);
+		}
+
+		UmcScenario* pScenario = (UmcScenario*) apr_hash_get(m_pScenarioTable,pItem,APR_HASH_KEY_STRING);
+		if(!pScenario || !pLoadGenerator->AddScenario(pScenario,weight))
+		{
+			printf("Invalid Scenario [%s] (use 'show scenarios')\n",pItem);
+			delete pLoadGenerator;
+			return false;
+		}
+	}
+
+	if(!pLoadGenerator->Start())
+	{
+		printf("No Scenario to Generate Load of\n");
+		delete pLoadGenerator;
+		return false;
+	}
+
+	m_pLoadGenerator = pLoadGenerator;
+	ProcessLoadTick();
+	return true;
+}
+
+void UmcFramework::ProcessStopLoadRequest()
+{
+	if(!m_pLoadGenerator)
+		return;
+
+	m_pLoadGenerator->Stop();
+	ProcessLoadTick();
+}
+
+void UmcFramework::ProcessShowLoad()
+{
+	if(!m_pLoadGenerator)
+	{
+		printf("No Load\n");
+		return;
+	}
+	m_pLoadGenerator->ShowSummary();
+}
+
+void UmcFramework::ProcessLoadTick()
+{
+	if(!m_pLoadGenerator)
+		return;
+
+	m_pLoadGenerator->OnTick();
+	if(m_pLoadGenerator->IsRunning())
+	{
+		apt_timer_set(m_pLoadTimer,UMC_LOAD_TICK_INTERVAL);
+		return;
+	}
+
+	apt_timer_kill(m_pLoadTimer);
+	if(m_pLoadGenerator->IsComplete())
+		m_pLoadGenerator->ShowSummary();
+}
+
 void UmcFramework::ProcessStopRequest(const char* id)
 {
 	UmcSession* pSession;
@@ -443,6 +565,12 @@ void UmcFramework::ProcessSessionExit(UmcSession* pUmcSession)
 		return;
 
 	RemoveSession(pUmcSession);
+	if(m_pLoadGenerator && pUmcSession->IsLoadGenerated())
+	{
+		m_pLoadGenerator->OnSessionExit(pUmcSession);
+		if(m_pLoadGenerator->IsComplete())
+			m_pLoadGenerator->ShowSummary();
+	}
 	delete pUmcSession;
 }
 
@@ -521,6 +649,54 @@ void UmcFramework::ShowSessions()
 	apt_task_msg_signal(pTask,pTaskMsg);
 }
 
+void UmcFramework::StartLoad(apr_size_t cps, apr_size_t concurrency, apr_size_t count, const char* pMix, const char* pProfileName)
+{
+	apt_task_t* pTask = apt_consumer_task_base_get(m_pTask);
+	apt_task_msg_t* pTaskMsg = apt_task_msg_get(pTask);
+	if(!pTaskMsg) 
+		return;
+
+	pTaskMsg->type = TASK_MSG_USER;
+	pTaskMsg->sub_type = UMC_TASK_START_LOAD_MSG;
+
+	UmcTaskMsg* pUmcMsg = (UmcTaskMsg*) pTaskMsg->data;
+	pUmcMsg->m_Cps = cps;
+	pUmcMsg->m_Concurrency = concurrency;
+	pUmcMsg->m_Count = count;
+	strncpy(pUmcMsg->m_LoadMix,pMix,sizeof(pUmcMsg->m_LoadMix)-1);
+	pUmcMsg->m_LoadMix[sizeof(pUmcMsg->m_LoadMix)-1] = '\0';
+	if(pProfileName)
+		strncpy(pUmcMsg->m_ProfileName,pProfileName,sizeof(pUmcMsg->m_ProfileName)-1);
+	else
+		*pUmcMsg->m_ProfileName = '\0';
+	pUmcMsg->m_pAppMessage = NULL;
+	apt_task_msg_signal(pTask,pTaskMsg);
+}
+
+void UmcFramework::StopLoad()
+{
+	apt_task_t* pTask = apt_consumer_task_base_get(m_pTask);
+	apt_task_msg_t* pTaskMsg = apt_task_msg_get(pTask);
+	if(!pTaskMsg) 
+		return;
+
+	pTaskMsg->type = TASK_MSG_USER;
+	pTaskMsg->sub_type = UMC_TASK_STOP_LOAD_MSG;
+	apt_task_msg_signal(pTask,pTaskMsg);
+}
+
+void UmcFramework::ShowLoad()
+{
+	apt_task_t* pTask = apt_consumer_task_base_get(m_pTask);
+	apt_task_msg_t* pTaskMsg = apt_task_msg_get(pTask);
+	if(!pTaskMsg) 
+		return;
+
+	pTaskMsg->type = TASK_MSG_USER;
+	pTaskMsg->sub_type = UMC_TASK_SHOW_LOAD_MSG;
+	apt_task_msg_signal(pTask,pTaskMsg);
+}
+
 void UmcFramework::ExitSession(UmcSession* pUmcSession)
 {
 	apt_task_t* pTask = apt_consumer_task_base_get(m_pTask);
@@ -613,10 +789,23 @@ void UmcOnTerminateComplete(apt_task_t* pTask)
 	apt_consumer_task_t* pConsumerTask = (apt_consumer_task_t*) apt_task_object_get(pTask);
 	UmcFramework* pFramework = (UmcFramework*) apt_consumer_task_object_get(pConsumerTask);
 
+	if(pFramework->m_pLoadGenerator)
+	{
+		apt_timer_kill(pFramework->m_pLoadTimer);
+		delete pFramework->m_pLoadGenerator;
+		pFramework->m_pLoadGenerator = NULL;
+	}
 	pFramework->DestroyMrcpClient();
 	pFramework->DestroyScenarios();
 }
 
+void UmcLoadTimerProc(apt_timer_t* pTimer, void* pObj)
+{
+	UmcFramework* pFramework = (UmcFramework*) pObj;
+	if(pFramework && pFramework->m_pLoadTimer == pTimer)
+		pFramework->ProcessLoadTick();
+}
+
 apt_bool_t UmcProcessMsg(apt_task_t *pTask, apt_task_msg_t *pMsg)
 {
 	if(pMsg->type != TASK_MSG_USER)
@@ -673,6 +862,21 @@ apt_bool_t UmcProcessMsg(apt_task_t *pTask, apt_task_msg_t *pMsg)
 			pFramework->ProcessSessionExit(pUmcMsg->m_pSession);
 			break;
 		}
+		case UMC_TASK_START_LOAD_MSG:
+		{
+			pFramework->ProcessStartLoadRequest(pUmcMsg->m_Cps,pUmcMsg->m_Concurrency,pUmcMsg->m_Count,pUmcMsg->m_LoadMix,pUmcMsg->m_ProfileName);
+			break;
+		}
+		case UMC_TASK_STOP_LOAD_MSG:
+		{
+			pFramework->ProcessStopLoadRequest();
+			break;
+		}
+		case UMC_TASK_SHOW_LOAD_MSG:
+		{
+			pFramework->ProcessShowLoad();
+			break;
+		}
 	}
 	return TRUE;
 }
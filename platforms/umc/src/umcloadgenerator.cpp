@@ -0,0 +1,259 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "umcloadgenerator.h"
+#include "umcscenario.h"
+#include "umcsession.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+
+static APR_INLINE apr_uint32_t UmcLatencyGet(apr_time_t from, apr_time_t to)
+{
+	if(to <= from)
+		return 0;
+	return (apr_uint32_t) ((to - from) / 1000);
+}
+
+UmcLoadGenerator::UmcLoadGenerator(UmcLoadMethodProvider* pMethodProvider) :
+	m_pMethodProvider(pMethodProvider),
+	m_pPool(NULL),
+	m_Cps(0),
+	m_Concurrency(0),
+	m_Count(0),
+	m_pProfileName(NULL),
+	m_pMix(NULL),
+	m_TotalWeight(0),
+	m_Running(false),
+	m_StartTime(0),
+	m_StopTime(0),
+	m_Scheduled(0),
+	m_Launched(0),
+	m_Throttled(0),
+	m_Active(0),
+	m_Completed(0),
+	m_Failed(0),
+	m_pSetupHistogram(NULL),
+	m_pInputHistogram(NULL),
+	m_pCompleteHistogram(NULL),
+	m_pSessionHistogram(NULL)
+{
+}
+
+UmcLoadGenerator::~UmcLoadGenerator()
+{
+	Destroy();
+}
+
+bool UmcLoadGenerator::Create(apr_size_t cps, apr_size_t concurrency, apr_size_t count, const char* pProfileName)
+{
+	if(!cps)
+		return false;
+
+	m_pPool = apt_pool_create();
+	if(!m_pPool)
+		return false;
+
+	m_Cps = cps;
+	m_Concurrency = concurrency;
+	m_Count = count;
+	m_pProfileName = (pProfileName && *pProfileName != '\0') ? apr_pstrdup(m_pPool,pProfileName) : NULL;
+	m_pMix = apr_array_make(m_pPool,3,sizeof(MixEntry));
+	m_TotalWeight = 0;
+
+	m_pSetupHistogram = apt_histogram_create(m_pPool);
+	m_pInputHistogram = apt_histogram_create(m_pPool);
+	m_pCompleteHistogram = apt_histogram_create(m_pPool);
+	m_pSessionHistogram = apt_histogram_create(m_pPool);
+	return true;
+}
+
+bool UmcLoadGenerator::AddScenario(UmcScenario* pScenario, apr_size_t weight)
+{
+	if(!pScenario || !weight || !m_pMix)
+		return false;
+
+	MixEntry* pEntry = (MixEntry*) apr_array_push(m_pMix);
+	pEntry->m_pScenario = pScenario;
+	pEntry->m_Weight = weight;
+	pEntry->m_Current = 0;
+	m_TotalWeight += weight;
+	return true;
+}
+
+void UmcLoadGenerator::Destroy()
+{
+	if(m_pPool)
+	{
+		apr_pool_destroy(m_pPool);
+		m_pPool = NULL;
+	}
+	m_pMix = NULL;
+	m_pSetupHistogram = NULL;
+	m_pInputHistogram = NULL;
+	m_pCompleteHistogram = NULL;
+	m_pSessionHistogram = NULL;
+}
+
+bool UmcLoadGenerator::Start()
+{
+	if(m_Running || !m_pMix || !m_TotalWeight)
+		return false;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Start Load [%" APR_SIZE_T_FMT " CPS] [%" APR_SIZE_T_FMT " concurrent] [%" APR_SIZE_T_FMT " sessions]",
+		m_Cps,m_Concurrency,m_Count);
+	m_Running = true;
+	m_StartTime = apr_time_now();
+	m_StopTime = 0;
+	return true;
+}
+
+void UmcLoadGenerator::Stop()
+{
+	if(!m_Running)
+		return;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Stop Load [%" APR_SIZE_T_FMT " launched] [%" APR_SIZE_T_FMT " active]",
+		m_Launched,m_Active);
+	m_Running = false;
+	m_StopTime = apr_time_now();
+}
+
+UmcScenario* UmcLoadGenerator::PickScenario()
+{
+	/* smooth weighted round-robin, which interleaves the scenarios evenly */
+	MixEntry* pBest = NULL;
+	for(int i = 0; i < m_pMix->nelts; i++)
+	{
+		MixEntry* pEntry = &APR_ARRAY_IDX(m_pMix,i,MixEntry);
+		pEntry->m_Current += pEntry->m_Weight;
+		if(!pBest || pEntry->m_Current > pBest->m_Current)
+			pBest = pEntry;
+	}
+	pBest->m_Current -= m_TotalWeight;
+	return pBest->m_pScenario;
+}
+
+void UmcLoadGenerator::OnTick()
+{
+	if(!m_Running)
+		return;
+
+	/* number of sessions due since start, the first one is launched at once */
+	apr_time_t elapsed = apr_time_now() - m_StartTime;
+	apr_size_t due = (apr_size_t) (elapsed * m_Cps / APR_USEC_PER_SEC) + 1;
+	if(m_Count && due > m_Count)
+		due = m_Count;
+
+	while(m_Scheduled < due)
+	{
+		m_Scheduled++;
+		if(m_Concurrency && m_Active >= m_Concurrency)
+		{
+			/* open loop: the slot is skipped rather than launched late */
+			m_Throttled++;
+			continue;
+		}
+
+		UmcSession* pSession = m_pMethodProvider->LaunchSession(PickScenario(),m_pProfileName);
+		if(!pSession)
+		{
+			m_Failed++;
+			continue;
+		}
+		m_Launched++;
+		m_Active++;
+	}
+
+	if(m_Count && m_Scheduled >= m_Count)
+		Stop();
+}
+
+void UmcLoadGenerator::OnSessionExit(const UmcSession* pSession)
+{
+	if(!pSession || !m_Active)
+		return;
+
+	m_Active--;
+
+	apr_time_t startTime = pSession->GetStartTime();
+	apr_time_t setupTime = pSession->GetSetupTime();
+	apr_time_t inputTime = pSession->GetInputTime();
+	apr_time_t completeTime = pSession->GetCompleteTime();
+
+	if(setupTime)
+	{
+		apt_histogram_record(m_pSetupHistogram,UmcLatencyGet(startTime,setupTime));
+		if(inputTime)
+			apt_histogram_record(m_pInputHistogram,UmcLatencyGet(setupTime,inputTime));
+	}
+	if(setupTime && completeTime)
+	{
+		apt_histogram_record(m_pCompleteHistogram,UmcLatencyGet(setupTime,completeTime));
+		m_Completed++;
+	}
+	else
+	{
+		m_Failed++;
+	}
+	apt_histogram_record(m_pSessionHistogram,UmcLatencyGet(startTime,apr_time_now()));
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Load Session [%s] %s setup [%u] start-of-input [%u] complete [%u] msec",
+		pSession->GetId(),
+		pSession->GetScenario()->GetName(),
+		setupTime ? UmcLatencyGet(startTime,setupTime) : 0,
+		setupTime && inputTime ? UmcLatencyGet(setupTime,inputTime) : 0,
+		setupTime && completeTime ? UmcLatencyGet(setupTime,completeTime) : 0);
+}
+
+void UmcLoadGenerator::ShowHistogram(const char* pName, const apt_histogram_t* pHistogram) const
+{
+	printf("%-16s %8" APR_SIZE_T_FMT " %8u %8u %8u %8u %8u %8u %10.1f\n",
+		pName,
+		apt_histogram_count_get(pHistogram),
+		apt_histogram_min_get(pHistogram),
+		apt_histogram_percentile_get(pHistogram,50),
+		apt_histogram_percentile_get(pHistogram,90),
+		apt_histogram_percentile_get(pHistogram,99),
+		apt_histogram_percentile_get(pHistogram,99.9),
+		apt_histogram_max_get(pHistogram),
+		apt_histogram_mean_get(pHistogram));
+}
+
+void UmcLoadGenerator::ShowSummary() const
+{
+	if(!m_StartTime || !m_pPool)
+	{
+		printf("No Load\n");
+		return;
+	}
+
+	apr_time_t endTime = m_Running ? apr_time_now() : m_StopTime;
+	double elapsed = (double) (endTime - m_StartTime) / APR_USEC_PER_SEC;
+	printf("Load %s [%.1f sec] target [%" APR_SIZE_T_FMT " CPS] actual [%.1f CPS]\n",
+		m_Running ? "Running" : (m_Active ? "Stopping" : "Complete"),
+		elapsed,
+		m_Cps,
+		elapsed > 0 ? m_Launched / elapsed : 0.0);
+	printf("Sessions launched [%" APR_SIZE_T_FMT "] active [%" APR_SIZE_T_FMT "] completed [%" APR_SIZE_T_FMT "] failed [%" APR_SIZE_T_FMT "] throttled [%" APR_SIZE_T_FMT "]\n",
+		m_Launched,m_Active,m_Completed,m_Failed,m_Throttled);
+	printf("%-16s %8s %8s %8s %8s %8s %8s %8s %10s\n",
+		"latency (msec)","count","min","p50","p90","p99","p99.9","max","mean");
+	ShowHistogram("setup",m_pSetupHistogram);
+	ShowHistogram("start-of-input",m_pInputHistogram);
+	ShowHistogram("complete",m_pCompleteHistogram);
+	ShowHistogram("session",m_pSessionHistogram);
+}
@@ -15,6 +15,7 @@
  */
 
 #include <stdlib.h>
+#include <apr_fnmatch.h>
 #include "umcscenario.h"
 #include "apt_log.h"
 
@@ -24,7 +25,9 @@ UmcScenario::UmcScenario() :
 	m_pDirLayout(NULL),
 	m_ResourceDiscovery(false),
 	m_pCapabilities(NULL),
-	m_pRtpDescriptor(NULL)
+	m_pRtpDescriptor(NULL),
+	m_pAudioCorpus(NULL),
+	m_AudioCorpusIndex(0)
 {
 }
 
@@ -125,6 +128,54 @@ bool UmcScenario::LoadCapabilities(const apr_xml_elem* pElem, apr_pool_t* pool)
 	return true;
 }
 
+static int UmcFileNameCompare(const void* pLeft, const void* pRight)
+{
+	return strcmp(*(const char* const*)pLeft,*(const char* const*)pRight);
+}
+
+bool UmcScenario::LoadAudioCorpus(const char* pPattern, apr_pool_t* pool)
+{
+	apr_dir_t* pDir;
+	apr_finfo_t finfo;
+	const char* pDirPath = apt_dir_layout_path_get(m_pDirLayout,APT_LAYOUT_DATA_DIR);
+	if(!pDirPath || apr_dir_open(&pDir,pDirPath,pool) != APR_SUCCESS)
+	{
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Data Directory for Audio Corpus [%s]",pPattern);
+		return false;
+	}
+
+	apr_array_header_t* pCorpus = apr_array_make(pool,10,sizeof(const char*));
+	while(apr_dir_read(&finfo,APR_FINFO_NAME|APR_FINFO_TYPE,pDir) == APR_SUCCESS)
+	{
+		if(finfo.filetype == APR_REG && apr_fnmatch(pPattern,finfo.name,0) == APR_SUCCESS)
+			APR_ARRAY_PUSH(pCorpus,const char*) = apr_pstrdup(pool,finfo.name);
+	}
+	apr_dir_close(pDir);
+
+	if(pCorpus->nelts == 0)
+	{
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Audio Corpus Files Match [%s]",pPattern);
+		return false;
+	}
+
+	/* stream the files in the same order at each run */
+	qsort(pCorpus->elts,pCorpus->nelts,sizeof(const char*),UmcFileNameCompare);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Load Audio Corpus [%s] [%d] Files",pPattern,pCorpus->nelts);
+	m_pAudioCorpus = pCorpus;
+	m_AudioCorpusIndex = 0;
+	return true;
+}
+
+const char* UmcScenario::GetAudioCorpusFile() const
+{
+	if(!m_pAudioCorpus)
+		return NULL;
+
+	const char* pFileName = APR_ARRAY_IDX(m_pAudioCorpus,m_AudioCorpusIndex,const char*);
+	m_AudioCorpusIndex = (m_AudioCorpusIndex + 1) % m_pAudioCorpus->nelts;
+	return pFileName;
+}
+
 int UmcScenario::ParseRates(const char* pStr, apr_pool_t* pool)
 {
 	int rates = 0;
@@ -27,7 +27,12 @@ UmcSession::UmcSession(const UmcScenario* pScenario) :
 	m_pMrcpSession(NULL),
 	m_pMrcpMessage(NULL),
 	m_Running(false),
-	m_Terminating(false)
+	m_Terminating(false),
+	m_LoadGenerated(false),
+	m_StartTime(0),
+	m_SetupTime(0),
+	m_InputTime(0),
+	m_CompleteTime(0)
 {
 	static int id = 0;
 	if(id == INT_MAX)
@@ -54,6 +59,7 @@ bool UmcSession::Run()
 	if(!m_pMrcpProfile || !m_pMrcpApplication)
 		return false;
 
+	m_StartTime = apr_time_now();
 	/* create session */
 	if(!CreateMrcpSession(m_pMrcpProfile))
 		return false;
@@ -111,6 +117,8 @@ bool UmcSession::OnSessionUpdate(mrcp_sig_status_code_e status)
 
 bool UmcSession::OnChannelAdd(mrcp_channel_t* pMrcpChannel, mrcp_sig_status_code_e status)
 {
+	if(m_Running && status == MRCP_SIG_STATUS_CODE_SUCCESS && !m_SetupTime)
+		m_SetupTime = apr_time_now();
 	return m_Running;
 }
 
@@ -131,6 +139,16 @@ bool UmcSession::OnMessageReceive(mrcp_channel_t* pMrcpChannel, mrcp_message_t*
 	if(m_pMrcpMessage->start_line.request_id != pMrcpMessage->start_line.request_id)
 		return false;
 
+	if(pMrcpMessage->start_line.message_type == MRCP_MESSAGE_TYPE_EVENT)
+	{
+		/* timestamp the events of the in-progress request to break the latency down */
+		apt_str_t startOfInput;
+		apt_string_set(&startOfInput,"START-OF-INPUT");
+		if(!m_InputTime && apt_string_compare(&pMrcpMessage->start_line.method_name,&startOfInput) == TRUE)
+			m_InputTime = apr_time_now();
+		if(!m_CompleteTime && pMrcpMessage->start_line.request_state == MRCP_REQUEST_STATE_COMPLETE)
+			m_CompleteTime = apr_time_now();
+	}
 	return true;
 }
 
@@ -43,11 +43,16 @@ static apt_bool_t cmdline_process(mrcp_server_t *server, char *cmdline)
 	else if(strcasecmp(name,"online") == 0) {
 		mrcp_server_online(server);
 	}
+	else if(strcasecmp(name,"drain") == 0) {
+		char *retry_after = apr_strtok(NULL, " ", &last);
+		mrcp_server_drain(server,retry_after ? atol(retry_after) : 0);
+	}
 	else if(strcasecmp(name,"help") == 0) {
 		printf("usage:\n");
 		printf("- loglevel [level] (set loglevel, one of 0,1...7)\n");
 		printf("- offline (take server offline)\n");
 		printf("- online (bring server online)\n");
+		printf("- drain [retry-after] (reject new sessions, while the ones in progress continue)\n");
 		printf("- quit, exit\n");
 	}
 	else {
@@ -44,7 +44,14 @@ apt_bool_t uni_daemon_run(apt_dir_layout_t *dir_layout, apt_bool_t detach, apr_p
 		return FALSE;
 	}
 
-	while(daemon_running) apr_sleep(1000000);
+	while(daemon_running) {
+		apr_sleep(1000000);
+		if(mrcp_server_is_drained(server) == TRUE) {
+			/* the successor has taken over, or the server has been drained otherwise */
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Exit Drained Daemon");
+			break;
+		}
+	}
 
 	/* shutdown server */
 	unimrcp_server_shutdown(server);
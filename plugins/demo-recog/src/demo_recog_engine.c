@@ -28,15 +28,15 @@
  */
 
 #include "mrcp_recog_engine.h"
+#include "mrcp_engine_worker.h"
 #include "mpf_activity_detector.h"
-#include "apt_consumer_task.h"
 #include "apt_log.h"
 
-#define RECOG_ENGINE_TASK_NAME "Demo Recog Engine"
+/** Max number of jobs queued per channel */
+#define DEMO_RECOG_STRAND_CAPACITY 16
 
 typedef struct demo_recog_engine_t demo_recog_engine_t;
 typedef struct demo_recog_channel_t demo_recog_channel_t;
-typedef struct demo_recog_msg_t demo_recog_msg_t;
 
 /** Declaration of recognizer engine methods */
 static apt_bool_t demo_recog_engine_destroy(mrcp_engine_t *engine);
@@ -84,7 +84,10 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 
 /** Declaration of demo recognizer engine */
 struct demo_recog_engine_t {
-	apt_consumer_task_t    *task;
+	/** Threads the jobs of channels are processed by */
+	mrcp_engine_worker_t   *worker;
+	/** Number of threads */
+	apr_size_t              thread_count;
 };
 
 /** Declaration of demo recognizer channel */
@@ -93,6 +96,8 @@ struct demo_recog_channel_t {
 	demo_recog_engine_t     *demo_engine;
 	/** Engine channel base */
 	mrcp_engine_channel_t   *channel;
+	/** Strand the jobs of the channel are processed by in order */
+	mrcp_engine_strand_t    *strand;
 
 	/** Active (in-progress) recognition request */
 	mrcp_message_t          *recog_request;
@@ -107,20 +112,13 @@ struct demo_recog_channel_t {
 };
 
 typedef enum {
-	DEMO_RECOG_MSG_OPEN_CHANNEL,
-	DEMO_RECOG_MSG_CLOSE_CHANNEL,
-	DEMO_RECOG_MSG_REQUEST_PROCESS
-} demo_recog_msg_type_e;
-
-/** Declaration of demo recognizer task message */
-struct demo_recog_msg_t {
-	demo_recog_msg_type_e  type;
-	mrcp_engine_channel_t *channel; 
-	mrcp_message_t        *request;
-};
+	DEMO_RECOG_JOB_OPEN_CHANNEL,
+	DEMO_RECOG_JOB_CLOSE_CHANNEL,
+	DEMO_RECOG_JOB_REQUEST_PROCESS
+} demo_recog_job_type_e;
 
-static apt_bool_t demo_recog_msg_signal(demo_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request);
-static apt_bool_t demo_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+static apt_bool_t demo_recog_job_post(demo_recog_job_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request);
+static void demo_recog_job_process(void *obj, int type, void *data);
 
 /** Declare this macro to set plugin version */
 MRCP_PLUGIN_VERSION_DECLARE
@@ -139,21 +137,9 @@ MRCP_PLUGIN_LOG_SOURCE_IMPLEMENT(RECOG_PLUGIN,"RECOG-PLUGIN")
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	demo_recog_engine_t *demo_engine = apr_palloc(pool,sizeof(demo_recog_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(demo_recog_msg_t),pool);
-	demo_engine->task = apt_consumer_task_create(demo_engine,msg_pool,pool);
-	if(!demo_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(demo_engine->task);
-	apt_task_name_set(task,RECOG_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = demo_recog_msg_process;
-	}
+	/* the threads are configured by engine params, which are only available on open */
+	demo_engine->worker = NULL;
+	demo_engine->thread_count = 1;
 
 	/* create engine base */
 	return mrcp_engine_create(
@@ -166,12 +152,6 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy recognizer engine */
 static apt_bool_t demo_recog_engine_destroy(mrcp_engine_t *engine)
 {
-	demo_recog_engine_t *demo_engine = engine->obj;
-	if(demo_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-		apt_task_destroy(task);
-		demo_engine->task = NULL;
-	}
 	return TRUE;
 }
 
@@ -179,9 +159,11 @@ static apt_bool_t demo_recog_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t demo_recog_engine_open(mrcp_engine_t *engine)
 {
 	demo_recog_engine_t *demo_engine = engine->obj;
-	if(demo_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-		apt_task_start(task);
+	mrcp_engine_param_size_get(engine,"worker-threads",&demo_engine->thread_count);
+	demo_engine->worker = mrcp_engine_worker_create(demo_engine->thread_count,engine->pool);
+	if(!demo_engine->worker) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Worker [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
 	return mrcp_engine_open_respond(engine,TRUE);
 }
@@ -190,9 +172,9 @@ static apt_bool_t demo_recog_engine_open(mrcp_engine_t *engine)
 static apt_bool_t demo_recog_engine_close(mrcp_engine_t *engine)
 {
 	demo_recog_engine_t *demo_engine = engine->obj;
-	if(demo_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-		apt_task_terminate(task,TRUE);
+	if(demo_engine->worker) {
+		mrcp_engine_worker_destroy(demo_engine->worker);
+		demo_engine->worker = NULL;
 	}
 	return mrcp_engine_close_respond(engine);
 }
@@ -209,6 +191,12 @@ static mrcp_engine_channel_t* demo_recog_engine_channel_create(mrcp_engine_t *en
 	recog_channel->stop_response = NULL;
 	recog_channel->detector = mpf_activity_detector_create(pool);
 	recog_channel->audio_out = NULL;
+	recog_channel->strand = mrcp_engine_strand_create(
+			recog_channel->demo_engine->worker,
+			DEMO_RECOG_STRAND_CAPACITY,
+			demo_recog_job_process,
+			recog_channel,
+			pool);
 
 	capabilities = mpf_sink_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
@@ -237,7 +225,9 @@ static mrcp_engine_channel_t* demo_recog_engine_channel_create(mrcp_engine_t *en
 /** Destroy engine channel */
 static apt_bool_t demo_recog_channel_destroy(mrcp_engine_channel_t *channel)
 {
-	/* nothing to destrtoy */
+	demo_recog_channel_t *recog_channel = channel->method_obj;
+	/* the job responding to close may still be returning */
+	mrcp_engine_strand_destroy(recog_channel->strand);
 	return TRUE;
 }
 
@@ -254,19 +244,19 @@ static apt_bool_t demo_recog_channel_open(mrcp_engine_channel_t *channel)
 		}
 	}
 
-	return demo_recog_msg_signal(DEMO_RECOG_MSG_OPEN_CHANNEL,channel,NULL);
+	return demo_recog_job_post(DEMO_RECOG_JOB_OPEN_CHANNEL,channel,NULL);
 }
 
 /** Close engine channel (asynchronous response MUST be sent)*/
 static apt_bool_t demo_recog_channel_close(mrcp_engine_channel_t *channel)
 {
-	return demo_recog_msg_signal(DEMO_RECOG_MSG_CLOSE_CHANNEL,channel,NULL);
+	return demo_recog_job_post(DEMO_RECOG_JOB_CLOSE_CHANNEL,channel,NULL);
 }
 
 /** Process MRCP channel request (asynchronous response MUST be sent)*/
 static apt_bool_t demo_recog_channel_request_process(mrcp_engine_channel_t *channel, mrcp_message_t *request)
 {
-	return demo_recog_msg_signal(DEMO_RECOG_MSG_REQUEST_PROCESS,channel,request);
+	return demo_recog_job_post(DEMO_RECOG_JOB_REQUEST_PROCESS,channel,request);
 }
 
 /** Process RECOGNIZE request */
@@ -531,51 +521,33 @@ static apt_bool_t demo_recog_stream_write(mpf_audio_stream_t *stream, const mpf_
 	return TRUE;
 }
 
-static apt_bool_t demo_recog_msg_signal(demo_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request)
+static apt_bool_t demo_recog_job_post(demo_recog_job_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request)
 {
-	apt_bool_t status = FALSE;
-	demo_recog_channel_t *demo_channel = channel->method_obj;
-	demo_recog_engine_t *demo_engine = demo_channel->demo_engine;
-	apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
-	apt_task_msg_t *msg = apt_task_msg_get(task);
-	if(msg) {
-		demo_recog_msg_t *demo_msg;
-		msg->type = TASK_MSG_USER;
-		demo_msg = (demo_recog_msg_t*) msg->data;
-
-		demo_msg->type = type;
-		demo_msg->channel = channel;
-		demo_msg->request = request;
-		status = apt_task_msg_signal(task,msg);
-	}
-	return status;
+	demo_recog_channel_t *recog_channel = channel->method_obj;
+	return mrcp_engine_strand_post(recog_channel->strand,type,request);
 }
 
-static apt_bool_t demo_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+static void demo_recog_job_process(void *obj, int type, void *data)
 {
-	demo_recog_msg_t *demo_msg = (demo_recog_msg_t*)msg->data;
-	switch(demo_msg->type) {
-		case DEMO_RECOG_MSG_OPEN_CHANNEL:
+	demo_recog_channel_t *recog_channel = obj;
+	switch(type) {
+		case DEMO_RECOG_JOB_OPEN_CHANNEL:
 			/* open channel and send asynch response */
-			mrcp_engine_channel_open_respond(demo_msg->channel,TRUE);
+			mrcp_engine_channel_open_respond(recog_channel->channel,TRUE);
 			break;
-		case DEMO_RECOG_MSG_CLOSE_CHANNEL:
-		{
+		case DEMO_RECOG_JOB_CLOSE_CHANNEL:
 			/* close channel, make sure there is no activity and send asynch response */
-			demo_recog_channel_t *recog_channel = demo_msg->channel->method_obj;
 			if(recog_channel->audio_out) {
 				fclose(recog_channel->audio_out);
 				recog_channel->audio_out = NULL;
 			}
 
-			mrcp_engine_channel_close_respond(demo_msg->channel);
+			mrcp_engine_channel_close_respond(recog_channel->channel);
 			break;
-		}
-		case DEMO_RECOG_MSG_REQUEST_PROCESS:
-			demo_recog_channel_request_dispatch(demo_msg->channel,demo_msg->request);
+		case DEMO_RECOG_JOB_REQUEST_PROCESS:
+			demo_recog_channel_request_dispatch(recog_channel->channel,data);
 			break;
 		default:
 			break;
 	}
-	return TRUE;
 }
@@ -27,12 +27,20 @@
  * 5. Methods (callbacks) of the MPF engine stream MUST not block.
  */
 
+#include <stdlib.h>
+#include <apr_file_io.h>
+#include <apr_file_info.h>
 #include "mrcp_synth_engine.h"
+#include "mrcp_prompt_cache.h"
+#include "mpf_buffer.h"
 #include "apt_consumer_task.h"
 #include "apt_log.h"
 
 #define SYNTH_ENGINE_TASK_NAME "Demo Synth Engine"
 
+/** Default max size of the prompt cache in bytes */
+#define DEMO_SYNTH_PROMPT_CACHE_SIZE (8 * 1024 * 1024)
+
 typedef struct demo_synth_engine_t demo_synth_engine_t;
 typedef struct demo_synth_channel_t demo_synth_channel_t;
 typedef struct demo_synth_msg_t demo_synth_msg_t;
@@ -84,6 +92,8 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 /** Declaration of demo synthesizer engine */
 struct demo_synth_engine_t {
 	apt_consumer_task_t    *task;
+	/** Cache of prompts shared by channels */
+	mrcp_prompt_cache_t    *prompt_cache;
 };
 
 /** Declaration of demo synthesizer channel */
@@ -101,8 +111,10 @@ struct demo_synth_channel_t {
 	apr_size_t             time_to_complete;
 	/** Is paused */
 	apt_bool_t             paused;
-	/** Speech source (used instead of actual synthesis) */
-	FILE                  *audio_file;
+	/** Speech source (used instead of actual synthesis), referenced from the prompt cache */
+	mrcp_prompt_t         *prompt;
+	/** Buffer of references to the audio of the prompt */
+	mpf_buffer_t          *audio_buffer;
 };
 
 typedef enum {
@@ -144,6 +156,8 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 	apt_task_vtable_t *vtable;
 	apt_task_msg_pool_t *msg_pool;
 
+	demo_engine->prompt_cache = NULL;
+
 	/* create task/thread to run demo engine in the context of this task */
 	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(demo_synth_msg_t),pool);
 	demo_engine->task = apt_consumer_task_create(demo_engine,msg_pool,pool);
@@ -174,6 +188,10 @@ static apt_bool_t demo_synth_engine_destroy(mrcp_engine_t *engine)
 		apt_task_destroy(task);
 		demo_engine->task = NULL;
 	}
+	if(demo_engine->prompt_cache) {
+		mrcp_prompt_cache_destroy(demo_engine->prompt_cache);
+		demo_engine->prompt_cache = NULL;
+	}
 	return TRUE;
 }
 
@@ -181,8 +199,13 @@ static apt_bool_t demo_synth_engine_destroy(mrcp_engine_t *engine)
 static apt_bool_t demo_synth_engine_open(mrcp_engine_t *engine)
 {
 	demo_synth_engine_t *demo_engine = engine->obj;
+	apr_size_t cache_size = DEMO_SYNTH_PROMPT_CACHE_SIZE;
+	mrcp_engine_param_size_get(engine,"prompt-cache-size",&cache_size);
+	demo_engine->prompt_cache = mrcp_prompt_cache_create(cache_size,engine->pool);
+
 	if(demo_engine->task) {
 		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
+		mrcp_engine_task_config_apply(engine,task);
 		apt_task_start(task);
 	}
 	return mrcp_engine_open_respond(engine,TRUE);
@@ -212,7 +235,8 @@ static mrcp_engine_channel_t* demo_synth_engine_channel_create(mrcp_engine_t *en
 	synth_channel->stop_response = NULL;
 	synth_channel->time_to_complete = 0;
 	synth_channel->paused = FALSE;
-	synth_channel->audio_file = NULL;
+	synth_channel->prompt = NULL;
+	synth_channel->audio_buffer = mpf_buffer_create(pool);
 	
 	capabilities = mpf_source_stream_capabilities_create(pool);
 	mpf_codec_capabilities_add(
@@ -238,10 +262,23 @@ static mrcp_engine_channel_t* demo_synth_engine_channel_create(mrcp_engine_t *en
 	return synth_channel->channel;
 }
 
+/** Release the prompt of the channel */
+static void demo_synth_channel_prompt_release(demo_synth_channel_t *synth_channel)
+{
+	if(synth_channel->prompt) {
+		/* references to the prompt must be dropped first */
+		mpf_buffer_restart(synth_channel->audio_buffer);
+		mrcp_prompt_release(synth_channel->demo_engine->prompt_cache,synth_channel->prompt);
+		synth_channel->prompt = NULL;
+	}
+}
+
 /** Destroy engine channel */
 static apt_bool_t demo_synth_channel_destroy(mrcp_engine_channel_t *channel)
 {
-	/* nothing to destroy */
+	demo_synth_channel_t *synth_channel = channel->method_obj;
+	demo_synth_channel_prompt_release(synth_channel);
+	mpf_buffer_destroy(synth_channel->audio_buffer);
 	return TRUE;
 }
 
@@ -263,6 +300,43 @@ static apt_bool_t demo_synth_channel_request_process(mrcp_engine_channel_t *chan
 	return demo_synth_msg_signal(DEMO_SYNTH_MSG_REQUEST_PROCESS,channel,request);
 }
 
+/** Get prompt of a file from the cache, or read the file and add it to the cache */
+static mrcp_prompt_t* demo_synth_prompt_get(demo_synth_engine_t *demo_engine, const mpf_codec_descriptor_t *descriptor, const char *file_path, apr_pool_t *pool)
+{
+	mrcp_prompt_t *prompt;
+	apr_pool_t *read_pool;
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	const char *key;
+	
+	if(!demo_engine->prompt_cache) {
+		return NULL;
+	}
+	/* the audio is produced of the file, so is the key */
+	key = mrcp_prompt_key_create(descriptor,file_path,strlen(file_path),pool);
+	prompt = mrcp_prompt_cache_get(demo_engine->prompt_cache,key);
+	if(prompt) {
+		return prompt;
+	}
+
+	/* read the file into a temporary pool, the audio is copied to the cache */
+	if(apr_pool_create(&read_pool,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_file_open(&file,file_path,APR_FOPEN_READ|APR_FOPEN_BINARY,APR_OS_DEFAULT,read_pool) == APR_SUCCESS) {
+		if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) == APR_SUCCESS) {
+			apr_size_t size = (apr_size_t)finfo.size;
+			void *data = apr_palloc(read_pool,size ? size : 1);
+			if(apr_file_read_full(file,data,size,&size) == APR_SUCCESS) {
+				prompt = mrcp_prompt_cache_put(demo_engine->prompt_cache,key,data,size);
+			}
+		}
+		apr_file_close(file);
+	}
+	apr_pool_destroy(read_pool);
+	return prompt;
+}
+
 /** Process SPEAK request */
 static apt_bool_t demo_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
 {
@@ -282,8 +356,14 @@ static apt_bool_t demo_synth_channel_speak(mrcp_engine_channel_t *channel, mrcp_
 		file_path = apt_datadir_filepath_get(channel->engine->dir_layout,file_name,channel->pool);
 	}
 	if(file_path) {
-		synth_channel->audio_file = fopen(file_path,"rb");
-		if(synth_channel->audio_file) {
+		demo_synth_channel_prompt_release(synth_channel);
+		synth_channel->prompt = demo_synth_prompt_get(synth_channel->demo_engine,descriptor,file_path,channel->pool);
+		if(synth_channel->prompt) {
+			/* no copy, the prompt is shared by the channels playing it */
+			mpf_buffer_audio_ref_write(
+				synth_channel->audio_buffer,
+				mrcp_prompt_data_get(synth_channel->prompt),
+				mrcp_prompt_size_get(synth_channel->prompt));
 			apt_log(SYNTH_LOG_MARK,APT_PRIO_INFO,"Set [%s] as Speech Source " APT_SIDRES_FMT,
 				file_path,
 				MRCP_MESSAGE_SIDRES(request));
@@ -457,10 +537,7 @@ static apt_bool_t demo_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 		synth_channel->stop_response = NULL;
 		synth_channel->speak_request = NULL;
 		synth_channel->paused = FALSE;
-		if(synth_channel->audio_file) {
-			fclose(synth_channel->audio_file);
-			synth_channel->audio_file = NULL;
-		}
+		demo_synth_channel_prompt_release(synth_channel);
 		return TRUE;
 	}
 
@@ -468,11 +545,10 @@ static apt_bool_t demo_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 	if(synth_channel->speak_request && synth_channel->paused == FALSE) {
 		/* normal processing */
 		apt_bool_t completed = FALSE;
-		if(synth_channel->audio_file) {
-			/* read speech from file */
-			apr_size_t size = frame->codec_frame.size;
-			if(fread(frame->codec_frame.buffer,1,size,synth_channel->audio_file) == size) {
-				frame->type |= MEDIA_FRAME_TYPE_AUDIO;
+		if(synth_channel->prompt) {
+			/* read speech from the prompt (the last frame is padded with silence) */
+			if(mpf_buffer_get_size(synth_channel->audio_buffer)) {
+				mpf_buffer_frame_read(synth_channel->audio_buffer,frame);
 			}
 			else {
 				completed = TRUE;
@@ -508,10 +584,7 @@ static apt_bool_t demo_synth_stream_read(mpf_audio_stream_t *stream, mpf_frame_t
 				message->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
 
 				synth_channel->speak_request = NULL;
-				if(synth_channel->audio_file) {
-					fclose(synth_channel->audio_file);
-					synth_channel->audio_file = NULL;
-				}
+				demo_synth_channel_prompt_release(synth_channel);
 				/* send asynch event */
 				mrcp_engine_channel_message_send(synth_channel->channel,message);
 			}
@@ -183,6 +183,7 @@ static apt_bool_t demo_verifier_engine_open(mrcp_engine_t *engine)
 	demo_verifier_engine_t *demo_engine = engine->obj;
 	if(demo_engine->task) {
 		apt_task_t *task = apt_consumer_task_base_get(demo_engine->task);
+		mrcp_engine_task_config_apply(engine,task);
 		apt_task_start(task);
 	}
 	return mrcp_engine_open_respond(engine,TRUE);
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef RECORDER_WRITER_H
+#define RECORDER_WRITER_H
+
+/**
+ * @file recorder_writer.h
+ * @brief Asynchronous Recording Writer
+ *
+ * Audio is copied to blocks of a per-recording lock-free ring by the media
+ * thread and written to file in large blocks by a background thread, which
+ * also encodes it, if a compressed format is set. The ring absorbs stalls
+ * of the disk, so that no disk I/O is done on the media thread.
+ *
+ * If silent regions are left out of a recording, an index of the regions
+ * kept is written along with it, so that the original timing can be
+ * reconstructed.
+ */
+
+#include "apt.h"
+#include "mpf_codec_manager.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Format of recordings */
+typedef enum {
+	RECORDER_FORMAT_PCM,      /**< raw L16 */
+	RECORDER_FORMAT_WAV,      /**< L16 in WAV */
+	RECORDER_FORMAT_WAV_ULAW, /**< G.711 mu-law in WAV, half the size */
+	RECORDER_FORMAT_WAV_ALAW  /**< G.711 A-law in WAV, half the size */
+} recorder_format_e;
+
+/** Opaque writer (background thread) declaration */
+typedef struct recorder_writer_t recorder_writer_t;
+/** Opaque recording output declaration */
+typedef struct recorder_output_t recorder_output_t;
+
+/** Parse format by name (pcm, wav, wav-ulaw, wav-alaw) */
+apt_bool_t recorder_format_parse(const char *name, recorder_format_e *format);
+
+/** Get file extension of format */
+const char* recorder_format_extension_get(recorder_format_e format);
+
+/** Get the size of a file of format, holding audio of the given L16 size */
+apr_size_t recorder_format_file_size_get(recorder_format_e format, apr_size_t size);
+
+/**
+ * Create writer.
+ * @param codec_manager the codec manager to take G.711 encoders from
+ * @param pool the pool to allocate memory from
+ */
+recorder_writer_t* recorder_writer_create(const mpf_codec_manager_t *codec_manager, apr_pool_t *pool);
+
+/** Destroy writer */
+void recorder_writer_destroy(recorder_writer_t *writer);
+
+/** Start writer thread */
+apt_bool_t recorder_writer_start(recorder_writer_t *writer);
+
+/** Terminate writer thread (pending recordings are completed first) */
+apt_bool_t recorder_writer_terminate(recorder_writer_t *writer);
+
+/**
+ * Open recording (file is opened asynchronously).
+ * @param writer the writer to write recording by
+ * @param file_path the path of the file to write to
+ * @param sample_rate the sampling rate of L16 mono audio
+ * @param format the format of the file
+ * @param index_size the max number of regions in the index of the recording (0 - no index)
+ */
+recorder_output_t* recorder_output_open(recorder_writer_t *writer, const char *file_path, int sample_rate, recorder_format_e format, apr_size_t index_size);
+
+/**
+ * Add a region to the index of recording, written on close to the file path with ".idx" appended.
+ * @param file the recording
+ * @param input_time the time (msec) of the region in the input
+ * @param output_time the time (msec) of the region in the recording
+ * @return FALSE if the index is full (or not enabled), so that the rest must be recorded as is
+ * @remark Must be called from the thread recorder_output_write() is called from
+ */
+apt_bool_t recorder_output_index_add(recorder_output_t *file, apr_size_t input_time, apr_size_t output_time);
+
+/** Determine whether the index of recording is full (or not enabled) */
+apt_bool_t recorder_output_index_full(const recorder_output_t *file);
+
+/**
+ * Write L16 audio to recording (never blocks, audio is dropped if the writer lags behind).
+ * @remark Must be called from one and the same thread at a time
+ */
+void recorder_output_write(recorder_output_t *file, const void *data, apr_size_t size);
+
+/** Close recording, the recording must not be referenced afterwards */
+void recorder_output_close(recorder_output_t *file);
+
+APT_END_EXTERN_C
+
+#endif /* RECORDER_WRITER_H */
@@ -29,10 +29,17 @@
 
 #include "mrcp_recorder_engine.h"
 #include "mpf_activity_detector.h"
-#include "apt_log.h"
+#include "recorder_writer.h"
+#include "recorder_log.h"
 
 #define RECORDER_ENGINE_TASK_NAME "Recorder Engine"
 
+/** Default silence (msec) kept at the start of each pause, if silence is suppressed */
+#define RECORDER_DEFAULT_SILENCE_HANGOVER 300
+/** Default max number of speech regions indexed per recording, if silence is suppressed */
+#define RECORDER_DEFAULT_SILENCE_INDEX_SIZE 1024
+
+typedef struct recorder_engine_t recorder_engine_t;
 typedef struct recorder_channel_t recorder_channel_t;
 
 /** Declaration of recorder engine methods */
@@ -79,6 +86,20 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 	NULL
 };
 
+/** Declaration of recorder engine */
+struct recorder_engine_t {
+	/** Background writer of recordings */
+	recorder_writer_t *writer;
+	/** Format of recordings */
+	recorder_format_e  format;
+	/** Whether silence is left out of recordings, beyond the hangover */
+	apt_bool_t         silence_suppression;
+	/** Silence (msec) kept at the start of each pause */
+	apr_size_t         silence_hangover;
+	/** Max number of regions indexed per recording */
+	apr_size_t         silence_index_size;
+};
+
 /** Declaration of recorder channel */
 struct recorder_channel_t {
 	/** Engine channel base */
@@ -98,10 +119,20 @@ struct recorder_channel_t {
 	apr_size_t               cur_time;
 	/** Written size of the recording in bytes */
 	apr_size_t               cur_size;
+	/** Elapsed time of the input in msec (differs from the recording if silence is suppressed) */
+	apr_size_t               input_time;
+	/** Elapsed time of the current pause in msec */
+	apr_size_t               silence_time;
+	/** Whether silence is being left out of the recording */
+	apt_bool_t               suppressing;
+	/** Whether silence is suppressed for the recording (turned off once its index is full) */
+	apt_bool_t               suppression;
 	/** File name of the recording */
 	const char              *file_name;
-	/** File to write to */
-	FILE                    *audio_out;
+	/** Format of the recording */
+	recorder_format_e        format;
+	/** Output to write to (by the writer of the engine) */
+	recorder_output_t       *audio_out;
 };
 
 /** Declare this macro to set plugin version */
@@ -114,16 +145,20 @@ MRCP_PLUGIN_VERSION_DECLARE
  */
 MRCP_PLUGIN_LOG_SOURCE_IMPLEMENT(RECORD_PLUGIN,"RECORD-PLUGIN")
 
-/** Use custom log source mark */
-#define RECORD_LOG_MARK   APT_LOG_MARK_DECLARE(RECORD_PLUGIN)
-
 /** Create recorder engine */
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
+	recorder_engine_t *recorder_engine = apr_palloc(pool,sizeof(recorder_engine_t));
+	recorder_engine->writer = NULL;
+	recorder_engine->format = RECORDER_FORMAT_PCM;
+	recorder_engine->silence_suppression = FALSE;
+	recorder_engine->silence_hangover = RECORDER_DEFAULT_SILENCE_HANGOVER;
+	recorder_engine->silence_index_size = RECORDER_DEFAULT_SILENCE_INDEX_SIZE;
+
 	/* create engine base */
 	return mrcp_engine_create(
 				MRCP_RECORDER_RESOURCE,    /* MRCP resource identifier */
-				NULL,                      /* object to associate */
+				recorder_engine,           /* object to associate */
 				&engine_vtable,            /* virtual methods table of engine */
 				pool);                     /* pool to allocate memory from */
 }
@@ -131,18 +166,51 @@ MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 /** Destroy recorder engine */
 static apt_bool_t recorder_engine_destroy(mrcp_engine_t *engine)
 {
+	recorder_engine_t *recorder_engine = engine->obj;
+	if(recorder_engine->writer) {
+		recorder_writer_destroy(recorder_engine->writer);
+		recorder_engine->writer = NULL;
+	}
 	return TRUE;
 }
 
 /** Open recorder engine */
 static apt_bool_t recorder_engine_open(mrcp_engine_t *engine)
 {
+	recorder_engine_t *recorder_engine = engine->obj;
+	const char *value = mrcp_engine_param_get(engine,"record-format");
+	if(value && recorder_format_parse(value,&recorder_engine->format) == FALSE) {
+		apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Unknown Record Format [%s]",value);
+	}
+	mrcp_engine_param_bool_get(engine,"silence-suppression",&recorder_engine->silence_suppression);
+	mrcp_engine_param_duration_get(engine,"silence-hangover",&recorder_engine->silence_hangover);
+	mrcp_engine_param_size_get(engine,"silence-index-size",&recorder_engine->silence_index_size);
+	if(!recorder_engine->silence_index_size) {
+		recorder_engine->silence_suppression = FALSE;
+	}
+	if(recorder_engine->silence_suppression == TRUE) {
+		apt_log(RECORD_LOG_MARK,APT_PRIO_INFO,"Suppress Silence of Recordings [hangover %"APR_SIZE_T_FMT" ms] [%"APR_SIZE_T_FMT" regions]",
+			recorder_engine->silence_hangover,
+			recorder_engine->silence_index_size);
+	}
+
+	/* the codec manager is available since open */
+	recorder_engine->writer = recorder_writer_create(engine->codec_manager,engine->pool);
+	if(!recorder_engine->writer || recorder_writer_start(recorder_engine->writer) == FALSE) {
+		apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Recorder Writer");
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
 	return mrcp_engine_open_respond(engine,TRUE);
 }
 
 /** Close recorder engine */
 static apt_bool_t recorder_engine_close(mrcp_engine_t *engine)
 {
+	recorder_engine_t *recorder_engine = engine->obj;
+	if(recorder_engine->writer) {
+		/* pending recordings are completed first */
+		recorder_writer_terminate(recorder_engine->writer);
+	}
 	return mrcp_engine_close_respond(engine);
 }
 
@@ -159,7 +227,12 @@ static mrcp_engine_channel_t* recorder_engine_channel_create(mrcp_engine_t *engi
 	recorder_channel->max_time = 0;
 	recorder_channel->cur_time = 0;
 	recorder_channel->cur_size = 0;
+	recorder_channel->input_time = 0;
+	recorder_channel->silence_time = 0;
+	recorder_channel->suppressing = FALSE;
+	recorder_channel->suppression = FALSE;
 	recorder_channel->file_name = NULL;
+	recorder_channel->format = RECORDER_FORMAT_PCM;
 	recorder_channel->audio_out = NULL;
 
 	capabilities = mpf_sink_stream_capabilities_create(pool);
@@ -213,6 +286,7 @@ static apt_bool_t recorder_file_open(recorder_channel_t *recorder_channel, mrcp_
 	char *file_path;
 	char *file_name;
 	mrcp_engine_channel_t *channel = recorder_channel->channel;
+	recorder_engine_t *recorder_engine = channel->engine->obj;
 	const apt_dir_layout_t *dir_layout = channel->engine->dir_layout;
 	const mpf_codec_descriptor_t *descriptor = mrcp_engine_sink_stream_codec_get(channel);
 
@@ -221,28 +295,36 @@ static apt_bool_t recorder_file_open(recorder_channel_t *recorder_channel, mrcp_
 		return FALSE;
 	}
 
-	file_name = apr_psprintf(channel->pool,"rec-%dkHz-%s-%"MRCP_REQUEST_ID_FMT".pcm",
+	file_name = apr_psprintf(channel->pool,"rec-%dkHz-%s-%"MRCP_REQUEST_ID_FMT".%s",
 		descriptor->sampling_rate/1000,
 		request->channel_id.session_id.buf,
-		request->start_line.request_id);
+		request->start_line.request_id,
+		recorder_format_extension_get(recorder_engine->format));
 	file_path = apt_vardir_filepath_get(dir_layout,file_name,channel->pool);
 	if(!file_path) {
 		return FALSE;
 	}
 
 	if(recorder_channel->audio_out) {
-		fclose(recorder_channel->audio_out);
+		recorder_output_close(recorder_channel->audio_out);
 		recorder_channel->audio_out = NULL;
 	}
 
-	apt_log(RECORD_LOG_MARK,APT_PRIO_INFO,"Open Utterance Output File [%s] for Writing",file_path);
-	recorder_channel->audio_out = fopen(file_path,"wb");
+	/* the file is opened and written by the writer thread, never by the media thread */
+	recorder_channel->audio_out = recorder_output_open(
+		recorder_engine->writer,
+		file_path,
+		descriptor->sampling_rate,
+		recorder_engine->format,
+		recorder_engine->silence_suppression == TRUE ? recorder_engine->silence_index_size : 0);
 	if(!recorder_channel->audio_out) {
 		apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Utterance Output File [%s] for Writing",file_path);
 		return FALSE;
 	}
 
 	recorder_channel->file_name = file_name;
+	recorder_channel->format = recorder_engine->format;
+	recorder_channel->suppression = recorder_engine->silence_suppression;
 	return TRUE;
 }
 
@@ -260,7 +342,7 @@ static apt_bool_t recorder_channel_uri_set(recorder_channel_t *recorder_channel,
 		message->pool,
 		"<file://mediaserver/data/%s>;size=%"APR_SIZE_T_FMT";duration=%"APR_SIZE_T_FMT,
 		recorder_channel->file_name,
-		recorder_channel->cur_size,
+		recorder_format_file_size_get(recorder_channel->format,recorder_channel->cur_size),
 		recorder_channel->cur_time);
 
 	apt_string_set(&recorder_header->record_uri,record_uri);
@@ -303,6 +385,13 @@ static apt_bool_t recorder_channel_record(recorder_channel_t *recorder_channel,
 
 	recorder_channel->cur_time = 0;
 	recorder_channel->cur_size = 0;
+	recorder_channel->input_time = 0;
+	recorder_channel->silence_time = 0;
+	recorder_channel->suppressing = FALSE;
+	if(recorder_channel->suppression == TRUE) {
+		/* the recording starts with the input */
+		recorder_output_index_add(recorder_channel->audio_out,0,0);
+	}
 	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
 	/* send asynchronous response */
 	mrcp_engine_channel_message_send(recorder_channel->channel,response);
@@ -387,7 +476,7 @@ static apt_bool_t recorder_record_complete(recorder_channel_t *recorder_channel,
 	}
 
 	if(recorder_channel->audio_out) {
-		fclose(recorder_channel->audio_out);
+		recorder_output_close(recorder_channel->audio_out);
 		recorder_channel->audio_out = NULL;
 	}
 
@@ -408,6 +497,37 @@ static apt_bool_t recorder_record_complete(recorder_channel_t *recorder_channel,
 	return mrcp_engine_channel_message_send(recorder_channel->channel,message);
 }
 
+/** Determine whether the frame is left out of the recording as silence beyond the hangover (MPF context) */
+static apt_bool_t recorder_silence_suppress(recorder_channel_t *recorder_channel)
+{
+	recorder_engine_t *recorder_engine = recorder_channel->channel->engine->obj;
+	if(mpf_activity_detector_activity_check(recorder_channel->detector) == TRUE) {
+		recorder_channel->silence_time = 0;
+		if(recorder_channel->suppressing == TRUE) {
+			/* a new region of the recording starts with the speech, room for it is checked ahead */
+			recorder_channel->suppressing = FALSE;
+			recorder_output_index_add(recorder_channel->audio_out,recorder_channel->input_time,recorder_channel->cur_time);
+		}
+		return FALSE;
+	}
+	if(recorder_channel->suppressing == TRUE) {
+		return TRUE;
+	}
+	recorder_channel->silence_time += CODEC_FRAME_TIME_BASE;
+	if(recorder_channel->silence_time > recorder_engine->silence_hangover) {
+		if(recorder_output_index_full(recorder_channel->audio_out) == TRUE) {
+			/* the rest is recorded as is, so that its timing is still known */
+			apt_log(RECORD_LOG_MARK,APT_PRIO_INFO,"Stop Suppressing Silence: index is full " APT_SIDRES_FMT,
+				MRCP_MESSAGE_SIDRES(recorder_channel->record_request));
+			recorder_channel->suppression = FALSE;
+			return FALSE;
+		}
+		recorder_channel->suppressing = TRUE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
 /** Callback is called from MPF engine context to destroy any additional data associated with audio stream */
 static apt_bool_t recorder_stream_destroy(mpf_audio_stream_t *stream)
 {
@@ -432,7 +552,7 @@ static apt_bool_t recorder_stream_write(mpf_audio_stream_t *stream, const mpf_fr
 	recorder_channel_t *recorder_channel = stream->obj;
 	if(recorder_channel->stop_response) {
 		if(recorder_channel->audio_out) {
-			fclose(recorder_channel->audio_out);
+			recorder_output_close(recorder_channel->audio_out);
 			recorder_channel->audio_out = NULL;
 		}
 		
@@ -472,7 +592,16 @@ static apt_bool_t recorder_stream_write(mpf_audio_stream_t *stream, const mpf_fr
 		}
 
 		if(recorder_channel->audio_out) {
-			fwrite(frame->codec_frame.buffer,1,frame->codec_frame.size,recorder_channel->audio_out);
+			apt_bool_t suppressed = FALSE;
+			if(recorder_channel->suppression == TRUE) {
+				suppressed = recorder_silence_suppress(recorder_channel);
+			}
+			recorder_channel->input_time += CODEC_FRAME_TIME_BASE;
+			if(suppressed == TRUE) {
+				/* neither written nor counted in the length of the recording */
+				return TRUE;
+			}
+			recorder_output_write(recorder_channel->audio_out,frame->codec_frame.buffer,frame->codec_frame.size);
 			
 			recorder_channel->cur_size += frame->codec_frame.size;
 			recorder_channel->cur_time += CODEC_FRAME_TIME_BASE;
@@ -0,0 +1,480 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <apr_strings.h>
+#include "recorder_writer.h"
+#include "apt_consumer_task.h"
+#include "apt_spsc_queue.h"
+#include "mpf_codec.h"
+#include "recorder_log.h"
+
+#define RECORDER_WRITER_TASK_NAME    "Recorder Writer"
+
+/** Size of a block of audio */
+#define RECORDER_BLOCK_SIZE          16384
+/** Number of blocks the writer may lag behind (about 16 sec of 16 kHz audio) */
+#define RECORDER_BLOCK_COUNT         32
+/** Number of filled blocks to wake the writer up at */
+#define RECORDER_BATCH_COUNT         2
+/** Size of stdio buffer, so that disk writes are large and sequential */
+#define RECORDER_FILE_BUFFER         (RECORDER_BLOCK_SIZE * 4)
+/** Size of WAV header */
+#define RECORDER_WAV_HEADER_SIZE     44
+
+/** Recording writer */
+struct recorder_writer_t {
+	/** Consumer task (thread) */
+	apt_consumer_task_t       *task;
+	/** Codec manager to take G.711 encoders from */
+	const mpf_codec_manager_t *codec_manager;
+};
+
+/** Block of audio */
+typedef struct recorder_block_t recorder_block_t;
+struct recorder_block_t {
+	apr_size_t size;
+	char       data[RECORDER_BLOCK_SIZE];
+};
+
+/** Region of recording kept, mapping its time in the recording to the time in the input */
+typedef struct recorder_region_t recorder_region_t;
+struct recorder_region_t {
+	apr_size_t input_time;
+	apr_size_t output_time;
+};
+
+/** Recording */
+struct recorder_output_t {
+	/** Writer the recording is written by */
+	recorder_writer_t *writer;
+	/** File path */
+	const char        *file_path;
+	/** Sampling rate */
+	int                sample_rate;
+	/** File format */
+	recorder_format_e  format;
+	/** Queue of blocks */
+	apt_spsc_queue_t  *queue;
+	/** Block being filled by producer (not committed yet) */
+	recorder_block_t  *block;
+	/** Number of blocks committed since the writer was signaled (producer) */
+	apr_size_t         uncommitted;
+	/** Number of bytes dropped because of queue overflow (producer) */
+	apr_size_t         dropped;
+	/** File (writer) */
+	FILE              *file;
+	/** G.711 encoder (writer) */
+	mpf_codec_t       *encoder;
+	/** Buffer of encoded audio (writer) */
+	char              *encoded;
+	/** Number of bytes of audio written (writer) */
+	apr_size_t         written;
+	/** Index of the regions kept, allocated on open, read by the writer on close */
+	recorder_region_t *regions;
+	/** Number of regions in the index (producer) */
+	apr_size_t         region_count;
+	/** Max number of regions in the index */
+	apr_size_t         region_capacity;
+	/** Pool the recording is allocated from */
+	apr_pool_t        *pool;
+};
+
+typedef enum {
+	RECORDER_MSG_OPEN,
+	RECORDER_MSG_WRITE,
+	RECORDER_MSG_CLOSE
+} recorder_msg_type_e;
+
+/** Writer task message */
+typedef struct recorder_msg_t recorder_msg_t;
+struct recorder_msg_t {
+	recorder_msg_type_e type;
+	recorder_output_t    *file;
+};
+
+apt_bool_t recorder_format_parse(const char *name, recorder_format_e *format)
+{
+	if(strcasecmp(name,"pcm") == 0) {
+		*format = RECORDER_FORMAT_PCM;
+	}
+	else if(strcasecmp(name,"wav") == 0) {
+		*format = RECORDER_FORMAT_WAV;
+	}
+	else if(strcasecmp(name,"wav-ulaw") == 0) {
+		*format = RECORDER_FORMAT_WAV_ULAW;
+	}
+	else if(strcasecmp(name,"wav-alaw") == 0) {
+		*format = RECORDER_FORMAT_WAV_ALAW;
+	}
+	else {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+const char* recorder_format_extension_get(recorder_format_e format)
+{
+	return format == RECORDER_FORMAT_PCM ? "pcm" : "wav";
+}
+
+/** Get the number of bytes a sample of format is written in */
+static apr_size_t recorder_format_sample_size_get(recorder_format_e format)
+{
+	return (format == RECORDER_FORMAT_WAV_ULAW || format == RECORDER_FORMAT_WAV_ALAW) ? 1 : 2;
+}
+
+apr_size_t recorder_format_file_size_get(recorder_format_e format, apr_size_t size)
+{
+	if(format == RECORDER_FORMAT_PCM) {
+		return size;
+	}
+	return RECORDER_WAV_HEADER_SIZE + size / 2 * recorder_format_sample_size_get(format);
+}
+
+static void recorder_le32_set(unsigned char *buf, apr_uint32_t value)
+{
+	buf[0] = (unsigned char)(value & 0xff);
+	buf[1] = (unsigned char)((value >> 8) & 0xff);
+	buf[2] = (unsigned char)((value >> 16) & 0xff);
+	buf[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+static void recorder_le16_set(unsigned char *buf, apr_uint16_t value)
+{
+	buf[0] = (unsigned char)(value & 0xff);
+	buf[1] = (unsigned char)((value >> 8) & 0xff);
+}
+
+/** Write WAV header of mono audio */
+static void recorder_wav_header_write(recorder_output_t *file, apr_size_t data_size)
+{
+	unsigned char header[RECORDER_WAV_HEADER_SIZE];
+	apr_uint16_t sample_size = (apr_uint16_t)recorder_format_sample_size_get(file->format);
+	apr_uint16_t format_tag = 1; /* PCM */
+	if(file->format == RECORDER_FORMAT_WAV_ALAW) {
+		format_tag = 6;
+	}
+	else if(file->format == RECORDER_FORMAT_WAV_ULAW) {
+		format_tag = 7;
+	}
+	memcpy(header,"RIFF",4);
+	recorder_le32_set(header+4,(apr_uint32_t)(data_size + RECORDER_WAV_HEADER_SIZE - 8));
+	memcpy(header+8,"WAVEfmt ",8);
+	recorder_le32_set(header+16,16);                         /* fmt chunk size */
+	recorder_le16_set(header+20,format_tag);
+	recorder_le16_set(header+22,1);                          /* mono */
+	recorder_le32_set(header+24,(apr_uint32_t)file->sample_rate);
+	recorder_le32_set(header+28,(apr_uint32_t)file->sample_rate * sample_size); /* byte rate */
+	recorder_le16_set(header+32,sample_size);                /* block align */
+	recorder_le16_set(header+34,(apr_uint16_t)(sample_size * 8)); /* bits per sample */
+	memcpy(header+36,"data",4);
+	recorder_le32_set(header+40,(apr_uint32_t)data_size);
+	fwrite(header,1,sizeof(header),file->file);
+}
+
+/** Create G.711 encoder by name (writer context) */
+static mpf_codec_t* recorder_encoder_create(recorder_output_t *file, const char *name)
+{
+	apt_str_t codec_name;
+	const mpf_codec_t *codec;
+	mpf_codec_t *encoder;
+	if(!file->writer->codec_manager) {
+		return NULL;
+	}
+	apt_string_set(&codec_name,name);
+	codec = mpf_codec_manager_codec_find(file->writer->codec_manager,&codec_name);
+	if(!codec) {
+		return NULL;
+	}
+	/* G.711 is stateless and encodes samples of any sampling rate alike */
+	encoder = mpf_codec_clone((mpf_codec_t*)codec,file->pool);
+	if(mpf_codec_open(encoder) == FALSE) {
+		return NULL;
+	}
+	file->encoded = apr_palloc(file->pool,RECORDER_BLOCK_SIZE / 2);
+	return encoder;
+}
+
+/** Open file (writer context) */
+static void recorder_output_do_open(recorder_output_t *file)
+{
+	apt_log(RECORD_LOG_MARK,APT_PRIO_INFO,"Open Record File [%s] for Writing",file->file_path);
+	if(file->format == RECORDER_FORMAT_WAV_ULAW || file->format == RECORDER_FORMAT_WAV_ALAW) {
+		const char *name = file->format == RECORDER_FORMAT_WAV_ULAW ? "PCMU" : "PCMA";
+		file->encoder = recorder_encoder_create(file,name);
+		if(!file->encoder) {
+			apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"No %s Encoder Available: write L16 to [%s]",name,file->file_path);
+			file->format = RECORDER_FORMAT_WAV;
+		}
+	}
+
+	file->file = fopen(file->file_path,"wb");
+	if(!file->file) {
+		apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Record File [%s] for Writing",file->file_path);
+		return;
+	}
+	setvbuf(file->file,NULL,_IOFBF,RECORDER_FILE_BUFFER);
+	if(file->format != RECORDER_FORMAT_PCM) {
+		/* sizes are updated on close */
+		recorder_wav_header_write(file,0);
+	}
+}
+
+/** Write queued blocks to file (writer context) */
+static void recorder_output_drain(recorder_output_t *file)
+{
+	recorder_block_t *block;
+	while((block = apt_spsc_queue_read_begin(file->queue)) != NULL) {
+		if(file->file) {
+			if(file->encoder) {
+				mpf_codec_frame_t frame_in;
+				mpf_codec_frame_t frame_out;
+				frame_in.buffer = block->data;
+				frame_in.size = block->size;
+				frame_out.buffer = file->encoded;
+				frame_out.size = 0;
+				mpf_codec_encode(file->encoder,&frame_in,&frame_out);
+				file->written += fwrite(frame_out.buffer,1,frame_out.size,file->file);
+			}
+			else {
+				file->written += fwrite(block->data,1,block->size,file->file);
+			}
+		}
+		apt_spsc_queue_read_commit(file->queue);
+	}
+}
+
+/** Write the index of the regions kept (writer context) */
+static void recorder_index_write(recorder_output_t *file)
+{
+	apr_size_t i;
+	const char *index_path = apr_pstrcat(file->pool,file->file_path,".idx",NULL);
+	FILE *index = fopen(index_path,"w");
+	if(!index) {
+		apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Record Index [%s] for Writing",index_path);
+		return;
+	}
+	fprintf(index,"# input-msec output-msec\n");
+	for(i=0; i<file->region_count; i++) {
+		fprintf(index,"%"APR_SIZE_T_FMT" %"APR_SIZE_T_FMT"\n",
+			file->regions[i].input_time,
+			file->regions[i].output_time);
+	}
+	fclose(index);
+}
+
+/** Close file and destroy recording (writer context) */
+static void recorder_output_do_close(recorder_output_t *file)
+{
+	recorder_output_drain(file);
+	if(file->file && file->region_count) {
+		recorder_index_write(file);
+	}
+	if(file->file) {
+		if(file->format != RECORDER_FORMAT_PCM && fseek(file->file,0,SEEK_SET) == 0) {
+			recorder_wav_header_write(file,file->written);
+		}
+		fclose(file->file);
+		file->file = NULL;
+		apt_log(RECORD_LOG_MARK,APT_PRIO_INFO,"Close Record File [%s] [%"APR_SIZE_T_FMT" bytes]",
+			file->file_path,file->written);
+	}
+	if(file->encoder) {
+		mpf_codec_close(file->encoder);
+	}
+	apr_pool_destroy(file->pool);
+}
+
+static apt_bool_t recorder_output_signal(recorder_output_t *file, recorder_msg_type_e type)
+{
+	apt_bool_t status = FALSE;
+	apt_task_t *task = apt_consumer_task_base_get(file->writer->task);
+	apt_task_msg_t *msg = apt_task_msg_get(task);
+	if(msg) {
+		recorder_msg_t *recorder_msg;
+		msg->type = TASK_MSG_USER;
+		recorder_msg = (recorder_msg_t*) msg->data;
+		recorder_msg->type = type;
+		recorder_msg->file = file;
+		status = apt_task_msg_signal(task,msg);
+	}
+	return status;
+}
+
+static apt_bool_t recorder_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	recorder_msg_t *recorder_msg = (recorder_msg_t*)msg->data;
+	switch(recorder_msg->type) {
+		case RECORDER_MSG_OPEN:
+			recorder_output_do_open(recorder_msg->file);
+			break;
+		case RECORDER_MSG_WRITE:
+			recorder_output_drain(recorder_msg->file);
+			break;
+		case RECORDER_MSG_CLOSE:
+			recorder_output_do_close(recorder_msg->file);
+			break;
+	}
+	return TRUE;
+}
+
+recorder_writer_t* recorder_writer_create(const mpf_codec_manager_t *codec_manager, apr_pool_t *pool)
+{
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	recorder_writer_t *writer = apr_palloc(pool,sizeof(recorder_writer_t));
+	writer->codec_manager = codec_manager;
+
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(recorder_msg_t),pool);
+	writer->task = apt_consumer_task_create(writer,msg_pool,pool);
+	if(!writer->task) {
+		return NULL;
+	}
+	task = apt_consumer_task_base_get(writer->task);
+	apt_task_name_set(task,RECORDER_WRITER_TASK_NAME);
+	vtable = apt_task_vtable_get(task);
+	if(vtable) {
+		vtable->process_msg = recorder_msg_process;
+	}
+	return writer;
+}
+
+void recorder_writer_destroy(recorder_writer_t *writer)
+{
+	if(writer->task) {
+		apt_task_destroy(apt_consumer_task_base_get(writer->task));
+		writer->task = NULL;
+	}
+}
+
+apt_bool_t recorder_writer_start(recorder_writer_t *writer)
+{
+	return apt_task_start(apt_consumer_task_base_get(writer->task));
+}
+
+apt_bool_t recorder_writer_terminate(recorder_writer_t *writer)
+{
+	return apt_task_terminate(apt_consumer_task_base_get(writer->task),TRUE);
+}
+
+recorder_output_t* recorder_output_open(recorder_writer_t *writer, const char *file_path, int sample_rate, recorder_format_e format, apr_size_t index_size)
+{
+	recorder_output_t *file;
+	apr_pool_t *pool;
+	/* the recording is destroyed by the writer thread, hence its own pool */
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	file = apr_palloc(pool,sizeof(recorder_output_t));
+	file->writer = writer;
+	file->file_path = apr_pstrdup(pool,file_path);
+	file->sample_rate = sample_rate;
+	file->format = format;
+	file->queue = apt_spsc_queue_create(RECORDER_BLOCK_COUNT,sizeof(recorder_block_t),pool);
+	file->block = NULL;
+	file->uncommitted = 0;
+	file->dropped = 0;
+	file->file = NULL;
+	file->encoder = NULL;
+	file->encoded = NULL;
+	file->written = 0;
+	/* allocated up front, the pool is used by the writer thread once signaled */
+	file->regions = index_size ? apr_palloc(pool,sizeof(recorder_region_t) * index_size) : NULL;
+	file->region_count = 0;
+	file->region_capacity = index_size;
+	file->pool = pool;
+
+	if(recorder_output_signal(file,RECORDER_MSG_OPEN) == FALSE) {
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+	return file;
+}
+
+/** Commit the block being filled (producer) */
+static void recorder_output_commit(recorder_output_t *file)
+{
+	apt_spsc_queue_write_commit(file->queue);
+	file->block = NULL;
+	if(++file->uncommitted >= RECORDER_BATCH_COUNT) {
+		file->uncommitted = 0;
+		recorder_output_signal(file,RECORDER_MSG_WRITE);
+	}
+}
+
+void recorder_output_write(recorder_output_t *file, const void *data, apr_size_t size)
+{
+	const char *pos = data;
+	while(size) {
+		apr_size_t chunk;
+		if(!file->block) {
+			file->block = apt_spsc_queue_write_begin(file->queue);
+			if(!file->block) {
+				if(!file->dropped) {
+					apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Record Overflow [%s]",file->file_path);
+				}
+				file->dropped += size;
+				return;
+			}
+			file->block->size = 0;
+		}
+		chunk = RECORDER_BLOCK_SIZE - file->block->size;
+		if(chunk > size) {
+			chunk = size;
+		}
+		memcpy(file->block->data + file->block->size,pos,chunk);
+		file->block->size += chunk;
+		pos += chunk;
+		size -= chunk;
+		if(file->block->size == RECORDER_BLOCK_SIZE) {
+			recorder_output_commit(file);
+		}
+	}
+}
+
+apt_bool_t recorder_output_index_add(recorder_output_t *file, apr_size_t input_time, apr_size_t output_time)
+{
+	recorder_region_t *region;
+	if(file->region_count >= file->region_capacity) {
+		return FALSE;
+	}
+	region = &file->regions[file->region_count++];
+	region->input_time = input_time;
+	region->output_time = output_time;
+	return TRUE;
+}
+
+apt_bool_t recorder_output_index_full(const recorder_output_t *file)
+{
+	return file->region_count >= file->region_capacity ? TRUE : FALSE;
+}
+
+void recorder_output_close(recorder_output_t *file)
+{
+	if(file->block) {
+		apt_spsc_queue_write_commit(file->queue);
+		file->block = NULL;
+	}
+	if(file->dropped) {
+		apt_log(RECORD_LOG_MARK,APT_PRIO_WARNING,"Dropped [%"APR_SIZE_T_FMT" bytes] of Record [%s]",
+			file->dropped,file->file_path);
+	}
+	recorder_output_signal(file,RECORDER_MSG_CLOSE);
+}
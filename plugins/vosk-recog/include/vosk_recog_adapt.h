@@ -0,0 +1,79 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef VOSK_RECOG_ADAPT_H
+#define VOSK_RECOG_ADAPT_H
+
+/**
+ * @file vosk_recog_adapt.h
+ * @brief Per-Caller Adaptation Store
+ *
+ * The Vosk API exposes no CMVN or i-vector statistics of a recognizer, so
+ * the speech of a caller is kept instead: a few seconds of voiced L16 audio
+ * per caller id, in an LRU of bounded size whose entries expire by TTL,
+ * optionally backed by one file per caller in a directory. The speech is
+ * passed to the recognizer of the next call of the caller ahead of the live
+ * audio, so that the online feature statistics start from those of the caller.
+ */
+
+#include <apr_time.h>
+#include "apt_string.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max length of a caller id */
+#define VOSK_RECOG_ADAPT_MAX_CALLER_ID 64
+
+/** Opaque adaptation store declaration */
+typedef struct vosk_recog_adapt_store_t vosk_recog_adapt_store_t;
+
+/**
+ * Create adaptation store, shared by all the channels.
+ * @param max_count the max number of callers kept in memory
+ * @param ttl the time the speech of a caller is kept for since it is stored
+ * @param dir the directory to keep the speech of callers in across restarts (NULL if kept in memory only)
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_adapt_store_t* vosk_recog_adapt_store_create(apr_size_t max_count, apr_interval_time_t ttl, const char *dir, apr_pool_t *pool);
+
+/** Destroy adaptation store */
+void vosk_recog_adapt_store_destroy(vosk_recog_adapt_store_t *store);
+
+/**
+ * Store speech of caller, replacing the one stored before.
+ * @param store the store to put the speech in
+ * @param caller_id the id of the caller
+ * @param sample_rate the sampling rate of the speech
+ * @param audio the speech (L16, host byte order)
+ * @param size the size of the speech
+ */
+apt_bool_t vosk_recog_adapt_store_put(vosk_recog_adapt_store_t *store, const char *caller_id, int sample_rate, const char *audio, apr_size_t size);
+
+/**
+ * Get speech of caller.
+ * @param store the store to look up the speech in
+ * @param caller_id the id of the caller
+ * @param sample_rate the sampling rate the speech is to be of
+ * @param buffer the buffer to copy the speech to
+ * @param capacity the size of the buffer
+ * @return the size of the speech copied, 0 if none is stored, it is expired or of another sampling rate
+ */
+apr_size_t vosk_recog_adapt_store_get(vosk_recog_adapt_store_t *store, const char *caller_id, int sample_rate, char *buffer, apr_size_t capacity);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_ADAPT_H */
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef VOSK_RECOG_AUDIO_H
+#define VOSK_RECOG_AUDIO_H
+
+/**
+ * @file vosk_recog_audio.h
+ * @brief Audio Input of Batch Recognition Requests
+ *
+ * Recorded audio is either carried by the body of RECOGNIZE (audio/L16,
+ * audio/wav) or referenced by a file URI, and is read by the decoder worker
+ * at decoder speed, bypassing the media stream of the session.
+ */
+
+#include <stdio.h>
+#include "apt_string.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Audio input of a batch request */
+typedef struct vosk_recog_audio_t vosk_recog_audio_t;
+struct vosk_recog_audio_t {
+	/** Audio of the body (NULL if audio is read from file) */
+	const char *data;
+	/** Size of audio of the body, or left to read from file */
+	apr_size_t  size;
+	/** File to read audio from (NULL if audio is in the body) */
+	FILE       *file;
+	/** Sampling rate of mono 16-bit linear samples (0 if unknown) */
+	int         sample_rate;
+	/** Whether samples are in network byte order (audio/L16), rather than little-endian */
+	apt_bool_t  big_endian;
+};
+
+/**
+ * Parse audio body.
+ * @param audio the audio to set
+ * @param content_type the content type of the body
+ * @param body the body
+ * @return FALSE if the body is not audio or the format is not supported
+ */
+apt_bool_t vosk_recog_audio_body_parse(vosk_recog_audio_t *audio, const apt_str_t *content_type, const apt_str_t *body);
+
+/**
+ * Open audio file, WAV or raw little-endian L16 (of unknown sampling rate).
+ * @param audio the audio to set
+ * @param path the path of the file
+ * @return FALSE if the file can not be opened or the format is not supported
+ */
+apt_bool_t vosk_recog_audio_file_open(vosk_recog_audio_t *audio, const char *path);
+
+/**
+ * Read audio converted to host byte order.
+ * @param audio the audio to read
+ * @param buffer the buffer to read to
+ * @param size the size of the buffer, which is a multiple of the sample size
+ * @return the size of audio read, 0 at the end of audio
+ */
+apr_size_t vosk_recog_audio_read(vosk_recog_audio_t *audio, char *buffer, apr_size_t size);
+
+/** Close audio, the file is closed if any */
+void vosk_recog_audio_close(vosk_recog_audio_t *audio);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_AUDIO_H */
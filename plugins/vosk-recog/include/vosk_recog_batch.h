@@ -0,0 +1,103 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_BATCH_H
+#define VOSK_RECOG_BATCH_H
+
+/**
+ * @file vosk_recog_batch.h
+ * @brief Batch (GPU) Decoding Backend
+ *
+ * Audio of all the active requests is collected by decoder workers into
+ * streams, which are pushed to the batch recognizers by one collector
+ * thread per cycle, so that the chunks of concurrent requests are decoded
+ * together by the batch model. Results are taken by the collector thread
+ * and handed back to the owners of the streams.
+ */
+
+#include "apt.h"
+#include "vosk_api.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque batch collector declaration */
+typedef struct vosk_recog_batch_t vosk_recog_batch_t;
+/** Opaque batch stream (one per request) declaration */
+typedef struct vosk_recog_batch_stream_t vosk_recog_batch_stream_t;
+
+/**
+ * Handler called from the collector thread once the result of a stream is available.
+ * @param stream the stream to take the result of by vosk_recog_batch_stream_result_take()
+ * @param obj the object the stream is opened with, which is guaranteed to be valid during the call
+ * @remark Must not block, nor call any other function of the stream.
+ */
+typedef void (*vosk_recog_batch_result_f)(vosk_recog_batch_stream_t *stream, void *obj);
+
+/**
+ * Create batch collector.
+ * @param cycle_time the interval (msec) pending audio is pushed at
+ * @param buffer_size the max size of audio pending per stream
+ * @param handler the handler of results
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_batch_t* vosk_recog_batch_create(apr_size_t cycle_time, apr_size_t buffer_size, vosk_recog_batch_result_f handler, apr_pool_t *pool);
+
+/** Start collector thread */
+apt_bool_t vosk_recog_batch_start(vosk_recog_batch_t *batch);
+
+/** Terminate collector thread and free the recognizers of the remaining streams */
+void vosk_recog_batch_terminate(vosk_recog_batch_t *batch);
+
+/**
+ * Free a batch model, as soon as the recognizers of the streams closed meanwhile are freed.
+ * @remark No stream must be opened of the model afterwards.
+ */
+void vosk_recog_batch_model_free(vosk_recog_batch_t *batch, VoskBatchModel *model);
+
+/**
+ * Open stream of a request.
+ * @param batch the collector to push audio by
+ * @param model the batch model to create recognizer of
+ * @param sample_rate the sampling rate of audio
+ * @param obj the object to pass to the result handler
+ */
+vosk_recog_batch_stream_t* vosk_recog_batch_stream_open(vosk_recog_batch_t *batch, VoskBatchModel *model, int sample_rate, void *obj);
+
+/**
+ * Write audio to stream (never blocks, audio is dropped if the collector lags behind).
+ * @return FALSE if audio is dropped
+ */
+apt_bool_t vosk_recog_batch_stream_write(vosk_recog_batch_stream_t *stream, const char *data, apr_size_t size);
+
+/** Mark the end of audio, so that the final result is produced */
+void vosk_recog_batch_stream_finish(vosk_recog_batch_stream_t *stream);
+
+/**
+ * Take the result signaled by the result handler.
+ * @param stream the stream passed to the result handler
+ * @param result the JSON result, valid till the stream is closed
+ * @return the object the stream is opened with, NULL if the stream is closed meanwhile
+ * @remark Must be called once per signaled result, the stream must not be referenced afterwards,
+ *         unless it is still open by the caller.
+ */
+void* vosk_recog_batch_stream_result_take(vosk_recog_batch_stream_t *stream, const char **result);
+
+/** Close stream, the stream must not be referenced afterwards */
+void vosk_recog_batch_stream_close(vosk_recog_batch_stream_t *stream);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_BATCH_H */
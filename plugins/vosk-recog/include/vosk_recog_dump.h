@@ -0,0 +1,70 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_DUMP_H
+#define VOSK_RECOG_DUMP_H
+
+/**
+ * @file vosk_recog_dump.h
+ * @brief Asynchronous Utterance Dump Writer
+ *
+ * Audio is copied to blocks of a lock-free queue by the producer and
+ * written to file by a background thread, so that no disk I/O is done
+ * in the context of either the media or the decoder threads.
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque dump writer (background thread) declaration */
+typedef struct vosk_recog_dump_writer_t vosk_recog_dump_writer_t;
+/** Opaque utterance dump declaration */
+typedef struct vosk_recog_dump_t vosk_recog_dump_t;
+
+/** Create dump writer */
+vosk_recog_dump_writer_t* vosk_recog_dump_writer_create(apr_pool_t *pool);
+
+/** Destroy dump writer */
+void vosk_recog_dump_writer_destroy(vosk_recog_dump_writer_t *writer);
+
+/** Start dump writer thread */
+apt_bool_t vosk_recog_dump_writer_start(vosk_recog_dump_writer_t *writer);
+
+/** Terminate dump writer thread (pending dumps are completed first) */
+apt_bool_t vosk_recog_dump_writer_terminate(vosk_recog_dump_writer_t *writer);
+
+/**
+ * Open utterance dump (file is opened asynchronously).
+ * @param writer the writer to write dump by
+ * @param file_path the path of the file to write to
+ * @param sample_rate the sampling rate of L16 mono audio
+ * @param wav whether to write WAV header
+ */
+vosk_recog_dump_t* vosk_recog_dump_open(vosk_recog_dump_writer_t *writer, const char *file_path, int sample_rate, apt_bool_t wav);
+
+/**
+ * Write audio to dump (never blocks, audio is dropped if the writer lags behind).
+ * @remark Must be called from one and the same thread at a time
+ */
+void vosk_recog_dump_write(vosk_recog_dump_t *dump, const void *data, apr_size_t size);
+
+/** Close dump, the dump must not be referenced afterwards */
+void vosk_recog_dump_close(vosk_recog_dump_t *dump);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_DUMP_H */
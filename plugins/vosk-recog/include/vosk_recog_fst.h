@@ -0,0 +1,137 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_FST_H
+#define VOSK_RECOG_FST_H
+
+/**
+ * @file vosk_recog_fst.h
+ * @brief Word-level FST Compiled from SRGS (XML, ABNF) and JSGF Grammars
+ *
+ * Rules are expanded from the root rule into a transducer, which accepts
+ * the word sequences of the grammar and outputs the <tag> (or {tag}) of
+ * each path, so that a hypothesis is both checked against the grammar and
+ * interpreted. Supported are rules and local rule references, one-of and
+ * alternatives, repeat and optional expansions, tags and the special rules
+ * NULL, VOID and GARBAGE.
+ *
+ * The FST is a single position-independent image, which is shared
+ * read-only by all the channels of the grammar, and which may be saved to
+ * a file and mapped back instead of compiled again.
+ *
+ * Image layout (host byte order, 32-bit fields)
+ *    header: "VFST", version, size, start, state count, arc count, symbol count,
+ *            source length
+ *    states: first arc, arc count (the top bit is set for final states)
+ *    arcs:   input symbol (0 - epsilon), output symbol (0 - none), next state
+ *    symbols: offset of the symbol in the strings (words and tags)
+ *    strings: nul-terminated words (lowercase) and tags
+ *    source: the document compiled (saved images only, past the size of the image)
+ */
+
+#include <apr_xml.h>
+#include "apt_string.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max number of phrases enumerated for constrained decoding, beyond that words are listed instead */
+#define VOSK_RECOG_FST_MAX_PHRASES 500
+
+/** Opaque FST declaration */
+typedef struct vosk_recog_fst_t vosk_recog_fst_t;
+
+/**
+ * Compile FST of SRGS XML grammar.
+ * @param doc the parsed document, the root of which is <grammar>
+ * @param pool the pool to allocate the FST from
+ * @return the FST, NULL if the grammar has no root rule or references external rules
+ */
+vosk_recog_fst_t* vosk_recog_fst_xml_compile(const apr_xml_doc *doc, apr_pool_t *pool);
+
+/** Check whether the body is an SRGS ABNF ("#ABNF") or JSGF ("#JSGF") grammar */
+apt_bool_t vosk_recog_fst_text_check(const char *buf, apr_size_t length);
+
+/**
+ * Compile FST of SRGS ABNF or JSGF grammar.
+ * @param buf the grammar document
+ * @param length the length of the document
+ * @param pool the pool to allocate the FST from
+ */
+vosk_recog_fst_t* vosk_recog_fst_text_compile(const char *buf, apr_size_t length, apr_pool_t *pool);
+
+/**
+ * Save FST image to file, replacing the previous one at once.
+ * @param fst the FST to save
+ * @param source the document the FST is compiled from, saved along to be compared on mapping
+ * @param length the length of the document
+ * @param path the path to the file
+ * @param pool the pool to allocate temporary memory from
+ */
+apt_bool_t vosk_recog_fst_save(vosk_recog_fst_t *fst, const char *source, apr_size_t length, const char *path, apr_pool_t *pool);
+
+/**
+ * Map FST image from file read-only.
+ * @param path the path to the file
+ * @param source the document the FST is to be compiled from, compared byte for byte with the one saved
+ * @param length the length of the document
+ * @param pool the pool to allocate the FST from, the file is unmapped on its cleanup
+ * @return the FST, NULL if there is no valid image of the document
+ */
+vosk_recog_fst_t* vosk_recog_fst_map(const char *path, const char *source, apr_size_t length, apr_pool_t *pool);
+
+/** Get the number of states of FST */
+apr_size_t vosk_recog_fst_state_count_get(const vosk_recog_fst_t *fst);
+
+/** Get the size of the image of FST in bytes */
+apr_size_t vosk_recog_fst_size_get(const vosk_recog_fst_t *fst);
+
+/**
+ * Get phrases to constrain decoding by.
+ * @param fst the FST to enumerate
+ * @param phrases the array (const char*) to append phrases to
+ * @param pool the pool to allocate phrases from
+ * @return TRUE if the phrases are the sentences of the grammar, FALSE if they are its words
+ *         (the grammar is cyclic, has more than VOSK_RECOG_FST_MAX_PHRASES sentences or GARBAGE)
+ */
+apt_bool_t vosk_recog_fst_phrases_get(const vosk_recog_fst_t *fst, apr_array_header_t *phrases, apr_pool_t *pool);
+
+/**
+ * Interpret text by FST.
+ * @param fst the FST to match the text against
+ * @param text the words to match (case insensitive)
+ * @param instance the XML content of the instance built of the tags of the path (NULL if there are none)
+ * @param pool the pool to allocate the instance from
+ * @return TRUE if the text is accepted by the grammar
+ * @remark Tags are taken as semantic literals, or as SISR assignments of string or number
+ *         literals to "out" or to its properties (out.name="value"), the last assignment wins.
+ */
+apt_bool_t vosk_recog_fst_interpret(const vosk_recog_fst_t *fst, const char *text, const char **instance, apr_pool_t *pool);
+
+/**
+ * Normalize text by FST, such as an inverse text normalization grammar.
+ * @param fst the FST to rewrite spans of the text by
+ * @param text the words to normalize (case insensitive)
+ * @param pool the pool to allocate the normalized text from
+ * @return the XML content of the normalized text, NULL if no span is rewritten
+ * @remark The longest span accepted by the FST from the leftmost word on (up to 16 words) is
+ *         replaced by the tags of its path concatenated, as in "twenty five" {2}{5}, the words
+ *         no span starts with are kept.
+ */
+const char* vosk_recog_fst_normalize(const vosk_recog_fst_t *fst, const char *text, apr_pool_t *pool);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_FST_H */
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_GRAMMAR_H
+#define VOSK_RECOG_GRAMMAR_H
+
+/**
+ * @file vosk_recog_grammar.h
+ * @brief Compiled Grammar Matcher for Early Results
+ *
+ * Each <item> of a <rule> is compiled once, when the grammar is defined,
+ * and matched against partial results in document order. The rules are
+ * compiled to an FST as well (see vosk_recog_fst.h), which constrains the
+ * decoding and interprets final results; SRGS ABNF and JSGF grammars are
+ * compiled to the FST only. Compiled grammars are immutable and shared by
+ * all the channels defining the same body.
+ */
+
+#include "apt_string.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default max number of grammars kept in the cache */
+#define VOSK_RECOG_GRAMMAR_CACHE_DEFAULT_SIZE 100
+
+/** Max number of digits collected against a DTMF grammar */
+#define VOSK_RECOG_DTMF_MAX_DIGITS 32
+
+/** Opaque compiled grammar declaration */
+typedef struct vosk_recog_grammar_t vosk_recog_grammar_t;
+/** Opaque cache of compiled grammars declaration */
+typedef struct vosk_recog_grammar_cache_t vosk_recog_grammar_cache_t;
+/** Opaque inverse text normalization grammar declaration */
+typedef struct vosk_recog_itn_t vosk_recog_itn_t;
+/** Built-in DTMF grammar declaration */
+typedef struct vosk_recog_dtmf_grammar_t vosk_recog_dtmf_grammar_t;
+
+/** Built-in DTMF grammar (builtin:dtmf/digits or builtin:dtmf/boolean) */
+struct vosk_recog_dtmf_grammar_t {
+	/** Min number of digits */
+	apr_size_t min_length;
+	/** Max number of digits */
+	apr_size_t max_length;
+	/** Whether the grammar is builtin:dtmf/boolean (1 - true, 2 - false) */
+	apt_bool_t boolean;
+	/** Digit which terminates input (NUL if none) */
+	char       term_char;
+};
+
+/** Result of matching digits against DTMF grammar */
+typedef enum {
+	VOSK_RECOG_DTMF_MATCH_PARTIAL, /**< the digits are a prefix of a match, more may follow */
+	VOSK_RECOG_DTMF_MATCH_FULL,    /**< the digits match, no more may follow */
+	VOSK_RECOG_DTMF_MATCH_NONE     /**< the digits do not match */
+} vosk_recog_dtmf_match_e;
+
+/**
+ * Create cache of compiled grammars.
+ * @param max_count the max number of grammars to keep (unreferenced ones are evicted beyond that)
+ * @param fst_dir the directory to save FST images to and map them from (NULL or empty if none)
+ * @param fst_max_count the max number of FST images kept in the directory, the least recently
+ *        used ones are removed beyond that (0 if unbounded)
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_grammar_cache_t* vosk_recog_grammar_cache_create(apr_size_t max_count, const char *fst_dir, apr_size_t fst_max_count, apr_pool_t *pool);
+
+/** Destroy cache of compiled grammars */
+void vosk_recog_grammar_cache_destroy(vosk_recog_grammar_cache_t *cache);
+
+/**
+ * Get compiled grammar, compile the body if not cached yet.
+ * @param cache the cache to look up grammar in
+ * @param body the grammar document (SRGS XML, SRGS ABNF or JSGF)
+ * @return the grammar referenced on behalf of the caller, or NULL on failure
+ */
+vosk_recog_grammar_t* vosk_recog_grammar_cache_get(vosk_recog_grammar_cache_t *cache, const apt_str_t *body);
+
+/**
+ * Get compiled grammar of the body of a message, looked up by the id of the interned body, if any.
+ * @param cache the cache to look up grammar in
+ * @param body the grammar document (SRGS XML, SRGS ABNF or JSGF)
+ * @param body_id the id of the interned body (mrcp_message_t::body_id, 0 if not interned)
+ * @return the grammar referenced on behalf of the caller, or NULL on failure
+ */
+vosk_recog_grammar_t* vosk_recog_grammar_cache_body_get(vosk_recog_grammar_cache_t *cache, const apt_str_t *body, apr_uint32_t body_id);
+
+/**
+ * Get compiled grammar of the document at path, compile it if not cached yet.
+ * @param cache the cache to look up grammar in
+ * @param path the path to the grammar document (SRGS XML, SRGS ABNF or JSGF)
+ * @return the grammar referenced on behalf of the caller, or NULL if the document fails to load or compile
+ */
+vosk_recog_grammar_t* vosk_recog_grammar_cache_load(vosk_recog_grammar_cache_t *cache, const char *path);
+
+/** Add reference to grammar */
+void vosk_recog_grammar_ref(vosk_recog_grammar_t *grammar);
+
+/** Remove reference from grammar (may be called from any thread) */
+void vosk_recog_grammar_unref(vosk_recog_grammar_t *grammar);
+
+/** Get hash of the grammar document, the same for the grammars compiled from the same body */
+apr_uint32_t vosk_recog_grammar_hash_get(const vosk_recog_grammar_t *grammar);
+
+/**
+ * Get vocabulary of grammar.
+ * @return the JSON list of phrases for vosk_recognizer_new_grm(), or NULL if the grammar
+ *         has items which are not plain phrases
+ */
+const char* vosk_recog_grammar_phrases_get(const vosk_recog_grammar_t *grammar);
+
+/** Get number of phrases of the vocabulary of grammar (0 if the vocabulary is not a phrase list) */
+apr_size_t vosk_recog_grammar_phrase_count_get(const vosk_recog_grammar_t *grammar);
+
+/** Get estimated memory footprint of grammar in bytes */
+apr_size_t vosk_recog_grammar_size_get(const vosk_recog_grammar_t *grammar);
+
+/** Check whether grammar is compiled to an FST, which interprets final results */
+apt_bool_t vosk_recog_grammar_fst_check(const vosk_recog_grammar_t *grammar);
+
+/**
+ * Interpret text by the FST of grammar (vosk_recog_nlsml_interpret_f).
+ * @param obj the grammar
+ * @param text the text of the final result
+ * @param pool the pool to allocate the instance from
+ * @return the XML content of the instance, NULL if the grammar has no tags on the path or rejects the text
+ */
+const char* vosk_recog_grammar_interpret(const void *obj, const char *text, apr_pool_t *pool);
+
+/**
+ * Load inverse text normalization grammar, the tags of which are the written forms of its phrases.
+ * @param cache the cache the FST image is saved to and mapped from, as grammar FSTs are
+ * @param path the path to the grammar document (SRGS XML, SRGS ABNF or JSGF)
+ * @param pool the pool to allocate the grammar from
+ * @return the grammar, NULL if the document fails to load or compile
+ */
+vosk_recog_itn_t* vosk_recog_itn_load(vosk_recog_grammar_cache_t *cache, const char *path, apr_pool_t *pool);
+
+/**
+ * Normalize text by inverse text normalization grammar (vosk_recog_nlsml_interpret_f).
+ * @param obj the ITN grammar
+ * @param text the text of the final result
+ * @param pool the pool to allocate the instance from
+ * @return the XML content of the instance (the written form), NULL if the text is left as is
+ */
+const char* vosk_recog_itn_interpret(const void *obj, const char *text, apr_pool_t *pool);
+
+/**
+ * Match text against grammar.
+ * @param grammar the grammar to match
+ * @param text the text to match
+ * @return the id of the first matching rule, or NULL
+ */
+const char* vosk_recog_grammar_match(const vosk_recog_grammar_t *grammar, const char *text);
+
+/**
+ * Find built-in DTMF grammar referenced by RECOGNIZE request.
+ * @param body the body of the request (text/uri-list or text/grammar-ref-list)
+ * @param grammar the grammar to fill (the term char is left intact)
+ * @return TRUE if the body references a DTMF grammar
+ * @remark Parameters of the URI are given as in "builtin:dtmf/digits?minlength=3;maxlength=5".
+ */
+apt_bool_t vosk_recog_dtmf_grammar_parse(const apt_str_t *body, vosk_recog_dtmf_grammar_t *grammar);
+
+/**
+ * Find grammar referenced by a network URI (http:// or https://) or by the id of a precompiled one
+ * (session: or builtin:grammar/).
+ * @param body the body of the request (text/uri-list or text/grammar-ref-list)
+ * @param pool the pool to allocate the URI from
+ * @return the first URI of the list, NULL if none
+ */
+const char* vosk_recog_grammar_uri_get(const apt_str_t *body, apr_pool_t *pool);
+
+/**
+ * Match digits collected so far against DTMF grammar.
+ * @param grammar the grammar to match
+ * @param digits the digits, the term char included
+ * @param length the number of digits
+ * @param timeout whether no more digits are expected (inter-digit timeout expired)
+ */
+vosk_recog_dtmf_match_e vosk_recog_dtmf_grammar_match(const vosk_recog_dtmf_grammar_t *grammar, const char *digits, apr_size_t length, apt_bool_t timeout);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_GRAMMAR_H */
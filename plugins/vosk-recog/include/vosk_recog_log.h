@@ -0,0 +1,37 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_LOG_H
+#define VOSK_RECOG_LOG_H
+
+/**
+ * @file vosk_recog_log.h
+ * @brief Log Source of Vosk Recognizer Plugin
+ */
+
+#include "apt_log.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Custom log source of the plugin (implemented in vosk_recog_engine.c) */
+extern apt_log_source_t *RECOG_PLUGIN;
+
+/** Use custom log source mark */
+#define RECOG_LOG_MARK   APT_LOG_MARK_DECLARE(RECOG_PLUGIN)
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_LOG_H */
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_MODEL_H
+#define VOSK_RECOG_MODEL_H
+
+/**
+ * @file vosk_recog_model.h
+ * @brief Registry of Vosk Models
+ *
+ * Models are configured by engine params in unimrcpserver.xml
+ *    <param name="model.en.path" value="/opt/vosk/model-en"/>
+ *    <param name="model.en.language" value="en-US,en-GB"/>
+ *    <param name="model.en.sample-rate" value="16000"/>
+ *    <param name="model.en-fast.path" value="/opt/vosk/model-en"/>
+ *    <param name="model.en-fast.beam" value="8"/>
+ *    <param name="model.en-fast.max-active" value="2000"/>
+ *    <param name="model.en-fast.speed-vs-accuracy" value="0.2"/>
+ *    <param name="model.en-small.path" value="/opt/vosk/model-en-small"/>
+ *    <param name="model.en-small.capacity" value="200"/>
+ *    <param name="model.en-small.recognizer-memory" value="20971520"/>
+ *    <param name="model-rule.closed" value="en-small,en"/>
+ *    <param name="model-rule.open" value="en"/>
+ *    <param name="default-model" value="en"/>
+ *    <param name="model-cache" value="true"/>
+ *    <param name="huge-pages" value="true"/>
+ *    <param name="numa" value="replicate"/>
+ *    <param name="model-watch-interval" value="30"/>
+ *
+ * In the model cache mode, the files of a model are mapped read-only and shared
+ * before the model is loaded, so that the model is parsed from the page cache,
+ * which is kept warm across server processes and restarts.
+ *
+ * With huge pages, the anonymous mappings a model is loaded to are advised to be
+ * backed by transparent huge pages (and so are the mapped files in the model
+ * cache mode), since the weights and the FSTs are read at random while decoding.
+ * It takes effect if transparent huge pages are set to "madvise" or "always".
+ *
+ * In the replicate NUMA mode, each model is loaded once per node by a loader
+ * thread preferring the memory of the node, so that decoders read the replica
+ * local to the CPU they run on. In the interleave mode, one copy is spread
+ * across all the nodes.
+ *
+ * If the directories of models are watched, a changed directory (replaced,
+ * re-linked or touched) is loaded as a new version of the model in the
+ * background. New requests are switched to the new version at once, while
+ * the requests in progress keep their references to the previous version,
+ * which is freed once the last of them is complete.
+ *
+ * The decoder search settings (beam, lattice-beam, max-active and frame-subsampling-factor)
+ * are read from conf/model.conf once a model is loaded, and cannot be changed per
+ * recognizer. If any of them is overridden, by a model param or by the engine param
+ * of the same name, the model is loaded from an overlay directory in the var dir,
+ * which links the files of the model directory and holds a rewritten conf/model.conf.
+ * Models sharing the same path are variants of each other, one of which is selected
+ * per request by the Speed-vs-Accuracy header. Each variant is a model loaded on its own.
+ *
+ * Rules map a class of requests (the class of the grammar, "closed" or "open", or a
+ * prompt class named by the client) to the models to use in order of preference. The
+ * capacity of a model bounds the number of requests decoded by it at once, a request
+ * taking a seat of the configured model till completion; a rule falls back to the next
+ * model, once the seats of one are all taken.
+ *
+ * The recognizer memory of a model is the estimated footprint (bytes) of a recognizer
+ * created from it, which is charged to the session and the engine for the duration of
+ * a request, since the Vosk API reports no size of its own.
+ */
+
+#include <apr_tables.h>
+#include <apr_hash.h>
+#include <apr_file_info.h>
+#include "mrcp_engine_types.h"
+#include "vosk_api.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Path of the model used if no model is configured */
+#define VOSK_RECOG_DEFAULT_MODEL_PATH "/opt/kaldi/model"
+/** Name of the model used if no model is configured */
+#define VOSK_RECOG_DEFAULT_MODEL_NAME "default"
+/** Default max number of models loaded at once */
+#define VOSK_RECOG_MODEL_LOAD_THREADS 4
+
+/** Placement of models on NUMA nodes */
+typedef enum {
+	VOSK_RECOG_NUMA_NONE,       /**< memory is placed by the default policy */
+	VOSK_RECOG_NUMA_REPLICATE,  /**< one replica per node */
+	VOSK_RECOG_NUMA_INTERLEAVE  /**< one copy interleaved across the nodes */
+} vosk_recog_numa_mode_e;
+
+/** Decoder search settings of a model (0 if taken from conf/model.conf) */
+typedef struct vosk_recog_model_search_t vosk_recog_model_search_t;
+
+struct vosk_recog_model_search_t {
+	/** Decoding beam */
+	float beam;
+	/** Lattice generation beam */
+	float lattice_beam;
+	/** Max number of active states */
+	int   max_active;
+	/** Frame subsampling factor of the acoustic model */
+	int   frame_subsampling_factor;
+};
+
+/** Opaque registry of models declaration */
+typedef struct vosk_recog_model_registry_t vosk_recog_model_registry_t;
+/** Model declaration */
+typedef struct vosk_recog_model_t vosk_recog_model_t;
+
+/** Configured model */
+struct vosk_recog_model_t {
+	/** Unique name of the model */
+	const char         *name;
+	/** Path to the model directory */
+	const char         *path;
+	/** Array of languages (const char*) served by the model */
+	apr_array_header_t *languages;
+	/** Native sampling rate of the model (0 if not specified) */
+	int                 sample_rate;
+	/** Decoder search settings overriding the ones of conf/model.conf */
+	vosk_recog_model_search_t search;
+	/** Speed vs accuracy among the variants sharing the path (0.0 fastest, 1.0 most accurate) */
+	float               speed_vs_accuracy;
+	/** Path the model is loaded from (the overlay directory, if search settings are overridden) */
+	const char         *load_path;
+	/** Loaded model (NULL in the batch decoding mode) */
+	VoskModel          *model;
+	/** Loaded batch model (NULL unless in the batch decoding mode) */
+	VoskBatchModel     *batch_model;
+	/** Pool of the mappings of the model files (NULL if the model cache is disabled) */
+	apr_pool_t         *map_pool;
+	/** Total size of the mapped model files */
+	apr_size_t          mapped_size;
+	/** Replicas per NUMA node, the first one being the model itself (NULL if not replicated) */
+	vosk_recog_model_t **replicas;
+	/** Number of replicas */
+	apr_size_t          replica_count;
+	/** NUMA node the model is placed on (APT_NUMA_NODE_NONE if not placed) */
+	int                 numa_node;
+	/** Current version of the configured model, replaced on reload (configured model only) */
+	vosk_recog_model_t * volatile current;
+	/** Number of references to the version (the registry while current, and each request) */
+	volatile apr_uint32_t refs;
+	/** Inode of the directory the version is loaded from */
+	apr_ino_t           inode;
+	/** Modification time of the directory the version is loaded from */
+	apr_time_t          mtime;
+	/** Max number of requests decoded at once (0 if unlimited, configured model only) */
+	apr_uint32_t        capacity;
+	/** Estimated memory footprint of a recognizer (0 if not accounted) */
+	apr_size_t          recognizer_memory;
+	/** Number of seats taken by requests (configured model only) */
+	volatile apr_uint32_t seats;
+};
+
+/**
+ * Create registry of models from engine params.
+ * @param engine the engine to get params of
+ * @param pool the pool to allocate memory from
+ * @return the registry, NULL on failure
+ */
+vosk_recog_model_registry_t* vosk_recog_model_registry_create(const mrcp_engine_t *engine, apr_pool_t *pool);
+
+/**
+ * Handler called from the loader thread once a model is loaded.
+ * @param model the loaded model
+ * @param obj the object passed to vosk_recog_model_registry_load()
+ */
+typedef void (*vosk_recog_model_load_handler_f)(vosk_recog_model_t *model, void *obj);
+
+/**
+ * Load all the models (blocking, must not be called from the context of the server or media task).
+ * @param registry the registry to load models of
+ * @param thread_count the max number of models loaded at once (the calling thread is one of the loaders)
+ * @param handler the handler to call once a model is loaded (NULL if none)
+ * @param obj the object to call the handler with
+ * @return TRUE if all the models are loaded
+ */
+apt_bool_t vosk_recog_model_registry_load(vosk_recog_model_registry_t *registry, apr_size_t thread_count, vosk_recog_model_load_handler_f handler, void *obj);
+
+/** Free all the loaded models (the versions replaced on reload must be released already) */
+void vosk_recog_model_registry_unload(vosk_recog_model_registry_t *registry);
+
+/**
+ * Handler called once the last reference to a replaced version is dropped (from the context it is dropped in).
+ * @param model the version, or a replica of, to be freed
+ * @param obj the object passed to vosk_recog_model_registry_watch_start()
+ * @remark The recognizers of the version must be freed by the handler.
+ */
+typedef void (*vosk_recog_model_free_handler_f)(vosk_recog_model_t *model, void *obj);
+
+/**
+ * Start watching the directories of models and reload the changed ones in the background.
+ * @param registry the registry to watch models of
+ * @param interval the interval the directories are checked at
+ * @param load_handler the handler to call once a new version is loaded, before it is current (NULL if none)
+ * @param free_handler the handler to call before a replaced version is freed (NULL if none)
+ * @param obj the object to call the handlers with
+ */
+apt_bool_t vosk_recog_model_registry_watch_start(
+				vosk_recog_model_registry_t *registry,
+				apr_interval_time_t interval,
+				vosk_recog_model_load_handler_f load_handler,
+				vosk_recog_model_free_handler_f free_handler,
+				void *obj);
+
+/** Stop watching the directories of models (waits for a reload in progress) */
+void vosk_recog_model_registry_watch_stop(vosk_recog_model_registry_t *registry);
+
+/**
+ * Get the current version of a configured model and reference it.
+ * @param registry the registry the model is configured in
+ * @param model the configured model, as found in the registry
+ * @return the current version, to be released by vosk_recog_model_release()
+ */
+vosk_recog_model_t* vosk_recog_model_acquire(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model);
+
+/**
+ * Drop the reference to a version.
+ * @param registry the registry the model is configured in
+ * @param model the version returned by vosk_recog_model_acquire(), or a replica of
+ */
+void vosk_recog_model_release(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model);
+
+/** Load batch models instead of regular ones (must be called before load) */
+void vosk_recog_model_registry_batch_enable(vosk_recog_model_registry_t *registry);
+
+/**
+ * Set placement of models on NUMA nodes (must be called before load).
+ * @param registry the registry to set placement of
+ * @param mode the placement mode
+ * @param node_count the number of nodes to replicate models to
+ */
+void vosk_recog_model_registry_numa_set(vosk_recog_model_registry_t *registry, vosk_recog_numa_mode_e mode, apr_size_t node_count);
+
+/**
+ * Get the replica of a model local to a NUMA node.
+ * @param model the model to get replica of
+ * @param numa_node the node to get replica for
+ * @return the replica, or the model itself if not replicated
+ */
+vosk_recog_model_t* vosk_recog_model_replica_get(vosk_recog_model_t *model, int numa_node);
+
+/** Find model by name */
+vosk_recog_model_t* vosk_recog_model_find(const vosk_recog_model_registry_t *registry, const char *name);
+
+/**
+ * Find model by language.
+ * @param registry the registry to search in
+ * @param language the language to find model for
+ * @param sample_rate the sampling rate of the session (0 if any)
+ * @remark Exact (case-insensitive) match is preferred, then primary language subtag ("en" for "en-US");
+ *         among models of the same match, the one with the native sampling rate is preferred.
+ */
+vosk_recog_model_t* vosk_recog_model_find_by_language(const vosk_recog_model_registry_t *registry, const char *language, int sample_rate);
+
+/**
+ * Find the variant of a model closest to the requested speed vs accuracy.
+ * @param registry the registry to search in
+ * @param model the model to find variant of
+ * @param speed_vs_accuracy the requested speed vs accuracy (0.0 fastest, 1.0 most accurate)
+ * @return the variant sharing the path and sampling rate of the model, or the model itself
+ */
+vosk_recog_model_t* vosk_recog_model_variant_find(const vosk_recog_model_registry_t *registry, vosk_recog_model_t *model, float speed_vs_accuracy);
+
+/**
+ * Get sampling rates the models are fit for.
+ * @return the mask of mpf_sample_rates_e (all the supported rates, if any model has no native rate set)
+ */
+int vosk_recog_model_sample_rates_get(const vosk_recog_model_registry_t *registry);
+
+/** Get array of models (vosk_recog_model_t*) in order of configuration */
+const apr_array_header_t* vosk_recog_model_list_get(const vosk_recog_model_registry_t *registry);
+
+/** Get default model */
+vosk_recog_model_t* vosk_recog_model_default_get(const vosk_recog_model_registry_t *registry);
+
+/**
+ * Find model by rule and take a seat of it.
+ * @param registry the registry to search in
+ * @param class_name the class of the request ("closed", "open" or a prompt class)
+ * @param language the language the model is to serve (NULL if any)
+ * @return the first model of the rule serving the language with a seat free,
+ *         NULL if there is no rule for the class or no such model
+ */
+vosk_recog_model_t* vosk_recog_model_rule_find(const vosk_recog_model_registry_t *registry, const char *class_name, const char *language);
+
+/** Check whether there is a rule for a class of requests */
+apt_bool_t vosk_recog_model_rule_check(const vosk_recog_model_registry_t *registry, const char *class_name);
+
+/**
+ * Take a seat of a configured model.
+ * @return FALSE if the seats are all taken
+ */
+apt_bool_t vosk_recog_model_seat_take(vosk_recog_model_t *model);
+
+/** Return the seat taken of a configured model */
+void vosk_recog_model_seat_return(vosk_recog_model_t *model);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_MODEL_H */
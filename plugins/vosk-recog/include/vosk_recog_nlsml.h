@@ -0,0 +1,133 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_NLSML_H
+#define VOSK_RECOG_NLSML_H
+
+/**
+ * @file vosk_recog_nlsml.h
+ * @brief NLSML Result Builder
+ *
+ * The JSON result of the recognizer is scanned in place and the NLSML
+ * document is written at once into a buffer of the exact size, allocated
+ * from the pool of the message it is the body of.
+ */
+
+#include "apt_string.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Max number of interpretations in the result */
+#define VOSK_RECOG_NLSML_MAX_INTERPRETATIONS 10
+/** Default max number of results kept in the cache */
+#define VOSK_RECOG_NLSML_CACHE_DEFAULT_SIZE 256
+/** Max size of the recognizer result cached */
+#define VOSK_RECOG_NLSML_CACHE_MAX_RESULT 256
+
+/** Opaque cache of rendered NLSML results declaration */
+typedef struct vosk_recog_nlsml_cache_t vosk_recog_nlsml_cache_t;
+
+/** Declaration of result options */
+typedef struct vosk_recog_result_options_t vosk_recog_result_options_t;
+
+/**
+ * Function to interpret the text of an interpretation by.
+ * @param obj the object the function is set along with
+ * @param text the text (unescaped)
+ * @param pool the pool to allocate the instance from
+ * @return the XML content of the instance, NULL to take the text as the instance
+ */
+typedef const char* (*vosk_recog_nlsml_interpret_f)(const void *obj, const char *text, apr_pool_t *pool);
+
+/** Options of the result of a request, which also set what the recognizer computes */
+struct vosk_recog_result_options_t {
+	/** Max number of interpretations (1 - the top hypothesis only, no alternatives are computed) */
+	apr_size_t n_best;
+	/** Whether to list the words of each interpretation with their timings */
+	apt_bool_t word_timings;
+	/** Whether to compute the confidence of the top hypothesis from word confidences, without listing the words */
+	apt_bool_t confidence_only;
+	/** Confidence interpretations are rejected below (0 if none is rejected) */
+	float      confidence_threshold;
+	/** Function to build the instances of interpretations by (NULL if the text is the instance) */
+	vosk_recog_nlsml_interpret_f interpret;
+	/** Object to pass to the function */
+	const void                  *interpret_obj;
+};
+
+/**
+ * Build NLSML result.
+ * @param json the final result of the recognizer (JSON, with or without alternatives)
+ * @param early the id of the rule matched by a partial result (NULL if none)
+ * @param options the options of the result
+ * @param body the body to build
+ * @param rejected whether all the interpretations are below the confidence threshold, the body is not built then
+ * @param pool the pool to allocate the body from
+ * @remark The confidence of an interpretation is omitted, if the recognizer computed none;
+ *         such an interpretation is never rejected.
+ */
+apt_bool_t vosk_recog_nlsml_build(const char *json, const char *early, const vosk_recog_result_options_t *options, apt_str_t *body, apt_bool_t *rejected, apr_pool_t *pool);
+
+/**
+ * Create cache of rendered NLSML results, shared by all the channels.
+ * @param max_count the max number of results to keep (the least recently used ones are evicted beyond that)
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_nlsml_cache_t* vosk_recog_nlsml_cache_create(apr_size_t max_count, apr_pool_t *pool);
+
+/** Destroy cache of rendered NLSML results */
+void vosk_recog_nlsml_cache_destroy(vosk_recog_nlsml_cache_t *cache);
+
+/**
+ * Build NLSML result, or take the one rendered for the same grammar, early result and recognizer result.
+ * @param cache the cache to look up the result in
+ * @param grammar_hash the hash of the grammar of the request
+ * @remark Only the results of the top hypothesis with neither words nor confidences are cached,
+ *         as are those of closed-grammar prompts; the others are built by vosk_recog_nlsml_build().
+ * @see vosk_recog_nlsml_build() for the rest of the params
+ */
+apt_bool_t vosk_recog_nlsml_cache_build(vosk_recog_nlsml_cache_t *cache, apr_uint32_t grammar_hash, const char *json, const char *early, const vosk_recog_result_options_t *options, apt_str_t *body, apt_bool_t *rejected, apr_pool_t *pool);
+
+/**
+ * Build NLSML result of DTMF input.
+ * @param digits the digits matched, the term char excluded
+ * @param instance the interpretation of the digits
+ * @param body the body to build
+ * @param pool the pool to allocate the body from
+ */
+apt_bool_t vosk_recog_nlsml_dtmf_build(const char *digits, const char *instance, apt_str_t *body, apr_pool_t *pool);
+
+/**
+ * Get the speaker vector (x-vector) computed along with the result.
+ * @param json the final result of the recognizer with a speaker model set
+ * @param vector the vector to fill
+ * @param max_size the max size of the vector
+ * @param frames the number of frames the vector is computed over
+ * @return the size of the vector, 0 if none
+ */
+apr_size_t vosk_recog_nlsml_speaker_vector_get(const char *json, float *vector, apr_size_t max_size, apr_size_t *frames);
+
+/**
+ * Get the confidence of the top hypothesis, the way it is reported in the NLSML result.
+ * @param json the final result of the recognizer (JSON, with or without alternatives)
+ * @param confidence the confidence to get
+ * @return FALSE if the recognizer computed none
+ */
+apt_bool_t vosk_recog_nlsml_confidence_get(const char *json, double *confidence);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_NLSML_H */
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_POOL_H
+#define VOSK_RECOG_POOL_H
+
+/**
+ * @file vosk_recog_pool.h
+ * @brief Pool of Reusable Vosk Recognizers
+ *
+ * Idle recognizers are kept per (model, sample rate, grammar) and reset
+ * before they are handed out again, so that no recognizer is built on
+ * the path of a RECOGNIZE request once the pool is warmed up.
+ */
+
+#include "vosk_recog_model.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque pool of recognizers declaration */
+typedef struct vosk_recog_pool_t vosk_recog_pool_t;
+
+/**
+ * Create pool of recognizers.
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_pool_t* vosk_recog_pool_create(apr_pool_t *pool);
+
+/** Free all the idle recognizers */
+void vosk_recog_pool_destroy(vosk_recog_pool_t *recog_pool);
+
+/**
+ * Build recognizers in advance (blocking).
+ * @param recog_pool the pool to put recognizers to
+ * @param model the model to build recognizers for
+ * @param sample_rate the sampling rate
+ * @param grammar the JSON list of phrases to constrain recognizers by (NULL for free-form)
+ * @param count the number of idle recognizers to have on return
+ */
+apt_bool_t vosk_recog_pool_warm(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar, apr_size_t count);
+
+/**
+ * Borrow an idle recognizer or build a new one, if there is none.
+ * @param recog_pool the pool to borrow recognizer from
+ * @param model the model to borrow recognizer for
+ * @param sample_rate the sampling rate
+ * @param grammar the JSON list of phrases to constrain recognizer by (NULL for free-form)
+ */
+VoskRecognizer* vosk_recog_pool_acquire(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar);
+
+/**
+ * Reset recognizer and return it to the pool.
+ * @remark The arguments must be the same the recognizer has been acquired with
+ */
+void vosk_recog_pool_release(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar, VoskRecognizer *recognizer);
+
+/**
+ * Set speaker model to the recognizers built afterwards.
+ * @remark Must be set before any recognizer is built, the model must outlive the pool.
+ */
+void vosk_recog_pool_speaker_model_set(vosk_recog_pool_t *recog_pool, VoskSpkModel *spk_model);
+
+/**
+ * Free the idle recognizers of a model, which is not to be acquired for anymore.
+ * @remark Called once the recognizers in use are returned, so that none is left of the model.
+ */
+void vosk_recog_pool_purge(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model);
+
+/** Get the number of idle recognizers */
+apr_size_t vosk_recog_pool_idle_count_get(vosk_recog_pool_t *recog_pool);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_POOL_H */
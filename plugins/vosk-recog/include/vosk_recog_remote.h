@@ -0,0 +1,119 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef VOSK_RECOG_REMOTE_H
+#define VOSK_RECOG_REMOTE_H
+
+/**
+ * @file vosk_recog_remote.h
+ * @brief Remote Decoding Backend (Decoder Farm)
+ *
+ * Audio of each request is streamed to one of a farm of remote decoders
+ * speaking the WebSocket protocol of vosk-server, so that the MRCP node
+ * holds no models and the decoders are scaled on their own. Connections
+ * are owned by one client thread, which routes each stream to the least
+ * loaded decoder in service, keeps warm (handshaken) connections to each
+ * decoder ahead of requests, and checks idle connections and decoders out
+ * of service at the check interval. The first final result of a stream,
+ * or its failure, is handed back to the owner of the stream.
+ */
+
+#include "apt.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Opaque remote client declaration */
+typedef struct vosk_recog_remote_t vosk_recog_remote_t;
+/** Opaque remote stream (one per request) declaration */
+typedef struct vosk_recog_remote_stream_t vosk_recog_remote_stream_t;
+
+/**
+ * Handler called from the client thread once the result of a stream is available.
+ * @param stream the stream to take the result of by vosk_recog_remote_stream_result_take()
+ * @param obj the object the stream is opened with, which is guaranteed to be valid during the call
+ * @remark Must not block, nor call any other function of the stream.
+ */
+typedef void (*vosk_recog_remote_result_f)(vosk_recog_remote_stream_t *stream, void *obj);
+
+/**
+ * Create remote client.
+ * @param max_streams the max number of streams open at once
+ * @param buffer_size the max size of audio pending per stream
+ * @param handler the handler of results
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_remote_t* vosk_recog_remote_create(apr_size_t max_streams, apr_size_t buffer_size, vosk_recog_remote_result_f handler, apr_pool_t *pool);
+
+/** Destroy remote client, once terminated */
+void vosk_recog_remote_destroy(vosk_recog_remote_t *remote);
+
+/**
+ * Add remote decoder to the farm.
+ * @param remote the remote client
+ * @param uri the WebSocket URI of the decoder (ws://host:port[/path])
+ */
+apt_bool_t vosk_recog_remote_decoder_add(vosk_recog_remote_t *remote, const char *uri);
+
+/**
+ * Set connection policy.
+ * @param remote the remote client
+ * @param idle_count the number of warm connections kept per decoder
+ * @param connect_timeout the timeout (msec) of connection and send
+ * @param check_interval the interval (msec) idle connections and decoders out of service are checked at
+ */
+void vosk_recog_remote_pool_set(vosk_recog_remote_t *remote, apr_size_t idle_count, apr_size_t connect_timeout, apr_size_t check_interval);
+
+/** Start client thread */
+apt_bool_t vosk_recog_remote_start(vosk_recog_remote_t *remote);
+
+/** Terminate client thread and close all the connections */
+void vosk_recog_remote_terminate(vosk_recog_remote_t *remote);
+
+/**
+ * Open stream of a request.
+ * @param remote the client to stream audio by
+ * @param sample_rate the sampling rate of audio
+ * @param options the JSON members added to the config of the decoder (e.g. "words" : true), NULL if none
+ * @param obj the object to pass to the result handler
+ */
+vosk_recog_remote_stream_t* vosk_recog_remote_stream_open(vosk_recog_remote_t *remote, int sample_rate, const char *options, void *obj);
+
+/**
+ * Write audio to stream (never blocks, audio is dropped if the connection lags behind).
+ * @return FALSE if audio is dropped
+ */
+apt_bool_t vosk_recog_remote_stream_write(vosk_recog_remote_stream_t *stream, const char *data, apr_size_t size);
+
+/** Mark the end of audio, so that the final result is produced */
+void vosk_recog_remote_stream_finish(vosk_recog_remote_stream_t *stream);
+
+/**
+ * Take the result signaled by the result handler.
+ * @param stream the stream passed to the result handler
+ * @param result the JSON result, valid till the stream is closed, NULL if decoding failed
+ * @return the object the stream is opened with, NULL if the stream is closed meanwhile
+ * @remark Must be called once per signaled result, the stream must not be referenced afterwards,
+ *         unless it is still open by the caller.
+ */
+void* vosk_recog_remote_stream_result_take(vosk_recog_remote_stream_t *stream, const char **result);
+
+/** Close stream, the stream must not be referenced afterwards */
+void vosk_recog_remote_stream_close(vosk_recog_remote_stream_t *stream);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_REMOTE_H */
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VOSK_RECOG_WORKER_H
+#define VOSK_RECOG_WORKER_H
+
+/**
+ * @file vosk_recog_worker.h
+ * @brief Pool of Decoder Worker Threads
+ */
+
+#include "apt_task.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Default number of decoder worker threads */
+#define VOSK_RECOG_WORKER_DEFAULT_COUNT 1
+/** Default max number of objects marked ready per worker at once */
+#define VOSK_RECOG_WORKER_DEFAULT_READY_SIZE 1024
+
+/** Opaque decoder worker declaration */
+typedef struct vosk_recog_worker_t vosk_recog_worker_t;
+/** Opaque pool of decoder workers declaration */
+typedef struct vosk_recog_worker_pool_t vosk_recog_worker_pool_t;
+
+/** Prototype of job handler, invoked in the context of the worker thread */
+typedef void (*vosk_recog_worker_job_f)(vosk_recog_worker_t *worker, int type, void *obj);
+
+/** Prototype of handler of gathered objects, invoked in the context of the worker thread */
+typedef void (*vosk_recog_worker_gather_f)(vosk_recog_worker_t *worker, void **objs, apr_size_t count);
+
+/**
+ * Create pool of decoder workers.
+ * @param count the number of worker threads
+ * @param handler the job handler
+ * @param pool the pool to allocate memory from
+ */
+vosk_recog_worker_pool_t* vosk_recog_worker_pool_create(apr_size_t count, vosk_recog_worker_job_f handler, apr_pool_t *pool);
+
+/** Destroy pool of decoder workers */
+void vosk_recog_worker_pool_destroy(vosk_recog_worker_pool_t *worker_pool);
+
+/** Start worker threads */
+apt_bool_t vosk_recog_worker_pool_start(vosk_recog_worker_pool_t *worker_pool);
+
+/** Terminate worker threads (wait till complete) */
+apt_bool_t vosk_recog_worker_pool_terminate(vosk_recog_worker_pool_t *worker_pool);
+
+/**
+ * Bind the counter of jobs signaled, but not taken by the workers yet.
+ * @param worker_pool the pool to count jobs of
+ * @param backlog the counter to maintain (the backlog of the engine)
+ * @remark To be called before the workers are started.
+ */
+void vosk_recog_worker_pool_backlog_bind(vosk_recog_worker_pool_t *worker_pool, volatile apr_uint32_t *backlog);
+
+/**
+ * Enable gathering of objects by the workers, so that the work of many objects is done back-to-back.
+ * @param worker_pool the pool of workers
+ * @param max_count the max number of objects gathered by a worker before they are handled
+ * @param handler the handler of gathered objects
+ * @param pool the pool to allocate memory from
+ * @remark To be called before any job is signaled.
+ */
+apt_bool_t vosk_recog_worker_pool_gather_enable(vosk_recog_worker_pool_t *worker_pool, apr_size_t max_count, vosk_recog_worker_gather_f handler, apr_pool_t *pool);
+
+/**
+ * Enable ready lists, so that marking an object ready wakes its worker at most once per pass.
+ * @param worker_pool the pool of workers
+ * @param type the job type ready objects are handled as
+ * @param max_count the max number of objects marked ready per worker at once
+ * @param pool the pool to allocate memory from
+ * @remark To be called before the workers are started.
+ */
+apt_bool_t vosk_recog_worker_pool_ready_enable(vosk_recog_worker_pool_t *worker_pool, int type, apr_size_t max_count, apr_pool_t *pool);
+
+/**
+ * Enable work stealing, so that an idle worker takes ready objects queued to busy workers of its node.
+ * @param worker_pool the pool of workers, ready lists of which are enabled
+ * @param pool the pool to allocate memory from
+ * @remark To be called before any job is signaled. The job handler may then be called for an object
+ *         by a worker other than the one it is marked ready for, though by one worker at a time.
+ */
+apt_bool_t vosk_recog_worker_pool_steal_enable(vosk_recog_worker_pool_t *worker_pool, apr_pool_t *pool);
+
+/** Get the number of worker threads */
+apr_size_t vosk_recog_worker_pool_count_get(const vosk_recog_worker_pool_t *worker_pool);
+
+/** Get the task of the worker by index (to set the affinity and priority before it's started) */
+apt_task_t* vosk_recog_worker_pool_task_get(const vosk_recog_worker_pool_t *worker_pool, apr_size_t index);
+
+/**
+ * Pin the thread of the worker to a single CPU.
+ * @param worker_pool the pool of workers
+ * @param index the index of the worker
+ * @param cpu the CPU to pin the worker to
+ * @remark To be called before the workers are started.
+ */
+apt_bool_t vosk_recog_worker_pool_cpu_set(vosk_recog_worker_pool_t *worker_pool, apr_size_t index, int cpu);
+
+/**
+ * Pin a new channel to the least loaded worker of those closest to its media.
+ * @param worker_pool the pool to pick worker from
+ * @param cpu the CPU to prefer workers pinned to (-1 for any)
+ * @param numa_node the node to prefer workers of next (APT_NUMA_NODE_NONE for any)
+ * @remark The returned worker must be released by vosk_recog_worker_release()
+ */
+vosk_recog_worker_t* vosk_recog_worker_assign(vosk_recog_worker_pool_t *worker_pool, int cpu, int numa_node);
+
+/** Unpin a channel from the worker */
+void vosk_recog_worker_release(vosk_recog_worker_t *worker);
+
+/** Pin a channel unpinned by vosk_recog_worker_release() back to the worker */
+void vosk_recog_worker_retain(vosk_recog_worker_t *worker);
+
+/**
+ * Signal a job to the worker.
+ * @param worker the worker to signal job to
+ * @param type the application specific job type
+ * @param obj the object associated with the job
+ * @remark May be called from any thread (including the MPF scheduler)
+ */
+apt_bool_t vosk_recog_worker_signal(vosk_recog_worker_t *worker, int type, void *obj);
+
+/**
+ * Mark an object ready, to be handled as a job of the type ready lists are enabled with.
+ * @param worker the worker to mark object ready for
+ * @param obj the object, which must not be marked again till its job is taken
+ * @return FALSE if the worker could not be woken up, the object may then be marked again
+ *         and its job may be taken twice
+ * @remark The worker is woken up by the first object marked since its last pass only, then it
+ *         handles all the objects marked meanwhile at once. May be called from any thread.
+ */
+apt_bool_t vosk_recog_worker_ready(vosk_recog_worker_t *worker, void *obj);
+
+/**
+ * Gather an object to be handled along with others, once the worker has no more jobs pending
+ * or the max number of objects is gathered.
+ * @remark To be called from the job handler only.
+ */
+void vosk_recog_worker_gather(vosk_recog_worker_t *worker, void *obj);
+
+/** Handle the objects gathered so far at once (to be called from the job handler only) */
+void vosk_recog_worker_gather_flush(vosk_recog_worker_t *worker);
+
+/**
+ * Record the time the worker is busy with decoding.
+ * @param worker the worker to record busy time of
+ * @param now the current time
+ * @param busy_time the time spent decoding since the previous record
+ * @remark To be called from the job handler only.
+ */
+void vosk_recog_worker_busy_record(vosk_recog_worker_t *worker, apr_time_t now, apr_interval_time_t busy_time);
+
+/** Get the load (permille of the wall-clock time busy with decoding, over the last second) of the worker */
+apr_uint32_t vosk_recog_worker_load_get(const vosk_recog_worker_t *worker);
+
+/** Get the NUMA node the worker is placed on (APT_NUMA_NODE_NONE if not placed) */
+int vosk_recog_worker_numa_node_get(const vosk_recog_worker_t *worker);
+
+/** Get the CPU the worker is pinned to (-1 if not pinned to a single CPU) */
+int vosk_recog_worker_cpu_get(const vosk_recog_worker_t *worker);
+
+/** Get the sequence number of the worker within the pool */
+apr_size_t vosk_recog_worker_id_get(const vosk_recog_worker_t *worker);
+
+APT_END_EXTERN_C
+
+#endif /* VOSK_RECOG_WORKER_H */
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <apr_strings.h>
+#include <apr_hash.h>
+#include <apr_ring.h>
+#include <apr_thread_mutex.h>
+#include <apr_file_io.h>
+#include "vosk_recog_adapt.h"
+#include "vosk_recog_log.h"
+
+/** Version of the file format */
+#define VOSK_RECOG_ADAPT_VERSION 1
+/** Max size of the path of a file */
+#define VOSK_RECOG_ADAPT_MAX_PATH 1024
+/** Max size of the speech of a caller read from file (60 sec of 16 kHz L16) */
+#define VOSK_RECOG_ADAPT_MAX_SIZE (60 * 16000 * 2)
+
+/** Header of the file the speech of a caller is kept in, followed by the caller id and the speech */
+typedef struct vosk_recog_adapt_header_t vosk_recog_adapt_header_t;
+struct vosk_recog_adapt_header_t {
+	/** "VADP" */
+	char         magic[4];
+	/** Version of the format */
+	apr_uint32_t version;
+	/** Sampling rate of the speech */
+	apr_uint32_t sample_rate;
+	/** Length of the caller id */
+	apr_uint32_t key_length;
+	/** Size of the speech */
+	apr_uint32_t size;
+	/** Reserved, zero */
+	apr_uint32_t reserved;
+	/** Time the speech is stored at */
+	apr_int64_t  stored_at;
+};
+
+/** Speech of a caller in the store, allocated along with its key and audio */
+typedef struct vosk_recog_adapt_entry_t vosk_recog_adapt_entry_t;
+struct vosk_recog_adapt_entry_t {
+	/** Ring entry, the most recently used first */
+	APR_RING_ENTRY(vosk_recog_adapt_entry_t) link;
+	/** Caller id */
+	const char  *key;
+	/** Length of the caller id */
+	apr_size_t   key_length;
+	/** Sampling rate of the speech */
+	int          sample_rate;
+	/** Time the speech is stored at */
+	apr_time_t   stored_at;
+	/** Speech (L16, host byte order) */
+	const char  *audio;
+	/** Size of the speech */
+	apr_size_t   size;
+};
+
+/** Store of the speech of callers */
+struct vosk_recog_adapt_store_t {
+	/** Table of entries by caller id */
+	apr_hash_t         *table;
+	/** Ring of entries in order of use */
+	APR_RING_HEAD(vosk_recog_adapt_ring_t, vosk_recog_adapt_entry_t) lru;
+	/** Max number of entries to keep */
+	apr_size_t          max_count;
+	/** Time entries are kept for (0 if not expired) */
+	apr_interval_time_t ttl;
+	/** Directory entries are kept in across restarts (NULL if not kept) */
+	const char         *dir;
+	/** Guards the table and the ring (entries are put and got by all the decoder workers) */
+	apr_thread_mutex_t *mutex;
+};
+
+vosk_recog_adapt_store_t* vosk_recog_adapt_store_create(apr_size_t max_count, apr_interval_time_t ttl, const char *dir, apr_pool_t *pool)
+{
+	vosk_recog_adapt_store_t *store = apr_palloc(pool,sizeof(vosk_recog_adapt_store_t));
+	store->table = apr_hash_make(pool);
+	APR_RING_INIT(&store->lru,vosk_recog_adapt_entry_t,link);
+	store->max_count = max_count;
+	store->ttl = ttl;
+	store->dir = NULL;
+	if(dir && *dir) {
+		if(apr_dir_make_recursive(dir,APR_OS_DEFAULT,pool) == APR_SUCCESS) {
+			store->dir = apr_pstrdup(pool,dir);
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Adaptation Dir [%s]",dir);
+		}
+	}
+	if(apr_thread_mutex_create(&store->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return store;
+}
+
+void vosk_recog_adapt_store_destroy(vosk_recog_adapt_store_t *store)
+{
+	while(!APR_RING_EMPTY(&store->lru,vosk_recog_adapt_entry_t,link)) {
+		vosk_recog_adapt_entry_t *entry = APR_RING_FIRST(&store->lru);
+		APR_RING_REMOVE(entry,link);
+		free(entry);
+	}
+	apr_hash_clear(store->table);
+	apr_thread_mutex_destroy(store->mutex);
+}
+
+/** Allocate entry along with its key and audio */
+static vosk_recog_adapt_entry_t* vosk_recog_adapt_entry_create(const char *key, apr_size_t key_length, int sample_rate, apr_time_t stored_at, apr_size_t size)
+{
+	vosk_recog_adapt_entry_t *entry = malloc(sizeof(vosk_recog_adapt_entry_t) + key_length + 1 + size);
+	if(!entry) {
+		return NULL;
+	}
+	entry->key = (char*)(entry + 1);
+	entry->key_length = key_length;
+	memcpy((char*)entry->key,key,key_length);
+	((char*)entry->key)[key_length] = '\0';
+	entry->sample_rate = sample_rate;
+	entry->stored_at = stored_at;
+	entry->audio = entry->key + key_length + 1;
+	entry->size = size;
+	return entry;
+}
+
+/** Check whether entry stored at the time is expired */
+static APR_INLINE apt_bool_t vosk_recog_adapt_expired(const vosk_recog_adapt_store_t *store, apr_time_t stored_at, apr_time_t now)
+{
+	return (store->ttl && now - stored_at > store->ttl) ? TRUE : FALSE;
+}
+
+/** Remove entry from the table and the ring, and free it (the mutex is held) */
+static void vosk_recog_adapt_entry_remove(vosk_recog_adapt_store_t *store, vosk_recog_adapt_entry_t *entry)
+{
+	APR_RING_REMOVE(entry,link);
+	apr_hash_set(store->table,entry->key,entry->key_length,NULL);
+	free(entry);
+}
+
+/** Insert entry, replacing the one of the same caller and evicting the least recently used one (the mutex is held) */
+static void vosk_recog_adapt_entry_insert(vosk_recog_adapt_store_t *store, vosk_recog_adapt_entry_t *entry)
+{
+	vosk_recog_adapt_entry_t *prev = apr_hash_get(store->table,entry->key,entry->key_length);
+	if(prev) {
+		vosk_recog_adapt_entry_remove(store,prev);
+	}
+	if(apr_hash_count(store->table) >= store->max_count && !APR_RING_EMPTY(&store->lru,vosk_recog_adapt_entry_t,link)) {
+		vosk_recog_adapt_entry_remove(store,APR_RING_LAST(&store->lru));
+	}
+	APR_RING_INSERT_HEAD(&store->lru,entry,vosk_recog_adapt_entry_t,link);
+	apr_hash_set(store->table,entry->key,entry->key_length,entry);
+}
+
+/** Compose the path of the file of caller, named by the hash of the caller id, which the file holds to tell collisions apart */
+static apt_bool_t vosk_recog_adapt_path_get(const vosk_recog_adapt_store_t *store, const char *key, apr_size_t key_length, char *path)
+{
+	apr_ssize_t length = (apr_ssize_t)key_length;
+	apr_uint32_t hash = apr_hashfunc_default(key,&length);
+	int size = apr_snprintf(path,VOSK_RECOG_ADAPT_MAX_PATH,"%s/%08x.adapt",store->dir,hash);
+	return (size > 0 && size < VOSK_RECOG_ADAPT_MAX_PATH) ? TRUE : FALSE;
+}
+
+/** Save entry to file */
+static void vosk_recog_adapt_entry_save(const vosk_recog_adapt_store_t *store, const vosk_recog_adapt_entry_t *entry)
+{
+	vosk_recog_adapt_header_t header;
+	char path[VOSK_RECOG_ADAPT_MAX_PATH];
+	char tmp_path[VOSK_RECOG_ADAPT_MAX_PATH + 32];
+	apt_bool_t status;
+	FILE *file;
+	if(vosk_recog_adapt_path_get(store,entry->key,entry->key_length,path) == FALSE) {
+		return;
+	}
+	apr_snprintf(tmp_path,sizeof(tmp_path),"%s.%pp.tmp",path,(void*)entry);
+	file = fopen(tmp_path,"wb");
+	if(!file) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Adaptation File [%s]",tmp_path);
+		return;
+	}
+	memcpy(header.magic,"VADP",4);
+	header.version = VOSK_RECOG_ADAPT_VERSION;
+	header.sample_rate = (apr_uint32_t)entry->sample_rate;
+	header.key_length = (apr_uint32_t)entry->key_length;
+	header.size = (apr_uint32_t)entry->size;
+	header.reserved = 0;
+	header.stored_at = entry->stored_at;
+	status = (fwrite(&header,sizeof(header),1,file) == 1 &&
+		fwrite(entry->key,1,entry->key_length,file) == entry->key_length &&
+		fwrite(entry->audio,1,entry->size,file) == entry->size) ? TRUE : FALSE;
+	if(fclose(file) != 0) {
+		status = FALSE;
+	}
+	/* renamed once complete, so that no partial file is ever read */
+	if(status == FALSE || rename(tmp_path,path) != 0) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Save Adaptation File [%s]",path);
+		remove(tmp_path);
+	}
+}
+
+/** Load entry of caller from file, NULL if there is none, or it is expired or invalid */
+static vosk_recog_adapt_entry_t* vosk_recog_adapt_entry_load(const vosk_recog_adapt_store_t *store, const char *key, apr_size_t key_length)
+{
+	vosk_recog_adapt_header_t header;
+	vosk_recog_adapt_entry_t *entry;
+	char path[VOSK_RECOG_ADAPT_MAX_PATH];
+	char stored_key[VOSK_RECOG_ADAPT_MAX_CALLER_ID];
+	FILE *file;
+	if(vosk_recog_adapt_path_get(store,key,key_length,path) == FALSE) {
+		return NULL;
+	}
+	file = fopen(path,"rb");
+	if(!file) {
+		return NULL;
+	}
+	if(fread(&header,sizeof(header),1,file) != 1 || memcmp(header.magic,"VADP",4) != 0 ||
+		header.version != VOSK_RECOG_ADAPT_VERSION || header.key_length != key_length ||
+		key_length > sizeof(stored_key) || header.size > VOSK_RECOG_ADAPT_MAX_SIZE || header.size % 2 != 0 ||
+		fread(stored_key,1,key_length,file) != key_length) {
+		fclose(file);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Invalid Adaptation File [%s]",path);
+		return NULL;
+	}
+	if(memcmp(stored_key,key,key_length) != 0) {
+		/* another caller of the same hash */
+		fclose(file);
+		return NULL;
+	}
+	if(vosk_recog_adapt_expired(store,header.stored_at,apr_time_now()) == TRUE) {
+		fclose(file);
+		remove(path);
+		return NULL;
+	}
+	entry = vosk_recog_adapt_entry_create(key,key_length,(int)header.sample_rate,header.stored_at,header.size);
+	if(entry && fread((char*)entry->audio,1,entry->size,file) != entry->size) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Truncated Adaptation File [%s]",path);
+		free(entry);
+		entry = NULL;
+	}
+	fclose(file);
+	return entry;
+}
+
+apt_bool_t vosk_recog_adapt_store_put(vosk_recog_adapt_store_t *store, const char *caller_id, int sample_rate, const char *audio, apr_size_t size)
+{
+	vosk_recog_adapt_entry_t *entry;
+	apr_size_t key_length = strlen(caller_id);
+	if(!key_length || key_length > VOSK_RECOG_ADAPT_MAX_CALLER_ID || !size) {
+		return FALSE;
+	}
+	entry = vosk_recog_adapt_entry_create(caller_id,key_length,sample_rate,apr_time_now(),size);
+	if(!entry) {
+		return FALSE;
+	}
+	memcpy((char*)entry->audio,audio,size);
+	if(store->dir) {
+		/* saved ahead of insertion, the entry may be evicted by another worker once inserted */
+		vosk_recog_adapt_entry_save(store,entry);
+	}
+
+	apr_thread_mutex_lock(store->mutex);
+	vosk_recog_adapt_entry_insert(store,entry);
+	apr_thread_mutex_unlock(store->mutex);
+	return TRUE;
+}
+
+apr_size_t vosk_recog_adapt_store_get(vosk_recog_adapt_store_t *store, const char *caller_id, int sample_rate, char *buffer, apr_size_t capacity)
+{
+	vosk_recog_adapt_entry_t *entry;
+	vosk_recog_adapt_entry_t *loaded;
+	apr_size_t key_length = strlen(caller_id);
+	apr_size_t size = 0;
+	if(!key_length || key_length > VOSK_RECOG_ADAPT_MAX_CALLER_ID) {
+		return 0;
+	}
+
+	apr_thread_mutex_lock(store->mutex);
+	entry = apr_hash_get(store->table,caller_id,key_length);
+	if(entry && vosk_recog_adapt_expired(store,entry->stored_at,apr_time_now()) == TRUE) {
+		vosk_recog_adapt_entry_remove(store,entry);
+		entry = NULL;
+	}
+	if(!entry && store->dir) {
+		/* read without holding the mutex, another worker may load the same caller meanwhile */
+		apr_thread_mutex_unlock(store->mutex);
+		loaded = vosk_recog_adapt_entry_load(store,caller_id,key_length);
+		if(!loaded) {
+			return 0;
+		}
+		apr_thread_mutex_lock(store->mutex);
+		entry = apr_hash_get(store->table,caller_id,key_length);
+		if(entry) {
+			/* stored or loaded by another worker in the meantime */
+			free(loaded);
+		}
+		else {
+			vosk_recog_adapt_entry_insert(store,loaded);
+			entry = loaded;
+		}
+	}
+	if(entry) {
+		/* the most recently used entry goes first */
+		APR_RING_REMOVE(entry,link);
+		APR_RING_INSERT_HEAD(&store->lru,entry,vosk_recog_adapt_entry_t,link);
+		if(entry->sample_rate == sample_rate) {
+			/* whole samples only */
+			size = (entry->size < capacity ? entry->size : capacity) & ~(apr_size_t)1;
+			memcpy(buffer,entry->audio,size);
+		}
+	}
+	apr_thread_mutex_unlock(store->mutex);
+	return size;
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "vosk_recog_audio.h"
+#include "vosk_recog_log.h"
+
+/** Size of the start of a file the WAV header is looked up in */
+#define VOSK_RECOG_AUDIO_HEADER_SIZE 4096
+/** Min and max sampling rates accepted */
+#define VOSK_RECOG_AUDIO_MIN_RATE    8000
+#define VOSK_RECOG_AUDIO_MAX_RATE    48000
+
+static APR_INLINE apr_uint32_t le32_get(const unsigned char *p)
+{
+	return (apr_uint32_t)p[0] | ((apr_uint32_t)p[1] << 8) | ((apr_uint32_t)p[2] << 16) | ((apr_uint32_t)p[3] << 24);
+}
+
+static APR_INLINE apr_uint16_t le16_get(const unsigned char *p)
+{
+	return (apr_uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * Look the mono 16-bit PCM format and the data chunk up in a WAV header.
+ * @return -1 if there is no RIFF header, 0 if the format is not supported, 1 otherwise
+ */
+static int vosk_recog_wav_parse(const unsigned char *buf, apr_size_t size, int *sample_rate, apr_size_t *offset, apr_size_t *length)
+{
+	apr_size_t pos = 12;
+	apt_bool_t fmt = FALSE;
+	if(size < 12 || memcmp(buf,"RIFF",4) != 0 || memcmp(buf + 8,"WAVE",4) != 0) {
+		return -1;
+	}
+	while(pos + 8 <= size) {
+		const unsigned char *chunk = buf + pos;
+		apr_uint32_t chunk_size = le32_get(chunk + 4);
+		pos += 8;
+		if(memcmp(chunk,"fmt ",4) == 0) {
+			if(chunk_size < 16 || pos + 16 > size) {
+				return 0;
+			}
+			/* PCM (1) or extensible (0xFFFE), mono, 16 bits per sample */
+			if((le16_get(buf + pos) != 1 && le16_get(buf + pos) != 0xFFFE) ||
+				le16_get(buf + pos + 2) != 1 || le16_get(buf + pos + 14) != 16) {
+				return 0;
+			}
+			*sample_rate = (int)le32_get(buf + pos + 4);
+			fmt = TRUE;
+		}
+		else if(memcmp(chunk,"data",4) == 0) {
+			if(fmt == FALSE) {
+				return 0;
+			}
+			*offset = pos;
+			/* the size is not known by the writer of a stream */
+			*length = (chunk_size && chunk_size != 0xFFFFFFFF) ? chunk_size : (apr_size_t)-1;
+			return 1;
+		}
+		/* chunks are word aligned */
+		pos += chunk_size + (chunk_size & 1);
+	}
+	return 0;
+}
+
+static apt_bool_t vosk_recog_audio_rate_check(const vosk_recog_audio_t *audio)
+{
+	if(audio->sample_rate && (audio->sample_rate < VOSK_RECOG_AUDIO_MIN_RATE || audio->sample_rate > VOSK_RECOG_AUDIO_MAX_RATE)) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported Sampling Rate of Audio [%d]",audio->sample_rate);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_bool_t vosk_recog_audio_body_parse(vosk_recog_audio_t *audio, const apt_str_t *content_type, const apt_str_t *body)
+{
+	const char *type = content_type->buf;
+	audio->data = NULL;
+	audio->size = 0;
+	audio->file = NULL;
+	audio->sample_rate = 0;
+	audio->big_endian = FALSE;
+	if(!type || !body->buf) {
+		return FALSE;
+	}
+
+	if(strncasecmp(type,"audio/L16",9) == 0) {
+		/* RFC 2586, the rate param is mandatory, but the rate of the session is used if missing */
+		const char *rate = strstr(type,"rate=");
+		if(rate) {
+			audio->sample_rate = atoi(rate + 5);
+		}
+		audio->data = body->buf;
+		audio->size = body->length & ~(apr_size_t)1;
+		audio->big_endian = TRUE;
+	}
+	else if(strncasecmp(type,"audio/wav",9) == 0 ||
+			strncasecmp(type,"audio/x-wav",11) == 0 ||
+			strncasecmp(type,"audio/wave",10) == 0) {
+		apr_size_t offset = 0;
+		apr_size_t length = 0;
+		if(vosk_recog_wav_parse((const unsigned char*)body->buf,body->length,&audio->sample_rate,&offset,&length) != 1) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported WAV Body, mono 16-bit PCM expected");
+			return FALSE;
+		}
+		if(length > body->length - offset) {
+			length = body->length - offset;
+		}
+		audio->data = body->buf + offset;
+		audio->size = length & ~(apr_size_t)1;
+	}
+	else {
+		return FALSE;
+	}
+	return vosk_recog_audio_rate_check(audio);
+}
+
+apt_bool_t vosk_recog_audio_file_open(vosk_recog_audio_t *audio, const char *path)
+{
+	unsigned char header[VOSK_RECOG_AUDIO_HEADER_SIZE];
+	apr_size_t offset = 0;
+	apr_size_t length = (apr_size_t)-1;
+	apr_size_t size;
+	int status;
+
+	audio->data = NULL;
+	audio->size = 0;
+	audio->sample_rate = 0;
+	audio->big_endian = FALSE;
+	/* read by stdio, as the file is closed by the decoder worker, which has no pool */
+	audio->file = fopen(path,"rb");
+	if(!audio->file) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Audio File [%s]",path);
+		return FALSE;
+	}
+
+	size = fread(header,1,sizeof(header),audio->file);
+	status = vosk_recog_wav_parse(header,size,&audio->sample_rate,&offset,&length);
+	if(status == 0) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported WAV File [%s], mono 16-bit PCM expected",path);
+		vosk_recog_audio_close(audio);
+		return FALSE;
+	}
+	if(status < 0) {
+		/* raw L16 of the sampling rate of the session */
+		offset = 0;
+	}
+	if(vosk_recog_audio_rate_check(audio) == FALSE || fseek(audio->file,(long)offset,SEEK_SET) != 0) {
+		vosk_recog_audio_close(audio);
+		return FALSE;
+	}
+	audio->size = length;
+	return TRUE;
+}
+
+apr_size_t vosk_recog_audio_read(vosk_recog_audio_t *audio, char *buffer, apr_size_t size)
+{
+	apt_bool_t swap;
+	if(size > audio->size) {
+		size = audio->size & ~(apr_size_t)1;
+	}
+	if(!size) {
+		return 0;
+	}
+
+	if(audio->file) {
+		size = fread(buffer,1,size,audio->file) & ~(apr_size_t)1;
+	}
+	else {
+		memcpy(buffer,audio->data,size);
+		audio->data += size;
+	}
+	audio->size -= size;
+
+#if APR_IS_BIGENDIAN
+	swap = audio->big_endian == TRUE ? FALSE : TRUE;
+#else
+	swap = audio->big_endian;
+#endif
+	if(swap == TRUE) {
+		apr_size_t i;
+		char byte;
+		for(i=0; i<size; i+=2) {
+			byte = buffer[i];
+			buffer[i] = buffer[i+1];
+			buffer[i+1] = byte;
+		}
+	}
+	return size;
+}
+
+void vosk_recog_audio_close(vosk_recog_audio_t *audio)
+{
+	if(audio->file) {
+		fclose(audio->file);
+		audio->file = NULL;
+	}
+	audio->data = NULL;
+	audio->size = 0;
+}
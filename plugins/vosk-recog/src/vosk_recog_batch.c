@@ -0,0 +1,417 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_ring.h>
+#include <apr_tables.h>
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include "vosk_recog_batch.h"
+#include "vosk_recog_log.h"
+
+#define VOSK_RECOG_BATCH_THREAD_NAME "Vosk Batch Collector"
+
+/** Stream of a request */
+struct vosk_recog_batch_stream_t {
+	/** Ring entry (active or idle streams) */
+	APR_RING_ENTRY(vosk_recog_batch_stream_t) link;
+	/** Collector the stream is pushed by */
+	vosk_recog_batch_t       *batch;
+	/** Batch recognizer (collector context after open) */
+	VoskBatchRecognizer      *recognizer;
+	/** Batch model the recognizer is created of */
+	VoskBatchModel           *model;
+	/** Guards the fields shared by the owner and the collector */
+	apr_thread_mutex_t       *mutex;
+	/** Object the stream is opened with (NULL once closed) */
+	void                     *obj;
+	/** Audio pending to push */
+	char                     *buffer;
+	/** Size of pending audio */
+	apr_size_t                length;
+	/** Whether the end of audio is marked */
+	apt_bool_t                finished;
+	/** Whether the stream is closed by the owner */
+	apt_bool_t                closed;
+	/** Whether audio dropped on overflow is already reported (owner context) */
+	apt_bool_t                dropped;
+	/** Buffer audio is pushed from, swapped with the pending one (collector context) */
+	char                     *spare;
+	/** Whether the end of audio is pushed (collector context) */
+	apt_bool_t                finish_sent;
+	/** Whether the result is handed to the owner (collector context) */
+	apt_bool_t                delivered;
+	/** Result handed to the owner */
+	char                     *result;
+	/** Number of references (owner, collector, signaled result) */
+	volatile apr_uint32_t     refs;
+};
+
+typedef APR_RING_HEAD(vosk_recog_batch_ring_t, vosk_recog_batch_stream_t) vosk_recog_batch_ring_t;
+
+/** Batch collector */
+struct vosk_recog_batch_t {
+	/** Ring of streams pushed by the collector */
+	vosk_recog_batch_ring_t   active;
+	/** Ring of streams to reuse */
+	vosk_recog_batch_ring_t   idle;
+	/** Array of replaced models (VoskBatchModel*) to free once their streams are gone */
+	apr_array_header_t       *retired;
+	/** Guards the rings and the retired models */
+	apr_thread_mutex_t       *mutex;
+	/** Collector thread */
+	apr_thread_t             *thread;
+	/** Whether the collector thread is running */
+	volatile apr_uint32_t     running;
+	/** Interval (msec) pending audio is pushed at */
+	apr_size_t                cycle_time;
+	/** Max size of audio pending per stream */
+	apr_size_t                buffer_size;
+	/** Handler of results */
+	vosk_recog_batch_result_f handler;
+	/** Pool to allocate memory from */
+	apr_pool_t               *pool;
+};
+
+vosk_recog_batch_t* vosk_recog_batch_create(apr_size_t cycle_time, apr_size_t buffer_size, vosk_recog_batch_result_f handler, apr_pool_t *pool)
+{
+	vosk_recog_batch_t *batch = apr_palloc(pool,sizeof(vosk_recog_batch_t));
+	if(apr_thread_mutex_create(&batch->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	APR_RING_INIT(&batch->active,vosk_recog_batch_stream_t,link);
+	APR_RING_INIT(&batch->idle,vosk_recog_batch_stream_t,link);
+	batch->retired = apr_array_make(pool,1,sizeof(VoskBatchModel*));
+	batch->thread = NULL;
+	batch->running = 0;
+	batch->cycle_time = cycle_time;
+	batch->buffer_size = buffer_size;
+	batch->handler = handler;
+	batch->pool = pool;
+	return batch;
+}
+
+/** Return stream to be reused (called with batch mutex locked) */
+static void vosk_recog_batch_stream_recycle(vosk_recog_batch_stream_t *stream)
+{
+	if(stream->result) {
+		free(stream->result);
+		stream->result = NULL;
+	}
+	APR_RING_INSERT_TAIL(&stream->batch->idle,stream,vosk_recog_batch_stream_t,link);
+}
+
+static void vosk_recog_batch_stream_unref(vosk_recog_batch_stream_t *stream)
+{
+	if(apr_atomic_dec32(&stream->refs) == 0) {
+		vosk_recog_batch_t *batch = stream->batch;
+		apr_thread_mutex_lock(batch->mutex);
+		vosk_recog_batch_stream_recycle(stream);
+		apr_thread_mutex_unlock(batch->mutex);
+	}
+}
+
+/** Hand the first result over to the owner, drop the rest (collector context) */
+static void vosk_recog_batch_stream_result_poll(vosk_recog_batch_stream_t *stream)
+{
+	const char *result;
+	while((result = vosk_batch_recognizer_front_result(stream->recognizer)) != NULL && *result != '\0') {
+		if(stream->delivered == FALSE) {
+			char *copy = strdup(result);
+			apr_thread_mutex_lock(stream->mutex);
+			if(copy && stream->closed == FALSE) {
+				stream->delivered = TRUE;
+				stream->result = copy;
+				copy = NULL;
+				/* the reference is dropped by the owner on taking the result */
+				apr_atomic_inc32(&stream->refs);
+				stream->batch->handler(stream,stream->obj);
+			}
+			apr_thread_mutex_unlock(stream->mutex);
+			if(copy) {
+				free(copy);
+			}
+		}
+		vosk_batch_recognizer_pop(stream->recognizer);
+	}
+}
+
+/** Push pending audio of stream (collector context) */
+static apt_bool_t vosk_recog_batch_stream_push(vosk_recog_batch_stream_t *stream)
+{
+	char *data;
+	apr_size_t length;
+	apt_bool_t finish;
+
+	apr_thread_mutex_lock(stream->mutex);
+	if(stream->closed == TRUE) {
+		apr_thread_mutex_unlock(stream->mutex);
+		return FALSE;
+	}
+	/* swap the buffers, so that the owner is not blocked while audio is pushed */
+	data = stream->buffer;
+	length = stream->length;
+	stream->buffer = stream->spare;
+	stream->length = 0;
+	stream->spare = data;
+	finish = stream->finished;
+	apr_thread_mutex_unlock(stream->mutex);
+
+	if(stream->delivered == TRUE) {
+		/* the request is complete, the rest of audio is of no use */
+		return TRUE;
+	}
+	if(length) {
+		vosk_batch_recognizer_accept_waveform(stream->recognizer,data,(int)length);
+	}
+	if(finish == TRUE && stream->finish_sent == FALSE) {
+		vosk_batch_recognizer_finish_stream(stream->recognizer);
+		stream->finish_sent = TRUE;
+	}
+	vosk_recog_batch_stream_result_poll(stream);
+	return TRUE;
+}
+
+/** Check whether any active stream is of the model (called with batch mutex locked) */
+static apt_bool_t vosk_recog_batch_model_in_use(vosk_recog_batch_t *batch, const VoskBatchModel *model)
+{
+	vosk_recog_batch_stream_t *stream;
+	for(stream = APR_RING_FIRST(&batch->active);
+			stream != APR_RING_SENTINEL(&batch->active,vosk_recog_batch_stream_t,link);
+				stream = APR_RING_NEXT(stream,link)) {
+		if(stream->model == model) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/** Free the retired models, which no stream is left of (called with batch mutex locked) */
+static void vosk_recog_batch_retired_free(vosk_recog_batch_t *batch)
+{
+	int i = 0;
+	while(i < batch->retired->nelts) {
+		VoskBatchModel *model = APR_ARRAY_IDX(batch->retired,i,VoskBatchModel*);
+		if(vosk_recog_batch_model_in_use(batch,model) == TRUE) {
+			i++;
+			continue;
+		}
+		vosk_batch_model_free(model);
+		/* the order is of no matter, move the last one in place */
+		APR_ARRAY_IDX(batch->retired,i,VoskBatchModel*) = APR_ARRAY_IDX(batch->retired,batch->retired->nelts-1,VoskBatchModel*);
+		apr_array_pop(batch->retired);
+	}
+}
+
+/** Push pending audio of all the streams at once (collector context) */
+static void vosk_recog_batch_cycle(vosk_recog_batch_t *batch)
+{
+	vosk_recog_batch_stream_t *stream;
+	vosk_recog_batch_stream_t *next;
+
+	/* pushing audio only queues it for the batch model, so the ring is locked for the whole cycle */
+	apr_thread_mutex_lock(batch->mutex);
+	stream = APR_RING_FIRST(&batch->active);
+	while(stream != APR_RING_SENTINEL(&batch->active,vosk_recog_batch_stream_t,link)) {
+		next = APR_RING_NEXT(stream,link);
+		if(vosk_recog_batch_stream_push(stream) == FALSE) {
+			/* closed by the owner, the recognizer is freed in the context it is used in */
+			APR_RING_REMOVE(stream,link);
+			vosk_batch_recognizer_free(stream->recognizer);
+			stream->recognizer = NULL;
+			if(apr_atomic_dec32(&stream->refs) == 0) {
+				vosk_recog_batch_stream_recycle(stream);
+			}
+		}
+		stream = next;
+	}
+	if(!apr_is_empty_array(batch->retired)) {
+		vosk_recog_batch_retired_free(batch);
+	}
+	apr_thread_mutex_unlock(batch->mutex);
+}
+
+static void* APR_THREAD_FUNC vosk_recog_batch_thread_proc(apr_thread_t *thread, void *data)
+{
+	vosk_recog_batch_t *batch = data;
+	apr_interval_time_t cycle_time = (apr_interval_time_t)batch->cycle_time * 1000;
+#if APR_HAS_SETTHREADNAME
+	apr_thread_name_set(VOSK_RECOG_BATCH_THREAD_NAME);
+#endif
+	vosk_gpu_thread_init();
+	while(apr_atomic_read32(&batch->running)) {
+		apr_time_t start = apr_time_now();
+		apr_interval_time_t elapsed;
+		vosk_recog_batch_cycle(batch);
+		elapsed = apr_time_now() - start;
+		if(elapsed < cycle_time) {
+			apr_sleep(cycle_time - elapsed);
+		}
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+apt_bool_t vosk_recog_batch_start(vosk_recog_batch_t *batch)
+{
+	apr_atomic_set32(&batch->running,1);
+	if(apr_thread_create(&batch->thread,NULL,vosk_recog_batch_thread_proc,batch,batch->pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Batch Collector Thread");
+		apr_atomic_set32(&batch->running,0);
+		batch->thread = NULL;
+		return FALSE;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Start Batch Collector [%"APR_SIZE_T_FMT" ms]",batch->cycle_time);
+	return TRUE;
+}
+
+void vosk_recog_batch_terminate(vosk_recog_batch_t *batch)
+{
+	vosk_recog_batch_stream_t *stream;
+	if(batch->thread) {
+		apr_status_t rv;
+		apr_atomic_set32(&batch->running,0);
+		apr_thread_join(&rv,batch->thread);
+		batch->thread = NULL;
+	}
+
+	/* the channels are closed, the recognizers must be freed before the batch models */
+	apr_thread_mutex_lock(batch->mutex);
+	while(!APR_RING_EMPTY(&batch->active,vosk_recog_batch_stream_t,link)) {
+		stream = APR_RING_FIRST(&batch->active);
+		APR_RING_REMOVE(stream,link);
+		vosk_batch_recognizer_free(stream->recognizer);
+		stream->recognizer = NULL;
+	}
+	vosk_recog_batch_retired_free(batch);
+	apr_thread_mutex_unlock(batch->mutex);
+}
+
+void vosk_recog_batch_model_free(vosk_recog_batch_t *batch, VoskBatchModel *model)
+{
+	apr_thread_mutex_lock(batch->mutex);
+	if(vosk_recog_batch_model_in_use(batch,model) == TRUE) {
+		/* closed streams are only dropped by the collector, which frees the model afterwards */
+		APR_ARRAY_PUSH(batch->retired,VoskBatchModel*) = model;
+	}
+	else {
+		vosk_batch_model_free(model);
+	}
+	apr_thread_mutex_unlock(batch->mutex);
+}
+
+vosk_recog_batch_stream_t* vosk_recog_batch_stream_open(vosk_recog_batch_t *batch, VoskBatchModel *model, int sample_rate, void *obj)
+{
+	vosk_recog_batch_stream_t *stream = NULL;
+	VoskBatchRecognizer *recognizer;
+
+	if(!model) {
+		return NULL;
+	}
+	recognizer = vosk_batch_recognizer_new(model,(float)sample_rate);
+	if(!recognizer) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Batch Recognizer [%d]",sample_rate);
+		return NULL;
+	}
+
+	apr_thread_mutex_lock(batch->mutex);
+	if(!APR_RING_EMPTY(&batch->idle,vosk_recog_batch_stream_t,link)) {
+		stream = APR_RING_FIRST(&batch->idle);
+		APR_RING_REMOVE(stream,link);
+	}
+	else {
+		/* streams are allocated once and reused, the pool is only used with the mutex locked */
+		stream = apr_palloc(batch->pool,sizeof(vosk_recog_batch_stream_t));
+		if(apr_thread_mutex_create(&stream->mutex,APR_THREAD_MUTEX_DEFAULT,batch->pool) != APR_SUCCESS) {
+			stream = NULL;
+		}
+		else {
+			stream->batch = batch;
+			stream->buffer = apr_palloc(batch->pool,batch->buffer_size);
+			stream->spare = apr_palloc(batch->pool,batch->buffer_size);
+			stream->result = NULL;
+		}
+	}
+	if(!stream) {
+		apr_thread_mutex_unlock(batch->mutex);
+		vosk_batch_recognizer_free(recognizer);
+		return NULL;
+	}
+
+	stream->recognizer = recognizer;
+	stream->model = model;
+	stream->obj = obj;
+	stream->length = 0;
+	stream->finished = FALSE;
+	stream->closed = FALSE;
+	stream->dropped = FALSE;
+	stream->finish_sent = FALSE;
+	stream->delivered = FALSE;
+	/* referenced by the owner and the collector */
+	apr_atomic_set32(&stream->refs,2);
+	APR_RING_INSERT_TAIL(&batch->active,stream,vosk_recog_batch_stream_t,link);
+	apr_thread_mutex_unlock(batch->mutex);
+	return stream;
+}
+
+apt_bool_t vosk_recog_batch_stream_write(vosk_recog_batch_stream_t *stream, const char *data, apr_size_t size)
+{
+	apt_bool_t status = TRUE;
+	apr_thread_mutex_lock(stream->mutex);
+	if(size > stream->batch->buffer_size - stream->length) {
+		size = stream->batch->buffer_size - stream->length;
+		status = FALSE;
+	}
+	memcpy(stream->buffer + stream->length,data,size);
+	stream->length += size;
+	apr_thread_mutex_unlock(stream->mutex);
+
+	if(status == FALSE && stream->dropped == FALSE) {
+		stream->dropped = TRUE;
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Batch Stream Overflow, audio is dropped");
+	}
+	return status;
+}
+
+void vosk_recog_batch_stream_finish(vosk_recog_batch_stream_t *stream)
+{
+	apr_thread_mutex_lock(stream->mutex);
+	stream->finished = TRUE;
+	apr_thread_mutex_unlock(stream->mutex);
+}
+
+void* vosk_recog_batch_stream_result_take(vosk_recog_batch_stream_t *stream, const char **result)
+{
+	void *obj;
+	apr_thread_mutex_lock(stream->mutex);
+	obj = stream->closed == FALSE ? stream->obj : NULL;
+	*result = stream->result;
+	apr_thread_mutex_unlock(stream->mutex);
+	/* the owner keeps its reference, while the stream is open */
+	vosk_recog_batch_stream_unref(stream);
+	return obj;
+}
+
+void vosk_recog_batch_stream_close(vosk_recog_batch_stream_t *stream)
+{
+	apr_thread_mutex_lock(stream->mutex);
+	stream->closed = TRUE;
+	stream->obj = NULL;
+	apr_thread_mutex_unlock(stream->mutex);
+	vosk_recog_batch_stream_unref(stream);
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <apr_strings.h>
+#include "vosk_recog_dump.h"
+#include "apt_consumer_task.h"
+#include "apt_spsc_queue.h"
+#include "vosk_recog_log.h"
+
+#define VOSK_RECOG_DUMP_TASK_NAME    "Vosk Dump Writer"
+
+/** Size of a block of audio */
+#define VOSK_RECOG_DUMP_BLOCK_SIZE   4096
+/** Number of blocks the writer may lag behind */
+#define VOSK_RECOG_DUMP_BLOCK_COUNT  64
+/** Number of filled blocks to wake the writer up at */
+#define VOSK_RECOG_DUMP_BATCH_COUNT  8
+/** Size of stdio buffer, so that disk writes are large and sequential */
+#define VOSK_RECOG_DUMP_FILE_BUFFER  (VOSK_RECOG_DUMP_BLOCK_SIZE * VOSK_RECOG_DUMP_BATCH_COUNT)
+/** Size of WAV header */
+#define VOSK_RECOG_WAV_HEADER_SIZE   44
+
+/** Dump writer */
+struct vosk_recog_dump_writer_t {
+	/** Consumer task (thread) */
+	apt_consumer_task_t *task;
+};
+
+/** Block of audio */
+typedef struct vosk_recog_dump_block_t vosk_recog_dump_block_t;
+struct vosk_recog_dump_block_t {
+	apr_size_t size;
+	char       data[VOSK_RECOG_DUMP_BLOCK_SIZE];
+};
+
+/** Utterance dump */
+struct vosk_recog_dump_t {
+	/** Writer the dump is written by */
+	vosk_recog_dump_writer_t *writer;
+	/** File path */
+	const char               *file_path;
+	/** Sampling rate */
+	int                       sample_rate;
+	/** Whether to write WAV header */
+	apt_bool_t                wav;
+	/** Queue of blocks */
+	apt_spsc_queue_t         *queue;
+	/** Block being filled by producer (not committed yet) */
+	vosk_recog_dump_block_t  *block;
+	/** Number of blocks committed since the writer was signaled (producer) */
+	apr_size_t                uncommitted;
+	/** Number of bytes dropped because of queue overflow (producer) */
+	apr_size_t                dropped;
+	/** File (writer) */
+	FILE                     *file;
+	/** Number of bytes of audio written (writer) */
+	apr_size_t                written;
+	/** Pool the dump is allocated from */
+	apr_pool_t               *pool;
+};
+
+typedef enum {
+	VOSK_RECOG_DUMP_MSG_OPEN,
+	VOSK_RECOG_DUMP_MSG_WRITE,
+	VOSK_RECOG_DUMP_MSG_CLOSE
+} vosk_recog_dump_msg_type_e;
+
+/** Writer task message */
+typedef struct vosk_recog_dump_msg_t vosk_recog_dump_msg_t;
+struct vosk_recog_dump_msg_t {
+	vosk_recog_dump_msg_type_e type;
+	vosk_recog_dump_t         *dump;
+};
+
+static void vosk_recog_le32_set(unsigned char *buf, apr_uint32_t value)
+{
+	buf[0] = (unsigned char)(value & 0xff);
+	buf[1] = (unsigned char)((value >> 8) & 0xff);
+	buf[2] = (unsigned char)((value >> 16) & 0xff);
+	buf[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+static void vosk_recog_le16_set(unsigned char *buf, apr_uint16_t value)
+{
+	buf[0] = (unsigned char)(value & 0xff);
+	buf[1] = (unsigned char)((value >> 8) & 0xff);
+}
+
+/** Write WAV header of L16 mono audio */
+static void vosk_recog_wav_header_write(FILE *file, int sample_rate, apr_size_t data_size)
+{
+	unsigned char header[VOSK_RECOG_WAV_HEADER_SIZE];
+	memcpy(header,"RIFF",4);
+	vosk_recog_le32_set(header+4,(apr_uint32_t)(data_size + VOSK_RECOG_WAV_HEADER_SIZE - 8));
+	memcpy(header+8,"WAVEfmt ",8);
+	vosk_recog_le32_set(header+16,16);                         /* fmt chunk size */
+	vosk_recog_le16_set(header+20,1);                          /* PCM */
+	vosk_recog_le16_set(header+22,1);                          /* mono */
+	vosk_recog_le32_set(header+24,(apr_uint32_t)sample_rate);
+	vosk_recog_le32_set(header+28,(apr_uint32_t)sample_rate * 2); /* byte rate */
+	vosk_recog_le16_set(header+32,2);                          /* block align */
+	vosk_recog_le16_set(header+34,16);                         /* bits per sample */
+	memcpy(header+36,"data",4);
+	vosk_recog_le32_set(header+40,(apr_uint32_t)data_size);
+	fwrite(header,1,sizeof(header),file);
+}
+
+/** Write queued blocks to file (writer context) */
+static void vosk_recog_dump_drain(vosk_recog_dump_t *dump)
+{
+	vosk_recog_dump_block_t *block;
+	while((block = apt_spsc_queue_read_begin(dump->queue)) != NULL) {
+		if(dump->file) {
+			dump->written += fwrite(block->data,1,block->size,dump->file);
+		}
+		apt_spsc_queue_read_commit(dump->queue);
+	}
+}
+
+static apt_bool_t vosk_recog_dump_signal(vosk_recog_dump_t *dump, vosk_recog_dump_msg_type_e type)
+{
+	apt_bool_t status = FALSE;
+	apt_task_t *task = apt_consumer_task_base_get(dump->writer->task);
+	apt_task_msg_t *msg = apt_task_msg_get(task);
+	if(msg) {
+		vosk_recog_dump_msg_t *dump_msg;
+		msg->type = TASK_MSG_USER;
+		dump_msg = (vosk_recog_dump_msg_t*) msg->data;
+		dump_msg->type = type;
+		dump_msg->dump = dump;
+		status = apt_task_msg_signal(task,msg);
+	}
+	return status;
+}
+
+static apt_bool_t vosk_recog_dump_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	vosk_recog_dump_msg_t *dump_msg = (vosk_recog_dump_msg_t*)msg->data;
+	vosk_recog_dump_t *dump = dump_msg->dump;
+	switch(dump_msg->type) {
+		case VOSK_RECOG_DUMP_MSG_OPEN:
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Open Utterance Output File [%s] for Writing",dump->file_path);
+			dump->file = fopen(dump->file_path,"wb");
+			if(!dump->file) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Utterance Output File [%s] for Writing",dump->file_path);
+				break;
+			}
+			setvbuf(dump->file,NULL,_IOFBF,VOSK_RECOG_DUMP_FILE_BUFFER);
+			if(dump->wav == TRUE) {
+				/* sizes are updated on close */
+				vosk_recog_wav_header_write(dump->file,dump->sample_rate,0);
+			}
+			break;
+		case VOSK_RECOG_DUMP_MSG_WRITE:
+			vosk_recog_dump_drain(dump);
+			break;
+		case VOSK_RECOG_DUMP_MSG_CLOSE:
+			vosk_recog_dump_drain(dump);
+			if(dump->file) {
+				if(dump->wav == TRUE && fseek(dump->file,0,SEEK_SET) == 0) {
+					vosk_recog_wav_header_write(dump->file,dump->sample_rate,dump->written);
+				}
+				fclose(dump->file);
+				dump->file = NULL;
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Close Utterance Output File [%s] [%"APR_SIZE_T_FMT" bytes]",
+					dump->file_path,dump->written);
+			}
+			apr_pool_destroy(dump->pool);
+			break;
+	}
+	return TRUE;
+}
+
+vosk_recog_dump_writer_t* vosk_recog_dump_writer_create(apr_pool_t *pool)
+{
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	vosk_recog_dump_writer_t *writer = apr_palloc(pool,sizeof(vosk_recog_dump_writer_t));
+
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(vosk_recog_dump_msg_t),pool);
+	writer->task = apt_consumer_task_create(writer,msg_pool,pool);
+	if(!writer->task) {
+		return NULL;
+	}
+	task = apt_consumer_task_base_get(writer->task);
+	apt_task_name_set(task,VOSK_RECOG_DUMP_TASK_NAME);
+	vtable = apt_task_vtable_get(task);
+	if(vtable) {
+		vtable->process_msg = vosk_recog_dump_msg_process;
+	}
+	return writer;
+}
+
+void vosk_recog_dump_writer_destroy(vosk_recog_dump_writer_t *writer)
+{
+	if(writer->task) {
+		apt_task_destroy(apt_consumer_task_base_get(writer->task));
+		writer->task = NULL;
+	}
+}
+
+apt_bool_t vosk_recog_dump_writer_start(vosk_recog_dump_writer_t *writer)
+{
+	return apt_task_start(apt_consumer_task_base_get(writer->task));
+}
+
+apt_bool_t vosk_recog_dump_writer_terminate(vosk_recog_dump_writer_t *writer)
+{
+	return apt_task_terminate(apt_consumer_task_base_get(writer->task),TRUE);
+}
+
+vosk_recog_dump_t* vosk_recog_dump_open(vosk_recog_dump_writer_t *writer, const char *file_path, int sample_rate, apt_bool_t wav)
+{
+	vosk_recog_dump_t *dump;
+	apr_pool_t *pool;
+	/* the dump is destroyed by the writer thread, hence its own pool */
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	dump = apr_palloc(pool,sizeof(vosk_recog_dump_t));
+	dump->writer = writer;
+	dump->file_path = apr_pstrdup(pool,file_path);
+	dump->sample_rate = sample_rate;
+	dump->wav = wav;
+	dump->queue = apt_spsc_queue_create(VOSK_RECOG_DUMP_BLOCK_COUNT,sizeof(vosk_recog_dump_block_t),pool);
+	dump->block = NULL;
+	dump->uncommitted = 0;
+	dump->dropped = 0;
+	dump->file = NULL;
+	dump->written = 0;
+	dump->pool = pool;
+
+	if(vosk_recog_dump_signal(dump,VOSK_RECOG_DUMP_MSG_OPEN) == FALSE) {
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+	return dump;
+}
+
+/** Commit the block being filled (producer) */
+static void vosk_recog_dump_commit(vosk_recog_dump_t *dump)
+{
+	apt_spsc_queue_write_commit(dump->queue);
+	dump->block = NULL;
+	if(++dump->uncommitted >= VOSK_RECOG_DUMP_BATCH_COUNT) {
+		dump->uncommitted = 0;
+		vosk_recog_dump_signal(dump,VOSK_RECOG_DUMP_MSG_WRITE);
+	}
+}
+
+void vosk_recog_dump_write(vosk_recog_dump_t *dump, const void *data, apr_size_t size)
+{
+	const char *pos = data;
+	while(size) {
+		apr_size_t chunk;
+		if(!dump->block) {
+			dump->block = apt_spsc_queue_write_begin(dump->queue);
+			if(!dump->block) {
+				if(!dump->dropped) {
+					apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Utterance Dump Overflow [%s]",dump->file_path);
+				}
+				dump->dropped += size;
+				return;
+			}
+			dump->block->size = 0;
+		}
+		chunk = VOSK_RECOG_DUMP_BLOCK_SIZE - dump->block->size;
+		if(chunk > size) {
+			chunk = size;
+		}
+		memcpy(dump->block->data + dump->block->size,pos,chunk);
+		dump->block->size += chunk;
+		pos += chunk;
+		size -= chunk;
+		if(dump->block->size == VOSK_RECOG_DUMP_BLOCK_SIZE) {
+			vosk_recog_dump_commit(dump);
+		}
+	}
+}
+
+void vosk_recog_dump_close(vosk_recog_dump_t *dump)
+{
+	if(dump->block) {
+		apt_spsc_queue_write_commit(dump->queue);
+		dump->block = NULL;
+	}
+	if(dump->dropped) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Dropped [%"APR_SIZE_T_FMT" bytes] of Utterance Dump [%s]",
+			dump->dropped,dump->file_path);
+	}
+	vosk_recog_dump_signal(dump,VOSK_RECOG_DUMP_MSG_CLOSE);
+}
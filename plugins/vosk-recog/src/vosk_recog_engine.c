@@ -28,21 +28,149 @@
  */
 
 #include "mrcp_recog_engine.h"
+#include "mrcp_message_trace.h"
 #include "mpf_activity_detector.h"
+#include "mpf_frame_pool.h"
+#include "mpf_named_event.h"
 #include "apt_consumer_task.h"
-#include "apt_log.h"
+#include "mpf_audio_queue.h"
+#include "mpf_flight_recorder.h"
+#include "apt_probe.h"
+#include "vosk_recog_log.h"
+#include "vosk_recog_worker.h"
+#include "vosk_recog_model.h"
+#include "vosk_recog_pool.h"
+#include "vosk_recog_grammar.h"
+#include "vosk_recog_dump.h"
+#include "vosk_recog_nlsml.h"
+#include "vosk_recog_batch.h"
+#include "vosk_recog_remote.h"
+#include "vosk_recog_audio.h"
+#include "vosk_recog_adapt.h"
+#include "mrcp_voiceprint_store.h"
+#include "mrcp_grammar_fetcher.h"
 #include "vosk_api.h"
-#include <apr_xml.h>
+#include <apr_atomic.h>
+#include <apr_hash.h>
+#include <apr_thread_mutex.h>
+#include <apr_file_info.h>
 #include "string.h"
-#include <regex.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VOSK_RECOG_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VOSK_RECOG_NEON
+#include <arm_neon.h>
+#endif
+#include <stdio.h>
+
 
 #define RECOG_ENGINE_TASK_NAME "Vosk Recog Engine"
+/** Default number of engine tasks channels are distributed to */
+#define VOSK_RECOG_DEFAULT_TASK_COUNT 1
+
+/** Max size of a frame passed to the decoder (10 msec of 16 kHz mono L16) */
+#define VOSK_RECOG_MAX_FRAME_SIZE  (16000 / 1000 * CODEC_FRAME_TIME_BASE * BYTES_PER_SAMPLE)
+/** Max number of interleaved channels of the audio, a speaker per channel */
+#define VOSK_RECOG_MAX_CHANNEL_COUNT 2
+/** Default audio (msec) the decoder may lag behind the MPF scheduler */
+#define VOSK_RECOG_DEFAULT_FRAME_QUEUE_TIME 2560
+/** Default size (msec of audio) of chunks passed to the recognizer */
+#define VOSK_RECOG_DEFAULT_CHUNK_TIME 100
+/** Max size (msec of audio) of chunks passed to the recognizer */
+#define VOSK_RECOG_MAX_CHUNK_TIME 1000
+/** Default size (msec of audio) of the pre-roll, covering the onset of speech before activity is detected */
+#define VOSK_RECOG_DEFAULT_PRE_ROLL_TIME 500
+/** Max size (msec of audio) of the pre-roll */
+#define VOSK_RECOG_MAX_PRE_ROLL_TIME 2000
+/** Default interval (msec of audio) partial results are evaluated at */
+#define VOSK_RECOG_DEFAULT_PARTIAL_INTERVAL 200
+/** Default max number of channels a decoder worker gathers to decode back-to-back by the cpu-batch backend */
+#define VOSK_RECOG_DEFAULT_CPU_BATCH_SIZE 16
+/** Size (msec of audio) pending per stream of the batch decoding backend, in chunks */
+#define VOSK_RECOG_BATCH_BUFFER_CHUNKS 4
+/** Default max number of streams open at once to the remote decoders, if max-channel-count is not set */
+#define VOSK_RECOG_DEFAULT_REMOTE_STREAMS 256
+/** Default time (msec) to wait for the next digit of DTMF input, once any is collected */
+#define VOSK_RECOG_DEFAULT_DTMF_INTERDIGIT_TIMEOUT 5000
+/** Default time (msec of audio) the hypothesis is to stay unchanged over silence to be finalized by the combined endpointer */
+#define VOSK_RECOG_DEFAULT_ENDPOINT_STABLE_TIME 300
+/** Default time (msec of input) a request is recognized for at most, once input has started */
+#define VOSK_RECOG_DEFAULT_RECOGNITION_TIMEOUT 10000
+/** Default time (msec of audio) a segment of continuous transcription is finalized at, if the speech does not pause */
+#define VOSK_RECOG_DEFAULT_SEGMENT_TIME 30000
+/** Default time (msec of audio) STOP with checkpoint waits for the boundary of segments, past which the segment is cut */
+#define VOSK_RECOG_DEFAULT_CHECKPOINT_TIMEOUT 5000
+/** Default audio (msec) queued to a channel, past which its decoding is degraded (if degrade-rtf is set) */
+#define VOSK_RECOG_DEFAULT_DEGRADE_BACKLOG 500
+/** Default number of workers low-confidence results are rescored by */
+#define VOSK_RECOG_DEFAULT_RESCORE_THREADS 1
+/** Default max time (msec of audio) of an utterance kept for rescoring */
+#define VOSK_RECOG_DEFAULT_RESCORE_MAX_TIME 10000
+/** Number of times the result of rescoring is signaled back to a decoder worker whose queue is full */
+#define VOSK_RECOG_RESCORE_SIGNAL_ATTEMPTS 1000
+/** Time (usec) waited for between the attempts to signal the result of rescoring */
+#define VOSK_RECOG_RESCORE_SIGNAL_INTERVAL 1000
+/** Default time (msec) the speech of a caller is kept for since the call */
+#define VOSK_RECOG_DEFAULT_ADAPT_TTL 86400000
+/** Default time (msec of voiced audio) of the speech of a caller kept */
+#define VOSK_RECOG_DEFAULT_ADAPT_TIME 3000
+/** Min time (msec of voiced audio) of the speech of a call to replace the one stored for the caller */
+#define VOSK_RECOG_ADAPT_MIN_TIME 500
+/** Default number of threads grammars referenced by URI are fetched by */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_THREADS 2
+/** Default timeout (msec) of the network operations of a grammar fetch */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_TIMEOUT 5000
+/** Default time (sec) a fetched grammar is taken as is, unless the server sets Cache-Control max-age */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_MAX_AGE 300
+/** Default max total size (bytes) of fetched grammars kept in memory */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_CACHE_SIZE (4 * 1024 * 1024)
+/** Default directory (var dir) fetched grammars are kept in */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_DIR "grammars"
+/** Default directory FST images of grammars are kept in (relative to the var dir) */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_FST_DIR "fst"
+/** Default max number of grammar FST images kept in the directory */
+#define VOSK_RECOG_DEFAULT_GRAMMAR_FST_MAX_FILES 10000
+/** Prefixes of the URIs precompiled grammars are referenced by, followed by the id of the grammar */
+#define VOSK_RECOG_PRECOMPILED_URI_BUILTIN "builtin:grammar/"
+#define VOSK_RECOG_PRECOMPILED_URI_SESSION "session:"
+/** Default max number of phrases of a grammar of the closed class */
+#define VOSK_RECOG_DEFAULT_CLOSED_GRAMMAR_MAX_PHRASES 100
+/** Interval (usec) RTP must have arrived within for no-input to dump the flight recorder */
+#define VOSK_RECOG_FLIGHT_RTP_INTERVAL (200 * 1000)
+/** Sampling rate recognizers are built for in advance, unless the model has a native rate set */
+#define VOSK_RECOG_DEFAULT_SAMPLE_RATE 8000
+/** Default file (var dir) of the voiceprint index */
+#define VOSK_RECOG_DEFAULT_VOICEPRINT_INDEX "voiceprints.vpi"
+/** Default min cosine score the speaker is verified at */
+#define VOSK_RECOG_DEFAULT_SPEAKER_THRESHOLD 0.5f
+/** Default max size of the result of the last request kept per channel for GET-RESULT */
+#define VOSK_RECOG_DEFAULT_LAST_RESULT_MAX_SIZE 65536
+/** Min number of frames (10 msec) a voiceprint is enrolled from */
+#define VOSK_RECOG_SPEAKER_MIN_FRAMES 100
+/** Audio (data dir) decoded by each model at 8 kHz to warm it up */
+#define VOSK_RECOG_WARM_UP_AUDIO_8K "one-8kHz.pcm"
+/** Audio (data dir) decoded by each model at 16 kHz to warm it up */
+#define VOSK_RECOG_WARM_UP_AUDIO_16K "johnsmith-16kHz.pcm"
+/** Number of G.711 laws (PCMU, PCMA) frames may be taken in */
+#define VOSK_RECOG_G711_TABLE_COUNT 2
 
 typedef struct vosk_recog_engine_t vosk_recog_engine_t;
 typedef struct vosk_recog_channel_t vosk_recog_channel_t;
 typedef struct vosk_recog_msg_t vosk_recog_msg_t;
+typedef struct vosk_recog_frame_t vosk_recog_frame_t;
+typedef struct vosk_recog_preroll_frame_t vosk_recog_preroll_frame_t;
+typedef struct vosk_recog_g711_table_t vosk_recog_g711_table_t;
+typedef struct vosk_recog_last_result_t vosk_recog_last_result_t;
+
+/** Endpointing of speech input */
+typedef enum {
+	VOSK_RECOG_ENDPOINTER_VAD,      /**< input ends on inactivity detected, or on the endpoint of the decoder */
+	VOSK_RECOG_ENDPOINTER_COMBINED  /**< input ends on the endpoint of the decoder, or on silence the hypothesis is stable over */
+} vosk_recog_endpointer_e;
+typedef struct vosk_recog_partial_t vosk_recog_partial_t;
 
 /** Declaration of recognizer engine methods */
 static apt_bool_t vosk_recog_engine_destroy(mrcp_engine_t *engine);
@@ -75,6 +203,7 @@ static apt_bool_t vosk_recog_stream_destroy(mpf_audio_stream_t *stream);
 static apt_bool_t vosk_recog_stream_open(mpf_audio_stream_t *stream, mpf_codec_t *codec);
 static apt_bool_t vosk_recog_stream_close(mpf_audio_stream_t *stream);
 static apt_bool_t vosk_recog_stream_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame);
+static apt_bool_t vosk_recog_stream_ref_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame, mpf_frame_ref_t *ref);
 
 static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 	vosk_recog_stream_destroy,
@@ -84,13 +213,177 @@ static const mpf_audio_stream_vtable_t audio_stream_vtable = {
 	vosk_recog_stream_open,
 	vosk_recog_stream_close,
 	vosk_recog_stream_write,
-	NULL
+	NULL,
+	NULL,
+	vosk_recog_stream_ref_write
 };
 
 /** Declaration of kaldi recognizer engine */
 struct vosk_recog_engine_t {
-	apt_consumer_task_t    *task;
-	VoskModel              *model;
+	/** Array of engine tasks, each channel is served by one of them */
+	apt_consumer_task_t     **tasks;
+	/** Number of engine tasks */
+	apr_size_t                task_count;
+	/** Pool of task messages shared by engine tasks */
+	apt_task_msg_pool_t      *msg_pool;
+	/** Pool of decoder workers */
+	vosk_recog_worker_pool_t *worker_pool;
+	/** Pool of workers low-confidence results are rescored by (NULL if results are not rescored) */
+	vosk_recog_worker_pool_t *rescore_pool;
+	/** Model low-confidence results are rescored by */
+	vosk_recog_model_t       *rescore_model;
+	/** Confidence of the top hypothesis of the first pass, below which the utterance is rescored */
+	float                     rescore_confidence;
+	/** Max time (msec of audio) of an utterance kept for rescoring, longer ones are not rescored */
+	apr_size_t                rescore_max_time;
+	/** Store of the speech of callers recognizers are primed by (NULL if disabled) */
+	vosk_recog_adapt_store_t *adapt_store;
+	/** Time (msec of voiced audio) of the speech of a caller kept */
+	apr_size_t                adapt_time;
+	/** Time (msec of speech) the language of a request is identified by among its candidates (0 if disabled) */
+	apr_size_t                lid_time;
+	/** Registry of models */
+	vosk_recog_model_registry_t *models;
+	/** Pool of reusable recognizers */
+	vosk_recog_pool_t        *recog_pool;
+	/** Collector of the batch (GPU) decoding backend (NULL if decoding is done by workers) */
+	vosk_recog_batch_t       *batch;
+	/** Whether the workers gather channels with frames queued to decode them back-to-back, grouped by model */
+	apt_bool_t                cpu_batch;
+	/** Client of the remote decoding backend (NULL if decoding is done locally) */
+	vosk_recog_remote_t      *remote;
+	/** Whether local models are loaded along with the remote backend, for the requests it does not serve */
+	apt_bool_t                remote_local_models;
+	/** Number of recognizers to build in advance per model */
+	apr_size_t                recog_pool_size;
+	/** Max number of models loaded at once on open */
+	apr_size_t                model_load_threads;
+	/** Placement of models, decoder workers and channels on NUMA nodes */
+	vosk_recog_numa_mode_e    numa_mode;
+	/** Whether decoder workers are pinned to single CPUs and channels to the workers on the CPU of their media */
+	apt_bool_t                media_affinity;
+	/** Interval (sec) the directories of models are checked for reload at (0 if not watched) */
+	apr_size_t                model_watch_interval;
+	/** Path to audio models are warmed up by at 8 kHz (NULL if not warmed up) */
+	const char               *warm_up_audio_8k;
+	/** Path to audio models are warmed up by at 16 kHz (NULL if not warmed up) */
+	const char               *warm_up_audio_16k;
+	/** Path to the speaker model (NULL if speakers are not scored) */
+	const char               *spk_model_path;
+	/** Speaker model set to all the recognizers */
+	VoskSpkModel             *spk_model;
+	/** Index of voiceprints speakers are scored against */
+	mrcp_voiceprint_store_t *voiceprints;
+	/** Min cosine score the speaker is verified at */
+	float                     speaker_threshold;
+	/** Sampling rates (mpf_sample_rates_e) to advertise */
+	int                       sample_rates;
+	/** Tables of the G.711 laws frames are taken in as is (NULL if frames are only taken in L16) */
+	vosk_recog_g711_table_t  *g711_tables;
+	/** Cache of compiled grammars shared by channels */
+	vosk_recog_grammar_cache_t *grammar_cache;
+	/** Grammars compiled at engine open by id, pinned in the cache till engine close (NULL if none) */
+	apr_hash_t               *precompiled_grammars;
+	/** Vocabularies (JSON lists of phrases) of the precompiled grammars recognizers are built for in advance */
+	apr_array_header_t       *precompiled_phrases;
+	/** Inverse text normalization grammar applied to final results (NULL if none) */
+	vosk_recog_itn_t         *itn;
+	/** Cache of NLSML results rendered for closed-grammar prompts */
+	vosk_recog_nlsml_cache_t *result_cache;
+	/** Fetcher of grammars referenced by URI (NULL if disabled) */
+	mrcp_grammar_fetcher_t   *grammar_fetcher;
+	/** Interval (msec of audio) partial results are evaluated at */
+	apr_size_t                partial_interval;
+	/** Size (msec of audio) of chunks passed to the recognizer */
+	apr_size_t                chunk_time;
+	/** Default interval (msec of audio) intermediate results are sent at (0 if disabled) */
+	apr_size_t                interim_interval;
+	/** Default time (msec of input) a request is recognized for at most (0 if not timed) */
+	apr_size_t                recognition_timeout;
+	/** Time (msec of audio) a segment of continuous transcription is finalized at, if the speech does not pause (0 if not bounded) */
+	apr_size_t                segment_time;
+	/** Time (msec of audio) STOP with checkpoint waits for the boundary of segments, past which the segment is cut */
+	apr_size_t                checkpoint_timeout;
+	/** Writer of utterance dumps */
+	vosk_recog_dump_writer_t *dump_writer;
+	/** Whether to dump utterances, unless requested otherwise by Save-Waveform */
+	apt_bool_t                dump_enabled;
+	/** Whether to dump utterances in WAV rather than raw PCM format */
+	apt_bool_t                dump_wav;
+	/** Whether to constrain decoding to the vocabulary of the grammar */
+	apt_bool_t                constrained_decoding;
+	/** Max number of phrases of a grammar the model rule of the closed class applies to */
+	apr_size_t                closed_grammar_max_phrases;
+	/** Default options of results, unless requested otherwise */
+	vosk_recog_result_options_t result_options;
+	/** Max size of the result of the last request kept for GET-RESULT (0 disables GET-RESULT) */
+	apr_size_t                last_result_max_size;
+	/** Whether to hold audio back from the recognizer till voice activity is detected */
+	apt_bool_t                vad_gate;
+	/** Size (msec of audio) of the pre-roll passed to the recognizer on voice activity */
+	apr_size_t                pre_roll_time;
+	/** Size (msec of audio) of the audio written ahead of a request, replayed into it (0 if disabled) */
+	apr_size_t                input_pre_roll_time;
+	/** Mode of activity detection */
+	mpf_detector_mode_e       vad_mode;
+	/** Endpointing of speech input */
+	vosk_recog_endpointer_e   endpointer;
+	/** Time (msec of audio) the hypothesis is to stay unchanged over silence to be finalized (combined endpointer) */
+	apr_size_t                endpoint_stable_time;
+	/** Endpointer mode of the decoder (-1 if the one of the model is kept) */
+	int                       decoder_endpointer_mode;
+	/** Real-time factor (permille) of a channel or load of a worker, past which decoding is degraded (0 if never) */
+	apr_uint32_t              degrade_rtf;
+	/** Audio (msec) queued to a channel, past which its decoding is degraded */
+	apr_size_t                degrade_backlog;
+	/** Capacity (msec of audio) of the queue of frames of a channel */
+	apr_size_t                frame_queue_time;
+	/** Overflow policy of the queue of frames */
+	mpf_audio_queue_policy_e  frame_queue_policy;
+	/** Time (msec) without incoming audio after which the call is taken as held (0 if only closed media is) */
+	apr_size_t                hold_timeout;
+	/** Whether idle decoder workers steal channels ready to decode from busy ones */
+	apt_bool_t                work_stealing;
+	/** Directory audio files of batch requests are confined to (NULL if file URIs are not allowed) */
+	const char               *audio_dir;
+	/** Slab of idle channels pre-allocated by max-channel-count (NULL if channels are allocated per session) */
+	vosk_recog_channel_t    **slab;
+	/** Number of idle channels in the slab */
+	apr_size_t                slab_count;
+	/** Guard of the slab, channels are created and destroyed by several session shards */
+	apr_thread_mutex_t       *slab_guard;
+	/** Engine base */
+	mrcp_engine_t            *engine;
+};
+
+/** Table the codes of a G.711 leg are expanded by */
+struct vosk_recog_g711_table_t {
+	/** Name of the codec (PCMU or PCMA) */
+	apt_str_t                 name;
+	/** Linear samples by code, as detected and dumped */
+	const apr_int16_t        *linear;
+	/** Samples by code, as passed to the decoder */
+	float                     samples[256];
+};
+
+/** Result of the last completed request, rendered again by GET-RESULT */
+struct vosk_recog_last_result_t {
+	/** Final result of the recognizer (JSON, with the alternatives computed) */
+	const char                 *result;
+	/** Id of the rule matched by a partial result (NULL if none) */
+	const char                 *early;
+	/** Options the result was rendered by */
+	vosk_recog_result_options_t options;
+	/** Grammar the result is interpreted by, referenced till the result is dropped (NULL if none) */
+	vosk_recog_grammar_t       *grammar;
+};
+
+/** Evaluation state of partial results */
+struct vosk_recog_partial_t {
+	/** Audio (msec) decoded since the last evaluation */
+	apr_size_t   elapsed;
+	/** Hash of the last evaluated partial result */
+	apr_uint32_t hash;
 };
 
 /** Declaration of kaldi recognizer channel */
@@ -99,38 +392,365 @@ struct vosk_recog_channel_t {
 	vosk_recog_engine_t     *kaldi_engine;
 	/** Engine channel base */
 	mrcp_engine_channel_t   *channel;
+	/** Whether the channel is owned by the slab of the engine rather than the session */
+	apt_bool_t               slab_owned;
 
 	/** Active (in-progress) recognition request */
-	mrcp_message_t          *recog_request;
+	mrcp_message_t * volatile recog_request;
+	/** Indicates whether the recognition request has just been started */
+	volatile apr_uint32_t    recog_start;
 	/** Pending stop response */
 	mrcp_message_t          *stop_response;
 	/** Indicates whether input timers are started */
 	apt_bool_t               timers_started;
 	/** Voice activity detector */
 	mpf_activity_detector_t *detector;
-	/** File to write utterance to */
-	FILE                    *audio_out;
-	/** grammar */
-	apr_xml_doc 			*grammar;
-	/** Actual recognizer **/
+	/** Utterance dump of the active request */
+	vosk_recog_dump_t       *dump;
+	/** Grammar defined by DEFINE-GRAMMAR (engine task context) */
+	vosk_recog_grammar_t    *grammar;
+	/** Memory charged to the session for the defined grammar */
+	apr_size_t               grammar_charge;
+	/** Grammar early results of the active request are matched against */
+	vosk_recog_grammar_t    *active_grammar;
+	/** Result of the last completed request, published by the decoder worker (NULL if none) */
+	vosk_recog_last_result_t * volatile last_result;
+	/** Fetch of the grammar referenced by URI by the pending request (engine task context) */
+	mrcp_grammar_fetch_t    *fetch;
+	/** Request processed on completion of the fetch */
+	mrcp_message_t          *fetch_request;
+	/** Response to the request */
+	mrcp_message_t          *fetch_response;
+	/** Grammar compiled on completion of the fetch, NULL on failure (fetcher thread) */
+	vosk_recog_grammar_t    *fetched_grammar;
+	/** Completion cause of the fetch (fetcher thread) */
+	mrcp_recog_completion_cause_e fetch_cause;
+	/** Whether the completion of the fetch is signaled to the engine task (fetcher thread) */
+	apt_bool_t               fetch_done;
+	/** Whether the channel is closed while the completion of the fetch is signaled */
+	apt_bool_t               close_pending;
+	/** Vocabulary the recognizer is constrained to (NULL for free-form) */
+	const char              *phrases;
+	/** Whether the active request spots keywords of the grammar (Recognition-Mode: hotword) */
+	apt_bool_t               hotword;
+	/** Whether the active request transcribes continuously till STOP (vendor-specific "continuous" param) */
+	apt_bool_t               continuous;
+	/** Whether voice activity has been detected in the active continuous request, no-input is ignored then (MPF context) */
+	apt_bool_t               activity_detected;
+	/** Number of segments sent by the active continuous request (decoder worker context) */
+	apr_size_t               segment_count;
+	/** Time (msec of input) the current segment starts at (decoder worker context) */
+	apr_size_t               segment_start;
+	/** Audio (msec) decoded in the current segment (decoder worker context) */
+	apr_size_t               segment_elapsed;
+	/** Time (msec of input) received by the request being decoded (decoder worker context) */
+	apr_size_t               input_elapsed;
+	/** Time (msec of input) of the checkpoint the active continuous request is resumed from (decoder worker context) */
+	apr_size_t               input_offset;
+	/** Response to STOP deferred till the checkpoint of the active continuous request is reached */
+	mrcp_message_t          *checkpoint_response;
+	/** State of the checkpoint of the active continuous request (vosk_recog_checkpoint_e) */
+	volatile apr_uint32_t    checkpoint_state;
+	/** Audio (msec) decoded since the checkpoint has been requested (decoder worker context) */
+	apr_size_t               checkpoint_elapsed;
+	/** Final result taken ahead of completion, a keyword is spotted in or the hypothesis is stable (decoder worker context) */
+	const char              *taken_result;
+	/** Actual recognizer, borrowed from the pool for the duration of a request **/
 	VoskRecognizer          *recognizer;
+	/** Recognizer of the second channel of stereo audio, borrowed along with the recognizer (NULL if mono) */
+	VoskRecognizer          *peer_recognizer;
+	/** Last result of the second channel taken at an endpoint of its recognizer (decoder worker context) */
+	const char              *peer_result;
+	/** Time (msec of input) the current segment of the second channel starts at (decoder worker context) */
+	apr_size_t               peer_segment_start;
+	/** Memory charged to the session for the recognizer of the active request */
+	apr_size_t               recognizer_charge;
+	/** Stream of the batch decoding backend, open for the duration of a request (instead of recognizer) */
+	vosk_recog_batch_stream_t *batch_stream;
+	/** Stream of the remote decoding backend, open for the duration of a request (instead of recognizer) */
+	vosk_recog_remote_stream_t *remote_stream;
+	/** Result taken from the batch or remote stream (decoder worker context) */
+	const char              *batch_result;
+	/** Model the recognizer is created for */
+	vosk_recog_model_t      *model;
+	/** Configured model a seat of is taken by the request (NULL if none) */
+	vosk_recog_model_t      *model_seat;
+	/** Sampling rate the recognizer is created for */
+	int                      sample_rate;
+	/** Table the G.711 codes of the request are expanded by (NULL if the audio is L16) */
+	const vosk_recog_g711_table_t *g711_table;
+	/** Size of a sample of the queued audio across its channels (1 for G.711, 2 for L16, doubled for stereo) */
+	apr_size_t               sample_size;
+	/** Number of interleaved channels of the audio of the request (2 for stereo, a speaker per channel) */
+	apr_size_t               channel_count;
+	/** G.711 frame expanded to L16 for activity detection (MPF context) */
+	apr_int16_t              detect_buffer[VOSK_RECOG_MAX_FRAME_SIZE];
+
+	/** Decoder worker the channel is pinned to */
+	vosk_recog_worker_t     *worker;
+	/** Queue of frames passed from the MPF scheduler to the decoder worker */
+	mpf_audio_queue_t       *frame_queue;
+	/** Indicates whether the decoder worker is already signaled to drain the queue */
+	volatile apr_uint32_t    scheduled;
+	/** Guard serializing the jobs of the channel, which idle workers may steal (NULL if stealing is disabled) */
+	apr_thread_mutex_t      *job_guard;
+	/** Whether the close job is processed, so that a stolen decoding job which lost the race to it is dropped */
+	apt_bool_t               job_closed;
+	/** Whether the close is to be responded to, once the guard is left (decoder worker context) */
+	apt_bool_t               close_respond;
+	/** Worker processing the job of the channel, the one it is pinned to unless the job is stolen (decoder worker context) */
+	vosk_recog_worker_t     *job_worker;
+	/** Detector event which could not be queued yet (MPF context) */
+	mpf_detector_event_e     pending_event;
+	/** Request being decoded (decoder worker context) */
+	mrcp_message_t          *decode_request;
+	/** Partial results matched for early results (decoder worker context) */
+	vosk_recog_partial_t     early_partial;
+	/** Partial results sent as intermediate results (decoder worker context) */
+	vosk_recog_partial_t     interim_partial;
+	/** Partial results checked for stability over silence, the elapsed time is since the last change (decoder worker context) */
+	vosk_recog_partial_t     stable_partial;
+	/** Whether the active request is endpointed by the combined endpointer */
+	apt_bool_t               endpoint_combined;
+	/** Time (msec of audio) of silence since the last frame of voice (decoder worker context) */
+	apr_size_t               endpoint_silence;
+	/** Interval (msec of audio) intermediate results are sent at (0 if disabled) */
+	apr_size_t               interim_interval;
+	/** Time (msec of input) the active request is recognized for at most (0 if not timed) */
+	apr_size_t               recognition_timeout;
+	/** Time (msec of input) decoded since START-OF-INPUT (decoder worker context) */
+	apr_size_t               recognition_elapsed;
+	/** Whether the recognition timeout has expired, the final result is pending (decoder worker context) */
+	apt_bool_t               recognition_expired;
+	/** Options of the result of the active request */
+	vosk_recog_result_options_t result_options;
+	/** Whether the result of the active request is rescored by the rescore model on low confidence */
+	apt_bool_t               rescore;
+	/** Audio of the utterance passed to the recognizer, decoded again on rescoring (decoder worker context) */
+	char                    *rescore_buffer;
+	/** Size of the rescore buffer (fits the rescore max time at the max sampling rate, 0 if rescoring is disabled) */
+	apr_size_t               rescore_capacity;
+	/** Size of kept audio (decoder worker context) */
+	apr_size_t               rescore_length;
+	/** Whether the audio of the utterance is not kept whole, it is not rescored then (decoder worker context) */
+	apt_bool_t               rescore_dropped;
+	/** Request whose result is being rescored, owned by the rescore worker till the result is signaled back */
+	mrcp_message_t          *rescore_request;
+	/** Result of the first pass, taken if rescoring fails */
+	const char              *rescore_first;
+	/** Grammar referenced for the duration of rescoring, the phrases of the recognizer belong to */
+	vosk_recog_grammar_t    *rescore_grammar;
+	/** Phrases the rescoring recognizer is constrained to (NULL for free-form) */
+	const char              *rescore_phrases;
+	/** Sampling rate of the kept audio */
+	int                      rescore_sample_rate;
+	/** Table the kept G.711 codes are expanded by (NULL if the kept audio is L16) */
+	const vosk_recog_g711_table_t *rescore_g711_table;
+	/** Samples of a piece of the kept G.711 audio expanded for the rescore model (rescore worker context) */
+	float                   *rescore_samples;
+	/** Rescore worker the utterance is decoded by */
+	vosk_recog_worker_t     *rescore_worker;
+	/** Version of the rescore model the recognizer is created for (rescore worker context) */
+	vosk_recog_model_t      *rescore_version;
+	/** Recognizer of the rescore model, borrowed from the pool for the duration of rescoring (rescore worker context) */
+	VoskRecognizer          *rescore_recognizer;
+	/** Final result of the rescore model, NULL if none (rescore worker context) */
+	const char              *rescore_result;
+	/** Indicates whether rescoring is to be abandoned, by STOP or close */
+	volatile apr_uint32_t    rescore_cancel;
+	/** Whether the channel is closed while rescoring is in progress (decoder worker context) */
+	apt_bool_t               rescore_close;
+	/** Caller of the session the speech is kept for (empty if none) */
+	char                     caller_id[VOSK_RECOG_ADAPT_MAX_CALLER_ID + 1];
+	/** Whether the recognizer of the next request is to be primed by the speech stored for the caller */
+	apt_bool_t               adapt_pending;
+	/** Voiced speech of the caller kept for the next call, L16 (decoder worker context) */
+	char                    *adapt_buffer;
+	/** Size of the adaptation buffer (fits the adaptation time at the max sampling rate, 0 if disabled) */
+	apr_size_t               adapt_capacity;
+	/** Size of kept speech (decoder worker context) */
+	apr_size_t               adapt_length;
+	/** Sampling rate of kept speech */
+	int                      adapt_sample_rate;
+	/** Whether the call is taken as held, no frames are queued meanwhile (MPF context) */
+	apt_bool_t               media_held;
+	/** Time (msec) since the last incoming audio (MPF context) */
+	apr_size_t               media_idle;
+	/** Whether the flight recorder of the stream is to be dumped once the request is done with (any context) */
+	volatile apr_uint32_t    media_trace_dump;
+	/** Whether the channel is suspended on hold, unpinned from its worker (decoder worker context) */
+	apt_bool_t               suspended;
+	/** Request the recognizer of which is returned to the pool on hold, NULL if none (decoder worker context) */
+	mrcp_message_t          *suspended_request;
+	/** Audio accumulated to pass to the recognizer at once (decoder worker context) */
+	char                    *chunk_buffer;
+	/** Size of the chunk buffer (fits the chunk time at the max sampling rate) */
+	apr_size_t               chunk_capacity;
+	/** Samples of a G.711 chunk expanded for the decoder (NULL if frames are only taken in L16) */
+	float                   *chunk_samples;
+	/** Second channel split off a stereo chunk, the first one is compacted in place (half the chunk capacity) */
+	char                    *split_buffer;
+	/** Models of the candidate languages of the active request, NULL unless its language is yet to be identified */
+	apr_array_header_t      *lid_models;
+	/** Speech held back from the recognizer till its language is identified (NULL if language identification is disabled) */
+	char                    *lid_buffer;
+	/** Size of the buffer (fits the identification time at the max sampling rate, and the chunk which overruns it) */
+	apr_size_t               lid_capacity;
+	/** Size of held speech (decoder worker context) */
+	apr_size_t               lid_length;
+	/** Size of speech to hold at the sampling rate of the request */
+	apr_size_t               lid_threshold;
+	/** Size of accumulated audio (decoder worker context) */
+	apr_size_t               chunk_length;
+	/** Size of audio to accumulate at the sampling rate of the request */
+	apr_size_t               chunk_threshold;
+	/** Ring of audio held back from the recognizer while there is no voice (decoder worker context) */
+	char                    *gate_buffer;
+	/** Size of the gate buffer (fits the pre-roll time at the max sampling rate, 0 if gating is disabled) */
+	apr_size_t               gate_capacity;
+	/** Offset of the oldest held audio in the gate buffer (decoder worker context) */
+	apr_size_t               gate_offset;
+	/** Size of held audio (decoder worker context) */
+	apr_size_t               gate_length;
+	/** Size of audio to hold at the sampling rate of the request */
+	apr_size_t               gate_threshold;
+	/** Whether voice activity has been detected in the current request (decoder worker context) */
+	apt_bool_t               gate_open;
+	/** Audio input of the active batch request, read by the decoder worker instead of the media stream */
+	vosk_recog_audio_t       audio;
+	/** Batch request the audio input is decoded for */
+	mrcp_message_t          *audio_request;
+	/** Indicates whether decoding of the audio input is to be abandoned */
+	volatile apr_uint32_t    audio_cancel;
+
+	/** Whether the active request references a DTMF grammar */
+	apt_bool_t               dtmf_enabled;
+	/** DTMF grammar of the active request */
+	vosk_recog_dtmf_grammar_t dtmf_grammar;
+	/** Time (msec) to wait for the next digit (0 if not timed) */
+	apr_size_t               dtmf_interdigit_timeout;
+	/** Digits collected in the active request, the term char included (MPF context) */
+	char                     dtmf_digits[VOSK_RECOG_DTMF_MAX_DIGITS + 1];
+	/** Number of digits collected (MPF context) */
+	apr_size_t               dtmf_length;
+	/** Time (msec) elapsed since the last digit (MPF context) */
+	apr_size_t               dtmf_elapsed;
+	/** Completion cause of DTMF input which could not be queued yet, UNKNOWN if none (MPF context) */
+	mrcp_recog_completion_cause_e dtmf_cause;
+	/** Whether START-OF-INPUT is sent for the request being decoded (decoder worker context) */
+	apt_bool_t               input_started;
+
+	/** Smoothed real-time factor (permille) of decoding the channel (decoder worker context) */
+	apr_uint32_t             rtf_avg;
+	/** Whether the channel is decoded by cheaper settings, as decoding falls behind (decoder worker context) */
+	apt_bool_t               degraded;
+
+	/** Ring of the last frames written while no request is active, replayed into the next one (MPF context) */
+	vosk_recog_preroll_frame_t *preroll;
+	/** Capacity of the ring in frames (0 if disabled) */
+	apr_size_t               preroll_capacity;
+	/** Index of the oldest frame in the ring (MPF context) */
+	apr_size_t               preroll_head;
+	/** Number of frames in the ring (MPF context) */
+	apr_size_t               preroll_count;
 };
 
 typedef enum {
+	VOSK_RECOG_FRAME_AUDIO,
+	VOSK_RECOG_FRAME_DTMF,
+	VOSK_RECOG_FRAME_STOP,
+	VOSK_RECOG_FRAME_HOLD,
+	VOSK_RECOG_FRAME_RESUME
+} vosk_recog_frame_type_e;
+
+/** State of the checkpoint of continuous transcription */
+typedef enum {
+	VOSK_RECOG_CHECKPOINT_NONE,     /**< not requested */
+	VOSK_RECOG_CHECKPOINT_PENDING,  /**< requested by STOP, the segment in progress is awaited (engine task context) */
+	VOSK_RECOG_CHECKPOINT_REACHED   /**< reached at the boundary of segments, the input past it is dropped (decoder worker context) */
+} vosk_recog_checkpoint_e;
+
+/** Frame of audio kept ahead of a request */
+struct vosk_recog_preroll_frame_t {
+	/** Size of the audio */
+	apr_size_t               size;
+	/** Audio of the frame */
+	char                     data[VOSK_RECOG_MAX_FRAME_SIZE];
+};
+
+/** Declaration of frame passed from the MPF scheduler to the decoder worker */
+struct vosk_recog_frame_t {
+	/** Frame type */
+	vosk_recog_frame_type_e  type;
+	/** Associated RECOGNIZE request or pending STOP response */
+	mrcp_message_t          *message;
+	/** Indicates the first frame of the request */
+	apt_bool_t               start;
+	/** Event raised by activity detector */
+	mpf_detector_event_e     det_event;
+	/** Whether the frame is considered voice by activity detector */
+	apt_bool_t               voice;
+	/** Whether the frame carries no audio, but a frame time of silence signaled by comfort noise */
+	apt_bool_t               silence;
+	/** Completion cause of DTMF input (UNKNOWN on the first digit) */
+	mrcp_recog_completion_cause_e cause;
+	/** Size of audio data (or number of digits) */
+	apr_size_t               size;
+	/** Audio data, either the buffer or the data of the shared frame */
+	const char              *data;
+	/** Shared frame retained by the queue (NULL if audio is copied to the buffer) */
+	mpf_frame_ref_t         *ref;
+	/** Audio data copied */
+	char                     buffer[VOSK_RECOG_MAX_FRAME_SIZE];
+};
+
+typedef enum {
+	VOSK_RECOG_JOB_DECODE,
+	VOSK_RECOG_JOB_CLOSE,
+	VOSK_RECOG_JOB_RESULT,
+	VOSK_RECOG_JOB_REMOTE_RESULT,
+	VOSK_RECOG_JOB_AUDIO,
+	VOSK_RECOG_JOB_RESCORE,
+	VOSK_RECOG_JOB_RESCORE_RESULT
+} vosk_recog_job_type_e;
+
+typedef enum {
+	vosk_recog_MSG_OPEN_ENGINE,
 	vosk_recog_MSG_OPEN_CHANNEL,
 	vosk_recog_MSG_CLOSE_CHANNEL,
-	vosk_recog_MSG_REQUEST_PROCESS
+	vosk_recog_MSG_REQUEST_PROCESS,
+	vosk_recog_MSG_GRAMMAR_FETCH
 } vosk_recog_msg_type_e;
 
+/** Status of the grammar referenced by URI by a request */
+typedef enum {
+	VOSK_RECOG_FETCH_NONE,    /**< the request references no grammar to fetch */
+	VOSK_RECOG_FETCH_DONE,    /**< the grammar is taken from memory and compiled */
+	VOSK_RECOG_FETCH_PENDING, /**< the request is processed on completion of the fetch */
+	VOSK_RECOG_FETCH_FAILED   /**< the response is set to failure */
+} vosk_recog_fetch_status_e;
+
 /** Declaration of kaldi recognizer task message */
 struct vosk_recog_msg_t {
 	vosk_recog_msg_type_e  type;
+	mrcp_engine_t         *engine;
 	mrcp_engine_channel_t *channel; 
 	mrcp_message_t        *request;
 };
 
 static apt_bool_t vosk_recog_msg_signal(vosk_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request);
+static apt_bool_t vosk_recog_engine_msg_signal(vosk_recog_msg_type_e type, mrcp_engine_t *engine, mrcp_engine_channel_t *channel, mrcp_message_t *request);
 static apt_bool_t vosk_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg);
+static void vosk_recog_job_process(vosk_recog_worker_t *worker, int type, void *obj);
+static void vosk_recog_rescore_job_process(vosk_recog_worker_t *worker, int type, void *obj);
+static void vosk_recog_batch_on_result(vosk_recog_batch_stream_t *stream, void *obj);
+static void vosk_recog_remote_on_result(vosk_recog_remote_stream_t *stream, void *obj);
+static void vosk_recog_gather_process(vosk_recog_worker_t *worker, void **objs, apr_size_t count);
+static APR_INLINE void vosk_recog_partial_reset(vosk_recog_partial_t *partial);
+static apt_bool_t vosk_recog_channel_slab_create(vosk_recog_engine_t *kaldi_engine, apr_size_t count, apr_pool_t *pool);
+static void vosk_recog_media_hold(vosk_recog_channel_t *recog_channel, const char *reason);
+static void vosk_recog_speaker_channel_tag(vosk_recog_channel_t *recog_channel, mrcp_message_t *message, apr_size_t index);
+static void vosk_recog_peer_complete(vosk_recog_channel_t *recog_channel, mrcp_message_t *request);
 
 /** Declare this macro to set plugin version */
 MRCP_PLUGIN_VERSION_DECLARE
@@ -142,575 +762,4850 @@ MRCP_PLUGIN_VERSION_DECLARE
  */
 MRCP_PLUGIN_LOG_SOURCE_IMPLEMENT(RECOG_PLUGIN,"RECOG-PLUGIN")
 
-/** Use custom log source mark */
-#define RECOG_LOG_MARK   APT_LOG_MARK_DECLARE(RECOG_PLUGIN)
-
 /** Create kaldi recognizer engine */
 MRCP_PLUGIN_DECLARE(mrcp_engine_t*) mrcp_plugin_create(apr_pool_t *pool)
 {
 	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)apr_palloc(pool,sizeof(vosk_recog_engine_t));
-	apt_task_t *task;
-	apt_task_vtable_t *vtable;
-	apt_task_msg_pool_t *msg_pool;
-
-	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(vosk_recog_msg_t),pool);
-	kaldi_engine->task = apt_consumer_task_create(kaldi_engine,msg_pool,pool);
-	if(!kaldi_engine->task) {
-		return NULL;
-	}
-	task = apt_consumer_task_base_get(kaldi_engine->task);
-	apt_task_name_set(task,RECOG_ENGINE_TASK_NAME);
-	vtable = apt_task_vtable_get(task);
-	if(vtable) {
-		vtable->process_msg = vosk_recog_msg_process;
-	}
 
-	kaldi_engine->model = vosk_model_new("/opt/kaldi/model");
+	kaldi_engine->msg_pool = apt_task_msg_pool_create_dynamic(sizeof(vosk_recog_msg_t),pool);
+	/* the number of tasks is configured by engine params, tasks are created on open */
+	kaldi_engine->tasks = NULL;
+	kaldi_engine->task_count = 0;
+	kaldi_engine->worker_pool = NULL;
+	kaldi_engine->rescore_pool = NULL;
+	kaldi_engine->rescore_model = NULL;
+	kaldi_engine->rescore_confidence = 0;
+	kaldi_engine->rescore_max_time = VOSK_RECOG_DEFAULT_RESCORE_MAX_TIME;
+	kaldi_engine->adapt_store = NULL;
+	kaldi_engine->adapt_time = VOSK_RECOG_DEFAULT_ADAPT_TIME;
+	kaldi_engine->lid_time = 0;
+	/* models are configured by engine params, which are only available on open */
+	kaldi_engine->models = NULL;
+	kaldi_engine->recog_pool = NULL;
+	kaldi_engine->batch = NULL;
+	kaldi_engine->cpu_batch = FALSE;
+	kaldi_engine->remote = NULL;
+	kaldi_engine->remote_local_models = FALSE;
+	kaldi_engine->recog_pool_size = 0;
+	kaldi_engine->model_load_threads = VOSK_RECOG_MODEL_LOAD_THREADS;
+	kaldi_engine->numa_mode = VOSK_RECOG_NUMA_NONE;
+	kaldi_engine->media_affinity = FALSE;
+	kaldi_engine->model_watch_interval = 0;
+	kaldi_engine->warm_up_audio_8k = NULL;
+	kaldi_engine->warm_up_audio_16k = NULL;
+	kaldi_engine->spk_model_path = NULL;
+	kaldi_engine->spk_model = NULL;
+	kaldi_engine->voiceprints = NULL;
+	kaldi_engine->speaker_threshold = VOSK_RECOG_DEFAULT_SPEAKER_THRESHOLD;
+	kaldi_engine->sample_rates = MPF_SAMPLE_RATE_8000 | MPF_SAMPLE_RATE_16000;
+	kaldi_engine->g711_tables = NULL;
+	kaldi_engine->grammar_cache = NULL;
+	kaldi_engine->precompiled_grammars = NULL;
+	kaldi_engine->precompiled_phrases = NULL;
+	kaldi_engine->itn = NULL;
+	kaldi_engine->result_cache = NULL;
+	kaldi_engine->grammar_fetcher = NULL;
+	kaldi_engine->partial_interval = VOSK_RECOG_DEFAULT_PARTIAL_INTERVAL;
+	kaldi_engine->chunk_time = VOSK_RECOG_DEFAULT_CHUNK_TIME;
+	kaldi_engine->interim_interval = 0;
+	kaldi_engine->recognition_timeout = VOSK_RECOG_DEFAULT_RECOGNITION_TIMEOUT;
+	kaldi_engine->segment_time = VOSK_RECOG_DEFAULT_SEGMENT_TIME;
+	kaldi_engine->checkpoint_timeout = VOSK_RECOG_DEFAULT_CHECKPOINT_TIMEOUT;
+	kaldi_engine->dump_writer = NULL;
+	kaldi_engine->dump_enabled = FALSE;
+	kaldi_engine->dump_wav = FALSE;
+	kaldi_engine->constrained_decoding = FALSE;
+	kaldi_engine->closed_grammar_max_phrases = VOSK_RECOG_DEFAULT_CLOSED_GRAMMAR_MAX_PHRASES;
+	kaldi_engine->last_result_max_size = VOSK_RECOG_DEFAULT_LAST_RESULT_MAX_SIZE;
+	kaldi_engine->result_options.n_best = 1;
+	kaldi_engine->result_options.word_timings = FALSE;
+	kaldi_engine->result_options.confidence_only = FALSE;
+	kaldi_engine->result_options.confidence_threshold = 0;
+	kaldi_engine->result_options.interpret = NULL;
+	kaldi_engine->result_options.interpret_obj = NULL;
+	kaldi_engine->vad_gate = FALSE;
+	kaldi_engine->degrade_rtf = 0;
+	kaldi_engine->degrade_backlog = VOSK_RECOG_DEFAULT_DEGRADE_BACKLOG;
+	kaldi_engine->frame_queue_time = VOSK_RECOG_DEFAULT_FRAME_QUEUE_TIME;
+	kaldi_engine->hold_timeout = 0;
+	kaldi_engine->work_stealing = FALSE;
+	kaldi_engine->frame_queue_policy = MPF_AUDIO_QUEUE_DROP_OLDEST;
+	kaldi_engine->pre_roll_time = VOSK_RECOG_DEFAULT_PRE_ROLL_TIME;
+	kaldi_engine->input_pre_roll_time = 0;
+	kaldi_engine->vad_mode = MPF_DETECTOR_MODE_FIXED;
+	kaldi_engine->endpointer = VOSK_RECOG_ENDPOINTER_VAD;
+	kaldi_engine->endpoint_stable_time = VOSK_RECOG_DEFAULT_ENDPOINT_STABLE_TIME;
+	kaldi_engine->decoder_endpointer_mode = -1;
+	kaldi_engine->audio_dir = NULL;
+	kaldi_engine->slab = NULL;
+	kaldi_engine->slab_count = 0;
+	kaldi_engine->slab_guard = NULL;
 
 	/* create engine base */
-	return mrcp_engine_create(
+	kaldi_engine->engine = mrcp_engine_create(
 				MRCP_RECOGNIZER_RESOURCE,  /* MRCP resource identifier */
 				kaldi_engine,               /* object to associate */
 				&engine_vtable,            /* virtual methods table of engine */
 				pool);                     /* pool to allocate memory from */
+	return kaldi_engine->engine;
 }
 
 /** Destroy recognizer engine */
 static apt_bool_t vosk_recog_engine_destroy(mrcp_engine_t *engine)
 {
 	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
-	if(kaldi_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->task);
+	apr_size_t i;
+	for(i=0; i<kaldi_engine->task_count; i++) {
+		apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->tasks[i]);
 		apt_task_destroy(task);
-		kaldi_engine->task = NULL;
 	}
-	if (kaldi_engine->model) {
-		vosk_model_free(kaldi_engine->model);
-		kaldi_engine->model = NULL;
+	kaldi_engine->tasks = NULL;
+	kaldi_engine->task_count = 0;
+	if(kaldi_engine->worker_pool) {
+		vosk_recog_worker_pool_destroy(kaldi_engine->worker_pool);
+		kaldi_engine->worker_pool = NULL;
+	}
+	if(kaldi_engine->rescore_pool) {
+		vosk_recog_worker_pool_destroy(kaldi_engine->rescore_pool);
+		kaldi_engine->rescore_pool = NULL;
+	}
+	if(kaldi_engine->dump_writer) {
+		vosk_recog_dump_writer_destroy(kaldi_engine->dump_writer);
+		kaldi_engine->dump_writer = NULL;
+	}
+	if(kaldi_engine->grammar_fetcher) {
+		/* fetched grammars are compiled by the fetcher threads, hence destroyed before the grammar cache */
+		mrcp_grammar_fetcher_destroy(kaldi_engine->grammar_fetcher);
+		kaldi_engine->grammar_fetcher = NULL;
+	}
+	if(kaldi_engine->precompiled_grammars) {
+		apr_hash_index_t *it;
+		void *val;
+		for(it = apr_hash_first(NULL,kaldi_engine->precompiled_grammars); it; it = apr_hash_next(it)) {
+			apr_hash_this(it,NULL,NULL,&val);
+			vosk_recog_grammar_unref(val);
+		}
+		kaldi_engine->precompiled_grammars = NULL;
+		kaldi_engine->precompiled_phrases = NULL;
+	}
+	if(kaldi_engine->grammar_cache) {
+		vosk_recog_grammar_cache_destroy(kaldi_engine->grammar_cache);
+		kaldi_engine->grammar_cache = NULL;
+	}
+	/* the FST of the ITN grammar is unmapped with the engine pool */
+	kaldi_engine->itn = NULL;
+	if(kaldi_engine->result_cache) {
+		vosk_recog_nlsml_cache_destroy(kaldi_engine->result_cache);
+		kaldi_engine->result_cache = NULL;
+	}
+	if(kaldi_engine->adapt_store) {
+		vosk_recog_adapt_store_destroy(kaldi_engine->adapt_store);
+		kaldi_engine->adapt_store = NULL;
+	}
+	if(kaldi_engine->recog_pool) {
+		vosk_recog_pool_destroy(kaldi_engine->recog_pool);
+		kaldi_engine->recog_pool = NULL;
+	}
+	if(kaldi_engine->spk_model) {
+		/* the recognizers referencing the speaker model are freed */
+		vosk_spk_model_free(kaldi_engine->spk_model);
+		kaldi_engine->spk_model = NULL;
+	}
+	if(kaldi_engine->voiceprints) {
+		mrcp_voiceprint_store_close(kaldi_engine->voiceprints);
+		kaldi_engine->voiceprints = NULL;
+	}
+	if(kaldi_engine->models) {
+		vosk_recog_model_registry_unload(kaldi_engine->models);
+		kaldi_engine->models = NULL;
+	}
+	if(kaldi_engine->remote) {
+		vosk_recog_remote_destroy(kaldi_engine->remote);
+		kaldi_engine->remote = NULL;
+	}
+	if(kaldi_engine->slab_guard) {
+		apr_thread_mutex_destroy(kaldi_engine->slab_guard);
+		kaldi_engine->slab_guard = NULL;
 	}
+	kaldi_engine->slab = NULL;
+	kaldi_engine->slab_count = 0;
 	return TRUE;
 }
 
-/** Open recognizer engine */
-static apt_bool_t vosk_recog_engine_open(mrcp_engine_t *engine)
+/** Create engine tasks */
+static apt_bool_t vosk_recog_engine_tasks_create(vosk_recog_engine_t *kaldi_engine, apr_size_t count, apr_pool_t *pool)
 {
-	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
-	if(kaldi_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->task);
-		apt_task_start(task);
+	apr_size_t i;
+	kaldi_engine->tasks = apr_palloc(pool,sizeof(apt_consumer_task_t*) * count);
+	for(i=0; i<count; i++) {
+		apt_task_t *task;
+		apt_task_vtable_t *vtable;
+		kaldi_engine->tasks[i] = apt_consumer_task_create(kaldi_engine,kaldi_engine->msg_pool,pool);
+		if(!kaldi_engine->tasks[i]) {
+			return FALSE;
+		}
+		kaldi_engine->task_count++;
+		task = apt_consumer_task_base_get(kaldi_engine->tasks[i]);
+		if(count == 1) {
+			apt_task_name_set(task,RECOG_ENGINE_TASK_NAME);
+		}
+		else {
+			apt_task_name_set(task,apr_psprintf(pool,RECOG_ENGINE_TASK_NAME" %"APR_SIZE_T_FMT,i+1));
+		}
+		vtable = apt_task_vtable_get(task);
+		if(vtable) {
+			vtable->process_msg = vosk_recog_msg_process;
+		}
 	}
-	return mrcp_engine_open_respond(engine,TRUE);
+	return TRUE;
 }
 
-/** Close recognizer engine */
-static apt_bool_t vosk_recog_engine_close(mrcp_engine_t *engine)
+/** Open recognizer engine */
+/** Create client of the remote decoding backend by the remote-* engine params */
+static apt_bool_t vosk_recog_engine_remote_create(vosk_recog_engine_t *kaldi_engine)
 {
-	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
-	if(kaldi_engine->task) {
-		apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->task);
-		apt_task_terminate(task,TRUE);
+	mrcp_engine_t *engine = kaldi_engine->engine;
+	apr_size_t idle_count = 1;
+	apr_size_t connect_timeout = 0;
+	apr_size_t check_interval = 0;
+	char *decoders;
+	char *uri;
+	char *state;
+	const char *value = mrcp_engine_param_get(engine,"remote-decoders");
+	if(!value) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No remote-decoders Set for decoder-backend [remote]");
+		return FALSE;
 	}
-	return mrcp_engine_close_respond(engine);
-}
-
-static mrcp_engine_channel_t* vosk_recog_engine_channel_create(mrcp_engine_t *engine, apr_pool_t *pool)
-{
-	mpf_stream_capabilities_t *capabilities;
-	mpf_termination_t *termination; 
-
-	/* create kaldi recog channel */
-	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)apr_palloc(pool,sizeof(vosk_recog_channel_t));
-	recog_channel->kaldi_engine = (vosk_recog_engine_t*)engine->obj;
-    recog_channel->recognizer = NULL;
-	recog_channel->recog_request = NULL;
-	recog_channel->stop_response = NULL;
-	recog_channel->grammar = NULL;
-	recog_channel->detector = mpf_activity_detector_create(pool);
-	recog_channel->audio_out = NULL;
 
-	capabilities = mpf_sink_stream_capabilities_create(pool);
-	mpf_codec_capabilities_add(
-			&capabilities->codecs,
-			MPF_SAMPLE_RATE_8000 | MPF_SAMPLE_RATE_16000,
-			"LPCM");
+	/* audio is sent once per chunk time, streams fit a few chunks at the max rate */
+	kaldi_engine->remote = vosk_recog_remote_create(
+							engine->config->max_channel_count ? engine->config->max_channel_count : VOSK_RECOG_DEFAULT_REMOTE_STREAMS,
+							VOSK_RECOG_BATCH_BUFFER_CHUNKS * kaldi_engine->chunk_time * 16000 / 1000 * BYTES_PER_SAMPLE,
+							vosk_recog_remote_on_result,
+							engine->pool);
+	if(!kaldi_engine->remote) {
+		return FALSE;
+	}
+	decoders = apr_pstrdup(engine->pool,value);
+	for(uri = apr_strtok(decoders,", ",&state); uri; uri = apr_strtok(NULL,", ",&state)) {
+		vosk_recog_remote_decoder_add(kaldi_engine->remote,uri);
+	}
+	mrcp_engine_param_size_get(engine,"remote-idle-connections",&idle_count);
+	mrcp_engine_param_duration_get(engine,"remote-connect-timeout",&connect_timeout);
+	mrcp_engine_param_duration_get(engine,"remote-check-interval",&check_interval);
+	vosk_recog_remote_pool_set(kaldi_engine->remote,idle_count,connect_timeout,check_interval);
 
-	/* create media termination */
-	termination = mrcp_engine_audio_termination_create(
-			recog_channel,        /* object to associate */
-			&audio_stream_vtable, /* virtual methods table of audio stream */
-			capabilities,         /* stream capabilities */
-			pool);                /* pool to allocate memory from */
+	mrcp_engine_param_bool_get(engine,"remote-local-models",&kaldi_engine->remote_local_models);
+	if(kaldi_engine->remote_local_models == FALSE) {
+		/* the remote decoders resample the input, as the local models would */
+		kaldi_engine->sample_rates = MPF_SAMPLE_RATE_8000 | MPF_SAMPLE_RATE_16000;
+	}
+	return TRUE;
+}
 
-	/* create engine channel base */
-	recog_channel->channel = mrcp_engine_channel_create(
-			engine,               /* engine */
-			&channel_vtable,      /* virtual methods table of engine channel */
-			recog_channel,        /* object to associate */
-			termination,          /* associated media termination */
-			pool);                /* pool to allocate memory from */
+/**
+ * Compile the grammars listed by the precompiled-grammars engine param as id=path pairs,
+ * so that requests reference them by builtin:grammar/<id> or session:<id> URIs at no parse cost.
+ */
+static void vosk_recog_engine_grammars_precompile(vosk_recog_engine_t *kaldi_engine, mrcp_engine_t *engine)
+{
+	vosk_recog_grammar_t *grammar;
+	const char *phrases;
+	char *grammars;
+	char *entry;
+	char *path;
+	char *state;
+	const char *value = mrcp_engine_param_get(engine,"precompiled-grammars");
+	if(!value || *value == '\0') {
+		return;
+	}
 
-	return recog_channel->channel;
+	kaldi_engine->precompiled_grammars = apr_hash_make(engine->pool);
+	kaldi_engine->precompiled_phrases = apr_array_make(engine->pool,1,sizeof(const char*));
+	grammars = apr_pstrdup(engine->pool,value);
+	for(entry = apr_strtok(grammars,", ",&state); entry; entry = apr_strtok(NULL,", ",&state)) {
+		path = strchr(entry,'=');
+		if(!path || path == entry || *(path+1) == '\0') {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid precompiled-grammars Entry [%s]",entry);
+			continue;
+		}
+		*path++ = '\0';
+		if(apr_hash_get(kaldi_engine->precompiled_grammars,entry,APR_HASH_KEY_STRING)) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Duplicate Precompiled Grammar [%s]",entry);
+			continue;
+		}
+		/* the reference is held till engine close, hence the grammar is never evicted from the cache */
+		grammar = vosk_recog_grammar_cache_load(
+					kaldi_engine->grammar_cache,
+					apt_datadir_filepath_get(engine->dir_layout,path,engine->pool));
+		if(!grammar) {
+			continue;
+		}
+		apr_hash_set(kaldi_engine->precompiled_grammars,entry,APR_HASH_KEY_STRING,grammar);
+		phrases = vosk_recog_grammar_phrases_get(grammar);
+		if(phrases && kaldi_engine->constrained_decoding == TRUE) {
+			/* the constrained recognizers are built by the loader threads, along with the free-form ones */
+			APR_ARRAY_PUSH(kaldi_engine->precompiled_phrases,const char*) = phrases;
+		}
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Precompile Grammar [%s] [%s] [%s]",entry,path,engine->id);
+	}
 }
 
-/** Destroy engine channel */
-static apt_bool_t vosk_recog_channel_destroy(mrcp_engine_channel_t *channel)
+/** Find the precompiled grammar referenced by builtin:grammar/<id> or session:<id> URI (NULL if none) */
+static vosk_recog_grammar_t* vosk_recog_grammar_precompiled_find(vosk_recog_engine_t *kaldi_engine, const char *uri)
 {
-	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"channel destory %s", channel->id.buf);
-	/* nothing to destrtoy */
-	return TRUE;
+	const char *id;
+	if(!kaldi_engine->precompiled_grammars) {
+		return NULL;
+	}
+	if(strncasecmp(uri,VOSK_RECOG_PRECOMPILED_URI_BUILTIN,sizeof(VOSK_RECOG_PRECOMPILED_URI_BUILTIN)-1) == 0) {
+		id = uri + sizeof(VOSK_RECOG_PRECOMPILED_URI_BUILTIN)-1;
+	}
+	else if(strncasecmp(uri,VOSK_RECOG_PRECOMPILED_URI_SESSION,sizeof(VOSK_RECOG_PRECOMPILED_URI_SESSION)-1) == 0) {
+		id = uri + sizeof(VOSK_RECOG_PRECOMPILED_URI_SESSION)-1;
+	}
+	else {
+		return NULL;
+	}
+	return apr_hash_get(kaldi_engine->precompiled_grammars,id,APR_HASH_KEY_STRING);
 }
 
-/** Open engine channel (asynchronous response MUST be sent)*/
-static apt_bool_t vosk_recog_channel_open(mrcp_engine_channel_t *channel)
+/** Create workers rescoring low-confidence results by the rescore-* engine params */
+/** Create the tables G.711 frames taken in as is are expanded by straight to the samples of the decoder */
+static apt_bool_t vosk_recog_engine_g711_create(vosk_recog_engine_t *kaldi_engine, apr_pool_t *pool)
 {
-	return vosk_recog_msg_signal(vosk_recog_MSG_OPEN_CHANNEL,channel,NULL);
+	static const char *names[VOSK_RECOG_G711_TABLE_COUNT] = {"PCMU", "PCMA"};
+	vosk_recog_g711_table_t *tables = apr_palloc(pool,sizeof(vosk_recog_g711_table_t) * VOSK_RECOG_G711_TABLE_COUNT);
+	apr_size_t i;
+	apr_size_t code;
+	for(i=0; i<VOSK_RECOG_G711_TABLE_COUNT; i++) {
+		apt_string_set(&tables[i].name,names[i]);
+		/* the same linear samples MPF decodes the codes to, so that the decoder is fed the same audio */
+		tables[i].linear = mpf_codec_g711_decode_table_get(&tables[i].name);
+		if(!tables[i].linear) {
+			return FALSE;
+		}
+		for(code=0; code<256; code++) {
+			tables[i].samples[code] = (float)tables[i].linear[code];
+		}
+	}
+	kaldi_engine->g711_tables = tables;
+	return TRUE;
 }
 
-/** Close engine channel (asynchronous response MUST be sent)*/
-static apt_bool_t vosk_recog_channel_close(mrcp_engine_channel_t *channel)
+/** Get the table the codes of the session are expanded by, NULL if frames are taken in L16 */
+static const vosk_recog_g711_table_t* vosk_recog_g711_table_get(const vosk_recog_engine_t *kaldi_engine, const mpf_codec_descriptor_t *descriptor)
 {
-	return vosk_recog_msg_signal(vosk_recog_MSG_CLOSE_CHANNEL,channel,NULL);
+	apr_size_t i;
+	if(!kaldi_engine->g711_tables || !descriptor) {
+		return NULL;
+	}
+	for(i=0; i<VOSK_RECOG_G711_TABLE_COUNT; i++) {
+		if(apt_string_compare(&kaldi_engine->g711_tables[i].name,&descriptor->name) == TRUE) {
+			return &kaldi_engine->g711_tables[i];
+		}
+	}
+	return NULL;
 }
 
-/** Process MRCP channel request (asynchronous response MUST be sent)*/
-static apt_bool_t vosk_recog_channel_request_process(mrcp_engine_channel_t *channel, mrcp_message_t *request)
+/** Expand G.711 codes by the table */
+static APR_INLINE void vosk_recog_g711_expand(const vosk_recog_g711_table_t *table, const char *buffer, apr_size_t size, float *samples)
 {
-	return vosk_recog_msg_signal(vosk_recog_MSG_REQUEST_PROCESS,channel,request);
+	const apr_byte_t *codes = (const apr_byte_t*)buffer;
+	apr_size_t i;
+	for(i=0; i<size; i++) {
+		samples[i] = table->samples[codes[i]];
+	}
 }
 
-/** Process RECOGNIZE request */
-static apt_bool_t vosk_recog_channel_recognize(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
+/** Expand G.711 codes by the table to linear samples */
+static APR_INLINE void vosk_recog_g711_linear_expand(const vosk_recog_g711_table_t *table, const char *buffer, apr_size_t size, apr_int16_t *linear)
 {
-	/* process RECOGNIZE request */
-	mrcp_recog_header_t *recog_header;
-	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
-	const mpf_codec_descriptor_t *descriptor = mrcp_engine_sink_stream_codec_get(channel);
-
-	if(!descriptor) {
-		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec Descriptor " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
-		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
-		return FALSE;
+	const apr_byte_t *codes = (const apr_byte_t*)buffer;
+	apr_size_t i;
+	for(i=0; i<size; i++) {
+		linear[i] = table->linear[codes[i]];
 	}
+}
 
-	recog_channel->timers_started = TRUE;
-
-	/* get recognizer header */
-	recog_header = (mrcp_recog_header_t*)mrcp_resource_header_get(request);
-	if(recog_header) {
-		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_START_INPUT_TIMERS) == TRUE) {
-			recog_channel->timers_started = recog_header->start_input_timers;
+/**
+ * Split stereo audio into its channels, the first one is compacted in place, the second one is written to right.
+ * @param buffer the interleaved audio, followed by the first channel on return
+ * @param length the size of the interleaved audio
+ * @param width the size of a sample of a channel (1 for G.711, 2 for L16)
+ * @param right the buffer to write the second channel to
+ * @return the size of a channel
+ */
+static apr_size_t vosk_recog_stereo_split(char *buffer, apr_size_t length, apr_size_t width, char *right)
+{
+	apr_size_t count = length / (width * 2);
+	apr_size_t i = 0;
+	if(width == BYTES_PER_SAMPLE) {
+		apr_int16_t *samples = (apr_int16_t*)buffer;
+		apr_int16_t *right_samples = (apr_int16_t*)right;
+#if defined(VOSK_RECOG_SSE2)
+		/* 8 frames at once: the channels are the low and high halves of 32-bit lanes */
+		for(; i + 8 <= count; i += 8) {
+			__m128i a = _mm_loadu_si128((const __m128i*)(samples + i * 2));
+			__m128i b = _mm_loadu_si128((const __m128i*)(samples + i * 2 + 8));
+			__m128i left_a = _mm_srai_epi32(_mm_slli_epi32(a,16),16);
+			__m128i left_b = _mm_srai_epi32(_mm_slli_epi32(b,16),16);
+			__m128i right_a = _mm_srai_epi32(a,16);
+			__m128i right_b = _mm_srai_epi32(b,16);
+			/* the first channel is stored behind the samples read, hence in place */
+			_mm_storeu_si128((__m128i*)(samples + i),_mm_packs_epi32(left_a,left_b));
+			_mm_storeu_si128((__m128i*)(right_samples + i),_mm_packs_epi32(right_a,right_b));
 		}
-		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_NO_INPUT_TIMEOUT) == TRUE) {
-			mpf_activity_detector_noinput_timeout_set(recog_channel->detector,recog_header->no_input_timeout);
+#elif defined(VOSK_RECOG_NEON)
+		for(; i + 8 <= count; i += 8) {
+			int16x8x2_t frames = vld2q_s16(samples + i * 2);
+			vst1q_s16(samples + i,frames.val[0]);
+			vst1q_s16(right_samples + i,frames.val[1]);
 		}
-		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_SPEECH_COMPLETE_TIMEOUT) == TRUE) {
-			mpf_activity_detector_silence_timeout_set(recog_channel->detector,recog_header->speech_complete_timeout);
+#endif
+		for(; i < count; i++) {
+			apr_int16_t left = samples[i * 2];
+			right_samples[i] = samples[i * 2 + 1];
+			samples[i] = left;
 		}
 	}
-
-	if(!recog_channel->audio_out) {
-		const apt_dir_layout_t *dir_layout = channel->engine->dir_layout;
-		char *file_name = apr_psprintf(channel->pool,"utter-%dkHz-%s.pcm",
-							descriptor->sampling_rate/1000,
-							request->channel_id.session_id.buf);
-		char *file_path = apt_vardir_filepath_get(dir_layout,file_name,channel->pool);
-		if(file_path) {
-			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Open Utterance Output File [%s] for Writing",file_path);
-			recog_channel->audio_out = fopen(file_path,"wb");
-			if(!recog_channel->audio_out) {
-				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Utterance Output File [%s] for Writing",file_path);
-			}
+	else {
+		for(; i < count; i++) {
+			char left = buffer[i * 2];
+			right[i] = buffer[i * 2 + 1];
+			buffer[i] = left;
 		}
 	}
-	if(!recog_channel->recognizer) {
-		vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
-		recog_channel->recognizer = vosk_recognizer_new(kaldi_engine->model, 8000.0f);
-		vosk_recognizer_set_max_alternatives(recog_channel->recognizer, 5);
-		vosk_recognizer_set_nlsml(recog_channel->recognizer, 1);
-	}
-
-	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
-	/* send asynchronous response */
-	mrcp_engine_channel_message_send(channel,response);
-	recog_channel->recog_request = request;
-	return TRUE;
-}
-
-/** Process STOP request */
-static apt_bool_t vosk_recog_channel_stop(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
-{
-	/* process STOP request */
-	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
-	/* store STOP request, make sure there is no more activity and only then send the response */
-	recog_channel->stop_response = response;
-	return TRUE;
-}
-
-/** Process START-INPUT-TIMERS request */
-static apt_bool_t vosk_recog_channel_timers_start(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
-{
-	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
-	recog_channel->timers_started = TRUE;
-	return mrcp_engine_channel_message_send(channel,response);
+	return count * width;
 }
 
-static apt_bool_t check_grammar(apr_xml_doc *doc)
+static apt_bool_t vosk_recog_engine_rescore_create(vosk_recog_engine_t *kaldi_engine, const char *name)
 {
-	const apr_xml_elem *elem;
-	const apr_xml_elem *child;
-	const apr_xml_elem *root;
-	const apr_xml_attr *attr;
+	mrcp_engine_t *engine = kaldi_engine->engine;
+	apr_size_t node_count = apt_numa_node_count_get();
+	apr_size_t thread_count = VOSK_RECOG_DEFAULT_RESCORE_THREADS;
+	apr_size_t i;
 
-	if(!doc) {
-		apt_log(APT_LOG_MARK,APT_PRIO_ERROR,"doc is null");
-		return FALSE;
+	kaldi_engine->rescore_model = vosk_recog_model_find(kaldi_engine->models,name);
+	if(!kaldi_engine->rescore_model) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Such rescore-model [%s], results are not rescored",name);
+		return TRUE;
+	}
+	mrcp_engine_param_float_get(engine,"rescore-confidence",&kaldi_engine->rescore_confidence);
+	if(kaldi_engine->rescore_confidence <= 0) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No rescore-confidence Set, results are not rescored");
+		kaldi_engine->rescore_model = NULL;
+		return TRUE;
+	}
+	mrcp_engine_param_duration_get(engine,"rescore-max-time",&kaldi_engine->rescore_max_time);
+	if(mrcp_engine_param_size_get(engine,"rescore-threads",&thread_count) == TRUE && !thread_count) {
+		thread_count = VOSK_RECOG_DEFAULT_RESCORE_THREADS;
 	}
 
-	root = doc->root;
-
-	/* Match document name */
-	if(!root || strcasecmp(root->name,"grammar") != 0) {
-		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unknown Document <%s>",root ? root->name : "null");
+	/* apart from the decoder workers, so that rescoring never holds back live audio */
+	kaldi_engine->rescore_pool = vosk_recog_worker_pool_create(thread_count,vosk_recog_rescore_job_process,engine->pool);
+	if(!kaldi_engine->rescore_pool) {
+		kaldi_engine->rescore_model = NULL;
 		return FALSE;
 	}
-
-	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Document <%s>",root ? root->name : "null");
-	return TRUE;
+	for(i=0; i<thread_count; i++) {
+		apt_task_t *task = vosk_recog_worker_pool_task_get(kaldi_engine->rescore_pool,i);
+		apt_task_name_set(task,apr_psprintf(engine->pool,"Vosk Rescore %"APR_SIZE_T_FMT,i+1));
+		mrcp_engine_task_config_apply(engine,task);
+		if(kaldi_engine->numa_mode != VOSK_RECOG_NUMA_NONE) {
+			apt_task_numa_node_set(task,(int)(i % node_count));
+		}
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Start Rescore Workers [%"APR_SIZE_T_FMT"] model [%s] below confidence [%.2f]",
+		thread_count,name,kaldi_engine->rescore_confidence);
+	return vosk_recog_worker_pool_start(kaldi_engine->rescore_pool);
 }
 
-/** Dispatch MRCP request */
-static apt_bool_t vosk_recog_channel_request_dispatch(mrcp_engine_channel_t *channel, mrcp_message_t *request)
+static apt_bool_t vosk_recog_engine_open(mrcp_engine_t *engine)
 {
-	apt_bool_t processed = FALSE;
-	mrcp_message_t *response = mrcp_response_create(request,request->pool);
-	switch(request->start_line.method_id) {
-		case RECOGNIZER_SET_PARAMS:
-			break;
-		case RECOGNIZER_GET_PARAMS:
-			break;
-		case RECOGNIZER_DEFINE_GRAMMAR: {
-				const char * pattern = "<grammar.*</grammar>";
-				regmatch_t pmatch[1];
-				char res[4096] = {'\0'};
-				const size_t nmatch = 1;
-				regex_t reg;
-				int cflags = REG_EXTENDED;
-				int status;
-
-				apr_pool_t *pool = request->pool;
-				apr_xml_parser *parser;
-				char errbuf[4096];
-				apr_status_t rv;
-
-				vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
-
-				// 只获取有效的音频
-				status = regcomp(&reg, pattern, cflags);
-				if(status != REG_NOERROR){
-					apt_log(APT_LOG_MARK, APT_PRIO_ERROR, "Error regcomp");
-					return FALSE;
-				}
-				status = regexec(&reg, request->body.buf, nmatch, pmatch, 0);
-				if(status == REG_NOERROR){
-					// grammar 超过字符长度限制
-					if ((pmatch[0].rm_eo-pmatch[0].rm_so)>=4096) {
-						apt_log(APT_LOG_MARK, APT_PRIO_ERROR, "Grammar length over size");
-						return FALSE;
-					}
-					for (size_t i = pmatch[0].rm_so, j = 0; i < pmatch[0].rm_eo; i++,j++){
-						res[j] = request->body.buf[i];
-					}
-					apt_log(APT_LOG_MARK, APT_PRIO_DEBUG, "Match: %s", res);
-				} else {
-					apt_log(APT_LOG_MARK, APT_PRIO_ERROR, "Error No Match: %s", request->body.buf);
-					return FALSE;
-				}
-				regfree(&reg);
+	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
+	apr_size_t worker_count = VOSK_RECOG_WORKER_DEFAULT_COUNT;
+	apr_size_t grammar_cache_size;
+	apr_size_t grammar_fst_max_files;
+	apr_size_t result_cache_size;
+	apr_size_t fetch_threads;
+	apr_size_t task_count;
+	apr_size_t size;
+	apr_size_t i;
+	apr_size_t node_count = apt_numa_node_count_get();
+	apt_bool_t warm_up = FALSE;
+	apt_bool_t g711_native = FALSE;
+	const char *value = mrcp_engine_param_get(engine,"decoder-threads");
+	if(value) {
+		worker_count = atol(value);
+		if(!worker_count) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid decoder-threads [%s], use default [%d]",
+				value,VOSK_RECOG_WORKER_DEFAULT_COUNT);
+			worker_count = VOSK_RECOG_WORKER_DEFAULT_COUNT;
+		}
+	}
+	value = mrcp_engine_param_get(engine,"numa");
+	if(value) {
+		if(strcasecmp(value,"replicate") == 0) {
+			kaldi_engine->numa_mode = VOSK_RECOG_NUMA_REPLICATE;
+		}
+		else if(strcasecmp(value,"interleave") == 0) {
+			kaldi_engine->numa_mode = VOSK_RECOG_NUMA_INTERLEAVE;
+		}
+		else if(strcasecmp(value,"none") != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown numa [%s], use [none]",value);
+		}
+		if(kaldi_engine->numa_mode != VOSK_RECOG_NUMA_NONE && node_count < 2) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Single NUMA Node, numa [%s] is ignored",value);
+			kaldi_engine->numa_mode = VOSK_RECOG_NUMA_NONE;
+		}
+	}
+	value = mrcp_engine_param_get(engine,"decoder-affinity");
+	if(value) {
+		if(strcasecmp(value,"media") == 0) {
+			kaldi_engine->media_affinity = TRUE;
+		}
+		else if(strcasecmp(value,"none") != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown decoder-affinity [%s], use [none]",value);
+		}
+	}
 
-				parser = apr_xml_parser_create(pool);
-				if (!parser) {
-					apt_log(APT_LOG_MARK, APT_PRIO_ERROR, "Error create xml paser");
-					return FALSE;
-				}
-				rv = apr_xml_parser_feed(parser, request->body.buf, strlen(request->body.buf));
-				if (rv != APR_SUCCESS) {
-					apr_xml_parser_geterror(parser, errbuf, sizeof(errbuf));
-					apt_log(APT_LOG_MARK, APT_PRIO_ERROR, "Error parsing grammar XML: %d %pm: %s",
-						rv, &rv, errbuf);
-					return FALSE;
-				}
-				rv = apr_xml_parser_done(parser, &(recog_channel->grammar));
-				if (rv != APR_SUCCESS) {
-					apr_xml_parser_geterror(parser, errbuf, sizeof(errbuf));
-					apt_log(APT_LOG_MARK, APT_PRIO_ERROR, "Error parsing grammar XML done: %d %pm: %s",
-						rv, &rv, errbuf);
-					return FALSE;
-				}
-				// grammar 不匹配
-				if (!check_grammar(recog_channel->grammar)){
-					return FALSE;
-				}
+	kaldi_engine->worker_pool = vosk_recog_worker_pool_create(worker_count,vosk_recog_job_process,engine->pool);
+	if(!kaldi_engine->worker_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Decoder Workers [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	/* the queued decoding jobs are the backlog of the engine, used by the admission control */
+	vosk_recog_worker_pool_backlog_bind(kaldi_engine->worker_pool,&engine->backlog);
+	/* the MPF scheduler marks channels with frames queued ready, waking each worker once per pass over them */
+	if(vosk_recog_worker_pool_ready_enable(
+			kaldi_engine->worker_pool,
+			VOSK_RECOG_JOB_DECODE,
+			engine->config->max_channel_count ? engine->config->max_channel_count : VOSK_RECOG_WORKER_DEFAULT_READY_SIZE,
+			engine->pool) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Decoder Ready Lists [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	/* the workers record the real-time factor of decoding, published by the server metrics */
+	engine->rtf_histogram = apt_histogram_create(engine->pool);
+	for(i=0; i<worker_count; i++) {
+		apt_task_t *task = vosk_recog_worker_pool_task_get(kaldi_engine->worker_pool,i);
+		mrcp_engine_task_config_apply(engine,task);
+		if(kaldi_engine->numa_mode != VOSK_RECOG_NUMA_NONE) {
+			/* spread the workers over the nodes, each runs on the CPUs and memory of its node */
+			apt_task_numa_node_set(task,(int)(i % node_count));
+		}
+		if(kaldi_engine->media_affinity == TRUE) {
+			/* the workers of a node take the CPUs of its set in turn */
+			int cpu = apt_task_affinity_cpu_get(task,kaldi_engine->numa_mode != VOSK_RECOG_NUMA_NONE ? i / node_count : i);
+			if(cpu < 0 || vosk_recog_worker_pool_cpu_set(kaldi_engine->worker_pool,i,cpu) == FALSE) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"No CPU Set, decoder-affinity [media] is ignored for Worker [%"APR_SIZE_T_FMT"]",i);
 			}
-			break;
-		case RECOGNIZER_RECOGNIZE:
-			processed = vosk_recog_channel_recognize(channel,request,response);
-			break;
-		case RECOGNIZER_GET_RESULT:
-			break;
-		case RECOGNIZER_START_INPUT_TIMERS:
-			processed = vosk_recog_channel_timers_start(channel,request,response);
-			break;
-		case RECOGNIZER_STOP:
-			processed = vosk_recog_channel_stop(channel,request,response);
-			break;
-		default:
-			break;
+		}
 	}
-	if(processed == FALSE) {
-		/* send asynchronous response for not handled request */
-		mrcp_engine_channel_message_send(channel,response);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Start Decoder Workers [%"APR_SIZE_T_FMT"]",worker_count);
+	vosk_recog_worker_pool_start(kaldi_engine->worker_pool);
+
+	kaldi_engine->dump_writer = vosk_recog_dump_writer_create(engine->pool);
+	if(!kaldi_engine->dump_writer) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Dump Writer [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
 	}
-	return TRUE;
-}
+	vosk_recog_dump_writer_start(kaldi_engine->dump_writer);
+	mrcp_engine_param_bool_get(engine,"utterance-dump",&kaldi_engine->dump_enabled);
+	value = mrcp_engine_param_get(engine,"utterance-dump-format");
+	if(value && strcasecmp(value,"wav") == 0) {
+		kaldi_engine->dump_wav = TRUE;
+	}
+	mrcp_engine_param_bool_get(engine,"constrained-decoding",&kaldi_engine->constrained_decoding);
+	mrcp_engine_param_size_get(engine,"closed-grammar-max-phrases",&kaldi_engine->closed_grammar_max_phrases);
+	mrcp_engine_param_size_get(engine,"last-result-max-size",&kaldi_engine->last_result_max_size);
+	if(mrcp_engine_param_size_get(engine,"n-best",&size) == TRUE && size > 0) {
+		kaldi_engine->result_options.n_best = size;
+	}
+	mrcp_engine_param_bool_get(engine,"word-timings",&kaldi_engine->result_options.word_timings);
+	mrcp_engine_param_bool_get(engine,"confidence-only",&kaldi_engine->result_options.confidence_only);
+	mrcp_engine_param_float_get(engine,"confidence-threshold",&kaldi_engine->result_options.confidence_threshold);
+
+	kaldi_engine->models = vosk_recog_model_registry_create(engine,engine->pool);
+	if(!kaldi_engine->models) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Model Registry [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	vosk_recog_model_registry_numa_set(kaldi_engine->models,kaldi_engine->numa_mode,node_count);
+	/* offer only the rates the models are trained for, so that the decoder is fed at the native rate */
+	kaldi_engine->sample_rates = vosk_recog_model_sample_rates_get(kaldi_engine->models);
+	kaldi_engine->recog_pool = vosk_recog_pool_create(engine->pool);
+	if(!kaldi_engine->recog_pool) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Recognizer Pool [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	mrcp_engine_param_size_get(engine,"recognizer-pool-size",&kaldi_engine->recog_pool_size);
+	if(mrcp_engine_param_size_get(engine,"model-load-threads",&size) == TRUE && size > 0) {
+		kaldi_engine->model_load_threads = size;
+	}
+	mrcp_engine_param_size_get(engine,"model-watch-interval",&kaldi_engine->model_watch_interval);
+	if(mrcp_engine_param_bool_get(engine,"model-warm-up",&warm_up) == TRUE && warm_up == TRUE) {
+		/* the paths are composed here, the loader threads must not allocate from the engine pool */
+		kaldi_engine->warm_up_audio_8k = apt_datadir_filepath_get(engine->dir_layout,VOSK_RECOG_WARM_UP_AUDIO_8K,engine->pool);
+		kaldi_engine->warm_up_audio_16k = apt_datadir_filepath_get(engine->dir_layout,VOSK_RECOG_WARM_UP_AUDIO_16K,engine->pool);
+	}
+	grammar_cache_size = VOSK_RECOG_GRAMMAR_CACHE_DEFAULT_SIZE;
+	if(mrcp_engine_param_size_get(engine,"grammar-cache-size",&size) == TRUE && size > 0) {
+		grammar_cache_size = size;
+	}
+	value = mrcp_engine_param_get(engine,"grammar-fst-dir");
+	if(!value) {
+		value = VOSK_RECOG_DEFAULT_GRAMMAR_FST_DIR;
+	}
+	grammar_fst_max_files = VOSK_RECOG_DEFAULT_GRAMMAR_FST_MAX_FILES;
+	mrcp_engine_param_size_get(engine,"grammar-fst-max-files",&grammar_fst_max_files);
+	kaldi_engine->grammar_cache = vosk_recog_grammar_cache_create(
+									grammar_cache_size,
+									*value != '\0' ? apt_vardir_filepath_get(engine->dir_layout,value,engine->pool) : NULL,
+									grammar_fst_max_files,
+									engine->pool);
+	if(!kaldi_engine->grammar_cache) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Grammar Cache [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	value = mrcp_engine_param_get(engine,"itn-grammar");
+	if(value && *value != '\0') {
+		/* compiled (or mapped) once, the FST is shared read-only by the decoder workers */
+		kaldi_engine->itn = vosk_recog_itn_load(
+								kaldi_engine->grammar_cache,
+								apt_datadir_filepath_get(engine->dir_layout,value,engine->pool),
+								engine->pool);
+		if(!kaldi_engine->itn) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No ITN Grammar, final results are left in spoken form [%s]",engine->id);
+		}
+	}
+	vosk_recog_engine_grammars_precompile(kaldi_engine,engine);
+	result_cache_size = VOSK_RECOG_NLSML_CACHE_DEFAULT_SIZE;
+	mrcp_engine_param_size_get(engine,"result-cache-size",&result_cache_size);
+	if(result_cache_size) {
+		kaldi_engine->result_cache = vosk_recog_nlsml_cache_create(result_cache_size,engine->pool);
+		if(!kaldi_engine->result_cache) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Result Cache [%s]",engine->id);
+			return mrcp_engine_open_respond(engine,FALSE);
+		}
+	}
+	if(mrcp_engine_param_size_get(engine,"adaptation-cache-size",&size) == TRUE && size > 0) {
+		apr_size_t ttl = VOSK_RECOG_DEFAULT_ADAPT_TTL;
+		mrcp_engine_param_duration_get(engine,"adaptation-ttl",&ttl);
+		if(mrcp_engine_param_duration_get(engine,"adaptation-time",&kaldi_engine->adapt_time) == TRUE &&
+			kaldi_engine->adapt_time < VOSK_RECOG_ADAPT_MIN_TIME) {
+			kaldi_engine->adapt_time = VOSK_RECOG_ADAPT_MIN_TIME;
+		}
+		kaldi_engine->adapt_store = vosk_recog_adapt_store_create(
+										size,
+										apr_time_from_msec(ttl),
+										mrcp_engine_param_get(engine,"adaptation-dir"),
+										engine->pool);
+		if(!kaldi_engine->adapt_store) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Adaptation Store [%s]",engine->id);
+			return mrcp_engine_open_respond(engine,FALSE);
+		}
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Keep Speech of Callers [%"APR_SIZE_T_FMT"] for [%"APR_SIZE_T_FMT" ms]",
+			size,ttl);
+	}
+	fetch_threads = VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_THREADS;
+	mrcp_engine_param_size_get(engine,"grammar-fetch-threads",&fetch_threads);
+	if(fetch_threads) {
+		apr_size_t fetch_timeout = VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_TIMEOUT;
+		apr_size_t max_age = VOSK_RECOG_DEFAULT_GRAMMAR_MAX_AGE;
+		apr_size_t fetch_cache_size = VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_CACHE_SIZE;
+		const char *fetch_dir = VOSK_RECOG_DEFAULT_GRAMMAR_FETCH_DIR;
+		if(mrcp_engine_param_duration_get(engine,"grammar-fetch-timeout",&size) == TRUE && size > 0) {
+			fetch_timeout = size;
+		}
+		mrcp_engine_param_size_get(engine,"grammar-max-age",&max_age);
+		mrcp_engine_param_size_get(engine,"grammar-fetch-cache-size",&fetch_cache_size);
+		value = mrcp_engine_param_get(engine,"grammar-fetch-dir");
+		if(value) {
+			/* an empty dir keeps fetched grammars in memory only */
+			fetch_dir = *value != '\0' ? value : NULL;
+		}
+		kaldi_engine->grammar_fetcher = mrcp_grammar_fetcher_create(
+							fetch_threads,
+							fetch_dir ? apt_vardir_filepath_get(engine->dir_layout,fetch_dir,engine->pool) : NULL,
+							fetch_cache_size,
+							apr_time_from_sec(max_age),
+							apr_time_from_msec(fetch_timeout),
+							engine->pool);
+		if(!kaldi_engine->grammar_fetcher) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Grammar Fetcher [%s]",engine->id);
+			return mrcp_engine_open_respond(engine,FALSE);
+		}
+	}
+	mrcp_engine_param_duration_get(engine,"partial-result-interval",&kaldi_engine->partial_interval);
+	mrcp_engine_param_duration_get(engine,"intermediate-result-interval",&kaldi_engine->interim_interval);
+	mrcp_engine_param_duration_get(engine,"recognition-timeout",&kaldi_engine->recognition_timeout);
+	mrcp_engine_param_duration_get(engine,"continuous-segment-time",&kaldi_engine->segment_time);
+	mrcp_engine_param_duration_get(engine,"checkpoint-timeout",&kaldi_engine->checkpoint_timeout);
+	mrcp_engine_param_duration_get(engine,"language-id-time",&kaldi_engine->lid_time);
+	value = mrcp_engine_param_get(engine,"decode-chunk-time");
+	if(value) {
+		apr_size_t chunk_time = atol(value);
+		if(chunk_time < CODEC_FRAME_TIME_BASE || chunk_time > VOSK_RECOG_MAX_CHUNK_TIME) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid decode-chunk-time [%s], use default [%d]",
+				value,VOSK_RECOG_DEFAULT_CHUNK_TIME);
+			chunk_time = VOSK_RECOG_DEFAULT_CHUNK_TIME;
+		}
+		kaldi_engine->chunk_time = chunk_time;
+	}
+	value = mrcp_engine_param_get(engine,"decoder-backend");
+	if(value) {
+		if(strcasecmp(value,"gpu-batch") == 0) {
+			/* pending audio is pushed once per chunk time, streams fit a few chunks at the max rate */
+			kaldi_engine->batch = vosk_recog_batch_create(
+									kaldi_engine->chunk_time,
+									VOSK_RECOG_BATCH_BUFFER_CHUNKS * kaldi_engine->chunk_time * 16000 / 1000 * BYTES_PER_SAMPLE,
+									vosk_recog_batch_on_result,
+									engine->pool);
+			if(!kaldi_engine->batch) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Batch Collector [%s]",engine->id);
+				return mrcp_engine_open_respond(engine,FALSE);
+			}
+			vosk_recog_model_registry_batch_enable(kaldi_engine->models);
+		}
+		else if(strcasecmp(value,"cpu-batch") == 0) {
+			apr_size_t batch_size = VOSK_RECOG_DEFAULT_CPU_BATCH_SIZE;
+			const char *size = mrcp_engine_param_get(engine,"cpu-batch-size");
+			if(size && atol(size) > 0) {
+				batch_size = atol(size);
+			}
+			/* no channel is open yet, hence no job is signaled to the workers */
+			kaldi_engine->cpu_batch = vosk_recog_worker_pool_gather_enable(
+										kaldi_engine->worker_pool,
+										batch_size,
+										vosk_recog_gather_process,
+										engine->pool);
+		}
+		else if(strcasecmp(value,"remote") == 0) {
+			if(vosk_recog_engine_remote_create(kaldi_engine) == FALSE) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Remote Client [%s]",engine->id);
+				return mrcp_engine_open_respond(engine,FALSE);
+			}
+		}
+		else if(strcasecmp(value,"cpu") != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown decoder-backend [%s], use [cpu]",value);
+		}
+	}
+	mrcp_engine_param_bool_get(engine,"work-stealing",&kaldi_engine->work_stealing);
+	if(kaldi_engine->work_stealing == TRUE) {
+		if(kaldi_engine->cpu_batch == TRUE || kaldi_engine->media_affinity == TRUE) {
+			/* the channels are gathered or decoded by the worker on the CPU of their media */
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Work Stealing Is Ignored for decoder-backend [cpu-batch] or decoder-affinity [media]");
+			kaldi_engine->work_stealing = FALSE;
+		}
+		else if(vosk_recog_worker_pool_steal_enable(kaldi_engine->worker_pool,engine->pool) == FALSE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"No Work Stealing by Decoder Workers [%"APR_SIZE_T_FMT"]",
+				vosk_recog_worker_pool_count_get(kaldi_engine->worker_pool));
+			kaldi_engine->work_stealing = FALSE;
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Enable Work Stealing by Decoder Workers");
+		}
+	}
+	value = mrcp_engine_param_get(engine,"speaker-model");
+	if(value) {
+		if(kaldi_engine->batch) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Speakers Are Not Scored by decoder-backend [gpu-batch]");
+		}
+		else {
+			const char *path = mrcp_engine_param_get(engine,"voiceprint-index");
+			const char *root_path;
+			if(!path) {
+				path = VOSK_RECOG_DEFAULT_VOICEPRINT_INDEX;
+			}
+			if(apr_filepath_root(&root_path,&path,0,engine->pool) == APR_ERELATIVE) {
+				path = apt_dir_layout_path_compose(engine->dir_layout,APT_LAYOUT_VAR_DIR,path,engine->pool);
+			}
+			kaldi_engine->voiceprints = mrcp_voiceprint_store_open(path,engine->pool);
+			if(kaldi_engine->voiceprints) {
+				/* the speaker model is loaded along with the models */
+				kaldi_engine->spk_model_path = value;
+			}
+		}
+	}
+	value = mrcp_engine_param_get(engine,"speaker-threshold");
+	if(value) {
+		kaldi_engine->speaker_threshold = (float)atof(value);
+	}
+	value = mrcp_engine_param_get(engine,"vad-gate");
+	if(value) {
+		kaldi_engine->vad_gate = (strcasecmp(value,"true") == 0) ? TRUE : FALSE;
+	}
+	value = mrcp_engine_param_get(engine,"vad-mode");
+	if(value) {
+		if(strcasecmp(value,"adaptive") == 0) {
+			kaldi_engine->vad_mode = MPF_DETECTOR_MODE_ADAPTIVE;
+		}
+		else if(strcasecmp(value,"fixed") != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown vad-mode [%s], use [fixed]",value);
+		}
+	}
+	value = mrcp_engine_param_get(engine,"vad-pre-roll");
+	if(value) {
+		apr_size_t pre_roll_time = atol(value);
+		if(pre_roll_time < CODEC_FRAME_TIME_BASE || pre_roll_time > VOSK_RECOG_MAX_PRE_ROLL_TIME) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid vad-pre-roll [%s], use default [%d]",
+				value,VOSK_RECOG_DEFAULT_PRE_ROLL_TIME);
+			pre_roll_time = VOSK_RECOG_DEFAULT_PRE_ROLL_TIME;
+		}
+		kaldi_engine->pre_roll_time = pre_roll_time;
+	}
+	value = mrcp_engine_param_get(engine,"input-pre-roll");
+	if(value) {
+		apr_size_t pre_roll_time = atol(value);
+		if(pre_roll_time > VOSK_RECOG_MAX_PRE_ROLL_TIME) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid input-pre-roll [%s], use [%d]",
+				value,VOSK_RECOG_MAX_PRE_ROLL_TIME);
+			pre_roll_time = VOSK_RECOG_MAX_PRE_ROLL_TIME;
+		}
+		kaldi_engine->input_pre_roll_time = pre_roll_time;
+	}
+	value = mrcp_engine_param_get(engine,"endpointer");
+	if(value) {
+		if(strcasecmp(value,"combined") == 0) {
+			kaldi_engine->endpointer = VOSK_RECOG_ENDPOINTER_COMBINED;
+		}
+		else if(strcasecmp(value,"vad") != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown endpointer [%s], use [vad]",value);
+		}
+	}
+	value = mrcp_engine_param_get(engine,"endpoint-stable-time");
+	if(value) {
+		kaldi_engine->endpoint_stable_time = atol(value);
+	}
+	value = mrcp_engine_param_get(engine,"decoder-endpointer-mode");
+	if(value) {
+		if(strcasecmp(value,"default") == 0) {
+			kaldi_engine->decoder_endpointer_mode = VOSK_EP_ANSWER_DEFAULT;
+		}
+		else if(strcasecmp(value,"short") == 0) {
+			kaldi_engine->decoder_endpointer_mode = VOSK_EP_ANSWER_SHORT;
+		}
+		else if(strcasecmp(value,"long") == 0) {
+			kaldi_engine->decoder_endpointer_mode = VOSK_EP_ANSWER_LONG;
+		}
+		else if(strcasecmp(value,"very-long") == 0) {
+			kaldi_engine->decoder_endpointer_mode = VOSK_EP_ANSWER_VERY_LONG;
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown decoder-endpointer-mode [%s]",value);
+		}
+	}
+	value = mrcp_engine_param_get(engine,"degrade-rtf");
+	if(value) {
+		kaldi_engine->degrade_rtf = (apr_uint32_t)(atof(value) * 1000);
+	}
+	value = mrcp_engine_param_get(engine,"degrade-backlog");
+	if(value && atol(value) > 0) {
+		kaldi_engine->degrade_backlog = atol(value);
+	}
+	value = mrcp_engine_param_get(engine,"frame-queue-time");
+	if(value && atol(value) >= CODEC_FRAME_TIME_BASE) {
+		kaldi_engine->frame_queue_time = atol(value);
+	}
+	mrcp_engine_param_duration_get(engine,"hold-timeout",&kaldi_engine->hold_timeout);
+	value = mrcp_engine_param_get(engine,"frame-queue-policy");
+	if(value) {
+		if(strcasecmp(value,"drop-oldest") == 0) {
+			kaldi_engine->frame_queue_policy = MPF_AUDIO_QUEUE_DROP_OLDEST;
+		}
+		else if(strcasecmp(value,"signal-backlog") == 0) {
+			kaldi_engine->frame_queue_policy = MPF_AUDIO_QUEUE_SIGNAL_BACKLOG;
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown frame-queue-policy [%s]",value);
+		}
+	}
+	value = mrcp_engine_param_get(engine,"batch-audio-dir");
+	if(value && *value != '\0') {
+		kaldi_engine->audio_dir = value;
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Allow Batch Audio Files in [%s]",value);
+	}
+	value = mrcp_engine_param_get(engine,"rescore-model");
+	if(value) {
+		if(kaldi_engine->batch || (kaldi_engine->remote && kaldi_engine->remote_local_models == FALSE)) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Results Are Not Rescored by decoder-backend [%s]",
+				kaldi_engine->batch ? "gpu-batch" : "remote");
+		}
+		else if(vosk_recog_engine_rescore_create(kaldi_engine,value) == FALSE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Rescore Workers [%s]",engine->id);
+			return mrcp_engine_open_respond(engine,FALSE);
+		}
+	}
+	if(mrcp_engine_param_bool_get(engine,"g711-native",&g711_native) == TRUE && g711_native == TRUE) {
+		if(kaldi_engine->batch || kaldi_engine->remote) {
+			/* the collectors and remote decoders are only fed L16 */
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Frames Are Not Taken in G.711 by decoder-backend [%s]",
+				kaldi_engine->batch ? "gpu-batch" : "remote");
+		}
+		else if((kaldi_engine->sample_rates & MPF_SAMPLE_RATE_8000) != MPF_SAMPLE_RATE_8000) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Frames Are Not Taken in G.711, no 8 kHz model [%s]",engine->id);
+		}
+		else if(vosk_recog_engine_g711_create(kaldi_engine,engine->pool) == FALSE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create G.711 Tables [%s]",engine->id);
+			return mrcp_engine_open_respond(engine,FALSE);
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Take Frames in G.711 [%s]",engine->id);
+		}
+	}
+
+	if(engine->config->max_channel_count) {
+		/* the buffers of the channels depend on the params above */
+		if(vosk_recog_channel_slab_create(kaldi_engine,engine->config->max_channel_count,engine->pool) == FALSE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Channel Slab [%s]",engine->id);
+			return mrcp_engine_open_respond(engine,FALSE);
+		}
+	}
+
+	task_count = VOSK_RECOG_DEFAULT_TASK_COUNT;
+	value = mrcp_engine_param_get(engine,"engine-tasks");
+	if(value) {
+		task_count = atol(value);
+		if(!task_count) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid engine-tasks [%s], use default [%d]",
+				value,VOSK_RECOG_DEFAULT_TASK_COUNT);
+			task_count = VOSK_RECOG_DEFAULT_TASK_COUNT;
+		}
+	}
+	if(vosk_recog_engine_tasks_create(kaldi_engine,task_count,engine->pool) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Engine Tasks [%s]",engine->id);
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Start Engine Tasks [%"APR_SIZE_T_FMT"]",task_count);
+	for(i=0; i<kaldi_engine->task_count; i++) {
+		apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->tasks[i]);
+		mrcp_engine_task_config_apply(engine,task);
+		apt_task_start(task);
+	}
+	/* load models in the context of the engine task, the response is sent once they are resident */
+	if(vosk_recog_engine_msg_signal(vosk_recog_MSG_OPEN_ENGINE,engine,NULL,NULL) == FALSE) {
+		return mrcp_engine_open_respond(engine,FALSE);
+	}
+	return TRUE;
+}
+
+/** Close recognizer engine */
+static apt_bool_t vosk_recog_engine_close(mrcp_engine_t *engine)
+{
+	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
+	apr_size_t i;
+	if(kaldi_engine->models) {
+		/* no version is loaded from now on, a reload in progress is waited for */
+		vosk_recog_model_registry_watch_stop(kaldi_engine->models);
+	}
+	for(i=0; i<kaldi_engine->task_count; i++) {
+		apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->tasks[i]);
+		apt_task_terminate(task,TRUE);
+	}
+	if(kaldi_engine->worker_pool) {
+		vosk_recog_worker_pool_terminate(kaldi_engine->worker_pool);
+	}
+	if(kaldi_engine->rescore_pool) {
+		/* no rescoring is signaled once the decoder workers are done */
+		vosk_recog_worker_pool_terminate(kaldi_engine->rescore_pool);
+	}
+	if(kaldi_engine->dump_writer) {
+		/* the decoder workers are done, so are the dumps */
+		vosk_recog_dump_writer_terminate(kaldi_engine->dump_writer);
+	}
+	if(kaldi_engine->batch) {
+		/* the batch recognizers are freed before the batch models are */
+		vosk_recog_batch_terminate(kaldi_engine->batch);
+	}
+	if(kaldi_engine->remote) {
+		vosk_recog_remote_terminate(kaldi_engine->remote);
+	}
+	return mrcp_engine_close_respond(engine);
+}
+
+/** Allocate channel along with its detector, frame queue and audio buffers */
+/** Release frame dropped from the queue by drop-oldest (decoder worker context) */
+static void vosk_recog_frame_drop(void *obj, void *elem)
+{
+	vosk_recog_frame_t *item = elem;
+	if(item->ref) {
+		mpf_frame_ref_release(item->ref);
+	}
+}
+
+static vosk_recog_channel_t* vosk_recog_channel_alloc(vosk_recog_engine_t *kaldi_engine, apr_pool_t *pool)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)apr_palloc(pool,sizeof(vosk_recog_channel_t));
+	recog_channel->kaldi_engine = kaldi_engine;
+	recog_channel->channel = NULL;
+	recog_channel->slab_owned = FALSE;
+	recog_channel->detector = mpf_activity_detector_create(pool);
+	recog_channel->frame_queue = mpf_audio_queue_create(
+									kaldi_engine->frame_queue_time,
+									sizeof(vosk_recog_frame_t),
+									kaldi_engine->frame_queue_policy,
+									pool);
+	if(recog_channel->frame_queue) {
+		mpf_audio_queue_drop_handler_set(recog_channel->frame_queue,vosk_recog_frame_drop,recog_channel);
+	}
+	recog_channel->job_guard = NULL;
+	if(kaldi_engine->work_stealing == TRUE) {
+		apr_thread_mutex_create(&recog_channel->job_guard,APR_THREAD_MUTEX_DEFAULT,pool);
+	}
+	recog_channel->chunk_capacity = kaldi_engine->chunk_time * 16000 / 1000 * BYTES_PER_SAMPLE;
+	recog_channel->chunk_buffer = apr_palloc(pool,recog_channel->chunk_capacity);
+	recog_channel->split_buffer = apr_palloc(pool,recog_channel->chunk_capacity / VOSK_RECOG_MAX_CHANNEL_COUNT);
+	recog_channel->chunk_samples = NULL;
+	if(kaldi_engine->g711_tables) {
+		/* a chunk of 8 kHz codes, doubled on degradation, and the frame which overruns it */
+		recog_channel->chunk_samples = apr_palloc(pool,sizeof(float) * (recog_channel->chunk_capacity / BYTES_PER_SAMPLE + VOSK_RECOG_MAX_FRAME_SIZE));
+	}
+	recog_channel->gate_buffer = NULL;
+	recog_channel->gate_capacity = 0;
+	if(kaldi_engine->vad_gate == TRUE) {
+		recog_channel->gate_capacity = kaldi_engine->pre_roll_time * 16000 / 1000 * BYTES_PER_SAMPLE;
+		recog_channel->gate_buffer = apr_palloc(pool,recog_channel->gate_capacity);
+	}
+	recog_channel->rescore_buffer = NULL;
+	recog_channel->rescore_capacity = 0;
+	if(kaldi_engine->rescore_pool) {
+		recog_channel->rescore_capacity = kaldi_engine->rescore_max_time * 16000 / 1000 * BYTES_PER_SAMPLE;
+		recog_channel->rescore_buffer = apr_palloc(pool,recog_channel->rescore_capacity);
+	}
+	recog_channel->adapt_buffer = NULL;
+	recog_channel->adapt_capacity = 0;
+	if(kaldi_engine->adapt_store) {
+		recog_channel->adapt_capacity = kaldi_engine->adapt_time * 16000 / 1000 * BYTES_PER_SAMPLE;
+		recog_channel->adapt_buffer = apr_palloc(pool,recog_channel->adapt_capacity);
+	}
+	recog_channel->lid_models = NULL;
+	recog_channel->lid_buffer = NULL;
+	recog_channel->lid_capacity = 0;
+	recog_channel->lid_length = 0;
+	recog_channel->lid_threshold = 0;
+	if(kaldi_engine->lid_time) {
+		recog_channel->lid_capacity = kaldi_engine->lid_time * 16000 / 1000 * BYTES_PER_SAMPLE + recog_channel->chunk_capacity;
+		recog_channel->lid_buffer = apr_palloc(pool,recog_channel->lid_capacity);
+	}
+	recog_channel->rescore_samples = NULL;
+	if(kaldi_engine->rescore_pool && kaldi_engine->g711_tables) {
+		recog_channel->rescore_samples = apr_palloc(pool,sizeof(float) * (recog_channel->chunk_capacity / BYTES_PER_SAMPLE));
+	}
+	/* one frame per frame time, whatever the sampling rate of the session */
+	recog_channel->preroll_capacity = kaldi_engine->input_pre_roll_time / CODEC_FRAME_TIME_BASE;
+	recog_channel->preroll = NULL;
+	if(recog_channel->preroll_capacity) {
+		recog_channel->preroll = apr_palloc(pool,sizeof(vosk_recog_preroll_frame_t) * recog_channel->preroll_capacity);
+	}
+	return recog_channel;
+}
+
+/** Create slab of channels, recycled on destroy */
+static apt_bool_t vosk_recog_channel_slab_create(vosk_recog_engine_t *kaldi_engine, apr_size_t count, apr_pool_t *pool)
+{
+	apr_size_t i;
+	if(apr_thread_mutex_create(&kaldi_engine->slab_guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	kaldi_engine->slab = apr_palloc(pool,sizeof(vosk_recog_channel_t*) * count);
+	for(i=0; i<count; i++) {
+		vosk_recog_channel_t *recog_channel = vosk_recog_channel_alloc(kaldi_engine,pool);
+		if(!recog_channel->frame_queue) {
+			return FALSE;
+		}
+		recog_channel->slab_owned = TRUE;
+		kaldi_engine->slab[i] = recog_channel;
+	}
+	kaldi_engine->slab_count = count;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Create Channel Slab [%"APR_SIZE_T_FMT"] [%"APR_SIZE_T_FMT" bytes per channel]",
+		count,
+		sizeof(vosk_recog_channel_t) + kaldi_engine->frame_queue_time / CODEC_FRAME_TIME_BASE * sizeof(vosk_recog_frame_t) +
+		kaldi_engine->slab[0]->chunk_capacity * 3 / 2 + kaldi_engine->slab[0]->gate_capacity + kaldi_engine->slab[0]->rescore_capacity +
+		kaldi_engine->slab[0]->preroll_capacity * sizeof(vosk_recog_preroll_frame_t));
+	return TRUE;
+}
+
+/** Take idle channel from the slab, NULL if there is none */
+static vosk_recog_channel_t* vosk_recog_channel_slab_take(vosk_recog_engine_t *kaldi_engine)
+{
+	vosk_recog_channel_t *recog_channel = NULL;
+	if(!kaldi_engine->slab) {
+		return NULL;
+	}
+	apr_thread_mutex_lock(kaldi_engine->slab_guard);
+	if(kaldi_engine->slab_count) {
+		recog_channel = kaldi_engine->slab[--kaldi_engine->slab_count];
+	}
+	apr_thread_mutex_unlock(kaldi_engine->slab_guard);
+	return recog_channel;
+}
+
+/** Return channel to the slab */
+static void vosk_recog_channel_slab_put(vosk_recog_engine_t *kaldi_engine, vosk_recog_channel_t *recog_channel)
+{
+	vosk_recog_frame_t *item;
+	/* frames written after the close job has drained the queue are dropped */
+	while((item = mpf_audio_queue_read_begin(recog_channel->frame_queue)) != NULL) {
+		if(item->ref) {
+			mpf_frame_ref_release(item->ref);
+		}
+		mpf_audio_queue_read_commit(recog_channel->frame_queue);
+	}
+	/* the metrics are counted per channel */
+	mpf_audio_queue_stats_reset(recog_channel->frame_queue);
+	recog_channel->channel = NULL;
+	apr_thread_mutex_lock(kaldi_engine->slab_guard);
+	kaldi_engine->slab[kaldi_engine->slab_count++] = recog_channel;
+	apr_thread_mutex_unlock(kaldi_engine->slab_guard);
+}
+
+static mrcp_engine_channel_t* vosk_recog_engine_channel_create(mrcp_engine_t *engine, apr_pool_t *pool)
+{
+	mpf_stream_capabilities_t *capabilities;
+	mpf_termination_t *termination; 
+	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
+
+	/* take kaldi recog channel from the slab, or create one in the session pool */
+	vosk_recog_channel_t *recog_channel = vosk_recog_channel_slab_take(kaldi_engine);
+	if(recog_channel) {
+		/* a new leg, drop the settings and noise floor of the previous one */
+		mpf_activity_detector_init(recog_channel->detector);
+	}
+	else {
+		recog_channel = vosk_recog_channel_alloc(kaldi_engine,pool);
+	}
+	recog_channel->recognizer = NULL;
+	recog_channel->recognizer_charge = 0;
+	recog_channel->peer_recognizer = NULL;
+	recog_channel->peer_result = NULL;
+	recog_channel->peer_segment_start = 0;
+	recog_channel->batch_stream = NULL;
+	recog_channel->remote_stream = NULL;
+	recog_channel->batch_result = NULL;
+	recog_channel->model = NULL;
+	recog_channel->model_seat = NULL;
+	recog_channel->sample_rate = 0;
+	recog_channel->g711_table = NULL;
+	recog_channel->sample_size = BYTES_PER_SAMPLE;
+	recog_channel->channel_count = 1;
+	recog_channel->recog_request = NULL;
+	recog_channel->recog_start = 0;
+	recog_channel->stop_response = NULL;
+	recog_channel->grammar = NULL;
+	recog_channel->grammar_charge = 0;
+	recog_channel->active_grammar = NULL;
+	recog_channel->last_result = NULL;
+	recog_channel->fetch = NULL;
+	recog_channel->fetch_request = NULL;
+	recog_channel->fetch_response = NULL;
+	recog_channel->fetched_grammar = NULL;
+	recog_channel->fetch_cause = RECOGNIZER_COMPLETION_CAUSE_SUCCESS;
+	recog_channel->fetch_done = FALSE;
+	recog_channel->close_pending = FALSE;
+	recog_channel->phrases = NULL;
+	recog_channel->hotword = FALSE;
+	recog_channel->continuous = FALSE;
+	recog_channel->activity_detected = FALSE;
+	recog_channel->segment_count = 0;
+	recog_channel->segment_start = 0;
+	recog_channel->segment_elapsed = 0;
+	recog_channel->input_elapsed = 0;
+	recog_channel->input_offset = 0;
+	recog_channel->checkpoint_response = NULL;
+	recog_channel->checkpoint_state = VOSK_RECOG_CHECKPOINT_NONE;
+	recog_channel->checkpoint_elapsed = 0;
+	recog_channel->taken_result = NULL;
+	mpf_activity_detector_mode_set(recog_channel->detector,kaldi_engine->vad_mode);
+	recog_channel->dump = NULL;
+	/* the worker is assigned on open, once the node the media is processed on is known */
+	recog_channel->worker = NULL;
+	recog_channel->scheduled = 0;
+	recog_channel->job_closed = FALSE;
+	recog_channel->close_respond = FALSE;
+	recog_channel->job_worker = NULL;
+	recog_channel->pending_event = MPF_DETECTOR_EVENT_NONE;
+	recog_channel->decode_request = NULL;
+	vosk_recog_partial_reset(&recog_channel->early_partial);
+	vosk_recog_partial_reset(&recog_channel->interim_partial);
+	vosk_recog_partial_reset(&recog_channel->stable_partial);
+	recog_channel->endpoint_combined = FALSE;
+	recog_channel->endpoint_silence = 0;
+	recog_channel->interim_interval = 0;
+	recog_channel->recognition_timeout = 0;
+	recog_channel->recognition_elapsed = 0;
+	recog_channel->recognition_expired = FALSE;
+	recog_channel->result_options = kaldi_engine->result_options;
+	recog_channel->rescore = FALSE;
+	recog_channel->rescore_length = 0;
+	recog_channel->rescore_dropped = FALSE;
+	recog_channel->rescore_request = NULL;
+	recog_channel->rescore_first = NULL;
+	recog_channel->rescore_grammar = NULL;
+	recog_channel->rescore_phrases = NULL;
+	recog_channel->rescore_sample_rate = 0;
+	recog_channel->rescore_g711_table = NULL;
+	recog_channel->caller_id[0] = '\0';
+	recog_channel->adapt_pending = FALSE;
+	recog_channel->adapt_length = 0;
+	recog_channel->adapt_sample_rate = 0;
+	recog_channel->media_held = FALSE;
+	recog_channel->media_idle = 0;
+	recog_channel->media_trace_dump = 0;
+	recog_channel->suspended = FALSE;
+	recog_channel->suspended_request = NULL;
+	recog_channel->rescore_worker = NULL;
+	recog_channel->rescore_version = NULL;
+	recog_channel->rescore_recognizer = NULL;
+	recog_channel->rescore_result = NULL;
+	recog_channel->rescore_cancel = 0;
+	recog_channel->rescore_close = FALSE;
+	recog_channel->chunk_length = 0;
+	recog_channel->chunk_threshold = recog_channel->chunk_capacity;
+	recog_channel->gate_offset = 0;
+	recog_channel->gate_length = 0;
+	recog_channel->gate_threshold = recog_channel->gate_capacity;
+	recog_channel->gate_open = FALSE;
+	memset(&recog_channel->audio,0,sizeof(recog_channel->audio));
+	recog_channel->audio_request = NULL;
+	recog_channel->audio_cancel = 0;
+	recog_channel->dtmf_enabled = FALSE;
+	recog_channel->dtmf_interdigit_timeout = VOSK_RECOG_DEFAULT_DTMF_INTERDIGIT_TIMEOUT;
+	recog_channel->dtmf_length = 0;
+	recog_channel->dtmf_elapsed = 0;
+	recog_channel->dtmf_cause = RECOGNIZER_COMPLETION_CAUSE_UNKNOWN;
+	recog_channel->input_started = FALSE;
+	recog_channel->rtf_avg = 0;
+	recog_channel->degraded = FALSE;
+	recog_channel->preroll_head = 0;
+	recog_channel->preroll_count = 0;
+
+	capabilities = mpf_sink_stream_capabilities_create(pool);
+	if(kaldi_engine->g711_tables) {
+		/* G.711 legs are linked as is, the codes are expanded by the decoder worker straight to the samples of the decoder */
+		mpf_codec_capabilities_add(&capabilities->codecs,MPF_SAMPLE_RATE_8000,"PCMU");
+		mpf_codec_capabilities_add(&capabilities->codecs,MPF_SAMPLE_RATE_8000,"PCMA");
+	}
+	mpf_codec_capabilities_add(
+			&capabilities->codecs,
+			kaldi_engine->sample_rates,
+			"LPCM");
+
+	/* create media termination */
+	termination = mrcp_engine_audio_termination_create(
+			recog_channel,        /* object to associate */
+			&audio_stream_vtable, /* virtual methods table of audio stream */
+			capabilities,         /* stream capabilities */
+			pool);                /* pool to allocate memory from */
+
+	/* create engine channel base */
+	recog_channel->channel = mrcp_engine_channel_create(
+			engine,               /* engine */
+			&channel_vtable,      /* virtual methods table of engine channel */
+			recog_channel,        /* object to associate */
+			termination,          /* associated media termination */
+			pool);                /* pool to allocate memory from */
+
+	return recog_channel->channel;
+}
+
+/** Destroy engine channel */
+static apt_bool_t vosk_recog_channel_destroy(mrcp_engine_channel_t *channel)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"channel destory %s", channel->id.buf);
+	if(recog_channel->slab_owned == TRUE) {
+		/* the close job is done and the termination is gone, recycle the channel */
+		vosk_recog_channel_slab_put(recog_channel->kaldi_engine,recog_channel);
+	}
+	return TRUE;
+}
+
+/** Open engine channel (asynchronous response MUST be sent)*/
+static apt_bool_t vosk_recog_channel_open(mrcp_engine_channel_t *channel)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	/* decode on the CPU or node the frames are produced on, so that they do not leave the caches or cross sockets */
+	recog_channel->worker = vosk_recog_worker_assign(
+								kaldi_engine->worker_pool,
+								kaldi_engine->media_affinity == TRUE ? channel->cpu : -1,
+								kaldi_engine->numa_mode != VOSK_RECOG_NUMA_NONE || kaldi_engine->media_affinity == TRUE ?
+									channel->numa_node : APT_NUMA_NODE_NONE);
+	if(vosk_recog_msg_signal(vosk_recog_MSG_OPEN_CHANNEL,channel,NULL) == FALSE) {
+		vosk_recog_worker_release(recog_channel->worker);
+		recog_channel->worker = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Close engine channel (asynchronous response MUST be sent)*/
+static apt_bool_t vosk_recog_channel_close(mrcp_engine_channel_t *channel)
+{
+	return vosk_recog_msg_signal(vosk_recog_MSG_CLOSE_CHANNEL,channel,NULL);
+}
+
+/** Process MRCP channel request (asynchronous response MUST be sent)*/
+static apt_bool_t vosk_recog_channel_request_process(mrcp_engine_channel_t *channel, mrcp_message_t *request)
+{
+	return vosk_recog_msg_signal(vosk_recog_MSG_REQUEST_PROCESS,channel,request);
+}
+
+/** Drop the reference to the model version of the request and return its seat */
+static void vosk_recog_channel_model_release(vosk_recog_channel_t *recog_channel)
+{
+	if(recog_channel->model) {
+		vosk_recog_model_release(recog_channel->kaldi_engine->models,recog_channel->model);
+		recog_channel->model = NULL;
+	}
+	if(recog_channel->model_seat) {
+		vosk_recog_model_seat_return(recog_channel->model_seat);
+		recog_channel->model_seat = NULL;
+	}
+}
+
+/** Take a seat of the model selected, return NULL if the seats are all taken */
+static vosk_recog_model_t* vosk_recog_channel_model_seat_take(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, vosk_recog_model_t *model)
+{
+	if(!model) {
+		return NULL;
+	}
+	if(vosk_recog_model_seat_take(model) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Seat Free of Model [%s] capacity [%u] " APT_SIDRES_FMT,
+			model->name, model->capacity, MRCP_MESSAGE_SIDRES(request));
+		return NULL;
+	}
+	recog_channel->model_seat = model;
+	return model;
+}
+
+/**
+ * Get class of request for model rules: the vendor-specific "prompt-class" param, if a rule is set for it,
+ * otherwise "closed" for a grammar of few enough phrases, "open" for dictation and other grammars.
+ */
+static const char* vosk_recog_channel_class_get(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const vosk_recog_grammar_t *grammar)
+{
+	apr_size_t phrase_count;
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"prompt-class");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			if(vosk_recog_model_rule_check(recog_channel->kaldi_engine->models,pair->value.buf) == TRUE) {
+				return pair->value.buf;
+			}
+			apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"No Model Rule for Prompt Class [%s] " APT_SIDRES_FMT,
+				pair->value.buf, MRCP_MESSAGE_SIDRES(request));
+		}
+	}
+	phrase_count = grammar ? vosk_recog_grammar_phrase_count_get(grammar) : 0;
+	if(phrase_count && phrase_count <= recog_channel->kaldi_engine->closed_grammar_max_phrases) {
+		return "closed";
+	}
+	return "open";
+}
+
+/**
+ * Select model by vendor-specific "model" param, by the rule of the class of the request
+ * or by Speech-Language header, then its variant by vendor-specific "speed-vs-accuracy" param
+ * or Speed-vs-Accuracy header, and take a seat of it.
+ */
+static vosk_recog_model_t* vosk_recog_channel_model_select(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_recog_header_t *recog_header, const vosk_recog_grammar_t *grammar, int sample_rate)
+{
+	vosk_recog_model_t *model = NULL;
+	const apt_pair_t *speed_vs_accuracy = NULL;
+	const char *language = NULL;
+	const char *class_name;
+	const vosk_recog_model_registry_t *models = recog_channel->kaldi_engine->models;
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_SPEECH_LANGUAGE) == TRUE) {
+		language = recog_header->speech_language.buf;
+	}
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"model");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair) {
+			model = vosk_recog_model_find(models,pair->value.buf);
+			if(!model) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Such Model [%s] " APT_SIDRES_FMT,
+					pair->value.buf, MRCP_MESSAGE_SIDRES(request));
+			}
+			else {
+				/* the model named is used as is */
+				return vosk_recog_channel_model_seat_take(recog_channel,request,model);
+			}
+		}
+		apt_string_set(&name,"speed-vs-accuracy");
+		speed_vs_accuracy = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+	}
+
+	/* the model of a rule is used as is, falling back to the next one once its seats are all taken */
+	class_name = vosk_recog_channel_class_get(recog_channel,request,grammar);
+	model = vosk_recog_model_rule_find(models,class_name,language);
+	if(model) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Select Model [%s] by Rule [%s] " APT_SIDRES_FMT,
+			model->name, class_name, MRCP_MESSAGE_SIDRES(request));
+		recog_channel->model_seat = model;
+		return model;
+	}
+	if(vosk_recog_model_rule_check(models,class_name) == TRUE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"No Model Free by Rule [%s] " APT_SIDRES_FMT,
+			class_name, MRCP_MESSAGE_SIDRES(request));
+	}
+	if(language) {
+		model = vosk_recog_model_find_by_language(models,language,sample_rate);
+		if(!model) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Model for Language [%s] " APT_SIDRES_FMT,
+				language, MRCP_MESSAGE_SIDRES(request));
+		}
+	}
+	if(!model) {
+		model = vosk_recog_model_default_get(models);
+	}
+
+	if(speed_vs_accuracy && speed_vs_accuracy->value.buf) {
+		model = vosk_recog_model_variant_find(models,model,(float)atof(speed_vs_accuracy->value.buf));
+	}
+	else if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_SPEED_VS_ACCURACY) == TRUE) {
+		model = vosk_recog_model_variant_find(models,model,recog_header->speed_vs_accuracy);
+	}
+	return vosk_recog_channel_model_seat_take(recog_channel,request,model);
+}
+
+/** Get interval of intermediate results by vendor-specific "intermediate-result-interval" param */
+static apr_size_t vosk_recog_interim_interval_get(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apr_size_t interval = recog_channel->kaldi_engine->interim_interval;
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"intermediate-result-interval");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			interval = atol(pair->value.buf);
+		}
+	}
+	return interval;
+}
+
+/** Check whether the media trace is to be dumped on completion by vendor-specific "media-trace-dump" param */
+static apt_bool_t vosk_recog_media_trace_dump_get(mrcp_message_t *request)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"media-trace-dump");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			return strcasecmp(pair->value.buf,"true") == 0 ? TRUE : FALSE;
+		}
+	}
+	return FALSE;
+}
+
+/** Check whether the request transcribes continuously by vendor-specific "continuous" param */
+static apt_bool_t vosk_recog_continuous_get(mrcp_message_t *request)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"continuous");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			return strcasecmp(pair->value.buf,"true") == 0 ? TRUE : FALSE;
+		}
+	}
+	return FALSE;
+}
+
+/** Check whether STOP is to be deferred to the checkpoint of continuous transcription by vendor-specific "checkpoint" param */
+static apt_bool_t vosk_recog_checkpoint_get(mrcp_message_t *request)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"checkpoint");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			return strcasecmp(pair->value.buf,"true") == 0 ? TRUE : FALSE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * Get the checkpoint continuous transcription is resumed from by vendor-specific "resume-checkpoint" param,
+ * which is "<segments>:<input-time>" as taken by STOP with checkpoint.
+ * @return FALSE if the request is not resumed, the counts are left as is then
+ */
+static apt_bool_t vosk_recog_resume_checkpoint_get(mrcp_message_t *request, apr_size_t *segments, apr_size_t *input_time)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"resume-checkpoint");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			const char *separator = strchr(pair->value.buf,':');
+			if(!separator) {
+				return FALSE;
+			}
+			*segments = atol(pair->value.buf);
+			*input_time = atol(separator + 1);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * Get the models of the candidate languages of the request by vendor-specific "language-id" param,
+ * which lists them separated by commas.
+ * @return NULL unless there are models of two languages at least to choose from
+ */
+static apr_array_header_t* vosk_recog_lid_models_get(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, int sample_rate)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	const apt_pair_t *pair = NULL;
+	apr_array_header_t *models;
+	char *languages;
+	char *language;
+	char *state;
+	int i;
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		apt_str_t name;
+		apt_string_set(&name,"language-id");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+	}
+	if(!pair || !pair->value.buf) {
+		return NULL;
+	}
+
+	models = apr_array_make(request->pool,2,sizeof(vosk_recog_model_t*));
+	languages = apr_pstrdup(request->pool,pair->value.buf);
+	for(language = apr_strtok(languages,", ",&state); language; language = apr_strtok(NULL,", ",&state)) {
+		vosk_recog_model_t *model = vosk_recog_model_find_by_language(recog_channel->kaldi_engine->models,language,sample_rate);
+		if(!model) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Model for Language [%s] " APT_SIDRES_FMT,
+				language, MRCP_MESSAGE_SIDRES(request));
+			continue;
+		}
+		for(i=0; i<models->nelts; i++) {
+			if(APR_ARRAY_IDX(models,i,vosk_recog_model_t*) == model) {
+				break;
+			}
+		}
+		if(i == models->nelts) {
+			APR_ARRAY_PUSH(models,vosk_recog_model_t*) = model;
+		}
+	}
+	return models->nelts > 1 ? models : NULL;
+}
+
+/** Take the caller of the session by the vendor-specific caller-id param of its first request naming one */
+static void vosk_recog_caller_setup(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	mrcp_generic_header_t *generic_header;
+	const apt_pair_t *pair;
+	apt_str_t name;
+	if(recog_channel->caller_id[0] != '\0') {
+		/* the speech kept so far is of the caller taken first */
+		return;
+	}
+	generic_header = mrcp_generic_header_get(request);
+	if(!generic_header || mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == FALSE) {
+		return;
+	}
+	apt_string_set(&name,"caller-id");
+	pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+	if(!pair || !pair->value.buf || !pair->value.length || pair->value.length > VOSK_RECOG_ADAPT_MAX_CALLER_ID) {
+		return;
+	}
+	memcpy(recog_channel->caller_id,pair->value.buf,pair->value.length);
+	recog_channel->caller_id[pair->value.length] = '\0';
+	recog_channel->adapt_pending = TRUE;
+}
+
+/** Set up DTMF input of the request by builtin:dtmf grammar URIs, DTMF-Term-Char and DTMF-Interdigit-Timeout headers */
+static void vosk_recog_dtmf_setup(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_recog_header_t *recog_header)
+{
+	vosk_recog_dtmf_grammar_t *grammar = &recog_channel->dtmf_grammar;
+	grammar->term_char = '\0';
+	recog_channel->dtmf_interdigit_timeout = VOSK_RECOG_DEFAULT_DTMF_INTERDIGIT_TIMEOUT;
+	if(recog_header) {
+		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_DTMF_TERM_CHAR) == TRUE) {
+			grammar->term_char = recog_header->dtmf_term_char;
+		}
+		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_DTMF_INTERDIGIT_TIMEOUT) == TRUE) {
+			recog_channel->dtmf_interdigit_timeout = recog_header->dtmf_interdigit_timeout;
+		}
+	}
+	/* the digits of the previous request are no longer collected, once it is completed */
+	recog_channel->dtmf_length = 0;
+	recog_channel->dtmf_elapsed = 0;
+	recog_channel->dtmf_cause = RECOGNIZER_COMPLETION_CAUSE_UNKNOWN;
+	recog_channel->dtmf_enabled = vosk_recog_dtmf_grammar_parse(&request->body,grammar);
+	if(recog_channel->dtmf_enabled == TRUE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Accept DTMF Input [%"APR_SIZE_T_FMT"-%"APR_SIZE_T_FMT" digits] " APT_SIDRES_FMT,
+			grammar->min_length,
+			grammar->max_length,
+			MRCP_MESSAGE_SIDRES(request));
+	}
+}
+
+/**
+ * Get options of the result by N-Best-List-Length and Confidence-Threshold headers
+ * and vendor-specific "n-best", "word-timings" and "confidence-only" params
+ */
+static void vosk_recog_result_options_get(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_recog_header_t *recog_header, vosk_recog_result_options_t *options)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	*options = recog_channel->kaldi_engine->result_options;
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_N_BEST_LIST_LENGTH) == TRUE) {
+		if(recog_header->n_best_list_length) {
+			options->n_best = recog_header->n_best_list_length;
+		}
+	}
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_CONFIDENCE_THRESHOLD) == TRUE) {
+		options->confidence_threshold = recog_header->confidence_threshold;
+	}
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"n-best");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf && atol(pair->value.buf) > 0) {
+			options->n_best = atol(pair->value.buf);
+		}
+		apt_string_set(&name,"word-timings");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			options->word_timings = strcasecmp(pair->value.buf,"true") == 0 ? TRUE : FALSE;
+		}
+		apt_string_set(&name,"confidence-only");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			options->confidence_only = strcasecmp(pair->value.buf,"true") == 0 ? TRUE : FALSE;
+		}
+	}
+	if(options->n_best > VOSK_RECOG_NLSML_MAX_INTERPRETATIONS) {
+		options->n_best = VOSK_RECOG_NLSML_MAX_INTERPRETATIONS;
+	}
+}
+
+/**
+ * Open audio input of a batch request, either the audio body or the file referenced by vendor-specific "audio-uri" param.
+ * @return 1 if opened, 0 if the request has no audio input, -1 on failure
+ */
+static int vosk_recog_audio_input_open(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	const char *uri = NULL;
+	char *path;
+	if(!generic_header) {
+		return 0;
+	}
+	if(mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"audio-uri");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.buf) {
+			uri = pair->value.buf;
+		}
+	}
+
+	if(!uri) {
+		if(mrcp_generic_header_property_check(request,GENERIC_HEADER_CONTENT_TYPE) == TRUE &&
+			strncasecmp(generic_header->content_type.buf,"audio/",6) == 0) {
+			return vosk_recog_audio_body_parse(&recog_channel->audio,&generic_header->content_type,&request->body) == TRUE ? 1 : -1;
+		}
+		return 0;
+	}
+
+	if(!recog_channel->kaldi_engine->audio_dir) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Audio Files Not Allowed, batch-audio-dir is not set " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+		return -1;
+	}
+	if(strncasecmp(uri,"file://",7) == 0) {
+		uri += 7;
+	}
+	/* the path must not escape the directory, absolute paths must be within it */
+	if(apr_filepath_merge(&path,recog_channel->kaldi_engine->audio_dir,uri,
+			APR_FILEPATH_SECUREROOT | APR_FILEPATH_NOTABOVEROOT,request->pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Audio URI Outside of batch-audio-dir [%s] " APT_SIDRES_FMT, uri, MRCP_MESSAGE_SIDRES(request));
+		return -1;
+	}
+	return vosk_recog_audio_file_open(&recog_channel->audio,path) == TRUE ? 1 : -1;
+}
+
+/** Set what the recognizer computes for the result, nothing but the top hypothesis if degraded */
+static void vosk_recog_recognizer_options_apply(vosk_recog_channel_t *recog_channel, VoskRecognizer *recognizer, apt_bool_t degraded)
+{
+	/* a pooled recognizer keeps the settings of its previous request, so set them all */
+	const vosk_recog_result_options_t *options = &recog_channel->result_options;
+	if(recog_channel->kaldi_engine->decoder_endpointer_mode >= 0) {
+		vosk_recognizer_set_endpointer_mode(recognizer,(VoskEndpointerMode)recog_channel->kaldi_engine->decoder_endpointer_mode);
+	}
+	if(degraded == TRUE) {
+		vosk_recognizer_set_max_alternatives(recognizer,0);
+		vosk_recognizer_set_words(recognizer,0);
+		return;
+	}
+	vosk_recognizer_set_max_alternatives(recognizer,options->n_best > 1 ? (int)options->n_best : 0);
+	/* the confidence of the top hypothesis is computed from word confidences, if it is to be checked */
+	vosk_recognizer_set_words(recognizer,
+		(options->word_timings == TRUE || options->confidence_only == TRUE || options->confidence_threshold > 0 ||
+		recog_channel->rescore == TRUE) ? 1 : 0);
+}
+
+/** Compose the members of the config of a remote decoder, which mirror the options of a local recognizer */
+static const char* vosk_recog_remote_options_get(const vosk_recog_channel_t *recog_channel, apr_pool_t *pool)
+{
+	const vosk_recog_result_options_t *options = &recog_channel->result_options;
+	return apr_psprintf(pool,"\"max_alternatives\" : %d, \"words\" : %d%s%s",
+		options->n_best > 1 ? (int)options->n_best : 0,
+		(options->word_timings == TRUE || options->confidence_only == TRUE || options->confidence_threshold > 0) ? 1 : 0,
+		recog_channel->phrases ? ", \"phrase_list\" : " : "",
+		recog_channel->phrases ? recog_channel->phrases : "");
+}
+
+/** Drop the result of the last request, on the next RECOGNIZE or on close */
+static void vosk_recog_last_result_drop(vosk_recog_channel_t *recog_channel)
+{
+	vosk_recog_last_result_t *last_result = apr_atomic_xchgptr((volatile void**)&recog_channel->last_result,NULL);
+	if(last_result && last_result->grammar) {
+		vosk_recog_grammar_unref(last_result->grammar);
+	}
+}
+
+/** Borrow recognizer of the second channel of stereo audio from the pool */
+static apt_bool_t vosk_recog_peer_acquire(vosk_recog_channel_t *recog_channel)
+{
+	recog_channel->peer_result = NULL;
+	recog_channel->peer_recognizer = vosk_recog_pool_acquire(
+							recog_channel->kaldi_engine->recog_pool,
+							recog_channel->model,
+							recog_channel->sample_rate,
+							recog_channel->phrases);
+	return recog_channel->peer_recognizer ? TRUE : FALSE;
+}
+
+/** Return recognizer of the second channel to the pool */
+static void vosk_recog_peer_release(vosk_recog_channel_t *recog_channel)
+{
+	if(recog_channel->peer_recognizer) {
+		vosk_recog_pool_release(
+			recog_channel->kaldi_engine->recog_pool,
+			recog_channel->model,
+			recog_channel->sample_rate,
+			recog_channel->phrases,
+			recog_channel->peer_recognizer);
+		recog_channel->peer_recognizer = NULL;
+	}
+	recog_channel->peer_result = NULL;
+}
+
+/** Set completion cause of failed grammar request */
+static void vosk_recog_grammar_failure_set(mrcp_message_t *response, mrcp_recog_completion_cause_e cause)
+{
+	mrcp_recog_header_t *recog_header;
+	response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+	recog_header = (mrcp_recog_header_t*)mrcp_resource_header_prepare(response);
+	if(recog_header) {
+		recog_header->completion_cause = cause;
+		mrcp_resource_header_property_add(response,RECOGNIZER_HEADER_COMPLETION_CAUSE);
+	}
+}
+
+/** Compile grammar fetched (fetcher thread) and signal the request to the engine task */
+static void vosk_recog_grammar_on_fetch(void *obj, const char *uri, const apt_str_t *body)
+{
+	vosk_recog_channel_t *recog_channel = obj;
+	recog_channel->fetched_grammar = NULL;
+	recog_channel->fetch_cause = RECOGNIZER_COMPLETION_CAUSE_GRAM_LOAD_FAILURE;
+	if(body) {
+		/* compiled once by the cache, however many requests reference the URI */
+		recog_channel->fetched_grammar = vosk_recog_grammar_cache_get(recog_channel->kaldi_engine->grammar_cache,body);
+		recog_channel->fetch_cause = recog_channel->fetched_grammar ?
+			RECOGNIZER_COMPLETION_CAUSE_SUCCESS : RECOGNIZER_COMPLETION_CAUSE_GRAM_COMP_FAILURE;
+	}
+	if(recog_channel->fetch_cause != RECOGNIZER_COMPLETION_CAUSE_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to %s Grammar [%s] " APT_SIDRES_FMT,
+			body ? "Compile" : "Fetch",
+			uri,
+			MRCP_MESSAGE_SIDRES(recog_channel->fetch_request));
+	}
+	recog_channel->fetch_done = TRUE;
+	vosk_recog_msg_signal(vosk_recog_MSG_GRAMMAR_FETCH,recog_channel->channel,recog_channel->fetch_request);
+}
+
+/**
+ * Get the grammar referenced by URI by the request, or start to fetch it (engine task context).
+ * @remark Grammars fetched recently are taken from the memory of the fetcher, hence never fetched per request.
+ */
+static vosk_recog_fetch_status_e vosk_recog_grammar_fetch_start(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_message_t *response, vosk_recog_grammar_t **grammar)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_get(request);
+	mrcp_grammar_fetcher_t *fetcher = recog_channel->kaldi_engine->grammar_fetcher;
+	const char *uri;
+	apt_str_t body;
+
+	/* audio and SRGS bodies are not scanned for URIs */
+	if(!generic_header || mrcp_generic_header_property_check(request,GENERIC_HEADER_CONTENT_TYPE) == FALSE ||
+		(strcasecmp(generic_header->content_type.buf,"text/uri-list") != 0 &&
+		strcasecmp(generic_header->content_type.buf,"text/grammar-ref-list") != 0)) {
+		return VOSK_RECOG_FETCH_NONE;
+	}
+	uri = vosk_recog_grammar_uri_get(&request->body,request->pool);
+	if(!uri) {
+		return VOSK_RECOG_FETCH_NONE;
+	}
+	*grammar = vosk_recog_grammar_precompiled_find(recog_channel->kaldi_engine,uri);
+	if(*grammar) {
+		/* compiled at engine open, referenced on behalf of the request as a cached one is */
+		vosk_recog_grammar_ref(*grammar);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Use Precompiled Grammar [%s] " APT_SIDRES_FMT, uri, MRCP_MESSAGE_SIDRES(request));
+		return VOSK_RECOG_FETCH_DONE;
+	}
+	if(!fetcher || mrcp_grammar_uri_check(uri) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported Grammar URI [%s] " APT_SIDRES_FMT, uri, MRCP_MESSAGE_SIDRES(request));
+		vosk_recog_grammar_failure_set(response,RECOGNIZER_COMPLETION_CAUSE_GRAM_LOAD_FAILURE);
+		return VOSK_RECOG_FETCH_FAILED;
+	}
+
+	if(mrcp_grammar_fetcher_get(fetcher,uri,&body,request->pool) == TRUE) {
+		*grammar = vosk_recog_grammar_cache_get(recog_channel->kaldi_engine->grammar_cache,&body);
+		if(!*grammar) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Compile Grammar [%s] " APT_SIDRES_FMT, uri, MRCP_MESSAGE_SIDRES(request));
+			vosk_recog_grammar_failure_set(response,RECOGNIZER_COMPLETION_CAUSE_GRAM_COMP_FAILURE);
+			return VOSK_RECOG_FETCH_FAILED;
+		}
+		return VOSK_RECOG_FETCH_DONE;
+	}
+
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Fetch Grammar [%s] " APT_SIDRES_FMT, uri, MRCP_MESSAGE_SIDRES(request));
+	recog_channel->fetch_request = request;
+	recog_channel->fetch_response = response;
+	recog_channel->fetched_grammar = NULL;
+	recog_channel->fetch_done = FALSE;
+	recog_channel->fetch = mrcp_grammar_fetch_start(fetcher,uri,vosk_recog_grammar_on_fetch,recog_channel);
+	if(!recog_channel->fetch) {
+		recog_channel->fetch_request = NULL;
+		recog_channel->fetch_response = NULL;
+		vosk_recog_grammar_failure_set(response,RECOGNIZER_COMPLETION_CAUSE_GRAM_LOAD_FAILURE);
+		return VOSK_RECOG_FETCH_FAILED;
+	}
+	return VOSK_RECOG_FETCH_PENDING;
+}
+
+/**
+ * Process RECOGNIZE request.
+ * @param grammar the grammar referenced by URI by the request, NULL to recognize against the defined one
+ */
+static apt_bool_t vosk_recog_channel_recognize_process(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response, vosk_recog_grammar_t *grammar)
+{
+	/* process RECOGNIZE request */
+	mrcp_recog_header_t *recog_header;
+	vosk_recog_model_t *model = NULL;
+	apt_bool_t save_waveform;
+	apt_bool_t batch_input;
+	apt_bool_t remote;
+	apr_size_t peers;
+	int sample_rate;
+	int status;
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	const mpf_codec_descriptor_t *descriptor = mrcp_engine_sink_stream_codec_get(channel);
+	if(!grammar) {
+		grammar = recog_channel->grammar;
+	}
+
+	/* recorded audio carried or referenced by the request is decoded at decoder speed, bypassing the media stream */
+	status = vosk_recog_audio_input_open(recog_channel,request);
+	if(status < 0) {
+		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+		recog_header = (mrcp_recog_header_t*)mrcp_resource_header_prepare(response);
+		if(recog_header) {
+			recog_header->completion_cause = RECOGNIZER_COMPLETION_CAUSE_URI_FAILURE;
+			mrcp_resource_header_property_add(response,RECOGNIZER_HEADER_COMPLETION_CAUSE);
+		}
+		return FALSE;
+	}
+	batch_input = status > 0 ? TRUE : FALSE;
+
+	if(!descriptor && batch_input == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec Descriptor " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+		return FALSE;
+	}
+	/* raw audio of unknown rate is taken to be of the rate of the session */
+	sample_rate = descriptor ? descriptor->sampling_rate : VOSK_RECOG_DEFAULT_SAMPLE_RATE;
+	if(batch_input == TRUE && recog_channel->audio.sample_rate) {
+		sample_rate = recog_channel->audio.sample_rate;
+	}
+	/* each channel of stereo audio is decoded by a recognizer of its own, as a speaker of its own */
+	recog_channel->channel_count = (batch_input == FALSE && descriptor->channel_count > 1) ? descriptor->channel_count : 1;
+	if(recog_channel->channel_count > VOSK_RECOG_MAX_CHANNEL_COUNT ||
+		(apr_size_t)sample_rate * recog_channel->channel_count > 16000) {
+		/* a queued frame fits 10 msec of 16 kHz mono audio, hence of 8 kHz stereo */
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported Audio [%d Hz] [%"APR_SIZE_T_FMT" channels] " APT_SIDRES_FMT,
+			sample_rate,recog_channel->channel_count,MRCP_MESSAGE_SIDRES(request));
+		recog_channel->channel_count = 1;
+		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+		return FALSE;
+	}
+
+	recog_channel->timers_started = TRUE;
+
+	/* get recognizer header */
+	recog_header = (mrcp_recog_header_t*)mrcp_resource_header_get(request);
+	if(recog_header) {
+		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_START_INPUT_TIMERS) == TRUE) {
+			recog_channel->timers_started = recog_header->start_input_timers;
+		}
+		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_NO_INPUT_TIMEOUT) == TRUE) {
+			mpf_activity_detector_noinput_timeout_set(recog_channel->detector,recog_header->no_input_timeout);
+		}
+		if(mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_SPEECH_COMPLETE_TIMEOUT) == TRUE) {
+			mpf_activity_detector_silence_timeout_set(recog_channel->detector,recog_header->speech_complete_timeout);
+		}
+	}
+	recog_channel->recognition_timeout = recog_channel->kaldi_engine->recognition_timeout;
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_RECOGNITION_TIMEOUT) == TRUE) {
+		recog_channel->recognition_timeout = recog_header->recognition_timeout;
+	}
+
+	/* keywords are spotted in live audio only, by a recognizer constrained to the phrases of the grammar */
+	recog_channel->hotword = FALSE;
+	if(batch_input == FALSE && recog_header &&
+		mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_RECOGNITION_MODE) == TRUE &&
+		recog_header->recognition_mode.buf &&
+		strcasecmp(recog_header->recognition_mode.buf,"hotword") == 0) {
+		if(!grammar) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Grammar Defined for Hotword Recognition " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+			response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+			return FALSE;
+		}
+		if(!vosk_recog_grammar_phrases_get(grammar)) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Grammar Is Not a Phrase List, Hotword Recognition Is Not Constrained " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+		}
+		recog_channel->hotword = TRUE;
+	}
+
+	/* live audio may be transcribed segment by segment till STOP, rather than completed on the first utterance */
+	recog_channel->continuous = FALSE;
+	recog_channel->activity_detected = FALSE;
+	recog_channel->checkpoint_response = NULL;
+	apr_atomic_set32(&recog_channel->checkpoint_state,VOSK_RECOG_CHECKPOINT_NONE);
+	if(batch_input == FALSE && recog_channel->hotword == FALSE && vosk_recog_continuous_get(request) == TRUE) {
+		/* the speech which never pauses is bounded by the segment time instead */
+		recog_channel->recognition_timeout = 0;
+		recog_channel->continuous = TRUE;
+	}
+
+	save_waveform = recog_channel->kaldi_engine->dump_enabled;
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_SAVE_WAVEFORM) == TRUE) {
+		save_waveform = recog_header->save_waveform;
+	}
+	/* the dump of the previous request is closed by the decoder worker on completion */
+	recog_channel->dump = NULL;
+	if(save_waveform == TRUE && batch_input == FALSE && recog_channel->channel_count == 1) {
+		const apt_dir_layout_t *dir_layout = channel->engine->dir_layout;
+		apt_bool_t wav = recog_channel->kaldi_engine->dump_wav;
+		char *file_name = apr_psprintf(channel->pool,"utter-%dkHz-%s-%"MRCP_REQUEST_ID_FMT".%s",
+							sample_rate/1000,
+							request->channel_id.session_id.buf,
+							request->start_line.request_id,
+							wav == TRUE ? "wav" : "pcm");
+		char *file_path = apt_vardir_filepath_get(dir_layout,file_name,channel->pool);
+		if(file_path) {
+			recog_channel->dump = vosk_recog_dump_open(
+									recog_channel->kaldi_engine->dump_writer,
+									file_path,
+									sample_rate,
+									wav);
+		}
+	}
+	/* keywords, segments and recorded audio are only decoded by local models */
+	remote = (recog_channel->kaldi_engine->remote && batch_input == FALSE &&
+		recog_channel->hotword == FALSE && recog_channel->continuous == FALSE) ? TRUE : FALSE;
+	if(remote == FALSE) {
+		model = vosk_recog_channel_model_select(recog_channel,request,recog_header,grammar,sample_rate);
+	}
+	if(model) {
+		/* the request keeps the current version till completion, even if the model is reloaded meanwhile */
+		model = vosk_recog_model_acquire(recog_channel->kaldi_engine->models,model);
+		if(!model->model && !model->batch_model) {
+			vosk_recog_model_release(recog_channel->kaldi_engine->models,model);
+			model = NULL;
+		}
+	}
+	if(!model && remote == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Model Available " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+		if(recog_channel->model_seat) {
+			vosk_recog_model_seat_return(recog_channel->model_seat);
+			recog_channel->model_seat = NULL;
+		}
+		vosk_recog_audio_close(&recog_channel->audio);
+		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+		return FALSE;
+	}
+	if(model && model->sample_rate && model->sample_rate != sample_rate) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Sampling Rate Mismatch [%s] native [%d] session [%d], feature input is resampled " APT_SIDRES_FMT,
+			model->name, model->sample_rate, sample_rate, MRCP_MESSAGE_SIDRES(request));
+	}
+	if(model) {
+		/* read the replica local to the node of the decoder worker */
+		model = vosk_recog_model_replica_get(model,vosk_recog_worker_numa_node_get(recog_channel->worker));
+	}
+	/* the recognizer of the previous request is returned by the decoder worker on completion */
+	recog_channel->model = model;
+	recog_channel->sample_rate = sample_rate;
+	/* recorded audio is L16 whatever the codec of the session */
+	recog_channel->g711_table = batch_input == FALSE ? vosk_recog_g711_table_get(recog_channel->kaldi_engine,descriptor) : NULL;
+	recog_channel->sample_size = (recog_channel->g711_table ? 1 : BYTES_PER_SAMPLE) * recog_channel->channel_count;
+	recog_channel->chunk_threshold = recog_channel->kaldi_engine->chunk_time * sample_rate / 1000 * recog_channel->sample_size;
+	if(recog_channel->chunk_threshold > recog_channel->chunk_capacity) {
+		recog_channel->chunk_threshold = recog_channel->chunk_capacity;
+	}
+	if(recog_channel->gate_capacity) {
+		recog_channel->gate_threshold = recog_channel->kaldi_engine->pre_roll_time * sample_rate / 1000 * recog_channel->sample_size;
+	}
+
+	if(recog_channel->adapt_buffer && batch_input == FALSE && recog_channel->channel_count == 1) {
+		vosk_recog_caller_setup(recog_channel,request);
+	}
+
+	recog_channel->interim_interval = vosk_recog_interim_interval_get(recog_channel,request);
+	if(batch_input == FALSE && vosk_recog_media_trace_dump_get(request) == TRUE) {
+		apr_atomic_set32(&recog_channel->media_trace_dump,1);
+	}
+	vosk_recog_result_options_get(recog_channel,request,recog_header,&recog_channel->result_options);
+	vosk_recog_dtmf_setup(recog_channel,request,recog_header);
+	if(batch_input == TRUE) {
+		/* recorded audio carries no named events */
+		recog_channel->dtmf_enabled = FALSE;
+	}
+
+	/* the grammar may be redefined during recognition, keep the current one till completion */
+	recog_channel->active_grammar = grammar;
+	recog_channel->phrases = NULL;
+	if(recog_channel->active_grammar) {
+		vosk_recog_grammar_ref(recog_channel->active_grammar);
+		if(recog_channel->kaldi_engine->constrained_decoding == TRUE || recog_channel->hotword == TRUE) {
+			recog_channel->phrases = vosk_recog_grammar_phrases_get(recog_channel->active_grammar);
+		}
+		if(vosk_recog_grammar_fst_check(recog_channel->active_grammar) == TRUE) {
+			/* final results are interpreted by the tags of the grammar */
+			recog_channel->result_options.interpret = vosk_recog_grammar_interpret;
+			recog_channel->result_options.interpret_obj = recog_channel->active_grammar;
+		}
+	}
+	if(!recog_channel->result_options.interpret && recog_channel->kaldi_engine->itn) {
+		/* the written form is rendered into the instance by the decoder worker, along with the result */
+		recog_channel->result_options.interpret = vosk_recog_itn_interpret;
+		recog_channel->result_options.interpret_obj = recog_channel->kaldi_engine->itn;
+	}
+
+	recog_channel->batch_result = NULL;
+	recog_channel->taken_result = NULL;
+	vosk_recog_last_result_drop(recog_channel);
+	/* keywords are spotted in the first channel, the other backends are only fed the first channel too */
+	peers = (recog_channel->hotword == FALSE) ? recog_channel->channel_count : 1;
+	if(remote == TRUE) {
+		/* decoded by a remote decoder, which is only biased by the phrases of the grammar */
+		recog_channel->remote_stream = vosk_recog_remote_stream_open(
+							recog_channel->kaldi_engine->remote,
+							recog_channel->sample_rate,
+							vosk_recog_remote_options_get(recog_channel,request->pool),
+							recog_channel);
+	}
+	else if(recog_channel->kaldi_engine->batch && batch_input == FALSE && recog_channel->hotword == FALSE && recog_channel->continuous == FALSE) {
+		/* decoded by the batch model, which is not constrained by grammars */
+		recog_channel->batch_stream = vosk_recog_batch_stream_open(
+							recog_channel->kaldi_engine->batch,
+							model->batch_model,
+							recog_channel->sample_rate,
+							recog_channel);
+		if(!recog_channel->batch_stream) {
+			if(recog_channel->active_grammar) {
+				vosk_recog_grammar_unref(recog_channel->active_grammar);
+				recog_channel->active_grammar = NULL;
+			}
+			recog_channel->phrases = NULL;
+			vosk_recog_channel_model_release(recog_channel);
+			response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+			return FALSE;
+		}
+	}
+	else if(mrcp_engine_channel_mem_charge(channel,model->recognizer_memory * peers) == TRUE) {
+		/* the audio input is decoded by the worker, the collector paces the chunks of live streams */
+		recog_channel->recognizer_charge = model->recognizer_memory * peers;
+		recog_channel->recognizer = vosk_recog_pool_acquire(
+							recog_channel->kaldi_engine->recog_pool,
+							model,
+							recog_channel->sample_rate,
+							recog_channel->phrases);
+		if(recog_channel->recognizer && peers > 1 && vosk_recog_peer_acquire(recog_channel) == FALSE) {
+			/* the channels are decoded all or none */
+			vosk_recog_pool_release(
+				recog_channel->kaldi_engine->recog_pool,
+				model,
+				recog_channel->sample_rate,
+				recog_channel->phrases,
+				recog_channel->recognizer);
+			recog_channel->recognizer = NULL;
+		}
+	}
+	else {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Reject Recognizer over Memory Cap [%"APR_SIZE_T_FMT"] " APT_SIDRES_FMT,
+			model->recognizer_memory * peers,MRCP_MESSAGE_SIDRES(request));
+	}
+	/* a live utterance decoded by a model other than the rescore model is decoded again by it on low confidence */
+	recog_channel->rescore = (recog_channel->recognizer && batch_input == FALSE && recog_channel->channel_count == 1 &&
+		recog_channel->hotword == FALSE && recog_channel->continuous == FALSE &&
+		recog_channel->kaldi_engine->rescore_model &&
+		strcmp(model->name,recog_channel->kaldi_engine->rescore_model->name) != 0) ? TRUE : FALSE;
+	if(recog_channel->recognizer) {
+		vosk_recog_recognizer_options_apply(recog_channel,recog_channel->recognizer,FALSE);
+	}
+	if(recog_channel->peer_recognizer) {
+		vosk_recog_recognizer_options_apply(recog_channel,recog_channel->peer_recognizer,FALSE);
+	}
+	/* the first speech is held back till its language is identified, then a single recognizer decodes it all */
+	recog_channel->lid_models = NULL;
+	if(recog_channel->lid_buffer && recog_channel->recognizer && batch_input == FALSE &&
+		recog_channel->channel_count == 1 && recog_channel->hotword == FALSE) {
+		recog_channel->lid_models = vosk_recog_lid_models_get(recog_channel,request,sample_rate);
+		recog_channel->lid_threshold = recog_channel->kaldi_engine->lid_time * sample_rate / 1000 * recog_channel->sample_size;
+	}
+	/* the batch model reports no partial results, keywords are spotted and segments are cut on inactivity */
+	recog_channel->endpoint_combined = (recog_channel->kaldi_engine->endpointer == VOSK_RECOG_ENDPOINTER_COMBINED &&
+		recog_channel->recognizer && recog_channel->hotword == FALSE && recog_channel->continuous == FALSE) ? TRUE : FALSE;
+	if(!recog_channel->recognizer && !recog_channel->batch_stream && !recog_channel->remote_stream) {
+		if(recog_channel->recognizer_charge) {
+			mrcp_engine_channel_mem_uncharge(channel,recog_channel->recognizer_charge);
+			recog_channel->recognizer_charge = 0;
+		}
+		if(recog_channel->active_grammar) {
+			vosk_recog_grammar_unref(recog_channel->active_grammar);
+			recog_channel->active_grammar = NULL;
+		}
+		recog_channel->phrases = NULL;
+		vosk_recog_channel_model_release(recog_channel);
+		vosk_recog_audio_close(&recog_channel->audio);
+		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_FAILED;
+		return FALSE;
+	}
+
+	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_PROCESSED);
+	/* send asynchronous response */
+	mrcp_engine_channel_message_send(channel,response);
+	if(batch_input == TRUE) {
+		/* the request is never published to the MPF scheduler, which only passes STOP then */
+		apr_atomic_set32(&recog_channel->audio_cancel,0);
+		recog_channel->audio_request = request;
+		vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_AUDIO,recog_channel);
+		return TRUE;
+	}
+	/* mark the start before the request is published to the MPF scheduler */
+	apr_atomic_set32(&recog_channel->recog_start,1);
+	apr_atomic_xchgptr((volatile void**)&recog_channel->recog_request,request);
+	return TRUE;
+}
+
+/** Process RECOGNIZE request, once the grammar it references by URI, if any, is fetched */
+static apt_bool_t vosk_recog_channel_recognize(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	vosk_recog_grammar_t *grammar = NULL;
+	apt_bool_t processed;
+	switch(vosk_recog_grammar_fetch_start(recog_channel,request,response,&grammar)) {
+		case VOSK_RECOG_FETCH_FAILED:
+			return FALSE;
+		case VOSK_RECOG_FETCH_PENDING:
+			/* the response is sent on completion of the fetch */
+			return TRUE;
+		default:
+			break;
+	}
+	processed = vosk_recog_channel_recognize_process(channel,request,response,grammar);
+	if(grammar) {
+		/* referenced by the request on its own, if it is in progress */
+		vosk_recog_grammar_unref(grammar);
+	}
+	return processed;
+}
+
+/** Process STOP request */
+static apt_bool_t vosk_recog_channel_stop(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
+{
+	/* process STOP request */
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	if(recog_channel->continuous == TRUE && recog_channel->recog_request && vosk_recog_checkpoint_get(request) == TRUE) {
+		/* the transcription is stopped at the next boundary of segments, so that it can be resumed from there */
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Request Checkpoint " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(request));
+		recog_channel->checkpoint_response = response;
+		apr_atomic_set32(&recog_channel->checkpoint_state,VOSK_RECOG_CHECKPOINT_PENDING);
+		return TRUE;
+	}
+	/* store STOP request, make sure there is no more activity and only then send the response */
+	recog_channel->stop_response = response;
+	/* abandon decoding of the audio input of a batch request, if any */
+	apr_atomic_set32(&recog_channel->audio_cancel,1);
+	return TRUE;
+}
+
+/** Process START-INPUT-TIMERS request */
+static apt_bool_t vosk_recog_channel_timers_start(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	recog_channel->timers_started = TRUE;
+	return mrcp_engine_channel_message_send(channel,response);
+}
+
+/**
+ * Define grammar of the channel, the reference of the caller is taken over.
+ * @return FALSE if the grammar is over the memory cap, the previous grammar is kept then
+ */
+static apt_bool_t vosk_recog_grammar_define(vosk_recog_channel_t *recog_channel, vosk_recog_grammar_t *grammar)
+{
+	apr_size_t size = vosk_recog_grammar_size_get(grammar);
+	if(mrcp_engine_channel_mem_charge(recog_channel->channel,size) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Reject Grammar over Memory Cap [%"APR_SIZE_T_FMT"] <%s>",
+			size,recog_channel->channel->id.buf);
+		vosk_recog_grammar_unref(grammar);
+		return FALSE;
+	}
+	if(recog_channel->grammar) {
+		vosk_recog_grammar_unref(recog_channel->grammar);
+		mrcp_engine_channel_mem_uncharge(recog_channel->channel,recog_channel->grammar_charge);
+	}
+	recog_channel->grammar = grammar;
+	recog_channel->grammar_charge = size;
+	return TRUE;
+}
+
+/** Process DEFINE-GRAMMAR request */
+static apt_bool_t vosk_recog_channel_define_grammar(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	vosk_recog_grammar_t *grammar = NULL;
+	switch(vosk_recog_grammar_fetch_start(recog_channel,request,response,&grammar)) {
+		case VOSK_RECOG_FETCH_FAILED:
+			return FALSE;
+		case VOSK_RECOG_FETCH_PENDING:
+			/* the response is sent on completion of the fetch */
+			return TRUE;
+		case VOSK_RECOG_FETCH_DONE:
+			break;
+		default:
+			grammar = vosk_recog_grammar_cache_body_get(recog_channel->kaldi_engine->grammar_cache,&request->body,request->body_id);
+			break;
+	}
+	if(!grammar) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Compile Grammar " APT_SIDRES_FMT, MRCP_MESSAGE_SIDRES(request));
+		vosk_recog_grammar_failure_set(response,RECOGNIZER_COMPLETION_CAUSE_GRAM_COMP_FAILURE);
+		return FALSE;
+	}
+
+	if(vosk_recog_grammar_define(recog_channel,grammar) == FALSE) {
+		vosk_recog_grammar_failure_set(response,RECOGNIZER_COMPLETION_CAUSE_GRAM_LOAD_FAILURE);
+	}
+	/* the response is sent by the dispatcher */
+	return FALSE;
+}
+
+/** Process the request its grammar is fetched for (engine task context) */
+static void vosk_recog_grammar_fetch_complete(mrcp_engine_channel_t *channel, mrcp_message_t *request)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	mrcp_message_t *response = recog_channel->fetch_response;
+	vosk_recog_grammar_t *grammar = recog_channel->fetched_grammar;
+	apt_bool_t processed = FALSE;
+
+	if(recog_channel->fetch) {
+		/* completed, hence just dropped */
+		mrcp_grammar_fetch_release(recog_channel->kaldi_engine->grammar_fetcher,recog_channel->fetch);
+		recog_channel->fetch = NULL;
+	}
+	recog_channel->fetch_request = NULL;
+	recog_channel->fetch_response = NULL;
+	recog_channel->fetched_grammar = NULL;
+	recog_channel->fetch_done = FALSE;
+	if(recog_channel->close_pending == TRUE) {
+		/* the channel is closed meanwhile, the request is abandoned */
+		recog_channel->close_pending = FALSE;
+		if(grammar) {
+			vosk_recog_grammar_unref(grammar);
+		}
+		vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_CLOSE,recog_channel);
+		return;
+	}
+
+	if(!grammar) {
+		vosk_recog_grammar_failure_set(response,recog_channel->fetch_cause);
+	}
+	else if(request->start_line.method_id == RECOGNIZER_DEFINE_GRAMMAR) {
+		if(vosk_recog_grammar_define(recog_channel,grammar) == FALSE) {
+			vosk_recog_grammar_failure_set(response,RECOGNIZER_COMPLETION_CAUSE_GRAM_LOAD_FAILURE);
+		}
+	}
+	else {
+		processed = vosk_recog_channel_recognize_process(channel,request,response,grammar);
+		vosk_recog_grammar_unref(grammar);
+	}
+	if(processed == FALSE) {
+		mrcp_engine_channel_message_send(channel,response);
+	}
+}
+
+/**
+ * Process GET-RESULT: render the result of the last request again by the N-Best-List-Length and
+ * Confidence-Threshold headers of GET-RESULT, without decoding the utterance again.
+ * The alternatives are limited to those computed for the request.
+ */
+static apt_bool_t vosk_recog_channel_get_result(mrcp_engine_channel_t *channel, mrcp_message_t *request, mrcp_message_t *response)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)channel->method_obj;
+	vosk_recog_last_result_t *last_result = apr_atomic_casptr((volatile void**)&recog_channel->last_result,NULL,NULL);
+	mrcp_recog_header_t *recog_header = (mrcp_recog_header_t*)mrcp_resource_header_get(request);
+	vosk_recog_result_options_t options;
+	apt_bool_t rejected = FALSE;
+
+	if(!last_result || recog_channel->recog_request) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"No Result to Get " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(request));
+		response->start_line.status_code = MRCP_STATUS_CODE_METHOD_NOT_VALID;
+		return FALSE;
+	}
+
+	options = last_result->options;
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_N_BEST_LIST_LENGTH) == TRUE) {
+		if(recog_header->n_best_list_length) {
+			options.n_best = recog_header->n_best_list_length;
+		}
+	}
+	if(recog_header && mrcp_resource_header_property_check(request,RECOGNIZER_HEADER_CONFIDENCE_THRESHOLD) == TRUE) {
+		options.confidence_threshold = recog_header->confidence_threshold;
+	}
+	if(vosk_recog_nlsml_build(last_result->result,last_result->early,&options,&response->body,&rejected,response->pool) == TRUE) {
+		if(rejected == TRUE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Reject Result below Confidence Threshold [%.2f] " APT_SIDRES_FMT,
+				options.confidence_threshold,
+				MRCP_MESSAGE_SIDRES(request));
+		}
+		else {
+			vosk_recog_result_content_type_set(response);
+		}
+	}
+	return FALSE;
+}
+
+/** Dispatch MRCP request */
+static apt_bool_t vosk_recog_channel_request_dispatch(mrcp_engine_channel_t *channel, mrcp_message_t *request)
+{
+	apt_bool_t processed = FALSE;
+	mrcp_message_t *response = mrcp_response_create(request,request->pool);
+	switch(request->start_line.method_id) {
+		case RECOGNIZER_SET_PARAMS:
+			break;
+		case RECOGNIZER_GET_PARAMS:
+			break;
+		case RECOGNIZER_DEFINE_GRAMMAR:
+			processed = vosk_recog_channel_define_grammar(channel,request,response);
+			break;
+		case RECOGNIZER_RECOGNIZE:
+			processed = vosk_recog_channel_recognize(channel,request,response);
+			break;
+		case RECOGNIZER_GET_RESULT:
+			processed = vosk_recog_channel_get_result(channel,request,response);
+			break;
+		case RECOGNIZER_START_INPUT_TIMERS:
+			processed = vosk_recog_channel_timers_start(channel,request,response);
+			break;
+		case RECOGNIZER_STOP:
+			processed = vosk_recog_channel_stop(channel,request,response);
+			break;
+		default:
+			break;
+	}
+	if(processed == FALSE) {
+		/* send asynchronous response for not handled request */
+		mrcp_engine_channel_message_send(channel,response);
+	}
+	return TRUE;
+}
 
 /** Callback is called from MPF engine context to destroy any additional data associated with audio stream */
 static apt_bool_t vosk_recog_stream_destroy(mpf_audio_stream_t *stream)
 {
-	return TRUE;
+	return TRUE;
+}
+
+/** Callback is called from MPF engine context to perform any action before open */
+static apt_bool_t vosk_recog_stream_open(mpf_audio_stream_t *stream, mpf_codec_t *codec)
+{
+	return TRUE;
+}
+
+/** Callback is called from MPF engine context to perform any action after close */
+static apt_bool_t vosk_recog_stream_close(mpf_audio_stream_t *stream)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)stream->obj;
+	if(recog_channel->media_held == FALSE) {
+		/* no frames are written till the stream is opened again, as for media made inactive by re-INVITE */
+		vosk_recog_media_hold(recog_channel,"closed");
+	}
+	return TRUE;
+}
+
+/** Return recognizer to the pool, drop the grammar and close the dump of the request (decoder worker context) */
+static void vosk_recog_channel_recognizer_release(vosk_recog_channel_t *recog_channel)
+{
+	if(recog_channel->dump) {
+		vosk_recog_dump_close(recog_channel->dump);
+		recog_channel->dump = NULL;
+	}
+	if(recog_channel->recognizer) {
+		vosk_recog_pool_release(
+			recog_channel->kaldi_engine->recog_pool,
+			recog_channel->model,
+			recog_channel->sample_rate,
+			recog_channel->phrases,
+			recog_channel->recognizer);
+		recog_channel->recognizer = NULL;
+	}
+	vosk_recog_peer_release(recog_channel);
+	if(recog_channel->recognizer_charge) {
+		mrcp_engine_channel_mem_uncharge(recog_channel->channel,recog_channel->recognizer_charge);
+		recog_channel->recognizer_charge = 0;
+	}
+	if(recog_channel->batch_stream) {
+		vosk_recog_batch_stream_close(recog_channel->batch_stream);
+		recog_channel->batch_stream = NULL;
+		recog_channel->batch_result = NULL;
+	}
+	if(recog_channel->remote_stream) {
+		vosk_recog_remote_stream_close(recog_channel->remote_stream);
+		recog_channel->remote_stream = NULL;
+		recog_channel->batch_result = NULL;
+	}
+	/* the version may be freed, once its recognizers are returned */
+	vosk_recog_channel_model_release(recog_channel);
+	/* the phrases belong to the grammar, hence dropped after the recognizer is returned */
+	recog_channel->phrases = NULL;
+	if(recog_channel->active_grammar) {
+		vosk_recog_grammar_unref(recog_channel->active_grammar);
+		recog_channel->active_grammar = NULL;
+	}
+}
+
+/* Raise kaldi START-OF-INPUT event, once per request, either on speech or on the first digit */
+static apt_bool_t vosk_recog_start_of_input(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, apt_bool_t dtmf)
+{
+	mrcp_message_t *message;
+	if(recog_channel->input_started == TRUE) {
+		return TRUE;
+	}
+	recog_channel->input_started = TRUE;
+
+	/* create START-OF-INPUT event */
+	message = mrcp_event_create(
+						request,
+						RECOGNIZER_START_OF_INPUT,
+						request->pool);
+	if(!message) {
+		return FALSE;
+	}
+
+	if(dtmf == TRUE && message->start_line.version == MRCP_VERSION_2) {
+		/* get/allocate recognizer header */
+		mrcp_recog_header_t *recog_header = (mrcp_recog_header_t*)mrcp_resource_header_prepare(message);
+		if(recog_header) {
+			apt_string_set(&recog_header->input_type,"dtmf");
+			mrcp_resource_header_property_add(message,RECOGNIZER_HEADER_INPUT_TYPE);
+		}
+	}
+	/* set request state */
+	message->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_INPUT_STARTED);
+	/* send asynch event */
+	return mrcp_engine_channel_message_send(recog_channel->channel,message);
+}
+
+
+/** Create vendor-specific INTERMEDIATE-RESULT event */
+static mrcp_message_t* vosk_recog_intermediate_create(mrcp_message_t *request, const char *result)
+{
+	mrcp_generic_header_t *generic_header;
+	/* create INTERMEDIATE-RESULT event */
+	mrcp_message_t *message = mrcp_event_create(
+						request,
+						RECOGNIZER_INTERMEDIATE_RESULT,
+						request->pool);
+	if(!message) {
+		return NULL;
+	}
+
+	apt_string_assign(&message->body,result,message->pool);
+	/* get/allocate generic header */
+	generic_header = mrcp_generic_header_prepare(message);
+	if(generic_header) {
+		/* set content types */
+		apt_string_assign(&generic_header->content_type,"application/json",message->pool);
+		mrcp_generic_header_property_add(message,GENERIC_HEADER_CONTENT_TYPE);
+	}
+
+	/* set request state */
+	message->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
+	return message;
+}
+
+/* Raise vendor-specific INTERMEDIATE-RESULT event */
+static apt_bool_t vosk_recog_intermediate_result(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result)
+{
+	mrcp_message_t *message = vosk_recog_intermediate_create(request,result);
+	if(!message) {
+		return FALSE;
+	}
+	/* send asynch event */
+	return mrcp_engine_channel_message_send(recog_channel->channel,message);
+}
+
+/** Add vendor-specific param to message */
+static void vosk_recog_vendor_param_add(apt_pair_arr_t *params, const char *name, const char *value, apr_pool_t *pool)
+{
+	apt_str_t name_str;
+	apt_str_t value_str;
+	apt_string_set(&name_str,name);
+	apt_string_set(&value_str,value);
+	apt_pair_array_append(params,&name_str,&value_str,pool);
+}
+
+/**
+ * Enroll, verify or identify the speaker by the vector computed along with the result (decoder worker context).
+ * The speaker is enrolled by vendor-specific "speaker-enroll" param, verified by "speaker-claimed-id",
+ * and identified otherwise; the outcome is returned as vendor-specific params of the event.
+ */
+static void vosk_recog_speaker_process(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result, mrcp_message_t *message)
+{
+	float vector[MRCP_VOICEPRINT_MAX_SIZE];
+	apr_size_t size;
+	apr_size_t frames;
+	float score = 0;
+	const char *id = NULL;
+	const char *enroll_id = NULL;
+	const char *claimed_id = NULL;
+	apt_bool_t scored = FALSE;
+	apt_pair_arr_t *params;
+	mrcp_generic_header_t *generic_header;
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+
+	generic_header = mrcp_generic_header_get(request);
+	if(generic_header && mrcp_generic_header_property_check(request,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS) == TRUE) {
+		const apt_pair_t *pair;
+		apt_str_t name;
+		apt_string_set(&name,"speaker-enroll");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.length) {
+			enroll_id = pair->value.buf;
+		}
+		apt_string_set(&name,"speaker-claimed-id");
+		pair = apt_pair_array_find(generic_header->vendor_specific_params,&name);
+		if(pair && pair->value.length) {
+			claimed_id = pair->value.buf;
+		}
+	}
+
+	size = vosk_recog_nlsml_speaker_vector_get(result,vector,MRCP_VOICEPRINT_MAX_SIZE,&frames);
+	if(!size) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"No Speaker Vector " APT_SIDRES_FMT,MRCP_MESSAGE_SIDRES(request));
+		return;
+	}
+	params = apt_pair_array_create(3,message->pool);
+	if(enroll_id) {
+		if(frames < VOSK_RECOG_SPEAKER_MIN_FRAMES) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Too Short Speech to Enroll [%s] [%"APR_SIZE_T_FMT" frames] " APT_SIDRES_FMT,
+				enroll_id,frames,MRCP_MESSAGE_SIDRES(request));
+		}
+		else if(mrcp_voiceprint_store_enroll(kaldi_engine->voiceprints,enroll_id,vector,size) == TRUE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Enrolled Voiceprint [%s] " APT_SIDRES_FMT,enroll_id,MRCP_MESSAGE_SIDRES(request));
+			vosk_recog_vendor_param_add(params,"speaker-enrolled",enroll_id,message->pool);
+		}
+	}
+	else if(claimed_id) {
+		if(mrcp_voiceprint_store_verify(kaldi_engine->voiceprints,claimed_id,vector,size,&score) == TRUE) {
+			id = claimed_id;
+			scored = TRUE;
+		}
+	}
+	else {
+		mrcp_voiceprint_match_t match;
+		if(mrcp_voiceprint_store_identify(kaldi_engine->voiceprints,vector,size,&match,1) == 1) {
+			id = match.id;
+			score = match.score;
+			scored = TRUE;
+		}
+	}
+
+	if(scored == TRUE) {
+		vosk_recog_vendor_param_add(params,"speaker-id",id,message->pool);
+		vosk_recog_vendor_param_add(params,"speaker-score",apr_psprintf(message->pool,"%.2f",score),message->pool);
+		vosk_recog_vendor_param_add(params,"speaker-verified",score >= kaldi_engine->speaker_threshold ? "true" : "false",message->pool);
+	}
+	if(apt_pair_array_size_get(params)) {
+		generic_header = mrcp_generic_header_prepare(message);
+		if(generic_header) {
+			generic_header->vendor_specific_params = params;
+			mrcp_generic_header_property_add(message,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS);
+		}
+	}
+}
+
+/** Create RECOGNITION-COMPLETE event */
+static mrcp_message_t* vosk_recog_complete_create(mrcp_message_t *request, mrcp_recog_completion_cause_e cause)
+{
+	mrcp_recog_header_t *recog_header;
+	/* create RECOGNITION-COMPLETE event */
+	mrcp_message_t *message = mrcp_event_create(
+						request,
+						RECOGNIZER_RECOGNITION_COMPLETE,
+						request->pool);
+	if(!message) {
+		return NULL;
+	}
+
+	/* get/allocate recognizer header */
+	recog_header = (mrcp_recog_header_t*)mrcp_resource_header_prepare(message);
+	if(recog_header) {
+		/* set completion cause */
+		recog_header->completion_cause = cause;
+		mrcp_resource_header_property_add(message,RECOGNIZER_HEADER_COMPLETION_CAUSE);
+	}
+	/* set request state */
+	message->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+	return message;
+}
+
+/** Set content type of NLSML result */
+static void vosk_recog_result_content_type_set(mrcp_message_t *message)
+{
+	/* get/allocate generic header */
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_prepare(message);
+	if(generic_header) {
+		/* set content types */
+		apt_string_assign(&generic_header->content_type,"application/x-nlsml",message->pool);
+		mrcp_generic_header_property_add(message,GENERIC_HEADER_CONTENT_TYPE);
+	}
+}
+
+/** Send RECOGNITION-COMPLETE event and return the recognizer (decoder worker context) */
+static apt_bool_t vosk_recog_complete_send(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_message_t *message)
+{
+	/* stop feeding frames of the request, unless a new one has already been started */
+	recog_channel->decode_request = NULL;
+	/* the next request may be started as soon as the event is sent */
+	vosk_recog_channel_recognizer_release(recog_channel);
+	apr_atomic_casptr((volatile void**)&recog_channel->recog_request,NULL,request);
+	/* send asynch event */
+	return mrcp_engine_channel_message_send(recog_channel->channel,message);
+}
+
+/** Keep the audio passed to the recognizer, to decode it again on rescoring (decoder worker context) */
+static void vosk_recog_rescore_keep(vosk_recog_channel_t *recog_channel, const char *buffer, apr_size_t size)
+{
+	apr_size_t max_length;
+	if(recog_channel->rescore_dropped == TRUE) {
+		return;
+	}
+	max_length = recog_channel->kaldi_engine->rescore_max_time * recog_channel->sample_rate / 1000 * recog_channel->sample_size;
+	if(max_length > recog_channel->rescore_capacity) {
+		max_length = recog_channel->rescore_capacity;
+	}
+	if(recog_channel->rescore_length + size > max_length) {
+		/* too long an utterance to decode it again in time, the first pass stands */
+		recog_channel->rescore_dropped = TRUE;
+		return;
+	}
+	memcpy(recog_channel->rescore_buffer + recog_channel->rescore_length,buffer,size);
+	recog_channel->rescore_length += size;
+}
+
+/**
+ * Hand the utterance over to a rescore worker, if the confidence of the final result is low (decoder worker context).
+ * @return TRUE if the request is completed once the rescored result is signaled back
+ */
+static apt_bool_t vosk_recog_rescore_start(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	double confidence;
+	if(!recog_channel->taken_result) {
+		/* the result is taken once, the recognizer returns an empty one afterwards */
+		recog_channel->taken_result = vosk_recognizer_result(recog_channel->recognizer);
+	}
+	if(recog_channel->rescore_dropped == TRUE || !recog_channel->rescore_length || recog_channel->rescore_request) {
+		return FALSE;
+	}
+	/* no confidence is computed while decoding is degraded, no rescoring is added to the load then */
+	if(vosk_recog_nlsml_confidence_get(recog_channel->taken_result,&confidence) == FALSE ||
+		confidence >= kaldi_engine->rescore_confidence) {
+		return FALSE;
+	}
+
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Rescore Result of Confidence [%.2f] by [%s] [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+		confidence,
+		kaldi_engine->rescore_model->name,
+		recog_channel->rescore_length * 1000 / (recog_channel->sample_rate * recog_channel->sample_size),
+		MRCP_MESSAGE_SIDRES(request));
+	/* the result of the first pass is owned by the recognizer, which is returned meanwhile */
+	recog_channel->rescore_first = apr_pstrdup(request->pool,recog_channel->taken_result);
+	recog_channel->rescore_request = request;
+	recog_channel->rescore_sample_rate = recog_channel->sample_rate;
+	recog_channel->rescore_g711_table = recog_channel->g711_table;
+	recog_channel->rescore_phrases = recog_channel->phrases;
+	/* the phrases belong to the grammar, which is released by STOP or the next request */
+	recog_channel->rescore_grammar = recog_channel->active_grammar;
+	if(recog_channel->rescore_grammar) {
+		vosk_recog_grammar_ref(recog_channel->rescore_grammar);
+	}
+	recog_channel->rescore_version = NULL;
+	recog_channel->rescore_recognizer = NULL;
+	recog_channel->rescore_result = NULL;
+	apr_atomic_set32(&recog_channel->rescore_cancel,0);
+	recog_channel->rescore_worker = vosk_recog_worker_assign(
+									kaldi_engine->rescore_pool,
+									-1,
+									vosk_recog_worker_numa_node_get(recog_channel->worker));
+	if(vosk_recog_worker_signal(recog_channel->rescore_worker,VOSK_RECOG_JOB_RESCORE,recog_channel) == FALSE) {
+		vosk_recog_worker_release(recog_channel->rescore_worker);
+		recog_channel->rescore_worker = NULL;
+		if(recog_channel->rescore_grammar) {
+			vosk_recog_grammar_unref(recog_channel->rescore_grammar);
+			recog_channel->rescore_grammar = NULL;
+		}
+		recog_channel->rescore_phrases = NULL;
+		recog_channel->rescore_first = NULL;
+		recog_channel->rescore_request = NULL;
+		return FALSE;
+	}
+
+	/* stop feeding frames of the request, the recognizer of the first pass is done with */
+	recog_channel->decode_request = NULL;
+	apr_atomic_casptr((volatile void**)&recog_channel->recog_request,NULL,request);
+	vosk_recog_pool_release(
+		kaldi_engine->recog_pool,
+		recog_channel->model,
+		recog_channel->sample_rate,
+		recog_channel->phrases,
+		recog_channel->recognizer);
+	recog_channel->recognizer = NULL;
+	recog_channel->taken_result = NULL;
+	return TRUE;
+}
+
+/* Raise kaldi RECOGNITION-COMPLETE event */
+/**
+ * Keep the result of the completed request for GET-RESULT, unless it is larger than configured (decoder worker context).
+ * The result is copied, as the one of the recognizer is only valid till it is used again.
+ */
+static void vosk_recog_last_result_keep(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result, const char *early)
+{
+	vosk_recog_last_result_t *last_result;
+	apr_size_t max_size = recog_channel->kaldi_engine->last_result_max_size;
+	if(!result || !max_size || strlen(result) > max_size) {
+		return;
+	}
+	last_result = apr_palloc(request->pool,sizeof(vosk_recog_last_result_t));
+	last_result->result = apr_pstrdup(request->pool,result);
+	last_result->early = early ? apr_pstrdup(request->pool,early) : NULL;
+	last_result->options = recog_channel->result_options;
+	last_result->grammar = recog_channel->active_grammar;
+	if(last_result->grammar) {
+		vosk_recog_grammar_ref(last_result->grammar);
+	}
+	/* published as a whole, GET-RESULT is processed by the engine task */
+	last_result = apr_atomic_xchgptr((volatile void**)&recog_channel->last_result,last_result);
+	if(last_result && last_result->grammar) {
+		vosk_recog_grammar_unref(last_result->grammar);
+	}
+}
+
+static apt_bool_t vosk_recog_recognition_complete(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_recog_completion_cause_e cause, const char *early)
+{
+	mrcp_message_t *message;
+	if(cause == RECOGNIZER_COMPLETION_CAUSE_SUCCESS && !early && recog_channel->rescore == TRUE && recog_channel->recognizer) {
+		if(vosk_recog_rescore_start(recog_channel,request) == TRUE) {
+			/* the request is completed once the rescored result is signaled back */
+			return TRUE;
+		}
+	}
+
+	message = vosk_recog_complete_create(request,cause);
+	if(!message) {
+		return FALSE;
+	}
+
+	if(cause == RECOGNIZER_COMPLETION_CAUSE_SUCCESS || cause == RECOGNIZER_COMPLETION_CAUSE_RECOGNITION_TIMEOUT) {
+		apt_bool_t rejected = FALSE;
+		const char *result = recog_channel->taken_result;
+		if(!result) {
+			if(recog_channel->batch_stream || recog_channel->remote_stream) {
+				result = recog_channel->batch_result;
+			}
+			else if(cause == RECOGNIZER_COMPLETION_CAUSE_RECOGNITION_TIMEOUT) {
+				/* no endpoint is reached, the speech decoded so far is finalized */
+				result = vosk_recognizer_final_result(recog_channel->recognizer);
+			}
+			else {
+				result = vosk_recognizer_result(recog_channel->recognizer);
+			}
+		}
+		if(recog_channel->hotword == TRUE) {
+			/* input is only considered started on a keyword hit */
+			vosk_recog_start_of_input(recog_channel,request,FALSE);
+		}
+		if((recog_channel->recognizer || recog_channel->rescore_request == request) && recog_channel->kaldi_engine->spk_model) {
+			vosk_recog_speaker_process(recog_channel,request,result,message);
+		}
+		if(recog_channel->peer_recognizer) {
+			/* each speaker channel gets its own result, the completion carries the first one */
+			vosk_recog_peer_complete(recog_channel,request);
+			vosk_recog_speaker_channel_tag(recog_channel,message,1);
+		}
+		/* the NLSML document is written right into the pool of the message,
+		unless the same one has been rendered for the same grammar before */
+		if(vosk_recog_nlsml_cache_build(
+				recog_channel->active_grammar ? recog_channel->kaldi_engine->result_cache : NULL,
+				recog_channel->active_grammar ? vosk_recog_grammar_hash_get(recog_channel->active_grammar) : 0,
+				result,
+				early,
+				&recog_channel->result_options,
+				&message->body,
+				&rejected,
+				message->pool) == TRUE) {
+			if(rejected == TRUE) {
+				if(cause == RECOGNIZER_COMPLETION_CAUSE_SUCCESS) {
+					mrcp_recog_header_t *recog_header = (mrcp_recog_header_t*)mrcp_resource_header_get(message);
+					if(recog_header) {
+						recog_header->completion_cause = RECOGNIZER_COMPLETION_CAUSE_NO_MATCH;
+					}
+				}
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Reject Result below Confidence Threshold [%.2f] " APT_SIDRES_FMT,
+					recog_channel->result_options.confidence_threshold,
+					MRCP_MESSAGE_SIDRES(request));
+			}
+			else {
+				vosk_recog_result_content_type_set(message);
+			}
+		}
+		vosk_recog_last_result_keep(recog_channel,request,result,early);
+	}
+	recog_channel->taken_result = NULL;
+	return vosk_recog_complete_send(recog_channel,request,message);
+}
+
+/* Raise kaldi RECOGNITION-COMPLETE event on DTMF input, abandoning the speech decoded so far (decoder worker context) */
+static apt_bool_t vosk_recog_dtmf_complete(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_recog_completion_cause_e cause, const char *digits, apr_size_t length)
+{
+	const vosk_recog_dtmf_grammar_t *grammar = &recog_channel->dtmf_grammar;
+	mrcp_message_t *message = vosk_recog_complete_create(request,cause);
+	char *input;
+	if(!message) {
+		return FALSE;
+	}
+
+	input = apr_pstrmemdup(message->pool,digits,length);
+	if(length && grammar->term_char && input[length-1] == grammar->term_char) {
+		input[--length] = '\0';
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Complete by DTMF Input [%s] cause [%d] " APT_SIDRES_FMT,
+		input, cause, MRCP_MESSAGE_SIDRES(request));
+	if(cause == RECOGNIZER_COMPLETION_CAUSE_SUCCESS) {
+		const char *instance = input;
+		if(grammar->boolean == TRUE) {
+			instance = *input == '1' ? "true" : "false";
+		}
+		if(vosk_recog_nlsml_dtmf_build(input,instance,&message->body,message->pool) == TRUE) {
+			vosk_recog_result_content_type_set(message);
+		}
+	}
+	return vosk_recog_complete_send(recog_channel,request,message);
+}
+
+/** Pass frame to the decoder worker (MPF context) */
+static apt_bool_t vosk_recog_frame_enqueue(
+						vosk_recog_channel_t *recog_channel,
+						vosk_recog_frame_type_e type,
+						mrcp_message_t *message,
+						const mpf_frame_t *frame,
+						mpf_frame_ref_t *ref,
+						mpf_detector_event_e det_event)
+{
+	/* plain audio may be dropped on overflow, frames which carry state may not */
+	apt_bool_t audio = (type == VOSK_RECOG_FRAME_AUDIO && det_event == MPF_DETECTOR_EVENT_NONE &&
+						!apr_atomic_read32(&recog_channel->recog_start)) ? TRUE : FALSE;
+	vosk_recog_frame_t *item = mpf_audio_queue_write_begin(recog_channel->frame_queue,audio);
+	if(!item) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Decoder Queue Overflow <%s>",recog_channel->channel->id.buf);
+		return FALSE;
+	}
+
+	item->type = type;
+	item->message = message;
+	item->start = FALSE;
+	item->det_event = det_event;
+	item->voice = FALSE;
+	item->silence = FALSE;
+	item->size = 0;
+	item->data = item->buffer;
+	item->ref = NULL;
+	if(frame && (frame->type & MEDIA_FRAME_TYPE_SILENCE) == MEDIA_FRAME_TYPE_SILENCE) {
+		/* nothing to copy, the frame only times the input on */
+		item->start = apr_atomic_xchg32(&recog_channel->recog_start,0) ? TRUE : FALSE;
+		item->silence = TRUE;
+	}
+	else if(frame) {
+		item->voice = mpf_activity_detector_activity_check(recog_channel->detector);
+		item->start = apr_atomic_xchg32(&recog_channel->recog_start,0) ? TRUE : FALSE;
+		item->size = frame->codec_frame.size;
+		if(item->size > VOSK_RECOG_MAX_FRAME_SIZE) {
+			item->size = VOSK_RECOG_MAX_FRAME_SIZE;
+		}
+		if(ref) {
+			/* shared with the other sinks, released once the frame is processed */
+			mpf_frame_ref_retain(ref);
+			item->ref = ref;
+			item->data = frame->codec_frame.buffer;
+		}
+		else {
+			memcpy(item->buffer,frame->codec_frame.buffer,item->size);
+		}
+	}
+	mpf_audio_queue_write_commit(recog_channel->frame_queue);
+
+	/* wake the worker up, unless it is already signaled to drain the queue */
+	if(apr_atomic_cas32(&recog_channel->scheduled,1,0) == 0 &&
+		vosk_recog_worker_ready(recog_channel->worker,recog_channel) == FALSE) {
+		/* the worker is not woken up, the next frame schedules the channel again */
+		apr_atomic_xchg32(&recog_channel->scheduled,0);
+	}
+	return TRUE;
+}
+
+/** Pass digits collected so far to the decoder worker (MPF context) */
+static apt_bool_t vosk_recog_dtmf_enqueue(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_recog_completion_cause_e cause)
+{
+	vosk_recog_frame_t *item = mpf_audio_queue_write_begin(recog_channel->frame_queue,FALSE);
+	if(!item) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Decoder Queue Overflow <%s>",recog_channel->channel->id.buf);
+		return FALSE;
+	}
+
+	item->type = VOSK_RECOG_FRAME_DTMF;
+	item->message = request;
+	/* the first digit may come ahead of the first frame of the request */
+	item->start = apr_atomic_xchg32(&recog_channel->recog_start,0) ? TRUE : FALSE;
+	item->det_event = MPF_DETECTOR_EVENT_NONE;
+	item->voice = FALSE;
+	item->silence = FALSE;
+	item->cause = cause;
+	item->size = recog_channel->dtmf_length;
+	item->data = item->buffer;
+	item->ref = NULL;
+	memcpy(item->buffer,recog_channel->dtmf_digits,item->size);
+	mpf_audio_queue_write_commit(recog_channel->frame_queue);
+
+	if(apr_atomic_cas32(&recog_channel->scheduled,1,0) == 0 &&
+		vosk_recog_worker_ready(recog_channel->worker,recog_channel) == FALSE) {
+		/* the worker is not woken up, the next digit or frame schedules the channel again */
+		apr_atomic_xchg32(&recog_channel->scheduled,0);
+	}
+	return TRUE;
+}
+
+/** Collect RFC 4733 digits and match them against DTMF grammar, return TRUE once the match is decided (MPF context) */
+static apt_bool_t vosk_recog_dtmf_collect(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const mpf_frame_t *frame)
+{
+	if(recog_channel->dtmf_cause == RECOGNIZER_COMPLETION_CAUSE_UNKNOWN) {
+		vosk_recog_dtmf_match_e match = VOSK_RECOG_DTMF_MATCH_PARTIAL;
+		char digit = '\0';
+		if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT && frame->marker == MPF_MARKER_START_OF_EVENT) {
+			digit = mpf_event_id_to_dtmf_char(frame->event_frame.event_id);
+		}
+
+		if(digit) {
+			if(!recog_channel->dtmf_length) {
+				/* barge-in on the first digit */
+				vosk_recog_dtmf_enqueue(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_UNKNOWN);
+			}
+			recog_channel->dtmf_digits[recog_channel->dtmf_length++] = digit;
+			recog_channel->dtmf_elapsed = 0;
+			match = vosk_recog_dtmf_grammar_match(
+						&recog_channel->dtmf_grammar,
+						recog_channel->dtmf_digits,
+						recog_channel->dtmf_length,
+						FALSE);
+		}
+		else if(recog_channel->dtmf_length && recog_channel->dtmf_interdigit_timeout) {
+			recog_channel->dtmf_elapsed += CODEC_FRAME_TIME_BASE;
+			if(recog_channel->dtmf_elapsed >= recog_channel->dtmf_interdigit_timeout) {
+				match = vosk_recog_dtmf_grammar_match(
+							&recog_channel->dtmf_grammar,
+							recog_channel->dtmf_digits,
+							recog_channel->dtmf_length,
+							TRUE);
+			}
+		}
+
+		if(match == VOSK_RECOG_DTMF_MATCH_PARTIAL) {
+			return FALSE;
+		}
+		recog_channel->dtmf_cause = (match == VOSK_RECOG_DTMF_MATCH_FULL) ?
+			RECOGNIZER_COMPLETION_CAUSE_SUCCESS : RECOGNIZER_COMPLETION_CAUSE_NO_MATCH;
+	}
+
+	/* retried with the next frame, if the queue is full */
+	if(vosk_recog_dtmf_enqueue(recog_channel,request,recog_channel->dtmf_cause) == TRUE) {
+		/* the rest is up to the worker, stop feeding frames */
+		apr_atomic_casptr((volatile void**)&recog_channel->recog_request,NULL,request);
+	}
+	return TRUE;
+}
+
+/** Keep audio frame written while no request is active, overwriting the oldest one (MPF context) */
+static void vosk_recog_preroll_store(vosk_recog_channel_t *recog_channel, const mpf_frame_t *frame)
+{
+	vosk_recog_preroll_frame_t *slot;
+	if((frame->type & MEDIA_FRAME_TYPE_AUDIO) != MEDIA_FRAME_TYPE_AUDIO || !frame->codec_frame.size) {
+		return;
+	}
+	if(recog_channel->preroll_count < recog_channel->preroll_capacity) {
+		slot = &recog_channel->preroll[(recog_channel->preroll_head + recog_channel->preroll_count) % recog_channel->preroll_capacity];
+		recog_channel->preroll_count++;
+	}
+	else {
+		slot = &recog_channel->preroll[recog_channel->preroll_head];
+		recog_channel->preroll_head = (recog_channel->preroll_head + 1) % recog_channel->preroll_capacity;
+	}
+	slot->size = frame->codec_frame.size;
+	if(slot->size > VOSK_RECOG_MAX_FRAME_SIZE) {
+		slot->size = VOSK_RECOG_MAX_FRAME_SIZE;
+	}
+	memcpy(slot->data,frame->codec_frame.buffer,slot->size);
+}
+
+/** Replay the frames kept ahead of the request, the first of them starts the request (MPF context) */
+static void vosk_recog_preroll_replay(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	mpf_frame_t frame;
+	apr_size_t count = recog_channel->preroll_count;
+	memset(&frame,0,sizeof(frame));
+	frame.type = MEDIA_FRAME_TYPE_AUDIO;
+	for(; recog_channel->preroll_count; recog_channel->preroll_count--) {
+		vosk_recog_preroll_frame_t *slot = &recog_channel->preroll[recog_channel->preroll_head];
+		frame.codec_frame.buffer = slot->data;
+		frame.codec_frame.size = slot->size;
+		if(vosk_recog_frame_enqueue(recog_channel,VOSK_RECOG_FRAME_AUDIO,request,&frame,NULL,MPF_DETECTOR_EVENT_NONE) == FALSE) {
+			/* the rest is dropped, the live audio is not to be held up */
+			break;
+		}
+		recog_channel->preroll_head = (recog_channel->preroll_head + 1) % recog_channel->preroll_capacity;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Replay Pre-Roll [%"APR_SIZE_T_FMT" frames] " APT_SIDRES_FMT,
+		count - recog_channel->preroll_count,
+		MRCP_MESSAGE_SIDRES(request));
+	recog_channel->preroll_head = 0;
+	recog_channel->preroll_count = 0;
+}
+
+/** Take the call as held, the channel is suspended by the worker (MPF context) */
+static void vosk_recog_media_hold(vosk_recog_channel_t *recog_channel, const char *reason)
+{
+	mrcp_message_t *request = recog_channel->recog_request;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Media Held [%s] <%s>",reason,recog_channel->channel->id.buf);
+	recog_channel->media_held = TRUE;
+	/* the audio kept ahead of a request predates the hold */
+	recog_channel->preroll_head = 0;
+	recog_channel->preroll_count = 0;
+	vosk_recog_frame_enqueue(recog_channel,VOSK_RECOG_FRAME_HOLD,request,NULL,NULL,MPF_DETECTOR_EVENT_NONE);
+}
+
+/** Take the call as resumed, the channel is resumed by the worker (MPF context) */
+static void vosk_recog_media_resume(vosk_recog_channel_t *recog_channel)
+{
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Media Resumed <%s>",recog_channel->channel->id.buf);
+	recog_channel->media_held = FALSE;
+	vosk_recog_frame_enqueue(recog_channel,VOSK_RECOG_FRAME_RESUME,recog_channel->recog_request,NULL,NULL,MPF_DETECTOR_EVENT_NONE);
+}
+
+/** Callback is called from MPF engine context to write/send new frame, shared with other sinks if ref is set */
+static apt_bool_t vosk_recog_frame_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame, mpf_frame_ref_t *ref)
+{
+	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)stream->obj;
+	mrcp_message_t *request;
+	if(recog_channel->checkpoint_response &&
+		(apr_atomic_read32(&recog_channel->checkpoint_state) == VOSK_RECOG_CHECKPOINT_REACHED || !recog_channel->recog_request)) {
+		/* the checkpoint is reached, or the request is over before it, the deferred STOP goes on as any other */
+		recog_channel->stop_response = recog_channel->checkpoint_response;
+		recog_channel->checkpoint_response = NULL;
+	}
+	if(recog_channel->stop_response) {
+		/* the response to STOP request is sent by the worker, once the preceding frames are processed */
+		if(vosk_recog_frame_enqueue(recog_channel,VOSK_RECOG_FRAME_STOP,recog_channel->stop_response,NULL,NULL,MPF_DETECTOR_EVENT_NONE) == TRUE) {
+			recog_channel->stop_response = NULL;
+			apr_atomic_xchgptr((volatile void**)&recog_channel->recog_request,NULL);
+		}
+		return TRUE;
+	}
+
+	if((frame->type & (MEDIA_FRAME_TYPE_AUDIO | MEDIA_FRAME_TYPE_EVENT | MEDIA_FRAME_TYPE_SILENCE)) != 0) {
+		/* the silence of discontinuous transmission does not put the call on hold */
+		recog_channel->media_idle = 0;
+		if(recog_channel->media_held == TRUE) {
+			vosk_recog_media_resume(recog_channel);
+		}
+	}
+	else if(recog_channel->kaldi_engine->hold_timeout && recog_channel->media_held == FALSE) {
+		recog_channel->media_idle += CODEC_FRAME_TIME_BASE;
+		if(recog_channel->media_idle >= recog_channel->kaldi_engine->hold_timeout) {
+			vosk_recog_media_hold(recog_channel,"idle");
+		}
+	}
+	if(recog_channel->media_held == TRUE) {
+		/* the timers of the request stand still, as the detector is not fed, till audio is back */
+		return TRUE;
+	}
+
+	request = recog_channel->recog_request;
+	if(!request && stream->recorder && apr_atomic_read32(&recog_channel->media_trace_dump)) {
+		/* dumped on demand once the request is done with, so that the trace covers it */
+		apr_atomic_set32(&recog_channel->media_trace_dump,0);
+		mpf_flight_recorder_dump(stream->recorder,recog_channel->channel->id.buf,"On Demand");
+	}
+	if(request) {
+		mpf_detector_event_e det_event;
+		apt_bool_t end = FALSE;
+		if(recog_channel->preroll_count) {
+			/* the audio kept ahead of the request precedes the frame */
+			vosk_recog_preroll_replay(recog_channel,request);
+		}
+		if(recog_channel->g711_table && (frame->type & MEDIA_FRAME_TYPE_AUDIO) == MEDIA_FRAME_TYPE_AUDIO) {
+			/* the detector takes linear samples, the codes are queued as is */
+			mpf_frame_t linear_frame = *frame;
+			apr_size_t size = frame->codec_frame.size;
+			if(size > VOSK_RECOG_MAX_FRAME_SIZE) {
+				size = VOSK_RECOG_MAX_FRAME_SIZE;
+			}
+			vosk_recog_g711_linear_expand(recog_channel->g711_table,frame->codec_frame.buffer,size,recog_channel->detect_buffer);
+			linear_frame.codec_frame.buffer = recog_channel->detect_buffer;
+			linear_frame.codec_frame.size = size * sizeof(apr_int16_t);
+			det_event = mpf_activity_detector_process(recog_channel->detector,&linear_frame);
+		}
+		else {
+			det_event = mpf_activity_detector_process(recog_channel->detector,frame);
+		}
+		mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_FIRST_AUDIO);
+		switch(det_event) {
+			case MPF_DETECTOR_EVENT_ACTIVITY:
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Voice Activity " APT_SIDRES_FMT,
+					MRCP_MESSAGE_SIDRES(request));
+				recog_channel->activity_detected = TRUE;
+				break;
+			case MPF_DETECTOR_EVENT_INACTIVITY:
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Voice Inactivity " APT_SIDRES_FMT,
+					MRCP_MESSAGE_SIDRES(request));
+				/* keywords are listened for past the end of out-of-grammar speech, the decoder may not agree on the end */
+				end = (recog_channel->hotword == TRUE || recog_channel->endpoint_combined == TRUE ||
+						recog_channel->continuous == TRUE) ? FALSE : TRUE;
+				break;
+			case MPF_DETECTOR_EVENT_NOINPUT:
+				if(recog_channel->continuous == TRUE && recog_channel->activity_detected == TRUE) {
+					/* silence between the segments of continuous transcription */
+					det_event = MPF_DETECTOR_EVENT_NONE;
+					break;
+				}
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Noinput " APT_SIDRES_FMT,
+					MRCP_MESSAGE_SIDRES(request));
+				if(recog_channel->timers_started == TRUE) {
+					end = TRUE;
+				}
+				else {
+					det_event = MPF_DETECTOR_EVENT_NONE;
+				}
+				break;
+			default:
+				break;
+		}
+
+		if(det_event != MPF_DETECTOR_EVENT_NONE && stream->recorder) {
+			mpf_flight_recorder_put(stream->recorder,MPF_FLIGHT_DETECTOR,(apr_byte_t)det_event,0,0,0);
+			if(det_event == MPF_DETECTOR_EVENT_NOINPUT &&
+				mpf_flight_recorder_rtp_check(stream->recorder,VOSK_RECOG_FLIGHT_RTP_INTERVAL) == TRUE) {
+				/* no input while RTP keeps arriving: silence or audio lost on the way to the detector */
+				mpf_flight_recorder_dump(stream->recorder,recog_channel->channel->id.buf,"No-Input");
+			}
+		}
+
+		if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
+			if(frame->marker == MPF_MARKER_START_OF_EVENT) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Start of Event " APT_SIDRES_FMT " id:%d",
+					MRCP_MESSAGE_SIDRES(request),
+					frame->event_frame.event_id);
+			}
+			else if(frame->marker == MPF_MARKER_END_OF_EVENT) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected End of Event " APT_SIDRES_FMT " id:%d duration:%d ts",
+					MRCP_MESSAGE_SIDRES(request),
+					frame->event_frame.event_id,
+					frame->event_frame.duration);
+			}
+		}
+
+		if(recog_channel->dtmf_enabled == TRUE) {
+			if(vosk_recog_dtmf_collect(recog_channel,request,frame) == TRUE) {
+				/* the request is completed by DTMF input, the rest of the audio is not decoded */
+				return TRUE;
+			}
+			if(recog_channel->dtmf_length && det_event == MPF_DETECTOR_EVENT_NOINPUT) {
+				/* input has started, the digits are timed by the inter-digit timeout instead */
+				det_event = MPF_DETECTOR_EVENT_NONE;
+				end = FALSE;
+			}
+		}
+
+		if(det_event == MPF_DETECTOR_EVENT_NONE) {
+			/* retry the event which did not fit into the queue previously */
+			det_event = recog_channel->pending_event;
+			end = ((det_event == MPF_DETECTOR_EVENT_INACTIVITY && recog_channel->hotword == FALSE &&
+					recog_channel->endpoint_combined == FALSE && recog_channel->continuous == FALSE) ||
+					det_event == MPF_DETECTOR_EVENT_NOINPUT) ? TRUE : FALSE;
+		}
+
+		if(vosk_recog_frame_enqueue(recog_channel,VOSK_RECOG_FRAME_AUDIO,request,frame,ref,det_event) == TRUE) {
+			recog_channel->pending_event = MPF_DETECTOR_EVENT_NONE;
+			if(end == TRUE) {
+				/* the rest is up to the worker, stop feeding frames */
+				apr_atomic_casptr((volatile void**)&recog_channel->recog_request,NULL,request);
+			}
+		}
+		else {
+			recog_channel->pending_event = det_event;
+		}
+	}
+	else if(recog_channel->preroll_capacity) {
+		/* the speech onset may precede the request, as in barge-in */
+		vosk_recog_preroll_store(recog_channel,frame);
+	}
+	return TRUE;
+}
+
+/** Callback is called from MPF engine context to write/send new frame */
+static apt_bool_t vosk_recog_stream_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame)
+{
+	return vosk_recog_frame_write(stream,frame,NULL);
+}
+
+/** Callback is called from MPF engine context to write frame shared with other sinks */
+static apt_bool_t vosk_recog_stream_ref_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame, mpf_frame_ref_t *ref)
+{
+	return vosk_recog_frame_write(stream,frame,ref);
+}
+
+/** Reset evaluation state of partial results */
+static APR_INLINE void vosk_recog_partial_reset(vosk_recog_partial_t *partial)
+{
+	partial->elapsed = 0;
+	partial->hash = 0;
+}
+
+/** Check whether partial result is due to evaluate (decoder worker context) */
+static apt_bool_t vosk_recog_partial_due(vosk_recog_partial_t *partial, apr_size_t interval, apr_size_t elapsed)
+{
+	partial->elapsed += elapsed;
+	if(partial->elapsed < interval) {
+		return FALSE;
+	}
+	partial->elapsed = 0;
+	return TRUE;
+}
+
+/** Check whether partial result differs from the last evaluated one (decoder worker context) */
+static apt_bool_t vosk_recog_partial_changed(vosk_recog_partial_t *partial, const char *result)
+{
+	apr_ssize_t length = APR_HASH_KEY_STRING;
+	apr_uint32_t hash = apr_hashfunc_default(result,&length);
+	if(hash == partial->hash) {
+		return FALSE;
+	}
+	partial->hash = hash;
+	return TRUE;
+}
+
+/** Check whether the text of result by the quoted key is empty (decoder worker context) */
+static apt_bool_t vosk_recog_result_empty(const char *result, const char *key)
+{
+	const char *value = result ? strstr(result,key) : NULL;
+	if(!value) {
+		return TRUE;
+	}
+	/* the opening quote of the value follows the key */
+	value = strchr(value + strlen(key),'"');
+	return (!value || value[1] == '"') ? TRUE : FALSE;
+}
+
+/** Check whether partial result has no text yet (decoder worker context) */
+static apt_bool_t vosk_recog_partial_empty(const char *result)
+{
+	return vosk_recog_result_empty(result,"\"partial\"");
+}
+
+/** Record the real-time factor of decoding a chunk of audio */
+static APR_INLINE void vosk_recog_rtf_record(vosk_recog_channel_t *recog_channel, apr_time_t decode_time, apr_size_t length)
+{
+	apt_histogram_t *histogram = recog_channel->channel->engine->rtf_histogram;
+	apr_uint64_t audio_time = (apr_uint64_t)length * 1000000 / (recog_channel->sample_rate * recog_channel->sample_size);
+	vosk_recog_worker_busy_record(recog_channel->job_worker,apr_time_now(),decode_time);
+	if(audio_time) {
+		apr_uint32_t rtf = (apr_uint32_t)((apr_uint64_t)decode_time * 1000 / audio_time);
+		if(histogram) {
+			apt_histogram_record(histogram,rtf);
+		}
+		/* smoothed over the last several chunks */
+		recog_channel->rtf_avg = (recog_channel->rtf_avg * 7 + rtf) / 8;
+	}
+}
+
+/** Apply the decoding settings of the request by the state of degradation (decoder worker context) */
+static void vosk_recog_degrade_apply(vosk_recog_channel_t *recog_channel)
+{
+	apr_size_t threshold = recog_channel->kaldi_engine->chunk_time * recog_channel->sample_rate / 1000 * recog_channel->sample_size;
+	if(recog_channel->degraded == TRUE) {
+		/* fewer, larger chunks cut the overhead per call, as far as the buffer fits */
+		threshold *= 2;
+		if(threshold > recog_channel->chunk_capacity) {
+			threshold = recog_channel->chunk_capacity;
+		}
+	}
+	recog_channel->chunk_threshold = threshold;
+	if(recog_channel->recognizer) {
+		vosk_recog_recognizer_options_apply(recog_channel,recog_channel->recognizer,recog_channel->degraded);
+	}
+	if(recog_channel->peer_recognizer) {
+		vosk_recog_recognizer_options_apply(recog_channel,recog_channel->peer_recognizer,recog_channel->degraded);
+	}
+}
+
+/** Switch the channel to cheaper decoding settings or back (decoder worker context) */
+static void vosk_recog_degrade_set(vosk_recog_channel_t *recog_channel, apt_bool_t degraded)
+{
+	mrcp_engine_t *engine = recog_channel->channel->engine;
+	recog_channel->degraded = degraded;
+	if(degraded == TRUE) {
+		apr_atomic_inc32(&engine->degraded_channel_count);
+		apr_atomic_inc32(&engine->degradation_count);
+	}
+	else {
+		apr_atomic_dec32(&engine->degraded_channel_count);
+	}
+	vosk_recog_degrade_apply(recog_channel);
+}
+
+/** Degrade decoding of the channel once it or its worker falls behind real time, recover once both catch up (decoder worker context) */
+static void vosk_recog_degrade_check(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apr_uint32_t threshold = recog_channel->kaldi_engine->degrade_rtf;
+	apr_size_t backlog = mpf_audio_queue_occupancy_get(recog_channel->frame_queue);
+	apr_uint32_t load = vosk_recog_worker_load_get(recog_channel->worker);
+	if(recog_channel->degraded == FALSE) {
+		if(recog_channel->rtf_avg >= threshold || load >= threshold ||
+			backlog >= recog_channel->kaldi_engine->degrade_backlog) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Degrade Decoding rtf [%u] worker load [%u] backlog [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+				recog_channel->rtf_avg, load, backlog, MRCP_MESSAGE_SIDRES(request));
+			vosk_recog_degrade_set(recog_channel,TRUE);
+		}
+	}
+	else if(recog_channel->rtf_avg < threshold * 3 / 4 && load < threshold * 3 / 4 &&
+		backlog < recog_channel->kaldi_engine->degrade_backlog / 4) {
+		/* the margin keeps the channel from flapping around the threshold */
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Recover Decoding rtf [%u] worker load [%u] backlog [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+			recog_channel->rtf_avg, load, backlog, MRCP_MESSAGE_SIDRES(request));
+		vosk_recog_degrade_set(recog_channel,FALSE);
+	}
+}
+
+/** Complete the request if a keyword is spotted in the final result of an utterance, otherwise listen on (decoder worker context) */
+static apt_bool_t vosk_recog_hotword_spot(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result)
+{
+	if(result && vosk_recog_grammar_match(recog_channel->active_grammar,result)) {
+		/* the result is taken off the recognizer already */
+		recog_channel->taken_result = result;
+		vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
+		return TRUE;
+	}
+	/* out-of-grammar speech is not reported, the recognizer goes on with the next utterance */
+	vosk_recog_partial_reset(&recog_channel->early_partial);
+	vosk_recog_partial_reset(&recog_channel->interim_partial);
+	return FALSE;
+}
+
+/** Tag the result of a channel of stereo audio by its speaker channel (1-based) */
+static void vosk_recog_speaker_channel_tag(vosk_recog_channel_t *recog_channel, mrcp_message_t *message, apr_size_t index)
+{
+	mrcp_generic_header_t *generic_header;
+	if(recog_channel->channel_count < 2) {
+		return;
+	}
+	generic_header = mrcp_generic_header_prepare(message);
+	if(!generic_header) {
+		return;
+	}
+	if(!generic_header->vendor_specific_params) {
+		generic_header->vendor_specific_params = apt_pair_array_create(1,message->pool);
+	}
+	vosk_recog_vendor_param_add(generic_header->vendor_specific_params,"speaker-channel",
+		apr_psprintf(message->pool,"%"APR_SIZE_T_FMT,index),message->pool);
+	mrcp_generic_header_property_add(message,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS);
+}
+
+/** Send the result of a segment of continuous transcription, unless it is empty (decoder worker context) */
+static void vosk_recog_segment_event_send(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result, apr_size_t start, apr_size_t index)
+{
+	if(vosk_recog_result_empty(result,"\"text\"") == FALSE) {
+		mrcp_message_t *message = vosk_recog_intermediate_create(request,result);
+		recog_channel->segment_count++;
+		if(message) {
+			mrcp_generic_header_t *generic_header = mrcp_generic_header_get(message);
+			apt_pair_arr_t *params = apt_pair_array_create(4,message->pool);
+			vosk_recog_vendor_param_add(params,"segment",
+				apr_psprintf(message->pool,"%"APR_SIZE_T_FMT,recog_channel->segment_count),message->pool);
+			vosk_recog_vendor_param_add(params,"segment-start",
+				apr_psprintf(message->pool,"%"APR_SIZE_T_FMT,recog_channel->input_offset + start),message->pool);
+			vosk_recog_vendor_param_add(params,"segment-end",
+				apr_psprintf(message->pool,"%"APR_SIZE_T_FMT,recog_channel->input_offset + recog_channel->input_elapsed),message->pool);
+			if(generic_header) {
+				generic_header->vendor_specific_params = params;
+				mrcp_generic_header_property_add(message,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS);
+			}
+			vosk_recog_speaker_channel_tag(recog_channel,message,index);
+			mrcp_engine_channel_message_send(recog_channel->channel,message);
+		}
+	}
+}
+
+/** Take the checkpoint requested as reached, the state of the decoder is all reset at the boundary of segments (decoder worker context) */
+static void vosk_recog_checkpoint_reach(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	if(apr_atomic_cas32(&recog_channel->checkpoint_state,VOSK_RECOG_CHECKPOINT_REACHED,VOSK_RECOG_CHECKPOINT_PENDING) != VOSK_RECOG_CHECKPOINT_PENDING) {
+		return;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Checkpoint Reached [%"APR_SIZE_T_FMT" segments] [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+		recog_channel->segment_count,
+		recog_channel->input_offset + recog_channel->input_elapsed,
+		MRCP_MESSAGE_SIDRES(request));
+}
+
+/**
+ * Check the checkpoint of continuous transcription (decoder worker context).
+ * @return TRUE if the checkpoint is reached, the input past it is not decoded then
+ */
+static apt_bool_t vosk_recog_checkpoint_check(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apr_uint32_t state = apr_atomic_read32(&recog_channel->checkpoint_state);
+	if(state == VOSK_RECOG_CHECKPOINT_PENDING && !recog_channel->segment_elapsed && !recog_channel->chunk_length) {
+		/* no segment is in progress, the checkpoint is right here */
+		vosk_recog_checkpoint_reach(recog_channel,request);
+		return TRUE;
+	}
+	return state == VOSK_RECOG_CHECKPOINT_REACHED ? TRUE : FALSE;
+}
+
+/** Check whether the segment in progress is to be cut, as the checkpoint requested is not reached in time (decoder worker context) */
+static apt_bool_t vosk_recog_checkpoint_due(vosk_recog_channel_t *recog_channel, apr_size_t elapsed)
+{
+	if(apr_atomic_read32(&recog_channel->checkpoint_state) != VOSK_RECOG_CHECKPOINT_PENDING) {
+		return FALSE;
+	}
+	recog_channel->checkpoint_elapsed += elapsed;
+	return recog_channel->checkpoint_elapsed >= recog_channel->kaldi_engine->checkpoint_timeout ? TRUE : FALSE;
+}
+
+/**
+ * Send the finalized segment of continuous transcription as intermediate result (decoder worker context).
+ * Nothing of the segment is kept, the decoder starts the next one anew, so that the memory of the channel
+ * does not grow with the length of the input.
+ */
+static void vosk_recog_segment_send(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result)
+{
+	vosk_recog_segment_event_send(recog_channel,request,result,recog_channel->segment_start,1);
+	/* the result is copied into the event, the lattice of the segment is dropped */
+	vosk_recognizer_reset(recog_channel->recognizer);
+	vosk_recog_partial_reset(&recog_channel->early_partial);
+	vosk_recog_partial_reset(&recog_channel->interim_partial);
+	vosk_recog_partial_reset(&recog_channel->stable_partial);
+	recog_channel->segment_start = recog_channel->input_elapsed;
+	recog_channel->segment_elapsed = 0;
+	vosk_recog_checkpoint_reach(recog_channel,request);
+}
+
+/** Send the segment of the second channel of stereo audio and start the next one (decoder worker context) */
+static void vosk_recog_peer_segment_send(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, const char *result)
+{
+	vosk_recog_segment_event_send(recog_channel,request,result,recog_channel->peer_segment_start,2);
+	vosk_recognizer_reset(recog_channel->peer_recognizer);
+	recog_channel->peer_segment_start = recog_channel->input_elapsed;
+}
+
+/**
+ * Decode the second channel of a stereo chunk (decoder worker context).
+ * The endpoints of the second channel cut its segments in continuous transcription, otherwise
+ * its last utterance is kept for the result, the request is completed by the first channel.
+ */
+static void vosk_recog_peer_decode(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, apr_size_t size)
+{
+	int ret;
+	if(recog_channel->g711_table) {
+		vosk_recog_g711_expand(recog_channel->g711_table,recog_channel->split_buffer,size,recog_channel->chunk_samples);
+		ret = vosk_recognizer_accept_waveform_f(recog_channel->peer_recognizer,recog_channel->chunk_samples,(int)size);
+	}
+	else {
+		ret = vosk_recognizer_accept_waveform(recog_channel->peer_recognizer,recog_channel->split_buffer,(int)size);
+	}
+	if(!ret) {
+		return;
+	}
+	if(recog_channel->continuous == TRUE) {
+		vosk_recog_peer_segment_send(recog_channel,request,vosk_recognizer_result(recog_channel->peer_recognizer));
+		return;
+	}
+	{
+		const char *result = vosk_recognizer_result(recog_channel->peer_recognizer);
+		if(vosk_recog_result_empty(result,"\"text\"") == FALSE) {
+			recog_channel->peer_result = apr_pstrdup(request->pool,result);
+		}
+	}
+}
+
+/**
+ * Send the result of the second channel of stereo audio ahead of RECOGNITION-COMPLETE,
+ * which carries the result of the first channel (decoder worker context).
+ */
+static void vosk_recog_peer_complete(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	mrcp_message_t *message;
+	const char *result = vosk_recognizer_final_result(recog_channel->peer_recognizer);
+	if(vosk_recog_result_empty(result,"\"text\"") == TRUE && recog_channel->peer_result) {
+		/* the utterance of the second channel ended before the one of the first channel */
+		result = recog_channel->peer_result;
+	}
+	message = vosk_recog_intermediate_create(request,result);
+	if(!message) {
+		return;
+	}
+	vosk_recog_speaker_channel_tag(recog_channel,message,2);
+	mrcp_engine_channel_message_send(recog_channel->channel,message);
+}
+
+/** Finalize the hypothesis ahead of the endpoint of the decoder and complete the request (decoder worker context) */
+static void vosk_recog_endpoint_finalize(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Finalize Hypothesis after [%"APR_SIZE_T_FMT" ms] of Silence " APT_SIDRES_FMT,
+		recog_channel->endpoint_silence,
+		MRCP_MESSAGE_SIDRES(request));
+	recog_channel->taken_result = vosk_recognizer_final_result(recog_channel->recognizer);
+	vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
+}
+
+/**
+ * Check the hypothesis for the combined endpointer (decoder worker context).
+ * Over silence, the hypothesis is finalized once it stays unchanged for the stable time;
+ * on inactivity detected, at once unless the decoder is still revising it.
+ */
+static apt_bool_t vosk_recog_endpoint_check(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, apr_size_t elapsed, apt_bool_t inactive)
+{
+	const char *result = vosk_recognizer_partial_result(recog_channel->recognizer);
+	apt_bool_t changed = vosk_recog_partial_changed(&recog_channel->stable_partial,result);
+	apt_bool_t empty = vosk_recog_partial_empty(result);
+	if(changed == TRUE) {
+		recog_channel->stable_partial.elapsed = 0;
+	}
+	else {
+		recog_channel->stable_partial.elapsed += elapsed;
+	}
+
+	if(inactive == TRUE) {
+		if(changed == TRUE && empty == FALSE) {
+			return FALSE;
+		}
+	}
+	else if(empty == TRUE || recog_channel->stable_partial.elapsed < recog_channel->kaldi_engine->endpoint_stable_time) {
+		return FALSE;
+	}
+	vosk_recog_endpoint_finalize(recog_channel,request);
+	return TRUE;
+}
+
+/** Pass the speech held back for language identification to a recognizer, chunk by chunk (decoder worker context) */
+static void vosk_recog_language_decode(vosk_recog_channel_t *recog_channel, VoskRecognizer *recognizer)
+{
+	apr_size_t offset;
+	apr_size_t length;
+	for(offset = 0; offset < recog_channel->lid_length; offset += length) {
+		length = recog_channel->lid_length - offset;
+		if(length > recog_channel->chunk_threshold) {
+			length = recog_channel->chunk_threshold;
+		}
+		if(recog_channel->g711_table) {
+			vosk_recog_g711_expand(recog_channel->g711_table,recog_channel->lid_buffer + offset,length,recog_channel->chunk_samples);
+			vosk_recognizer_accept_waveform_f(recognizer,recog_channel->chunk_samples,(int)length);
+		}
+		else {
+			vosk_recognizer_accept_waveform(recognizer,recog_channel->lid_buffer + offset,(int)length);
+		}
+	}
+}
+
+/** Switch the request to the model identified, keep the current one if it cannot be taken (decoder worker context) */
+static void vosk_recog_language_switch(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, vosk_recog_model_t *model)
+{
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	vosk_recog_model_t *version;
+	VoskRecognizer *recognizer = NULL;
+	if(vosk_recog_model_seat_take(model) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Seat Free of Model [%s] capacity [%u], Keep Model [%s] " APT_SIDRES_FMT,
+			model->name, model->capacity, recog_channel->model->name, MRCP_MESSAGE_SIDRES(request));
+		return;
+	}
+	version = vosk_recog_model_acquire(kaldi_engine->models,model);
+	if(version->model) {
+		version = vosk_recog_model_replica_get(version,vosk_recog_worker_numa_node_get(recog_channel->worker));
+		recognizer = vosk_recog_pool_acquire(kaldi_engine->recog_pool,version,recog_channel->sample_rate,recog_channel->phrases);
+	}
+	if(!recognizer) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Acquire Recognizer of Model [%s], Keep Model [%s] " APT_SIDRES_FMT,
+			model->name, recog_channel->model->name, MRCP_MESSAGE_SIDRES(request));
+		vosk_recog_model_release(kaldi_engine->models,version);
+		vosk_recog_model_seat_return(model);
+		return;
+	}
+
+	/* the memory charged for the recognizer of the model selected first stands for the one switched to */
+	vosk_recog_pool_release(
+		kaldi_engine->recog_pool,
+		recog_channel->model,
+		recog_channel->sample_rate,
+		recog_channel->phrases,
+		recog_channel->recognizer);
+	vosk_recog_channel_model_release(recog_channel);
+	recog_channel->recognizer = recognizer;
+	recog_channel->model = version;
+	recog_channel->model_seat = model;
+	vosk_recog_recognizer_options_apply(recog_channel,recognizer,recog_channel->degraded);
+	if(recog_channel->rescore == TRUE && strcmp(model->name,kaldi_engine->rescore_model->name) == 0) {
+		recog_channel->rescore = FALSE;
+	}
+}
+
+/**
+ * Identify the language of the speech held back, and switch the request to the model of it (decoder worker context).
+ * The speech is decoded once by the model of each candidate language, the one the words of which are the most
+ * confident wins. Only the held speech is decoded more than once, the rest is decoded by a single recognizer.
+ */
+static void vosk_recog_language_identify(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	int numa_node = vosk_recog_worker_numa_node_get(recog_channel->worker);
+	vosk_recog_model_t *best = NULL;
+	double best_confidence = 0;
+	apr_time_t identify_start = apr_time_now();
+	int i;
+
+	for(i=0; i<recog_channel->lid_models->nelts; i++) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(recog_channel->lid_models,i,vosk_recog_model_t*);
+		vosk_recog_model_t *version = vosk_recog_model_acquire(kaldi_engine->models,model);
+		VoskRecognizer *recognizer = NULL;
+		double confidence;
+		if(version->model) {
+			version = vosk_recog_model_replica_get(version,numa_node);
+			recognizer = vosk_recog_pool_acquire(kaldi_engine->recog_pool,version,recog_channel->sample_rate,NULL);
+		}
+		if(recognizer) {
+			/* the confidence of the hypothesis is computed from word confidences */
+			vosk_recognizer_set_max_alternatives(recognizer,0);
+			vosk_recognizer_set_words(recognizer,1);
+			vosk_recog_language_decode(recog_channel,recognizer);
+			if(vosk_recog_nlsml_confidence_get(vosk_recognizer_final_result(recognizer),&confidence) == TRUE) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Score Language by Model [%s] confidence [%.2f] " APT_SIDRES_FMT,
+					model->name, confidence, MRCP_MESSAGE_SIDRES(request));
+				if(!best || confidence > best_confidence) {
+					best = model;
+					best_confidence = confidence;
+				}
+			}
+			vosk_recog_pool_release(kaldi_engine->recog_pool,version,recog_channel->sample_rate,NULL,recognizer);
+		}
+		vosk_recog_model_release(kaldi_engine->models,version);
+	}
+
+	if(!best) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Language Not Identified, Keep Model [%s] " APT_SIDRES_FMT,
+			recog_channel->model->name, MRCP_MESSAGE_SIDRES(request));
+		return;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Identify Language by Model [%s] confidence [%.2f] of [%d] in [%"APR_TIME_T_FMT" ms] " APT_SIDRES_FMT,
+		best->name,
+		best_confidence,
+		recog_channel->lid_models->nelts,
+		apr_time_as_msec(apr_time_now() - identify_start),
+		MRCP_MESSAGE_SIDRES(request));
+	if(strcmp(best->name,recog_channel->model->name) != 0) {
+		vosk_recog_language_switch(recog_channel,request,best);
+	}
+}
+
+/** Hold back accumulated speech till its language is identified (decoder worker context) */
+static void vosk_recog_language_hold(vosk_recog_channel_t *recog_channel, apr_size_t length)
+{
+	if(length > recog_channel->lid_capacity - recog_channel->lid_length) {
+		length = recog_channel->lid_capacity - recog_channel->lid_length;
+	}
+	memcpy(recog_channel->lid_buffer + recog_channel->lid_length,recog_channel->chunk_buffer,length);
+	recog_channel->lid_length += length;
+}
+
+static apt_bool_t vosk_recog_language_settle(vosk_recog_channel_t *recog_channel, mrcp_message_t *request);
+
+/** Pass accumulated audio to the recognizer (decoder worker context) */
+static apt_bool_t vosk_recog_chunk_flush(vosk_recog_channel_t *recog_channel)
+{
+	mrcp_message_t *request = recog_channel->decode_request;
+	apr_size_t length = recog_channel->chunk_length;
+	apr_size_t size = length;
+	apr_size_t elapsed;
+	apt_bool_t completed = FALSE;
+	apt_bool_t interim_due = FALSE;
+	apt_bool_t early_due = FALSE;
+	const char *result;
+	apr_time_t decode_start;
+	int ret;
+
+	recog_channel->chunk_length = 0;
+	if(!length) {
+		return FALSE;
+	}
+	if(recog_channel->lid_models) {
+		vosk_recog_language_hold(recog_channel,length);
+		if(recog_channel->lid_length < recog_channel->lid_threshold) {
+			return FALSE;
+		}
+		return vosk_recog_language_settle(recog_channel,request);
+	}
+	if(recog_channel->channel_count > 1) {
+		/* the first channel stays in the chunk, the second one moves to the split buffer */
+		size = vosk_recog_stereo_split(
+					recog_channel->chunk_buffer,
+					length,
+					recog_channel->sample_size / recog_channel->channel_count,
+					recog_channel->split_buffer);
+	}
+	if(recog_channel->batch_stream) {
+		/* decoded by the collector, the result is signaled back to the worker */
+		vosk_recog_batch_stream_write(recog_channel->batch_stream,recog_channel->chunk_buffer,size);
+		return FALSE;
+	}
+	if(recog_channel->remote_stream) {
+		/* decoded by a remote decoder, the result is signaled back to the worker */
+		vosk_recog_remote_stream_write(recog_channel->remote_stream,recog_channel->chunk_buffer,size);
+		return FALSE;
+	}
+	if(!recog_channel->recognizer) {
+		return FALSE;
+	}
+
+	if(recog_channel->rescore == TRUE) {
+		vosk_recog_rescore_keep(recog_channel,recog_channel->chunk_buffer,length);
+	}
+	decode_start = apr_time_now();
+	APT_PROBE2(vosk_decode_start,recog_channel->channel->id.buf,length);
+	if(recog_channel->g711_table) {
+		/* a single pass from the codes to the samples of the decoder */
+		vosk_recog_g711_expand(recog_channel->g711_table,recog_channel->chunk_buffer,size,recog_channel->chunk_samples);
+		ret = vosk_recognizer_accept_waveform_f(recog_channel->recognizer, recog_channel->chunk_samples, (int)size);
+	}
+	else {
+		ret = vosk_recognizer_accept_waveform(recog_channel->recognizer, recog_channel->chunk_buffer, (int)size);
+	}
+	if(recog_channel->peer_recognizer) {
+		vosk_recog_peer_decode(recog_channel,request,size);
+	}
+	APT_PROBE3(vosk_decode_end,recog_channel->channel->id.buf,length,ret);
+	vosk_recog_rtf_record(recog_channel,apr_time_now() - decode_start,length);
+	if(recog_channel->kaldi_engine->degrade_rtf) {
+		vosk_recog_degrade_check(recog_channel,request);
+	}
+	if (ret) {
+		if(recog_channel->hotword == TRUE) {
+			return vosk_recog_hotword_spot(recog_channel,request,vosk_recognizer_result(recog_channel->recognizer));
+		}
+		if(recog_channel->continuous == TRUE) {
+			/* the endpoint of the decoder cuts the segment, the request goes on */
+			vosk_recog_segment_send(recog_channel,request,vosk_recognizer_result(recog_channel->recognizer));
+			return FALSE;
+		}
+		vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
+		return TRUE;
+	}
+
+	elapsed = length * 1000 / (recog_channel->sample_rate * recog_channel->sample_size);
+	if(recog_channel->continuous == TRUE) {
+		apr_size_t segment_time = recog_channel->kaldi_engine->segment_time;
+		recog_channel->segment_elapsed += elapsed;
+		if((segment_time && recog_channel->segment_elapsed >= segment_time) || vosk_recog_checkpoint_due(recog_channel,elapsed) == TRUE) {
+			/* the speech does not pause, the segment is cut by time */
+			vosk_recog_segment_send(recog_channel,request,vosk_recognizer_final_result(recog_channel->recognizer));
+			return FALSE;
+		}
+	}
+	if(recog_channel->degraded == TRUE) {
+		/* partial results are not evaluated while decoding is behind */
+		return FALSE;
+	}
+	if(recog_channel->endpoint_combined == TRUE && recog_channel->endpoint_silence) {
+		if(vosk_recog_endpoint_check(recog_channel,request,elapsed,FALSE) == TRUE) {
+			return TRUE;
+		}
+	}
+	if(recog_channel->interim_interval) {
+		interim_due = vosk_recog_partial_due(&recog_channel->interim_partial,recog_channel->interim_interval,elapsed);
+	}
+	if(recog_channel->active_grammar && recog_channel->continuous == FALSE) {
+		early_due = vosk_recog_partial_due(&recog_channel->early_partial,recog_channel->kaldi_engine->partial_interval,elapsed);
+	}
+	if(interim_due == FALSE && early_due == FALSE) {
+		return FALSE;
+	}
+
+	/* the partial result is serialized once for both purposes */
+	result = vosk_recognizer_partial_result(recog_channel->recognizer);
+	if(interim_due == TRUE && vosk_recog_partial_changed(&recog_channel->interim_partial,result) == TRUE) {
+		vosk_recog_intermediate_result(recog_channel,request,result);
+	}
+	if(early_due == TRUE) {
+		const char *early = NULL;
+		/* the same partial text can not match differently */
+		if(vosk_recog_partial_changed(&recog_channel->early_partial,result) == TRUE) {
+			early = vosk_recog_grammar_match(recog_channel->active_grammar, result);
+		}
+		if(early) {
+			/* the id of the matched rule is reported by <earlyres> of the result */
+			vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,early);
+			completed = TRUE;
+		}
+	}
+	return completed;
+}
+
+/**
+ * Identify the language of the speech held back so far, if it is yet to be identified, and replay the speech
+ * to the recognizer of the request, the way the audio kept ahead of a request is (decoder worker context).
+ * @return TRUE if the request is completed by the speech replayed
+ */
+static apt_bool_t vosk_recog_language_settle(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apr_size_t offset;
+	apr_size_t length;
+	if(!recog_channel->lid_models) {
+		return FALSE;
+	}
+	if(recog_channel->chunk_length) {
+		vosk_recog_language_hold(recog_channel,recog_channel->chunk_length);
+		recog_channel->chunk_length = 0;
+	}
+	if(recog_channel->lid_length) {
+		vosk_recog_language_identify(recog_channel,request);
+	}
+	recog_channel->lid_models = NULL;
+	for(offset = 0; offset < recog_channel->lid_length; offset += length) {
+		length = recog_channel->lid_length - offset;
+		if(length > recog_channel->chunk_threshold) {
+			length = recog_channel->chunk_threshold;
+		}
+		memcpy(recog_channel->chunk_buffer,recog_channel->lid_buffer + offset,length);
+		recog_channel->chunk_length = length;
+		if(vosk_recog_chunk_flush(recog_channel) == TRUE) {
+			recog_channel->lid_length = 0;
+			return TRUE;
+		}
+	}
+	recog_channel->lid_length = 0;
+	return FALSE;
+}
+
+/** Accumulate audio and pass it to the recognizer once the chunk is full (decoder worker context) */
+static apt_bool_t vosk_recog_chunk_append(vosk_recog_channel_t *recog_channel, const char *buffer, apr_size_t size)
+{
+	if(size > recog_channel->chunk_capacity - recog_channel->chunk_length) {
+		/* the chunk size is not a multiple of the frame size */
+		if(vosk_recog_chunk_flush(recog_channel) == TRUE) {
+			return TRUE;
+		}
+	}
+	memcpy(recog_channel->chunk_buffer + recog_channel->chunk_length,buffer,size);
+	recog_channel->chunk_length += size;
+	if(recog_channel->chunk_length >= recog_channel->chunk_threshold) {
+		return vosk_recog_chunk_flush(recog_channel);
+	}
+	return FALSE;
+}
+
+/** Remove the oldest held audio from the gate, pass it to the recognizer if requested (decoder worker context) */
+static apt_bool_t vosk_recog_gate_consume(vosk_recog_channel_t *recog_channel, apr_size_t size, apt_bool_t decode)
+{
+	while(size) {
+		/* held audio may wrap around the end of the ring */
+		apr_size_t length = recog_channel->gate_capacity - recog_channel->gate_offset;
+		if(length > size) {
+			length = size;
+		}
+		if(decode == TRUE) {
+			if(vosk_recog_chunk_append(recog_channel,recog_channel->gate_buffer + recog_channel->gate_offset,length) == TRUE) {
+				recog_channel->gate_offset = 0;
+				recog_channel->gate_length = 0;
+				return TRUE;
+			}
+		}
+		recog_channel->gate_offset = (recog_channel->gate_offset + length) % recog_channel->gate_capacity;
+		recog_channel->gate_length -= length;
+		size -= length;
+	}
+	return FALSE;
+}
+
+/**
+ * Hold audio back from the recognizer (decoder worker context).
+ * @param spill whether audio not fitting the gate is passed to the recognizer rather than dropped
+ */
+static apt_bool_t vosk_recog_gate_hold(vosk_recog_channel_t *recog_channel, const char *buffer, apr_size_t size, apt_bool_t spill)
+{
+	apr_size_t tail;
+	apr_size_t length;
+	if(size > recog_channel->gate_threshold) {
+		/* the pre-roll is shorter than a frame */
+		if(vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,spill) == TRUE) {
+			return TRUE;
+		}
+		return spill == TRUE ? vosk_recog_chunk_append(recog_channel,buffer,size) : FALSE;
+	}
+	if(recog_channel->gate_length + size > recog_channel->gate_threshold) {
+		if(vosk_recog_gate_consume(recog_channel,recog_channel->gate_length + size - recog_channel->gate_threshold,spill) == TRUE) {
+			return TRUE;
+		}
+	}
+
+	tail = (recog_channel->gate_offset + recog_channel->gate_length) % recog_channel->gate_capacity;
+	length = recog_channel->gate_capacity - tail;
+	if(length > size) {
+		length = size;
+	}
+	memcpy(recog_channel->gate_buffer + tail,buffer,length);
+	memcpy(recog_channel->gate_buffer,buffer + length,size - length);
+	recog_channel->gate_length += size;
+	return FALSE;
+}
+
+/** Pass audio frame to the recognizer through the activity gate (decoder worker context) */
+static apt_bool_t vosk_recog_gate_pass(vosk_recog_channel_t *recog_channel, const vosk_recog_frame_t *item)
+{
+	if(!recog_channel->gate_capacity) {
+		return vosk_recog_chunk_append(recog_channel,item->data,item->size);
+	}
+
+	if(recog_channel->gate_open == FALSE) {
+		if(item->det_event != MPF_DETECTOR_EVENT_ACTIVITY) {
+			/* leading silence, keep the pre-roll only */
+			return vosk_recog_gate_hold(recog_channel,item->data,item->size,FALSE);
+		}
+		recog_channel->gate_open = TRUE;
+	}
+	else if(item->voice == FALSE && recog_channel->endpoint_combined == FALSE) {
+		/* possibly trailing silence, held back till voice resumes (the combined endpointer decodes it) */
+		return vosk_recog_gate_hold(recog_channel,item->data,item->size,TRUE);
+	}
+
+	/* voice, pass the held audio and the frame itself */
+	if(vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,TRUE) == TRUE) {
+		return TRUE;
+	}
+	return vosk_recog_chunk_append(recog_channel,item->data,item->size);
+}
+
+/** Complete the request whose input outlasts the recognition timeout, by the speech decoded so far (decoder worker context) */
+static void vosk_recog_recognition_expire(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Recognition Timeout Expired [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+		recog_channel->recognition_timeout,
+		MRCP_MESSAGE_SIDRES(request));
+	recog_channel->recognition_expired = TRUE;
+	/* the speech held back and accumulated is decoded, the rest of the input is not */
+	if(vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,TRUE) == TRUE ||
+		vosk_recog_chunk_flush(recog_channel) == TRUE) {
+		return;
+	}
+	if(recog_channel->batch_stream) {
+		/* the request is completed once the final result is signaled */
+		vosk_recog_batch_stream_finish(recog_channel->batch_stream);
+		return;
+	}
+	if(recog_channel->remote_stream) {
+		vosk_recog_remote_stream_finish(recog_channel->remote_stream);
+		return;
+	}
+	vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_RECOGNITION_TIMEOUT,NULL);
+}
+
+/** Keep voiced speech of the caller for the next call, as long as it fits (decoder worker context) */
+static void vosk_recog_adapt_keep(vosk_recog_channel_t *recog_channel, const vosk_recog_frame_t *item)
+{
+	apr_size_t max_length = recog_channel->kaldi_engine->adapt_time * recog_channel->sample_rate / 1000 * BYTES_PER_SAMPLE;
+	apr_size_t size = item->size / recog_channel->sample_size * BYTES_PER_SAMPLE;
+	if(max_length > recog_channel->adapt_capacity) {
+		max_length = recog_channel->adapt_capacity;
+	}
+	if(recog_channel->adapt_length + size > max_length) {
+		return;
+	}
+	if(recog_channel->g711_table) {
+		vosk_recog_g711_linear_expand(
+			recog_channel->g711_table,
+			item->data,
+			item->size,
+			(apr_int16_t*)(recog_channel->adapt_buffer + recog_channel->adapt_length));
+	}
+	else {
+		memcpy(recog_channel->adapt_buffer + recog_channel->adapt_length,item->data,size);
+	}
+	recog_channel->adapt_length += size;
+}
+
+/**
+ * Pass the speech stored for the caller to the recognizer ahead of the live audio, then reset it,
+ * so that its online feature statistics (CMVN, i-vector) start from those of the caller (decoder worker context).
+ */
+static void vosk_recog_adapt_prime(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
+{
+	apr_size_t size;
+	apr_size_t offset;
+	apr_size_t length;
+	apr_time_t prime_start;
+	if(recog_channel->adapt_sample_rate != recog_channel->sample_rate) {
+		/* the speech kept so far is not of the rate of the request */
+		recog_channel->adapt_length = 0;
+		recog_channel->adapt_sample_rate = recog_channel->sample_rate;
+	}
+	if(recog_channel->adapt_pending == FALSE) {
+		return;
+	}
+	recog_channel->adapt_pending = FALSE;
+	if(!recog_channel->recognizer) {
+		return;
+	}
+
+	/* the buffer is only read through here, the speech of this call is kept from scratch afterwards */
+	size = vosk_recog_adapt_store_get(
+				recog_channel->kaldi_engine->adapt_store,
+				recog_channel->caller_id,
+				recog_channel->sample_rate,
+				recog_channel->adapt_buffer,
+				recog_channel->adapt_capacity);
+	recog_channel->adapt_length = 0;
+	if(!size) {
+		return;
+	}
+	prime_start = apr_time_now();
+	for(offset = 0; offset < size; offset += length) {
+		length = size - offset;
+		if(length > recog_channel->chunk_capacity) {
+			length = recog_channel->chunk_capacity;
+		}
+		vosk_recognizer_accept_waveform(recog_channel->recognizer,recog_channel->adapt_buffer + offset,(int)length);
+	}
+	/* the hypothesis of the stored speech is dropped, the statistics are not */
+	vosk_recognizer_reset(recog_channel->recognizer);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Primed by Speech of Caller [%s] [%"APR_SIZE_T_FMT" ms] in [%"APR_TIME_T_FMT" ms] " APT_SIDRES_FMT,
+		recog_channel->caller_id,
+		size * 1000 / (recog_channel->sample_rate * BYTES_PER_SAMPLE),
+		apr_time_as_msec(apr_time_now() - prime_start),
+		MRCP_MESSAGE_SIDRES(request));
+}
+
+/** Frame of silence written to dumps for the frames which carry no audio */
+static const char vosk_recog_silence_frame[VOSK_RECOG_MAX_FRAME_SIZE] = {0};
+
+/**
+ * Take a frame time of silence signaled by comfort noise, the recognizer is not run over absent audio (decoder worker context).
+ * The hypothesis does not change over it, the combined endpointer finalizes the hypothesis once the speech before is decoded.
+ * @return TRUE if the request is completed
+ */
+static apt_bool_t vosk_recog_silence_pass(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, apr_size_t duration)
+{
+	if(recog_channel->endpoint_combined == FALSE) {
+		/* the voice activity detector times the silence on its own */
+		return FALSE;
+	}
+	if(vosk_recog_chunk_flush(recog_channel) == TRUE) {
+		return TRUE;
+	}
+	return vosk_recog_endpoint_check(recog_channel,request,duration,FALSE);
 }
 
-/** Callback is called from MPF engine context to perform any action before open */
-static apt_bool_t vosk_recog_stream_open(mpf_audio_stream_t *stream, mpf_codec_t *codec)
+/** Decode audio frame (decoder worker context) */
+static void vosk_recog_frame_decode(vosk_recog_channel_t *recog_channel, const vosk_recog_frame_t *item)
 {
-	return TRUE;
+	mrcp_message_t *request = recog_channel->decode_request;
+	apr_size_t duration;
+
+	if(recog_channel->recognition_expired == TRUE) {
+		/* the final result of a batch stream is pending, the rest of the input is dropped */
+		return;
+	}
+	if(recog_channel->continuous == TRUE && vosk_recog_checkpoint_check(recog_channel,request) == TRUE) {
+		/* the input past the checkpoint is left to the peer the transcription is resumed on */
+		return;
+	}
+	duration = item->silence == TRUE ? CODEC_FRAME_TIME_BASE : item->size * 1000 / (recog_channel->sample_rate * recog_channel->sample_size);
+	recog_channel->input_elapsed += duration;
+
+	switch(item->det_event) {
+		case MPF_DETECTOR_EVENT_ACTIVITY:
+			if(recog_channel->hotword == FALSE) {
+				/* in hotword mode, input only starts on a keyword hit */
+				vosk_recog_start_of_input(recog_channel,request,FALSE);
+			}
+			break;
+		case MPF_DETECTOR_EVENT_INACTIVITY:
+			if(vosk_recog_language_settle(recog_channel,request) == TRUE) {
+				/* the utterance is shorter than the time its language is identified by */
+				return;
+			}
+			if(recog_channel->endpoint_combined == TRUE) {
+				if(vosk_recog_chunk_flush(recog_channel) == TRUE) {
+					return;
+				}
+				if(recog_channel->degraded == TRUE) {
+					/* the hypothesis is not checked while decoding is behind */
+					vosk_recog_endpoint_finalize(recog_channel,request);
+					return;
+				}
+				if(vosk_recog_endpoint_check(recog_channel,request,0,TRUE) == TRUE) {
+					return;
+				}
+				/* the decoder is still revising the hypothesis, the audio goes on to it */
+				apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Hypothesis Unstable on Inactivity " APT_SIDRES_FMT,
+					MRCP_MESSAGE_SIDRES(request));
+				break;
+			}
+			/* end of speech, drop the trailing silence held back, do not hold back the tail of the utterance */
+			vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,FALSE);
+			if(vosk_recog_chunk_flush(recog_channel) == FALSE) {
+				if(recog_channel->hotword == TRUE) {
+					if(vosk_recog_hotword_spot(recog_channel,request,vosk_recognizer_final_result(recog_channel->recognizer)) == FALSE) {
+						/* hold the audio back again till the next utterance */
+						recog_channel->gate_open = FALSE;
+					}
+				}
+				else if(recog_channel->continuous == TRUE) {
+					/* the pause cuts the segment, the audio is held back again till the next one */
+					vosk_recog_segment_send(recog_channel,request,vosk_recognizer_final_result(recog_channel->recognizer));
+					recog_channel->gate_open = FALSE;
+				}
+				else if(recog_channel->batch_stream) {
+					/* the request is completed once the final result is signaled */
+					vosk_recog_batch_stream_finish(recog_channel->batch_stream);
+				}
+				else if(recog_channel->remote_stream) {
+					vosk_recog_remote_stream_finish(recog_channel->remote_stream);
+				}
+				else {
+					vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
+				}
+			}
+			return;
+		case MPF_DETECTOR_EVENT_NOINPUT:
+			vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,FALSE);
+			recog_channel->chunk_length = 0;
+			vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_NO_INPUT_TIMEOUT,NULL);
+			return;
+		default:
+			break;
+	}
+
+	if(recog_channel->dump) {
+		if(item->silence == TRUE) {
+			/* the dump keeps the timing of the input */
+			vosk_recog_dump_write(recog_channel->dump,vosk_recog_silence_frame,duration * recog_channel->sample_rate / 1000 * BYTES_PER_SAMPLE);
+		}
+		else if(recog_channel->g711_table) {
+			/* dumps are L16 whatever the codec of the session */
+			apr_int16_t linear[VOSK_RECOG_MAX_FRAME_SIZE];
+			vosk_recog_g711_linear_expand(recog_channel->g711_table,item->data,item->size,linear);
+			vosk_recog_dump_write(recog_channel->dump,linear,item->size * sizeof(apr_int16_t));
+		}
+		else {
+			vosk_recog_dump_write(recog_channel->dump,item->data,item->size);
+		}
+	}
+
+	if(recog_channel->adapt_buffer && recog_channel->caller_id[0] != '\0' && item->voice == TRUE) {
+		vosk_recog_adapt_keep(recog_channel,item);
+	}
+
+	if(recog_channel->endpoint_combined == TRUE) {
+		recog_channel->endpoint_silence = item->voice == TRUE ? 0 : recog_channel->endpoint_silence + duration;
+	}
+	if(item->silence == TRUE) {
+		if(vosk_recog_silence_pass(recog_channel,request,duration) == TRUE) {
+			return;
+		}
+	}
+	else if(vosk_recog_gate_pass(recog_channel,item) == TRUE) {
+		return;
+	}
+	if(recog_channel->recognition_timeout && recog_channel->input_started == TRUE) {
+		/* timed by the input itself, so that a channel decoded behind real time is not cut short */
+		recog_channel->recognition_elapsed += duration;
+		if(recog_channel->recognition_elapsed >= recog_channel->recognition_timeout) {
+			vosk_recog_recognition_expire(recog_channel,request);
+		}
+	}
 }
 
-/** Callback is called from MPF engine context to perform any action after close */
-static apt_bool_t vosk_recog_stream_close(mpf_audio_stream_t *stream)
+/** Process DTMF input (decoder worker context) */
+static void vosk_recog_dtmf_input(vosk_recog_channel_t *recog_channel, const vosk_recog_frame_t *item)
 {
-	return TRUE;
+	mrcp_message_t *request = recog_channel->decode_request;
+	if(item->cause == RECOGNIZER_COMPLETION_CAUSE_UNKNOWN) {
+		vosk_recog_start_of_input(recog_channel,request,TRUE);
+		return;
+	}
+
+	/* the decoder is stopped, neither the audio held back nor the audio accumulated is decoded */
+	vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,FALSE);
+	recog_channel->chunk_length = 0;
+	vosk_recog_dtmf_complete(recog_channel,request,item->cause,item->data,item->size);
 }
 
-/* Raise kaldi START-OF-INPUT event */
-static apt_bool_t vosk_recog_start_of_input(vosk_recog_channel_t *recog_channel)
+/** Finalize the last segment of continuous transcription and summarize the transcription by the response to STOP (decoder worker context) */
+static void vosk_recog_continuous_stop(vosk_recog_channel_t *recog_channel, mrcp_message_t *request, mrcp_message_t *response)
 {
-	/* create START-OF-INPUT event */
-	mrcp_message_t *message = mrcp_event_create(
-						recog_channel->recog_request,
-						RECOGNIZER_START_OF_INPUT,
-						recog_channel->recog_request->pool);
-	if(!message) {
-		return FALSE;
+	mrcp_generic_header_t *generic_header;
+	apt_pair_arr_t *params;
+	apr_size_t input_time;
+	/* the silence held back is dropped, the speech accumulated is decoded */
+	vosk_recog_gate_consume(recog_channel,recog_channel->gate_length,FALSE);
+	vosk_recog_language_settle(recog_channel,request);
+	vosk_recog_chunk_flush(recog_channel);
+	if(recog_channel->recognizer) {
+		vosk_recog_segment_send(recog_channel,request,vosk_recognizer_final_result(recog_channel->recognizer));
 	}
+	if(recog_channel->peer_recognizer) {
+		vosk_recog_peer_segment_send(recog_channel,request,vosk_recognizer_final_result(recog_channel->peer_recognizer));
+	}
+	input_time = recog_channel->input_offset + recog_channel->input_elapsed;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Stop Continuous Transcription [%"APR_SIZE_T_FMT" segments] [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+		recog_channel->segment_count,
+		input_time,
+		MRCP_MESSAGE_SIDRES(request));
 
-	/* set request state */
-	message->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
-	/* send asynch event */
-	return mrcp_engine_channel_message_send(recog_channel->channel,message);
+	params = apt_pair_array_create(3,response->pool);
+	vosk_recog_vendor_param_add(params,"segments",
+		apr_psprintf(response->pool,"%"APR_SIZE_T_FMT,recog_channel->segment_count),response->pool);
+	vosk_recog_vendor_param_add(params,"input-time",
+		apr_psprintf(response->pool,"%"APR_SIZE_T_FMT,input_time),response->pool);
+	if(apr_atomic_read32(&recog_channel->checkpoint_state) == VOSK_RECOG_CHECKPOINT_REACHED) {
+		/* passed on by RECOGNIZE with resume-checkpoint to the peer the transcription is resumed on */
+		vosk_recog_vendor_param_add(params,"checkpoint",
+			apr_psprintf(response->pool,"%"APR_SIZE_T_FMT":%"APR_SIZE_T_FMT,recog_channel->segment_count,input_time),response->pool);
+	}
+	generic_header = mrcp_generic_header_prepare(response);
+	if(generic_header) {
+		generic_header->vendor_specific_params = params;
+		mrcp_generic_header_property_add(response,GENERIC_HEADER_VENDOR_SPECIFIC_PARAMS);
+	}
 }
 
-
-/* Raise kaldi RECOGNITION-COMPLETE event */
-static apt_bool_t vosk_recog_recognition_complete(vosk_recog_channel_t *recog_channel, mrcp_recog_completion_cause_e cause, char *early)
+/** Suspend the channel on hold: unpin it from the worker and return the recognizer of a request with no input yet to the pool (decoder worker context) */
+static void vosk_recog_channel_suspend(vosk_recog_channel_t *recog_channel, mrcp_message_t *request)
 {
-	mrcp_recog_header_t *recog_header;
-	/* create RECOGNITION-COMPLETE event */
-	mrcp_message_t *message = mrcp_event_create(
-						recog_channel->recog_request,
-						RECOGNIZER_RECOGNITION_COMPLETE,
-						recog_channel->recog_request->pool);
-	if(!message) {
-		return FALSE;
+	if(recog_channel->suspended == TRUE) {
+		return;
+	}
+	recog_channel->suspended = TRUE;
+	/* new channels are balanced as if this one were gone */
+	vosk_recog_worker_release(recog_channel->worker);
+	if(request && request == recog_channel->decode_request && recog_channel->recognizer &&
+		recog_channel->input_started == FALSE && !recog_channel->rescore_request) {
+		/* the audio accumulated so far is no speech, it is dropped along with the recognizer */
+		recog_channel->chunk_length = 0;
+		vosk_recog_pool_release(
+			recog_channel->kaldi_engine->recog_pool,
+			recog_channel->model,
+			recog_channel->sample_rate,
+			recog_channel->phrases,
+			recog_channel->recognizer);
+		recog_channel->recognizer = NULL;
+		vosk_recog_peer_release(recog_channel);
+		recog_channel->suspended_request = request;
 	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Suspend Channel on Hold <%s> recognizer [%s]",
+		recog_channel->channel->id.buf,
+		recog_channel->suspended_request ? "returned" : "kept");
+}
 
-	/* get/allocate recognizer header */
-	recog_header = (mrcp_recog_header_t*)mrcp_resource_header_prepare(message);
-	if(recog_header) {
-		/* set completion cause */
-		recog_header->completion_cause = cause;
-		mrcp_resource_header_property_add(message,RECOGNIZER_HEADER_COMPLETION_CAUSE);
+/** Resume the channel suspended on hold (decoder worker context) */
+static void vosk_recog_channel_resume(vosk_recog_channel_t *recog_channel)
+{
+	mrcp_message_t *request = recog_channel->suspended_request;
+	if(recog_channel->suspended == FALSE) {
+		return;
 	}
-	/* set request state */
-	message->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+	recog_channel->suspended = FALSE;
+	recog_channel->suspended_request = NULL;
+	vosk_recog_worker_retain(recog_channel->worker);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Resume Channel <%s>",recog_channel->channel->id.buf);
+	if(!request || request != recog_channel->decode_request) {
+		/* the request is over, or there was no recognizer to return */
+		return;
+	}
+	recog_channel->recognizer = vosk_recog_pool_acquire(
+									recog_channel->kaldi_engine->recog_pool,
+									recog_channel->model,
+									recog_channel->sample_rate,
+									recog_channel->phrases);
+	if(!recog_channel->recognizer) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Reacquire Recognizer " APT_SIDRES_FMT,
+			MRCP_MESSAGE_SIDRES(request));
+		vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_ERROR,NULL);
+		return;
+	}
+	vosk_recog_recognizer_options_apply(recog_channel,recog_channel->recognizer,recog_channel->degraded);
+	if(recog_channel->channel_count > 1 && recog_channel->hotword == FALSE) {
+		if(vosk_recog_peer_acquire(recog_channel) == FALSE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Reacquire Peer Recognizer " APT_SIDRES_FMT,
+				MRCP_MESSAGE_SIDRES(request));
+			vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_ERROR,NULL);
+			return;
+		}
+		vosk_recog_recognizer_options_apply(recog_channel,recog_channel->peer_recognizer,recog_channel->degraded);
+	}
+}
 
-	if(cause == RECOGNIZER_COMPLETION_CAUSE_SUCCESS) {
-		{
-			const char *result = vosk_recognizer_result(recog_channel->recognizer);
-			if(early){
-				char * buffer = (char *)malloc(strlen(result)+strlen(early));
-				strcpy(buffer,result);
-				strcat(buffer,early);
-				apt_string_assign_n(&message->body,buffer,strlen(buffer),message->pool);
-				free((void *)buffer);
-			}else{
-				apt_string_assign_n(&message->body,result,strlen(result),message->pool);
+/** Drain queued frames (decoder worker context) */
+static void vosk_recog_frames_process(vosk_recog_channel_t *recog_channel, apt_bool_t decode)
+{
+	vosk_recog_frame_t *item;
+	while((item = mpf_audio_queue_read_begin(recog_channel->frame_queue)) != NULL) {
+		if(item->type == VOSK_RECOG_FRAME_STOP) {
+			if(decode == TRUE && recog_channel->decode_request && recog_channel->continuous == TRUE) {
+				vosk_recog_continuous_stop(recog_channel,recog_channel->decode_request,item->message);
+			}
+			if(recog_channel->rescore_request) {
+				/* the request is stopped, the rescored result is dropped */
+				apr_atomic_set32(&recog_channel->rescore_cancel,1);
 			}
+			/* send asynchronous response to STOP request */
+			recog_channel->decode_request = NULL;
+			vosk_recog_channel_recognizer_release(recog_channel);
+			mrcp_engine_channel_message_send(recog_channel->channel,item->message);
 		}
-		{
-			/* get/allocate generic header */
-			mrcp_generic_header_t *generic_header = mrcp_generic_header_prepare(message);
-			if(generic_header) {
-				/* set content types */
-				apt_string_assign(&generic_header->content_type,"application/x-nlsml",message->pool);
-				mrcp_generic_header_property_add(message,GENERIC_HEADER_CONTENT_TYPE);
+		else if(item->type == VOSK_RECOG_FRAME_HOLD) {
+			if(decode == TRUE) {
+				vosk_recog_channel_suspend(recog_channel,item->message);
 			}
 		}
-	}
-
-	recog_channel->recog_request = NULL;
-	/* send asynch event */
-	return mrcp_engine_channel_message_send(recog_channel->channel,message);
-}
-
-/** Process parsed XML document */
-static char* prase_grammar(apr_xml_doc *doc,const char *result)
-{
-	const apr_xml_elem *elem;
-	const apr_xml_elem *child;
-	const apr_xml_attr *attr;
-
-	
-    regmatch_t pmatch[1];
-    const size_t nmatch = 1;
-    regex_t reg;
-    int cflags = REG_EXTENDED;
-    int status;
-    
-	/* Navigate through document */
-	for (elem = doc->root->first_child; elem; elem = elem->next) {
-		char *id = NULL;
-		if(!elem || strcasecmp(elem->name,"rule") == 0) {
-			for (attr = elem->attr; attr; attr = attr->next) {
-				if(strcasecmp(attr->name,"id") == 0) {
-					id = attr->value;
+		else if(item->type == VOSK_RECOG_FRAME_RESUME) {
+			if(decode == TRUE) {
+				vosk_recog_channel_resume(recog_channel);
+			}
+		}
+		else if(decode == TRUE) {
+			if(item->start == TRUE) {
+				recog_channel->decode_request = item->message;
+				vosk_recog_partial_reset(&recog_channel->early_partial);
+				vosk_recog_partial_reset(&recog_channel->interim_partial);
+				vosk_recog_partial_reset(&recog_channel->stable_partial);
+				recog_channel->endpoint_silence = 0;
+				recog_channel->chunk_length = 0;
+				recog_channel->gate_offset = 0;
+				recog_channel->gate_length = 0;
+				recog_channel->gate_open = FALSE;
+				recog_channel->input_started = FALSE;
+				recog_channel->recognition_elapsed = 0;
+				recog_channel->recognition_expired = FALSE;
+				recog_channel->segment_count = 0;
+				recog_channel->segment_start = 0;
+				recog_channel->peer_segment_start = 0;
+				recog_channel->segment_elapsed = 0;
+				recog_channel->input_elapsed = 0;
+				recog_channel->input_offset = 0;
+				recog_channel->checkpoint_elapsed = 0;
+				recog_channel->lid_length = 0;
+				if(vosk_recog_resume_checkpoint_get(item->message,&recog_channel->segment_count,&recog_channel->input_offset) == TRUE) {
+					/* the transcription checkpointed by another node goes on, the segments are counted and timed on from there */
+					apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Resume from Checkpoint [%"APR_SIZE_T_FMT" segments] [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+						recog_channel->segment_count,
+						recog_channel->input_offset,
+						MRCP_MESSAGE_SIDRES(item->message));
+				}
+				/* the kept audio is read by the rescore worker till the rescored result of a stopped request is signaled back */
+				recog_channel->rescore_dropped = recog_channel->rescore_request ? TRUE : FALSE;
+				if(!recog_channel->rescore_request) {
+					recog_channel->rescore_length = 0;
+				}
+				if(recog_channel->degraded == TRUE) {
+					/* the recognizer and the chunk size are set up anew for each request */
+					vosk_recog_degrade_apply(recog_channel);
+				}
+				if(recog_channel->adapt_buffer) {
+					vosk_recog_adapt_prime(recog_channel,item->message);
 				}
 			}
-			if(elem->first_child){
-				for(child = elem->first_child; child; child = child->next) {
-					if(!child->first_cdata.first || !child->first_cdata.first->text){
-						continue;
-					}
-					char *pattern = (char *)malloc(strlen(child->first_cdata.first->text)+1);
-					strcpy(pattern, child->first_cdata.first->text);
-					strcat(pattern,".");
-					// if(strstr(result,child->first_cdata.first->text)){
-					// 	apt_log(APT_LOG_MARK, APT_PRIO_DEBUG, "Match id <%s> child <%s> result <%s>", id, child->first_cdata.first->text, result);
-					// 	regfree(&reg);
-					// 	return id;
-					// }
-					// init regex
-					status = regcomp(&reg, pattern, cflags);
-					if(status != REG_NOERROR){
-						return NULL;
-					}
-					// exec regex
-					status = regexec(&reg, result, nmatch, pmatch, 0);
-					regfree(&reg);
-					free((void*)pattern);
-					if(status == REG_NOERROR){
-						return id;
-					}
+			/* frames queued after completion of the request are dropped */
+			if(recog_channel->decode_request && recog_channel->decode_request == item->message) {
+				if(item->type == VOSK_RECOG_FRAME_DTMF) {
+					vosk_recog_dtmf_input(recog_channel,item);
+				}
+				else {
+					vosk_recog_frame_decode(recog_channel,item);
 				}
 			}
 		}
+		if(item->ref) {
+			mpf_frame_ref_release(item->ref);
+		}
+		mpf_audio_queue_read_commit(recog_channel->frame_queue);
 	}
-	return NULL;
 }
 
-/** Callback is called from MPF engine context to write/send new frame */
-static apt_bool_t vosk_recog_stream_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame)
+/** Decode the audio input of a batch request at decoder speed (decoder worker context) */
+static void vosk_recog_audio_decode(vosk_recog_channel_t *recog_channel)
 {
-	vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)stream->obj;
-	if(recog_channel->stop_response) {
-		/* send asynchronous response to STOP request */
-		mrcp_engine_channel_message_send(recog_channel->channel,recog_channel->stop_response);
-		recog_channel->stop_response = NULL;
-		recog_channel->recog_request = NULL;
-		return TRUE;
+	mrcp_message_t *request = recog_channel->audio_request;
+	apr_size_t total = 0;
+	apr_size_t size;
+	apr_time_t decode_start;
+
+	recog_channel->decode_request = request;
+	recog_channel->input_started = FALSE;
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_FIRST_AUDIO);
+	vosk_recog_start_of_input(recog_channel,request,FALSE);
+	while(apr_atomic_read32(&recog_channel->audio_cancel) == 0) {
+		size = vosk_recog_audio_read(&recog_channel->audio,recog_channel->chunk_buffer,recog_channel->chunk_capacity);
+		if(!size) {
+			break;
+		}
+		decode_start = apr_time_now();
+		if(vosk_recognizer_accept_waveform(recog_channel->recognizer,recog_channel->chunk_buffer,(int)size)) {
+			/* recorded audio is carried on past endpoints, each utterance but the last one is sent as intermediate result */
+			vosk_recog_intermediate_result(recog_channel,request,vosk_recognizer_result(recog_channel->recognizer));
+		}
+		vosk_recog_rtf_record(recog_channel,apr_time_now() - decode_start,size);
+		total += size;
 	}
+	vosk_recog_audio_close(&recog_channel->audio);
 
-	if(recog_channel->recog_request) {
-		mpf_detector_event_e det_event = mpf_activity_detector_process(recog_channel->detector,frame);
-		int end = 0;
-		switch(det_event) {
-			case MPF_DETECTOR_EVENT_ACTIVITY:
-				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Voice Activity " APT_SIDRES_FMT,
-					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
-				vosk_recog_start_of_input(recog_channel);
-				break;
-			case MPF_DETECTOR_EVENT_INACTIVITY:
-				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Voice Inactivity " APT_SIDRES_FMT,
-					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
-				vosk_recog_recognition_complete(recog_channel,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
-				end = 1;
+	if(apr_atomic_read32(&recog_channel->audio_cancel) != 0) {
+		/* the recognizer is returned once STOP is drained from the queue or the channel is closed */
+		return;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Decoded Batch Audio [%"APR_SIZE_T_FMT" ms] " APT_SIDRES_FMT,
+		total * 1000 / (recog_channel->sample_rate * BYTES_PER_SAMPLE),
+		MRCP_MESSAGE_SIDRES(request));
+	vosk_recog_recognition_complete(
+		recog_channel,
+		request,
+		total ? RECOGNIZER_COMPLETION_CAUSE_SUCCESS : RECOGNIZER_COMPLETION_CAUSE_NO_INPUT_TIMEOUT,
+		NULL);
+}
+
+/** Return the resources of the channel and respond to its close (decoder worker context) */
+static void vosk_recog_channel_close_complete(vosk_recog_channel_t *recog_channel)
+{
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	recog_channel->decode_request = NULL;
+	if(recog_channel->caller_id[0] != '\0' && recog_channel->adapt_length &&
+		recog_channel->adapt_length >= VOSK_RECOG_ADAPT_MIN_TIME * recog_channel->adapt_sample_rate / 1000 * BYTES_PER_SAMPLE) {
+		/* a short call leaves the speech stored before for the caller */
+		vosk_recog_adapt_store_put(
+			kaldi_engine->adapt_store,
+			recog_channel->caller_id,
+			recog_channel->adapt_sample_rate,
+			recog_channel->adapt_buffer,
+			recog_channel->adapt_length);
+	}
+	vosk_recog_channel_recognizer_release(recog_channel);
+	vosk_recog_last_result_drop(recog_channel);
+	if(recog_channel->grammar) {
+		vosk_recog_grammar_unref(recog_channel->grammar);
+		mrcp_engine_channel_mem_uncharge(recog_channel->channel,recog_channel->grammar_charge);
+		recog_channel->grammar = NULL;
+		recog_channel->grammar_charge = 0;
+	}
+	if(recog_channel->degraded == TRUE) {
+		vosk_recog_degrade_set(recog_channel,FALSE);
+	}
+	recog_channel->rtf_avg = 0;
+	/* responded to by the job, once the channel is left */
+	recog_channel->close_respond = TRUE;
+	if(recog_channel->suspended == TRUE) {
+		/* the channel is unpinned from the worker already */
+		recog_channel->suspended = FALSE;
+		recog_channel->suspended_request = NULL;
+	}
+	else {
+		vosk_recog_worker_release(recog_channel->worker);
+	}
+}
+
+/** Complete the request by the rescored result, or by the result of the first pass if rescoring fails (decoder worker context) */
+static void vosk_recog_rescore_complete(vosk_recog_channel_t *recog_channel)
+{
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	mrcp_message_t *request = recog_channel->rescore_request;
+	double confidence = 0;
+
+	vosk_recog_worker_release(recog_channel->rescore_worker);
+	recog_channel->rescore_worker = NULL;
+	if(apr_atomic_read32(&recog_channel->rescore_cancel) == 0) {
+		if(recog_channel->rescore_result) {
+			vosk_recog_nlsml_confidence_get(recog_channel->rescore_result,&confidence);
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Rescored Result of Confidence [%.2f] " APT_SIDRES_FMT,
+				confidence,
+				MRCP_MESSAGE_SIDRES(request));
+			recog_channel->taken_result = recog_channel->rescore_result;
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Failed to Rescore Result, take the first pass " APT_SIDRES_FMT,
+				MRCP_MESSAGE_SIDRES(request));
+			recog_channel->taken_result = recog_channel->rescore_first;
+		}
+		/* still pending rescoring, so that the speaker is scored by the result taken */
+		vosk_recog_recognition_complete(recog_channel,request,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
+	}
+
+	if(recog_channel->rescore_recognizer) {
+		vosk_recog_pool_release(
+			kaldi_engine->recog_pool,
+			recog_channel->rescore_version,
+			recog_channel->rescore_sample_rate,
+			recog_channel->rescore_phrases,
+			recog_channel->rescore_recognizer);
+		recog_channel->rescore_recognizer = NULL;
+	}
+	if(recog_channel->rescore_version) {
+		vosk_recog_model_release(kaldi_engine->models,recog_channel->rescore_version);
+		recog_channel->rescore_version = NULL;
+	}
+	recog_channel->rescore_phrases = NULL;
+	if(recog_channel->rescore_grammar) {
+		vosk_recog_grammar_unref(recog_channel->rescore_grammar);
+		recog_channel->rescore_grammar = NULL;
+	}
+	recog_channel->rescore_result = NULL;
+	recog_channel->rescore_first = NULL;
+	recog_channel->rescore_request = NULL;
+	if(recog_channel->rescore_close == TRUE) {
+		recog_channel->rescore_close = FALSE;
+		vosk_recog_channel_close_complete(recog_channel);
+	}
+}
+
+/** Enter the channel, the jobs of which may be processed by any worker once stolen (decoder worker context) */
+static APR_INLINE void vosk_recog_channel_enter(vosk_recog_channel_t *recog_channel, vosk_recog_worker_t *worker)
+{
+	if(recog_channel->job_guard) {
+		apr_thread_mutex_lock(recog_channel->job_guard);
+	}
+	recog_channel->job_worker = worker;
+	apt_log_scope_set(recog_channel->channel->log_priority);
+}
+
+/** Leave the channel and respond to its close, if completed by the job (decoder worker context) */
+static void vosk_recog_channel_leave(vosk_recog_channel_t *recog_channel)
+{
+	/* the channel may be destroyed as soon as the close is responded to */
+	mrcp_engine_channel_t *channel = recog_channel->close_respond == TRUE ? recog_channel->channel : NULL;
+	recog_channel->close_respond = FALSE;
+	if(recog_channel->job_guard) {
+		apr_thread_mutex_unlock(recog_channel->job_guard);
+	}
+	if(channel) {
+		mrcp_engine_channel_close_respond(channel);
+	}
+	apt_log_scope_set(APT_PRIO_COUNT);
+}
+
+/** Process job signaled to the decoder worker */
+static void vosk_recog_job_process(vosk_recog_worker_t *worker, int type, void *obj)
+{
+	vosk_recog_channel_t *recog_channel = obj;
+	if(type != VOSK_RECOG_JOB_DECODE) {
+		/* the gathered channels are decoded first, none of them may be closed meanwhile */
+		vosk_recog_worker_gather_flush(worker);
+	}
+	if(type == VOSK_RECOG_JOB_RESULT) {
+		/* the object is the batch stream, the channel is only valid while the stream is open */
+		vosk_recog_batch_stream_t *stream = obj;
+		const char *result = NULL;
+		recog_channel = vosk_recog_batch_stream_result_take(stream,&result);
+		if(!recog_channel) {
+			return;
+		}
+		vosk_recog_channel_enter(recog_channel,worker);
+		if(recog_channel->batch_stream == stream && recog_channel->decode_request) {
+			recog_channel->batch_result = result;
+			vosk_recog_recognition_complete(
+				recog_channel,
+				recog_channel->decode_request,
+				recog_channel->recognition_expired == TRUE ? RECOGNIZER_COMPLETION_CAUSE_RECOGNITION_TIMEOUT : RECOGNIZER_COMPLETION_CAUSE_SUCCESS,
+				NULL);
+		}
+		vosk_recog_channel_leave(recog_channel);
+		return;
+	}
+	if(type == VOSK_RECOG_JOB_REMOTE_RESULT) {
+		/* the object is the remote stream, the channel is only valid while the stream is open */
+		vosk_recog_remote_stream_t *stream = obj;
+		const char *result = NULL;
+		recog_channel = vosk_recog_remote_stream_result_take(stream,&result);
+		if(!recog_channel) {
+			return;
+		}
+		vosk_recog_channel_enter(recog_channel,worker);
+		if(recog_channel->remote_stream == stream && recog_channel->decode_request) {
+			mrcp_recog_completion_cause_e cause = RECOGNIZER_COMPLETION_CAUSE_SUCCESS;
+			if(!result) {
+				/* no decoder is reachable, or the one decoding is lost */
+				cause = RECOGNIZER_COMPLETION_CAUSE_ERROR;
+			}
+			else if(recog_channel->recognition_expired == TRUE) {
+				cause = RECOGNIZER_COMPLETION_CAUSE_RECOGNITION_TIMEOUT;
+			}
+			recog_channel->batch_result = result;
+			vosk_recog_recognition_complete(recog_channel,recog_channel->decode_request,cause,NULL);
+		}
+		vosk_recog_channel_leave(recog_channel);
+		return;
+	}
+	vosk_recog_channel_enter(recog_channel,worker);
+	switch(type) {
+		case VOSK_RECOG_JOB_AUDIO:
+			vosk_recog_audio_decode(recog_channel);
+			break;
+		case VOSK_RECOG_JOB_DECODE:
+			if(recog_channel->kaldi_engine->cpu_batch == TRUE) {
+				/* decoded along with the other channels having frames queued, the flag is reset then */
+				vosk_recog_worker_gather(worker,recog_channel);
 				break;
-			case MPF_DETECTOR_EVENT_NOINPUT:
-				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Noinput " APT_SIDRES_FMT,
-					MRCP_MESSAGE_SIDRES(recog_channel->recog_request));
-				if(recog_channel->timers_started == TRUE) {
-					vosk_recog_recognition_complete(recog_channel,RECOGNIZER_COMPLETION_CAUSE_NO_INPUT_TIMEOUT,NULL);
-					end = 1;
-				}
+			}
+			if(recog_channel->job_closed == TRUE) {
+				/* stolen ahead of the close, but taken after it */
 				break;
-			default:
+			}
+			/* reset the flag first, so that frames queued while draining signal a new job */
+			apr_atomic_xchg32(&recog_channel->scheduled,0);
+			vosk_recog_frames_process(recog_channel,TRUE);
+			break;
+		case VOSK_RECOG_JOB_CLOSE:
+			/* the channel is gone for the MPF scheduler, never signal it again */
+			apr_atomic_xchg32(&recog_channel->scheduled,1);
+			recog_channel->job_closed = TRUE;
+			vosk_recog_frames_process(recog_channel,FALSE);
+			{
+				mpf_audio_queue_stats_t stats;
+				mpf_audio_queue_stats_get(recog_channel->frame_queue,&stats);
+				apt_log(RECOG_LOG_MARK,stats.dropped || stats.rejected ? APT_PRIO_NOTICE : APT_PRIO_DEBUG,
+					"Decoder Queue <%s> frames [%"APR_SIZE_T_FMT"] dropped [%"APR_SIZE_T_FMT"] rejected [%"APR_SIZE_T_FMT"] high-water [%"APR_SIZE_T_FMT" ms] capacity [%"APR_SIZE_T_FMT" ms]",
+					recog_channel->channel->id.buf,
+					stats.written,stats.dropped,stats.rejected,
+					stats.high_water * CODEC_FRAME_TIME_BASE,
+					mpf_audio_queue_capacity_get(recog_channel->frame_queue));
+			}
+			if(recog_channel->rescore_request) {
+				/* the rescore worker reads the channel, the close is responded to once the rescored result is signaled back */
+				apr_atomic_set32(&recog_channel->rescore_cancel,1);
+				recog_channel->rescore_close = TRUE;
 				break;
+			}
+			vosk_recog_channel_close_complete(recog_channel);
+			break;
+		case VOSK_RECOG_JOB_RESCORE_RESULT:
+			vosk_recog_rescore_complete(recog_channel);
+			break;
+		default:
+			break;
+	}
+	vosk_recog_channel_leave(recog_channel);
+}
+
+/** Signal the result of rescoring back to the decoder worker, which alone completes the request (rescore worker context) */
+static void vosk_recog_rescore_result_signal(vosk_recog_channel_t *recog_channel)
+{
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	apr_size_t attempt;
+	if(vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_RESCORE_RESULT,recog_channel) == TRUE) {
+		return;
+	}
+
+	/* the queue of the decoder worker is full, the pooled recognizer is not held while waiting for room,
+	   and the result it owns is given up for the result of the first pass */
+	apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Signal Rescored Result, take the first pass <%s>",
+		recog_channel->channel->id.buf);
+	recog_channel->rescore_result = NULL;
+	if(recog_channel->rescore_recognizer) {
+		vosk_recog_pool_release(
+			kaldi_engine->recog_pool,
+			recog_channel->rescore_version,
+			recog_channel->rescore_sample_rate,
+			recog_channel->rescore_phrases,
+			recog_channel->rescore_recognizer);
+		recog_channel->rescore_recognizer = NULL;
+	}
+	for(attempt = 1; attempt < VOSK_RECOG_RESCORE_SIGNAL_ATTEMPTS; attempt++) {
+		apr_sleep(VOSK_RECOG_RESCORE_SIGNAL_INTERVAL);
+		if(vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_RESCORE_RESULT,recog_channel) == TRUE) {
+			return;
 		}
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_ERROR,"Failed to Signal Rescored Result, request is left pending <%s>",
+		recog_channel->channel->id.buf);
+}
 
-		if(recog_channel->recog_request) {
-			if((frame->type & MEDIA_FRAME_TYPE_EVENT) == MEDIA_FRAME_TYPE_EVENT) {
-				if(frame->marker == MPF_MARKER_START_OF_EVENT) {
-					apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected Start of Event " APT_SIDRES_FMT " id:%d",
-						MRCP_MESSAGE_SIDRES(recog_channel->recog_request),
-						frame->event_frame.event_id);
-				}
-				else if(frame->marker == MPF_MARKER_END_OF_EVENT) {
-					apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Detected End of Event " APT_SIDRES_FMT " id:%d duration:%d ts",
-						MRCP_MESSAGE_SIDRES(recog_channel->recog_request),
-						frame->event_frame.event_id,
-						frame->event_frame.duration);
-				}
+/** Decode the utterance again by the rescore model and signal the result back to the decoder worker (rescore worker context) */
+static void vosk_recog_rescore_job_process(vosk_recog_worker_t *worker, int type, void *obj)
+{
+	vosk_recog_channel_t *recog_channel = obj;
+	vosk_recog_engine_t *kaldi_engine = recog_channel->kaldi_engine;
+	vosk_recog_model_t *version;
+	const vosk_recog_g711_table_t *g711_table = recog_channel->rescore_g711_table;
+	apr_size_t sample_size = g711_table ? 1 : BYTES_PER_SAMPLE;
+	apr_size_t piece = g711_table ? recog_channel->chunk_capacity / BYTES_PER_SAMPLE : recog_channel->chunk_capacity;
+	apr_size_t offset = 0;
+	apr_size_t size;
+	int ret;
+	apr_time_t decode_start;
+	if(type != VOSK_RECOG_JOB_RESCORE) {
+		return;
+	}
+
+	/* the current version, even if the model is reloaded meanwhile */
+	version = vosk_recog_model_acquire(kaldi_engine->models,kaldi_engine->rescore_model);
+	if(!version->model) {
+		vosk_recog_model_release(kaldi_engine->models,version);
+		vosk_recog_rescore_result_signal(recog_channel);
+		return;
+	}
+	recog_channel->rescore_version = vosk_recog_model_replica_get(version,vosk_recog_worker_numa_node_get(worker));
+	recog_channel->rescore_recognizer = vosk_recog_pool_acquire(
+											kaldi_engine->recog_pool,
+											recog_channel->rescore_version,
+											recog_channel->rescore_sample_rate,
+											recog_channel->rescore_phrases);
+	if(recog_channel->rescore_recognizer) {
+		vosk_recog_recognizer_options_apply(recog_channel,recog_channel->rescore_recognizer,FALSE);
+		decode_start = apr_time_now();
+		while(offset < recog_channel->rescore_length && apr_atomic_read32(&recog_channel->rescore_cancel) == 0) {
+			size = recog_channel->rescore_length - offset;
+			if(size > piece) {
+				size = piece;
+			}
+			if(g711_table) {
+				vosk_recog_g711_expand(g711_table,recog_channel->rescore_buffer + offset,size,recog_channel->rescore_samples);
+				ret = vosk_recognizer_accept_waveform_f(recog_channel->rescore_recognizer,recog_channel->rescore_samples,(int)size);
 			}
+			else {
+				ret = vosk_recognizer_accept_waveform(recog_channel->rescore_recognizer,recog_channel->rescore_buffer + offset,(int)size);
+			}
+			if(ret) {
+				/* the rescore model cuts the utterance short, its result would not cover the whole input */
+				break;
+			}
+			offset += size;
+		}
+		if(offset == recog_channel->rescore_length && apr_atomic_read32(&recog_channel->rescore_cancel) == 0) {
+			recog_channel->rescore_result = vosk_recognizer_final_result(recog_channel->rescore_recognizer);
 		}
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Rescored [%"APR_SIZE_T_FMT" ms] in [%"APR_TIME_T_FMT" ms] <%s>",
+			offset * 1000 / (recog_channel->rescore_sample_rate * sample_size),
+			apr_time_as_msec(apr_time_now() - decode_start),
+			recog_channel->channel->id.buf);
+	}
+	/* the recognizer owns the result, it is returned by the decoder worker once the result is sent */
+	vosk_recog_rescore_result_signal(recog_channel);
+}
 
-		if(recog_channel->audio_out) {
-			fwrite(frame->codec_frame.buffer,1,frame->codec_frame.size,recog_channel->audio_out);
+/** Decode the channels gathered by the worker, those of the same model back-to-back, so that the model stays in cache (decoder worker context) */
+static void vosk_recog_gather_process(vosk_recog_worker_t *worker, void **objs, apr_size_t count)
+{
+	vosk_recog_channel_t *recog_channel;
+	const vosk_recog_model_t *model;
+	apr_size_t i;
+	apr_size_t j;
+	for(i=0; i<count; i++) {
+		if(!objs[i]) {
+			continue;
 		}
-		if(recog_channel->recognizer) {
-			int ret = -1;
-			ret = vosk_recognizer_accept_waveform(recog_channel->recognizer, (const char*)frame->codec_frame.buffer, frame->codec_frame.size);
-			if (ret) {
-				vosk_recog_recognition_complete(recog_channel,RECOGNIZER_COMPLETION_CAUSE_SUCCESS,NULL);
-			} else if (ret == 0 && end == 0) {
-				const char *result = vosk_recognizer_partial_result(recog_channel->recognizer);
-				const char *early = prase_grammar(recog_channel->grammar, result);
-				if (early) {
-					// apt_log(APT_LOG_MARK, APT_PRIO_INFO, "Match id <%s>", early);
-					char *buffer = (char *)malloc(strlen(early)+21);
-					strcpy(buffer,"<earlyres>");
-					strcat(buffer, early);
-					strcat(buffer,"</earlyres>");
-					vosk_recog_recognition_complete(recog_channel, RECOGNIZER_COMPLETION_CAUSE_SUCCESS, buffer);
-					free((void *)buffer);
-				} 
+		/* the model is only a hint of grouping, it's set by the engine task on RECOGNIZE */
+		model = ((vosk_recog_channel_t*)objs[i])->model;
+		for(j=i; j<count; j++) {
+			recog_channel = objs[j];
+			if(!recog_channel || (j > i && recog_channel->model != model)) {
+				continue;
 			}
+			objs[j] = NULL;
+			recog_channel->job_worker = worker;
+			/* reset the flag first, so that frames queued while draining signal a new job */
+			apr_atomic_xchg32(&recog_channel->scheduled,0);
+			vosk_recog_frames_process(recog_channel,TRUE);
 		}
 	}
-	return TRUE;
 }
 
 static apt_bool_t vosk_recog_msg_signal(vosk_recog_msg_type_e type, mrcp_engine_channel_t *channel, mrcp_message_t *request)
+{
+	return vosk_recog_engine_msg_signal(type,channel->engine,channel,request);
+}
+
+static apt_bool_t vosk_recog_engine_msg_signal(vosk_recog_msg_type_e type, mrcp_engine_t *engine, mrcp_engine_channel_t *channel, mrcp_message_t *request)
 {
 	apt_bool_t status = FALSE;
-	vosk_recog_channel_t *kaldi_channel = (vosk_recog_channel_t*)channel->method_obj;
-	vosk_recog_engine_t *kaldi_engine = kaldi_channel->kaldi_engine;
-	apt_task_t *task = apt_consumer_task_base_get(kaldi_engine->task);
-	apt_task_msg_t *msg = apt_task_msg_get(task);
+	vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)engine->obj;
+	apt_consumer_task_t *consumer_task = kaldi_engine->tasks[0];
+	apt_task_t *task;
+	apt_task_msg_t *msg;
+	if(channel && kaldi_engine->task_count > 1) {
+		/* all the messages of a channel are processed by the same task, hence in order */
+		apr_ssize_t length = channel->id.length;
+		consumer_task = kaldi_engine->tasks[apr_hashfunc_default(channel->id.buf,&length) % kaldi_engine->task_count];
+	}
+	task = apt_consumer_task_base_get(consumer_task);
+	msg = apt_task_msg_get(task);
 	if(msg) {
 		vosk_recog_msg_t *kaldi_msg;
 		msg->type = TASK_MSG_USER;
 		kaldi_msg = (vosk_recog_msg_t*) msg->data;
 
 		kaldi_msg->type = type;
+		kaldi_msg->engine = engine;
 		kaldi_msg->channel = channel;
 		kaldi_msg->request = request;
 		status = apt_task_msg_signal(task,msg);
@@ -718,33 +5613,180 @@ static apt_bool_t vosk_recog_msg_signal(vosk_recog_msg_type_e type, mrcp_engine_
 	return status;
 }
 
+/** Signal the result of a batch stream to the decoder worker of the channel (collector context) */
+static void vosk_recog_batch_on_result(vosk_recog_batch_stream_t *stream, void *obj)
+{
+	vosk_recog_channel_t *recog_channel = obj;
+	vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_RESULT,stream);
+}
+
+/** Signal the result of a remote stream to the decoder worker of the channel (remote client context) */
+static void vosk_recog_remote_on_result(vosk_recog_remote_stream_t *stream, void *obj)
+{
+	vosk_recog_channel_t *recog_channel = obj;
+	vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_REMOTE_RESULT,stream);
+}
+
+/** Decode bundled audio by a model, so that its pages are faulted in before the first request (loader thread context) */
+static void vosk_recog_model_warm_up(vosk_recog_engine_t *kaldi_engine, vosk_recog_model_t *model, int sample_rate, const char *path)
+{
+	char buffer[VOSK_RECOG_MAX_FRAME_SIZE * 10];
+	size_t size;
+	VoskRecognizer *recognizer;
+	apr_time_t start;
+	/* read by stdio, as no pool is to be used by the loader threads */
+	FILE *file = fopen(path,"rb");
+	if(!file) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Warm-up Audio [%s]",path);
+		return;
+	}
+
+	start = apr_time_now();
+	/* the recognizer is returned to the pool, so the first request also gets a warm one */
+	recognizer = vosk_recog_pool_acquire(kaldi_engine->recog_pool,model,sample_rate,NULL);
+	if(recognizer) {
+		while((size = fread(buffer,1,sizeof(buffer),file)) > 0) {
+			vosk_recognizer_accept_waveform(recognizer,buffer,(int)size);
+		}
+		vosk_recognizer_final_result(recognizer);
+		vosk_recog_pool_release(kaldi_engine->recog_pool,model,sample_rate,NULL,recognizer);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Warmed Up Model [%s] [%d] in [%"APR_TIME_T_FMT" ms]",
+			model->name,
+			sample_rate,
+			apr_time_as_msec(apr_time_now() - start));
+	}
+	fclose(file);
+}
+
+/** Warm up recognizers of a model as soon as it is loaded (loader thread context) */
+static void vosk_recog_model_on_load(vosk_recog_model_t *model, void *obj)
+{
+	vosk_recog_engine_t *kaldi_engine = obj;
+	int sample_rate = model->sample_rate ? model->sample_rate : VOSK_RECOG_DEFAULT_SAMPLE_RATE;
+	if(kaldi_engine->recog_pool_size) {
+		vosk_recog_pool_warm(
+			kaldi_engine->recog_pool,
+			model,
+			sample_rate,
+			NULL,
+			kaldi_engine->recog_pool_size);
+		if(kaldi_engine->precompiled_phrases) {
+			int i;
+			for(i=0; i<kaldi_engine->precompiled_phrases->nelts; i++) {
+				vosk_recog_pool_warm(
+					kaldi_engine->recog_pool,
+					model,
+					sample_rate,
+					APR_ARRAY_IDX(kaldi_engine->precompiled_phrases,i,const char*),
+					kaldi_engine->recog_pool_size);
+			}
+		}
+	}
+	/* batch models are decoded by the collector, which is started once all the models are loaded */
+	if(model->model && kaldi_engine->warm_up_audio_8k) {
+		if(!model->sample_rate || model->sample_rate == 8000) {
+			vosk_recog_model_warm_up(kaldi_engine,model,8000,kaldi_engine->warm_up_audio_8k);
+		}
+		if(!model->sample_rate || model->sample_rate == 16000) {
+			vosk_recog_model_warm_up(kaldi_engine,model,16000,kaldi_engine->warm_up_audio_16k);
+		}
+	}
+}
+
+/** Free the recognizers of a replaced model version, once the last request of it is complete */
+static void vosk_recog_model_on_free(vosk_recog_model_t *model, void *obj)
+{
+	vosk_recog_engine_t *kaldi_engine = obj;
+	if(model->batch_model) {
+		/* the batch recognizers of closed streams are freed by the collector, so is the batch model */
+		vosk_recog_batch_model_free(kaldi_engine->batch,model->batch_model);
+		model->batch_model = NULL;
+	}
+	vosk_recog_pool_purge(kaldi_engine->recog_pool,model);
+}
+
 static apt_bool_t vosk_recog_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
 	vosk_recog_msg_t *kaldi_msg = (vosk_recog_msg_t*)msg->data;
 	switch(kaldi_msg->type) {
+		case vosk_recog_MSG_OPEN_ENGINE:
+		{
+			/* load models and send asynch response */
+			vosk_recog_engine_t *kaldi_engine = (vosk_recog_engine_t*)kaldi_msg->engine->obj;
+			apt_bool_t status;
+			if(kaldi_engine->spk_model_path) {
+				/* set before any recognizer is built, so that all of them compute speaker vectors */
+				apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Load Speaker Model from [%s]",kaldi_engine->spk_model_path);
+				kaldi_engine->spk_model = vosk_spk_model_new(kaldi_engine->spk_model_path);
+				if(kaldi_engine->spk_model) {
+					vosk_recog_pool_speaker_model_set(kaldi_engine->recog_pool,kaldi_engine->spk_model);
+				}
+				else {
+					apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Load Speaker Model from [%s]",kaldi_engine->spk_model_path);
+				}
+			}
+			if(kaldi_engine->remote && kaldi_engine->remote_local_models == FALSE) {
+				/* the node holds no models, all the requests are decoded remotely */
+				status = TRUE;
+			}
+			else {
+				status = vosk_recog_model_registry_load(
+									kaldi_engine->models,
+									kaldi_engine->model_load_threads,
+									vosk_recog_model_on_load,
+									kaldi_engine);
+			}
+			if(status == FALSE) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Load Models [%s]",kaldi_msg->engine->id);
+			}
+			else if(kaldi_engine->batch) {
+				status = vosk_recog_batch_start(kaldi_engine->batch);
+			}
+			else if(kaldi_engine->remote) {
+				status = vosk_recog_remote_start(kaldi_engine->remote);
+			}
+			if(status == TRUE && kaldi_engine->model_watch_interval &&
+				(!kaldi_engine->remote || kaldi_engine->remote_local_models == TRUE)) {
+				vosk_recog_model_registry_watch_start(
+					kaldi_engine->models,
+					apr_time_from_sec(kaldi_engine->model_watch_interval),
+					vosk_recog_model_on_load,
+					vosk_recog_model_on_free,
+					kaldi_engine);
+			}
+			mrcp_engine_open_respond(kaldi_msg->engine,status);
+			break;
+		}
 		case vosk_recog_MSG_OPEN_CHANNEL:
 			/* open channel and send asynch response */
 			mrcp_engine_channel_open_respond(kaldi_msg->channel,TRUE);
 			break;
 		case vosk_recog_MSG_CLOSE_CHANNEL:
 		{
-			/* close channel, make sure there is no activity and send asynch response */
+			/* close channel in the context of the decoder worker, which sends asynch response */
 			vosk_recog_channel_t *recog_channel = (vosk_recog_channel_t*)kaldi_msg->channel->method_obj;
-			if(recog_channel->audio_out) {
-				fclose(recog_channel->audio_out);
-				recog_channel->audio_out = NULL;
-			}
-			if(recog_channel->recognizer) {
-				vosk_recognizer_free(recog_channel->recognizer);
-				recog_channel->recognizer = NULL;
+			apr_atomic_set32(&recog_channel->audio_cancel,1);
+			if(recog_channel->fetch) {
+				/* the fetch is not called back from now on */
+				mrcp_grammar_fetch_release(recog_channel->kaldi_engine->grammar_fetcher,recog_channel->fetch);
+				recog_channel->fetch = NULL;
+				if(recog_channel->fetch_done == TRUE) {
+					/* its completion is queued to the task, the channel is closed once that is processed */
+					recog_channel->close_pending = TRUE;
+					break;
+				}
+				recog_channel->fetch_request = NULL;
+				recog_channel->fetch_response = NULL;
 			}
-
-			mrcp_engine_channel_close_respond(kaldi_msg->channel);
+			vosk_recog_worker_signal(recog_channel->worker,VOSK_RECOG_JOB_CLOSE,recog_channel);
 			break;
 		}
 		case vosk_recog_MSG_REQUEST_PROCESS:
 			vosk_recog_channel_request_dispatch(kaldi_msg->channel,kaldi_msg->request);
 			break;
+		case vosk_recog_MSG_GRAMMAR_FETCH:
+			vosk_recog_grammar_fetch_complete(kaldi_msg->channel,kaldi_msg->request);
+			break;
 		default:
 			break;
 	}
@@ -0,0 +1,1588 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_lib.h>
+#include <apr_file_io.h>
+#include <apr_file_info.h>
+#include <apr_mmap.h>
+#include "vosk_recog_fst.h"
+#include "vosk_recog_log.h"
+
+/** Version of the image layout */
+#define VOSK_RECOG_FST_VERSION     2
+/** Flag of final states in the arc count of a state */
+#define VOSK_RECOG_FST_FINAL       0x80000000
+/** Input symbol of GARBAGE, which any word is taken by */
+#define VOSK_RECOG_FST_ANY         0xffffffff
+/** Max number of states of FST */
+#define VOSK_RECOG_FST_MAX_STATES  65536
+/** Max depth of rule references, deeper ones are taken to be recursive */
+#define VOSK_RECOG_FST_MAX_DEPTH   32
+/** Max bounded number of repeats, more are taken to be unbounded */
+#define VOSK_RECOG_FST_MAX_REPEATS 32
+/** Max number of steps to enumerate sentences of FST in */
+#define VOSK_RECOG_FST_MAX_STEPS   100000
+/** Max length of paths walked (in states), so that the stack is bounded */
+#define VOSK_RECOG_FST_MAX_PATH    4096
+/** Max number of words a span rewritten by normalization may take */
+#define VOSK_RECOG_FST_MAX_SPAN    16
+
+/** Characters which end a word of ABNF and JSGF grammars */
+#define VOSK_RECOG_FST_TEXT_SPECIALS ";|()[]{}<>*+/\"$="
+
+/** Header of FST image */
+typedef struct vosk_recog_fst_header_t vosk_recog_fst_header_t;
+struct vosk_recog_fst_header_t {
+	/** "VFST" */
+	char         magic[4];
+	/** Version of the layout */
+	apr_uint32_t version;
+	/** Size of the image */
+	apr_uint32_t size;
+	/** Start state */
+	apr_uint32_t start;
+	/** Number of states */
+	apr_uint32_t state_count;
+	/** Number of arcs */
+	apr_uint32_t arc_count;
+	/** Number of symbols */
+	apr_uint32_t symbol_count;
+	/** Length of the document the FST is compiled from, which follows the image in a file */
+	apr_uint32_t source_length;
+};
+
+/** State of FST image */
+typedef struct vosk_recog_fst_state_t vosk_recog_fst_state_t;
+struct vosk_recog_fst_state_t {
+	/** Index of the first arc leaving the state */
+	apr_uint32_t first_arc;
+	/** Number of arcs leaving the state, VOSK_RECOG_FST_FINAL is set for final states */
+	apr_uint32_t arc_count;
+};
+
+/** Arc of FST image */
+typedef struct vosk_recog_fst_arc_t vosk_recog_fst_arc_t;
+struct vosk_recog_fst_arc_t {
+	/** Input symbol (word), 0 for epsilon */
+	apr_uint32_t ilabel;
+	/** Output symbol (tag), 0 for none */
+	apr_uint32_t olabel;
+	/** Next state */
+	apr_uint32_t next;
+};
+
+/** FST */
+struct vosk_recog_fst_t {
+	/** The image, either compiled or mapped */
+	vosk_recog_fst_header_t *header;
+	/** Mapping of the image (NULL if compiled) */
+	apr_mmap_t              *mmap;
+};
+
+#define FST_STATES(h)  ((const vosk_recog_fst_state_t*)((const char*)(h) + sizeof(vosk_recog_fst_header_t)))
+#define FST_ARCS(h)    ((const vosk_recog_fst_arc_t*)(FST_STATES(h) + (h)->state_count))
+#define FST_SYMBOLS(h) ((const apr_uint32_t*)(FST_ARCS(h) + (h)->arc_count))
+#define FST_STRINGS(h) ((const char*)(FST_SYMBOLS(h) + (h)->symbol_count))
+#define FST_SYMBOL(h,label) (FST_STRINGS(h) + FST_SYMBOLS(h)[(label) - 1])
+
+/** Type of node of expanded rules */
+typedef enum {
+	FST_NODE_WORD,
+	FST_NODE_TAG,
+	FST_NODE_SEQ,
+	FST_NODE_ALT,
+	FST_NODE_REPEAT,
+	FST_NODE_REF,
+	FST_NODE_NULL,
+	FST_NODE_VOID,
+	FST_NODE_GARBAGE
+} vosk_recog_fst_node_e;
+
+/** Node of expanded rules */
+typedef struct vosk_recog_fst_node_t vosk_recog_fst_node_t;
+struct vosk_recog_fst_node_t {
+	/** Type of node */
+	vosk_recog_fst_node_e type;
+	/** Word, tag or name of the referenced rule */
+	const char           *text;
+	/** Child nodes (vosk_recog_fst_node_t*) of sequence, alternatives and repeat */
+	apr_array_header_t   *children;
+	/** Min number of repeats */
+	int                   min_repeat;
+	/** Max number of repeats (-1 if unbounded) */
+	int                   max_repeat;
+};
+
+/** Arc being built */
+typedef struct vosk_recog_fst_build_arc_t vosk_recog_fst_build_arc_t;
+struct vosk_recog_fst_build_arc_t {
+	apr_uint32_t from;
+	apr_uint32_t ilabel;
+	apr_uint32_t olabel;
+	apr_uint32_t next;
+};
+
+/** Builder of FST */
+typedef struct vosk_recog_fst_builder_t vosk_recog_fst_builder_t;
+struct vosk_recog_fst_builder_t {
+	/** Rules (vosk_recog_fst_node_t*) by name */
+	apr_hash_t         *rules;
+	/** Name of the first rule */
+	const char         *first_rule;
+	/** Arcs (vosk_recog_fst_build_arc_t) */
+	apr_array_header_t *arcs;
+	/** Number of states */
+	apr_uint32_t        state_count;
+	/** Labels of symbols by string */
+	apr_hash_t         *symbol_table;
+	/** Symbols (const char*) in order of labels */
+	apr_array_header_t *symbols;
+	/** Total size of symbols, including terminating nuls */
+	apr_size_t          strings_size;
+	/** Current depth of rule references */
+	apr_size_t          depth;
+	/** Pool to allocate temporary memory from */
+	apr_pool_t         *pool;
+};
+
+static vosk_recog_fst_builder_t* vosk_recog_fst_builder_create(apr_pool_t *pool)
+{
+	vosk_recog_fst_builder_t *builder = apr_palloc(pool,sizeof(vosk_recog_fst_builder_t));
+	builder->rules = apr_hash_make(pool);
+	builder->first_rule = NULL;
+	builder->arcs = apr_array_make(pool,64,sizeof(vosk_recog_fst_build_arc_t));
+	builder->state_count = 0;
+	builder->symbol_table = apr_hash_make(pool);
+	builder->symbols = apr_array_make(pool,32,sizeof(const char*));
+	builder->strings_size = 0;
+	builder->depth = 0;
+	builder->pool = pool;
+	return builder;
+}
+
+static vosk_recog_fst_node_t* vosk_recog_fst_node_create(vosk_recog_fst_builder_t *builder, vosk_recog_fst_node_e type, const char *text)
+{
+	vosk_recog_fst_node_t *node = apr_palloc(builder->pool,sizeof(vosk_recog_fst_node_t));
+	node->type = type;
+	node->text = text;
+	node->children = NULL;
+	node->min_repeat = 1;
+	node->max_repeat = 1;
+	if(type == FST_NODE_SEQ || type == FST_NODE_ALT || type == FST_NODE_REPEAT) {
+		node->children = apr_array_make(builder->pool,2,sizeof(vosk_recog_fst_node_t*));
+	}
+	return node;
+}
+
+static APR_INLINE void vosk_recog_fst_node_add(vosk_recog_fst_node_t *parent, vosk_recog_fst_node_t *child)
+{
+	APR_ARRAY_PUSH(parent->children,vosk_recog_fst_node_t*) = child;
+}
+
+/** Wrap node into repeat */
+static vosk_recog_fst_node_t* vosk_recog_fst_repeat_create(vosk_recog_fst_builder_t *builder, vosk_recog_fst_node_t *node, int min_repeat, int max_repeat)
+{
+	vosk_recog_fst_node_t *repeat = vosk_recog_fst_node_create(builder,FST_NODE_REPEAT,NULL);
+	if(max_repeat > VOSK_RECOG_FST_MAX_REPEATS) {
+		max_repeat = -1;
+	}
+	if(min_repeat > VOSK_RECOG_FST_MAX_REPEATS) {
+		min_repeat = VOSK_RECOG_FST_MAX_REPEATS;
+	}
+	repeat->min_repeat = min_repeat;
+	repeat->max_repeat = max_repeat;
+	vosk_recog_fst_node_add(repeat,node);
+	return repeat;
+}
+
+/** Add words of text, separated by spaces, to sequence lowercased */
+static void vosk_recog_fst_words_add(vosk_recog_fst_builder_t *builder, vosk_recog_fst_node_t *seq, const char *text, apr_size_t length)
+{
+	const char *pos = text;
+	const char *end = text + length;
+	const char *word;
+	char *lower;
+	apr_size_t i;
+	while(pos < end) {
+		while(pos < end && apr_isspace(*pos)) pos++;
+		word = pos;
+		while(pos < end && !apr_isspace(*pos)) pos++;
+		if(pos == word) {
+			break;
+		}
+		lower = apr_pstrmemdup(builder->pool,word,pos - word);
+		for(i=0; lower[i]; i++) {
+			lower[i] = (char)apr_tolower(lower[i]);
+		}
+		vosk_recog_fst_node_add(seq,vosk_recog_fst_node_create(builder,FST_NODE_WORD,lower));
+	}
+}
+
+static apr_uint32_t vosk_recog_fst_state_add(vosk_recog_fst_builder_t *builder)
+{
+	return builder->state_count++;
+}
+
+static void vosk_recog_fst_arc_add(vosk_recog_fst_builder_t *builder, apr_uint32_t from, apr_uint32_t ilabel, apr_uint32_t olabel, apr_uint32_t next)
+{
+	vosk_recog_fst_build_arc_t *arc = apr_array_push(builder->arcs);
+	arc->from = from;
+	arc->ilabel = ilabel;
+	arc->olabel = olabel;
+	arc->next = next;
+}
+
+/** Get label of symbol, add the symbol if not added yet */
+static apr_uint32_t vosk_recog_fst_symbol_get(vosk_recog_fst_builder_t *builder, const char *symbol)
+{
+	apr_uint32_t *label = apr_hash_get(builder->symbol_table,symbol,APR_HASH_KEY_STRING);
+	if(label) {
+		return *label;
+	}
+	APR_ARRAY_PUSH(builder->symbols,const char*) = symbol;
+	builder->strings_size += strlen(symbol) + 1;
+	label = apr_palloc(builder->pool,sizeof(apr_uint32_t));
+	*label = (apr_uint32_t)builder->symbols->nelts;
+	apr_hash_set(builder->symbol_table,symbol,APR_HASH_KEY_STRING,label);
+	return *label;
+}
+
+/** Build node between two states, through new states, if needed */
+static apt_bool_t vosk_recog_fst_node_build(vosk_recog_fst_builder_t *builder, const vosk_recog_fst_node_t *node, apr_uint32_t from, apr_uint32_t to)
+{
+	const vosk_recog_fst_node_t *child;
+	apr_uint32_t cur;
+	apr_uint32_t next;
+	int i;
+
+	if(builder->state_count > VOSK_RECOG_FST_MAX_STATES) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Grammar Too Large [%u] states",builder->state_count);
+		return FALSE;
+	}
+	switch(node->type) {
+		case FST_NODE_WORD:
+			vosk_recog_fst_arc_add(builder,from,vosk_recog_fst_symbol_get(builder,node->text),0,to);
+			return TRUE;
+		case FST_NODE_TAG:
+			vosk_recog_fst_arc_add(builder,from,0,vosk_recog_fst_symbol_get(builder,node->text),to);
+			return TRUE;
+		case FST_NODE_NULL:
+			vosk_recog_fst_arc_add(builder,from,0,0,to);
+			return TRUE;
+		case FST_NODE_VOID:
+			/* no path */
+			return TRUE;
+		case FST_NODE_GARBAGE:
+			cur = vosk_recog_fst_state_add(builder);
+			vosk_recog_fst_arc_add(builder,from,0,0,cur);
+			vosk_recog_fst_arc_add(builder,cur,VOSK_RECOG_FST_ANY,0,cur);
+			vosk_recog_fst_arc_add(builder,cur,0,0,to);
+			return TRUE;
+		case FST_NODE_SEQ:
+			if(apr_is_empty_array(node->children)) {
+				vosk_recog_fst_arc_add(builder,from,0,0,to);
+				return TRUE;
+			}
+			cur = from;
+			for(i=0; i<node->children->nelts; i++) {
+				child = APR_ARRAY_IDX(node->children,i,const vosk_recog_fst_node_t*);
+				next = (i == node->children->nelts - 1) ? to : vosk_recog_fst_state_add(builder);
+				if(vosk_recog_fst_node_build(builder,child,cur,next) == FALSE) {
+					return FALSE;
+				}
+				cur = next;
+			}
+			return TRUE;
+		case FST_NODE_ALT:
+			/* the alternatives share the states, none of them leads back to the first one */
+			for(i=0; i<node->children->nelts; i++) {
+				child = APR_ARRAY_IDX(node->children,i,const vosk_recog_fst_node_t*);
+				if(vosk_recog_fst_node_build(builder,child,from,to) == FALSE) {
+					return FALSE;
+				}
+			}
+			return TRUE;
+		case FST_NODE_REPEAT:
+			child = APR_ARRAY_IDX(node->children,0,const vosk_recog_fst_node_t*);
+			cur = from;
+			for(i=0; i<node->min_repeat; i++) {
+				next = vosk_recog_fst_state_add(builder);
+				if(vosk_recog_fst_node_build(builder,child,cur,next) == FALSE) {
+					return FALSE;
+				}
+				cur = next;
+			}
+			if(node->max_repeat < 0) {
+				/* the loop has its own state, so that no other path enters it */
+				apr_uint32_t loop = vosk_recog_fst_state_add(builder);
+				next = vosk_recog_fst_state_add(builder);
+				vosk_recog_fst_arc_add(builder,cur,0,0,loop);
+				if(vosk_recog_fst_node_build(builder,child,loop,next) == FALSE) {
+					return FALSE;
+				}
+				vosk_recog_fst_arc_add(builder,next,0,0,loop);
+				cur = loop;
+			}
+			else {
+				for(; i<node->max_repeat; i++) {
+					vosk_recog_fst_arc_add(builder,cur,0,0,to);
+					next = vosk_recog_fst_state_add(builder);
+					if(vosk_recog_fst_node_build(builder,child,cur,next) == FALSE) {
+						return FALSE;
+					}
+					cur = next;
+				}
+			}
+			vosk_recog_fst_arc_add(builder,cur,0,0,to);
+			return TRUE;
+		case FST_NODE_REF:
+		{
+			apt_bool_t status;
+			const vosk_recog_fst_node_t *rule = apr_hash_get(builder->rules,node->text,APR_HASH_KEY_STRING);
+			if(!rule) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown Grammar Rule [%s]",node->text);
+				return FALSE;
+			}
+			if(builder->depth >= VOSK_RECOG_FST_MAX_DEPTH) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Recursive Grammar Rule [%s]",node->text);
+				return FALSE;
+			}
+			/* referenced rules are expanded in place */
+			builder->depth++;
+			status = vosk_recog_fst_node_build(builder,rule,from,to);
+			builder->depth--;
+			return status;
+		}
+	}
+	return FALSE;
+}
+
+/** Expand root rule and lay out FST image */
+static vosk_recog_fst_t* vosk_recog_fst_build(vosk_recog_fst_builder_t *builder, const char *root, apr_pool_t *pool)
+{
+	vosk_recog_fst_t *fst;
+	vosk_recog_fst_header_t *header;
+	vosk_recog_fst_state_t *states;
+	vosk_recog_fst_arc_t *arcs;
+	apr_uint32_t *symbols;
+	apr_uint32_t *fill;
+	char *strings;
+	apr_size_t size;
+	apr_size_t offset;
+	apr_uint32_t start;
+	apr_uint32_t final;
+	vosk_recog_fst_node_t *ref;
+	int i;
+
+	if(!root) {
+		root = builder->first_rule;
+	}
+	if(!root) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Root Grammar Rule");
+		return NULL;
+	}
+	start = vosk_recog_fst_state_add(builder);
+	final = vosk_recog_fst_state_add(builder);
+	ref = vosk_recog_fst_node_create(builder,FST_NODE_REF,root);
+	if(vosk_recog_fst_node_build(builder,ref,start,final) == FALSE) {
+		return NULL;
+	}
+
+	size = sizeof(vosk_recog_fst_header_t) +
+		builder->state_count * sizeof(vosk_recog_fst_state_t) +
+		builder->arcs->nelts * sizeof(vosk_recog_fst_arc_t) +
+		builder->symbols->nelts * sizeof(apr_uint32_t) +
+		builder->strings_size;
+	header = apr_pcalloc(pool,size);
+	memcpy(header->magic,"VFST",4);
+	header->version = VOSK_RECOG_FST_VERSION;
+	header->size = (apr_uint32_t)size;
+	header->start = start;
+	header->state_count = builder->state_count;
+	header->arc_count = (apr_uint32_t)builder->arcs->nelts;
+	header->symbol_count = (apr_uint32_t)builder->symbols->nelts;
+	header->source_length = 0;
+
+	/* the arcs leaving a state are contiguous, in the order they are built */
+	states = (vosk_recog_fst_state_t*)FST_STATES(header);
+	arcs = (vosk_recog_fst_arc_t*)FST_ARCS(header);
+	for(i=0; i<builder->arcs->nelts; i++) {
+		states[APR_ARRAY_IDX(builder->arcs,i,vosk_recog_fst_build_arc_t).from].arc_count++;
+	}
+	fill = apr_palloc(builder->pool,sizeof(apr_uint32_t) * builder->state_count);
+	for(offset = 0, i = 0; i < (int)builder->state_count; i++) {
+		states[i].first_arc = (apr_uint32_t)offset;
+		fill[i] = (apr_uint32_t)offset;
+		offset += states[i].arc_count;
+	}
+	for(i=0; i<builder->arcs->nelts; i++) {
+		const vosk_recog_fst_build_arc_t *build_arc = &APR_ARRAY_IDX(builder->arcs,i,vosk_recog_fst_build_arc_t);
+		vosk_recog_fst_arc_t *arc = &arcs[fill[build_arc->from]++];
+		arc->ilabel = build_arc->ilabel;
+		arc->olabel = build_arc->olabel;
+		arc->next = build_arc->next;
+	}
+	states[final].arc_count |= VOSK_RECOG_FST_FINAL;
+
+	symbols = (apr_uint32_t*)FST_SYMBOLS(header);
+	strings = (char*)FST_STRINGS(header);
+	for(offset = 0, i = 0; i < builder->symbols->nelts; i++) {
+		const char *symbol = APR_ARRAY_IDX(builder->symbols,i,const char*);
+		apr_size_t length = strlen(symbol) + 1;
+		symbols[i] = (apr_uint32_t)offset;
+		memcpy(strings + offset,symbol,length);
+		offset += length;
+	}
+
+	fst = apr_palloc(pool,sizeof(vosk_recog_fst_t));
+	fst->header = header;
+	fst->mmap = NULL;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Compiled Grammar FST [%u] states [%u] arcs [%u] symbols [%"APR_SIZE_T_FMT" bytes]",
+		header->state_count,header->arc_count,header->symbol_count,size);
+	return fst;
+}
+
+/** Get value of attribute of XML element */
+static const char* vosk_recog_fst_xml_attr_get(const apr_xml_elem *elem, const char *name)
+{
+	const apr_xml_attr *attr;
+	for(attr = elem->attr; attr; attr = attr->next) {
+		if(strcasecmp(attr->name,name) == 0) {
+			return attr->value;
+		}
+	}
+	return NULL;
+}
+
+/** Concatenate text of XML element */
+static const char* vosk_recog_fst_xml_text_get(const apr_text_header *hdr, apr_pool_t *pool)
+{
+	const apr_text *text;
+	const char *value = "";
+	for(text = hdr->first; text; text = text->next) {
+		value = apr_pstrcat(pool,value,text->text,NULL);
+	}
+	return value;
+}
+
+/** Add words of XML text to sequence */
+static void vosk_recog_fst_xml_words_add(vosk_recog_fst_builder_t *builder, vosk_recog_fst_node_t *seq, const apr_text_header *hdr)
+{
+	const apr_text *text;
+	for(text = hdr->first; text; text = text->next) {
+		if(text->text) {
+			vosk_recog_fst_words_add(builder,seq,text->text,strlen(text->text));
+		}
+	}
+}
+
+/** Parse repeat attribute ("n", "n-" or "n-m") */
+static apt_bool_t vosk_recog_fst_repeat_parse(const char *value, int *min_repeat, int *max_repeat)
+{
+	char *end;
+	long min = strtol(value,&end,10);
+	if(end == value || min < 0) {
+		return FALSE;
+	}
+	*min_repeat = (int)min;
+	*max_repeat = (int)min;
+	if(*end == '-') {
+		const char *pos = end + 1;
+		long max = strtol(pos,&end,10);
+		*max_repeat = (end == pos) ? -1 : (int)max;
+		if(*max_repeat >= 0 && *max_repeat < *min_repeat) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static vosk_recog_fst_node_t* vosk_recog_fst_xml_content_parse(vosk_recog_fst_builder_t *builder, const apr_xml_elem *elem);
+
+/** Parse expansion element of rule, NULL if it is not one */
+static vosk_recog_fst_node_t* vosk_recog_fst_xml_elem_parse(vosk_recog_fst_builder_t *builder, const apr_xml_elem *elem, apt_bool_t *failed)
+{
+	vosk_recog_fst_node_t *node;
+	const char *value;
+	if(strcasecmp(elem->name,"item") == 0) {
+		node = vosk_recog_fst_xml_content_parse(builder,elem);
+		if(!node) {
+			*failed = TRUE;
+			return NULL;
+		}
+		value = vosk_recog_fst_xml_attr_get(elem,"repeat");
+		if(value) {
+			int min_repeat;
+			int max_repeat;
+			if(vosk_recog_fst_repeat_parse(value,&min_repeat,&max_repeat) == FALSE) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid Repeat [%s]",value);
+				*failed = TRUE;
+				return NULL;
+			}
+			node = vosk_recog_fst_repeat_create(builder,node,min_repeat,max_repeat);
+		}
+		return node;
+	}
+	if(strcasecmp(elem->name,"one-of") == 0) {
+		const apr_xml_elem *child;
+		node = vosk_recog_fst_node_create(builder,FST_NODE_ALT,NULL);
+		for(child = elem->first_child; child; child = child->next) {
+			vosk_recog_fst_node_t *item;
+			if(strcasecmp(child->name,"item") != 0) {
+				continue;
+			}
+			item = vosk_recog_fst_xml_elem_parse(builder,child,failed);
+			if(!item) {
+				return NULL;
+			}
+			vosk_recog_fst_node_add(node,item);
+		}
+		return node;
+	}
+	if(strcasecmp(elem->name,"ruleref") == 0) {
+		value = vosk_recog_fst_xml_attr_get(elem,"special");
+		if(value) {
+			if(strcasecmp(value,"NULL") == 0) {
+				return vosk_recog_fst_node_create(builder,FST_NODE_NULL,NULL);
+			}
+			if(strcasecmp(value,"VOID") == 0) {
+				return vosk_recog_fst_node_create(builder,FST_NODE_VOID,NULL);
+			}
+			if(strcasecmp(value,"GARBAGE") == 0) {
+				return vosk_recog_fst_node_create(builder,FST_NODE_GARBAGE,NULL);
+			}
+		}
+		value = vosk_recog_fst_xml_attr_get(elem,"uri");
+		if(!value || *value != '#') {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Unsupported Rule Reference [%s]",value ? value : "");
+			*failed = TRUE;
+			return NULL;
+		}
+		return vosk_recog_fst_node_create(builder,FST_NODE_REF,value + 1);
+	}
+	if(strcasecmp(elem->name,"tag") == 0) {
+		return vosk_recog_fst_node_create(builder,FST_NODE_TAG,vosk_recog_fst_xml_text_get(&elem->first_cdata,builder->pool));
+	}
+	if(strcasecmp(elem->name,"token") == 0) {
+		node = vosk_recog_fst_node_create(builder,FST_NODE_SEQ,NULL);
+		vosk_recog_fst_xml_words_add(builder,node,&elem->first_cdata);
+		return node;
+	}
+	/* <example>, <meta> and the like expand to nothing */
+	return NULL;
+}
+
+/** Parse mixed content of rule or item into sequence */
+static vosk_recog_fst_node_t* vosk_recog_fst_xml_content_parse(vosk_recog_fst_builder_t *builder, const apr_xml_elem *elem)
+{
+	const apr_xml_elem *child;
+	vosk_recog_fst_node_t *node;
+	apt_bool_t failed = FALSE;
+	vosk_recog_fst_node_t *seq = vosk_recog_fst_node_create(builder,FST_NODE_SEQ,NULL);
+	vosk_recog_fst_xml_words_add(builder,seq,&elem->first_cdata);
+	for(child = elem->first_child; child; child = child->next) {
+		node = vosk_recog_fst_xml_elem_parse(builder,child,&failed);
+		if(failed == TRUE) {
+			return NULL;
+		}
+		if(node) {
+			vosk_recog_fst_node_add(seq,node);
+		}
+		vosk_recog_fst_xml_words_add(builder,seq,&child->following_cdata);
+	}
+	return seq;
+}
+
+vosk_recog_fst_t* vosk_recog_fst_xml_compile(const apr_xml_doc *doc, apr_pool_t *pool)
+{
+	const apr_xml_elem *elem;
+	const char *id;
+	vosk_recog_fst_node_t *rule;
+	vosk_recog_fst_t *fst;
+	apr_pool_t *tmp_pool;
+	vosk_recog_fst_builder_t *builder;
+
+	if(!doc->root) {
+		return NULL;
+	}
+	if(apr_pool_create(&tmp_pool,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	builder = vosk_recog_fst_builder_create(tmp_pool);
+	for(elem = doc->root->first_child; elem; elem = elem->next) {
+		if(strcasecmp(elem->name,"rule") != 0) {
+			continue;
+		}
+		id = vosk_recog_fst_xml_attr_get(elem,"id");
+		if(!id) {
+			continue;
+		}
+		rule = vosk_recog_fst_xml_content_parse(builder,elem);
+		if(!rule) {
+			apr_pool_destroy(tmp_pool);
+			return NULL;
+		}
+		apr_hash_set(builder->rules,id,APR_HASH_KEY_STRING,rule);
+		if(!builder->first_rule) {
+			builder->first_rule = id;
+		}
+	}
+	fst = vosk_recog_fst_build(builder,vosk_recog_fst_xml_attr_get(doc->root,"root"),pool);
+	apr_pool_destroy(tmp_pool);
+	return fst;
+}
+
+/** Parser of ABNF and JSGF grammars */
+typedef struct vosk_recog_fst_parser_t vosk_recog_fst_parser_t;
+struct vosk_recog_fst_parser_t {
+	/** Current position */
+	const char               *pos;
+	/** End of the document */
+	const char               *end;
+	/** Whether the grammar is JSGF (rules are referenced as <name> rather than $name) */
+	apt_bool_t                jsgf;
+	/** Builder of FST */
+	vosk_recog_fst_builder_t *builder;
+};
+
+/** Skip spaces and comments */
+static void vosk_recog_fst_space_skip(vosk_recog_fst_parser_t *parser)
+{
+	while(parser->pos < parser->end) {
+		if(apr_isspace(*parser->pos)) {
+			parser->pos++;
+		}
+		else if(parser->end - parser->pos >= 2 && parser->pos[0] == '/' && parser->pos[1] == '/') {
+			while(parser->pos < parser->end && *parser->pos != '\n') parser->pos++;
+		}
+		else if(parser->end - parser->pos >= 2 && parser->pos[0] == '/' && parser->pos[1] == '*') {
+			parser->pos += 2;
+			while(parser->end - parser->pos >= 2 && !(parser->pos[0] == '*' && parser->pos[1] == '/')) parser->pos++;
+			parser->pos = parser->end - parser->pos >= 2 ? parser->pos + 2 : parser->end;
+		}
+		else {
+			break;
+		}
+	}
+}
+
+/** Check whether the next char is the one expected and skip it */
+static apt_bool_t vosk_recog_fst_char_check(vosk_recog_fst_parser_t *parser, char c)
+{
+	vosk_recog_fst_space_skip(parser);
+	if(parser->pos < parser->end && *parser->pos == c) {
+		parser->pos++;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/** Skip to the end of statement */
+static void vosk_recog_fst_statement_skip(vosk_recog_fst_parser_t *parser)
+{
+	while(parser->pos < parser->end && *parser->pos != ';') parser->pos++;
+	if(parser->pos < parser->end) parser->pos++;
+}
+
+static APR_INLINE apt_bool_t vosk_recog_fst_word_char_check(char c)
+{
+	return (!apr_isspace(c) && !strchr(VOSK_RECOG_FST_TEXT_SPECIALS,c)) ? TRUE : FALSE;
+}
+
+/** Scan word (or keyword) */
+static const char* vosk_recog_fst_word_scan(vosk_recog_fst_parser_t *parser)
+{
+	const char *word;
+	vosk_recog_fst_space_skip(parser);
+	word = parser->pos;
+	while(parser->pos < parser->end && vosk_recog_fst_word_char_check(*parser->pos) == TRUE) parser->pos++;
+	if(parser->pos == word) {
+		return NULL;
+	}
+	return apr_pstrmemdup(parser->builder->pool,word,parser->pos - word);
+}
+
+/** Scan rule name, either "$name" (ABNF) or "<name>" (JSGF), the leading char is skipped already */
+static const char* vosk_recog_fst_rule_name_scan(vosk_recog_fst_parser_t *parser)
+{
+	const char *name = parser->pos;
+	if(parser->jsgf == TRUE) {
+		while(parser->pos < parser->end && *parser->pos != '>') parser->pos++;
+		if(parser->pos == parser->end) {
+			return NULL;
+		}
+		parser->pos++;
+		return apr_pstrmemdup(parser->builder->pool,name,parser->pos - 1 - name);
+	}
+	while(parser->pos < parser->end && (apr_isalnum(*parser->pos) || strchr("_-.:",*parser->pos))) parser->pos++;
+	if(parser->pos == name) {
+		return NULL;
+	}
+	return apr_pstrmemdup(parser->builder->pool,name,parser->pos - name);
+}
+
+static vosk_recog_fst_node_t* vosk_recog_fst_alt_parse(vosk_recog_fst_parser_t *parser);
+
+/** Parse rule reference, the leading char is skipped already */
+static vosk_recog_fst_node_t* vosk_recog_fst_ref_parse(vosk_recog_fst_parser_t *parser)
+{
+	const char *name;
+	if(parser->pos < parser->end && *parser->pos == '<' && parser->jsgf == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Unsupported Rule Reference [$<]");
+		return NULL;
+	}
+	name = vosk_recog_fst_rule_name_scan(parser);
+	if(!name) {
+		return NULL;
+	}
+	if(strcmp(name,"NULL") == 0) {
+		return vosk_recog_fst_node_create(parser->builder,FST_NODE_NULL,NULL);
+	}
+	if(strcmp(name,"VOID") == 0) {
+		return vosk_recog_fst_node_create(parser->builder,FST_NODE_VOID,NULL);
+	}
+	if(strcmp(name,"GARBAGE") == 0) {
+		return vosk_recog_fst_node_create(parser->builder,FST_NODE_GARBAGE,NULL);
+	}
+	return vosk_recog_fst_node_create(parser->builder,FST_NODE_REF,name);
+}
+
+/** Parse tag, the opening brace is skipped already */
+static vosk_recog_fst_node_t* vosk_recog_fst_tag_parse(vosk_recog_fst_parser_t *parser)
+{
+	const char *tag = parser->pos;
+	const char *tag_end;
+	if(parser->end - parser->pos >= 2 && parser->pos[0] == '!' && parser->pos[1] == '{') {
+		/* {!{ ... }!} may contain braces */
+		tag += 2;
+		for(tag_end = tag; parser->end - tag_end >= 3; tag_end++) {
+			if(tag_end[0] == '}' && tag_end[1] == '!' && tag_end[2] == '}') {
+				break;
+			}
+		}
+		if(parser->end - tag_end < 3) {
+			return NULL;
+		}
+		parser->pos = tag_end + 3;
+	}
+	else {
+		tag_end = memchr(tag,'}',parser->end - tag);
+		if(!tag_end) {
+			return NULL;
+		}
+		parser->pos = tag_end + 1;
+	}
+	return vosk_recog_fst_node_create(parser->builder,FST_NODE_TAG,apr_pstrmemdup(parser->builder->pool,tag,tag_end - tag));
+}
+
+/** Parse item with its repeat operators */
+static vosk_recog_fst_node_t* vosk_recog_fst_item_parse(vosk_recog_fst_parser_t *parser)
+{
+	vosk_recog_fst_node_t *node = NULL;
+	char c;
+	vosk_recog_fst_space_skip(parser);
+	c = *parser->pos;
+	if(c == '(' || c == '[') {
+		parser->pos++;
+		node = vosk_recog_fst_alt_parse(parser);
+		if(!node || vosk_recog_fst_char_check(parser,c == '(' ? ')' : ']') == FALSE) {
+			return NULL;
+		}
+		if(c == '[') {
+			node = vosk_recog_fst_repeat_create(parser->builder,node,0,1);
+		}
+	}
+	else if(c == '{') {
+		parser->pos++;
+		return vosk_recog_fst_tag_parse(parser);
+	}
+	else if(c == '"') {
+		const char *text = ++parser->pos;
+		while(parser->pos < parser->end && *parser->pos != '"') parser->pos++;
+		if(parser->pos == parser->end) {
+			return NULL;
+		}
+		node = vosk_recog_fst_node_create(parser->builder,FST_NODE_SEQ,NULL);
+		vosk_recog_fst_words_add(parser->builder,node,text,parser->pos - text);
+		parser->pos++;
+	}
+	else if((c == '$' && parser->jsgf == FALSE) || (c == '<' && parser->jsgf == TRUE)) {
+		parser->pos++;
+		node = vosk_recog_fst_ref_parse(parser);
+	}
+	else {
+		const char *word = vosk_recog_fst_word_scan(parser);
+		if(!word) {
+			return NULL;
+		}
+		node = vosk_recog_fst_node_create(parser->builder,FST_NODE_SEQ,NULL);
+		vosk_recog_fst_words_add(parser->builder,node,word,strlen(word));
+	}
+	if(!node) {
+		return NULL;
+	}
+
+	for(;;) {
+		vosk_recog_fst_space_skip(parser);
+		if(parser->pos == parser->end) {
+			break;
+		}
+		c = *parser->pos;
+		if(c == '*' || c == '+') {
+			parser->pos++;
+			node = vosk_recog_fst_repeat_create(parser->builder,node,c == '*' ? 0 : 1,-1);
+		}
+		else if(c == '<' && parser->jsgf == FALSE) {
+			/* ABNF repeat <n>, <n-> or <n-m>, optionally followed by a probability /p/ */
+			int min_repeat;
+			int max_repeat;
+			const char *value = ++parser->pos;
+			while(parser->pos < parser->end && *parser->pos != '>') parser->pos++;
+			if(parser->pos == parser->end ||
+				vosk_recog_fst_repeat_parse(apr_pstrmemdup(parser->builder->pool,value,parser->pos - value),&min_repeat,&max_repeat) == FALSE) {
+				return NULL;
+			}
+			parser->pos++;
+			node = vosk_recog_fst_repeat_create(parser->builder,node,min_repeat,max_repeat);
+		}
+		else {
+			break;
+		}
+	}
+	return node;
+}
+
+/** Parse sequence of items */
+static vosk_recog_fst_node_t* vosk_recog_fst_seq_parse(vosk_recog_fst_parser_t *parser)
+{
+	vosk_recog_fst_node_t *item;
+	vosk_recog_fst_node_t *seq = vosk_recog_fst_node_create(parser->builder,FST_NODE_SEQ,NULL);
+	for(;;) {
+		vosk_recog_fst_space_skip(parser);
+		if(parser->pos == parser->end || strchr("|)];",*parser->pos)) {
+			break;
+		}
+		if(*parser->pos == '/') {
+			/* weights /w/ are ignored */
+			const char *weight_end = memchr(parser->pos + 1,'/',parser->end - parser->pos - 1);
+			if(!weight_end) {
+				return NULL;
+			}
+			parser->pos = weight_end + 1;
+			continue;
+		}
+		item = vosk_recog_fst_item_parse(parser);
+		if(!item) {
+			return NULL;
+		}
+		vosk_recog_fst_node_add(seq,item);
+	}
+	return seq;
+}
+
+/** Parse alternatives */
+static vosk_recog_fst_node_t* vosk_recog_fst_alt_parse(vosk_recog_fst_parser_t *parser)
+{
+	vosk_recog_fst_node_t *alt = NULL;
+	vosk_recog_fst_node_t *seq = vosk_recog_fst_seq_parse(parser);
+	while(seq && vosk_recog_fst_char_check(parser,'|') == TRUE) {
+		if(!alt) {
+			alt = vosk_recog_fst_node_create(parser->builder,FST_NODE_ALT,NULL);
+			vosk_recog_fst_node_add(alt,seq);
+		}
+		seq = vosk_recog_fst_seq_parse(parser);
+		if(seq) {
+			vosk_recog_fst_node_add(alt,seq);
+		}
+	}
+	if(!seq) {
+		return NULL;
+	}
+	return alt ? alt : seq;
+}
+
+apt_bool_t vosk_recog_fst_text_check(const char *buf, apr_size_t length)
+{
+	const char *pos = buf;
+	const char *end = buf + length;
+	if(!buf) {
+		return FALSE;
+	}
+	/* the self-identifying header comes first, possibly after a byte order mark */
+	if(end - pos >= 3 && memcmp(pos,"\xEF\xBB\xBF",3) == 0) {
+		pos += 3;
+	}
+	while(pos < end && apr_isspace(*pos)) pos++;
+	if(end - pos >= 5 && (memcmp(pos,"#ABNF",5) == 0 || memcmp(pos,"#JSGF",5) == 0)) {
+		return TRUE;
+	}
+	return FALSE;
+}
+
+vosk_recog_fst_t* vosk_recog_fst_text_compile(const char *buf, apr_size_t length, apr_pool_t *pool)
+{
+	vosk_recog_fst_parser_t parser;
+	vosk_recog_fst_t *fst;
+	vosk_recog_fst_node_t *rule;
+	const char *keyword;
+	const char *name;
+	const char *root = NULL;
+	const char *first_public = NULL;
+	apt_bool_t is_public;
+	apr_pool_t *tmp_pool;
+
+	if(apr_pool_create(&tmp_pool,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	parser.pos = buf;
+	parser.end = buf + length;
+	parser.builder = vosk_recog_fst_builder_create(tmp_pool);
+	parser.jsgf = (strstr(apr_pstrmemdup(tmp_pool,buf,length),"#JSGF") != NULL) ? TRUE : FALSE;
+
+	for(;;) {
+		vosk_recog_fst_space_skip(&parser);
+		if(parser.pos == parser.end) {
+			break;
+		}
+		if(*parser.pos == '#') {
+			/* self-identifying header */
+			vosk_recog_fst_statement_skip(&parser);
+			continue;
+		}
+		is_public = FALSE;
+		keyword = NULL;
+		if(*parser.pos != '$' && *parser.pos != '<') {
+			keyword = vosk_recog_fst_word_scan(&parser);
+			if(!keyword) {
+				break;
+			}
+			if(strcmp(keyword,"public") == 0 || strcmp(keyword,"private") == 0) {
+				is_public = strcmp(keyword,"public") == 0 ? TRUE : FALSE;
+				keyword = NULL;
+			}
+			else if(strcmp(keyword,"root") != 0) {
+				/* language, mode, tag-format, grammar, import and the like */
+				vosk_recog_fst_statement_skip(&parser);
+				continue;
+			}
+		}
+		if(vosk_recog_fst_char_check(&parser,parser.jsgf == TRUE ? '<' : '$') == FALSE ||
+			(name = vosk_recog_fst_rule_name_scan(&parser)) == NULL) {
+			break;
+		}
+		if(keyword) {
+			/* root $name; */
+			root = name;
+			vosk_recog_fst_statement_skip(&parser);
+			continue;
+		}
+		if(vosk_recog_fst_char_check(&parser,'=') == FALSE) {
+			break;
+		}
+		rule = vosk_recog_fst_alt_parse(&parser);
+		if(!rule || vosk_recog_fst_char_check(&parser,';') == FALSE) {
+			break;
+		}
+		apr_hash_set(parser.builder->rules,name,APR_HASH_KEY_STRING,rule);
+		if(is_public == TRUE && !first_public) {
+			first_public = name;
+		}
+		if(!parser.builder->first_rule) {
+			parser.builder->first_rule = name;
+		}
+	}
+	if(parser.pos != parser.end) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Grammar at [%"APR_SIZE_T_FMT"]",(apr_size_t)(parser.pos - buf));
+		apr_pool_destroy(tmp_pool);
+		return NULL;
+	}
+	fst = vosk_recog_fst_build(parser.builder,root ? root : first_public,pool);
+	apr_pool_destroy(tmp_pool);
+	return fst;
+}
+
+apt_bool_t vosk_recog_fst_save(vosk_recog_fst_t *fst, const char *source, apr_size_t length, const char *path, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	apr_size_t size = fst->header->size;
+	apt_bool_t status;
+	const char *tmp_path = apr_psprintf(pool,"%s.%pp.tmp",path,(void*)pool);
+	if(apr_file_open(&file,tmp_path,APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE | APR_FOPEN_BINARY,
+			APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Grammar FST [%s]",tmp_path);
+		return FALSE;
+	}
+	fst->header->source_length = (apr_uint32_t)length;
+	status = apr_file_write_full(file,fst->header,size,&size) == APR_SUCCESS ? TRUE : FALSE;
+	if(status == TRUE && length) {
+		/* the document itself, compared on mapping, so that no other document of the same name is ever taken */
+		status = apr_file_write_full(file,source,length,&length) == APR_SUCCESS ? TRUE : FALSE;
+	}
+	if(apr_file_close(file) != APR_SUCCESS) {
+		status = FALSE;
+	}
+	/* renamed once complete, so that no partial image is ever mapped */
+	if(status == FALSE || apr_file_rename(tmp_path,path,pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Save Grammar FST [%s]",path);
+		apr_file_remove(tmp_path,pool);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Validate image, so that no offset is out of its bounds */
+static apt_bool_t vosk_recog_fst_image_check(const vosk_recog_fst_header_t *header, apr_size_t size)
+{
+	const vosk_recog_fst_state_t *states;
+	const vosk_recog_fst_arc_t *arcs;
+	const apr_uint32_t *symbols;
+	apr_size_t strings_offset;
+	apr_size_t strings_size;
+	apr_uint32_t i;
+
+	if(size < sizeof(vosk_recog_fst_header_t) || memcmp(header->magic,"VFST",4) != 0 ||
+		header->version != VOSK_RECOG_FST_VERSION || header->size != size ||
+		header->state_count > VOSK_RECOG_FST_MAX_STATES + 2 || header->start >= header->state_count) {
+		return FALSE;
+	}
+	strings_offset = sizeof(vosk_recog_fst_header_t) +
+		(apr_size_t)header->state_count * sizeof(vosk_recog_fst_state_t) +
+		(apr_size_t)header->arc_count * sizeof(vosk_recog_fst_arc_t) +
+		(apr_size_t)header->symbol_count * sizeof(apr_uint32_t);
+	if(strings_offset > size) {
+		return FALSE;
+	}
+	strings_size = size - strings_offset;
+	if(header->symbol_count && (!strings_size || FST_STRINGS(header)[strings_size - 1] != '\0')) {
+		return FALSE;
+	}
+	states = FST_STATES(header);
+	for(i=0; i<header->state_count; i++) {
+		apr_uint32_t count = states[i].arc_count & ~VOSK_RECOG_FST_FINAL;
+		if(states[i].first_arc > header->arc_count || count > header->arc_count - states[i].first_arc) {
+			return FALSE;
+		}
+	}
+	arcs = FST_ARCS(header);
+	for(i=0; i<header->arc_count; i++) {
+		if(arcs[i].next >= header->state_count || arcs[i].olabel > header->symbol_count ||
+			(arcs[i].ilabel > header->symbol_count && arcs[i].ilabel != VOSK_RECOG_FST_ANY)) {
+			return FALSE;
+		}
+	}
+	symbols = FST_SYMBOLS(header);
+	for(i=0; i<header->symbol_count; i++) {
+		if(symbols[i] >= strings_size) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+vosk_recog_fst_t* vosk_recog_fst_map(const char *path, const char *source, apr_size_t length, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	apr_mmap_t *mmap;
+	vosk_recog_fst_t *fst;
+	const vosk_recog_fst_header_t *header;
+
+	if(apr_file_open(&file,path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) != APR_SUCCESS ||
+		finfo.size < (apr_off_t)sizeof(vosk_recog_fst_header_t) ||
+		apr_mmap_create(&mmap,file,0,(apr_size_t)finfo.size,APR_MMAP_READ,pool) != APR_SUCCESS) {
+		apr_file_close(file);
+		return NULL;
+	}
+	/* the mapping outlives the file */
+	apr_file_close(file);
+
+	header = mmap->mm;
+	if(header->source_length != (apr_uint32_t)length || header->size > (apr_size_t)finfo.size ||
+		(apr_size_t)finfo.size - header->size != length ||
+		memcmp((const char*)header + header->size,source,length) != 0 ||
+		vosk_recog_fst_image_check(header,header->size) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Stale Grammar FST [%s]",path);
+		apr_mmap_delete(mmap);
+		return NULL;
+	}
+	fst = apr_palloc(pool,sizeof(vosk_recog_fst_t));
+	fst->header = (vosk_recog_fst_header_t*)header;
+	fst->mmap = mmap;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Map Grammar FST [%s] [%u] states",path,header->state_count);
+	return fst;
+}
+
+apr_size_t vosk_recog_fst_state_count_get(const vosk_recog_fst_t *fst)
+{
+	return fst->header->state_count;
+}
+
+apr_size_t vosk_recog_fst_size_get(const vosk_recog_fst_t *fst)
+{
+	return fst->header->size;
+}
+
+/** Enumeration of sentences */
+typedef struct vosk_recog_fst_walk_t vosk_recog_fst_walk_t;
+struct vosk_recog_fst_walk_t {
+	const vosk_recog_fst_header_t *header;
+	/** Words of the path (const char*) */
+	apr_array_header_t *words;
+	/** Whether each state is on the path */
+	char               *on_path;
+	/** Sentences found (const char*) */
+	apr_array_header_t *phrases;
+	/** Sentences found, to skip the ones found by another path */
+	apr_hash_t         *seen;
+	/** Number of sentences found */
+	apr_size_t          count;
+	/** Number of steps made */
+	apr_size_t          steps;
+	/** Length of the path */
+	apr_size_t          depth;
+	apr_pool_t         *pool;
+};
+
+/** Walk paths from the state, FALSE if the sentences are not to be enumerated */
+static apt_bool_t vosk_recog_fst_walk(vosk_recog_fst_walk_t *walk, apr_uint32_t state)
+{
+	const vosk_recog_fst_state_t *s = &FST_STATES(walk->header)[state];
+	const vosk_recog_fst_arc_t *arc = FST_ARCS(walk->header) + s->first_arc;
+	const vosk_recog_fst_arc_t *arc_end = arc + (s->arc_count & ~VOSK_RECOG_FST_FINAL);
+
+	/* a state on the path again is a loop */
+	if(walk->on_path[state] || ++walk->steps > VOSK_RECOG_FST_MAX_STEPS || walk->depth >= VOSK_RECOG_FST_MAX_PATH) {
+		return FALSE;
+	}
+	if((s->arc_count & VOSK_RECOG_FST_FINAL) && walk->words->nelts) {
+		const char *sentence = apr_array_pstrcat(walk->pool,walk->words,' ');
+		if(!apr_hash_get(walk->seen,sentence,APR_HASH_KEY_STRING)) {
+			if(++walk->count > VOSK_RECOG_FST_MAX_PHRASES) {
+				return FALSE;
+			}
+			apr_hash_set(walk->seen,sentence,APR_HASH_KEY_STRING,sentence);
+			APR_ARRAY_PUSH(walk->phrases,const char*) = sentence;
+		}
+	}
+	walk->on_path[state] = 1;
+	walk->depth++;
+	for(; arc < arc_end; arc++) {
+		apt_bool_t status;
+		if(arc->ilabel == VOSK_RECOG_FST_ANY) {
+			return FALSE;
+		}
+		if(arc->ilabel) {
+			APR_ARRAY_PUSH(walk->words,const char*) = FST_SYMBOL(walk->header,arc->ilabel);
+		}
+		status = vosk_recog_fst_walk(walk,arc->next);
+		if(arc->ilabel) {
+			apr_array_pop(walk->words);
+		}
+		if(status == FALSE) {
+			return FALSE;
+		}
+	}
+	walk->depth--;
+	walk->on_path[state] = 0;
+	return TRUE;
+}
+
+apt_bool_t vosk_recog_fst_phrases_get(const vosk_recog_fst_t *fst, apr_array_header_t *phrases, apr_pool_t *pool)
+{
+	const vosk_recog_fst_header_t *header = fst->header;
+	const vosk_recog_fst_arc_t *arcs = FST_ARCS(header);
+	vosk_recog_fst_walk_t walk;
+	char *listed;
+	int nelts = phrases->nelts;
+	apr_uint32_t i;
+
+	walk.header = header;
+	walk.words = apr_array_make(pool,16,sizeof(const char*));
+	walk.on_path = apr_pcalloc(pool,header->state_count);
+	walk.phrases = phrases;
+	walk.seen = apr_hash_make(pool);
+	walk.count = 0;
+	walk.steps = 0;
+	walk.depth = 0;
+	walk.pool = pool;
+	if(vosk_recog_fst_walk(&walk,header->start) == TRUE) {
+		return TRUE;
+	}
+
+	/* constrained to the vocabulary of the grammar rather than to its sentences */
+	phrases->nelts = nelts;
+	listed = apr_pcalloc(pool,header->symbol_count + 1);
+	for(i=0; i<header->arc_count; i++) {
+		apr_uint32_t label = arcs[i].ilabel;
+		if(label && label != VOSK_RECOG_FST_ANY && !listed[label]) {
+			listed[label] = 1;
+			APR_ARRAY_PUSH(phrases,const char*) = FST_SYMBOL(header,label);
+		}
+	}
+	return FALSE;
+}
+
+/** Match of text against FST */
+typedef struct vosk_recog_fst_match_t vosk_recog_fst_match_t;
+struct vosk_recog_fst_match_t {
+	const vosk_recog_fst_header_t *header;
+	/** Words of the text (lowercase) */
+	const char        **words;
+	/** Number of words */
+	apr_size_t          count;
+	/** Bits of (state, position) pairs no path is accepted from */
+	unsigned char      *failed;
+	/** Bits of (state, position) pairs on the current path */
+	unsigned char      *active;
+	/** Output symbols of the current path (apr_uint32_t) */
+	apr_array_header_t *tags;
+	/** Depth of recursion */
+	apr_size_t          depth;
+	/** Number of words of the longest accepted prefix (normalization only) */
+	apr_size_t          longest;
+	/** Output symbols of the path of the longest accepted prefix (apr_uint32_t) */
+	apr_array_header_t *longest_tags;
+};
+
+#define FST_BIT_GET(bits,i) ((bits)[(i) >> 3] & (1 << ((i) & 7)))
+#define FST_BIT_SET(bits,i) ((bits)[(i) >> 3] |= (unsigned char)(1 << ((i) & 7)))
+#define FST_BIT_CLEAR(bits,i) ((bits)[(i) >> 3] &= (unsigned char)~(1 << ((i) & 7)))
+
+/** Find path accepting the words from the position on, depth first */
+static apt_bool_t vosk_recog_fst_search(vosk_recog_fst_match_t *match, apr_uint32_t state, apr_size_t pos)
+{
+	const vosk_recog_fst_state_t *s = &FST_STATES(match->header)[state];
+	const vosk_recog_fst_arc_t *arc = FST_ARCS(match->header) + s->first_arc;
+	const vosk_recog_fst_arc_t *arc_end = arc + (s->arc_count & ~VOSK_RECOG_FST_FINAL);
+	apr_size_t index = (apr_size_t)state * (match->count + 1) + pos;
+
+	if(pos == match->count && (s->arc_count & VOSK_RECOG_FST_FINAL)) {
+		return TRUE;
+	}
+	if(FST_BIT_GET(match->failed,index) || FST_BIT_GET(match->active,index) ||
+		match->depth >= VOSK_RECOG_FST_MAX_PATH) {
+		return FALSE;
+	}
+	FST_BIT_SET(match->active,index);
+	match->depth++;
+	for(; arc < arc_end; arc++) {
+		apr_size_t next_pos = pos;
+		if(arc->ilabel) {
+			if(pos == match->count) {
+				continue;
+			}
+			if(arc->ilabel != VOSK_RECOG_FST_ANY && strcmp(FST_SYMBOL(match->header,arc->ilabel),match->words[pos]) != 0) {
+				continue;
+			}
+			next_pos++;
+		}
+		if(arc->olabel) {
+			APR_ARRAY_PUSH(match->tags,apr_uint32_t) = arc->olabel;
+		}
+		if(vosk_recog_fst_search(match,arc->next,next_pos) == TRUE) {
+			return TRUE;
+		}
+		if(arc->olabel) {
+			apr_array_pop(match->tags);
+		}
+	}
+	match->depth--;
+	FST_BIT_CLEAR(match->active,index);
+	FST_BIT_SET(match->failed,index);
+	return FALSE;
+}
+
+/** Find the longest prefix of the words accepted by a path, depth first */
+static void vosk_recog_fst_prefix_search(vosk_recog_fst_match_t *match, apr_uint32_t state, apr_size_t pos)
+{
+	const vosk_recog_fst_state_t *s = &FST_STATES(match->header)[state];
+	const vosk_recog_fst_arc_t *arc = FST_ARCS(match->header) + s->first_arc;
+	const vosk_recog_fst_arc_t *arc_end = arc + (s->arc_count & ~VOSK_RECOG_FST_FINAL);
+	apr_size_t index = (apr_size_t)state * (match->count + 1) + pos;
+
+	/* each (state, position) pair is visited once, the first path to it is kept */
+	if(FST_BIT_GET(match->active,index) || match->depth >= VOSK_RECOG_FST_MAX_PATH) {
+		return;
+	}
+	FST_BIT_SET(match->active,index);
+	if((s->arc_count & VOSK_RECOG_FST_FINAL) && pos > match->longest) {
+		int i;
+		match->longest = pos;
+		apr_array_clear(match->longest_tags);
+		for(i=0; i<match->tags->nelts; i++) {
+			APR_ARRAY_PUSH(match->longest_tags,apr_uint32_t) = APR_ARRAY_IDX(match->tags,i,apr_uint32_t);
+		}
+	}
+	match->depth++;
+	for(; arc < arc_end; arc++) {
+		apr_size_t next_pos = pos;
+		if(arc->ilabel) {
+			/* GARBAGE would swallow any span, it is not rewritten */
+			if(pos == match->count || arc->ilabel == VOSK_RECOG_FST_ANY ||
+				strcmp(FST_SYMBOL(match->header,arc->ilabel),match->words[pos]) != 0) {
+				continue;
+			}
+			next_pos++;
+		}
+		if(arc->olabel) {
+			APR_ARRAY_PUSH(match->tags,apr_uint32_t) = arc->olabel;
+		}
+		vosk_recog_fst_prefix_search(match,arc->next,next_pos);
+		if(arc->olabel) {
+			apr_array_pop(match->tags);
+		}
+	}
+	match->depth--;
+}
+
+/** Append text to XML content escaped */
+static void vosk_recog_fst_xml_escape(apr_array_header_t *out, const char *text, apr_size_t length)
+{
+	apr_size_t i;
+	const char *entity;
+	for(i=0; i<length; i++) {
+		switch(text[i]) {
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			default: entity = NULL; break;
+		}
+		if(entity) {
+			for(; *entity; entity++) {
+				APR_ARRAY_PUSH(out,char) = *entity;
+			}
+		}
+		else {
+			APR_ARRAY_PUSH(out,char) = text[i];
+		}
+	}
+}
+
+/** Trim spaces of the text */
+static void vosk_recog_fst_trim(const char **begin, const char **end)
+{
+	while(*begin < *end && apr_isspace(**begin)) (*begin)++;
+	while(*end > *begin && apr_isspace(*(*end - 1))) (*end)--;
+}
+
+/** Interpret statement of tag, either a semantic literal or an assignment to out */
+static void vosk_recog_fst_statement_interpret(const char *begin, const char *end, const char **literal, apr_hash_t *props, apr_array_header_t *names, apr_pool_t *pool)
+{
+	const char *name = NULL;
+	const char *name_end = NULL;
+	const char *value;
+	vosk_recog_fst_trim(&begin,&end);
+	if(begin == end) {
+		return;
+	}
+	if(end - begin > 3 && strncmp(begin,"out",3) == 0 && (begin[3] == '.' || begin[3] == '=' || apr_isspace(begin[3]))) {
+		const char *pos = begin + 3;
+		if(*pos == '.') {
+			name = ++pos;
+			while(pos < end && (apr_isalnum(*pos) || *pos == '_')) pos++;
+			name_end = pos;
+		}
+		while(pos < end && apr_isspace(*pos)) pos++;
+		if(pos < end && *pos == '=' && (!name || name != name_end)) {
+			begin = pos + 1;
+			vosk_recog_fst_trim(&begin,&end);
+			if(end - begin >= 2 && (*begin == '"' || *begin == '\'') && *(end - 1) == *begin) {
+				begin++;
+				end--;
+			}
+			value = apr_pstrmemdup(pool,begin,end - begin);
+			if(name) {
+				name = apr_pstrmemdup(pool,name,name_end - name);
+				if(!apr_hash_get(props,name,APR_HASH_KEY_STRING)) {
+					APR_ARRAY_PUSH(names,const char*) = name;
+				}
+				apr_hash_set(props,name,APR_HASH_KEY_STRING,value);
+			}
+			else {
+				*literal = value;
+			}
+			return;
+		}
+	}
+	*literal = apr_pstrmemdup(pool,begin,end - begin);
+}
+
+/** Build instance of the tags of the path */
+static const char* vosk_recog_fst_instance_build(const vosk_recog_fst_header_t *header, const apr_array_header_t *tags, apr_pool_t *pool)
+{
+	const char *literal = NULL;
+	apr_hash_t *props = apr_hash_make(pool);
+	apr_array_header_t *names = apr_array_make(pool,2,sizeof(const char*));
+	apr_array_header_t *out;
+	int i;
+
+	for(i=0; i<tags->nelts; i++) {
+		const char *tag = FST_SYMBOL(header,APR_ARRAY_IDX(tags,i,apr_uint32_t));
+		const char *statement = tag;
+		char quote = 0;
+		/* statements are separated by semicolons out of quotes */
+		for(; ; tag++) {
+			if(*tag == '\0' || (*tag == ';' && !quote)) {
+				vosk_recog_fst_statement_interpret(statement,tag,&literal,props,names,pool);
+				if(*tag == '\0') {
+					break;
+				}
+				statement = tag + 1;
+			}
+			else if(*tag == '"' || *tag == '\'') {
+				quote = (quote == *tag) ? 0 : (quote ? quote : *tag);
+			}
+		}
+	}
+
+	if(!literal && apr_is_empty_array(names)) {
+		return NULL;
+	}
+	out = apr_array_make(pool,64,sizeof(char));
+	if(!apr_is_empty_array(names)) {
+		for(i=0; i<names->nelts; i++) {
+			const char *name = APR_ARRAY_IDX(names,i,const char*);
+			const char *value = apr_hash_get(props,name,APR_HASH_KEY_STRING);
+			apr_size_t length = strlen(name);
+			APR_ARRAY_PUSH(out,char) = '<';
+			vosk_recog_fst_xml_escape(out,name,length);
+			APR_ARRAY_PUSH(out,char) = '>';
+			vosk_recog_fst_xml_escape(out,value,strlen(value));
+			APR_ARRAY_PUSH(out,char) = '<';
+			APR_ARRAY_PUSH(out,char) = '/';
+			vosk_recog_fst_xml_escape(out,name,length);
+			APR_ARRAY_PUSH(out,char) = '>';
+		}
+	}
+	else {
+		vosk_recog_fst_xml_escape(out,literal,strlen(literal));
+	}
+	return apr_pstrmemdup(pool,out->elts,out->nelts);
+}
+
+apt_bool_t vosk_recog_fst_interpret(const vosk_recog_fst_t *fst, const char *text, const char **instance, apr_pool_t *pool)
+{
+	vosk_recog_fst_match_t match;
+	apr_array_header_t *words = apr_array_make(pool,8,sizeof(const char*));
+	char *copy = apr_pstrdup(pool,text);
+	char *last;
+	char *word;
+	apr_size_t bits;
+	char *pos;
+
+	*instance = NULL;
+	for(pos = copy; *pos; pos++) {
+		*pos = (char)apr_tolower(*pos);
+	}
+	for(word = apr_strtok(copy," \t\r\n",&last); word; word = apr_strtok(NULL," \t\r\n",&last)) {
+		APR_ARRAY_PUSH(words,const char*) = word;
+	}
+
+	match.header = fst->header;
+	match.words = (const char**)words->elts;
+	match.count = words->nelts;
+	bits = (apr_size_t)fst->header->state_count * (match.count + 1);
+	match.failed = apr_pcalloc(pool,bits / 8 + 1);
+	match.active = apr_pcalloc(pool,bits / 8 + 1);
+	match.tags = apr_array_make(pool,4,sizeof(apr_uint32_t));
+	match.depth = 0;
+	match.longest = 0;
+	match.longest_tags = NULL;
+	if(vosk_recog_fst_search(&match,fst->header->start,0) == FALSE) {
+		return FALSE;
+	}
+	*instance = vosk_recog_fst_instance_build(fst->header,match.tags,pool);
+	return TRUE;
+}
+
+const char* vosk_recog_fst_normalize(const vosk_recog_fst_t *fst, const char *text, apr_pool_t *pool)
+{
+	vosk_recog_fst_match_t match;
+	apr_array_header_t *words = apr_array_make(pool,8,sizeof(const char*));
+	apr_array_header_t *lowers = apr_array_make(pool,8,sizeof(const char*));
+	apr_array_header_t *out;
+	apt_bool_t rewritten = FALSE;
+	char *copy = apr_pstrdup(pool,text);
+	char *last;
+	char *word;
+	apr_size_t bits;
+	apr_size_t i;
+	int j;
+
+	for(word = apr_strtok(copy," \t\r\n",&last); word; word = apr_strtok(NULL," \t\r\n",&last)) {
+		char *lower = apr_pstrdup(pool,word);
+		char *pos;
+		for(pos = lower; *pos; pos++) {
+			*pos = (char)apr_tolower(*pos);
+		}
+		APR_ARRAY_PUSH(words,const char*) = word;
+		APR_ARRAY_PUSH(lowers,const char*) = lower;
+	}
+	if(apr_is_empty_array(words)) {
+		return NULL;
+	}
+
+	match.header = fst->header;
+	bits = (apr_size_t)fst->header->state_count * (VOSK_RECOG_FST_MAX_SPAN + 1);
+	match.failed = NULL;
+	match.active = apr_palloc(pool,bits / 8 + 1);
+	match.tags = apr_array_make(pool,4,sizeof(apr_uint32_t));
+	match.longest_tags = apr_array_make(pool,4,sizeof(apr_uint32_t));
+	out = apr_array_make(pool,(int)strlen(text) + 16,sizeof(char));
+
+	/* the longest span from the leftmost word on is replaced by the tags of its path, words no span starts with are kept */
+	for(i=0; i<(apr_size_t)words->nelts; ) {
+		const char *written;
+		match.words = (const char**)lowers->elts + i;
+		match.count = words->nelts - i;
+		if(match.count > VOSK_RECOG_FST_MAX_SPAN) {
+			match.count = VOSK_RECOG_FST_MAX_SPAN;
+		}
+		memset(match.active,0,bits / 8 + 1);
+		apr_array_clear(match.tags);
+		match.depth = 0;
+		match.longest = 0;
+		vosk_recog_fst_prefix_search(&match,fst->header->start,0);
+
+		if(out->nelts) {
+			APR_ARRAY_PUSH(out,char) = ' ';
+		}
+		if(match.longest && !apr_is_empty_array(match.longest_tags)) {
+			/* the written form is the output of the transducer, the tags concatenated */
+			for(j=0; j<match.longest_tags->nelts; j++) {
+				written = FST_SYMBOL(fst->header,APR_ARRAY_IDX(match.longest_tags,j,apr_uint32_t));
+				vosk_recog_fst_xml_escape(out,written,strlen(written));
+			}
+			i += match.longest;
+			rewritten = TRUE;
+			continue;
+		}
+		written = APR_ARRAY_IDX(words,i,const char*);
+		vosk_recog_fst_xml_escape(out,written,strlen(written));
+		i++;
+	}
+	if(rewritten == FALSE) {
+		return NULL;
+	}
+	return apr_pstrmemdup(pool,out->elts,out->nelts);
+}
@@ -0,0 +1,985 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include <apr_xml.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include <apr_atomic.h>
+#include <apr_lib.h>
+#include <apr_file_io.h>
+#include <apr_file_info.h>
+#include <apr_thread_mutex.h>
+#include "vosk_recog_grammar.h"
+#include "vosk_recog_fst.h"
+#include "apt_pool.h"
+#include "vosk_recog_log.h"
+
+/** Characters which make an item a regular expression rather than a literal */
+#define VOSK_RECOG_REGEX_SPECIALS ".[]()*+?{}|^$\\"
+/** Phrase which lets out-of-grammar speech be recognized as such */
+#define VOSK_RECOG_UNKNOWN_PHRASE "[unk]"
+/** Prefix of the URIs of built-in DTMF grammars */
+#define VOSK_RECOG_DTMF_URI_PREFIX "builtin:dtmf/"
+
+/** Compiled <item> */
+typedef struct vosk_recog_grammar_item_t vosk_recog_grammar_item_t;
+struct vosk_recog_grammar_item_t {
+	/** Id of the enclosing rule */
+	const char *rule_id;
+	/** Literal text (NULL if regex is used) */
+	const char *literal;
+	/** Length of the literal text */
+	apr_size_t  literal_length;
+	/** Compiled regular expression "<item>." */
+	regex_t    *regex;
+};
+
+/** Compiled grammar */
+struct vosk_recog_grammar_t {
+	/** Grammar document (the key in the cache) */
+	const char            *body;
+	/** Length of the document */
+	apr_size_t             body_length;
+	/** Hash of the document */
+	apr_uint32_t           hash;
+	/** Id of the interned message body the grammar is looked up by (0 if none) */
+	apr_uint32_t           body_id;
+	/** Array of items (vosk_recog_grammar_item_t) in document order */
+	apr_array_header_t    *items;
+	/** FST of the rules (NULL if the grammar is not compiled to one) */
+	vosk_recog_fst_t      *fst;
+	/** JSON list of phrases (NULL if not all the items are literals) */
+	const char            *phrases;
+	/** Number of phrases of the list (0 if there is none) */
+	apr_size_t             phrase_count;
+	/** Estimated memory footprint, charged to the channels defining the grammar */
+	apr_size_t             size;
+	/** Number of references held by channels */
+	volatile apr_uint32_t  ref_count;
+	/** Sequence number of the last lookup */
+	apr_uint32_t           last_used;
+	/** Pool the grammar is allocated from */
+	apr_pool_t            *pool;
+};
+
+/** Cache of compiled grammars */
+struct vosk_recog_grammar_cache_t {
+	/** Table of grammars by body */
+	apr_hash_t   *table;
+	/** Table of grammars by id of the interned message body, looked up without hashing the body */
+	apr_hash_t   *ids;
+	/** Max number of grammars to keep */
+	apr_size_t    max_count;
+	/** Lookup sequence number */
+	apr_uint32_t  sequence;
+	/** Directory to keep FST images in (NULL if none) */
+	const char   *fst_dir;
+	/** Max number of FST images kept in the directory (0 if unbounded) */
+	apr_size_t    fst_max_count;
+	/** Number of FST images in the directory, as counted on the last pruning plus the ones saved since */
+	volatile apr_uint32_t fst_count;
+	/** Set while the directory is pruned by a thread */
+	volatile apr_uint32_t fst_pruning;
+	/** Guards table (grammars are defined by any of engine tasks) */
+	apr_thread_mutex_t *mutex;
+};
+
+/** Inverse text normalization grammar, loaded once per engine */
+struct vosk_recog_itn_t {
+	/** FST of the rules, the tags of which are written forms */
+	vosk_recog_fst_t *fst;
+};
+
+static apr_status_t vosk_recog_regex_cleanup(void *data)
+{
+	regfree((regex_t*)data);
+	return APR_SUCCESS;
+}
+
+static apt_bool_t vosk_recog_grammar_item_add(vosk_recog_grammar_t *grammar, const char *rule_id, const char *text)
+{
+	vosk_recog_grammar_item_t *item = apr_array_push(grammar->items);
+	item->rule_id = rule_id;
+	item->literal = NULL;
+	item->literal_length = 0;
+	item->regex = NULL;
+
+	if(strpbrk(text,VOSK_RECOG_REGEX_SPECIALS) == NULL) {
+		item->literal = text;
+		item->literal_length = strlen(text);
+		return TRUE;
+	}
+
+	item->regex = apr_palloc(grammar->pool,sizeof(regex_t));
+	if(regcomp(item->regex,apr_pstrcat(grammar->pool,text,".",NULL),REG_EXTENDED | REG_NOSUB) != 0) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Compile Grammar Item <%s>",text);
+		apr_array_pop(grammar->items);
+		return FALSE;
+	}
+	apr_pool_cleanup_register(grammar->pool,item->regex,vosk_recog_regex_cleanup,apr_pool_cleanup_null);
+	return TRUE;
+}
+
+/** Locate <grammar> element in a single pass over the body (no NUL termination is assumed) */
+static apt_bool_t vosk_recog_grammar_element_find(const char *buf, apr_size_t length)
+{
+	static const char start_tag[] = "<grammar";
+	static const char end_tag[] = "</grammar>";
+	const char *pos = buf;
+	const char *end = buf + length;
+	apt_bool_t started = FALSE;
+	while(pos < end && (pos = memchr(pos,'<',end - pos)) != NULL) {
+		apr_size_t left = end - pos;
+		if(started == FALSE) {
+			if(left > sizeof(start_tag) - 1 && memcmp(pos,start_tag,sizeof(start_tag) - 1) == 0) {
+				char c = pos[sizeof(start_tag) - 1];
+				/* not a prefix of another element name */
+				if(c == '>' || c == '/' || apr_isspace(c)) {
+					started = TRUE;
+				}
+			}
+		}
+		else if(left >= sizeof(end_tag) - 1 && memcmp(pos,end_tag,sizeof(end_tag) - 1) == 0) {
+			return TRUE;
+		}
+		pos++;
+	}
+	return FALSE;
+}
+
+/** Validate parsed grammar document */
+static apt_bool_t vosk_recog_grammar_check(const apr_xml_doc *doc)
+{
+	const apr_xml_elem *root = doc->root;
+	/* Match document name */
+	if(!root || strcasecmp(root->name,"grammar") != 0) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown Document <%s>",root ? root->name : "null");
+		return FALSE;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Document <%s>",root->name);
+	return TRUE;
+}
+
+static apt_bool_t vosk_recog_grammar_doc_compile(vosk_recog_grammar_t *grammar, const apr_xml_doc *doc)
+{
+	const apr_xml_elem *elem;
+	const apr_xml_elem *child;
+	const apr_xml_attr *attr;
+
+	if(vosk_recog_grammar_check(doc) == FALSE) {
+		return FALSE;
+	}
+
+	for(elem = doc->root->first_child; elem; elem = elem->next) {
+		const char *id = NULL;
+		if(strcasecmp(elem->name,"rule") != 0) {
+			continue;
+		}
+		for(attr = elem->attr; attr; attr = attr->next) {
+			if(strcasecmp(attr->name,"id") == 0) {
+				id = attr->value;
+			}
+		}
+		for(child = elem->first_child; child; child = child->next) {
+			if(!child->first_cdata.first || !child->first_cdata.first->text) {
+				continue;
+			}
+			vosk_recog_grammar_item_add(grammar,id,child->first_cdata.first->text);
+		}
+	}
+	return TRUE;
+}
+
+/** Append JSON string to text stream */
+static void vosk_recog_json_string_append(apr_array_header_t *json, const char *str, apr_size_t length)
+{
+	apr_size_t i;
+	APR_ARRAY_PUSH(json,char) = '"';
+	for(i=0; i<length; i++) {
+		unsigned char c = (unsigned char)str[i];
+		if(c == '"' || c == '\\') {
+			APR_ARRAY_PUSH(json,char) = '\\';
+			APR_ARRAY_PUSH(json,char) = (char)c;
+		}
+		else if(c < 0x20) {
+			/* line breaks and tabs within an item separate words */
+			APR_ARRAY_PUSH(json,char) = ' ';
+		}
+		else {
+			APR_ARRAY_PUSH(json,char) = (char)c;
+		}
+	}
+	APR_ARRAY_PUSH(json,char) = '"';
+}
+
+/** Build JSON list of phrases (const char*) */
+static const char* vosk_recog_grammar_json_build(const apr_array_header_t *phrases, apr_pool_t *pool)
+{
+	int i;
+	apr_array_header_t *json = apr_array_make(pool,256,sizeof(char));
+	APR_ARRAY_PUSH(json,char) = '[';
+	for(i=0; i<phrases->nelts; i++) {
+		const char *begin = APR_ARRAY_IDX(phrases,i,const char*);
+		const char *end = begin + strlen(begin);
+		while(begin < end && apr_isspace(*begin)) begin++;
+		while(end > begin && apr_isspace(*(end-1))) end--;
+		if(begin == end) {
+			continue;
+		}
+		vosk_recog_json_string_append(json,begin,end - begin);
+		APR_ARRAY_PUSH(json,char) = ',';
+	}
+	vosk_recog_json_string_append(json,VOSK_RECOG_UNKNOWN_PHRASE,sizeof(VOSK_RECOG_UNKNOWN_PHRASE)-1);
+	APR_ARRAY_PUSH(json,char) = ']';
+	return apr_pstrmemdup(pool,json->elts,json->nelts);
+}
+
+/** Build JSON list of phrases out of the FST or, if there is none, out of literal items */
+static const char* vosk_recog_grammar_phrases_build(vosk_recog_grammar_t *grammar)
+{
+	int i;
+	apr_array_header_t *phrases = apr_array_make(grammar->pool,16,sizeof(const char*));
+	if(grammar->fst) {
+		vosk_recog_fst_phrases_get(grammar->fst,phrases,grammar->pool);
+		grammar->phrase_count = phrases->nelts;
+		return apr_is_empty_array(phrases) ? NULL : vosk_recog_grammar_json_build(phrases,grammar->pool);
+	}
+	if(apr_is_empty_array(grammar->items)) {
+		return NULL;
+	}
+
+	for(i=0; i<grammar->items->nelts; i++) {
+		const vosk_recog_grammar_item_t *item = &APR_ARRAY_IDX(grammar->items,i,vosk_recog_grammar_item_t);
+		if(!item->literal) {
+			/* the vocabulary of a regular expression is unknown */
+			return NULL;
+		}
+		APR_ARRAY_PUSH(phrases,const char*) = item->literal;
+	}
+	grammar->phrase_count = phrases->nelts;
+	return vosk_recog_grammar_json_build(phrases,grammar->pool);
+}
+
+/** Get path to the FST image of grammar (NULL if images are not kept) */
+static const char* vosk_recog_grammar_fst_path_get(const vosk_recog_grammar_cache_t *cache, const vosk_recog_grammar_t *grammar)
+{
+	if(!cache->fst_dir) {
+		return NULL;
+	}
+	return apr_psprintf(grammar->pool,"%s/%08x-%"APR_SIZE_T_FMT".fst",cache->fst_dir,grammar->hash,grammar->body_length);
+}
+
+/** FST image found in the directory */
+typedef struct vosk_recog_fst_file_t vosk_recog_fst_file_t;
+struct vosk_recog_fst_file_t {
+	const char *name;
+	apr_time_t  mtime;
+};
+
+/** Order FST images from the least recently used on */
+static int vosk_recog_fst_file_compare(const void *a, const void *b)
+{
+	const vosk_recog_fst_file_t *file_a = a;
+	const vosk_recog_fst_file_t *file_b = b;
+	if(file_a->mtime != file_b->mtime) {
+		return file_a->mtime < file_b->mtime ? -1 : 1;
+	}
+	return strcmp(file_a->name,file_b->name);
+}
+
+/** Remove the least recently used FST images beyond the max count, images are touched whenever mapped */
+static void vosk_recog_grammar_fst_dir_prune(vosk_recog_grammar_cache_t *cache)
+{
+	apr_pool_t *pool;
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	apr_array_header_t *files;
+	apr_size_t name_length;
+	apr_size_t keep_count;
+	apr_size_t removed = 0;
+	int i;
+
+	/* one thread at a time, the others go on saving meanwhile */
+	if(apr_atomic_cas32(&cache->fst_pruning,1,0) != 0) {
+		return;
+	}
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		apr_atomic_set32(&cache->fst_pruning,0);
+		return;
+	}
+	if(apr_dir_open(&dir,cache->fst_dir,pool) != APR_SUCCESS) {
+		apr_pool_destroy(pool);
+		apr_atomic_set32(&cache->fst_pruning,0);
+		return;
+	}
+	files = apr_array_make(pool,64,sizeof(vosk_recog_fst_file_t));
+	while(apr_dir_read(&finfo,APR_FINFO_NAME | APR_FINFO_TYPE | APR_FINFO_MTIME,dir) == APR_SUCCESS) {
+		vosk_recog_fst_file_t *file;
+		if(finfo.filetype != APR_REG || !finfo.name) {
+			continue;
+		}
+		name_length = strlen(finfo.name);
+		/* the image of the ITN grammar is in use for the lifetime of the engine */
+		if(name_length < 4 || strcmp(finfo.name + name_length - 4,".fst") != 0 || strncmp(finfo.name,"itn-",4) == 0) {
+			continue;
+		}
+		file = apr_array_push(files);
+		file->name = apr_pstrdup(pool,finfo.name);
+		file->mtime = finfo.mtime;
+	}
+	apr_dir_close(dir);
+
+	if((apr_size_t)files->nelts > cache->fst_max_count) {
+		/* down to 3/4 of the max, so that the directory is not scanned on every save */
+		keep_count = cache->fst_max_count - cache->fst_max_count / 4;
+		qsort(files->elts,files->nelts,sizeof(vosk_recog_fst_file_t),vosk_recog_fst_file_compare);
+		for(i=0; i<files->nelts && (apr_size_t)(files->nelts - i) > keep_count; i++) {
+			const vosk_recog_fst_file_t *file = &APR_ARRAY_IDX(files,i,vosk_recog_fst_file_t);
+			/* mappings in use outlive the files (but on Windows, where such files are left) */
+			if(apr_file_remove(apr_pstrcat(pool,cache->fst_dir,"/",file->name,NULL),pool) == APR_SUCCESS) {
+				removed++;
+			}
+		}
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Pruned Grammar FST Dir [%s] removed [%"APR_SIZE_T_FMT"] of [%d] images",
+			cache->fst_dir,removed,files->nelts);
+	}
+	apr_atomic_set32(&cache->fst_count,(apr_uint32_t)(files->nelts - removed));
+	apr_pool_destroy(pool);
+	apr_atomic_set32(&cache->fst_pruning,0);
+}
+
+/** Save FST image, pruning the directory once it holds more images than the max */
+static void vosk_recog_grammar_fst_save(vosk_recog_grammar_cache_t *cache, vosk_recog_fst_t *fst, const char *source, apr_size_t length, const char *path, apr_pool_t *pool)
+{
+	if(vosk_recog_fst_save(fst,source,length,path,pool) == FALSE || !cache->fst_max_count) {
+		return;
+	}
+	if((apr_size_t)apr_atomic_inc32(&cache->fst_count) + 1 > cache->fst_max_count) {
+		vosk_recog_grammar_fst_dir_prune(cache);
+	}
+}
+
+/** Map FST image saved before, marking it used */
+static vosk_recog_fst_t* vosk_recog_grammar_fst_map(const char *path, const char *source, apr_size_t length, apr_pool_t *pool)
+{
+	vosk_recog_fst_t *fst = vosk_recog_fst_map(path,source,length,pool);
+	if(fst) {
+		/* the images are pruned from the least recently used on */
+		apr_file_mtime_set(path,apr_time_now(),pool);
+	}
+	return fst;
+}
+
+/** Estimate memory footprint of compiled grammar */
+static apr_size_t vosk_recog_grammar_size_estimate(const vosk_recog_grammar_t *grammar)
+{
+	/* the pool reports its size with pool debugging only */
+	apr_size_t size = apt_pool_size_get(grammar->pool);
+	if(size) {
+		return size;
+	}
+	size = sizeof(vosk_recog_grammar_t) + grammar->body_length;
+	size += grammar->items->nelts * sizeof(vosk_recog_grammar_item_t);
+	if(grammar->phrases) {
+		size += strlen(grammar->phrases);
+	}
+	if(grammar->fst) {
+		size += vosk_recog_fst_size_get(grammar->fst);
+	}
+	return size;
+}
+
+/** Compile FST of grammar, or map the image compiled before */
+static void vosk_recog_grammar_fst_compile(vosk_recog_grammar_cache_t *cache, vosk_recog_grammar_t *grammar, const apr_xml_doc *doc)
+{
+	const char *path = vosk_recog_grammar_fst_path_get(cache,grammar);
+	if(path) {
+		grammar->fst = vosk_recog_grammar_fst_map(path,grammar->body,grammar->body_length,grammar->pool);
+		if(grammar->fst) {
+			return;
+		}
+	}
+	if(doc) {
+		grammar->fst = vosk_recog_fst_xml_compile(doc,grammar->pool);
+	}
+	else {
+		grammar->fst = vosk_recog_fst_text_compile(grammar->body,grammar->body_length,grammar->pool);
+	}
+	if(grammar->fst && path) {
+		vosk_recog_grammar_fst_save(cache,grammar->fst,grammar->body,grammar->body_length,path,grammar->pool);
+	}
+}
+
+static vosk_recog_grammar_t* vosk_recog_grammar_compile(vosk_recog_grammar_cache_t *cache, const apt_str_t *body)
+{
+	char errbuf[256];
+	apr_xml_parser *parser;
+	apr_xml_doc *doc = NULL;
+	apr_status_t rv;
+	vosk_recog_grammar_t *grammar;
+	apr_pool_t *pool;
+
+	apt_bool_t text = vosk_recog_fst_text_check(body->buf,body->length);
+
+	/* SRGS XML, SRGS ABNF and JSGF documents are supported */
+	if(text == FALSE && vosk_recog_grammar_element_find(body->buf,body->length) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Grammar Element Found");
+		return NULL;
+	}
+
+	/* the grammar may be evicted by any thread, hence its own root pool */
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	grammar = apr_palloc(pool,sizeof(vosk_recog_grammar_t));
+	grammar->body = apr_pstrmemdup(pool,body->buf,body->length);
+	grammar->body_length = body->length;
+	grammar->body_id = 0;
+	{
+		apr_ssize_t length = (apr_ssize_t)body->length;
+		grammar->hash = apr_hashfunc_default(grammar->body,&length);
+	}
+	grammar->items = apr_array_make(pool,5,sizeof(vosk_recog_grammar_item_t));
+	grammar->fst = NULL;
+	grammar->phrases = NULL;
+	grammar->phrase_count = 0;
+	grammar->size = 0;
+	grammar->ref_count = 0;
+	grammar->last_used = 0;
+	grammar->pool = pool;
+
+	if(text == TRUE) {
+		/* ABNF and JSGF grammars are matched by their FST only */
+		vosk_recog_grammar_fst_compile(cache,grammar,NULL);
+		if(!grammar->fst) {
+			apr_pool_destroy(pool);
+			return NULL;
+		}
+		grammar->phrases = vosk_recog_grammar_phrases_build(grammar);
+		grammar->size = vosk_recog_grammar_size_estimate(grammar);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Compiled Grammar FST [%"APR_SIZE_T_FMT"] states phrases %s",
+			vosk_recog_fst_state_count_get(grammar->fst),grammar->phrases ? grammar->phrases : "none");
+		return grammar;
+	}
+
+	parser = apr_xml_parser_create(pool);
+	if(!parser) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create XML Parser");
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+	/* the body is fed as is, there is no limit on its size */
+	rv = apr_xml_parser_feed(parser,body->buf,body->length);
+	if(rv == APR_SUCCESS) {
+		rv = apr_xml_parser_done(parser,&doc);
+	}
+	if(rv != APR_SUCCESS || !doc) {
+		apr_xml_parser_geterror(parser,errbuf,sizeof(errbuf));
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Grammar: %s",errbuf);
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+
+	if(vosk_recog_grammar_doc_compile(grammar,doc) == FALSE) {
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+	/* the items still match partial results, in case the rules do not compile */
+	vosk_recog_grammar_fst_compile(cache,grammar,doc);
+	grammar->phrases = vosk_recog_grammar_phrases_build(grammar);
+	grammar->size = vosk_recog_grammar_size_estimate(grammar);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Compiled Grammar [%d] items phrases %s",
+		grammar->items->nelts,grammar->phrases ? grammar->phrases : "none");
+	return grammar;
+}
+
+/** Evict the least recently used unreferenced grammar (called with mutex locked) */
+static void vosk_recog_grammar_cache_evict(vosk_recog_grammar_cache_t *cache)
+{
+	apr_hash_index_t *it;
+	void *val;
+	vosk_recog_grammar_t *grammar;
+	vosk_recog_grammar_t *oldest = NULL;
+	for(it = apr_hash_first(NULL,cache->table); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		grammar = val;
+		if(apr_atomic_read32(&grammar->ref_count) != 0) {
+			continue;
+		}
+		if(!oldest || (apr_int32_t)(grammar->last_used - oldest->last_used) < 0) {
+			oldest = grammar;
+		}
+	}
+	if(oldest) {
+		apr_hash_set(cache->table,oldest->body,oldest->body_length,NULL);
+		if(oldest->body_id) {
+			apr_hash_set(cache->ids,&oldest->body_id,sizeof(oldest->body_id),NULL);
+		}
+		apr_pool_destroy(oldest->pool);
+	}
+}
+
+vosk_recog_grammar_cache_t* vosk_recog_grammar_cache_create(apr_size_t max_count, const char *fst_dir, apr_size_t fst_max_count, apr_pool_t *pool)
+{
+	vosk_recog_grammar_cache_t *cache = apr_palloc(pool,sizeof(vosk_recog_grammar_cache_t));
+	cache->table = apr_hash_make(pool);
+	cache->ids = apr_hash_make(pool);
+	cache->max_count = max_count;
+	cache->sequence = 0;
+	cache->fst_dir = NULL;
+	cache->fst_max_count = fst_max_count;
+	cache->fst_count = 0;
+	cache->fst_pruning = 0;
+	if(fst_dir && *fst_dir) {
+		if(apr_dir_make_recursive(fst_dir,APR_OS_DEFAULT,pool) == APR_SUCCESS) {
+			cache->fst_dir = apr_pstrdup(pool,fst_dir);
+			if(cache->fst_max_count) {
+				/* counted once, and pruned of the images left beyond the max by former runs */
+				vosk_recog_grammar_fst_dir_prune(cache);
+			}
+		}
+		else {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Grammar FST Dir [%s]",fst_dir);
+		}
+	}
+	if(apr_thread_mutex_create(&cache->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return cache;
+}
+
+void vosk_recog_grammar_cache_destroy(vosk_recog_grammar_cache_t *cache)
+{
+	apr_hash_index_t *it;
+	void *val;
+	for(it = apr_hash_first(NULL,cache->table); it; it = apr_hash_next(it)) {
+		apr_hash_this(it,NULL,NULL,&val);
+		apr_pool_destroy(((vosk_recog_grammar_t*)val)->pool);
+	}
+	apr_hash_clear(cache->table);
+	apr_hash_clear(cache->ids);
+	apr_thread_mutex_destroy(cache->mutex);
+}
+
+/** Index grammar by the id of the interned body it is looked up by (guarded) */
+static void vosk_recog_grammar_body_id_set(vosk_recog_grammar_cache_t *cache, vosk_recog_grammar_t *grammar, apr_uint32_t body_id)
+{
+	if(!body_id || grammar->body_id == body_id) {
+		return;
+	}
+	if(grammar->body_id) {
+		/* the body has been interned again since, the previous id is never seen anymore */
+		apr_hash_set(cache->ids,&grammar->body_id,sizeof(grammar->body_id),NULL);
+	}
+	grammar->body_id = body_id;
+	apr_hash_set(cache->ids,&grammar->body_id,sizeof(grammar->body_id),grammar);
+}
+
+vosk_recog_grammar_t* vosk_recog_grammar_cache_get(vosk_recog_grammar_cache_t *cache, const apt_str_t *body)
+{
+	return vosk_recog_grammar_cache_body_get(cache,body,0);
+}
+
+vosk_recog_grammar_t* vosk_recog_grammar_cache_body_get(vosk_recog_grammar_cache_t *cache, const apt_str_t *body, apr_uint32_t body_id)
+{
+	vosk_recog_grammar_t *grammar = NULL;
+	if(!body->buf || !body->length) {
+		return NULL;
+	}
+
+	apr_thread_mutex_lock(cache->mutex);
+	if(body_id) {
+		/* the same id stands for the same body, which then is not hashed again */
+		grammar = apr_hash_get(cache->ids,&body_id,sizeof(body_id));
+	}
+	if(!grammar) {
+		grammar = apr_hash_get(cache->table,body->buf,body->length);
+		if(grammar) {
+			vosk_recog_grammar_body_id_set(cache,grammar,body_id);
+		}
+	}
+	if(grammar) {
+		/* referenced under the mutex, so that it can not be evicted meanwhile */
+		grammar->last_used = ++cache->sequence;
+		apr_atomic_inc32(&grammar->ref_count);
+		apr_thread_mutex_unlock(cache->mutex);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Use Cached Grammar [%d] items",grammar->items->nelts);
+		return grammar;
+	}
+	apr_thread_mutex_unlock(cache->mutex);
+
+	/* compile without holding the mutex, other tasks may define other grammars meanwhile */
+	grammar = vosk_recog_grammar_compile(cache,body);
+	if(!grammar) {
+		return NULL;
+	}
+
+	apr_thread_mutex_lock(cache->mutex);
+	{
+		vosk_recog_grammar_t *cached = apr_hash_get(cache->table,grammar->body,grammar->body_length);
+		if(cached) {
+			/* compiled by another task in the meantime */
+			apr_pool_destroy(grammar->pool);
+			grammar = cached;
+		}
+		else {
+			if(apr_hash_count(cache->table) >= cache->max_count) {
+				vosk_recog_grammar_cache_evict(cache);
+			}
+			apr_hash_set(cache->table,grammar->body,grammar->body_length,grammar);
+		}
+	}
+	vosk_recog_grammar_body_id_set(cache,grammar,body_id);
+	grammar->last_used = ++cache->sequence;
+	apr_atomic_inc32(&grammar->ref_count);
+	apr_thread_mutex_unlock(cache->mutex);
+	return grammar;
+}
+
+vosk_recog_grammar_t* vosk_recog_grammar_cache_load(vosk_recog_grammar_cache_t *cache, const char *path)
+{
+	vosk_recog_grammar_t *grammar = NULL;
+	apr_pool_t *pool;
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	apt_str_t body;
+	apr_size_t length;
+
+	/* the document is only read to be compiled, the grammar keeps its own copy */
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_file_open(&file,path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Grammar [%s]",path);
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+	if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) == APR_SUCCESS && finfo.size > 0) {
+		length = (apr_size_t)finfo.size;
+		body.buf = apr_palloc(pool,length + 1);
+		if(apr_file_read_full(file,body.buf,length,&length) == APR_SUCCESS) {
+			body.buf[length] = '\0';
+			body.length = length;
+			grammar = vosk_recog_grammar_cache_get(cache,&body);
+		}
+	}
+	apr_file_close(file);
+	apr_pool_destroy(pool);
+	if(!grammar) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Load Grammar [%s]",path);
+	}
+	return grammar;
+}
+
+void vosk_recog_grammar_ref(vosk_recog_grammar_t *grammar)
+{
+	apr_atomic_inc32(&grammar->ref_count);
+}
+
+void vosk_recog_grammar_unref(vosk_recog_grammar_t *grammar)
+{
+	apr_atomic_dec32(&grammar->ref_count);
+}
+
+apr_uint32_t vosk_recog_grammar_hash_get(const vosk_recog_grammar_t *grammar)
+{
+	return grammar->hash;
+}
+
+const char* vosk_recog_grammar_phrases_get(const vosk_recog_grammar_t *grammar)
+{
+	return grammar->phrases;
+}
+
+apr_size_t vosk_recog_grammar_phrase_count_get(const vosk_recog_grammar_t *grammar)
+{
+	return grammar->phrases ? grammar->phrase_count : 0;
+}
+
+apr_size_t vosk_recog_grammar_size_get(const vosk_recog_grammar_t *grammar)
+{
+	return grammar->size;
+}
+
+const char* vosk_recog_grammar_interpret(const void *obj, const char *text, apr_pool_t *pool)
+{
+	const vosk_recog_grammar_t *grammar = obj;
+	const char *instance;
+	if(!grammar->fst || vosk_recog_fst_interpret(grammar->fst,text,&instance,pool) == FALSE) {
+		return NULL;
+	}
+	return instance;
+}
+
+apt_bool_t vosk_recog_grammar_fst_check(const vosk_recog_grammar_t *grammar)
+{
+	return grammar->fst ? TRUE : FALSE;
+}
+
+/** Compile FST of ITN grammar document */
+static vosk_recog_fst_t* vosk_recog_itn_compile(const char *body, apr_size_t length, apr_pool_t *pool)
+{
+	char errbuf[256];
+	apr_xml_parser *parser;
+	apr_xml_doc *doc = NULL;
+	apr_status_t rv;
+
+	if(vosk_recog_fst_text_check(body,length) == TRUE) {
+		return vosk_recog_fst_text_compile(body,length,pool);
+	}
+	parser = apr_xml_parser_create(pool);
+	if(!parser) {
+		return NULL;
+	}
+	rv = apr_xml_parser_feed(parser,body,length);
+	if(rv == APR_SUCCESS) {
+		rv = apr_xml_parser_done(parser,&doc);
+	}
+	if(rv != APR_SUCCESS || !doc) {
+		apr_xml_parser_geterror(parser,errbuf,sizeof(errbuf));
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse ITN Grammar: %s",errbuf);
+		return NULL;
+	}
+	return vosk_recog_fst_xml_compile(doc,pool);
+}
+
+vosk_recog_itn_t* vosk_recog_itn_load(vosk_recog_grammar_cache_t *cache, const char *path, apr_pool_t *pool)
+{
+	vosk_recog_itn_t *itn;
+	vosk_recog_fst_t *fst = NULL;
+	const char *fst_path = NULL;
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	apr_ssize_t hash_length;
+	apr_uint32_t hash;
+	apr_size_t length;
+	char *body;
+
+	if(apr_file_open(&file,path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open ITN Grammar [%s]",path);
+		return NULL;
+	}
+	if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) != APR_SUCCESS || finfo.size <= 0) {
+		apr_file_close(file);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Empty ITN Grammar [%s]",path);
+		return NULL;
+	}
+	length = (apr_size_t)finfo.size;
+	body = apr_palloc(pool,length + 1);
+	if(apr_file_read_full(file,body,length,&length) != APR_SUCCESS) {
+		apr_file_close(file);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Read ITN Grammar [%s]",path);
+		return NULL;
+	}
+	apr_file_close(file);
+	body[length] = '\0';
+	hash_length = (apr_ssize_t)length;
+	hash = apr_hashfunc_default(body,&hash_length);
+
+	/* the image is kept next to the ones of grammars, so that restarts map it rather than compile */
+	if(cache->fst_dir) {
+		fst_path = apr_psprintf(pool,"%s/itn-%08x-%"APR_SIZE_T_FMT".fst",cache->fst_dir,hash,length);
+		fst = vosk_recog_fst_map(fst_path,body,length,pool);
+	}
+	if(!fst) {
+		fst = vosk_recog_itn_compile(body,length,pool);
+		if(!fst) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Compile ITN Grammar [%s]",path);
+			return NULL;
+		}
+		if(fst_path) {
+			vosk_recog_fst_save(fst,body,length,fst_path,pool);
+		}
+	}
+
+	itn = apr_palloc(pool,sizeof(vosk_recog_itn_t));
+	itn->fst = fst;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Load ITN Grammar [%s] states [%"APR_SIZE_T_FMT"]",
+		path,vosk_recog_fst_state_count_get(fst));
+	return itn;
+}
+
+const char* vosk_recog_itn_interpret(const void *obj, const char *text, apr_pool_t *pool)
+{
+	const vosk_recog_itn_t *itn = obj;
+	return vosk_recog_fst_normalize(itn->fst,text,pool);
+}
+
+const char* vosk_recog_grammar_match(const vosk_recog_grammar_t *grammar, const char *text)
+{
+	int i;
+	for(i=0; i<grammar->items->nelts; i++) {
+		const vosk_recog_grammar_item_t *item = &APR_ARRAY_IDX(grammar->items,i,vosk_recog_grammar_item_t);
+		if(item->literal) {
+			/* "<item>." requires at least one character to follow the literal */
+			const char *found = strstr(text,item->literal);
+			if(found && found[item->literal_length] != '\0') {
+				return item->rule_id;
+			}
+		}
+		else if(regexec(item->regex,text,0,NULL,0) == 0) {
+			return item->rule_id;
+		}
+	}
+	return NULL;
+}
+
+/** Get value of the URI parameter (NULL if not set) */
+static const char* vosk_recog_dtmf_param_get(const char *params, const char *end, const char *name, apr_size_t *value)
+{
+	apr_size_t length = strlen(name);
+	const char *pos = params;
+	while(pos && pos < end) {
+		if((apr_size_t)(end - pos) > length && strncasecmp(pos,name,length) == 0 && pos[length] == '=') {
+			*value = (apr_size_t)strtol(pos + length + 1,NULL,10);
+			return pos;
+		}
+		pos = memchr(pos,';',end - pos);
+		if(pos) {
+			pos++;
+		}
+	}
+	return NULL;
+}
+
+apt_bool_t vosk_recog_dtmf_grammar_parse(const apt_str_t *body, vosk_recog_dtmf_grammar_t *grammar)
+{
+	const char *pos = body->buf;
+	const char *end = body->buf + body->length;
+	const char *line_end;
+	const char *type;
+	const char *params;
+	apr_size_t length;
+
+	if(!pos) {
+		return FALSE;
+	}
+	for(; pos < end; pos = line_end + 1) {
+		/* one URI per line, enclosed in angle brackets in the grammar-ref-list */
+		line_end = memchr(pos,'\n',end - pos);
+		if(!line_end) {
+			line_end = end;
+		}
+		while(pos < line_end && (*pos == ' ' || *pos == '\t' || *pos == '<')) {
+			pos++;
+		}
+		if((apr_size_t)(line_end - pos) <= sizeof(VOSK_RECOG_DTMF_URI_PREFIX) - 1 ||
+			strncasecmp(pos,VOSK_RECOG_DTMF_URI_PREFIX,sizeof(VOSK_RECOG_DTMF_URI_PREFIX) - 1) != 0) {
+			continue;
+		}
+		type = pos + sizeof(VOSK_RECOG_DTMF_URI_PREFIX) - 1;
+		params = memchr(type,'?',line_end - type);
+		if(params) {
+			params++;
+		}
+
+		grammar->min_length = 1;
+		grammar->max_length = VOSK_RECOG_DTMF_MAX_DIGITS;
+		grammar->boolean = FALSE;
+		if(line_end - type >= 7 && strncasecmp(type,"boolean",7) == 0) {
+			grammar->max_length = 1;
+			grammar->boolean = TRUE;
+			return TRUE;
+		}
+		if(line_end - type < 6 || strncasecmp(type,"digits",6) != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Unsupported DTMF Grammar [%.*s]",(int)(line_end - pos),pos);
+			continue;
+		}
+		if(vosk_recog_dtmf_param_get(params,line_end,"length",&length)) {
+			grammar->min_length = grammar->max_length = length;
+		}
+		if(vosk_recog_dtmf_param_get(params,line_end,"minlength",&length)) {
+			grammar->min_length = length;
+		}
+		if(vosk_recog_dtmf_param_get(params,line_end,"maxlength",&length)) {
+			grammar->max_length = length;
+		}
+		if(!grammar->max_length || grammar->max_length > VOSK_RECOG_DTMF_MAX_DIGITS) {
+			grammar->max_length = VOSK_RECOG_DTMF_MAX_DIGITS;
+		}
+		if(!grammar->min_length || grammar->min_length > grammar->max_length) {
+			grammar->min_length = 1;
+		}
+		return TRUE;
+	}
+	return FALSE;
+}
+
+const char* vosk_recog_grammar_uri_get(const apt_str_t *body, apr_pool_t *pool)
+{
+	const char *pos = body->buf;
+	const char *end = body->buf + body->length;
+	const char *line_end;
+	const char *uri_end;
+	apt_bool_t bracketed;
+
+	if(!pos) {
+		return NULL;
+	}
+	for(; pos < end; pos = line_end + 1) {
+		line_end = memchr(pos,'\n',end - pos);
+		if(!line_end) {
+			line_end = end;
+		}
+		bracketed = FALSE;
+		while(pos < line_end && (*pos == ' ' || *pos == '\t' || *pos == '<')) {
+			if(*pos == '<') {
+				bracketed = TRUE;
+			}
+			pos++;
+		}
+		if((line_end - pos > 7 && strncasecmp(pos,"http://",7) == 0) ||
+			(line_end - pos > 8 && strncasecmp(pos,"https://",8) == 0) ||
+			(line_end - pos > 8 && strncasecmp(pos,"session:",8) == 0) ||
+			(line_end - pos > 16 && strncasecmp(pos,"builtin:grammar/",16) == 0)) {
+			/* the URI of the grammar-ref-list is enclosed in angle brackets, followed by its params */
+			for(uri_end = pos; uri_end < line_end; uri_end++) {
+				if(bracketed == TRUE ? *uri_end == '>' : (*uri_end == ' ' || *uri_end == '\t' || *uri_end == '\r')) {
+					break;
+				}
+			}
+			return apr_pstrmemdup(pool,pos,uri_end - pos);
+		}
+	}
+	return NULL;
+}
+
+vosk_recog_dtmf_match_e vosk_recog_dtmf_grammar_match(const vosk_recog_dtmf_grammar_t *grammar, const char *digits, apr_size_t length, apt_bool_t timeout)
+{
+	apt_bool_t terminated = FALSE;
+	apr_size_t i;
+
+	if(length && grammar->term_char && digits[length-1] == grammar->term_char) {
+		terminated = TRUE;
+		length--;
+	}
+	for(i=0; i<length; i++) {
+		if(grammar->boolean == TRUE ? (digits[i] != '1' && digits[i] != '2') : (digits[i] < '0' || digits[i] > '9')) {
+			return VOSK_RECOG_DTMF_MATCH_NONE;
+		}
+	}
+	if(length > grammar->max_length) {
+		return VOSK_RECOG_DTMF_MATCH_NONE;
+	}
+	if(terminated == TRUE || timeout == TRUE) {
+		return length >= grammar->min_length ? VOSK_RECOG_DTMF_MATCH_FULL : VOSK_RECOG_DTMF_MATCH_NONE;
+	}
+	/* no term char can follow the max number of digits */
+	return length == grammar->max_length ? VOSK_RECOG_DTMF_MATCH_FULL : VOSK_RECOG_DTMF_MATCH_PARTIAL;
+}
@@ -0,0 +1,1335 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <apr_strings.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include <apr_atomic.h>
+#include <apr_file_info.h>
+#include <apr_mmap.h>
+#include "vosk_recog_model.h"
+#include "apt_numa.h"
+#include "apt_dir_layout.h"
+#include "mrcp_engine_impl.h"
+#include "mpf_codec_descriptor.h"
+#include "vosk_recog_log.h"
+
+#define MODEL_PARAM_PREFIX       "model."
+#define MODEL_PARAM_PREFIX_SIZE  (sizeof(MODEL_PARAM_PREFIX) - 1)
+#define RULE_PARAM_PREFIX        "model-rule."
+#define RULE_PARAM_PREFIX_SIZE   (sizeof(RULE_PARAM_PREFIX) - 1)
+
+#if defined(__linux__)
+#include <stdio.h>
+#include <sys/mman.h>
+#define VOSK_RECOG_MODEL_MADVISE
+#ifdef MADV_HUGEPAGE
+#define VOSK_RECOG_MODEL_HUGE_PAGES
+#endif
+#endif
+
+#if !defined(WIN32)
+#include <unistd.h>
+#include <errno.h>
+#define VOSK_RECOG_MODEL_OVERLAY
+#endif
+
+/** Prefix of the overlay directories of models in the var dir */
+#define VOSK_RECOG_MODEL_OVERLAY_PREFIX "vosk-model-"
+/** Default speed vs accuracy of a model */
+#define VOSK_RECOG_MODEL_DEFAULT_SPEED_VS_ACCURACY 0.5f
+
+/** Max depth of the subdirectories of a model mapped */
+#define VOSK_RECOG_MODEL_MAP_MAX_DEPTH 4
+
+/** Size of a transparent huge page (x86-64 and arm64 with 4K base pages) */
+#define VOSK_RECOG_MODEL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+#define VOSK_RECOG_MODEL_WATCH_THREAD_NAME "Vosk Model Watcher"
+
+/** Watcher of the directories of models */
+typedef struct vosk_recog_model_watch_t vosk_recog_model_watch_t;
+
+struct vosk_recog_model_watch_t {
+	/** Watcher thread */
+	apr_thread_t                   *thread;
+	/** Guards the running flag, signaled on stop */
+	apr_thread_mutex_t             *mutex;
+	/** Wakes the watcher up on stop */
+	apr_thread_cond_t              *cond;
+	/** Whether the watcher is running */
+	volatile apt_bool_t             running;
+	/** Interval the directories are checked at */
+	apr_interval_time_t             interval;
+	/** Handler called once a new version is loaded */
+	vosk_recog_model_load_handler_f load_handler;
+	/** Handler called before a replaced version is freed */
+	vosk_recog_model_free_handler_f free_handler;
+	/** Object to call the handlers with */
+	void                           *obj;
+	/** Pool new versions are allocated from (watcher thread context) */
+	apr_pool_t                     *pool;
+};
+
+/** Registry of models */
+struct vosk_recog_model_registry_t {
+	/** Table of models (vosk_recog_model_t*) by name */
+	apr_hash_t         *model_table;
+	/** Array of models (vosk_recog_model_t*) in order of configuration */
+	apr_array_header_t *model_list;
+	/** Default model */
+	vosk_recog_model_t *default_model;
+	/** Table of rules (arrays of vosk_recog_model_t*) by class of requests */
+	apr_hash_t         *rule_table;
+	/** Whether the files of models are mapped to the page cache before load */
+	apt_bool_t          cache_enabled;
+	/** Whether the memory of models is advised to be backed by transparent huge pages */
+	apt_bool_t          huge_pages;
+	/** Whether batch models are loaded for the batch (GPU) decoding backend */
+	apt_bool_t          batch_enabled;
+	/** Placement of models on NUMA nodes */
+	vosk_recog_numa_mode_e numa_mode;
+	/** Number of replicas per model (number of nodes in the replicate mode, 1 otherwise) */
+	apr_size_t          replica_count;
+	/** Directory layout, the overlay directories of models are made in the var dir of */
+	const apt_dir_layout_t *dir_layout;
+	/** Guards the current versions of models against release while being referenced */
+	apr_thread_mutex_t *mutex;
+	/** Watcher of the directories of models (NULL if not watched) */
+	vosk_recog_model_watch_t *watch;
+	/** Pool to allocate memory from */
+	apr_pool_t         *pool;
+};
+
+/** State of loading models shared by loader threads */
+typedef struct vosk_recog_model_loader_t vosk_recog_model_loader_t;
+
+struct vosk_recog_model_loader_t {
+	/** Registry to load models of */
+	vosk_recog_model_registry_t   *registry;
+	/** Index of the next model to take */
+	volatile apr_uint32_t          next;
+	/** Number of models failed to load */
+	volatile apr_uint32_t          failures;
+	/** Handler called once a model is loaded */
+	vosk_recog_model_load_handler_f handler;
+	/** Object to call the handler with */
+	void                          *obj;
+};
+
+static vosk_recog_model_t* vosk_recog_model_get(vosk_recog_model_registry_t *registry, const char *name)
+{
+	vosk_recog_model_t *model = apr_hash_get(registry->model_table,name,APR_HASH_KEY_STRING);
+	if(!model) {
+		model = apr_palloc(registry->pool,sizeof(vosk_recog_model_t));
+		model->name = apr_pstrdup(registry->pool,name);
+		model->path = NULL;
+		model->languages = apr_array_make(registry->pool,1,sizeof(const char*));
+		model->sample_rate = 0;
+		memset(&model->search,0,sizeof(model->search));
+		model->speed_vs_accuracy = VOSK_RECOG_MODEL_DEFAULT_SPEED_VS_ACCURACY;
+		model->load_path = NULL;
+		model->model = NULL;
+		model->batch_model = NULL;
+		model->map_pool = NULL;
+		model->mapped_size = 0;
+		model->replicas = NULL;
+		model->replica_count = 0;
+		model->numa_node = APT_NUMA_NODE_NONE;
+		/* the configured model is the first version of itself, referenced by the registry */
+		model->current = model;
+		model->refs = 1;
+		model->inode = 0;
+		model->mtime = 0;
+		model->capacity = 0;
+		model->recognizer_memory = 0;
+		model->seats = 0;
+		apr_hash_set(registry->model_table,model->name,APR_HASH_KEY_STRING,model);
+		APR_ARRAY_PUSH(registry->model_list,vosk_recog_model_t*) = model;
+	}
+	return model;
+}
+
+static void vosk_recog_model_languages_parse(vosk_recog_model_t *model, const char *value, apr_pool_t *pool)
+{
+	char *state;
+	char *languages = apr_pstrdup(pool,value);
+	char *language = apr_strtok(languages,", ",&state);
+	while(language) {
+		APR_ARRAY_PUSH(model->languages,const char*) = language;
+		language = apr_strtok(NULL,", ",&state);
+	}
+}
+
+/** Set decoder search setting by param name, return FALSE if the name is not of a search setting */
+static apt_bool_t vosk_recog_model_search_param_set(vosk_recog_model_search_t *search, const char *name, const char *value)
+{
+	if(strcasecmp(name,"beam") == 0) {
+		search->beam = (float)atof(value);
+	}
+	else if(strcasecmp(name,"lattice-beam") == 0) {
+		search->lattice_beam = (float)atof(value);
+	}
+	else if(strcasecmp(name,"max-active") == 0) {
+		search->max_active = atoi(value);
+	}
+	else if(strcasecmp(name,"frame-subsampling-factor") == 0) {
+		search->frame_subsampling_factor = atoi(value);
+	}
+	else {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Check whether any decoder search setting is overridden */
+static apt_bool_t vosk_recog_model_search_overridden(const vosk_recog_model_search_t *search)
+{
+	if(search->beam > 0 || search->lattice_beam > 0 || search->max_active > 0 || search->frame_subsampling_factor > 0) {
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/** Parse rules mapping classes of requests to the models declared before */
+static void vosk_recog_model_rules_parse(vosk_recog_model_registry_t *registry, apr_table_t *params, apr_pool_t *pool)
+{
+	int i;
+	const apr_array_header_t *header = apr_table_elts(params);
+	const apr_table_entry_t *entry = (const apr_table_entry_t*)header->elts;
+	for(i=0; i<header->nelts; i++) {
+		char *state;
+		char *names;
+		char *name;
+		const char *class_name;
+		apr_array_header_t *rule;
+		if(!entry[i].key || strncasecmp(entry[i].key,RULE_PARAM_PREFIX,RULE_PARAM_PREFIX_SIZE) != 0) {
+			continue;
+		}
+		class_name = entry[i].key + RULE_PARAM_PREFIX_SIZE;
+		if(*class_name == '\0' || !entry[i].val) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid Model Rule [%s]",entry[i].key);
+			continue;
+		}
+
+		rule = apr_array_make(pool,2,sizeof(vosk_recog_model_t*));
+		names = apr_pstrdup(pool,entry[i].val);
+		name = apr_strtok(names,", ",&state);
+		while(name) {
+			vosk_recog_model_t *model = vosk_recog_model_find(registry,name);
+			if(model) {
+				APR_ARRAY_PUSH(rule,vosk_recog_model_t*) = model;
+			}
+			else {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Such Model [%s] in Rule [%s]",name,entry[i].key);
+			}
+			name = apr_strtok(NULL,", ",&state);
+		}
+		if(apr_is_empty_array(rule)) {
+			continue;
+		}
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Add Model Rule [%s] [%s]",class_name,entry[i].val);
+		apr_hash_set(registry->rule_table,apr_pstrdup(pool,class_name),APR_HASH_KEY_STRING,rule);
+	}
+}
+
+vosk_recog_model_registry_t* vosk_recog_model_registry_create(const mrcp_engine_t *engine, apr_pool_t *pool)
+{
+	int i;
+	const char *default_name;
+	const mrcp_engine_config_t *config = mrcp_engine_config_get(engine);
+	vosk_recog_model_registry_t *registry = apr_palloc(pool,sizeof(vosk_recog_model_registry_t));
+	registry->model_table = apr_hash_make(pool);
+	registry->model_list = apr_array_make(pool,1,sizeof(vosk_recog_model_t*));
+	registry->default_model = NULL;
+	registry->rule_table = apr_hash_make(pool);
+	registry->cache_enabled = FALSE;
+	registry->huge_pages = FALSE;
+	registry->batch_enabled = FALSE;
+	registry->numa_mode = VOSK_RECOG_NUMA_NONE;
+	registry->replica_count = 1;
+	registry->dir_layout = engine->dir_layout;
+	registry->watch = NULL;
+	registry->pool = pool;
+	if(apr_thread_mutex_create(&registry->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+
+	if(config && config->params) {
+		const apr_array_header_t *header = apr_table_elts(config->params);
+		const apr_table_entry_t *entry = (const apr_table_entry_t*)header->elts;
+		for(i=0; i<header->nelts; i++) {
+			const char *attr;
+			char *name;
+			vosk_recog_model_t *model;
+			if(!entry[i].key || strncasecmp(entry[i].key,MODEL_PARAM_PREFIX,MODEL_PARAM_PREFIX_SIZE) != 0) {
+				continue;
+			}
+			attr = strrchr(entry[i].key,'.');
+			if(!attr || attr - entry[i].key <= (int)MODEL_PARAM_PREFIX_SIZE) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid Model Param [%s]",entry[i].key);
+				continue;
+			}
+			name = apr_pstrmemdup(pool,entry[i].key + MODEL_PARAM_PREFIX_SIZE,attr - entry[i].key - MODEL_PARAM_PREFIX_SIZE);
+			attr++;
+
+			model = vosk_recog_model_get(registry,name);
+			if(strcasecmp(attr,"path") == 0) {
+				model->path = apr_pstrdup(pool,entry[i].val);
+			}
+			else if(strcasecmp(attr,"language") == 0) {
+				vosk_recog_model_languages_parse(model,entry[i].val,pool);
+			}
+			else if(strcasecmp(attr,"sample-rate") == 0) {
+				model->sample_rate = atoi(entry[i].val);
+				if((mpf_sample_rate_mask_get((apr_uint16_t)model->sample_rate) & (MPF_SAMPLE_RATE_8000 | MPF_SAMPLE_RATE_16000)) == 0) {
+					apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported Sampling Rate [%s] [%s]",entry[i].key,entry[i].val);
+					model->sample_rate = 0;
+				}
+			}
+			else if(strcasecmp(attr,"speed-vs-accuracy") == 0) {
+				model->speed_vs_accuracy = (float)atof(entry[i].val);
+			}
+			else if(strcasecmp(attr,"capacity") == 0) {
+				model->capacity = (apr_uint32_t)atol(entry[i].val);
+			}
+			else if(strcasecmp(attr,"recognizer-memory") == 0) {
+				model->recognizer_memory = (apr_size_t)apr_atoi64(entry[i].val);
+			}
+			else if(vosk_recog_model_search_param_set(&model->search,attr,entry[i].val) == TRUE) {
+				/* overrides conf/model.conf of the model */
+			}
+			else {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unknown Model Param [%s]",entry[i].key);
+			}
+		}
+	}
+
+	if(apr_is_empty_array(registry->model_list)) {
+		vosk_recog_model_t *model = vosk_recog_model_get(registry,VOSK_RECOG_DEFAULT_MODEL_NAME);
+		model->path = VOSK_RECOG_DEFAULT_MODEL_PATH;
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"No Model Configured, use [%s]",model->path);
+	}
+
+	if(config && config->params) {
+		/* the engine params of search settings apply to the models not overriding them */
+		vosk_recog_model_search_t defaults;
+		const char *names[] = {"beam","lattice-beam","max-active","frame-subsampling-factor"};
+		memset(&defaults,0,sizeof(defaults));
+		for(i=0; i<(int)(sizeof(names)/sizeof(names[0])); i++) {
+			const char *value = mrcp_engine_param_get(engine,names[i]);
+			if(value) {
+				vosk_recog_model_search_param_set(&defaults,names[i],value);
+			}
+		}
+		for(i=0; i<registry->model_list->nelts; i++) {
+			vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+			if(model->search.beam <= 0) {
+				model->search.beam = defaults.beam;
+			}
+			if(model->search.lattice_beam <= 0) {
+				model->search.lattice_beam = defaults.lattice_beam;
+			}
+			if(model->search.max_active <= 0) {
+				model->search.max_active = defaults.max_active;
+			}
+			if(model->search.frame_subsampling_factor <= 0) {
+				model->search.frame_subsampling_factor = defaults.frame_subsampling_factor;
+			}
+		}
+	}
+
+	default_name = mrcp_engine_param_get(engine,"model-cache");
+	if(default_name && strcasecmp(default_name,"true") == 0) {
+		registry->cache_enabled = TRUE;
+	}
+
+	default_name = mrcp_engine_param_get(engine,"huge-pages");
+	if(default_name && strcasecmp(default_name,"true") == 0) {
+#ifdef VOSK_RECOG_MODEL_HUGE_PAGES
+		registry->huge_pages = TRUE;
+#else
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Huge Pages Not Supported, huge-pages is ignored");
+#endif
+	}
+
+	default_name = mrcp_engine_param_get(engine,"default-model");
+	if(default_name) {
+		registry->default_model = vosk_recog_model_find(registry,default_name);
+		if(!registry->default_model) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Such Default Model [%s]",default_name);
+		}
+	}
+	if(!registry->default_model) {
+		registry->default_model = APR_ARRAY_IDX(registry->model_list,0,vosk_recog_model_t*);
+	}
+
+	if(config && config->params) {
+		vosk_recog_model_rules_parse(registry,config->params,pool);
+	}
+	return registry;
+}
+
+/** Map the files of a directory read-only and shared, so that their pages are kept in the page cache */
+static void vosk_recog_model_dir_map(vosk_recog_model_t *model, const char *path, int depth, apt_bool_t huge_pages)
+{
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	char *file_path;
+	apr_file_t *file;
+	apr_mmap_t *mm;
+	apr_pool_t *pool = model->map_pool;
+
+	if(apr_dir_open(&dir,path,pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Model Dir [%s]",path);
+		return;
+	}
+	while(apr_dir_read(&finfo,APR_FINFO_NAME | APR_FINFO_TYPE | APR_FINFO_SIZE,dir) == APR_SUCCESS) {
+		if(!finfo.name || finfo.name[0] == '.') {
+			continue;
+		}
+		if(apr_filepath_merge(&file_path,path,finfo.name,APR_FILEPATH_NATIVE,pool) != APR_SUCCESS) {
+			continue;
+		}
+		if(finfo.filetype == APR_DIR) {
+			if(depth < VOSK_RECOG_MODEL_MAP_MAX_DEPTH) {
+				vosk_recog_model_dir_map(model,file_path,depth + 1,huge_pages);
+			}
+			continue;
+		}
+		if(finfo.filetype != APR_REG || finfo.size <= 0) {
+			continue;
+		}
+		if(apr_file_open(&file,file_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+			continue;
+		}
+		/* the mapping outlives the file, which is closed right away */
+		if(apr_mmap_create(&mm,file,0,(apr_size_t)finfo.size,APR_MMAP_READ,pool) == APR_SUCCESS) {
+#ifdef VOSK_RECOG_MODEL_MADVISE
+			/* read ahead, so that the parser is served from the page cache */
+			madvise(mm->mm,mm->size,MADV_WILLNEED);
+#endif
+#ifdef VOSK_RECOG_MODEL_HUGE_PAGES
+			if(huge_pages == TRUE && mm->size >= VOSK_RECOG_MODEL_HUGE_PAGE_SIZE) {
+				/* effective where the filesystem supports large folios, ignored otherwise */
+				madvise(mm->mm,mm->size,MADV_HUGEPAGE);
+			}
+#endif
+			model->mapped_size += mm->size;
+		}
+		apr_file_close(file);
+	}
+	apr_dir_close(dir);
+}
+
+/** Get the identity of the directory of a model, which changes once the directory is replaced or touched */
+static apt_bool_t vosk_recog_model_dir_stat(const char *path, apr_ino_t *inode, apr_time_t *mtime, apr_pool_t *pool)
+{
+	apr_finfo_t finfo;
+	/* symbolic links are followed, so that re-linking the path is noticed */
+	if(apr_stat(&finfo,path,APR_FINFO_INODE | APR_FINFO_MTIME,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	*inode = finfo.inode;
+	*mtime = finfo.mtime;
+	return TRUE;
+}
+
+#if defined(VOSK_RECOG_MODEL_OVERLAY)
+/** Check whether a line of model.conf sets an option */
+static apt_bool_t vosk_recog_model_conf_option_is(const char *line, const char *option)
+{
+	apr_size_t length = strlen(option);
+	if(strncmp(line,option,length) != 0) {
+		return FALSE;
+	}
+	return (line[length] == '=' || line[length] == ' ' || line[length] == '\0') ? TRUE : FALSE;
+}
+
+/** Check whether a line of model.conf is kept, that is, not overridden by the search settings */
+static apt_bool_t vosk_recog_model_conf_line_kept(const vosk_recog_model_search_t *search, const char *line)
+{
+	while(*line == ' ' || *line == '\t') {
+		line++;
+	}
+	if((search->beam > 0 && vosk_recog_model_conf_option_is(line,"--beam") == TRUE) ||
+		(search->lattice_beam > 0 && vosk_recog_model_conf_option_is(line,"--lattice-beam") == TRUE) ||
+		(search->max_active > 0 && vosk_recog_model_conf_option_is(line,"--max-active") == TRUE) ||
+		(search->frame_subsampling_factor > 0 && vosk_recog_model_conf_option_is(line,"--frame-subsampling-factor") == TRUE)) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Write conf/model.conf of the overlay directory, the one of the model with the search settings overridden */
+static apt_bool_t vosk_recog_model_conf_write(const vosk_recog_model_t *model, const char *overlay, apr_pool_t *pool)
+{
+	apr_file_t *file;
+	apr_finfo_t finfo;
+	char *content = NULL;
+	apr_size_t size;
+	const vosk_recog_model_search_t *search = &model->search;
+	const char *conf_path = apr_pstrcat(pool,model->path,"/conf/model.conf",NULL);
+	const char *overlay_path = apr_pstrcat(pool,overlay,"/conf/model.conf",NULL);
+	const char *tmp_path = apr_pstrcat(pool,overlay_path,".tmp",NULL);
+
+	if(apr_file_open(&file,conf_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) == APR_SUCCESS) {
+		if(apr_file_info_get(&finfo,APR_FINFO_SIZE,file) == APR_SUCCESS) {
+			size = (apr_size_t)finfo.size;
+			content = apr_palloc(pool,size + 1);
+			if(apr_file_read_full(file,content,size,&size) != APR_SUCCESS) {
+				size = 0;
+			}
+			content[size] = '\0';
+		}
+		apr_file_close(file);
+	}
+
+	/* written aside and renamed, so that a version being loaded never reads a partial file */
+	if(apr_file_open(&file,tmp_path,APR_FOPEN_WRITE | APR_FOPEN_CREATE | APR_FOPEN_TRUNCATE | APR_FOPEN_BINARY,APR_OS_DEFAULT,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	if(content) {
+		char *state;
+		char *line = apr_strtok(content,"\r\n",&state);
+		while(line) {
+			if(vosk_recog_model_conf_line_kept(search,line) == TRUE) {
+				apr_file_printf(file,"%s\n",line);
+			}
+			line = apr_strtok(NULL,"\r\n",&state);
+		}
+	}
+	if(search->beam > 0) {
+		apr_file_printf(file,"--beam=%.2f\n",search->beam);
+	}
+	if(search->lattice_beam > 0) {
+		apr_file_printf(file,"--lattice-beam=%.2f\n",search->lattice_beam);
+	}
+	if(search->max_active > 0) {
+		apr_file_printf(file,"--max-active=%d\n",search->max_active);
+	}
+	if(search->frame_subsampling_factor > 0) {
+		apr_file_printf(file,"--frame-subsampling-factor=%d\n",search->frame_subsampling_factor);
+	}
+	apr_file_close(file);
+	return apr_file_rename(tmp_path,overlay_path,pool) == APR_SUCCESS ? TRUE : FALSE;
+}
+
+/** Link the entries of a directory from another one, except the one named skip */
+static apt_bool_t vosk_recog_model_dir_link(const char *from, const char *to, const char *skip, apr_pool_t *pool)
+{
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	apt_bool_t status = TRUE;
+	if(apr_dir_open(&dir,from,pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	while(apr_dir_read(&finfo,APR_FINFO_NAME,dir) == APR_SUCCESS) {
+		const char *target;
+		const char *link;
+		if(!finfo.name || strcmp(finfo.name,".") == 0 || strcmp(finfo.name,"..") == 0) {
+			continue;
+		}
+		if(skip && strcmp(finfo.name,skip) == 0) {
+			continue;
+		}
+		target = apr_pstrcat(pool,from,"/",finfo.name,NULL);
+		link = apr_pstrcat(pool,to,"/",finfo.name,NULL);
+		/* the link made by the previous load is replaced, the entry may be gone or re-linked meanwhile */
+		apr_file_remove(link,pool);
+		if(symlink(target,link) != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Link [%s] to [%s] [%d]",link,target,errno);
+			status = FALSE;
+			break;
+		}
+	}
+	apr_dir_close(dir);
+	return status;
+}
+#endif
+
+/**
+ * Make the overlay directory of a model with the search settings overridden (single loader context).
+ * @return the path to load the model from, the path of the model itself if not overridden or on failure
+ */
+static const char* vosk_recog_model_overlay_make(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model, apr_pool_t *pool)
+{
+#if defined(VOSK_RECOG_MODEL_OVERLAY)
+	char *path;
+	char *overlay;
+	const char *conf_dir;
+	if(!model->path || vosk_recog_model_search_overridden(&model->search) == FALSE) {
+		return model->path;
+	}
+	if(!registry->dir_layout ||
+		apr_filepath_merge(&path,NULL,model->path,APR_FILEPATH_NOTRELATIVE,pool) != APR_SUCCESS) {
+		return model->path;
+	}
+	overlay = apt_vardir_filepath_get(registry->dir_layout,apr_pstrcat(pool,VOSK_RECOG_MODEL_OVERLAY_PREFIX,model->name,NULL),pool);
+	if(!overlay) {
+		return model->path;
+	}
+
+	/* links are made to the absolute path, so that the overlay is independent of the working directory */
+	conf_dir = apr_pstrcat(pool,path,"/conf",NULL);
+	if(apr_dir_make_recursive(apr_pstrcat(pool,overlay,"/conf",NULL),APR_OS_DEFAULT,pool) != APR_SUCCESS ||
+		vosk_recog_model_dir_link(path,overlay,"conf",pool) == FALSE ||
+		vosk_recog_model_dir_link(conf_dir,apr_pstrcat(pool,overlay,"/conf",NULL),"model.conf",pool) == FALSE ||
+		vosk_recog_model_conf_write(model,overlay,pool) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Make Overlay of Model [%s] in [%s], search settings are not overridden",model->name,overlay);
+		return model->path;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Made Overlay of Model [%s] in [%s] beam [%.2f] lattice-beam [%.2f] max-active [%d] frame-subsampling-factor [%d]",
+		model->name,
+		overlay,
+		model->search.beam,
+		model->search.lattice_beam,
+		model->search.max_active,
+		model->search.frame_subsampling_factor);
+	return overlay;
+#else
+	if(vosk_recog_model_search_overridden(&model->search) == TRUE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Search Settings of Model [%s] are not overridden on this platform",model->name);
+	}
+	return model->path;
+#endif
+}
+
+#ifdef VOSK_RECOG_MODEL_HUGE_PAGES
+/** Get the start addresses of the anonymous private mappings of the process, in ascending order */
+static apr_array_header_t* vosk_recog_model_anon_maps_get(apr_pool_t *pool)
+{
+	char line[512];
+	unsigned long start;
+	unsigned long end;
+	unsigned long inode;
+	char perms[5];
+	int offset;
+	apr_array_header_t *maps;
+	FILE *file = fopen("/proc/self/maps","r");
+	if(!file) {
+		return NULL;
+	}
+
+	maps = apr_array_make(pool,256,sizeof(unsigned long) * 2);
+	while(fgets(line,sizeof(line),file)) {
+		offset = 0;
+		if(sscanf(line,"%lx-%lx %4s %*x %*x:%*x %lu %n",&start,&end,perms,&inode,&offset) < 4) {
+			continue;
+		}
+		/* named mappings, such as files, [heap] and [stack], are skipped */
+		if(inode != 0 || (line[offset] != '\0' && line[offset] != '\n')) {
+			continue;
+		}
+		if(perms[0] != 'r' || perms[1] != 'w' || perms[3] != 'p') {
+			continue;
+		}
+		{
+			unsigned long *range = apr_array_push(maps);
+			range[0] = start;
+			range[1] = end;
+		}
+	}
+	fclose(file);
+	return maps;
+}
+
+/**
+ * Advise the anonymous mappings made by the load of a model to be backed by transparent huge pages,
+ * so that the weights and the FSTs accessed at random while decoding take fewer TLB entries.
+ * The mappings made meanwhile by other loader threads are advised as well, which are models too.
+ */
+static void vosk_recog_model_huge_pages_advise(vosk_recog_model_t *model, const apr_array_header_t *before, apr_pool_t *pool)
+{
+	apr_array_header_t *after = vosk_recog_model_anon_maps_get(pool);
+	apr_size_t advised = 0;
+	apr_size_t count = 0;
+	int i;
+	int j = 0;
+	if(!before || !after) {
+		return;
+	}
+
+	for(i=0; i<after->nelts; i++) {
+		const unsigned long *range = (const unsigned long*)after->elts + i * 2;
+		unsigned long start = (range[0] + VOSK_RECOG_MODEL_HUGE_PAGE_SIZE - 1) & ~(unsigned long)(VOSK_RECOG_MODEL_HUGE_PAGE_SIZE - 1);
+		unsigned long end = range[1] & ~(unsigned long)(VOSK_RECOG_MODEL_HUGE_PAGE_SIZE - 1);
+		/* both lists are sorted, so the mappings present before the load are skipped in a single pass */
+		while(j < before->nelts && ((const unsigned long*)before->elts)[j * 2] < range[0]) {
+			j++;
+		}
+		if(j < before->nelts && ((const unsigned long*)before->elts)[j * 2] == range[0]) {
+			continue;
+		}
+		if(end <= start) {
+			continue;
+		}
+		if(madvise((void*)start,end - start,MADV_HUGEPAGE) != 0) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Advise Huge Pages for Model [%s] errno [%d]",model->name,errno);
+			return;
+		}
+		advised += end - start;
+		count++;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Advised Huge Pages for Model [%s] [%"APR_SIZE_T_FMT" bytes] in [%"APR_SIZE_T_FMT"] mappings",
+		model->name,advised,count);
+}
+#endif
+
+static apt_bool_t vosk_recog_model_load(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model, apr_pool_t *pool)
+{
+	apr_time_t start;
+	const char *load_path;
+	apt_bool_t batch = registry->batch_enabled;
+#ifdef VOSK_RECOG_MODEL_HUGE_PAGES
+	apr_array_header_t *maps = NULL;
+#endif
+	if(model->model || model->batch_model) {
+		return TRUE;
+	}
+	if(!model->path) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Path Set for Model [%s]",model->name);
+		return FALSE;
+	}
+
+	/* taken before load, so that a change made meanwhile is picked by the next check */
+	vosk_recog_model_dir_stat(model->path,&model->inode,&model->mtime,pool);
+	start = apr_time_now();
+	if(model->map_pool && !model->mapped_size) {
+		vosk_recog_model_dir_map(model,model->path,0,registry->huge_pages);
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Mapped Model [%s] [%"APR_SIZE_T_FMT" bytes] in [%"APR_TIME_T_FMT" ms]",
+			model->name,
+			model->mapped_size,
+			apr_time_as_msec(apr_time_now() - start));
+	}
+
+	load_path = model->load_path ? model->load_path : model->path;
+#ifdef VOSK_RECOG_MODEL_HUGE_PAGES
+	if(registry->huge_pages == TRUE) {
+		maps = vosk_recog_model_anon_maps_get(pool);
+	}
+#endif
+	if(batch == TRUE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Load Batch Model [%s] from [%s]",model->name,load_path);
+		model->batch_model = vosk_batch_model_new(load_path);
+	}
+	else {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Load Model [%s] from [%s]",model->name,load_path);
+		model->model = vosk_model_new(load_path);
+	}
+	if(!model->model && !model->batch_model) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Load Model [%s] from [%s]",model->name,model->path);
+		return FALSE;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Model Loaded [%s] in [%"APR_TIME_T_FMT" ms]",
+		model->name,
+		apr_time_as_msec(apr_time_now() - start));
+#ifdef VOSK_RECOG_MODEL_HUGE_PAGES
+	if(maps) {
+		vosk_recog_model_huge_pages_advise(model,maps,pool);
+	}
+#endif
+	return TRUE;
+}
+
+/** Load model (replica) on its node and call the handler (loader or watcher thread context) */
+static apt_bool_t vosk_recog_model_place(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model, vosk_recog_model_load_handler_f handler, void *obj, apr_pool_t *pool)
+{
+	apt_bool_t status;
+	/* the memory of the model, and of the recognizers warmed up by the handler, is placed by the policy */
+	if(registry->numa_mode == VOSK_RECOG_NUMA_INTERLEAVE) {
+		apt_numa_memory_policy_set(APT_NUMA_NODE_INTERLEAVE);
+	}
+	else if(model->numa_node != APT_NUMA_NODE_NONE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Place Model [%s] on Node [%d]",model->name,model->numa_node);
+		apt_numa_memory_policy_set(model->numa_node);
+	}
+	status = vosk_recog_model_load(registry,model,pool);
+	if(status == TRUE && handler) {
+		handler(model,obj);
+	}
+	if(registry->numa_mode != VOSK_RECOG_NUMA_NONE) {
+		apt_numa_memory_policy_set(APT_NUMA_NODE_NONE);
+	}
+	return status;
+}
+
+/** Take models (replicas) one by one until none is left */
+static void vosk_recog_model_loader_run(vosk_recog_model_loader_t *loader)
+{
+	vosk_recog_model_registry_t *registry = loader->registry;
+	const apr_array_header_t *model_list = registry->model_list;
+	apr_uint32_t count = (apr_uint32_t)(model_list->nelts * registry->replica_count);
+	apr_uint32_t i;
+	while((i = apr_atomic_inc32(&loader->next)) < count) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(model_list,i / registry->replica_count,vosk_recog_model_t*);
+		if(model->replicas) {
+			model = model->replicas[i % registry->replica_count];
+		}
+		if(vosk_recog_model_place(registry,model,loader->handler,loader->obj,registry->pool) == FALSE) {
+			apr_atomic_inc32(&loader->failures);
+		}
+	}
+}
+
+/** Create replicas of a model, one per node, the first one being the model itself */
+static void vosk_recog_model_replicas_make(vosk_recog_model_t *model, apr_size_t count, apr_pool_t *pool)
+{
+	apr_size_t node;
+	model->replicas = apr_palloc(pool,sizeof(vosk_recog_model_t*) * count);
+	model->replicas[0] = model;
+	model->replica_count = count;
+	model->numa_node = 0;
+	for(node=1; node<count; node++) {
+		vosk_recog_model_t *replica = apr_palloc(pool,sizeof(vosk_recog_model_t));
+		/* the replicas share the array, so that the version is found by any of them */
+		*replica = *model;
+		/* the files are mapped once, the pages are shared by the replicas */
+		replica->map_pool = NULL;
+		replica->mapped_size = 0;
+		replica->numa_node = (int)node;
+		model->replicas[node] = replica;
+	}
+}
+
+/** Create replicas of the models */
+static void vosk_recog_model_replicas_create(vosk_recog_model_registry_t *registry)
+{
+	int i;
+	for(i=0; i<registry->model_list->nelts; i++) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		if(!model->replicas) {
+			vosk_recog_model_replicas_make(model,registry->replica_count,registry->pool);
+		}
+	}
+}
+
+static void* APR_THREAD_FUNC vosk_recog_model_loader_thread_proc(apr_thread_t *thread, void *data)
+{
+#if APR_HAS_SETTHREADNAME
+	apr_thread_name_set("Vosk Loader");
+#endif
+	vosk_recog_model_loader_run(data);
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+apt_bool_t vosk_recog_model_registry_load(vosk_recog_model_registry_t *registry, apr_size_t thread_count, vosk_recog_model_load_handler_f handler, void *obj)
+{
+	vosk_recog_model_loader_t loader;
+	apr_thread_t **threads = NULL;
+	apr_pool_t *pool = NULL;
+	apr_size_t started = 0;
+	apr_size_t i;
+
+	loader.registry = registry;
+	loader.next = 0;
+	loader.failures = 0;
+	loader.handler = handler;
+	loader.obj = obj;
+
+	for(i=0; i<(apr_size_t)registry->model_list->nelts; i++) {
+		/* overlays are made in advance, as the variants of a model may be loaded at once */
+		vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		model->load_path = vosk_recog_model_overlay_make(registry,model,registry->pool);
+	}
+
+	if(registry->cache_enabled == TRUE) {
+		/* pools of mappings are created in advance, as loader threads must not create subpools at once */
+		for(i=0; i<(apr_size_t)registry->model_list->nelts; i++) {
+			vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+			if(!model->map_pool) {
+				apr_pool_create(&model->map_pool,registry->pool);
+			}
+		}
+	}
+
+	if(registry->batch_enabled == TRUE) {
+		/* the device is selected once per process, before any batch model is loaded */
+		vosk_gpu_init();
+	}
+	if(registry->replica_count > 1) {
+		vosk_recog_model_replicas_create(registry);
+	}
+
+	if(thread_count > (apr_size_t)registry->model_list->nelts * registry->replica_count) {
+		thread_count = registry->model_list->nelts * registry->replica_count;
+	}
+	/* the calling thread is one of the loaders */
+	if(thread_count > 1 && apr_pool_create(&pool,registry->pool) == APR_SUCCESS) {
+		threads = apr_palloc(pool,sizeof(apr_thread_t*) * (thread_count - 1));
+		for(; started < thread_count - 1; started++) {
+			if(apr_thread_create(&threads[started],NULL,vosk_recog_model_loader_thread_proc,&loader,pool) != APR_SUCCESS) {
+				apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Model Loader Thread");
+				break;
+			}
+		}
+	}
+
+	vosk_recog_model_loader_run(&loader);
+
+	for(i=0; i<started; i++) {
+		apr_status_t rv;
+		apr_thread_join(&rv,threads[i]);
+	}
+	if(pool) {
+		apr_pool_destroy(pool);
+	}
+	return apr_atomic_read32(&loader.failures) ? FALSE : TRUE;
+}
+
+/** Free the loaded model */
+static void vosk_recog_model_unload(vosk_recog_model_t *model)
+{
+	if(model->model) {
+		vosk_model_free(model->model);
+		model->model = NULL;
+	}
+	if(model->batch_model) {
+		vosk_batch_model_free(model->batch_model);
+		model->batch_model = NULL;
+	}
+}
+
+/** Free the loaded version and its replicas */
+static void vosk_recog_model_version_unload(vosk_recog_model_t *version)
+{
+	apr_size_t node;
+	for(node=1; node<version->replica_count; node++) {
+		vosk_recog_model_unload(version->replicas[node]);
+	}
+	vosk_recog_model_unload(version);
+	if(version->map_pool) {
+		/* unmap the files */
+		apr_pool_clear(version->map_pool);
+		version->mapped_size = 0;
+	}
+}
+
+/** Free the version the last reference is dropped to (the context it is dropped in) */
+static void vosk_recog_model_version_free(vosk_recog_model_registry_t *registry, vosk_recog_model_t *version)
+{
+	apr_size_t node;
+	vosk_recog_model_watch_t *watch = registry->watch;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Free Model Version [%s]",version->name);
+	if(watch && watch->free_handler) {
+		watch->free_handler(version,watch->obj);
+		for(node=1; node<version->replica_count; node++) {
+			watch->free_handler(version->replicas[node],watch->obj);
+		}
+	}
+	vosk_recog_model_version_unload(version);
+}
+
+void vosk_recog_model_registry_unload(vosk_recog_model_registry_t *registry)
+{
+	int i;
+	for(i=0; i<registry->model_list->nelts; i++) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		vosk_recog_model_version_unload(model->current);
+	}
+}
+
+vosk_recog_model_t* vosk_recog_model_acquire(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model)
+{
+	vosk_recog_model_t *version;
+	/* the version can not be released by the watcher, till it is referenced */
+	apr_thread_mutex_lock(registry->mutex);
+	version = model->current;
+	apr_atomic_inc32(&version->refs);
+	apr_thread_mutex_unlock(registry->mutex);
+	return version;
+}
+
+void vosk_recog_model_release(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model)
+{
+	/* the version is referenced as a whole, the first replica being the version itself */
+	vosk_recog_model_t *version = model->replicas ? model->replicas[0] : model;
+	if(apr_atomic_dec32(&version->refs) == 0) {
+		vosk_recog_model_version_free(registry,version);
+	}
+}
+
+/** Load a new version of a configured model (watcher thread context) */
+static apt_bool_t vosk_recog_model_reload(vosk_recog_model_registry_t *registry, vosk_recog_model_t *model, apr_pool_t *pool)
+{
+	vosk_recog_model_watch_t *watch = registry->watch;
+	vosk_recog_model_t *version;
+	vosk_recog_model_t *replaced;
+	apr_size_t node;
+
+	/* the configuration is shared by the versions */
+	version = apr_palloc(watch->pool,sizeof(vosk_recog_model_t));
+	*version = *model;
+	version->model = NULL;
+	version->batch_model = NULL;
+	version->map_pool = NULL;
+	version->mapped_size = 0;
+	version->replicas = NULL;
+	version->replica_count = 0;
+	version->numa_node = APT_NUMA_NODE_NONE;
+	version->current = NULL;
+	version->refs = 1;
+	/* conf/model.conf of the changed directory is rewritten, before the replicas copy the path */
+	version->load_path = vosk_recog_model_overlay_make(registry,version,watch->pool);
+	if(registry->cache_enabled == TRUE) {
+		apr_pool_create(&version->map_pool,watch->pool);
+	}
+	if(registry->replica_count > 1) {
+		vosk_recog_model_replicas_make(version,registry->replica_count,watch->pool);
+	}
+
+	apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Reload Model [%s] from [%s]",model->name,model->path);
+	if(vosk_recog_model_place(registry,version,watch->load_handler,watch->obj,pool) == FALSE) {
+		/* the current version is kept, till the directory is changed again */
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Reload Model [%s], keep the current version",model->name);
+		model->current->inode = version->inode;
+		model->current->mtime = version->mtime;
+		vosk_recog_model_version_free(registry,version);
+		if(version->map_pool) {
+			apr_pool_destroy(version->map_pool);
+		}
+		return FALSE;
+	}
+	/* a replica failed to load is substituted by the version itself */
+	for(node=1; node<version->replica_count; node++) {
+		vosk_recog_model_place(registry,version->replicas[node],watch->load_handler,watch->obj,pool);
+	}
+
+	/* new requests are switched at once, the requests in progress keep the replaced version */
+	apr_thread_mutex_lock(registry->mutex);
+	replaced = model->current;
+	model->current = version;
+	apr_thread_mutex_unlock(registry->mutex);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Model Reloaded [%s]",model->name);
+
+	if(replaced->map_pool) {
+		/* the files have been parsed, the mappings of the replaced version are no longer needed */
+		if(replaced == model) {
+			apr_pool_clear(replaced->map_pool);
+		}
+		else {
+			apr_pool_destroy(replaced->map_pool);
+			replaced->map_pool = NULL;
+		}
+		replaced->mapped_size = 0;
+	}
+	vosk_recog_model_release(registry,replaced);
+	return TRUE;
+}
+
+/** Reload the models whose directories are changed and settled (watcher thread context) */
+static void vosk_recog_model_watch_check(vosk_recog_model_registry_t *registry, apr_pool_t *pool)
+{
+	int i;
+	apr_ino_t inode;
+	apr_time_t mtime;
+	for(i=0; i<registry->model_list->nelts; i++) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		/* the current version is only replaced by the watcher itself */
+		vosk_recog_model_t *version = model->current;
+		if(!model->path || vosk_recog_model_dir_stat(model->path,&inode,&mtime,pool) == FALSE) {
+			continue;
+		}
+		if(inode == version->inode && mtime == version->mtime) {
+			continue;
+		}
+		/* the directory must not be modified within the last interval, so that a copy in progress is not loaded */
+		if(apr_time_now() - mtime < registry->watch->interval) {
+			continue;
+		}
+		vosk_recog_model_reload(registry,model,pool);
+		apr_pool_clear(pool);
+		if(registry->watch->running == FALSE) {
+			break;
+		}
+	}
+}
+
+static void* APR_THREAD_FUNC vosk_recog_model_watch_thread_proc(apr_thread_t *thread, void *data)
+{
+	vosk_recog_model_registry_t *registry = data;
+	vosk_recog_model_watch_t *watch = registry->watch;
+	apr_pool_t *pool = NULL;
+#if APR_HAS_SETTHREADNAME
+	apr_thread_name_set(VOSK_RECOG_MODEL_WATCH_THREAD_NAME);
+#endif
+	apr_pool_create(&pool,watch->pool);
+	apr_thread_mutex_lock(watch->mutex);
+	while(watch->running == TRUE) {
+		apr_thread_cond_timedwait(watch->cond,watch->mutex,watch->interval);
+		if(watch->running == FALSE) {
+			break;
+		}
+		/* models are loaded without holding the mutex, so that stop is only delayed by a reload in progress */
+		apr_thread_mutex_unlock(watch->mutex);
+		vosk_recog_model_watch_check(registry,pool);
+		apr_pool_clear(pool);
+		apr_thread_mutex_lock(watch->mutex);
+	}
+	apr_thread_mutex_unlock(watch->mutex);
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+apt_bool_t vosk_recog_model_registry_watch_start(
+				vosk_recog_model_registry_t *registry,
+				apr_interval_time_t interval,
+				vosk_recog_model_load_handler_f load_handler,
+				vosk_recog_model_free_handler_f free_handler,
+				void *obj)
+{
+	vosk_recog_model_watch_t *watch;
+	apr_pool_t *pool;
+	if(registry->watch || interval <= 0) {
+		return FALSE;
+	}
+	/* new versions are allocated from a pool of the watcher, the registry pool is not touched by the thread */
+	if(apr_pool_create(&pool,registry->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	watch = apr_palloc(pool,sizeof(vosk_recog_model_watch_t));
+	watch->thread = NULL;
+	watch->running = TRUE;
+	watch->interval = interval;
+	watch->load_handler = load_handler;
+	watch->free_handler = free_handler;
+	watch->obj = obj;
+	watch->pool = pool;
+	if(apr_thread_mutex_create(&watch->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS ||
+		apr_thread_cond_create(&watch->cond,pool) != APR_SUCCESS) {
+		apr_pool_destroy(pool);
+		return FALSE;
+	}
+	registry->watch = watch;
+	if(apr_thread_create(&watch->thread,NULL,vosk_recog_model_watch_thread_proc,registry,pool) != APR_SUCCESS) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Model Watcher Thread");
+		registry->watch = NULL;
+		apr_pool_destroy(pool);
+		return FALSE;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Watch Models [%"APR_TIME_T_FMT" sec]",apr_time_sec(interval));
+	return TRUE;
+}
+
+void vosk_recog_model_registry_watch_stop(vosk_recog_model_registry_t *registry)
+{
+	vosk_recog_model_watch_t *watch = registry->watch;
+	apr_status_t rv;
+	if(!watch || !watch->thread) {
+		return;
+	}
+	apr_thread_mutex_lock(watch->mutex);
+	watch->running = FALSE;
+	apr_thread_cond_signal(watch->cond);
+	apr_thread_mutex_unlock(watch->mutex);
+	apr_thread_join(&rv,watch->thread);
+	watch->thread = NULL;
+	/* the watch is kept, so that the replaced versions still referenced are freed through the handler */
+}
+
+void vosk_recog_model_registry_batch_enable(vosk_recog_model_registry_t *registry)
+{
+	registry->batch_enabled = TRUE;
+}
+
+void vosk_recog_model_registry_numa_set(vosk_recog_model_registry_t *registry, vosk_recog_numa_mode_e mode, apr_size_t node_count)
+{
+	registry->numa_mode = mode;
+	registry->replica_count = 1;
+	if(mode == VOSK_RECOG_NUMA_REPLICATE && node_count > 1) {
+		registry->replica_count = node_count;
+	}
+}
+
+vosk_recog_model_t* vosk_recog_model_replica_get(vosk_recog_model_t *model, int numa_node)
+{
+	if(model->replicas && numa_node >= 0 && (apr_size_t)numa_node < model->replica_count) {
+		vosk_recog_model_t *replica = model->replicas[numa_node];
+		/* a replica failed to load is substituted by the model itself */
+		if(replica->model || replica->batch_model) {
+			return replica;
+		}
+	}
+	return model;
+}
+
+vosk_recog_model_t* vosk_recog_model_find(const vosk_recog_model_registry_t *registry, const char *name)
+{
+	return apr_hash_get(registry->model_table,name,APR_HASH_KEY_STRING);
+}
+
+vosk_recog_model_t* vosk_recog_model_find_by_language(const vosk_recog_model_registry_t *registry, const char *language, int sample_rate)
+{
+	int i, j;
+	int score;
+	int best_score = 0;
+	apr_size_t primary_size;
+	vosk_recog_model_t *candidate = NULL;
+	if(!language || *language == '\0') {
+		return NULL;
+	}
+
+	primary_size = strcspn(language,"-_");
+	for(i=0; i<registry->model_list->nelts; i++) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		for(j=0; j<model->languages->nelts; j++) {
+			const char *model_language = APR_ARRAY_IDX(model->languages,j,const char*);
+			/* language match outweighs sampling rate match */
+			if(strcasecmp(model_language,language) == 0) {
+				score = 4;
+			}
+			else if(strncasecmp(model_language,language,primary_size) == 0 &&
+				strcspn(model_language,"-_") == primary_size) {
+				score = 2;
+			}
+			else {
+				continue;
+			}
+			if(!sample_rate || !model->sample_rate || model->sample_rate == sample_rate) {
+				score++;
+			}
+			if(score > best_score) {
+				best_score = score;
+				candidate = model;
+			}
+		}
+	}
+	return candidate;
+}
+
+vosk_recog_model_t* vosk_recog_model_variant_find(const vosk_recog_model_registry_t *registry, vosk_recog_model_t *model, float speed_vs_accuracy)
+{
+	int i;
+	float distance;
+	float best_distance;
+	vosk_recog_model_t *candidate = model;
+	if(!model->path) {
+		return model;
+	}
+
+	best_distance = model->speed_vs_accuracy - speed_vs_accuracy;
+	if(best_distance < 0) {
+		best_distance = -best_distance;
+	}
+	for(i=0; i<registry->model_list->nelts; i++) {
+		vosk_recog_model_t *variant = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		if(variant == model || !variant->path || strcmp(variant->path,model->path) != 0 ||
+			variant->sample_rate != model->sample_rate) {
+			continue;
+		}
+		distance = variant->speed_vs_accuracy - speed_vs_accuracy;
+		if(distance < 0) {
+			distance = -distance;
+		}
+		if(distance < best_distance) {
+			best_distance = distance;
+			candidate = variant;
+		}
+	}
+	return candidate;
+}
+
+int vosk_recog_model_sample_rates_get(const vosk_recog_model_registry_t *registry)
+{
+	int i;
+	int rates = MPF_SAMPLE_RATE_NONE;
+	for(i=0; i<registry->model_list->nelts; i++) {
+		const vosk_recog_model_t *model = APR_ARRAY_IDX(registry->model_list,i,vosk_recog_model_t*);
+		if(!model->sample_rate) {
+			return MPF_SAMPLE_RATE_8000 | MPF_SAMPLE_RATE_16000;
+		}
+		rates |= mpf_sample_rate_mask_get((apr_uint16_t)model->sample_rate);
+	}
+	return rates;
+}
+
+const apr_array_header_t* vosk_recog_model_list_get(const vosk_recog_model_registry_t *registry)
+{
+	return registry->model_list;
+}
+
+vosk_recog_model_t* vosk_recog_model_default_get(const vosk_recog_model_registry_t *registry)
+{
+	return registry->default_model;
+}
+
+/** Check whether model serves language, by the primary subtag at least (any language, if none is declared) */
+static apt_bool_t vosk_recog_model_language_check(const vosk_recog_model_t *model, const char *language)
+{
+	int i;
+	apr_size_t primary_size;
+	if(!language || *language == '\0' || apr_is_empty_array(model->languages)) {
+		return TRUE;
+	}
+	primary_size = strcspn(language,"-_");
+	for(i=0; i<model->languages->nelts; i++) {
+		const char *model_language = APR_ARRAY_IDX(model->languages,i,const char*);
+		if(strncasecmp(model_language,language,primary_size) == 0 &&
+			strcspn(model_language,"-_") == primary_size) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+vosk_recog_model_t* vosk_recog_model_rule_find(const vosk_recog_model_registry_t *registry, const char *class_name, const char *language)
+{
+	int i;
+	const apr_array_header_t *rule = apr_hash_get(registry->rule_table,class_name,APR_HASH_KEY_STRING);
+	if(!rule) {
+		return NULL;
+	}
+	for(i=0; i<rule->nelts; i++) {
+		vosk_recog_model_t *model = APR_ARRAY_IDX(rule,i,vosk_recog_model_t*);
+		if(vosk_recog_model_language_check(model,language) == FALSE) {
+			continue;
+		}
+		if(vosk_recog_model_seat_take(model) == TRUE) {
+			return model;
+		}
+	}
+	return NULL;
+}
+
+apt_bool_t vosk_recog_model_rule_check(const vosk_recog_model_registry_t *registry, const char *class_name)
+{
+	return apr_hash_get(registry->rule_table,class_name,APR_HASH_KEY_STRING) ? TRUE : FALSE;
+}
+
+apt_bool_t vosk_recog_model_seat_take(vosk_recog_model_t *model)
+{
+	apr_uint32_t seats;
+	if(!model->capacity) {
+		apr_atomic_inc32(&model->seats);
+		return TRUE;
+	}
+	do {
+		seats = apr_atomic_read32(&model->seats);
+		if(seats >= model->capacity) {
+			return FALSE;
+		}
+	}
+	while(apr_atomic_cas32(&model->seats,seats + 1,seats) != seats);
+	return TRUE;
+}
+
+void vosk_recog_model_seat_return(vosk_recog_model_t *model)
+{
+	apr_atomic_dec32(&model->seats);
+}
@@ -0,0 +1,847 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <apr_strings.h>
+#include <apr_hash.h>
+#include <apr_ring.h>
+#include <apr_thread_mutex.h>
+#include "vosk_recog_nlsml.h"
+#include "vosk_recog_log.h"
+
+/** Max nesting of JSON values skipped */
+#define VOSK_RECOG_JSON_MAX_DEPTH 32
+
+/** Rendered result in the cache, allocated along with its key and body */
+typedef struct vosk_recog_nlsml_entry_t vosk_recog_nlsml_entry_t;
+struct vosk_recog_nlsml_entry_t {
+	/** Ring entry, the most recently used first */
+	APR_RING_ENTRY(vosk_recog_nlsml_entry_t) link;
+	/** Key (grammar hash, early result and recognizer result) */
+	const char *key;
+	/** Length of the key */
+	apr_size_t  key_length;
+	/** Rendered NLSML document */
+	const char *body;
+	/** Length of the document */
+	apr_size_t  body_length;
+};
+
+/** Cache of rendered NLSML results */
+struct vosk_recog_nlsml_cache_t {
+	/** Table of entries by key */
+	apr_hash_t         *table;
+	/** Ring of entries in order of use */
+	APR_RING_HEAD(vosk_recog_nlsml_ring_t, vosk_recog_nlsml_entry_t) lru;
+	/** Max number of entries to keep */
+	apr_size_t          max_count;
+	/** Guards the table and the ring (results are built by all the decoder workers) */
+	apr_thread_mutex_t *mutex;
+};
+
+/** Position in JSON text being scanned */
+typedef struct vosk_recog_json_cursor_t vosk_recog_json_cursor_t;
+struct vosk_recog_json_cursor_t {
+	const char *pos;
+	apt_bool_t  valid;
+};
+
+/** Interpretation (alternative) found in the result */
+typedef struct vosk_recog_nlsml_interpretation_t vosk_recog_nlsml_interpretation_t;
+struct vosk_recog_nlsml_interpretation_t {
+	/** Text as it is in JSON (still escaped) */
+	apt_str_t   text;
+	/** Confidence score (normalized to [0, 1] before written) */
+	double      confidence;
+	/** Whether the confidence is computed by the recognizer */
+	apt_bool_t  has_confidence;
+	/** Start of the JSON list of words, which is scanned again while written (NULL if none) */
+	const char *words;
+	/** XML content of the instance (NULL if the text is the instance) */
+	const char *instance;
+};
+
+/** NLSML writer, which only counts the length, if there is no buffer yet */
+typedef struct vosk_recog_nlsml_writer_t vosk_recog_nlsml_writer_t;
+struct vosk_recog_nlsml_writer_t {
+	char      *buf;
+	apr_size_t length;
+	/** Whether text is written unescaped rather than as XML */
+	apt_bool_t raw;
+};
+
+static void json_ws_skip(vosk_recog_json_cursor_t *cursor)
+{
+	while(*cursor->pos == ' ' || *cursor->pos == '\t' || *cursor->pos == '\r' || *cursor->pos == '\n') {
+		cursor->pos++;
+	}
+}
+
+static APR_INLINE apt_bool_t json_invalid(vosk_recog_json_cursor_t *cursor)
+{
+	cursor->valid = FALSE;
+	return FALSE;
+}
+
+/** Scan string, leaving it escaped */
+static apt_bool_t json_string_scan(vosk_recog_json_cursor_t *cursor, apt_str_t *str)
+{
+	const char *pos = cursor->pos;
+	if(*pos != '"') {
+		return json_invalid(cursor);
+	}
+	pos++;
+	str->buf = (char*)pos;
+	while(*pos != '"') {
+		if(*pos == '\0') {
+			return json_invalid(cursor);
+		}
+		if(*pos == '\\' && *(pos+1) != '\0') {
+			pos++;
+		}
+		pos++;
+	}
+	str->length = pos - str->buf;
+	cursor->pos = pos + 1;
+	return TRUE;
+}
+
+static apt_bool_t json_number_scan(vosk_recog_json_cursor_t *cursor, double *value)
+{
+	char *end;
+	*value = strtod(cursor->pos,&end);
+	if(end == cursor->pos) {
+		return json_invalid(cursor);
+	}
+	cursor->pos = end;
+	return TRUE;
+}
+
+static apt_bool_t json_value_skip(vosk_recog_json_cursor_t *cursor, int depth);
+
+/** Move to the next member of object (or element of array, if key is NULL), consuming the closing bracket at the end */
+static apt_bool_t json_next(vosk_recog_json_cursor_t *cursor, char close, apt_str_t *key)
+{
+	if(cursor->valid == FALSE) {
+		return FALSE;
+	}
+	json_ws_skip(cursor);
+	if(*cursor->pos == ',') {
+		cursor->pos++;
+		json_ws_skip(cursor);
+	}
+	if(*cursor->pos == close) {
+		cursor->pos++;
+		return FALSE;
+	}
+	if(key) {
+		if(json_string_scan(cursor,key) == FALSE) {
+			return FALSE;
+		}
+		json_ws_skip(cursor);
+		if(*cursor->pos != ':') {
+			return json_invalid(cursor);
+		}
+		cursor->pos++;
+		json_ws_skip(cursor);
+	}
+	if(*cursor->pos == '\0') {
+		return json_invalid(cursor);
+	}
+	return TRUE;
+}
+
+static apt_bool_t json_value_skip(vosk_recog_json_cursor_t *cursor, int depth)
+{
+	apt_str_t str;
+	double number;
+	if(depth > VOSK_RECOG_JSON_MAX_DEPTH) {
+		return json_invalid(cursor);
+	}
+	switch(*cursor->pos) {
+		case '"':
+			return json_string_scan(cursor,&str);
+		case '{':
+			cursor->pos++;
+			while(json_next(cursor,'}',&str) == TRUE) {
+				json_value_skip(cursor,depth + 1);
+			}
+			return cursor->valid;
+		case '[':
+			cursor->pos++;
+			while(json_next(cursor,']',NULL) == TRUE) {
+				json_value_skip(cursor,depth + 1);
+			}
+			return cursor->valid;
+		case 't':
+		case 'f':
+		case 'n':
+			while(*cursor->pos >= 'a' && *cursor->pos <= 'z') {
+				cursor->pos++;
+			}
+			return TRUE;
+	}
+	return json_number_scan(cursor,&number);
+}
+
+static APR_INLINE apt_bool_t json_key_is(const apt_str_t *key, const char *name, apr_size_t length)
+{
+	return (key->length == length && memcmp(key->buf,name,length) == 0) ? TRUE : FALSE;
+}
+#define JSON_KEY_IS(key,name) json_key_is(key,name,sizeof(name)-1)
+
+/** Scan one alternative (or the whole result without alternatives) */
+static apt_bool_t nlsml_interpretation_scan(vosk_recog_json_cursor_t *cursor, vosk_recog_nlsml_interpretation_t *interpretation)
+{
+	apt_str_t key;
+	if(*cursor->pos != '{') {
+		return json_invalid(cursor);
+	}
+	cursor->pos++;
+	while(json_next(cursor,'}',&key) == TRUE) {
+		if(JSON_KEY_IS(&key,"text") == TRUE) {
+			json_string_scan(cursor,&interpretation->text);
+		}
+		else if(JSON_KEY_IS(&key,"confidence") == TRUE) {
+			interpretation->has_confidence = json_number_scan(cursor,&interpretation->confidence);
+		}
+		else if(JSON_KEY_IS(&key,"result") == TRUE && *cursor->pos == '[') {
+			interpretation->words = cursor->pos;
+			json_value_skip(cursor,1);
+		}
+		else {
+			json_value_skip(cursor,1);
+		}
+	}
+	return cursor->valid;
+}
+
+/** Average confidence of the words, if there are no alternatives */
+static apt_bool_t nlsml_words_confidence_get(const char *words, double *confidence)
+{
+	vosk_recog_json_cursor_t cursor = {words + 1, TRUE};
+	apt_str_t key;
+	double sum = 0;
+	double conf;
+	apr_size_t count = 0;
+	while(json_next(&cursor,']',NULL) == TRUE) {
+		if(*cursor.pos != '{') {
+			json_value_skip(&cursor,1);
+			continue;
+		}
+		cursor.pos++;
+		while(json_next(&cursor,'}',&key) == TRUE) {
+			if(JSON_KEY_IS(&key,"conf") == TRUE && json_number_scan(&cursor,&conf) == TRUE) {
+				sum += conf;
+				count++;
+			}
+			else {
+				json_value_skip(&cursor,2);
+			}
+		}
+	}
+	if(!count) {
+		return FALSE;
+	}
+	*confidence = sum / count;
+	return TRUE;
+}
+
+static APR_INLINE void nlsml_write(vosk_recog_nlsml_writer_t *writer, const char *str, apr_size_t length)
+{
+	if(writer->buf) {
+		memcpy(writer->buf + writer->length,str,length);
+	}
+	writer->length += length;
+}
+#define NLSML_LITERAL_WRITE(writer,str) nlsml_write(writer,str,sizeof(str)-1)
+
+static void nlsml_number_write(vosk_recog_nlsml_writer_t *writer, double value)
+{
+	char buf[32];
+	int length = apr_snprintf(buf,sizeof(buf),"%.2f",value);
+	nlsml_write(writer,buf,length);
+}
+
+static void nlsml_char_write(vosk_recog_nlsml_writer_t *writer, char c)
+{
+	if(writer->raw == TRUE) {
+		nlsml_write(writer,&c,1);
+		return;
+	}
+	switch(c) {
+		case '&': NLSML_LITERAL_WRITE(writer,"&amp;"); break;
+		case '<': NLSML_LITERAL_WRITE(writer,"&lt;"); break;
+		case '>': NLSML_LITERAL_WRITE(writer,"&gt;"); break;
+		case '"': NLSML_LITERAL_WRITE(writer,"&quot;"); break;
+		default:
+			if((unsigned char)c < 0x20) {
+				/* not allowed in XML */
+				c = ' ';
+			}
+			nlsml_write(writer,&c,1);
+	}
+}
+
+static void nlsml_code_point_write(vosk_recog_nlsml_writer_t *writer, unsigned long code)
+{
+	char buf[4];
+	apr_size_t length;
+	if(code < 0x80) {
+		nlsml_char_write(writer,(char)code);
+		return;
+	}
+	if(code < 0x800) {
+		buf[0] = (char)(0xC0 | (code >> 6));
+		length = 2;
+	}
+	else if(code < 0x10000) {
+		buf[0] = (char)(0xE0 | (code >> 12));
+		buf[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+		length = 3;
+	}
+	else {
+		buf[0] = (char)(0xF0 | (code >> 18));
+		buf[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+		buf[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+		length = 4;
+	}
+	buf[length-1] = (char)(0x80 | (code & 0x3F));
+	nlsml_write(writer,buf,length);
+}
+
+static unsigned long json_hex4_get(const char *pos, const char *end)
+{
+	char hex[5];
+	if(end - pos < 4) {
+		return 0;
+	}
+	memcpy(hex,pos,4);
+	hex[4] = '\0';
+	return strtoul(hex,NULL,16);
+}
+
+/** Write JSON string as XML text */
+static void nlsml_text_write(vosk_recog_nlsml_writer_t *writer, const apt_str_t *text)
+{
+	const char *pos = text->buf;
+	const char *end = text->buf + text->length;
+	unsigned long code;
+	for(; pos < end; pos++) {
+		if(*pos != '\\' || pos + 1 == end) {
+			nlsml_char_write(writer,*pos);
+			continue;
+		}
+		pos++;
+		switch(*pos) {
+			case 'n':
+			case 'r':
+			case 't':
+			case 'b':
+			case 'f':
+				nlsml_char_write(writer,' ');
+				break;
+			case 'u':
+				code = json_hex4_get(pos + 1,end);
+				pos += 4;
+				if(code >= 0xD800 && code < 0xDC00 && end - pos > 6 && pos[1] == '\\' && pos[2] == 'u') {
+					/* surrogate pair */
+					unsigned long low = json_hex4_get(pos + 3,end);
+					if(low >= 0xDC00 && low < 0xE000) {
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+						pos += 6;
+					}
+				}
+				nlsml_code_point_write(writer,code);
+				break;
+			default:
+				/* quote, backslash and slash stand for themselves */
+				nlsml_char_write(writer,*pos);
+		}
+	}
+}
+
+static void nlsml_cstr_write(vosk_recog_nlsml_writer_t *writer, const char *str)
+{
+	for(; *str != '\0'; str++) {
+		nlsml_char_write(writer,*str);
+	}
+}
+
+/** Write the words of interpretation with their timings */
+static void nlsml_words_write(vosk_recog_nlsml_writer_t *writer, const char *words)
+{
+	vosk_recog_json_cursor_t cursor = {words + 1, TRUE};
+	apt_str_t key;
+	apt_str_t word;
+	double start;
+	double end;
+	double conf;
+	apt_bool_t has_conf;
+
+	NLSML_LITERAL_WRITE(writer,"<words>\n");
+	while(json_next(&cursor,']',NULL) == TRUE) {
+		if(*cursor.pos != '{') {
+			json_value_skip(&cursor,1);
+			continue;
+		}
+		cursor.pos++;
+		apt_string_reset(&word);
+		start = end = conf = 0;
+		has_conf = FALSE;
+		while(json_next(&cursor,'}',&key) == TRUE) {
+			if(JSON_KEY_IS(&key,"word") == TRUE) {
+				json_string_scan(&cursor,&word);
+			}
+			else if(JSON_KEY_IS(&key,"start") == TRUE) {
+				json_number_scan(&cursor,&start);
+			}
+			else if(JSON_KEY_IS(&key,"end") == TRUE) {
+				json_number_scan(&cursor,&end);
+			}
+			else if(JSON_KEY_IS(&key,"conf") == TRUE) {
+				has_conf = json_number_scan(&cursor,&conf);
+			}
+			else {
+				json_value_skip(&cursor,2);
+			}
+		}
+		if(cursor.valid == FALSE) {
+			break;
+		}
+		NLSML_LITERAL_WRITE(writer,"<word start=\"");
+		nlsml_number_write(writer,start);
+		NLSML_LITERAL_WRITE(writer,"\" end=\"");
+		nlsml_number_write(writer,end);
+		if(has_conf == TRUE) {
+			NLSML_LITERAL_WRITE(writer,"\" confidence=\"");
+			nlsml_number_write(writer,conf);
+		}
+		NLSML_LITERAL_WRITE(writer,"\">");
+		nlsml_text_write(writer,&word);
+		NLSML_LITERAL_WRITE(writer,"</word>\n");
+	}
+	NLSML_LITERAL_WRITE(writer,"</words>\n");
+}
+
+static void nlsml_document_write(
+				vosk_recog_nlsml_writer_t *writer,
+				const vosk_recog_nlsml_interpretation_t *interpretations,
+				apr_size_t count,
+				const char *early,
+				apt_bool_t word_timings)
+{
+	const vosk_recog_nlsml_interpretation_t *interpretation;
+	apr_size_t i;
+
+	NLSML_LITERAL_WRITE(writer,"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n");
+	NLSML_LITERAL_WRITE(writer,"<result grammar=\"default\">\n");
+	for(i=0; i<count; i++) {
+		interpretation = &interpretations[i];
+		NLSML_LITERAL_WRITE(writer,"<interpretation grammar=\"default\"");
+		if(interpretation->has_confidence == TRUE) {
+			NLSML_LITERAL_WRITE(writer," confidence=\"");
+			nlsml_number_write(writer,interpretation->confidence);
+			NLSML_LITERAL_WRITE(writer,"\"");
+		}
+		NLSML_LITERAL_WRITE(writer,">\n<input mode=\"speech\">");
+		nlsml_text_write(writer,&interpretation->text);
+		NLSML_LITERAL_WRITE(writer,"</input>\n<instance>");
+		if(interpretation->instance) {
+			nlsml_write(writer,interpretation->instance,strlen(interpretation->instance));
+		}
+		else {
+			nlsml_text_write(writer,&interpretation->text);
+		}
+		NLSML_LITERAL_WRITE(writer,"</instance>\n");
+		if(word_timings == TRUE && interpretation->words) {
+			nlsml_words_write(writer,interpretation->words);
+		}
+		NLSML_LITERAL_WRITE(writer,"</interpretation>\n");
+	}
+	if(!count) {
+		NLSML_LITERAL_WRITE(writer,"<interpretation grammar=\"default\" confidence=\"0.00\">\n");
+		NLSML_LITERAL_WRITE(writer,"<input mode=\"speech\"><nomatch/></input>\n</interpretation>\n");
+	}
+	if(early) {
+		NLSML_LITERAL_WRITE(writer,"<earlyres>");
+		nlsml_cstr_write(writer,early);
+		NLSML_LITERAL_WRITE(writer,"</earlyres>\n");
+	}
+	NLSML_LITERAL_WRITE(writer,"</result>\n");
+}
+
+/** Normalize the scores of alternatives to [0, 1], the way they relate to each other */
+static void nlsml_confidences_normalize(vosk_recog_nlsml_interpretation_t *interpretations, apr_size_t count)
+{
+	double max;
+	double sum = 0;
+	apr_size_t i;
+	if(!count) {
+		return;
+	}
+	max = interpretations[0].confidence;
+	for(i=1; i<count; i++) {
+		if(interpretations[i].confidence > max) {
+			max = interpretations[i].confidence;
+		}
+	}
+	for(i=0; i<count; i++) {
+		interpretations[i].confidence = exp(interpretations[i].confidence - max);
+		sum += interpretations[i].confidence;
+	}
+	for(i=0; i<count; i++) {
+		interpretations[i].confidence /= sum;
+		interpretations[i].has_confidence = TRUE;
+	}
+}
+
+/** Interpret the text of each interpretation */
+static void nlsml_instances_build(vosk_recog_nlsml_interpretation_t *interpretations, apr_size_t count, const vosk_recog_result_options_t *options, apr_pool_t *pool)
+{
+	vosk_recog_nlsml_writer_t writer;
+	char *text;
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		/* unescape the JSON string the way it is written, measure first */
+		writer.buf = NULL;
+		writer.length = 0;
+		writer.raw = TRUE;
+		nlsml_text_write(&writer,&interpretations[i].text);
+		text = apr_palloc(pool,writer.length + 1);
+		writer.buf = text;
+		writer.length = 0;
+		nlsml_text_write(&writer,&interpretations[i].text);
+		text[writer.length] = '\0';
+		interpretations[i].instance = options->interpret(options->interpret_obj,text,pool);
+	}
+}
+
+/** Build NLSML result */
+apt_bool_t vosk_recog_nlsml_build(const char *json, const char *early, const vosk_recog_result_options_t *options, apt_str_t *body, apt_bool_t *rejected, apr_pool_t *pool)
+{
+	vosk_recog_nlsml_interpretation_t interpretations[VOSK_RECOG_NLSML_MAX_INTERPRETATIONS];
+	vosk_recog_nlsml_interpretation_t single;
+	vosk_recog_nlsml_writer_t writer;
+	vosk_recog_json_cursor_t cursor;
+	apt_bool_t alternatives = FALSE;
+	apr_size_t max_count = VOSK_RECOG_NLSML_MAX_INTERPRETATIONS;
+	apr_size_t count = 0;
+	apr_size_t kept;
+	apr_size_t i;
+	apt_str_t key;
+
+	*rejected = FALSE;
+	if(options->n_best && options->n_best < max_count) {
+		max_count = options->n_best;
+	}
+
+	memset(&single,0,sizeof(single));
+	cursor.pos = json ? json : "";
+	cursor.valid = TRUE;
+	json_ws_skip(&cursor);
+	if(*cursor.pos != '{') {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid Recognition Result");
+		return FALSE;
+	}
+	cursor.pos++;
+	while(json_next(&cursor,'}',&key) == TRUE) {
+		if(JSON_KEY_IS(&key,"alternatives") == TRUE && *cursor.pos == '[') {
+			alternatives = TRUE;
+			cursor.pos++;
+			while(json_next(&cursor,']',NULL) == TRUE) {
+				if(count == max_count) {
+					json_value_skip(&cursor,2);
+					continue;
+				}
+				memset(&interpretations[count],0,sizeof(interpretations[count]));
+				if(nlsml_interpretation_scan(&cursor,&interpretations[count]) == TRUE &&
+					interpretations[count].text.length) {
+					count++;
+				}
+			}
+		}
+		else if(JSON_KEY_IS(&key,"text") == TRUE) {
+			json_string_scan(&cursor,&single.text);
+		}
+		else if(JSON_KEY_IS(&key,"result") == TRUE && *cursor.pos == '[') {
+			single.words = cursor.pos;
+			json_value_skip(&cursor,1);
+		}
+		else {
+			json_value_skip(&cursor,1);
+		}
+	}
+	if(cursor.valid == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Invalid Recognition Result");
+		return FALSE;
+	}
+
+	if(alternatives == TRUE) {
+		nlsml_confidences_normalize(interpretations,count);
+	}
+	else if(single.text.length) {
+		if(single.words) {
+			single.has_confidence = nlsml_words_confidence_get(single.words,&single.confidence);
+		}
+		interpretations[0] = single;
+		count = 1;
+	}
+
+	if(options->confidence_threshold > 0 && count) {
+		kept = 0;
+		for(i=0; i<count; i++) {
+			if(interpretations[i].has_confidence == TRUE &&
+				interpretations[i].confidence < options->confidence_threshold) {
+				continue;
+			}
+			interpretations[kept++] = interpretations[i];
+		}
+		if(!kept) {
+			*rejected = TRUE;
+			return TRUE;
+		}
+		count = kept;
+	}
+
+	if(options->interpret) {
+		nlsml_instances_build(interpretations,count,options,pool);
+	}
+
+	/* measure first, then write into the buffer of the exact size */
+	writer.buf = NULL;
+	writer.length = 0;
+	writer.raw = FALSE;
+	nlsml_document_write(&writer,interpretations,count,early,options->word_timings);
+	body->buf = apr_palloc(pool,writer.length + 1);
+	body->length = writer.length;
+	writer.buf = body->buf;
+	writer.length = 0;
+	nlsml_document_write(&writer,interpretations,count,early,options->word_timings);
+	body->buf[body->length] = '\0';
+	return TRUE;
+}
+
+vosk_recog_nlsml_cache_t* vosk_recog_nlsml_cache_create(apr_size_t max_count, apr_pool_t *pool)
+{
+	vosk_recog_nlsml_cache_t *cache = apr_palloc(pool,sizeof(vosk_recog_nlsml_cache_t));
+	cache->table = apr_hash_make(pool);
+	APR_RING_INIT(&cache->lru,vosk_recog_nlsml_entry_t,link);
+	cache->max_count = max_count;
+	if(apr_thread_mutex_create(&cache->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return cache;
+}
+
+void vosk_recog_nlsml_cache_destroy(vosk_recog_nlsml_cache_t *cache)
+{
+	while(!APR_RING_EMPTY(&cache->lru,vosk_recog_nlsml_entry_t,link)) {
+		vosk_recog_nlsml_entry_t *entry = APR_RING_FIRST(&cache->lru);
+		APR_RING_REMOVE(entry,link);
+		free(entry);
+	}
+	apr_hash_clear(cache->table);
+	apr_thread_mutex_destroy(cache->mutex);
+}
+
+/** Check whether the result built by the options depends on nothing but the text of the top hypothesis */
+static apt_bool_t nlsml_cacheable_check(const char *json, const vosk_recog_result_options_t *options)
+{
+	if(!json || options->n_best > 1 || options->word_timings == TRUE ||
+		options->confidence_only == TRUE || options->confidence_threshold > 0) {
+		return FALSE;
+	}
+	return strlen(json) <= VOSK_RECOG_NLSML_CACHE_MAX_RESULT ? TRUE : FALSE;
+}
+
+apt_bool_t vosk_recog_nlsml_cache_build(vosk_recog_nlsml_cache_t *cache, apr_uint32_t grammar_hash, const char *json, const char *early, const vosk_recog_result_options_t *options, apt_str_t *body, apt_bool_t *rejected, apr_pool_t *pool)
+{
+	vosk_recog_nlsml_entry_t *entry;
+	char *key;
+	apr_size_t key_length;
+	if(!cache || !cache->max_count || nlsml_cacheable_check(json,options) == FALSE) {
+		return vosk_recog_nlsml_build(json,early,options,body,rejected,pool);
+	}
+
+	key = apr_psprintf(pool,"%08x\n%s\n%s",grammar_hash,early ? early : "",json);
+	key_length = strlen(key);
+	apr_thread_mutex_lock(cache->mutex);
+	entry = apr_hash_get(cache->table,key,key_length);
+	if(entry) {
+		/* the most recently used entry goes first */
+		APR_RING_REMOVE(entry,link);
+		APR_RING_INSERT_HEAD(&cache->lru,entry,vosk_recog_nlsml_entry_t,link);
+		body->buf = apr_pstrmemdup(pool,entry->body,entry->body_length);
+		body->length = entry->body_length;
+		apr_thread_mutex_unlock(cache->mutex);
+		*rejected = FALSE;
+		return TRUE;
+	}
+	apr_thread_mutex_unlock(cache->mutex);
+
+	/* rendered without holding the mutex, another worker may render the same result meanwhile */
+	if(vosk_recog_nlsml_build(json,early,options,body,rejected,pool) == FALSE) {
+		return FALSE;
+	}
+	if(*rejected == TRUE) {
+		return TRUE;
+	}
+
+	entry = malloc(sizeof(vosk_recog_nlsml_entry_t) + key_length + body->length + 2);
+	if(!entry) {
+		return TRUE;
+	}
+	entry->key = (char*)(entry + 1);
+	entry->key_length = key_length;
+	memcpy((char*)entry->key,key,key_length + 1);
+	entry->body = entry->key + key_length + 1;
+	entry->body_length = body->length;
+	memcpy((char*)entry->body,body->buf,body->length + 1);
+
+	apr_thread_mutex_lock(cache->mutex);
+	if(apr_hash_get(cache->table,entry->key,entry->key_length)) {
+		/* rendered by another worker in the meantime */
+		apr_thread_mutex_unlock(cache->mutex);
+		free(entry);
+		return TRUE;
+	}
+	if(apr_hash_count(cache->table) >= cache->max_count) {
+		vosk_recog_nlsml_entry_t *last = APR_RING_LAST(&cache->lru);
+		APR_RING_REMOVE(last,link);
+		apr_hash_set(cache->table,last->key,last->key_length,NULL);
+		free(last);
+	}
+	APR_RING_INSERT_HEAD(&cache->lru,entry,vosk_recog_nlsml_entry_t,link);
+	apr_hash_set(cache->table,entry->key,entry->key_length,entry);
+	apr_thread_mutex_unlock(cache->mutex);
+	return TRUE;
+}
+
+/** Build NLSML result of DTMF input */
+apt_bool_t vosk_recog_nlsml_dtmf_build(const char *digits, const char *instance, apt_str_t *body, apr_pool_t *pool)
+{
+	/* digits and their interpretations need no escaping */
+	body->buf = apr_psprintf(pool,
+		"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+		"<result grammar=\"builtin:dtmf\">\n"
+		"<interpretation grammar=\"builtin:dtmf\" confidence=\"1.00\">\n"
+		"<input mode=\"dtmf\">%s</input>\n"
+		"<instance>%s</instance>\n"
+		"</interpretation>\n"
+		"</result>\n",
+		digits,
+		instance);
+	body->length = strlen(body->buf);
+	return TRUE;
+}
+
+apr_size_t vosk_recog_nlsml_speaker_vector_get(const char *json, float *vector, apr_size_t max_size, apr_size_t *frames)
+{
+	vosk_recog_json_cursor_t cursor;
+	apr_size_t size = 0;
+	apt_str_t key;
+	double value;
+
+	*frames = 0;
+	cursor.pos = json ? json : "";
+	cursor.valid = TRUE;
+	json_ws_skip(&cursor);
+	if(*cursor.pos != '{') {
+		return 0;
+	}
+	cursor.pos++;
+	while(json_next(&cursor,'}',&key) == TRUE) {
+		if(JSON_KEY_IS(&key,"spk") == TRUE && *cursor.pos == '[') {
+			cursor.pos++;
+			size = 0;
+			while(json_next(&cursor,']',NULL) == TRUE) {
+				if(json_number_scan(&cursor,&value) == TRUE && size < max_size) {
+					vector[size++] = (float)value;
+				}
+			}
+		}
+		else if(JSON_KEY_IS(&key,"spk_frames") == TRUE) {
+			if(json_number_scan(&cursor,&value) == TRUE && value > 0) {
+				*frames = (apr_size_t)value;
+			}
+		}
+		else {
+			json_value_skip(&cursor,1);
+		}
+	}
+	return cursor.valid == TRUE ? size : 0;
+}
+
+apt_bool_t vosk_recog_nlsml_confidence_get(const char *json, double *confidence)
+{
+	vosk_recog_nlsml_interpretation_t interpretations[VOSK_RECOG_NLSML_MAX_INTERPRETATIONS];
+	vosk_recog_json_cursor_t cursor;
+	apt_bool_t alternatives = FALSE;
+	const char *words = NULL;
+	apr_size_t count = 0;
+	apt_str_t key;
+
+	cursor.pos = json ? json : "";
+	cursor.valid = TRUE;
+	json_ws_skip(&cursor);
+	if(*cursor.pos != '{') {
+		return FALSE;
+	}
+	cursor.pos++;
+	while(json_next(&cursor,'}',&key) == TRUE) {
+		if(JSON_KEY_IS(&key,"alternatives") == TRUE && *cursor.pos == '[') {
+			alternatives = TRUE;
+			cursor.pos++;
+			while(json_next(&cursor,']',NULL) == TRUE) {
+				if(count == VOSK_RECOG_NLSML_MAX_INTERPRETATIONS) {
+					json_value_skip(&cursor,2);
+					continue;
+				}
+				memset(&interpretations[count],0,sizeof(interpretations[count]));
+				if(nlsml_interpretation_scan(&cursor,&interpretations[count]) == TRUE &&
+					interpretations[count].text.length) {
+					count++;
+				}
+			}
+		}
+		else if(JSON_KEY_IS(&key,"result") == TRUE && *cursor.pos == '[') {
+			words = cursor.pos;
+			json_value_skip(&cursor,1);
+		}
+		else {
+			json_value_skip(&cursor,1);
+		}
+	}
+	if(cursor.valid == FALSE) {
+		return FALSE;
+	}
+
+	if(alternatives == TRUE) {
+		if(!count) {
+			return FALSE;
+		}
+		/* the top hypothesis, as it is reported in the NLSML result */
+		nlsml_confidences_normalize(interpretations,count);
+		*confidence = interpretations[0].confidence;
+		return TRUE;
+	}
+	if(!words) {
+		return FALSE;
+	}
+	return nlsml_words_confidence_get(words,confidence);
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+#include "vosk_recog_pool.h"
+#include "vosk_recog_log.h"
+
+/** Idle recognizers of the same kind */
+typedef struct vosk_recog_pool_slot_t vosk_recog_pool_slot_t;
+struct vosk_recog_pool_slot_t {
+	/** Model recognizers are built for (NULL if the slot is purged and free) */
+	const vosk_recog_model_t *model;
+	/** Sampling rate */
+	int                       sample_rate;
+	/** Grammar (NULL for free-form) */
+	const char               *grammar;
+	/** Stack of idle recognizers (VoskRecognizer*) */
+	apr_array_header_t       *idle;
+};
+
+/** Pool of recognizers */
+struct vosk_recog_pool_t {
+	/** Array of slots (vosk_recog_pool_slot_t) */
+	apr_array_header_t  *slots;
+	/** Guards slots (acquired by the engine task, released by decoder workers) */
+	apr_thread_mutex_t  *mutex;
+	/** Speaker model set to the recognizers built (NULL if none) */
+	VoskSpkModel        *spk_model;
+	/** Pool to allocate memory from */
+	apr_pool_t          *pool;
+};
+
+static VoskRecognizer* vosk_recog_recognizer_create(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar)
+{
+	VoskRecognizer *recognizer;
+	if(grammar) {
+		recognizer = vosk_recognizer_new_grm(model->model,(float)sample_rate,grammar);
+	}
+	else {
+		recognizer = vosk_recognizer_new(model->model,(float)sample_rate);
+	}
+	if(!recognizer) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Recognizer [%s] [%d]",model->name,sample_rate);
+		return NULL;
+	}
+	if(recog_pool->spk_model) {
+		/* the speaker vector is computed along with decoding, in the same pass over audio */
+		vosk_recognizer_set_spk_model(recognizer,recog_pool->spk_model);
+	}
+	/* alternatives and words are set per request by the engine, which builds the NLSML result */
+	return recognizer;
+}
+
+/** Find or add slot (called with mutex locked) */
+static vosk_recog_pool_slot_t* vosk_recog_pool_slot_get(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar)
+{
+	int i;
+	vosk_recog_pool_slot_t *slot;
+	vosk_recog_pool_slot_t *free_slot = NULL;
+	for(i=0; i<recog_pool->slots->nelts; i++) {
+		slot = &APR_ARRAY_IDX(recog_pool->slots,i,vosk_recog_pool_slot_t);
+		if(!slot->model && !free_slot) {
+			free_slot = slot;
+		}
+		if(slot->model != model || slot->sample_rate != sample_rate) {
+			continue;
+		}
+		if(slot->grammar == grammar || (slot->grammar && grammar && strcmp(slot->grammar,grammar) == 0)) {
+			return slot;
+		}
+	}
+
+	if(free_slot) {
+		/* reuse the slot of a replaced model, its stack is empty */
+		slot = free_slot;
+	}
+	else {
+		slot = apr_array_push(recog_pool->slots);
+		slot->idle = apr_array_make(recog_pool->pool,4,sizeof(VoskRecognizer*));
+	}
+	slot->model = model;
+	slot->sample_rate = sample_rate;
+	slot->grammar = grammar ? apr_pstrdup(recog_pool->pool,grammar) : NULL;
+	return slot;
+}
+
+vosk_recog_pool_t* vosk_recog_pool_create(apr_pool_t *pool)
+{
+	vosk_recog_pool_t *recog_pool = apr_palloc(pool,sizeof(vosk_recog_pool_t));
+	recog_pool->slots = apr_array_make(pool,1,sizeof(vosk_recog_pool_slot_t));
+	recog_pool->spk_model = NULL;
+	recog_pool->pool = pool;
+	if(apr_thread_mutex_create(&recog_pool->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return recog_pool;
+}
+
+void vosk_recog_pool_destroy(vosk_recog_pool_t *recog_pool)
+{
+	int i;
+	apr_thread_mutex_lock(recog_pool->mutex);
+	for(i=0; i<recog_pool->slots->nelts; i++) {
+		vosk_recog_pool_slot_t *slot = &APR_ARRAY_IDX(recog_pool->slots,i,vosk_recog_pool_slot_t);
+		while(!apr_is_empty_array(slot->idle)) {
+			VoskRecognizer **recognizer = apr_array_pop(slot->idle);
+			vosk_recognizer_free(*recognizer);
+		}
+	}
+	apr_array_clear(recog_pool->slots);
+	apr_thread_mutex_unlock(recog_pool->mutex);
+	apr_thread_mutex_destroy(recog_pool->mutex);
+}
+
+apt_bool_t vosk_recog_pool_warm(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar, apr_size_t count)
+{
+	vosk_recog_pool_slot_t *slot;
+	apr_size_t idle_count;
+	if(!model->model) {
+		return FALSE;
+	}
+
+	apr_thread_mutex_lock(recog_pool->mutex);
+	slot = vosk_recog_pool_slot_get(recog_pool,model,sample_rate,grammar);
+	idle_count = slot->idle->nelts;
+	apr_thread_mutex_unlock(recog_pool->mutex);
+
+	/* build without holding the mutex, recognizer construction is slow */
+	for(; idle_count < count; idle_count++) {
+		VoskRecognizer *recognizer = vosk_recog_recognizer_create(recog_pool,model,sample_rate,grammar);
+		if(!recognizer) {
+			return FALSE;
+		}
+		vosk_recog_pool_release(recog_pool,model,sample_rate,grammar,recognizer);
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Warmed Up %s Recognizers [%s] [%d] [%"APR_SIZE_T_FMT"]",
+		grammar ? "Constrained" : "Free-Form",
+		model->name,sample_rate,count);
+	return TRUE;
+}
+
+VoskRecognizer* vosk_recog_pool_acquire(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar)
+{
+	VoskRecognizer *recognizer = NULL;
+	vosk_recog_pool_slot_t *slot;
+
+	apr_thread_mutex_lock(recog_pool->mutex);
+	slot = vosk_recog_pool_slot_get(recog_pool,model,sample_rate,grammar);
+	if(!apr_is_empty_array(slot->idle)) {
+		recognizer = *(VoskRecognizer**)apr_array_pop(slot->idle);
+	}
+	apr_thread_mutex_unlock(recog_pool->mutex);
+
+	if(!recognizer) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"No Idle Recognizer [%s] [%d], create new one",model->name,sample_rate);
+		recognizer = vosk_recog_recognizer_create(recog_pool,model,sample_rate,grammar);
+	}
+	return recognizer;
+}
+
+void vosk_recog_pool_release(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model, int sample_rate, const char *grammar, VoskRecognizer *recognizer)
+{
+	vosk_recog_pool_slot_t *slot;
+	if(!recognizer) {
+		return;
+	}
+
+	/* drop the state of the previous utterance */
+	vosk_recognizer_reset(recognizer);
+
+	apr_thread_mutex_lock(recog_pool->mutex);
+	slot = vosk_recog_pool_slot_get(recog_pool,model,sample_rate,grammar);
+	APR_ARRAY_PUSH(slot->idle,VoskRecognizer*) = recognizer;
+	apr_thread_mutex_unlock(recog_pool->mutex);
+}
+
+void vosk_recog_pool_speaker_model_set(vosk_recog_pool_t *recog_pool, VoskSpkModel *spk_model)
+{
+	recog_pool->spk_model = spk_model;
+}
+
+void vosk_recog_pool_purge(vosk_recog_pool_t *recog_pool, const vosk_recog_model_t *model)
+{
+	int i;
+	apr_size_t count = 0;
+	apr_thread_mutex_lock(recog_pool->mutex);
+	for(i=0; i<recog_pool->slots->nelts; i++) {
+		vosk_recog_pool_slot_t *slot = &APR_ARRAY_IDX(recog_pool->slots,i,vosk_recog_pool_slot_t);
+		if(slot->model != model) {
+			continue;
+		}
+		while(!apr_is_empty_array(slot->idle)) {
+			VoskRecognizer **recognizer = apr_array_pop(slot->idle);
+			vosk_recognizer_free(*recognizer);
+			count++;
+		}
+		slot->model = NULL;
+	}
+	apr_thread_mutex_unlock(recog_pool->mutex);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Purged Recognizers [%s] [%"APR_SIZE_T_FMT"]",model->name,count);
+}
+
+apr_size_t vosk_recog_pool_idle_count_get(vosk_recog_pool_t *recog_pool)
+{
+	int i;
+	apr_size_t count = 0;
+	apr_thread_mutex_lock(recog_pool->mutex);
+	for(i=0; i<recog_pool->slots->nelts; i++) {
+		count += APR_ARRAY_IDX(recog_pool->slots,i,vosk_recog_pool_slot_t).idle->nelts;
+	}
+	apr_thread_mutex_unlock(recog_pool->mutex);
+	return count;
+}
@@ -0,0 +1,1157 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <apr_ring.h>
+#include <apr_tables.h>
+#include <apr_strings.h>
+#include <apr_atomic.h>
+#include <apr_network_io.h>
+#include <apr_thread_mutex.h>
+#include <apr_base64.h>
+#include <apr_sha1.h>
+#include "vosk_recog_remote.h"
+#include "vosk_recog_log.h"
+#include "apt_poller_task.h"
+
+#define VOSK_RECOG_REMOTE_TASK_NAME "Vosk Remote Client"
+
+/** Size of the receive buffer of a connection (the largest result expected) */
+#define VOSK_RECOG_REMOTE_RX_BUFFER_SIZE 65536
+/** Max size of the header of a client frame (2 + 8 bytes of length + 4 bytes of mask) */
+#define VOSK_RECOG_REMOTE_FRAME_HEADER_SIZE 14
+/** Max size of the config and control messages */
+#define VOSK_RECOG_REMOTE_TEXT_SIZE 4096
+/** Max number of checks a decoder out of service is probed after */
+#define VOSK_RECOG_REMOTE_MAX_BACKOFF 8
+
+/** GUID the key of the opening handshake is concatenated with (RFC 6455) */
+#define VOSK_RECOG_REMOTE_WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+/** WebSocket opcodes */
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT         0x1
+#define WS_OPCODE_BINARY       0x2
+#define WS_OPCODE_CLOSE        0x8
+#define WS_OPCODE_PING         0x9
+#define WS_OPCODE_PONG         0xA
+
+typedef struct vosk_recog_remote_decoder_t vosk_recog_remote_decoder_t;
+typedef struct vosk_recog_remote_connection_t vosk_recog_remote_connection_t;
+
+/** Remote decoder */
+struct vosk_recog_remote_decoder_t {
+	/** URI of the decoder */
+	const char               *uri;
+	/** Host name or address */
+	char                     *host;
+	/** Port */
+	apr_port_t                port;
+	/** Resource path of the handshake */
+	const char               *path;
+	/** Number of connections in use */
+	apr_size_t                active;
+	/** Number of warm connections */
+	apr_size_t                idle;
+	/** Number of successive failures to connect, the decoder is out of service if non-zero */
+	apr_size_t                failures;
+	/** Time the decoder out of service is probed again at */
+	apr_time_t                retry_time;
+	/** Routing attempt the decoder is last tried in */
+	apr_uint32_t              attempt;
+};
+
+/** WebSocket connection to a decoder */
+struct vosk_recog_remote_connection_t {
+	/** Ring entry */
+	APR_RING_ENTRY(vosk_recog_remote_connection_t) link;
+	/** Decoder the connection is established to */
+	vosk_recog_remote_decoder_t *decoder;
+	/** Pool of the connection */
+	apr_pool_t               *pool;
+	/** Socket */
+	apr_socket_t             *sock;
+	/** Descriptor of the socket in the pollset */
+	apr_pollfd_t              sock_pfd;
+	/** Stream the connection is assigned to (NULL if warm) */
+	vosk_recog_remote_stream_t *stream;
+	/** Whether a ping of the warm connection is not answered yet */
+	apt_bool_t                ping_pending;
+	/** State of the generator of masking keys */
+	apr_uint32_t              mask_state;
+	/** Buffer frames are composed in */
+	char                     *tx_buffer;
+	/** Buffer frames are received in */
+	char                     *rx_buffer;
+	/** Size of the data received */
+	apr_size_t                rx_length;
+	/** Identifier used in logs */
+	const char               *id;
+};
+
+typedef APR_RING_HEAD(vosk_recog_remote_connection_ring_t, vosk_recog_remote_connection_t) vosk_recog_remote_connection_ring_t;
+
+/** Stream of a request */
+struct vosk_recog_remote_stream_t {
+	/** Ring entry (idle streams) */
+	APR_RING_ENTRY(vosk_recog_remote_stream_t) link;
+	/** Client the stream is sent by */
+	vosk_recog_remote_t      *remote;
+	/** Connection the stream is sent over (client context) */
+	vosk_recog_remote_connection_t *connection;
+	/** Guards the fields shared by the owner and the client */
+	apr_thread_mutex_t       *mutex;
+	/** Object the stream is opened with (NULL once closed) */
+	void                     *obj;
+	/** Sampling rate of audio */
+	int                       sample_rate;
+	/** JSON members added to the config */
+	char                     *options;
+	/** Audio pending to send */
+	char                     *buffer;
+	/** Size of pending audio */
+	apr_size_t                length;
+	/** Whether the end of audio is marked */
+	apt_bool_t                finished;
+	/** Whether the stream is closed by the owner */
+	apt_bool_t                closed;
+	/** Whether audio dropped on overflow is already reported (owner context) */
+	apt_bool_t                dropped;
+	/** Whether a message to send pending audio is already signaled */
+	volatile apr_uint32_t     signaled;
+	/** Buffer audio is sent from, swapped with the pending one (client context) */
+	char                     *spare;
+	/** Whether the end of audio is sent (client context) */
+	apt_bool_t                finish_sent;
+	/** Whether the result is handed to the owner (client context) */
+	apt_bool_t                delivered;
+	/** Result handed to the owner (NULL if decoding failed) */
+	char                     *result;
+	/** Number of references (owner, client, signaled result) */
+	volatile apr_uint32_t     refs;
+};
+
+typedef APR_RING_HEAD(vosk_recog_remote_stream_ring_t, vosk_recog_remote_stream_t) vosk_recog_remote_stream_ring_t;
+
+/** Remote client */
+struct vosk_recog_remote_t {
+	/** Array of decoders (vosk_recog_remote_decoder_t) */
+	apr_array_header_t       *decoders;
+	/** Ring of connections */
+	vosk_recog_remote_connection_ring_t connections;
+	/** Ring of streams to reuse */
+	vosk_recog_remote_stream_ring_t idle;
+	/** Guards the ring of streams to reuse */
+	apr_thread_mutex_t       *mutex;
+	/** Client task */
+	apt_poller_task_t        *task;
+	/** Timer of the checks */
+	apt_timer_t              *check_timer;
+	/** Max number of streams open at once */
+	apr_size_t                max_streams;
+	/** Max size of audio pending per stream */
+	apr_size_t                buffer_size;
+	/** Number of warm connections kept per decoder */
+	apr_size_t                idle_count;
+	/** Timeout of connection and send */
+	apr_interval_time_t       connect_timeout;
+	/** Interval (msec) of the checks */
+	apr_size_t                check_interval;
+	/** Routing attempt counter (client context) */
+	apr_uint32_t              attempt;
+	/** Decoder the last stream is routed to, to break ties in turn (client context) */
+	apr_size_t                last_decoder;
+	/** Handler of results */
+	vosk_recog_remote_result_f handler;
+	/** Pool to allocate memory from */
+	apr_pool_t               *pool;
+};
+
+/** Type of client task message */
+typedef enum {
+	VOSK_RECOG_REMOTE_MSG_OPEN,  /**< route the stream to a decoder */
+	VOSK_RECOG_REMOTE_MSG_DATA,  /**< send pending audio of the stream */
+	VOSK_RECOG_REMOTE_MSG_CLOSE  /**< the stream is closed by the owner */
+} vosk_recog_remote_msg_type_e;
+
+/** Client task message */
+typedef struct {
+	vosk_recog_remote_msg_type_e type;
+	vosk_recog_remote_stream_t  *stream;
+} vosk_recog_remote_msg_t;
+
+static apt_bool_t vosk_recog_remote_msg_process(apt_task_t *task, apt_task_msg_t *task_msg);
+static apt_bool_t vosk_recog_remote_signal_process(void *obj, const apr_pollfd_t *descriptor);
+static void vosk_recog_remote_check_timer_proc(apt_timer_t *timer, void *obj);
+static void vosk_recog_remote_on_pre_run(apt_task_t *task);
+static void vosk_recog_remote_on_post_run(apt_task_t *task);
+
+vosk_recog_remote_t* vosk_recog_remote_create(apr_size_t max_streams, apr_size_t buffer_size, vosk_recog_remote_result_f handler, apr_pool_t *pool)
+{
+	vosk_recog_remote_t *remote = apr_palloc(pool,sizeof(vosk_recog_remote_t));
+	if(apr_thread_mutex_create(&remote->mutex,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	remote->decoders = apr_array_make(pool,1,sizeof(vosk_recog_remote_decoder_t));
+	APR_RING_INIT(&remote->connections,vosk_recog_remote_connection_t,link);
+	APR_RING_INIT(&remote->idle,vosk_recog_remote_stream_t,link);
+	remote->task = NULL;
+	remote->check_timer = NULL;
+	remote->max_streams = max_streams;
+	remote->buffer_size = buffer_size;
+	remote->idle_count = 1;
+	remote->connect_timeout = apr_time_from_msec(3000);
+	remote->check_interval = 5000;
+	remote->attempt = 0;
+	remote->last_decoder = 0;
+	remote->handler = handler;
+	remote->pool = pool;
+	return remote;
+}
+
+void vosk_recog_remote_destroy(vosk_recog_remote_t *remote)
+{
+	if(remote->task) {
+		apt_poller_task_destroy(remote->task);
+		remote->task = NULL;
+	}
+}
+
+apt_bool_t vosk_recog_remote_decoder_add(vosk_recog_remote_t *remote, const char *uri)
+{
+	vosk_recog_remote_decoder_t *decoder;
+	char *authority;
+	char *scope_id = NULL;
+	const char *path;
+	apr_port_t port = 0;
+
+	if(!uri || strncmp(uri,"ws://",5) != 0) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported Remote Decoder URI [%s]",uri ? uri : "");
+		return FALSE;
+	}
+	path = strchr(uri + 5,'/');
+	if(path) {
+		authority = apr_pstrndup(remote->pool,uri + 5,path - (uri + 5));
+	}
+	else {
+		authority = apr_pstrdup(remote->pool,uri + 5);
+		path = "/";
+	}
+
+	decoder = apr_array_push(remote->decoders);
+	decoder->host = NULL;
+	if(apr_parse_addr_port(&decoder->host,&scope_id,&port,authority,remote->pool) != APR_SUCCESS || !decoder->host) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Remote Decoder URI [%s]",uri);
+		apr_array_pop(remote->decoders);
+		return FALSE;
+	}
+	decoder->uri = apr_pstrdup(remote->pool,uri);
+	decoder->port = port ? port : 80;
+	decoder->path = apr_pstrdup(remote->pool,path);
+	decoder->active = 0;
+	decoder->idle = 0;
+	decoder->failures = 0;
+	decoder->retry_time = 0;
+	decoder->attempt = 0;
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Add Remote Decoder [%s]",decoder->uri);
+	return TRUE;
+}
+
+void vosk_recog_remote_pool_set(vosk_recog_remote_t *remote, apr_size_t idle_count, apr_size_t connect_timeout, apr_size_t check_interval)
+{
+	remote->idle_count = idle_count;
+	if(connect_timeout) {
+		remote->connect_timeout = apr_time_from_msec(connect_timeout);
+	}
+	if(check_interval) {
+		remote->check_interval = check_interval;
+	}
+}
+
+apt_bool_t vosk_recog_remote_start(vosk_recog_remote_t *remote)
+{
+	apt_task_t *task;
+	apt_task_vtable_t *vtable;
+	apt_task_msg_pool_t *msg_pool;
+	apr_size_t max_connections;
+
+	if(apr_is_empty_array(remote->decoders)) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Remote Decoder Configured");
+		return FALSE;
+	}
+
+	/* each open stream holds a connection, the rest are warm ones */
+	max_connections = remote->max_streams + remote->decoders->nelts * remote->idle_count;
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(vosk_recog_remote_msg_t),remote->pool);
+	remote->task = apt_poller_task_create(
+					max_connections,
+					vosk_recog_remote_signal_process,
+					remote,
+					msg_pool,
+					remote->pool);
+	if(!remote->task) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Remote Client Task");
+		return FALSE;
+	}
+
+	task = apt_poller_task_base_get(remote->task);
+	if(task) {
+		apt_task_name_set(task,VOSK_RECOG_REMOTE_TASK_NAME);
+	}
+	vtable = apt_poller_task_vtable_get(remote->task);
+	if(vtable) {
+		vtable->process_msg = vosk_recog_remote_msg_process;
+		vtable->on_pre_run = vosk_recog_remote_on_pre_run;
+		vtable->on_post_run = vosk_recog_remote_on_post_run;
+	}
+	remote->check_timer = apt_poller_task_timer_create(
+							remote->task,
+							vosk_recog_remote_check_timer_proc,
+							remote,
+							remote->pool);
+
+	if(apt_poller_task_start(remote->task) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Remote Client Task");
+		apt_poller_task_destroy(remote->task);
+		remote->task = NULL;
+		return FALSE;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Start Remote Client [%d decoders] idle [%"APR_SIZE_T_FMT"] check [%"APR_SIZE_T_FMT" ms]",
+		remote->decoders->nelts,remote->idle_count,remote->check_interval);
+	return TRUE;
+}
+
+void vosk_recog_remote_terminate(vosk_recog_remote_t *remote)
+{
+	if(remote->task) {
+		apt_poller_task_terminate(remote->task);
+	}
+}
+
+/** Return stream to be reused (called with remote mutex locked) */
+static void vosk_recog_remote_stream_recycle(vosk_recog_remote_stream_t *stream)
+{
+	if(stream->result) {
+		free(stream->result);
+		stream->result = NULL;
+	}
+	if(stream->options) {
+		free(stream->options);
+		stream->options = NULL;
+	}
+	APR_RING_INSERT_TAIL(&stream->remote->idle,stream,vosk_recog_remote_stream_t,link);
+}
+
+static void vosk_recog_remote_stream_unref(vosk_recog_remote_stream_t *stream)
+{
+	if(apr_atomic_dec32(&stream->refs) == 0) {
+		vosk_recog_remote_t *remote = stream->remote;
+		apr_thread_mutex_lock(remote->mutex);
+		vosk_recog_remote_stream_recycle(stream);
+		apr_thread_mutex_unlock(remote->mutex);
+	}
+}
+
+/** Hand the result (NULL on failure) over to the owner, once per stream (client context) */
+static void vosk_recog_remote_stream_deliver(vosk_recog_remote_stream_t *stream, const char *result)
+{
+	char *copy = NULL;
+	if(stream->delivered == TRUE) {
+		return;
+	}
+	stream->delivered = TRUE;
+	if(result) {
+		copy = strdup(result);
+	}
+	apr_thread_mutex_lock(stream->mutex);
+	if(stream->closed == FALSE) {
+		stream->result = copy;
+		copy = NULL;
+		/* the reference is dropped by the owner on taking the result */
+		apr_atomic_inc32(&stream->refs);
+		stream->remote->handler(stream,stream->obj);
+	}
+	apr_thread_mutex_unlock(stream->mutex);
+	if(copy) {
+		free(copy);
+	}
+}
+
+/** Put decoder out of service, or keep it out for longer (client context) */
+static void vosk_recog_remote_decoder_fail(vosk_recog_remote_t *remote, vosk_recog_remote_decoder_t *decoder)
+{
+	apr_size_t backoff;
+	if(!decoder->failures) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Remote Decoder Out of Service [%s]",decoder->uri);
+	}
+	decoder->failures++;
+	backoff = decoder->failures < VOSK_RECOG_REMOTE_MAX_BACKOFF ? decoder->failures : VOSK_RECOG_REMOTE_MAX_BACKOFF;
+	decoder->retry_time = apr_time_now() + apr_time_from_msec(remote->check_interval * backoff);
+}
+
+/** Put decoder back in service (client context) */
+static void vosk_recog_remote_decoder_recover(vosk_recog_remote_decoder_t *decoder)
+{
+	if(decoder->failures) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_NOTICE,"Remote Decoder Back in Service [%s]",decoder->uri);
+		decoder->failures = 0;
+		decoder->retry_time = 0;
+	}
+}
+
+/** Next masking key of connection (xorshift32, the keys only need to be unpredictable to intermediaries) */
+static apr_uint32_t vosk_recog_remote_mask_next(vosk_recog_remote_connection_t *connection)
+{
+	apr_uint32_t x = connection->mask_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	connection->mask_state = x;
+	return x;
+}
+
+/** Send the whole buffer over blocking socket */
+static apt_bool_t vosk_recog_remote_socket_send(apr_socket_t *sock, const char *data, apr_size_t size)
+{
+	apr_size_t length;
+	while(size) {
+		length = size;
+		if(apr_socket_send(sock,data,&length) != APR_SUCCESS || !length) {
+			return FALSE;
+		}
+		data += length;
+		size -= length;
+	}
+	return TRUE;
+}
+
+/** Send masked frame (client context) */
+static apt_bool_t vosk_recog_remote_frame_send(vosk_recog_remote_connection_t *connection, int opcode, const char *data, apr_size_t size)
+{
+	unsigned char *header = (unsigned char*)connection->tx_buffer;
+	unsigned char mask[4];
+	apr_uint32_t key;
+	apr_size_t offset = 0;
+	apr_size_t i;
+
+	header[offset++] = (unsigned char)(0x80 | opcode);
+	if(size < 126) {
+		header[offset++] = (unsigned char)(0x80 | size);
+	}
+	else if(size <= 0xFFFF) {
+		header[offset++] = 0x80 | 126;
+		header[offset++] = (unsigned char)(size >> 8);
+		header[offset++] = (unsigned char)size;
+	}
+	else {
+		apr_uint64_t length = size;
+		header[offset++] = 0x80 | 127;
+		for(i = 0; i < 8; i++) {
+			header[offset++] = (unsigned char)(length >> (56 - 8 * i));
+		}
+	}
+	key = vosk_recog_remote_mask_next(connection);
+	memcpy(mask,&key,4);
+	memcpy(header + offset,mask,4);
+	offset += 4;
+
+	/* the buffer holds the largest chunk of audio along with the header */
+	for(i = 0; i < size; i++) {
+		header[offset + i] = (unsigned char)data[i] ^ mask[i & 3];
+	}
+	return vosk_recog_remote_socket_send(connection->sock,connection->tx_buffer,offset + size);
+}
+
+/** Close connection and release its decoder slot (client context) */
+static void vosk_recog_remote_connection_close(vosk_recog_remote_t *remote, vosk_recog_remote_connection_t *connection)
+{
+	vosk_recog_remote_decoder_t *decoder = connection->decoder;
+	APR_RING_REMOVE(connection,link);
+	if(connection->stream) {
+		connection->stream->connection = NULL;
+		connection->stream = NULL;
+		decoder->active--;
+	}
+	else {
+		decoder->idle--;
+	}
+	if(connection->sock) {
+		apt_poller_task_descriptor_remove(remote->task,&connection->sock_pfd);
+		apr_socket_close(connection->sock);
+		connection->sock = NULL;
+	}
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Close Remote Connection %s",connection->id);
+	apr_pool_destroy(connection->pool);
+}
+
+/** Check the response of the opening handshake */
+static apt_bool_t vosk_recog_remote_handshake_check(const char *response, const char *key)
+{
+	char digest[APR_SHA1_DIGESTSIZE];
+	char accept[64];
+	char expected[64];
+	apr_sha1_ctx_t context;
+	const char *field;
+	apr_size_t length;
+
+	if(strncmp(response,"HTTP/1.1 101",12) != 0) {
+		return FALSE;
+	}
+	field = strstr(response,"Sec-WebSocket-Accept:");
+	if(!field) {
+		/* header field names are case-insensitive, the usual spelling is checked first */
+		field = strstr(response,"sec-websocket-accept:");
+	}
+	if(!field) {
+		return FALSE;
+	}
+	field += sizeof("Sec-WebSocket-Accept:") - 1;
+	while(*field == ' ') {
+		field++;
+	}
+	length = strcspn(field,"\r\n ");
+	if(length >= sizeof(accept)) {
+		return FALSE;
+	}
+	memcpy(accept,field,length);
+	accept[length] = '\0';
+
+	apr_sha1_init(&context);
+	apr_sha1_update(&context,key,(unsigned int)strlen(key));
+	apr_sha1_update(&context,VOSK_RECOG_REMOTE_WS_GUID,(unsigned int)strlen(VOSK_RECOG_REMOTE_WS_GUID));
+	apr_sha1_final((unsigned char*)digest,&context);
+	apr_base64_encode(expected,digest,APR_SHA1_DIGESTSIZE);
+	return strcmp(accept,expected) == 0 ? TRUE : FALSE;
+}
+
+/** Perform the opening handshake over blocking socket */
+static apt_bool_t vosk_recog_remote_handshake(vosk_recog_remote_connection_t *connection)
+{
+	vosk_recog_remote_decoder_t *decoder = connection->decoder;
+	unsigned char nonce[16];
+	char key[32];
+	char *request;
+	char *end = NULL;
+	apr_size_t length = 0;
+	apr_size_t size;
+	apr_size_t i;
+
+	if(apr_generate_random_bytes(nonce,sizeof(nonce)) != APR_SUCCESS) {
+		for(i = 0; i < sizeof(nonce); i++) {
+			nonce[i] = (unsigned char)vosk_recog_remote_mask_next(connection);
+		}
+	}
+	apr_base64_encode(key,(const char*)nonce,sizeof(nonce));
+
+	request = apr_psprintf(connection->pool,
+		"GET %s HTTP/1.1\r\n"
+		"Host: %s:%hu\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Key: %s\r\n"
+		"Sec-WebSocket-Version: 13\r\n"
+		"\r\n",
+		decoder->path,decoder->host,decoder->port,key);
+	if(vosk_recog_remote_socket_send(connection->sock,request,strlen(request)) == FALSE) {
+		return FALSE;
+	}
+
+	/* read the response till the end of the header section */
+	while(!end) {
+		size = VOSK_RECOG_REMOTE_RX_BUFFER_SIZE - 1 - length;
+		if(!size || apr_socket_recv(connection->sock,connection->rx_buffer + length,&size) != APR_SUCCESS || !size) {
+			return FALSE;
+		}
+		length += size;
+		connection->rx_buffer[length] = '\0';
+		end = strstr(connection->rx_buffer,"\r\n\r\n");
+	}
+	end += 4;
+	if(vosk_recog_remote_handshake_check(connection->rx_buffer,key) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Upgrade Remote Connection %s",connection->id);
+		return FALSE;
+	}
+
+	/* frames sent right after the response are kept */
+	connection->rx_length = length - (end - connection->rx_buffer);
+	memmove(connection->rx_buffer,end,connection->rx_length);
+	return TRUE;
+}
+
+/** Establish connection to decoder (client context) */
+static vosk_recog_remote_connection_t* vosk_recog_remote_connection_create(vosk_recog_remote_t *remote, vosk_recog_remote_decoder_t *decoder)
+{
+	vosk_recog_remote_connection_t *connection;
+	apr_sockaddr_t *sockaddr = NULL;
+	apr_pool_t *pool;
+
+	if(apr_pool_create(&pool,NULL) != APR_SUCCESS) {
+		return NULL;
+	}
+	connection = apr_palloc(pool,sizeof(vosk_recog_remote_connection_t));
+	connection->pool = pool;
+	connection->decoder = decoder;
+	connection->sock = NULL;
+	connection->stream = NULL;
+	connection->ping_pending = FALSE;
+	connection->mask_state = (apr_uint32_t)apr_time_now() ^ (apr_uint32_t)(apr_uintptr_t)connection;
+	if(!connection->mask_state) {
+		connection->mask_state = 1;
+	}
+	connection->tx_buffer = apr_palloc(pool,VOSK_RECOG_REMOTE_FRAME_HEADER_SIZE +
+		(remote->buffer_size > VOSK_RECOG_REMOTE_TEXT_SIZE ? remote->buffer_size : VOSK_RECOG_REMOTE_TEXT_SIZE));
+	connection->rx_buffer = apr_palloc(pool,VOSK_RECOG_REMOTE_RX_BUFFER_SIZE);
+	connection->rx_length = 0;
+	connection->id = apr_psprintf(pool,"%s:%hu",decoder->host,decoder->port);
+
+	/* resolved per connection, so that decoders behind a DNS name may be moved */
+	if(apr_sockaddr_info_get(&sockaddr,decoder->host,APR_UNSPEC,decoder->port,0,pool) != APR_SUCCESS ||
+		apr_socket_create(&connection->sock,sockaddr->family,SOCK_STREAM,APR_PROTO_TCP,pool) != APR_SUCCESS) {
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+
+	apr_socket_opt_set(connection->sock,APR_SO_NONBLOCK,0);
+	apr_socket_timeout_set(connection->sock,remote->connect_timeout);
+	apr_socket_opt_set(connection->sock,APR_TCP_NODELAY,1);
+	apr_socket_opt_set(connection->sock,APR_SO_KEEPALIVE,1);
+	if(apr_socket_connect(connection->sock,sockaddr) != APR_SUCCESS ||
+		vosk_recog_remote_handshake(connection) == FALSE) {
+		apr_socket_close(connection->sock);
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+
+	memset(&connection->sock_pfd,0,sizeof(apr_pollfd_t));
+	connection->sock_pfd.desc_type = APR_POLL_SOCKET;
+	connection->sock_pfd.reqevents = APR_POLLIN;
+	connection->sock_pfd.desc.s = connection->sock;
+	connection->sock_pfd.client_data = connection;
+	if(apt_poller_task_descriptor_add(remote->task,&connection->sock_pfd) != TRUE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Add to Pollset %s",connection->id);
+		apr_socket_close(connection->sock);
+		apr_pool_destroy(pool);
+		return NULL;
+	}
+
+	decoder->idle++;
+	APR_RING_INSERT_TAIL(&remote->connections,connection,vosk_recog_remote_connection_t,link);
+	apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Established Remote Connection %s",connection->id);
+	return connection;
+}
+
+/** Establish warm connections to the decoders in service, probe the ones due (client context) */
+static void vosk_recog_remote_pool_replenish(vosk_recog_remote_t *remote)
+{
+	apr_time_t now = apr_time_now();
+	int i;
+	for(i = 0; i < remote->decoders->nelts; i++) {
+		vosk_recog_remote_decoder_t *decoder = &APR_ARRAY_IDX(remote->decoders,i,vosk_recog_remote_decoder_t);
+		if(decoder->failures && now < decoder->retry_time) {
+			continue;
+		}
+		while(decoder->idle < remote->idle_count) {
+			if(!vosk_recog_remote_connection_create(remote,decoder)) {
+				vosk_recog_remote_decoder_fail(remote,decoder);
+				break;
+			}
+			vosk_recog_remote_decoder_recover(decoder);
+		}
+	}
+}
+
+/** Pick the least loaded decoder not tried yet, those in service first (client context) */
+static vosk_recog_remote_decoder_t* vosk_recog_remote_decoder_select(vosk_recog_remote_t *remote)
+{
+	vosk_recog_remote_decoder_t *best = NULL;
+	apr_size_t best_index = 0;
+	apr_size_t count = remote->decoders->nelts;
+	apr_size_t i;
+
+	for(i = 1; i <= count; i++) {
+		/* start next to the last one routed to, so that ties are broken in turn */
+		apr_size_t index = (remote->last_decoder + i) % count;
+		vosk_recog_remote_decoder_t *decoder = &APR_ARRAY_IDX(remote->decoders,index,vosk_recog_remote_decoder_t);
+		if(decoder->attempt == remote->attempt) {
+			continue;
+		}
+		if(!best ||
+			(best->failures && !decoder->failures) ||
+			(!best->failures == !decoder->failures && decoder->active < best->active)) {
+			best = decoder;
+			best_index = index;
+		}
+	}
+	if(best) {
+		best->attempt = remote->attempt;
+		remote->last_decoder = best_index;
+	}
+	return best;
+}
+
+/** Take warm connection to decoder, or establish one (client context) */
+static vosk_recog_remote_connection_t* vosk_recog_remote_connection_acquire(vosk_recog_remote_t *remote, vosk_recog_remote_decoder_t *decoder)
+{
+	vosk_recog_remote_connection_t *connection;
+	for(connection = APR_RING_FIRST(&remote->connections);
+			connection != APR_RING_SENTINEL(&remote->connections,vosk_recog_remote_connection_t,link);
+				connection = APR_RING_NEXT(connection,link)) {
+		if(connection->decoder == decoder && !connection->stream) {
+			return connection;
+		}
+	}
+	connection = vosk_recog_remote_connection_create(remote,decoder);
+	if(!connection) {
+		vosk_recog_remote_decoder_fail(remote,decoder);
+		return NULL;
+	}
+	vosk_recog_remote_decoder_recover(decoder);
+	return connection;
+}
+
+/** Route stream to a decoder and send the config (client context) */
+static void vosk_recog_remote_stream_route(vosk_recog_remote_t *remote, vosk_recog_remote_stream_t *stream)
+{
+	vosk_recog_remote_decoder_t *decoder;
+	vosk_recog_remote_connection_t *connection;
+	char config[VOSK_RECOG_REMOTE_TEXT_SIZE];
+	int length;
+
+	length = apr_snprintf(config,sizeof(config),"{\"config\" : {\"sample_rate\" : %d%s%s}}",
+		stream->sample_rate,
+		stream->options ? ", " : "",
+		stream->options ? stream->options : "");
+
+	remote->attempt++;
+	while((decoder = vosk_recog_remote_decoder_select(remote)) != NULL) {
+		connection = vosk_recog_remote_connection_acquire(remote,decoder);
+		if(!connection) {
+			continue;
+		}
+		if(vosk_recog_remote_frame_send(connection,WS_OPCODE_TEXT,config,length) == FALSE) {
+			/* the warm connection is gone meanwhile, try another one */
+			vosk_recog_remote_connection_close(remote,connection);
+			continue;
+		}
+		decoder->idle--;
+		decoder->active++;
+		connection->stream = stream;
+		connection->ping_pending = FALSE;
+		stream->connection = connection;
+		apt_log(RECOG_LOG_MARK,APT_PRIO_DEBUG,"Route Remote Stream to %s [%"APR_SIZE_T_FMT" active]",
+			connection->id,decoder->active);
+		return;
+	}
+
+	apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"No Remote Decoder Available");
+	vosk_recog_remote_stream_deliver(stream,NULL);
+}
+
+/** Send pending audio of stream (client context) */
+static void vosk_recog_remote_stream_send(vosk_recog_remote_t *remote, vosk_recog_remote_stream_t *stream)
+{
+	vosk_recog_remote_connection_t *connection = stream->connection;
+	char *data;
+	apr_size_t length;
+	apt_bool_t finish;
+
+	/* cleared ahead of the swap, so that audio written meanwhile is signaled again */
+	apr_atomic_set32(&stream->signaled,0);
+	apr_thread_mutex_lock(stream->mutex);
+	if(stream->closed == TRUE) {
+		apr_thread_mutex_unlock(stream->mutex);
+		return;
+	}
+	/* swap the buffers, so that the owner is not blocked while audio is sent */
+	data = stream->buffer;
+	length = stream->length;
+	stream->buffer = stream->spare;
+	stream->length = 0;
+	stream->spare = data;
+	finish = stream->finished;
+	apr_thread_mutex_unlock(stream->mutex);
+
+	if(!connection || stream->delivered == TRUE) {
+		/* failed or complete, the rest of audio is of no use */
+		return;
+	}
+	if(length && vosk_recog_remote_frame_send(connection,WS_OPCODE_BINARY,data,length) == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Send Audio over Remote Connection %s",connection->id);
+		vosk_recog_remote_decoder_fail(remote,connection->decoder);
+		vosk_recog_remote_connection_close(remote,connection);
+		vosk_recog_remote_stream_deliver(stream,NULL);
+		return;
+	}
+	if(finish == TRUE && stream->finish_sent == FALSE) {
+		static const char eof[] = "{\"eof\" : 1}";
+		stream->finish_sent = TRUE;
+		vosk_recog_remote_frame_send(connection,WS_OPCODE_TEXT,eof,sizeof(eof) - 1);
+	}
+}
+
+/** Process received frame, return FALSE if the connection is to be closed (client context) */
+static apt_bool_t vosk_recog_remote_frame_process(vosk_recog_remote_connection_t *connection, int opcode, char *payload, apr_size_t size)
+{
+	vosk_recog_remote_stream_t *stream = connection->stream;
+	switch(opcode) {
+		case WS_OPCODE_TEXT:
+			if(stream) {
+				/* partial results are of no use, the first final one completes the request */
+				if(strstr(payload,"\"text\"")) {
+					vosk_recog_remote_stream_deliver(stream,payload);
+				}
+			}
+			break;
+		case WS_OPCODE_PING:
+			return vosk_recog_remote_frame_send(connection,WS_OPCODE_PONG,payload,size);
+		case WS_OPCODE_PONG:
+			connection->ping_pending = FALSE;
+			break;
+		case WS_OPCODE_CLOSE:
+			return FALSE;
+		default:
+			break;
+	}
+	return TRUE;
+}
+
+/** Parse the complete frames received (client context) */
+static apt_bool_t vosk_recog_remote_frames_parse(vosk_recog_remote_t *remote, vosk_recog_remote_connection_t *connection)
+{
+	unsigned char *data = (unsigned char*)connection->rx_buffer;
+	apr_size_t offset = 0;
+	unsigned char saved;
+	apt_bool_t status;
+
+	while(connection->rx_length - offset >= 2) {
+		unsigned char *frame = data + offset;
+		apr_size_t available = connection->rx_length - offset;
+		apr_size_t header = 2;
+		apr_uint64_t size = frame[1] & 0x7F;
+		apt_bool_t masked = (frame[1] & 0x80) ? TRUE : FALSE;
+		apr_size_t i;
+
+		if(!(frame[0] & 0x80) || (frame[0] & 0x0F) == WS_OPCODE_CONTINUATION) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Unsupported Fragmented Frame over Remote Connection %s",connection->id);
+			return FALSE;
+		}
+		if(size == 126) {
+			if(available < 4) {
+				break;
+			}
+			size = ((apr_uint64_t)frame[2] << 8) | frame[3];
+			header = 4;
+		}
+		else if(size == 127) {
+			if(available < 10) {
+				break;
+			}
+			size = 0;
+			for(i = 0; i < 8; i++) {
+				size = (size << 8) | frame[2 + i];
+			}
+			header = 10;
+		}
+		if(masked) {
+			header += 4;
+		}
+		/* one byte is kept to terminate text */
+		if(size + header >= VOSK_RECOG_REMOTE_RX_BUFFER_SIZE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Too Large Frame [%"APR_UINT64_T_FMT"] over Remote Connection %s",
+				size,connection->id);
+			return FALSE;
+		}
+		if(available < header + size) {
+			break;
+		}
+		if(masked) {
+			unsigned char *mask = frame + header - 4;
+			for(i = 0; i < size; i++) {
+				frame[header + i] ^= mask[i & 3];
+			}
+		}
+		offset += header + (apr_size_t)size;
+		/* the payload is terminated in place, the byte taken is of the next frame */
+		saved = data[offset];
+		data[offset] = '\0';
+		status = vosk_recog_remote_frame_process(connection,frame[0] & 0x0F,(char*)frame + header,(apr_size_t)size);
+		data[offset] = saved;
+		if(status == FALSE) {
+			return FALSE;
+		}
+	}
+
+	if(offset) {
+		connection->rx_length -= offset;
+		memmove(connection->rx_buffer,connection->rx_buffer + offset,connection->rx_length);
+	}
+	return TRUE;
+}
+
+/** Connection to be closed is lost, fail the stream it is assigned to (client context) */
+static void vosk_recog_remote_connection_lost(vosk_recog_remote_t *remote, vosk_recog_remote_connection_t *connection)
+{
+	vosk_recog_remote_stream_t *stream = connection->stream;
+	if(stream && stream->delivered == FALSE) {
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Remote Connection Lost %s",connection->id);
+		vosk_recog_remote_decoder_fail(remote,connection->decoder);
+	}
+	vosk_recog_remote_connection_close(remote,connection);
+	if(stream) {
+		vosk_recog_remote_stream_deliver(stream,NULL);
+	}
+}
+
+/* Receive frames over connection */
+static apt_bool_t vosk_recog_remote_signal_process(void *obj, const apr_pollfd_t *descriptor)
+{
+	vosk_recog_remote_t *remote = obj;
+	vosk_recog_remote_connection_t *connection = descriptor->client_data;
+	apr_size_t size;
+
+	if(!connection || !connection->sock) {
+		return FALSE;
+	}
+
+	size = VOSK_RECOG_REMOTE_RX_BUFFER_SIZE - connection->rx_length;
+	if(apr_socket_recv(connection->sock,connection->rx_buffer + connection->rx_length,&size) != APR_SUCCESS || !size) {
+		/* the decoder closes the connection once the final result of the stream is sent */
+		vosk_recog_remote_connection_lost(remote,connection);
+		return TRUE;
+	}
+	connection->rx_length += size;
+	if(vosk_recog_remote_frames_parse(remote,connection) == FALSE) {
+		vosk_recog_remote_connection_lost(remote,connection);
+	}
+	return TRUE;
+}
+
+/* Process task message */
+static apt_bool_t vosk_recog_remote_msg_process(apt_task_t *task, apt_task_msg_t *task_msg)
+{
+	apt_poller_task_t *poller_task = apt_task_object_get(task);
+	vosk_recog_remote_t *remote = apt_poller_task_object_get(poller_task);
+	vosk_recog_remote_msg_t *msg = (vosk_recog_remote_msg_t*)task_msg->data;
+	vosk_recog_remote_stream_t *stream = msg->stream;
+
+	switch(msg->type) {
+		case VOSK_RECOG_REMOTE_MSG_OPEN:
+			vosk_recog_remote_stream_route(remote,stream);
+			break;
+		case VOSK_RECOG_REMOTE_MSG_DATA:
+			vosk_recog_remote_stream_send(remote,stream);
+			break;
+		case VOSK_RECOG_REMOTE_MSG_CLOSE:
+			/* the connection of a stream is never reused, the decoder keeps its state */
+			if(stream->connection) {
+				vosk_recog_remote_connection_close(remote,stream->connection);
+			}
+			if(apr_atomic_dec32(&stream->refs) == 0) {
+				apr_thread_mutex_lock(remote->mutex);
+				vosk_recog_remote_stream_recycle(stream);
+				apr_thread_mutex_unlock(remote->mutex);
+			}
+			break;
+	}
+	return TRUE;
+}
+
+/* Timer callback */
+static void vosk_recog_remote_check_timer_proc(apt_timer_t *timer, void *obj)
+{
+	vosk_recog_remote_t *remote = obj;
+	vosk_recog_remote_connection_t *connection;
+	vosk_recog_remote_connection_t *next;
+
+	if(!remote || remote->check_timer != timer) {
+		return;
+	}
+
+	/* warm connections are pinged, the ones not answering since the last check are dead */
+	for(connection = APR_RING_FIRST(&remote->connections);
+			connection != APR_RING_SENTINEL(&remote->connections,vosk_recog_remote_connection_t,link);
+				connection = next) {
+		next = APR_RING_NEXT(connection,link);
+		if(connection->stream) {
+			continue;
+		}
+		if(connection->ping_pending == TRUE ||
+			vosk_recog_remote_frame_send(connection,WS_OPCODE_PING,NULL,0) == FALSE) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_INFO,"Drop Dead Remote Connection %s",connection->id);
+			vosk_recog_remote_decoder_fail(remote,connection->decoder);
+			vosk_recog_remote_connection_close(remote,connection);
+			continue;
+		}
+		connection->ping_pending = TRUE;
+	}
+
+	vosk_recog_remote_pool_replenish(remote);
+	apt_timer_set(timer,(apr_uint32_t)remote->check_interval);
+}
+
+static void vosk_recog_remote_on_pre_run(apt_task_t *task)
+{
+	apt_poller_task_t *poller_task = apt_task_object_get(task);
+	vosk_recog_remote_t *remote = apt_poller_task_object_get(poller_task);
+	/* establish the warm connections ahead of the first request */
+	vosk_recog_remote_pool_replenish(remote);
+	if(remote->check_timer) {
+		apt_timer_set(remote->check_timer,(apr_uint32_t)remote->check_interval);
+	}
+}
+
+static void vosk_recog_remote_on_post_run(apt_task_t *task)
+{
+	apt_poller_task_t *poller_task = apt_task_object_get(task);
+	vosk_recog_remote_t *remote = apt_poller_task_object_get(poller_task);
+
+	if(remote->check_timer) {
+		apt_timer_kill(remote->check_timer);
+	}
+	/* the channels are closed, the streams left are only referenced by the client */
+	while(!APR_RING_EMPTY(&remote->connections,vosk_recog_remote_connection_t,link)) {
+		vosk_recog_remote_connection_close(remote,APR_RING_FIRST(&remote->connections));
+	}
+}
+
+/** Signal message of stream to the client */
+static apt_bool_t vosk_recog_remote_msg_signal(vosk_recog_remote_stream_t *stream, vosk_recog_remote_msg_type_e type)
+{
+	apt_task_t *task = apt_poller_task_base_get(stream->remote->task);
+	apt_task_msg_t *task_msg = apt_task_msg_get(task);
+	if(task_msg) {
+		vosk_recog_remote_msg_t *msg = (vosk_recog_remote_msg_t*)task_msg->data;
+		msg->type = type;
+		msg->stream = stream;
+		return apt_task_msg_signal(task,task_msg);
+	}
+	return FALSE;
+}
+
+vosk_recog_remote_stream_t* vosk_recog_remote_stream_open(vosk_recog_remote_t *remote, int sample_rate, const char *options, void *obj)
+{
+	vosk_recog_remote_stream_t *stream = NULL;
+
+	if(!remote->task) {
+		return NULL;
+	}
+
+	apr_thread_mutex_lock(remote->mutex);
+	if(!APR_RING_EMPTY(&remote->idle,vosk_recog_remote_stream_t,link)) {
+		stream = APR_RING_FIRST(&remote->idle);
+		APR_RING_REMOVE(stream,link);
+	}
+	else {
+		/* streams are allocated once and reused, the pool is only used with the mutex locked */
+		stream = apr_palloc(remote->pool,sizeof(vosk_recog_remote_stream_t));
+		if(apr_thread_mutex_create(&stream->mutex,APR_THREAD_MUTEX_DEFAULT,remote->pool) != APR_SUCCESS) {
+			stream = NULL;
+		}
+		else {
+			stream->remote = remote;
+			stream->buffer = apr_palloc(remote->pool,remote->buffer_size);
+			stream->spare = apr_palloc(remote->pool,remote->buffer_size);
+			stream->result = NULL;
+			stream->options = NULL;
+		}
+	}
+	apr_thread_mutex_unlock(remote->mutex);
+	if(!stream) {
+		return NULL;
+	}
+
+	stream->connection = NULL;
+	stream->obj = obj;
+	stream->sample_rate = sample_rate;
+	stream->options = options ? strdup(options) : NULL;
+	stream->length = 0;
+	stream->finished = FALSE;
+	stream->closed = FALSE;
+	stream->dropped = FALSE;
+	stream->finish_sent = FALSE;
+	stream->delivered = FALSE;
+	apr_atomic_set32(&stream->signaled,0);
+	/* referenced by the owner and the client */
+	apr_atomic_set32(&stream->refs,2);
+	if(vosk_recog_remote_msg_signal(stream,VOSK_RECOG_REMOTE_MSG_OPEN) == FALSE) {
+		apr_thread_mutex_lock(remote->mutex);
+		vosk_recog_remote_stream_recycle(stream);
+		apr_thread_mutex_unlock(remote->mutex);
+		return NULL;
+	}
+	return stream;
+}
+
+apt_bool_t vosk_recog_remote_stream_write(vosk_recog_remote_stream_t *stream, const char *data, apr_size_t size)
+{
+	apt_bool_t status = TRUE;
+	apr_thread_mutex_lock(stream->mutex);
+	if(size > stream->remote->buffer_size - stream->length) {
+		size = stream->remote->buffer_size - stream->length;
+		status = FALSE;
+	}
+	memcpy(stream->buffer + stream->length,data,size);
+	stream->length += size;
+	apr_thread_mutex_unlock(stream->mutex);
+
+	/* one message is pending at most, it sends all the audio written till it is processed */
+	if(apr_atomic_cas32(&stream->signaled,1,0) == 0) {
+		vosk_recog_remote_msg_signal(stream,VOSK_RECOG_REMOTE_MSG_DATA);
+	}
+
+	if(status == FALSE && stream->dropped == FALSE) {
+		stream->dropped = TRUE;
+		apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Remote Stream Overflow, audio is dropped");
+	}
+	return status;
+}
+
+void vosk_recog_remote_stream_finish(vosk_recog_remote_stream_t *stream)
+{
+	apr_thread_mutex_lock(stream->mutex);
+	stream->finished = TRUE;
+	apr_thread_mutex_unlock(stream->mutex);
+	if(apr_atomic_cas32(&stream->signaled,1,0) == 0) {
+		vosk_recog_remote_msg_signal(stream,VOSK_RECOG_REMOTE_MSG_DATA);
+	}
+}
+
+void* vosk_recog_remote_stream_result_take(vosk_recog_remote_stream_t *stream, const char **result)
+{
+	void *obj;
+	apr_thread_mutex_lock(stream->mutex);
+	obj = stream->closed == FALSE ? stream->obj : NULL;
+	*result = stream->result;
+	apr_thread_mutex_unlock(stream->mutex);
+	/* the owner keeps its reference, while the stream is open */
+	vosk_recog_remote_stream_unref(stream);
+	return obj;
+}
+
+void vosk_recog_remote_stream_close(vosk_recog_remote_stream_t *stream)
+{
+	apr_thread_mutex_lock(stream->mutex);
+	stream->closed = TRUE;
+	stream->obj = NULL;
+	apr_thread_mutex_unlock(stream->mutex);
+	/* the client drops its reference along with the connection */
+	if(vosk_recog_remote_msg_signal(stream,VOSK_RECOG_REMOTE_MSG_CLOSE) == FALSE) {
+		vosk_recog_remote_stream_unref(stream);
+	}
+	vosk_recog_remote_stream_unref(stream);
+}
@@ -0,0 +1,582 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_atomic.h>
+#include <apr_strings.h>
+#include <apr_thread_mutex.h>
+#include "vosk_recog_worker.h"
+#include "apt_consumer_task.h"
+#include "apt_mpsc_queue.h"
+#include "apt_numa.h"
+#include "vosk_recog_log.h"
+
+#define VOSK_RECOG_WORKER_TASK_NAME "Vosk Decoder"
+/** Type of the message waking the worker up to drain its ready list */
+#define VOSK_RECOG_WORKER_WAKE -1
+/** Type of the message waking an idle worker up to steal ready objects of others */
+#define VOSK_RECOG_WORKER_STEAL -2
+
+/** Decoder worker */
+struct vosk_recog_worker_t {
+	/** Back pointer to the pool */
+	vosk_recog_worker_pool_t *worker_pool;
+	/** Consumer task (thread) */
+	apt_consumer_task_t      *task;
+	/** Sequence number within the pool */
+	apr_size_t                id;
+	/** Number of channels pinned to the worker */
+	volatile apr_uint32_t     channel_count;
+	/** CPU the worker is pinned to (-1 if not pinned to a single CPU) */
+	int                       cpu;
+	/** Objects marked ready (NULL if ready lists are disabled) */
+	apt_mpsc_queue_t         *ready;
+	/** Whether the worker is signaled to drain the ready list */
+	volatile apr_uint32_t     wake_pending;
+	/** Ready objects taken off the list, the worker takes them from the head, thieves from the tail (NULL if stealing is disabled) */
+	void                    **deque;
+	/** Index of the head of the deque */
+	apr_size_t                deque_head;
+	/** Number of objects in the deque */
+	volatile apr_uint32_t     deque_count;
+	/** Guard of the deque */
+	apr_thread_mutex_t       *deque_guard;
+	/** Whether the worker has no jobs pending, so that it may be woken up to steal */
+	volatile apr_uint32_t     idle;
+	/** Objects gathered to be handled at once (NULL if gathering is disabled) */
+	void                    **gathered;
+	/** Number of objects gathered */
+	apr_size_t                gathered_count;
+	/** Start of the window busy time is accumulated over */
+	apr_time_t                window_start;
+	/** Time busy with decoding within the window */
+	apr_interval_time_t       busy_time;
+	/** Load (permille) measured over the previous window */
+	apr_uint32_t              load;
+};
+
+/** Pool of decoder workers */
+struct vosk_recog_worker_pool_t {
+	/** Array of workers */
+	vosk_recog_worker_t      *workers;
+	/** Number of workers */
+	apr_size_t                count;
+	/** Job handler */
+	vosk_recog_worker_job_f   handler;
+	/** Handler of gathered objects */
+	vosk_recog_worker_gather_f gather_handler;
+	/** Max number of objects gathered per worker */
+	apr_size_t                gather_max_count;
+	/** Job type ready objects are handled as */
+	int                       ready_type;
+	/** Max number of objects marked ready per worker at once */
+	apr_size_t                ready_max_count;
+	/** Whether idle workers steal ready objects of busy ones */
+	apt_bool_t                steal;
+	/** Number of jobs signaled, but not taken by the workers yet (NULL if not counted) */
+	volatile apr_uint32_t    *backlog;
+};
+
+/** Job message */
+typedef struct vosk_recog_worker_msg_t vosk_recog_worker_msg_t;
+struct vosk_recog_worker_msg_t {
+	int   type;
+	void *obj;
+};
+
+static apt_bool_t vosk_recog_worker_msg_send(vosk_recog_worker_t *worker, int type, void *obj);
+
+/** Handle ready object (worker thread) */
+static APR_INLINE void vosk_recog_worker_ready_handle(vosk_recog_worker_t *worker, void *obj)
+{
+	if(worker->worker_pool->backlog) {
+		apr_atomic_dec32(worker->worker_pool->backlog);
+	}
+	worker->worker_pool->handler(worker,worker->worker_pool->ready_type,obj);
+}
+
+/** Wake an idle worker of the node up to steal from the deque of the worker */
+static void vosk_recog_worker_thief_wake(vosk_recog_worker_t *worker)
+{
+	vosk_recog_worker_pool_t *worker_pool = worker->worker_pool;
+	int numa_node = vosk_recog_worker_numa_node_get(worker);
+	apr_size_t i;
+	for(i=0; i<worker_pool->count; i++) {
+		vosk_recog_worker_t *thief = &worker_pool->workers[(worker->id + 1 + i) % worker_pool->count];
+		if(thief == worker || vosk_recog_worker_numa_node_get(thief) != numa_node) {
+			continue;
+		}
+		if(apr_atomic_cas32(&thief->idle,0,1) == 1) {
+			if(vosk_recog_worker_msg_send(thief,VOSK_RECOG_WORKER_STEAL,NULL) == TRUE) {
+				return;
+			}
+			/* the queue of the thief is full, it is still idle as far as the others are concerned */
+			apr_atomic_set32(&thief->idle,1);
+		}
+	}
+}
+
+/** Take object from the head of the deque of the worker, or from the tail for a thief */
+static void* vosk_recog_worker_deque_take(vosk_recog_worker_t *worker, apt_bool_t tail)
+{
+	void *obj = NULL;
+	apr_thread_mutex_lock(worker->deque_guard);
+	if(worker->deque_count) {
+		apr_size_t capacity = worker->worker_pool->ready_max_count;
+		if(tail == TRUE) {
+			obj = worker->deque[(worker->deque_head + worker->deque_count - 1) % capacity];
+		}
+		else {
+			obj = worker->deque[worker->deque_head];
+			worker->deque_head = (worker->deque_head + 1) % capacity;
+		}
+		apr_atomic_dec32(&worker->deque_count);
+	}
+	apr_thread_mutex_unlock(worker->deque_guard);
+	return obj;
+}
+
+/** Move the objects marked ready to the deque, where thieves can reach them (worker thread) */
+static void vosk_recog_worker_deque_fill(vosk_recog_worker_t *worker)
+{
+	apr_size_t capacity = worker->worker_pool->ready_max_count;
+	apr_uint32_t count;
+	void *obj;
+	apr_thread_mutex_lock(worker->deque_guard);
+	while(worker->deque_count < capacity && (obj = apt_mpsc_queue_pop(worker->ready)) != NULL) {
+		worker->deque[(worker->deque_head + worker->deque_count) % capacity] = obj;
+		apr_atomic_inc32(&worker->deque_count);
+	}
+	count = worker->deque_count;
+	apr_thread_mutex_unlock(worker->deque_guard);
+	if(count > 1) {
+		/* more than the one taken next wait behind it */
+		vosk_recog_worker_thief_wake(worker);
+	}
+}
+
+/** Handle all the objects marked ready (worker thread) */
+static void vosk_recog_worker_ready_drain(vosk_recog_worker_t *worker)
+{
+	void *obj;
+	/* cleared first, so that an object marked meanwhile wakes the worker again */
+	apr_atomic_xchg32(&worker->wake_pending,0);
+	if(worker->deque) {
+		do {
+			vosk_recog_worker_deque_fill(worker);
+			obj = vosk_recog_worker_deque_take(worker,FALSE);
+			if(obj) {
+				vosk_recog_worker_ready_handle(worker,obj);
+			}
+		}
+		while(obj);
+		return;
+	}
+	while((obj = apt_mpsc_queue_pop(worker->ready)) != NULL) {
+		vosk_recog_worker_ready_handle(worker,obj);
+	}
+}
+
+/** Handle the ready objects of the most loaded workers of the node, till none is left or a job is signaled (worker thread) */
+static void vosk_recog_worker_steal(vosk_recog_worker_t *worker)
+{
+	vosk_recog_worker_pool_t *worker_pool = worker->worker_pool;
+	int numa_node = vosk_recog_worker_numa_node_get(worker);
+	while(!apt_consumer_task_queue_size_get(worker->task)) {
+		vosk_recog_worker_t *victim = NULL;
+		apr_uint32_t max_count = 0;
+		apr_size_t i;
+		void *obj;
+		for(i=0; i<worker_pool->count; i++) {
+			vosk_recog_worker_t *other = &worker_pool->workers[i];
+			apr_uint32_t count = apr_atomic_read32(&other->deque_count);
+			if(other != worker && count > max_count && vosk_recog_worker_numa_node_get(other) == numa_node) {
+				max_count = count;
+				victim = other;
+			}
+		}
+		if(!victim) {
+			break;
+		}
+		obj = vosk_recog_worker_deque_take(victim,TRUE);
+		if(obj) {
+			vosk_recog_worker_ready_handle(worker,obj);
+		}
+	}
+}
+
+static apt_bool_t vosk_recog_worker_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	vosk_recog_worker_t *worker = apt_consumer_task_object_get(consumer_task);
+	vosk_recog_worker_msg_t *worker_msg = (vosk_recog_worker_msg_t*)msg->data;
+	if(worker->deque) {
+		apr_atomic_set32(&worker->idle,0);
+	}
+	if(worker->ready) {
+		/* the objects marked ahead of the job are handled ahead of it */
+		vosk_recog_worker_ready_drain(worker);
+	}
+	if(worker_msg->type == VOSK_RECOG_WORKER_STEAL) {
+		vosk_recog_worker_steal(worker);
+	}
+	else if(worker_msg->type != VOSK_RECOG_WORKER_WAKE) {
+		if(worker->worker_pool->backlog) {
+			apr_atomic_dec32(worker->worker_pool->backlog);
+		}
+		worker->worker_pool->handler(worker,worker_msg->type,worker_msg->obj);
+	}
+	if(worker->gathered_count && !apt_consumer_task_queue_size_get(worker->task)) {
+		/* no more jobs pending, nothing else is going to be gathered soon */
+		vosk_recog_worker_gather_flush(worker);
+	}
+	if(worker->deque && !apt_consumer_task_queue_size_get(worker->task)) {
+		/* the others may have filled their deques while the worker was busy */
+		vosk_recog_worker_steal(worker);
+		/* about to wait for the next job, it may be woken up to steal meanwhile */
+		apr_atomic_set32(&worker->idle,1);
+	}
+	return TRUE;
+}
+
+vosk_recog_worker_pool_t* vosk_recog_worker_pool_create(apr_size_t count, vosk_recog_worker_job_f handler, apr_pool_t *pool)
+{
+	apr_size_t i;
+	apt_task_msg_pool_t *msg_pool;
+	vosk_recog_worker_pool_t *worker_pool;
+
+	if(!count || !handler) {
+		return NULL;
+	}
+
+	worker_pool = apr_palloc(pool,sizeof(vosk_recog_worker_pool_t));
+	worker_pool->workers = apr_pcalloc(pool,sizeof(vosk_recog_worker_t) * count);
+	worker_pool->count = count;
+	worker_pool->handler = handler;
+	worker_pool->gather_handler = NULL;
+	worker_pool->gather_max_count = 0;
+	worker_pool->ready_type = 0;
+	worker_pool->ready_max_count = 0;
+	worker_pool->steal = FALSE;
+	worker_pool->backlog = NULL;
+
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(vosk_recog_worker_msg_t),pool);
+	for(i=0; i<count; i++) {
+		apt_task_t *task;
+		apt_task_vtable_t *vtable;
+		vosk_recog_worker_t *worker = &worker_pool->workers[i];
+		worker->worker_pool = worker_pool;
+		worker->id = i;
+		worker->channel_count = 0;
+		worker->cpu = -1;
+		worker->ready = NULL;
+		worker->wake_pending = 0;
+		worker->deque = NULL;
+		worker->deque_head = 0;
+		worker->deque_count = 0;
+		worker->deque_guard = NULL;
+		worker->idle = 0;
+		worker->gathered = NULL;
+		worker->gathered_count = 0;
+		worker->window_start = 0;
+		worker->busy_time = 0;
+		worker->load = 0;
+		worker->task = apt_consumer_task_create(worker,msg_pool,pool);
+		if(!worker->task) {
+			apt_log(RECOG_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Decoder Worker [%"APR_SIZE_T_FMT"]",i);
+			return NULL;
+		}
+		task = apt_consumer_task_base_get(worker->task);
+		apt_task_name_set(task,apr_psprintf(pool,VOSK_RECOG_WORKER_TASK_NAME" %"APR_SIZE_T_FMT,i+1));
+		vtable = apt_task_vtable_get(task);
+		if(vtable) {
+			vtable->process_msg = vosk_recog_worker_msg_process;
+		}
+	}
+	return worker_pool;
+}
+
+void vosk_recog_worker_pool_destroy(vosk_recog_worker_pool_t *worker_pool)
+{
+	apr_size_t i;
+	for(i=0; i<worker_pool->count; i++) {
+		vosk_recog_worker_t *worker = &worker_pool->workers[i];
+		if(worker->task) {
+			apt_task_destroy(apt_consumer_task_base_get(worker->task));
+			worker->task = NULL;
+		}
+	}
+}
+
+apt_bool_t vosk_recog_worker_pool_start(vosk_recog_worker_pool_t *worker_pool)
+{
+	apr_size_t i;
+	for(i=0; i<worker_pool->count; i++) {
+		vosk_recog_worker_t *worker = &worker_pool->workers[i];
+		if(apt_task_start(apt_consumer_task_base_get(worker->task)) == FALSE) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+apt_bool_t vosk_recog_worker_pool_terminate(vosk_recog_worker_pool_t *worker_pool)
+{
+	apr_size_t i;
+	for(i=0; i<worker_pool->count; i++) {
+		vosk_recog_worker_t *worker = &worker_pool->workers[i];
+		apt_task_terminate(apt_consumer_task_base_get(worker->task),TRUE);
+	}
+	return TRUE;
+}
+
+void vosk_recog_worker_pool_backlog_bind(vosk_recog_worker_pool_t *worker_pool, volatile apr_uint32_t *backlog)
+{
+	worker_pool->backlog = backlog;
+}
+
+apt_bool_t vosk_recog_worker_pool_gather_enable(vosk_recog_worker_pool_t *worker_pool, apr_size_t max_count, vosk_recog_worker_gather_f handler, apr_pool_t *pool)
+{
+	apr_size_t i;
+	if(!max_count || !handler) {
+		return FALSE;
+	}
+	for(i=0; i<worker_pool->count; i++) {
+		worker_pool->workers[i].gathered = apr_palloc(pool,sizeof(void*) * max_count);
+		worker_pool->workers[i].gathered_count = 0;
+	}
+	worker_pool->gather_handler = handler;
+	worker_pool->gather_max_count = max_count;
+	return TRUE;
+}
+
+apt_bool_t vosk_recog_worker_pool_ready_enable(vosk_recog_worker_pool_t *worker_pool, int type, apr_size_t max_count, apr_pool_t *pool)
+{
+	apr_size_t i;
+	if(!max_count) {
+		return FALSE;
+	}
+	for(i=0; i<worker_pool->count; i++) {
+		worker_pool->workers[i].ready = apt_mpsc_queue_create(max_count,pool);
+		if(!worker_pool->workers[i].ready) {
+			return FALSE;
+		}
+	}
+	worker_pool->ready_type = type;
+	worker_pool->ready_max_count = max_count;
+	return TRUE;
+}
+
+apt_bool_t vosk_recog_worker_pool_steal_enable(vosk_recog_worker_pool_t *worker_pool, apr_pool_t *pool)
+{
+	apr_size_t i;
+	if(!worker_pool->ready_max_count || worker_pool->count < 2) {
+		return FALSE;
+	}
+	for(i=0; i<worker_pool->count; i++) {
+		if(apr_thread_mutex_create(&worker_pool->workers[i].deque_guard,APR_THREAD_MUTEX_DEFAULT,pool) != APR_SUCCESS) {
+			return FALSE;
+		}
+	}
+	for(i=0; i<worker_pool->count; i++) {
+		vosk_recog_worker_t *worker = &worker_pool->workers[i];
+		worker->deque = apr_palloc(pool,sizeof(void*) * worker_pool->ready_max_count);
+		/* a worker started is waiting for its first job */
+		worker->idle = 1;
+	}
+	worker_pool->steal = TRUE;
+	return TRUE;
+}
+
+apr_size_t vosk_recog_worker_pool_count_get(const vosk_recog_worker_pool_t *worker_pool)
+{
+	return worker_pool->count;
+}
+
+apt_task_t* vosk_recog_worker_pool_task_get(const vosk_recog_worker_pool_t *worker_pool, apr_size_t index)
+{
+	if(index >= worker_pool->count || !worker_pool->workers[index].task) {
+		return NULL;
+	}
+	return apt_consumer_task_base_get(worker_pool->workers[index].task);
+}
+
+apt_bool_t vosk_recog_worker_pool_cpu_set(vosk_recog_worker_pool_t *worker_pool, apr_size_t index, int cpu)
+{
+	char cpu_set[16];
+	if(index >= worker_pool->count || !worker_pool->workers[index].task || cpu < 0) {
+		return FALSE;
+	}
+	apr_snprintf(cpu_set,sizeof(cpu_set),"%d",cpu);
+	if(apt_task_affinity_set(apt_consumer_task_base_get(worker_pool->workers[index].task),cpu_set) == FALSE) {
+		return FALSE;
+	}
+	worker_pool->workers[index].cpu = cpu;
+	return TRUE;
+}
+
+/** Get how close the worker is to the media (2 - same CPU, 1 - same node, 0 - neither) */
+static int vosk_recog_worker_distance_score(const vosk_recog_worker_t *worker, int cpu, int numa_node)
+{
+	int worker_node;
+	if(cpu >= 0 && worker->cpu == cpu) {
+		return 2;
+	}
+	if(numa_node == APT_NUMA_NODE_NONE) {
+		return 0;
+	}
+	worker_node = vosk_recog_worker_numa_node_get(worker);
+	if(worker_node == APT_NUMA_NODE_NONE && worker->cpu >= 0) {
+		worker_node = apt_numa_cpu_node_get(worker->cpu);
+	}
+	return worker_node == numa_node ? 1 : 0;
+}
+
+vosk_recog_worker_t* vosk_recog_worker_assign(vosk_recog_worker_pool_t *worker_pool, int cpu, int numa_node)
+{
+	apr_size_t i;
+	vosk_recog_worker_t *worker = NULL;
+	apr_uint32_t min_count = 0;
+	int max_score = 0;
+	for(i=0; i<worker_pool->count; i++) {
+		apr_uint32_t count = apr_atomic_read32(&worker_pool->workers[i].channel_count);
+		/* the closest workers first, the least loaded of them next */
+		int score = vosk_recog_worker_distance_score(&worker_pool->workers[i],cpu,numa_node);
+		if(!worker || score > max_score || (score == max_score && count < min_count)) {
+			max_score = score;
+			min_count = count;
+			worker = &worker_pool->workers[i];
+		}
+	}
+	if(worker) {
+		apr_atomic_inc32(&worker->channel_count);
+	}
+	return worker;
+}
+
+void vosk_recog_worker_release(vosk_recog_worker_t *worker)
+{
+	apr_atomic_dec32(&worker->channel_count);
+}
+
+void vosk_recog_worker_retain(vosk_recog_worker_t *worker)
+{
+	apr_atomic_inc32(&worker->channel_count);
+}
+
+int vosk_recog_worker_numa_node_get(const vosk_recog_worker_t *worker)
+{
+	return apt_task_numa_node_get(apt_consumer_task_base_get(worker->task));
+}
+
+int vosk_recog_worker_cpu_get(const vosk_recog_worker_t *worker)
+{
+	return worker->cpu;
+}
+
+/** Send message to the worker */
+static apt_bool_t vosk_recog_worker_msg_send(vosk_recog_worker_t *worker, int type, void *obj)
+{
+	apt_task_t *task = apt_consumer_task_base_get(worker->task);
+	apt_task_msg_t *msg = apt_task_msg_get(task);
+	vosk_recog_worker_msg_t *worker_msg;
+	if(!msg) {
+		return FALSE;
+	}
+	msg->type = TASK_MSG_USER;
+	worker_msg = (vosk_recog_worker_msg_t*) msg->data;
+	worker_msg->type = type;
+	worker_msg->obj = obj;
+	return apt_task_msg_signal(task,msg);
+}
+
+apt_bool_t vosk_recog_worker_signal(vosk_recog_worker_t *worker, int type, void *obj)
+{
+	apt_bool_t status;
+	if(worker->worker_pool->backlog) {
+		apr_atomic_inc32(worker->worker_pool->backlog);
+	}
+	status = vosk_recog_worker_msg_send(worker,type,obj);
+	if(status == FALSE && worker->worker_pool->backlog) {
+		apr_atomic_dec32(worker->worker_pool->backlog);
+	}
+	return status;
+}
+
+apt_bool_t vosk_recog_worker_ready(vosk_recog_worker_t *worker, void *obj)
+{
+	if(!worker->ready) {
+		return vosk_recog_worker_signal(worker,worker->worker_pool->ready_type,obj);
+	}
+	if(worker->worker_pool->backlog) {
+		apr_atomic_inc32(worker->worker_pool->backlog);
+	}
+	if(apt_mpsc_queue_push(worker->ready,obj) == FALSE) {
+		if(worker->worker_pool->backlog) {
+			apr_atomic_dec32(worker->worker_pool->backlog);
+		}
+		return vosk_recog_worker_signal(worker,worker->worker_pool->ready_type,obj);
+	}
+	/* published before the flag is checked, hence either drained by the pass in progress or by the next one */
+	if(apr_atomic_cas32(&worker->wake_pending,1,0) != 0) {
+		return TRUE;
+	}
+	if(vosk_recog_worker_msg_send(worker,VOSK_RECOG_WORKER_WAKE,NULL) == FALSE) {
+		/* no wake-up is on the way, the next object marked ready must send one */
+		apr_atomic_xchg32(&worker->wake_pending,0);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+void vosk_recog_worker_gather(vosk_recog_worker_t *worker, void *obj)
+{
+	worker->gathered[worker->gathered_count++] = obj;
+	if(worker->gathered_count == worker->worker_pool->gather_max_count) {
+		vosk_recog_worker_gather_flush(worker);
+	}
+}
+
+void vosk_recog_worker_gather_flush(vosk_recog_worker_t *worker)
+{
+	apr_size_t count = worker->gathered_count;
+	if(!count) {
+		return;
+	}
+	worker->gathered_count = 0;
+	worker->worker_pool->gather_handler(worker,worker->gathered,count);
+}
+
+void vosk_recog_worker_busy_record(vosk_recog_worker_t *worker, apr_time_t now, apr_interval_time_t busy_time)
+{
+	apr_interval_time_t window = now - worker->window_start;
+	worker->busy_time += busy_time;
+	if(window >= APR_USEC_PER_SEC) {
+		/* an idle worker records nothing, so a long window is due to idleness and yields a low load */
+		worker->load = worker->window_start ? (apr_uint32_t)(worker->busy_time * 1000 / window) : 0;
+		worker->window_start = now;
+		worker->busy_time = 0;
+	}
+}
+
+apr_uint32_t vosk_recog_worker_load_get(const vosk_recog_worker_t *worker)
+{
+	return worker->load;
+}
+
+apr_size_t vosk_recog_worker_id_get(const vosk_recog_worker_t *worker)
+{
+	return worker->id;
+}
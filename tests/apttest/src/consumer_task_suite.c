@@ -15,10 +15,25 @@
  */
 
 #include <apr_time.h>
+#include <apr_thread_proc.h>
 #include "apt_test_suite.h"
 #include "apt_consumer_task.h"
 #include "apt_log.h"
 
+/** Capacity of the message queue */
+#define CONSUMER_TEST_QUEUE_SIZE   8
+/** Number of messages to signal */
+#define CONSUMER_TEST_MESSAGE_COUNT 10000
+/** Timer timeout in msec */
+#define CONSUMER_TEST_TIMEOUT      20
+
+/** Consumer task test context */
+typedef struct {
+	volatile int processed;
+	apt_bool_t   out_of_order;
+	apt_bool_t   timer_fired;
+} consumer_test_t;
+
 typedef struct {
 	apr_time_t timestamp;
 	int        number;
@@ -36,11 +51,24 @@ static void task_on_terminate_complete(apt_task_t *task)
 
 static apt_bool_t task_msg_process(apt_task_t *task, apt_task_msg_t *msg)
 {
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	consumer_test_t *test = apt_consumer_task_object_get(consumer_task);
 	sample_msg_data_t *data = (sample_msg_data_t*)msg->data;
 	apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Process Message [%d]",data->number);
+	if(data->number != test->processed) {
+		test->out_of_order = TRUE;
+	}
+	test->processed++;
 	return TRUE;
 }
 
+static void task_timer_proc(apt_timer_t *timer, void *obj)
+{
+	consumer_test_t *test = obj;
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"On Timer Expire");
+	test->timer_fired = TRUE;
+}
+
 
 static apt_bool_t consumer_task_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
 {
@@ -49,18 +77,26 @@ static apt_bool_t consumer_task_test_run(apt_test_suite_t *suite, int argc, cons
 	apt_task_vtable_t *vtable;
 	apt_task_msg_pool_t *msg_pool;
 	apt_task_msg_t *msg;
+	apt_timer_t *timer;
 	sample_msg_data_t *data;
+	const apt_histogram_t *process_hist;
+	consumer_test_t test;
+	apt_bool_t status = TRUE;
 	int i;
 	
+	test.processed = 0;
+	test.out_of_order = FALSE;
+	test.timer_fired = FALSE;
 	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(sample_msg_data_t),suite->pool);
 
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Create Consumer Task");
-	consumer_task = apt_consumer_task_create(NULL,msg_pool,suite->pool);
+	consumer_task = apt_consumer_task_create_ex(&test,msg_pool,CONSUMER_TEST_QUEUE_SIZE,suite->pool);
 	if(!consumer_task) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Consumer Task");
 		return FALSE;
 	}
 	task = apt_consumer_task_base_get(consumer_task);
+	apt_task_stats_enable(task,0);
 	vtable = apt_task_vtable_get(task);
 	if(vtable) {
 		vtable->process_msg = task_msg_process;
@@ -68,6 +104,37 @@ static apt_bool_t consumer_task_test_run(apt_test_suite_t *suite, int argc, cons
 		vtable->on_terminate_complete = task_on_terminate_complete;
 	}
 
+	timer = apt_consumer_task_timer_create(consumer_task,task_timer_proc,&test,suite->pool);
+	if(!timer) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Timer");
+		apt_task_destroy(task);
+		return FALSE;
+	}
+
+	/* timers are only safe to set from the task thread, or before it is started */
+	apt_timer_set(timer,CONSUMER_TEST_TIMEOUT);
+
+	/* the task isn't running yet, the queue must report back-pressure once full */
+	for(i=0; i<CONSUMER_TEST_QUEUE_SIZE; i++) {
+		msg = apt_task_msg_acquire(msg_pool);
+		msg->type = TASK_MSG_USER;
+		data = (sample_msg_data_t*) msg->data;
+		data->number = i;
+		data->timestamp = apr_time_now();
+		if(apt_task_msg_signal(task,msg) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Signal Message [%d]",i);
+			apt_task_destroy(task);
+			return FALSE;
+		}
+	}
+	msg = apt_task_msg_acquire(msg_pool);
+	msg->type = TASK_MSG_USER;
+	if(apt_task_msg_signal(task,msg) == TRUE || apt_consumer_task_queue_size_get(consumer_task) != CONSUMER_TEST_QUEUE_SIZE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Full Queue");
+		apt_task_destroy(task);
+		return FALSE;
+	}
+
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Start Task");
 	if(apt_task_start(task) == FALSE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Task");
@@ -75,7 +142,7 @@ static apt_bool_t consumer_task_test_run(apt_test_suite_t *suite, int argc, cons
 		return FALSE;
 	}
 
-	for(i=0; i<10; i++) {
+	for(i=CONSUMER_TEST_QUEUE_SIZE; i<CONSUMER_TEST_MESSAGE_COUNT; ) {
 		msg = apt_task_msg_acquire(msg_pool);
 		msg->type = TASK_MSG_USER;
 		data = (sample_msg_data_t*) msg->data;
@@ -83,14 +150,42 @@ static apt_bool_t consumer_task_test_run(apt_test_suite_t *suite, int argc, cons
 		data->number = i;
 		data->timestamp = apr_time_now();
 		apt_log(APT_LOG_MARK,APT_PRIO_DEBUG,"Signal Message [%d]",data->number);
-		apt_task_msg_signal(task,msg);
+		if(apt_task_msg_signal(task,msg) == TRUE) {
+			i++;
+		}
+		else {
+			/* back-pressure, let the consumer catch up */
+			apr_thread_yield();
+		}
+	}
+
+	while(apt_consumer_task_queue_size_get(consumer_task) || test.processed < CONSUMER_TEST_MESSAGE_COUNT) {
+		apr_thread_yield();
+	}
+	apr_sleep(4 * CONSUMER_TEST_TIMEOUT * 1000);
+
+	apt_task_stats_dump(task);
+	process_hist = apt_task_histogram_get(task,TASK_HISTOGRAM_PROCESS_TIME);
+	if(apt_histogram_count_get(process_hist) < CONSUMER_TEST_MESSAGE_COUNT ||
+		apt_histogram_count_get(apt_task_histogram_get(task,TASK_HISTOGRAM_DWELL_TIME)) != apt_histogram_count_get(process_hist)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Task Stats [%"APR_SIZE_T_FMT"]",apt_histogram_count_get(process_hist));
+		status = FALSE;
 	}
 
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Terminate Task [wait till complete]");
 	apt_task_terminate(task,TRUE);
 	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Destroy Task");
 	apt_task_destroy(task);
-	return TRUE;
+
+	if(test.processed != CONSUMER_TEST_MESSAGE_COUNT || test.out_of_order == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Messages processed [%d] out of order [%d]",test.processed,test.out_of_order);
+		return FALSE;
+	}
+	if(test.timer_fired == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Timer Not Fired");
+		return FALSE;
+	}
+	return status;
 }
 
 apt_test_suite_t* consumer_task_test_suite_create(apr_pool_t *pool)
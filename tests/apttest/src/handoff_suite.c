@@ -0,0 +1,148 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_time.h>
+#include <apr_file_io.h>
+#include <apr_strings.h>
+#include "apt_test_suite.h"
+#include "apt_handoff.h"
+#include "apt_log.h"
+
+/** Max time (msec) to wait for the predecessor to be released */
+#define HANDOFF_TEST_TIMEOUT 3000
+
+static void handoff_test_on_takeover(apt_handoff_t *handoff, void *obj)
+{
+	volatile apt_bool_t *taken_over = obj;
+	*taken_over = TRUE;
+}
+
+static apr_socket_t* handoff_test_listener_create(apr_sockaddr_t **sockaddr, apr_pool_t *pool)
+{
+	apr_socket_t *sock;
+	apr_sockaddr_t *bound;
+	if(apr_sockaddr_info_get(sockaddr,"127.0.0.1",APR_INET,0,0,pool) != APR_SUCCESS ||
+		apr_socket_create(&sock,APR_INET,SOCK_STREAM,APR_PROTO_TCP,pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_socket_bind(sock,*sockaddr) != APR_SUCCESS || apr_socket_listen(sock,SOMAXCONN) != APR_SUCCESS ||
+		apr_socket_addr_get(&bound,APR_LOCAL,sock) != APR_SUCCESS) {
+		apr_socket_close(sock);
+		return NULL;
+	}
+	/* the port is assigned on bind */
+	apr_sockaddr_info_get(sockaddr,"127.0.0.1",APR_INET,bound->port,0,pool);
+	return sock;
+}
+
+static apt_bool_t handoff_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_handoff_t *predecessor;
+	apt_handoff_t *successor;
+	apr_socket_t *listener;
+	apr_socket_t *inherited;
+	apr_socket_t *client;
+	apr_socket_t *accepted;
+	apr_sockaddr_t *sockaddr;
+	apr_sockaddr_t *other;
+	const char *temp_dir;
+	const char *path;
+	volatile apt_bool_t taken_over = FALSE;
+	apr_time_t start;
+
+#ifdef WIN32
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Handoff Not Supported");
+	return TRUE;
+#endif
+
+	if(apr_temp_dir_get(&temp_dir,suite->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	path = apr_psprintf(suite->pool,"%s/apttest-%"APR_TIME_T_FMT".sock",temp_dir,apr_time_now());
+
+	listener = handoff_test_listener_create(&sockaddr,suite->pool);
+	if(!listener) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Listening Socket");
+		return FALSE;
+	}
+
+	/* nobody serves the path yet */
+	predecessor = apt_handoff_create(path,suite->pool);
+	if(apt_handoff_receive(predecessor) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Predecessor");
+		return FALSE;
+	}
+	apt_handoff_socket_add(predecessor,listener);
+	if(apt_handoff_complete(predecessor,handoff_test_on_takeover,(void*)&taken_over) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Serve Handoff [%s]",path);
+		return FALSE;
+	}
+
+	successor = apt_handoff_create(path,suite->pool);
+	if(apt_handoff_receive(successor) != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Receive Listening Socket");
+		return FALSE;
+	}
+
+	/* sockets are taken by the address they are bound to */
+	apr_sockaddr_info_get(&other,"127.0.0.1",APR_INET,sockaddr->port + 1,0,suite->pool);
+	if(apt_handoff_socket_take(successor,other,suite->pool) != NULL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Socket Taken");
+		return FALSE;
+	}
+	inherited = apt_handoff_socket_take(successor,sockaddr,suite->pool);
+	if(!inherited) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Take Listening Socket");
+		return FALSE;
+	}
+
+	/* the predecessor is released once the successor completes */
+	if(taken_over == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Predecessor Released Too Early");
+		return FALSE;
+	}
+	apt_handoff_complete(successor,NULL,NULL);
+	start = apr_time_now();
+	while(taken_over == FALSE && apr_time_now() - start < apr_time_from_msec(HANDOFF_TEST_TIMEOUT)) {
+		apr_sleep(apr_time_from_msec(10));
+	}
+	if(taken_over == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Predecessor Not Released");
+		return FALSE;
+	}
+
+	/* the inherited socket accepts connections, once the predecessor closes its own */
+	apr_socket_close(listener);
+	if(apr_socket_create(&client,APR_INET,SOCK_STREAM,APR_PROTO_TCP,suite->pool) != APR_SUCCESS ||
+		apr_socket_connect(client,sockaddr) != APR_SUCCESS ||
+		apr_socket_accept(&accepted,inherited,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Accept by Inherited Socket");
+		return FALSE;
+	}
+	apr_socket_close(accepted);
+	apr_socket_close(client);
+	apr_socket_close(inherited);
+
+	apt_handoff_destroy(predecessor);
+	apt_handoff_destroy(successor);
+	return TRUE;
+}
+
+apt_test_suite_t* handoff_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"handoff",NULL,handoff_test_run);
+	return suite;
+}
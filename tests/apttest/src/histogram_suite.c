@@ -0,0 +1,125 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_time.h>
+#include <apr_thread_proc.h>
+#include "apt_test_suite.h"
+#include "apt_histogram.h"
+#include "apt_log.h"
+
+/** Number of values to record sequentially */
+#define HISTOGRAM_TEST_VALUE_COUNT   100000
+/** Number of threads to record concurrently */
+#define HISTOGRAM_TEST_THREAD_COUNT  4
+/** Max relative error of the percentile in percents */
+#define HISTOGRAM_TEST_PRECISION     6.25
+
+static apt_bool_t histogram_value_check(const char *name, apr_uint32_t value, apr_uint32_t expected)
+{
+	double error = ((double)value - expected) * 100 / expected;
+	if(error < -HISTOGRAM_TEST_PRECISION || error > HISTOGRAM_TEST_PRECISION) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected %s [%u] expected [%u]",name,value,expected);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void* APR_THREAD_FUNC histogram_thread_run(apr_thread_t *thread, void *data)
+{
+	apt_histogram_t *histogram = data;
+	apr_uint32_t i;
+	for(i=1; i<=HISTOGRAM_TEST_VALUE_COUNT; i++) {
+		apt_histogram_record(histogram,i);
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static apt_bool_t histogram_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_histogram_t *histogram;
+	apr_thread_t *threads[HISTOGRAM_TEST_THREAD_COUNT];
+	apr_status_t rv;
+	apr_time_t start;
+	apr_uint32_t i;
+
+	histogram = apt_histogram_create(suite->pool);
+	if(apt_histogram_count_get(histogram) != 0 || apt_histogram_percentile_get(histogram,50) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Empty Histogram");
+		return FALSE;
+	}
+
+	/* small values are counted exactly */
+	for(i=0; i<10; i++) {
+		apt_histogram_record(histogram,i);
+	}
+	if(apt_histogram_percentile_get(histogram,50) != 4 || apt_histogram_percentile_get(histogram,100) != 9 ||
+		apt_histogram_min_get(histogram) != 0 || apt_histogram_max_get(histogram) != 9) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Exact Percentiles");
+		return FALSE;
+	}
+
+	apt_histogram_reset(histogram);
+	start = apr_time_now();
+	for(i=1; i<=HISTOGRAM_TEST_VALUE_COUNT; i++) {
+		apt_histogram_record(histogram,i);
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Record [%d] values [%.1f ns/value]",HISTOGRAM_TEST_VALUE_COUNT,
+		(apr_time_now() - start) * 1000.0 / HISTOGRAM_TEST_VALUE_COUNT);
+	if(apt_histogram_count_get(histogram) != HISTOGRAM_TEST_VALUE_COUNT ||
+		apt_histogram_min_get(histogram) != 1 ||
+		apt_histogram_max_get(histogram) != HISTOGRAM_TEST_VALUE_COUNT ||
+		histogram_value_check("Mean",(apr_uint32_t)apt_histogram_mean_get(histogram),HISTOGRAM_TEST_VALUE_COUNT / 2) == FALSE ||
+		histogram_value_check("P50",apt_histogram_percentile_get(histogram,50),HISTOGRAM_TEST_VALUE_COUNT / 2) == FALSE ||
+		histogram_value_check("P99",apt_histogram_percentile_get(histogram,99),HISTOGRAM_TEST_VALUE_COUNT / 100 * 99) == FALSE ||
+		apt_histogram_percentile_get(histogram,100) != HISTOGRAM_TEST_VALUE_COUNT) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Percentiles");
+		return FALSE;
+	}
+
+	/* the whole 32-bit range is covered */
+	apt_histogram_reset(histogram);
+	apt_histogram_record(histogram,0xFFFFFFFF);
+	if(apt_histogram_percentile_get(histogram,50) != 0xFFFFFFFF || apt_histogram_min_get(histogram) != 0xFFFFFFFE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Max Value");
+		return FALSE;
+	}
+
+	/* concurrent recording */
+	apt_histogram_reset(histogram);
+	for(i=0; i<HISTOGRAM_TEST_THREAD_COUNT; i++) {
+		if(apr_thread_create(&threads[i],NULL,histogram_thread_run,histogram,suite->pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Thread");
+			return FALSE;
+		}
+	}
+	for(i=0; i<HISTOGRAM_TEST_THREAD_COUNT; i++) {
+		apr_thread_join(&rv,threads[i]);
+	}
+	if(apt_histogram_count_get(histogram) != HISTOGRAM_TEST_THREAD_COUNT * HISTOGRAM_TEST_VALUE_COUNT ||
+		apt_histogram_min_get(histogram) != 1 || apt_histogram_max_get(histogram) != HISTOGRAM_TEST_VALUE_COUNT) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Lost Concurrent Values [%"APR_SIZE_T_FMT"]",apt_histogram_count_get(histogram));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* histogram_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"histogram",NULL,histogram_test_run);
+	return suite;
+}
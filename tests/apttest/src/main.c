@@ -20,6 +20,17 @@
 apt_test_suite_t* task_test_suite_create(apr_pool_t *pool);
 apt_test_suite_t* consumer_task_test_suite_create(apr_pool_t *pool);
 apt_test_suite_t* multipart_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* spsc_queue_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* mpsc_queue_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* timer_queue_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* task_msg_pool_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* histogram_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* pool_cache_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* handoff_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* pollset_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* task_bench_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* xml_cache_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* nlsml_scan_test_suite_create(apr_pool_t *pool);
 
 int main(int argc, const char * const *argv)
 {
@@ -46,6 +57,39 @@ int main(int argc, const char * const *argv)
 	test_suite = multipart_test_suite_create(pool);
 	apt_test_framework_suite_add(test_framework,test_suite);
 
+	test_suite = spsc_queue_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = mpsc_queue_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = timer_queue_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = task_msg_pool_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = histogram_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = pool_cache_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = handoff_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = pollset_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = task_bench_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = xml_cache_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = nlsml_scan_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
 	/* run tests */
 	apt_test_framework_run(test_framework,argc,argv);
 
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_thread_proc.h>
+#include "apt_test_suite.h"
+#include "apt_mpsc_queue.h"
+#include "apt_log.h"
+
+#define MPSC_TEST_QUEUE_SIZE     64
+#define MPSC_TEST_PRODUCER_COUNT 4
+#define MPSC_TEST_MESSAGE_COUNT  100000
+
+/** Element pushed by producers */
+typedef struct {
+	apr_uint32_t producer;
+	apr_uint32_t number;
+} mpsc_test_elem_t;
+
+/** Producer thread */
+typedef struct {
+	apt_mpsc_queue_t *queue;
+	mpsc_test_elem_t *elems;
+	apr_uint32_t      id;
+} mpsc_test_producer_t;
+
+static void* APR_THREAD_FUNC mpsc_producer_run(apr_thread_t *thread, void *data)
+{
+	mpsc_test_producer_t *producer = data;
+	apr_uint32_t i = 0;
+	while(i < MPSC_TEST_MESSAGE_COUNT) {
+		mpsc_test_elem_t *elem = &producer->elems[i];
+		elem->producer = producer->id;
+		elem->number = i;
+		if(apt_mpsc_queue_push(producer->queue,elem) == FALSE) {
+			/* full, let the consumer catch up */
+			apr_thread_yield();
+			continue;
+		}
+		i++;
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static apt_bool_t mpsc_queue_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_mpsc_queue_t *queue;
+	mpsc_test_producer_t producers[MPSC_TEST_PRODUCER_COUNT];
+	apr_thread_t *threads[MPSC_TEST_PRODUCER_COUNT];
+	apr_uint32_t expected[MPSC_TEST_PRODUCER_COUNT];
+	apr_uint32_t elems[MPSC_TEST_QUEUE_SIZE];
+	mpsc_test_elem_t *elem;
+	apt_bool_t status = TRUE;
+	apr_status_t rv;
+	apr_uint32_t i;
+	apr_uint32_t count;
+
+	queue = apt_mpsc_queue_create(MPSC_TEST_QUEUE_SIZE - 1,suite->pool);
+	if(!queue || apt_mpsc_queue_capacity(queue) != MPSC_TEST_QUEUE_SIZE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create MPSC Queue");
+		return FALSE;
+	}
+
+	/* single thread: fill up and drain, twice to get through the wrap-around */
+	for(count=0; count<2; count++) {
+		for(i=0; i<MPSC_TEST_QUEUE_SIZE; i++) {
+			if(apt_mpsc_queue_push(queue,&elems[i]) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Full Queue [%u]",i);
+				return FALSE;
+			}
+		}
+		if(apt_mpsc_queue_push(queue,&elems[0]) == TRUE || apt_mpsc_queue_size(queue) != MPSC_TEST_QUEUE_SIZE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Full Queue");
+			return FALSE;
+		}
+		for(i=0; i<MPSC_TEST_QUEUE_SIZE; i++) {
+			if(apt_mpsc_queue_pop(queue) != &elems[i]) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Element [%u]",i);
+				return FALSE;
+			}
+		}
+		if(apt_mpsc_queue_pop(queue) != NULL || apt_mpsc_queue_size(queue) != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Empty Queue");
+			return FALSE;
+		}
+	}
+
+	/* multiple threads: nothing lost, the order of each producer preserved */
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run [%d] Producer Threads [%d] elements each",
+		MPSC_TEST_PRODUCER_COUNT,MPSC_TEST_MESSAGE_COUNT);
+	for(i=0; i<MPSC_TEST_PRODUCER_COUNT; i++) {
+		producers[i].queue = queue;
+		producers[i].elems = apr_palloc(suite->pool,sizeof(mpsc_test_elem_t) * MPSC_TEST_MESSAGE_COUNT);
+		producers[i].id = i;
+		expected[i] = 0;
+		if(apr_thread_create(&threads[i],NULL,mpsc_producer_run,&producers[i],suite->pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Producer Thread");
+			return FALSE;
+		}
+	}
+	count = 0;
+	while(count < MPSC_TEST_PRODUCER_COUNT * MPSC_TEST_MESSAGE_COUNT) {
+		elem = apt_mpsc_queue_pop(queue);
+		if(!elem) {
+			apr_thread_yield();
+			continue;
+		}
+		if(elem->producer >= MPSC_TEST_PRODUCER_COUNT || elem->number != expected[elem->producer]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Out of Order Element [%u] expected [%u]",
+				elem->number,expected[elem->producer]);
+			status = FALSE;
+			break;
+		}
+		expected[elem->producer]++;
+		count++;
+	}
+	if(status == FALSE) {
+		/* drain the queue to let producers complete */
+		for(i=0; i<MPSC_TEST_PRODUCER_COUNT * MPSC_TEST_MESSAGE_COUNT - count; ) {
+			if(apt_mpsc_queue_pop(queue)) {
+				i++;
+			}
+			else {
+				apr_thread_yield();
+			}
+		}
+	}
+	for(i=0; i<MPSC_TEST_PRODUCER_COUNT; i++) {
+		apr_thread_join(&rv,threads[i]);
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Consumed [%u] elements",count);
+	return status;
+}
+
+apt_test_suite_t* mpsc_queue_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"mpsc",NULL,mpsc_queue_test_run);
+	return suite;
+}
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <string.h>
 #include "apt_test_suite.h"
 #include "apt_multipart_content.h"
 #include "apt_log.h"
@@ -78,6 +79,48 @@ static apt_bool_t multipart_content_parse(apt_test_suite_t *suite, apt_str_t *bo
 	return TRUE;
 }
 
+/** Parse parts without Content-Length, the bodies of which contain hyphens */
+static apt_bool_t multipart_content_span_parse(apt_test_suite_t *suite)
+{
+	static const char *expected[] = {"first - part", "--second\r\npart-"};
+	apt_multipart_content_t *multipart;
+	apt_content_part_t content_part;
+	apt_bool_t is_final = FALSE;
+	apr_size_t count = 0;
+	apt_str_t boundary;
+	apt_str_t body;
+
+	apt_string_set(&boundary,"break");
+	apt_string_set(&body,
+		"preamble - text\r\n"
+		"--break\r\n"
+		"Content-Type: text/plain\r\n"
+		"\r\n"
+		"first - part\r\n"
+		"--break\r\n"
+		"Content-Type: text/plain\r\n"
+		"\r\n"
+		"--second\r\npart-\r\n"
+		"--break--\r\n");
+	multipart = apt_multipart_content_assign(&body,&boundary,suite->pool);
+	if(!multipart) {
+		return FALSE;
+	}
+	while(apt_multipart_content_get(multipart,&content_part,&is_final) == TRUE && is_final == FALSE) {
+		if(count >= 2 || content_part.body.length != strlen(expected[count]) ||
+			strncmp(content_part.body.buf,expected[count],content_part.body.length) != 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Content Part [%"APR_SIZE_T_FMT"] %.*s",
+				count,content_part.body.length,content_part.body.buf);
+			return FALSE;
+		}
+		count++;
+	}
+	if(count != 2 || is_final == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Number of Content Parts [%"APR_SIZE_T_FMT"]",count);
+		return FALSE;
+	}
+	return TRUE;
+}
 
 static apt_bool_t multipart_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
 {
@@ -86,6 +129,9 @@ static apt_bool_t multipart_test_run(apt_test_suite_t *suite, int argc, const ch
 	if(body) {
 		status = multipart_content_parse(suite,body);
 	}
+	if(status == TRUE) {
+		status = multipart_content_span_parse(suite);
+	}
 	return status;
 }
 
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "apt_test_suite.h"
+#include "apt_nlsml_doc.h"
+#include "apt_log.h"
+
+/** Results under test, each is scanned and parsed */
+static const char *nlsml_scan_test_results[] = {
+	"<?xml version=\"1.0\"?>\n"
+	"<result grammar=\"session:grammar-1\">\n"
+	"  <interpretation grammar=\"session:grammar-1\" confidence=\"0.87\">\n"
+	"    <instance>one &amp; two</instance>\n"
+	"    <input mode=\"speech\" timestamp-start=\"2010-01-01T00:00:00\">one and two</input>\n"
+	"  </interpretation>\n"
+	"  <interpretation confidence=\"45\">\n"
+	"    <instance><![CDATA[a<b]]></instance>\n"
+	"    <input mode=\"dtmf\">1 2</input>\n"
+	"  </interpretation>\n"
+	"</result>\n",
+
+	"<result xmlns=\"http://www.ietf.org/xml/ns/mrcpv2\">"
+	"<!-- comment -->"
+	"<interpretation><instance><SWI_literal>john smith</SWI_literal><SWI_meaning>{JS}</SWI_meaning></instance>"
+	"<input/></interpretation>"
+	"</result>"
+};
+
+/** Malformed results, which both the scanner and the parser reject */
+static const char *nlsml_scan_test_malformed[] = {
+	"<result><interpretation><instance>x</interpretation></result>",
+	"<result><interpretation confidence=0.5/></result>",
+	"<grammar/>"
+};
+
+static apt_bool_t nlsml_scan_string_compare(const char *s1, const char *s2)
+{
+	if(!s1 || !s2) {
+		return (s1 == s2) ? TRUE : FALSE;
+	}
+	return strcmp(s1,s2) == 0 ? TRUE : FALSE;
+}
+
+static apt_bool_t nlsml_scan_result_compare(const nlsml_result_t *parsed, const nlsml_result_t *scanned, apr_pool_t *pool)
+{
+	nlsml_interpretation_t *i1 = nlsml_first_interpretation_get(parsed);
+	nlsml_interpretation_t *i2 = nlsml_first_interpretation_get(scanned);
+	if(nlsml_scan_string_compare(nlsml_result_grammar_get(parsed),nlsml_result_grammar_get(scanned)) == FALSE) {
+		return FALSE;
+	}
+	for(; i1 && i2; i1 = nlsml_next_interpretation_get(parsed,i1), i2 = nlsml_next_interpretation_get(scanned,i2)) {
+		nlsml_instance_t *n1 = nlsml_interpretation_first_instance_get(i1);
+		nlsml_instance_t *n2 = nlsml_interpretation_first_instance_get(i2);
+		nlsml_input_t *in1 = nlsml_interpretation_input_get(i1);
+		nlsml_input_t *in2 = nlsml_interpretation_input_get(i2);
+		if(nlsml_interpretation_confidence_get(i1) != nlsml_interpretation_confidence_get(i2) ||
+			nlsml_scan_string_compare(nlsml_interpretation_grammar_get(i1),nlsml_interpretation_grammar_get(i2)) == FALSE) {
+			return FALSE;
+		}
+		for(; n1 && n2; n1 = nlsml_interpretation_next_instance_get(i1,n1), n2 = nlsml_interpretation_next_instance_get(i2,n2)) {
+			const char *c1;
+			const char *c2;
+			nlsml_instance_swi_suppress(n1);
+			nlsml_instance_swi_suppress(n2);
+			c1 = nlsml_instance_content_generate(n1,pool);
+			c2 = nlsml_instance_content_generate(n2,pool);
+			if(nlsml_scan_string_compare(c1,c2) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Instance Mismatch [%s] [%s]",c1,c2);
+				return FALSE;
+			}
+		}
+		if(n1 || n2 || (!in1 != !in2)) {
+			return FALSE;
+		}
+		if(in1 && (nlsml_scan_string_compare(nlsml_input_mode_get(in1),nlsml_input_mode_get(in2)) == FALSE ||
+			nlsml_input_confidence_get(in1) != nlsml_input_confidence_get(in2) ||
+			nlsml_scan_string_compare(nlsml_input_timestamp_start_get(in1),nlsml_input_timestamp_start_get(in2)) == FALSE ||
+			nlsml_scan_string_compare(nlsml_input_content_generate(in1,pool),nlsml_input_content_generate(in2,pool)) == FALSE)) {
+			return FALSE;
+		}
+	}
+	return (!i1 && !i2) ? TRUE : FALSE;
+}
+
+static apt_bool_t nlsml_scan_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_size_t i;
+	for(i=0; i<sizeof(nlsml_scan_test_results)/sizeof(nlsml_scan_test_results[0]); i++) {
+		const char *data = nlsml_scan_test_results[i];
+		nlsml_result_t *parsed = nlsml_result_parse(data,strlen(data),suite->pool);
+		nlsml_result_t *scanned = nlsml_result_scan(data,strlen(data),suite->pool);
+		if(!parsed || !scanned || nlsml_scan_result_compare(parsed,scanned,suite->pool) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Scanned Result Mismatch [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+	}
+	for(i=0; i<sizeof(nlsml_scan_test_malformed)/sizeof(nlsml_scan_test_malformed[0]); i++) {
+		const char *data = nlsml_scan_test_malformed[i];
+		if(nlsml_result_scan(data,strlen(data),suite->pool)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Malformed Result Scanned [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* nlsml_scan_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"nlsml-scan",NULL,nlsml_scan_test_run);
+	return suite;
+}
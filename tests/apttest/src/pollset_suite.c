@@ -0,0 +1,170 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_file_io.h>
+#include <apr_thread_proc.h>
+#include <apr_atomic.h>
+#include "apt_test_suite.h"
+#include "apt_pollset.h"
+#include "apt_log.h"
+
+/** Number of wakeups to signal from the other thread */
+#define POLLSET_TEST_WAKEUP_COUNT  10000
+/** Timeout to poll for in usec */
+#define POLLSET_TEST_TIMEOUT       10000
+
+typedef struct {
+	apt_pollset_t         *pollset;
+	volatile apr_uint32_t  signalled;
+} pollset_test_t;
+
+static void* APR_THREAD_FUNC pollset_wakeup_thread_run(apr_thread_t *thread, void *data)
+{
+	pollset_test_t *test = data;
+	apr_uint32_t i;
+	for(i=0; i<POLLSET_TEST_WAKEUP_COUNT; i++) {
+		/* publish the "message" first, then wake the poller up */
+		apr_atomic_inc32(&test->signalled);
+		if(apt_pollset_wakeup(test->pollset) == FALSE) {
+			apr_thread_exit(thread,APR_EGENERAL);
+			return NULL;
+		}
+		if(i % 100 == 0) {
+			apr_thread_yield();
+		}
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static apr_status_t pollset_test_poll(apt_pollset_t *pollset, apr_interval_time_t timeout, const apr_pollfd_t **descriptor)
+{
+	apr_int32_t num = 0;
+	apr_status_t status = apt_pollset_poll(pollset,timeout,&num,descriptor);
+	if(status == APR_SUCCESS && num != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Number of Descriptors [%d]",num);
+		return APR_EGENERAL;
+	}
+	return status;
+}
+
+static apt_bool_t pollset_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	pollset_test_t test;
+	apr_file_t *pipe_in;
+	apr_file_t *pipe_out;
+	apr_pollfd_t pfd;
+	const apr_pollfd_t *descriptor;
+	apr_thread_t *thread;
+	apr_status_t rv;
+	apr_uint32_t consumed = 0;
+	apr_size_t wakeups = 0;
+	apr_size_t len;
+	char c;
+	int i;
+
+	test.signalled = 0;
+	test.pollset = apt_pollset_create(4,suite->pool);
+	if(!test.pollset) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pollset");
+		return FALSE;
+	}
+	if(apr_file_pipe_create(&pipe_in,&pipe_out,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pipe");
+		apt_pollset_destroy(test.pollset);
+		return FALSE;
+	}
+	memset(&pfd,0,sizeof(pfd));
+	pfd.desc_type = APR_POLL_FILE;
+	pfd.reqevents = APR_POLLIN;
+	pfd.desc.f = pipe_in;
+	pfd.client_data = &test;
+	if(apt_pollset_add(test.pollset,&pfd) == FALSE ||
+		pollset_test_poll(test.pollset,POLLSET_TEST_TIMEOUT,&descriptor) != APR_TIMEUP) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Poll Timeout");
+		apt_pollset_destroy(test.pollset);
+		return FALSE;
+	}
+
+	/* multiple wakeups are coalesced into a single signal */
+	for(i=0; i<100; i++) {
+		apt_pollset_wakeup(test.pollset);
+	}
+	if(pollset_test_poll(test.pollset,-1,&descriptor) != APR_SUCCESS ||
+		apt_pollset_is_wakeup(test.pollset,descriptor) == FALSE ||
+		pollset_test_poll(test.pollset,POLLSET_TEST_TIMEOUT,&descriptor) != APR_TIMEUP) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Single Wakeup");
+		apt_pollset_destroy(test.pollset);
+		return FALSE;
+	}
+
+	/* descriptors are level-triggered, unread data is signalled again */
+	apr_file_putc('x',pipe_out);
+	for(i=0; i<2; i++) {
+		if(pollset_test_poll(test.pollset,-1,&descriptor) != APR_SUCCESS ||
+			apt_pollset_is_wakeup(test.pollset,descriptor) == TRUE ||
+			descriptor->client_data != &test || (descriptor->rtnevents & APR_POLLIN) == 0) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Signalled Descriptor");
+			apt_pollset_destroy(test.pollset);
+			return FALSE;
+		}
+	}
+	len = sizeof(c);
+	apr_file_read(pipe_in,&c,&len);
+
+	/* no wakeup gets lost while signalled concurrently */
+	if(apr_thread_create(&thread,NULL,pollset_wakeup_thread_run,&test,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Thread");
+		apt_pollset_destroy(test.pollset);
+		return FALSE;
+	}
+	while(consumed < POLLSET_TEST_WAKEUP_COUNT) {
+		if(pollset_test_poll(test.pollset,1000 * POLLSET_TEST_TIMEOUT,&descriptor) != APR_SUCCESS ||
+			apt_pollset_is_wakeup(test.pollset,descriptor) == FALSE) {
+			break;
+		}
+		consumed = apr_atomic_read32(&test.signalled);
+		wakeups++;
+	}
+	apr_thread_join(&rv,thread);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Signalled [%d] wakeups, polled [%"APR_SIZE_T_FMT"]",
+		POLLSET_TEST_WAKEUP_COUNT,wakeups);
+	if(rv != APR_SUCCESS || consumed != POLLSET_TEST_WAKEUP_COUNT) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Lost Wakeup [%u]",consumed);
+		apt_pollset_destroy(test.pollset);
+		return FALSE;
+	}
+
+	/* removed descriptor is no longer signalled */
+	apt_pollset_remove(test.pollset,&pfd);
+	apr_file_putc('x',pipe_out);
+	if(pollset_test_poll(test.pollset,POLLSET_TEST_TIMEOUT,&descriptor) != APR_TIMEUP) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Removed Descriptor Signalled");
+		apt_pollset_destroy(test.pollset);
+		return FALSE;
+	}
+
+	apt_pollset_destroy(test.pollset);
+	apr_file_close(pipe_in);
+	apr_file_close(pipe_out);
+	return TRUE;
+}
+
+apt_test_suite_t* pollset_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"pollset",NULL,pollset_test_run);
+	return suite;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "apt_test_suite.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+
+/** Max number of idle pools to keep */
+#define POOL_CACHE_TEST_MAX_COUNT     2
+/** Max size of free memory a cleared pool retains */
+#define POOL_CACHE_TEST_RETAINED_SIZE 8192
+/** Size of memory to allocate from each pool */
+#define POOL_CACHE_TEST_ALLOC_SIZE    65536
+
+static apt_bool_t pool_cache_stats_check(apt_pool_cache_t *cache, apr_size_t acquired, apr_size_t reused, apr_size_t released, apr_size_t discarded, apr_size_t cached)
+{
+	apt_pool_cache_stats_t stats;
+	apt_pool_cache_stats_get(cache,&stats);
+	if(stats.acquired != acquired || stats.reused != reused || stats.released != released ||
+		stats.discarded != discarded || stats.cached != cached) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Stats acquired [%"APR_SIZE_T_FMT"] reused [%"APR_SIZE_T_FMT"] "
+			"released [%"APR_SIZE_T_FMT"] discarded [%"APR_SIZE_T_FMT"] cached [%"APR_SIZE_T_FMT"]",
+			stats.acquired,stats.reused,stats.released,stats.discarded,stats.cached);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t pool_cache_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_pool_cache_t *cache;
+	apr_pool_t *pools[POOL_CACHE_TEST_MAX_COUNT + 1];
+	apr_pool_t *pool;
+	apt_bool_t status = TRUE;
+	int i;
+
+	cache = apt_pool_cache_create(POOL_CACHE_TEST_MAX_COUNT,POOL_CACHE_TEST_RETAINED_SIZE,suite->pool);
+	if(!cache) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pool Cache");
+		return FALSE;
+	}
+
+	for(i=0; i<POOL_CACHE_TEST_MAX_COUNT + 1; i++) {
+		char *buf;
+		pools[i] = apt_pool_cache_acquire(cache);
+		if(!pools[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Acquire Pool");
+			return FALSE;
+		}
+		buf = apr_palloc(pools[i],POOL_CACHE_TEST_ALLOC_SIZE);
+		memset(buf,0,POOL_CACHE_TEST_ALLOC_SIZE);
+	}
+
+	/* the pool released beyond the max count is destroyed */
+	for(i=0; i<POOL_CACHE_TEST_MAX_COUNT + 1; i++) {
+		apt_pool_cache_release(cache,pools[i]);
+	}
+	if(pool_cache_stats_check(cache,3,0,3,1,2) == FALSE) {
+		status = FALSE;
+	}
+
+	/* cleared pools are reused, most recently released first */
+	pool = apt_pool_cache_acquire(cache);
+	if(pool != pools[POOL_CACHE_TEST_MAX_COUNT - 1]) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Most Recently Released Pool");
+		status = FALSE;
+	}
+	if(pool_cache_stats_check(cache,4,1,3,1,1) == FALSE) {
+		status = FALSE;
+	}
+	if(pool) {
+		apr_palloc(pool,POOL_CACHE_TEST_ALLOC_SIZE);
+		apt_pool_cache_release(cache,pool);
+	}
+
+	apt_pool_cache_destroy(cache);
+	return status;
+}
+
+apt_test_suite_t* pool_cache_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"poolcache",NULL,pool_cache_test_run);
+	return suite;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_thread_proc.h>
+#include "apt_test_suite.h"
+#include "apt_spsc_queue.h"
+#include "apt_log.h"
+
+#define SPSC_TEST_QUEUE_SIZE    64
+#define SPSC_TEST_MESSAGE_COUNT 100000
+
+typedef struct {
+	apr_uint32_t number;
+	char         payload[20];
+} spsc_test_elem_t;
+
+static void* APR_THREAD_FUNC spsc_producer_run(apr_thread_t *thread, void *data)
+{
+	apt_spsc_queue_t *queue = data;
+	spsc_test_elem_t *elem;
+	apr_uint32_t i = 0;
+	while(i < SPSC_TEST_MESSAGE_COUNT) {
+		elem = apt_spsc_queue_write_begin(queue);
+		if(!elem) {
+			/* full, let the consumer catch up */
+			continue;
+		}
+		elem->number = i++;
+		apt_spsc_queue_write_commit(queue);
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static apt_bool_t spsc_queue_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_spsc_queue_t *queue;
+	spsc_test_elem_t *elem;
+	apr_thread_t *thread;
+	apr_status_t rv;
+	apr_uint32_t i;
+
+	queue = apt_spsc_queue_create(SPSC_TEST_QUEUE_SIZE - 1,sizeof(spsc_test_elem_t),suite->pool);
+	if(!queue || apt_spsc_queue_capacity(queue) != SPSC_TEST_QUEUE_SIZE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create SPSC Queue");
+		return FALSE;
+	}
+
+	/* single thread: fill up and drain */
+	for(i=0; i<SPSC_TEST_QUEUE_SIZE; i++) {
+		elem = apt_spsc_queue_write_begin(queue);
+		if(!elem) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Full Queue [%u]",i);
+			return FALSE;
+		}
+		elem->number = i;
+		apt_spsc_queue_write_commit(queue);
+	}
+	if(apt_spsc_queue_write_begin(queue) != NULL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Full Queue");
+		return FALSE;
+	}
+	for(i=0; i<SPSC_TEST_QUEUE_SIZE; i++) {
+		elem = apt_spsc_queue_read_begin(queue);
+		if(!elem || elem->number != i) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Element [%u]",i);
+			return FALSE;
+		}
+		apt_spsc_queue_read_commit(queue);
+	}
+	if(apt_spsc_queue_size(queue) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Empty Queue");
+		return FALSE;
+	}
+
+	/* two threads: the order must be preserved */
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run Producer Thread [%d] elements",SPSC_TEST_MESSAGE_COUNT);
+	if(apr_thread_create(&thread,NULL,spsc_producer_run,queue,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Producer Thread");
+		return FALSE;
+	}
+	i = 0;
+	while(i < SPSC_TEST_MESSAGE_COUNT) {
+		elem = apt_spsc_queue_read_begin(queue);
+		if(!elem) {
+			continue;
+		}
+		if(elem->number != i) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Out of Order Element [%u] expected [%u]",elem->number,i);
+			apr_thread_join(&rv,thread);
+			return FALSE;
+		}
+		apt_spsc_queue_read_commit(queue);
+		i++;
+	}
+	apr_thread_join(&rv,thread);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Consumed [%u] elements",i);
+	return TRUE;
+}
+
+apt_test_suite_t* spsc_queue_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"spsc",NULL,spsc_queue_test_run);
+	return suite;
+}
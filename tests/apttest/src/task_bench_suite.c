@@ -0,0 +1,339 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmarks of task messaging and pollset wakeups.
+ *
+ * apttest task-bench [messages=N] [producers=N]
+ */
+
+#include <stdlib.h>
+#include <apr_time.h>
+#include <apr_strings.h>
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include "apt_test_suite.h"
+#include "apt_consumer_task.h"
+#include "apt_pollset.h"
+#include "apt_histogram.h"
+#include "apt_log.h"
+
+/** Number of round trips to measure */
+#define TASK_BENCH_ROUND_TRIPS     10000
+/** Default number of messages to signal in the throughput runs */
+#define TASK_BENCH_MESSAGE_COUNT   1000000
+/** Default number of producers of the multi-producer run */
+#define TASK_BENCH_PRODUCER_COUNT  4
+/** Number of pollset wakeups to measure */
+#define TASK_BENCH_WAKEUP_COUNT    2000
+/** Pause (usec) before a wakeup, so that the poller is blocked by then */
+#define TASK_BENCH_WAKEUP_PAUSE    100
+
+typedef struct task_bench_t task_bench_t;
+
+/** Task benchmark */
+struct task_bench_t {
+	apt_task_t           *task;
+	apt_task_msg_pool_t  *msg_pool;
+	apr_thread_mutex_t   *mutex;
+	apr_thread_cond_t    *cond;
+	/** Whether the message is to be answered to the signaller */
+	apt_bool_t            round_trip;
+	volatile apt_bool_t   answered;
+	volatile apr_size_t   processed;
+	apr_size_t            message_count;
+	apr_size_t            producer_count;
+	/** Number of messages each producer signals */
+	apr_size_t            producer_message_count;
+	volatile apr_uint32_t retries;
+
+	apt_pollset_t        *pollset;
+	volatile apr_time_t   wakeup_time;
+	volatile apr_uint32_t wakeups;
+};
+
+static apt_bool_t task_bench_msg_process(apt_task_t *task, apt_task_msg_t *msg)
+{
+	apt_consumer_task_t *consumer_task = apt_task_object_get(task);
+	task_bench_t *bench = apt_consumer_task_object_get(consumer_task);
+	if(bench->round_trip == TRUE) {
+		apr_thread_mutex_lock(bench->mutex);
+		bench->answered = TRUE;
+		apr_thread_cond_signal(bench->cond);
+		apr_thread_mutex_unlock(bench->mutex);
+	}
+	bench->processed++;
+	return TRUE;
+}
+
+static apt_bool_t task_bench_msg_signal(task_bench_t *bench)
+{
+	apt_task_msg_t *msg = apt_task_msg_acquire(bench->msg_pool);
+	msg->type = TASK_MSG_USER;
+	return apt_task_msg_signal(bench->task,msg);
+}
+
+static void task_bench_histogram_log(const char *name, const apt_histogram_t *histogram)
+{
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"%s [usec] count [%"APR_SIZE_T_FMT"] min [%u] p50 [%u] p99 [%u] p99.9 [%u] max [%u] mean [%.1f]",
+		name,
+		apt_histogram_count_get(histogram),
+		apt_histogram_min_get(histogram),
+		apt_histogram_percentile_get(histogram,50),
+		apt_histogram_percentile_get(histogram,99),
+		apt_histogram_percentile_get(histogram,99.9),
+		apt_histogram_max_get(histogram),
+		apt_histogram_mean_get(histogram));
+}
+
+/** Signal a message and wait for the task to answer it, one at a time */
+static apt_bool_t task_bench_round_trip_run(task_bench_t *bench, apr_pool_t *pool)
+{
+	apt_histogram_t *histogram = apt_histogram_create(pool);
+	apr_time_t start;
+	apr_size_t i;
+
+	bench->round_trip = TRUE;
+	for(i=0; i<TASK_BENCH_ROUND_TRIPS; i++) {
+		bench->answered = FALSE;
+		start = apr_time_now();
+		if(task_bench_msg_signal(bench) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Signal Message [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		apr_thread_mutex_lock(bench->mutex);
+		while(bench->answered == FALSE) {
+			apr_thread_cond_wait(bench->cond,bench->mutex);
+		}
+		apr_thread_mutex_unlock(bench->mutex);
+		apt_histogram_record(histogram,(apr_uint32_t)(apr_time_now() - start));
+	}
+	bench->round_trip = FALSE;
+
+	task_bench_histogram_log("Message Round Trip",histogram);
+	return TRUE;
+}
+
+static void* APR_THREAD_FUNC task_bench_producer_run(apr_thread_t *thread, void *data)
+{
+	task_bench_t *bench = data;
+	apr_size_t i;
+	for(i=0; i<bench->producer_message_count; ) {
+		if(task_bench_msg_signal(bench) == TRUE) {
+			i++;
+		}
+		else {
+			/* back-pressure, let the consumer catch up */
+			apr_atomic_inc32(&bench->retries);
+			apr_thread_yield();
+		}
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+/** Flood the task with messages signalled by the given number of producer threads */
+static apt_bool_t task_bench_throughput_run(task_bench_t *bench, apr_size_t producer_count, apr_pool_t *pool)
+{
+	apr_thread_t **threads;
+	apr_status_t rv;
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_size_t total;
+	apr_size_t i;
+
+	bench->producer_message_count = bench->message_count / producer_count;
+	total = bench->producer_message_count * producer_count;
+	bench->processed = 0;
+	bench->retries = 0;
+	apt_task_stats_reset(bench->task);
+
+	threads = apr_palloc(pool,sizeof(apr_thread_t*) * producer_count);
+	start = apr_time_now();
+	for(i=0; i<producer_count; i++) {
+		if(apr_thread_create(&threads[i],NULL,task_bench_producer_run,bench,pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Producer Thread");
+			total = bench->producer_message_count * i;
+			producer_count = i;
+			break;
+		}
+	}
+	for(i=0; i<producer_count; i++) {
+		apr_thread_join(&rv,threads[i]);
+	}
+	while(bench->processed < total) {
+		apr_thread_yield();
+	}
+	elapsed = apr_time_now() - start;
+	if(!elapsed) {
+		elapsed = 1;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Message Throughput producers [%"APR_SIZE_T_FMT"] messages [%"APR_SIZE_T_FMT"] in [%"APR_TIME_T_FMT" usec] [%.0f msg/sec] retries [%u]",
+		producer_count,
+		total,
+		elapsed,
+		total * 1000000.0 / elapsed,
+		apr_atomic_read32(&bench->retries));
+	task_bench_histogram_log("Message Dwell Time",apt_task_histogram_get(bench->task,TASK_HISTOGRAM_DWELL_TIME));
+	return producer_count ? TRUE : FALSE;
+}
+
+static void* APR_THREAD_FUNC task_bench_waker_run(apr_thread_t *thread, void *data)
+{
+	task_bench_t *bench = data;
+	apr_uint32_t i;
+	for(i=0; i<TASK_BENCH_WAKEUP_COUNT; i++) {
+		/* wait for the previous wakeup to be consumed, then for the poller to block again */
+		while(apr_atomic_read32(&bench->wakeups) != i) {
+			apr_thread_yield();
+		}
+		apr_sleep(TASK_BENCH_WAKEUP_PAUSE);
+		bench->wakeup_time = apr_time_now();
+		apt_pollset_wakeup(bench->pollset);
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+/** Measure the time from a wakeup signalled by the other thread till the poll returns */
+static apt_bool_t task_bench_wakeup_run(task_bench_t *bench, apr_pool_t *pool)
+{
+	apt_histogram_t *histogram = apt_histogram_create(pool);
+	const apr_pollfd_t *descriptor;
+	apr_thread_t *thread;
+	apr_status_t rv;
+	apr_int32_t num;
+	apt_bool_t status = TRUE;
+
+	bench->pollset = apt_pollset_create(1,pool);
+	if(!bench->pollset) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Pollset");
+		return FALSE;
+	}
+	bench->wakeups = 0;
+	if(apr_thread_create(&thread,NULL,task_bench_waker_run,bench,pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Thread");
+		apt_pollset_destroy(bench->pollset);
+		return FALSE;
+	}
+	while(apr_atomic_read32(&bench->wakeups) < TASK_BENCH_WAKEUP_COUNT) {
+		num = 0;
+		if(apt_pollset_poll(bench->pollset,APR_USEC_PER_SEC,&num,&descriptor) != APR_SUCCESS ||
+			num != 1 || apt_pollset_is_wakeup(bench->pollset,descriptor) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Wakeup [%u]",apr_atomic_read32(&bench->wakeups));
+			status = FALSE;
+			break;
+		}
+		apt_histogram_record(histogram,(apr_uint32_t)(apr_time_now() - bench->wakeup_time));
+		apr_atomic_inc32(&bench->wakeups);
+	}
+	if(status == FALSE) {
+		/* let the waker run out */
+		apr_atomic_set32(&bench->wakeups,TASK_BENCH_WAKEUP_COUNT);
+	}
+	apr_thread_join(&rv,thread);
+	apt_pollset_destroy(bench->pollset);
+	bench->pollset = NULL;
+
+	task_bench_histogram_log("Pollset Wakeup",histogram);
+	return status;
+}
+
+static void task_bench_args_parse(task_bench_t *bench, int argc, const char * const *argv, apr_pool_t *pool)
+{
+	int i;
+	for(i=0; i<argc; i++) {
+		char *name = apr_pstrdup(pool,argv[i]);
+		char *value = strchr(name,'=');
+		if(!value) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Ignore Argument [%s]",name);
+			continue;
+		}
+		*value++ = '\0';
+		if(strcasecmp(name,"messages") == 0)
+			bench->message_count = atol(value);
+		else if(strcasecmp(name,"producers") == 0)
+			bench->producer_count = atol(value);
+		else
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Ignore Argument [%s]",name);
+	}
+	if(!bench->producer_count) {
+		bench->producer_count = 1;
+	}
+	if(bench->message_count < bench->producer_count) {
+		bench->message_count = bench->producer_count;
+	}
+}
+
+static apt_bool_t task_bench_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_consumer_task_t *consumer_task;
+	apt_task_vtable_t *vtable;
+	task_bench_t bench;
+	apt_bool_t status;
+
+	memset(&bench,0,sizeof(bench));
+	bench.message_count = TASK_BENCH_MESSAGE_COUNT;
+	bench.producer_count = TASK_BENCH_PRODUCER_COUNT;
+	task_bench_args_parse(&bench,argc,argv,suite->pool);
+
+	apr_thread_mutex_create(&bench.mutex,APR_THREAD_MUTEX_DEFAULT,suite->pool);
+	apr_thread_cond_create(&bench.cond,suite->pool);
+	bench.msg_pool = apt_task_msg_pool_create_dynamic(0,suite->pool);
+	consumer_task = apt_consumer_task_create(&bench,bench.msg_pool,suite->pool);
+	if(!consumer_task) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Consumer Task");
+		return FALSE;
+	}
+	bench.task = apt_consumer_task_base_get(consumer_task);
+	apt_task_stats_enable(bench.task,0);
+	vtable = apt_task_vtable_get(bench.task);
+	if(vtable) {
+		vtable->process_msg = task_bench_msg_process;
+	}
+	if(apt_task_start(bench.task) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Task");
+		apt_task_destroy(bench.task);
+		return FALSE;
+	}
+
+	status = task_bench_round_trip_run(&bench,suite->pool);
+	if(status == TRUE) {
+		status = task_bench_throughput_run(&bench,1,suite->pool);
+	}
+	if(status == TRUE && bench.producer_count > 1) {
+		status = task_bench_throughput_run(&bench,bench.producer_count,suite->pool);
+	}
+
+	apt_task_terminate(bench.task,TRUE);
+	apt_task_destroy(bench.task);
+
+	if(status == TRUE) {
+		status = task_bench_wakeup_run(&bench,suite->pool);
+	}
+	apr_thread_cond_destroy(bench.cond);
+	apr_thread_mutex_destroy(bench.mutex);
+	return status;
+}
+
+apt_test_suite_t* task_bench_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"task-bench",NULL,task_bench_run);
+	return suite;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_time.h>
+#include <apr_thread_proc.h>
+#include "apt_test_suite.h"
+#include "apt_task_msg.h"
+#include "apt_log.h"
+
+#define MSG_POOL_TEST_STATIC_SIZE   8
+#define MSG_POOL_TEST_BURST_SIZE    100
+#define MSG_POOL_TEST_MAX_FREE      16
+#define MSG_POOL_TEST_SMALL_FREE    2
+#define MSG_POOL_TEST_THREAD_COUNT  4
+#define MSG_POOL_TEST_CYCLE_COUNT   100000
+
+typedef struct {
+	apr_uint32_t owner;
+	apr_uint32_t number;
+} msg_pool_test_data_t;
+
+static apt_bool_t msg_pool_stats_check(apt_task_msg_pool_t *msg_pool, apr_size_t acquired, apr_size_t allocated, apr_size_t freed, apr_size_t max_used)
+{
+	apt_task_msg_pool_stats_t stats;
+	apt_task_msg_pool_stats_get(msg_pool,&stats);
+	if(stats.acquired != acquired || stats.released != acquired ||
+		stats.allocated != allocated || stats.freed != freed || stats.max_used != max_used) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Stats acquired [%"APR_SIZE_T_FMT"] released [%"APR_SIZE_T_FMT"] "
+			"allocated [%"APR_SIZE_T_FMT"] freed [%"APR_SIZE_T_FMT"] max used [%"APR_SIZE_T_FMT"]",
+			stats.acquired,stats.released,stats.allocated,stats.freed,stats.max_used);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t msg_pool_burst_run(apt_task_msg_pool_t *msg_pool, apr_size_t count)
+{
+	apt_task_msg_t *msgs[MSG_POOL_TEST_BURST_SIZE];
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		msgs[i] = apt_task_msg_acquire(msg_pool);
+		if(!msgs[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Acquire Message [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		((msg_pool_test_data_t*)msgs[i]->data)->number = (apr_uint32_t)i;
+	}
+	for(i=0; i<count; i++) {
+		if(((msg_pool_test_data_t*)msgs[i]->data)->number != i) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Corrupted Message [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		apt_task_msg_release(msgs[i]);
+	}
+	return TRUE;
+}
+
+static void* APR_THREAD_FUNC msg_pool_thread_run(apr_thread_t *thread, void *data)
+{
+	apt_task_msg_pool_t *msg_pool = data;
+	apr_uint32_t owner = (apr_uint32_t)(apr_uintptr_t)thread;
+	apt_task_msg_t *msgs[2];
+	msg_pool_test_data_t *msg_data;
+	apr_uint32_t i;
+	apr_uint32_t j;
+	for(i=0; i<MSG_POOL_TEST_CYCLE_COUNT; i++) {
+		for(j=0; j<2; j++) {
+			msgs[j] = apt_task_msg_acquire(msg_pool);
+			msg_data = (msg_pool_test_data_t*)msgs[j]->data;
+			msg_data->owner = owner;
+			msg_data->number = i;
+		}
+		if(i % 64 == 0) {
+			/* let the other threads interleave */
+			apr_thread_yield();
+		}
+		for(j=0; j<2; j++) {
+			msg_data = (msg_pool_test_data_t*)msgs[j]->data;
+			if(msg_data->owner != owner || msg_data->number != i) {
+				/* the message has been handed out twice */
+				apr_thread_exit(thread,APR_EGENERAL);
+				return NULL;
+			}
+			apt_task_msg_release(msgs[j]);
+		}
+	}
+	apr_thread_exit(thread,APR_SUCCESS);
+	return NULL;
+}
+
+static apt_bool_t msg_pool_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apt_task_msg_pool_t *msg_pool;
+	apt_task_msg_pool_stats_t stats;
+	apr_thread_t *threads[MSG_POOL_TEST_THREAD_COUNT];
+	apr_status_t rv;
+	apr_time_t start;
+	apr_size_t i;
+	apt_bool_t status = TRUE;
+
+	/* static pool: preallocated messages first, then extension from the heap */
+	msg_pool = apt_task_msg_pool_create_static(sizeof(msg_pool_test_data_t),MSG_POOL_TEST_STATIC_SIZE,suite->pool);
+	if(!msg_pool) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Static Pool");
+		return FALSE;
+	}
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_STATIC_SIZE) == FALSE ||
+		msg_pool_stats_check(msg_pool,MSG_POOL_TEST_STATIC_SIZE,0,0,MSG_POOL_TEST_STATIC_SIZE) == FALSE) {
+		return FALSE;
+	}
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE ||
+		msg_pool_stats_check(msg_pool,2 * MSG_POOL_TEST_STATIC_SIZE + 1,1,0,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE) {
+		return FALSE;
+	}
+	/* the extension is kept for reuse */
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE ||
+		msg_pool_stats_check(msg_pool,3 * MSG_POOL_TEST_STATIC_SIZE + 2,1,0,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE) {
+		return FALSE;
+	}
+
+	/* preallocated messages never acquired are not freed on destroy */
+	msg_pool = apt_task_msg_pool_create_static(sizeof(msg_pool_test_data_t),MSG_POOL_TEST_STATIC_SIZE,suite->pool);
+	apt_task_msg_pool_destroy(msg_pool);
+	if(msg_pool_stats_check(msg_pool,0,0,0,0) == FALSE) {
+		return FALSE;
+	}
+
+	/* preallocated messages are all kept, even if more than the free messages allowed */
+	msg_pool = apt_task_msg_pool_create_ex(sizeof(msg_pool_test_data_t),MSG_POOL_TEST_STATIC_SIZE,MSG_POOL_TEST_SMALL_FREE,suite->pool);
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_STATIC_SIZE) == FALSE ||
+		msg_pool_stats_check(msg_pool,MSG_POOL_TEST_STATIC_SIZE,0,0,MSG_POOL_TEST_STATIC_SIZE) == FALSE) {
+		return FALSE;
+	}
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE ||
+		msg_pool_stats_check(msg_pool,2 * MSG_POOL_TEST_STATIC_SIZE + 1,1,0,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE) {
+		return FALSE;
+	}
+	apt_task_msg_pool_destroy(msg_pool);
+	if(msg_pool_stats_check(msg_pool,2 * MSG_POOL_TEST_STATIC_SIZE + 1,1,1,MSG_POOL_TEST_STATIC_SIZE + 1) == FALSE) {
+		return FALSE;
+	}
+
+	/* free messages above the high-water mark go back to the heap */
+	msg_pool = apt_task_msg_pool_create_ex(sizeof(msg_pool_test_data_t),0,MSG_POOL_TEST_MAX_FREE,suite->pool);
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_BURST_SIZE) == FALSE ||
+		msg_pool_stats_check(msg_pool,MSG_POOL_TEST_BURST_SIZE,MSG_POOL_TEST_BURST_SIZE,
+			MSG_POOL_TEST_BURST_SIZE - MSG_POOL_TEST_MAX_FREE,MSG_POOL_TEST_BURST_SIZE) == FALSE) {
+		return FALSE;
+	}
+	if(msg_pool_burst_run(msg_pool,MSG_POOL_TEST_BURST_SIZE) == FALSE ||
+		msg_pool_stats_check(msg_pool,2 * MSG_POOL_TEST_BURST_SIZE,2 * MSG_POOL_TEST_BURST_SIZE - MSG_POOL_TEST_MAX_FREE,
+			2 * (MSG_POOL_TEST_BURST_SIZE - MSG_POOL_TEST_MAX_FREE),MSG_POOL_TEST_BURST_SIZE) == FALSE) {
+		return FALSE;
+	}
+	apt_task_msg_pool_destroy(msg_pool);
+	apt_task_msg_pool_stats_get(msg_pool,&stats);
+	if(stats.allocated != stats.freed) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Leaked [%"APR_SIZE_T_FMT"] Messages",stats.allocated - stats.freed);
+		return FALSE;
+	}
+
+	/* concurrent acquire and release */
+	msg_pool = apt_task_msg_pool_create_dynamic(sizeof(msg_pool_test_data_t),suite->pool);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run [%d] Threads [%d] cycles",MSG_POOL_TEST_THREAD_COUNT,MSG_POOL_TEST_CYCLE_COUNT);
+	start = apr_time_now();
+	for(i=0; i<MSG_POOL_TEST_THREAD_COUNT; i++) {
+		if(apr_thread_create(&threads[i],NULL,msg_pool_thread_run,msg_pool,suite->pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Thread");
+			return FALSE;
+		}
+	}
+	for(i=0; i<MSG_POOL_TEST_THREAD_COUNT; i++) {
+		apr_thread_join(&rv,threads[i]);
+		if(rv != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Message Handed out Twice");
+			status = FALSE;
+		}
+	}
+	apt_task_msg_pool_stats_get(msg_pool,&stats);
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Acquired [%"APR_SIZE_T_FMT"] allocated [%"APR_SIZE_T_FMT"] max used [%"APR_SIZE_T_FMT"] [%.1f ns/msg]",
+		stats.acquired,stats.allocated,stats.max_used,
+		(apr_time_now() - start) * 1000.0 / stats.acquired);
+	if(stats.acquired != 2 * MSG_POOL_TEST_THREAD_COUNT * MSG_POOL_TEST_CYCLE_COUNT || stats.released != stats.acquired ||
+		stats.max_used > 2 * MSG_POOL_TEST_THREAD_COUNT) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Stats");
+		status = FALSE;
+	}
+	return status;
+}
+
+apt_test_suite_t* task_msg_pool_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"msgpool",NULL,msg_pool_test_run);
+	return suite;
+}
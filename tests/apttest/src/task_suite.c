@@ -25,6 +25,37 @@ static apt_bool_t task_main(apt_task_t *task)
 	return TRUE;
 }
 
+static apt_bool_t task_affinity_test_run(apt_task_t *task)
+{
+	static const char *invalid_sets[] = {"x","3-1","0,,1","1-","256","0;1"};
+	apr_size_t i;
+	for(i=0; i<sizeof(invalid_sets)/sizeof(invalid_sets[0]); i++) {
+		if(apt_task_affinity_set(task,invalid_sets[i]) == TRUE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Accepted Invalid CPU Set [%s]",invalid_sets[i]);
+			return FALSE;
+		}
+	}
+	if(apt_task_priority_set(task,100) == TRUE || apt_task_priority_set(task,-1) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Accepted Invalid Priority");
+		return FALSE;
+	}
+
+	/* CPUs are returned in ascending order, wrapped around the set */
+	if(apt_task_affinity_set(task,"6, 0-2") == FALSE ||
+		apt_task_affinity_cpu_get(task,0) != 0 || apt_task_affinity_cpu_get(task,2) != 2 ||
+		apt_task_affinity_cpu_get(task,3) != 6 || apt_task_affinity_cpu_get(task,4) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected CPU Set");
+		return FALSE;
+	}
+	if(apt_task_affinity_set(task,NULL) == FALSE || apt_task_affinity_cpu_get(task,0) != -1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Reset CPU Set");
+		return FALSE;
+	}
+
+	/* the first CPU is always there, the task thread pins itself to it */
+	return apt_task_affinity_set(task,"0");
+}
+
 static apt_bool_t task_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
 {
 	apt_task_t *task;
@@ -41,6 +72,11 @@ static apt_bool_t task_test_run(apt_test_suite_t *suite, int argc, const char *
 		vtable->run = task_main;
 	}
 
+	if(task_affinity_test_run(task) == FALSE) {
+		apt_task_destroy(task);
+		return FALSE;
+	}
+
 	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Start Task");
 	if(apt_task_start(task) == FALSE) {
 		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Task");
@@ -0,0 +1,240 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_timer_queue.h"
+#include "apt_pool.h"
+#include "apt_log.h"
+
+#define TIMER_TEST_COUNT      1000
+#define TIMER_TEST_STEPS      20000
+
+/** Test timer along with the time it is expected to elapse at */
+typedef struct {
+	apt_timer_t  *timer;
+	apt_bool_t    set;
+	apr_uint64_t  expected;
+} timer_test_entry_t;
+
+/** Model of the timer queue */
+typedef struct {
+	timer_test_entry_t entries[TIMER_TEST_COUNT];
+	/** Number of timers set */
+	apr_size_t         count;
+	/** Time before and after the current advance */
+	apr_uint64_t       time_before;
+	apr_uint64_t       time_after;
+	/** Whether the next advance is to be skipped (elapsed time reset) */
+	apt_bool_t         reset;
+	apt_bool_t         status;
+	apr_uint32_t       seed;
+} timer_test_model_t;
+
+static apr_uint32_t timer_test_random(timer_test_model_t *model, apr_uint32_t max)
+{
+	model->seed = model->seed * 1103515245 + 12345;
+	return (model->seed >> 4) % max;
+}
+
+static void timer_test_elapsed(apt_timer_t *timer, void *obj)
+{
+	timer_test_model_t *model = obj;
+	timer_test_entry_t *entry = NULL;
+	apr_size_t i;
+	for(i=0; i<TIMER_TEST_COUNT; i++) {
+		if(model->entries[i].timer == timer) {
+			entry = &model->entries[i];
+			break;
+		}
+	}
+	if(!entry || entry->set == FALSE ||
+		entry->expected <= model->time_before || entry->expected > model->time_after) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Timer Elapsed in (%"APR_UINT64_T_FMT";%"APR_UINT64_T_FMT"]",
+			model->time_before,model->time_after);
+		model->status = FALSE;
+		return;
+	}
+	entry->set = FALSE;
+	model->count--;
+}
+
+static void timer_test_remove(timer_test_model_t *model, timer_test_entry_t *entry)
+{
+	entry->set = FALSE;
+	model->count--;
+	if(!model->count) {
+		/* the queue resets elapsed time once it gets empty */
+		model->reset = TRUE;
+	}
+}
+
+/** Randomly set, kill and advance timers, checking each one elapses in time */
+static apt_bool_t timer_test_model_run(apt_test_suite_t *suite)
+{
+	timer_test_model_t *model = apr_pcalloc(suite->pool,sizeof(timer_test_model_t));
+	apt_timer_queue_t *queue = apt_timer_queue_create(suite->pool);
+	timer_test_entry_t *entry;
+	apr_uint64_t now = 0;
+	apr_uint32_t timeout;
+	apr_uint32_t step;
+	apr_size_t i;
+
+	model->status = TRUE;
+	model->seed = 1;
+	for(i=0; i<TIMER_TEST_COUNT; i++) {
+		model->entries[i].timer = apt_timer_create(queue,timer_test_elapsed,model,suite->pool);
+	}
+
+	for(step=0; step<TIMER_TEST_STEPS && model->status == TRUE; step++) {
+		/* set, reset or kill some timers: mostly short timeouts, now and then long ones */
+		for(i=0; i<8; i++) {
+			entry = &model->entries[timer_test_random(model,TIMER_TEST_COUNT)];
+			if(timer_test_random(model,4) == 0) {
+				if(apt_timer_kill(entry->timer) != entry->set) {
+					apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Kill Status");
+					return FALSE;
+				}
+				if(entry->set == TRUE) {
+					timer_test_remove(model,entry);
+				}
+				continue;
+			}
+
+			switch(timer_test_random(model,8)) {
+				case 0:  timeout = 1 + timer_test_random(model,1 << 28); break;
+				case 1:  timeout = 1 + timer_test_random(model,1 << 20); break;
+				case 2:  timeout = 1 + timer_test_random(model,1 << 14); break;
+				default: timeout = 1 + timer_test_random(model,1000); break;
+			}
+			if(entry->set == TRUE) {
+				timer_test_remove(model,entry);
+			}
+			apt_timer_set(entry->timer,timeout);
+			entry->set = TRUE;
+			entry->expected = now + timeout;
+			model->count++;
+		}
+
+		/* the timeout must not exceed the time left to the nearest timer */
+		model->reset = FALSE;
+		if(apt_timer_queue_timeout_get(queue,&timeout) == TRUE) {
+			for(i=0; i<TIMER_TEST_COUNT; i++) {
+				entry = &model->entries[i];
+				if(entry->set == TRUE && (timeout == 0 || entry->expected < now + timeout)) {
+					apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Timeout [%u]",timeout);
+					return FALSE;
+				}
+			}
+		}
+		else if(model->count) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Timeout");
+			return FALSE;
+		}
+
+		/* advance by the timeout (as poller does), by a random step, or by a huge one */
+		switch(timer_test_random(model,16)) {
+			case 0:  timeout = 1 << 24; break;
+			case 1:
+			case 2:  break;
+			default: timeout = 1 + timer_test_random(model,500); break;
+		}
+		if(!model->count) {
+			timeout = 1;
+		}
+		model->time_before = now;
+		if(model->count) {
+			now += timeout;
+		}
+		model->time_after = now;
+		apt_timer_queue_advance(queue,timeout);
+
+		for(i=0; i<TIMER_TEST_COUNT; i++) {
+			entry = &model->entries[i];
+			if(entry->set == TRUE && entry->expected <= now) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Timer Not Elapsed [%"APR_UINT64_T_FMT"] at [%"APR_UINT64_T_FMT"]",
+					entry->expected,now);
+				return FALSE;
+			}
+		}
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Timer Queue [%u] steps [%"APR_UINT64_T_FMT"] ms elapsed",step,now);
+	return model->status;
+}
+
+static void timer_test_bench_proc(apt_timer_t *timer, void *obj)
+{
+}
+
+/** Measure the cost of set and kill with many timers in the queue */
+static apt_bool_t timer_test_bench_run(apt_test_suite_t *suite, apr_size_t count)
+{
+	apr_pool_t *pool = apt_subpool_create(suite->pool);
+	apt_timer_queue_t *queue = apt_timer_queue_create(pool);
+	apt_timer_t **timers = apr_palloc(pool,sizeof(apt_timer_t*) * count);
+	apr_time_t start;
+	apr_time_t set_time;
+	apr_time_t kill_time;
+	apr_size_t i;
+
+	for(i=0; i<count; i++) {
+		timers[i] = apt_timer_create(queue,timer_test_bench_proc,NULL,pool);
+	}
+
+	start = apr_time_now();
+	for(i=0; i<count; i++) {
+		/* a mix of RTCP-like and inactivity-like timeouts */
+		apt_timer_set(timers[i],(i & 1) ? 5000 + (apr_uint32_t)(i % 1000) : 60000 + (apr_uint32_t)(i % 10000));
+	}
+	set_time = apr_time_now() - start;
+
+	start = apr_time_now();
+	for(i=0; i<count; i++) {
+		apt_timer_kill(timers[i]);
+	}
+	kill_time = apr_time_now() - start;
+
+	if(apt_timer_queue_is_empty(queue) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Empty Timer Queue");
+		apt_timer_queue_destroy(queue);
+		apr_pool_destroy(pool);
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Timer Queue [%"APR_SIZE_T_FMT"] timers set [%.1f ns/timer] kill [%.1f ns/timer]",
+		count,
+		set_time * 1000.0 / count,
+		kill_time * 1000.0 / count);
+	apt_timer_queue_destroy(queue);
+	apr_pool_destroy(pool);
+	return TRUE;
+}
+
+static apt_bool_t timer_queue_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	if(timer_test_model_run(suite) == FALSE) {
+		return FALSE;
+	}
+	if(timer_test_bench_run(suite,10000) == FALSE) {
+		return FALSE;
+	}
+	return timer_test_bench_run(suite,100000);
+}
+
+apt_test_suite_t* timer_queue_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"timer",NULL,timer_queue_test_run);
+	return suite;
+}
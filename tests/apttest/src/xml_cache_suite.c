@@ -0,0 +1,142 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_file_io.h>
+#include <apr_strings.h>
+#include "apt_test_suite.h"
+#include "apt_xml_cache.h"
+#include "apt_log.h"
+
+/** Document under test */
+static const char xml_cache_test_doc[] =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<unimrcpserver version=\"1.0\">\n"
+	"  <properties>\n"
+	"    <ip type=\"auto\"/>\n"
+	"  </properties>\n"
+	"  <components>\n"
+	"    <plugin-factory>\n"
+	"      <engine id=\"Demo-Synth-1\" name=\"demosynth\" enable=\"true\">\n"
+	"        <max-channel-count>100</max-channel-count>\n"
+	"        <param name=\"prompt-cache-size\" value=\"16\"/>\n"
+	"      </engine>\n"
+	"    </plugin-factory>\n"
+	"  </components>\n"
+	"</unimrcpserver>\n";
+
+static apt_bool_t xml_cache_text_compare(const apr_text_header *h1, const apr_text_header *h2)
+{
+	const apr_text *t1 = h1->first;
+	const apr_text *t2 = h2->first;
+	for(; t1 && t2; t1 = t1->next, t2 = t2->next) {
+		if(strcmp(t1->text,t2->text) != 0) {
+			return FALSE;
+		}
+	}
+	return (!t1 && !t2) ? TRUE : FALSE;
+}
+
+static apt_bool_t xml_cache_elem_compare(const apr_xml_elem *e1, const apr_xml_elem *e2)
+{
+	const apr_xml_attr *a1;
+	const apr_xml_attr *a2;
+	if(strcmp(e1->name,e2->name) != 0 || e1->ns != e2->ns ||
+		xml_cache_text_compare(&e1->first_cdata,&e2->first_cdata) == FALSE ||
+		xml_cache_text_compare(&e1->following_cdata,&e2->following_cdata) == FALSE) {
+		return FALSE;
+	}
+	for(a1 = e1->attr, a2 = e2->attr; a1 && a2; a1 = a1->next, a2 = a2->next) {
+		if(strcmp(a1->name,a2->name) != 0 || strcmp(a1->value,a2->value) != 0) {
+			return FALSE;
+		}
+	}
+	if(a1 || a2) {
+		return FALSE;
+	}
+	for(e1 = e1->first_child, e2 = e2->first_child; e1 && e2; e1 = e1->next, e2 = e2->next) {
+		if(xml_cache_elem_compare(e1,e2) == FALSE) {
+			return FALSE;
+		}
+	}
+	return (!e1 && !e2) ? TRUE : FALSE;
+}
+
+static apt_bool_t xml_cache_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_xml_parser *parser;
+	apr_xml_doc *doc = NULL;
+	apr_xml_doc *cached;
+	apr_file_t *file;
+	const char *temp_dir;
+	const char *path;
+	apr_off_t size = sizeof(xml_cache_test_doc) - 1;
+	apr_time_t mtime = apr_time_now();
+	apr_off_t offset;
+	char c;
+
+	parser = apr_xml_parser_create(suite->pool);
+	if(apr_xml_parser_feed(parser,xml_cache_test_doc,sizeof(xml_cache_test_doc) - 1) != APR_SUCCESS ||
+		apr_xml_parser_done(parser,&doc) != APR_SUCCESS || !doc) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Document");
+		return FALSE;
+	}
+
+	if(apr_temp_dir_get(&temp_dir,suite->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	path = apr_psprintf(suite->pool,"%s/apttest-%"APR_TIME_T_FMT".xml.cache",temp_dir,mtime);
+	if(apt_xml_cache_save(doc,path,size,mtime,suite->pool) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Save Cache [%s]",path);
+		return FALSE;
+	}
+
+	cached = apt_xml_cache_load(path,size,mtime,suite->pool);
+	if(!cached || xml_cache_elem_compare(doc->root,cached->root) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Cached Document Mismatch");
+		apr_file_remove(path,suite->pool);
+		return FALSE;
+	}
+
+	/* the cache of a modified source is stale */
+	if(apt_xml_cache_load(path,size,mtime + 1,suite->pool) || apt_xml_cache_load(path,size + 1,mtime,suite->pool)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Stale Cache Loaded");
+		apr_file_remove(path,suite->pool);
+		return FALSE;
+	}
+
+	/* a corrupted cache fails the checksum */
+	if(apr_file_open(&file,path,APR_FOPEN_READ | APR_FOPEN_WRITE | APR_FOPEN_BINARY,APR_OS_DEFAULT,suite->pool) == APR_SUCCESS) {
+		offset = 48;
+		c = 'X';
+		apr_file_seek(file,APR_SET,&offset);
+		apr_file_putc(c,file);
+		apr_file_close(file);
+	}
+	cached = apt_xml_cache_load(path,size,mtime,suite->pool);
+	apr_file_remove(path,suite->pool);
+	if(cached) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Corrupted Cache Loaded");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* xml_cache_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"xml-cache",NULL,xml_cache_test_run);
+	return suite;
+}
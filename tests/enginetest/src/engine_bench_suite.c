@@ -0,0 +1,1047 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Benchmark of a recognizer plugin driven in-process, without signaling and RTP.
+ *
+ * The plugin is loaded by the engine loader, the channels are opened through the
+ * engine interface as the server does it, and DEFINE-GRAMMAR and RECOGNIZE requests
+ * are processed by the channels directly. The audio of an input file is written to
+ * the sink stream of each channel in 10 msec frames at a configurable speed, which
+ * makes the runs reproducible and the plugin easy to profile.
+ *
+ * Usage: enginetest engine-bench plugin [name=value ...]
+ *   plugin    path to the plugin (relative to plugin dir)
+ *   root      root dir of the dir layout
+ *   input     headerless L16 or WAV file (relative to data dir), default one-8kHz.pcm
+ *   rate      sampling rate of headerless input, default 8000
+ *   grammar   grammar file (relative to data dir), none by default
+ *   channels  number of concurrent channels, default 1
+ *   count     number of utterances per channel, default 10
+ *   speed     speed relative to real time, 0 for as fast as possible, default 1
+ *   any other name=value is passed to the engine as a param
+ *
+ * Soak test of the same plugin, churning sessions for hours and watching for drift.
+ *
+ * Each channel thread opens a channel, runs "count" utterances over it and closes it,
+ * over and over till the time is up. Every "interval" the process is sampled: RSS,
+ * open file descriptors, jobs queued to the engine (backlog), open channels, memory
+ * charged to the engine and the p99 time to complete within the interval. The samples
+ * are written as CSV to the series file for regression tracking. The first sample is
+ * the baseline, taken once the engine is warmed up by the first interval; the run
+ * fails if the last sample drifts from it beyond any of the thresholds.
+ *
+ * Usage: enginetest engine-soak plugin [name=value ...]
+ *   as engine-bench, except count defaults to 1 (a session per utterance), and
+ *   hours          duration of the run, default 1
+ *   interval       sampling interval (sec), default 60
+ *   series         CSV file to write the samples to, none by default
+ *   rss-drift      max growth of RSS (percent), default 10
+ *   fd-drift       max growth of open file descriptors, default 16
+ *   backlog-drift  max growth of the engine backlog, default the number of channels
+ *   p99-drift      max growth of the p99 time to complete (percent), default 50
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <apr_atomic.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#include <apr_strings.h>
+#include <apr_file_info.h>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+#include "apt_test_suite.h"
+#include "apt_dir_layout.h"
+#include "apt_histogram.h"
+#include "apt_mem_account.h"
+#include "apt_log.h"
+#include "mrcp_engine_loader.h"
+#include "mrcp_engine_iface.h"
+#include "mrcp_resource_loader.h"
+#include "mrcp_resource_factory.h"
+#include "mrcp_message.h"
+#include "mrcp_generic_header.h"
+#include "mrcp_recog_resource.h"
+#include "mpf_engine.h"
+#include "mpf_termination_factory.h"
+#include "mpf_stream.h"
+#include "mpf_codec_descriptor.h"
+
+#define ENGINE_BENCH_DEFAULT_INPUT    "one-8kHz.pcm"
+#define ENGINE_BENCH_DEFAULT_RATE     8000
+#define ENGINE_BENCH_DEFAULT_COUNT    10
+
+/** Time (msec) to wait for the engine and the channels to respond */
+#define ENGINE_BENCH_RESPONSE_TIMEOUT 30000
+/** Time (msec) of silence written after the input till the recognition is given up */
+#define ENGINE_BENCH_TRAILING_SILENCE 10000
+
+#define ENGINE_SOAK_DEFAULT_HOURS         1
+#define ENGINE_SOAK_DEFAULT_INTERVAL      60
+#define ENGINE_SOAK_DEFAULT_RSS_DRIFT     10
+#define ENGINE_SOAK_DEFAULT_FD_DRIFT      16
+#define ENGINE_SOAK_DEFAULT_P99_DRIFT     50
+
+typedef struct engine_bench_t engine_bench_t;
+typedef struct engine_bench_channel_t engine_bench_channel_t;
+typedef struct engine_soak_sample_t engine_soak_sample_t;
+
+/** Sample of the process taken by the soak test */
+struct engine_soak_sample_t {
+	/** Time since the start (sec) */
+	apr_size_t   elapsed;
+	/** Resident set size (KB, 0 if unknown) */
+	apr_size_t   rss;
+	/** Open file descriptors (0 if unknown) */
+	apr_size_t   fds;
+	/** Jobs queued to the threads of the engine */
+	apr_size_t   backlog;
+	/** Open channels */
+	apr_size_t   channels;
+	/** Memory charged to the engine (bytes) */
+	apr_size_t   engine_memory;
+	/** Sessions and utterances run so far */
+	apr_size_t   sessions;
+	apr_size_t   recognized;
+	apr_size_t   failed;
+	/** Utterances complete and p99 time to complete (msec) within the interval */
+	apr_size_t   interval_count;
+	apr_uint32_t p99;
+};
+
+/** Benchmark settings and the outcome of the run */
+struct engine_bench_t {
+	const char           *plugin_path;
+	const char           *root_dir_path;
+	const char           *input_file;
+	const char           *grammar_file;
+	apr_uint16_t          sampling_rate;
+	apr_size_t            channel_count;
+	apr_size_t            utterance_count;
+	double                speed;
+	apr_table_t          *params;
+
+	/** Soak test settings (soak is FALSE for the benchmark) */
+	apt_bool_t            soak;
+	double                hours;
+	apr_size_t            sample_interval;
+	const char           *series_file;
+	double                rss_drift;
+	apr_size_t            fd_drift;
+	apr_size_t            backlog_drift;
+	double                p99_drift;
+	/** Time the channels stop starting sessions at */
+	apr_time_t            end_time;
+
+	const mrcp_resource_t *resource;
+	mrcp_engine_t        *engine;
+
+	/** Audio of the input file, shared by the channels */
+	const char           *audio;
+	apr_size_t            audio_size;
+	/** Grammar content and its type */
+	const char           *grammar;
+	const char           *grammar_type;
+
+	apr_thread_mutex_t   *mutex;
+	apr_thread_cond_t    *cond;
+	apt_bool_t            engine_responded;
+
+	/** Outcome guarded by the mutex */
+	apr_size_t            recognized;
+	apr_size_t            failed;
+	apt_histogram_t      *latency_histogram;
+	apt_histogram_t      *rtf_histogram;
+	apt_histogram_t      *write_histogram;
+	/** Time to complete within the sampling interval of the soak test */
+	apt_histogram_t      *interval_histogram;
+	apr_size_t            sessions;
+
+	apr_pool_t           *pool;
+};
+
+/** Simulated channel */
+struct engine_bench_channel_t {
+	engine_bench_t        *bench;
+	apr_size_t             id;
+	apt_str_t              session_id;
+	mrcp_engine_channel_t *channel;
+	apr_thread_t          *thread;
+
+	apr_thread_mutex_t    *mutex;
+	apr_thread_cond_t     *cond;
+	apt_bool_t             responded;
+	apt_bool_t             status;
+	mrcp_message_t        *response;
+	apt_bool_t             complete;
+	apr_time_t             complete_time;
+	mrcp_request_id        request_id;
+
+	apr_pool_t            *pool;
+	/** Pool of the current session, cleared as the channel is destroyed */
+	apr_pool_t            *session_pool;
+};
+
+static apt_bool_t engine_bench_engine_on_open(mrcp_engine_t *engine, apt_bool_t status)
+{
+	engine_bench_t *bench = engine->event_obj;
+	mrcp_engine_on_open(engine,status);
+	apr_thread_mutex_lock(bench->mutex);
+	bench->engine_responded = TRUE;
+	apr_thread_cond_signal(bench->cond);
+	apr_thread_mutex_unlock(bench->mutex);
+	return TRUE;
+}
+
+static apt_bool_t engine_bench_engine_on_close(mrcp_engine_t *engine)
+{
+	engine_bench_t *bench = engine->event_obj;
+	mrcp_engine_on_close(engine);
+	apr_thread_mutex_lock(bench->mutex);
+	bench->engine_responded = TRUE;
+	apr_thread_cond_signal(bench->cond);
+	apr_thread_mutex_unlock(bench->mutex);
+	return TRUE;
+}
+
+static const mrcp_engine_event_vtable_t engine_bench_engine_vtable = {
+	engine_bench_engine_on_open,
+	engine_bench_engine_on_close
+};
+
+static void engine_bench_channel_signal(engine_bench_channel_t *bench_channel, apt_bool_t status)
+{
+	apr_thread_mutex_lock(bench_channel->mutex);
+	bench_channel->status = status;
+	bench_channel->responded = TRUE;
+	apr_thread_cond_signal(bench_channel->cond);
+	apr_thread_mutex_unlock(bench_channel->mutex);
+}
+
+static apt_bool_t engine_bench_channel_on_open(mrcp_engine_channel_t *channel, apt_bool_t status)
+{
+	engine_bench_channel_signal(channel->event_obj,status);
+	return TRUE;
+}
+
+static apt_bool_t engine_bench_channel_on_close(mrcp_engine_channel_t *channel)
+{
+	engine_bench_channel_signal(channel->event_obj,TRUE);
+	return TRUE;
+}
+
+static apt_bool_t engine_bench_channel_on_message(mrcp_engine_channel_t *channel, mrcp_message_t *message)
+{
+	engine_bench_channel_t *bench_channel = channel->event_obj;
+	apr_thread_mutex_lock(bench_channel->mutex);
+	if(message->start_line.message_type == MRCP_MESSAGE_TYPE_RESPONSE) {
+		bench_channel->response = message;
+		bench_channel->status = (message->start_line.status_code == MRCP_STATUS_CODE_SUCCESS) ? TRUE : FALSE;
+		bench_channel->responded = TRUE;
+		if(message->start_line.request_state == MRCP_REQUEST_STATE_COMPLETE &&
+			message->start_line.method_id == RECOGNIZER_RECOGNIZE) {
+			/* the request is complete without an event, e.g. failed */
+			bench_channel->complete = TRUE;
+			bench_channel->complete_time = apr_time_now();
+		}
+		apr_thread_cond_signal(bench_channel->cond);
+	}
+	else if(message->start_line.message_type == MRCP_MESSAGE_TYPE_EVENT &&
+		message->start_line.method_id == RECOGNIZER_RECOGNITION_COMPLETE) {
+		bench_channel->complete = TRUE;
+		bench_channel->complete_time = apr_time_now();
+	}
+	apr_thread_mutex_unlock(bench_channel->mutex);
+	return TRUE;
+}
+
+static const mrcp_engine_channel_event_vtable_t engine_bench_channel_vtable = {
+	engine_bench_channel_on_open,
+	engine_bench_channel_on_close,
+	engine_bench_channel_on_message
+};
+
+/** Wait for the engine to respond, the mutex of the bench is locked */
+static apt_bool_t engine_bench_engine_wait(engine_bench_t *bench)
+{
+	while(bench->engine_responded == FALSE) {
+		if(apr_thread_cond_timedwait(bench->cond,bench->mutex,ENGINE_BENCH_RESPONSE_TIMEOUT * 1000) == APR_TIMEUP) {
+			return FALSE;
+		}
+	}
+	bench->engine_responded = FALSE;
+	return TRUE;
+}
+
+/** Wait for the channel to respond, the mutex of the channel is locked */
+static apt_bool_t engine_bench_channel_wait(engine_bench_channel_t *bench_channel)
+{
+	while(bench_channel->responded == FALSE) {
+		if(apr_thread_cond_timedwait(bench_channel->cond,bench_channel->mutex,ENGINE_BENCH_RESPONSE_TIMEOUT * 1000) == APR_TIMEUP) {
+			return FALSE;
+		}
+	}
+	bench_channel->responded = FALSE;
+	return bench_channel->status;
+}
+
+/** Create request of the channel */
+static mrcp_message_t* engine_bench_request_create(engine_bench_channel_t *bench_channel, mrcp_method_id method_id, apr_pool_t *pool)
+{
+	mrcp_message_t *request = mrcp_request_create(bench_channel->bench->resource,MRCP_VERSION_2,method_id,pool);
+	if(request) {
+		request->start_line.request_id = ++bench_channel->request_id;
+		request->channel_id.session_id = bench_channel->session_id;
+	}
+	return request;
+}
+
+/** Set the body of the request */
+static void engine_bench_request_body_set(mrcp_message_t *request, const char *content_type, const char *content_id, const char *body)
+{
+	mrcp_generic_header_t *generic_header = mrcp_generic_header_prepare(request);
+	if(!generic_header) {
+		return;
+	}
+	apt_string_assign(&generic_header->content_type,content_type,request->pool);
+	mrcp_generic_header_property_add(request,GENERIC_HEADER_CONTENT_TYPE);
+	if(content_id) {
+		apt_string_assign(&generic_header->content_id,content_id,request->pool);
+		mrcp_generic_header_property_add(request,GENERIC_HEADER_CONTENT_ID);
+	}
+	apt_string_assign(&request->body,body,request->pool);
+}
+
+/** Process request and wait for the response */
+static apt_bool_t engine_bench_request_process(engine_bench_channel_t *bench_channel, mrcp_message_t *request)
+{
+	apt_bool_t status;
+	apr_thread_mutex_lock(bench_channel->mutex);
+	bench_channel->responded = FALSE;
+	bench_channel->response = NULL;
+	bench_channel->complete = FALSE;
+	apr_thread_mutex_unlock(bench_channel->mutex);
+
+	/* the response may be sent from within the call */
+	if(mrcp_engine_channel_request_process(bench_channel->channel,request) == FALSE) {
+		return FALSE;
+	}
+
+	apr_thread_mutex_lock(bench_channel->mutex);
+	status = engine_bench_channel_wait(bench_channel);
+	apr_thread_mutex_unlock(bench_channel->mutex);
+	return status;
+}
+
+/** Write the input and then silence to the sink stream at the speed set, till the recognition is complete */
+static apt_bool_t engine_bench_audio_write(engine_bench_channel_t *bench_channel, mpf_audio_stream_t *stream, apr_size_t frame_size, apr_time_t *input_over_time)
+{
+	engine_bench_t *bench = bench_channel->bench;
+	mpf_frame_t frame;
+	char *silence = apr_pcalloc(bench_channel->session_pool,frame_size);
+	apr_size_t offset = 0;
+	apr_size_t frame_count = 0;
+	apr_size_t silence_count = 0;
+	apr_time_t start_time = apr_time_now();
+	apr_time_t write_time;
+	apt_bool_t complete = FALSE;
+
+	*input_over_time = 0;
+	memset(&frame,0,sizeof(frame));
+	frame.type = MEDIA_FRAME_TYPE_AUDIO;
+	frame.codec_frame.size = frame_size;
+
+	while(silence_count < ENGINE_BENCH_TRAILING_SILENCE / CODEC_FRAME_TIME_BASE) {
+		if(offset + frame_size <= bench->audio_size) {
+			frame.codec_frame.buffer = (void*)(bench->audio + offset);
+			offset += frame_size;
+		}
+		else {
+			if(!*input_over_time) {
+				*input_over_time = apr_time_now();
+			}
+			frame.codec_frame.buffer = silence;
+			silence_count++;
+		}
+
+		write_time = apr_time_now();
+		mpf_audio_stream_frame_write(stream,&frame);
+		write_time = apr_time_now() - write_time;
+		frame_count++;
+
+		apr_thread_mutex_lock(bench->mutex);
+		apt_histogram_record(bench->write_histogram,(apr_uint32_t)write_time);
+		apr_thread_mutex_unlock(bench->mutex);
+
+		apr_thread_mutex_lock(bench_channel->mutex);
+		complete = bench_channel->complete;
+		apr_thread_mutex_unlock(bench_channel->mutex);
+		if(complete == TRUE) {
+			break;
+		}
+
+		if(bench->speed > 0) {
+			/* keep the pace against the start, so that the delays do not accumulate */
+			apr_time_t due = start_time + (apr_time_t)(frame_count * CODEC_FRAME_TIME_BASE * 1000 / bench->speed);
+			apr_time_t now = apr_time_now();
+			if(due > now) {
+				apr_sleep(due - now);
+			}
+		}
+	}
+
+	if(!*input_over_time) {
+		*input_over_time = apr_time_now();
+	}
+	return complete;
+}
+
+/** Run utterances over a channel */
+static apt_bool_t engine_bench_utterances_run(engine_bench_channel_t *bench_channel)
+{
+	engine_bench_t *bench = bench_channel->bench;
+	mpf_audio_stream_t *stream = mpf_termination_audio_stream_get(bench_channel->channel->termination);
+	apr_size_t frame_size = bench->sampling_rate * 2 * CODEC_FRAME_TIME_BASE / 1000;
+	apr_uint32_t duration = (apr_uint32_t) (bench->audio_size * 1000 / (bench->sampling_rate * 2));
+	const char *grammar_uri = NULL;
+	mrcp_message_t *request;
+	apr_pool_t *pool;
+	apr_size_t i;
+
+	if(!stream || !stream->vtable->write_frame) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Sink Stream of Channel [%s]",bench_channel->session_id.buf);
+		return FALSE;
+	}
+
+	/* the media engine would validate the stream against the offer */
+	stream->tx_descriptor = mpf_codec_lpcm_descriptor_create(bench->sampling_rate,1,bench_channel->session_pool);
+	mpf_audio_stream_tx_open(stream,NULL);
+
+	apr_pool_create(&pool,bench_channel->session_pool);
+	if(bench->grammar) {
+		request = engine_bench_request_create(bench_channel,RECOGNIZER_DEFINE_GRAMMAR,pool);
+		engine_bench_request_body_set(request,bench->grammar_type,"bench",bench->grammar);
+		if(engine_bench_request_process(bench_channel,request) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Define Grammar [%s]",bench_channel->session_id.buf);
+			mpf_audio_stream_tx_close(stream);
+			apr_pool_destroy(pool);
+			return FALSE;
+		}
+		grammar_uri = "session:bench";
+	}
+
+	for(i=0; i<bench->utterance_count; i++) {
+		apr_time_t start_time;
+		apr_time_t input_over_time;
+		apt_bool_t complete = FALSE;
+
+		apr_pool_clear(pool);
+		request = engine_bench_request_create(bench_channel,RECOGNIZER_RECOGNIZE,pool);
+		if(grammar_uri) {
+			engine_bench_request_body_set(request,"text/uri-list",NULL,grammar_uri);
+		}
+
+		start_time = apr_time_now();
+		if(engine_bench_request_process(bench_channel,request) == TRUE) {
+			complete = engine_bench_audio_write(bench_channel,stream,frame_size,&input_over_time);
+		}
+
+		apr_thread_mutex_lock(bench->mutex);
+		if(complete == TRUE) {
+			apr_time_t complete_time = bench_channel->complete_time;
+			bench->recognized++;
+			apr_uint32_t latency = complete_time > input_over_time ? (apr_uint32_t)apr_time_as_msec(complete_time - input_over_time) : 0;
+			apt_histogram_record(bench->latency_histogram,latency);
+			apt_histogram_record(bench->interval_histogram,latency);
+			if(duration) {
+				/* permille of the duration of the input */
+				apt_histogram_record(bench->rtf_histogram,
+					(apr_uint32_t)(apr_time_as_msec(complete_time - start_time) * 1000 / duration));
+			}
+		}
+		else {
+			bench->failed++;
+		}
+		apr_thread_mutex_unlock(bench->mutex);
+	}
+
+	mpf_audio_stream_tx_close(stream);
+	apr_pool_destroy(pool);
+	return TRUE;
+}
+
+/** Open a channel, run utterances over it and close it */
+static apt_bool_t engine_bench_session_run(engine_bench_channel_t *bench_channel)
+{
+	engine_bench_t *bench = bench_channel->bench;
+	apt_bool_t status;
+
+	bench_channel->channel = mrcp_engine_channel_virtual_create(bench->engine,NULL,MRCP_VERSION_2,bench_channel->session_pool);
+	if(!bench_channel->channel) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Channel [%s]",bench_channel->session_id.buf);
+		return FALSE;
+	}
+	bench_channel->channel->event_vtable = &engine_bench_channel_vtable;
+	bench_channel->channel->event_obj = bench_channel;
+
+	/* the response may be sent from within the call, the mutex is not held meanwhile */
+	bench_channel->responded = FALSE;
+	status = mrcp_engine_channel_virtual_open(bench_channel->channel);
+	if(status == TRUE) {
+		apr_thread_mutex_lock(bench_channel->mutex);
+		status = engine_bench_channel_wait(bench_channel);
+		apr_thread_mutex_unlock(bench_channel->mutex);
+	}
+
+	if(status == TRUE) {
+		engine_bench_utterances_run(bench_channel);
+
+		bench_channel->responded = FALSE;
+		if(mrcp_engine_channel_virtual_close(bench_channel->channel) == TRUE) {
+			apr_thread_mutex_lock(bench_channel->mutex);
+			engine_bench_channel_wait(bench_channel);
+			apr_thread_mutex_unlock(bench_channel->mutex);
+		}
+	}
+	else {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Channel [%s]",bench_channel->session_id.buf);
+	}
+
+	mrcp_engine_channel_virtual_destroy(bench_channel->channel);
+	bench_channel->channel = NULL;
+	return status;
+}
+
+/** Thread function to run a channel in, session after session till the soak time is up */
+static void* APR_THREAD_FUNC engine_bench_channel_run(apr_thread_t *thread, void *data)
+{
+	engine_bench_channel_t *bench_channel = data;
+	engine_bench_t *bench = bench_channel->bench;
+	apt_bool_t status;
+
+	apr_pool_create(&bench_channel->session_pool,bench_channel->pool);
+	do {
+		status = engine_bench_session_run(bench_channel);
+		/* the harness must not grow by itself over the sessions */
+		apr_pool_clear(bench_channel->session_pool);
+
+		apr_thread_mutex_lock(bench->mutex);
+		bench->sessions++;
+		apr_thread_mutex_unlock(bench->mutex);
+	}
+	while(status == TRUE && bench->soak == TRUE && apr_time_now() < bench->end_time);
+	return NULL;
+}
+
+/** Read a file as a whole */
+static char* engine_bench_file_read(const char *file_path, apr_size_t *size, apr_pool_t *pool)
+{
+	char *buf = NULL;
+	long file_size;
+	FILE *file = fopen(file_path,"rb");
+	if(!file) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open File [%s]",file_path);
+		return NULL;
+	}
+	if(fseek(file,0,SEEK_END) == 0 && (file_size = ftell(file)) >= 0 && fseek(file,0,SEEK_SET) == 0) {
+		buf = apr_palloc(pool,file_size + 1);
+		*size = fread(buf,1,file_size,file);
+		buf[*size] = '\0';
+	}
+	fclose(file);
+	return buf;
+}
+
+/** Load the audio of the input file, the header of a WAV file is skipped */
+static apt_bool_t engine_bench_audio_load(engine_bench_t *bench, const char *file_path)
+{
+	apr_size_t size = 0;
+	const char *audio = engine_bench_file_read(file_path,&size,bench->pool);
+	if(!audio) {
+		return FALSE;
+	}
+
+	if(size >= 12 && memcmp(audio,"RIFF",4) == 0 && memcmp(audio+8,"WAVE",4) == 0) {
+		apr_size_t offset = 12;
+		while(offset + 8 <= size) {
+			const unsigned char *chunk = (const unsigned char*)audio + offset;
+			apr_size_t chunk_size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((apr_size_t)chunk[7] << 24);
+			offset += 8;
+			if(memcmp(chunk,"fmt ",4) == 0 && chunk_size >= 8 && offset + 8 <= size) {
+				bench->sampling_rate = (apr_uint16_t) (chunk[12] | (chunk[13] << 8) | (chunk[14] << 16));
+			}
+			else if(memcmp(chunk,"data",4) == 0) {
+				if(chunk_size > size - offset)
+					chunk_size = size - offset;
+				bench->audio = audio + offset;
+				bench->audio_size = chunk_size;
+				return TRUE;
+			}
+			offset += (chunk_size + 1) & ~(apr_size_t)1;
+		}
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Data in [%s]",file_path);
+		return FALSE;
+	}
+
+	bench->audio = audio;
+	bench->audio_size = size;
+	return TRUE;
+}
+
+/** Get the content type of a grammar by the extension of the file */
+static const char* engine_bench_grammar_type_get(const char *file_path)
+{
+	const char *ext = strrchr(file_path,'.');
+	if(ext) {
+		if(strcasecmp(ext,".xml") == 0 || strcasecmp(ext,".grxml") == 0 || strcasecmp(ext,".srgs") == 0)
+			return "application/srgs+xml";
+		if(strcasecmp(ext,".jsgf") == 0)
+			return "application/x-jsgf";
+	}
+	return "text/plain";
+}
+
+/** Parse an argument of the soak test */
+static apt_bool_t engine_soak_arg_parse(engine_bench_t *bench, const char *name, const char *value)
+{
+	if(strcasecmp(name,"hours") == 0)
+		bench->hours = atof(value);
+	else if(strcasecmp(name,"interval") == 0)
+		bench->sample_interval = atol(value);
+	else if(strcasecmp(name,"series") == 0)
+		bench->series_file = value;
+	else if(strcasecmp(name,"rss-drift") == 0)
+		bench->rss_drift = atof(value);
+	else if(strcasecmp(name,"fd-drift") == 0)
+		bench->fd_drift = atol(value);
+	else if(strcasecmp(name,"backlog-drift") == 0)
+		bench->backlog_drift = atol(value);
+	else if(strcasecmp(name,"p99-drift") == 0)
+		bench->p99_drift = atof(value);
+	else
+		return FALSE;
+	return TRUE;
+}
+
+static void engine_bench_args_parse(engine_bench_t *bench, int argc, const char * const *argv)
+{
+	int i;
+	bench->plugin_path = argv[0];
+	for(i=1; i<argc; i++) {
+		char *name = apr_pstrdup(bench->pool,argv[i]);
+		char *value = strchr(name,'=');
+		if(!value) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Ignore Argument [%s]",name);
+			continue;
+		}
+		*value++ = '\0';
+		if(bench->soak == TRUE && engine_soak_arg_parse(bench,name,value) == TRUE)
+			continue;
+		if(strcasecmp(name,"root") == 0)
+			bench->root_dir_path = value;
+		else if(strcasecmp(name,"input") == 0)
+			bench->input_file = value;
+		else if(strcasecmp(name,"rate") == 0)
+			bench->sampling_rate = (apr_uint16_t) atol(value);
+		else if(strcasecmp(name,"grammar") == 0)
+			bench->grammar_file = value;
+		else if(strcasecmp(name,"channels") == 0)
+			bench->channel_count = atol(value);
+		else if(strcasecmp(name,"count") == 0)
+			bench->utterance_count = atol(value);
+		else if(strcasecmp(name,"speed") == 0)
+			bench->speed = atof(value);
+		else
+			apr_table_set(bench->params,name,value);
+	}
+}
+
+static void engine_bench_histogram_log(const char *name, const char *unit, const apt_histogram_t *histogram)
+{
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"%s [%s] count [%"APR_SIZE_T_FMT"] p50 [%u] p99 [%u] max [%u] mean [%.1f]",
+		name,
+		unit,
+		apt_histogram_count_get(histogram),
+		apt_histogram_percentile_get(histogram,50),
+		apt_histogram_percentile_get(histogram,99),
+		apt_histogram_max_get(histogram),
+		apt_histogram_mean_get(histogram));
+}
+
+/** Get the resident set size of the process (KB, 0 if unknown) */
+static apr_size_t engine_soak_rss_get(void)
+{
+	apr_size_t rss = 0;
+#if defined(__linux__)
+	unsigned long pages;
+	FILE *file = fopen("/proc/self/statm","r");
+	if(file) {
+		if(fscanf(file,"%*lu %lu",&pages) == 1) {
+			rss = (apr_size_t)pages * (apr_size_t)sysconf(_SC_PAGESIZE) / 1024;
+		}
+		fclose(file);
+	}
+#endif
+	return rss;
+}
+
+/** Get the number of open file descriptors of the process (0 if unknown) */
+static apr_size_t engine_soak_fd_count_get(apr_pool_t *pool)
+{
+	apr_size_t count = 0;
+#if defined(__linux__)
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	if(apr_dir_open(&dir,"/proc/self/fd",pool) == APR_SUCCESS) {
+		while(apr_dir_read(&finfo,APR_FINFO_NAME,dir) == APR_SUCCESS) {
+			if(finfo.name && finfo.name[0] != '.') {
+				count++;
+			}
+		}
+		apr_dir_close(dir);
+		/* the descriptor of the dir itself is not counted */
+		if(count) {
+			count--;
+		}
+	}
+#endif
+	return count;
+}
+
+/** Take a sample of the process, the histogram of the interval is reset */
+static void engine_soak_sample_take(engine_bench_t *bench, apr_time_t start_time, engine_soak_sample_t *sample)
+{
+	apr_pool_t *pool;
+	apr_pool_create(&pool,bench->pool);
+	sample->elapsed = (apr_size_t)apr_time_sec(apr_time_now() - start_time);
+	sample->rss = engine_soak_rss_get();
+	sample->fds = engine_soak_fd_count_get(pool);
+	apr_pool_destroy(pool);
+	sample->backlog = apr_atomic_read32(&bench->engine->backlog);
+	sample->channels = apr_atomic_read32(&bench->engine->cur_channel_count);
+	sample->engine_memory = bench->engine->mem_account ? apt_mem_account_used_get(bench->engine->mem_account) : 0;
+
+	apr_thread_mutex_lock(bench->mutex);
+	sample->sessions = bench->sessions;
+	sample->recognized = bench->recognized;
+	sample->failed = bench->failed;
+	sample->interval_count = apt_histogram_count_get(bench->interval_histogram);
+	sample->p99 = sample->interval_count ? apt_histogram_percentile_get(bench->interval_histogram,99) : 0;
+	apt_histogram_reset(bench->interval_histogram);
+	apr_thread_mutex_unlock(bench->mutex);
+}
+
+/** Check the last sample against the baseline */
+static apt_bool_t engine_soak_drift_check(const engine_bench_t *bench, const engine_soak_sample_t *baseline, const engine_soak_sample_t *last)
+{
+	apt_bool_t status = TRUE;
+	if(baseline->rss && last->rss > baseline->rss * (1 + bench->rss_drift / 100)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"RSS Drift [%"APR_SIZE_T_FMT" -> %"APR_SIZE_T_FMT" KB] beyond [%.1f%%]",
+			baseline->rss,last->rss,bench->rss_drift);
+		status = FALSE;
+	}
+	if(last->fds > baseline->fds + bench->fd_drift) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"FD Drift [%"APR_SIZE_T_FMT" -> %"APR_SIZE_T_FMT"] beyond [%"APR_SIZE_T_FMT"]",
+			baseline->fds,last->fds,bench->fd_drift);
+		status = FALSE;
+	}
+	if(last->backlog > baseline->backlog + bench->backlog_drift) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Backlog Drift [%"APR_SIZE_T_FMT" -> %"APR_SIZE_T_FMT"] beyond [%"APR_SIZE_T_FMT"]",
+			baseline->backlog,last->backlog,bench->backlog_drift);
+		status = FALSE;
+	}
+	/* intervals without completions have no latency to compare */
+	if(baseline->interval_count && last->interval_count && last->p99 > baseline->p99 * (1 + bench->p99_drift / 100)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"P99 Drift [%u -> %u ms] beyond [%.1f%%]",
+			baseline->p99,last->p99,bench->p99_drift);
+		status = FALSE;
+	}
+	return status;
+}
+
+/** Sample the process till the soak time is up, then check the drift */
+static apt_bool_t engine_soak_monitor(engine_bench_t *bench, apr_time_t start_time)
+{
+	engine_soak_sample_t baseline;
+	engine_soak_sample_t sample;
+	apr_size_t count = 0;
+	FILE *series = NULL;
+	apr_time_t now;
+
+	if(bench->series_file) {
+		series = fopen(bench->series_file,"w");
+		if(series) {
+			fprintf(series,"elapsed_s,rss_kb,fds,backlog,channels,engine_memory,sessions,recognized,failed,interval_count,p99_ms\n");
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Series File [%s]",bench->series_file);
+		}
+	}
+
+	memset(&baseline,0,sizeof(baseline));
+	while((now = apr_time_now()) < bench->end_time) {
+		/* sampled against the start, so that the delays do not accumulate */
+		apr_time_t due = start_time + apr_time_from_sec(bench->sample_interval * (count + 1));
+		if(due > bench->end_time) {
+			due = bench->end_time;
+		}
+		if(due > now) {
+			apr_sleep(due - now);
+		}
+
+		engine_soak_sample_take(bench,start_time,&sample);
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Soak [%"APR_SIZE_T_FMT" s] RSS [%"APR_SIZE_T_FMT" KB] FDs [%"APR_SIZE_T_FMT"] Backlog [%"APR_SIZE_T_FMT"] Channels [%"APR_SIZE_T_FMT"] Sessions [%"APR_SIZE_T_FMT"] Failed [%"APR_SIZE_T_FMT"] P99 [%u ms]",
+			sample.elapsed,
+			sample.rss,
+			sample.fds,
+			sample.backlog,
+			sample.channels,
+			sample.sessions,
+			sample.failed,
+			sample.p99);
+		if(series) {
+			fprintf(series,"%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%"APR_SIZE_T_FMT",%u\n",
+				sample.elapsed,
+				sample.rss,
+				sample.fds,
+				sample.backlog,
+				sample.channels,
+				sample.engine_memory,
+				sample.sessions,
+				sample.recognized,
+				sample.failed,
+				sample.interval_count,
+				sample.p99);
+			/* the series is followed while the run is in progress */
+			fflush(series);
+		}
+		if(!count) {
+			/* the engine is warmed up by the first interval */
+			baseline = sample;
+		}
+		count++;
+	}
+
+	if(series) {
+		fclose(series);
+	}
+	if(count < 2) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Too Few Samples [%"APR_SIZE_T_FMT"] to Check Drift",count);
+		return TRUE;
+	}
+	return engine_soak_drift_check(bench,&baseline,&sample);
+}
+
+/** Run the channels */
+static apt_bool_t engine_bench_channels_run(engine_bench_t *bench)
+{
+	engine_bench_channel_t *channels = apr_pcalloc(bench->pool,sizeof(engine_bench_channel_t) * bench->channel_count);
+	apr_time_t start_time = apr_time_now();
+	apr_time_t elapsed;
+	apr_status_t rv;
+	apt_bool_t status = TRUE;
+	apr_size_t i;
+
+	bench->end_time = start_time + (apr_time_t)(bench->hours * 3600 * APR_USEC_PER_SEC);
+	for(i=0; i<bench->channel_count; i++) {
+		engine_bench_channel_t *bench_channel = &channels[i];
+		bench_channel->bench = bench;
+		bench_channel->id = i;
+		apr_pool_create(&bench_channel->pool,bench->pool);
+		apt_string_set(&bench_channel->session_id,apr_psprintf(bench_channel->pool,"bench-%"APR_SIZE_T_FMT,i));
+		apr_thread_mutex_create(&bench_channel->mutex,APR_THREAD_MUTEX_DEFAULT,bench_channel->pool);
+		apr_thread_cond_create(&bench_channel->cond,bench_channel->pool);
+		if(apr_thread_create(&bench_channel->thread,NULL,engine_bench_channel_run,bench_channel,bench_channel->pool) != APR_SUCCESS) {
+			bench_channel->thread = NULL;
+		}
+	}
+
+	if(bench->soak == TRUE) {
+		status = engine_soak_monitor(bench,start_time);
+	}
+
+	for(i=0; i<bench->channel_count; i++) {
+		if(channels[i].thread) {
+			apr_thread_join(&rv,channels[i].thread);
+		}
+	}
+	elapsed = apr_time_now() - start_time;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Channels [%"APR_SIZE_T_FMT"] Sessions [%"APR_SIZE_T_FMT"] Utterances [%"APR_SIZE_T_FMT"] Recognized [%"APR_SIZE_T_FMT"] Failed [%"APR_SIZE_T_FMT"] in [%"APR_TIME_T_FMT" ms]",
+		bench->channel_count,
+		bench->sessions,
+		bench->recognized + bench->failed,
+		bench->recognized,
+		bench->failed,
+		apr_time_as_msec(elapsed));
+	engine_bench_histogram_log("Time to Complete after Input","ms",bench->latency_histogram);
+	engine_bench_histogram_log("Real-Time Factor","permille",bench->rtf_histogram);
+	engine_bench_histogram_log("Write Frame","us",bench->write_histogram);
+
+	for(i=0; i<bench->channel_count; i++) {
+		apr_pool_destroy(channels[i].pool);
+	}
+	return (status == TRUE && !bench->failed) ? TRUE : FALSE;
+}
+
+static apt_bool_t engine_bench_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	engine_bench_t *bench;
+	apt_dir_layout_t *dir_layout;
+	mrcp_resource_loader_t *resource_loader;
+	mrcp_engine_loader_t *engine_loader;
+	mrcp_engine_config_t *config;
+	const char *path;
+	apt_bool_t status = FALSE;
+	apt_bool_t opened;
+
+	if(argc < 1) {
+		if(suite->obj) {
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Usage: engine-soak plugin [root=dir] [input=file] [rate=8000] [grammar=file] [channels=1] [count=1] [speed=1] [hours=1] [interval=60] [series=file] [rss-drift=10] [fd-drift=16] [backlog-drift=channels] [p99-drift=50] [param=value]");
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Usage: engine-bench plugin [root=dir] [input=file] [rate=8000] [grammar=file] [channels=1] [count=10] [speed=1] [param=value]");
+		}
+		return TRUE;
+	}
+
+	bench = apr_pcalloc(suite->pool,sizeof(engine_bench_t));
+	bench->pool = suite->pool;
+	bench->input_file = ENGINE_BENCH_DEFAULT_INPUT;
+	bench->sampling_rate = ENGINE_BENCH_DEFAULT_RATE;
+	bench->channel_count = 1;
+	bench->utterance_count = ENGINE_BENCH_DEFAULT_COUNT;
+	bench->speed = 1;
+	bench->params = apr_table_make(bench->pool,5);
+	if(suite->obj) {
+		/* a session per utterance churns channels the most */
+		bench->soak = TRUE;
+		bench->utterance_count = 1;
+		bench->hours = ENGINE_SOAK_DEFAULT_HOURS;
+		bench->sample_interval = ENGINE_SOAK_DEFAULT_INTERVAL;
+		bench->rss_drift = ENGINE_SOAK_DEFAULT_RSS_DRIFT;
+		bench->fd_drift = ENGINE_SOAK_DEFAULT_FD_DRIFT;
+		bench->backlog_drift = (apr_size_t)-1;
+		bench->p99_drift = ENGINE_SOAK_DEFAULT_P99_DRIFT;
+	}
+	engine_bench_args_parse(bench,argc,argv);
+	if(!bench->channel_count || !bench->sampling_rate || (bench->soak == TRUE && !bench->sample_interval)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Arguments");
+		return FALSE;
+	}
+	if(bench->backlog_drift == (apr_size_t)-1) {
+		bench->backlog_drift = bench->channel_count;
+	}
+
+	bench->latency_histogram = apt_histogram_create(bench->pool);
+	bench->rtf_histogram = apt_histogram_create(bench->pool);
+	bench->write_histogram = apt_histogram_create(bench->pool);
+	bench->interval_histogram = apt_histogram_create(bench->pool);
+	apr_thread_mutex_create(&bench->mutex,APR_THREAD_MUTEX_DEFAULT,bench->pool);
+	apr_thread_cond_create(&bench->cond,bench->pool);
+
+	dir_layout = apt_default_dir_layout_create(bench->root_dir_path,bench->pool);
+
+	path = apt_datadir_filepath_get(dir_layout,bench->input_file,bench->pool);
+	if(!path || engine_bench_audio_load(bench,path) == FALSE) {
+		return FALSE;
+	}
+
+	if(bench->grammar_file) {
+		apr_size_t size;
+		path = apt_datadir_filepath_get(dir_layout,bench->grammar_file,bench->pool);
+		bench->grammar = path ? engine_bench_file_read(path,&size,bench->pool) : NULL;
+		if(!bench->grammar) {
+			return FALSE;
+		}
+		bench->grammar_type = engine_bench_grammar_type_get(bench->grammar_file);
+	}
+
+	resource_loader = mrcp_resource_loader_create(TRUE,bench->pool);
+	if(!resource_loader) {
+		return FALSE;
+	}
+	bench->resource = mrcp_resource_get(mrcp_resource_factory_get(resource_loader),MRCP_RECOGNIZER_RESOURCE);
+
+	engine_loader = mrcp_engine_loader_create(bench->pool);
+	config = mrcp_engine_config_alloc(bench->pool);
+	config->max_channel_count = bench->channel_count;
+	config->params = bench->params;
+	path = apt_dir_layout_path_compose(dir_layout,APT_LAYOUT_PLUGIN_DIR,bench->plugin_path,bench->pool);
+	bench->engine = mrcp_engine_loader_plugin_load(engine_loader,"bench",path,config);
+	if(!bench->engine || bench->engine->resource_id != MRCP_RECOGNIZER_RESOURCE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Recognizer Engine in Plugin [%s]",path);
+		mrcp_engine_loader_destroy(engine_loader);
+		return FALSE;
+	}
+
+	/* the engine is set up as the server does it */
+	bench->engine->codec_manager = mpf_engine_codec_manager_create(bench->pool);
+	bench->engine->dir_layout = dir_layout;
+	bench->engine->event_vtable = &engine_bench_engine_vtable;
+	bench->engine->event_obj = bench;
+
+	/* the engine may respond from within the call, the mutex is not held meanwhile */
+	bench->engine_responded = FALSE;
+	opened = mrcp_engine_virtual_open(bench->engine);
+	if(opened == TRUE) {
+		apr_thread_mutex_lock(bench->mutex);
+		opened = engine_bench_engine_wait(bench);
+		apr_thread_mutex_unlock(bench->mutex);
+	}
+
+	if(opened == TRUE && bench->engine->is_open == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Run Engine Bench [%s] Input [%s] [%"APR_SIZE_T_FMT" ms] Channels [%"APR_SIZE_T_FMT"] Speed [%.1f]",
+			bench->plugin_path,
+			bench->input_file,
+			bench->audio_size * 1000 / (bench->sampling_rate * 2),
+			bench->channel_count,
+			bench->speed);
+		status = engine_bench_channels_run(bench);
+
+		bench->engine_responded = FALSE;
+		if(mrcp_engine_virtual_close(bench->engine) == TRUE) {
+			apr_thread_mutex_lock(bench->mutex);
+			engine_bench_engine_wait(bench);
+			apr_thread_mutex_unlock(bench->mutex);
+		}
+	}
+	else {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Engine [%s]",bench->plugin_path);
+	}
+
+	mrcp_engine_virtual_destroy(bench->engine);
+	mrcp_engine_loader_plugins_unload(engine_loader);
+	mrcp_engine_loader_destroy(engine_loader);
+	return status;
+}
+
+apt_test_suite_t* engine_bench_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"engine-bench",NULL,engine_bench_run);
+	return suite;
+}
+
+apt_test_suite_t* engine_soak_test_suite_create(apr_pool_t *pool)
+{
+	static apt_bool_t soak = TRUE;
+	/* the soak test shares the harness, the object of the suite tells it apart */
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"engine-soak",&soak,engine_bench_run);
+	return suite;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include "apt_test_suite.h"
+#include "mpf_activity_detector.h"
+#include "apt_log.h"
+
+#define DETECTOR_TEST_MAX_COUNT 1000
+#define DETECTOR_TEST_FRAME_SAMPLES (8000 / 1000 * CODEC_FRAME_TIME_BASE)
+
+/** Reference calculation of features, sample by sample */
+static void detector_test_features_calculate(const apr_int16_t *samples, apr_size_t count, mpf_activity_features_t *features)
+{
+	apr_size_t i;
+	apr_uint64_t abs_sum = 0;
+	apr_uint64_t energy_sum = 0;
+	features->level = 0;
+	features->energy = 0;
+	features->zero_crossings = 0;
+	if(!count) {
+		return;
+	}
+	for(i=0; i<count; i++) {
+		apr_int32_t value = samples[i];
+		abs_sum += value < 0 ? -value : value;
+		energy_sum += (apr_uint64_t)(value * value);
+		if(i && (value < 0) != (samples[i-1] < 0)) {
+			features->zero_crossings++;
+		}
+	}
+	features->level = (apr_size_t)(abs_sum / count);
+	features->energy = (apr_size_t)(energy_sum / count);
+}
+
+static apt_bool_t detector_test_compare(const apr_int16_t *samples, apr_size_t count)
+{
+	mpf_activity_features_t expected;
+	mpf_activity_features_t features;
+	detector_test_features_calculate(samples,count,&expected);
+
+	mpf_activity_features_calculate(samples,count,&features,TRUE);
+	if(features.level != expected.level ||
+		features.energy != expected.energy ||
+		features.zero_crossings != expected.zero_crossings) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Features Mismatch [%"APR_SIZE_T_FMT"] samples: "
+			"level [%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT"] "
+			"energy [%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT"] "
+			"zero-crossings [%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT"]",
+			count,
+			features.level,expected.level,
+			features.energy,expected.energy,
+			features.zero_crossings,expected.zero_crossings);
+		return FALSE;
+	}
+
+	mpf_activity_features_calculate(samples,count,&features,FALSE);
+	if(features.level != expected.level) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Level Mismatch [%"APR_SIZE_T_FMT"] samples: [%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT"]",
+			count,features.level,expected.level);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/** Feed frames of noise with the given peak amplitude, return the first event raised if any */
+static mpf_detector_event_e detector_test_feed(mpf_activity_detector_t *detector, apr_size_t duration, int amplitude)
+{
+	apr_int16_t samples[DETECTOR_TEST_FRAME_SAMPLES];
+	mpf_frame_t frame;
+	mpf_detector_event_e det_event = MPF_DETECTOR_EVENT_NONE;
+	apr_size_t elapsed;
+	apr_size_t i;
+
+	frame.type = MEDIA_FRAME_TYPE_AUDIO;
+	frame.marker = MPF_MARKER_NONE;
+	frame.codec_frame.buffer = samples;
+	frame.codec_frame.size = sizeof(samples);
+	for(elapsed=0; elapsed<duration; elapsed+=CODEC_FRAME_TIME_BASE) {
+		mpf_detector_event_e cur_event;
+		for(i=0; i<DETECTOR_TEST_FRAME_SAMPLES; i++) {
+			samples[i] = (apr_int16_t)((rand() % (2 * amplitude + 1)) - amplitude);
+		}
+		cur_event = mpf_activity_detector_process(detector,&frame);
+		if(cur_event != MPF_DETECTOR_EVENT_NONE && det_event == MPF_DETECTOR_EVENT_NONE) {
+			det_event = cur_event;
+		}
+	}
+	return det_event;
+}
+
+/** Speech over noise louder than the fixed threshold must be told apart in the adaptive mode */
+static apt_bool_t detector_test_adaptive_run(apr_pool_t *pool)
+{
+	mpf_detector_event_e det_event;
+	mpf_activity_detector_t *detector = mpf_activity_detector_create(pool);
+	mpf_activity_detector_noinput_timeout_set(detector,10000);
+	mpf_activity_detector_mode_set(detector,MPF_DETECTOR_MODE_ADAPTIVE);
+
+	det_event = detector_test_feed(detector,3000,1000);
+	if(det_event != MPF_DETECTOR_EVENT_NONE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Event [%d] on Noise",det_event);
+		return FALSE;
+	}
+	det_event = detector_test_feed(detector,1000,8000);
+	if(det_event != MPF_DETECTOR_EVENT_ACTIVITY) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Activity Detected on Speech [%d]",det_event);
+		return FALSE;
+	}
+	if(mpf_activity_detector_speech_probability_get(detector) < 0.5f) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Low Speech Probability [%f]",
+			mpf_activity_detector_speech_probability_get(detector));
+		return FALSE;
+	}
+	det_event = detector_test_feed(detector,2000,1000);
+	if(det_event != MPF_DETECTOR_EVENT_INACTIVITY) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Inactivity Detected on Noise [%d]",det_event);
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Adaptive Mode Noise Floor [%"APR_SIZE_T_FMT"]",
+		mpf_activity_detector_noise_floor_get(detector));
+
+	/* a detector reused for another leg must not carry the settings and floor of the previous one */
+	mpf_activity_detector_init(detector);
+	if(mpf_activity_detector_noise_floor_get(detector) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Noise Floor Kept on Init [%"APR_SIZE_T_FMT"]",
+			mpf_activity_detector_noise_floor_get(detector));
+		return FALSE;
+	}
+	det_event = detector_test_feed(detector,1000,1000);
+	if(det_event != MPF_DETECTOR_EVENT_ACTIVITY) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Activity Detected in Fixed Mode on Init [%d]",det_event);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t detector_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_int16_t *samples = apr_palloc(suite->pool,sizeof(apr_int16_t) * DETECTOR_TEST_MAX_COUNT);
+	apr_size_t count;
+	apr_size_t i;
+
+	/* every count exercises the vector loops as well as the scalar tails */
+	for(count=0; count<=DETECTOR_TEST_MAX_COUNT; count++) {
+		/* extremes: -32768 has no positive counterpart in 16 bits */
+		for(i=0; i<count; i++) {
+			samples[i] = (i % 2) ? 32767 : -32768;
+		}
+		if(detector_test_compare(samples,count) == FALSE) {
+			return FALSE;
+		}
+
+		for(i=0; i<count; i++) {
+			samples[i] = (apr_int16_t)((rand() % 65536) - 32768);
+		}
+		if(detector_test_compare(samples,count) == FALSE) {
+			return FALSE;
+		}
+
+		/* low level noise around zero */
+		for(i=0; i<count; i++) {
+			samples[i] = (apr_int16_t)((rand() % 201) - 100);
+		}
+		if(detector_test_compare(samples,count) == FALSE) {
+			return FALSE;
+		}
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Features Match up to [%d] samples",DETECTOR_TEST_MAX_COUNT);
+
+	return detector_test_adaptive_run(suite->pool);
+}
+
+apt_test_suite_t* activity_detector_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"detector",NULL,detector_test_run);
+	return suite;
+}
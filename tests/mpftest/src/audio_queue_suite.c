@@ -0,0 +1,172 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_audio_queue.h"
+
+/** Capacity (msec) of the queue under test, 5 frames */
+#define AUDIO_QUEUE_TEST_CAPACITY 50
+/** Number of frames written ahead of the consumer */
+#define AUDIO_QUEUE_TEST_FRAMES   8
+
+static void audio_queue_test_drop(void *obj, void *elem)
+{
+	apr_size_t *dropped = obj;
+	(*dropped)++;
+}
+
+static apt_bool_t audio_queue_entry_write(mpf_audio_queue_t *queue, apt_bool_t audio, apr_size_t seq)
+{
+	apr_size_t *entry = mpf_audio_queue_write_begin(queue,audio);
+	if(!entry) {
+		return FALSE;
+	}
+	*entry = seq;
+	mpf_audio_queue_write_commit(queue);
+	return TRUE;
+}
+
+static apt_bool_t audio_queue_drop_oldest_test(apr_pool_t *pool)
+{
+	mpf_audio_queue_t *queue;
+	mpf_audio_queue_stats_t stats;
+	apr_size_t dropped = 0;
+	apr_size_t *entry;
+	apr_size_t i;
+
+	queue = mpf_audio_queue_create(AUDIO_QUEUE_TEST_CAPACITY,sizeof(apr_size_t),MPF_AUDIO_QUEUE_DROP_OLDEST,pool);
+	if(!queue) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Audio Queue");
+		return FALSE;
+	}
+	mpf_audio_queue_drop_handler_set(queue,audio_queue_test_drop,&dropped);
+
+	/* the first entry is a control one, the next are plain audio */
+	for(i=0; i<AUDIO_QUEUE_TEST_FRAMES; i++) {
+		if(audio_queue_entry_write(queue,i ? TRUE : FALSE,i) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Write Entry [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+	}
+	if(mpf_audio_queue_occupancy_get(queue) != AUDIO_QUEUE_TEST_FRAMES * 10) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Occupancy [%"APR_SIZE_T_FMT" ms]",mpf_audio_queue_occupancy_get(queue));
+		return FALSE;
+	}
+
+	/* control entries are never dropped */
+	entry = mpf_audio_queue_read_begin(queue);
+	if(!entry || *entry != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Control Entry Dropped");
+		return FALSE;
+	}
+	mpf_audio_queue_read_commit(queue);
+
+	/* the oldest audio beyond the capacity is dropped */
+	entry = mpf_audio_queue_read_begin(queue);
+	if(!entry || *entry != AUDIO_QUEUE_TEST_FRAMES - 5 || dropped != 2) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry [%"APR_SIZE_T_FMT"] dropped [%"APR_SIZE_T_FMT"]",
+			entry ? *entry : 0,dropped);
+		return FALSE;
+	}
+	mpf_audio_queue_read_commit(queue);
+	for(i=AUDIO_QUEUE_TEST_FRAMES - 4; i<AUDIO_QUEUE_TEST_FRAMES; i++) {
+		entry = mpf_audio_queue_read_begin(queue);
+		if(!entry || *entry != i) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		mpf_audio_queue_read_commit(queue);
+	}
+	if(mpf_audio_queue_read_begin(queue) != NULL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry past End");
+		return FALSE;
+	}
+
+	mpf_audio_queue_stats_get(queue,&stats);
+	if(stats.written != AUDIO_QUEUE_TEST_FRAMES || stats.dropped != 2 || stats.rejected != 0 ||
+		stats.high_water != AUDIO_QUEUE_TEST_FRAMES) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Stats written [%"APR_SIZE_T_FMT"] dropped [%"APR_SIZE_T_FMT"] rejected [%"APR_SIZE_T_FMT"] high-water [%"APR_SIZE_T_FMT"]",
+			stats.written,stats.dropped,stats.rejected,stats.high_water);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t audio_queue_signal_backlog_test(apr_pool_t *pool)
+{
+	mpf_audio_queue_t *queue;
+	mpf_audio_queue_stats_t stats;
+	apr_size_t *entry;
+	apr_size_t i;
+
+	queue = mpf_audio_queue_create(AUDIO_QUEUE_TEST_CAPACITY,sizeof(apr_size_t),MPF_AUDIO_QUEUE_SIGNAL_BACKLOG,pool);
+	if(!queue) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Audio Queue");
+		return FALSE;
+	}
+	for(i=0; i<AUDIO_QUEUE_TEST_CAPACITY / 10; i++) {
+		if(audio_queue_entry_write(queue,TRUE,i) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Write Entry [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+	}
+	/* audio beyond the capacity is rejected, control entries still fit */
+	if(audio_queue_entry_write(queue,TRUE,i) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Audio beyond Capacity");
+		return FALSE;
+	}
+	if(audio_queue_entry_write(queue,FALSE,i) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Control Entry Rejected");
+		return FALSE;
+	}
+	for(i=0; i<=AUDIO_QUEUE_TEST_CAPACITY / 10; i++) {
+		entry = mpf_audio_queue_read_begin(queue);
+		if(!entry || *entry != i) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Entry [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		mpf_audio_queue_read_commit(queue);
+	}
+
+	mpf_audio_queue_stats_get(queue,&stats);
+	if(stats.rejected != 1 || stats.dropped != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Stats rejected [%"APR_SIZE_T_FMT"] dropped [%"APR_SIZE_T_FMT"]",
+			stats.rejected,stats.dropped);
+		return FALSE;
+	}
+	mpf_audio_queue_stats_reset(queue);
+	mpf_audio_queue_stats_get(queue,&stats);
+	if(stats.written || stats.rejected || stats.high_water) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Stats Not Reset");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t audio_queue_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	if(audio_queue_drop_oldest_test(suite->pool) == FALSE) {
+		return FALSE;
+	}
+	return audio_queue_signal_backlog_test(suite->pool);
+}
+
+apt_test_suite_t* audio_queue_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"audio-queue",NULL,audio_queue_test_run);
+	return suite;
+}
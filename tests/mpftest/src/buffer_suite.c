@@ -0,0 +1,119 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_buffer.h"
+
+/** Size of a chunk written */
+#define BUFFER_TEST_CHUNK_SIZE 100
+/** Number of chunks written per cycle */
+#define BUFFER_TEST_CHUNK_COUNT 3
+/** Size of a frame read */
+#define BUFFER_TEST_FRAME_SIZE 160
+/** Number of write/read cycles, so that chunks are recycled */
+#define BUFFER_TEST_CYCLE_COUNT 100
+
+/** Read all the frames and check their content against the expected one (padded with silence) */
+static apt_bool_t buffer_test_read(mpf_buffer_t *buffer, const unsigned char *expected, apr_size_t size)
+{
+	unsigned char data[BUFFER_TEST_FRAME_SIZE];
+	mpf_frame_t frame;
+	apr_size_t offset = 0;
+	apr_size_t i;
+
+	while(mpf_buffer_get_size(buffer)) {
+		frame.type = MEDIA_FRAME_TYPE_NONE;
+		frame.codec_frame.buffer = data;
+		frame.codec_frame.size = sizeof(data);
+		mpf_buffer_frame_read(buffer,&frame);
+		if(!(frame.type & MEDIA_FRAME_TYPE_AUDIO)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Audio in Frame at [%"APR_SIZE_T_FMT"]",offset);
+			return FALSE;
+		}
+		for(i=0; i<sizeof(data); i++, offset++) {
+			unsigned char value = offset < size ? expected[offset] : 0;
+			if(data[i] != value) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Byte at [%"APR_SIZE_T_FMT"]",offset);
+				return FALSE;
+			}
+		}
+	}
+	if(offset < size) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Missing Audio [%"APR_SIZE_T_FMT"/%"APR_SIZE_T_FMT"]",offset,size);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t buffer_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	unsigned char chunk[BUFFER_TEST_CHUNK_SIZE];
+	unsigned char expected[BUFFER_TEST_CHUNK_SIZE * BUFFER_TEST_CHUNK_COUNT];
+	mpf_buffer_t *buffer;
+	apr_size_t cycle;
+	apr_size_t i;
+	apr_size_t j;
+
+	buffer = mpf_buffer_create(suite->pool);
+
+	/* chunks read are recycled by the writes of the next cycle */
+	for(cycle=0; cycle<BUFFER_TEST_CYCLE_COUNT; cycle++) {
+		for(i=0; i<BUFFER_TEST_CHUNK_COUNT; i++) {
+			for(j=0; j<BUFFER_TEST_CHUNK_SIZE; j++) {
+				chunk[j] = (unsigned char)(cycle + i * BUFFER_TEST_CHUNK_SIZE + j + 1);
+			}
+			memcpy(expected + i * BUFFER_TEST_CHUNK_SIZE,chunk,BUFFER_TEST_CHUNK_SIZE);
+			/* the data written is copied */
+			mpf_buffer_audio_write(buffer,chunk,BUFFER_TEST_CHUNK_SIZE);
+		}
+		if(mpf_buffer_get_size(buffer) != sizeof(expected)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Size [%"APR_SIZE_T_FMT"]",mpf_buffer_get_size(buffer));
+			return FALSE;
+		}
+		if(buffer_test_read(buffer,expected,sizeof(expected)) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Read Cycle [%"APR_SIZE_T_FMT"]",cycle);
+			return FALSE;
+		}
+	}
+
+	/* restart recycles chunks pending and partially read */
+	mpf_buffer_audio_write(buffer,chunk,BUFFER_TEST_CHUNK_SIZE);
+	mpf_buffer_audio_write(buffer,chunk,BUFFER_TEST_CHUNK_SIZE);
+	mpf_buffer_restart(buffer);
+	if(mpf_buffer_get_size(buffer) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Non-empty Buffer after Restart");
+		return FALSE;
+	}
+
+	/* references are read as written */
+	mpf_buffer_audio_ref_write(buffer,expected,sizeof(expected));
+	if(buffer_test_read(buffer,expected,sizeof(expected)) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Read Reference");
+		return FALSE;
+	}
+
+	mpf_buffer_destroy(buffer);
+	return TRUE;
+}
+
+apt_test_suite_t* buffer_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"buffer",NULL,buffer_test_run);
+	return suite;
+}
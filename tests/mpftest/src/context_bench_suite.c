@@ -0,0 +1,149 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_context.h"
+#include "mpf_termination.h"
+#include "mpf_stream.h"
+#include "mpf_engine.h"
+#include "mpf_codec_manager.h"
+
+/** Number of ticks to measure per run */
+#define CONTEXT_BENCH_TICKS 100
+
+/** Source of PCMU silence */
+static apt_bool_t context_bench_source_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	memset(frame->codec_frame.buffer,0xFF,frame->codec_frame.size);
+	frame->type = MEDIA_FRAME_TYPE_AUDIO;
+	return TRUE;
+}
+
+static apt_bool_t context_bench_sink_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame)
+{
+	return TRUE;
+}
+
+static const mpf_audio_stream_vtable_t source_vtable = {
+	NULL, NULL, NULL, context_bench_source_read, NULL, NULL, NULL, NULL
+};
+
+static const mpf_audio_stream_vtable_t sink_vtable = {
+	NULL, NULL, NULL, NULL, NULL, NULL, context_bench_sink_write, NULL
+};
+
+/** Create termination of a simulated session, the source one is PCMU, the sink one is L16 */
+static mpf_termination_t* context_bench_termination_create(apt_bool_t source, const mpf_codec_manager_t *codec_manager, apr_pool_t *pool)
+{
+	mpf_audio_stream_t *stream;
+	mpf_termination_t *termination;
+	mpf_codec_descriptor_t *descriptor;
+	if(source == TRUE) {
+		stream = mpf_audio_stream_create(NULL,&source_vtable,mpf_stream_capabilities_create(STREAM_DIRECTION_RECEIVE,pool),pool);
+		descriptor = mpf_codec_descriptor_create(pool);
+		apt_string_set(&descriptor->name,"PCMU");
+		descriptor->sampling_rate = 8000;
+		descriptor->channel_count = 1;
+		stream->rx_descriptor = descriptor;
+	}
+	else {
+		stream = mpf_audio_stream_create(NULL,&sink_vtable,mpf_stream_capabilities_create(STREAM_DIRECTION_SEND,pool),pool);
+		stream->tx_descriptor = mpf_codec_lpcm_descriptor_create(8000,1,pool);
+	}
+	termination = mpf_termination_base_create(NULL,NULL,NULL,stream,NULL,pool);
+	termination->codec_manager = codec_manager;
+	return termination;
+}
+
+/** Measure ticks per second of contexts bridging a PCMU source to an L16 sink, each context in a pool of its own */
+static apt_bool_t context_bench_layout_run(apr_size_t count, apt_bool_t arena, const mpf_codec_manager_t *codec_manager, apr_pool_t *pool)
+{
+	mpf_context_factory_t *factory;
+	mpf_context_t **contexts;
+	apr_pool_t **pools;
+	mpf_termination_t *source;
+	mpf_termination_t *sink;
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_size_t i;
+
+	factory = mpf_context_factory_create(pool);
+	mpf_context_factory_arena_enable(factory,arena);
+	contexts = apr_palloc(pool,sizeof(mpf_context_t*) * count);
+	pools = apr_palloc(pool,sizeof(apr_pool_t*) * count);
+	for(i=0; i<count; i++) {
+		apr_pool_create(&pools[i],pool);
+		contexts[i] = mpf_context_create(factory,NULL,NULL,2,pools[i]);
+		source = context_bench_termination_create(TRUE,codec_manager,pools[i]);
+		sink = context_bench_termination_create(FALSE,codec_manager,pools[i]);
+		if(mpf_context_termination_add(contexts[i],source) == FALSE ||
+			mpf_context_termination_add(contexts[i],sink) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add Termination");
+			return FALSE;
+		}
+		mpf_context_association_add(contexts[i],source,sink);
+		mpf_context_topology_apply(contexts[i]);
+	}
+
+	start = apr_time_now();
+	for(i=0; i<CONTEXT_BENCH_TICKS; i++) {
+		mpf_context_factory_process(factory);
+	}
+	elapsed = apr_time_now() - start;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Contexts [%"APR_SIZE_T_FMT"] Layout [%s] Ticks per Second [%.0f]",
+		count,
+		arena == TRUE ? "arena" : "pools",
+		elapsed ? CONTEXT_BENCH_TICKS * (double)APR_USEC_PER_SEC / elapsed : 0);
+
+	for(i=0; i<count; i++) {
+		mpf_context_topology_destroy(contexts[i]);
+		mpf_context_destroy(contexts[i]);
+		apr_pool_destroy(pools[i]);
+	}
+	mpf_context_factory_destroy(factory);
+	return TRUE;
+}
+
+static apt_bool_t context_bench_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	static const apr_size_t counts[] = {1000, 5000, 10000};
+	mpf_codec_manager_t *codec_manager = mpf_engine_codec_manager_create(suite->pool);
+	apt_bool_t status = TRUE;
+	apr_pool_t *pool;
+	apr_size_t i;
+
+	/* media paths of the contexts are traced at the info level */
+	apt_log_priority_set(APT_PRIO_NOTICE);
+	for(i=0; i<sizeof(counts)/sizeof(counts[0]) && status == TRUE; i++) {
+		apr_pool_create(&pool,suite->pool);
+		status = context_bench_layout_run(counts[i],FALSE,codec_manager,pool);
+		if(status == TRUE) {
+			status = context_bench_layout_run(counts[i],TRUE,codec_manager,pool);
+		}
+		apr_pool_destroy(pool);
+	}
+	apt_log_priority_set(APT_PRIO_INFO);
+	return status;
+}
+
+apt_test_suite_t* context_bench_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"context-bench",NULL,context_bench_run);
+	return suite;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <math.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_dtmf_detector.h"
+
+#ifndef M_PI
+#	define M_PI 3.141592653589793238462643
+#endif
+
+#define DTMF_TEST_SAMPLING_RATE 8000
+#define DTMF_TEST_FRAME_SAMPLES (DTMF_TEST_SAMPLING_RATE / 1000 * CODEC_FRAME_TIME_BASE)
+/** Duration (msec) of a tone and of the pause after it */
+#define DTMF_TEST_TONE_TIME     100
+/** Peak amplitude of either frequency of a tone */
+#define DTMF_TEST_AMPLITUDE     8000
+
+/** Digits to send, the repeated one must be detected twice thanks to the pause */
+static const char dtmf_test_digits[] = "1559#D";
+
+static apt_bool_t dtmf_test_freqs_get(char digit, double *row, double *col)
+{
+	static const char digits[] = "123A456B789C*0#D";
+	static const double rows[] = {697, 770, 852, 941};
+	static const double cols[] = {1209, 1336, 1477, 1633};
+	const char *pos = strchr(digits,digit);
+	if(!pos || !digit) {
+		return FALSE;
+	}
+	*row = rows[(pos - digits) / 4];
+	*col = cols[(pos - digits) % 4];
+	return TRUE;
+}
+
+/** Feed a frame (tone or silence) to the activity detector if any, then to the DTMF detector */
+static void dtmf_test_frame_feed(mpf_dtmf_detector_t *detector, mpf_activity_detector_t *activity_detector, mpf_frame_t *frame)
+{
+	if(activity_detector) {
+		mpf_activity_detector_process(activity_detector,frame);
+	}
+	mpf_dtmf_detector_get_frame(detector,frame);
+}
+
+static apt_bool_t dtmf_test_digits_run(const mpf_audio_stream_t *stream, mpf_activity_detector_t *activity_detector, apr_pool_t *pool)
+{
+	apr_int16_t samples[DTMF_TEST_FRAME_SAMPLES];
+	mpf_frame_t frame;
+	mpf_dtmf_detector_t *detector;
+	char detected[sizeof(dtmf_test_digits)];
+	apr_size_t count = 0;
+	apr_size_t t = 0;
+	apr_size_t elapsed;
+	apr_size_t i;
+	double row = 0, col = 0;
+	const char *digit;
+	char ch;
+
+	detector = mpf_dtmf_detector_create_ex(stream,MPF_DTMF_DETECTOR_INBAND,pool);
+	if(!detector) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create DTMF Detector");
+		return FALSE;
+	}
+	mpf_dtmf_detector_activity_detector_set(detector,activity_detector);
+
+	frame.type = MEDIA_FRAME_TYPE_AUDIO;
+	frame.marker = MPF_MARKER_NONE;
+	frame.codec_frame.buffer = samples;
+	frame.codec_frame.size = sizeof(samples);
+	for(digit = dtmf_test_digits; *digit; digit++) {
+		dtmf_test_freqs_get(*digit,&row,&col);
+		for(elapsed=0; elapsed<DTMF_TEST_TONE_TIME; elapsed+=CODEC_FRAME_TIME_BASE) {
+			for(i=0; i<DTMF_TEST_FRAME_SAMPLES; i++, t++) {
+				samples[i] = (apr_int16_t)(DTMF_TEST_AMPLITUDE *
+					(sin(2 * M_PI * row * t / DTMF_TEST_SAMPLING_RATE) +
+					 sin(2 * M_PI * col * t / DTMF_TEST_SAMPLING_RATE)));
+			}
+			dtmf_test_frame_feed(detector,activity_detector,&frame);
+		}
+		memset(samples,0,sizeof(samples));
+		for(elapsed=0; elapsed<DTMF_TEST_TONE_TIME; elapsed+=CODEC_FRAME_TIME_BASE) {
+			dtmf_test_frame_feed(detector,activity_detector,&frame);
+		}
+	}
+
+	while((ch = mpf_dtmf_detector_digit_get(detector)) != 0 && count < sizeof(detected) - 1) {
+		detected[count++] = ch;
+	}
+	detected[count] = '\0';
+	mpf_dtmf_detector_destroy(detector);
+
+	if(strcmp(detected,dtmf_test_digits) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected DTMF Digits [%s] Sent [%s] Activity Detector [%s]",
+			detected,dtmf_test_digits,activity_detector ? "on" : "off");
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Detected DTMF Digits [%s] Activity Detector [%s]",
+		detected,activity_detector ? "on" : "off");
+	return TRUE;
+}
+
+static apt_bool_t dtmf_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mpf_codec_descriptor_t descriptor;
+	mpf_audio_stream_t stream;
+
+	memset(&descriptor,0,sizeof(descriptor));
+	descriptor.sampling_rate = DTMF_TEST_SAMPLING_RATE;
+	descriptor.channel_count = 1;
+	memset(&stream,0,sizeof(stream));
+	stream.tx_descriptor = &descriptor;
+
+	if(dtmf_test_digits_run(&stream,NULL,suite->pool) == FALSE) {
+		return FALSE;
+	}
+	/* tones are loud enough to be reported as activity, pauses are skipped */
+	return dtmf_test_digits_run(&stream,mpf_activity_detector_create(suite->pool),suite->pool);
+}
+
+apt_test_suite_t* dtmf_detector_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"dtmf-detector",NULL,dtmf_test_run);
+	return suite;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_frame_pool.h"
+
+/** Number of buffers of the pool under test */
+#define FRAME_POOL_TEST_CAPACITY 4
+
+static apt_bool_t frame_pool_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mpf_frame_pool_t *frame_pool;
+	mpf_frame_ref_t *refs[FRAME_POOL_TEST_CAPACITY];
+	mpf_frame_ref_t *ref;
+	apr_size_t i;
+
+	frame_pool = mpf_frame_pool_create(MPF_FRAME_POOL_BUFFER_SIZE,FRAME_POOL_TEST_CAPACITY,suite->pool);
+	if(!frame_pool) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Frame Pool");
+		return FALSE;
+	}
+
+	/* buffers are allocated on demand up to the capacity */
+	for(i=0; i<FRAME_POOL_TEST_CAPACITY; i++) {
+		refs[i] = mpf_frame_pool_acquire(frame_pool);
+		if(!refs[i]) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Acquire Buffer [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+		memset(mpf_frame_ref_data_get(refs[i]),(int)i,MPF_FRAME_POOL_BUFFER_SIZE);
+	}
+	if(mpf_frame_pool_acquire(frame_pool) != NULL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Buffer beyond Capacity");
+		return FALSE;
+	}
+
+	/* a retained buffer is not returned to the pool till the last release */
+	mpf_frame_ref_retain(refs[0]);
+	mpf_frame_ref_release(refs[0]);
+	if(mpf_frame_pool_acquire(frame_pool) != NULL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Buffer Returned while Retained");
+		return FALSE;
+	}
+	mpf_frame_ref_release(refs[0]);
+	ref = mpf_frame_pool_acquire(frame_pool);
+	if(ref != refs[0]) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Released Buffer Not Reused");
+		return FALSE;
+	}
+
+	mpf_frame_ref_release(ref);
+	for(i=1; i<FRAME_POOL_TEST_CAPACITY; i++) {
+		mpf_frame_ref_release(refs[i]);
+	}
+	for(i=0; i<FRAME_POOL_TEST_CAPACITY; i++) {
+		if(!mpf_frame_pool_acquire(frame_pool)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Reacquire Buffer [%"APR_SIZE_T_FMT"]",i);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* frame_pool_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"frame-pool",NULL,frame_pool_test_run);
+	return suite;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "mpf_engine.h"
+#include "mpf_codec_manager.h"
+#include "apt_log.h"
+
+/** Samples per frame (20 msec at 8 kHz) */
+#define G711_TEST_FRAME_SAMPLES 160
+/** Frames to run the benchmark for */
+#define G711_TEST_FRAME_COUNT   100000
+
+#define G711_TEST_ULAW_BIAS     0x84
+
+/** Reference per-sample calculation (as in the G.711 spec) */
+static int g711_test_segment_get(int value)
+{
+	int seg = 0;
+	while(value > 0xFF) {
+		value >>= 1;
+		seg++;
+	}
+	return seg;
+}
+
+static apr_byte_t g711_test_ulaw_encode(int linear)
+{
+	int mask;
+	int seg;
+	if(linear < 0) {
+		linear = G711_TEST_ULAW_BIAS - linear - 1;
+		mask = 0x7F;
+	}
+	else {
+		linear = G711_TEST_ULAW_BIAS + linear;
+		mask = 0xFF;
+	}
+	seg = g711_test_segment_get(linear);
+	if(seg >= 8) {
+		return (apr_byte_t)(0x7F ^ mask);
+	}
+	return (apr_byte_t)(((seg << 4) | ((linear >> (seg + 3)) & 0x0F)) ^ mask);
+}
+
+static apr_int16_t g711_test_ulaw_decode(apr_byte_t ulaw)
+{
+	int t;
+	ulaw = ~ulaw;
+	t = (((ulaw & 0x0F) << 3) + G711_TEST_ULAW_BIAS) << ((ulaw & 0x70) >> 4);
+	return (apr_int16_t)((ulaw & 0x80) ? (G711_TEST_ULAW_BIAS - t) : (t - G711_TEST_ULAW_BIAS));
+}
+
+static apr_byte_t g711_test_alaw_encode(int linear)
+{
+	int mask;
+	int seg;
+	if(linear >= 0) {
+		mask = 0x55 | 0x80;
+	}
+	else {
+		mask = 0x55;
+		linear = -linear - 1;
+	}
+	seg = g711_test_segment_get(linear);
+	if(seg >= 8) {
+		return (apr_byte_t)(0x7F ^ mask);
+	}
+	return (apr_byte_t)(((seg << 4) | ((linear >> (seg ? seg + 3 : 4)) & 0x0F)) ^ mask);
+}
+
+static apr_int16_t g711_test_alaw_decode(apr_byte_t alaw)
+{
+	int i;
+	int seg;
+	alaw ^= 0x55;
+	i = ((alaw & 0x0F) << 4);
+	seg = (((int)alaw & 0x70) >> 4);
+	if(seg) {
+		i = (i + 0x108) << (seg - 1);
+	}
+	else {
+		i += 8;
+	}
+	return (apr_int16_t)((alaw & 0x80) ? i : -i);
+}
+
+/** Reference encode and decode of a frame, sample by sample */
+static void g711_test_ulaw_frame_transcode(apr_int16_t *linear, apr_byte_t *encoded, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		encoded[i] = g711_test_ulaw_encode(linear[i]);
+	}
+	for(i=0; i<count; i++) {
+		linear[i] = g711_test_ulaw_decode(encoded[i]);
+	}
+}
+
+static void g711_test_alaw_frame_transcode(apr_int16_t *linear, apr_byte_t *encoded, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		encoded[i] = g711_test_alaw_encode(linear[i]);
+	}
+	for(i=0; i<count; i++) {
+		linear[i] = g711_test_alaw_decode(encoded[i]);
+	}
+}
+
+typedef apr_byte_t (*g711_test_encode_f)(int linear);
+typedef apr_int16_t (*g711_test_decode_f)(apr_byte_t code);
+typedef void (*g711_test_transcode_f)(apr_int16_t *linear, apr_byte_t *encoded, apr_size_t count);
+
+static mpf_codec_t* g711_test_codec_get(const char *name, apr_pool_t *pool)
+{
+	mpf_codec_manager_t *codec_manager = mpf_engine_codec_manager_create(pool);
+	mpf_codec_descriptor_t *descriptor = apr_palloc(pool,sizeof(mpf_codec_descriptor_t));
+	mpf_codec_descriptor_init(descriptor);
+	apt_string_set(&descriptor->name,name);
+	descriptor->sampling_rate = 8000;
+	descriptor->channel_count = 1;
+	return mpf_codec_manager_codec_get(codec_manager,descriptor,pool);
+}
+
+/** Compare the codec with the reference for every possible input and measure throughput */
+static apt_bool_t g711_test_codec_run(const char *name, g711_test_encode_f encode, g711_test_decode_f decode, g711_test_transcode_f transcode, apr_pool_t *pool)
+{
+	mpf_codec_t *codec;
+	mpf_codec_frame_t linear_frame;
+	mpf_codec_frame_t encoded_frame;
+	apr_int16_t *linear;
+	apr_byte_t *encoded;
+	apr_time_t start;
+	apr_time_t reference_time;
+	apr_time_t codec_time;
+	apr_size_t i;
+	apr_size_t k;
+	double samples;
+
+	codec = g711_test_codec_get(name,pool);
+	if(!codec) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec [%s]",name);
+		return FALSE;
+	}
+
+	linear = apr_palloc(pool,sizeof(apr_int16_t) * 65536);
+	encoded = apr_palloc(pool,65536);
+
+	/* all the samples */
+	for(i=0; i<65536; i++) {
+		linear[i] = (apr_int16_t)(apr_uint16_t)i;
+	}
+	linear_frame.buffer = linear;
+	linear_frame.size = sizeof(apr_int16_t) * 65536;
+	encoded_frame.buffer = encoded;
+	mpf_codec_encode(codec,&linear_frame,&encoded_frame);
+	for(i=0; i<65536; i++) {
+		if(encoded[i] != encode(linear[i])) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Encode Mismatch [%s] [%d]",name,linear[i]);
+			return FALSE;
+		}
+	}
+
+	/* all the codes */
+	for(i=0; i<256; i++) {
+		encoded[i] = (apr_byte_t)i;
+	}
+	encoded_frame.size = 256;
+	mpf_codec_decode(codec,&encoded_frame,&linear_frame);
+	for(i=0; i<256; i++) {
+		if(linear[i] != decode(encoded[i])) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Decode Mismatch [%s] [%"APR_SIZE_T_FMT"]",name,i);
+			return FALSE;
+		}
+	}
+
+	/* a frame of varying samples */
+	for(i=0; i<G711_TEST_FRAME_SAMPLES; i++) {
+		linear[i] = (apr_int16_t)((i * 2731) ^ (i << 9));
+	}
+	samples = (double)G711_TEST_FRAME_SAMPLES * G711_TEST_FRAME_COUNT;
+
+	start = apr_time_now();
+	for(k=0; k<G711_TEST_FRAME_COUNT; k++) {
+		transcode(linear,encoded,G711_TEST_FRAME_SAMPLES);
+	}
+	reference_time = apr_time_now() - start;
+
+	start = apr_time_now();
+	for(k=0; k<G711_TEST_FRAME_COUNT; k++) {
+		linear_frame.size = G711_TEST_FRAME_SAMPLES * sizeof(apr_int16_t);
+		mpf_codec_encode(codec,&linear_frame,&encoded_frame);
+		mpf_codec_decode(codec,&encoded_frame,&linear_frame);
+	}
+	codec_time = apr_time_now() - start;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Codec [%s] encode+decode per sample [%.1f] Msamples/s, by tables [%.1f] Msamples/s",
+		name,
+		reference_time ? samples / reference_time : 0,
+		codec_time ? samples / codec_time : 0);
+	return TRUE;
+}
+
+static apt_bool_t g711_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	if(g711_test_codec_run("PCMU",g711_test_ulaw_encode,g711_test_ulaw_decode,g711_test_ulaw_frame_transcode,suite->pool) == FALSE) {
+		return FALSE;
+	}
+	if(g711_test_codec_run("PCMA",g711_test_alaw_encode,g711_test_alaw_decode,g711_test_alaw_frame_transcode,suite->pool) == FALSE) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* g711_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"g711",NULL,g711_test_run);
+	return suite;
+}
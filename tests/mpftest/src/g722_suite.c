@@ -0,0 +1,132 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include "apt_test_suite.h"
+#include "mpf_engine.h"
+#include "mpf_codec.h"
+#include "mpf_codec_manager.h"
+#include "mpf_rtp_pt.h"
+#include "apt_log.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define G722_TEST_AMPLITUDE  8000
+/** Frames to skip while the predictors adapt */
+#define G722_TEST_WARMUP     10
+/** Frames to measure (a whole number of tone periods) */
+#define G722_TEST_FRAMES     50
+/** Required signal to noise ratio in dB */
+#define G722_TEST_MIN_SNR    20.0
+
+/** Encode and decode tone and check its amplitude and the level of distortion */
+static apt_bool_t g722_test_tone_run(mpf_codec_t *codec, apr_size_t frequency, apr_pool_t *pool)
+{
+	apr_int16_t linear_in[160];
+	apr_int16_t linear_out[160];
+	apr_byte_t encoded[80];
+	mpf_codec_frame_t frame_in;
+	mpf_codec_frame_t frame_encoded;
+	mpf_codec_frame_t frame_out;
+	apr_size_t n = 0;
+	apr_size_t i;
+	int k;
+	double re = 0, im = 0, energy = 0;
+	double amplitude;
+	double snr;
+
+	mpf_codec_open(codec);
+	frame_in.buffer = linear_in;
+	frame_encoded.buffer = encoded;
+	frame_out.buffer = linear_out;
+	for(k=0; k<G722_TEST_WARMUP + G722_TEST_FRAMES; k++) {
+		for(i=0; i<160; i++) {
+			linear_in[i] = (apr_int16_t)(G722_TEST_AMPLITUDE * sin(2 * M_PI * frequency * (k * 160 + i) / 16000));
+		}
+		frame_in.size = sizeof(linear_in);
+		mpf_codec_encode(codec,&frame_in,&frame_encoded);
+		mpf_codec_decode(codec,&frame_encoded,&frame_out);
+		if(frame_encoded.size != sizeof(encoded) || frame_out.size != sizeof(linear_out)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Frame Size [%"APR_SIZE_T_FMT"] [%"APR_SIZE_T_FMT"]",
+				frame_encoded.size,frame_out.size);
+			return FALSE;
+		}
+		if(k < G722_TEST_WARMUP) {
+			continue;
+		}
+		/* project on the tone, the codec delay only affects the phase */
+		for(i=0; i<160; i++, n++) {
+			double phase = 2 * M_PI * frequency * (k * 160 + i) / 16000;
+			re += linear_out[i] * cos(phase);
+			im += linear_out[i] * sin(phase);
+			energy += (double)linear_out[i] * linear_out[i];
+		}
+	}
+	mpf_codec_close(codec);
+
+	amplitude = 2 * sqrt(re * re + im * im) / n;
+	snr = 10 * log10((amplitude * amplitude / 2) / (energy / n - amplitude * amplitude / 2));
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"G722 Tone [%"APR_SIZE_T_FMT" Hz] amplitude [%.0f] SNR [%.1f dB]",
+		frequency,amplitude,snr);
+	if(fabs(amplitude - G722_TEST_AMPLITUDE) > G722_TEST_AMPLITUDE / 10 || snr < G722_TEST_MIN_SNR) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Distorted Tone [%"APR_SIZE_T_FMT" Hz]",frequency);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t g722_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mpf_codec_manager_t *codec_manager;
+	mpf_codec_descriptor_t *descriptor;
+	mpf_codec_t *codec;
+
+	codec_manager = mpf_engine_codec_manager_create(suite->pool);
+	descriptor = apr_palloc(suite->pool,sizeof(mpf_codec_descriptor_t));
+	mpf_codec_descriptor_init(descriptor);
+	descriptor->payload_type = RTP_PT_G722;
+	apt_string_set(&descriptor->name,"G722");
+	descriptor->sampling_rate = 8000;
+	descriptor->channel_count = 1;
+	codec = mpf_codec_manager_codec_get(codec_manager,descriptor,suite->pool);
+	if(!codec) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec");
+		return FALSE;
+	}
+
+	/* advertised at 8kHz, sampled at 16kHz */
+	if(mpf_codec_linear_sampling_rate_get(descriptor) != 16000 ||
+		mpf_codec_frame_size_calculate(descriptor,codec->attribs) != 80) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected G722 Rate");
+		return FALSE;
+	}
+
+	/* 400 and 1600 Hz fit the measured interval, 6400 Hz is in the upper sub-band */
+	if(g722_test_tone_run(codec,400,suite->pool) == FALSE ||
+		g722_test_tone_run(codec,1600,suite->pool) == FALSE ||
+		g722_test_tone_run(codec,6400,suite->pool) == FALSE) {
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* g722_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"g722",NULL,g722_test_run);
+	return suite;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "mpf_jitter_buffer.h"
+#include "mpf_engine.h"
+#include "mpf_codec_manager.h"
+#include "apt_log.h"
+
+/** Playout delay in frames */
+#define JB_TEST_DELAY_FRAMES  5
+/** Frames written (and then read) at once */
+#define JB_TEST_BATCH_FRAMES  10
+/** Frames to run the benchmark for */
+#define JB_TEST_FRAME_COUNT   1000000
+/** Frame to drop in order to check the gap */
+#define JB_TEST_LOST_FRAME    1234
+/** Duration of concealment in msec */
+#define JB_TEST_CONCEALMENT   30
+
+static apt_bool_t jb_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mpf_codec_manager_t *codec_manager;
+	mpf_codec_descriptor_t *descriptor;
+	mpf_codec_t *codec;
+	mpf_jb_config_t *config;
+	mpf_jitter_buffer_t *jb;
+	mpf_frame_t frame;
+	apr_byte_t packet[80];
+	apr_byte_t payload[80];
+	apr_time_t start;
+	apr_time_t write_time = 0;
+	apr_time_t read_time = 0;
+	apr_uint32_t n = 0;
+	apr_uint32_t read_n = 0;
+	apr_size_t i;
+
+	codec_manager = mpf_engine_codec_manager_create(suite->pool);
+	descriptor = apr_palloc(suite->pool,sizeof(mpf_codec_descriptor_t));
+	mpf_codec_descriptor_init(descriptor);
+	descriptor->payload_type = 0;
+	apt_string_set(&descriptor->name,"PCMU");
+	descriptor->sampling_rate = 8000;
+	descriptor->channel_count = 1;
+	codec = mpf_codec_manager_codec_get(codec_manager,descriptor,suite->pool);
+	if(!codec) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec");
+		return FALSE;
+	}
+
+	config = apr_palloc(suite->pool,sizeof(mpf_jb_config_t));
+	mpf_jb_config_init(config);
+	config->adaptive = 0;
+	config->time_skew_detection = 0;
+	config->min_playout_delay = JB_TEST_DELAY_FRAMES * CODEC_FRAME_TIME_BASE;
+	config->initial_playout_delay = JB_TEST_DELAY_FRAMES * CODEC_FRAME_TIME_BASE;
+	config->max_playout_delay = 200;
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,suite->pool);
+
+	frame.codec_frame.buffer = payload;
+	while(read_n < JB_TEST_FRAME_COUNT) {
+		start = apr_time_now();
+		for(i=0; i<JB_TEST_BATCH_FRAMES; i++, n++) {
+			if(n == JB_TEST_LOST_FRAME) {
+				continue;
+			}
+			memset(packet,(int)(n & 0xFF),sizeof(packet));
+			if(mpf_jitter_buffer_write(jb,packet,sizeof(packet),n * sizeof(packet),n == 0) != JB_OK) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Write Frame [%u]",n);
+				return FALSE;
+			}
+		}
+		write_time += apr_time_now() - start;
+
+		start = apr_time_now();
+		for(i=0; i<JB_TEST_BATCH_FRAMES; i++) {
+			mpf_jitter_buffer_read(jb,&frame);
+		}
+		read_time += apr_time_now() - start;
+
+		/* validate the last frame of the batch, it was written JB_TEST_DELAY_FRAMES before */
+		read_n += JB_TEST_BATCH_FRAMES;
+		if(read_n > JB_TEST_DELAY_FRAMES && read_n - 1 - JB_TEST_DELAY_FRAMES != JB_TEST_LOST_FRAME) {
+			apr_uint32_t expected = read_n - 1 - JB_TEST_DELAY_FRAMES;
+			if((frame.type & MEDIA_FRAME_TYPE_AUDIO) == 0 ||
+				frame.codec_frame.size != sizeof(payload) || payload[0] != (expected & 0xFF)) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Frame [%u]",expected);
+				return FALSE;
+			}
+		}
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Jitter Buffer [%u] frames write [%.1f ns/frame] read [%.1f ns/frame]",
+		read_n,
+		write_time * 1000.0 / read_n,
+		read_time * 1000.0 / read_n);
+
+	/* the dropped frame should be reported as a gap */
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,suite->pool);
+	for(n=0; n<JB_TEST_BATCH_FRAMES; n++) {
+		if(n == JB_TEST_BATCH_FRAMES / 2) {
+			continue;
+		}
+		memset(packet,(int)n,sizeof(packet));
+		mpf_jitter_buffer_write(jb,packet,sizeof(packet),n * sizeof(packet),n == 0);
+	}
+	for(n=0; n<JB_TEST_DELAY_FRAMES + JB_TEST_BATCH_FRAMES; n++) {
+		mpf_jitter_buffer_read(jb,&frame);
+		if(n < JB_TEST_DELAY_FRAMES) {
+			continue;
+		}
+		if(n - JB_TEST_DELAY_FRAMES == JB_TEST_BATCH_FRAMES / 2) {
+			if(frame.type != MEDIA_FRAME_TYPE_NONE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Gap [%u]",n);
+				return FALSE;
+			}
+		}
+		else if(frame.type != MEDIA_FRAME_TYPE_AUDIO || payload[0] != n - JB_TEST_DELAY_FRAMES) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Frame [%u]",n);
+			return FALSE;
+		}
+	}
+	/* the gap is not an underrun, running dry is, once however long it lasts */
+	if(mpf_jitter_buffer_underruns_get(jb) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Underrun before End of Stream");
+		return FALSE;
+	}
+	mpf_jitter_buffer_read(jb,&frame);
+	mpf_jitter_buffer_read(jb,&frame);
+	if(mpf_jitter_buffer_underruns_get(jb) != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Number of Underruns [%u]",
+			mpf_jitter_buffer_underruns_get(jb));
+		return FALSE;
+	}
+
+	/* with concealment the dropped frame should be replaced by the faded previous one */
+	config->concealment = JB_TEST_CONCEALMENT;
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,suite->pool);
+	for(n=0; n<JB_TEST_BATCH_FRAMES; n++) {
+		if(n == JB_TEST_BATCH_FRAMES / 2) {
+			continue;
+		}
+		/* loud enough to be still distinguishable from silence after fade-out */
+		memset(packet,0x10,sizeof(packet));
+		mpf_jitter_buffer_write(jb,packet,sizeof(packet),n * sizeof(packet),n == 0);
+	}
+	/* read beyond the end to get the underflow concealed too */
+	for(n=0; n<JB_TEST_DELAY_FRAMES + JB_TEST_BATCH_FRAMES + JB_TEST_CONCEALMENT / CODEC_FRAME_TIME_BASE + 1; n++) {
+		mpf_jitter_buffer_read(jb,&frame);
+		if(n - JB_TEST_DELAY_FRAMES == JB_TEST_BATCH_FRAMES / 2) {
+			if(frame.type != MEDIA_FRAME_TYPE_AUDIO || frame.codec_frame.size != sizeof(payload) ||
+				payload[0] != 0x10 || payload[sizeof(payload)-1] == 0x10) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Concealed Frame [%u]",n);
+				return FALSE;
+			}
+		}
+	}
+	if(frame.type != MEDIA_FRAME_TYPE_NONE ||
+		mpf_jitter_buffer_concealed_frames_get(jb) != JB_TEST_CONCEALMENT / CODEC_FRAME_TIME_BASE + 1) {
+		/* the gap plus the underflow at the end, limited by the max duration */
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Number of Concealed Frames [%u]",
+			mpf_jitter_buffer_concealed_frames_get(jb));
+		return FALSE;
+	}
+
+	/* read by reference, received audio is referenced in place, concealed one is generated to the buffer of the frame */
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,suite->pool);
+	for(n=0; n<JB_TEST_BATCH_FRAMES; n++) {
+		if(n == JB_TEST_BATCH_FRAMES / 2) {
+			continue;
+		}
+		memset(packet,0x10 + (int)n,sizeof(packet));
+		mpf_jitter_buffer_write(jb,packet,sizeof(packet),n * sizeof(packet),n == 0);
+	}
+	for(n=0; n<JB_TEST_DELAY_FRAMES + JB_TEST_BATCH_FRAMES; n++) {
+		frame.codec_frame.buffer = payload;
+		mpf_jitter_buffer_ref_read(jb,&frame);
+		if(n < JB_TEST_DELAY_FRAMES) {
+			continue;
+		}
+		if(n - JB_TEST_DELAY_FRAMES == JB_TEST_BATCH_FRAMES / 2) {
+			if(frame.type != MEDIA_FRAME_TYPE_AUDIO || frame.codec_frame.buffer != payload) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Concealed Frame in Place [%u]",n);
+				return FALSE;
+			}
+		}
+		else if(frame.type != MEDIA_FRAME_TYPE_AUDIO || frame.codec_frame.buffer == payload ||
+			frame.codec_frame.size != sizeof(packet) ||
+			((apr_byte_t*)frame.codec_frame.buffer)[0] != 0x10 + n - JB_TEST_DELAY_FRAMES) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Referenced Frame [%u]",n);
+			return FALSE;
+		}
+	}
+
+	/* audio received to a packet buffer is referenced in place, the packet is reused once all its frames are read */
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,suite->pool);
+	{
+		apr_byte_t *first = mpf_jitter_buffer_packet_alloc(jb,2 * sizeof(packet));
+		apr_byte_t *second;
+		memset(first,0x20,sizeof(packet));
+		memset(first + sizeof(packet),0x21,sizeof(packet));
+		mpf_jitter_buffer_packet_write(jb,first,first,2 * sizeof(packet),0,1);
+		mpf_jitter_buffer_packet_free(jb,first);
+		second = mpf_jitter_buffer_packet_alloc(jb,2 * sizeof(packet));
+		if(second == first) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Packet Reused while Buffered");
+			return FALSE;
+		}
+		mpf_jitter_buffer_packet_free(jb,second);
+
+		for(n=0; n<JB_TEST_DELAY_FRAMES + 2; n++) {
+			frame.codec_frame.buffer = payload;
+			mpf_jitter_buffer_ref_read(jb,&frame);
+		}
+		if(frame.type != MEDIA_FRAME_TYPE_AUDIO || frame.codec_frame.buffer != first + sizeof(packet)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Frame Referenced in Packet");
+			return FALSE;
+		}
+		/* the frame read by reference holds the packet till the next read */
+		if(mpf_jitter_buffer_packet_alloc(jb,2 * sizeof(packet)) == first) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Packet Reused while Referenced");
+			return FALSE;
+		}
+		frame.codec_frame.buffer = payload;
+		mpf_jitter_buffer_read(jb,&frame);
+		if(mpf_jitter_buffer_packet_alloc(jb,2 * sizeof(packet)) != first) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Packet Reused");
+			return FALSE;
+		}
+	}
+
+	/* low-latency mode, frames are held for one frame to be reordered only */
+	config->low_latency = 1;
+	config->adaptive = 1;
+	config->concealment = 0;
+	config->min_playout_delay = CODEC_FRAME_TIME_BASE;
+	config->initial_playout_delay = JB_TEST_DELAY_FRAMES * CODEC_FRAME_TIME_BASE;
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,suite->pool);
+	frame.codec_frame.buffer = payload;
+	/* reordered within the hold */
+	for(n=2; n>0; n--) {
+		memset(packet,(int)n-1,sizeof(packet));
+		if(mpf_jitter_buffer_write(jb,packet,sizeof(packet),(n-1) * sizeof(packet),n == 1) != JB_OK) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Write Reordered Frame [%u]",n-1);
+			return FALSE;
+		}
+	}
+	for(n=0; n<2; n++) {
+		mpf_jitter_buffer_read(jb,&frame);
+		if(frame.type != MEDIA_FRAME_TYPE_AUDIO || frame.marker != MPF_MARKER_NONE || payload[0] != n) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Reordered Frame [%u]",n);
+			return FALSE;
+		}
+	}
+	/* stall, late packets are played out at arrival rather than discarded, the first one marked as a gap */
+	for(n=0; n<JB_TEST_DELAY_FRAMES; n++) {
+		mpf_jitter_buffer_read(jb,&frame);
+	}
+	for(n=2; n<4; n++) {
+		memset(packet,(int)n,sizeof(packet));
+		if(mpf_jitter_buffer_write(jb,packet,sizeof(packet),n * sizeof(packet),0) != JB_OK) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Write Late Frame [%u]",n);
+			return FALSE;
+		}
+	}
+	mpf_jitter_buffer_read(jb,&frame);
+	for(n=2; n<4; n++) {
+		mpf_jitter_buffer_read(jb,&frame);
+		if(frame.type != MEDIA_FRAME_TYPE_AUDIO || payload[0] != n ||
+			frame.marker != (n == 2 ? MPF_MARKER_GAP : MPF_MARKER_NONE)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Late Frame [%u]",n);
+			return FALSE;
+		}
+	}
+	if(mpf_jitter_buffer_playout_delay_get(jb) != CODEC_FRAME_TIME_BASE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Playout Delay [%u ms]",
+			mpf_jitter_buffer_playout_delay_get(jb));
+		return FALSE;
+	}
+	/* reordered beyond the hold, the missing frame is reported as a gap and discarded once arrived */
+	memset(packet,5,sizeof(packet));
+	mpf_jitter_buffer_write(jb,packet,sizeof(packet),5 * sizeof(packet),0);
+	mpf_jitter_buffer_read(jb,&frame);
+	memset(packet,4,sizeof(packet));
+	if(mpf_jitter_buffer_write(jb,packet,sizeof(packet),4 * sizeof(packet),0) != JB_DISCARD_TOO_LATE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Discard of Late Frame [4]");
+		return FALSE;
+	}
+	mpf_jitter_buffer_read(jb,&frame);
+	if(frame.type != MEDIA_FRAME_TYPE_AUDIO || payload[0] != 5 || frame.marker != MPF_MARKER_GAP) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Expected Gap before Frame [5]");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* jitter_buffer_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"jb",NULL,jb_test_run);
+	return suite;
+}
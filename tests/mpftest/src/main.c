@@ -18,6 +18,21 @@
 #include "apt_log.h"
 
 apt_test_suite_t* mpf_suite_create(apr_pool_t *pool);
+apt_test_suite_t* activity_detector_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* resampler_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* jitter_buffer_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* g711_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* g722_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* frame_pool_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* audio_queue_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* rtp_port_pool_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* mixer_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* dtmf_detector_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* context_bench_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* scheduler_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* buffer_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* rtp_stat_test_suite_create(apr_pool_t *pool);
+apt_test_suite_t* micro_bench_test_suite_create(apr_pool_t *pool);
 
 int main(int argc, const char * const *argv)
 {
@@ -38,6 +53,51 @@ int main(int argc, const char * const *argv)
 	test_suite = mpf_suite_create(pool);
 	apt_test_framework_suite_add(test_framework,test_suite);
 
+	test_suite = activity_detector_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = resampler_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = jitter_buffer_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = g711_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = g722_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = frame_pool_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = audio_queue_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = rtp_port_pool_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = mixer_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = dtmf_detector_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = context_bench_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = scheduler_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = buffer_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = rtp_stat_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
+	test_suite = micro_bench_test_suite_create(pool);
+	apt_test_framework_suite_add(test_framework,test_suite);
+
 	/* run tests */
 	apt_test_framework_run(test_framework,argc,argv);
 
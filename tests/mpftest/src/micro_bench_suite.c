@@ -0,0 +1,714 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Microbenchmarks of the media hot path, one JSON line per component is printed
+ * to stdout, so that the results can be collected and compared across builds.
+ *
+ * mpftest micro-bench [frames=N] [loss=percent] [reorder=percent] [contexts=N]
+ *
+ * The RTP receiver is measured over loopback UDP, packets per second per core
+ * is reported along with the time per packet.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <apr_time.h>
+#include <apr_strings.h>
+#include <apr_network_io.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_engine.h"
+#include "mpf_codec_manager.h"
+#include "mpf_jitter_buffer.h"
+#include "mpf_activity_detector.h"
+#include "mpf_dtmf_detector.h"
+#include "mpf_mixer.h"
+#include "mpf_multiplier.h"
+#include "mpf_context.h"
+#include "mpf_termination.h"
+#include "mpf_stream.h"
+#include "mpf_rtp_stream.h"
+
+#ifndef M_PI
+#	define M_PI 3.141592653589793238462643
+#endif
+
+/** Default number of frames to process per component */
+#define MICRO_BENCH_FRAME_COUNT  100000
+/** Number of ticks of bridged contexts to measure */
+#define MICRO_BENCH_TICKS        100
+/** Sampling rate of the benchmarks */
+#define MICRO_BENCH_RATE         8000
+/** Samples per frame */
+#define MICRO_BENCH_SAMPLES      (MICRO_BENCH_RATE / 1000 * CODEC_FRAME_TIME_BASE)
+/** Frames written (and then read) at once to the jitter buffer */
+#define MICRO_BENCH_JB_BATCH     10
+/** Number of inputs of the mixer and outputs of the multiplier */
+#define MICRO_BENCH_LEGS         3
+/** RTP packets sent (and then read) at once */
+#define MICRO_BENCH_RTP_BATCH    16
+/** Size of RTP header */
+#define MICRO_BENCH_RTP_HEADER   12
+
+typedef struct micro_bench_t micro_bench_t;
+
+/** Parameters of the benchmark */
+struct micro_bench_t {
+	apr_pool_t                *pool;
+	const mpf_codec_manager_t *codec_manager;
+	apr_size_t                 frame_count;
+	/** Percentage of packets lost in the jitter buffer run */
+	apr_size_t                 loss;
+	/** Percentage of packets swapped with the next one */
+	apr_size_t                 reorder;
+	/** Number of bridged contexts, all of 1k/5k/10k if 0 */
+	apr_size_t                 context_count;
+	apr_uint32_t               seed;
+};
+
+static apr_uint32_t micro_bench_rand(micro_bench_t *bench)
+{
+	bench->seed = bench->seed * 1103515245 + 12345;
+	return (bench->seed >> 16) & 0x7FFF;
+}
+
+static apt_bool_t micro_bench_percent_check(micro_bench_t *bench, apr_size_t percent)
+{
+	return (micro_bench_rand(bench) % 100 < percent) ? TRUE : FALSE;
+}
+
+/** Fill a frame with noise, loud enough to be detected as activity */
+static void micro_bench_noise_fill(micro_bench_t *bench, apr_int16_t *samples, apr_size_t count)
+{
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		samples[i] = (apr_int16_t)((int)micro_bench_rand(bench) - 0x4000);
+	}
+}
+
+/** Print a result, params is a (possibly empty) list of extra JSON members */
+static void micro_bench_report(const char *component, const char *params, apr_size_t frames, apr_time_t elapsed)
+{
+	printf("{\"suite\":\"micro-bench\",\"component\":\"%s\"%s%s,\"frames\":%"APR_SIZE_T_FMT",\"ns_per_frame\":%.1f}\n",
+		component,
+		*params ? "," : "",
+		params,
+		frames,
+		frames ? elapsed * 1000.0 / frames : 0);
+	fflush(stdout);
+}
+
+static mpf_codec_t* micro_bench_codec_get(micro_bench_t *bench, const char *name)
+{
+	mpf_codec_descriptor_t *descriptor = mpf_codec_descriptor_create(bench->pool);
+	apt_string_set(&descriptor->name,name);
+	descriptor->sampling_rate = MICRO_BENCH_RATE;
+	descriptor->channel_count = 1;
+	return mpf_codec_manager_codec_get(bench->codec_manager,descriptor,bench->pool);
+}
+
+/** Write frames of PCMU to the jitter buffer, losing and reordering some of them, and read them back */
+static apt_bool_t micro_bench_jb_run(micro_bench_t *bench)
+{
+	mpf_codec_descriptor_t *descriptor;
+	mpf_codec_t *codec;
+	mpf_jb_config_t *config;
+	mpf_jitter_buffer_t *jb;
+	mpf_frame_t frame;
+	apr_byte_t packets[MICRO_BENCH_JB_BATCH][MICRO_BENCH_SAMPLES];
+	apr_uint32_t timestamps[MICRO_BENCH_JB_BATCH];
+	apt_bool_t lost[MICRO_BENCH_JB_BATCH];
+	apr_byte_t payload[MICRO_BENCH_SAMPLES];
+	apr_time_t start;
+	apr_time_t write_time = 0;
+	apr_time_t read_time = 0;
+	apr_size_t written = 0;
+	apr_size_t n = 0;
+	apr_size_t i;
+	char *params;
+
+	codec = micro_bench_codec_get(bench,"PCMU");
+	if(!codec) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec [PCMU]");
+		return FALSE;
+	}
+	descriptor = mpf_codec_descriptor_create(bench->pool);
+	apt_string_set(&descriptor->name,"PCMU");
+	descriptor->sampling_rate = MICRO_BENCH_RATE;
+	descriptor->channel_count = 1;
+
+	config = apr_palloc(bench->pool,sizeof(mpf_jb_config_t));
+	mpf_jb_config_init(config);
+	config->adaptive = 0;
+	config->time_skew_detection = 0;
+	config->min_playout_delay = MICRO_BENCH_JB_BATCH * CODEC_FRAME_TIME_BASE;
+	config->initial_playout_delay = MICRO_BENCH_JB_BATCH * CODEC_FRAME_TIME_BASE;
+	config->max_playout_delay = 4 * MICRO_BENCH_JB_BATCH * CODEC_FRAME_TIME_BASE;
+	jb = mpf_jitter_buffer_create(config,descriptor,codec,bench->pool);
+
+	frame.codec_frame.buffer = payload;
+	while(n < bench->frame_count) {
+		/* prepare the batch beforehand, only the calls of the jitter buffer are measured */
+		for(i=0; i<MICRO_BENCH_JB_BATCH; i++) {
+			memset(packets[i],(int)((n + i) & 0xFF),MICRO_BENCH_SAMPLES);
+			timestamps[i] = (apr_uint32_t)((n + i) * MICRO_BENCH_SAMPLES);
+			lost[i] = (n + i) && micro_bench_percent_check(bench,bench->loss);
+		}
+		for(i=0; i+1<MICRO_BENCH_JB_BATCH; i++) {
+			if(i && micro_bench_percent_check(bench,bench->reorder) == TRUE) {
+				apr_uint32_t timestamp = timestamps[i];
+				apt_bool_t is_lost = lost[i];
+				timestamps[i] = timestamps[i+1];
+				timestamps[i+1] = timestamp;
+				lost[i] = lost[i+1];
+				lost[i+1] = is_lost;
+				i++;
+			}
+		}
+
+		start = apr_time_now();
+		for(i=0; i<MICRO_BENCH_JB_BATCH; i++) {
+			if(lost[i] == FALSE) {
+				mpf_jitter_buffer_write(jb,packets[i],MICRO_BENCH_SAMPLES,timestamps[i],n + i == 0);
+				written++;
+			}
+		}
+		write_time += apr_time_now() - start;
+
+		start = apr_time_now();
+		for(i=0; i<MICRO_BENCH_JB_BATCH; i++) {
+			mpf_jitter_buffer_read(jb,&frame);
+		}
+		read_time += apr_time_now() - start;
+		n += MICRO_BENCH_JB_BATCH;
+	}
+
+	params = apr_psprintf(bench->pool,"\"loss\":%"APR_SIZE_T_FMT",\"reorder\":%"APR_SIZE_T_FMT,
+		bench->loss,bench->reorder);
+	micro_bench_report("jb-write",params,written,write_time);
+	micro_bench_report("jb-read",params,n,read_time);
+	mpf_jitter_buffer_destroy(jb);
+	return TRUE;
+}
+
+/** Encode and decode frames of noise */
+static apt_bool_t micro_bench_codec_run(micro_bench_t *bench, const char *name)
+{
+	mpf_codec_t *codec;
+	mpf_codec_frame_t linear_frame;
+	mpf_codec_frame_t encoded_frame;
+	apr_int16_t linear[MICRO_BENCH_SAMPLES];
+	apr_int16_t encoded[MICRO_BENCH_SAMPLES];
+	apr_time_t start;
+	apr_time_t encode_time;
+	apr_time_t decode_time;
+	apr_size_t n;
+	char *component;
+
+	codec = micro_bench_codec_get(bench,name);
+	if(!codec) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Get Codec [%s]",name);
+		return FALSE;
+	}
+	mpf_codec_open(codec);
+
+	micro_bench_noise_fill(bench,linear,MICRO_BENCH_SAMPLES);
+	linear_frame.buffer = linear;
+	encoded_frame.buffer = encoded;
+
+	start = apr_time_now();
+	for(n=0; n<bench->frame_count; n++) {
+		linear_frame.size = sizeof(linear);
+		mpf_codec_encode(codec,&linear_frame,&encoded_frame);
+	}
+	encode_time = apr_time_now() - start;
+
+	start = apr_time_now();
+	for(n=0; n<bench->frame_count; n++) {
+		linear_frame.size = sizeof(linear);
+		mpf_codec_decode(codec,&encoded_frame,&linear_frame);
+	}
+	decode_time = apr_time_now() - start;
+	mpf_codec_close(codec);
+
+	component = apr_psprintf(bench->pool,"%s-encode",name);
+	micro_bench_report(component,"",bench->frame_count,encode_time);
+	component = apr_psprintf(bench->pool,"%s-decode",name);
+	micro_bench_report(component,"",bench->frame_count,decode_time);
+	return TRUE;
+}
+
+/** Run the activity detector over noise interleaved with silence */
+static apt_bool_t micro_bench_activity_detector_run(micro_bench_t *bench)
+{
+	mpf_activity_detector_t *detector;
+	mpf_frame_t frames[2];
+	apr_int16_t noise[MICRO_BENCH_SAMPLES];
+	apr_int16_t silence[MICRO_BENCH_SAMPLES];
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_size_t n;
+
+	detector = mpf_activity_detector_create(bench->pool);
+	micro_bench_noise_fill(bench,noise,MICRO_BENCH_SAMPLES);
+	memset(silence,0,sizeof(silence));
+	frames[0].type = frames[1].type = MEDIA_FRAME_TYPE_AUDIO;
+	frames[0].marker = frames[1].marker = MPF_MARKER_NONE;
+	frames[0].codec_frame.buffer = noise;
+	frames[0].codec_frame.size = sizeof(noise);
+	frames[1].codec_frame.buffer = silence;
+	frames[1].codec_frame.size = sizeof(silence);
+
+	start = apr_time_now();
+	for(n=0; n<bench->frame_count; n++) {
+		/* a second of speech followed by a second of silence to pass through the states */
+		mpf_activity_detector_process(detector,&frames[(n / 100) & 1]);
+	}
+	elapsed = apr_time_now() - start;
+
+	micro_bench_report("activity-detector","",bench->frame_count,elapsed);
+	return TRUE;
+}
+
+/** Run the inband DTMF detector over a tone interleaved with silence */
+static apt_bool_t micro_bench_dtmf_detector_run(micro_bench_t *bench)
+{
+	mpf_codec_descriptor_t descriptor;
+	mpf_audio_stream_t stream;
+	mpf_dtmf_detector_t *detector;
+	mpf_frame_t frames[2];
+	apr_int16_t tone[MICRO_BENCH_SAMPLES];
+	apr_int16_t silence[MICRO_BENCH_SAMPLES];
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_size_t n;
+	apr_size_t i;
+
+	memset(&descriptor,0,sizeof(descriptor));
+	descriptor.sampling_rate = MICRO_BENCH_RATE;
+	descriptor.channel_count = 1;
+	memset(&stream,0,sizeof(stream));
+	stream.tx_descriptor = &descriptor;
+	detector = mpf_dtmf_detector_create_ex(&stream,MPF_DTMF_DETECTOR_INBAND,bench->pool);
+	if(!detector) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create DTMF Detector");
+		return FALSE;
+	}
+
+	/* digit 5, the frame is a whole number of periods of neither frequency, which is fine for the load */
+	for(i=0; i<MICRO_BENCH_SAMPLES; i++) {
+		tone[i] = (apr_int16_t)(8000 *
+			(sin(2 * M_PI * 770 * i / MICRO_BENCH_RATE) +
+			 sin(2 * M_PI * 1336 * i / MICRO_BENCH_RATE)));
+	}
+	memset(silence,0,sizeof(silence));
+	frames[0].type = frames[1].type = MEDIA_FRAME_TYPE_AUDIO;
+	frames[0].marker = frames[1].marker = MPF_MARKER_NONE;
+	frames[0].codec_frame.buffer = tone;
+	frames[0].codec_frame.size = sizeof(tone);
+	frames[1].codec_frame.buffer = silence;
+	frames[1].codec_frame.size = sizeof(silence);
+
+	start = apr_time_now();
+	for(n=0; n<bench->frame_count; n++) {
+		mpf_dtmf_detector_get_frame(detector,&frames[(n / 10) & 1]);
+		if(n % 1000 == 999) {
+			/* drain the detected digits not to measure the overflow */
+			while(mpf_dtmf_detector_digit_get(detector));
+		}
+	}
+	elapsed = apr_time_now() - start;
+	mpf_dtmf_detector_destroy(detector);
+
+	micro_bench_report("dtmf-detector","",bench->frame_count,elapsed);
+	return TRUE;
+}
+
+/** Source of L16 noise */
+/** Create RTP stream receiving PCMU from the loopback, the local RTP address is returned */
+static mpf_audio_stream_t* micro_bench_rtp_stream_create(micro_bench_t *bench, apr_sockaddr_t **sockaddr)
+{
+	mpf_rtp_config_t *config;
+	mpf_rtp_settings_t *settings;
+	mpf_rtp_stream_descriptor_t *descriptor;
+	mpf_rtp_media_descriptor_t *local;
+	mpf_rtp_media_descriptor_t *remote;
+	mpf_codec_descriptor_t *codec_descriptor;
+	mpf_termination_t *termination;
+	mpf_audio_stream_t *stream;
+	mpf_codec_t *codec;
+
+	config = mpf_rtp_config_alloc(bench->pool);
+	apt_string_set(&config->ip,"127.0.0.1");
+	config->rtp_port_min = 5000;
+	config->rtp_port_max = 6000;
+	config->rtp_port_cur = config->rtp_port_min;
+
+	settings = mpf_rtp_settings_alloc(bench->pool);
+	settings->ptime = CODEC_FRAME_TIME_BASE;
+	settings->jb_config.adaptive = 0;
+	settings->jb_config.time_skew_detection = 0;
+	settings->jb_config.min_playout_delay = MICRO_BENCH_RTP_BATCH * CODEC_FRAME_TIME_BASE;
+	settings->jb_config.initial_playout_delay = MICRO_BENCH_RTP_BATCH * CODEC_FRAME_TIME_BASE;
+	settings->jb_config.max_playout_delay = 4 * MICRO_BENCH_RTP_BATCH * CODEC_FRAME_TIME_BASE;
+	mpf_codec_manager_codec_list_load(bench->codec_manager,&settings->codec_list,"PCMU",bench->pool);
+
+	termination = mpf_termination_base_create(NULL,NULL,NULL,NULL,NULL,bench->pool);
+	termination->codec_manager = bench->codec_manager;
+	stream = mpf_rtp_stream_create(termination,config,settings,bench->pool);
+	if(!stream) {
+		return NULL;
+	}
+
+	local = mpf_rtp_media_descriptor_alloc(bench->pool);
+	local->state = MPF_MEDIA_ENABLED;
+	local->direction = STREAM_DIRECTION_RECEIVE;
+	apt_string_set(&local->ip,"127.0.0.1");
+	remote = mpf_rtp_media_descriptor_alloc(bench->pool);
+	remote->state = MPF_MEDIA_ENABLED;
+	remote->direction = STREAM_DIRECTION_SEND;
+	apt_string_set(&remote->ip,"127.0.0.1");
+	remote->port = config->rtp_port_max;
+	mpf_codec_list_init(&remote->codec_list,1,bench->pool);
+	codec_descriptor = mpf_codec_list_add(&remote->codec_list);
+	codec_descriptor->payload_type = 0;
+	apt_string_set(&codec_descriptor->name,"PCMU");
+	codec_descriptor->sampling_rate = MICRO_BENCH_RATE;
+	codec_descriptor->channel_count = 1;
+
+	descriptor = apr_palloc(bench->pool,sizeof(mpf_rtp_stream_descriptor_t));
+	mpf_rtp_stream_descriptor_init(descriptor);
+	descriptor->local = local;
+	descriptor->remote = remote;
+	descriptor->settings = settings;
+	if(mpf_rtp_stream_add(stream) == FALSE || mpf_rtp_stream_modify(stream,descriptor) == FALSE || !stream->rx_descriptor) {
+		return NULL;
+	}
+
+	codec = mpf_codec_manager_codec_get(bench->codec_manager,stream->rx_descriptor,bench->pool);
+	if(!codec || mpf_audio_stream_rx_open(stream,codec) == FALSE) {
+		return NULL;
+	}
+	if(apr_sockaddr_info_get(sockaddr,"127.0.0.1",APR_INET,local->port,0,bench->pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	return stream;
+}
+
+/** Send batches of RTP packets to the RTP stream and read them out, the receive path and the jitter buffer are measured */
+static apt_bool_t micro_bench_rtp_rx_run(micro_bench_t *bench)
+{
+	mpf_audio_stream_t *stream;
+	apr_sockaddr_t *sockaddr;
+	apr_socket_t *socket;
+	rtp_rx_stat_t rx_stat;
+	rtcp_xr_voip_stat_t voip_stat;
+	mpf_frame_t frame;
+	apr_byte_t packet[MICRO_BENCH_RTP_HEADER + MICRO_BENCH_SAMPLES];
+	apr_byte_t payload[MICRO_BENCH_SAMPLES];
+	apr_uint32_t value;
+	apr_size_t size;
+	apr_time_t start;
+	apr_time_t elapsed = 0;
+	apr_size_t n = 0;
+	apr_size_t i;
+	char *params;
+
+	stream = micro_bench_rtp_stream_create(bench,&sockaddr);
+	if(!stream) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create RTP Stream");
+		return FALSE;
+	}
+	if(apr_socket_create(&socket,APR_INET,SOCK_DGRAM,0,bench->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Socket");
+		mpf_audio_stream_rx_close(stream);
+		mpf_rtp_stream_remove(stream);
+		return FALSE;
+	}
+
+	memset(packet,0,sizeof(packet));
+	packet[0] = 0x80; /* version 2, PCMU */
+	value = htonl(0x12345678);
+	memcpy(packet + 8,&value,4);
+	frame.codec_frame.buffer = payload;
+	while(n < bench->frame_count) {
+		/* loopback delivers the packets to the socket by the time they're sent */
+		for(i=0; i<MICRO_BENCH_RTP_BATCH; i++) {
+			apr_uint16_t seq = htons((apr_uint16_t)(n + i));
+			value = htonl((apr_uint32_t)((n + i) * MICRO_BENCH_SAMPLES));
+			memcpy(packet + 2,&seq,2);
+			memcpy(packet + 4,&value,4);
+			memset(packet + MICRO_BENCH_RTP_HEADER,(int)((n + i) & 0xFF),MICRO_BENCH_SAMPLES);
+			size = sizeof(packet);
+			apr_socket_sendto(socket,sockaddr,0,(const char*)packet,&size);
+		}
+
+		start = apr_time_now();
+		for(i=0; i<MICRO_BENCH_RTP_BATCH; i++) {
+			mpf_audio_stream_frame_read(stream,&frame);
+		}
+		elapsed += apr_time_now() - start;
+		n += MICRO_BENCH_RTP_BATCH;
+	}
+
+	memset(&rx_stat,0,sizeof(rx_stat));
+	mpf_rtp_stream_rx_stat_get(stream,&rx_stat,&voip_stat);
+	params = apr_psprintf(bench->pool,"\"received\":%u,\"discarded\":%u,\"packets_per_sec\":%.0f",
+		rx_stat.received_packets,
+		rx_stat.discarded_packets,
+		elapsed ? rx_stat.received_packets * (double)APR_USEC_PER_SEC / elapsed : 0);
+	micro_bench_report("rtp-rx",params,n,elapsed);
+
+	apr_socket_close(socket);
+	mpf_audio_stream_rx_close(stream);
+	mpf_rtp_stream_remove(stream);
+	return TRUE;
+}
+
+static apt_bool_t micro_bench_source_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	apr_int16_t *samples = frame->codec_frame.buffer;
+	apr_size_t count = frame->codec_frame.size / sizeof(apr_int16_t);
+	apr_size_t i;
+	for(i=0; i<count; i++) {
+		samples[i] = (apr_int16_t)(i * 2731);
+	}
+	frame->type = MEDIA_FRAME_TYPE_AUDIO;
+	return TRUE;
+}
+
+static apt_bool_t micro_bench_sink_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame)
+{
+	return TRUE;
+}
+
+static const mpf_audio_stream_vtable_t source_vtable = {
+	NULL, NULL, NULL, micro_bench_source_read, NULL, NULL, NULL, NULL
+};
+
+static const mpf_audio_stream_vtable_t sink_vtable = {
+	NULL, NULL, NULL, NULL, NULL, NULL, micro_bench_sink_write, NULL
+};
+
+/** Create stream, the source one is of the given codec, the sink one is L16 */
+static mpf_audio_stream_t* micro_bench_stream_create(apt_bool_t source, const char *codec_name, apr_pool_t *pool)
+{
+	mpf_audio_stream_t *stream;
+	mpf_codec_descriptor_t *descriptor;
+	if(source == TRUE) {
+		stream = mpf_audio_stream_create(NULL,&source_vtable,mpf_stream_capabilities_create(STREAM_DIRECTION_RECEIVE,pool),pool);
+		descriptor = mpf_codec_descriptor_create(pool);
+		apt_string_set(&descriptor->name,codec_name);
+		descriptor->sampling_rate = MICRO_BENCH_RATE;
+		descriptor->channel_count = 1;
+		stream->rx_descriptor = descriptor;
+	}
+	else {
+		stream = mpf_audio_stream_create(NULL,&sink_vtable,mpf_stream_capabilities_create(STREAM_DIRECTION_SEND,pool),pool);
+		stream->tx_descriptor = mpf_codec_lpcm_descriptor_create(MICRO_BENCH_RATE,1,pool);
+	}
+	return stream;
+}
+
+/** Process the mixer of several L16 sources and the multiplier to several L16 sinks */
+static apt_bool_t micro_bench_bridges_run(micro_bench_t *bench)
+{
+	mpf_audio_stream_t *sources[MICRO_BENCH_LEGS];
+	mpf_audio_stream_t *sinks[MICRO_BENCH_LEGS];
+	mpf_object_t *mixer;
+	mpf_object_t *multiplier;
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_size_t n;
+	apr_size_t i;
+	char *params;
+
+	for(i=0; i<MICRO_BENCH_LEGS; i++) {
+		sources[i] = micro_bench_stream_create(TRUE,"L16",bench->pool);
+	}
+	mixer = mpf_mixer_create(sources,MICRO_BENCH_LEGS,micro_bench_stream_create(FALSE,NULL,bench->pool),
+		bench->codec_manager,"micro-bench-mixer",bench->pool);
+	for(i=0; i<MICRO_BENCH_LEGS; i++) {
+		sinks[i] = micro_bench_stream_create(FALSE,NULL,bench->pool);
+	}
+	multiplier = mpf_multiplier_create(micro_bench_stream_create(TRUE,"L16",bench->pool),sinks,MICRO_BENCH_LEGS,
+		bench->codec_manager,"micro-bench-multiplier",bench->pool);
+	if(!mixer || !multiplier) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Mixer or Multiplier");
+		return FALSE;
+	}
+
+	params = apr_psprintf(bench->pool,"\"legs\":%d",MICRO_BENCH_LEGS);
+
+	start = apr_time_now();
+	for(n=0; n<bench->frame_count; n++) {
+		mpf_object_process(mixer);
+	}
+	elapsed = apr_time_now() - start;
+	micro_bench_report("mixer",params,bench->frame_count,elapsed);
+
+	start = apr_time_now();
+	for(n=0; n<bench->frame_count; n++) {
+		mpf_object_process(multiplier);
+	}
+	elapsed = apr_time_now() - start;
+	micro_bench_report("multiplier",params,bench->frame_count,elapsed);
+
+	mpf_object_destroy(mixer);
+	mpf_object_destroy(multiplier);
+	return TRUE;
+}
+
+static mpf_termination_t* micro_bench_termination_create(apt_bool_t source, const mpf_codec_manager_t *codec_manager, apr_pool_t *pool)
+{
+	mpf_termination_t *termination = mpf_termination_base_create(NULL,NULL,NULL,
+		micro_bench_stream_create(source,"PCMU",pool),NULL,pool);
+	termination->codec_manager = codec_manager;
+	return termination;
+}
+
+/** Tick contexts bridging a PCMU source to an L16 sink, a frame is a tick of a context */
+static apt_bool_t micro_bench_contexts_run(micro_bench_t *bench, apr_size_t count)
+{
+	mpf_context_factory_t *factory;
+	mpf_context_t **contexts;
+	mpf_termination_t *source;
+	mpf_termination_t *sink;
+	apr_pool_t *pool;
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_size_t i;
+	apt_bool_t status = TRUE;
+	char *params;
+
+	apr_pool_create(&pool,bench->pool);
+	factory = mpf_context_factory_create(pool);
+	contexts = apr_palloc(pool,sizeof(mpf_context_t*) * count);
+	for(i=0; i<count; i++) {
+		contexts[i] = mpf_context_create(factory,NULL,NULL,2,pool);
+		source = micro_bench_termination_create(TRUE,bench->codec_manager,pool);
+		sink = micro_bench_termination_create(FALSE,bench->codec_manager,pool);
+		if(mpf_context_termination_add(contexts[i],source) == FALSE ||
+			mpf_context_termination_add(contexts[i],sink) == FALSE) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Add Termination");
+			status = FALSE;
+			count = i + 1;
+			break;
+		}
+		mpf_context_association_add(contexts[i],source,sink);
+		mpf_context_topology_apply(contexts[i]);
+	}
+
+	if(status == TRUE) {
+		start = apr_time_now();
+		for(i=0; i<MICRO_BENCH_TICKS; i++) {
+			mpf_context_factory_process(factory);
+		}
+		elapsed = apr_time_now() - start;
+
+		params = apr_psprintf(bench->pool,"\"contexts\":%"APR_SIZE_T_FMT,count);
+		micro_bench_report("context-tick",params,count * MICRO_BENCH_TICKS,elapsed);
+	}
+
+	for(i=0; i<count; i++) {
+		mpf_context_topology_destroy(contexts[i]);
+		mpf_context_destroy(contexts[i]);
+	}
+	mpf_context_factory_destroy(factory);
+	apr_pool_destroy(pool);
+	return status;
+}
+
+static void micro_bench_args_parse(micro_bench_t *bench, int argc, const char * const *argv)
+{
+	int i;
+	for(i=0; i<argc; i++) {
+		char *name = apr_pstrdup(bench->pool,argv[i]);
+		char *value = strchr(name,'=');
+		if(!value) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Ignore Argument [%s]",name);
+			continue;
+		}
+		*value++ = '\0';
+		if(strcasecmp(name,"frames") == 0)
+			bench->frame_count = atol(value);
+		else if(strcasecmp(name,"loss") == 0)
+			bench->loss = atol(value);
+		else if(strcasecmp(name,"reorder") == 0)
+			bench->reorder = atol(value);
+		else if(strcasecmp(name,"contexts") == 0)
+			bench->context_count = atol(value);
+		else
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Ignore Argument [%s]",name);
+	}
+}
+
+static apt_bool_t micro_bench_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	static const apr_size_t context_counts[] = {1000, 5000, 10000};
+	static const char *codecs[] = {"PCMU", "PCMA", "L16"};
+	micro_bench_t bench;
+	apt_bool_t status = TRUE;
+	apr_size_t i;
+
+	bench.pool = suite->pool;
+	bench.codec_manager = mpf_engine_codec_manager_create(suite->pool);
+	bench.frame_count = MICRO_BENCH_FRAME_COUNT;
+	bench.loss = 0;
+	bench.reorder = 0;
+	bench.context_count = 0;
+	bench.seed = 1;
+	micro_bench_args_parse(&bench,argc,argv);
+
+	/* media paths of the contexts are traced at the info level */
+	apt_log_priority_set(APT_PRIO_NOTICE);
+	status = micro_bench_jb_run(&bench);
+	for(i=0; i<sizeof(codecs)/sizeof(codecs[0]) && status == TRUE; i++) {
+		status = micro_bench_codec_run(&bench,codecs[i]);
+	}
+	if(status == TRUE) {
+		status = micro_bench_activity_detector_run(&bench);
+	}
+	if(status == TRUE) {
+		status = micro_bench_dtmf_detector_run(&bench);
+	}
+	if(status == TRUE) {
+		status = micro_bench_rtp_rx_run(&bench);
+	}
+	if(status == TRUE) {
+		status = micro_bench_bridges_run(&bench);
+	}
+	if(bench.context_count) {
+		if(status == TRUE) {
+			status = micro_bench_contexts_run(&bench,bench.context_count);
+		}
+	}
+	else {
+		for(i=0; i<sizeof(context_counts)/sizeof(context_counts[0]) && status == TRUE; i++) {
+			status = micro_bench_contexts_run(&bench,context_counts[i]);
+		}
+	}
+	apt_log_priority_set(APT_PRIO_INFO);
+	return status;
+}
+
+apt_test_suite_t* micro_bench_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"micro-bench",NULL,micro_bench_run);
+	return suite;
+}
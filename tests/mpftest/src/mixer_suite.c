@@ -0,0 +1,85 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_mixer.h"
+
+/** Number of samples per input, not a multiple of the vector width to cover the tail */
+#define MIXER_TEST_SAMPLES 165
+/** Max number of inputs to mix */
+#define MIXER_TEST_MAX_INPUTS 5
+
+static apr_int16_t mixer_test_sample_get(apr_uint32_t *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return (apr_int16_t)(*seed >> 16);
+}
+
+static apt_bool_t mixer_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	apr_int16_t input[MIXER_TEST_MAX_INPUTS][MIXER_TEST_SAMPLES];
+	const apr_int16_t *inputs[MIXER_TEST_MAX_INPUTS];
+	apr_int16_t mix[MIXER_TEST_SAMPLES];
+	apr_uint32_t seed = 1;
+	apr_int32_t sum;
+	apr_size_t count;
+	apr_size_t i;
+	apr_size_t j;
+
+	for(j=0; j<MIXER_TEST_MAX_INPUTS; j++) {
+		for(i=0; i<MIXER_TEST_SAMPLES; i++) {
+			input[j][i] = mixer_test_sample_get(&seed);
+		}
+		/* full scale samples of the same sign to force saturation */
+		input[j][0] = 32767;
+		input[j][1] = -32768;
+		inputs[j] = input[j];
+	}
+	/* the sum of opposite extremes must not be clipped part-way through */
+	input[2][2] = -32768;
+	input[0][2] = input[1][2] = 32767;
+
+	for(count=0; count<=MIXER_TEST_MAX_INPUTS; count++) {
+		mpf_mixer_samples_mix(mix,inputs,count,MIXER_TEST_SAMPLES);
+		for(i=0; i<MIXER_TEST_SAMPLES; i++) {
+			sum = 0;
+			for(j=0; j<count; j++) {
+				sum += input[j][i];
+			}
+			if(sum > 32767) {
+				sum = 32767;
+			}
+			else if(sum < -32768) {
+				sum = -32768;
+			}
+			if(mix[i] != sum) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Mismatch of Mixed Sample [%"APR_SIZE_T_FMT"] of [%"APR_SIZE_T_FMT"] Inputs: %d != %d",
+					i,count,mix[i],sum);
+				return FALSE;
+			}
+		}
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Mixed up to [%d] Inputs",MIXER_TEST_MAX_INPUTS);
+	return TRUE;
+}
+
+apt_test_suite_t* mixer_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"mixer",NULL,mixer_test_run);
+	return suite;
+}
@@ -144,6 +144,8 @@ static apt_bool_t mpf_test_run(apt_test_suite_t *suite, int argc, const char * c
 
 	agent->rtp_termination_factory = mpf_rtp_termination_factory_create(rtp_config,suite->pool);
 	agent->file_termination_factory = mpf_file_termination_factory_create(suite->pool);
+	/* files are written by the writer task of the factory, which is started along with the engine */
+	mpf_termination_factory_engine_assign(agent->file_termination_factory,engine);
 
 	agent->rx_session = NULL;
 	agent->tx_session = NULL;
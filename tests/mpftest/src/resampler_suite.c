@@ -0,0 +1,155 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include "apt_test_suite.h"
+#include "mpf_resampler.h"
+#include "mpf_codec_descriptor.h"
+#include "apt_log.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define RESAMPLER_TEST_TONE       1000
+#define RESAMPLER_TEST_AMPLITUDE  10000
+/** Frames to skip while the filter fills up */
+#define RESAMPLER_TEST_WARMUP     10
+/** Frames to measure (a whole number of tone periods) */
+#define RESAMPLER_TEST_FRAMES     50
+
+/** Source of tone at the specified sampling rate */
+typedef struct {
+	apr_size_t  sampling_rate;
+	apr_size_t  position;
+} resampler_test_source_t;
+
+static apt_bool_t resampler_test_source_read(mpf_audio_stream_t *stream, mpf_frame_t *frame)
+{
+	resampler_test_source_t *source = stream->obj;
+	apr_int16_t *samples = frame->codec_frame.buffer;
+	apr_size_t count = frame->codec_frame.size / sizeof(apr_int16_t);
+	apr_size_t i;
+	for(i=0; i<count; i++, source->position++) {
+		samples[i] = (apr_int16_t)(RESAMPLER_TEST_AMPLITUDE * sin(2 * M_PI * RESAMPLER_TEST_TONE * source->position / source->sampling_rate));
+	}
+	frame->type = MEDIA_FRAME_TYPE_AUDIO;
+	return TRUE;
+}
+
+static apt_bool_t resampler_test_sink_write(mpf_audio_stream_t *stream, const mpf_frame_t *frame)
+{
+	return TRUE;
+}
+
+static const mpf_audio_stream_vtable_t source_vtable = {
+	NULL, NULL, NULL, resampler_test_source_read, NULL, NULL, NULL, NULL
+};
+
+static const mpf_audio_stream_vtable_t sink_vtable = {
+	NULL, NULL, NULL, NULL, NULL, NULL, resampler_test_sink_write, NULL
+};
+
+/** Resample tone and check its amplitude and the level of distortion */
+static apt_bool_t resampler_test_rate_run(apr_uint16_t rate_in, apr_uint16_t rate_out, apr_pool_t *pool)
+{
+	resampler_test_source_t *tone;
+	mpf_audio_stream_t *source;
+	mpf_audio_stream_t *sink;
+	mpf_audio_stream_t *resampler;
+	mpf_frame_t frame;
+	apr_size_t frame_size = mpf_codec_linear_frame_size_calculate(rate_out,1);
+	apr_size_t count = frame_size / sizeof(apr_int16_t);
+	apr_size_t n = 0;
+	apr_size_t i;
+	int k;
+	double re = 0, im = 0, energy = 0;
+	double amplitude;
+	double snr;
+
+	tone = apr_palloc(pool,sizeof(resampler_test_source_t));
+	tone->sampling_rate = rate_in;
+	tone->position = 0;
+	source = mpf_audio_stream_create(tone,&source_vtable,mpf_stream_capabilities_create(STREAM_DIRECTION_RECEIVE,pool),pool);
+	source->rx_descriptor = mpf_codec_lpcm_descriptor_create(rate_in,1,pool);
+	sink = mpf_audio_stream_create(NULL,&sink_vtable,mpf_stream_capabilities_create(STREAM_DIRECTION_SEND,pool),pool);
+	sink->tx_descriptor = mpf_codec_lpcm_descriptor_create(rate_out,1,pool);
+
+	resampler = mpf_resampler_create(source,sink,pool);
+	if(!resampler || resampler->rx_descriptor->sampling_rate != rate_out) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resampler [%d->%d]",rate_in,rate_out);
+		return FALSE;
+	}
+	mpf_audio_stream_rx_open(resampler,NULL);
+
+	frame.codec_frame.size = frame_size;
+	frame.codec_frame.buffer = apr_palloc(pool,frame_size);
+	for(k=0; k<RESAMPLER_TEST_WARMUP + RESAMPLER_TEST_FRAMES; k++) {
+		const apr_int16_t *samples = frame.codec_frame.buffer;
+		mpf_audio_stream_frame_read(resampler,&frame);
+		if(frame.codec_frame.size != frame_size) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Frame Size [%"APR_SIZE_T_FMT"] [%d->%d]",
+				frame.codec_frame.size,rate_in,rate_out);
+			return FALSE;
+		}
+		if(k < RESAMPLER_TEST_WARMUP) {
+			continue;
+		}
+		/* project onto the tone, whatever the delay of the filter is */
+		for(i=0; i<count; i++, n++) {
+			double phase = 2 * M_PI * RESAMPLER_TEST_TONE * n / rate_out;
+			re += samples[i] * cos(phase);
+			im += samples[i] * sin(phase);
+			energy += (double)samples[i] * samples[i];
+		}
+	}
+	mpf_audio_stream_rx_close(resampler);
+
+	amplitude = 2 * sqrt(re * re + im * im) / n;
+	/* the rest of the energy is distortion */
+	snr = 10 * log10((amplitude * amplitude / 2) / (energy / n - amplitude * amplitude / 2 + 1e-9));
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Resampled [%d->%d] amplitude [%.0f] SNR [%.1f dB]",rate_in,rate_out,amplitude,snr);
+	if(fabs(amplitude - RESAMPLER_TEST_AMPLITUDE) > RESAMPLER_TEST_AMPLITUDE * 0.05 || snr < 40) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Poor Resampling [%d->%d] amplitude [%.0f] SNR [%.1f dB]",rate_in,rate_out,amplitude,snr);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t resampler_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	static const apr_uint16_t rates[] = {8000, 16000, 32000, 48000};
+	apr_size_t i;
+	apr_size_t j;
+	for(i=0; i<sizeof(rates)/sizeof(rates[0]); i++) {
+		for(j=0; j<sizeof(rates)/sizeof(rates[0]); j++) {
+			if(i == j) {
+				continue;
+			}
+			if(resampler_test_rate_run(rates[i],rates[j],suite->pool) == FALSE) {
+				return FALSE;
+			}
+		}
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Resampled Tone between All Rate Pairs");
+	return TRUE;
+}
+
+apt_test_suite_t* resampler_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"resampler",NULL,resampler_test_run);
+	return suite;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_rtp_port_pool.h"
+
+/** Port range under test, 4 pairs (the odd min is rounded up) */
+#define PORT_POOL_TEST_MIN 4999
+#define PORT_POOL_TEST_MAX 5008
+
+static apt_bool_t port_pool_fifo_test(apr_pool_t *pool)
+{
+	mpf_rtp_port_pool_t *port_pool;
+	apr_port_t port;
+	apr_port_t expected;
+
+	port_pool = mpf_rtp_port_pool_create(PORT_POOL_TEST_MIN,PORT_POOL_TEST_MAX,FALSE,pool);
+	if(!port_pool || mpf_rtp_port_pool_free_count_get(port_pool) != 4) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Port Pool");
+		return FALSE;
+	}
+
+	for(expected = 5000; expected < PORT_POOL_TEST_MAX; expected += 2) {
+		port = mpf_rtp_port_pool_alloc(port_pool);
+		if(port != expected) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Port [%hu] expected [%hu]",port,expected);
+			return FALSE;
+		}
+	}
+	if(mpf_rtp_port_pool_alloc(port_pool) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Port past Range");
+		return FALSE;
+	}
+
+	/* pairs not taken, odd and out of range ports are not returned */
+	if(mpf_rtp_port_pool_release(port_pool,5001) == TRUE ||
+		mpf_rtp_port_pool_release(port_pool,5008) == TRUE ||
+		mpf_rtp_port_pool_release(port_pool,4998) == TRUE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Release of Foreign Port");
+		return FALSE;
+	}
+
+	/* released pairs are reused in the order they are returned */
+	if(mpf_rtp_port_pool_release(port_pool,5004) == FALSE ||
+		mpf_rtp_port_pool_release(port_pool,5004) == TRUE ||
+		mpf_rtp_port_pool_release(port_pool,5000) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Release Port");
+		return FALSE;
+	}
+	if(mpf_rtp_port_pool_alloc(port_pool) != 5004 || mpf_rtp_port_pool_alloc(port_pool) != 5000) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Order of Released Ports");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t port_pool_random_test(apr_pool_t *pool)
+{
+	mpf_rtp_port_pool_t *port_pool;
+	apr_port_t port;
+	apr_size_t i;
+	apr_uint32_t taken = 0;
+
+	port_pool = mpf_rtp_port_pool_create(PORT_POOL_TEST_MIN,PORT_POOL_TEST_MAX,TRUE,pool);
+	if(!port_pool) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Port Pool");
+		return FALSE;
+	}
+
+	/* each pair is taken exactly once */
+	for(i=0; i<4; i++) {
+		port = mpf_rtp_port_pool_alloc(port_pool);
+		if(port < 5000 || port >= PORT_POOL_TEST_MAX || (port & 1) || (taken & (1 << (port - 5000) / 2))) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Random Port [%hu]",port);
+			return FALSE;
+		}
+		taken |= 1 << (port - 5000) / 2;
+	}
+	if(mpf_rtp_port_pool_alloc(port_pool) != 0 || mpf_rtp_port_pool_free_count_get(port_pool) != 0) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Port past Range");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static apt_bool_t port_pool_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	if(mpf_rtp_port_pool_create(5000,5001,FALSE,suite->pool) != NULL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Port Pool of Empty Range");
+		return FALSE;
+	}
+	if(port_pool_fifo_test(suite->pool) == FALSE) {
+		return FALSE;
+	}
+	return port_pool_random_test(suite->pool);
+}
+
+apt_test_suite_t* rtp_port_pool_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"rtp-port-pool",NULL,port_pool_test_run);
+	return suite;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_rtp_stat.h"
+
+/** Number of packets received per run */
+#define RTP_STAT_TEST_PACKETS 1000
+/** Packetization time in msec */
+#define RTP_STAT_TEST_PTIME   20
+/** Jitter buffer delay in msec */
+#define RTP_STAT_TEST_JB      50
+
+/**
+ * Receive packets, losing the given number of packets of every period.
+ * @param rx_stat the statistics to update
+ * @param period the number of packets of a period (0 for no loss)
+ * @param burst the number of consecutive packets lost per period
+ */
+static void rtp_stat_test_receive(rtp_rx_stat_t *rx_stat, apr_uint32_t period, apr_uint32_t burst)
+{
+	apr_uint32_t i;
+	mpf_rtp_rx_stat_reset(rx_stat);
+	for(i=0; i<RTP_STAT_TEST_PACKETS; i++) {
+		apr_uint32_t lost = 0;
+		if(period && i && i % period == 0) {
+			lost = burst;
+		}
+		rx_stat->received_packets++;
+		rx_stat->lost_packets += lost;
+		mpf_rtp_burst_stat_update(&rx_stat->burst,lost,FALSE);
+	}
+}
+
+static apt_bool_t rtp_stat_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	rtp_rx_stat_t rx_stat;
+	rtcp_xr_voip_stat_t clean;
+	rtcp_xr_voip_stat_t random;
+	rtcp_xr_voip_stat_t bursty;
+
+	/* no loss */
+	rtp_stat_test_receive(&rx_stat,0,0);
+	mpf_rtcp_xr_voip_stat_calculate(&rx_stat,RTP_STAT_TEST_PTIME,RTP_STAT_TEST_JB,RTP_STAT_TEST_JB,&clean);
+	if(clean.loss_rate || clean.burst_density || clean.gap_density) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Loss [%u/%u/%u]",clean.loss_rate,clean.burst_density,clean.gap_density);
+		return FALSE;
+	}
+	if(clean.gap_duration != RTP_STAT_TEST_PACKETS * RTP_STAT_TEST_PTIME) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Gap Duration [%u ms]",clean.gap_duration);
+		return FALSE;
+	}
+	if(clean.r_factor < 90 || clean.mos_lq < 43 || clean.mos_cq < 43) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Quality of Clean Stream [R:%u LQ:%u CQ:%u]",
+			clean.r_factor,clean.mos_lq,clean.mos_cq);
+		return FALSE;
+	}
+
+	/* 2% isolated losses, which fall within gaps */
+	rtp_stat_test_receive(&rx_stat,50,1);
+	mpf_rtcp_xr_voip_stat_calculate(&rx_stat,RTP_STAT_TEST_PTIME,RTP_STAT_TEST_JB,RTP_STAT_TEST_JB,&random);
+	if(random.loss_rate < 4 || random.loss_rate > 6 || random.gap_density < 4) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Isolated Loss [%u/%u]",random.loss_rate,random.gap_density);
+		return FALSE;
+	}
+
+	/* the same loss in bursts of 5 packets, which the bursts consist of */
+	rtp_stat_test_receive(&rx_stat,250,5);
+	mpf_rtcp_xr_voip_stat_calculate(&rx_stat,RTP_STAT_TEST_PTIME,RTP_STAT_TEST_JB,RTP_STAT_TEST_JB,&bursty);
+	if(bursty.burst_density < 200 || bursty.gap_density) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Burst Loss [%u/%u]",bursty.burst_density,bursty.gap_density);
+		return FALSE;
+	}
+	if(bursty.burst_duration < 5 * RTP_STAT_TEST_PTIME) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Burst Duration [%u ms]",bursty.burst_duration);
+		return FALSE;
+	}
+
+	/* loss degrades quality, bursty loss even more */
+	if(random.mos_lq >= clean.mos_lq || bursty.mos_lq >= random.mos_lq) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected MOS-LQ Order [%u %u %u]",clean.mos_lq,random.mos_lq,bursty.mos_lq);
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"R Factor [%u %u %u] MOS-CQ [%u %u %u]",
+		clean.r_factor,random.r_factor,bursty.r_factor,
+		clean.mos_cq,random.mos_cq,bursty.mos_cq);
+	return TRUE;
+}
+
+apt_test_suite_t* rtp_stat_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"rtp-stat",NULL,rtp_stat_test_run);
+	return suite;
+}
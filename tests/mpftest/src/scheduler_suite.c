@@ -0,0 +1,87 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <apr_atomic.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mpf_scheduler.h"
+
+/** Number of ticks media is transferred for, 5 sec in real-time */
+#define SCHEDULER_TEST_BUSY_TICKS 500
+/** Max time (usec) the busy ticks may take in offline mode */
+#define SCHEDULER_TEST_TIMEOUT    (2 * APR_USEC_PER_SEC)
+
+typedef struct scheduler_test_t scheduler_test_t;
+struct scheduler_test_t {
+	volatile apr_uint32_t tick_count;
+};
+
+static void scheduler_test_media_proc(mpf_scheduler_t *scheduler, void *obj)
+{
+	scheduler_test_t *test = obj;
+	if(apr_atomic_inc32(&test->tick_count) < SCHEDULER_TEST_BUSY_TICKS) {
+		mpf_scheduler_tick_busy_set(scheduler,TRUE);
+	}
+}
+
+static apt_bool_t scheduler_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	scheduler_test_t test;
+	mpf_scheduler_t *scheduler;
+	apr_time_t start;
+	apr_time_t elapsed;
+	apr_uint32_t tick_count;
+
+	scheduler = mpf_scheduler_create(suite->pool);
+	if(!scheduler) {
+		return FALSE;
+	}
+	if(mpf_scheduler_offline_set(scheduler,TRUE) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Offline Mode Not Supported");
+		mpf_scheduler_destroy(scheduler);
+		return TRUE;
+	}
+
+	apr_atomic_set32(&test.tick_count,0);
+	mpf_scheduler_media_clock_set(scheduler,10,scheduler_test_media_proc,&test);
+
+	start = apr_time_now();
+	mpf_scheduler_start(scheduler);
+	do {
+		apr_sleep(10000);
+		tick_count = apr_atomic_read32(&test.tick_count);
+		elapsed = apr_time_now() - start;
+	}
+	while(tick_count < SCHEDULER_TEST_BUSY_TICKS && elapsed < SCHEDULER_TEST_TIMEOUT);
+	mpf_scheduler_stop(scheduler);
+	mpf_scheduler_destroy(scheduler);
+
+	if(tick_count < SCHEDULER_TEST_BUSY_TICKS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Offline Ticks Lag Behind [%u] in %"APR_TIME_T_FMT" usec",
+			tick_count,SCHEDULER_TEST_TIMEOUT);
+		return FALSE;
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Ran [%u] Offline Ticks in %"APR_TIME_T_FMT" usec",tick_count,elapsed);
+	return TRUE;
+}
+
+apt_test_suite_t* scheduler_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"scheduler",NULL,scheduler_test_run);
+	return suite;
+}
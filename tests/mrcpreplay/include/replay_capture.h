@@ -0,0 +1,120 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef REPLAY_CAPTURE_H
+#define REPLAY_CAPTURE_H
+
+/**
+ * @file replay_capture.h
+ * @brief Calls Extracted from Packet Capture of SIP, RTP and MRCPv2
+ *
+ * A capture (classic pcap format, Ethernet, Linux cooked, loopback or raw
+ * IPv4) is split into calls by the SIP Call-ID. The side sending the INVITE
+ * is the client. The client's SIP requests (over UDP), MRCPv2 requests
+ * (over TCP, reassembled and framed by the message-length) and RTP (to the
+ * address of the SDP answer) are kept to be replayed with their original
+ * timing, and the server's final SIP responses, MRCP responses and events
+ * are kept as the outcome expected.
+ */
+
+#include <apr_tables.h>
+#include "mrcp_resource_factory.h"
+#include "mrcp_message.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Type of packet replayed */
+typedef enum {
+	REPLAY_PACKET_SIP,
+	REPLAY_PACKET_MRCP,
+	REPLAY_PACKET_RTP
+} replay_packet_type_e;
+
+/** Packet sent by the client */
+typedef struct replay_packet_t replay_packet_t;
+struct replay_packet_t {
+	/** Type of packet */
+	replay_packet_type_e type;
+	/** Time since the start of the call */
+	apr_interval_time_t  time;
+	/** Payload (SIP and MRCP messages are nul-terminated) */
+	apt_str_t            data;
+	/** Order in the capture, to keep packets of the same time in order */
+	apr_size_t           seq;
+};
+
+/** Call extracted from capture */
+typedef struct replay_call_t replay_call_t;
+struct replay_call_t {
+	/** Name of the capture file */
+	const char          *capture;
+	/** SIP Call-ID */
+	const char          *call_id;
+	/** Client IP address */
+	const char          *client_ip;
+	/** Client SIP port */
+	apr_port_t           client_sip_port;
+	/** Client RTP port of the SDP offer */
+	apr_port_t           client_rtp_port;
+	/** Server IP address */
+	const char          *server_ip;
+	/** Server SIP port */
+	apr_port_t           server_sip_port;
+	/** Server RTP port of the SDP answer */
+	apr_port_t           server_rtp_port;
+	/** MRCP session id of the SDP answer */
+	const char          *session_id;
+	/** Packets sent by the client (replay_packet_t), in time order */
+	apr_array_header_t  *packets;
+	/** Outcome expected (const char*), see replay_mrcp_outcome_get() and replay_sip_outcome_get() */
+	apr_array_header_t  *outcomes;
+	/** Duration from the first to the last packet of the call */
+	apr_interval_time_t  duration;
+};
+
+/**
+ * Load calls from capture file.
+ * @param path the path to the capture file
+ * @param factory the MRCP resource factory to parse MRCPv2 messages by
+ * @param calls the array (replay_call_t*) to append calls to
+ * @param pool the pool to allocate calls from
+ */
+apt_bool_t replay_capture_load(const char *path, const mrcp_resource_factory_t *factory, apr_array_header_t *calls, apr_pool_t *pool);
+
+/** Get the outcome of an MRCP response or event as compared, e.g. "MRCP 2 RECOGNITION-COMPLETE COMPLETE 000" */
+const char* replay_mrcp_outcome_get(const mrcp_message_t *message, apr_pool_t *pool);
+
+/** Get the outcome of a final SIP response as compared, e.g. "SIP INVITE 200" */
+const char* replay_sip_outcome_get(const char *method, int status_code, apr_pool_t *pool);
+
+/**
+ * Get the length of the MRCPv2 message at the start of buffer.
+ * @param buf the buffer, which must start with "MRCP/2.0 "
+ * @param length the length of data in the buffer
+ * @return the message-length, 0 if the start-line is incomplete or invalid
+ */
+apr_size_t replay_mrcp_length_get(const char *buf, apr_size_t length);
+
+/** Get the value of a SIP header (full or compact name) in a nul-terminated message */
+const char* replay_sip_header_get(const char *msg, const char *name, const char *compact_name, apr_pool_t *pool);
+
+/** Get the body of a nul-terminated SIP message, NULL if there is none */
+const char* replay_sip_body_get(const char *msg);
+
+APT_END_EXTERN_C
+
+#endif /* REPLAY_CAPTURE_H */
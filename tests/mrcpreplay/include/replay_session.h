@@ -0,0 +1,91 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef REPLAY_SESSION_H
+#define REPLAY_SESSION_H
+
+/**
+ * @file replay_session.h
+ * @brief Replay of Captured Call against Server
+ *
+ * The client side of a captured call is replayed from local sockets: SIP
+ * requests are sent to the target server with the addresses, the Call-ID,
+ * the Via branches and the SDP offer rewritten, MRCPv2 requests are sent
+ * over a connection to the port of the SDP answer with the session-id of
+ * the answer, and RTP is sent to the address of the answer. Packets are
+ * sent at their original times, scaled by the speed. The final SIP
+ * responses, MRCP responses and events received are compared against the
+ * ones of the capture.
+ */
+
+#include "replay_capture.h"
+
+APT_BEGIN_EXTERN_C
+
+/** Replay configuration, shared by concurrent sessions */
+typedef struct replay_config_t replay_config_t;
+struct replay_config_t {
+	/** IP address of the server to replay against */
+	const char                    *target_ip;
+	/** SIP port of the server */
+	apr_port_t                     target_port;
+	/** Local IP address to send from and advertise */
+	const char                    *local_ip;
+	/** Speed to scale the original timing by (0 - as fast as possible) */
+	double                         speed;
+	/** Time to wait for a response or for the outcome after the last packet */
+	apr_interval_time_t            timeout;
+	/** Factory to parse and generate MRCP messages by */
+	const mrcp_resource_factory_t *factory;
+};
+
+/** Result of replayed call */
+typedef struct replay_result_t replay_result_t;
+struct replay_result_t {
+	/** Call replayed */
+	const replay_call_t *call;
+	/** Instance of the call, to tell concurrent replays of the same call apart */
+	apr_size_t           instance;
+	/** Whether the outcome matches the capture */
+	apt_bool_t           passed;
+	/** Reason the replay is aborted for (NULL if none) */
+	const char          *error;
+	/** Outcome received (const char*) */
+	apr_array_header_t  *outcomes;
+	/** Outcome of the capture not received (const char*) */
+	apr_array_header_t  *missing;
+	/** Outcome received not in the capture (const char*) */
+	apr_array_header_t  *unexpected;
+	/** Number of packets sent */
+	apr_size_t           sent;
+	/** Time taken by the replay */
+	apr_interval_time_t  elapsed;
+};
+
+/**
+ * Replay captured call.
+ * @param call the call to replay
+ * @param config the replay configuration
+ * @param instance the instance of the call
+ * @param result the result to fill
+ * @param pool the pool to allocate the result from
+ */
+apt_bool_t replay_session_run(const replay_call_t *call, const replay_config_t *config, apr_size_t instance, replay_result_t *result, apr_pool_t *pool);
+
+APT_END_EXTERN_C
+
+#endif /* REPLAY_SESSION_H */
@@ -0,0 +1,444 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Replay of packet captures of SIP, RTP and MRCPv2 against a server.
+ *
+ * The calls of the captures given are replayed as the client, each with
+ * the original timing or scaled by the speed, a number of them at once.
+ * The outcome of each replay (final SIP responses, MRCP responses and
+ * events) is compared against the capture and reported as JSON lines,
+ * followed by a summary. The exit status is 0 if all the replays pass.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <apr_getopt.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_strings.h>
+#include "replay_session.h"
+#include "mrcp_resource_loader.h"
+#include "apt_log.h"
+
+#define DEFAULT_LOCAL_IP "127.0.0.1"
+#define DEFAULT_TARGET_PORT 8060
+#define DEFAULT_TIMEOUT 10
+
+typedef struct {
+	apr_array_header_t *captures;
+	const char         *target_ip;
+	apr_port_t          target_port;
+	const char         *local_ip;
+	double              speed;
+	apr_size_t          concurrency;
+	apr_size_t          repeat_count;
+	apr_size_t          timeout;
+	const char         *output_file;
+	apt_log_priority_e  log_priority;
+	apr_pool_t         *pool;
+} replay_options_t;
+
+typedef struct {
+	replay_config_t     config;
+	apr_array_header_t *calls;
+	/** Results, a replay of a call per instance, the call is the instance modulo the number of calls */
+	replay_result_t    *results;
+	apr_size_t          result_count;
+	apr_thread_mutex_t *mutex;
+	apr_size_t          next_result;
+	apr_pool_t         *pool;
+} replay_t;
+
+typedef struct {
+	replay_t           *replay;
+	apr_thread_t       *thread;
+	/** Pool the results of the worker are allocated from */
+	apr_pool_t         *pool;
+} replay_worker_t;
+
+/** Thread function to replay calls in one after another */
+static void* APR_THREAD_FUNC replay_worker_run(apr_thread_t *thread, void *data)
+{
+	replay_worker_t *worker = data;
+	replay_t *replay = worker->replay;
+	apr_size_t index;
+
+	for(;;) {
+		const replay_call_t *call;
+		apr_thread_mutex_lock(replay->mutex);
+		index = replay->next_result++;
+		apr_thread_mutex_unlock(replay->mutex);
+		if(index >= replay->result_count) {
+			break;
+		}
+		call = APR_ARRAY_IDX(replay->calls,index % replay->calls->nelts,replay_call_t*);
+		replay_session_run(call,&replay->config,index,&replay->results[index],worker->pool);
+	}
+	return NULL;
+}
+
+/** Write a string as a JSON literal */
+static void json_string_write(FILE *out, const char *str)
+{
+	fputc('"',out);
+	for(; str && *str != '\0'; str++) {
+		unsigned char ch = (unsigned char) *str;
+		if(ch == '"' || ch == '\\') {
+			fputc('\\',out);
+			fputc(ch,out);
+		}
+		else if(ch < 0x20) {
+			fprintf(out,"\\u%04x",ch);
+		}
+		else {
+			fputc(ch,out);
+		}
+	}
+	fputc('"',out);
+}
+
+static void json_strings_write(FILE *out, const apr_array_header_t *strings)
+{
+	int i;
+	fputc('[',out);
+	for(i = 0; i < strings->nelts; i++) {
+		if(i) {
+			fputc(',',out);
+		}
+		json_string_write(out,APR_ARRAY_IDX(strings,i,const char*));
+	}
+	fputc(']',out);
+}
+
+static void result_write(FILE *out, const replay_result_t *result)
+{
+	fprintf(out,"{\"type\":\"call\",\"capture\":");
+	json_string_write(out,result->call ? result->call->capture : "");
+	fprintf(out,",\"call_id\":");
+	json_string_write(out,result->call ? result->call->call_id : "");
+	fprintf(out,",\"instance\":%" APR_SIZE_T_FMT ",\"passed\":%s,\"sent\":%" APR_SIZE_T_FMT
+		",\"capture_ms\":%" APR_TIME_T_FMT ",\"elapsed_ms\":%" APR_TIME_T_FMT,
+		result->instance,
+		result->passed == TRUE ? "true" : "false",
+		result->sent,
+		result->call ? apr_time_as_msec(result->call->duration) : 0,
+		apr_time_as_msec(result->elapsed));
+	if(result->error) {
+		fprintf(out,",\"error\":");
+		json_string_write(out,result->error);
+	}
+	if(result->missing) {
+		fprintf(out,",\"missing\":");
+		json_strings_write(out,result->missing);
+	}
+	if(result->unexpected) {
+		fprintf(out,",\"unexpected\":");
+		json_strings_write(out,result->unexpected);
+	}
+	fprintf(out,"}\n");
+}
+
+static apt_bool_t replay_run(replay_t *replay, const replay_options_t *options, FILE *out)
+{
+	replay_worker_t *workers;
+	apr_size_t passed = 0;
+	apr_time_t start_time;
+	apr_time_t wall_time;
+	apr_size_t i;
+
+	if(apr_thread_mutex_create(&replay->mutex,APR_THREAD_MUTEX_DEFAULT,replay->pool) != APR_SUCCESS) {
+		return FALSE;
+	}
+	replay->result_count = replay->calls->nelts * options->repeat_count;
+	replay->results = apr_pcalloc(replay->pool,sizeof(replay_result_t) * replay->result_count);
+	replay->next_result = 0;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Start Replay [%d calls] [%" APR_SIZE_T_FMT " replays] [%" APR_SIZE_T_FMT " concurrent]",
+		replay->calls->nelts,replay->result_count,options->concurrency);
+
+	start_time = apr_time_now();
+	workers = apr_pcalloc(replay->pool,sizeof(replay_worker_t) * options->concurrency);
+	for(i = 0; i < options->concurrency; i++) {
+		workers[i].replay = replay;
+		apr_pool_create(&workers[i].pool,replay->pool);
+		if(apr_thread_create(&workers[i].thread,NULL,replay_worker_run,&workers[i],replay->pool) != APR_SUCCESS) {
+			workers[i].thread = NULL;
+		}
+	}
+	for(i = 0; i < options->concurrency; i++) {
+		if(workers[i].thread) {
+			apr_status_t rv;
+			apr_thread_join(&rv,workers[i].thread);
+		}
+	}
+	wall_time = apr_time_now() - start_time;
+
+	for(i = 0; i < replay->result_count; i++) {
+		const replay_result_t *result = &replay->results[i];
+		result_write(out,result);
+		if(result->passed == TRUE) {
+			passed++;
+		}
+	}
+	fprintf(out,"{\"type\":\"summary\",\"calls\":%d,\"replays\":%" APR_SIZE_T_FMT ",\"passed\":%" APR_SIZE_T_FMT
+		",\"failed\":%" APR_SIZE_T_FMT ",\"concurrency\":%" APR_SIZE_T_FMT ",\"speed\":%.2f,\"wall_sec\":%.3f}\n",
+		replay->calls->nelts,
+		replay->result_count,
+		passed,
+		replay->result_count - passed,
+		options->concurrency,
+		options->speed,
+		(double) wall_time / APR_USEC_PER_SEC);
+	fflush(out);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Replay Complete [%" APR_SIZE_T_FMT "/%" APR_SIZE_T_FMT " passed]",
+		passed,replay->result_count);
+	return passed == replay->result_count ? TRUE : FALSE;
+}
+
+static void usage(void)
+{
+	printf(
+		"\n"
+		"Usage:\n"
+		"\n"
+		"  mrcpreplay [options] capture.pcap ...\n"
+		"\n"
+		"  Available options:\n"
+		"\n"
+		"   -t [--target] ip[:port]   : Set the SIP address of the server to replay against (required).\n"
+		"                               (the port is 8060 by default)\n"
+		"\n"
+		"   -L [--local-ip] ip        : Set the local IP address to send from (default " DEFAULT_LOCAL_IP ").\n"
+		"\n"
+		"   -s [--speed] factor       : Set the speed to scale the original timing by (default 1).\n"
+		"                               (0 - send as fast as possible)\n"
+		"\n"
+		"   -c [--concurrency] count  : Set the number of calls replayed at once (default 1).\n"
+		"\n"
+		"   -n [--repeat] count       : Set the number of times each call is replayed (default 1).\n"
+		"\n"
+		"   -T [--timeout] sec        : Set the time to wait for a response or the outcome (default 10).\n"
+		"\n"
+		"   -O [--output] path        : Set the file to write the JSON lines to (default stdout).\n"
+		"\n"
+		"   -l [--log-prio] priority  : Set the log priority.\n"
+		"                               (0-emergency, ..., 7-debug)\n"
+		"\n"
+		"   -h [--help]               : Show the help.\n"
+		"\n");
+}
+
+static void options_destroy(replay_options_t *options)
+{
+	if(options->pool) {
+		apr_pool_destroy(options->pool);
+	}
+}
+
+static replay_options_t* options_load(int argc, const char * const *argv)
+{
+	apr_status_t rv;
+	apr_getopt_t *opt = NULL;
+	int optch;
+	const char *optarg;
+	apr_pool_t *pool;
+	replay_options_t *options;
+
+	const apr_getopt_option_t opt_option[] = {
+		/* long-option, short-option, has-arg flag, description */
+		{ "target",      't', TRUE,  "server address" },         /* -t arg or --target arg */
+		{ "local-ip",    'L', TRUE,  "local ip address" },       /* -L arg or --local-ip arg */
+		{ "speed",       's', TRUE,  "speed of replay" },        /* -s arg or --speed arg */
+		{ "concurrency", 'c', TRUE,  "number of calls at once" },/* -c arg or --concurrency arg */
+		{ "repeat",      'n', TRUE,  "number of repetitions" },  /* -n arg or --repeat arg */
+		{ "timeout",     'T', TRUE,  "timeout" },                /* -T arg or --timeout arg */
+		{ "output",      'O', TRUE,  "output file" },            /* -O arg or --output arg */
+		{ "log-prio",    'l', TRUE,  "log priority" },           /* -l arg or --log-prio arg */
+		{ "help",        'h', FALSE, "show help" },              /* -h or --help */
+		{ NULL, 0, 0, NULL },                                    /* end */
+	};
+
+	/* create APR pool to allocate options from */
+	apr_pool_create(&pool,NULL);
+	if(!pool) {
+		return NULL;
+	}
+	options = apr_palloc(pool,sizeof(replay_options_t));
+	options->pool = pool;
+	/* set the default options */
+	options->captures = apr_array_make(pool,4,sizeof(const char*));
+	options->target_ip = NULL;
+	options->target_port = DEFAULT_TARGET_PORT;
+	options->local_ip = DEFAULT_LOCAL_IP;
+	options->speed = 1.0;
+	options->concurrency = 1;
+	options->repeat_count = 1;
+	options->timeout = DEFAULT_TIMEOUT;
+	options->output_file = NULL;
+	options->log_priority = APT_PRIO_WARNING;
+
+	rv = apr_getopt_init(&opt, pool , argc, argv);
+	if(rv != APR_SUCCESS) {
+		options_destroy(options);
+		return NULL;
+	}
+
+	while((rv = apr_getopt_long(opt, opt_option, &optch, &optarg)) == APR_SUCCESS) {
+		switch(optch) {
+			case 't':
+				if(optarg) {
+					const char *colon = strchr(optarg,':');
+					if(colon) {
+						options->target_ip = apr_pstrndup(pool,optarg,colon - optarg);
+						options->target_port = (apr_port_t)atoi(colon + 1);
+					}
+					else {
+						options->target_ip = optarg;
+					}
+				}
+				break;
+			case 'L':
+				options->local_ip = optarg;
+				break;
+			case 's':
+				if(optarg && atof(optarg) >= 0) {
+					options->speed = atof(optarg);
+				}
+				break;
+			case 'c':
+				if(optarg && atol(optarg) > 0) {
+					options->concurrency = atol(optarg);
+				}
+				break;
+			case 'n':
+				if(optarg && atol(optarg) > 0) {
+					options->repeat_count = atol(optarg);
+				}
+				break;
+			case 'T':
+				if(optarg && atol(optarg) > 0) {
+					options->timeout = atol(optarg);
+				}
+				break;
+			case 'O':
+				options->output_file = optarg;
+				break;
+			case 'l':
+				if(optarg) {
+					options->log_priority = atoi(optarg);
+				}
+				break;
+			case 'h':
+				usage();
+				options_destroy(options);
+				return NULL;
+		}
+	}
+
+	if(rv == APR_EOF) {
+		for(; opt->ind < opt->argc; opt->ind++) {
+			APR_ARRAY_PUSH(options->captures,const char*) = opt->argv[opt->ind];
+		}
+	}
+	if(rv != APR_EOF || !options->target_ip || !options->target_port || !options->captures->nelts) {
+		usage();
+		options_destroy(options);
+		return NULL;
+	}
+
+	return options;
+}
+
+int main(int argc, const char * const *argv)
+{
+	replay_options_t *options;
+	mrcp_resource_loader_t *resource_loader;
+	mrcp_resource_factory_t *factory = NULL;
+	replay_t replay;
+	FILE *out = stdout;
+	int status = 1;
+	int i;
+
+	/* APR global initialization */
+	if(apr_initialize() != APR_SUCCESS) {
+		apr_terminate();
+		return 1;
+	}
+
+	/* load options */
+	options = options_load(argc,argv);
+	if(!options) {
+		apr_terminate();
+		return 1;
+	}
+
+	apt_log_instance_create(APT_LOG_OUTPUT_CONSOLE,options->log_priority,options->pool);
+
+	if(options->output_file) {
+		out = fopen(options->output_file,"w");
+		if(!out) {
+			printf("Failed to Open Output [%s]\n",options->output_file);
+			apt_log_instance_destroy();
+			options_destroy(options);
+			apr_terminate();
+			return 1;
+		}
+	}
+
+	resource_loader = mrcp_resource_loader_create(TRUE,options->pool);
+	if(resource_loader) {
+		factory = mrcp_resource_factory_get(resource_loader);
+	}
+
+	memset(&replay,0,sizeof(replay));
+	replay.pool = options->pool;
+	replay.calls = apr_array_make(options->pool,16,sizeof(replay_call_t*));
+	replay.config.target_ip = options->target_ip;
+	replay.config.target_port = options->target_port;
+	replay.config.local_ip = options->local_ip;
+	replay.config.speed = options->speed;
+	replay.config.timeout = apr_time_from_sec(options->timeout);
+	replay.config.factory = factory;
+
+	if(factory) {
+		for(i = 0; i < options->captures->nelts; i++) {
+			replay_capture_load(APR_ARRAY_IDX(options->captures,i,const char*),factory,replay.calls,options->pool);
+		}
+		if(!replay.calls->nelts) {
+			printf("No Calls in Captures\n");
+		}
+		else if(replay_run(&replay,options,out) == TRUE) {
+			status = 0;
+		}
+		mrcp_resource_factory_destroy(factory);
+	}
+
+	if(out != stdout) {
+		fclose(out);
+	}
+
+	apt_log_instance_destroy();
+
+	/* destroy options */
+	options_destroy(options);
+
+	/* APR global termination */
+	apr_terminate();
+	return status;
+}
@@ -0,0 +1,857 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include "replay_capture.h"
+#include "mrcp_stream.h"
+#include "apt_log.h"
+
+/** Magic numbers of pcap file (microsecond and nanosecond resolution) */
+#define PCAP_MAGIC       0xa1b2c3d4
+#define PCAP_MAGIC_NSEC  0xa1b23c4d
+
+/** Link-layer header types of pcap file */
+#define PCAP_LINKTYPE_NULL      0
+#define PCAP_LINKTYPE_ETHERNET  1
+#define PCAP_LINKTYPE_RAW_BSD   12
+#define PCAP_LINKTYPE_RAW       101
+#define PCAP_LINKTYPE_LINUX_SLL 113
+
+/** Max size of packet read */
+#define PCAP_MAX_SNAPLEN 65535
+
+#define IP_PROTO_TCP 6
+#define IP_PROTO_UDP 17
+
+#define TCP_FLAG_SYN 0x02
+
+#define MRCP_V2_PREFIX "MRCP/2.0 "
+#define MRCP_V2_PREFIX_LENGTH (sizeof(MRCP_V2_PREFIX)-1)
+
+/** Max length of MRCPv2 message accepted */
+#define MRCP_MAX_MESSAGE_LENGTH (16 * 1024 * 1024)
+
+/** UDP datagram or reassembled MRCP message of capture */
+typedef struct replay_record_t replay_record_t;
+struct replay_record_t {
+	apr_time_t      time;
+	apr_uint32_t    src_addr;
+	apr_port_t      src_port;
+	apr_uint32_t    dst_addr;
+	apr_port_t      dst_port;
+	apt_str_t       data;
+	/** Parsed message (MRCP only) */
+	mrcp_message_t *message;
+	apr_size_t      seq;
+};
+
+/** Key of TCP flow (a direction of connection) */
+typedef struct replay_flow_key_t replay_flow_key_t;
+struct replay_flow_key_t {
+	apr_uint32_t src_addr;
+	apr_uint32_t dst_addr;
+	apr_port_t   src_port;
+	apr_port_t   dst_port;
+};
+
+/** TCP flow reassembled */
+typedef struct replay_flow_t replay_flow_t;
+struct replay_flow_t {
+	replay_flow_key_t key;
+	/** Whether the sequence is known */
+	apt_bool_t        synced;
+	/** Whether the flow carries anything but MRCPv2 */
+	apt_bool_t        ignored;
+	apr_uint32_t      next_seq;
+	char             *buf;
+	apr_size_t        length;
+	apr_size_t        capacity;
+};
+
+/** Call being extracted */
+typedef struct replay_call_builder_t replay_call_builder_t;
+struct replay_call_builder_t {
+	replay_call_t *call;
+	apr_uint32_t   client_addr;
+	apr_uint32_t   server_addr;
+	/** Server RTP address of the SDP answer */
+	apr_uint32_t   media_addr;
+	apr_time_t     start;
+	apr_time_t     last;
+};
+
+/** Capture loader */
+typedef struct replay_loader_t replay_loader_t;
+struct replay_loader_t {
+	const char                    *path;
+	const mrcp_resource_factory_t *factory;
+	mrcp_parser_t                 *parser;
+	apr_hash_t                    *flows;
+	/** SIP datagrams (replay_record_t) */
+	apr_array_header_t            *sip;
+	/** Other UDP datagrams (replay_record_t) */
+	apr_array_header_t            *udp;
+	/** MRCP messages (replay_record_t) */
+	apr_array_header_t            *mrcp;
+	apr_size_t                     seq;
+	apr_size_t                     skipped;
+	apr_pool_t                    *pool;
+};
+
+static const char *request_states[] = {"COMPLETE", "IN-PROGRESS", "PENDING"};
+
+static APR_INLINE apr_uint16_t be16_get(const unsigned char *p)
+{
+	return (apr_uint16_t)((p[0] << 8) | p[1]);
+}
+
+static APR_INLINE apr_uint32_t be32_get(const unsigned char *p)
+{
+	return ((apr_uint32_t)p[0] << 24) | ((apr_uint32_t)p[1] << 16) | ((apr_uint32_t)p[2] << 8) | p[3];
+}
+
+static APR_INLINE apr_uint32_t pcap32_get(const unsigned char *p, apt_bool_t swapped)
+{
+	if(swapped == TRUE) {
+		return be32_get(p);
+	}
+	return ((apr_uint32_t)p[3] << 24) | ((apr_uint32_t)p[2] << 16) | ((apr_uint32_t)p[1] << 8) | p[0];
+}
+
+static const char* ip_string_get(apr_uint32_t addr, apr_pool_t *pool)
+{
+	return apr_psprintf(pool,"%u.%u.%u.%u",
+		(addr >> 24) & 0xff, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff);
+}
+
+static apr_uint32_t ip_string_parse(const char *str)
+{
+	unsigned int a, b, c, d;
+	if(!str || sscanf(str,"%u.%u.%u.%u",&a,&b,&c,&d) != 4) {
+		return 0;
+	}
+	return ((apr_uint32_t)a << 24) | ((apr_uint32_t)b << 16) | ((apr_uint32_t)c << 8) | d;
+}
+
+static replay_record_t* replay_record_add(replay_loader_t *loader, apr_array_header_t *records, apr_time_t time, const char *data, apr_size_t size)
+{
+	replay_record_t *record = apr_array_push(records);
+	char *buf = apr_palloc(loader->pool,size + 1);
+	memcpy(buf,data,size);
+	buf[size] = '\0';
+	record->time = time;
+	record->src_addr = record->dst_addr = 0;
+	record->src_port = record->dst_port = 0;
+	record->data.buf = buf;
+	record->data.length = size;
+	record->message = NULL;
+	record->seq = loader->seq++;
+	return record;
+}
+
+/** Check whether the datagram is a SIP message, by the start-line */
+static apt_bool_t sip_message_check(const char *data, apr_size_t size)
+{
+	const char *eol;
+	if(size >= 8 && memcmp(data,"SIP/2.0 ",8) == 0) {
+		return TRUE;
+	}
+	eol = memchr(data,'\r',size > 256 ? 256 : size);
+	if(eol && eol - data > 8 && memcmp(eol - 8," SIP/2.0",8) == 0) {
+		return TRUE;
+	}
+	return FALSE;
+}
+
+const char* replay_sip_header_get(const char *msg, const char *name, const char *compact_name, apr_pool_t *pool)
+{
+	const char *line = strstr(msg,"\r\n");
+	while(line) {
+		const char *colon;
+		const char *name_end;
+		const char *value;
+		const char *eol;
+		line += 2;
+		if(*line == '\r' || *line == '\0') {
+			/* end of header */
+			break;
+		}
+		eol = strstr(line,"\r\n");
+		if(!eol) {
+			eol = line + strlen(line);
+		}
+		colon = memchr(line,':',eol - line);
+		if(colon) {
+			name_end = colon;
+			while(name_end > line && (name_end[-1] == ' ' || name_end[-1] == '\t')) {
+				name_end--;
+			}
+			if((strncasecmp(line,name,name_end - line) == 0 && name[name_end - line] == '\0') ||
+				(compact_name && strncasecmp(line,compact_name,name_end - line) == 0 && compact_name[name_end - line] == '\0')) {
+				value = colon + 1;
+				while(value < eol && (*value == ' ' || *value == '\t')) {
+					value++;
+				}
+				return apr_pstrndup(pool,value,eol - value);
+			}
+		}
+		line = *eol ? eol : NULL;
+	}
+	return NULL;
+}
+
+const char* replay_sip_body_get(const char *msg)
+{
+	const char *body = strstr(msg,"\r\n\r\n");
+	if(!body || body[4] == '\0') {
+		return NULL;
+	}
+	return body + 4;
+}
+
+/** Get the value of the first SDP line starting with the prefix */
+static const char* sdp_line_get(const char *sdp, const char *prefix, apr_pool_t *pool)
+{
+	apr_size_t prefix_length = strlen(prefix);
+	const char *line = sdp;
+	while(line && *line != '\0') {
+		const char *eol = strpbrk(line,"\r\n");
+		if(strncmp(line,prefix,prefix_length) == 0) {
+			line += prefix_length;
+			return eol ? apr_pstrndup(pool,line,eol - line) : apr_pstrdup(pool,line);
+		}
+		if(!eol) {
+			break;
+		}
+		line = eol + strspn(eol,"\r\n");
+	}
+	return NULL;
+}
+
+apr_size_t replay_mrcp_length_get(const char *buf, apr_size_t length)
+{
+	apr_size_t message_length = 0;
+	apr_size_t i;
+	if(length < MRCP_V2_PREFIX_LENGTH || memcmp(buf,MRCP_V2_PREFIX,MRCP_V2_PREFIX_LENGTH) != 0) {
+		return 0;
+	}
+	for(i = MRCP_V2_PREFIX_LENGTH; i < length; i++) {
+		if(buf[i] == ' ') {
+			if(i == MRCP_V2_PREFIX_LENGTH || message_length < i) {
+				return 0;
+			}
+			return message_length;
+		}
+		if(buf[i] < '0' || buf[i] > '9' || message_length > MRCP_MAX_MESSAGE_LENGTH) {
+			return 0;
+		}
+		message_length = message_length * 10 + (buf[i] - '0');
+	}
+	/* the length is incomplete */
+	return 0;
+}
+
+const char* replay_mrcp_outcome_get(const mrcp_message_t *message, apr_pool_t *pool)
+{
+	const mrcp_start_line_t *start_line = &message->start_line;
+	const char *state = start_line->request_state < MRCP_REQUEST_STATE_COUNT ?
+		request_states[start_line->request_state] : "UNKNOWN";
+	if(start_line->message_type == MRCP_MESSAGE_TYPE_EVENT) {
+		/* the completion cause is what tells the outcome of the request */
+		apt_header_field_t *header_field = NULL;
+		const char *cause = NULL;
+		while((header_field = mrcp_message_next_header_field_get(message,header_field)) != NULL) {
+			if(strncasecmp(header_field->name.buf,"Completion-Cause",header_field->name.length) == 0 &&
+				header_field->name.length == sizeof("Completion-Cause")-1) {
+				/* the code only, the reason phrase may vary */
+				apr_size_t length = strcspn(header_field->value.buf," ");
+				if(length > header_field->value.length) {
+					length = header_field->value.length;
+				}
+				cause = apr_pstrndup(pool,header_field->value.buf,length);
+				break;
+			}
+		}
+		return apr_psprintf(pool,"MRCP %"MRCP_REQUEST_ID_FMT" %.*s %s%s%s",
+			start_line->request_id,
+			(int)start_line->method_name.length,start_line->method_name.buf,
+			state,
+			cause ? " " : "",
+			cause ? cause : "");
+	}
+	return apr_psprintf(pool,"MRCP %"MRCP_REQUEST_ID_FMT" %d %s",
+		start_line->request_id,
+		start_line->status_code,
+		state);
+}
+
+const char* replay_sip_outcome_get(const char *method, int status_code, apr_pool_t *pool)
+{
+	return apr_psprintf(pool,"SIP %s %d",method,status_code);
+}
+
+/** Parse MRCPv2 message framed out of TCP flow */
+static void replay_mrcp_message_add(replay_loader_t *loader, replay_flow_t *flow, apr_time_t time, apr_size_t length)
+{
+	apt_text_stream_t stream;
+	mrcp_message_t *message = NULL;
+	replay_record_t *record = replay_record_add(loader,loader->mrcp,time,flow->buf,length);
+
+	apt_text_stream_init(&stream,record->data.buf,record->data.length);
+	if(mrcp_parser_run(loader->parser,&stream,&message) != APT_MESSAGE_STATUS_COMPLETE || !message) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse MRCP Message [%s] [%"APR_SIZE_T_FMT" bytes]",
+			loader->path,length);
+		/* start over, the parser may be left in the middle of a message */
+		loader->parser = mrcp_parser_create(loader->factory,loader->pool);
+		apr_array_pop(loader->mrcp);
+		return;
+	}
+	record->src_addr = flow->key.src_addr;
+	record->src_port = flow->key.src_port;
+	record->dst_addr = flow->key.dst_addr;
+	record->dst_port = flow->key.dst_port;
+	record->message = message;
+}
+
+/** Frame MRCPv2 messages out of the data reassembled */
+static void replay_flow_process(replay_loader_t *loader, replay_flow_t *flow, apr_time_t time)
+{
+	apr_size_t offset = 0;
+	while(flow->length - offset >= MRCP_V2_PREFIX_LENGTH) {
+		char *buf = flow->buf + offset;
+		apr_size_t length = flow->length - offset;
+		apr_size_t message_length;
+		if(memcmp(buf,MRCP_V2_PREFIX,MRCP_V2_PREFIX_LENGTH) != 0) {
+			/* out of sync, skip to the next start-line */
+			char *next = NULL;
+			apr_size_t i;
+			for(i = 1; i + MRCP_V2_PREFIX_LENGTH <= length; i++) {
+				if(memcmp(buf + i,MRCP_V2_PREFIX,MRCP_V2_PREFIX_LENGTH) == 0) {
+					next = buf + i;
+					break;
+				}
+			}
+			offset += next ? (apr_size_t)(next - buf) : length - MRCP_V2_PREFIX_LENGTH + 1;
+			continue;
+		}
+
+		message_length = replay_mrcp_length_get(buf,length);
+		if(!message_length) {
+			if(memchr(buf,'\n',length)) {
+				/* the start-line is complete but invalid */
+				offset += MRCP_V2_PREFIX_LENGTH;
+				continue;
+			}
+			break;
+		}
+		if(message_length > length) {
+			break;
+		}
+		replay_mrcp_message_add(loader,flow,time,message_length);
+		offset += message_length;
+	}
+
+	if(offset) {
+		flow->length -= offset;
+		memmove(flow->buf,flow->buf + offset,flow->length);
+	}
+}
+
+/** Reassemble TCP segment into its flow */
+static void replay_tcp_segment_process(replay_loader_t *loader, const replay_flow_key_t *key, apr_time_t time,
+									   const unsigned char *segment, apr_size_t size)
+{
+	replay_flow_t *flow;
+	apr_size_t header_length;
+	apr_uint32_t seq;
+	apr_int32_t delta;
+	const unsigned char *data;
+	apr_size_t length;
+
+	if(size < 20) {
+		return;
+	}
+	header_length = (segment[12] >> 4) * 4;
+	if(header_length < 20 || header_length > size) {
+		return;
+	}
+	seq = be32_get(segment + 4);
+	data = segment + header_length;
+	length = size - header_length;
+
+	flow = apr_hash_get(loader->flows,key,sizeof(*key));
+	if(!flow) {
+		flow = apr_pcalloc(loader->pool,sizeof(replay_flow_t));
+		flow->key = *key;
+		apr_hash_set(loader->flows,&flow->key,sizeof(flow->key),flow);
+	}
+	if(segment[13] & TCP_FLAG_SYN) {
+		flow->synced = TRUE;
+		flow->next_seq = seq + 1;
+		flow->length = 0;
+		return;
+	}
+	if(!length || flow->ignored == TRUE) {
+		return;
+	}
+	if(flow->synced == FALSE) {
+		/* the capture started in the middle of the connection */
+		flow->synced = TRUE;
+		flow->next_seq = seq;
+	}
+
+	delta = (apr_int32_t)(seq - flow->next_seq);
+	if(delta < 0) {
+		/* retransmission, take the new data only */
+		if((apr_size_t)-delta >= length) {
+			return;
+		}
+		data += -delta;
+		length -= -delta;
+	}
+	else if(delta > 0) {
+		/* segments are missing, resync at the next start-line */
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Missing TCP Data [%s] [%d bytes]",loader->path,delta);
+		flow->length = 0;
+	}
+	flow->next_seq = seq + (apr_uint32_t)(size - header_length);
+
+	if(!flow->length && flow->buf == NULL &&
+		(length < MRCP_V2_PREFIX_LENGTH || memcmp(data,MRCP_V2_PREFIX,MRCP_V2_PREFIX_LENGTH) != 0)) {
+		/* the first data of the flow is not MRCPv2 */
+		flow->ignored = TRUE;
+		return;
+	}
+
+	if(flow->length + length > flow->capacity) {
+		apr_size_t capacity = flow->capacity ? flow->capacity : 4096;
+		char *buf;
+		while(capacity < flow->length + length) {
+			capacity *= 2;
+		}
+		buf = apr_palloc(loader->pool,capacity);
+		if(flow->length) {
+			memcpy(buf,flow->buf,flow->length);
+		}
+		flow->buf = buf;
+		flow->capacity = capacity;
+	}
+	memcpy(flow->buf + flow->length,data,length);
+	flow->length += length;
+	replay_flow_process(loader,flow,time);
+}
+
+/** Process IPv4 packet */
+static void replay_ip_packet_process(replay_loader_t *loader, apr_time_t time, const unsigned char *packet, apr_size_t size)
+{
+	apr_size_t header_length;
+	apr_size_t total_length;
+	replay_flow_key_t key;
+	const unsigned char *payload;
+	apr_size_t payload_size;
+
+	if(size < 20 || (packet[0] >> 4) != 4) {
+		loader->skipped++;
+		return;
+	}
+	header_length = (packet[0] & 0x0f) * 4;
+	total_length = be16_get(packet + 2);
+	if(header_length < 20 || total_length < header_length) {
+		loader->skipped++;
+		return;
+	}
+	if(total_length < size) {
+		/* trailer (padding) of the link layer */
+		size = total_length;
+	}
+	if(be16_get(packet + 6) & 0x3fff) {
+		/* fragments are not reassembled */
+		loader->skipped++;
+		return;
+	}
+
+	memset(&key,0,sizeof(key));
+	key.src_addr = be32_get(packet + 12);
+	key.dst_addr = be32_get(packet + 16);
+	payload = packet + header_length;
+	payload_size = size - header_length;
+
+	if(packet[9] == IP_PROTO_UDP) {
+		replay_record_t *record;
+		const char *data;
+		apr_size_t data_size;
+		if(payload_size < 8) {
+			return;
+		}
+		key.src_port = be16_get(payload);
+		key.dst_port = be16_get(payload + 2);
+		data = (const char*)payload + 8;
+		data_size = payload_size - 8;
+		if(!data_size) {
+			return;
+		}
+		record = replay_record_add(loader,
+					sip_message_check(data,data_size) == TRUE ? loader->sip : loader->udp,
+					time,data,data_size);
+		record->src_addr = key.src_addr;
+		record->src_port = key.src_port;
+		record->dst_addr = key.dst_addr;
+		record->dst_port = key.dst_port;
+	}
+	else if(packet[9] == IP_PROTO_TCP) {
+		if(payload_size < 20) {
+			return;
+		}
+		key.src_port = be16_get(payload);
+		key.dst_port = be16_get(payload + 2);
+		replay_tcp_segment_process(loader,&key,time,payload,payload_size);
+	}
+}
+
+/** Read packets of pcap file */
+static apt_bool_t replay_pcap_read(replay_loader_t *loader, FILE *file)
+{
+	unsigned char header[24];
+	unsigned char *packet;
+	apt_bool_t swapped;
+	apt_bool_t nsec;
+	apr_uint32_t magic;
+	apr_uint32_t linktype;
+
+	if(fread(header,1,sizeof(header),file) != sizeof(header)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Read Capture Header [%s]",loader->path);
+		return FALSE;
+	}
+	magic = pcap32_get(header,FALSE);
+	if(magic == PCAP_MAGIC || magic == PCAP_MAGIC_NSEC) {
+		swapped = FALSE;
+	}
+	else {
+		magic = pcap32_get(header,TRUE);
+		if(magic != PCAP_MAGIC && magic != PCAP_MAGIC_NSEC) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unsupported Capture Format [%s] (pcapng is to be converted to pcap)",loader->path);
+			return FALSE;
+		}
+		swapped = TRUE;
+	}
+	nsec = (magic == PCAP_MAGIC_NSEC) ? TRUE : FALSE;
+	linktype = pcap32_get(header + 20,swapped) & 0xffff;
+	if(linktype != PCAP_LINKTYPE_NULL && linktype != PCAP_LINKTYPE_ETHERNET && linktype != PCAP_LINKTYPE_RAW_BSD &&
+		linktype != PCAP_LINKTYPE_RAW && linktype != PCAP_LINKTYPE_LINUX_SLL) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unsupported Link Type [%s] [%u]",loader->path,linktype);
+		return FALSE;
+	}
+
+	packet = apr_palloc(loader->pool,PCAP_MAX_SNAPLEN);
+	while(fread(header,1,16,file) == 16) {
+		apr_uint32_t sec = pcap32_get(header,swapped);
+		apr_uint32_t frac = pcap32_get(header + 4,swapped);
+		apr_size_t caplen = pcap32_get(header + 8,swapped);
+		apr_time_t time = (apr_time_t)sec * APR_USEC_PER_SEC + (nsec == TRUE ? frac / 1000 : frac);
+		const unsigned char *ip;
+		apr_size_t offset;
+		apr_uint16_t ethertype = 0x0800;
+
+		if(caplen > PCAP_MAX_SNAPLEN) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Capture Record [%s] [%"APR_SIZE_T_FMT" bytes]",loader->path,caplen);
+			return FALSE;
+		}
+		if(fread(packet,1,caplen,file) != caplen) {
+			/* truncated capture */
+			break;
+		}
+
+		switch(linktype) {
+			case PCAP_LINKTYPE_NULL:
+				offset = 4;
+				break;
+			case PCAP_LINKTYPE_ETHERNET:
+				offset = 14;
+				if(caplen >= offset) {
+					ethertype = be16_get(packet + 12);
+					/* VLAN tags */
+					while((ethertype == 0x8100 || ethertype == 0x88a8) && caplen >= offset + 4) {
+						ethertype = be16_get(packet + offset + 2);
+						offset += 4;
+					}
+				}
+				break;
+			case PCAP_LINKTYPE_LINUX_SLL:
+				offset = 16;
+				if(caplen >= offset) {
+					ethertype = be16_get(packet + 14);
+				}
+				break;
+			default:
+				offset = 0;
+				break;
+		}
+		if(caplen < offset || ethertype != 0x0800) {
+			loader->skipped++;
+			continue;
+		}
+		ip = packet + offset;
+		replay_ip_packet_process(loader,time,ip,caplen - offset);
+	}
+	return TRUE;
+}
+
+static replay_packet_t* replay_packet_add(replay_call_builder_t *builder, replay_packet_type_e type, const replay_record_t *record)
+{
+	replay_packet_t *packet = apr_array_push(builder->call->packets);
+	packet->type = type;
+	packet->time = record->time - builder->start;
+	packet->data = record->data;
+	packet->seq = record->seq;
+	if(record->time > builder->last) {
+		builder->last = record->time;
+	}
+	return packet;
+}
+
+static void replay_outcome_add(replay_call_builder_t *builder, const char *outcome, const replay_record_t *record)
+{
+	APR_ARRAY_PUSH(builder->call->outcomes,const char*) = outcome;
+	if(record->time > builder->last) {
+		builder->last = record->time;
+	}
+}
+
+/** Take the media of the SDP offer (client) or answer (server) */
+static void replay_sdp_process(replay_call_builder_t *builder, const char *sdp, apt_bool_t offer, apr_pool_t *pool)
+{
+	const char *audio = sdp_line_get(sdp,"m=audio ",pool);
+	if(offer == TRUE) {
+		if(audio && !builder->call->client_rtp_port) {
+			builder->call->client_rtp_port = (apr_port_t)atoi(audio);
+		}
+	}
+	else {
+		const char *connection = sdp_line_get(sdp,"c=IN IP4 ",pool);
+		const char *channel = sdp_line_get(sdp,"a=channel:",pool);
+		if(audio) {
+			builder->call->server_rtp_port = (apr_port_t)atoi(audio);
+		}
+		builder->media_addr = ip_string_parse(connection);
+		if(!builder->media_addr) {
+			builder->media_addr = builder->server_addr;
+		}
+		if(channel) {
+			/* channel-id is session-id@resource-name */
+			const char *at = strchr(channel,'@');
+			builder->call->session_id = at ? apr_pstrndup(pool,channel,at - channel) : channel;
+		}
+	}
+}
+
+/** Split SIP messages into calls */
+static void replay_sip_records_process(replay_loader_t *loader, apr_hash_t *builders, apr_array_header_t *order)
+{
+	int i;
+	for(i = 0; i < loader->sip->nelts; i++) {
+		const replay_record_t *record = &APR_ARRAY_IDX(loader->sip,i,replay_record_t);
+		const char *msg = record->data.buf;
+		const char *call_id = replay_sip_header_get(msg,"Call-ID","i",loader->pool);
+		apt_bool_t request = strncmp(msg,"SIP/2.0 ",8) != 0 ? TRUE : FALSE;
+		replay_call_builder_t *builder;
+		const char *body;
+
+		if(!call_id) {
+			continue;
+		}
+		builder = apr_hash_get(builders,call_id,APR_HASH_KEY_STRING);
+		if(!builder) {
+			replay_call_t *call;
+			if(request == FALSE || strncmp(msg,"INVITE ",7) != 0) {
+				continue;
+			}
+			/* the side sending the INVITE is the client */
+			call = apr_pcalloc(loader->pool,sizeof(replay_call_t));
+			call->capture = loader->path;
+			call->call_id = call_id;
+			call->client_ip = ip_string_get(record->src_addr,loader->pool);
+			call->client_sip_port = record->src_port;
+			call->server_ip = ip_string_get(record->dst_addr,loader->pool);
+			call->server_sip_port = record->dst_port;
+			call->packets = apr_array_make(loader->pool,64,sizeof(replay_packet_t));
+			call->outcomes = apr_array_make(loader->pool,16,sizeof(const char*));
+
+			builder = apr_pcalloc(loader->pool,sizeof(replay_call_builder_t));
+			builder->call = call;
+			builder->client_addr = record->src_addr;
+			builder->server_addr = record->dst_addr;
+			builder->start = builder->last = record->time;
+			apr_hash_set(builders,call_id,APR_HASH_KEY_STRING,builder);
+			APR_ARRAY_PUSH(order,replay_call_builder_t*) = builder;
+		}
+
+		body = replay_sip_body_get(msg);
+		if(record->src_addr == builder->client_addr && record->src_port == builder->call->client_sip_port) {
+			if(request == TRUE) {
+				replay_packet_add(builder,REPLAY_PACKET_SIP,record);
+				if(body && strncmp(msg,"INVITE ",7) == 0) {
+					replay_sdp_process(builder,body,TRUE,loader->pool);
+				}
+			}
+		}
+		else if(request == FALSE) {
+			/* response to the client */
+			int status_code = atoi(msg + 8);
+			const char *cseq = replay_sip_header_get(msg,"CSeq",NULL,loader->pool);
+			const char *method = cseq ? strchr(cseq,' ') : NULL;
+			if(status_code < 200 || !method) {
+				continue;
+			}
+			method++;
+			replay_outcome_add(builder,replay_sip_outcome_get(method,status_code,loader->pool),record);
+			if(body && status_code < 300 && strcmp(method,"INVITE") == 0) {
+				replay_sdp_process(builder,body,FALSE,loader->pool);
+			}
+		}
+	}
+}
+
+/** Assign RTP to calls by the addresses of the SDP offer and answer */
+static void replay_rtp_records_process(replay_loader_t *loader, apr_array_header_t *order)
+{
+	apr_hash_t *endpoints = apr_hash_make(loader->pool);
+	replay_flow_key_t key;
+	int i;
+
+	for(i = 0; i < order->nelts; i++) {
+		replay_call_builder_t *builder = APR_ARRAY_IDX(order,i,replay_call_builder_t*);
+		if(!builder->call->client_rtp_port || !builder->call->server_rtp_port) {
+			continue;
+		}
+		memset(&key,0,sizeof(key));
+		key.src_addr = builder->client_addr;
+		key.src_port = builder->call->client_rtp_port;
+		key.dst_addr = builder->media_addr;
+		key.dst_port = builder->call->server_rtp_port;
+		apr_hash_set(endpoints,apr_pmemdup(loader->pool,&key,sizeof(key)),sizeof(key),builder);
+	}
+
+	for(i = 0; i < loader->udp->nelts; i++) {
+		const replay_record_t *record = &APR_ARRAY_IDX(loader->udp,i,replay_record_t);
+		replay_call_builder_t *builder;
+		memset(&key,0,sizeof(key));
+		key.src_addr = record->src_addr;
+		key.src_port = record->src_port;
+		key.dst_addr = record->dst_addr;
+		key.dst_port = record->dst_port;
+		builder = apr_hash_get(endpoints,&key,sizeof(key));
+		if(builder && record->time >= builder->start) {
+			replay_packet_add(builder,REPLAY_PACKET_RTP,record);
+		}
+	}
+}
+
+/** Assign MRCP messages to calls by the session-id of the SDP answer */
+static void replay_mrcp_records_process(replay_loader_t *loader, apr_array_header_t *order)
+{
+	apr_hash_t *sessions = apr_hash_make(loader->pool);
+	int i;
+
+	for(i = 0; i < order->nelts; i++) {
+		replay_call_builder_t *builder = APR_ARRAY_IDX(order,i,replay_call_builder_t*);
+		if(builder->call->session_id) {
+			apr_hash_set(sessions,builder->call->session_id,APR_HASH_KEY_STRING,builder);
+		}
+	}
+
+	for(i = 0; i < loader->mrcp->nelts; i++) {
+		const replay_record_t *record = &APR_ARRAY_IDX(loader->mrcp,i,replay_record_t);
+		const mrcp_message_t *message = record->message;
+		replay_call_builder_t *builder = apr_hash_get(sessions,
+									message->channel_id.session_id.buf,
+									message->channel_id.session_id.length);
+		if(!builder) {
+			continue;
+		}
+		if(message->start_line.message_type == MRCP_MESSAGE_TYPE_REQUEST) {
+			replay_packet_add(builder,REPLAY_PACKET_MRCP,record);
+		}
+		else {
+			replay_outcome_add(builder,replay_mrcp_outcome_get(message,loader->pool),record);
+		}
+	}
+}
+
+static int replay_packet_compare(const void *v1, const void *v2)
+{
+	const replay_packet_t *packet1 = v1;
+	const replay_packet_t *packet2 = v2;
+	if(packet1->time != packet2->time) {
+		return packet1->time < packet2->time ? -1 : 1;
+	}
+	return packet1->seq < packet2->seq ? -1 : (packet1->seq > packet2->seq ? 1 : 0);
+}
+
+apt_bool_t replay_capture_load(const char *path, const mrcp_resource_factory_t *factory, apr_array_header_t *calls, apr_pool_t *pool)
+{
+	replay_loader_t loader;
+	apr_hash_t *builders;
+	apr_array_header_t *order;
+	apt_bool_t status;
+	FILE *file;
+	int i;
+
+	file = fopen(path,"rb");
+	if(!file) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open Capture [%s]",path);
+		return FALSE;
+	}
+
+	loader.path = apr_pstrdup(pool,path);
+	loader.factory = factory;
+	loader.parser = mrcp_parser_create(factory,pool);
+	loader.flows = apr_hash_make(pool);
+	loader.sip = apr_array_make(pool,64,sizeof(replay_record_t));
+	loader.udp = apr_array_make(pool,1024,sizeof(replay_record_t));
+	loader.mrcp = apr_array_make(pool,64,sizeof(replay_record_t));
+	loader.seq = 0;
+	loader.skipped = 0;
+	loader.pool = pool;
+
+	status = replay_pcap_read(&loader,file);
+	fclose(file);
+	if(status == FALSE) {
+		return FALSE;
+	}
+
+	builders = apr_hash_make(pool);
+	order = apr_array_make(pool,16,sizeof(replay_call_builder_t*));
+	replay_sip_records_process(&loader,builders,order);
+	replay_rtp_records_process(&loader,order);
+	replay_mrcp_records_process(&loader,order);
+
+	for(i = 0; i < order->nelts; i++) {
+		replay_call_builder_t *builder = APR_ARRAY_IDX(order,i,replay_call_builder_t*);
+		replay_call_t *call = builder->call;
+		qsort(call->packets->elts,call->packets->nelts,sizeof(replay_packet_t),replay_packet_compare);
+		call->duration = builder->last - builder->start;
+		APR_ARRAY_PUSH(calls,replay_call_t*) = call;
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Load Call [%s] [%s] [%d packets] [%d outcomes] [%"APR_TIME_T_FMT" ms]",
+			path,call->call_id,call->packets->nelts,call->outcomes->nelts,apr_time_as_msec(call->duration));
+	}
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Load Capture [%s] [%d calls] [%"APR_SIZE_T_FMT" packets skipped]",
+		path,order->nelts,loader.skipped);
+	return TRUE;
+}
@@ -0,0 +1,638 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <stdlib.h>
+#include <apr_network_io.h>
+#include <apr_poll.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
+#include "replay_session.h"
+#include "mrcp_stream.h"
+#include "apt_log.h"
+
+/** Max size of SIP message received */
+#define SIP_MAX_MESSAGE_SIZE 8192
+
+/** Size of buffer RTP received from server is drained into */
+#define RTP_MAX_PACKET_SIZE 1500
+
+/** What to wait for */
+typedef enum {
+	REPLAY_WAIT_NONE,     /**< only the time */
+	REPLAY_WAIT_ANSWER,   /**< the final response to the INVITE */
+	REPLAY_WAIT_MRCP,     /**< the MRCPv2 connection */
+	REPLAY_WAIT_OUTCOME   /**< the outcome of the capture */
+} replay_wait_e;
+
+/** Replay session */
+typedef struct replay_session_t replay_session_t;
+struct replay_session_t {
+	const replay_call_t   *call;
+	const replay_config_t *config;
+	replay_result_t       *result;
+
+	/** Suffix of the Call-ID and the Via branches of the instance */
+	const char            *suffix;
+	const char            *call_id;
+
+	apr_socket_t          *sip_socket;
+	apr_port_t             sip_port;
+	apr_sockaddr_t        *sip_addr;
+
+	apr_socket_t          *rtp_socket;
+	apr_port_t             rtp_port;
+	apr_sockaddr_t        *rtp_addr;
+
+	apr_socket_t          *mrcp_socket;
+	char                  *mrcp_buf;
+	apr_size_t             mrcp_length;
+	apr_size_t             mrcp_capacity;
+
+	/** Whether the INVITE is answered, with or without success */
+	apt_bool_t             answered;
+	/** Tag of the To header of the answer */
+	const char            *to_tag;
+	/** MRCP session-id of the answer */
+	const char            *session_id;
+	/** Final responses received, by CSeq, to skip retransmissions */
+	apr_hash_t            *responses;
+
+	mrcp_parser_t         *parser;
+	mrcp_generator_t      *generator;
+	apr_pollfd_t           pollfds[3];
+
+	apr_pool_t            *pool;
+};
+
+/** Replace all the occurrences of a string */
+static char* str_replace_all(const char *str, const char *from, const char *to, apr_pool_t *pool)
+{
+	apr_size_t from_length = strlen(from);
+	apr_size_t to_length = strlen(to);
+	apr_size_t count = 0;
+	const char *p;
+	char *result;
+	char *dst;
+
+	if(!from_length || strcmp(from,to) == 0) {
+		return (char*)str;
+	}
+	for(p = strstr(str,from); p; p = strstr(p + from_length,from)) {
+		count++;
+	}
+	if(!count) {
+		return (char*)str;
+	}
+
+	result = apr_palloc(pool,strlen(str) + count * to_length - count * from_length + 1);
+	dst = result;
+	while((p = strstr(str,from)) != NULL) {
+		memcpy(dst,str,p - str);
+		dst += p - str;
+		memcpy(dst,to,to_length);
+		dst += to_length;
+		str = p + from_length;
+	}
+	strcpy(dst,str);
+	return result;
+}
+
+/** Set the Content-Length of SIP message to the length of its body */
+static char* sip_content_length_set(const char *msg, apr_pool_t *pool)
+{
+	const char *body = strstr(msg,"\r\n\r\n");
+	const char *line;
+	const char *value = NULL;
+	const char *eol;
+	if(!body) {
+		return (char*)msg;
+	}
+	body += 4;
+	for(line = strstr(msg,"\r\n"); line && line < body - 2; line = strstr(line,"\r\n")) {
+		line += 2;
+		if(strncasecmp(line,"Content-Length:",15) == 0) {
+			value = line + 15;
+			break;
+		}
+		if(strncasecmp(line,"l:",2) == 0) {
+			value = line + 2;
+			break;
+		}
+	}
+	if(!value) {
+		return (char*)msg;
+	}
+	eol = strstr(value,"\r\n");
+	return apr_psprintf(pool,"%.*s %"APR_SIZE_T_FMT"%s",
+		(int)(value - msg),msg,
+		strlen(body),
+		eol);
+}
+
+/** Rewrite SIP request of the capture for the instance */
+static char* replay_sip_rewrite(replay_session_t *session, const replay_packet_t *packet, apr_pool_t *pool)
+{
+	const replay_call_t *call = session->call;
+	const replay_config_t *config = session->config;
+	char *msg = packet->data.buf;
+	const char *to;
+
+	/* addresses with ports first, the bare ones (SDP) then */
+	msg = str_replace_all(msg,
+			apr_psprintf(pool,"%s:%hu",call->client_ip,call->client_sip_port),
+			apr_psprintf(pool,"%s:%hu",config->local_ip,session->sip_port),
+			pool);
+	msg = str_replace_all(msg,
+			apr_psprintf(pool,"%s:%hu",call->server_ip,call->server_sip_port),
+			apr_psprintf(pool,"%s:%hu",config->target_ip,config->target_port),
+			pool);
+	msg = str_replace_all(msg,call->client_ip,config->local_ip,pool);
+	msg = str_replace_all(msg,call->server_ip,config->target_ip,pool);
+
+	/* concurrent instances make dialogs and transactions of their own */
+	msg = str_replace_all(msg,call->call_id,session->call_id,pool);
+	msg = str_replace_all(msg,"branch=z9hG4bK",apr_pstrcat(pool,"branch=z9hG4bK",session->suffix,NULL),pool);
+
+	/* in-dialog requests take the tag of the answer */
+	to = replay_sip_header_get(msg,"To","t",pool);
+	if(to && session->to_tag) {
+		const char *tag = strstr(to,"tag=");
+		if(tag) {
+			apr_size_t length = strcspn(tag + 4,";> \t");
+			msg = str_replace_all(msg,to,
+					apr_psprintf(pool,"%.*s%s%s",(int)(tag + 4 - to),to,session->to_tag,tag + 4 + length),
+					pool);
+		}
+	}
+
+	if(call->client_rtp_port) {
+		msg = str_replace_all(msg,
+				apr_psprintf(pool,"m=audio %hu ",call->client_rtp_port),
+				apr_psprintf(pool,"m=audio %hu ",session->rtp_port),
+				pool);
+	}
+	return sip_content_length_set(msg,pool);
+}
+
+/** Respond to request of the server (e.g. BYE), echoing the transaction and dialog headers */
+static void replay_sip_request_respond(replay_session_t *session, const char *msg, apr_sockaddr_t *from)
+{
+	static const char *headers[] = {"Via", "From", "To", "Call-ID", "CSeq"};
+	static const char *compact_headers[] = {"v", "f", "t", "i", NULL};
+	char *response = "SIP/2.0 200 OK\r\n";
+	apr_size_t length;
+	apr_size_t i;
+	for(i = 0; i < sizeof(headers) / sizeof(headers[0]); i++) {
+		const char *value = replay_sip_header_get(msg,headers[i],compact_headers[i],session->pool);
+		if(value) {
+			response = apr_pstrcat(session->pool,response,headers[i],": ",value,"\r\n",NULL);
+		}
+	}
+	response = apr_pstrcat(session->pool,response,"Content-Length: 0\r\n\r\n",NULL);
+	length = strlen(response);
+	apr_socket_sendto(session->sip_socket,from,0,response,&length);
+}
+
+static void replay_outcome_add(replay_session_t *session, const char *outcome)
+{
+	APR_ARRAY_PUSH(session->result->outcomes,const char*) = outcome;
+}
+
+/** Connect to the MRCPv2 port of the answer */
+static void replay_mrcp_connect(replay_session_t *session, const char *ip, apr_port_t port)
+{
+	apr_sockaddr_t *sockaddr;
+	if(apr_sockaddr_info_get(&sockaddr,ip,APR_INET,port,0,session->pool) != APR_SUCCESS ||
+		apr_socket_create(&session->mrcp_socket,sockaddr->family,SOCK_STREAM,APR_PROTO_TCP,session->pool) != APR_SUCCESS) {
+		session->mrcp_socket = NULL;
+		return;
+	}
+	apr_socket_opt_set(session->mrcp_socket,APR_TCP_NODELAY,1);
+	apr_socket_timeout_set(session->mrcp_socket,session->config->timeout);
+	if(apr_socket_connect(session->mrcp_socket,sockaddr) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Connect MRCP [%s] %s:%hu",session->call_id,ip,port);
+		apr_socket_close(session->mrcp_socket);
+		session->mrcp_socket = NULL;
+	}
+}
+
+/** Take the media of the SDP answer */
+static void replay_answer_process(replay_session_t *session, const char *sdp)
+{
+	const char *ip = session->config->target_ip;
+	const char *line;
+	apr_port_t audio_port = 0;
+	apr_port_t mrcp_port = 0;
+	for(line = sdp; line && *line != '\0'; line = strstr(line,"\n")) {
+		if(*line == '\n') {
+			line++;
+		}
+		if(strncmp(line,"c=IN IP4 ",9) == 0 && ip == session->config->target_ip) {
+			ip = apr_pstrndup(session->pool,line + 9,strcspn(line + 9,"\r\n/ "));
+		}
+		else if(strncmp(line,"m=audio ",8) == 0 && !audio_port) {
+			audio_port = (apr_port_t)atoi(line + 8);
+		}
+		else if(strncmp(line,"m=application ",14) == 0 && !mrcp_port) {
+			mrcp_port = (apr_port_t)atoi(line + 14);
+		}
+		else if(strncmp(line,"a=channel:",10) == 0 && !session->session_id) {
+			session->session_id = apr_pstrndup(session->pool,line + 10,strcspn(line + 10,"@\r\n"));
+		}
+	}
+
+	if(audio_port && apr_sockaddr_info_get(&session->rtp_addr,ip,APR_INET,audio_port,0,session->pool) != APR_SUCCESS) {
+		session->rtp_addr = NULL;
+	}
+	if(mrcp_port) {
+		/* a connection per call, whatever the capture shares */
+		replay_mrcp_connect(session,ip,mrcp_port);
+	}
+}
+
+/** Receive SIP message from the server */
+static void replay_sip_receive(replay_session_t *session)
+{
+	char buf[SIP_MAX_MESSAGE_SIZE];
+	apr_size_t length = sizeof(buf) - 1;
+	apr_sockaddr_t *from;
+	const char *call_id;
+	const char *cseq;
+	const char *method;
+	int status_code;
+
+	apr_sockaddr_info_get(&from,NULL,APR_INET,0,0,session->pool);
+	if(apr_socket_recvfrom(from,session->sip_socket,0,buf,&length) != APR_SUCCESS || !length) {
+		return;
+	}
+	buf[length] = '\0';
+	call_id = replay_sip_header_get(buf,"Call-ID","i",session->pool);
+	if(!call_id || strcmp(call_id,session->call_id) != 0) {
+		return;
+	}
+	if(strncmp(buf,"SIP/2.0 ",8) != 0) {
+		if(strncmp(buf,"ACK ",4) != 0) {
+			replay_sip_request_respond(session,buf,from);
+		}
+		return;
+	}
+
+	status_code = atoi(buf + 8);
+	cseq = replay_sip_header_get(buf,"CSeq",NULL,session->pool);
+	method = cseq ? strchr(cseq,' ') : NULL;
+	if(status_code < 200 || !method || apr_hash_get(session->responses,cseq,APR_HASH_KEY_STRING)) {
+		return;
+	}
+	method++;
+	apr_hash_set(session->responses,cseq,APR_HASH_KEY_STRING,cseq);
+	replay_outcome_add(session,replay_sip_outcome_get(method,status_code,session->result->outcomes->pool));
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Receive SIP Response [%s] [%s %d]",session->call_id,method,status_code);
+
+	if(strcmp(method,"INVITE") == 0 && session->answered == FALSE) {
+		session->answered = TRUE;
+		if(status_code < 300) {
+			const char *to = replay_sip_header_get(buf,"To","t",session->pool);
+			const char *tag = to ? strstr(to,"tag=") : NULL;
+			const char *body = replay_sip_body_get(buf);
+			if(tag) {
+				session->to_tag = apr_pstrndup(session->pool,tag + 4,strcspn(tag + 4,";> \t"));
+			}
+			if(body) {
+				replay_answer_process(session,body);
+			}
+		}
+	}
+}
+
+/** Receive MRCPv2 messages from the server */
+static void replay_mrcp_receive(replay_session_t *session)
+{
+	apr_size_t length;
+	apr_size_t offset = 0;
+	apr_status_t status;
+
+	if(session->mrcp_capacity - session->mrcp_length < 1024) {
+		apr_size_t capacity = session->mrcp_capacity ? session->mrcp_capacity * 2 : 8192;
+		char *buf = apr_palloc(session->pool,capacity);
+		if(session->mrcp_length) {
+			memcpy(buf,session->mrcp_buf,session->mrcp_length);
+		}
+		session->mrcp_buf = buf;
+		session->mrcp_capacity = capacity;
+	}
+	length = session->mrcp_capacity - session->mrcp_length - 1;
+	status = apr_socket_recv(session->mrcp_socket,session->mrcp_buf + session->mrcp_length,&length);
+	if(status != APR_SUCCESS || !length) {
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"MRCP Connection Closed by Server [%s]",session->call_id);
+		apr_socket_close(session->mrcp_socket);
+		session->mrcp_socket = NULL;
+		return;
+	}
+	session->mrcp_length += length;
+
+	for(;;) {
+		apt_text_stream_t stream;
+		mrcp_message_t *message = NULL;
+		char *buf = session->mrcp_buf + offset;
+		apr_size_t message_length = replay_mrcp_length_get(buf,session->mrcp_length - offset);
+		if(!message_length || message_length > session->mrcp_length - offset) {
+			break;
+		}
+		apt_text_stream_init(&stream,buf,message_length);
+		if(mrcp_parser_run(session->parser,&stream,&message) == APT_MESSAGE_STATUS_COMPLETE && message) {
+			const char *outcome = replay_mrcp_outcome_get(message,session->result->outcomes->pool);
+			apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Receive MRCP Message [%s] [%s]",session->call_id,outcome);
+			replay_outcome_add(session,outcome);
+		}
+		else {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse MRCP Message [%s]",session->call_id);
+			session->parser = mrcp_parser_create(session->config->factory,session->pool);
+		}
+		offset += message_length;
+	}
+	if(offset) {
+		session->mrcp_length -= offset;
+		memmove(session->mrcp_buf,session->mrcp_buf + offset,session->mrcp_length);
+	}
+}
+
+/** Drain RTP sent by the server */
+static void replay_rtp_receive(replay_session_t *session)
+{
+	char buf[RTP_MAX_PACKET_SIZE];
+	apr_size_t length = sizeof(buf);
+	apr_socket_recv(session->rtp_socket,buf,&length);
+}
+
+static apt_bool_t replay_condition_check(replay_session_t *session, replay_wait_e condition)
+{
+	switch(condition) {
+		case REPLAY_WAIT_ANSWER:
+			return session->answered;
+		case REPLAY_WAIT_MRCP:
+			return (session->mrcp_socket || session->answered == TRUE) ? TRUE : FALSE;
+		case REPLAY_WAIT_OUTCOME:
+			return session->result->outcomes->nelts >= session->call->outcomes->nelts ? TRUE : FALSE;
+		default:
+			break;
+	}
+	return FALSE;
+}
+
+/** Process messages received till the condition is met or the deadline */
+static apt_bool_t replay_wait(replay_session_t *session, apr_time_t deadline, replay_wait_e condition)
+{
+	for(;;) {
+		apr_int32_t count = 2;
+		apr_int32_t nsds = 0;
+		apr_interval_time_t timeout;
+		apr_time_t now;
+		apr_int32_t i;
+
+		if(condition != REPLAY_WAIT_NONE && replay_condition_check(session,condition) == TRUE) {
+			return TRUE;
+		}
+		now = apr_time_now();
+		if(now >= deadline) {
+			return condition == REPLAY_WAIT_NONE ? TRUE : FALSE;
+		}
+		timeout = deadline - now;
+
+		if(session->mrcp_socket) {
+			session->pollfds[2].desc.s = session->mrcp_socket;
+			count = 3;
+		}
+		if(apr_poll(session->pollfds,count,&nsds,timeout) != APR_SUCCESS) {
+			continue;
+		}
+		for(i = 0; i < count; i++) {
+			if(!(session->pollfds[i].rtnevents & (APR_POLLIN | APR_POLLHUP | APR_POLLERR))) {
+				continue;
+			}
+			session->pollfds[i].rtnevents = 0;
+			if(i == 0) {
+				replay_sip_receive(session);
+			}
+			else if(i == 1) {
+				replay_rtp_receive(session);
+			}
+			else if(session->mrcp_socket) {
+				replay_mrcp_receive(session);
+			}
+		}
+	}
+}
+
+static apt_bool_t replay_sip_send(replay_session_t *session, const replay_packet_t *packet, apr_pool_t *pool)
+{
+	const char *msg;
+	apr_size_t length;
+	if(strncmp(packet->data.buf,"INVITE ",7) != 0 || session->answered == TRUE) {
+		/* requests other than the initial INVITE are in (or end) the dialog */
+		if(replay_wait(session,apr_time_now() + session->config->timeout,REPLAY_WAIT_ANSWER) == FALSE) {
+			session->result->error = "no answer to INVITE";
+			return FALSE;
+		}
+	}
+	msg = replay_sip_rewrite(session,packet,pool);
+	length = strlen(msg);
+	return apr_socket_sendto(session->sip_socket,session->sip_addr,0,msg,&length) == APR_SUCCESS ? TRUE : FALSE;
+}
+
+static apt_bool_t replay_mrcp_send(replay_session_t *session, const replay_packet_t *packet, apr_pool_t *pool)
+{
+	apt_text_stream_t stream;
+	mrcp_message_t *message = NULL;
+	char *buf;
+	apr_size_t size;
+	apr_size_t length;
+
+	if(replay_wait(session,apr_time_now() + session->config->timeout,REPLAY_WAIT_MRCP) == FALSE || !session->mrcp_socket) {
+		session->result->error = "no MRCP connection";
+		return FALSE;
+	}
+
+	/* parse the request and generate it anew with the session-id of the answer */
+	buf = apr_pstrmemdup(pool,packet->data.buf,packet->data.length);
+	apt_text_stream_init(&stream,buf,packet->data.length);
+	if(mrcp_parser_run(session->parser,&stream,&message) != APT_MESSAGE_STATUS_COMPLETE || !message) {
+		session->parser = mrcp_parser_create(session->config->factory,session->pool);
+		session->result->error = "invalid MRCP request in capture";
+		return FALSE;
+	}
+	if(session->session_id) {
+		apt_string_set(&message->channel_id.session_id,session->session_id);
+	}
+	size = packet->data.length + strlen(session->session_id ? session->session_id : "") + 64;
+	buf = apr_palloc(pool,size);
+	apt_text_stream_init(&stream,buf,size);
+	if(mrcp_generator_run(session->generator,message,&stream) != APT_MESSAGE_STATUS_COMPLETE) {
+		session->result->error = "failed to generate MRCP request";
+		return FALSE;
+	}
+	length = stream.pos - stream.text.buf;
+	return apr_socket_send(session->mrcp_socket,buf,&length) == APR_SUCCESS ? TRUE : FALSE;
+}
+
+static apt_bool_t replay_rtp_send(replay_session_t *session, const replay_packet_t *packet)
+{
+	apr_size_t length = packet->data.length;
+	if(session->answered == FALSE && replay_wait(session,apr_time_now() + session->config->timeout,REPLAY_WAIT_ANSWER) == FALSE) {
+		session->result->error = "no answer to INVITE";
+		return FALSE;
+	}
+	if(!session->rtp_addr) {
+		/* the answer has no audio, skip */
+		return TRUE;
+	}
+	return apr_socket_sendto(session->rtp_socket,session->rtp_addr,0,packet->data.buf,&length) == APR_SUCCESS ? TRUE : FALSE;
+}
+
+/** Create local UDP socket bound to an ephemeral port */
+static apr_socket_t* replay_udp_socket_create(replay_session_t *session, apr_port_t *port)
+{
+	apr_socket_t *socket;
+	apr_sockaddr_t *sockaddr;
+	if(apr_sockaddr_info_get(&sockaddr,session->config->local_ip,APR_INET,0,0,session->pool) != APR_SUCCESS ||
+		apr_socket_create(&socket,sockaddr->family,SOCK_DGRAM,APR_PROTO_UDP,session->pool) != APR_SUCCESS) {
+		return NULL;
+	}
+	if(apr_socket_bind(socket,sockaddr) != APR_SUCCESS ||
+		apr_socket_addr_get(&sockaddr,APR_LOCAL,socket) != APR_SUCCESS) {
+		apr_socket_close(socket);
+		return NULL;
+	}
+	*port = sockaddr->port;
+	return socket;
+}
+
+/** Match the outcome received against the capture, in order per request */
+static void replay_outcome_compare(replay_session_t *session)
+{
+	replay_result_t *result = session->result;
+	const apr_array_header_t *expected = session->call->outcomes;
+	char *matched = apr_pcalloc(session->pool,result->outcomes->nelts + 1);
+	int i, j;
+
+	for(i = 0; i < expected->nelts; i++) {
+		const char *outcome = APR_ARRAY_IDX(expected,i,const char*);
+		for(j = 0; j < result->outcomes->nelts; j++) {
+			if(!matched[j] && strcmp(outcome,APR_ARRAY_IDX(result->outcomes,j,const char*)) == 0) {
+				matched[j] = 1;
+				break;
+			}
+		}
+		if(j == result->outcomes->nelts) {
+			APR_ARRAY_PUSH(result->missing,const char*) = outcome;
+		}
+	}
+	for(j = 0; j < result->outcomes->nelts; j++) {
+		if(!matched[j]) {
+			APR_ARRAY_PUSH(result->unexpected,const char*) = APR_ARRAY_IDX(result->outcomes,j,const char*);
+		}
+	}
+	result->passed = (!result->error && !result->missing->nelts && !result->unexpected->nelts) ? TRUE : FALSE;
+}
+
+apt_bool_t replay_session_run(const replay_call_t *call, const replay_config_t *config, apr_size_t instance, replay_result_t *result, apr_pool_t *pool)
+{
+	replay_session_t session;
+	apr_pool_t *packet_pool;
+	apr_time_t start;
+	int i;
+
+	result->call = call;
+	result->instance = instance;
+	result->passed = FALSE;
+	result->error = NULL;
+	result->outcomes = apr_array_make(pool,call->outcomes->nelts + 1,sizeof(const char*));
+	result->missing = apr_array_make(pool,1,sizeof(const char*));
+	result->unexpected = apr_array_make(pool,1,sizeof(const char*));
+	result->sent = 0;
+	result->elapsed = 0;
+
+	memset(&session,0,sizeof(session));
+	session.call = call;
+	session.config = config;
+	session.result = result;
+	apr_pool_create(&session.pool,pool);
+	apr_pool_create(&packet_pool,session.pool);
+	session.suffix = apr_psprintf(session.pool,"r%"APR_SIZE_T_FMT"x",instance);
+	session.call_id = apr_pstrcat(session.pool,call->call_id,"-",session.suffix,NULL);
+	session.responses = apr_hash_make(session.pool);
+	session.parser = mrcp_parser_create(config->factory,session.pool);
+	session.generator = mrcp_generator_create(config->factory,session.pool);
+
+	session.sip_socket = replay_udp_socket_create(&session,&session.sip_port);
+	session.rtp_socket = replay_udp_socket_create(&session,&session.rtp_port);
+	if(!session.sip_socket || !session.rtp_socket ||
+		apr_sockaddr_info_get(&session.sip_addr,config->target_ip,APR_INET,config->target_port,0,session.pool) != APR_SUCCESS) {
+		result->error = "failed to create sockets";
+		apr_pool_destroy(session.pool);
+		return FALSE;
+	}
+	for(i = 0; i < 3; i++) {
+		session.pollfds[i].p = session.pool;
+		session.pollfds[i].desc_type = APR_POLL_SOCKET;
+		session.pollfds[i].reqevents = APR_POLLIN;
+		session.pollfds[i].rtnevents = 0;
+		session.pollfds[i].client_data = NULL;
+	}
+	session.pollfds[0].desc.s = session.sip_socket;
+	session.pollfds[1].desc.s = session.rtp_socket;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Start Replay [%s] [%d packets]",session.call_id,call->packets->nelts);
+	start = apr_time_now();
+	for(i = 0; i < call->packets->nelts && !result->error; i++) {
+		const replay_packet_t *packet = &APR_ARRAY_IDX(call->packets,i,replay_packet_t);
+		apt_bool_t status = FALSE;
+		if(config->speed > 0) {
+			replay_wait(&session,start + (apr_time_t)(packet->time / config->speed),REPLAY_WAIT_NONE);
+		}
+		switch(packet->type) {
+			case REPLAY_PACKET_SIP:
+				status = replay_sip_send(&session,packet,packet_pool);
+				break;
+			case REPLAY_PACKET_MRCP:
+				status = replay_mrcp_send(&session,packet,packet_pool);
+				break;
+			case REPLAY_PACKET_RTP:
+				status = replay_rtp_send(&session,packet);
+				break;
+		}
+		if(status == TRUE) {
+			result->sent++;
+		}
+		apr_pool_clear(packet_pool);
+	}
+
+	if(!result->error) {
+		/* the outcome may follow the last packet, e.g. the response to the BYE */
+		replay_wait(&session,apr_time_now() + config->timeout,REPLAY_WAIT_OUTCOME);
+	}
+	result->elapsed = apr_time_now() - start;
+	replay_outcome_compare(&session);
+	apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Complete Replay [%s] [%s]",session.call_id,result->passed == TRUE ? "passed" : "failed");
+
+	if(session.mrcp_socket) {
+		apr_socket_close(session.mrcp_socket);
+	}
+	apr_socket_close(session.rtp_socket);
+	apr_socket_close(session.sip_socket);
+	apr_pool_destroy(session.pool);
+	return TRUE;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <apr_strings.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mrcp_resource_loader.h"
+#include "mrcp_resource_factory.h"
+#include "mrcp_message.h"
+#include "mrcp_stream.h"
+#include "mrcp_recog_resource.h"
+
+/** Size of the rx buffer, much less than the body */
+#define BODY_TEST_BUFFER_SIZE  64
+/** Size of the body */
+#define BODY_TEST_BODY_SIZE    10000
+/** Size of the chunks the data is received by */
+#define BODY_TEST_CHUNK_SIZE   100
+/** Number of messages to receive back to back */
+#define BODY_TEST_MESSAGE_COUNT 3
+
+static const char* body_test_message_create(const char *body, apr_pool_t *pool)
+{
+	apr_size_t length = 0;
+	apr_size_t prev_length;
+	const char *header;
+	/* the message-length includes its own digits */
+	do {
+		prev_length = length;
+		header = apr_psprintf(pool,
+			"MRCP/2.0 %"APR_SIZE_T_FMT" DEFINE-GRAMMAR 1\r\n"
+			"Channel-Identifier: 32AECB23433801@speechrecog\r\n"
+			"Content-Type: application/srgs+xml\r\n"
+			"Content-Id: request1@form-level\r\n"
+			"Content-Length: %"APR_SIZE_T_FMT"\r\n"
+			"\r\n",
+			prev_length,strlen(body));
+		length = strlen(header) + strlen(body);
+	}
+	while(length != prev_length);
+	return apr_pstrcat(pool,header,body,NULL);
+}
+
+static apt_bool_t body_buffer_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mrcp_resource_loader_t *resource_loader;
+	mrcp_resource_factory_t *factory;
+	mrcp_parser_t *parser;
+	mrcp_message_t *message;
+	apt_message_status_e msg_status;
+	apt_text_stream_t stream;
+	char buffer[BODY_TEST_BUFFER_SIZE + 1];
+	char *body;
+	char *buf;
+	const char *data;
+	apr_size_t data_length;
+	apr_size_t data_pos = 0;
+	apr_size_t in_place_length = 0;
+	apr_size_t offset;
+	apr_size_t length;
+	apr_size_t count = 0;
+	apr_size_t i;
+	apt_bool_t status = TRUE;
+
+	resource_loader = mrcp_resource_loader_create(TRUE,suite->pool);
+	if(!resource_loader) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Loader");
+		return FALSE;
+	}
+	factory = mrcp_resource_factory_get(resource_loader);
+	if(!factory) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Factory");
+		return FALSE;
+	}
+
+	body = apr_palloc(suite->pool,BODY_TEST_BODY_SIZE + 1);
+	for(i=0; i<BODY_TEST_BODY_SIZE; i++) {
+		body[i] = 'a' + (char)(i % 26);
+	}
+	body[BODY_TEST_BODY_SIZE] = '\0';
+	data = body_test_message_create(body,suite->pool);
+	for(i=1; i<BODY_TEST_MESSAGE_COUNT; i++) {
+		data = apr_pstrcat(suite->pool,data,body_test_message_create(body,suite->pool),NULL);
+	}
+	data_length = strlen(data);
+
+	parser = mrcp_parser_create(factory,suite->pool);
+	apt_text_stream_init(&stream,buffer,BODY_TEST_BUFFER_SIZE);
+	while(data_pos < data_length) {
+		/* follow the receive path of an MRCPv2 connection */
+		offset = stream.pos - stream.text.buf;
+		if(!offset && mrcp_parser_body_buffer_get(parser,&buf,&length) == TRUE && length) {
+			if(length > BODY_TEST_CHUNK_SIZE) {
+				length = BODY_TEST_CHUNK_SIZE;
+			}
+			if(length > data_length - data_pos) {
+				length = data_length - data_pos;
+			}
+			memcpy(buf,data + data_pos,length);
+			mrcp_parser_body_buffer_fill(parser,length);
+			in_place_length += length;
+			stream.text.length = 0;
+		}
+		else {
+			length = BODY_TEST_BUFFER_SIZE - offset;
+			if(length > data_length - data_pos) {
+				length = data_length - data_pos;
+			}
+			memcpy(stream.pos,data + data_pos,length);
+			stream.text.length = offset + length;
+			stream.pos[length] = '\0';
+		}
+		data_pos += length;
+		apt_text_stream_reset(&stream);
+
+		do {
+			msg_status = mrcp_parser_run(parser,&stream,&message);
+			if(msg_status == APT_MESSAGE_STATUS_COMPLETE) {
+				if(message->start_line.method_id != RECOGNIZER_DEFINE_GRAMMAR ||
+					message->body.length != BODY_TEST_BODY_SIZE ||
+					memcmp(message->body.buf,body,BODY_TEST_BODY_SIZE) != 0) {
+					apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Message [%"APR_SIZE_T_FMT"]",count);
+					status = FALSE;
+				}
+				count++;
+			}
+			else if(msg_status == APT_MESSAGE_STATUS_INVALID) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message [%"APR_SIZE_T_FMT"]",count);
+				status = FALSE;
+			}
+		}
+		while(apt_text_is_eos(&stream) == FALSE);
+
+		apt_text_stream_scroll(&stream);
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Parsed [%"APR_SIZE_T_FMT"] messages [%"APR_SIZE_T_FMT"] bytes [%"APR_SIZE_T_FMT"] in place",
+		count,data_length,in_place_length);
+	if(count != BODY_TEST_MESSAGE_COUNT || in_place_length < BODY_TEST_MESSAGE_COUNT * (BODY_TEST_BODY_SIZE - BODY_TEST_BUFFER_SIZE)) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Body Not Received in Place");
+		status = FALSE;
+	}
+
+	mrcp_resource_factory_destroy(factory);
+	return status;
+}
+
+apt_test_suite_t* body_buffer_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"body-buffer",NULL,body_buffer_test_run);
+	return suite;
+}
@@ -14,15 +14,24 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include <apr_file_info.h>
 #include <apr_file_io.h>
+#include <apr_time.h>
 #include "apt_test_suite.h"
 #include "apt_log.h"
+#include "apt_pool.h"
 #include "mrcp_resource_loader.h"
 #include "mrcp_resource_factory.h"
 #include "mrcp_message.h"
+#include "mrcp_message_arena.h"
 #include "mrcp_stream.h"
 
+/** Default number of passes over the corpus in the benchmark mode */
+#define PARSE_BENCH_CYCLE_COUNT 10000
+/** Default directory of the corpus of the benchmark mode */
+#define PARSE_BENCH_CORPUS_DIR  "bench"
+
 static apt_bool_t test_stream_generate(mrcp_generator_t *generator, mrcp_message_t *message)
 {
 	char buffer[500];
@@ -180,6 +189,315 @@ static apt_bool_t test_dir_process(apt_test_suite_t *suite, mrcp_resource_factor
 	return TRUE;
 }
 
+/** Load all the messages of a directory into a single buffer */
+static apt_bool_t test_corpus_load(apt_test_suite_t *suite, const char *dir_name, apt_str_t *corpus)
+{
+	apr_status_t rv;
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	apr_file_t *file;
+	char *file_path;
+	char *buf;
+	apr_size_t length;
+
+	apt_string_reset(corpus);
+	if(apr_dir_open(&dir,dir_name,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Cannot Open Directory [%s]",dir_name);
+		return FALSE;
+	}
+
+	do {
+		rv = apr_dir_read(&finfo,APR_FINFO_DIRENT,dir);
+		if(rv != APR_SUCCESS || finfo.filetype != APR_REG || !finfo.name) {
+			continue;
+		}
+		apr_filepath_merge(&file_path,dir_name,finfo.name,APR_FILEPATH_NATIVE,suite->pool);
+		if(apr_stat(&finfo,file_path,APR_FINFO_SIZE,suite->pool) != APR_SUCCESS ||
+			apr_file_open(&file,file_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,suite->pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open File [%s]",file_path);
+			continue;
+		}
+
+		length = (apr_size_t)finfo.size;
+		buf = apr_palloc(suite->pool,corpus->length + length);
+		if(corpus->length) {
+			memcpy(buf,corpus->buf,corpus->length);
+		}
+		if(apr_file_read_full(file,buf + corpus->length,length,&length) == APR_SUCCESS) {
+			corpus->buf = buf;
+			corpus->length += length;
+		}
+		apr_file_close(file);
+	}
+	while(rv == APR_SUCCESS);
+
+	apr_dir_close(dir);
+	return corpus->length ? TRUE : FALSE;
+}
+
+/** Measure the number of messages parsed per second, running over the corpus of captured messages */
+static apt_bool_t parse_bench_run(apt_test_suite_t *suite, mrcp_resource_factory_t *factory, const char *dir_name, apr_size_t cycle_count, apt_bool_t lazy, apt_bool_t arena)
+{
+	apt_str_t corpus;
+	apt_text_stream_t stream;
+	apr_pool_t *pool;
+	mrcp_parser_t *parser;
+	mrcp_message_t *message;
+	apt_message_status_e msg_status;
+	apr_size_t message_count = 0;
+	apr_size_t pool_size;
+	apr_size_t i;
+	apr_time_t start;
+	apr_time_t elapsed;
+
+	if(test_corpus_load(suite,dir_name,&corpus) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Messages to Parse");
+		return FALSE;
+	}
+
+	/* messages not in arenas are allocated from the pool of the parser, which is accounted per message */
+	pool = apt_subpool_create(suite->pool);
+	parser = mrcp_parser_create(factory,pool);
+	mrcp_parser_lazy_mode_set(parser,lazy);
+	mrcp_parser_arena_mode_set(parser,arena);
+	start = apr_time_now();
+	for(i=0; i<cycle_count; i++) {
+		apt_text_stream_init(&stream,corpus.buf,corpus.length);
+		do {
+			msg_status = mrcp_parser_run(parser,&stream,&message);
+			if(msg_status == APT_MESSAGE_STATUS_COMPLETE) {
+				message_count++;
+				if(arena == TRUE) {
+					mrcp_message_arena_release(message);
+				}
+				else {
+					mrcp_message_destroy(message);
+				}
+			}
+			else if(msg_status == APT_MESSAGE_STATUS_INVALID) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message [%"APR_SIZE_T_FMT"]",message_count);
+				apr_pool_destroy(pool);
+				return FALSE;
+			}
+		}
+		while(apt_text_is_eos(&stream) == FALSE);
+	}
+	elapsed = apr_time_now() - start;
+	if(!elapsed) {
+		elapsed = 1;
+	}
+	pool_size = apt_pool_size_get(pool);
+	apr_pool_destroy(pool);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Parsed (%s%s) [%"APR_SIZE_T_FMT"] messages [%"APR_SIZE_T_FMT" bytes] in [%"APR_TIME_T_FMT" usec] [%.0f msg/sec] [%.1f MB/sec]",
+		lazy == TRUE ? "lazy" : "eager",
+		arena == TRUE ? ", arena" : "",
+		message_count,
+		corpus.length * cycle_count,
+		elapsed,
+		message_count * 1000000.0 / elapsed,
+		corpus.length * cycle_count * 1.0 / elapsed);
+	if(pool_size && message_count) {
+		/* only known with the pool debugging of APR */
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Allocated [%"APR_SIZE_T_FMT" bytes] [%.0f bytes/msg]",
+			pool_size,
+			(double)pool_size / message_count);
+	}
+
+	if(arena == TRUE) {
+		mrcp_message_arena_stats_t stats;
+		mrcp_message_arena_stats_get(&stats);
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Arenas acquired [%"APR_SIZE_T_FMT"] reused [%"APR_SIZE_T_FMT"] [%.1f%%] discarded [%"APR_SIZE_T_FMT"]",
+			stats.acquired,
+			stats.reused,
+			stats.acquired ? stats.reused * 100.0 / stats.acquired : 0.0,
+			stats.discarded);
+		mrcp_message_arena_cache_clear();
+		if(stats.released != stats.acquired || stats.acquired - stats.reused > MRCP_MESSAGE_ARENA_CACHE_SIZE) {
+			/* one message at a time, a single arena should be recycled over and over */
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Arena Stats");
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/** Measure the number of messages generated per second, the corpus is parsed once beforehand */
+static apt_bool_t generate_bench_run(apt_test_suite_t *suite, mrcp_resource_factory_t *factory, const char *dir_name, apr_size_t cycle_count)
+{
+	apt_str_t corpus;
+	apt_text_stream_t stream;
+	apr_array_header_t *messages;
+	mrcp_parser_t *parser;
+	mrcp_generator_t *generator;
+	mrcp_message_t *message;
+	apt_message_status_e msg_status;
+	apr_size_t generated_length = 0;
+	apr_size_t message_count = 0;
+	apr_size_t buffer_size;
+	char *buffer;
+	apr_size_t i;
+	int j;
+	apr_time_t start;
+	apr_time_t elapsed;
+
+	if(test_corpus_load(suite,dir_name,&corpus) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Messages to Generate");
+		return FALSE;
+	}
+
+	messages = apr_array_make(suite->pool,10,sizeof(mrcp_message_t*));
+	parser = mrcp_parser_create(factory,suite->pool);
+	apt_text_stream_init(&stream,corpus.buf,corpus.length);
+	do {
+		msg_status = mrcp_parser_run(parser,&stream,&message);
+		if(msg_status == APT_MESSAGE_STATUS_COMPLETE) {
+			APR_ARRAY_PUSH(messages,mrcp_message_t*) = message;
+		}
+		else if(msg_status == APT_MESSAGE_STATUS_INVALID) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message [%d]",messages->nelts);
+			return FALSE;
+		}
+	}
+	while(apt_text_is_eos(&stream) == FALSE);
+
+	/* any message generated fits the buffer at once, it is no longer than the whole corpus plus reformatting */
+	buffer_size = corpus.length * 2 + 1024;
+	buffer = apr_palloc(suite->pool,buffer_size);
+	generator = mrcp_generator_create(factory,suite->pool);
+	start = apr_time_now();
+	for(i=0; i<cycle_count; i++) {
+		for(j=0; j<messages->nelts; j++) {
+			message = APR_ARRAY_IDX(messages,j,mrcp_message_t*);
+			apt_text_stream_init(&stream,buffer,buffer_size);
+			if(mrcp_generator_run(generator,message,&stream) != APT_MESSAGE_STATUS_COMPLETE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Generate Message [%d]",j);
+				return FALSE;
+			}
+			generated_length += stream.pos - stream.text.buf;
+			message_count++;
+		}
+	}
+	elapsed = apr_time_now() - start;
+	if(!elapsed) {
+		elapsed = 1;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Generated [%"APR_SIZE_T_FMT"] messages [%"APR_SIZE_T_FMT" bytes] in [%"APR_TIME_T_FMT" usec] [%.0f msg/sec] [%.1f MB/sec]",
+		message_count,
+		generated_length,
+		elapsed,
+		message_count * 1000000.0 / elapsed,
+		generated_length * 1.0 / elapsed);
+
+	for(j=0; j<messages->nelts; j++) {
+		mrcp_message_destroy(APR_ARRAY_IDX(messages,j,mrcp_message_t*));
+	}
+	return TRUE;
+}
+
+/** Compare the header fields of the messages parsed in the eager and lazy modes */
+static apt_bool_t lazy_message_compare(const mrcp_message_t *eager_message, const mrcp_message_t *lazy_message, apr_pool_t *pool)
+{
+	const mrcp_header_accessor_t *accessor;
+	const apt_header_field_t *eager_field;
+	const apt_header_field_t *lazy_field;
+	apr_size_t id;
+
+	for(id=0; id<eager_message->header.header_section.arr_size; id++) {
+		/* the check parses the pending value */
+		if(mrcp_generic_header_property_check(eager_message,id) != mrcp_generic_header_property_check(lazy_message,id)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Field Mismatch [%"APR_SIZE_T_FMT"]",id);
+			return FALSE;
+		}
+	}
+	if(lazy_message->header.pending_count) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Pending Fields Left [%"APR_SIZE_T_FMT"]",lazy_message->header.pending_count);
+		return FALSE;
+	}
+
+	for(id=0; id<eager_message->header.header_section.arr_size; id++) {
+		if(!eager_message->header.header_section.arr[id]) {
+			continue;
+		}
+		/* regenerate the values from the parsed data to compare them */
+		if(id < GENERIC_HEADER_COUNT) {
+			eager_field = mrcp_header_field_value_generate(&eager_message->header.generic_header_accessor,id,FALSE,pool);
+			lazy_field = mrcp_header_field_value_generate(&lazy_message->header.generic_header_accessor,id,FALSE,pool);
+		}
+		else {
+			accessor = &eager_message->header.resource_header_accessor;
+			eager_field = mrcp_header_field_value_generate(accessor,id - GENERIC_HEADER_COUNT,FALSE,pool);
+			accessor = &lazy_message->header.resource_header_accessor;
+			lazy_field = mrcp_header_field_value_generate(accessor,id - GENERIC_HEADER_COUNT,FALSE,pool);
+		}
+		if(!eager_field || !lazy_field || eager_field->value.length != lazy_field->value.length ||
+			(eager_field->value.length && apt_string_compare(&eager_field->value,&lazy_field->value) == FALSE)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Value Mismatch [%"APR_SIZE_T_FMT"]",id);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/** Parse the corpus in the eager and lazy modes and check the results are the same */
+static apt_bool_t lazy_parse_check(apt_test_suite_t *suite, mrcp_resource_factory_t *factory, const char *dir_name)
+{
+	apt_str_t corpus;
+	apt_text_stream_t eager_stream;
+	apt_text_stream_t lazy_stream;
+	mrcp_parser_t *eager_parser;
+	mrcp_parser_t *lazy_parser;
+	mrcp_message_t *eager_message;
+	mrcp_message_t *lazy_message;
+	apt_message_status_e eager_status;
+	apt_message_status_e lazy_status;
+	apr_size_t message_count = 0;
+	apr_size_t pending_count = 0;
+	apt_bool_t status = TRUE;
+
+	if(test_corpus_load(suite,dir_name,&corpus) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Messages to Parse");
+		return FALSE;
+	}
+
+	eager_parser = mrcp_parser_create(factory,suite->pool);
+	lazy_parser = mrcp_parser_create(factory,suite->pool);
+	mrcp_parser_lazy_mode_set(lazy_parser,TRUE);
+	apt_text_stream_init(&eager_stream,corpus.buf,corpus.length);
+	apt_text_stream_init(&lazy_stream,corpus.buf,corpus.length);
+	do {
+		eager_status = mrcp_parser_run(eager_parser,&eager_stream,&eager_message);
+		lazy_status = mrcp_parser_run(lazy_parser,&lazy_stream,&lazy_message);
+		if(eager_status != lazy_status) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Status Mismatch [%"APR_SIZE_T_FMT"]",message_count);
+			return FALSE;
+		}
+		if(eager_status == APT_MESSAGE_STATUS_COMPLETE) {
+			pending_count += lazy_message->header.pending_count;
+			if(lazy_message_compare(eager_message,lazy_message,suite->pool) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Lazy Parse Mismatch [%"APR_SIZE_T_FMT"]",message_count);
+				status = FALSE;
+			}
+			message_count++;
+			mrcp_message_destroy(eager_message);
+			mrcp_message_destroy(lazy_message);
+		}
+		else if(eager_status == APT_MESSAGE_STATUS_INVALID) {
+			return FALSE;
+		}
+	}
+	while(apt_text_is_eos(&eager_stream) == FALSE && status == TRUE);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Compared [%"APR_SIZE_T_FMT"] messages parsed lazily [%"APR_SIZE_T_FMT"] fields pending",
+		message_count,pending_count);
+	if(!pending_count) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Pending Fields");
+		status = FALSE;
+	}
+	return status;
+}
+
 static apt_bool_t parse_gen_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
 {
 	mrcp_resource_factory_t *factory;
@@ -196,6 +514,27 @@ static apt_bool_t parse_gen_test_run(apt_test_suite_t *suite, int argc, const ch
 		return FALSE;
 	}
 
+	if(argc > 0 && strcasecmp(argv[0],"bench") == 0) {
+		/* non-interactive benchmark: parse-gen bench [cycle count] [corpus dir] */
+		apr_size_t cycle_count = argc > 1 ? (apr_size_t)atol(argv[1]) : PARSE_BENCH_CYCLE_COUNT;
+		const char *dir_name = argc > 2 ? argv[2] : PARSE_BENCH_CORPUS_DIR;
+		apt_bool_t status = lazy_parse_check(suite,factory,dir_name);
+		if(status == TRUE) {
+			status = parse_bench_run(suite,factory,dir_name,cycle_count,FALSE,FALSE);
+		}
+		if(status == TRUE) {
+			status = parse_bench_run(suite,factory,dir_name,cycle_count,TRUE,FALSE);
+		}
+		if(status == TRUE) {
+			status = parse_bench_run(suite,factory,dir_name,cycle_count,FALSE,TRUE);
+		}
+		if(status == TRUE) {
+			status = generate_bench_run(suite,factory,dir_name,cycle_count);
+		}
+		mrcp_resource_factory_destroy(factory);
+		return status;
+	}
+
 	test_dir_process(suite,factory,MRCP_VERSION_2);
 	test_dir_process(suite,factory,MRCP_VERSION_1);
 
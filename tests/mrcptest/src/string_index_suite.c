@@ -0,0 +1,157 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctype.h>
+#include <apr_time.h>
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mrcp_resource_loader.h"
+#include "mrcp_resource_factory.h"
+#include "mrcp_resource.h"
+#include "mrcp_generic_header.h"
+
+/** Number of lookups to measure */
+#define STRING_INDEX_TEST_LOOKUP_COUNT 1000000
+
+/** Check the index against the linear search for each string of the table and its variations */
+static apt_bool_t string_index_check(const char *name, const apt_str_table_item_t *table, apr_size_t size, const apt_str_table_index_t *index)
+{
+	char buf[64];
+	apt_str_t value;
+	apr_size_t i,j;
+	if(!index) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Index of [%s]",name);
+		return FALSE;
+	}
+	for(i=0; i<size; i++) {
+		if(apt_string_table_index_find(table,size,index,&table[i].value) != i) {
+			/* the index is out of date, regenerate it by strtablegen */
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Stale Index of [%s] at [%s]",name,table[i].value.buf);
+			return FALSE;
+		}
+		if(table[i].value.length >= sizeof(buf)) {
+			continue;
+		}
+		for(j=0; j<table[i].value.length; j++) {
+			buf[j] = (char)tolower(table[i].value.buf[j]);
+		}
+		value.buf = buf;
+		value.length = table[i].value.length;
+		if(apt_string_table_index_find(table,size,index,&value) != i) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Find [%s] in [%s] by Index",table[i].value.buf,name);
+			return FALSE;
+		}
+		value.length--;
+		if(apt_string_table_index_find(table,size,index,&value) != apt_string_table_id_find(table,size,&value)) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Match of [%.*s] in [%s]",(int)value.length,value.buf,name);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void string_index_measure(const mrcp_header_vtable_t *vtable)
+{
+	apr_time_t start;
+	apr_time_t linear_time;
+	apr_time_t index_time;
+	apr_size_t sum = 0;
+	apr_size_t i;
+
+	start = apr_time_now();
+	for(i=0; i<STRING_INDEX_TEST_LOOKUP_COUNT; i++) {
+		sum += apt_string_table_id_find(vtable->field_table,vtable->field_count,
+					&vtable->field_table[i % vtable->field_count].value);
+	}
+	linear_time = apr_time_now() - start;
+
+	start = apr_time_now();
+	for(i=0; i<STRING_INDEX_TEST_LOOKUP_COUNT; i++) {
+		sum += apt_string_table_index_find(vtable->field_table,vtable->field_count,vtable->field_index,
+					&vtable->field_table[i % vtable->field_count].value);
+	}
+	index_time = apr_time_now() - start;
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Header Lookup [%"APR_SIZE_T_FMT"] fields linear [%.1f ns] index [%.1f ns] (%"APR_SIZE_T_FMT")",
+		vtable->field_count,
+		linear_time * 1000.0 / STRING_INDEX_TEST_LOOKUP_COUNT,
+		index_time * 1000.0 / STRING_INDEX_TEST_LOOKUP_COUNT,
+		sum);
+}
+
+static apt_bool_t string_index_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mrcp_resource_loader_t *resource_loader;
+	mrcp_resource_factory_t *factory;
+	const mrcp_resource_t *resource;
+	const mrcp_header_vtable_t *vtable;
+	mrcp_resource_id id;
+	mrcp_version_e version;
+	apt_bool_t status = TRUE;
+
+	resource_loader = mrcp_resource_loader_create(TRUE,suite->pool);
+	if(!resource_loader) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Loader");
+		return FALSE;
+	}
+	factory = mrcp_resource_factory_get(resource_loader);
+	if(!factory) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Create Resource Factory");
+		return FALSE;
+	}
+
+	for(version=MRCP_VERSION_1; version<=MRCP_VERSION_2; version++) {
+		vtable = mrcp_generic_header_vtable_get(version);
+		if(string_index_check("generic-header",vtable->field_table,vtable->field_count,vtable->field_index) == FALSE) {
+			status = FALSE;
+		}
+
+		for(id=0; id<MRCP_RESOURCE_TYPE_COUNT; id++) {
+			resource = mrcp_resource_get(factory,id);
+			if(!resource) {
+				continue;
+			}
+			if(!resource->get_method_str_index || !resource->get_event_str_index ||
+				string_index_check(resource->name.buf,resource->get_method_str_table(version),resource->method_count,
+					resource->get_method_str_index(version)) == FALSE ||
+				string_index_check(resource->name.buf,resource->get_event_str_table(version),resource->event_count,
+					resource->get_event_str_index(version)) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Method Index of [%s]",resource->name.buf);
+				status = FALSE;
+			}
+
+			vtable = resource->get_resource_header_vtable(version);
+			if(string_index_check(resource->name.buf,vtable->field_table,vtable->field_count,vtable->field_index) == FALSE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Invalid Header Index of [%s]",resource->name.buf);
+				status = FALSE;
+			}
+		}
+	}
+
+	resource = mrcp_resource_get(factory,MRCP_RECOGNIZER_RESOURCE);
+	if(resource && status == TRUE) {
+		string_index_measure(resource->get_resource_header_vtable(MRCP_VERSION_2));
+	}
+
+	mrcp_resource_factory_destroy(factory);
+	return status;
+}
+
+apt_test_suite_t* string_index_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"string-index",NULL,string_index_test_run);
+	return suite;
+}
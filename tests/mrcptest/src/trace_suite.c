@@ -0,0 +1,108 @@
+/*
+ * Copyright 2008-2015 Arsen Chaloyan
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apt_test_suite.h"
+#include "apt_log.h"
+#include "mrcp_message_trace.h"
+
+/** Number of records emitted */
+static apr_size_t trace_record_count = 0;
+
+static void trace_record_handle(const mrcp_message_t *message, const mrcp_message_trace_t *trace)
+{
+	int i;
+	for(i = 0; i < MRCP_TRACE_POINT_COUNT; i++) {
+		apt_log(APT_LOG_MARK,APT_PRIO_INFO,"Trace Point [%s] %"APR_INT64_T_FMT,
+			mrcp_message_trace_point_name_get(i),
+			trace->stamps[i]);
+	}
+	trace_record_count++;
+}
+
+static mrcp_message_t* trace_request_create(apr_pool_t *pool)
+{
+	mrcp_message_t *request = mrcp_message_create(pool);
+	request->start_line.message_type = MRCP_MESSAGE_TYPE_REQUEST;
+	request->start_line.request_id = 1;
+	apt_string_set(&request->start_line.method_name,"RECOGNIZE");
+	return request;
+}
+
+static apt_bool_t trace_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
+{
+	mrcp_message_t *request;
+	mrcp_message_t *response;
+	mrcp_message_t *event;
+	const apr_int64_t *stamps;
+
+	mrcp_message_trace_handler_set(trace_record_handle);
+
+	/* nothing is traced, unless enabled */
+	request = trace_request_create(suite->pool);
+	mrcp_message_trace_start(request);
+	if(request->trace) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Trace of Request");
+		return FALSE;
+	}
+
+	mrcp_message_trace_enable(TRUE);
+	mrcp_message_trace_start(request);
+	if(!request->trace) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Start Trace");
+		mrcp_message_trace_enable(FALSE);
+		return FALSE;
+	}
+	stamps = request->trace->stamps;
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_DISPATCHED);
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_PROCESSED);
+
+	/* the response and the events share the trace of the request */
+	response = mrcp_response_create(request,suite->pool);
+	response->start_line.request_state = MRCP_REQUEST_STATE_INPROGRESS;
+	mrcp_message_trace_sent(response);
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_FIRST_AUDIO);
+	mrcp_message_trace_stamp(request,MRCP_TRACE_POINT_INPUT_STARTED);
+	if(trace_record_count || !stamps[MRCP_TRACE_POINT_RESPONSE_SENT]) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Record of Request in Progress");
+		mrcp_message_trace_enable(FALSE);
+		return FALSE;
+	}
+
+	event = mrcp_event_create(request,1,suite->pool);
+	event->start_line.request_state = MRCP_REQUEST_STATE_COMPLETE;
+	mrcp_message_trace_sent(event);
+	mrcp_message_trace_sent(event);
+	mrcp_message_trace_enable(FALSE);
+	mrcp_message_trace_handler_set(NULL);
+
+	if(trace_record_count != 1) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Unexpected Number of Records [%"APR_SIZE_T_FMT"]",trace_record_count);
+		return FALSE;
+	}
+	if(stamps[MRCP_TRACE_POINT_COMPLETE_SENT] < stamps[MRCP_TRACE_POINT_INPUT_STARTED] ||
+		stamps[MRCP_TRACE_POINT_FIRST_AUDIO] < stamps[MRCP_TRACE_POINT_RESPONSE_SENT] ||
+		stamps[MRCP_TRACE_POINT_DISPATCHED] < stamps[MRCP_TRACE_POINT_RECEIVED]) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Trace Points out of Order");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+apt_test_suite_t* trace_test_suite_create(apr_pool_t *pool)
+{
+	apt_test_suite_t *suite = apt_test_suite_create(pool,"trace",NULL,trace_test_run);
+	return suite;
+}
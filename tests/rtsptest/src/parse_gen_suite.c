@@ -14,12 +14,20 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include <apr_file_info.h>
 #include <apr_file_io.h>
+#include <apr_time.h>
 #include "apt_test_suite.h"
 #include "apt_log.h"
+#include "apt_pool.h"
 #include "rtsp_stream.h"
 
+/** Default number of passes over the corpus in the benchmark mode */
+#define PARSE_BENCH_CYCLE_COUNT 10000
+/** Default directory of the corpus of the benchmark mode */
+#define PARSE_BENCH_CORPUS_DIR  "bench"
+
 static apt_bool_t test_stream_generate(rtsp_generator_t *generator, rtsp_message_t *message)
 {
 	char buffer[500];
@@ -144,8 +152,198 @@ static apt_bool_t test_dir_process(apt_test_suite_t *suite)
 	return TRUE;
 }
 
+/** Load all the messages of a directory into a single buffer */
+static apt_bool_t test_corpus_load(apt_test_suite_t *suite, const char *dir_name, apt_str_t *corpus)
+{
+	apr_status_t rv;
+	apr_dir_t *dir;
+	apr_finfo_t finfo;
+	apr_file_t *file;
+	char *file_path;
+	char *buf;
+	apr_size_t length;
+
+	apt_string_reset(corpus);
+	if(apr_dir_open(&dir,dir_name,suite->pool) != APR_SUCCESS) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Cannot Open Directory [%s]",dir_name);
+		return FALSE;
+	}
+
+	do {
+		rv = apr_dir_read(&finfo,APR_FINFO_DIRENT,dir);
+		if(rv != APR_SUCCESS || finfo.filetype != APR_REG || !finfo.name) {
+			continue;
+		}
+		apr_filepath_merge(&file_path,dir_name,finfo.name,APR_FILEPATH_NATIVE,suite->pool);
+		if(apr_stat(&finfo,file_path,APR_FINFO_SIZE,suite->pool) != APR_SUCCESS ||
+			apr_file_open(&file,file_path,APR_FOPEN_READ | APR_FOPEN_BINARY,APR_OS_DEFAULT,suite->pool) != APR_SUCCESS) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Open File [%s]",file_path);
+			continue;
+		}
+
+		length = (apr_size_t)finfo.size;
+		buf = apr_palloc(suite->pool,corpus->length + length);
+		if(corpus->length) {
+			memcpy(buf,corpus->buf,corpus->length);
+		}
+		if(apr_file_read_full(file,buf + corpus->length,length,&length) == APR_SUCCESS) {
+			corpus->buf = buf;
+			corpus->length += length;
+		}
+		apr_file_close(file);
+	}
+	while(rv == APR_SUCCESS);
+
+	apr_dir_close(dir);
+	return corpus->length ? TRUE : FALSE;
+}
+
+/** Measure the number of messages parsed per second, running over the corpus of captured messages */
+static apt_bool_t parse_bench_run(apt_test_suite_t *suite, const char *dir_name, apr_size_t cycle_count)
+{
+	apt_str_t corpus;
+	apt_text_stream_t stream;
+	apr_pool_t *pool;
+	rtsp_parser_t *parser;
+	rtsp_message_t *message;
+	apt_message_status_e msg_status;
+	apr_size_t message_count = 0;
+	apr_size_t pool_size = 0;
+	apr_size_t i;
+	apr_time_t start;
+	apr_time_t elapsed;
+
+	if(test_corpus_load(suite,dir_name,&corpus) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Messages to Parse");
+		return FALSE;
+	}
+
+	/* messages are allocated from the pool of the parser, which is cleared after each pass, as a connection is closed */
+	pool = apt_subpool_create(suite->pool);
+	start = apr_time_now();
+	for(i=0; i<cycle_count; i++) {
+		parser = rtsp_parser_create(pool);
+		apt_text_stream_init(&stream,corpus.buf,corpus.length);
+		do {
+			msg_status = rtsp_parser_run(parser,&stream,&message);
+			if(msg_status == APT_MESSAGE_STATUS_COMPLETE) {
+				message_count++;
+				rtsp_message_destroy(message);
+			}
+			else if(msg_status == APT_MESSAGE_STATUS_INVALID) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message [%"APR_SIZE_T_FMT"]",message_count);
+				apr_pool_destroy(pool);
+				return FALSE;
+			}
+		}
+		while(apt_text_is_eos(&stream) == FALSE);
+		pool_size += apt_pool_size_get(pool);
+		apr_pool_clear(pool);
+	}
+	elapsed = apr_time_now() - start;
+	if(!elapsed) {
+		elapsed = 1;
+	}
+	apr_pool_destroy(pool);
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Parsed [%"APR_SIZE_T_FMT"] messages [%"APR_SIZE_T_FMT" bytes] in [%"APR_TIME_T_FMT" usec] [%.0f msg/sec] [%.1f MB/sec]",
+		message_count,
+		corpus.length * cycle_count,
+		elapsed,
+		message_count * 1000000.0 / elapsed,
+		corpus.length * cycle_count * 1.0 / elapsed);
+	if(pool_size && message_count) {
+		/* only known with the pool debugging of APR */
+		apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Allocated [%"APR_SIZE_T_FMT" bytes] [%.0f bytes/msg]",
+			pool_size,
+			(double)pool_size / message_count);
+	}
+	return TRUE;
+}
+
+/** Measure the number of messages generated per second, the corpus is parsed once beforehand */
+static apt_bool_t generate_bench_run(apt_test_suite_t *suite, const char *dir_name, apr_size_t cycle_count)
+{
+	apt_str_t corpus;
+	apt_text_stream_t stream;
+	apr_array_header_t *messages;
+	rtsp_parser_t *parser;
+	rtsp_generator_t *generator;
+	rtsp_message_t *message;
+	apt_message_status_e msg_status;
+	apr_size_t generated_length = 0;
+	apr_size_t message_count = 0;
+	apr_size_t buffer_size;
+	char *buffer;
+	apr_size_t i;
+	int j;
+	apr_time_t start;
+	apr_time_t elapsed;
+
+	if(test_corpus_load(suite,dir_name,&corpus) == FALSE) {
+		apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"No Messages to Generate");
+		return FALSE;
+	}
+
+	messages = apr_array_make(suite->pool,10,sizeof(rtsp_message_t*));
+	parser = rtsp_parser_create(suite->pool);
+	apt_text_stream_init(&stream,corpus.buf,corpus.length);
+	do {
+		msg_status = rtsp_parser_run(parser,&stream,&message);
+		if(msg_status == APT_MESSAGE_STATUS_COMPLETE) {
+			APR_ARRAY_PUSH(messages,rtsp_message_t*) = message;
+		}
+		else if(msg_status == APT_MESSAGE_STATUS_INVALID) {
+			apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Parse Message [%d]",messages->nelts);
+			return FALSE;
+		}
+	}
+	while(apt_text_is_eos(&stream) == FALSE);
+
+	/* any message generated fits the buffer at once, it is no longer than the whole corpus plus reformatting */
+	buffer_size = corpus.length * 2 + 1024;
+	buffer = apr_palloc(suite->pool,buffer_size);
+	generator = rtsp_generator_create(suite->pool);
+	start = apr_time_now();
+	for(i=0; i<cycle_count; i++) {
+		for(j=0; j<messages->nelts; j++) {
+			message = APR_ARRAY_IDX(messages,j,rtsp_message_t*);
+			apt_text_stream_init(&stream,buffer,buffer_size);
+			if(rtsp_generator_run(generator,message,&stream) != APT_MESSAGE_STATUS_COMPLETE) {
+				apt_log(APT_LOG_MARK,APT_PRIO_WARNING,"Failed to Generate Message [%d]",j);
+				return FALSE;
+			}
+			generated_length += stream.pos - stream.text.buf;
+			message_count++;
+		}
+	}
+	elapsed = apr_time_now() - start;
+	if(!elapsed) {
+		elapsed = 1;
+	}
+
+	apt_log(APT_LOG_MARK,APT_PRIO_NOTICE,"Generated [%"APR_SIZE_T_FMT"] messages [%"APR_SIZE_T_FMT" bytes] in [%"APR_TIME_T_FMT" usec] [%.0f msg/sec] [%.1f MB/sec]",
+		message_count,
+		generated_length,
+		elapsed,
+		message_count * 1000000.0 / elapsed,
+		generated_length * 1.0 / elapsed);
+	return TRUE;
+}
+
 static apt_bool_t parse_gen_test_run(apt_test_suite_t *suite, int argc, const char * const *argv)
 {
+	if(argc > 0 && strcasecmp(argv[0],"bench") == 0) {
+		/* non-interactive benchmark: parse-gen bench [cycle count] [corpus dir] */
+		apr_size_t cycle_count = argc > 1 ? (apr_size_t)atol(argv[1]) : PARSE_BENCH_CYCLE_COUNT;
+		const char *dir_name = argc > 2 ? argv[2] : PARSE_BENCH_CORPUS_DIR;
+		apt_bool_t status = parse_bench_run(suite,dir_name,cycle_count);
+		if(status == TRUE) {
+			status = generate_bench_run(suite,dir_name,cycle_count);
+		}
+		return status;
+	}
+
 	test_dir_process(suite);
 	return TRUE;
 }
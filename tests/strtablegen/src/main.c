@@ -93,11 +93,31 @@ static apt_bool_t string_table_write(const apt_str_table_item_t table[], apr_siz
 	return TRUE;
 }
 
+static apt_bool_t string_table_index_write(const apt_str_table_index_t *index, apr_size_t count, const char *name, FILE *file)
+{
+	apr_size_t i;
+	fprintf(file,"\r\n/** Perfect hash index of %s */\r\n",name);
+	fprintf(file,"static const apr_int32_t %s_buckets[] = {",name);
+	for(i=0; i<count; i++) {
+		fprintf(file,"%s%d",i ? "," : "",index->buckets[i]);
+	}
+	fprintf(file,"};\r\n");
+	fprintf(file,"static const apr_size_t %s_ids[] = {",name);
+	for(i=0; i<count; i++) {
+		fprintf(file,"%s%"APR_SIZE_T_FMT,i ? "," : "",index->ids[i]);
+	}
+	fprintf(file,"};\r\n");
+	fprintf(file,"static const apt_str_table_index_t %s_index = {%s_buckets,%s_ids};\r\n",name,name,name);
+	return TRUE;
+}
+
 int main(int argc, char *argv[])
 {
 	apr_pool_t *pool = NULL;
 	apt_str_table_item_t table[100];
+	apt_str_table_index_t *index;
 	apr_size_t count;
+	const char *name = "string_table";
 	FILE *file_in, *file_out;
 
 	/* one time apr global initialization */
@@ -107,7 +127,7 @@ int main(int argc, char *argv[])
 	pool = apt_pool_create();
 
 	if(argc < 2) {
-		printf("usage: stringtablegen stringtable.in [stringtable.out]\n");
+		printf("usage: stringtablegen stringtable.in [stringtable.out] [name]\n");
 		return 0;
 	}
 	file_in = fopen(argv[1], "rb");
@@ -122,6 +142,9 @@ int main(int argc, char *argv[])
 	else {
 		file_out = stdout;
 	}
+	if(argc > 3) {
+		name = argv[3];
+	}
 
 	/* read items (strings) from the file */
 	count = string_table_read(table,100,file_in,pool);
@@ -132,6 +155,15 @@ int main(int argc, char *argv[])
 	/* dump string table to the file */
 	string_table_write(table,count,file_out);
 
+	/* generate and dump perfect hash index */
+	index = apt_string_table_index_generate(table,count,pool);
+	if(index) {
+		string_table_index_write(index,count,name,file_out);
+	}
+	else {
+		printf("cannot generate index of %s\n", argv[1]);
+	}
+
 	fclose(file_in);
 	if(file_out != stdout) {
 		fclose(file_out);